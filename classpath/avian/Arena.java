@@ -0,0 +1,195 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import sun.misc.Unsafe;
+
+/**
+ * Memory outside the heap for great numbers of small records, handed
+ * out by bumping a pointer through segments, as the VM's Zone does,
+ * and freed all at once when the arena is closed.  The collector never
+ * scans it, so it may hold only primitive data, which is read and
+ * written through the static accessors below at addresses returned by
+ * allocate.  The compiler turns calls to those accessors into plain
+ * loads and stores, as it does Unsafe's; like Unsafe's, they check
+ * nothing, so an address must be used neither past the end of what
+ * was allocated there nor once its arena has been closed.
+ *
+ * An arena may be used by only one thread at a time.
+ */
+public final class Arena implements AutoCloseable {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+
+  private static final long DefaultAlignment = 8;
+  private static final long MinimumSegmentSize = 64 * 1024;
+  private static final long MaximumSegmentSize = 64 * 1024 * 1024;
+
+  private long[] segments = new long[8];
+  private int segmentCount;
+  // the size of the next segment, which doubles each time up to
+  // MaximumSegmentSize
+  private long segmentSize;
+  private long position;
+  private long limit;
+  private long footprint;
+  private boolean closed;
+
+  public Arena() {
+    this(MinimumSegmentSize);
+  }
+
+  public Arena(long initialSegmentSize) {
+    if (initialSegmentSize <= 0) {
+      throw new IllegalArgumentException();
+    }
+    segmentSize = initialSegmentSize;
+  }
+
+  /**
+   * Returns the address of size bytes aligned to eight, which is enough
+   * for any of the accessors.  Their contents are undefined.
+   */
+  public long allocate(long size) {
+    return allocate(size, DefaultAlignment);
+  }
+
+  /**
+   * Returns the address of size bytes aligned to alignment, which must
+   * be a power of two.  Their contents are undefined.
+   */
+  public long allocate(long size, long alignment) {
+    if (size < 0 || alignment <= 0 || (alignment & (alignment - 1)) != 0) {
+      throw new IllegalArgumentException();
+    }
+
+    long address = align(position, alignment);
+    if (limit != 0 && address <= limit && size <= limit - address) {
+      position = address + size;
+      return address;
+    } else {
+      return allocateSlow(size, alignment);
+    }
+  }
+
+  private long allocateSlow(long size, long alignment) {
+    if (closed) {
+      throw new IllegalStateException("arena closed");
+    }
+
+    long needed = size + alignment - 1;
+    if (needed > segmentSize) {
+      // too big to share, so it gets a segment of its own, and we go on
+      // filling the current one
+      return align(addSegment(needed), alignment);
+    }
+
+    long segment = addSegment(segmentSize);
+    limit = segment + segmentSize;
+    segmentSize = Math.min(segmentSize * 2,
+                           Math.max(segmentSize, MaximumSegmentSize));
+
+    long address = align(segment, alignment);
+    position = address + size;
+    return address;
+  }
+
+  private long addSegment(long size) {
+    long segment = unsafe.allocateMemory(size);
+
+    if (segmentCount == segments.length) {
+      long[] newSegments = new long[segments.length * 2];
+      System.arraycopy(segments, 0, newSegments, 0, segmentCount);
+      segments = newSegments;
+    }
+    segments[segmentCount++] = segment;
+    footprint += size;
+
+    return segment;
+  }
+
+  private static long align(long address, long alignment) {
+    return (address + alignment - 1) & -alignment;
+  }
+
+  /**
+   * Returns the number of bytes the arena has claimed from the system,
+   * which includes what remains unused at the end of each segment.
+   */
+  public long footprint() {
+    return footprint;
+  }
+
+  /**
+   * Frees everything allocated from the arena, after which it may not
+   * be used again.  Closing it more than once does nothing.
+   */
+  public void close() {
+    if (! closed) {
+      closed = true;
+      for (int i = 0; i < segmentCount; ++i) {
+        unsafe.freeMemory(segments[i]);
+      }
+      segments = null;
+      segmentCount = 0;
+      position = 0;
+      limit = 0;
+      footprint = 0;
+    }
+  }
+
+  public static byte getByte(long address) {
+    return unsafe.getByte(address);
+  }
+
+  public static void putByte(long address, byte value) {
+    unsafe.putByte(address, value);
+  }
+
+  public static short getShort(long address) {
+    return unsafe.getShort(address);
+  }
+
+  public static void putShort(long address, short value) {
+    unsafe.putShort(address, value);
+  }
+
+  public static int getInt(long address) {
+    return unsafe.getInt(address);
+  }
+
+  public static void putInt(long address, int value) {
+    unsafe.putInt(address, value);
+  }
+
+  public static long getLong(long address) {
+    return unsafe.getLong(address);
+  }
+
+  public static void putLong(long address, long value) {
+    unsafe.putLong(address, value);
+  }
+
+  public static float getFloat(long address) {
+    return unsafe.getFloat(address);
+  }
+
+  public static void putFloat(long address, float value) {
+    unsafe.putFloat(address, value);
+  }
+
+  public static double getDouble(long address) {
+    return unsafe.getDouble(address);
+  }
+
+  public static void putDouble(long address, double value) {
+    unsafe.putDouble(address, value);
+  }
+}
@@ -26,19 +26,27 @@ public class Assembler {
 
   public static final int aaload = 0x32;
   public static final int aastore = 0x53;
+  public static final int aconst_null = 0x01;
   public static final int aload = 0x19;
   public static final int aload_0 = 0x2a;
   public static final int aload_1 = 0x2b;
+  public static final int aload_2 = 0x2c;
+  public static final int aload_3 = 0x2d;
   public static final int astore_0 = 0x4b;
+  public static final int astore_3 = 0x4e;
   public static final int anewarray = 0xbd;
   public static final int areturn = 0xb0;
+  public static final int athrow = 0xbf;
+  public static final int checkcast = 0xc0;
   public static final int dload = 0x18;
   public static final int dreturn = 0xaf;
   public static final int dup = 0x59;
   public static final int fload = 0x17;
   public static final int freturn = 0xae;
   public static final int getfield = 0xb4;
+  public static final int getstatic = 0xb2;
   public static final int goto_ = 0xa7;
+  public static final int ifnonnull = 0xc7;
   public static final int iload = 0x15;
   public static final int invokeinterface = 0xb9;
   public static final int invokespecial = 0xb7;
@@ -52,6 +60,7 @@ public class Assembler {
   public static final int new_ = 0xbb;
   public static final int pop = 0x57;
   public static final int putfield = 0xb5;
+  public static final int putstatic = 0xb3;
   public static final int ret = 0xa9;
   public static final int return_ = 0xb1;
 
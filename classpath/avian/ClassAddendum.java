@@ -25,4 +25,11 @@ public class ClassAddendum extends Addendum {
   public byte[] enclosingClass;
 
   public Pair enclosingMethod;
+
+  /**
+   * Hashed indexes of VMClass.fieldTable and VMClass.methodTable,
+   * built by the VM for classes with many members.
+   */
+  public Object fieldIndex;
+  public Object methodIndex;
 }
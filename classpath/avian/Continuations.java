@@ -87,6 +87,20 @@ import java.util.concurrent.Callable;
  * with an incompatible return type will throw an {@link
  * avian.IncompatibleContinuationException}.
  *
+ * <h3>Cost of Capturing and Calling Continuations</h3>
+ *
+ * <p>Capturing a continuation only copies those frames pushed since
+ * the thread last entered its current continuation; older frames are
+ * already on the heap and are shared by reference.  Likewise, calling
+ * a continuation only copies its most recent frame onto the stack,
+ * and each further frame is copied when the one above it returns.
+ * Thus, a generator or coroutine which yields from the same few
+ * methods each time pays for those frames alone, no matter how deep
+ * the stack which started it.  Since a thread has only one native
+ * stack, frames must be copied when control leaves them for another
+ * continuation, whether or not the one capturing them is ever called
+ * more than once.
+ *
  * <h3>Winding, Unwinding, and Rewinding</h3>
  *
  * <p>Traditionally, Java provides one way to wind the execution stack
@@ -136,6 +150,12 @@ public class Continuations {
   public static native <T> T callWithCurrentContinuation
     (Function<Callback<T>,T> receiver) throws Exception;
 
+  /**
+   * Returns whether this VM was built with continuation support, and
+   * thus whether the other methods of this class may be used.
+   */
+  public static native boolean supported();
+
   /**
    * Calls the specified "before" and "after" tasks each time a
    * continuation containing the call is wound or unwound,
@@ -14,6 +14,7 @@ import java.io.IOException;
 import java.util.ArrayList;
 import java.util.IllegalFormatException;
 import java.util.List;
+import java.util.concurrent.ConcurrentHashMap;
 
 // ------------------------------------------------------------------------- //
 // things that must be done in order to call this semi-complete: 
@@ -49,9 +50,27 @@ import java.util.List;
  */
 public final class FormatString {
 
-  /** Parses a format string and returns a compiled representation of it. */
+  /** The most compiled format strings kept for reuse by compile. */
+  private static final int CACHE_SIZE = 256;
+
+  private static final ConcurrentHashMap<String, FormatString> _cache
+    = new ConcurrentHashMap<String, FormatString>();
+
+  /** Parses a format string and returns a compiled representation of it.
+      Programs tend to use a few patterns over and over, so recently
+      compiled ones are reused rather than parsed again. */
   public static final FormatString compile(String fmt) {
-    return new FormatString(fmt);
+    FormatString compiled = _cache.get(fmt);
+    if (compiled == null) {
+      compiled = new FormatString(fmt);
+      // crude, but bounds the cache without tracking use; the patterns
+      // still in use are soon compiled again
+      if (_cache.size() >= CACHE_SIZE) {
+        _cache.clear();
+      }
+      _cache.put(fmt, compiled);
+    }
+    return compiled;
   }
 
   /** The original string value that was parsed */
@@ -112,10 +131,80 @@ public final class FormatString {
             }
         }
       }
+      if (cmp._flags == 0 && cmp._width == 0 && cmp._precision == 0
+          && a instanceof StringBuilder
+          && convertPlain((StringBuilder) a, arg, cmp._conversion)) {
+        continue;
+      }
       convert(a, arg, cmp._conversion, cmp._flags, cmp._width, cmp._precision);
     }
   }
 
+  /** Appends the most common conversions (%s, %d and %x) with no flags,
+      width or precision straight to a StringBuilder, without making a
+      String of the value first. Returns false if the argument needs the
+      general path instead. */
+  static final boolean convertPlain(
+      final StringBuilder b, final Object arg, final byte conversion) {
+    switch (conversion) {
+      case CONV_STRNG:
+        if (arg == null || arg instanceof String) {
+          b.append((String) arg);
+          return true;
+        }
+        return false;
+      case CONV_DECML:
+        if (arg instanceof Integer || arg instanceof Long
+            || arg instanceof Short || arg instanceof Byte) {
+          appendDecimal(b, ((Number) arg).longValue());
+          return true;
+        }
+        return false;
+      case CONV_HXDEC:
+        if (arg instanceof Integer) {
+          appendHex(b, ((Integer) arg).intValue() & 0xFFFFFFFFL);
+          return true;
+        } else if (arg instanceof Long && ((Long) arg).longValue() >= 0) {
+          appendHex(b, ((Long) arg).longValue());
+          return true;
+        }
+        return false;
+      default:
+        return false;
+    }
+  }
+
+  private static void appendDecimal(final StringBuilder b, long v) {
+    if (v == Long.MIN_VALUE) {
+      b.append("-9223372036854775808");
+      return;
+    }
+    if (v < 0) {
+      b.append('-');
+      v = -v;
+    }
+    long p = 1;
+    while (p <= v / 10) {
+      p *= 10;
+    }
+    for (; p > 0; p /= 10) {
+      b.append((char) ('0' + (v / p)));
+      v %= p;
+    }
+  }
+
+  private static final char[] HEX_DIGITS = "0123456789abcdef".toCharArray();
+
+  private static void appendHex(final StringBuilder b, final long v) {
+    int shift = 60;
+    while (shift > 0 && ((v >>> shift) & 0xF) == 0) {
+      shift -= 4;
+    }
+    for (; shift >= 0; shift -= 4) {
+      b.append(HEX_DIGITS[(int) ((v >>> shift) & 0xF)]);
+    }
+  }
+
   //- conversions
   static final byte CONV_LITRL = 0x0;
   static final byte CONV_NLINE = 0x1;
@@ -159,9 +248,8 @@ public final class FormatString {
   /** array of components parsed from the source string */
   private final FmtCmpnt[] _components;
 
-  /*/ keeping this private for now to encourage access through the static 
-      compile method, which might allow caching format string instances if it 
-      turns out there is an advantage to that. /*/
+  /*/ private to encourage access through the static compile method,
+      which caches format string instances. /*/
   /** Constructor */
   private FormatString(final String fmt) {
     this._source = fmt;
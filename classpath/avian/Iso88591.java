@@ -23,4 +23,29 @@ public class Iso88591 {
     }
     return buf.toByteArray();
   }
+
+  // returns a copy of the bytes if they are all ASCII, which String can
+  // use as they are, and otherwise the characters they stand for
+  public static Object decode(byte[] s8, int offset, int length) {
+    int i = offset;
+    while (i < offset + length && s8[i] >= 0) ++i;
+
+    if (i == offset + length) {
+      byte[] bytes = new byte[length];
+      System.arraycopy(s8, offset, bytes, 0, length);
+      return bytes;
+    } else {
+      char[] chars = new char[length];
+      decode(s8, offset, length, chars, 0);
+      return chars;
+    }
+  }
+
+  public static void decode(byte[] s8, int offset, int length,
+                            char[] s16, int s16Offset)
+  {
+    for (int i = 0; i < length; ++i) {
+      s16[s16Offset + i] = (char) (s8[offset + i] & 0xFF);
+    }
+  }
 }
@@ -12,8 +12,6 @@ package avian;
 
 import java.util.IdentityHashMap;
 import java.lang.reflect.Array;
-import java.lang.reflect.Field;
-import java.lang.reflect.Modifier;
 import java.io.IOException;
 import java.io.OutputStream;
 import java.io.PrintStream;
@@ -170,42 +168,46 @@ public class LegacyObjectOutputStream extends OutputStream {
     out.print(" ");
     out.print(c.getName());
 
-    for (Field f: c.getAllFields()) {
-      int modifiers = f.getModifiers();
-      if ((modifiers & (Modifier.TRANSIENT | Modifier.STATIC)) == 0) {
-        out.print(" ");
-        Object v;
+    serializeFields(o, c, map, nextId);
 
-        try {
-          v = f.get(o);
-        } catch (Exception e) {
-          throw new RuntimeException(e);
-        }
+    out.print(")");
+  }
 
-        Class t = f.getType();
-        if (t.equals(boolean.class)) {
-          writeBoolean((Boolean) v);
-        } else if (t.equals(byte.class)) {
-          writeByte((Byte) v);
-        } else if (t.equals(char.class)) {
-          writeChar((Character) v);
-        } else if (t.equals(short.class)) {
-          writeShort((Short) v);
-        } else if (t.equals(int.class)) {
-          writeInt((Integer) v);
-        } else if (t.equals(long.class)) {
-          writeLong((Long) v);
-        } else if (t.equals(float.class)) {
-          writeFloat((Float) v);
-        } else if (t.equals(double.class)) {
-          writeDouble((Double) v);
-        } else {
-          writeObject(v, map, nextId);
-        }
-      }
+  // writes the fields of each class from the root of the hierarchy
+  // down, as Class.getAllFields orders them
+  private void serializeFields(Object o, Class c,
+                               IdentityHashMap<Object, Integer> map,
+                               int[] nextId)
+    throws IOException
+  {
+    if (c.getSuperclass() != null) {
+      serializeFields(o, c.getSuperclass(), map, nextId);
     }
 
-    out.print(")");
+    SerialDescriptor descriptor = SerialDescriptor.lookup(c);
+    char[] types = descriptor.types;
+    long[] offsets = descriptor.offsets;
+    for (int i = 0; i < types.length; ++i) {
+      out.print(" ");
+
+      if (types[i] == 'L') {
+        writeObject(SerialDescriptor.getObject(o, offsets[i]), map, nextId);
+        continue;
+      }
+
+      long v = SerialDescriptor.bits(o, types[i], offsets[i]);
+      switch (types[i]) {
+      case 'Z': writeBoolean(v != 0); break;
+      case 'B': writeByte((byte) v); break;
+      case 'C': writeChar((char) v); break;
+      case 'S': writeShort((short) v); break;
+      case 'I': writeInt((int) v); break;
+      case 'J': writeLong(v); break;
+      case 'F': writeFloat(Float.intBitsToFloat((int) v)); break;
+      case 'D': writeDouble(Double.longBitsToDouble(v)); break;
+      default: throw new AssertionError();
+      }
+    }
   }
   
 }
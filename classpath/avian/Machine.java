@@ -31,6 +31,100 @@ public abstract class Machine {
 
   public static native void dumpHeap(String outputFile);
 
+  /**
+   * Writes a heap dump in the binary HPROF format understood by
+   * standard analysers such as Eclipse MAT and VisualVM.
+   */
+  public static native void dumpHeapHprof(String outputFile);
+
+  /**
+   * Writes one "bytes count class" line for each class with live
+   * instances, largest total first.
+   */
+  public static native void dumpClassHistogram(String outputFile);
+
+  /**
+   * Writes the most recent garbage collections, compilations, class
+   * loads, monitor inflations, safepoints, and thread starts and stops
+   * recorded by each thread, oldest first.  Recording is on unless the
+   * avian.events property is "false", and the same record is written
+   * to the file named by avian.events.crashDump if the VM aborts.
+   */
+  public static native void dumpEvents(String outputFile);
+
+  /**
+   * Samples one allocation in roughly every interval bytes each
+   * thread allocates, recording its class and the method and line
+   * which allocated it.  An interval of zero turns sampling off, but
+   * keeps what has been recorded so far.  The initial interval is
+   * taken from the avian.allocation.profileInterval property.
+   */
+  public static native void setAllocationProfileInterval(int interval);
+
+  /**
+   * Writes the allocations sampled so far to the specified file, one
+   * "bytes count class site" line per class and site, largest first.
+   * The byte counts are estimates scaled by the sampling interval.
+   */
+  public static native void dumpAllocationProfile(String outputFile);
+
+  // indexes into the array filled in by gcStatistics.  The first four
+  // are totals since the VM started; the rest describe the most recent
+  // collection.  Sizes are in bytes and times in milliseconds.
+  public static final int GC_COLLECTIONS = 0;
+  public static final int GC_MAJOR_COLLECTIONS = 1;
+  public static final int GC_TOTAL_PAUSE_TIME = 2;
+  public static final int GC_MAX_PAUSE_TIME = 3;
+  public static final int GC_TYPE = 4; // 0 for minor, 1 for major
+  public static final int GC_PAUSE_TIME = 5;
+  public static final int GC_COPIED = 6;
+  public static final int GC_TENURED = 7;
+  public static final int GC_FREED_FIXIES = 8;
+  public static final int GC_UNTENURED_FIXIES = 9;
+  public static final int GC_TENURED_FIXIES = 10;
+  public static final int GC_GEN1_BEFORE = 11;
+  public static final int GC_GEN1_AFTER = 12;
+  public static final int GC_GEN2_BEFORE = 13;
+  public static final int GC_GEN2_AFTER = 14;
+  // native memory from Unsafe.allocateMemory, including the part of
+  // the footprint which is pooled but not in use:
+  public static final int GC_DIRECT_FOOTPRINT = 15;
+  public static final int GC_DIRECT_POOLED = 16;
+  public static final int GC_STATISTICS_COUNT = 17;
+
+  /**
+   * Copies the garbage collector's statistics into the specified
+   * array, indexed by the GC_* constants above.  Values which don't
+   * fit are dropped.
+   */
+  public static native void gcStatistics(long[] statistics);
+
+  // indexes into the array filled in by compileStatistics, all totals
+  // over the methods compiled since the VM started.  Times are in
+  // nanoseconds and sizes in bytes, except for JIT_EVENTS, which counts
+  // the compiler's intermediate instructions.  The interpreter leaves
+  // them all zero.
+  public static final int JIT_METHODS = 0;
+  public static final int JIT_TOTAL_TIME = 1;
+  public static final int JIT_MAX_TIME = 2;
+  public static final int JIT_BYTECODE = 3;
+  public static final int JIT_EVENTS = 4;
+  public static final int JIT_CODE = 5;
+  public static final int JIT_FRAME_MAPS = 6;
+  public static final int JIT_CALL_SITES = 7;
+  public static final int JIT_CODE_CACHE_USED = 8;
+  public static final int JIT_CODE_CACHE_CAPACITY = 9;
+  public static final int JIT_STATISTICS_COUNT = 10;
+
+  /**
+   * Copies the JIT compiler's statistics into the specified array,
+   * indexed by the JIT_* constants above.  Values which don't fit are
+   * dropped.  Setting the avian.jit.statistics property to a file name
+   * additionally logs each method as it is compiled, one CSV row per
+   * method.
+   */
+  public static native void compileStatistics(long[] statistics);
+
   public static Unsafe getUnsafe() {
     return unsafe;
   }
@@ -0,0 +1,329 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import static avian.Stream.write1;
+import static avian.Stream.write2;
+import static avian.Stream.write4;
+import static avian.Stream.set4;
+import static avian.Assembler.*;
+
+import avian.ConstantPool.PoolEntry;
+import avian.Assembler.MethodData;
+import avian.Assembler.FieldData;
+
+import java.util.List;
+import java.util.ArrayList;
+import java.io.ByteArrayOutputStream;
+import java.io.IOException;
+import java.lang.reflect.Modifier;
+import java.lang.reflect.InvocationTargetException;
+
+/**
+ * Calls a specific method directly, without going through the VM's
+ * generic reflective invocation path.  Instances are generated by
+ * {@link #make} once a java.lang.reflect.Method has been invoked
+ * often enough to be worth the cost of defining a class for it.
+ */
+public abstract class MethodAccessor {
+  private static int nextNumber;
+
+  public abstract Object invoke(Object instance, Object[] arguments)
+    throws InvocationTargetException;
+
+  private static String boxClass(byte code) {
+    switch (code) {
+    case 'Z': return "java/lang/Boolean";
+    case 'B': return "java/lang/Byte";
+    case 'C': return "java/lang/Character";
+    case 'S': return "java/lang/Short";
+    case 'I': return "java/lang/Integer";
+    case 'J': return "java/lang/Long";
+    case 'F': return "java/lang/Float";
+    case 'D': return "java/lang/Double";
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  private static String unboxMethod(byte code) {
+    switch (code) {
+    case 'Z': return "booleanValue";
+    case 'B': return "byteValue";
+    case 'C': return "charValue";
+    case 'S': return "shortValue";
+    case 'I': return "intValue";
+    case 'J': return "longValue";
+    case 'F': return "floatValue";
+    case 'D': return "doubleValue";
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  private static void writeCast(List<PoolEntry> pool,
+                                ByteArrayOutputStream out,
+                                String className)
+    throws IOException
+  {
+    write1(out, checkcast);
+    write2(out, ConstantPool.addClass(pool, className) + 1);
+  }
+
+  private static void writeThrow(List<PoolEntry> pool,
+                                 ByteArrayOutputStream out,
+                                 String className,
+                                 String spec)
+    throws IOException
+  {
+    write1(out, new_);
+    write2(out, ConstantPool.addClass(pool, className) + 1);
+    write1(out, dup);
+    if (! spec.equals("()V")) {
+      write1(out, aload_3);
+    }
+    write1(out, invokespecial);
+    write2(out, ConstantPool.addMethodRef
+           (pool, className, "<init>", spec) + 1);
+    write1(out, athrow);
+  }
+
+  private static void writeHandler(ByteArrayOutputStream out,
+                                   int start,
+                                   int end,
+                                   int handler,
+                                   int catchType)
+    throws IOException
+  {
+    write2(out, start);
+    write2(out, end);
+    write2(out, handler);
+    write2(out, catchType);
+  }
+
+  // The generated invoke unpacks the arguments, calls the target
+  // directly, and boxes the result.  A ClassCastException or
+  // NullPointerException while unpacking means an argument doesn't
+  // match its parameter, and becomes an IllegalArgumentException, while
+  // anything thrown by the target itself is wrapped in an
+  // InvocationTargetException, just as Method.invoke would do.
+  private static byte[] makeInvokeCode(List<PoolEntry> pool,
+                                       VMMethod method,
+                                       String className)
+    throws IOException
+  {
+    boolean isStatic = (method.flags & Modifier.STATIC) != 0;
+    byte[] spec = method.spec;
+
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, method.parameterFootprint + 4); // max stack
+    write2(out, 4); // max locals
+    write4(out, 0); // length (we'll set the real value later)
+
+    int base = out.size();
+
+    if (! isStatic) {
+      write1(out, aload_1);
+      writeCast(pool, out, className);
+    }
+
+    int ai = 0;
+    int si;
+    for (si = 1; spec[si] != ')'; ++si) {
+      write1(out, aload_2);
+      write1(out, ldc_w);
+      write2(out, ConstantPool.addInteger(pool, ai++) + 1);
+      write1(out, aaload);
+
+      int start = si;
+      switch (spec[si]) {
+      case 'L':
+        while (spec[si] != ';') ++si;
+        writeCast(pool, out, Classes.makeString
+                  (spec, start + 1, si - start - 1));
+        break;
+
+      case '[':
+        while (spec[si] == '[') ++si;
+        if (spec[si] == 'L') {
+          while (spec[si] != ';') ++si;
+        }
+        writeCast(pool, out, Classes.makeString(spec, start, si - start + 1));
+        break;
+
+      default: {
+        String box = boxClass(spec[si]);
+        writeCast(pool, out, box);
+        write1(out, invokevirtual);
+        write2(out, ConstantPool.addMethodRef
+               (pool, box, unboxMethod(spec[si]), "()" + (char) spec[si])
+               + 1);
+      } break;
+      }
+    }
+
+    int callStart = out.size() - base;
+
+    String name = Classes.toString(method.name);
+    String methodSpec = Classes.toString(spec);
+    if (isStatic) {
+      write1(out, invokestatic);
+      write2(out, ConstantPool.addMethodRef
+             (pool, className, name, methodSpec) + 1);
+    } else if ((method.class_.flags & Modifier.INTERFACE) != 0) {
+      write1(out, invokeinterface);
+      write2(out, ConstantPool.addInterfaceMethodRef
+             (pool, className, name, methodSpec) + 1);
+      write1(out, method.parameterFootprint);
+      write1(out, 0);
+    } else {
+      write1(out, (method.flags & Modifier.PRIVATE) != 0
+             ? invokespecial : invokevirtual);
+      write2(out, ConstantPool.addMethodRef
+             (pool, className, name, methodSpec) + 1);
+    }
+
+    int callEnd = out.size() - base;
+
+    byte returnCode = spec[si + 1];
+    switch (returnCode) {
+    case 'V':
+      write1(out, aconst_null);
+      break;
+
+    case 'L':
+    case '[':
+      break;
+
+    default: {
+      String box = boxClass(returnCode);
+      write1(out, invokestatic);
+      write2(out, ConstantPool.addMethodRef
+             (pool, box, "valueOf", "(" + (char) returnCode + ")L" + box
+              + ";") + 1);
+    } break;
+    }
+
+    write1(out, areturn);
+
+    int argumentHandler = out.size() - base;
+    write1(out, pop);
+    writeThrow(pool, out, "java/lang/IllegalArgumentException", "()V");
+
+    int targetHandler = out.size() - base;
+    write1(out, astore_3);
+    writeThrow(pool, out, "java/lang/reflect/InvocationTargetException",
+               "(Ljava/lang/Throwable;)V");
+
+    int length = out.size() - base;
+
+    if (callStart > 0) {
+      write2(out, 3); // exception handler table length
+      writeHandler(out, 0, callStart, argumentHandler, ConstantPool.addClass
+                   (pool, "java/lang/ClassCastException") + 1);
+      writeHandler(out, 0, callStart, argumentHandler, ConstantPool.addClass
+                   (pool, "java/lang/NullPointerException") + 1);
+    } else {
+      write2(out, 1); // exception handler table length
+    }
+    writeHandler(out, callStart, callEnd, targetHandler, 0);
+
+    write2(out, 0); // attribute count
+
+    byte[] code = out.toByteArray();
+    set4(code, 4, length);
+
+    return code;
+  }
+
+  private static byte[] makeConstructorCode(List<PoolEntry> pool)
+    throws IOException
+  {
+    ByteArrayOutputStream out = new ByteArrayOutputStream();
+    write2(out, 1); // max stack
+    write2(out, 1); // max locals
+    write4(out, 5); // length
+
+    write1(out, aload_0);
+    write1(out, invokespecial);
+    write2(out, ConstantPool.addMethodRef
+           (pool, "avian/MethodAccessor", "<init>", "()V") + 1);
+    write1(out, return_);
+
+    write2(out, 0); // exception handler table length
+    write2(out, 0); // attribute count
+
+    return out.toByteArray();
+  }
+
+  /**
+   * Returns an accessor which invokes the specified method, or null
+   * if one can't be made for it, in which case the caller should keep
+   * using the generic path.  The accessor is defined by the method's
+   * own class loader, so it only works if that loader resolves the
+   * declaring class's name back to the declaring class.
+   */
+  public static MethodAccessor make(VMMethod method) {
+    VMClass vmClass = method.class_;
+    if (vmClass.arrayDimensions != 0) {
+      return null;
+    }
+
+    String className = Classes.toString(vmClass.name);
+
+    try {
+      ClassLoader loader = vmClass.loader;
+      if (Classes.forName(className, false, loader)
+          != SystemClassLoader.getClass(vmClass))
+      {
+        return null;
+      }
+
+      int number;
+      synchronized (MethodAccessor.class) {
+        number = nextNumber++;
+      }
+
+      List<PoolEntry> pool = new ArrayList();
+
+      MethodData[] methods = new MethodData[] {
+        new MethodData
+        (Modifier.PUBLIC,
+         ConstantPool.addUtf8(pool, "invoke"),
+         ConstantPool.addUtf8
+         (pool, "(Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/Object;"),
+         makeInvokeCode(pool, method, className)),
+
+        new MethodData
+        (Modifier.PUBLIC,
+         ConstantPool.addUtf8(pool, "<init>"),
+         ConstantPool.addUtf8(pool, "()V"),
+         makeConstructorCode(pool))
+      };
+
+      int nameIndex = ConstantPool.addClass(pool, "MethodAccessor-" + number);
+      int superIndex = ConstantPool.addClass(pool, "avian/MethodAccessor");
+
+      ByteArrayOutputStream out = new ByteArrayOutputStream();
+      Assembler.writeClass
+        (out, pool, nameIndex, superIndex, new int[0], new FieldData[0],
+         methods);
+
+      byte[] classData = out.toByteArray();
+      Class c = SystemClassLoader.getClass
+        (Classes.defineVMClass(loader, classData, 0, classData.length));
+
+      return (MethodAccessor) c.newInstance();
+    } catch (Exception e) {
+      return null;
+    } catch (LinkageError e) {
+      return null;
+    }
+  }
+}
@@ -0,0 +1,223 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import java.lang.ref.SoftReference;
+import java.lang.reflect.Field;
+import java.lang.reflect.Method;
+import java.lang.reflect.Modifier;
+import java.util.ArrayList;
+import java.util.WeakHashMap;
+import java.io.ObjectInputStream;
+import java.io.ObjectOutputStream;
+
+import sun.misc.Unsafe;
+
+/**
+ * What the object streams need to know about a class, worked out once
+ * rather than by reflection for every object written or read: the
+ * fields declared by the class which are neither static nor transient,
+ * in declaration order, with their type codes and offsets, the
+ * serialVersionUID, and the readObject and writeObject methods, if any.
+ */
+public class SerialDescriptor {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+
+  // the descriptors refer back to their classes, so they are held
+  // softly lest the weak keys never be cleared
+  private static final WeakHashMap<Class, SoftReference<SerialDescriptor>>
+    descriptors = new WeakHashMap();
+
+  public final Class clazz;
+  public final boolean hasSerialVersionUID;
+  public final long serialVersionUID;
+  public final Method readObject;
+  public final Method writeObject;
+  public final Field[] fields;
+  // one of "BCDFIJSZ" for each primitive field, or 'L' otherwise
+  public final char[] types;
+  public final long[] offsets;
+  // the stream's encoding of this descriptor, built by the first
+  // ObjectOutputStream to need it
+  public byte[] encoded;
+
+  private SerialDescriptor(Class clazz) {
+    this.clazz = clazz;
+
+    boolean hasSerialVersionUID = false;
+    long serialVersionUID = 1l;
+    try {
+      serialVersionUID = clazz.getField("serialVersionUID").getLong(null);
+      hasSerialVersionUID = true;
+    } catch (Exception ignored) { }
+    this.hasSerialVersionUID = hasSerialVersionUID;
+    this.serialVersionUID = serialVersionUID;
+
+    readObject = method(clazz, "readObject", ObjectInputStream.class);
+    writeObject = method(clazz, "writeObject", ObjectOutputStream.class);
+
+    ArrayList<Field> list = new ArrayList<Field>();
+    for (Field field : clazz.getDeclaredFields()) {
+      if ((field.getModifiers() & (Modifier.STATIC | Modifier.TRANSIENT))
+          == 0)
+      {
+        list.add(field);
+      }
+    }
+    fields = list.toArray(new Field[list.size()]);
+
+    types = new char[fields.length];
+    offsets = new long[fields.length];
+    for (int i = 0; i < fields.length; ++i) {
+      types[i] = typeCode(fields[i].getType());
+      offsets[i] = unsafe.objectFieldOffset(fields[i]);
+    }
+  }
+
+  public static SerialDescriptor lookup(Class c) {
+    synchronized (descriptors) {
+      SoftReference<SerialDescriptor> ref = descriptors.get(c);
+      SerialDescriptor descriptor = ref == null ? null : ref.get();
+      if (descriptor == null) {
+        descriptor = new SerialDescriptor(c);
+        descriptors.put(c, new SoftReference<SerialDescriptor>(descriptor));
+      }
+      return descriptor;
+    }
+  }
+
+  private static Method method(Class c, String name, Class parameterType) {
+    try {
+      Method method = c.getDeclaredMethod(name, parameterType);
+      method.setAccessible(true);
+      int modifiers = method.getModifiers();
+      if ((modifiers & Modifier.STATIC) == 0
+          || (modifiers & Modifier.PRIVATE) != 0)
+      {
+        return method;
+      }
+    } catch (NoSuchMethodException ignored) { }
+    return null;
+  }
+
+  public static char typeCode(Class type) {
+    if (! type.isPrimitive()) {
+      return 'L';
+    } else if (type == Byte.TYPE) {
+      return 'B';
+    } else if (type == Character.TYPE) {
+      return 'C';
+    } else if (type == Double.TYPE) {
+      return 'D';
+    } else if (type == Float.TYPE) {
+      return 'F';
+    } else if (type == Integer.TYPE) {
+      return 'I';
+    } else if (type == Long.TYPE) {
+      return 'J';
+    } else if (type == Short.TYPE) {
+      return 'S';
+    } else if (type == Boolean.TYPE) {
+      return 'Z';
+    }
+    throw new RuntimeException("Unhandled primitive type: " + type);
+  }
+
+  // the number of bytes the stream uses for a field of the specified
+  // primitive type
+  public static int size(char type) {
+    switch (type) {
+    case 'B': case 'Z': return 1;
+    case 'C': case 'S': return 2;
+    case 'F': case 'I': return 4;
+    case 'D': case 'J': return 8;
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  /**
+   * Returns the bits of the primitive field of the specified type at the
+   * specified offset in o, zero-extended.
+   */
+  public static long bits(Object o, char type, long offset) {
+    switch (type) {
+    case 'B': return unsafe.getByteVolatile(o, offset) & 0xffL;
+    case 'Z': return unsafe.getBooleanVolatile(o, offset) ? 1 : 0;
+    case 'C': return unsafe.getCharVolatile(o, offset);
+    case 'S': return unsafe.getShort(o, offset) & 0xffffL;
+    case 'I': return unsafe.getInt(o, offset) & 0xffffffffL;
+    case 'F':
+      return Float.floatToIntBits(unsafe.getFloatVolatile(o, offset))
+        & 0xffffffffL;
+    case 'J': return unsafe.getLong(o, offset);
+    case 'D': return Double.doubleToLongBits(unsafe.getDouble(o, offset));
+    default: throw new IllegalArgumentException();
+    }
+  }
+
+  /**
+   * Encodes the primitive fields from start up to (but not including)
+   * end, which must all be primitive, into buffer at the specified
+   * offset, big-endian, returning the offset following them.
+   */
+  public static int encode(Object o, char[] types, long[] offsets,
+                           int start, int end, byte[] buffer, int offset)
+  {
+    for (int i = start; i < end; ++i) {
+      long v = bits(o, types[i], offsets[i]);
+      for (int shift = (size(types[i]) - 1) * 8; shift >= 0; shift -= 8) {
+        buffer[offset++] = (byte) (v >>> shift);
+      }
+    }
+    return offset;
+  }
+
+  /**
+   * The reverse of encode: stores the primitive fields from start up to
+   * (but not including) end into o, decoding them from buffer at the
+   * specified offset, and returns the offset following them.
+   */
+  public static int decode(Object o, char[] types, long[] offsets,
+                           int start, int end, byte[] buffer, int offset)
+  {
+    for (int i = start; i < end; ++i) {
+      long v = 0;
+      for (int j = size(types[i]); j > 0; --j) {
+        v = (v << 8) | (buffer[offset++] & 0xff);
+      }
+
+      switch (types[i]) {
+      case 'B': unsafe.putByteVolatile(o, offsets[i], (byte) v); break;
+      case 'Z': unsafe.putBooleanVolatile(o, offsets[i], v != 0); break;
+      case 'C': unsafe.putCharVolatile(o, offsets[i], (char) v); break;
+      case 'S': unsafe.putShort(o, offsets[i], (short) v); break;
+      case 'I': unsafe.putInt(o, offsets[i], (int) v); break;
+      case 'F':
+        unsafe.putFloatVolatile(o, offsets[i], Float.intBitsToFloat((int) v));
+        break;
+      case 'J': unsafe.putLong(o, offsets[i], v); break;
+      case 'D':
+        unsafe.putDouble(o, offsets[i], Double.longBitsToDouble(v));
+        break;
+      default: throw new IllegalArgumentException();
+      }
+    }
+    return offset;
+  }
+
+  public static Object getObject(Object o, long offset) {
+    return unsafe.getObject(o, offset);
+  }
+
+  public static void putObject(Object o, long offset, Object value) {
+    unsafe.putObject(o, offset, value);
+  }
+}
@@ -25,6 +25,8 @@ public class SystemClassLoader extends ClassLoader {
   private native VMClass findVMClass(String name)
     throws ClassNotFoundException;
 
+  private native VMClass findVMClassOrNull(String name);
+
   protected Class findClass(String name) throws ClassNotFoundException {
     return getClass(findVMClass(name));
   }
@@ -47,9 +49,19 @@ public class SystemClassLoader extends ClassLoader {
     if (c == null) {
       ClassLoader parent = getParent();
       if (parent != null) {
-        try {
-          c = parent.loadClass(name);
-        } catch (ClassNotFoundException ok) { }
+        if (systemChain(parent)) {
+          // the VM can search the whole chain itself, without making
+          // an exception for each loader which misses
+          VMClass vmClass = ((SystemClassLoader) parent).findVMClassOrNull
+            (name);
+          if (vmClass != null) {
+            c = getClass(vmClass);
+          }
+        } else {
+          try {
+            c = parent.loadClass(name);
+          } catch (ClassNotFoundException ok) { }
+        }
       }
 
       if (c == null) {
@@ -64,6 +76,15 @@ public class SystemClassLoader extends ClassLoader {
     return c;
   }
 
+  private static boolean systemChain(ClassLoader loader) {
+    for (; loader != null; loader = loader.getParent()) {
+      if (loader.getClass() != SystemClassLoader.class) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   private native String resourceURLPrefix(String name);
 
   protected URL findResource(String name) {
@@ -21,16 +21,29 @@ public class Traces {
   private static String traceAllThreads() {
     StringBuilder buffer = new StringBuilder();
 
-    Thread[] threads = new Thread[Thread.activeCount()];
-
-    int count = Thread.enumerate(threads);
-    for (int i = 0; i < count; ++i) {
-      traceThread(threads[i], buffer);
+    Object[] traces = captureAllThreads();
+    for (int i = 0; i < traces.length && traces[i] != null; i += 2) {
+      buffer.append(traces[i]).append(Newline)
+        .append(describeTrace(traces[i + 1]));
     }
 
     return buffer.toString();
   }
 
+  /**
+   * Returns each live thread followed by its raw stack trace, all
+   * captured in a single pause.  The rest of the array is null.
+   * Turning a trace into something readable is left to
+   * describeTrace, which doesn't need the other threads to stop.
+   */
+  private static native Object[] captureAllThreads();
+
+  /**
+   * Returns one "\tat Class.method (line N)" line for each frame of a
+   * trace returned by captureAllThreads.
+   */
+  private static native String describeTrace(Object trace);
+
   private static String traceThread(Thread thread) {
     StringBuilder buffer = new StringBuilder();
 
@@ -46,6 +59,23 @@ public class Traces {
     }
   }
 
+  /**
+   * Turns recording of contended monitor acquisitions on or off.
+   * Recording starts out on if the avian.contention.profile property
+   * is "true".  Turning it off keeps what has been recorded so
+   * far.
+   */
+  public static native void setContentionProfiling(boolean enabled);
+
+  /**
+   * Returns one "count milliseconds class site owner" line for each
+   * class of object whose monitor was contended and each site that
+   * waited for one, with the most time spent waiting first.  The
+   * owner is where a sampled owner of the monitor was at the time, or
+   * "-" if none was sampled.
+   */
+  public static native String contentionProfile();
+
   public static void startTraceListener(final String host, final int port) {
     Thread t = new Thread(new Runnable() {
         public void run() {
@@ -56,6 +86,14 @@ public class Traces {
               SocketChannel c = server.accept();
               try {
                 c.write(ByteBuffer.wrap(traceAllThreads().getBytes()));
+
+                String contention = contentionProfile();
+                if (contention.length() > 0) {
+                  c.write(ByteBuffer.wrap
+                          (("monitor contention"
+                            + " (count milliseconds class site owner):"
+                            + Newline + contention).getBytes()));
+                }
               } finally {
                 c.close();
               }
@@ -13,6 +13,9 @@ package avian;
 import java.io.ByteArrayOutputStream;
 
 public class Utf8 {
+  // below this, the scan is quicker in Java than the call to native code
+  private static final int NativeScanThreshold = 32;
+
   public static boolean test(Object data) {
     if (!(data instanceof byte[])) return false;
     byte[] b = (byte[])data;
@@ -22,6 +25,21 @@ public class Utf8 {
     return false;
   }
 
+  // returns how many of the bytes starting at offset stand for
+  // themselves: ASCII other than zero, which encode writes as a pair
+  private static int plainPrefix(byte[] b, int offset, int length) {
+    if (length >= NativeScanThreshold) {
+      return plainPrefixLength(b, offset, length);
+    }
+
+    int i = 0;
+    while (i < length && b[offset + i] > 0) ++i;
+    return i;
+  }
+
+  private static native int plainPrefixLength(byte[] b, int offset,
+                                              int length);
+
   public static byte[] encode(char[] s16, int offset, int length) {
     ByteArrayOutputStream buf = new ByteArrayOutputStream();
     for (int i = offset; i < offset+length; ++i) {
@@ -44,9 +62,18 @@ public class Utf8 {
   }
 
   public static Object decode(byte[] s8, int offset, int length) {
-    Object buf = new byte[length];
+    // most strings are all ASCII, which needs only a copy, and the rest
+    // usually start with a run of it
+    int ascii = plainPrefix(s8, offset, length);
+    byte[] bytes = new byte[length];
+    System.arraycopy(s8, offset, bytes, 0, ascii);
+    if (ascii == length) {
+      return bytes;
+    }
+
+    Object buf = bytes;
     boolean isMultiByte = false;
-    int i=offset, j=0;
+    int i=offset + ascii, j=ascii;
     while (i < offset+length) {
       int x = s8[i++];
       if ((x & 0x080) == 0x0) {          // 1 byte char
@@ -96,6 +123,66 @@ public class Utf8 {
     }
   }
 
+  // returns how many of the bytes starting at offset make up whole
+  // characters, leaving out a multibyte sequence cut short at the end
+  public static int completeLength(byte[] s8, int offset, int length) {
+    int i = offset + plainPrefix(s8, offset, length);
+    int end = offset + length;
+    while (i < end) {
+      int x = s8[i];
+      int size;
+      if (x == 0 || (x & 0x0e0) == 0x0c0) {
+        size = 2;
+      } else if ((x & 0x0f0) == 0x0e0) {
+        size = 3;
+      } else {
+        size = 1;
+      }
+
+      if (i + size > end) {
+        break;
+      }
+      i += size;
+    }
+    return i - offset;
+  }
+
+  /**
+   * Decodes the specified bytes, which must end with a whole character
+   * (see completeLength), into s16 starting at s16Offset, and returns
+   * the number of characters written.  That is never more than length,
+   * so a caller with room for length characters need not check.
+   */
+  public static int decode(byte[] s8, int offset, int length,
+                           char[] s16, int s16Offset)
+  {
+    int ascii = plainPrefix(s8, offset, length);
+    int j = s16Offset;
+    for (int i = offset; i < offset + ascii; ++i) {
+      s16[j++] = (char) s8[i];
+    }
+
+    int i = offset + ascii;
+    int end = offset + length;
+    while (i < end) {
+      int x = s8[i++];
+      if ((x & 0x080) == 0x0) {          // 1 byte char
+        if (x == 0) {                    // 2 byte null char
+          ++ i;
+        }
+        s16[j++] = (char) x;
+      } else if ((x & 0x0e0) == 0x0c0) { // 2 byte char
+        int y = s8[i++];
+        s16[j++] = (char) (((x & 0x1f) << 6) | (y & 0x3f));
+      } else if ((x & 0x0f0) == 0x0e0) { // 3 byte char
+        int y = s8[i++]; int z = s8[i++];
+        s16[j++] = (char)
+          (((x & 0xf) << 12) | ((y & 0x3f) << 6) | (z & 0x3f));
+      }
+    }
+    return j - s16Offset;
+  }
+
   private static void cram(Object data, int index, int val) {
     if (data instanceof byte[]) ((byte[])data)[index] = (byte)val;
     else                        ((char[])data)[index] = (char)val;
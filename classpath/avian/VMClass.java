@@ -39,4 +39,35 @@ public class VMClass {
   public Singleton staticTable;
   public ClassLoader loader;
   public byte[] source;
+  /**
+   * This class and its superclasses, indexed by depth in the
+   * hierarchy, so that java.lang.Object comes first and this class
+   * last.  Null if the display could not be built when the class was
+   * made, in which case subtype checks walk the superclass chain.
+   */
+  public Object[] display;
+  /**
+   * The interface this class was most recently found to implement.
+   */
+  public VMClass interfaceCache;
+  /**
+   * An open-addressed hash table mapping each interface in
+   * interfaceTable, by identity hash, to one plus its position there,
+   * with zero marking an empty slot.  Only built for non-interface
+   * classes implementing enough interfaces for it to beat a scan of
+   * interfaceTable.
+   */
+  public int[] interfaceIndex;
+  /**
+   * The VM's runtime data for this class, if its loader isn't the
+   * boot or app loader.  Otherwise, the runtime data is found through
+   * runtimeDataIndex.
+   */
+  public Object runtimeData;
+  /**
+   * One plus the VM type this class was booted as, if the VM was built
+   * with a specialised walker for that type's layout, or zero
+   * otherwise, in which case the collector interprets objectMask.
+   */
+  public short vmType;
 }
@@ -0,0 +1,573 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package avian;
+
+import static avian.Continuations.callWithCurrentContinuation;
+
+import java.io.IOException;
+import java.nio.channels.SelectableChannel;
+import java.nio.channels.SelectionKey;
+import java.nio.channels.Selector;
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.Iterator;
+import java.util.TreeSet;
+import java.util.concurrent.LinkedBlockingQueue;
+import java.util.concurrent.locks.LockSupport;
+
+/**
+ * A thread of execution which is multiplexed with others over a
+ * small pool of carrier threads, one per processor.
+ *
+ * <p>When a virtual thread parks, whether through {@link #park()},
+ * {@link LockSupport}, {@link #sleep(long)}, {@link #join()}, or a
+ * blocking read, write, connect, or accept on a socket channel, it
+ * captures its continuation and hands its carrier over to the next
+ * runnable virtual thread instead of blocking it.  Sockets are
+ * watched by a single poller thread, which also handles timeouts, and
+ * a virtual thread is resumed on whichever carrier is free once its
+ * socket is ready or it is unparked.
+ *
+ * <p>This needs a VM built with continuation support.  Elsewhere, each
+ * virtual thread runs on a thread of its own.
+ *
+ * <p>The following caveats apply:
+ *
+ * <ul>
+ *
+ * <li>{@link Thread#currentThread} returns the carrier, so a virtual
+ * thread shares the carrier's name, thread locals, and interrupt
+ * status, and {@link LockSupport#unpark} cannot wake it up.  Use
+ * {@link #current} and {@link #unpark} instead.</li>
+ *
+ * <li>A virtual thread must not park while it holds a monitor, since
+ * it may be resumed on another carrier, which does not own it.</li>
+ *
+ * <li>Waiting on a monitor, blocking on a {@link java.net.Socket},
+ * and native code still block the carrier.</li>
+ *
+ * </ul>
+ */
+public class VirtualThread {
+  private static final int New = 0;
+  private static final int Queued = 1;
+  private static final int Running = 2;
+  private static final int Parking = 3;
+  private static final int Parked = 4;
+  private static final int Terminated = 5;
+
+  private static final boolean Supported = Continuations.supported();
+
+  private static LinkedBlockingQueue<VirtualThread> queue;
+  private static Poller poller;
+
+  private final Runnable task;
+  private final String name;
+
+  // guarded by this:
+  private int state = New;
+  private boolean permit;
+  private boolean interrupted;
+  private ArrayList<VirtualThread> joiners;
+
+  // used only by whichever thread is running this one:
+  private Callback<Object> continuation;
+  private Callback<Object> carrier;
+  private boolean done;
+
+  // guarded by the poller while this thread is scheduled to time out:
+  private long deadline;
+  private long sequence;
+
+  // only used where continuations are unsupported
+  private Thread platform;
+
+  public VirtualThread(Runnable task, String name) {
+    if (task == null) {
+      throw new NullPointerException();
+    }
+
+    this.task = task;
+    this.name = name;
+  }
+
+  public VirtualThread(Runnable task) {
+    this(task, "VirtualThread");
+  }
+
+  /**
+   * Returns the virtual thread running the caller, or null if the
+   * caller is not running on one.
+   */
+  public static VirtualThread current() {
+    Thread t = Thread.currentThread();
+    return t instanceof Carrier ? ((Carrier) t).current : null;
+  }
+
+  public String getName() {
+    return name;
+  }
+
+  public synchronized void start() {
+    if (state != New) {
+      throw new IllegalStateException();
+    }
+
+    if (Supported) {
+      state = Queued;
+      submit(this);
+    } else {
+      state = Running;
+      platform = new Thread(task, name);
+      platform.setDaemon(true);
+      platform.start();
+    }
+  }
+
+  public synchronized boolean isAlive() {
+    if (platform != null) {
+      return platform.isAlive();
+    } else {
+      return state != New && state != Terminated;
+    }
+  }
+
+  /**
+   * Makes the permit available, resuming this thread if it is parked.
+   */
+  public void unpark() {
+    if (platform != null) {
+      LockSupport.unpark(platform);
+      return;
+    }
+
+    synchronized (this) {
+      if (state == Parked) {
+        state = Queued;
+        submit(this);
+      } else if (state != Terminated) {
+        permit = true;
+      }
+    }
+  }
+
+  public void interrupt() {
+    if (platform != null) {
+      platform.interrupt();
+      return;
+    }
+
+    synchronized (this) {
+      interrupted = true;
+    }
+    unpark();
+  }
+
+  /**
+   * Clears the interrupt status of the current virtual thread,
+   * returning whether it was set.
+   */
+  public static boolean interrupted() {
+    VirtualThread self = current();
+    if (self == null) {
+      return Thread.interrupted();
+    }
+
+    synchronized (self) {
+      boolean v = self.interrupted;
+      self.interrupted = false;
+      return v;
+    }
+  }
+
+  /**
+   * Waits for the permit, parking the current virtual thread if it is
+   * not available.  As with {@link LockSupport#park}, this may return
+   * spuriously.
+   */
+  public static void park() {
+    VirtualThread self = current();
+    if (self == null) {
+      LockSupport.park();
+    } else {
+      self.park(0);
+    }
+  }
+
+  /**
+   * Like {@link #park()}, but returns after at most the specified
+   * number of nanoseconds.
+   */
+  public static void parkNanos(long nanos) {
+    if (nanos <= 0) {
+      return;
+    }
+
+    VirtualThread self = current();
+    if (self == null) {
+      LockSupport.parkNanos(nanos);
+    } else {
+      // a deadline of zero means none at all
+      long deadline = System.nanoTime() + nanos;
+      self.park(deadline == 0 ? 1 : deadline);
+    }
+  }
+
+  public static void sleep(long milliseconds) throws InterruptedException {
+    VirtualThread self = current();
+    if (self == null) {
+      Thread.sleep(milliseconds);
+      return;
+    }
+
+    long deadline = System.nanoTime() + (milliseconds * 1000000L);
+    while (true) {
+      if (interrupted()) {
+        throw new InterruptedException();
+      }
+
+      long remaining = deadline - System.nanoTime();
+      if (remaining <= 0) {
+        return;
+      }
+      parkNanos(remaining);
+    }
+  }
+
+  public void join() throws InterruptedException {
+    if (platform != null) {
+      platform.join();
+      return;
+    }
+
+    VirtualThread self = current();
+    if (self == null) {
+      synchronized (this) {
+        while (state != New && state != Terminated) {
+          wait();
+        }
+      }
+    } else {
+      while (true) {
+        synchronized (this) {
+          if (state == New || state == Terminated) {
+            return;
+          }
+          if (joiners == null) {
+            joiners = new ArrayList<VirtualThread>();
+          }
+          if (! joiners.contains(self)) {
+            joiners.add(self);
+          }
+        }
+
+        if (interrupted()) {
+          throw new InterruptedException();
+        }
+        self.park(0);
+      }
+    }
+  }
+
+  /**
+   * Parks the current virtual thread until the specified channel is
+   * ready for one of the specified operations, or is closed.
+   */
+  public static void awaitReady(SelectableChannel channel, int operations)
+    throws IOException
+  {
+    VirtualThread self = current();
+    if (self == null) {
+      throw new IllegalStateException();
+    }
+
+    Waiter waiter = new Waiter(self, channel, operations);
+    poller().register(waiter);
+    while (! waiter.ready) {
+      self.park(0);
+    }
+  }
+
+  private void park(long deadline) {
+    synchronized (this) {
+      if (permit) {
+        permit = false;
+        return;
+      }
+      state = Parking;
+    }
+
+    this.deadline = deadline;
+
+    try {
+      callWithCurrentContinuation(new Function<Callback<Object>,Object>() {
+          public Object call(Callback<Object> continuation) {
+            VirtualThread.this.continuation = continuation;
+            carrier.handleResult(null);
+            throw new AssertionError();
+          }
+        });
+    } catch (Exception e) {
+      throw new RuntimeException(e);
+    }
+
+    if (deadline != 0) {
+      poller().cancel(this);
+    }
+  }
+
+  // runs this thread on the current carrier until it terminates or
+  // parks
+  private void runSlice() {
+    try {
+      callWithCurrentContinuation(new Function<Callback<Object>,Object>() {
+          public Object call(Callback<Object> carrier) {
+            VirtualThread.this.carrier = carrier;
+
+            Callback<Object> c = continuation;
+            if (c != null) {
+              continuation = null;
+              c.handleResult(null);
+            } else {
+              try {
+                task.run();
+              } catch (Throwable e) {
+                Thread t = Thread.currentThread();
+                t.getUncaughtExceptionHandler().uncaughtException(t, e);
+              }
+
+              done = true;
+              // we may have parked and resumed on another carrier
+              // since the above was called, so use the latest one:
+              VirtualThread.this.carrier.handleResult(null);
+            }
+            throw new AssertionError();
+          }
+        });
+    } catch (Exception e) {
+      throw new RuntimeException(e);
+    }
+  }
+
+  // called by the carrier once a slice is over
+  private void afterSlice() {
+    ArrayList<VirtualThread> toWake = null;
+
+    synchronized (this) {
+      if (done) {
+        state = Terminated;
+        permit = false;
+        toWake = joiners;
+        joiners = null;
+        notifyAll();
+      } else if (permit) {
+        permit = false;
+        state = Queued;
+        submit(this);
+      } else {
+        state = Parked;
+        if (deadline != 0) {
+          poller().schedule(this);
+        }
+      }
+    }
+
+    if (toWake != null) {
+      for (VirtualThread t : toWake) {
+        t.unpark();
+      }
+    }
+  }
+
+  private static synchronized void submit(VirtualThread t) {
+    if (queue == null) {
+      queue = new LinkedBlockingQueue<VirtualThread>();
+
+      int count = Runtime.getRuntime().availableProcessors();
+      for (int i = 0; i < count; ++i) {
+        Carrier c = new Carrier(queue, i);
+        c.setDaemon(true);
+        c.start();
+      }
+    }
+
+    queue.add(t);
+  }
+
+  private static synchronized Poller poller() {
+    if (poller == null) {
+      try {
+        poller = new Poller(Selector.open());
+      } catch (IOException e) {
+        throw new RuntimeException(e);
+      }
+
+      Thread t = new Thread(poller, "VirtualThread poller");
+      t.setDaemon(true);
+      t.start();
+    }
+    return poller;
+  }
+
+  private static class Carrier extends Thread {
+    private final LinkedBlockingQueue<VirtualThread> queue;
+    private VirtualThread current;
+
+    public Carrier(LinkedBlockingQueue<VirtualThread> queue, int index) {
+      super("VirtualThread carrier " + index);
+      this.queue = queue;
+    }
+
+    public void run() {
+      while (true) {
+        VirtualThread t;
+        try {
+          t = queue.take();
+        } catch (InterruptedException e) {
+          continue;
+        }
+
+        synchronized (t) {
+          t.state = Running;
+        }
+
+        current = t;
+        t.runSlice();
+        current = null;
+
+        t.afterSlice();
+      }
+    }
+  }
+
+  private static class Waiter {
+    public final VirtualThread thread;
+    public final SelectableChannel channel;
+    public final int operations;
+    public SelectionKey key;
+    public volatile boolean ready;
+
+    public Waiter(VirtualThread thread, SelectableChannel channel,
+                  int operations)
+    {
+      this.thread = thread;
+      this.channel = channel;
+      this.operations = operations;
+    }
+  }
+
+  private static class Poller implements Runnable {
+    // how long to wait at most between checks for channels closed by
+    // another thread, in milliseconds
+    private static final long SweepInterval = 100;
+
+    private final Selector selector;
+    // guarded by this:
+    private final ArrayList<Waiter> pending = new ArrayList<Waiter>();
+    private final TreeSet<VirtualThread> timeouts = new TreeSet<VirtualThread>
+      (new Comparator<VirtualThread>() {
+        public int compare(VirtualThread a, VirtualThread b) {
+          long d = a.deadline - b.deadline;
+          if (d == 0) {
+            d = a.sequence - b.sequence;
+          }
+          return d < 0 ? -1 : (d > 0 ? 1 : 0);
+        }
+      });
+    private long nextSequence;
+    // only used by the poller thread:
+    private final ArrayList<Waiter> waiting = new ArrayList<Waiter>();
+    private final ArrayList<VirtualThread> expired
+      = new ArrayList<VirtualThread>();
+
+    public Poller(Selector selector) {
+      this.selector = selector;
+    }
+
+    public void register(Waiter waiter) {
+      synchronized (this) {
+        pending.add(waiter);
+      }
+      selector.wakeup();
+    }
+
+    public void schedule(VirtualThread t) {
+      boolean first;
+      synchronized (this) {
+        t.sequence = nextSequence++;
+        timeouts.add(t);
+        first = timeouts.first() == t;
+      }
+      if (first) {
+        selector.wakeup();
+      }
+    }
+
+    public synchronized void cancel(VirtualThread t) {
+      timeouts.remove(t);
+      t.deadline = 0;
+    }
+
+    public void run() {
+      while (true) {
+        long interval = SweepInterval;
+
+        synchronized (this) {
+          for (Waiter w : pending) {
+            w.key = w.channel.register(selector, w.operations, w);
+            waiting.add(w);
+          }
+          pending.clear();
+
+          long now = System.nanoTime();
+          while (! timeouts.isEmpty()) {
+            VirtualThread t = timeouts.first();
+            long remaining = t.deadline - now;
+            if (remaining <= 0) {
+              timeouts.remove(t);
+              expired.add(t);
+            } else {
+              interval = Math.max
+                (1, Math.min(interval, remaining / 1000000L));
+              break;
+            }
+          }
+        }
+
+        // afterSlice calls schedule while holding the thread's lock,
+        // which unpark acquires, so we must not hold ours here
+        for (VirtualThread t : expired) {
+          t.unpark();
+        }
+        expired.clear();
+
+        try {
+          selector.select(interval);
+        } catch (IOException e) {
+          // a channel was probably closed while we were waiting for it,
+          // which the sweep below will notice
+        }
+
+        for (Iterator<Waiter> it = waiting.iterator(); it.hasNext();) {
+          Waiter w = it.next();
+          if ((! w.channel.isOpen())
+              || selector.selectedKeys().contains(w.key))
+          {
+            it.remove();
+            selector.remove(w.key);
+            w.ready = true;
+            w.thread.unpark();
+          }
+        }
+      }
+    }
+  }
+}
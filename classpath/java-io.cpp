@@ -32,6 +32,7 @@
 #define READ _read
 #define WRITE _write
 #define STAT _wstat
+#define FSTAT _fstat
 #define STRUCT_STAT struct _stat
 #define MKDIR(path, mode) _wmkdir(path)
 #define CHMOD(path, mode) _wchmod(path, mode)
@@ -79,6 +80,7 @@ typedef wchar_t char_t;
 #define READ read
 #define WRITE write
 #define STAT stat
+#define FSTAT fstat
 #define STRUCT_STAT struct stat
 #define MKDIR mkdir
 #define CHMOD chmod
@@ -180,6 +182,21 @@ inline void doWrite(JNIEnv* e, jint fd, const jbyte* data, jint length)
   }
 }
 
+// Returns true if I/O on the specified descriptor waits on nothing but
+// the disk, in which case we may read or write a pinned Java array
+// directly.  Pipes, terminals and sockets may block indefinitely, which
+// we can't allow while holding an array critical, since that keeps the
+// garbage collector from running.
+inline bool pinnable(jint fd)
+{
+  STRUCT_STAT s;
+  return FSTAT(fd, &s) == 0 and S_ISREG(s.st_mode);
+}
+
+// size of the stack buffer used to copy small transfers on descriptors
+// which are not pinnable
+const int BufferSize = 8 * 1024;
+
 #ifdef PLATFORM_WINDOWS
 
 class Directory {
@@ -762,17 +779,42 @@ extern "C" JNIEXPORT jint JNICALL
                                               jint offset,
                                               jint length)
 {
-  jbyte* data = static_cast<jbyte*>(malloc(length));
-  if (data == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return 0;
+  if (pinnable(fd)) {
+    jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
+    int r = READ(fd, data + offset, length);
+    int error = errno;
+    e->ReleasePrimitiveArrayCritical(b, data, 0);
+
+    if (r > 0) {
+      return r;
+    } else if (r == 0) {
+      return -1;
+    } else {
+      errno = error;
+      throwNewErrno(e, "java/io/IOException");
+      return 0;
+    }
+  }
+
+  jbyte buffer[BufferSize];
+  jbyte* data = buffer;
+  if (length > BufferSize) {
+    data = static_cast<jbyte*>(malloc(length));
+    if (data == 0) {
+      throwNew(e, "java/lang/OutOfMemoryError", 0);
+      return 0;
+    }
   }
 
   int r = doRead(e, fd, data, length);
 
-  e->SetByteArrayRegion(b, offset, length, data);
+  if (r > 0) {
+    e->SetByteArrayRegion(b, offset, r, data);
+  }
 
-  free(data);
+  if (data != buffer) {
+    free(data);
+  }
 
   return r;
 }
@@ -817,19 +859,37 @@ extern "C" JNIEXPORT void JNICALL
                                                 jint offset,
                                                 jint length)
 {
-  jbyte* data = static_cast<jbyte*>(malloc(length));
-
-  if (data == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
+  if (pinnable(fd)) {
+    jbyte* data = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(b, 0));
+    int r = WRITE(fd, data + offset, length);
+    int error = errno;
+    e->ReleasePrimitiveArrayCritical(b, data, JNI_ABORT);
+
+    if (r != length) {
+      errno = error;
+      throwNewErrno(e, "java/io/IOException");
+    }
     return;
   }
 
+  jbyte buffer[BufferSize];
+  jbyte* data = buffer;
+  if (length > BufferSize) {
+    data = static_cast<jbyte*>(malloc(length));
+    if (data == 0) {
+      throwNew(e, "java/lang/OutOfMemoryError", 0);
+      return;
+    }
+  }
+
   e->GetByteArrayRegion(b, offset, length, data);
   if (not e->ExceptionCheck()) {
     doWrite(e, fd, data, length);
   }
 
-  free(data);
+  if (data != buffer) {
+    free(data);
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -1005,3 +1065,171 @@ extern "C" JNIEXPORT void JNICALL
   CloseHandle(hFile);
 #endif
 }
+
+#define java_io_RandomAccessFile_MapReadOnly 0L
+#define java_io_RandomAccessFile_MapReadWrite 1L
+#define java_io_RandomAccessFile_MapPrivate 2L
+
+extern "C" JNIEXPORT jobject JNICALL
+    Java_java_io_RandomAccessFile_map(JNIEnv* e,
+                                      jclass,
+                                      jlong peer,
+                                      jlong position,
+                                      jint size,
+                                      jint mode)
+{
+  jclass c = e->FindClass("java/nio/MappedByteBuffer");
+  if (c == 0) {
+    return 0;
+  }
+
+  jmethodID constructor = e->GetMethodID(c, "<init>", "(JIZJJ)V");
+  if (constructor == 0) {
+    return 0;
+  }
+
+  jboolean readOnly = mode == java_io_RandomAccessFile_MapReadOnly;
+  if (size == 0) {
+    return e->NewObject(
+        c, constructor, jlong(0), size, readOnly, jlong(0), jlong(0));
+  }
+
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+  int fd = (int)peer;
+  jlong end = position + size;
+
+  // a mapping which extends past the end of the file would leave the
+  // rest of the buffer unbacked, so we grow the file to fit, as the JDK
+  // does
+  STRUCT_STAT fileStats;
+  if (FSTAT(fd, &fileStats) == -1) {
+    throwNewErrno(e, "java/io/IOException");
+    return 0;
+  }
+
+  if (fileStats.st_size < end) {
+#ifdef PLATFORM_WINDOWS
+    errno = _chsize_s(fd, end);
+    if (errno) {
+#else
+    if (::ftruncate(fd, end) == -1) {
+#endif
+      throwNewErrno(e, "java/io/IOException");
+      return 0;
+    }
+  }
+
+#ifdef PLATFORM_WINDOWS
+  DWORD protection;
+  DWORD access;
+  switch (mode) {
+  case java_io_RandomAccessFile_MapReadWrite:
+    protection = PAGE_READWRITE;
+    access = FILE_MAP_WRITE;
+    break;
+  case java_io_RandomAccessFile_MapPrivate:
+    protection = PAGE_WRITECOPY;
+    access = FILE_MAP_COPY;
+    break;
+  default:
+    protection = PAGE_READONLY;
+    access = FILE_MAP_READ;
+    break;
+  }
+
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  jlong start = position - (position % info.dwAllocationGranularity);
+
+  void* base = 0;
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  HANDLE mapping = CreateFileMapping(file,
+                                     0,
+                                     protection,
+                                     static_cast<DWORD>(end >> 32),
+                                     static_cast<DWORD>(end),
+                                     0);
+  if (mapping) {
+    base = MapViewOfFile(mapping,
+                         access,
+                         static_cast<DWORD>(start >> 32),
+                         static_cast<DWORD>(start),
+                         end - start);
+    // the view keeps the mapping object alive
+    CloseHandle(mapping);
+  }
+
+  if (base == 0) {
+    throwNew(e, "java/io/IOException", "unable to map file");
+    return 0;
+  }
+#else
+  int protection = PROT_READ;
+  int flags = MAP_SHARED;
+  switch (mode) {
+  case java_io_RandomAccessFile_MapReadWrite:
+    protection |= PROT_WRITE;
+    break;
+  case java_io_RandomAccessFile_MapPrivate:
+    protection |= PROT_WRITE;
+    flags = MAP_PRIVATE;
+    break;
+  default:
+    break;
+  }
+
+  jlong start = position - (position % sysconf(_SC_PAGESIZE));
+
+  void* base = ::mmap(0, end - start, protection, flags, fd, start);
+  if (base == MAP_FAILED) {
+    throwNewErrno(e, "java/io/IOException");
+    return 0;
+  }
+#endif
+
+  return e->NewObject(
+      c,
+      constructor,
+      reinterpret_cast<jlong>(static_cast<char*>(base) + (position - start)),
+      size,
+      readOnly,
+      reinterpret_cast<jlong>(base),
+      end - start);
+#else
+  (void)peer;
+  (void)position;
+  throwNew(e, "java/lang/UnsupportedOperationException", 0);
+  return 0;
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+    Java_java_nio_MappedByteBuffer_natForce(JNIEnv* e,
+                                            jclass,
+                                            jlong base,
+                                            jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  if (not FlushViewOfFile(reinterpret_cast<void*>(base), length)) {
+    throwNew(e, "java/io/IOException", "unable to flush mapped file");
+  }
+#else
+  if (::msync(reinterpret_cast<void*>(base), length, MS_SYNC) == -1) {
+    throwNewErrno(e, "java/io/IOException");
+  }
+#endif
+}
+
+extern "C" JNIEXPORT void JNICALL
+    Java_java_nio_MappedByteBuffer_natUnmap(JNIEnv*,
+                                            jclass,
+                                            jlong base,
+                                            jlong length)
+{
+#ifdef PLATFORM_WINDOWS
+  (void)length;
+  UnmapViewOfFile(reinterpret_cast<void*>(base));
+#else
+  ::munmap(reinterpret_cast<void*>(base), length);
+#endif
+}
@@ -65,6 +65,14 @@
 #include "sys/utsname.h"
 #include "sys/wait.h"
 
+// QNX and older versions of Android lack posix_spawn, so we fork
+// there instead
+#if !defined __QNX__ \
+    && !(defined __ANDROID__ && __ANDROID_API__ < 28)
+#define AVIAN_POSIX_SPAWN
+#include "spawn.h"
+#endif
+
 #endif  // not PLATFORM_WINDOWS
 
 #ifndef WINAPI_FAMILY
@@ -83,6 +91,25 @@
 #endif
 #endif  // WINAPI_FAMILY
 
+// the environment, which System.getEnvironment() reports and
+// Runtime.exec passes on
+// TODO: For Win32, replace usage of deprecated _environ and add Unicode
+// support (neither of which is likely to be of great importance).
+#ifdef AVIAN_IOS
+namespace {
+const char* environ[] = {0};
+}
+#elif defined __APPLE__
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#elif defined(WINAPI_FAMILY) \
+    && !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+// WinRT/WP8 does not provide alternative for environment variables
+char* environ[] = {0};
+#else
+extern char** environ;
+#endif
+
 #ifndef M_E
 // in new C++-11 standard math.h doesn't have M_E, at least on MinGW, so define it manually
 #define M_E		2.7182818284590452354
@@ -690,7 +717,6 @@ extern "C" JNIEXPORT void JNICALL
   int in[] = {-1, -1};
   int out[] = {-1, -1};
   int err[] = {-1, -1};
-  int msg[] = {-1, -1};
 
   makePipe(e, in);
   if (e->ExceptionCheck())
@@ -707,6 +733,68 @@ extern "C" JNIEXPORT void JNICALL
     return;
   jlong errDescriptor = static_cast<jlong>(err[0]);
   e->SetLongArrayRegion(process, 4, 1, &errDescriptor);
+
+#ifdef AVIAN_POSIX_SPAWN
+  // posix_spawn reports its own errors, and unlike fork it doesn't
+  // copy our address space (which may be large) to do it
+  posix_spawn_file_actions_t actions;
+  int r = posix_spawn_file_actions_init(&actions);
+  if (r != 0) {
+    errno = r;
+    throwNewErrno(e, "java/io/IOException");
+    return;
+  }
+
+  // Setup stdin, stdout and stderr
+  if ((r = posix_spawn_file_actions_adddup2(&actions, in[1], 1))
+      or (r = posix_spawn_file_actions_addclose(&actions, in[0]))
+      or (r = posix_spawn_file_actions_addclose(&actions, in[1]))
+      or (r = posix_spawn_file_actions_adddup2(&actions, out[0], 0))
+      or (r = posix_spawn_file_actions_addclose(&actions, out[0]))
+      or (r = posix_spawn_file_actions_addclose(&actions, out[1]))
+      or (r = posix_spawn_file_actions_adddup2(&actions, err[1], 2))
+      or (r = posix_spawn_file_actions_addclose(&actions, err[0]))
+      or (r = posix_spawn_file_actions_addclose(&actions, err[1]))) {
+    posix_spawn_file_actions_destroy(&actions);
+    errno = r;
+    throwNewErrno(e, "java/io/IOException");
+    return;
+  }
+
+  posix_spawnattr_t attributes;
+  r = posix_spawnattr_init(&attributes);
+  if (r != 0) {
+    posix_spawn_file_actions_destroy(&actions);
+    errno = r;
+    throwNewErrno(e, "java/io/IOException");
+    return;
+  }
+
+#ifdef POSIX_SPAWN_USEVFORK
+  posix_spawnattr_setflags(&attributes, POSIX_SPAWN_USEVFORK);
+#endif
+
+  pid_t pid;
+  r = posix_spawnp(&pid, argv[0], &actions, &attributes, argv, environ);
+
+  posix_spawnattr_destroy(&attributes);
+  posix_spawn_file_actions_destroy(&actions);
+
+  if (r != 0) {
+    errno = r;
+    throwNewErrno(e, "java/io/IOException");
+    return;
+  }
+
+  jlong JNIPid = static_cast<jlong>(pid);
+  e->SetLongArrayRegion(process, 0, 1, &JNIPid);
+
+  safeClose(in[1]);
+  safeClose(out[0]);
+  safeClose(err[1]);
+#else
+  int msg[] = {-1, -1};
+
   makePipe(e, msg);
   if (e->ExceptionCheck())
     return;
@@ -770,6 +858,8 @@ extern "C" JNIEXPORT void JNICALL
   }
 
   safeClose(msg[0]);
+#endif
+
   clean(e, command, argv);
 
   fcntl(in[0], F_SETFD, FD_CLOEXEC);
@@ -1004,22 +1094,6 @@ extern "C" JNIEXPORT jobjectArray JNICALL
 }
 
 // System.getEnvironment() implementation
-// TODO: For Win32, replace usage of deprecated _environ and add Unicode
-// support (neither of which is likely to be of great importance).
-#ifdef AVIAN_IOS
-namespace {
-const char* environ[] = {0};
-}
-#elif defined __APPLE__
-#include <crt_externs.h>
-#define environ (*_NSGetEnviron())
-#elif defined(WINAPI_FAMILY) \
-    && !WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-// WinRT/WP8 does not provide alternative for environment variables
-char* environ[] = {0};
-#else
-extern char** environ;
-#endif
 extern "C" JNIEXPORT jobjectArray JNICALL
     Java_java_lang_System_getEnvironment(JNIEnv* env, jclass)
 {
@@ -1038,25 +1112,6 @@ extern "C" JNIEXPORT jobjectArray JNICALL
   return stringArray;
 }
 
-extern "C" JNIEXPORT jlong JNICALL
-    Java_java_lang_System_currentTimeMillis(JNIEnv*, jclass)
-{
-#ifdef PLATFORM_WINDOWS
-  // We used to use _ftime here, but that only gives us 1-second
-  // resolution on Windows 7.  _ftime_s might work better, but MinGW
-  // doesn't have it as of this writing.  So we use this mess instead:
-  FILETIME time;
-  GetSystemTimeAsFileTime(&time);
-  return (((static_cast<jlong>(time.dwHighDateTime) << 32) | time.dwLowDateTime)
-          / 10000) - 11644473600000LL;
-#else
-  timeval tv = {0, 0};
-  gettimeofday(&tv, 0);
-  return (static_cast<jlong>(tv.tv_sec) * 1000)
-         + (static_cast<jlong>(tv.tv_usec) / 1000);
-#endif
-}
-
 extern "C" JNIEXPORT jstring JNICALL
     Java_java_lang_System_doMapLibraryName(JNIEnv* e, jclass, jstring name)
 {
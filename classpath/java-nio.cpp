@@ -19,6 +19,8 @@
 #ifdef PLATFORM_WINDOWS
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <mswsock.h>
+#include <io.h>
 #include <errno.h>
 #ifdef _MSC_VER
 #define snprintf sprintf_s
@@ -36,6 +38,28 @@
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <limits.h>
+#ifdef __linux__
+#define AVIAN_SELECT_EPOLL
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#ifdef SYS_io_uring_setup
+#include <linux/io_uring.h>
+#ifdef IORING_FEAT_FAST_POLL
+#define AVIAN_IO_URING
+#include <sys/mman.h>
+#endif
+#endif
+#elif (defined __APPLE__) || (defined __FreeBSD__) || (defined __OpenBSD__) \
+    || (defined __NetBSD__)
+#define AVIAN_SELECT_KQUEUE
+#include <sys/event.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#endif
 #endif
 
 #define java_nio_channels_SelectionKey_OP_READ 1L
@@ -43,6 +67,10 @@
 #define java_nio_channels_SelectionKey_OP_CONNECT 8L
 #define java_nio_channels_SelectionKey_OP_ACCEPT 16L
 
+#define java_nio_channels_FileChannel_Unsupported -1LL
+
+#define java_nio_channels_DatagramChannel_Unsupported -1L
+
 #ifdef PLATFORM_WINDOWS
 typedef int socklen_t;
 #endif
@@ -300,14 +328,48 @@ bool doConnect(JNIEnv* e, int s, sockaddr_in* address)
   }
 }
 
-int doAccept(JNIEnv* e, int s)
+#if (defined __linux__) && (defined SYS_accept4)
+#define AVIAN_ACCEPT4
+#else
+// whether a newly accepted socket is already in the specified mode:
+// BSD sockets inherit the listener's, while Windows ones always block
+bool acceptedInMode(int s, bool blocking)
+{
+#ifdef PLATFORM_WINDOWS
+  return blocking;
+#else
+  return ((fcntl(s, F_GETFL) & O_NONBLOCK) == 0) == blocking;
+#endif
+}
+#endif
+
+// Accepts a connection on the listening socket s, returning a socket
+// for it in the specified mode, or -1 if there's none yet.  With
+// accept4 (called directly, since the C library only declares it for
+// _GNU_SOURCE) the socket comes in that mode, and closed on exec,
+// without any further calls.
+int doAccept(JNIEnv* e, int s, bool blocking)
 {
   sockaddr address;
   socklen_t length = sizeof(address);
+#ifdef AVIAN_ACCEPT4
+  int r = syscall(SYS_accept4,
+                  s,
+                  &address,
+                  &length,
+                  SOCK_CLOEXEC | (blocking ? 0 : SOCK_NONBLOCK));
+#else
   int r = ::accept(s, &address, &length);
+#endif
   if (r >= 0) {
+#ifndef AVIAN_ACCEPT4
+    if (not acceptedInMode(r, blocking) and not setBlocking(e, r, blocking)) {
+      doClose(r);
+      return -1;
+    }
+#endif
     return r;
-  } else if (errno != EINTR) {
+  } else if (errno != EINTR and not eagain()) {
     throwIOException(e);
   }
   return -1;
@@ -350,6 +412,49 @@ int doWrite(int fd, const void* buffer, size_t count)
 #endif
 }
 
+#ifndef PLATFORM_WINDOWS
+// Writes all of the specified region of a Java array to a blocking
+// socket straight from the array itself.  We mustn't block while
+// holding the array critical, since that keeps the garbage collector
+// from running, so each send takes only what the socket will accept
+// without waiting, and we wait for it to drain with the array released.
+// Returns the number of bytes written, or -1 with errno set if an error
+// occurred before anything could be written.
+int doWriteBlocking(JNIEnv* e,
+                    int fd,
+                    jbyteArray buffer,
+                    jint offset,
+                    jint length)
+{
+  int written = 0;
+  while (written < length) {
+    uint8_t* buf
+        = static_cast<uint8_t*>(e->GetPrimitiveArrayCritical(buffer, 0));
+
+    int r = send(fd, buf + offset + written, length - written, MSG_DONTWAIT);
+    int error = errno;
+
+    e->ReleasePrimitiveArrayCritical(buffer, buf, JNI_ABORT);
+
+    if (r >= 0) {
+      written += r;
+    } else if (error == EAGAIN or error == EWOULDBLOCK) {
+      pollfd p;
+      p.fd = fd;
+      p.events = POLLOUT;
+      p.revents = 0;
+      if (::poll(&p, 1, -1) < 0 and errno != EINTR) {
+        return written ? written : -1;
+      }
+    } else if (error != EINTR) {
+      errno = error;
+      return written ? written : -1;
+    }
+  }
+  return written;
+}
+#endif
+
 int doSend(int fd, sockaddr_in* address, const void* buffer, size_t count)
 {
   return sendto(fd,
@@ -376,9 +481,33 @@ int makeSocket(JNIEnv* e, int type = SOCK_STREAM, int protocol = IPPROTO_TCP)
 extern "C" JNIEXPORT jint JNICALL
     Java_java_nio_channels_ServerSocketChannel_natDoAccept(JNIEnv* e,
                                                            jclass,
-                                                           jint socket)
+                                                           jint socket,
+                                                           jboolean blocking)
 {
-  return ::doAccept(e, socket);
+  return ::doAccept(e, socket, blocking);
+}
+
+extern "C" JNIEXPORT void JNICALL
+    Java_java_nio_channels_ServerSocketChannel_natSetReusePort(JNIEnv* e,
+                                                               jclass,
+                                                               jint socket,
+                                                               jboolean on)
+{
+#ifdef SO_REUSEPORT
+  int opt = on;
+  int r = ::setsockopt(socket,
+                       SOL_SOCKET,
+                       SO_REUSEPORT,
+                       reinterpret_cast<char*>(&opt),
+                       sizeof(int));
+  if (r != 0) {
+    throwSocketException(e);
+  }
+#else
+  (void)socket;
+  (void)on;
+  throwNew(e, "java/lang/UnsupportedOperationException", "SO_REUSEPORT");
+#endif
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -601,6 +730,7 @@ extern "C" JNIEXPORT jint JNICALL
 {
   int r;
   if (blocking) {
+#ifdef PLATFORM_WINDOWS
     uint8_t* buf = static_cast<uint8_t*>(allocate(e, length));
     if (buf) {
       e->GetByteArrayRegion(
@@ -610,6 +740,9 @@ extern "C" JNIEXPORT jint JNICALL
     } else {
       return 0;
     }
+#else
+    r = ::doWriteBlocking(e, socket, buffer, offset, length);
+#endif
   } else {
     jboolean isCopy;
     uint8_t* buf
@@ -688,6 +821,509 @@ extern "C" JNIEXPORT jint JNICALL
   return r;
 }
 
+namespace {
+
+const unsigned MaxIoVector = 64;
+
+#ifdef PLATFORM_WINDOWS
+typedef WSABUF IoBuffer;
+
+inline void setIoBuffer(IoBuffer* b, uint8_t* p, size_t length)
+{
+  b->buf = reinterpret_cast<char*>(p);
+  b->len = length;
+}
+#else
+typedef iovec IoBuffer;
+
+inline void setIoBuffer(IoBuffer* b, uint8_t* p, size_t length)
+{
+  b->iov_base = p;
+  b->iov_len = length;
+}
+#endif
+
+// The remaining bytes of up to MaxIoVector ByteBuffers, as transferred
+// by a scattering read or gathering write.  Heap arrays may move
+// between system calls, so we pin them around each call and find their
+// addresses afresh every time.
+class IoVector {
+ public:
+  IoVector(JNIEnv* e,
+           jobjectArray buffers,
+           jint offset,
+           jobjectArray arrays,
+           jintArray starts,
+           jintArray lengths,
+           jint count)
+      : e(e), count(count > jint(MaxIoVector) ? MaxIoVector : count), size(0)
+  {
+    e->GetIntArrayRegion(starts, 0, this->count, this->starts);
+    e->GetIntArrayRegion(lengths, 0, this->count, this->lengths);
+
+    for (unsigned i = 0; i < this->count; ++i) {
+      size += this->lengths[i];
+      bodies[i] = 0;
+      this->arrays[i]
+          = static_cast<jbyteArray>(e->GetObjectArrayElement(arrays, i));
+      if (this->arrays[i] == 0) {
+        bodies[i] = static_cast<uint8_t*>(e->GetDirectBufferAddress(
+            e->GetObjectArrayElement(buffers, offset + i)));
+        if (bodies[i] == 0) {
+          throwNew(e, "java/lang/IllegalArgumentException", 0);
+          return;
+        }
+      }
+    }
+  }
+
+  // Pins the heap arrays and describes all but the first skip bytes of
+  // the vector in io, returning the number of elements used.  With no
+  // bytes skipped, element i of io describes buffer i.
+  unsigned pin(IoBuffer* io, jlong skip)
+  {
+    unsigned n = 0;
+    for (unsigned i = 0; i < count; ++i) {
+      if (skip and skip >= lengths[i]) {
+        skip -= lengths[i];
+      } else {
+        if (arrays[i]) {
+          bodies[i] = static_cast<uint8_t*>(
+              e->GetPrimitiveArrayCritical(arrays[i], 0));
+        }
+        setIoBuffer(
+            io + (n++), bodies[i] + starts[i] + skip, lengths[i] - skip);
+        skip = 0;
+      }
+    }
+    return n;
+  }
+
+  void release()
+  {
+    for (unsigned i = 0; i < count; ++i) {
+      if (arrays[i] and bodies[i]) {
+        e->ReleasePrimitiveArrayCritical(arrays[i], bodies[i], 0);
+        bodies[i] = 0;
+      }
+    }
+  }
+
+#ifdef PLATFORM_WINDOWS
+  void gather(uint8_t* dst)
+  {
+    for (unsigned i = 0; i < count; ++i) {
+      if (arrays[i]) {
+        e->GetByteArrayRegion(
+            arrays[i], starts[i], lengths[i], reinterpret_cast<jbyte*>(dst));
+      } else {
+        memcpy(dst, bodies[i] + starts[i], lengths[i]);
+      }
+      dst += lengths[i];
+    }
+  }
+
+  void scatter(const uint8_t* src, jlong length)
+  {
+    for (unsigned i = 0; i < count and length; ++i) {
+      jint n = length < lengths[i] ? length : lengths[i];
+      if (arrays[i]) {
+        e->SetByteArrayRegion(
+            arrays[i], starts[i], n, reinterpret_cast<const jbyte*>(src));
+      } else {
+        memcpy(bodies[i] + starts[i], src, n);
+      }
+      src += n;
+      length -= n;
+    }
+  }
+#endif
+
+  JNIEnv* e;
+  unsigned count;
+  jlong size;
+  jbyteArray arrays[MaxIoVector];
+  uint8_t* bodies[MaxIoVector];
+  jint starts[MaxIoVector];
+  jint lengths[MaxIoVector];
+};
+
+#ifndef PLATFORM_WINDOWS
+// Waits, with no arrays pinned, until the socket is ready for the
+// specified events, returning false on error.
+bool waitFor(int socket, short events)
+{
+  pollfd p;
+  p.fd = socket;
+  p.events = events;
+  p.revents = 0;
+  return ::poll(&p, 1, -1) >= 0 or errno == EINTR;
+}
+#endif
+
+}  // namespace
+
+extern "C" JNIEXPORT jlong JNICALL
+    Java_java_nio_channels_SocketChannel_natReadVector(JNIEnv* e,
+                                                       jclass,
+                                                       jint socket,
+                                                       jobjectArray buffers,
+                                                       jint offset,
+                                                       jobjectArray arrays,
+                                                       jintArray starts,
+                                                       jintArray lengths,
+                                                       jint count,
+                                                       jboolean blocking)
+{
+  IoVector v(e, buffers, offset, arrays, starts, lengths, count);
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+#ifdef PLATFORM_WINDOWS
+  int r;
+  if (blocking) {
+    uint8_t* buf = static_cast<uint8_t*>(allocate(e, v.size));
+    if (buf) {
+      r = ::doRead(socket, buf, v.size);
+      if (r > 0) {
+        v.scatter(buf, r);
+      }
+      free(buf);
+    } else {
+      return 0;
+    }
+  } else {
+    IoBuffer io[MaxIoVector];
+    DWORD received;
+    DWORD flags = 0;
+    unsigned n = v.pin(io, 0);
+    r = WSARecv(socket, io, n, &received, &flags, 0, 0) == 0 ? received : -1;
+    v.release();
+  }
+
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  } else if (r == 0) {
+    return -1;
+  }
+  return r;
+#else
+  // as with natWriteVector, we never block with an array pinned
+  while (true) {
+    IoBuffer io[MaxIoVector];
+    msghdr m;
+    memset(&m, 0, sizeof(msghdr));
+    m.msg_iov = io;
+    m.msg_iovlen = v.pin(io, 0);
+
+    ssize_t r = recvmsg(socket, &m, MSG_DONTWAIT);
+    int error = errno;
+
+    v.release();
+
+    if (r > 0) {
+      return r;
+    } else if (r == 0) {
+      return -1;
+    } else if (error == EAGAIN or error == EWOULDBLOCK) {
+      if (not blocking) {
+        return 0;
+      } else if (not waitFor(socket, POLLIN)) {
+        break;
+      }
+    } else if (error != EINTR) {
+      errno = error;
+      break;
+    }
+  }
+
+  throwIOException(e);
+  return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+    Java_java_nio_channels_SocketChannel_natWriteVector(JNIEnv* e,
+                                                        jclass,
+                                                        jint socket,
+                                                        jobjectArray buffers,
+                                                        jint offset,
+                                                        jobjectArray arrays,
+                                                        jintArray starts,
+                                                        jintArray lengths,
+                                                        jint count,
+                                                        jboolean blocking)
+{
+  IoVector v(e, buffers, offset, arrays, starts, lengths, count);
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+#ifdef PLATFORM_WINDOWS
+  int r;
+  if (blocking) {
+    uint8_t* buf = static_cast<uint8_t*>(allocate(e, v.size));
+    if (buf) {
+      v.gather(buf);
+      r = ::doWrite(socket, buf, v.size);
+      free(buf);
+    } else {
+      return 0;
+    }
+  } else {
+    IoBuffer io[MaxIoVector];
+    DWORD sent;
+    unsigned n = v.pin(io, 0);
+    r = WSASend(socket, io, n, &sent, 0, 0, 0) == 0 ? sent : -1;
+    v.release();
+  }
+
+  if (r < 0) {
+    if (eagain()) {
+      return 0;
+    } else {
+      throwIOException(e);
+    }
+  }
+  return r;
+#else
+  // Like doWriteBlocking, we send only what the socket will take without
+  // waiting, and wait for it to drain with the arrays released, so as
+  // not to hold up the garbage collector.
+  jlong written = 0;
+  while (written < v.size) {
+    IoBuffer io[MaxIoVector];
+    msghdr m;
+    memset(&m, 0, sizeof(msghdr));
+    m.msg_iov = io;
+    m.msg_iovlen = v.pin(io, written);
+
+    ssize_t r = sendmsg(socket, &m, MSG_DONTWAIT);
+    int error = errno;
+
+    v.release();
+
+    if (r >= 0) {
+      written += r;
+      if (not blocking) {
+        break;
+      }
+    } else if (error == EAGAIN or error == EWOULDBLOCK) {
+      if (not blocking) {
+        break;
+      } else if (not waitFor(socket, POLLOUT)) {
+        if (written == 0) {
+          throwIOException(e);
+        }
+        break;
+      }
+    } else if (error != EINTR) {
+      if (written == 0) {
+        errno = error;
+        throwIOException(e);
+      }
+      break;
+    }
+  }
+  return written;
+#endif
+}
+
+#if (defined __linux__) && (defined SYS_recvmmsg) && (defined SYS_sendmmsg)
+#define AVIAN_MULTIPLE_MESSAGES
+
+namespace {
+
+// Laid out as the kernel's struct mmsghdr, which the C library only
+// declares for _GNU_SOURCE.
+struct MultipleMessage {
+  msghdr header;
+  unsigned length;
+};
+
+void describeMessages(MultipleMessage* messages,
+                      IoBuffer* io,
+                      sockaddr_in* addresses,
+                      unsigned count)
+{
+  memset(messages, 0, count * sizeof(MultipleMessage));
+  for (unsigned i = 0; i < count; ++i) {
+    messages[i].header.msg_iov = io + i;
+    messages[i].header.msg_iovlen = 1;
+    if (addresses) {
+      messages[i].header.msg_name = addresses + i;
+      messages[i].header.msg_namelen = sizeof(sockaddr_in);
+    }
+  }
+}
+
+}  // namespace
+#endif
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_nio_channels_DatagramChannel_natReceiveBatch(
+        JNIEnv* e,
+        jclass,
+        jint socket,
+        jobjectArray buffers,
+        jint offset,
+        jobjectArray arrays,
+        jintArray starts,
+        jintArray lengths,
+        jint count,
+        jboolean blocking,
+        jintArray sizes,
+        jintArray addresses)
+{
+#ifdef AVIAN_MULTIPLE_MESSAGES
+  IoVector v(e, buffers, offset, arrays, starts, lengths, count);
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+  // as with natReadVector, we never block with an array pinned
+  while (true) {
+    IoBuffer io[MaxIoVector];
+    MultipleMessage messages[MaxIoVector];
+    sockaddr_in sources[MaxIoVector];
+    unsigned n = v.pin(io, 0);
+    describeMessages(messages, io, sources, n);
+
+    long r = syscall(SYS_recvmmsg, socket, messages, n, MSG_DONTWAIT, 0);
+    int error = errno;
+
+    v.release();
+
+    if (r >= 0) {
+      for (long i = 0; i < r; ++i) {
+        jint size = messages[i].length;
+        e->SetIntArrayRegion(sizes, i, 1, &size);
+
+        jint address[]
+            = {jint(ntohl(sources[i].sin_addr.s_addr)),
+               jint(ntohs(sources[i].sin_port))};
+        e->SetIntArrayRegion(addresses, i * 2, 2, address);
+      }
+      return r;
+    } else if (error == ENOSYS) {
+      break;
+    } else if (error == EAGAIN or error == EWOULDBLOCK) {
+      if (not blocking) {
+        return 0;
+      } else if (not waitFor(socket, POLLIN)) {
+        throwIOException(e);
+        return 0;
+      }
+    } else if (error != EINTR) {
+      errno = error;
+      throwIOException(e);
+      return 0;
+    }
+  }
+#else
+  (void)e;
+  (void)socket;
+  (void)buffers;
+  (void)offset;
+  (void)arrays;
+  (void)starts;
+  (void)lengths;
+  (void)count;
+  (void)blocking;
+  (void)sizes;
+  (void)addresses;
+#endif
+  return java_nio_channels_DatagramChannel_Unsupported;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_nio_channels_DatagramChannel_natSendBatch(JNIEnv* e,
+                                                        jclass,
+                                                        jint socket,
+                                                        jobjectArray buffers,
+                                                        jint offset,
+                                                        jobjectArray arrays,
+                                                        jintArray starts,
+                                                        jintArray lengths,
+                                                        jint count,
+                                                        jboolean blocking,
+                                                        jintArray addresses)
+{
+#ifdef AVIAN_MULTIPLE_MESSAGES
+  IoVector v(e, buffers, offset, arrays, starts, lengths, count);
+  if (e->ExceptionCheck()) {
+    return 0;
+  }
+
+  sockaddr_in targets[MaxIoVector];
+  if (addresses) {
+    for (unsigned i = 0; i < v.count; ++i) {
+      jint address[2];
+      e->GetIntArrayRegion(addresses, i * 2, 2, address);
+      init(targets + i, address[0], address[1]);
+    }
+  }
+
+  // Like natWriteVector, we send what the socket will take without
+  // waiting and wait for it to drain with the arrays released.
+  unsigned sent = 0;
+  while (sent < v.count) {
+    IoBuffer io[MaxIoVector];
+    MultipleMessage messages[MaxIoVector];
+    unsigned n = v.pin(io, 0);
+    describeMessages(messages, io, addresses ? targets : 0, n);
+
+    long r = syscall(
+        SYS_sendmmsg, socket, messages + sent, n - sent, MSG_DONTWAIT);
+    int error = errno;
+
+    v.release();
+
+    if (r >= 0) {
+      sent += r;
+      if (not blocking) {
+        break;
+      }
+    } else if (error == ENOSYS and sent == 0) {
+      return java_nio_channels_DatagramChannel_Unsupported;
+    } else if (error == EAGAIN or error == EWOULDBLOCK) {
+      if (not blocking) {
+        break;
+      } else if (not waitFor(socket, POLLOUT)) {
+        if (sent == 0) {
+          throwIOException(e);
+        }
+        break;
+      }
+    } else if (error != EINTR) {
+      if (sent == 0) {
+        errno = error;
+        throwIOException(e);
+      }
+      break;
+    }
+  }
+  return sent;
+#else
+  (void)e;
+  (void)socket;
+  (void)buffers;
+  (void)offset;
+  (void)arrays;
+  (void)starts;
+  (void)lengths;
+  (void)count;
+  (void)blocking;
+  (void)addresses;
+  return java_nio_channels_DatagramChannel_Unsupported;
+#endif
+}
+
 extern "C" JNIEXPORT void JNICALL
     Java_java_nio_channels_SocketChannel_natThrowWriteError(JNIEnv* e,
                                                             jclass,
@@ -857,6 +1493,287 @@ class Pipe {
 #endif
 };
 
+void drainWakeups(JNIEnv* e, Pipe* control)
+{
+  char c;
+  int r = 1;
+  while (r == 1) {
+    r = ::doRead(control->reader(), &c, 1);
+  }
+  if (r < 0 and not eagain()) {
+    throwIOException(e);
+  }
+}
+
+jint readyOps(jint interest, bool readable, bool writable)
+{
+  jint ready = 0;
+
+  if (readable) {
+    if (interest & java_nio_channels_SelectionKey_OP_READ) {
+      ready |= java_nio_channels_SelectionKey_OP_READ;
+    }
+
+    if (interest & java_nio_channels_SelectionKey_OP_ACCEPT) {
+      ready |= java_nio_channels_SelectionKey_OP_ACCEPT;
+    }
+  }
+
+  if (writable) {
+    if (interest & java_nio_channels_SelectionKey_OP_WRITE) {
+      ready |= java_nio_channels_SelectionKey_OP_WRITE;
+    }
+
+    if (interest & java_nio_channels_SelectionKey_OP_CONNECT) {
+      ready |= java_nio_channels_SelectionKey_OP_CONNECT;
+    }
+  }
+
+  return ready;
+}
+
+#if (defined AVIAN_SELECT_EPOLL) || (defined AVIAN_SELECT_KQUEUE)
+
+// The kernel keeps the interest set for us here, so we need only tell
+// it what changes, and the cost of a wait depends on how many sockets
+// are ready rather than on the highest descriptor in use.  We remember
+// for each descriptor what we registered and what the last wait
+// reported about it.
+
+const unsigned InterestRead = 1 << 0;
+const unsigned InterestWrite = 1 << 1;
+
+struct Registration {
+  uint8_t interest;
+  uint8_t ready;
+};
+
+#ifdef AVIAN_SELECT_EPOLL
+typedef epoll_event Event;
+
+const unsigned EventsPerSocket = 1;
+#else
+typedef struct kevent Event;
+
+// kqueue reports reads and writes as separate events
+const unsigned EventsPerSocket = 2;
+#endif
+
+struct SelectorState {
+  int queue;
+  Registration* registrations;
+  unsigned registrationCapacity;
+  unsigned registrationCount;
+  Event* events;
+  unsigned eventCapacity;
+  unsigned eventCount;
+  Pipe control;
+  SelectorState(JNIEnv* e)
+      : queue(-1),
+        registrations(0),
+        registrationCapacity(0),
+        registrationCount(0),
+        events(0),
+        eventCapacity(0),
+        eventCount(0),
+        control(e)
+  {
+  }
+};
+
+#ifdef AVIAN_SELECT_EPOLL
+int makeQueue()
+{
+  return epoll_create1(EPOLL_CLOEXEC);
+}
+
+bool changeInterest(int queue, int socket, unsigned from, unsigned to)
+{
+  epoll_event event;
+  memset(&event, 0, sizeof(epoll_event));
+  if (to & InterestRead) {
+    event.events |= EPOLLIN;
+  }
+  if (to & InterestWrite) {
+    event.events |= EPOLLOUT;
+  }
+  event.data.fd = socket;
+
+  // Closing a descriptor removes it from the set, so one we believe to
+  // be registered may have been reused by a new socket, and vice versa.
+  if (to == 0) {
+    return epoll_ctl(queue, EPOLL_CTL_DEL, socket, &event) == 0
+           or errno == ENOENT or errno == EBADF;
+  } else if (from == 0) {
+    return epoll_ctl(queue, EPOLL_CTL_ADD, socket, &event) == 0
+           or (errno == EEXIST
+               and epoll_ctl(queue, EPOLL_CTL_MOD, socket, &event) == 0);
+  } else {
+    return epoll_ctl(queue, EPOLL_CTL_MOD, socket, &event) == 0
+           or (errno == ENOENT
+               and epoll_ctl(queue, EPOLL_CTL_ADD, socket, &event) == 0);
+  }
+}
+
+int waitForEvents(SelectorState* s, jlong interval)
+{
+  int timeout;
+  if (interval > 0) {
+    timeout = interval > INT_MAX ? INT_MAX : interval;
+  } else if (interval < 0) {
+    timeout = 0;
+  } else {
+    timeout = -1;
+  }
+  return epoll_wait(s->queue, s->events, s->eventCapacity, timeout);
+}
+
+unsigned eventSocket(Event* event)
+{
+  return event->data.fd;
+}
+
+unsigned eventReadiness(Event* event)
+{
+  // like select, we treat errors and hangups as making a socket both
+  // readable and writable, so the next operation on it will report them
+  unsigned ready = 0;
+  if (event->events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+    ready |= InterestRead;
+  }
+  if (event->events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+    ready |= InterestWrite;
+  }
+  return ready;
+}
+#else  // AVIAN_SELECT_KQUEUE
+int makeQueue()
+{
+  return kqueue();
+}
+
+bool changeFilter(int queue, int socket, short filter, bool add)
+{
+  struct kevent change;
+  EV_SET(&change, socket, filter, add ? EV_ADD : EV_DELETE, 0, 0, 0);
+  return kevent(queue, &change, 1, 0, 0, 0) == 0
+         or ((not add) and (errno == ENOENT or errno == EBADF));
+}
+
+bool changeInterest(int queue, int socket, unsigned from, unsigned to)
+{
+  unsigned changed = from ^ to;
+  if ((changed & InterestRead)
+      and not changeFilter(queue, socket, EVFILT_READ, to & InterestRead)) {
+    return false;
+  }
+  if ((changed & InterestWrite)
+      and not changeFilter(
+              queue, socket, EVFILT_WRITE, to & InterestWrite)) {
+    return false;
+  }
+  return true;
+}
+
+int waitForEvents(SelectorState* s, jlong interval)
+{
+  timespec time;
+  timespec* timeout = &time;
+  if (interval > 0) {
+    time.tv_sec = interval / 1000;
+    time.tv_nsec = (interval % 1000) * 1000 * 1000;
+  } else if (interval < 0) {
+    time.tv_sec = 0;
+    time.tv_nsec = 0;
+  } else {
+    timeout = 0;
+  }
+  return kevent(s->queue, 0, 0, s->events, s->eventCapacity, timeout);
+}
+
+unsigned eventSocket(Event* event)
+{
+  return event->ident;
+}
+
+unsigned eventReadiness(Event* event)
+{
+  switch (event->filter) {
+  case EVFILT_READ:
+    return InterestRead;
+  case EVFILT_WRITE:
+    return InterestWrite;
+  default:
+    return 0;
+  }
+}
+#endif
+
+unsigned interestOf(jint ops)
+{
+  unsigned interest = 0;
+  if (ops & (java_nio_channels_SelectionKey_OP_READ
+             | java_nio_channels_SelectionKey_OP_ACCEPT)) {
+    interest |= InterestRead;
+  }
+  if (ops & (java_nio_channels_SelectionKey_OP_WRITE
+             | java_nio_channels_SelectionKey_OP_CONNECT)) {
+    interest |= InterestWrite;
+  }
+  return interest;
+}
+
+Registration* registration(SelectorState* s, int socket)
+{
+  unsigned index = socket;
+  if (index >= s->registrationCapacity) {
+    unsigned capacity = s->registrationCapacity ? s->registrationCapacity : 64;
+    while (capacity <= index) {
+      capacity *= 2;
+    }
+
+    Registration* r = static_cast<Registration*>(
+        realloc(s->registrations, capacity * sizeof(Registration)));
+    if (r == 0) {
+      return 0;
+    }
+
+    memset(r + s->registrationCapacity,
+           0,
+           (capacity - s->registrationCapacity) * sizeof(Registration));
+
+    s->registrations = r;
+    s->registrationCapacity = capacity;
+  }
+  return s->registrations + index;
+}
+
+bool updateInterest(JNIEnv* e, SelectorState* s, int socket, unsigned interest)
+{
+  Registration* r = registration(s, socket);
+  if (r == 0) {
+    throwNew(e, "java/lang/OutOfMemoryError", 0);
+    return false;
+  }
+
+  if (r->interest != interest) {
+    if (not changeInterest(s->queue, socket, r->interest, interest)) {
+      throwIOException(e);
+      return false;
+    }
+
+    if (r->interest == 0) {
+      ++s->registrationCount;
+    } else if (interest == 0) {
+      --s->registrationCount;
+    }
+    r->interest = interest;
+  }
+  return true;
+}
+
+#else  // not AVIAN_SELECT_EPOLL and not AVIAN_SELECT_KQUEUE
+
 struct SelectorState {
   fd_set read;
   fd_set write;
@@ -867,6 +1784,8 @@ struct SelectorState {
   }
 };
 
+#endif
+
 }  // namespace
 
 extern "C" JNIEXPORT jlong JNICALL
@@ -879,9 +1798,27 @@ extern "C" JNIEXPORT jlong JNICALL
       return 0;
 
     if (s) {
+#if (defined AVIAN_SELECT_EPOLL) || (defined AVIAN_SELECT_KQUEUE)
+      s->queue = makeQueue();
+      if (s->queue < 0) {
+        throwIOException(e);
+        s->control.dispose();
+        free(s);
+        return 0;
+      }
+
+      if (not updateInterest(e, s, s->control.reader(), InterestRead)) {
+        close(s->queue);
+        s->control.dispose();
+        free(s->registrations);
+        free(s);
+        return 0;
+      }
+#else
       FD_ZERO(&(s->read));
       FD_ZERO(&(s->write));
       FD_ZERO(&(s->except));
+#endif
       return reinterpret_cast<jlong>(s);
     }
   }
@@ -909,6 +1846,11 @@ extern "C" JNIEXPORT void JNICALL
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
   s->control.dispose();
+#if (defined AVIAN_SELECT_EPOLL) || (defined AVIAN_SELECT_KQUEUE)
+  close(s->queue);
+  free(s->registrations);
+  free(s->events);
+#endif
   free(s);
 }
 
@@ -919,14 +1861,28 @@ extern "C" JNIEXPORT void JNICALL
                                                             jlong state)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
+#if (defined AVIAN_SELECT_EPOLL) || (defined AVIAN_SELECT_KQUEUE)
+  if (socket >= 0 and static_cast<unsigned>(socket) < s->registrationCapacity) {
+    Registration* r = s->registrations + socket;
+    if (r->interest) {
+      // the socket is most likely closed already, in which case the
+      // kernel has forgotten it and there is nothing to report
+      changeInterest(s->queue, socket, r->interest, 0);
+      --s->registrationCount;
+    }
+    r->interest = 0;
+    r->ready = 0;
+  }
+#else
   FD_CLR(static_cast<unsigned>(socket), &(s->read));
   FD_CLR(static_cast<unsigned>(socket), &(s->write));
   FD_CLR(static_cast<unsigned>(socket), &(s->except));
+#endif
 }
 
 extern "C" JNIEXPORT jint JNICALL
     Java_java_nio_channels_SocketSelector_natSelectUpdateInterestSet(
-        JNIEnv*,
+        JNIEnv* e,
         jclass,
         jint socket,
         jint interest,
@@ -934,6 +1890,12 @@ extern "C" JNIEXPORT jint JNICALL
         jint max)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
+#if (defined AVIAN_SELECT_EPOLL) || (defined AVIAN_SELECT_KQUEUE)
+  updateInterest(e, s, socket, interestOf(interest));
+  if (max < socket)
+    max = socket;
+#else
+  (void)e;
   if (interest & (java_nio_channels_SelectionKey_OP_READ
                   | java_nio_channels_SelectionKey_OP_ACCEPT)) {
     FD_SET(static_cast<unsigned>(socket), &(s->read));
@@ -952,9 +1914,82 @@ extern "C" JNIEXPORT jint JNICALL
   } else {
     FD_CLR(static_cast<unsigned>(socket), &(s->write));
   }
+#endif
   return max;
 }
 
+#if (defined AVIAN_SELECT_EPOLL) || (defined AVIAN_SELECT_KQUEUE)
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv* e,
+                                                            jclass,
+                                                            jlong state,
+                                                            jint,
+                                                            jlong interval)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+
+  // forget what the last wait reported
+  for (unsigned i = 0; i < s->eventCount; ++i) {
+    unsigned socket = eventSocket(s->events + i);
+    if (socket < s->registrationCapacity) {
+      s->registrations[socket].ready = 0;
+    }
+  }
+  s->eventCount = 0;
+
+  unsigned capacity = s->registrationCount * EventsPerSocket;
+  if (capacity > s->eventCapacity) {
+    Event* events
+        = static_cast<Event*>(realloc(s->events, capacity * sizeof(Event)));
+    if (events == 0) {
+      throwNew(e, "java/lang/OutOfMemoryError", 0);
+      return 0;
+    }
+    s->events = events;
+    s->eventCapacity = capacity;
+  }
+
+  int r = waitForEvents(s, interval);
+
+  if (r < 0) {
+    if (errno != EINTR) {
+      throwIOException(e);
+    }
+    return 0;
+  }
+
+  s->eventCount = r;
+  for (int i = 0; i < r; ++i) {
+    unsigned socket = eventSocket(s->events + i);
+    if (socket == static_cast<unsigned>(s->control.reader())) {
+      drainWakeups(e, &(s->control));
+    } else if (socket < s->registrationCapacity) {
+      s->registrations[socket].ready |= eventReadiness(s->events + i);
+    }
+  }
+
+  return r;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_nio_channels_SocketSelector_natUpdateReadySet(JNIEnv*,
+                                                            jclass,
+                                                            jint socket,
+                                                            jint interest,
+                                                            jlong state)
+{
+  SelectorState* s = reinterpret_cast<SelectorState*>(state);
+  unsigned ready = 0;
+  if (socket >= 0 and static_cast<unsigned>(socket) < s->registrationCapacity) {
+    ready = s->registrations[socket].ready;
+  }
+
+  return readyOps(interest, ready & InterestRead, ready & InterestWrite);
+}
+
+#else  // not AVIAN_SELECT_EPOLL and not AVIAN_SELECT_KQUEUE
+
 extern "C" JNIEXPORT jint JNICALL
     Java_java_nio_channels_SocketSelector_natDoSocketSelect(JNIEnv* e,
                                                             jclass,
@@ -1038,14 +2073,7 @@ extern "C" JNIEXPORT jint JNICALL
   if (s->control.reader() >= 0 and FD_ISSET(s->control.reader(), &(s->read))) {
     FD_CLR(static_cast<unsigned>(s->control.reader()), &(s->read));
 
-    char c;
-    int r = 1;
-    while (r == 1) {
-      r = ::doRead(s->control.reader(), &c, 1);
-    }
-    if (r < 0 and not eagain()) {
-      throwIOException(e);
-    }
+    drainWakeups(e, &(s->control));
   }
 
   return r;
@@ -1059,29 +2087,353 @@ extern "C" JNIEXPORT jint JNICALL
                                                             jlong state)
 {
   SelectorState* s = reinterpret_cast<SelectorState*>(state);
-  jint ready = 0;
+  return readyOps(
+      interest,
+      FD_ISSET(socket, &(s->read)),
+      FD_ISSET(socket, &(s->write)) or FD_ISSET(socket, &(s->except)));
+}
 
-  if (FD_ISSET(socket, &(s->read))) {
-    if (interest & java_nio_channels_SelectionKey_OP_READ) {
-      ready |= java_nio_channels_SelectionKey_OP_READ;
+#endif
+
+extern "C" JNIEXPORT jlong JNICALL
+    Java_java_nio_channels_FileChannel_natTransferToSocket(JNIEnv* e,
+                                                           jclass,
+                                                           jint fd,
+                                                           jlong position,
+                                                           jlong count,
+                                                           jint socket)
+{
+#if (defined __linux__)
+  off_t offset = position;
+  ssize_t r = ::sendfile(socket, fd, &offset, count);
+  if (r >= 0) {
+    return r;
+  } else if (eagain() or errno == EINTR) {
+    return 0;
+  } else if (errno == EINVAL or errno == ENOSYS) {
+    return java_nio_channels_FileChannel_Unsupported;
+  }
+#elif (defined __APPLE__)
+  off_t length = count;
+  if (::sendfile(fd, socket, position, &length, 0, 0) == 0) {
+    return length;
+  } else if (eagain() or errno == EINTR) {
+    // length holds what was sent before we were interrupted
+    return length;
+  } else if (errno == EINVAL or errno == ENOTSOCK or errno == ENOTSUP) {
+    return java_nio_channels_FileChannel_Unsupported;
+  }
+#elif (defined __FreeBSD__)
+  off_t sent = 0;
+  if (::sendfile(fd, socket, position, count, 0, &sent, 0) == 0) {
+    return sent;
+  } else if (eagain() or errno == EINTR or errno == EBUSY) {
+    return sent;
+  } else if (errno == EINVAL or errno == ENOTSOCK or errno == EOPNOTSUPP) {
+    return java_nio_channels_FileChannel_Unsupported;
+  }
+#elif (defined PLATFORM_WINDOWS)
+  HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+  LARGE_INTEGER offset;
+  offset.QuadPart = position;
+  if (SetFilePointerEx(file, offset, 0, FILE_BEGIN)) {
+    // TransmitFile sends at most 2^31 - 2 bytes per call
+    DWORD length = count > 0x7FFFFFFE ? 0x7FFFFFFE : count;
+    if (TransmitFile(socket, file, length, 0, 0, 0, 0)) {
+      return length;
+    } else if (eagain()) {
+      return 0;
     }
+  }
+#else
+  (void)e;
+  (void)fd;
+  (void)position;
+  (void)count;
+  (void)socket;
+  return java_nio_channels_FileChannel_Unsupported;
+#endif
 
-    if (interest & java_nio_channels_SelectionKey_OP_ACCEPT) {
-      ready |= java_nio_channels_SelectionKey_OP_ACCEPT;
+#if (defined __linux__) || (defined __APPLE__) || (defined __FreeBSD__) \
+    || (defined PLATFORM_WINDOWS)
+  throwIOException(e);
+  return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+    Java_java_nio_channels_FileChannel_natCopyRange(JNIEnv* e,
+                                                    jclass,
+                                                    jint in,
+                                                    jlong inPosition,
+                                                    jint out,
+                                                    jlong outPosition,
+                                                    jlong count)
+{
+#if (defined __linux__) && (defined SYS_copy_file_range)
+  int64_t inOffset = inPosition;
+  int64_t outOffset = outPosition;
+  long r = syscall(
+      SYS_copy_file_range, in, &inOffset, out, &outOffset, count, 0);
+  if (r >= 0) {
+    return r;
+  } else if (errno == EINTR) {
+    return 0;
+  } else if (errno == ENOSYS or errno == EXDEV or errno == EINVAL
+             or errno == EOPNOTSUPP or errno == EBADF) {
+    // old kernels, different filesystems, overlapping ranges and so on
+    // are left to the caller to copy by hand
+    return java_nio_channels_FileChannel_Unsupported;
+  }
+
+  throwIOException(e);
+  return 0;
+#else
+  (void)e;
+  (void)in;
+  (void)inPosition;
+  (void)out;
+  (void)outPosition;
+  (void)count;
+  return java_nio_channels_FileChannel_Unsupported;
+#endif
+}
+
+#ifdef AVIAN_IO_URING
+namespace {
+
+// An io_uring and the queues we share with the kernel.  Submissions are
+// serialized by the Java side, and only the completion thread reaps, so
+// each of the queues has a single producer and a single consumer.
+struct Ring {
+  int fd;
+  unsigned entries;
+  void* submissionRing;
+  size_t submissionRingSize;
+  void* completionRing;
+  size_t completionRingSize;
+  io_uring_sqe* submissions;
+  size_t submissionsSize;
+  unsigned* submissionHead;
+  unsigned* submissionTail;
+  unsigned submissionMask;
+  unsigned* submissionArray;
+  unsigned* completionHead;
+  unsigned* completionTail;
+  unsigned completionMask;
+  io_uring_cqe* completions;
+};
+
+template <class T>
+T* ringField(void* ring, unsigned offset)
+{
+  return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+void* mapRing(int fd, size_t size, off_t offset)
+{
+  void* p = mmap(
+      0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return p == MAP_FAILED ? 0 : p;
+}
+
+void closeRing(Ring* r)
+{
+  if (r->submissions) {
+    munmap(r->submissions, r->submissionsSize);
+  }
+  if (r->completionRing) {
+    munmap(r->completionRing, r->completionRingSize);
+  }
+  if (r->submissionRing) {
+    munmap(r->submissionRing, r->submissionRingSize);
+  }
+  close(r->fd);
+  free(r);
+}
+
+}  // namespace
+#endif
+
+extern "C" JNIEXPORT jlong JNICALL
+    Java_java_nio_channels_IoService_natOpen(JNIEnv*, jclass, jint entries)
+{
+#ifdef AVIAN_IO_URING
+  io_uring_params p;
+  memset(&p, 0, sizeof(io_uring_params));
+  int fd = syscall(SYS_io_uring_setup, entries, &p);
+  if (fd < 0) {
+    return 0;
+  }
+
+  // kernels which poll sockets rather than blocking a worker thread on
+  // them also support all the operations we use
+  if ((p.features & IORING_FEAT_FAST_POLL) == 0) {
+    close(fd);
+    return 0;
+  }
+
+  Ring* r = static_cast<Ring*>(malloc(sizeof(Ring)));
+  if (r == 0) {
+    close(fd);
+    return 0;
+  }
+  memset(r, 0, sizeof(Ring));
+  r->fd = fd;
+  r->entries = p.sq_entries;
+
+  r->submissionRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  r->submissionRing = mapRing(fd, r->submissionRingSize, IORING_OFF_SQ_RING);
+  r->completionRingSize = p.cq_off.cqes
+                          + p.cq_entries * sizeof(io_uring_cqe);
+  r->completionRing = mapRing(fd, r->completionRingSize, IORING_OFF_CQ_RING);
+  r->submissionsSize = p.sq_entries * sizeof(io_uring_sqe);
+  r->submissions = static_cast<io_uring_sqe*>(
+      mapRing(fd, r->submissionsSize, IORING_OFF_SQES));
+
+  if (r->submissionRing == 0 or r->completionRing == 0
+      or r->submissions == 0) {
+    closeRing(r);
+    return 0;
+  }
+
+  r->submissionHead = ringField<unsigned>(r->submissionRing, p.sq_off.head);
+  r->submissionTail = ringField<unsigned>(r->submissionRing, p.sq_off.tail);
+  r->submissionMask
+      = *ringField<unsigned>(r->submissionRing, p.sq_off.ring_mask);
+  r->submissionArray
+      = ringField<unsigned>(r->submissionRing, p.sq_off.array);
+  r->completionHead = ringField<unsigned>(r->completionRing, p.cq_off.head);
+  r->completionTail = ringField<unsigned>(r->completionRing, p.cq_off.tail);
+  r->completionMask
+      = *ringField<unsigned>(r->completionRing, p.cq_off.ring_mask);
+  r->completions
+      = ringField<io_uring_cqe>(r->completionRing, p.cq_off.cqes);
+
+  return reinterpret_cast<jlong>(r);
+#else
+  (void)entries;
+  return 0;
+#endif
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+    Java_java_nio_channels_IoService_natSubmit(JNIEnv* e,
+                                               jclass,
+                                               jlong ring,
+                                               jboolean write,
+                                               jint fd,
+                                               jobject buffer,
+                                               jint offset,
+                                               jint length,
+                                               jlong position,
+                                               jlong id)
+{
+#ifdef AVIAN_IO_URING
+  Ring* r = reinterpret_cast<Ring*>(ring);
+  uint8_t* body = static_cast<uint8_t*>(e->GetDirectBufferAddress(buffer));
+  if (body == 0) {
+    return false;
+  }
+
+  unsigned tail = *(r->submissionTail);
+  if (tail - __atomic_load_n(r->submissionHead, __ATOMIC_ACQUIRE)
+      >= r->entries) {
+    return false;
+  }
+
+  unsigned index = tail & r->submissionMask;
+  io_uring_sqe* sqe = r->submissions + index;
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uintptr_t>(body + offset);
+  sqe->len = length;
+  sqe->off = position;
+  sqe->user_data = id;
+  r->submissionArray[index] = index;
+
+  __atomic_store_n(r->submissionTail, tail + 1, __ATOMIC_RELEASE);
+
+  while (true) {
+    int n = syscall(SYS_io_uring_enter, r->fd, 1, 0, 0, 0, 0);
+    if (n == 1) {
+      return true;
+    } else if (n < 0 and errno == EINTR) {
+      continue;
+    }
+
+    // The kernel only consumes submissions during io_uring_enter, so if
+    // it refused this one (e.g. with EBUSY while completions overflow)
+    // we can take it back and let the caller run it another way.
+    if (__atomic_load_n(r->submissionHead, __ATOMIC_ACQUIRE) == tail) {
+      __atomic_store_n(r->submissionTail, tail, __ATOMIC_RELEASE);
+      return false;
     }
+    return true;
   }
+#else
+  (void)e;
+  (void)ring;
+  (void)write;
+  (void)fd;
+  (void)buffer;
+  (void)offset;
+  (void)length;
+  (void)position;
+  (void)id;
+  return false;
+#endif
+}
 
-  if (FD_ISSET(socket, &(s->write)) or FD_ISSET(socket, &(s->except))) {
-    if (interest & java_nio_channels_SelectionKey_OP_WRITE) {
-      ready |= java_nio_channels_SelectionKey_OP_WRITE;
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_nio_channels_IoService_natWait(JNIEnv* e,
+                                             jclass,
+                                             jlong ring,
+                                             jlongArray ids,
+                                             jintArray results)
+{
+#ifdef AVIAN_IO_URING
+  Ring* r = reinterpret_cast<Ring*>(ring);
+  jint capacity = e->GetArrayLength(ids);
+  while (true) {
+    unsigned head = *(r->completionHead);
+    unsigned tail = __atomic_load_n(r->completionTail, __ATOMIC_ACQUIRE);
+    if (head != tail) {
+      jint count = 0;
+      for (; head != tail and count < capacity; ++head, ++count) {
+        io_uring_cqe* cqe = r->completions + (head & r->completionMask);
+        jlong id = cqe->user_data;
+        e->SetLongArrayRegion(ids, count, 1, &id);
+        jint result = cqe->res;
+        e->SetIntArrayRegion(results, count, 1, &result);
+      }
+      __atomic_store_n(r->completionHead, head, __ATOMIC_RELEASE);
+      return count;
     }
 
-    if (interest & java_nio_channels_SelectionKey_OP_CONNECT) {
-      ready |= java_nio_channels_SelectionKey_OP_CONNECT;
+    int n = syscall(
+        SYS_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, 0, 0);
+    if (n < 0 and errno != EINTR and errno != EAGAIN and errno != EBUSY) {
+      throwIOException(e);
+      return 0;
     }
   }
+#else
+  (void)ring;
+  (void)ids;
+  (void)results;
+  throwNew(e, "java/lang/UnsupportedOperationException", 0);
+  return 0;
+#endif
+}
 
-  return ready;
+extern "C" JNIEXPORT jstring JNICALL
+    Java_java_nio_channels_IoService_natErrorMessage(JNIEnv* e,
+                                                     jclass,
+                                                     jint error)
+{
+  return e->NewStringUTF(strerror(error));
 }
 
 extern "C" JNIEXPORT jboolean JNICALL
@@ -12,9 +12,68 @@
 #include "string.h"
 #include "avian/zlib-custom.h"
 
+#ifdef AVIAN_USE_LIBDEFLATE
+#include "libdeflate.h"
+#endif
+
 #include "jni.h"
 #include "jni-util.h"
 
+namespace {
+
+// Bytes which zlib reads or writes in place: either a byte array,
+// which we pin for the duration of a single call, or the memory of a
+// direct buffer.  zlib doesn't block, so holding the array critical
+// only delays the collector for as long as the call takes.
+class Region {
+ public:
+  Region(JNIEnv* e, jbyteArray array, jobject buffer, jint offset)
+      : e(e), array(array), body(0), offset(offset)
+  {
+    if (array) {
+      body = static_cast<Bytef*>(e->GetPrimitiveArrayCritical(array, 0));
+      if (body == 0) {
+        throwNew(e, "java/lang/OutOfMemoryError", 0);
+        return;
+      }
+    } else {
+      body = static_cast<Bytef*>(e->GetDirectBufferAddress(buffer));
+      if (body == 0) {
+        throwNew(e, "java/lang/IllegalArgumentException", "not a direct buffer");
+        return;
+      }
+    }
+
+    body += offset;
+  }
+
+  ~Region()
+  {
+    release(JNI_ABORT);
+  }
+
+  Bytef* start()
+  {
+    return body;
+  }
+
+  void release(jint mode)
+  {
+    if (array and body) {
+      e->ReleasePrimitiveArrayCritical(array, body - offset, mode);
+    }
+    body = 0;
+  }
+
+ private:
+  JNIEnv* e;
+  jbyteArray array;
+  Bytef* body;
+  jint offset;
+};
+
+}  // namespace
+
 extern "C" JNIEXPORT jlong JNICALL
     Java_java_util_zip_Inflater_make(JNIEnv* e, jclass, jboolean nowrap)
 {
@@ -48,34 +107,27 @@ extern "C" JNIEXPORT void JNICALL
     Java_java_util_zip_Inflater_inflate(JNIEnv* e,
                                         jclass,
                                         jlong peer,
-                                        jbyteArray input,
+                                        jbyteArray inputArray,
+                                        jobject inputBuffer,
                                         jint inputOffset,
                                         jint inputLength,
-                                        jbyteArray output,
+                                        jbyteArray outputArray,
+                                        jobject outputBuffer,
                                         jint outputOffset,
                                         jint outputLength,
                                         jintArray results)
 {
   z_stream* s = reinterpret_cast<z_stream*>(peer);
 
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
-  if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
+  Region in(e, inputArray, inputBuffer, inputOffset);
+  Region out(e, outputArray, outputBuffer, outputOffset);
+  if (in.start() == 0 or out.start() == 0) {
     return;
   }
 
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
-  if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;
-  }
-
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-
-  s->next_in = reinterpret_cast<Bytef*>(in);
+  s->next_in = in.start();
   s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
+  s->next_out = out.start();
   s->avail_out = outputLength;
 
   int r = inflate(s, Z_SYNC_FLUSH);
@@ -83,14 +135,82 @@ extern "C" JNIEXPORT void JNICALL
                          static_cast<jint>(inputLength - s->avail_in),
                          static_cast<jint>(outputLength - s->avail_out)};
 
-  free(in);
-
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+  in.release(JNI_ABORT);
+  out.release(0);
 
   e->SetIntArrayRegion(results, 0, 3, resultArray);
 }
 
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_util_zip_Inflater_inflateFully(JNIEnv* e,
+                                             jclass,
+                                             jbyteArray input,
+                                             jint inputOffset,
+                                             jint inputLength,
+                                             jbyteArray output,
+                                             jint outputOffset,
+                                             jint outputLength,
+                                             jboolean nowrap)
+{
+#ifndef AVIAN_USE_LIBDEFLATE
+  z_stream s;
+  memset(&s, 0, sizeof(z_stream));
+
+  int r = inflateInit2(&s, (nowrap ? -15 : 15));
+  if (r != Z_OK) {
+    throwNew(e, "java/lang/RuntimeException", zError(r));
+    return -1;
+  }
+#else
+  libdeflate_decompressor* d = libdeflate_alloc_decompressor();
+  if (d == 0) {
+    throwNew(e, "java/lang/OutOfMemoryError", 0);
+    return -1;
+  }
+#endif
+
+  Region in(e, input, 0, inputOffset);
+  Region out(e, output, 0, outputOffset);
+  if (in.start() == 0 or out.start() == 0) {
+#ifndef AVIAN_USE_LIBDEFLATE
+    inflateEnd(&s);
+#else
+    libdeflate_free_decompressor(d);
+#endif
+    return -1;
+  }
+
+#ifndef AVIAN_USE_LIBDEFLATE
+  s.next_in = in.start();
+  s.avail_in = inputLength;
+  s.next_out = out.start();
+  s.avail_out = outputLength;
+
+  r = inflate(&s, Z_FINISH);
+  jint produced = (r == Z_STREAM_END ? outputLength - s.avail_out : -1);
+
+  inflateEnd(&s);
+#else
+  size_t count;
+  libdeflate_result r;
+  if (nowrap) {
+    r = libdeflate_deflate_decompress(
+        d, in.start(), inputLength, out.start(), outputLength, &count);
+  } else {
+    r = libdeflate_zlib_decompress(
+        d, in.start(), inputLength, out.start(), outputLength, &count);
+  }
+  jint produced = (r == LIBDEFLATE_SUCCESS ? static_cast<jint>(count) : -1);
+
+  libdeflate_free_decompressor(d);
+#endif
+
+  in.release(JNI_ABORT);
+  out.release(0);
+
+  return produced;
+}
+
 extern "C" JNIEXPORT jlong JNICALL
     Java_java_util_zip_Deflater_make(JNIEnv* e,
                                      jclass,
@@ -127,10 +247,12 @@ extern "C" JNIEXPORT void JNICALL
     Java_java_util_zip_Deflater_deflate(JNIEnv* e,
                                         jclass,
                                         jlong peer,
-                                        jbyteArray input,
+                                        jbyteArray inputArray,
+                                        jobject inputBuffer,
                                         jint inputOffset,
                                         jint inputLength,
-                                        jbyteArray output,
+                                        jbyteArray outputArray,
+                                        jobject outputBuffer,
                                         jint outputOffset,
                                         jint outputLength,
                                         jboolean finish,
@@ -138,24 +260,15 @@ extern "C" JNIEXPORT void JNICALL
 {
   z_stream* s = reinterpret_cast<z_stream*>(peer);
 
-  jbyte* in = static_cast<jbyte*>(malloc(inputLength));
-  if (in == 0) {
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
-    return;
-  }
-
-  jbyte* out = static_cast<jbyte*>(malloc(outputLength));
-  if (out == 0) {
-    free(in);
-    throwNew(e, "java/lang/OutOfMemoryError", 0);
+  Region in(e, inputArray, inputBuffer, inputOffset);
+  Region out(e, outputArray, outputBuffer, outputOffset);
+  if (in.start() == 0 or out.start() == 0) {
     return;
   }
 
-  e->GetByteArrayRegion(input, inputOffset, inputLength, in);
-
-  s->next_in = reinterpret_cast<Bytef*>(in);
+  s->next_in = in.start();
   s->avail_in = inputLength;
-  s->next_out = reinterpret_cast<Bytef*>(out);
+  s->next_out = out.start();
   s->avail_out = outputLength;
 
   int r = deflate(s, finish ? Z_FINISH : Z_NO_FLUSH);
@@ -163,10 +276,206 @@ extern "C" JNIEXPORT void JNICALL
                          static_cast<jint>(inputLength - s->avail_in),
                          static_cast<jint>(outputLength - s->avail_out)};
 
-  free(in);
-
-  e->SetByteArrayRegion(output, outputOffset, resultArray[2], out);
-  free(out);
+  in.release(JNI_ABORT);
+  out.release(0);
 
   e->SetIntArrayRegion(results, 0, 3, resultArray);
 }
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_util_zip_CRC32_update(JNIEnv* e,
+                                    jclass,
+                                    jint crc,
+                                    jbyteArray array,
+                                    jint offset,
+                                    jint length)
+{
+  // zlib's crc32 does several bytes per step, where a loop in Java
+  // would do one, and libdeflate's uses carryless multiplication or
+  // the CRC instructions where the CPU has them
+  Region in(e, array, 0, offset);
+  if (in.start() == 0) {
+    return crc;
+  }
+
+#ifdef AVIAN_USE_LIBDEFLATE
+  return static_cast<jint>(
+      libdeflate_crc32(static_cast<uint32_t>(crc), in.start(), length));
+#else
+  return static_cast<jint>(
+      crc32(static_cast<uint32_t>(crc), in.start(), length));
+#endif
+}
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_util_zip_Adler32_update(JNIEnv* e,
+                                      jclass,
+                                      jint adler,
+                                      jbyteArray array,
+                                      jint offset,
+                                      jint length)
+{
+  Region in(e, array, 0, offset);
+  if (in.start() == 0) {
+    return adler;
+  }
+
+#ifdef AVIAN_USE_LIBDEFLATE
+  return static_cast<jint>(
+      libdeflate_adler32(static_cast<uint32_t>(adler), in.start(), length));
+#else
+  return static_cast<jint>(
+      adler32(static_cast<uint32_t>(adler), in.start(), length));
+#endif
+}
+
+namespace {
+
+// Neither zlib nor libdeflate does CRC-32C, so we do it here: with the
+// SSE 4.2 or ARMv8 CRC instructions where we can, and otherwise eight
+// bytes per step using eight tables, where tables[k][b] is the
+// remainder of byte b followed by k zero bytes.  The tables are filled
+// in once, from CRC32C's static initializer.
+
+const uint32_t Crc32cPolynomial = 0x82F63B78;
+
+uint32_t crc32cTables[8][256];
+
+#if (defined __x86_64__ || defined __i386__) && defined __GNUC__
+#define AVIAN_CRC32C_SSE42
+bool crc32cHardware;
+
+__attribute__((target("sse4.2"))) uint32_t
+    crc32cSse42(uint32_t crc, const uint8_t* p, size_t length)
+{
+  for (; length and (reinterpret_cast<uintptr_t>(p) & 7); --length) {
+    crc = __builtin_ia32_crc32qi(crc, *(p++));
+  }
+
+#ifdef __x86_64__
+  for (; length >= 8; length -= 8, p += 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc = static_cast<uint32_t>(__builtin_ia32_crc32di(crc, v));
+  }
+#endif
+
+  for (; length >= 4; length -= 4, p += 4) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    crc = __builtin_ia32_crc32si(crc, v);
+  }
+
+  for (; length; --length) {
+    crc = __builtin_ia32_crc32qi(crc, *(p++));
+  }
+  return crc;
+}
+#endif
+
+#if defined __aarch64__ && defined __ARM_FEATURE_CRC32
+#define AVIAN_CRC32C_ARMV8
+#include <arm_acle.h>
+
+uint32_t crc32cArmv8(uint32_t crc, const uint8_t* p, size_t length)
+{
+  for (; length and (reinterpret_cast<uintptr_t>(p) & 7); --length) {
+    crc = __crc32cb(crc, *(p++));
+  }
+
+  for (; length >= 8; length -= 8, p += 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc = __crc32cd(crc, v);
+  }
+
+  for (; length; --length) {
+    crc = __crc32cb(crc, *(p++));
+  }
+  return crc;
+}
+#endif
+
+#ifndef AVIAN_CRC32C_ARMV8
+inline uint32_t load32(const uint8_t* p)
+{
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+         | (static_cast<uint32_t>(p[2]) << 16)
+         | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint32_t crc32cSoftware(uint32_t crc, const uint8_t* p, size_t length)
+{
+  for (; length >= 8; length -= 8, p += 8) {
+    uint32_t low = crc ^ load32(p);
+    uint32_t high = load32(p + 4);
+    crc = crc32cTables[7][low & 0xFF] ^ crc32cTables[6][(low >> 8) & 0xFF]
+          ^ crc32cTables[5][(low >> 16) & 0xFF] ^ crc32cTables[4][low >> 24]
+          ^ crc32cTables[3][high & 0xFF]
+          ^ crc32cTables[2][(high >> 8) & 0xFF]
+          ^ crc32cTables[1][(high >> 16) & 0xFF]
+          ^ crc32cTables[0][high >> 24];
+  }
+
+  for (; length; --length) {
+    crc = crc32cTables[0][(crc ^ *(p++)) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+#endif
+
+}  // namespace
+
+extern "C" JNIEXPORT void JNICALL
+    Java_java_util_zip_CRC32C_initialize(JNIEnv*, jclass)
+{
+  for (unsigned i = 0; i < 256; ++i) {
+    uint32_t remainder = i;
+    for (unsigned bit = 0; bit < 8; ++bit) {
+      remainder = (remainder & 1) ? (remainder >> 1) ^ Crc32cPolynomial
+                                  : (remainder >> 1);
+    }
+    crc32cTables[0][i] = remainder;
+  }
+
+  for (unsigned k = 1; k < 8; ++k) {
+    for (unsigned i = 0; i < 256; ++i) {
+      uint32_t previous = crc32cTables[k - 1][i];
+      crc32cTables[k][i] = (previous >> 8)
+                           ^ crc32cTables[0][previous & 0xFF];
+    }
+  }
+
+#ifdef AVIAN_CRC32C_SSE42
+  crc32cHardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_java_util_zip_CRC32C_update(JNIEnv* e,
+                                     jclass,
+                                     jint crc,
+                                     jbyteArray array,
+                                     jint offset,
+                                     jint length)
+{
+  Region in(e, array, 0, offset);
+  if (in.start() == 0) {
+    return crc;
+  }
+
+  // like zlib's crc32, this takes and returns the finished checksum,
+  // which is the complement of the running remainder
+  uint32_t remainder = ~static_cast<uint32_t>(crc);
+#if defined AVIAN_CRC32C_ARMV8
+  remainder = crc32cArmv8(remainder, in.start(), length);
+#else
+#ifdef AVIAN_CRC32C_SSE42
+  if (crc32cHardware) {
+    remainder = crc32cSse42(remainder, in.start(), length);
+  } else
+#endif
+    remainder = crc32cSoftware(remainder, in.start(), length);
+#endif
+  return static_cast<jint>(~remainder);
+}
@@ -11,6 +11,9 @@
 package java.io;
 
 public class BufferedReader extends Reader {
+  // below this, the scan is quicker in Java than the call to native code
+  private static final int NativeScanThreshold = 32;
+
   private final Reader in;
   private final char[] buffer;
   private int position;
@@ -22,7 +25,7 @@ public class BufferedReader extends Reader {
   }
 
   public BufferedReader(Reader in) {
-    this(in, 32);
+    this(in, 8192);
   }
   
   private void fill() throws IOException {
@@ -30,32 +33,56 @@ public class BufferedReader extends Reader {
     limit = in.read(buffer);
   }
 
+  // returns the index of the first '\n' or '\r' from offset up to (but
+  // not including) limit, or limit if there is none
+  private static int lineBreak(char[] b, int offset, int limit) {
+    if (limit - offset >= NativeScanThreshold) {
+      return lineBreakIndex(b, offset, limit - offset);
+    }
+
+    int i = offset;
+    while (i < limit && b[i] != '\n' && b[i] != '\r') ++i;
+    return i;
+  }
+
+  private static native int lineBreakIndex(char[] b, int offset,
+                                           int length);
+
   public String readLine() throws IOException {
-    StringBuilder sb = new StringBuilder();
+    // only needed for a line which runs past the end of the buffer
+    StringBuilder sb = null;
     while (true) {
       if (position >= limit) {
         fill();
       }
 
       if (position >= limit) {
-        return sb.length() == 0 ? null : sb.toString();
+        return sb == null || sb.length() == 0 ? null : sb.toString();
       }
 
-      for (int i = position; i < limit; ++i) {
-        if(buffer[i] == '\r') {
+      int i = lineBreak(buffer, position, limit);
+      if (i < limit) {
+        String line;
+        if (sb == null) {
+          line = new String(buffer, position, i - position);
+        } else {
           sb.append(buffer, position, i - position);
-          position = i + 1;
-          if(i+1 < limit && buffer[i+1] == '\n') {
-            position = i + 2;
-          }
-          return sb.toString();
-        } else if (buffer[i] == '\n') {
-          sb.append(buffer, position, i - position);
-          position = i + 1;
-          return sb.toString();
+          line = sb.toString();
+        }
+
+        position = i + 1;
+        if (buffer[i] == '\r' && position < limit
+            && buffer[position] == '\n')
+        {
+          ++ position;
         }
+        return line;
+      }
+
+      if (sb == null) {
+        sb = new StringBuilder();
       }
-      sb.append(buffer, position, limit-position);
+      sb.append(buffer, position, limit - position);
       position = limit;
     }
   }
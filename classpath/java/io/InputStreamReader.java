@@ -10,25 +10,38 @@
 
 package java.io;
 
+import avian.Iso88591;
 import avian.Utf8;
 
 public class InputStreamReader extends Reader {
   private static final int MultibytePadding = 4;
 
   private final InputStream in;
+  private final boolean latin1;
+  // bytes read from the stream ahead of the characters returned so far:
+  // the start of a multibyte character cut short by the last read
+  private byte[] buffer;
+  private int pending;
 
   public InputStreamReader(InputStream in) {
     this.in = in;
+    this.latin1 = false;
   }
 
   public InputStreamReader(InputStream in, String encoding)
     throws UnsupportedEncodingException
   {
-    this(in);
+    this.in = in;
 
-    if (! encoding.equals("UTF-8")) {
+    if (encoding.equalsIgnoreCase("UTF-8")) {
+      this.latin1 = false;
+    } else if (encoding.equalsIgnoreCase("ISO-8859-1")
+               || encoding.equalsIgnoreCase("LATIN-1"))
+    {
+      this.latin1 = true;
+    } else {
       throw new UnsupportedEncodingException(encoding);
-    }    
+    }
   }
   
   public int read(char[] b, int offset, int length) throws IOException {
@@ -36,53 +49,55 @@ public class InputStreamReader extends Reader {
       return 0;
     }
 
-    byte[] buffer = new byte[length + MultibytePadding];
-    int bufferLength = length;
-    int bufferOffset = 0;
+    if (buffer == null || buffer.length < length + MultibytePadding) {
+      byte[] newBuffer = new byte[length + MultibytePadding];
+      if (buffer != null) {
+        System.arraycopy(buffer, 0, newBuffer, 0, pending);
+      }
+      buffer = newBuffer;
+    }
+
+    if (latin1) {
+      int c = in.read(buffer, 0, length);
+      if (c > 0) {
+        Iso88591.decode(buffer, 0, c, b, offset);
+      }
+      return c;
+    }
+
     while (true) {
-      int c = in.read(buffer, bufferOffset, bufferLength);
+      // whatever is pending and the bytes following it make up one
+      // character, so reading at most length bytes here yields at most
+      // length characters
+      int c = in.read(buffer, pending, length);
 
       if (c <= 0) {
-        if (bufferOffset > 0) {
-          // if we've reached the end of the stream while trying to
-          // read a multibyte character, we still need to return any
-          // competely-decoded characters, plus \ufffd to indicate an
+        if (pending > 0) {
+          // we've reached the end of the stream in the middle of a
+          // multibyte character, so return \ufffd to indicate an
           // unknown character
-          c = 1;
-          while (bufferOffset > 0) {
-            char[] buffer16 = Utf8.decode16(buffer, 0, bufferOffset);
-
-            if (buffer16 != null) {
-              System.arraycopy(buffer16, 0, b, offset, buffer16.length);
-              
-              c = buffer16.length + 1;
-              break;
-            } else {
-              -- bufferOffset;
-            }
-          }
-
-          b[offset + c - 1] = '\ufffd';
+          pending = 0;
+          b[offset] = '\ufffd';
+          return 1;
         }
 
         return c;
       }
 
-      bufferOffset += c;
-
-      char[] buffer16 = Utf8.decode16(buffer, 0, bufferOffset);
+      int available = pending + c;
+      int complete = Utf8.completeLength(buffer, 0, available);
+      int count = Utf8.decode(buffer, 0, complete, b, offset);
 
-      if (buffer16 != null) {
-        bufferOffset = 0;
+      pending = available - complete;
+      System.arraycopy(buffer, complete, buffer, 0, pending);
 
-        System.arraycopy(buffer16, 0, b, offset, buffer16.length);
-
-        return buffer16.length;
-      } else {
-        // the buffer ended in an incomplete multibyte character, so
-        // we try to read a another byte at a time until it's complete
-        bufferLength = 1;
+      if (count > 0) {
+        return count;
       }
+
+      // the buffer ended in an incomplete multibyte character, so we
+      // try to read another byte at a time until it's complete
+      length = 1;
     }
   }
 
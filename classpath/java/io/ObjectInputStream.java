@@ -32,8 +32,8 @@ import static java.io.ObjectOutputStream.SC_BLOCK_DATA;
 import static java.io.ObjectOutputStream.SC_SERIALIZABLE;
 import static java.io.ObjectOutputStream.SC_EXTERNALIZABLE;
 import static java.io.ObjectOutputStream.SC_ENUM;
-import static java.io.ObjectOutputStream.getReadOrWriteMethod;
 
+import avian.SerialDescriptor;
 import avian.VMClass;
 
 import java.util.ArrayList;
@@ -43,9 +43,13 @@ import java.lang.reflect.Field;
 import java.lang.reflect.Method;
 import java.lang.reflect.Modifier;
 
+import sun.misc.Unsafe;
+
 public class ObjectInputStream extends InputStream implements DataInput {
   private final static int HANDLE_OFFSET = 0x7e0000;
 
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+
   private final InputStream in;
   private final ArrayList references;
 
@@ -254,36 +258,6 @@ public class ObjectInputStream extends InputStream implements DataInput {
     }
   }
 
-  private void field(Field field, Object o)
-    throws IOException, IllegalArgumentException, IllegalAccessException,
-      ClassNotFoundException
-  {
-    Class type = field.getType();
-    if (!type.isPrimitive()) {
-      field.set(o, readObject());
-    } else {
-      if (type == Byte.TYPE) {
-        field.setByte(o, (byte)rawByte());
-      } else if (type == Character.TYPE) {
-        field.setChar(o, (char)rawShort());
-      } else if (type == Double.TYPE) {
-        field.setDouble(o, Double.longBitsToDouble(rawLong()));
-      } else if (type == Float.TYPE) {
-        field.setFloat(o, Float.intBitsToFloat(rawInt()));
-      } else if (type == Integer.TYPE) {
-        field.setInt(o, rawInt());
-      } else if (type == Long.TYPE) {
-        field.setLong(o, rawLong());
-      } else if (type == Short.TYPE) {
-        field.setShort(o, (short)rawShort());
-      } else if (type == Boolean.TYPE) {
-        field.setBoolean(o, rawByte() != 0);
-      } else {
-        throw new IOException("Unhandled type: " + type);
-      }
-    }
-  }
-
   public Object readObject() throws IOException, ClassNotFoundException {
     int c = rawByte();
     if (c == TC_NULL) {
@@ -327,19 +301,25 @@ public class ObjectInputStream extends InputStream implements DataInput {
         Object o1 = classDesc.clazz.cast(o);
         boolean customized = (classDesc.flags & SC_WRITE_METHOD) != 0;
         Method readMethod = customized ?
-          getReadOrWriteMethod(o, "readObject") : null;
+          SerialDescriptor.lookup(o.getClass()).readObject : null;
         if (readMethod == null) {
           if (customized) {
             throw new IOException("Could not find required readObject method "
               + "in " + classDesc.clazz);
           }
-          defaultReadObject(o, classDesc.fields);
+          defaultReadObject(o, classDesc);
         } else {
-          current = o1;
-          currentFields = classDesc.fields;
-          readMethod.invoke(o, this);
-          current = null;
-          currentFields = null;
+          // readObject may itself read objects with their own methods
+          Object savedObject = current;
+          ClassDesc savedDesc = currentDesc;
+          try {
+            current = o1;
+            currentDesc = classDesc;
+            readMethod.invoke(o, this);
+          } finally {
+            current = savedObject;
+            currentDesc = savedDesc;
+          }
           expectToken(TC_ENDBLOCKDATA);
         }
       } while ((classDesc = classDesc.superClassDesc) != null);
@@ -356,6 +336,9 @@ public class ObjectInputStream extends InputStream implements DataInput {
     Class clazz;
     int flags;
     Field[] fields;
+    // the type code and offset of each field (see SerialDescriptor)
+    char[] types;
+    long[] offsets;
     ClassDesc superClassDesc;
   }
 
@@ -364,16 +347,15 @@ public class ObjectInputStream extends InputStream implements DataInput {
     String className = rawString();
     ClassLoader loader = Thread.currentThread().getContextClassLoader();
     result.clazz = loader.loadClass(className);
+    SerialDescriptor descriptor = SerialDescriptor.lookup(result.clazz);
     long serialVersionUID = rawLong();
-    try {
-      Field field = result.clazz.getField("serialVersionUID");
-      long expected = field.getLong(null);
-      if (expected != serialVersionUID) {
-        throw new IOException("Incompatible serial version UID: 0x"
-            + Long.toHexString(serialVersionUID) + " != 0x"
-            + Long.toHexString(expected));
-      }
-    } catch (Exception ignored) { }
+    if (descriptor.hasSerialVersionUID
+        && descriptor.serialVersionUID != serialVersionUID)
+    {
+      throw new IOException("Incompatible serial version UID: 0x"
+          + Long.toHexString(serialVersionUID) + " != 0x"
+          + Long.toHexString(descriptor.serialVersionUID));
+    }
     references.add(result);
 
     result.flags = rawByte();
@@ -384,14 +366,14 @@ public class ObjectInputStream extends InputStream implements DataInput {
 
     int fieldCount = rawShort();
     result.fields = new Field[fieldCount];
+    result.types = new char[fieldCount];
+    result.offsets = new long[fieldCount];
     for (int i = 0; i < result.fields.length; i++) {
       int typeChar = rawByte();
       String fieldName = rawString();
-      try {
-        result.fields[i] = result.clazz.getDeclaredField(fieldName);
-      } catch (Exception e) {
-        throw new IOException(e);
-      }
+      result.fields[i] = field(descriptor, fieldName);
+      result.types[i] = SerialDescriptor.typeCode(result.fields[i].getType());
+      result.offsets[i] = unsafe.objectFieldOffset(result.fields[i]);
       Class type;
       if (typeChar == '[' || typeChar == 'L') {
         String typeName = (String)readObject();
@@ -420,22 +402,73 @@ public class ObjectInputStream extends InputStream implements DataInput {
     return result;
   }
 
+  // the fields a stream names are usually exactly those the class
+  // serializes, in the same order, so try those first
+  private static Field field(SerialDescriptor descriptor, String name)
+    throws IOException
+  {
+    for (Field field : descriptor.fields) {
+      if (field.getName().equals(name)) {
+        return field;
+      }
+    }
+    Field field;
+    try {
+      field = descriptor.clazz.getDeclaredField(name);
+    } catch (Exception e) {
+      throw new IOException(e);
+    }
+    if ((field.getModifiers() & Modifier.STATIC) != 0) {
+      throw new IOException("Cannot deserialize static field " + name);
+    }
+    return field;
+  }
+
   private Object current;
-  private Field[] currentFields;
+  private ClassDesc currentDesc;
 
   public void defaultReadObject() throws IOException {
-    defaultReadObject(current, currentFields);
+    defaultReadObject(current, currentDesc);
   }
 
-  private void defaultReadObject(Object o, Field[] fields) throws IOException {
-    try {
-      for (Field field : fields) {
-        field(field, o);
+  // scratch space for reading runs of primitive fields in one go
+  private byte[] buffer = new byte[64];
+
+  private void defaultReadObject(Object o, ClassDesc desc)
+    throws IOException
+  {
+    char[] types = desc.types;
+    long[] offsets = desc.offsets;
+    int i = 0;
+    while (i < types.length) {
+      if (types[i] == 'L') {
+        Object value;
+        try {
+          value = readObject();
+        } catch (ClassNotFoundException e) {
+          throw new IOException(e);
+        }
+        Class type = desc.fields[i].getType();
+        if (value != null && ! type.isInstance(value)) {
+          throw new IOException("Cannot assign " + value.getClass().getName()
+              + " to field " + desc.fields[i].getName() + " of type "
+              + type.getName());
+        }
+        SerialDescriptor.putObject(o, offsets[i], value);
+        ++ i;
+      } else {
+        int size = 0;
+        int end = i;
+        while (end < types.length && types[end] != 'L') {
+          size += SerialDescriptor.size(types[end++]);
+        }
+        if (size > buffer.length) {
+          buffer = new byte[size];
+        }
+        readFully(buffer, 0, size);
+        SerialDescriptor.decode(o, types, offsets, i, end, buffer, 0);
+        i = end;
       }
-    } catch (IOException e) {
-      throw e;
-    } catch (Exception e) {
-      throw new IOException(e);
     }
   }
 
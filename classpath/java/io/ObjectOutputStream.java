@@ -10,11 +10,9 @@
 
 package java.io;
 
-import java.util.ArrayList;
-import java.lang.reflect.Array;
+import avian.SerialDescriptor;
+
 import java.lang.reflect.Field;
-import java.lang.reflect.Method;
-import java.lang.reflect.Modifier;
 
 public class ObjectOutputStream extends OutputStream implements DataOutput {
   final static short STREAM_MAGIC = (short)0xaced;
@@ -164,120 +162,87 @@ public class ObjectOutputStream extends OutputStream implements DataOutput {
 
   private int classHandle;
 
-  private void string(String s) throws IOException {
-    int length = s.length();
-    rawShort(length);
-    for (byte b : s.getBytes()) {
-      rawByte(b);
-    }
+  private static void string(DataOutputStream out, String s)
+    throws IOException
+  {
+    out.writeShort(s.length());
+    out.write(s.getBytes());
   }
 
-  private static char primitiveTypeChar(Class type) {
-    if (type == Byte.TYPE) {
-      return 'B';
-    } else if (type == Character.TYPE) {
-      return 'C';
-    } else if (type == Double.TYPE) {
-      return 'D';
-    } else if (type == Float.TYPE) {
-      return 'F';
-    } else if (type == Integer.TYPE) {
-      return 'I';
-    } else if (type == Long.TYPE) {
-      return 'J';
-    } else if (type == Short.TYPE) {
-      return 'S';
-    } else if (type == Boolean.TYPE) {
-      return 'Z';
-    }
-    throw new RuntimeException("Unhandled primitive type: " + type);
-  }
+  private static byte[] encode(SerialDescriptor descriptor)
+    throws IOException
+  {
+    ByteArrayOutputStream bytes = new ByteArrayOutputStream();
+    DataOutputStream out = new DataOutputStream(bytes);
 
-  private void classDesc(Class clazz, int scFlags) throws IOException {
-    rawByte(TC_CLASSDESC);
+    out.writeByte(TC_CLASSDESC);
 
     // class name
-    string(clazz.getName());
+    string(out, descriptor.clazz.getName());
 
     // serial version UID
-    long serialVersionUID = 1l;
-    try {
-      Field field = clazz.getField("serialVersionUID");
-      serialVersionUID = field.getLong(null);
-    } catch (Exception ignored) {}
-    rawLong(serialVersionUID);
+    out.writeLong(descriptor.serialVersionUID);
 
     // handle
-    rawByte(SC_SERIALIZABLE | scFlags);
-
-    Field[] fields = getFields(clazz);
-    rawShort(fields.length);
-    for (Field field : fields) {
-      Class fieldType = field.getType();
-      if (fieldType.isPrimitive()) {
-        rawByte(primitiveTypeChar(fieldType));
-        string(field.getName());
+    out.writeByte(SC_SERIALIZABLE
+                  | (descriptor.writeObject == null ? 0 : SC_WRITE_METHOD));
+
+    Field[] fields = descriptor.fields;
+    out.writeShort(fields.length);
+    for (int i = 0; i < fields.length; ++i) {
+      Class fieldType = fields[i].getType();
+      if (descriptor.types[i] != 'L') {
+        out.writeByte(descriptor.types[i]);
+        string(out, fields[i].getName());
       } else {
-        rawByte(fieldType.isArray() ? '[' : 'L');
-        string(field.getName());
-        rawByte(TC_STRING);
-        string("L" + fieldType.getName().replace('.', '/') + ";");
+        out.writeByte(fieldType.isArray() ? '[' : 'L');
+        string(out, fields[i].getName());
+        out.writeByte(TC_STRING);
+        string(out, "L" + fieldType.getName().replace('.', '/') + ";");
       }
     }
-    rawByte(TC_ENDBLOCKDATA); // TODO: write annotation
-    rawByte(TC_NULL); // super class desc
+    out.writeByte(TC_ENDBLOCKDATA); // TODO: write annotation
+    out.writeByte(TC_NULL); // super class desc
+
+    return bytes.toByteArray();
   }
 
-  private void field(Object o, Field field) throws IOException {
-    try {
-      field.setAccessible(true);
-      Class type = field.getType();
-      if (!type.isPrimitive()) {
-        writeObject(field.get(o));
-      } else if (type == Byte.TYPE) {
-        rawByte(field.getByte(o));
-      } else if (type == Character.TYPE) {
-        char c = field.getChar(o);
-        rawShort((short)c);
-      } else if (type == Double.TYPE) {
-        double d = field.getDouble(o);
-        rawLong(Double.doubleToLongBits(d));
-      } else if (type == Float.TYPE) {
-        float f = field.getFloat(o);
-        rawInt(Float.floatToIntBits(f));
-      } else if (type == Integer.TYPE) {
-        int i = field.getInt(o);
-        rawInt(i);
-      } else if (type == Long.TYPE) {
-        long l = field.getLong(o);
-        rawLong(l);
-      } else if (type == Short.TYPE) {
-        short s = field.getShort(o);
-        rawShort(s);
-      } else if (type == Boolean.TYPE) {
-        boolean b = field.getBoolean(o);
-        rawByte(b ? 1 : 0);
-      } else {
-        throw new UnsupportedOperationException("Field '" + field.getName()
-          + "' has unsupported type: " + type);
-      }
-    } catch (IOException e) {
-      throw e;
-    } catch (Exception e) {
-      throw new IOException(e);
+  private void classDesc(SerialDescriptor descriptor) throws IOException {
+    byte[] encoded = descriptor.encoded;
+    if (encoded == null) {
+      // racing streams may each encode it, but the results are the same
+      descriptor.encoded = encoded = encode(descriptor);
     }
+    write(encoded, 0, encoded.length);
   }
 
-  private static Field[] getFields(Class clazz) {
-    ArrayList<Field> list = new ArrayList<Field>();
-    Field[] fields = clazz.getDeclaredFields();
-    for (Field field : fields) {
-      if (0 == (field.getModifiers() &
-          (Modifier.STATIC | Modifier.TRANSIENT))) {
-        list.add(field);
+  // scratch space for writing runs of primitive fields in one go
+  private byte[] buffer = new byte[64];
+
+  private void fields(Object o, SerialDescriptor descriptor)
+    throws IOException
+  {
+    char[] types = descriptor.types;
+    long[] offsets = descriptor.offsets;
+    int i = 0;
+    while (i < types.length) {
+      if (types[i] == 'L') {
+        writeObject(SerialDescriptor.getObject(o, offsets[i]));
+        ++ i;
+      } else {
+        int size = 0;
+        int end = i;
+        while (end < types.length && types[end] != 'L') {
+          size += SerialDescriptor.size(types[end++]);
+        }
+        if (size > buffer.length) {
+          buffer = new byte[size];
+        }
+        SerialDescriptor.encode(o, types, offsets, i, end, buffer, 0);
+        write(buffer, 0, size);
+        i = end;
       }
     }
-    return list.toArray(new Field[list.size()]);
   }
 
   public void writeObject(Object o) throws IOException {
@@ -293,45 +258,32 @@ public class ObjectOutputStream extends OutputStream implements DataOutput {
       return;
     }
     rawByte(TC_OBJECT);
-    Method writeObject = getReadOrWriteMethod(o, "writeObject");
-    if (writeObject == null) {
-      classDesc(o.getClass(), 0);
-      defaultWriteObject(o);
-    } else try {
-      classDesc(o.getClass(), SC_WRITE_METHOD);
-      current = o;
-      writeObject.invoke(o, this);
-      current = null;
+    SerialDescriptor descriptor = SerialDescriptor.lookup(o.getClass());
+    classDesc(descriptor);
+    if (descriptor.writeObject == null) {
+      fields(o, descriptor);
+    } else {
+      // writeObject may itself write objects with their own methods
+      Object savedObject = current;
+      SerialDescriptor savedDescriptor = currentDescriptor;
+      try {
+        current = o;
+        currentDescriptor = descriptor;
+        descriptor.writeObject.invoke(o, this);
+      } catch (Exception e) {
+        throw new IOException(e);
+      } finally {
+        current = savedObject;
+        currentDescriptor = savedDescriptor;
+      }
       rawByte(TC_ENDBLOCKDATA);
-    } catch (Exception e) {
-      throw new IOException(e);
     }
   }
 
-  static Method getReadOrWriteMethod(Object o, String methodName) {
-    try {
-      Method method = o.getClass().getDeclaredMethod(methodName,
-        new Class[] { methodName.startsWith("write") ?
-          ObjectOutputStream.class : ObjectInputStream.class });
-      method.setAccessible(true);
-      int modifiers = method.getModifiers();
-      if ((modifiers & Modifier.STATIC) == 0 ||
-          (modifiers & Modifier.PRIVATE) != 0) {
-        return method;
-      }
-    } catch (NoSuchMethodException ignored) { }
-    return null;
-  }
-
   private Object current;
+  private SerialDescriptor currentDescriptor;
 
   public void defaultWriteObject() throws IOException {
-    defaultWriteObject(current);
-  }
-
-  private void defaultWriteObject(Object o) throws IOException {
-    for (Field field : getFields(o.getClass())) {
-      field(o, field);
-    }
+    fields(current, currentDescriptor);
   }
 }
@@ -12,9 +12,14 @@ package java.io;
 
 import java.lang.IllegalArgumentException;
 import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
 import java.nio.channels.FileChannel;
+import java.nio.channels.NonWritableChannelException;
 
 public class RandomAccessFile implements DataInput, Closeable {
+  private static final int MapReadOnly = 0;
+  private static final int MapReadWrite = 1;
+  private static final int MapPrivate = 2;
 
   private long peer;
   private File file;
@@ -230,6 +235,10 @@ public class RandomAccessFile implements DataInput, Closeable {
 
   private static native void close(long peer);
 
+  private static native MappedByteBuffer map(long peer, long position,
+                                             int size, int mode)
+    throws IOException;
+
   public FileChannel getChannel() {
     return new FileChannel() {
       public void close() {
@@ -244,7 +253,11 @@ public class RandomAccessFile implements DataInput, Closeable {
         if (!dst.hasArray()) throw new IOException("Cannot handle " + dst.getClass());
 	// TODO: this needs to be synchronized on the Buffer, no?
         byte[] array = dst.array();
-        return readBytes(peer, position, array, dst.position(), dst.remaining());
+        int count = readBytes(peer, position, array,
+                              dst.arrayOffset() + dst.position(),
+                              dst.remaining());
+        if (count > 0) dst.position(dst.position() + count);
+        return count;
       }
 
       public int read(ByteBuffer dst) throws IOException {
@@ -256,7 +269,11 @@ public class RandomAccessFile implements DataInput, Closeable {
       public int write(ByteBuffer src, long position) throws IOException {
         if (!src.hasArray()) throw new IOException("Cannot handle " + src.getClass());
         byte[] array = src.array();
-        return writeBytes(peer, position, array, src.position(), src.remaining());
+        int count = writeBytes(peer, position, array,
+                               src.arrayOffset() + src.position(),
+                               src.remaining());
+        if (count > 0) src.position(src.position() + count);
+        return count;
       }
 
       public int write(ByteBuffer src) throws IOException {
@@ -277,6 +294,37 @@ public class RandomAccessFile implements DataInput, Closeable {
       public long size() throws IOException {
         return length();
       }
+
+      protected int descriptor() {
+        return (int) peer;
+      }
+
+      public MappedByteBuffer map(MapMode mode, long position, long size)
+        throws IOException
+      {
+        if (position < 0 || size < 0 || size > Integer.MAX_VALUE) {
+          throw new IllegalArgumentException();
+        }
+
+        if (mode != MapMode.READ_ONLY && ! allowWrite) {
+          throw new NonWritableChannelException();
+        }
+
+        if (peer == 0) {
+          throw new IOException();
+        }
+
+        if (position + size > length() && ! allowWrite) {
+          throw new IOException
+            ("cannot extend a file opened read-only to map it");
+        }
+
+        int m = (mode == MapMode.READ_ONLY ? MapReadOnly
+                 : mode == MapMode.READ_WRITE ? MapReadWrite
+                 : MapPrivate);
+
+        return RandomAccessFile.map(peer, position, (int) size, m);
+      }
     };
   }
 }
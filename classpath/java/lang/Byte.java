@@ -16,6 +16,15 @@ public final class Byte extends Number implements Comparable<Byte> {
   public static final byte MIN_VALUE = -128;
   public static final byte MAX_VALUE = 127;
 
+  // every byte value is boxed by a single instance
+  private static final Byte[] cache = new Byte[256];
+
+  static {
+    for (int i = 0; i < cache.length; ++i) {
+      cache[i] = new Byte((byte) (i - 128));
+    }
+  }
+
   private final byte value;
 
   public Byte(byte value) {
@@ -23,7 +32,7 @@ public final class Byte extends Number implements Comparable<Byte> {
   }
 
   public static Byte valueOf(byte value) {
-    return new Byte(value);
+    return cache[value + 128];
   }
 
   public boolean equals(Object o) {
@@ -16,6 +16,14 @@ public final class Character implements Comparable<Character> {
 
   public static final Class TYPE = avian.Classes.forCanonicalName("C");
 
+  private static final Character[] cache = new Character[128];
+
+  static {
+    for (int i = 0; i < cache.length; ++i) {
+      cache[i] = new Character((char) i);
+    }
+  }
+
   private final char value;
 
   public Character(char value) {
@@ -23,7 +31,11 @@ public final class Character implements Comparable<Character> {
   }
 
   public static Character valueOf(char value) {
-    return new Character(value);
+    if (value < 128) {
+      return cache[value];
+    } else {
+      return new Character(value);
+    }
   }
 
   public int compareTo(Character o) {
@@ -32,6 +32,7 @@ import java.lang.reflect.SignatureParser;
 import java.lang.annotation.Annotation;
 import java.io.InputStream;
 import java.io.IOException;
+import java.lang.ref.SoftReference;
 import java.net.URL;
 import java.util.Arrays;
 import java.util.List;
@@ -50,11 +51,51 @@ public final class Class <T>
   private static final int EnumFlag      = 1 << 14;
 
   public final VMClass vmClass;
+  private SoftReference<ReflectionData> reflectionData;
 
   public Class(VMClass vmClass) {
     this.vmClass = vmClass;
   }
 
+  // the Field and Method arrays handed out so far, each element of
+  // which is copied before it is returned since callers may call
+  // setAccessible on it.  Softly held so the collector may drop them
+  // when memory is short.
+  private static class ReflectionData {
+    public Field[] declaredFields;
+    public Field[] publicFields;
+    public Method[] declaredMethods;
+    public Method[] publicMethods;
+  }
+
+  private ReflectionData reflectionData() {
+    SoftReference<ReflectionData> ref = reflectionData;
+    ReflectionData data = ref == null ? null : ref.get();
+    if (data == null) {
+      // racing threads may each make one, but they hold the same
+      // contents so it doesn't matter whose is kept
+      data = new ReflectionData();
+      reflectionData = new SoftReference<ReflectionData>(data);
+    }
+    return data;
+  }
+
+  private static Field[] copy(Field[] fields) {
+    Field[] array = new Field[fields.length];
+    for (int i = 0; i < fields.length; ++i) {
+      array[i] = new Field(fields[i]);
+    }
+    return array;
+  }
+
+  private static Method[] copy(Method[] methods) {
+    Method[] array = new Method[methods.length];
+    for (int i = 0; i < methods.length; ++i) {
+      array[i] = new Method(methods[i]);
+    }
+    return array;
+  }
+
   public String toString() {
     String res;
     if (isInterface()) res = "interface ";
@@ -321,6 +362,15 @@ public final class Class <T>
   }
 
   public Field[] getDeclaredFields() {
+    ReflectionData data = reflectionData();
+    Field[] fields = data.declaredFields;
+    if (fields == null) {
+      data.declaredFields = fields = makeDeclaredFields();
+    }
+    return copy(fields);
+  }
+
+  private Field[] makeDeclaredFields() {
     if (vmClass.fieldTable != null) {
       Field[] array = new Field[vmClass.fieldTable.length];
       for (int i = 0; i < vmClass.fieldTable.length; ++i) {
@@ -345,6 +395,15 @@ public final class Class <T>
   }
 
   public Field[] getFields() {
+    ReflectionData data = reflectionData();
+    Field[] fields = data.publicFields;
+    if (fields == null) {
+      data.publicFields = fields = makePublicFields();
+    }
+    return copy(fields);
+  }
+
+  private Field[] makePublicFields() {
     Field[] array = new Field[countPublicFields()];
     if (vmClass.fieldTable != null) {
       Classes.link(vmClass);
@@ -379,11 +438,21 @@ public final class Class <T>
   }
 
   public Method[] getDeclaredMethods() {
-    return Classes.getMethods(vmClass, false);
+    ReflectionData data = reflectionData();
+    Method[] methods = data.declaredMethods;
+    if (methods == null) {
+      data.declaredMethods = methods = Classes.getMethods(vmClass, false);
+    }
+    return copy(methods);
   }
 
   public Method[] getMethods() {
-    return Classes.getMethods(vmClass, true);
+    ReflectionData data = reflectionData();
+    Method[] methods = data.publicMethods;
+    if (methods == null) {
+      data.publicMethods = methods = Classes.getMethods(vmClass, true);
+    }
+    return copy(methods);
   }
 
   public Class[] getInterfaces() {
@@ -16,6 +16,17 @@ public final class Integer extends Number implements Comparable<Integer> {
   public static final int MIN_VALUE = 0x80000000;
   public static final int MAX_VALUE = 0x7FFFFFFF;
 
+  // valueOf, which autoboxing calls, must return the same instance
+  // each time it boxes a value in -128..127 (JLS 5.1.7), so the boxes
+  // for those are made once here; Long, Short and Character do the same
+  private static final Integer[] cache = new Integer[256];
+
+  static {
+    for (int i = 0; i < cache.length; ++i) {
+      cache[i] = new Integer(i - 128);
+    }
+  }
+
   private final int value;
 
   public Integer(int value) {
@@ -27,7 +38,11 @@ public final class Integer extends Number implements Comparable<Integer> {
   }
 
   public static Integer valueOf(int value) {
-    return new Integer(value);
+    if (value >= -128 && value < 128) {
+      return cache[value + 128];
+    } else {
+      return new Integer(value);
+    }
   }
 
   public static Integer valueOf(String value) {
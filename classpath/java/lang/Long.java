@@ -16,6 +16,14 @@ public final class Long extends Number implements Comparable<Long> {
 
   public static final Class TYPE = avian.Classes.forCanonicalName("J");
 
+  private static final Long[] cache = new Long[256];
+
+  static {
+    for (int i = 0; i < cache.length; ++i) {
+      cache[i] = new Long(i - 128);
+    }
+  }
+
   private final long value;
 
   public Long(long value) {
@@ -31,7 +39,11 @@ public final class Long extends Number implements Comparable<Long> {
   }
 
   public static Long valueOf(long value) {
-    return new Long(value);
+    if (value >= -128 && value < 128) {
+      return cache[(int) value + 128];
+    } else {
+      return new Long(value);
+    }
   }
 
   public int compareTo(Long o) {
@@ -132,6 +144,22 @@ public final class Long extends Number implements Comparable<Long> {
     else            return -1;
   }
 
+  public static long reverseBytes(long v) {
+    return (((long) Integer.reverseBytes((int) v)) << 32)
+      | (((long) Integer.reverseBytes((int) (v >>> 32))) & 0xFFFFFFFFL);
+  }
+
+  public static int bitCount(long v) {
+    return Integer.bitCount((int) v) + Integer.bitCount((int) (v >>> 32));
+  }
+
+  public static int numberOfLeadingZeros(long v) {
+    int high = (int) (v >>> 32);
+    return high == 0
+      ? 32 + Integer.numberOfLeadingZeros((int) v)
+      : Integer.numberOfLeadingZeros(high);
+  }
+
   private static long pow(long a, long b) {
     long c = 1;
     for (int i = 0; i < b; ++i) c *= a;
@@ -132,6 +132,8 @@ public class Runtime {
   
   public native long maxMemory();
 
+  public native int availableProcessors();
+
   private static class MyProcess extends Process {
     private long pid;
     private long tid;
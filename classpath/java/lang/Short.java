@@ -16,6 +16,14 @@ public final class Short extends Number implements Comparable<Short> {
   public static final short MIN_VALUE = -32768;
   public static final short MAX_VALUE = 32767;
 
+  private static final Short[] cache = new Short[256];
+
+  static {
+    for (int i = 0; i < cache.length; ++i) {
+      cache[i] = new Short((short) (i - 128));
+    }
+  }
+
   private final short value;
 
   public Short(short value) {
@@ -23,7 +31,11 @@ public final class Short extends Number implements Comparable<Short> {
   }
 
   public static Short valueOf(short value) {
-    return new Short(value);
+    if (value >= -128 && value < 128) {
+      return cache[value + 128];
+    } else {
+      return new Short(value);
+    }
   }
 
   public int compareTo(Short o) {
@@ -50,6 +62,10 @@ public final class Short extends Number implements Comparable<Short> {
     return toString(v, 10);
   }
 
+  public static short reverseBytes(short v) {
+    return (short) (((v & 0xFF) << 8) | ((v >> 8) & 0xFF));
+  }
+
   public byte byteValue() {
     return (byte) value;
   }
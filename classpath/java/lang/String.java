@@ -60,10 +60,36 @@ public final class String
   public String(byte bytes[], int offset, int length, String charsetName)
     throws UnsupportedEncodingException
   {
-    this(bytes, offset, length);
-    if (! (charsetName.equalsIgnoreCase(UTF_8_ENCODING)
-           || charsetName.equalsIgnoreCase(ISO_8859_1_ENCODING)))
+    this(decode(bytes, offset, length, charsetName));
+  }
+
+  // the decoded data is ours alone, so we take it as it is
+  private String(Object data) {
+    this(data, 0, data instanceof char[]
+         ? ((char[]) data).length : ((byte[]) data).length, false);
+  }
+
+  private static Object decode(byte[] bytes, int offset, int length,
+                               String charsetName)
+    throws UnsupportedEncodingException
+  {
+    if (offset < 0 || length < 0 || offset > bytes.length - length) {
+      throw new StringIndexOutOfBoundsException(offset);
+    }
+
+    if (charsetName.equalsIgnoreCase(UTF_8_ENCODING)) {
+      Object data = Utf8.decode(bytes, offset, length);
+      if (data == null) {
+        throw new RuntimeException
+          ("unable to parse \"" + new String(bytes, offset, length, false)
+           + "\"");
+      }
+      return data;
+    } else if (charsetName.equalsIgnoreCase(ISO_8859_1_ENCODING)
+               || charsetName.equalsIgnoreCase(LATIN_1_ENCODING))
     {
+      return Iso88591.decode(bytes, offset, length);
+    } else {
       throw new UnsupportedEncodingException(charsetName);
     }
   }
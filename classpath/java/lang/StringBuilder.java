@@ -97,11 +97,39 @@ public class StringBuilder implements CharSequence, Appendable {
   }
 
   public StringBuilder append(int v) {
-    return append(String.valueOf(v));
+    return append((long) v);
   }
 
   public StringBuilder append(long v) {
-    return append(String.valueOf(v));
+    if (v == Long.MIN_VALUE) {
+      return append(String.valueOf(v));
+    }
+
+    // write the digits straight into the buffer rather than making a
+    // String of them first
+    int digits = 1;
+    for (long n = v < 0 ? -v : v; n >= 10; n /= 10) {
+      ++ digits;
+    }
+    int size = v < 0 ? digits + 1 : digits;
+
+    if (buffer == null || buffer.length - position < size) {
+      flush();
+      buffer = new char[BufferSize];
+    }
+
+    if (v < 0) {
+      buffer[position++] = '-';
+      v = -v;
+    }
+    for (int i = position + digits - 1; i >= position; --i) {
+      buffer[i] = (char) ('0' + (v % 10));
+      v /= 10;
+    }
+    position += digits;
+    length += size;
+
+    return this;
   }
 
   public StringBuilder append(float v) {
@@ -291,6 +319,8 @@ public class StringBuilder implements CharSequence, Appendable {
     if (v == 0) {
       length = 0;
       chain = null;
+      buffer = null;
+      position = 0;
       return;
     }
 
@@ -342,6 +372,13 @@ public class StringBuilder implements CharSequence, Appendable {
   }
 
   public String toString() {
+    if (position == 0 && chain != null && chain.next == null
+        && length == chain.value.length()) {
+      // a builder holding just one string, e.g. from "" + s, needn't
+      // copy it
+      return chain.value;
+    }
+
     char[] array = new char[length];
     getChars(0, length, array, 0);
     return new String(array, 0, length, false);
@@ -10,26 +10,24 @@
 
 package java.lang;
 
-import java.util.Map;
-import java.util.WeakHashMap;
-
 public class Thread implements Runnable {
   // set and accessed from within LockSupport
   protected volatile Object parkBlocker;
   
   private long peer;
   private volatile boolean interrupted;
-  private volatile boolean unparked;
   private boolean daemon;
   private byte state;
   private byte priority;
   private final Runnable task;
-  private Map<ThreadLocal, Object> locals;
+  // indexed by ThreadLocal; see ThreadLocal.get
+  ThreadLocal.Entry[] locals;
   private Object sleepLock;
   private ClassLoader classLoader;
   private UncaughtExceptionHandler exceptionHandler;
   private String name;
   private ThreadGroup group;
+  private long stackSize;
 
   private static UncaughtExceptionHandler defaultExceptionHandler;
 
@@ -42,17 +40,12 @@ public class Thread implements Runnable {
     this.group = (group == null ? Thread.currentThread().group : group);
     this.task = task;
     this.name = name;
+    this.stackSize = stackSize;
 
     Thread current = currentThread();
 
-    Map<ThreadLocal, Object> map = current.locals;
-    if (map != null) {
-      for (Map.Entry<ThreadLocal, Object> e: map.entrySet()) {
-        if (e.getKey() instanceof InheritableThreadLocal) {
-          InheritableThreadLocal itl = (InheritableThreadLocal) e.getKey();
-          locals().put(itl, itl.childValue(e.getValue()));
-        }
-      }
+    if (current.locals != null) {
+      locals = ThreadLocal.inherit(current.locals);
     }
 
     classLoader = current.classLoader;
@@ -133,13 +126,6 @@ public class Thread implements Runnable {
     classLoader = v;
   }
 
-  public Map<ThreadLocal, Object> locals() {
-    if (locals == null) {
-      locals = new WeakHashMap();
-    }
-    return locals;
-  }
-
   public static native Thread currentThread();
 
   public void interrupt() {
@@ -10,37 +10,153 @@
 
 package java.lang;
 
-import java.util.Map;
+import java.lang.ref.ReferenceQueue;
+import java.lang.ref.WeakReference;
 
 public class ThreadLocal<T> {
-  private static final Object Null = new Object();
+  private static final Object lock = new Object();
+  private static final ReferenceQueue<ThreadLocal> queue
+    = new ReferenceQueue();
+
+  // keys[i] is the key of the live ThreadLocal with index i, if any.
+  // Keeping the keys here keeps them reachable until their ThreadLocals
+  // are collected, at which point they are queued and we reuse their
+  // indexes.
+  private static Key[] keys = new Key[16];
+  private static int[] free = new int[16];
+  private static int freeCount;
+  private static int nextIndex;
+
+  private final Key key;
+
+  public ThreadLocal() {
+    key = new Key(this);
+  }
 
   protected T initialValue() {
     return null;
   }
 
   public T get() {
-    Map<ThreadLocal, Object> map = Thread.currentThread().locals();
-    Object o = map.get(this);
-    if (o == null) {
-      o = initialValue();
-      if (o == null) {
-        o = Null;
+    Entry[] entries = Thread.currentThread().locals;
+    int index = key.index;
+    if (entries != null && index < entries.length) {
+      Entry e = entries[index];
+      if (e != null && e.key == key) {
+        return (T) e.value;
       }
-      map.put(this, o);
-    }
-    if (o == Null) {
-      o = null;
     }
-    return (T) o;
+
+    T value = initialValue();
+    set(value);
+    return value;
   }
 
   public void set(T value) {
-    Map<ThreadLocal, Object> map = Thread.currentThread().locals();
-    Object o = value;
-    if (o == null) {
-      o = Null;
+    Thread current = Thread.currentThread();
+    Entry[] entries = current.locals;
+    int index = key.index;
+    if (entries != null && index < entries.length) {
+      Entry e = entries[index];
+      if (e != null && e.key == key) {
+        e.value = value;
+        return;
+      }
+    } else {
+      entries = grow(entries, index);
+      current.locals = entries;
+    }
+
+    // either nothing is here yet or a collected ThreadLocal which had
+    // our index left its value here, which we replace
+    entries[index] = new Entry(key, value);
+  }
+
+  public void remove() {
+    Entry[] entries = Thread.currentThread().locals;
+    int index = key.index;
+    if (entries != null && index < entries.length) {
+      Entry e = entries[index];
+      if (e != null && e.key == key) {
+        entries[index] = null;
+      }
+    }
+  }
+
+  // threads the VM creates itself (e.g. the main thread) start out
+  // with no entries at all
+  private static Entry[] grow(Entry[] entries, int index) {
+    int length = entries == null ? 0 : entries.length * 2;
+    if (length <= index) {
+      length = index + 1;
+    }
+    Entry[] a = new Entry[length];
+    if (entries != null) {
+      System.arraycopy(entries, 0, a, 0, entries.length);
+    }
+    return a;
+  }
+
+  static Entry[] inherit(Entry[] parent) {
+    Entry[] entries = new Entry[parent.length];
+    for (int i = 0; i < parent.length; ++i) {
+      Entry e = parent[i];
+      if (e != null) {
+        ThreadLocal tl = e.key.get();
+        if (tl instanceof InheritableThreadLocal) {
+          entries[i] = new Entry
+            (e.key, ((InheritableThreadLocal) tl).childValue(e.value));
+        }
+      }
+    }
+    return entries;
+  }
+
+  private static int allocateIndex(Key key) {
+    synchronized (lock) {
+      for (Key k = (Key) queue.poll(); k != null; k = (Key) queue.poll()) {
+        keys[k.index] = null;
+        if (freeCount == free.length) {
+          int[] a = new int[free.length * 2];
+          System.arraycopy(free, 0, a, 0, freeCount);
+          free = a;
+        }
+        free[freeCount++] = k.index;
+      }
+
+      int index;
+      if (freeCount > 0) {
+        index = free[--freeCount];
+      } else {
+        index = nextIndex++;
+        if (index == keys.length) {
+          Key[] a = new Key[keys.length * 2];
+          System.arraycopy(keys, 0, a, 0, keys.length);
+          keys = a;
+        }
+      }
+
+      keys[index] = key;
+      return index;
+    }
+  }
+
+  static class Key extends WeakReference<ThreadLocal> {
+    final int index;
+
+    Key(ThreadLocal tl) {
+      super(tl, queue);
+      index = allocateIndex(this);
+    }
+  }
+
+  static class Entry {
+    final Key key;
+    Object value;
+
+    Entry(Key key, Object value) {
+      this.key = key;
+      this.value = value;
     }
-    map.put(this, o);
   }
 }
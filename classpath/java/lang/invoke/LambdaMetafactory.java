@@ -84,10 +84,28 @@ public class LambdaMetafactory {
     throws IOException
   {
     ByteArrayOutputStream out = new ByteArrayOutputStream();
-    write2(out, type.footprint() + 2); // max stack
+    write2(out, type.footprint() + 3); // max stack
     write2(out, type.footprint()); // max locals
     write4(out, 0); // length (we'll set the real value later)
 
+    boolean capturing = type.footprint() != 0;
+
+    // a lambda which captures nothing can be shared, so we make one
+    // the first time through and return it from then on.  If two
+    // threads race to make it, one of them wins, which is harmless.
+    int instance = 0;
+    if (! capturing) {
+      instance = ConstantPool.addFieldRef
+        (pool, className, "instance", "L" + className + ";") + 1;
+
+      write1(out, getstatic);
+      write2(out, instance);
+      write1(out, dup);
+      write1(out, ifnonnull);
+      write2(out, 15); // offset of areturn below
+      write1(out, pop);
+    }
+
     write1(out, new_);
     write2(out, ConstantPool.addClass(pool, className) + 1);
     write1(out, dup);
@@ -101,6 +119,12 @@ public class LambdaMetafactory {
     write2(out, ConstantPool.addMethodRef
            (pool, className, "<init>", constructorSpec) + 1);
 
+    if (! capturing) {
+      write1(out, dup);
+      write1(out, putstatic);
+      write2(out, instance);
+    }
+
     write1(out, areturn);
 
     write2(out, 0); // exception handler table length
@@ -443,6 +467,14 @@ public class LambdaMetafactory {
                        ConstantPool.addUtf8(pool, p.spec())));
     }
 
+    if (invokedType.footprint() == 0) {
+      // see makeFactoryCode
+      fieldTable.add
+        (new FieldData(Modifier.PRIVATE | Modifier.STATIC,
+                       ConstantPool.addUtf8(pool, "instance"),
+                       ConstantPool.addUtf8(pool, "L" + className + ";")));
+    }
+
     String constructorSpec = constructorSpec(invokedType);
 
     List<MethodData> methodTable = new ArrayList();
@@ -11,11 +11,27 @@
 package java.lang.ref;
 
 public class SoftReference<T> extends Reference<T> {
+  // the time of the most recent collection, which the VM updates; a
+  // target's time since last use is measured against it when deciding
+  // whether to clear a reference
+  private static long clock = System.currentTimeMillis();
+
+  private long timestamp;
+
   public SoftReference(T target, ReferenceQueue<? super T> queue) {
-    super(target, queue);    
+    super(target, queue);
+    timestamp = clock;
   }
 
   public SoftReference(T target) {
     this(target, null);
   }
+
+  public T get() {
+    T o = super.get();
+    if (timestamp != clock) {
+      timestamp = clock;
+    }
+    return o;
+  }
 }
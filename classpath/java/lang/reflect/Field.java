@@ -31,11 +31,18 @@ public class Field<T> extends AccessibleObject implements Member {
 
   private final VMField vmField;
   private boolean accessible = true;
+  private String name;
 
   public Field(VMField vmField) {
     this.vmField = vmField;
   }
 
+  // a fresh copy of a cached instance, sharing its interned name
+  public Field(Field original) {
+    this.vmField = original.vmField;
+    this.name = original.getName();
+  }
+
   public boolean isAccessible() {
     return accessible;
   }
@@ -57,7 +64,10 @@ public class Field<T> extends AccessibleObject implements Member {
   }
 
   public String getName() {
-    return getName(vmField);
+    if (name == null) {
+      name = getName(vmField).intern();
+    }
+    return name;
   }
 
   public static String getName(VMField vmField) {
@@ -14,17 +14,31 @@ import avian.VMMethod;
 import avian.AnnotationInvocationHandler;
 import avian.SystemClassLoader;
 import avian.Classes;
+import avian.MethodAccessor;
 
 import java.lang.annotation.Annotation;
 
 public class Method<T> extends AccessibleObject implements Member {
+  // number of calls through the generic native path before we try to
+  // generate an accessor which calls the method directly
+  private static final int InflationThreshold = 16;
+
   public final VMMethod vmMethod;
   private boolean accessible;
+  private int invocations;
+  private MethodAccessor accessor;
+  private String name;
 
   public Method(VMMethod vmMethod) {
     this.vmMethod = vmMethod;
   }
 
+  // a fresh copy of a cached instance, sharing its interned name
+  public Method(Method original) {
+    this.vmMethod = original.vmMethod;
+    this.name = original.getName();
+  }
+
   public boolean equals(Object o) {
     return o instanceof Method && ((Method) o).vmMethod == vmMethod;
   }
@@ -48,7 +62,10 @@ public class Method<T> extends AccessibleObject implements Member {
   }
 
   public String getName() {
-    return getName(vmMethod);
+    if (name == null) {
+      name = getName(vmMethod).intern();
+    }
+    return name;
   }
 
   public static String getName(VMMethod vmMethod) {
@@ -85,6 +102,22 @@ public class Method<T> extends AccessibleObject implements Member {
       }
 
       if (arguments.length == vmMethod.parameterCount) {
+        if (accessor == null && ++ invocations == InflationThreshold) {
+          // if this fails, invocations moves past the threshold and
+          // we won't try again
+          accessor = MethodAccessor.make(vmMethod);
+        }
+
+        if (accessor != null) {
+          try {
+            return accessor.invoke(instance, arguments);
+          } catch (IllegalArgumentException e) {
+            // the accessor only accepts arguments which match the
+            // parameter types exactly, so let the generic path decide
+            // what to do with anything else
+          }
+        }
+
         Classes.initialize(vmMethod.class_);
 
         return invoke(vmMethod, instance, arguments);        
@@ -32,6 +32,7 @@ import java.util.Map;
 import java.util.HashMap;
 import java.util.Set;
 import java.util.HashSet;
+import java.util.Arrays;
 import java.io.OutputStream;
 import java.io.ByteArrayOutputStream;
 import java.io.IOException;
@@ -39,17 +40,22 @@ import java.io.IOException;
 public class Proxy {
   private static int nextNumber;
 
-  protected InvocationHandler h;
-  protected final static Map<Class, Method[]> methodRefsMap =
-    new HashMap<Class, Method[]>();
-  protected final Method[] methodRefs;
+  // constructors of the proxy classes we've made so far, so that
+  // asking for the same loader and interfaces again doesn't make a new
+  // class each time
+  private static final Map<Key, Constructor> constructors
+    = new HashMap<Key, Constructor>();
 
-  public Proxy() {
-    methodRefs = methodRefsMap.get(getClass());
-  }
+  protected InvocationHandler h;
 
   public static Class getProxyClass(ClassLoader loader,
                                     Class ... interfaces)
+  {
+    return getProxyConstructor(loader, interfaces).getDeclaringClass();
+  }
+
+  private static Constructor getProxyConstructor(ClassLoader loader,
+                                                 Class[] interfaces)
   {
     for (Class c: interfaces) {
       if (! c.isInterface()) {
@@ -57,17 +63,28 @@ public class Proxy {
       }
     }
 
-    int number;
-    synchronized (Proxy.class) {
-      number = nextNumber++;
-    }
+    Key key = new Key(loader, interfaces.clone());
 
-    try {
-      return makeClass(loader, interfaces, "Proxy-" + number);
-    } catch (IOException e) {
-      AssertionError error = new AssertionError();
-      error.initCause(e);
-      throw error;      
+    synchronized (constructors) {
+      Constructor constructor = constructors.get(key);
+      if (constructor == null) {
+        int number;
+        synchronized (Proxy.class) {
+          number = nextNumber++;
+        }
+
+        try {
+          constructor = makeClass(loader, interfaces, "Proxy-" + number)
+            .getConstructor(new Class[] { InvocationHandler.class });
+        } catch (Exception e) {
+          AssertionError error = new AssertionError();
+          error.initCause(e);
+          throw error;
+        }
+
+        constructors.put(key, constructor);
+      }
+      return constructor;
     }
   }
 
@@ -79,6 +96,27 @@ public class Proxy {
     return ((Proxy) proxy).h;
   }
 
+  private static class Key {
+    private final ClassLoader loader;
+    private final Class[] interfaces;
+
+    public Key(ClassLoader loader, Class[] interfaces) {
+      this.loader = loader;
+      this.interfaces = interfaces;
+    }
+
+    public int hashCode() {
+      return (loader == null ? 0 : loader.hashCode())
+        ^ Arrays.hashCode(interfaces);
+    }
+
+    public boolean equals(Object o) {
+      return o instanceof Key
+        && ((Key) o).loader == loader
+        && Arrays.equals(((Key) o).interfaces, interfaces);
+    }
+  }
+
   private static byte[] makeInvokeCode(List<PoolEntry> pool,
                                        String className,
                                        byte[] spec,
@@ -99,15 +137,11 @@ public class Proxy {
             "h", "Ljava/lang/reflect/InvocationHandler;") + 1);
 
     write1(out, aload_0);
-    
-    write1(out, aload_0);
-    write1(out, getfield);
+
+    write1(out, getstatic);
     write2(out, ConstantPool.addFieldRef
            (pool, className,
-            "methodRefs", "[Ljava/lang/reflect/Method;") + 1);
-    write1(out, ldc_w);
-    write2(out, ConstantPool.addInteger(pool, index) + 1);
-    write1(out, aaload);
+            "method" + index, "Ljava/lang/reflect/Method;") + 1);
 
     write1(out, ldc_w);
     write2(out, ConstantPool.addInteger(pool, parameterCount) + 1);
@@ -370,6 +404,7 @@ public class Proxy {
 
     Set<String> specs = new HashSet<String>();
     List<MethodData> methodTable = new ArrayList<MethodData>();
+    List<FieldData> fieldTable = new ArrayList<FieldData>();
     List<Method> refs = new ArrayList<Method>();
     for (Class c: interfaces) {
       avian.VMMethod[] ivtable = SystemClassLoader.vmClass(c).virtualTable;
@@ -385,6 +420,10 @@ public class Proxy {
              ConstantPool.addUtf8(pool, Classes.toString(m.spec)),
              makeInvokeCode(pool, name, m.spec, m.parameterCount,
                             m.parameterFootprint, methodTable.size())));
+          fieldTable.add(new FieldData
+            (Modifier.PRIVATE | Modifier.STATIC,
+             ConstantPool.addUtf8(pool, "method" + refs.size()),
+             ConstantPool.addUtf8(pool, "Ljava/lang/reflect/Method;")));
           refs.add(Classes.makeMethod(m));
         }
       }
@@ -403,13 +442,25 @@ public class Proxy {
     ByteArrayOutputStream out = new ByteArrayOutputStream();
     Assembler.writeClass
       (out, pool, nameIndex, superIndex, interfaceIndexes,
-       new FieldData[0],
+       fieldTable.toArray(new FieldData[fieldTable.size()]),
        methodTable.toArray(new MethodData[methodTable.size()]));
 
     byte[] classData = out.toByteArray();
     Class result = avian.SystemClassLoader.getClass
       (avian.Classes.defineVMClass(loader, classData, 0, classData.length));
-    methodRefsMap.put(result, refs.toArray(new Method[refs.size()]));
+
+    // each proxy method passes its own Method to the handler, which we
+    // resolve once here rather than on every call
+    try {
+      for (int i = 0; i < refs.size(); ++i) {
+        result.getDeclaredField("method" + i).set(null, refs.get(i));
+      }
+    } catch (Exception e) {
+      AssertionError error = new AssertionError();
+      error.initCause(e);
+      throw error;
+    }
+
     return result;
   }
 
@@ -418,8 +469,7 @@ public class Proxy {
                                         InvocationHandler handler)
   {
     try {
-      return Proxy.getProxyClass(loader, interfaces)
-        .getConstructor(new Class[] { InvocationHandler.class })
+      return getProxyConstructor(loader, interfaces)
         .newInstance(new Object[] { handler });
     } catch (Exception e) {
       AssertionError error = new AssertionError();
@@ -0,0 +1,40 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.net;
+
+public final class StandardSocketOptions {
+  public static final SocketOption<Boolean> SO_REUSEPORT
+    = new Option<Boolean>("SO_REUSEPORT", Boolean.class);
+
+  private StandardSocketOptions() { }
+
+  private static class Option<T> implements SocketOption<T> {
+    private final String name;
+    private final Class<T> type;
+
+    public Option(String name, Class<T> type) {
+      this.name = name;
+      this.type = type;
+    }
+
+    public String name() {
+      return name;
+    }
+
+    public Class<T> type() {
+      return type;
+    }
+
+    public String toString() {
+      return name;
+    }
+  }
+}
@@ -10,7 +10,12 @@
 
 package java.nio;
 
+import sun.misc.Unsafe;
+
 class ArrayByteBuffer extends ByteBuffer {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final int baseOffset = unsafe.arrayBaseOffset(byte[].class);
+
   private final byte[] array;
   private final int arrayOffset;
 
@@ -82,6 +87,145 @@ class ArrayByteBuffer extends ByteBuffer {
     return array[arrayOffset+position];
   }
 
+  // As in DirectByteBuffer, the multi-byte accessors below read and
+  // write a whole value at once via Unsafe, which the JIT compiles to
+  // a plain load or store, once checkGet or checkPut has established
+  // that the whole value lies within the buffer.  Element offsets are
+  // measured from the start of the array object, which is word
+  // aligned.
+
+  private short arrayGetShort(int position) {
+    long p = baseOffset + arrayOffset + position;
+    if (unaligned || (p & 1) == 0) {
+      short v = unsafe.getShort(array, p);
+      return swap ? Short.reverseBytes(v) : v;
+    } else {
+      return super.getShort(position);
+    }
+  }
+
+  private int arrayGetInt(int position) {
+    long p = baseOffset + arrayOffset + position;
+    if (unaligned || (p & 3) == 0) {
+      int v = unsafe.getInt(array, p);
+      return swap ? Integer.reverseBytes(v) : v;
+    } else {
+      return super.getInt(position);
+    }
+  }
+
+  private long arrayGetLong(int position) {
+    long p = baseOffset + arrayOffset + position;
+    if (unaligned || (p & 7) == 0) {
+      long v = unsafe.getLong(array, p);
+      return swap ? Long.reverseBytes(v) : v;
+    } else {
+      return super.getLong(position);
+    }
+  }
+
+  public short getShort(int position) {
+    checkGet(position, 2, true);
+    return arrayGetShort(position);
+  }
+
+  public int getInt(int position) {
+    checkGet(position, 4, true);
+    return arrayGetInt(position);
+  }
+
+  public long getLong(int position) {
+    checkGet(position, 8, true);
+    return arrayGetLong(position);
+  }
+
+  public short getShort() {
+    checkGet(position, 2, false);
+    short r = arrayGetShort(position);
+    position += 2;
+    return r;
+  }
+
+  public int getInt() {
+    checkGet(position, 4, false);
+    int r = arrayGetInt(position);
+    position += 4;
+    return r;
+  }
+
+  public long getLong() {
+    checkGet(position, 8, false);
+    long r = arrayGetLong(position);
+    position += 8;
+    return r;
+  }
+
+  private void arrayPutShort(int position, short val) {
+    long p = baseOffset + arrayOffset + position;
+    if (unaligned || (p & 1) == 0) {
+      unsafe.putShort(array, p, swap ? Short.reverseBytes(val) : val);
+    } else {
+      super.putShort(position, val);
+    }
+  }
+
+  private void arrayPutInt(int position, int val) {
+    long p = baseOffset + arrayOffset + position;
+    if (unaligned || (p & 3) == 0) {
+      unsafe.putInt(array, p, swap ? Integer.reverseBytes(val) : val);
+    } else {
+      super.putInt(position, val);
+    }
+  }
+
+  private void arrayPutLong(int position, long val) {
+    long p = baseOffset + arrayOffset + position;
+    if (unaligned || (p & 7) == 0) {
+      unsafe.putLong(array, p, swap ? Long.reverseBytes(val) : val);
+    } else {
+      super.putLong(position, val);
+    }
+  }
+
+  public ByteBuffer putShort(int position, short val) {
+    checkPut(position, 2, true);
+    arrayPutShort(position, val);
+    return this;
+  }
+
+  public ByteBuffer putInt(int position, int val) {
+    checkPut(position, 4, true);
+    arrayPutInt(position, val);
+    return this;
+  }
+
+  public ByteBuffer putLong(int position, long val) {
+    checkPut(position, 8, true);
+    arrayPutLong(position, val);
+    return this;
+  }
+
+  public ByteBuffer putShort(short val) {
+    checkPut(position, 2, false);
+    arrayPutShort(position, val);
+    position += 2;
+    return this;
+  }
+
+  public ByteBuffer putInt(int val) {
+    checkPut(position, 4, false);
+    arrayPutInt(position, val);
+    position += 4;
+    return this;
+  }
+
+  public ByteBuffer putLong(long val) {
+    checkPut(position, 8, false);
+    arrayPutLong(position, val);
+    position += 8;
+    return this;
+  }
+
   public String toString() {
     return "(ArrayByteBuffer with array: " + array
       + " arrayOffset: " + arrayOffset
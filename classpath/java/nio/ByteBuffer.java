@@ -14,6 +14,25 @@ public abstract class ByteBuffer
   extends Buffer
   implements Comparable<ByteBuffer>
 {
+  static final boolean nativeBigEndian
+    = ByteOrder.nativeOrder() == ByteOrder.BIG_ENDIAN;
+
+  // whether subclasses may load and store values at any address, not
+  // just ones aligned to their size: x86 and arm64 do so at full
+  // speed, but other architectures may trap or be slow
+  static final boolean unaligned;
+
+  static {
+    String arch = System.getProperty("os.arch");
+    unaligned = "x86".equals(arch) || "x86_64".equals(arch)
+      || "arm64".equals(arch);
+  }
+
+  private boolean bigEndian = true;
+
+  // whether a value read from or written to memory whole must have
+  // its bytes reversed to match this buffer's order
+  boolean swap = ! nativeBigEndian;
 
   protected ByteBuffer(boolean readOnly) {
     this.readonly = readOnly;
@@ -32,6 +51,10 @@ public abstract class ByteBuffer
   }
 
   public static ByteBuffer wrap(byte[] array, int offset, int length) {
+    if (offset < 0 || length < 0 || offset > array.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+
     return new ArrayByteBuffer(array, offset, length, false);
   }
 
@@ -125,6 +148,8 @@ public abstract class ByteBuffer
   }
   
   private void rawPutLong(int position, long val) {
+    if (! bigEndian) val = Long.reverseBytes(val);
+
     doPut(position    , (byte) ((val >> 56) & 0xff));
     doPut(position + 1, (byte) ((val >> 48) & 0xff));
     doPut(position + 2, (byte) ((val >> 40) & 0xff));
@@ -136,6 +161,8 @@ public abstract class ByteBuffer
   }
 
   private void rawPutInt(int position, int val) {
+    if (! bigEndian) val = Integer.reverseBytes(val);
+
     doPut(position    , (byte) ((val >> 24) & 0xff));
     doPut(position + 1, (byte) ((val >> 16) & 0xff));
     doPut(position + 2, (byte) ((val >>  8) & 0xff));
@@ -143,6 +170,8 @@ public abstract class ByteBuffer
   }
 
   private void rawPutShort(int position, short val) {
+    if (! bigEndian) val = Short.reverseBytes(val);
+
     doPut(position    , (byte) ((val >> 8) & 0xff));
     doPut(position + 1, (byte) ((val     ) & 0xff));
   }
@@ -252,7 +281,7 @@ public abstract class ByteBuffer
   }
 
   private long rawGetLong(int position) {
-    return (((long) (doGet(position    ) & 0xFF)) << 56)
+    long v = (((long) (doGet(position    ) & 0xFF)) << 56)
       |    (((long) (doGet(position + 1) & 0xFF)) << 48)
       |    (((long) (doGet(position + 2) & 0xFF)) << 40)
       |    (((long) (doGet(position + 3) & 0xFF)) << 32)
@@ -260,18 +289,21 @@ public abstract class ByteBuffer
       |    (((long) (doGet(position + 5) & 0xFF)) << 16)
       |    (((long) (doGet(position + 6) & 0xFF)) <<  8)
       |    (((long) (doGet(position + 7) & 0xFF))      );
+    return bigEndian ? v : Long.reverseBytes(v);
   }
 
   private int rawGetInt(int position) {
-    return (((int) (doGet(position    ) & 0xFF)) << 24)
+    int v = (((int) (doGet(position    ) & 0xFF)) << 24)
       |    (((int) (doGet(position + 1) & 0xFF)) << 16)
       |    (((int) (doGet(position + 2) & 0xFF)) <<  8)
       |    (((int) (doGet(position + 3) & 0xFF))      );
+    return bigEndian ? v : Integer.reverseBytes(v);
   }
 
   private short rawGetShort(int position) {
-    return (short) ((  ((int) (doGet(position    ) & 0xFF)) << 8)
-                    | (((int) (doGet(position + 1) & 0xFF))     ));
+    short v = (short) ((  ((int) (doGet(position    ) & 0xFF)) << 8)
+                       | (((int) (doGet(position + 1) & 0xFF))     ));
+    return bigEndian ? v : Short.reverseBytes(v);
   }
   
   public double getDouble() {
@@ -319,7 +351,7 @@ public abstract class ByteBuffer
   }
 
   protected void checkGet(int position, int amount, boolean absolute) {
-    if (amount > limit-position) {
+    if (position < 0 || amount > limit-position) {
       throw absolute
         ? new IndexOutOfBoundsException()
         : new BufferUnderflowException();
@@ -327,11 +359,12 @@ public abstract class ByteBuffer
   }
 
   public ByteBuffer order(ByteOrder order) {
-    if (order != ByteOrder.BIG_ENDIAN) throw new UnsupportedOperationException();
+    bigEndian = order == ByteOrder.BIG_ENDIAN;
+    swap = bigEndian != nativeBigEndian;
     return this;
   }
 
   public ByteOrder order() {
-    return ByteOrder.BIG_ENDIAN;
+    return bigEndian ? ByteOrder.BIG_ENDIAN : ByteOrder.LITTLE_ENDIAN;
   }
 }
@@ -89,6 +89,147 @@ class DirectByteBuffer extends ByteBuffer {
     unsafe.copyMemory
       (null, address + position, dst, baseOffset + offset, length);
 
+    position += length;
+
+    return this;
+  }
+
+  // The multi-byte accessors below read and write a whole value at
+  // once via Unsafe, which the JIT compiles to a plain load or store,
+  // rather than assembling it a byte at a time with doGet/doPut, and
+  // swap its bytes if the buffer's order isn't the machine's.
+  // Misaligned values take the byte-wise path on architectures which
+  // can't load them directly.
+
+  private short directGetShort(int position) {
+    long p = address + position;
+    if (unaligned || (p & 1) == 0) {
+      short v = unsafe.getShort(p);
+      return swap ? Short.reverseBytes(v) : v;
+    } else {
+      return super.getShort(position);
+    }
+  }
+
+  private int directGetInt(int position) {
+    long p = address + position;
+    if (unaligned || (p & 3) == 0) {
+      int v = unsafe.getInt(p);
+      return swap ? Integer.reverseBytes(v) : v;
+    } else {
+      return super.getInt(position);
+    }
+  }
+
+  private long directGetLong(int position) {
+    long p = address + position;
+    if (unaligned || (p & 7) == 0) {
+      long v = unsafe.getLong(p);
+      return swap ? Long.reverseBytes(v) : v;
+    } else {
+      return super.getLong(position);
+    }
+  }
+
+  public short getShort(int position) {
+    checkGet(position, 2, true);
+    return directGetShort(position);
+  }
+
+  public int getInt(int position) {
+    checkGet(position, 4, true);
+    return directGetInt(position);
+  }
+
+  public long getLong(int position) {
+    checkGet(position, 8, true);
+    return directGetLong(position);
+  }
+
+  public short getShort() {
+    checkGet(position, 2, false);
+    short r = directGetShort(position);
+    position += 2;
+    return r;
+  }
+
+  public int getInt() {
+    checkGet(position, 4, false);
+    int r = directGetInt(position);
+    position += 4;
+    return r;
+  }
+
+  public long getLong() {
+    checkGet(position, 8, false);
+    long r = directGetLong(position);
+    position += 8;
+    return r;
+  }
+
+  private void directPutShort(int position, short val) {
+    long p = address + position;
+    if (unaligned || (p & 1) == 0) {
+      unsafe.putShort(p, swap ? Short.reverseBytes(val) : val);
+    } else {
+      super.putShort(position, val);
+    }
+  }
+
+  private void directPutInt(int position, int val) {
+    long p = address + position;
+    if (unaligned || (p & 3) == 0) {
+      unsafe.putInt(p, swap ? Integer.reverseBytes(val) : val);
+    } else {
+      super.putInt(position, val);
+    }
+  }
+
+  private void directPutLong(int position, long val) {
+    long p = address + position;
+    if (unaligned || (p & 7) == 0) {
+      unsafe.putLong(p, swap ? Long.reverseBytes(val) : val);
+    } else {
+      super.putLong(position, val);
+    }
+  }
+
+  public ByteBuffer putShort(int position, short val) {
+    checkPut(position, 2, true);
+    directPutShort(position, val);
+    return this;
+  }
+
+  public ByteBuffer putInt(int position, int val) {
+    checkPut(position, 4, true);
+    directPutInt(position, val);
+    return this;
+  }
+
+  public ByteBuffer putLong(int position, long val) {
+    checkPut(position, 8, true);
+    directPutLong(position, val);
+    return this;
+  }
+
+  public ByteBuffer putShort(short val) {
+    checkPut(position, 2, false);
+    directPutShort(position, val);
+    position += 2;
+    return this;
+  }
+
+  public ByteBuffer putInt(int val) {
+    checkPut(position, 4, false);
+    directPutInt(position, val);
+    position += 4;
+    return this;
+  }
+
+  public ByteBuffer putLong(long val) {
+    checkPut(position, 8, false);
+    directPutLong(position, val);
+    position += 8;
     return this;
   }
 
@@ -0,0 +1,95 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+
+package java.nio;
+
+public class MappedByteBuffer extends DirectByteBuffer {
+  // Only the buffer returned by FileChannel.map owns the mapping and
+  // unmaps it when finalized.  Views of it refer back to that buffer to
+  // keep the mapping alive as long as they are.
+  private final MappedByteBuffer owner;
+  private final long base;
+  private final long length;
+
+  private MappedByteBuffer(long address, int capacity, boolean readOnly,
+                           MappedByteBuffer owner, long base, long length)
+  {
+    super(address, capacity, readOnly);
+    this.owner = owner;
+    this.base = base;
+    this.length = length;
+  }
+
+  // called via JNI by RandomAccessFile.map to wrap a mapping of length
+  // bytes at base, of which the caller wants capacity bytes starting at
+  // address
+  private MappedByteBuffer(long address, int capacity, boolean readOnly,
+                           long base, long length)
+  {
+    this(address, capacity, readOnly, null, base, length);
+  }
+
+  private MappedByteBuffer view(long address, int capacity,
+                                boolean readOnly)
+  {
+    return new MappedByteBuffer(address, capacity, readOnly,
+                                owner == null ? this : owner, 0, 0);
+  }
+
+  public ByteBuffer asReadOnlyBuffer() {
+    ByteBuffer b = view(address, capacity, true);
+    b.position(position());
+    b.limit(limit());
+    return b;
+  }
+
+  public ByteBuffer slice() {
+    return view(address + position, remaining(), isReadOnly());
+  }
+
+  public ByteBuffer duplicate() {
+    ByteBuffer b = view(address, capacity, isReadOnly());
+    b.limit(limit());
+    b.position(position());
+    return b;
+  }
+
+  public final MappedByteBuffer force() {
+    if (owner != null) {
+      owner.force();
+    } else if (length != 0 && ! isReadOnly()) {
+      natForce(base, length);
+    }
+    return this;
+  }
+
+  public final MappedByteBuffer load() {
+    // touch each page so it is read in now rather than on first use
+    for (int i = 0; i < capacity; i += 4096) {
+      doGet(i);
+    }
+    return this;
+  }
+
+  public final boolean isLoaded() {
+    return false;
+  }
+
+  protected void finalize() {
+    if (owner == null && length != 0) {
+      natUnmap(base, length);
+    }
+  }
+
+  private static native void natForce(long base, long length);
+
+  private static native void natUnmap(long base, long length);
+}
@@ -0,0 +1,109 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.util.concurrent.Future;
+
+// TODO: This class is both divergent from the Java standard and incomplete.
+public class AsynchronousFileChannel implements AsynchronousChannel {
+  private final RandomAccessFile file;
+  private final FileChannel channel;
+
+  private AsynchronousFileChannel(RandomAccessFile file) {
+    this.file = file;
+    this.channel = file.getChannel();
+  }
+
+  /**
+   * Opens the file with the specified mode, which is "r" or "rw" as for
+   * RandomAccessFile.
+   */
+  public static AsynchronousFileChannel open(File file, String mode)
+    throws IOException
+  {
+    return new AsynchronousFileChannel(new RandomAccessFile(file, mode));
+  }
+
+  public long size() throws IOException {
+    return channel.size();
+  }
+
+  public boolean isOpen() {
+    return channel.isOpen();
+  }
+
+  public void close() throws IOException {
+    file.close();
+  }
+
+  public <A> void read(ByteBuffer dst, long position, A attachment,
+                       CompletionHandler<Integer, ? super A> handler)
+  {
+    start(dst, false, position, attachment, handler);
+  }
+
+  public Future<Integer> read(ByteBuffer dst, long position) {
+    IoFuture<Integer> future = new IoFuture<Integer>();
+    start(dst, false, position, null, future);
+    return future;
+  }
+
+  public <A> void write(ByteBuffer src, long position, A attachment,
+                        CompletionHandler<Integer, ? super A> handler)
+  {
+    start(src, true, position, attachment, handler);
+  }
+
+  public Future<Integer> write(ByteBuffer src, long position) {
+    IoFuture<Integer> future = new IoFuture<Integer>();
+    start(src, true, position, null, future);
+    return future;
+  }
+
+  private void start(ByteBuffer buffer, final boolean write,
+                     final long position, Object attachment,
+                     CompletionHandler handler)
+  {
+    if (position < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    IoService.Request r = new IoService.Request
+      (buffer, write, handler, attachment)
+      {
+        int descriptor() {
+          return channel.descriptor();
+        }
+
+        long position() {
+          return position;
+        }
+
+        int perform(ByteBuffer buffer) throws IOException {
+          if (write) {
+            return channel.write(buffer, position);
+          } else {
+            return channel.read(buffer, position);
+          }
+        }
+      };
+
+    if (isOpen()) {
+      IoService.get().submit(r);
+    } else {
+      r.failed(new ClosedChannelException());
+    }
+  }
+}
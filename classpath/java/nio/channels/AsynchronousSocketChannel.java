@@ -0,0 +1,115 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.net.SocketAddress;
+import java.nio.ByteBuffer;
+import java.util.concurrent.Future;
+
+// TODO: This class is both divergent from the Java standard and incomplete.
+public class AsynchronousSocketChannel implements AsynchronousChannel {
+  private final SocketChannel channel;
+
+  private AsynchronousSocketChannel(SocketChannel channel) {
+    this.channel = channel;
+  }
+
+  public static AsynchronousSocketChannel open() throws IOException {
+    return new AsynchronousSocketChannel(SocketChannel.open());
+  }
+
+  public boolean isOpen() {
+    return channel.isOpen();
+  }
+
+  public void close() throws IOException {
+    channel.close();
+  }
+
+  public <A> void connect(final SocketAddress remote, final A attachment,
+                          final CompletionHandler<Void, ? super A> handler)
+  {
+    // the ring can't wait for a blocking connect, so this always runs on
+    // the pool
+    IoService.get().execute(new Runnable() {
+        public void run() {
+          try {
+            channel.connect(remote);
+          } catch (Throwable e) {
+            handler.failed(e, attachment);
+            return;
+          }
+          handler.completed(null, attachment);
+        }
+      });
+  }
+
+  public Future<Void> connect(SocketAddress remote) {
+    IoFuture<Void> future = new IoFuture<Void>();
+    connect(remote, null, future);
+    return future;
+  }
+
+  public <A> void read(ByteBuffer dst, A attachment,
+                       CompletionHandler<Integer, ? super A> handler)
+  {
+    start(dst, false, attachment, handler);
+  }
+
+  public Future<Integer> read(ByteBuffer dst) {
+    IoFuture<Integer> future = new IoFuture<Integer>();
+    start(dst, false, null, future);
+    return future;
+  }
+
+  public <A> void write(ByteBuffer src, A attachment,
+                        CompletionHandler<Integer, ? super A> handler)
+  {
+    start(src, true, attachment, handler);
+  }
+
+  public Future<Integer> write(ByteBuffer src) {
+    IoFuture<Integer> future = new IoFuture<Integer>();
+    start(src, true, null, future);
+    return future;
+  }
+
+  private void start(ByteBuffer buffer, final boolean write,
+                     Object attachment, CompletionHandler handler)
+  {
+    IoService.Request r = new IoService.Request
+      (buffer, write, handler, attachment)
+      {
+        int descriptor() {
+          return channel.connected ? channel.socketFD() : -1;
+        }
+
+        long position() {
+          return 0;
+        }
+
+        int perform(ByteBuffer buffer) throws IOException {
+          if (write) {
+            return channel.write(buffer);
+          } else {
+            return channel.read(buffer);
+          }
+        }
+      };
+
+    if (isOpen()) {
+      IoService.get().submit(r);
+    } else {
+      r.failed(new ClosedChannelException());
+    }
+  }
+}
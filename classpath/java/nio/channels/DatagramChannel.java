@@ -26,6 +26,12 @@ public class DatagramChannel extends SelectableChannel
 {
   public static final int InvalidSocket = -1;
 
+  // the most datagrams we pass to the system in one batch
+  private static final int MaxBatchLength = 64;
+
+  // returned by the batch natives where the system can't batch datagrams
+  private static final int Unsupported = -1;
+
   private int socket = makeSocket();
   private boolean blocking = true;
   private boolean connected = false;
@@ -172,6 +178,139 @@ public class DatagramChannel extends SelectableChannel
     return c;    
   }
 
+  /**
+   * Receives up to length datagrams, one into each of the buffers
+   * starting at dsts[offset], with a single system call where the
+   * platform allows.  Each buffer's position advances past the datagram
+   * it received, and, if sources is not null, the corresponding element
+   * is set to the datagram's sender.  A blocking channel waits for the
+   * first datagram only.  Returns the number of datagrams received.
+   */
+  public int receive(ByteBuffer[] dsts, SocketAddress[] sources, int offset,
+                     int length)
+    throws IOException
+  {
+    if (offset < 0 || length < 0 || offset > dsts.length - length
+        || (sources != null && offset > sources.length - length))
+    {
+      throw new IndexOutOfBoundsException();
+    }
+    if (length == 0) return 0;
+
+    int count = Math.min(length, MaxBatchLength);
+    byte[][] arrays = new byte[count][];
+    int[] starts = new int[count];
+    int[] lengths = new int[count];
+    SocketChannel.describe(dsts, offset, count, arrays, starts, lengths);
+
+    int[] sizes = new int[count];
+    int[] addresses = new int[count * 2];
+    int n = natReceiveBatch
+      (socket, dsts, offset, arrays, starts, lengths, count, blocking, sizes,
+       addresses);
+
+    if (n == Unsupported) {
+      n = 0;
+      while (n < count) {
+        SocketAddress source = receive(dsts[offset + n]);
+        if (source == null) break;
+
+        if (sources != null) sources[offset + n] = source;
+        ++n;
+
+        // another receive would wait for the next datagram
+        if (blocking) break;
+      }
+      return n;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      ByteBuffer b = dsts[offset + i];
+      b.position(b.position() + sizes[i]);
+      if (sources != null) {
+        sources[offset + i] = new InetSocketAddress
+          (ipv4ToString(addresses[i * 2]), addresses[(i * 2) + 1]);
+      }
+    }
+    return n;
+  }
+
+  /**
+   * Sends each of the buffers starting at srcs[offset] as a datagram,
+   * batching them into as few system calls as the platform allows.  If
+   * targets is null the channel must be connected; otherwise each
+   * datagram goes to the corresponding element of targets.  Returns the
+   * number of datagrams sent, which may be fewer than length if the
+   * channel is non-blocking.
+   */
+  public int send(ByteBuffer[] srcs, SocketAddress[] targets, int offset,
+                  int length)
+    throws IOException
+  {
+    if (offset < 0 || length < 0 || offset > srcs.length - length
+        || (targets != null && offset > targets.length - length))
+    {
+      throw new IndexOutOfBoundsException();
+    }
+
+    int total = 0;
+    while (length > 0) {
+      int count = Math.min(length, MaxBatchLength);
+      byte[][] arrays = new byte[count][];
+      int[] starts = new int[count];
+      int[] lengths = new int[count];
+      SocketChannel.describe(srcs, offset, count, arrays, starts, lengths);
+
+      int[] addresses = null;
+      if (targets != null) {
+        addresses = new int[count * 2];
+        for (int i = 0; i < count; ++i) {
+          InetSocketAddress inetAddress;
+          try {
+            inetAddress = (InetSocketAddress) targets[offset + i];
+          } catch (ClassCastException e) {
+            throw new UnsupportedAddressTypeException();
+          }
+          addresses[i * 2] = inetAddress.getAddress().getRawAddress();
+          addresses[(i * 2) + 1] = inetAddress.getPort();
+        }
+      }
+
+      int n = natSendBatch
+        (socket, srcs, offset, arrays, starts, lengths, count, blocking,
+         addresses);
+
+      if (n == Unsupported) {
+        n = 0;
+        while (n < count) {
+          ByteBuffer b = srcs[offset + n];
+          if (b.hasRemaining()) {
+            if (targets == null) {
+              write(b);
+            } else {
+              send(b, targets[offset + n]);
+            }
+            if (b.hasRemaining()) break;
+          }
+          ++n;
+        }
+      } else {
+        for (int i = 0; i < n; ++i) {
+          ByteBuffer b = srcs[offset + i];
+          b.position(b.limit());
+        }
+      }
+
+      total += n;
+      if (n < count) {
+        break;
+      }
+      offset += count;
+      length -= count;
+    }
+    return total;
+  }
+
   private static String ipv4ToString(int address) {
     StringBuilder sb = new StringBuilder();
 
@@ -235,5 +374,17 @@ public class DatagramChannel extends SelectableChannel
                                     int length, boolean blocking,
                                     int[] address)
     throws IOException;
+  private static native int natReceiveBatch(int socket, ByteBuffer[] buffers,
+                                            int offset, byte[][] arrays,
+                                            int[] starts, int[] lengths,
+                                            int count, boolean blocking,
+                                            int[] sizes, int[] addresses)
+    throws IOException;
+  private static native int natSendBatch(int socket, ByteBuffer[] buffers,
+                                         int offset, byte[][] arrays,
+                                         int[] starts, int[] lengths,
+                                         int count, boolean blocking,
+                                         int[] addresses)
+    throws IOException;
   private static native void close(int socket);
 }
@@ -12,6 +12,7 @@ package java.nio.channels;
 
 import java.io.IOException;
 import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
 
 public abstract class FileChannel implements Channel {
 
@@ -32,4 +33,143 @@ public abstract class FileChannel implements Channel {
   public abstract FileChannel position(long position) throws IOException;
 
   public abstract long size() throws IOException;
+
+  public abstract MappedByteBuffer map(MapMode mode, long position, long size)
+    throws IOException;
+
+  private static final int TransferBufferSize = 64 * 1024;
+
+  private static final long Unsupported = -1;
+
+  /**
+   * Returns the file descriptor backing this channel, or -1 if it has
+   * none, in which case transfers are always done by copying through a
+   * buffer.
+   */
+  protected int descriptor() {
+    return -1;
+  }
+
+  public long transferTo(long position, long count,
+                         WritableByteChannel target)
+    throws IOException
+  {
+    if (position < 0 || count < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    long size = size();
+    if (position >= size) {
+      return 0;
+    }
+    if (count > size - position) {
+      count = size - position;
+    }
+
+    int fd = descriptor();
+    if (fd >= 0) {
+      long r = Unsupported;
+      if (target instanceof SocketChannel) {
+        r = natTransferToSocket
+          (fd, position, count, ((SocketChannel) target).socketFD());
+      } else if (target instanceof FileChannel) {
+        FileChannel file = (FileChannel) target;
+        int targetFd = file.descriptor();
+        if (targetFd >= 0) {
+          long targetPosition = file.position();
+          r = natCopyRange(fd, position, targetFd, targetPosition, count);
+          if (r > 0) {
+            file.position(targetPosition + r);
+          }
+        }
+      }
+
+      if (r != Unsupported) {
+        return r;
+      }
+    }
+
+    ByteBuffer b = ByteBuffer.allocate
+      ((int) Math.min(count, TransferBufferSize));
+    long n = 0;
+    while (n < count) {
+      b.clear();
+      b.limit((int) Math.min(b.capacity(), count - n));
+      int r = read(b, position + n);
+      if (r <= 0) {
+        break;
+      }
+
+      b.flip();
+      while (b.hasRemaining()) {
+        if (target.write(b) <= 0) {
+          // a non-blocking target is full
+          return n + r - b.remaining();
+        }
+      }
+      n += r;
+    }
+    return n;
+  }
+
+  public long transferFrom(ReadableByteChannel src, long position,
+                           long count)
+    throws IOException
+  {
+    if (position < 0 || count < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    if (position > size()) {
+      return 0;
+    }
+
+    if (src instanceof FileChannel) {
+      FileChannel file = (FileChannel) src;
+      long srcPosition = file.position();
+      long available = Math.max(0, file.size() - srcPosition);
+      int fd = descriptor();
+      int srcFd = file.descriptor();
+      if (fd >= 0 && srcFd >= 0) {
+        long r = natCopyRange
+          (srcFd, srcPosition, fd, position, Math.min(count, available));
+        if (r != Unsupported) {
+          if (r > 0) {
+            file.position(srcPosition + r);
+          }
+          return r;
+        }
+      }
+    }
+
+    ByteBuffer b = ByteBuffer.allocate
+      ((int) Math.min(count, TransferBufferSize));
+    long n = 0;
+    while (n < count) {
+      b.clear();
+      b.limit((int) Math.min(b.capacity(), count - n));
+      int r = src.read(b);
+      if (r <= 0) {
+        break;
+      }
+
+      b.flip();
+      while (b.hasRemaining()) {
+        write(b, position + n + r - b.remaining());
+      }
+      n += r;
+    }
+    return n;
+  }
+
+  // Each of these returns the number of bytes transferred, or
+  // Unsupported if the platform can't transfer between these
+  // descriptors directly.
+  private static native long natTransferToSocket(int fd, long position,
+                                                 long count, int socket)
+    throws IOException;
+
+  private static native long natCopyRange(int in, long inPosition, int out,
+                                          long outPosition, long count)
+    throws IOException;
 }
@@ -0,0 +1,78 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.Future;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+
+// The result of an asynchronous operation started without a
+// CompletionHandler, which the operation completes as if it were one.
+class IoFuture<V> implements Future<V>, CompletionHandler<V, Object> {
+  private boolean done;
+  private V result;
+  private Throwable exception;
+
+  public synchronized void completed(V result, Object attachment) {
+    this.result = result;
+    done = true;
+    notifyAll();
+  }
+
+  public synchronized void failed(Throwable exception, Object attachment) {
+    this.exception = exception;
+    done = true;
+    notifyAll();
+  }
+
+  public boolean cancel(boolean mayInterruptIfRunning) {
+    return false;
+  }
+
+  public boolean isCancelled() {
+    return false;
+  }
+
+  public synchronized boolean isDone() {
+    return done;
+  }
+
+  public synchronized V get()
+    throws InterruptedException, ExecutionException
+  {
+    while (! done) {
+      wait();
+    }
+    return result();
+  }
+
+  public synchronized V get(long timeout, TimeUnit unit)
+    throws InterruptedException, ExecutionException, TimeoutException
+  {
+    long deadline = System.currentTimeMillis() + unit.toMillis(timeout);
+    while (! done) {
+      long remaining = deadline - System.currentTimeMillis();
+      if (remaining <= 0) {
+        throw new TimeoutException();
+      }
+      wait(remaining);
+    }
+    return result();
+  }
+
+  private V result() throws ExecutionException {
+    if (exception != null) {
+      throw new ExecutionException(exception);
+    }
+    return result;
+  }
+}
@@ -0,0 +1,298 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.util.HashMap;
+import java.util.LinkedList;
+import java.util.Map;
+
+// Runs the operations of the asynchronous channels.  On Linux these are
+// submitted to an io_uring, whose completions a single thread reaps and
+// dispatches to their handlers.  Operations the ring can't take, and
+// every operation elsewhere, run synchronously on a pool of threads
+// which grows as operations block and shrinks when they sit idle.
+final class IoService {
+  // the size of the submission queue; the kernel queues completions
+  // beyond what the completion queue holds, so this doesn't limit the
+  // number of operations in flight
+  private static final int RingSize = 256;
+
+  // the most completions the completion thread reaps at once
+  private static final int BatchSize = 64;
+
+  // how long a pool thread waits for work before exiting
+  private static final long IdleTimeout = 30 * 1000;
+
+  private static IoService instance;
+
+  private final long ring;
+  private final Map<Long, Request> pending = new HashMap<Long, Request>();
+  private final LinkedList<Runnable> tasks = new LinkedList<Runnable>();
+  private long nextId;
+  private int idle;
+  private boolean broken;
+
+  private IoService() {
+    ring = natOpen(RingSize);
+    if (ring != 0) {
+      Thread thread = new Thread("io completions") {
+          public void run() {
+            reap();
+          }
+        };
+      thread.setDaemon(true);
+      thread.start();
+    }
+  }
+
+  static synchronized IoService get() {
+    if (instance == null) {
+      instance = new IoService();
+    }
+    return instance;
+  }
+
+  // An asynchronous read or write of the remaining bytes of a buffer.
+  abstract static class Request implements Runnable {
+    private final ByteBuffer buffer;
+    private final boolean write;
+    private final CompletionHandler handler;
+    private final Object attachment;
+    private ByteBuffer staging;
+
+    Request(ByteBuffer buffer, boolean write, CompletionHandler handler,
+            Object attachment)
+    {
+      if ((! write) && buffer.isReadOnly()) {
+        throw new IllegalArgumentException();
+      }
+
+      this.buffer = buffer;
+      this.write = write;
+      this.handler = handler;
+      this.attachment = attachment;
+    }
+
+    // the descriptor to submit the operation against, or -1 if it must
+    // run on the pool
+    abstract int descriptor();
+
+    // the file position the operation starts at, ignored for sockets
+    abstract long position();
+
+    // performs the operation synchronously on a heap buffer
+    abstract int perform(ByteBuffer buffer) throws IOException;
+
+    public void run() {
+      int n;
+      try {
+        if (buffer.hasArray()) {
+          n = perform(buffer);
+        } else {
+          ByteBuffer b = ByteBuffer.allocate(buffer.remaining());
+          if (write) {
+            b.put(buffer.duplicate());
+            b.flip();
+          }
+          n = perform(b);
+          if (n > 0) {
+            if (write) {
+              buffer.position(buffer.position() + n);
+            } else {
+              b.flip();
+              buffer.put(b);
+            }
+          }
+        }
+      } catch (Throwable e) {
+        failed(e);
+        return;
+      }
+      completed(n);
+    }
+
+    private void complete(int result) {
+      if (result < 0) {
+        failed(new IOException(natErrorMessage(-result)));
+        return;
+      }
+
+      if (result > 0) {
+        if (write || staging == buffer) {
+          buffer.position(buffer.position() + result);
+        } else {
+          staging.limit(result);
+          buffer.put(staging);
+        }
+      }
+      completed(result);
+    }
+
+    private void completed(int result) {
+      if (result <= 0 && (! write) && buffer.hasRemaining()) {
+        // end of file or stream
+        result = -1;
+      }
+
+      try {
+        handler.completed(Integer.valueOf(result), attachment);
+      } catch (Throwable e) {
+        failed(e);
+      }
+    }
+
+    void failed(Throwable exception) {
+      try {
+        handler.failed(exception, attachment);
+      } catch (Throwable e) {
+        // the thread must go on serving other requests, so the handler
+        // for uncaught exceptions gets this rather than the thread
+        Thread thread = Thread.currentThread();
+        thread.getUncaughtExceptionHandler().uncaughtException(thread, e);
+      }
+    }
+  }
+
+  void submit(Request r) {
+    if (r.buffer.remaining() == 0) {
+      r.completed(0);
+      return;
+    }
+
+    int descriptor = r.descriptor();
+    if (ring == 0 || descriptor < 0) {
+      execute(r);
+      return;
+    }
+
+    // the kernel needs an address which won't move for the duration of
+    // the operation, which heap arrays can't promise
+    if (r.buffer.hasArray()) {
+      r.staging = ByteBuffer.allocateDirect(r.buffer.remaining());
+      if (r.write) {
+        r.staging.put(r.buffer.duplicate());
+        r.staging.flip();
+      }
+    } else {
+      r.staging = r.buffer;
+    }
+
+    synchronized (this) {
+      if (broken) {
+        execute(r);
+        return;
+      }
+
+      long id = ++ nextId;
+      pending.put(id, r);
+      if (natSubmit(ring, r.write, descriptor, r.staging,
+                    r.staging.position(), r.staging.remaining(),
+                    r.position(), id))
+      {
+        return;
+      }
+      pending.remove(id);
+    }
+
+    // the ring is unavailable for now, so we do it the slow way
+    r.staging = null;
+    execute(r);
+  }
+
+  synchronized void execute(Runnable task) {
+    tasks.add(task);
+    if (idle >= tasks.size()) {
+      notify();
+    } else {
+      Thread thread = new Thread("io worker") {
+          public void run() {
+            work();
+          }
+        };
+      thread.setDaemon(true);
+      thread.start();
+    }
+  }
+
+  private synchronized Runnable nextTask() {
+    long deadline = System.currentTimeMillis() + IdleTimeout;
+    ++ idle;
+    try {
+      while (tasks.isEmpty()) {
+        long remaining = deadline - System.currentTimeMillis();
+        if (remaining <= 0) {
+          return null;
+        }
+        wait(remaining);
+      }
+      return tasks.removeFirst();
+    } catch (InterruptedException e) {
+      return null;
+    } finally {
+      -- idle;
+    }
+  }
+
+  private void work() {
+    Runnable task;
+    while ((task = nextTask()) != null) {
+      task.run();
+    }
+  }
+
+  private void reap() {
+    long[] ids = new long[BatchSize];
+    int[] results = new int[BatchSize];
+    Request[] requests = new Request[BatchSize];
+    while (true) {
+      int count;
+      try {
+        count = natWait(ring, ids, results);
+      } catch (IOException e) {
+        // nothing more will complete, so fail whatever is in flight
+        synchronized (this) {
+          broken = true;
+          requests = pending.values().toArray(new Request[pending.size()]);
+          pending.clear();
+        }
+        for (int i = 0; i < requests.length; ++i) {
+          requests[i].failed(e);
+        }
+        return;
+      }
+
+      synchronized (this) {
+        for (int i = 0; i < count; ++i) {
+          requests[i] = pending.remove(ids[i]);
+        }
+      }
+
+      for (int i = 0; i < count; ++i) {
+        requests[i].complete(results[i]);
+        requests[i] = null;
+      }
+    }
+  }
+
+  private static native long natOpen(int entries);
+
+  private static native boolean natSubmit(long ring, boolean write,
+                                          int descriptor, ByteBuffer buffer,
+                                          int offset, int length,
+                                          long position, long id);
+
+  private static native int natWait(long ring, long[] ids, int[] results)
+    throws IOException;
+
+  private static native String natErrorMessage(int error);
+}
@@ -0,0 +1,21 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+
+package java.nio.channels;
+
+import java.io.IOException;
+import java.nio.ByteBuffer;
+
+public interface ScatteringByteChannel extends ReadableByteChannel {
+  public long read(ByteBuffer[] dsts) throws IOException;
+  public long read(ByteBuffer[] dsts, int offset, int length)
+    throws IOException;
+}
@@ -16,6 +16,10 @@ import java.net.InetSocketAddress;
 import java.net.SocketAddress;
 import java.net.ServerSocket;
 import java.net.Socket;
+import java.net.SocketOption;
+import java.net.StandardSocketOptions;
+
+import avian.VirtualThread;
 
 public class ServerSocketChannel extends SelectableChannel {
   private final SocketChannel channel;
@@ -42,13 +46,44 @@ public class ServerSocketChannel extends SelectableChannel {
     return channel.configureBlocking(v);
   }
 
+  public boolean isOpen() {
+    return channel.isOpen();
+  }
+
   public void close() throws IOException {
     channel.close();
   }
 
+  /**
+   * Sets the value of a socket option.  Only
+   * StandardSocketOptions.SO_REUSEPORT is supported, and only where the
+   * system has it; it lets each of several acceptor threads bind a
+   * channel of its own to the same address, with the system spreading
+   * incoming connections among them, rather than all contending for
+   * one listen queue.  It must be set before binding.
+   */
+  public <T> ServerSocketChannel setOption(SocketOption<T> name, T value)
+    throws IOException
+  {
+    if (name == StandardSocketOptions.SO_REUSEPORT) {
+      natSetReusePort(channel.socket, (Boolean) value);
+    } else {
+      throw new UnsupportedOperationException(name.name());
+    }
+    return this;
+  }
+
   public SocketChannel accept() throws IOException {
-    SocketChannel c = new SocketChannel();
-    c.socket = doAccept();
+    // a connection accepted by a virtual thread is most likely served by
+    // one, which wants its socket not to block, so the new socket comes
+    // in the listener's present mode
+    boolean park = channel.parksVirtualThread();
+    int s = doAccept(park);
+    if (s == -1) {
+      return null;
+    }
+
+    SocketChannel c = new SocketChannel(s, ! park);
     c.connected = true;
     return c;
   }
@@ -57,12 +92,20 @@ public class ServerSocketChannel extends SelectableChannel {
     return new Handle();
   }
 
-  private int doAccept() throws IOException {
+  private int doAccept(boolean park) throws IOException {
     while (true) {
-      int s = natDoAccept(channel.socket);
+      int s = natDoAccept(channel.socket, ! park);
       if (s != -1) {
         return s;
       }
+      if (park) {
+        VirtualThread.awaitReady(this, SelectionKey.OP_ACCEPT);
+        if (! channel.isOpen()) {
+          throw new ClosedChannelException();
+        }
+      } else if (! channel.blocking) {
+        return -1;
+      }
       // todo: throw ClosedByInterruptException if this thread was
       // interrupted during the accept call
     }
@@ -88,6 +131,9 @@ public class ServerSocketChannel extends SelectableChannel {
     }
   }
 
-  private static native int natDoAccept(int socket) throws IOException;
+  private static native int natDoAccept(int socket, boolean blocking)
+    throws IOException;
+  private static native void natSetReusePort(int socket, boolean on)
+    throws IOException;
   private static native void natDoListen(int socket, int host, int port) throws IOException;
 }
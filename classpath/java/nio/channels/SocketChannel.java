@@ -16,16 +16,35 @@ import java.net.SocketAddress;
 import java.net.InetSocketAddress;
 import java.net.Socket;
 import java.nio.ByteBuffer;
+import avian.VirtualThread;
 
 public class SocketChannel extends SelectableChannel
-  implements ReadableByteChannel, GatheringByteChannel
+  implements ScatteringByteChannel, GatheringByteChannel
 {
   public static final int InvalidSocket = -1;
 
-  int socket = makeSocket();
+  // the most buffers we pass to the system in one scattering read or
+  // gathering write
+  private static final int MaxVectorLength = 16;
+
+  int socket;
   boolean connected = false;
   boolean readyToConnect = false;
   boolean blocking = true;
+  // whether the socket itself blocks, which it doesn't while a
+  // virtual thread waits for it in the poller instead
+  boolean nativeBlocking;
+
+  public SocketChannel() {
+    this(makeSocket(), true);
+  }
+
+  // adopts a socket, e.g. one just accepted, which is already in the
+  // specified native mode
+  SocketChannel(int socket, boolean nativeBlocking) {
+    this.socket = socket;
+    this.nativeBlocking = nativeBlocking;
+  }
 
   public static SocketChannel open() throws IOException {
     Socket.init();
@@ -35,12 +54,25 @@ public class SocketChannel extends SelectableChannel
 
   public SelectableChannel configureBlocking(boolean v) throws IOException {
     blocking = v;
-    if (socket != InvalidSocket) {
+    if (socket != InvalidSocket && nativeBlocking != v) {
       configureBlocking(socket, v);
+      nativeBlocking = v;
     }
     return this;
   }
 
+  // Returns whether a blocking operation should park the current
+  // virtual thread until the socket is ready, rather than block in the
+  // system, switching the socket to the matching mode.
+  boolean parksVirtualThread() throws IOException {
+    boolean park = blocking && VirtualThread.current() != null;
+    if (nativeBlocking == park && socket != InvalidSocket) {
+      configureBlocking(socket, ! park);
+      nativeBlocking = ! park;
+    }
+    return park;
+  }
+
   public boolean isBlocking() {
     return blocking;
   }
@@ -64,14 +96,24 @@ public class SocketChannel extends SelectableChannel
     } catch (ClassCastException e) {
       throw new UnsupportedAddressTypeException();
     }
+    boolean park = parksVirtualThread();
     doConnect(socket, a.getAddress().getRawAddress(), a.getPort());
-    configureBlocking(blocking);
+    if (park) {
+      finishConnect();
+    } else {
+      configureBlocking(blocking);
+    }
     return connected;
   }
 
   public boolean finishConnect() throws IOException {
     if (! connected) {
       while (! readyToConnect) {
+        if (blocking && VirtualThread.current() != null) {
+          awaitReady(SelectionKey.OP_CONNECT);
+          continue;
+        }
+
         Selector selector = Selector.open();
         SelectionKey key = register(selector, SelectionKey.OP_CONNECT, null);
 
@@ -111,7 +153,14 @@ public class SocketChannel extends SelectableChannel
     byte[] array = b.array();
     if (array == null) throw new NullPointerException();
 
-    int r = natRead(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+    int r;
+    if (parksVirtualThread()) {
+      while ((r = natRead(socket, array, b.arrayOffset() + b.position(), b.remaining(), false)) == 0) {
+        awaitReady(SelectionKey.OP_READ);
+      }
+    } else {
+      r = natRead(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+    }
     if (r > 0) {
       b.position(b.position() + r);
     }
@@ -127,7 +176,14 @@ public class SocketChannel extends SelectableChannel
     byte[] array = b.array();
     if (array == null) throw new NullPointerException();
 
-    int w = natWrite(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+    int w;
+    if (parksVirtualThread()) {
+      while ((w = natWrite(socket, array, b.arrayOffset() + b.position(), b.remaining(), false)) == 0) {
+        awaitReady(SelectionKey.OP_WRITE);
+      }
+    } else {
+      w = natWrite(socket, array, b.arrayOffset() + b.position(), b.remaining(), blocking);
+    }
     if (w > 0) {
       b.position(b.position() + w);
     }
@@ -141,16 +197,134 @@ public class SocketChannel extends SelectableChannel
   public long write(ByteBuffer[] srcs, int offset, int length)
     throws IOException
   {
+    if (! connected) {
+      natThrowWriteError(socket);
+    }
+    if (offset < 0 || length < 0 || offset > srcs.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+
+    boolean park = parksVirtualThread();
     long total = 0;
-    for (int i = offset; i < offset + length; ++i) {
-      total += write(srcs[i]);
-      if (srcs[i].hasRemaining()) {
-        return total;
+    while (length > 0) {
+      int count = Math.min(length, MaxVectorLength);
+      byte[][] arrays = new byte[count][];
+      int[] starts = new int[count];
+      int[] lengths = new int[count];
+      long size = describe(srcs, offset, count, arrays, starts, lengths);
+
+      long w;
+      if (park) {
+        while ((w = natWriteVector
+                (socket, srcs, offset, arrays, starts, lengths, count, false))
+               == 0 && size > 0)
+        {
+          awaitReady(SelectionKey.OP_WRITE);
+        }
+      } else {
+        w = natWriteVector
+          (socket, srcs, offset, arrays, starts, lengths, count, blocking);
       }
+      if (w <= 0) {
+        break;
+      }
+      advance(srcs, offset, w);
+      total += w;
+
+      if (w < size) {
+        // the socket is full
+        if (park) {
+          // keep going with what's left of this batch
+          continue;
+        }
+        break;
+      }
+      offset += count;
+      length -= count;
     }
     return total;
   }
 
+  public long read(ByteBuffer[] dsts) throws IOException {
+    return read(dsts, 0, dsts.length);
+  }
+
+  public long read(ByteBuffer[] dsts, int offset, int length)
+    throws IOException
+  {
+    if (offset < 0 || length < 0 || offset > dsts.length - length) {
+      throw new IndexOutOfBoundsException();
+    }
+    if (! isOpen()) return -1;
+
+    int count = Math.min(length, MaxVectorLength);
+    for (int i = offset; i < offset + count; ++i) {
+      if (dsts[i].isReadOnly()) throw new IllegalArgumentException();
+    }
+
+    byte[][] arrays = new byte[count][];
+    int[] starts = new int[count];
+    int[] lengths = new int[count];
+    if (describe(dsts, offset, count, arrays, starts, lengths) == 0) {
+      return 0;
+    }
+
+    long r;
+    if (parksVirtualThread()) {
+      while ((r = natReadVector
+              (socket, dsts, offset, arrays, starts, lengths, count, false))
+             == 0)
+      {
+        awaitReady(SelectionKey.OP_READ);
+      }
+    } else {
+      r = natReadVector
+        (socket, dsts, offset, arrays, starts, lengths, count, blocking);
+    }
+    if (r > 0) {
+      advance(dsts, offset, r);
+    }
+    return r;
+  }
+
+  // Fills in, for each of count buffers, the array backing it (or null
+  // for a direct buffer) and the offset and length of its remaining
+  // bytes in that array (or in the direct buffer), returning the total
+  // length.
+  static long describe(ByteBuffer[] buffers, int offset, int count,
+                       byte[][] arrays, int[] starts, int[] lengths)
+  {
+    long size = 0;
+    for (int i = 0; i < count; ++i) {
+      ByteBuffer b = buffers[offset + i];
+      if (b.hasArray()) {
+        arrays[i] = b.array();
+        starts[i] = b.arrayOffset() + b.position();
+      } else {
+        starts[i] = b.position();
+      }
+      lengths[i] = b.remaining();
+      size += lengths[i];
+    }
+    return size;
+  }
+
+  private static void advance(ByteBuffer[] buffers, int offset, long count) {
+    for (int i = offset; count > 0; ++i) {
+      ByteBuffer b = buffers[i];
+      int n = (int) Math.min(count, b.remaining());
+      b.position(b.position() + n);
+      count -= n;
+    }
+  }
+
+  private void awaitReady(int operations) throws IOException {
+    VirtualThread.awaitReady(this, operations);
+    if (! isOpen()) {
+      throw new ClosedChannelException();
+    }
+  }
+
   private void closeSocket() {
     natCloseSocket(socket);
   }
@@ -209,6 +383,16 @@ public class SocketChannel extends SelectableChannel
     throws IOException;
   private static native int natWrite(int socket, byte[] buffer, int offset, int length, boolean blocking)
     throws IOException;
+  private static native long natReadVector(int socket, ByteBuffer[] buffers,
+                                           int offset, byte[][] arrays,
+                                           int[] starts, int[] lengths,
+                                           int count, boolean blocking)
+    throws IOException;
+  private static native long natWriteVector(int socket, ByteBuffer[] buffers,
+                                            int offset, byte[][] arrays,
+                                            int[] starts, int[] lengths,
+                                            int count, boolean blocking)
+    throws IOException;
   private static native void natThrowWriteError(int socket) throws IOException;
   private static native void natCloseSocket(int socket);
 }
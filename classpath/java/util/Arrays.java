@@ -11,6 +11,8 @@
 package java.util;
 
 import java.lang.reflect.Array;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.RecursiveAction;
 
 public class Arrays {
   private Arrays() { }
@@ -143,7 +145,11 @@ public class Arrays {
   }
 
   public static void sort(Object[] array) {
-    sort(array, new Comparator() {
+    sort(array, 0, array.length);
+  }
+
+  public static void sort(Object[] array, int begin, int end) {
+    sort(array, begin, end, new Comparator() {
         @Override
         public int compare(Object a, Object b) {
           return ((Comparable) a).compareTo(b);
@@ -151,108 +157,238 @@ public class Arrays {
       });
   }
 
-  private final static int SORT_SIZE_THRESHOLD = 16;
-
   public static <T> void sort(T[] array, Comparator<? super T> comparator) {
-    introSort(array, comparator, 0, array.length, array.length);
-    insertionSort(array, comparator);
+    sort(array, 0, array.length, comparator);
   }
 
-  private static <T > void introSort(T[] array,
-    Comparator<? super T> comparator, int begin, int end, int limit)
+  public static <T> void sort(T[] array, int begin, int end,
+                              Comparator<? super T> comparator)
   {
-    while (end - begin > SORT_SIZE_THRESHOLD) {
-      if (limit == 0) {
-        heapSort(array, comparator, begin, end);
+    checkRange(array.length, begin, end);
+    TimSort.sort(array, comparator, begin, end);
+  }
+
+  public static void sort(int[] array) {
+    DualPivotQuicksort.sort(array, 0, array.length);
+  }
+
+  public static void sort(int[] array, int begin, int end) {
+    checkRange(array.length, begin, end);
+    DualPivotQuicksort.sort(array, begin, end);
+  }
+
+  public static void sort(long[] array) {
+    DualPivotQuicksort.sort(array, 0, array.length);
+  }
+
+  public static void sort(long[] array, int begin, int end) {
+    checkRange(array.length, begin, end);
+    DualPivotQuicksort.sort(array, begin, end);
+  }
+
+  // Parallel sorts split the array into chunks, sort those
+  // sequentially, and merge them back together pairwise through a
+  // buffer, forking each half of the work on the common pool.  Arrays
+  // smaller than this aren't worth splitting up.
+  private final static int PARALLEL_SORT_THRESHOLD = 1 << 13;
+
+  // returns the chunk size for a parallel sort of the specified number
+  // of elements, or zero if it should be done sequentially
+  private static int parallelGranularity(int length) {
+    int parallelism = ForkJoinPool.getCommonPoolParallelism();
+    if (length <= PARALLEL_SORT_THRESHOLD || parallelism == 1) {
+      return 0;
+    } else {
+      return Math.max(PARALLEL_SORT_THRESHOLD, length / (parallelism << 2));
+    }
+  }
+
+  public static void parallelSort(Object[] array) {
+    parallelSort(array, new Comparator() {
+        @Override
+        public int compare(Object a, Object b) {
+          return ((Comparable) a).compareTo(b);
+        }
+      });
+  }
+
+  public static <T> void parallelSort(T[] array,
+                                      Comparator<? super T> comparator)
+  {
+    int granularity = parallelGranularity(array.length);
+    if (granularity == 0) {
+      sort(array, comparator);
+    } else {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelSort<T>
+         (array, new Object[array.length], comparator, 0, array.length,
+          granularity));
+    }
+  }
+
+  public static void parallelSort(int[] array) {
+    int granularity = parallelGranularity(array.length);
+    if (granularity == 0) {
+      sort(array);
+    } else {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelIntSort
+         (array, new int[array.length], 0, array.length, granularity));
+    }
+  }
+
+  public static void parallelSort(long[] array) {
+    int granularity = parallelGranularity(array.length);
+    if (granularity == 0) {
+      sort(array);
+    } else {
+      ForkJoinPool.commonPool().invoke
+        (new ParallelLongSort
+         (array, new long[array.length], 0, array.length, granularity));
+    }
+  }
+
+  // sorts the halves of a range in parallel and merges them, using the
+  // corresponding range of the buffer for the left half while merging
+  private static class ParallelSort<T> extends RecursiveAction {
+    private final T[] array;
+    private final Object[] buffer;
+    private final Comparator<? super T> comparator;
+    private final int begin;
+    private final int end;
+    private final int granularity;
+
+    public ParallelSort(T[] array, Object[] buffer,
+                        Comparator<? super T> comparator, int begin, int end,
+                        int granularity)
+    {
+      this.array = array;
+      this.buffer = buffer;
+      this.comparator = comparator;
+      this.begin = begin;
+      this.end = end;
+      this.granularity = granularity;
+    }
+
+    protected void compute() {
+      if (end - begin <= granularity) {
+        TimSort.sort(array, comparator, begin, end);
         return;
       }
-      limit >>= 1;
 
-      // median of three
-      T a = array[begin];
-      T b = array[begin + (end - begin) / 2 + 1];
-      T c = array[end - 1];
-      T median;
-      if (comparator.compare(a, b) < 0) {
-        median = comparator.compare(b, c) < 0 ?
-          b : (comparator.compare(a, c) < 0 ? c : a);
-      } else {
-        median = comparator.compare(b, c) > 0 ?
-          b : (comparator.compare(a, c) > 0 ? c : a);
+      int middle = (begin + end) >>> 1;
+      invokeAll
+        (new ParallelSort<T>
+         (array, buffer, comparator, begin, middle, granularity),
+         new ParallelSort<T>
+         (array, buffer, comparator, middle, end, granularity));
+
+      if (comparator.compare(array[middle - 1], array[middle]) <= 0) {
+        return;
       }
 
-      // partition
-      int pivot, i = begin, j = end;
-      for (;;) {
-        while (comparator.compare(array[i], median) < 0) {
-          ++i;
-        }
-        --j;
-        while (comparator.compare(median, array[j]) < 0) {
-          --j;
+      // ties go to the left half, which keeps the sort stable
+      System.arraycopy(array, begin, buffer, begin, middle - begin);
+      int i = begin;
+      int j = middle;
+      int k = begin;
+      while (i < middle && j < end) {
+        if (comparator.compare(array[j], (T) buffer[i]) < 0) {
+          array[k++] = array[j++];
+        } else {
+          array[k++] = (T) buffer[i++];
         }
-        if (i >= j) {
-          pivot = i;
-          break;
-        }
-        T swap = array[i];
-        array[i] = array[j];
-        array[j] = swap;
-        ++i;
       }
-
-      introSort(array, comparator, pivot, end, limit);
-      end = pivot;
+      System.arraycopy(buffer, i, array, k, middle - i);
+      for (int n = begin; n < middle; ++n) {
+        buffer[n] = null;
+      }
     }
   }
 
-  private static <T> void heapSort(T[] array, Comparator<? super T> comparator,
-    int begin, int end)
-  {
-    int count = end - begin;
-    for (int i = count / 2 - 1; i >= 0; --i) {
-      siftDown(array, comparator, i, count, begin);
-    }
-    for (int i = count - 1; i > 0; --i) {
-      // swap begin and begin + i
-      T swap = array[begin + i];
-      array[begin + i] = array[begin];
-      array[begin] = swap;
+  private static class ParallelIntSort extends RecursiveAction {
+    private final int[] array;
+    private final int[] buffer;
+    private final int begin;
+    private final int end;
+    private final int granularity;
 
-      siftDown(array, comparator, 0, i, begin);
+    public ParallelIntSort(int[] array, int[] buffer, int begin, int end,
+                           int granularity)
+    {
+      this.array = array;
+      this.buffer = buffer;
+      this.begin = begin;
+      this.end = end;
+      this.granularity = granularity;
     }
-  }
 
-  private static <T> void siftDown(T[] array, Comparator<? super T> comparator,
-    int i, int count, int offset)
-  {
-    T value = array[offset + i];
-    while (i < count / 2) {
-      int child = 2 * i + 1;
-      if (child + 1 < count &&
-          comparator.compare(array[child], array[child + 1]) < 0) {
-        ++child;
+    protected void compute() {
+      if (end - begin <= granularity) {
+        DualPivotQuicksort.sort(array, begin, end);
+        return;
+      }
+
+      int middle = (begin + end) >>> 1;
+      invokeAll
+        (new ParallelIntSort(array, buffer, begin, middle, granularity),
+         new ParallelIntSort(array, buffer, middle, end, granularity));
+
+      if (array[middle - 1] <= array[middle]) {
+        return;
       }
-      if (comparator.compare(value, array[child]) >= 0) {
-        break;
+
+      System.arraycopy(array, begin, buffer, begin, middle - begin);
+      int i = begin;
+      int j = middle;
+      int k = begin;
+      while (i < middle && j < end) {
+        array[k++] = array[j] < buffer[i] ? array[j++] : buffer[i++];
       }
-      array[offset + i] = array[offset + child];
-      i = child;
+      System.arraycopy(buffer, i, array, k, middle - i);
     }
-    array[offset + i] = value;
   }
 
-  private static <T> void insertionSort(T[] array,
-    Comparator<? super T> comparator)
-  {
-    for (int j = 1; j < array.length; ++j) {
-      T t = array[j];
-      int i = j - 1;
-      while (i >= 0 && comparator.compare(array[i], t) > 0) {
-        array[i + 1] = array[i];
-        i = i - 1;
+  private static class ParallelLongSort extends RecursiveAction {
+    private final long[] array;
+    private final long[] buffer;
+    private final int begin;
+    private final int end;
+    private final int granularity;
+
+    public ParallelLongSort(long[] array, long[] buffer, int begin, int end,
+                            int granularity)
+    {
+      this.array = array;
+      this.buffer = buffer;
+      this.begin = begin;
+      this.end = end;
+      this.granularity = granularity;
+    }
+
+    protected void compute() {
+      if (end - begin <= granularity) {
+        DualPivotQuicksort.sort(array, begin, end);
+        return;
+      }
+
+      int middle = (begin + end) >>> 1;
+      invokeAll
+        (new ParallelLongSort(array, buffer, begin, middle, granularity),
+         new ParallelLongSort(array, buffer, middle, end, granularity));
+
+      if (array[middle - 1] <= array[middle]) {
+        return;
       }
-      array[i + 1] = t;
+
+      System.arraycopy(array, begin, buffer, begin, middle - begin);
+      int i = begin;
+      int j = middle;
+      int k = begin;
+      while (i < middle && j < end) {
+        array[k++] = array[j] < buffer[i] ? array[j++] : buffer[i++];
+      }
+      System.arraycopy(buffer, i, array, k, middle - i);
     }
   }
 
@@ -497,107 +633,130 @@ public class Arrays {
     }
   }
 
+  // filling in native code stores several elements at a time, which
+  // pays for the cost of the call once the range isn't tiny
+  private static final int NativeFillThreshold = 32;
+
+  private static native void fillPrimitive(Object array, int offset,
+                                           int length, long value);
+
   public static void fill(int[] array, int value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(int[] array, int start, int stop, int value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, value);
     }
   }
 
   public static void fill(char[] array, char value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(char[] array, int start, int stop, char value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, value);
     }
   }
 
   public static void fill(short[] array, short value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(short[] array, int start, int stop, short value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, value);
     }
   }
 
   public static void fill(byte[] array, byte value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+    fill(array, 0, array.length, value);
   }
-  
+
   public static void fill(byte[] array, int start, int stop, byte value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, value);
     }
   }
 
   public static void fill(boolean[] array, boolean value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(boolean[] array, int start, int stop, boolean value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, value ? 1 : 0);
     }
   }
 
   public static void fill(long[] array, long value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(long[] array, int start, int stop, long value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, value);
     }
   }
 
-   public static void fill(float[] array, float value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+  public static void fill(float[] array, float value) {
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(float[] array, int start, int stop, float value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, Float.floatToRawIntBits(value));
     }
   }
 
- public static void fill(double[] array, double value) {
-    for (int i=0;i<array.length;i++) {
-      array[i] = value;
-    }
+  public static void fill(double[] array, double value) {
+    fill(array, 0, array.length, value);
   }
 
   public static void fill(double[] array, int start, int stop, double value) {
     checkRange(array.length, start, stop);
-    for (int i=start;i<stop;i++) {
-      array[i] = value;
+    if (stop - start < NativeFillThreshold) {
+      for (int i=start;i<stop;i++) {
+        array[i] = value;
+      }
+    } else {
+      fillPrimitive(array, start, stop - start, Double.doubleToRawLongBits(value));
     }
   }
 
@@ -0,0 +1,370 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util;
+
+/**
+ * Sorts primitive arrays by partitioning around two pivots at a time,
+ * after Yaroslavskiy, which does fewer swaps than a single-pivot
+ * quicksort and keeps more of each pass in cache.
+ *
+ * <p>The pivots are the second and fourth of five evenly spaced
+ * samples.  When they're equal, the range has a lot of duplicates and
+ * we fall back to a three-way partition around the one value instead.
+ * Small ranges are finished with an insertion sort, and the recursion
+ * depth is limited with a heap sort fallback so pathological inputs
+ * stay O(n log n).
+ */
+final class DualPivotQuicksort {
+  private static final int InsertionSortThreshold = 47;
+
+  private DualPivotQuicksort() { }
+
+  private static int depthLimit(int length) {
+    return (32 - Integer.numberOfLeadingZeros(length)) << 1;
+  }
+
+  // sorts the range [begin, end)
+  static void sort(int[] a, int begin, int end) {
+    sort(a, begin, end - 1, depthLimit(end - begin));
+  }
+
+  // sorts the range [left, right], inclusive
+  private static void sort(int[] a, int left, int right, int depth) {
+    while (right - left >= InsertionSortThreshold) {
+      if (depth-- == 0) {
+        heapSort(a, left, right + 1);
+        return;
+      }
+
+      int length = right - left + 1;
+      int seventh = (length >> 3) + (length >> 6) + 1;
+      int e3 = (left + right) >>> 1;
+      int e1 = e3 - (seventh << 1);
+      int e2 = e3 - seventh;
+      int e4 = e3 + seventh;
+      int e5 = e4 + seventh;
+
+      // insertion sort the samples in place
+      for (int i = e2; i <= e5; i += seventh) {
+        int x = a[i];
+        int j = i - seventh;
+        while (j >= e1 && a[j] > x) {
+          a[j + seventh] = a[j];
+          j -= seventh;
+        }
+        a[j + seventh] = x;
+      }
+
+      if (a[e2] != a[e4]) {
+        int pivot1 = a[e2];
+        int pivot2 = a[e4];
+
+        // the ends are where the pivots go once we know their places, so
+        // move what's there into the pivots' slots
+        a[e2] = a[left];
+        a[e4] = a[right];
+
+        // [left + 1, less) < pivot1 <= [less, k) <= pivot2 < (great,
+        // right - 1]
+        int less = left + 1;
+        int great = right - 1;
+        for (int k = less; k <= great; ++k) {
+          int x = a[k];
+          if (x < pivot1) {
+            a[k] = a[less];
+            a[less++] = x;
+          } else if (x > pivot2) {
+            while (a[great] > pivot2 && k < great) {
+              --great;
+            }
+            a[k] = a[great];
+            a[great--] = x;
+
+            x = a[k];
+            if (x < pivot1) {
+              a[k] = a[less];
+              a[less++] = x;
+            }
+          }
+        }
+
+        a[left] = a[less - 1];
+        a[less - 1] = pivot1;
+        a[right] = a[great + 1];
+        a[great + 1] = pivot2;
+
+        sort(a, left, less - 2, depth);
+        sort(a, great + 2, right, depth);
+
+        // if the middle part is most of the range, it probably has a lot
+        // of elements equal to the pivots; move those to its ends, which
+        // is where they belong
+        if (less < e1 && e5 < great) {
+          while (a[less] == pivot1) {
+            ++less;
+          }
+          while (a[great] == pivot2) {
+            --great;
+          }
+
+          for (int k = less; k <= great; ++k) {
+            int x = a[k];
+            if (x == pivot1) {
+              a[k] = a[less];
+              a[less++] = x;
+            } else if (x == pivot2) {
+              while (a[great] == pivot2 && k < great) {
+                --great;
+              }
+              a[k] = a[great];
+              a[great--] = x;
+
+              x = a[k];
+              if (x == pivot1) {
+                a[k] = a[less];
+                a[less++] = x;
+              }
+            }
+          }
+        }
+
+        left = less;
+        right = great;
+      } else {
+        int pivot = a[e3];
+
+        // [left, less) < pivot == [less, k) < ... < (great, right]
+        int less = left;
+        int great = right;
+        int k = left;
+        while (k <= great) {
+          int x = a[k];
+          if (x < pivot) {
+            a[k++] = a[less];
+            a[less++] = x;
+          } else if (x > pivot) {
+            a[k] = a[great];
+            a[great--] = x;
+          } else {
+            ++k;
+          }
+        }
+
+        sort(a, left, less - 1, depth);
+        left = great + 1;
+      }
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      int x = a[i];
+      int j = i - 1;
+      while (j >= left && a[j] > x) {
+        a[j + 1] = a[j];
+        --j;
+      }
+      a[j + 1] = x;
+    }
+  }
+
+  private static void heapSort(int[] a, int begin, int end) {
+    int count = end - begin;
+    for (int i = count / 2 - 1; i >= 0; --i) {
+      siftDown(a, i, count, begin);
+    }
+    for (int i = count - 1; i > 0; --i) {
+      int swap = a[begin + i];
+      a[begin + i] = a[begin];
+      a[begin] = swap;
+
+      siftDown(a, 0, i, begin);
+    }
+  }
+
+  private static void siftDown(int[] a, int i, int count, int offset) {
+    int value = a[offset + i];
+    while (i < count / 2) {
+      int child = 2 * i + 1;
+      if (child + 1 < count && a[offset + child] < a[offset + child + 1]) {
+        ++child;
+      }
+      if (value >= a[offset + child]) {
+        break;
+      }
+      a[offset + i] = a[offset + child];
+      i = child;
+    }
+    a[offset + i] = value;
+  }
+
+  // The long versions are the same as the int ones above.
+
+  static void sort(long[] a, int begin, int end) {
+    sort(a, begin, end - 1, depthLimit(end - begin));
+  }
+
+  private static void sort(long[] a, int left, int right, int depth) {
+    while (right - left >= InsertionSortThreshold) {
+      if (depth-- == 0) {
+        heapSort(a, left, right + 1);
+        return;
+      }
+
+      int length = right - left + 1;
+      int seventh = (length >> 3) + (length >> 6) + 1;
+      int e3 = (left + right) >>> 1;
+      int e1 = e3 - (seventh << 1);
+      int e2 = e3 - seventh;
+      int e4 = e3 + seventh;
+      int e5 = e4 + seventh;
+
+      for (int i = e2; i <= e5; i += seventh) {
+        long x = a[i];
+        int j = i - seventh;
+        while (j >= e1 && a[j] > x) {
+          a[j + seventh] = a[j];
+          j -= seventh;
+        }
+        a[j + seventh] = x;
+      }
+
+      if (a[e2] != a[e4]) {
+        long pivot1 = a[e2];
+        long pivot2 = a[e4];
+
+        a[e2] = a[left];
+        a[e4] = a[right];
+
+        int less = left + 1;
+        int great = right - 1;
+        for (int k = less; k <= great; ++k) {
+          long x = a[k];
+          if (x < pivot1) {
+            a[k] = a[less];
+            a[less++] = x;
+          } else if (x > pivot2) {
+            while (a[great] > pivot2 && k < great) {
+              --great;
+            }
+            a[k] = a[great];
+            a[great--] = x;
+
+            x = a[k];
+            if (x < pivot1) {
+              a[k] = a[less];
+              a[less++] = x;
+            }
+          }
+        }
+
+        a[left] = a[less - 1];
+        a[less - 1] = pivot1;
+        a[right] = a[great + 1];
+        a[great + 1] = pivot2;
+
+        sort(a, left, less - 2, depth);
+        sort(a, great + 2, right, depth);
+
+        if (less < e1 && e5 < great) {
+          while (a[less] == pivot1) {
+            ++less;
+          }
+          while (a[great] == pivot2) {
+            --great;
+          }
+
+          for (int k = less; k <= great; ++k) {
+            long x = a[k];
+            if (x == pivot1) {
+              a[k] = a[less];
+              a[less++] = x;
+            } else if (x == pivot2) {
+              while (a[great] == pivot2 && k < great) {
+                --great;
+              }
+              a[k] = a[great];
+              a[great--] = x;
+
+              x = a[k];
+              if (x == pivot1) {
+                a[k] = a[less];
+                a[less++] = x;
+              }
+            }
+          }
+        }
+
+        left = less;
+        right = great;
+      } else {
+        long pivot = a[e3];
+
+        int less = left;
+        int great = right;
+        int k = left;
+        while (k <= great) {
+          long x = a[k];
+          if (x < pivot) {
+            a[k++] = a[less];
+            a[less++] = x;
+          } else if (x > pivot) {
+            a[k] = a[great];
+            a[great--] = x;
+          } else {
+            ++k;
+          }
+        }
+
+        sort(a, left, less - 1, depth);
+        left = great + 1;
+      }
+    }
+
+    for (int i = left + 1; i <= right; ++i) {
+      long x = a[i];
+      int j = i - 1;
+      while (j >= left && a[j] > x) {
+        a[j + 1] = a[j];
+        --j;
+      }
+      a[j + 1] = x;
+    }
+  }
+
+  private static void heapSort(long[] a, int begin, int end) {
+    int count = end - begin;
+    for (int i = count / 2 - 1; i >= 0; --i) {
+      siftDown(a, i, count, begin);
+    }
+    for (int i = count - 1; i > 0; --i) {
+      long swap = a[begin + i];
+      a[begin + i] = a[begin];
+      a[begin] = swap;
+
+      siftDown(a, 0, i, begin);
+    }
+  }
+
+  private static void siftDown(long[] a, int i, int count, int offset) {
+    long value = a[offset + i];
+    while (i < count / 2) {
+      int child = 2 * i + 1;
+      if (child + 1 < count && a[offset + child] < a[offset + child + 1]) {
+        ++child;
+      }
+      if (value >= a[offset + child]) {
+        break;
+      }
+      a[offset + i] = a[offset + child];
+      i = child;
+    }
+    a[offset + i] = value;
+  }
+}
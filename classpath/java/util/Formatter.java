@@ -123,8 +123,7 @@ public class Formatter implements Closeable, Flushable, AutoCloseable {
   public Formatter format(Locale l, final String format, final Object...args) {
     ensureNotClosed();
     try {
-      final FormatString formatString = FormatString.compile(format);
-      this._out.append(formatString.format(args));
+      FormatString.compile(format).format(this._out, args);
     } catch (IOException e) {
       this.lastException = e;
     }
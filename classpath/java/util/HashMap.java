@@ -15,8 +15,17 @@ import avian.Data;
 public class HashMap<K, V> implements Map<K, V> {
   private static final int MinimumCapacity = 16;
 
+  // A bucket whose chain reaches TreeifyThreshold cells is indexed by a
+  // tree, unless the table is smaller than MinimumTreeifyCapacity, in
+  // which case it grows instead.  The tree goes away again once the
+  // bucket is down to UntreeifyThreshold cells.
+  private static final int TreeifyThreshold = 8;
+  private static final int UntreeifyThreshold = 6;
+  private static final int MinimumTreeifyCapacity = 64;
+
   private int size;
   private Cell[] array;
+  private TreeBin<K, V>[] trees;
   private final Helper helper;
 
   public HashMap(int capacity, Helper<K, V> helper) {
@@ -53,47 +62,149 @@ public class HashMap<K, V> implements Map<K, V> {
     return size;
   }
 
+  // folds the high bits of a hash into the low ones, which are all
+  // that pick a bucket
+  private static int spread(int hash) {
+    return hash ^ (hash >>> 16);
+  }
+
+  private int index(int hash) {
+    return spread(hash) & (array.length - 1);
+  }
+
+  private TreeBin<K, V> tree(int index) {
+    return trees == null ? null : trees[index];
+  }
+
   private void grow() {
-    if (array == null || size >= array.length * 2) {
+    if (array == null || size > array.length - (array.length >>> 2)) {
       resize(array == null ? MinimumCapacity : array.length * 2);
     }
   }
 
   private void shrink() {
-    if (array.length / 2 >= MinimumCapacity && size <= array.length / 3) {
+    if (array.length / 2 >= MinimumCapacity && size <= array.length / 4) {
       resize(array.length / 2);
     }
   }
 
   private void resize(int capacity) {
     Cell<K, V>[] newArray = null;
+    TreeBin<K, V>[] oldTrees = trees;
+    trees = null;
     if (capacity != 0) {
       capacity = Data.nextPowerOfTwo(capacity);
       if (array != null && array.length == capacity) {
+        trees = oldTrees;
         return;
       }
 
       newArray = new Cell[capacity];
       if (array != null) {
+        boolean doubling = capacity == array.length * 2;
         for (int i = 0; i < array.length; ++i) {
-          Cell<K, V> next;
-          for (Cell<K, V> c = array[i]; c != null; c = next) {
-            next = c.next();
-            int index = c.hashCode() & (capacity - 1);
-            c.setNext(newArray[index]);
-            newArray[index] = c;
+          if (doubling) {
+            split(i, newArray);
+          } else {
+            Cell<K, V> next;
+            for (Cell<K, V> c = array[i]; c != null; c = next) {
+              next = c.next();
+              int index = spread(c.hashCode()) & (capacity - 1);
+              c.setNext(newArray[index]);
+              newArray[index] = c;
+            }
           }
         }
       }
     }
+
+    Cell<K, V>[] oldArray = array;
     array = newArray;
+
+    // the table only ever doubles or halves, so the cells of bucket i
+    // now live at i & (capacity - 1) and, if it doubled, at i plus the
+    // old capacity
+    if (oldTrees != null && newArray != null) {
+      for (int i = 0; i < oldTrees.length; ++i) {
+        if (oldTrees[i] != null) {
+          int index = i & (capacity - 1);
+          treeifyIfLong(index, UntreeifyThreshold + 1);
+          if (capacity > oldArray.length) {
+            treeifyIfLong(index + oldArray.length, UntreeifyThreshold + 1);
+          }
+        }
+      }
+    }
+  }
+
+  // Moves the chain at index into a table of twice the size.  Each
+  // cell either stays at index or moves up by the old capacity,
+  // depending on one more bit of its hash, so the chain splits into two
+  // without computing any indexes, and both halves keep their order.
+  private void split(int index, Cell<K, V>[] newArray) {
+    Cell<K, V> low = null;
+    Cell<K, V> lowTail = null;
+    Cell<K, V> high = null;
+    Cell<K, V> highTail = null;
+    Cell<K, V> next;
+    for (Cell<K, V> c = array[index]; c != null; c = next) {
+      next = c.next();
+      c.setNext(null);
+      if ((spread(c.hashCode()) & array.length) == 0) {
+        if (lowTail == null) {
+          low = c;
+        } else {
+          lowTail.setNext(c);
+        }
+        lowTail = c;
+      } else {
+        if (highTail == null) {
+          high = c;
+        } else {
+          highTail.setNext(c);
+        }
+        highTail = c;
+      }
+    }
+    newArray[index] = low;
+    newArray[index + array.length] = high;
+  }
+
+  private void treeifyIfLong(int index, int threshold) {
+    if (tree(index) != null) {
+      return;
+    }
+
+    int length = 0;
+    for (Cell<K, V> c = array[index]; c != null && length < threshold;
+         c = c.next())
+    {
+      ++ length;
+    }
+
+    if (length >= threshold && helper.stableKeys()) {
+      TreeBin<K, V> tree = new TreeBin<K, V>(helper);
+      for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
+        tree.insert(c);
+      }
+      if (trees == null) {
+        trees = new TreeBin[array.length];
+      }
+      trees[index] = tree;
+    }
   }
 
   protected Cell<K, V> find(Object key) {
     if (array != null) {
-      int index = helper.hash(key) & (array.length - 1);
+      int hash = helper.hash(key);
+      int index = index(hash);
+      TreeBin<K, V> tree = tree(index);
+      if (tree != null) {
+        return tree.find(hash, key);
+      }
+
       for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
-        if (helper.equal(key, c.getKey())) {
+        if (c.hashCode() == hash && helper.equal(key, c.getKey())) {
           return c;
         }
       }
@@ -107,13 +218,32 @@ public class HashMap<K, V> implements Map<K, V> {
 
     grow();
 
-    int index = cell.hashCode() & (array.length - 1);
+    int index = index(cell.hashCode());
     cell.setNext(array[index]);
     array[index] = cell;
+
+    TreeBin<K, V> tree = tree(index);
+    if (tree != null) {
+      tree.insert(cell);
+    } else if (cell.next() != null) {
+      if (array.length < MinimumTreeifyCapacity) {
+        int length = 0;
+        for (Cell<K, V> c = cell; c != null; c = c.next()) {
+          if (++ length == TreeifyThreshold) {
+            resize(array.length * 2);
+            break;
+          }
+        }
+      } else {
+        treeifyIfLong(index, TreeifyThreshold);
+      }
+    }
   }
 
-  public void remove(Cell<K, V> cell) {
-    int index = cell.hashCode() & (array.length - 1);
+  // unlinks a cell from the chain at index and takes it out of the
+  // bucket's tree, if any; the chain is singly linked, so this walks it
+  // either way, but without comparing keys
+  private boolean unlink(int index, Cell<K, V> cell) {
     Cell<K, V> p = null;
     for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
       if (c == cell) {
@@ -122,12 +252,26 @@ public class HashMap<K, V> implements Map<K, V> {
         } else {
           p.setNext(c.next());
         }
-        -- size;
-        break;
+
+        TreeBin<K, V> tree = tree(index);
+        if (tree != null) {
+          tree.remove(cell);
+          if (tree.size() <= UntreeifyThreshold) {
+            trees[index] = null;
+          }
+        }
+        return true;
       }
+      p = c;
     }
+    return false;
+  }
 
-    shrink();
+  public void remove(Cell<K, V> cell) {
+    if (array != null && unlink(index(cell.hashCode()), cell)) {
+      -- size;
+      shrink();
+    }
   }
 
   private Cell<K, V> putCell(K key, V value) {
@@ -164,24 +308,10 @@ public class HashMap<K, V> implements Map<K, V> {
   }
 
   public Cell<K, V> removeCell(Object key) {
-    Cell<K, V> old = null;
-    if (array != null) {
-      int index = helper.hash(key) & (array.length - 1);
-      Cell<K, V> p = null;
-      for (Cell<K, V> c = array[index]; c != null; c = c.next()) {
-        if (helper.equal(key, c.getKey())) {
-          old = c;
-          if (p == null) {
-            array[index] = c.next();
-          } else {
-            p.setNext(c.next());
-          }
-          -- size;
-          break;
-        }
-        p = c;
-      }
-
+    Cell<K, V> old = find(key);
+    if (old != null) {
+      unlink(index(old.hashCode()), old);
+      -- size;
       shrink();
     }
     return old;
@@ -212,6 +342,7 @@ public class HashMap<K, V> implements Map<K, V> {
 
   public void clear() {
     array = null;
+    trees = null;
     size = 0;
   }
 
@@ -265,6 +396,10 @@ public class HashMap<K, V> implements Map<K, V> {
     public int hash(K key);
 
     public boolean equal(K a, K b);
+
+    // whether a cell's key stays put for as long as the cell is in the
+    // map, which tree bins rely on to keep their order
+    public boolean stableKeys();
   }
 
   private static class MyCell<K, V> implements Cell<K, V> {
@@ -319,6 +454,347 @@ public class HashMap<K, V> implements Map<K, V> {
     public boolean equal(K a, K b) {
       return (a == null && b == null) || (a != null && a.equals(b));
     }
+
+    public boolean stableKeys() {
+      return true;
+    }
+  }
+
+  private static class TreeNode<K, V> {
+    public Cell<K, V> cell;
+    public int hash;
+    public TreeNode<K, V> parent;
+    public TreeNode<K, V> left;
+    public TreeNode<K, V> right;
+    public boolean red;
+
+    public TreeNode(Cell<K, V> cell, TreeNode<K, V> parent) {
+      this.cell = cell;
+      this.hash = cell.hashCode();
+      this.parent = parent;
+    }
+  }
+
+  /**
+   * A red-black tree over the cells of one bucket, so that lookups stay
+   * logarithmic however badly the keys' hashes collide.
+   *
+   * <p>Cells are ordered by hash, then by compareTo if the keys are
+   * comparable instances of the same class.  Where neither decides,
+   * insertion picks a side arbitrarily and lookups search both.  The
+   * bucket's chain stays as it is, so iteration and containsValue need
+   * not know about the tree.
+   */
+  private static class TreeBin<K, V> {
+    private final Helper<K, V> helper;
+    private TreeNode<K, V> root;
+    private int size;
+
+    public TreeBin(Helper<K, V> helper) {
+      this.helper = helper;
+    }
+
+    public int size() {
+      return size;
+    }
+
+    public Cell<K, V> find(int hash, Object key) {
+      TreeNode<K, V> n = find(root, hash, key, null);
+      return n == null ? null : n.cell;
+    }
+
+    public void insert(Cell<K, V> cell) {
+      int hash = cell.hashCode();
+      K key = cell.getKey();
+      Class keyClass = comparableClass(key);
+      TreeNode<K, V> parent = null;
+      int d = 0;
+      for (TreeNode<K, V> n = root; n != null; n = d < 0 ? n.left : n.right) {
+        parent = n;
+        d = compare(hash, key, keyClass, n);
+        if (d == 0) {
+          d = tieBreak(key, n.cell.getKey());
+        }
+      }
+
+      TreeNode<K, V> node = new TreeNode<K, V>(cell, parent);
+      if (parent == null) {
+        root = node;
+      } else if (d < 0) {
+        parent.left = node;
+      } else {
+        parent.right = node;
+      }
+      fixAfterInsertion(node);
+      ++ size;
+    }
+
+    public void remove(Cell<K, V> cell) {
+      TreeNode<K, V> n = find(root, cell.hashCode(), cell.getKey(), cell);
+      if (n != null) {
+        delete(n);
+        -- size;
+      }
+    }
+
+    // finds the node for key, or, if cell is not null, the one for cell
+    private TreeNode<K, V> find(TreeNode<K, V> n, int hash, Object key,
+                                Cell<K, V> cell)
+    {
+      Class keyClass = comparableClass(key);
+      while (n != null) {
+        if (cell == null
+            ? n.hash == hash && helper.equal((K) key, n.cell.getKey())
+            : n.cell == cell)
+        {
+          return n;
+        }
+
+        int d = compare(hash, key, keyClass, n);
+        if (d < 0) {
+          n = n.left;
+        } else if (d > 0) {
+          n = n.right;
+        } else {
+          TreeNode<K, V> found = find(n.right, hash, key, cell);
+          if (found != null) {
+            return found;
+          }
+          n = n.left;
+        }
+      }
+      return null;
+    }
+
+    private static Class comparableClass(Object key) {
+      return key instanceof Comparable ? key.getClass() : null;
+    }
+
+    private static int compare(int hash, Object key, Class keyClass,
+                               TreeNode n)
+    {
+      if (hash != n.hash) {
+        return hash < n.hash ? -1 : 1;
+      }
+
+      Object other = n.cell.getKey();
+      if (keyClass == null || other == null || other.getClass() != keyClass) {
+        return 0;
+      }
+      try {
+        return ((Comparable) key).compareTo(other);
+      } catch (ClassCastException e) {
+        // the class is comparable to something other than itself
+        return 0;
+      }
+    }
+
+    private static int tieBreak(Object a, Object b) {
+      int d = 0;
+      if (a != null && b != null) {
+        d = a.getClass().getName().compareTo(b.getClass().getName());
+      }
+      if (d == 0) {
+        d = System.identityHashCode(a) <= System.identityHashCode(b) ? -1 : 1;
+      }
+      return d;
+    }
+
+    // The balancing below follows Cormen et al., with null standing in
+    // for the black leaves.
+
+    private static boolean isRed(TreeNode n) {
+      return n != null && n.red;
+    }
+
+    private static void setRed(TreeNode n, boolean red) {
+      if (n != null) {
+        n.red = red;
+      }
+    }
+
+    private static <K, V> TreeNode<K, V> parentOf(TreeNode<K, V> n) {
+      return n == null ? null : n.parent;
+    }
+
+    private static <K, V> TreeNode<K, V> leftOf(TreeNode<K, V> n) {
+      return n == null ? null : n.left;
+    }
+
+    private static <K, V> TreeNode<K, V> rightOf(TreeNode<K, V> n) {
+      return n == null ? null : n.right;
+    }
+
+    private void replaceChild(TreeNode<K, V> n, TreeNode<K, V> child) {
+      child.parent = n.parent;
+      if (n.parent == null) {
+        root = child;
+      } else if (n.parent.left == n) {
+        n.parent.left = child;
+      } else {
+        n.parent.right = child;
+      }
+    }
+
+    private void rotateLeft(TreeNode<K, V> n) {
+      TreeNode<K, V> r = n.right;
+      n.right = r.left;
+      if (r.left != null) {
+        r.left.parent = n;
+      }
+      replaceChild(n, r);
+      r.left = n;
+      n.parent = r;
+    }
+
+    private void rotateRight(TreeNode<K, V> n) {
+      TreeNode<K, V> l = n.left;
+      n.left = l.right;
+      if (l.right != null) {
+        l.right.parent = n;
+      }
+      replaceChild(n, l);
+      l.right = n;
+      n.parent = l;
+    }
+
+    private void fixAfterInsertion(TreeNode<K, V> n) {
+      n.red = true;
+      while (n != root && n.parent.red) {
+        TreeNode<K, V> parent = n.parent;
+        TreeNode<K, V> grandparent = parent.parent;
+        if (parent == grandparent.left) {
+          TreeNode<K, V> uncle = grandparent.right;
+          if (isRed(uncle)) {
+            parent.red = false;
+            uncle.red = false;
+            grandparent.red = true;
+            n = grandparent;
+          } else {
+            if (n == parent.right) {
+              n = parent;
+              rotateLeft(n);
+              parent = n.parent;
+            }
+            parent.red = false;
+            grandparent.red = true;
+            rotateRight(grandparent);
+          }
+        } else {
+          TreeNode<K, V> uncle = grandparent.left;
+          if (isRed(uncle)) {
+            parent.red = false;
+            uncle.red = false;
+            grandparent.red = true;
+            n = grandparent;
+          } else {
+            if (n == parent.left) {
+              n = parent;
+              rotateRight(n);
+              parent = n.parent;
+            }
+            parent.red = false;
+            grandparent.red = true;
+            rotateLeft(grandparent);
+          }
+        }
+      }
+      root.red = false;
+    }
+
+    private void delete(TreeNode<K, V> n) {
+      // a node with two children trades places with its successor,
+      // which has at most one
+      if (n.left != null && n.right != null) {
+        TreeNode<K, V> s = n.right;
+        while (s.left != null) {
+          s = s.left;
+        }
+        n.cell = s.cell;
+        n.hash = s.hash;
+        n = s;
+      }
+
+      TreeNode<K, V> child = n.left != null ? n.left : n.right;
+      if (child != null) {
+        replaceChild(n, child);
+        n.left = n.right = n.parent = null;
+        if (! n.red) {
+          fixAfterDeletion(child);
+        }
+      } else if (n.parent == null) {
+        root = null;
+      } else {
+        if (! n.red) {
+          fixAfterDeletion(n);
+        }
+        if (n.parent != null) {
+          if (n == n.parent.left) {
+            n.parent.left = null;
+          } else if (n == n.parent.right) {
+            n.parent.right = null;
+          }
+          n.parent = null;
+        }
+      }
+    }
+
+    private void fixAfterDeletion(TreeNode<K, V> n) {
+      while (n != root && ! isRed(n)) {
+        if (n == leftOf(parentOf(n))) {
+          TreeNode<K, V> sibling = rightOf(parentOf(n));
+          if (isRed(sibling)) {
+            setRed(sibling, false);
+            setRed(parentOf(n), true);
+            rotateLeft(parentOf(n));
+            sibling = rightOf(parentOf(n));
+          }
+
+          if (! isRed(leftOf(sibling)) && ! isRed(rightOf(sibling))) {
+            setRed(sibling, true);
+            n = parentOf(n);
+          } else {
+            if (! isRed(rightOf(sibling))) {
+              setRed(leftOf(sibling), false);
+              setRed(sibling, true);
+              rotateRight(sibling);
+              sibling = rightOf(parentOf(n));
+            }
+            setRed(sibling, isRed(parentOf(n)));
+            setRed(parentOf(n), false);
+            setRed(rightOf(sibling), false);
+            rotateLeft(parentOf(n));
+            n = root;
+          }
+        } else {
+          TreeNode<K, V> sibling = leftOf(parentOf(n));
+          if (isRed(sibling)) {
+            setRed(sibling, false);
+            setRed(parentOf(n), true);
+            rotateRight(parentOf(n));
+            sibling = leftOf(parentOf(n));
+          }
+
+          if (! isRed(rightOf(sibling)) && ! isRed(leftOf(sibling))) {
+            setRed(sibling, true);
+            n = parentOf(n);
+          } else {
+            if (! isRed(leftOf(sibling))) {
+              setRed(rightOf(sibling), false);
+              setRed(sibling, true);
+              rotateLeft(sibling);
+              sibling = leftOf(parentOf(n));
+            }
+            setRed(sibling, isRed(parentOf(n)));
+            setRed(parentOf(n), false);
+            setRed(leftOf(sibling), false);
+            rotateRight(parentOf(n));
+            n = root;
+          }
+        }
+      }
+      setRed(n, false);
+    }
   }
 
   private class MyIterator implements Iterator<Entry<K, V>> {
@@ -375,6 +851,14 @@ public class HashMap<K, V> implements Map<K, V> {
             previousCell = null;
           }
         }
+
+        TreeBin<K, V> tree = tree(currentIndex);
+        if (tree != null) {
+          tree.remove(currentCell);
+          if (tree.size() <= UntreeifyThreshold) {
+            trees[currentIndex] = null;
+          }
+        }
         currentCell = null;
         -- size;
       } else {
@@ -0,0 +1,345 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util;
+
+/**
+ * A stable, adaptive merge sort after Tim Peters' list sort for
+ * Python.
+ *
+ * <p>The array is cut into runs which are already in order (reversing
+ * descending ones), with short runs extended to a minimum length by
+ * an insertion sort.  Runs are pushed on a stack and merged whenever
+ * the lengths at the top stop shrinking fast enough, which keeps the
+ * merges balanced.  A merge only moves the parts of its two runs which
+ * overlap, and when one side keeps winning it copies a whole block of
+ * that side at once, found by galloping, so partially ordered input
+ * sorts in close to linear time.
+ */
+final class TimSort<T> {
+  private static final int MinMerge = 32;
+  private static final int MinGallop = 7;
+
+  // enough for any array whose length fits in an int, given the
+  // invariants mergeCollapse maintains
+  private static final int MaxRuns = 49;
+
+  private final T[] array;
+  private final Comparator<? super T> comparator;
+  private final int[] runBase = new int[MaxRuns];
+  private final int[] runLength = new int[MaxRuns];
+  private int runCount;
+  private Object[] buffer;
+
+  private TimSort(T[] array, Comparator<? super T> comparator) {
+    this.array = array;
+    this.comparator = comparator;
+  }
+
+  // sorts the range [begin, end)
+  static <T> void sort(T[] array, Comparator<? super T> comparator,
+                       int begin, int end)
+  {
+    int remaining = end - begin;
+    if (remaining < 2) {
+      return;
+    }
+
+    if (remaining < MinMerge) {
+      int n = countRun(array, comparator, begin, end);
+      insertionSort(array, comparator, begin, end, begin + n);
+      return;
+    }
+
+    TimSort<T> sort = new TimSort<T>(array, comparator);
+    int minRun = minRunLength(remaining);
+    do {
+      int n = countRun(array, comparator, begin, end);
+      if (n < minRun) {
+        int forced = remaining < minRun ? remaining : minRun;
+        insertionSort(array, comparator, begin, begin + forced, begin + n);
+        n = forced;
+      }
+
+      sort.runBase[sort.runCount] = begin;
+      sort.runLength[sort.runCount] = n;
+      ++ sort.runCount;
+      sort.mergeCollapse();
+
+      begin += n;
+      remaining -= n;
+    } while (remaining != 0);
+
+    sort.mergeForceCollapse();
+  }
+
+  // picks a run length such that the number of runs is a power of two,
+  // or a little less, for the sake of balanced merges
+  private static int minRunLength(int n) {
+    int r = 0;
+    while (n >= MinMerge) {
+      r |= n & 1;
+      n >>= 1;
+    }
+    return n + r;
+  }
+
+  // returns the length of the run starting at begin, reversing it if
+  // it's descending.  Only strictly descending runs are reversed, so
+  // equal elements keep their order.
+  private static <T> int countRun(T[] array, Comparator<? super T> comparator,
+                                  int begin, int end)
+  {
+    int i = begin + 1;
+    if (i == end) {
+      return 1;
+    }
+
+    if (comparator.compare(array[i++], array[begin]) < 0) {
+      while (i < end && comparator.compare(array[i], array[i - 1]) < 0) {
+        ++i;
+      }
+
+      for (int lo = begin, hi = i - 1; lo < hi; ++lo, --hi) {
+        T swap = array[lo];
+        array[lo] = array[hi];
+        array[hi] = swap;
+      }
+    } else {
+      while (i < end && comparator.compare(array[i], array[i - 1]) >= 0) {
+        ++i;
+      }
+    }
+    return i - begin;
+  }
+
+  // sorts [begin, end), given that [begin, start) is already sorted,
+  // using a binary search to find where each element goes
+  private static <T> void insertionSort(T[] array,
+                                        Comparator<? super T> comparator,
+                                        int begin, int end, int start)
+  {
+    for (; start < end; ++start) {
+      T pivot = array[start];
+      int left = begin;
+      int right = start;
+      while (left < right) {
+        int middle = (left + right) >>> 1;
+        if (comparator.compare(pivot, array[middle]) < 0) {
+          right = middle;
+        } else {
+          left = middle + 1;
+        }
+      }
+      System.arraycopy(array, left, array, left + 1, start - left);
+      array[left] = pivot;
+    }
+  }
+
+  // Merges runs until the stack's lengths, read from the top, grow at
+  // least as fast as the Fibonacci numbers.  Checking three entries
+  // deep, not just two, is what makes the bound in MaxRuns hold.
+  private void mergeCollapse() {
+    while (runCount > 1) {
+      int n = runCount - 2;
+      if ((n > 0 && runLength[n - 1] <= runLength[n] + runLength[n + 1])
+          || (n > 1 && runLength[n - 2] <= runLength[n - 1] + runLength[n]))
+      {
+        if (runLength[n - 1] < runLength[n + 1]) {
+          -- n;
+        }
+      } else if (runLength[n] > runLength[n + 1]) {
+        break;
+      }
+      mergeAt(n);
+    }
+  }
+
+  private void mergeForceCollapse() {
+    while (runCount > 1) {
+      int n = runCount - 2;
+      if (n > 0 && runLength[n - 1] < runLength[n + 1]) {
+        -- n;
+      }
+      mergeAt(n);
+    }
+  }
+
+  // merges the runs at i and i + 1 on the stack
+  private void mergeAt(int i) {
+    int base1 = runBase[i];
+    int length1 = runLength[i];
+    int base2 = runBase[i + 1];
+    int length2 = runLength[i + 1];
+
+    runLength[i] = length1 + length2;
+    if (i == runCount - 3) {
+      runBase[i + 1] = runBase[i + 2];
+      runLength[i + 1] = runLength[i + 2];
+    }
+    -- runCount;
+
+    // elements of the first run which are no greater than the first of
+    // the second are already in place, as are those of the second run
+    // which are no less than the last of the first
+    int k = gallop(array[base2], array, base1, length1, true);
+    base1 += k;
+    length1 -= k;
+    if (length1 == 0) {
+      return;
+    }
+
+    length2 = gallop(array[base1 + length1 - 1], array, base2, length2, false);
+    if (length2 == 0) {
+      return;
+    }
+
+    if (length1 <= length2) {
+      mergeLow(base1, length1, base2, length2);
+    } else {
+      mergeHigh(base1, length1, base2, length2);
+    }
+  }
+
+  // returns how many elements at the start of the sorted range [base,
+  // base + length) of a are less than the key, or no greater than it if
+  // inclusive is set.  Searches exponentially from the start, since
+  // that's where the answer usually is, and then by bisection.
+  private int gallop(T key, Object[] a, int base, int length,
+                     boolean inclusive)
+  {
+    int lo = 0;
+    int hi = 1;
+    while (hi <= length && before(a[base + hi - 1], key, inclusive)) {
+      lo = hi;
+      hi = hi > (length >>> 1) ? length + 1 : hi << 1;
+    }
+    if (hi > length) {
+      hi = length;
+    }
+
+    while (lo < hi) {
+      int middle = (lo + hi) >>> 1;
+      if (before(a[base + middle], key, inclusive)) {
+        lo = middle + 1;
+      } else {
+        hi = middle;
+      }
+    }
+    return lo;
+  }
+
+  private boolean before(Object element, T key, boolean inclusive) {
+    int c = comparator.compare((T) element, key);
+    return inclusive ? c <= 0 : c < 0;
+  }
+
+  private Object[] buffer(int length) {
+    if (buffer == null || buffer.length < length) {
+      int size = length;
+      if (buffer != null) {
+        size = Math.max(length, Math.min(buffer.length << 1,
+                                         array.length >>> 1));
+      }
+      buffer = new Object[size];
+    }
+    return buffer;
+  }
+
+  // merges adjacent runs, copying the first, shorter one aside and
+  // filling in from the left
+  private void mergeLow(int base1, int length1, int base2, int length2) {
+    T[] a = array;
+    Object[] tmp = buffer(length1);
+    System.arraycopy(a, base1, tmp, 0, length1);
+
+    int i = 0;
+    int j = base2;
+    int k = base1;
+    int end2 = base2 + length2;
+    int wins1 = 0;
+    int wins2 = 0;
+    while (i < length1 && j < end2) {
+      if (comparator.compare(a[j], (T) tmp[i]) < 0) {
+        a[k++] = a[j++];
+        wins1 = 0;
+        if (++ wins2 >= MinGallop && j < end2) {
+          int n = gallop((T) tmp[i], a, j, end2 - j, false);
+          System.arraycopy(a, j, a, k, n);
+          j += n;
+          k += n;
+          wins2 = 0;
+        }
+      } else {
+        a[k++] = (T) tmp[i++];
+        wins2 = 0;
+        if (++ wins1 >= MinGallop && i < length1) {
+          int n = gallop(a[j], tmp, i, length1 - i, true);
+          System.arraycopy(tmp, i, a, k, n);
+          i += n;
+          k += n;
+          wins1 = 0;
+        }
+      }
+    }
+
+    // whatever is left of the second run is already in place
+    System.arraycopy(tmp, i, a, k, length1 - i);
+
+    for (int n = 0; n < length1; ++n) {
+      tmp[n] = null;
+    }
+  }
+
+  // merges adjacent runs, copying the second, shorter one aside and
+  // filling in from the right
+  private void mergeHigh(int base1, int length1, int base2, int length2) {
+    T[] a = array;
+    Object[] tmp = buffer(length2);
+    System.arraycopy(a, base2, tmp, 0, length2);
+
+    int i = base1 + length1 - 1;
+    int j = length2 - 1;
+    int k = base2 + length2 - 1;
+    int wins1 = 0;
+    int wins2 = 0;
+    while (i >= base1 && j >= 0) {
+      if (comparator.compare((T) tmp[j], a[i]) < 0) {
+        a[k--] = a[i--];
+        wins2 = 0;
+        if (++ wins1 >= MinGallop && i >= base1) {
+          int length = i + 1 - base1;
+          int n = length - gallop((T) tmp[j], a, base1, length, true);
+          System.arraycopy(a, i + 1 - n, a, k + 1 - n, n);
+          i -= n;
+          k -= n;
+          wins1 = 0;
+        }
+      } else {
+        a[k--] = (T) tmp[j--];
+        wins1 = 0;
+        if (++ wins2 >= MinGallop && j >= 0) {
+          int n = j + 1 - gallop(a[i], tmp, 0, j + 1, false);
+          System.arraycopy(tmp, j + 1 - n, a, k + 1 - n, n);
+          j -= n;
+          k -= n;
+          wins2 = 0;
+        }
+      }
+    }
+
+    // whatever is left of the first run is already in place
+    System.arraycopy(tmp, 0, a, base1, j + 1);
+
+    for (int n = 0; n < length2; ++n) {
+      tmp[n] = null;
+    }
+  }
+}
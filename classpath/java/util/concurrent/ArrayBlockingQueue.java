@@ -0,0 +1,494 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.AbstractQueue;
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.Iterator;
+import java.util.NoSuchElementException;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * A bounded blocking queue backed by a circular array.
+ *
+ * <p>As with {@link LinkedBlockingQueue}, the head and the tail have
+ * separate locks, and the count of elements, which only the side
+ * which holds the lock may change in the direction it cares about,
+ * tells each side which slots belong to it.
+ */
+public class ArrayBlockingQueue<T> extends AbstractQueue<T>
+                                   implements BlockingQueue<T> {
+  private final Object putLock = new Object();
+  private final Object takeLock = new Object();
+  private final AtomicInteger count = new AtomicInteger();
+  private final Object[] items;
+
+  // guarded by the take lock
+  private int takeIndex;
+
+  // guarded by the put lock
+  private int putIndex;
+
+  public ArrayBlockingQueue(int capacity) {
+    if (capacity <= 0) {
+      throw new IllegalArgumentException();
+    }
+
+    items = new Object[capacity];
+  }
+
+  public ArrayBlockingQueue(int capacity, boolean fair) {
+    this(capacity);
+  }
+
+  public ArrayBlockingQueue(int capacity, boolean fair,
+                            Collection<? extends T> c)
+  {
+    this(capacity);
+    addAll(c);
+  }
+
+  private int increment(int i) {
+    return ++i == items.length ? 0 : i;
+  }
+
+  // wakes a consumer; must not be called with the put lock held
+  private void signalNotEmpty() {
+    synchronized (takeLock) {
+      takeLock.notify();
+    }
+  }
+
+  // wakes a producer; must not be called with the take lock held
+  private void signalNotFull() {
+    synchronized (putLock) {
+      putLock.notify();
+    }
+  }
+
+  // should be synchronized on putLock before calling, with space
+  // available.  Returns the count from before the element was added.
+  private int enqueue(T element) {
+    items[putIndex] = element;
+    putIndex = increment(putIndex);
+    int c = count.getAndIncrement();
+    if (c + 1 < items.length) {
+      putLock.notify();
+    }
+    return c;
+  }
+
+  // should be synchronized on takeLock before calling, with an
+  // element available
+  private T dequeue() {
+    T result = (T) items[takeIndex];
+    items[takeIndex] = null;
+    takeIndex = increment(takeIndex);
+    return result;
+  }
+
+  // should be synchronized on takeLock before calling, after removing
+  // the specified number of elements.  Returns whether the queue was
+  // full, in which case the caller should signal a producer once it has
+  // released the lock.
+  private boolean removed(int n) {
+    int c = count.getAndAdd(-n);
+    if (c > n) {
+      takeLock.notify();
+    }
+    return c == items.length;
+  }
+
+  // should be synchronized on lock before calling.  Waits for up to
+  // the specified time, or indefinitely if it's Long.MAX_VALUE,
+  // returning the time remaining.  If we're interrupted, pass on any
+  // notification we might have consumed before throwing.
+  private static long await(Object lock, long waitInMillis)
+    throws InterruptedException
+  {
+    try {
+      if (waitInMillis == Long.MAX_VALUE) {
+        lock.wait();
+        return waitInMillis;
+      } else {
+        long startTime = System.currentTimeMillis();
+        lock.wait(waitInMillis);
+        return waitInMillis - (System.currentTimeMillis() - startTime);
+      }
+    } catch (InterruptedException e) {
+      lock.notify();
+      throw e;
+    }
+  }
+
+  @Override
+  public boolean offer(T element) {
+    if (element == null) {
+      throw new NullPointerException();
+    }
+
+    if (count.get() == items.length) {
+      return false;
+    }
+
+    int c = -1;
+    synchronized (putLock) {
+      if (count.get() < items.length) {
+        c = enqueue(element);
+      }
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+    return c >= 0;
+  }
+
+  @Override
+  public boolean offer(T e, long timeout, TimeUnit unit) throws InterruptedException {
+    if (e == null) {
+      throw new NullPointerException();
+    }
+
+    long remainingWait = unit.toMillis(timeout);
+    int c;
+    synchronized (putLock) {
+      while (count.get() == items.length) {
+        if (remainingWait <= 0) {
+          return false;
+        }
+        remainingWait = await(putLock, remainingWait);
+      }
+
+      c = enqueue(e);
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+    return true;
+  }
+
+  @Override
+  public void put(T e) throws InterruptedException {
+    if (e == null) {
+      throw new NullPointerException();
+    }
+
+    int c;
+    synchronized (putLock) {
+      while (count.get() == items.length) {
+        await(putLock, Long.MAX_VALUE);
+      }
+
+      c = enqueue(e);
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+  }
+
+  @Override
+  public T peek() {
+    if (count.get() == 0) {
+      return null;
+    }
+
+    synchronized (takeLock) {
+      return (T) items[takeIndex];
+    }
+  }
+
+  @Override
+  public T poll() {
+    if (count.get() == 0) {
+      return null;
+    }
+
+    T result = null;
+    boolean signal = false;
+    synchronized (takeLock) {
+      if (count.get() > 0) {
+        result = dequeue();
+        signal = removed(1);
+      }
+    }
+
+    if (signal) {
+      signalNotFull();
+    }
+    return result;
+  }
+
+  @Override
+  public T poll(long timeout, TimeUnit unit) throws InterruptedException {
+    long remainingWait = unit.toMillis(timeout);
+    T result;
+    boolean signal;
+    synchronized (takeLock) {
+      while (count.get() == 0) {
+        if (remainingWait <= 0) {
+          return null;
+        }
+        remainingWait = await(takeLock, remainingWait);
+      }
+
+      result = dequeue();
+      signal = removed(1);
+    }
+
+    if (signal) {
+      signalNotFull();
+    }
+    return result;
+  }
+
+  @Override
+  public T take() throws InterruptedException {
+    T result;
+    boolean signal;
+    synchronized (takeLock) {
+      while (count.get() == 0) {
+        await(takeLock, Long.MAX_VALUE);
+      }
+
+      result = dequeue();
+      signal = removed(1);
+    }
+
+    if (signal) {
+      signalNotFull();
+    }
+    return result;
+  }
+
+  @Override
+  public int drainTo(Collection<? super T> c) {
+    return drainTo(c, Integer.MAX_VALUE);
+  }
+
+  @Override
+  public int drainTo(Collection<? super T> c, int maxElements) {
+    if (c == this) {
+      throw new IllegalArgumentException();
+    }
+
+    int drained = 0;
+    boolean signal = false;
+    synchronized (takeLock) {
+      int n = Math.min(maxElements, count.get());
+      try {
+        while (drained < n) {
+          T element = dequeue();
+          ++ drained;
+          c.add(element);
+        }
+      } finally {
+        if (drained != 0) {
+          signal = removed(drained);
+        }
+      }
+    }
+
+    if (signal) {
+      signalNotFull();
+    }
+    return drained;
+  }
+
+  @Override
+  public int remainingCapacity() {
+    return items.length - count.get();
+  }
+
+  @Override
+  public int size() {
+    return count.get();
+  }
+
+  @Override
+  public boolean isEmpty() {
+    return count.get() == 0;
+  }
+
+  @Override
+  public boolean contains(Object element) {
+    if (element == null) {
+      return false;
+    }
+
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (int i = takeIndex, n = count.get(); n > 0;
+             i = increment(i), --n)
+        {
+          if (element.equals(items[i])) {
+            return true;
+          }
+        }
+        return false;
+      }
+    }
+  }
+
+  // should be synchronized on both locks before calling.  Closes the
+  // gap left by the element at the specified index by moving the ones
+  // after it back a slot.
+  private void removeAt(int index) {
+    for (int i = index, next = increment(i); next != putIndex;
+         i = next, next = increment(next))
+    {
+      items[i] = items[next];
+    }
+
+    putIndex = putIndex == 0 ? items.length - 1 : putIndex - 1;
+    items[putIndex] = null;
+
+    if (count.getAndDecrement() == items.length) {
+      putLock.notify();
+    }
+  }
+
+  @Override
+  public boolean remove(Object element) {
+    if (element == null) {
+      return false;
+    }
+
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (int i = takeIndex, n = count.get(); n > 0;
+             i = increment(i), --n)
+        {
+          if (element.equals(items[i])) {
+            removeAt(i);
+            return true;
+          }
+        }
+        return false;
+      }
+    }
+  }
+
+  @Override
+  public boolean removeAll(Collection<?> c) {
+    boolean changed = false;
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (int i = takeIndex, n = count.get(); n > 0; --n) {
+          if (c.contains(items[i])) {
+            removeAt(i);
+            changed = true;
+          } else {
+            i = increment(i);
+          }
+        }
+      }
+    }
+    return changed;
+  }
+
+  @Override
+  public void clear() {
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (int i = 0; i < items.length; ++i) {
+          items[i] = null;
+        }
+        takeIndex = putIndex = 0;
+
+        if (count.getAndSet(0) == items.length) {
+          putLock.notifyAll();
+        }
+      }
+    }
+  }
+
+  @Override
+  public Object[] toArray() {
+    return snapshot().toArray();
+  }
+
+  @Override
+  public <S> S[] toArray(S[] array) {
+    return snapshot().toArray(array);
+  }
+
+  private ArrayList<T> snapshot() {
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        int n = count.get();
+        ArrayList<T> list = new ArrayList<T>(n);
+        for (int i = takeIndex; n > 0; i = increment(i), --n) {
+          list.add((T) items[i]);
+        }
+        return list;
+      }
+    }
+  }
+
+  // The iterator works on a snapshot of the queue taken when it was
+  // created, so it never throws ConcurrentModificationException.
+  @Override
+  public Iterator<T> iterator() {
+    return new MyIterator(snapshot());
+  }
+
+  private class MyIterator implements Iterator<T> {
+    private final ArrayList<T> elements;
+    private int index;
+    private T current;
+
+    public MyIterator(ArrayList<T> elements) {
+      this.elements = elements;
+    }
+
+    public boolean hasNext() {
+      return index < elements.size();
+    }
+
+    public T next() {
+      if (index == elements.size()) {
+        throw new NoSuchElementException();
+      }
+
+      return current = elements.get(index++);
+    }
+
+    public void remove() {
+      if (current == null) {
+        throw new IllegalStateException();
+      }
+
+      removeIdentical(current);
+      current = null;
+    }
+  }
+
+  // removes the specified element, as opposed to one which is merely
+  // equal to it, if it's still in the queue
+  private void removeIdentical(T element) {
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (int i = takeIndex, n = count.get(); n > 0;
+             i = increment(i), --n)
+        {
+          if (items[i] == element) {
+            removeAt(i);
+            return;
+          }
+        }
+      }
+    }
+  }
+}
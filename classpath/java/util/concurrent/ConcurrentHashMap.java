@@ -11,8 +11,6 @@
 package java.util.concurrent;
 
 import avian.Data;
-import avian.PersistentSet;
-import avian.PersistentSet.Path;
 
 import sun.misc.Unsafe;
 import java.util.AbstractMap;
@@ -22,47 +20,152 @@ import java.util.Collection;
 import java.util.Iterator;
 import java.util.NoSuchElementException;
 
+/**
+ * A hash table which may be read without locking and written by
+ * several threads at once.
+ *
+ * <p>The table is an array of bins, each of which is a chain of
+ * nodes.  A node is added to an empty bin with a compare-and-swap;
+ * otherwise, writers lock the first node of the bin, so writes to
+ * different bins don't contend.  Readers never lock: a node's key and
+ * hash never change, and its value and successor are volatile.
+ *
+ * <p>When the table grows, the bins are moved to a table of twice the
+ * size a range at a time, and each bin which has been moved is
+ * replaced by a forwarding node which points to the new table.  A
+ * writer which finds one helps move the remaining ranges before
+ * retrying, and a reader follows it.
+ */
 public class ConcurrentHashMap<K,V>
   extends AbstractMap<K,V>
   implements ConcurrentMap<K,V>
 {
   private static final Unsafe unsafe = Unsafe.getUnsafe();
-  private static final long Content;
-  private static final Content Empty = new Content(new PersistentSet(), 0);
+  private static final long ArrayBase = unsafe.arrayBaseOffset(Object.class);
+  private static final long ArrayScale = unsafe.arrayIndexScale
+    (Object.class);
+  private static final long SizeControl;
+  private static final long TransferIndex;
+  private static final long Count;
+  private static final long CounterCells;
+  private static final long CellValue;
 
   static {
     try {
-      Content = unsafe.objectFieldOffset
-        (ConcurrentHashMap.class.getDeclaredField("content"));
+      SizeControl = unsafe.objectFieldOffset
+        (ConcurrentHashMap.class.getDeclaredField("sizeControl"));
+      TransferIndex = unsafe.objectFieldOffset
+        (ConcurrentHashMap.class.getDeclaredField("transferIndex"));
+      Count = unsafe.objectFieldOffset
+        (ConcurrentHashMap.class.getDeclaredField("count"));
+      CounterCells = unsafe.objectFieldOffset
+        (ConcurrentHashMap.class.getDeclaredField("counterCells"));
+      CellValue = unsafe.objectFieldOffset
+        (CounterCell.class.getDeclaredField("value"));
     } catch (NoSuchFieldException e) {
       throw new Error(e);
     }
   }
 
-  private volatile Content<K,V> content;
+  private static final int DefaultCapacity = 16;
+  private static final int MaximumCapacity = 1 << 30;
 
-  public ConcurrentHashMap() {
-    content = Empty;
-  }
+  // the smallest number of bins a thread claims at a time when moving
+  // them to a bigger table
+  private static final int TransferStride = 16;
+
+  // while the table is being resized, the size control word holds a
+  // stamp identifying the size we're resizing from in the high bits
+  // and one more than the number of threads moving bins in the low
+  // bits
+  private static final int ResizeStampShift = 16;
+  private static final int MaximumResizers = (1 << ResizeStampShift) - 1;
+
+  private static final int CounterCellCount = 8;
+
+  // the hash of a forwarding node; those of other nodes are never
+  // negative
+  private static final int Moved = -1;
+  private static final int HashBits = 0x7fffffff;
+
+  private volatile Node<K,V>[] table;
+  private volatile Node<K,V>[] nextTable;
+
+  // the capacity to allocate when the table is null, -1 while it's
+  // being allocated, a resize stamp while it's being resized, and the
+  // size at which to resize it otherwise
+  private volatile int sizeControl;
+
+  // the bins below this index of the table being resized have not yet
+  // been claimed by a thread to move
+  private volatile int transferIndex;
+
+  // the size is the sum of this and the counter cells, which are only
+  // allocated once threads contend to update this
+  private volatile int count;
+  private volatile CounterCell[] counterCells;
+
+  public ConcurrentHashMap() { }
 
   public ConcurrentHashMap(int initialCapacity) {
-    this();
+    if (initialCapacity < 0) {
+      throw new IllegalArgumentException();
+    }
+
+    sizeControl = tableSize(initialCapacity + (initialCapacity >>> 1) + 1);
   }
 
   public ConcurrentHashMap(int initialCapacity,  float loadFactor) {
-    this();
+    this(initialCapacity);
   }
 
   public ConcurrentHashMap(int initialCapacity,  float loadFactor, int concurrencyLevel) {
-    this();
+    this(initialCapacity);
+  }
+
+  private static int tableSize(int capacity) {
+    if (capacity >= MaximumCapacity) {
+      return MaximumCapacity;
+    }
+
+    int n = 1;
+    while (n < capacity) {
+      n <<= 1;
+    }
+    return n;
+  }
+
+  private static int spread(int h) {
+    return (h ^ (h >>> 16)) & HashBits;
+  }
+
+  private static int resizeStamp(int n) {
+    return Integer.numberOfLeadingZeros(n) | (1 << (ResizeStampShift - 1));
+  }
+
+  private static <K,V> Node<K,V> tabAt(Node<K,V>[] tab, int i) {
+    return (Node<K,V>) unsafe.getObjectVolatile
+      (tab, ArrayBase + (i * ArrayScale));
+  }
+
+  private static <K,V> boolean casTabAt(Node<K,V>[] tab, int i,
+                                        Node<K,V> old, Node<K,V> new_)
+  {
+    return unsafe.compareAndSwapObject
+      (tab, ArrayBase + (i * ArrayScale), old, new_);
+  }
+
+  private static <K,V> void setTabAt(Node<K,V>[] tab, int i, Node<K,V> v) {
+    unsafe.putObjectVolatile(tab, ArrayBase + (i * ArrayScale), v);
   }
 
   public boolean isEmpty() {
-    return content.size == 0;
+    return sumCount() <= 0;
   }
 
   public int size() {
-    return content.size;
+    int n = sumCount();
+    return n < 0 ? 0 : n;
   }
 
   public boolean containsKey(Object key) {
@@ -70,8 +173,14 @@ public class ConcurrentHashMap<K,V>
   }
 
   public boolean containsValue(Object value) {
-    for (V v: values()) {
-      if (value.equals(v)) {
+    if (value == null) {
+      throw new NullPointerException();
+    }
+
+    Traverser<K,V> t = new Traverser(table);
+    for (Node<K,V> n = t.advance(); n != null; n = t.advance()) {
+      V v = n.value;
+      if (v == value || value.equals(v)) {
         return true;
       }
     }
@@ -79,53 +188,55 @@ public class ConcurrentHashMap<K,V>
   }
 
   public V get(Object key) {
-    Cell<K,V> cell = find(key);
-    return cell == null ? null : cell.value;
+    Node<K,V> node = find(key);
+    return node == null ? null : node.value;
   }
 
-  private Cell<K,V> find(Object key) {
-    Content<K,V> c = content;
-
-    Path<Node<Cell<K,V>>> path = c.set.find(new Node(key.hashCode()));
-    for (Cell<K,V> cell = path.value().value; 
-         cell != null;
-         cell = cell.next)
-    {
-      if (key.equals(cell.key)) {
-        return cell;
+  private Node<K,V> find(Object key) {
+    int h = spread(key.hashCode());
+    Node<K,V>[] tab = table;
+    while (tab != null) {
+      Node<K,V> e = tabAt(tab, (tab.length - 1) & h);
+      if (e == null) {
+        return null;
+      } else if (e.hash < 0) {
+        tab = ((ForwardingNode<K,V>) e).nextTable;
+      } else {
+        for (; e != null; e = e.next) {
+          if (e.hash == h && (e.key == key || key.equals(e.key))) {
+            return e;
+          }
+        }
+        return null;
       }
     }
     return null;
   }
 
   public V putIfAbsent(K key, V value) {
-    Cell<K,V> cell = put(key, value, PutCondition.IfAbsent, null);
-    return cell == null ? null : cell.value;
+    return put(key, value, PutCondition.IfAbsent, null);
   }
 
   public boolean remove(K key, V value) {
-    Cell<K,V> cell = remove(key, RemoveCondition.IfEqual, value);
-    return cell != null && cell.value.equals(value);
+    V v = remove(key, RemoveCondition.IfEqual, value);
+    return v != null && v.equals(value);
   }
 
   public V replace(K key, V value) {
-    Cell<K,V> cell = put(key, value, PutCondition.IfPresent, null);
-    return cell == null ? null : cell.value;
+    return put(key, value, PutCondition.IfPresent, null);
   }
 
   public boolean replace(K key, V oldValue, V newValue) {
-    Cell<K,V> cell = put(key, newValue, PutCondition.IfEqual, oldValue);
-    return cell != null && cell.value.equals(oldValue);    
+    V v = put(key, newValue, PutCondition.IfEqual, oldValue);
+    return v != null && v.equals(oldValue);
   }
 
   public V put(K key, V value) {
-    Cell<K,V> cell = put(key, value, PutCondition.Always, null);
-    return cell == null ? null : cell.value;
+    return put(key, value, PutCondition.Always, null);
   }
 
   public V remove(Object key) {
-    Cell<K,V> cell = remove(key, RemoveCondition.Always, null);
-    return cell == null ? null : cell.value;
+    return remove(key, RemoveCondition.Always, null);
   }
 
   private enum PutCondition {
@@ -134,7 +245,7 @@ public class ConcurrentHashMap<K,V>
       public <V> boolean addIfPresent(V a, V b) { return true; }
     }, IfAbsent() {
       public boolean addIfAbsent() { return true; }
-      public <V> boolean addIfPresent(V a, V b) { return false; }      
+      public <V> boolean addIfPresent(V a, V b) { return false; }
     }, IfPresent() {
       public boolean addIfAbsent() { return false; }
       public <V> boolean addIfPresent(V a, V b) { return true; }
@@ -157,69 +268,68 @@ public class ConcurrentHashMap<K,V>
     public <V> boolean remove(V a, V b) { throw new AssertionError(); }
   }
 
-  private Cell<K,V> put(K key, V value, PutCondition condition, V oldValue) {
-    Node<Cell<K,V>> node = new Node(key.hashCode());
+  // returns the value the key was mapped to, if any, whether or not
+  // the condition allowed us to replace it
+  private V put(K key, V value, PutCondition condition, V oldValue) {
+    if (key == null || value == null) {
+      throw new NullPointerException();
+    }
 
-    loop: while (true) {
-      node.value = null;
-      Content content = this.content;
-      Path<Node<Cell<K,V>>> path = content.set.find(node);
-      for (Cell<K,V> cell = path.value().value;
-           cell != null;
-           cell = cell.next)
-      {
-        if (key.equals(cell.key)) {
-          if (! condition.addIfPresent(cell.value, oldValue)) {
-            return cell;
-          }
+    int h = spread(key.hashCode());
+    Node<K,V>[] tab = table;
+    while (true) {
+      if (tab == null) {
+        tab = initTable();
+        continue;
+      }
 
-          Cell<K,V> start = null;
-          Cell<K,V> last = null;
-          for (Cell<K,V> cell2 = path.value().value;
-               true;
-               cell2 = cell2.next)
-          {
-            Cell<K,V> c;
-            c = cell2.clone();
-
-            if (last == null) {
-              last = start = c;
-            } else {
-              last.next = c;
-              last = c;
-            }
+      int i = (tab.length - 1) & h;
+      Node<K,V> f = tabAt(tab, i);
+      if (f == null) {
+        if (! condition.addIfAbsent()) {
+          return null;
+        }
 
-            if (cell2 == cell) {
-              c.value = value;
-              break;
+        if (casTabAt(tab, i, null, new Node(h, key, value, null))) {
+          addCount(1, true);
+          return null;
+        }
+      } else if (f.hash == Moved) {
+        tab = helpTransfer(tab, f);
+      } else {
+        V old = null;
+        boolean done = false;
+        boolean added = false;
+        synchronized (f) {
+          if (tabAt(tab, i) == f) {
+            done = true;
+            for (Node<K,V> e = f;; e = e.next) {
+              if (e.hash == h && (e.key == key || key.equals(e.key))) {
+                old = e.value;
+                if (condition.addIfPresent(old, oldValue)) {
+                  e.value = value;
+                }
+                break;
+              }
+
+              if (e.next == null) {
+                if (condition.addIfAbsent()) {
+                  e.next = new Node(h, key, value, null);
+                  added = true;
+                }
+                break;
+              }
             }
           }
+        }
 
-          node.value = start;
-          if (unsafe.compareAndSwapObject
-              (this, Content, content, new Content
-               (path.replaceWith(node), content.size)))
-          {
-            return cell;
-          } else {
-            continue loop;
+        if (done) {
+          if (added) {
+            addCount(1, true);
           }
+          return old;
         }
       }
-
-      // no mapping found -- add a new one if appropriate
-      if (! condition.addIfAbsent()) {
-        return null;
-      }
-
-      node.value = new Cell(key, value, null);
-      if (unsafe.compareAndSwapObject
-          (this, Content, content, new Content
-           (path.fresh() ? path.add() : path.replaceWith(node),
-            content.size + 1)))
-      {
-        return null;
-      }
     }
   }
 
@@ -229,64 +339,296 @@ public class ConcurrentHashMap<K,V>
     }
   }
 
-  private Cell<K,V> remove(Object key, RemoveCondition condition,
-                           V oldValue)
-  {
-    Node<Cell<K,V>> node = new Node(key.hashCode());
-
-    loop: while (true) {
-      node.value = null;
-      Content content = this.content;
-      Path<Node<Cell<K,V>>> path = content.set.find(node);
-      for (Cell<K,V> cell = path.value().value;
-           cell != null;
-           cell = cell.next)
-      {
-        if (key.equals(cell.key)) {
-          if (! condition.remove(cell.value, oldValue)) {
-            return cell;
-          }
-          
-          Cell<K,V> start = null;
-          Cell<K,V> last = null;
-          for (Cell<K,V> cell2 = path.value().value;
-               cell2 != cell;
-               cell2 = cell2.next)
-          {
-            Cell<K,V> c = cell2.clone();
-            if (last == null) {
-              last = start = c;
-            } else {
-              last.next = c;
-              last = c;
+  // returns the value the key was mapped to, if any, whether or not
+  // the condition allowed us to remove it
+  private V remove(Object key, RemoveCondition condition, V oldValue) {
+    int h = spread(key.hashCode());
+    Node<K,V>[] tab = table;
+    while (tab != null) {
+      int i = (tab.length - 1) & h;
+      Node<K,V> f = tabAt(tab, i);
+      if (f == null) {
+        return null;
+      } else if (f.hash == Moved) {
+        tab = helpTransfer(tab, f);
+      } else {
+        V old = null;
+        boolean done = false;
+        boolean removed = false;
+        synchronized (f) {
+          if (tabAt(tab, i) == f) {
+            done = true;
+            for (Node<K,V> e = f, pred = null; e != null;
+                 pred = e, e = e.next)
+            {
+              if (e.hash == h && (e.key == key || key.equals(e.key))) {
+                old = e.value;
+                if (condition.remove(old, oldValue)) {
+                  if (pred == null) {
+                    setTabAt(tab, i, e.next);
+                  } else {
+                    pred.next = e.next;
+                  }
+                  removed = true;
+                }
+                break;
+              }
             }
           }
+        }
 
-          if (last == null) {
-            start = last = cell.next;
-          } else {
-            last.next = cell.next;
+        if (done) {
+          if (removed) {
+            addCount(-1, false);
           }
+          return old;
+        }
+      }
+    }
+    return null;
+  }
 
-          node.value = start;
-          if (unsafe.compareAndSwapObject
-              (this, Content, content, new Content
-               (start == null ? path.remove() : path.replaceWith(node),
-                content.size - 1)))
-          {
-            return cell;
-          } else {
-            continue loop;
+  public void clear() {
+    int removed = 0;
+    Node<K,V>[] tab = table;
+    int i = 0;
+    while (tab != null && i < tab.length) {
+      Node<K,V> f = tabAt(tab, i);
+      if (f == null) {
+        ++ i;
+      } else if (f.hash == Moved) {
+        tab = helpTransfer(tab, f);
+        i = 0;
+      } else {
+        synchronized (f) {
+          if (tabAt(tab, i) == f) {
+            for (Node<K,V> e = f; e != null; e = e.next) {
+              ++ removed;
+            }
+            setTabAt(tab, i++, null);
           }
         }
       }
+    }
 
-      return null;
+    if (removed != 0) {
+      addCount(-removed, false);
     }
   }
 
-  public void clear() {
-    content = Empty;
+  private Node<K,V>[] initTable() {
+    Node<K,V>[] tab;
+    while ((tab = table) == null) {
+      int sc = sizeControl;
+      if (sc < 0) {
+        // another thread is allocating it
+        Thread.yield();
+      } else if (unsafe.compareAndSwapInt(this, SizeControl, sc, -1)) {
+        try {
+          if ((tab = table) == null) {
+            int n = sc > 0 ? sc : DefaultCapacity;
+            tab = new Node[n];
+            table = tab;
+            sc = n - (n >>> 2);
+          }
+        } finally {
+          sizeControl = sc;
+        }
+        break;
+      }
+    }
+    return tab;
+  }
+
+  private int sumCount() {
+    int sum = count;
+    CounterCell[] cells = counterCells;
+    if (cells != null) {
+      for (int i = 0; i < cells.length; ++i) {
+        sum += cells[i].value;
+      }
+    }
+    return sum;
+  }
+
+  // adds to the size, and, if it grew, resizes the table or helps a
+  // resize which is in progress as necessary
+  private void addCount(int delta, boolean grew) {
+    CounterCell[] cells = counterCells;
+    int c;
+    if (cells != null
+        || ! unsafe.compareAndSwapInt(this, Count, c = count, c + delta))
+    {
+      if (cells == null) {
+        cells = new CounterCell[CounterCellCount];
+        for (int i = 0; i < cells.length; ++i) {
+          cells[i] = new CounterCell();
+        }
+        if (! unsafe.compareAndSwapObject(this, CounterCells, null, cells)) {
+          cells = counterCells;
+        }
+      }
+
+      CounterCell cell = cells
+        [System.identityHashCode(Thread.currentThread()) & (cells.length - 1)];
+      int v;
+      while (! unsafe.compareAndSwapInt(cell, CellValue, v = cell.value,
+                                        v + delta))
+      { }
+    }
+
+    if (! grew) {
+      return;
+    }
+
+    int s = sumCount();
+    Node<K,V>[] tab;
+    int sc;
+    while (s >= (sc = sizeControl) && (tab = table) != null
+           && tab.length < MaximumCapacity)
+    {
+      int rs = resizeStamp(tab.length) << ResizeStampShift;
+      if (sc < 0) {
+        Node<K,V>[] nt = nextTable;
+        if ((sc >>> ResizeStampShift) != (rs >>> ResizeStampShift)
+            || sc == rs + 1 || sc == rs + MaximumResizers || nt == null
+            || transferIndex <= 0)
+        {
+          break;
+        }
+
+        if (unsafe.compareAndSwapInt(this, SizeControl, sc, sc + 1)) {
+          transfer(tab, nt);
+        }
+      } else if (unsafe.compareAndSwapInt(this, SizeControl, sc, rs + 2)) {
+        transfer(tab, null);
+      }
+      s = sumCount();
+    }
+  }
+
+  // helps move bins to the table the specified forwarding node refers
+  // to, returning that table
+  private Node<K,V>[] helpTransfer(Node<K,V>[] tab, Node<K,V> f) {
+    Node<K,V>[] nextTab = ((ForwardingNode<K,V>) f).nextTable;
+    int rs = resizeStamp(tab.length) << ResizeStampShift;
+    int sc;
+    while (nextTab == nextTable && table == tab && (sc = sizeControl) < 0) {
+      if ((sc >>> ResizeStampShift) != (rs >>> ResizeStampShift)
+          || sc == rs + 1 || sc == rs + MaximumResizers
+          || transferIndex <= 0)
+      {
+        break;
+      }
+
+      if (unsafe.compareAndSwapInt(this, SizeControl, sc, sc + 1)) {
+        transfer(tab, nextTab);
+        break;
+      }
+    }
+    return nextTab;
+  }
+
+  // moves bins from the specified table to one twice its size, which
+  // is allocated if null, claiming a range of bins at a time until none
+  // are left.  The last thread to finish installs the new table.
+  private void transfer(Node<K,V>[] tab, Node<K,V>[] nextTab) {
+    int n = tab.length;
+    if (nextTab == null) {
+      nextTab = new Node[n << 1];
+      nextTable = nextTab;
+      transferIndex = n;
+    }
+
+    ForwardingNode<K,V> forward = new ForwardingNode(nextTab);
+    boolean advance = true;
+    boolean finishing = false;
+    for (int i = 0, bound = 0;;) {
+      while (advance) {
+        int nextIndex;
+        if (--i >= bound || finishing) {
+          advance = false;
+        } else if ((nextIndex = transferIndex) <= 0) {
+          i = -1;
+          advance = false;
+        } else {
+          int nextBound = nextIndex > TransferStride
+            ? nextIndex - TransferStride : 0;
+          if (unsafe.compareAndSwapInt
+              (this, TransferIndex, nextIndex, nextBound))
+          {
+            bound = nextBound;
+            i = nextIndex - 1;
+            advance = false;
+          }
+        }
+      }
+
+      if (i < 0) {
+        if (finishing) {
+          nextTable = null;
+          table = nextTab;
+          sizeControl = (n << 1) - (n >>> 1);
+          return;
+        }
+
+        int sc;
+        if (unsafe.compareAndSwapInt
+            (this, SizeControl, sc = sizeControl, sc - 1))
+        {
+          if (sc - 2 != resizeStamp(n) << ResizeStampShift) {
+            // another thread is still moving bins and will finish up
+            return;
+          }
+
+          // we're the last, so make sure nothing was missed before
+          // installing the new table
+          finishing = advance = true;
+          i = n;
+        }
+        continue;
+      }
+
+      Node<K,V> f = tabAt(tab, i);
+      if (f == null) {
+        advance = casTabAt(tab, i, null, forward);
+      } else if (f.hash == Moved) {
+        advance = true;
+      } else {
+        synchronized (f) {
+          if (tabAt(tab, i) == f) {
+            // nodes either stay at the same index or move up by n.
+            // Reuse the longest run at the end of the chain which all go
+            // the same way, and copy the rest, since readers may still
+            // be walking the old chain.
+            int runBit = f.hash & n;
+            Node<K,V> lastRun = f;
+            for (Node<K,V> p = f.next; p != null; p = p.next) {
+              int b = p.hash & n;
+              if (b != runBit) {
+                runBit = b;
+                lastRun = p;
+              }
+            }
+
+            Node<K,V> low = runBit == 0 ? lastRun : null;
+            Node<K,V> high = runBit == 0 ? null : lastRun;
+            for (Node<K,V> p = f; p != lastRun; p = p.next) {
+              if ((p.hash & n) == 0) {
+                low = new Node(p.hash, p.key, p.value, low);
+              } else {
+                high = new Node(p.hash, p.key, p.value, high);
+              }
+            }
+
+            setTabAt(nextTab, i, low);
+            setTabAt(nextTab, i + n, high);
+            setTabAt(tab, i, forward);
+            advance = true;
+          }
+        }
+      }
+    }
   }
 
   public Set<Map.Entry<K, V>> entrySet() {
@@ -307,12 +649,14 @@ public class ConcurrentHashMap<K,V>
     }
 
     public Map.Entry<K,V> find(Object key) {
-      return new MyEntry(ConcurrentHashMap.this.find(key));
+      Node<K,V> node = ConcurrentHashMap.this.find(key);
+      return node == null ? null : new MyEntry(node.key, node.value);
     }
 
     public Map.Entry<K,V> remove(Object key) {
-      return new MyEntry
-        (ConcurrentHashMap.this.remove(key, RemoveCondition.Always, null));
+      V value = ConcurrentHashMap.this.remove
+        (key, RemoveCondition.Always, null);
+      return value == null ? null : new MyEntry((K) key, value);
     }
 
     public void clear() {
@@ -320,62 +664,99 @@ public class ConcurrentHashMap<K,V>
     }
 
     public Iterator<Map.Entry<K,V>> iterator() {
-      return new MyIterator(content);
+      return new MyIterator(table);
     }
   }
 
-  private static class Content<K,V> {
-    private final PersistentSet<Node<Cell<K,V>>> set;
-    private final int size;
-
-    public Content(PersistentSet<Node<Cell<K,V>>> set,
-                   int size)
-    {
-      this.set = set;
-      this.size = size;
-    }
-  }
-
-  private static class Cell<K,V> implements Cloneable {
+  private static class Node<K,V> {
+    public final int hash;
     public final K key;
-    public V value;
-    public Cell<K,V> next;
+    public volatile V value;
+    public volatile Node<K,V> next;
 
-    public Cell(K key, V value, Cell<K,V> next) {
+    public Node(int hash, K key, V value, Node<K,V> next) {
+      this.hash = hash;
       this.key = key;
       this.value = value;
       this.next = next;
     }
+  }
 
-    public Cell<K,V> clone() {
-      try {
-        return (Cell<K,V>) super.clone();
-      } catch (CloneNotSupportedException e) {
-        throw new AssertionError();
-      }
+  private static class ForwardingNode<K,V> extends Node<K,V> {
+    public final Node<K,V>[] nextTable;
+
+    public ForwardingNode(Node<K,V>[] nextTable) {
+      super(Moved, null, null, null);
+      this.nextTable = nextTable;
     }
   }
 
-  private static class Node<T> implements Comparable<Node<T>> {
-    public final int key;
-    public T value;
+  private static class CounterCell {
+    public volatile int value;
+  }
 
-    public Node(int key) {
-      this.key = key;
+  // visits each node of a table, following forwarding nodes to the
+  // bins they were moved to.  A bin at index i of a table of size n
+  // moves to indexes i and i + n of the next table.
+  private static class Traverser<K,V> {
+    private Frame<K,V> frame;
+    private Node<K,V> next;
+
+    public Traverser(Node<K,V>[] table) {
+      if (table != null) {
+        frame = new Frame(table, 0, 1, null);
+      }
     }
 
-    public int compareTo(Node<T> n) {
-      return key - n.key;
+    public Node<K,V> advance() {
+      Node<K,V> e = next;
+      if (e != null) {
+        e = e.next;
+      }
+
+      while (e == null) {
+        Frame<K,V> f = frame;
+        if (f == null) {
+          break;
+        } else if (f.index >= f.table.length) {
+          frame = f.next;
+        } else {
+          int i = f.index;
+          e = tabAt(f.table, i);
+          f.index += f.step;
+          if (e != null && e.hash < 0) {
+            frame = new Frame
+              (((ForwardingNode<K,V>) e).nextTable, i, f.table.length, f);
+            e = null;
+          }
+        }
+      }
+
+      return next = e;
+    }
+  }
+
+  private static class Frame<K,V> {
+    public final Node<K,V>[] table;
+    public int index;
+    public final int step;
+    public final Frame<K,V> next;
+
+    public Frame(Node<K,V>[] table, int index, int step, Frame<K,V> next) {
+      this.table = table;
+      this.index = index;
+      this.step = step;
+      this.next = next;
     }
   }
 
   private class MyEntry implements Map.Entry<K,V> {
     private final K key;
     private V value;
-    
-    public MyEntry(Cell<K,V> cell) {
-      key = cell.key;
-      value = cell.value;
+
+    public MyEntry(K key, V value) {
+      this.key = key;
+      this.value = value;
     }
 
     public K getKey() {
@@ -387,7 +768,7 @@ public class ConcurrentHashMap<K,V>
     }
 
     public V setValue(V value) {
-      V v = value;
+      V v = this.value;
       this.value = value;
       put(key, value);
       return v;
@@ -395,41 +776,36 @@ public class ConcurrentHashMap<K,V>
   }
 
   private class MyIterator implements Iterator<Map.Entry<K, V>> {
-    private final Content<K,V> content;
-    private final Iterator<Node<Cell<K, V>>> iterator;
-    private Cell<K, V> currentCell;
-    private Cell<K, V> nextCell;
+    private final Traverser<K,V> traverser;
+    private Node<K, V> currentNode;
+    private Node<K, V> nextNode;
 
-    public MyIterator(Content<K,V> content) {
-      this.content = content;
-      this.iterator = content.set.iterator();
-      hasNext();
+    public MyIterator(Node<K,V>[] table) {
+      traverser = new Traverser(table);
+      nextNode = traverser.advance();
     }
 
     public Map.Entry<K, V> next() {
       if (hasNext()) {
-        currentCell = nextCell;
+        currentNode = nextNode;
 
-        nextCell = nextCell.next;
+        nextNode = traverser.advance();
 
-        return new MyEntry(currentCell);
+        return new MyEntry(currentNode.key, currentNode.value);
       } else {
         throw new NoSuchElementException();
       }
     }
 
     public boolean hasNext() {
-      if (nextCell == null && iterator.hasNext()) {
-        nextCell = iterator.next().value;
-      }
-      return nextCell != null;
+      return nextNode != null;
     }
 
     public void remove() {
-      if (currentCell != null) {
+      if (currentNode != null) {
         ConcurrentHashMap.this.remove
-          (currentCell.key, RemoveCondition.Always, null);
-        currentCell = null;
+          (currentNode.key, RemoveCondition.Always, null);
+        currentNode = null;
       } else {
         throw new IllegalStateException();
       }
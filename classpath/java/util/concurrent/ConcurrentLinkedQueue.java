@@ -11,28 +11,43 @@
 package java.util.concurrent;
 
 import java.util.AbstractQueue;
-import java.util.Collection;
+import java.util.ArrayList;
 import java.util.Iterator;
+import java.util.NoSuchElementException;
 
-import avian.Atomic;
+import sun.misc.Unsafe;
 
+/**
+ * A lock-free queue, after Michael and Scott.
+ *
+ * <p>The head is a placeholder whose successor is the first element.
+ * A node's element is claimed, whether by a consumer or by a removal
+ * from the middle of the queue, by swapping it for null, and nodes
+ * whose elements have been claimed are dropped as the head passes
+ * them.
+ */
 public class ConcurrentLinkedQueue<T> extends AbstractQueue<T> {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
   private static final long QueueHead;
   private static final long QueueTail;
   private static final long NodeNext;
+  private static final long NodeValue;
 
   static {
     try {
-      QueueHead = Atomic.getOffset
-        (ConcurrentLinkedQueue.class.getField("head"));
+      QueueHead = unsafe.objectFieldOffset
+        (ConcurrentLinkedQueue.class.getDeclaredField("head"));
 
-      QueueTail = Atomic.getOffset
-        (ConcurrentLinkedQueue.class.getField("tail"));
+      QueueTail = unsafe.objectFieldOffset
+        (ConcurrentLinkedQueue.class.getDeclaredField("tail"));
 
-      NodeNext = Atomic.getOffset
-        (Node.class.getField("next"));
+      NodeNext = unsafe.objectFieldOffset
+        (Node.class.getDeclaredField("next"));
+
+      NodeValue = unsafe.objectFieldOffset
+        (Node.class.getDeclaredField("value"));
     } catch (NoSuchFieldException e) {
-      throw new RuntimeException(e);
+      throw new Error(e);
     }
   }
 
@@ -48,21 +63,25 @@ public class ConcurrentLinkedQueue<T> extends AbstractQueue<T> {
   @Override
   public boolean offer(T element) {
     add(element);
-    
+
     return true;
   }
 
   @Override
   public boolean add(T value) {
+    if (value == null) {
+      throw new NullPointerException();
+    }
+
     Node<T> n = new Node<T>(value, null);
     while (true) {
       Node<T> t = tail;
-      Node<T> next = tail.next;
+      Node<T> next = t.next;
       if (t == tail) {
         if (next != null) {
-          Atomic.compareAndSwapObject(this, QueueTail, t, next);
-        } else if (Atomic.compareAndSwapObject(tail, NodeNext, null, n)) {
-          Atomic.compareAndSwapObject(this, QueueTail, t, n);
+          unsafe.compareAndSwapObject(this, QueueTail, t, next);
+        } else if (unsafe.compareAndSwapObject(t, NodeNext, null, n)) {
+          unsafe.compareAndSwapObject(this, QueueTail, t, n);
           break;
         }
       }
@@ -85,20 +104,25 @@ public class ConcurrentLinkedQueue<T> extends AbstractQueue<T> {
     while (true) {
       Node<T> h = head;
       Node<T> t = tail;
-      Node<T> next = head.next;
+      Node<T> next = h.next;
 
       if (h == head) {
         if (h == t) {
           if (next != null) {
-            Atomic.compareAndSwapObject(this, QueueTail, t, next);
+            unsafe.compareAndSwapObject(this, QueueTail, t, next);
           } else {
             return null;
           }
         } else {
           T value = next.value;
-          if ((! remove)
-              || Atomic.compareAndSwapObject(this, QueueHead, h, next))
+          if (value == null) {
+            // removed from the middle of the queue; step past it
+            unsafe.compareAndSwapObject(this, QueueHead, h, next);
+          } else if (! remove) {
+            return value;
+          } else if (unsafe.compareAndSwapObject(next, NodeValue, value, null))
           {
+            unsafe.compareAndSwapObject(this, QueueHead, h, next);
             return value;
           }
         }
@@ -116,56 +140,127 @@ public class ConcurrentLinkedQueue<T> extends AbstractQueue<T> {
     }
   }
 
+  // The following are weakly consistent: they see each element which
+  // was in the queue throughout, and may or may not see those added or
+  // removed meanwhile.
+
   @Override
   public int size() {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+    int size = 0;
+    for (Node<T> n = head.next; n != null; n = n.next) {
+      if (n.value != null && ++ size == Integer.MAX_VALUE) {
+        break;
+      }
+    }
+    return size;
   }
 
   @Override
   public boolean isEmpty() {
-    return size() == 0;
+    return peek() == null;
   }
 
   @Override
   public boolean contains(Object element) {
-    // TODO - implement
-    throw new UnsupportedOperationException();
-  }
-
-  @Override
-  public boolean containsAll(Collection<?> c) {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+    if (element != null) {
+      for (Node<T> n = head.next; n != null; n = n.next) {
+        if (element.equals(n.value)) {
+          return true;
+        }
+      }
+    }
+    return false;
   }
 
   @Override
   public boolean remove(Object element) {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+    if (element != null) {
+      for (Node<T> n = head.next; n != null; n = n.next) {
+        T value = n.value;
+        if (element.equals(value)
+            && unsafe.compareAndSwapObject(n, NodeValue, value, null))
+        {
+          return true;
+        }
+      }
+    }
+    return false;
   }
 
-  @Override
-  public boolean removeAll(Collection<?> c) {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+  private ArrayList<T> snapshot() {
+    ArrayList<T> list = new ArrayList<T>();
+    for (Node<T> n = head.next; n != null; n = n.next) {
+      T value = n.value;
+      if (value != null) {
+        list.add(value);
+      }
+    }
+    return list;
   }
 
   @Override
   public Object[] toArray() {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+    return snapshot().toArray();
   }
 
   @Override
   public <S> S[] toArray(S[] array) {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+    return snapshot().toArray(array);
   }
 
   @Override
   public Iterator<T> iterator() {
-    // TODO - implement
-    throw new UnsupportedOperationException();
+    return new MyIterator();
+  }
+
+  private class MyIterator implements Iterator<T> {
+    private Node<T> current;
+    private Node<T> nextNode;
+    private T nextValue;
+
+    public MyIterator() {
+      advance(head);
+    }
+
+    // finds the first live node after the specified one
+    private void advance(Node<T> n) {
+      for (n = n.next; n != null; n = n.next) {
+        T value = n.value;
+        if (value != null) {
+          nextNode = n;
+          nextValue = value;
+          return;
+        }
+      }
+      nextNode = null;
+      nextValue = null;
+    }
+
+    public boolean hasNext() {
+      return nextNode != null;
+    }
+
+    public T next() {
+      if (nextNode == null) {
+        throw new NoSuchElementException();
+      }
+
+      T result = nextValue;
+      current = nextNode;
+      advance(nextNode);
+      return result;
+    }
+
+    public void remove() {
+      if (current == null) {
+        throw new IllegalStateException();
+      }
+
+      T value = current.value;
+      if (value != null) {
+        unsafe.compareAndSwapObject(current, NodeValue, value, null);
+      }
+      current = null;
+    }
   }
 }
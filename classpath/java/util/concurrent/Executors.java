@@ -11,6 +11,22 @@
 package java.util.concurrent;
 
 public class Executors {
+  public static ScheduledExecutorService newScheduledThreadPool
+    (int corePoolSize)
+  {
+    return new ScheduledThreadPoolExecutor(corePoolSize);
+  }
+
+  public static ScheduledExecutorService newScheduledThreadPool
+    (int corePoolSize, ThreadFactory threadFactory)
+  {
+    return new ScheduledThreadPoolExecutor(corePoolSize, threadFactory);
+  }
+
+  public static ScheduledExecutorService newSingleThreadScheduledExecutor() {
+    return new ScheduledThreadPoolExecutor(1);
+  }
+
   public static <T> Callable<T> callable(final Runnable task, final T result) {
     return new Callable<T>() {
       @Override
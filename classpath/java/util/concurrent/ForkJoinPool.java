@@ -0,0 +1,559 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.Collections;
+import java.util.List;
+import java.util.concurrent.locks.LockSupport;
+
+import sun.misc.Unsafe;
+
+/**
+ * An executor whose workers each keep a deque of the tasks they fork,
+ * taking them from the top and, when they run out, stealing tasks from
+ * the bottom of the others' deques.
+ *
+ * <p>Tasks submitted from outside the pool go on a shared deque which
+ * workers steal from in the same way.  Workers start as work arrives,
+ * up to the parallelism, and park when there's nothing to steal; a
+ * thread which pushes a task unparks one of them.
+ */
+public class ForkJoinPool implements ExecutorService {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long ArrayBase = unsafe.arrayBaseOffset(Object.class);
+  private static final long ArrayScale = unsafe.arrayIndexScale
+    (Object.class);
+  private static final long StartedOffset;
+
+  static {
+    try {
+      StartedOffset = unsafe.objectFieldOffset
+        (ForkJoinPool.class.getDeclaredField("started"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  static final ForkJoinPool common = new ForkJoinPool
+    (Math.max(1, Runtime.getRuntime().availableProcessors() - 1), true);
+
+  private static int poolCount;
+
+  private final int parallelism;
+  private final boolean isCommon;
+  private final String namePrefix;
+
+  // the first queue holds tasks submitted from outside the pool, and
+  // the rest belong to the workers
+  private final WorkQueue[] queues;
+
+  private final ConcurrentLinkedQueue<ForkJoinWorkerThread> idle
+    = new ConcurrentLinkedQueue<ForkJoinWorkerThread>();
+
+  // the number of workers started so far
+  private volatile int started;
+
+  // the number of workers which haven't exited; guarded by this pool's
+  // monitor
+  private int live;
+
+  private volatile boolean shutdown;
+
+  public ForkJoinPool() {
+    this(Runtime.getRuntime().availableProcessors());
+  }
+
+  public ForkJoinPool(int parallelism) {
+    this(parallelism, false);
+  }
+
+  private ForkJoinPool(int parallelism, boolean isCommon) {
+    if (parallelism <= 0) {
+      throw new IllegalArgumentException();
+    }
+
+    this.parallelism = parallelism;
+    this.isCommon = isCommon;
+
+    if (isCommon) {
+      namePrefix = "ForkJoinPool.commonPool-worker-";
+    } else {
+      synchronized (ForkJoinPool.class) {
+        namePrefix = "ForkJoinPool-" + (++ poolCount) + "-worker-";
+      }
+    }
+
+    queues = new WorkQueue[parallelism + 1];
+    for (int i = 0; i < queues.length; ++i) {
+      queues[i] = new WorkQueue(this, i);
+    }
+  }
+
+  public static ForkJoinPool commonPool() {
+    return common;
+  }
+
+  public static int getCommonPoolParallelism() {
+    return common.parallelism;
+  }
+
+  public int getParallelism() {
+    return parallelism;
+  }
+
+  public int getPoolSize() {
+    return started;
+  }
+
+  String workerName(int index) {
+    return namePrefix + index;
+  }
+
+  // wakes an idle worker, or starts a new one if none are idle and we
+  // haven't reached the parallelism yet
+  void signalWork() {
+    ForkJoinWorkerThread w = idle.poll();
+    if (w != null) {
+      LockSupport.unpark(w);
+      return;
+    }
+
+    int c;
+    while ((c = started) < parallelism) {
+      if (unsafe.compareAndSwapInt(this, StartedOffset, c, c + 1)) {
+        synchronized (this) {
+          ++ live;
+        }
+        new ForkJoinWorkerThread(this, queues[c + 1]).start();
+        return;
+      }
+    }
+  }
+
+  private boolean hasQueuedTasks() {
+    for (int i = 0; i < queues.length; ++i) {
+      if (! queues[i].isEmpty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // steals a task from any queue but the specified one, starting at a
+  // random one so that thieves spread out
+  private ForkJoinTask<?> scan(WorkQueue q) {
+    int n = queues.length;
+    int start = (q.nextSeed() >>> 1) % n;
+    for (int i = 0; i < n; ++i) {
+      WorkQueue victim = queues[(start + i) % n];
+      if (victim != q) {
+        ForkJoinTask<?> t = victim.poll();
+        if (t != null) {
+          return t;
+        }
+      }
+    }
+    return null;
+  }
+
+  void runWorker(ForkJoinWorkerThread w) {
+    WorkQueue q = w.workQueue;
+    try {
+      while (true) {
+        ForkJoinTask<?> t = q.pop();
+        if (t == null) {
+          t = scan(q);
+        }
+
+        if (t != null) {
+          t.doExec();
+        } else if (shutdown && ! hasQueuedTasks()) {
+          break;
+        } else {
+          // advertise that we're idle before checking once more for
+          // work, so that a thread which pushes a task after our check
+          // is sure to find us
+          idle.add(w);
+          if (! (shutdown || hasQueuedTasks())) {
+            LockSupport.park(this);
+          }
+          idle.remove(w);
+        }
+      }
+    } finally {
+      synchronized (this) {
+        if (-- live == 0) {
+          notifyAll();
+        }
+      }
+    }
+  }
+
+  // runs other tasks while waiting for the specified one to finish
+  void awaitJoin(WorkQueue q, ForkJoinTask<?> task) {
+    boolean interrupted = false;
+    while (task.status == ForkJoinTask.Pending) {
+      ForkJoinTask<?> t = q.pop();
+      if (t == null) {
+        t = scan(q);
+      }
+
+      if (t != null) {
+        t.doExec();
+      } else {
+        // whoever took the task is running it.  Look again now and
+        // then in case it forks something we can help with.
+        try {
+          task.awaitDone(1);
+        } catch (InterruptedException e) {
+          interrupted = true;
+        }
+      }
+    }
+
+    if (interrupted) {
+      Thread.currentThread().interrupt();
+    }
+  }
+
+  void externalPush(ForkJoinTask<?> task) {
+    WorkQueue q = queues[0];
+    synchronized (q) {
+      q.push(task);
+    }
+  }
+
+  boolean tryExternalUnpush(ForkJoinTask<?> task) {
+    WorkQueue q = queues[0];
+    synchronized (q) {
+      return q.tryUnpush(task);
+    }
+  }
+
+  private void push(ForkJoinTask<?> task) {
+    if (task == null) {
+      throw new NullPointerException();
+    }
+
+    if (shutdown) {
+      throw new RejectedExecutionException();
+    }
+
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread
+        && ((ForkJoinWorkerThread) t).pool == this)
+    {
+      ((ForkJoinWorkerThread) t).workQueue.push(task);
+    } else {
+      externalPush(task);
+    }
+  }
+
+  public <T> T invoke(ForkJoinTask<T> task) {
+    push(task);
+    return task.join();
+  }
+
+  public void execute(ForkJoinTask<?> task) {
+    push(task);
+  }
+
+  public void execute(Runnable task) {
+    push(task instanceof ForkJoinTask
+         ? (ForkJoinTask<?>) task : ForkJoinTask.adapt(task));
+  }
+
+  public <T> ForkJoinTask<T> submit(ForkJoinTask<T> task) {
+    push(task);
+    return task;
+  }
+
+  public <T> ForkJoinTask<T> submit(Callable<T> task) {
+    ForkJoinTask<T> t = ForkJoinTask.adapt(task);
+    push(t);
+    return t;
+  }
+
+  public <T> ForkJoinTask<T> submit(Runnable task, T result) {
+    ForkJoinTask<T> t = ForkJoinTask.adapt(task, result);
+    push(t);
+    return t;
+  }
+
+  public ForkJoinTask<?> submit(Runnable task) {
+    ForkJoinTask<?> t = task instanceof ForkJoinTask
+      ? (ForkJoinTask<?>) task : ForkJoinTask.adapt(task);
+    push(t);
+    return t;
+  }
+
+  public <T> List<Future<T>> invokeAll(Collection<? extends Callable<T>> tasks)
+  {
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    for (Callable<T> c: tasks) {
+      futures.add(submit(c));
+    }
+    for (Future<T> f: futures) {
+      ((ForkJoinTask<T>) f).quietlyJoin();
+    }
+    return futures;
+  }
+
+  public <T> List<Future<T>> invokeAll(Collection<? extends Callable<T>> tasks,
+                                       long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    long deadline = System.currentTimeMillis() + unit.toMillis(timeout);
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    for (Callable<T> c: tasks) {
+      futures.add(submit(c));
+    }
+    for (Future<T> f: futures) {
+      long remaining = deadline - System.currentTimeMillis();
+      try {
+        f.get(remaining, TimeUnit.MILLISECONDS);
+      } catch (ExecutionException e) {
+        // reported through the future
+      } catch (CancellationException e) {
+        // likewise
+      } catch (TimeoutException e) {
+        for (Future<T> g: futures) {
+          g.cancel(false);
+        }
+        break;
+      }
+    }
+    return futures;
+  }
+
+  public <T> T invokeAny(Collection<? extends Callable<T>> tasks)
+    throws InterruptedException, ExecutionException
+  {
+    try {
+      return invokeAny(tasks, Long.MAX_VALUE, TimeUnit.MILLISECONDS);
+    } catch (TimeoutException e) {
+      // not possible
+      throw new RuntimeException(e);
+    }
+  }
+
+  public <T> T invokeAny(Collection<? extends Callable<T>> tasks,
+                         long timeout, TimeUnit unit)
+    throws InterruptedException, ExecutionException, TimeoutException
+  {
+    if (tasks.isEmpty()) {
+      throw new IllegalArgumentException();
+    }
+
+    long millis = unit.toMillis(timeout);
+    long deadline = millis == Long.MAX_VALUE
+      ? Long.MAX_VALUE : System.currentTimeMillis() + millis;
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    for (Callable<T> c: tasks) {
+      futures.add(submit(c));
+    }
+
+    try {
+      ExecutionException failure = null;
+      for (Future<T> f: futures) {
+        try {
+          return f.get(deadline == Long.MAX_VALUE
+                       ? Long.MAX_VALUE
+                       : deadline - System.currentTimeMillis(),
+                       TimeUnit.MILLISECONDS);
+        } catch (ExecutionException e) {
+          failure = e;
+        } catch (CancellationException e) {
+          failure = new ExecutionException(e);
+        }
+      }
+      throw failure;
+    } finally {
+      for (Future<T> f: futures) {
+        f.cancel(false);
+      }
+    }
+  }
+
+  // the common pool can't be shut down, since anything may be using it
+  public void shutdown() {
+    if (! isCommon) {
+      shutdown = true;
+      for (ForkJoinWorkerThread w = idle.poll(); w != null; w = idle.poll()) {
+        LockSupport.unpark(w);
+      }
+    }
+  }
+
+  public List<Runnable> shutdownNow() {
+    if (! isCommon) {
+      for (int i = 0; i < queues.length; ++i) {
+        for (ForkJoinTask<?> t = queues[i].poll(); t != null;
+             t = queues[i].poll())
+        {
+          t.cancel(false);
+        }
+      }
+      shutdown();
+    }
+    return Collections.emptyList();
+  }
+
+  public boolean isShutdown() {
+    return shutdown;
+  }
+
+  public synchronized boolean isTerminated() {
+    return shutdown && live == 0;
+  }
+
+  public boolean awaitTermination(long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    long remaining = unit.toMillis(timeout);
+    long deadline = System.currentTimeMillis() + remaining;
+    synchronized (this) {
+      while (! (shutdown && live == 0)) {
+        if (remaining <= 0) {
+          return false;
+        }
+        wait(remaining);
+        remaining = deadline - System.currentTimeMillis();
+      }
+      return true;
+    }
+  }
+
+  /**
+   * A deque of tasks.  Its owner pushes and pops at the top, and other
+   * threads steal from the base, each side claiming a task by swapping
+   * its slot for null, so that the owner and a thief racing for the
+   * last task can't both get it.  The submission queue has no owner,
+   * so pushes and pops are done holding the queue's monitor instead.
+   */
+  static final class WorkQueue {
+    private static final int InitialCapacity = 1 << 8;
+
+    final ForkJoinPool pool;
+    final int index;
+    private int seed;
+    private volatile ForkJoinTask<?>[] array
+      = new ForkJoinTask<?>[InitialCapacity];
+    private volatile int base;
+    private volatile int top;
+
+    WorkQueue(ForkJoinPool pool, int index) {
+      this.pool = pool;
+      this.index = index;
+      this.seed = index * 0x9e3779b9 | 1;
+    }
+
+    // returns the next value of a xorshift generator, for picking the
+    // queues to steal from; only used by the owner
+    int nextSeed() {
+      int s = seed;
+      s ^= s << 13;
+      s ^= s >>> 17;
+      s ^= s << 5;
+      return seed = s;
+    }
+
+    private static long slot(ForkJoinTask<?>[] a, int i) {
+      return ArrayBase + ((i & (a.length - 1)) * ArrayScale);
+    }
+
+    boolean isEmpty() {
+      return top - base <= 0;
+    }
+
+    void push(ForkJoinTask<?> task) {
+      ForkJoinTask<?>[] a = array;
+      int t = top;
+      unsafe.putOrderedObject(a, slot(a, t), task);
+      top = t + 1;
+      if (t + 1 - base >= a.length) {
+        grow();
+      }
+      pool.signalWork();
+    }
+
+    // moves the tasks to an array twice the size, claiming each from
+    // the old one as a thief would
+    private void grow() {
+      ForkJoinTask<?>[] old = array;
+      ForkJoinTask<?>[] a = new ForkJoinTask<?>[old.length << 1];
+      for (int i = base, t = top; i != t; ++i) {
+        long j = slot(old, i);
+        ForkJoinTask<?> x = (ForkJoinTask<?>) unsafe.getObjectVolatile(old, j);
+        if (x != null && unsafe.compareAndSwapObject(old, j, x, null)) {
+          unsafe.putOrderedObject(a, slot(a, i), x);
+        }
+      }
+      array = a;
+    }
+
+    ForkJoinTask<?> pop() {
+      ForkJoinTask<?>[] a = array;
+      int t;
+      while ((t = top) - base > 0) {
+        long j = slot(a, -- t);
+        ForkJoinTask<?> x = (ForkJoinTask<?>) unsafe.getObjectVolatile(a, j);
+        if (x == null) {
+          // a thief got it first
+          break;
+        } else if (unsafe.compareAndSwapObject(a, j, x, null)) {
+          top = t;
+          return x;
+        }
+      }
+      return null;
+    }
+
+    // pops the specified task if it's the one on top
+    boolean tryUnpush(ForkJoinTask<?> task) {
+      ForkJoinTask<?>[] a = array;
+      int t = top;
+      if (t - base > 0) {
+        long j = slot(a, -- t);
+        if (unsafe.getObjectVolatile(a, j) == task
+            && unsafe.compareAndSwapObject(a, j, task, null))
+        {
+          top = t;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    ForkJoinTask<?> poll() {
+      int b;
+      while ((b = base) - top < 0) {
+        ForkJoinTask<?>[] a = array;
+        long j = slot(a, b);
+        ForkJoinTask<?> x = (ForkJoinTask<?>) unsafe.getObjectVolatile(a, j);
+        if (b == base) {
+          if (x != null) {
+            if (unsafe.compareAndSwapObject(a, j, x, null)) {
+              base = b + 1;
+              return x;
+            }
+          } else if (b + 1 == top) {
+            // the owner is popping the last task
+            break;
+          }
+        }
+      }
+      return null;
+    }
+  }
+}
@@ -0,0 +1,358 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.Collection;
+
+import sun.misc.Unsafe;
+
+public abstract class ForkJoinTask<V> implements Future<V> {
+  private static final Unsafe unsafe = Unsafe.getUnsafe();
+  private static final long StatusOffset;
+
+  static {
+    try {
+      StatusOffset = unsafe.objectFieldOffset
+        (ForkJoinTask.class.getDeclaredField("status"));
+    } catch (NoSuchFieldException e) {
+      throw new Error(e);
+    }
+  }
+
+  static final int Pending = 0;
+  static final int Normal = 1;
+  static final int Exceptional = 2;
+  static final int Cancelled = 3;
+
+  volatile int status;
+
+  // the number of threads blocked in awaitDone, which the thread
+  // completing the task must wake; guarded by this task's monitor
+  private volatile int waiters;
+
+  private Throwable exception;
+
+  public abstract V getRawResult();
+
+  protected abstract void setRawResult(V value);
+
+  // returns whether the task completed, which is always the case
+  // unless a subclass arranges to complete it some other way
+  protected abstract boolean exec();
+
+  private boolean setDone(int s) {
+    if (unsafe.compareAndSwapInt(this, StatusOffset, Pending, s)) {
+      // status is written before waiters is read, and waiters is
+      // written before status is read, so either we see the waiter or
+      // it sees that we're done
+      if (waiters != 0) {
+        synchronized (this) {
+          notifyAll();
+        }
+      }
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  final void doExec() {
+    if (status == Pending) {
+      boolean completed;
+      try {
+        completed = exec();
+      } catch (Throwable e) {
+        exception = e;
+        setDone(Exceptional);
+        return;
+      }
+
+      if (completed) {
+        setDone(Normal);
+      }
+    }
+  }
+
+  // blocks until the task is done or the specified time passes, with
+  // zero meaning indefinitely
+  final void awaitDone(long millis) throws InterruptedException {
+    synchronized (this) {
+      ++ waiters;
+      try {
+        if (status == Pending) {
+          wait(millis);
+        }
+      } finally {
+        -- waiters;
+      }
+    }
+  }
+
+  private int doJoin() {
+    int s = status;
+    if (s != Pending) {
+      return s;
+    }
+
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread) {
+      ForkJoinWorkerThread w = (ForkJoinWorkerThread) t;
+      if (w.workQueue.tryUnpush(this)) {
+        doExec();
+      }
+      w.pool.awaitJoin(w.workQueue, this);
+    } else {
+      boolean interrupted = false;
+      if (ForkJoinPool.common.tryExternalUnpush(this)) {
+        doExec();
+      }
+      while (status == Pending) {
+        try {
+          awaitDone(0);
+        } catch (InterruptedException e) {
+          interrupted = true;
+        }
+      }
+      if (interrupted) {
+        t.interrupt();
+      }
+    }
+    return status;
+  }
+
+  private void report(int s) {
+    if (s == Cancelled) {
+      throw new CancellationException();
+    } else if (s == Exceptional) {
+      Throwable e = exception;
+      if (e instanceof RuntimeException) {
+        throw (RuntimeException) e;
+      } else if (e instanceof Error) {
+        throw (Error) e;
+      } else {
+        throw new RuntimeException(e);
+      }
+    }
+  }
+
+  public final ForkJoinTask<V> fork() {
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread) {
+      ((ForkJoinWorkerThread) t).workQueue.push(this);
+    } else {
+      ForkJoinPool.common.externalPush(this);
+    }
+    return this;
+  }
+
+  public final V join() {
+    int s = doJoin();
+    if (s != Normal) {
+      report(s);
+    }
+    return getRawResult();
+  }
+
+  public final V invoke() {
+    doExec();
+    return join();
+  }
+
+  public final void quietlyJoin() {
+    doJoin();
+  }
+
+  public boolean tryUnfork() {
+    Thread t = Thread.currentThread();
+    if (t instanceof ForkJoinWorkerThread) {
+      return ((ForkJoinWorkerThread) t).workQueue.tryUnpush(this);
+    } else {
+      return ForkJoinPool.common.tryExternalUnpush(this);
+    }
+  }
+
+  public static void invokeAll(ForkJoinTask<?> a, ForkJoinTask<?> b) {
+    b.fork();
+    a.invoke();
+    b.join();
+  }
+
+  public static void invokeAll(ForkJoinTask<?>... tasks) {
+    for (int i = tasks.length - 1; i > 0; --i) {
+      tasks[i].fork();
+    }
+    if (tasks.length > 0) {
+      tasks[0].invoke();
+    }
+    for (int i = 1; i < tasks.length; ++i) {
+      tasks[i].join();
+    }
+  }
+
+  public static <T extends ForkJoinTask<?>> Collection<T> invokeAll
+    (Collection<T> tasks)
+  {
+    invokeAll(tasks.toArray(new ForkJoinTask<?>[tasks.size()]));
+    return tasks;
+  }
+
+  public boolean cancel(boolean mayInterruptIfRunning) {
+    return setDone(Cancelled) || status == Cancelled;
+  }
+
+  public final boolean isDone() {
+    return status != Pending;
+  }
+
+  public final boolean isCancelled() {
+    return status == Cancelled;
+  }
+
+  public final boolean isCompletedNormally() {
+    return status == Normal;
+  }
+
+  public final boolean isCompletedAbnormally() {
+    return status > Normal;
+  }
+
+  public final Throwable getException() {
+    int s = status;
+    if (s == Cancelled) {
+      return new CancellationException();
+    } else if (s == Exceptional) {
+      return exception;
+    } else {
+      return null;
+    }
+  }
+
+  private V result(int s) throws ExecutionException {
+    if (s == Cancelled) {
+      throw new CancellationException();
+    } else if (s == Exceptional) {
+      throw new ExecutionException(exception);
+    } else {
+      return getRawResult();
+    }
+  }
+
+  public final V get() throws InterruptedException, ExecutionException {
+    if (Thread.currentThread() instanceof ForkJoinWorkerThread) {
+      return result(doJoin());
+    }
+
+    while (status == Pending) {
+      awaitDone(0);
+    }
+    return result(status);
+  }
+
+  public final V get(long timeout, TimeUnit unit)
+    throws InterruptedException, ExecutionException, TimeoutException
+  {
+    long remaining = unit.toMillis(timeout);
+    long deadline = System.currentTimeMillis() + remaining;
+    while (status == Pending) {
+      if (remaining <= 0) {
+        throw new TimeoutException();
+      }
+      awaitDone(remaining);
+      remaining = deadline - System.currentTimeMillis();
+    }
+    return result(status);
+  }
+
+  public static ForkJoinPool getPool() {
+    Thread t = Thread.currentThread();
+    return t instanceof ForkJoinWorkerThread
+      ? ((ForkJoinWorkerThread) t).pool : null;
+  }
+
+  public static boolean inForkJoinPool() {
+    return Thread.currentThread() instanceof ForkJoinWorkerThread;
+  }
+
+  public static ForkJoinTask<?> adapt(Runnable runnable) {
+    return new AdaptedRunnable<Void>(runnable, null);
+  }
+
+  public static <T> ForkJoinTask<T> adapt(Runnable runnable, T result) {
+    return new AdaptedRunnable<T>(runnable, result);
+  }
+
+  public static <T> ForkJoinTask<T> adapt(Callable<? extends T> callable) {
+    return new AdaptedCallable<T>(callable);
+  }
+
+  static class AdaptedRunnable<T> extends ForkJoinTask<T>
+    implements RunnableFuture<T>
+  {
+    private final Runnable runnable;
+    private T result;
+
+    public AdaptedRunnable(Runnable runnable, T result) {
+      this.runnable = runnable;
+      this.result = result;
+    }
+
+    public T getRawResult() {
+      return result;
+    }
+
+    protected void setRawResult(T value) {
+      result = value;
+    }
+
+    protected boolean exec() {
+      runnable.run();
+      return true;
+    }
+
+    public void run() {
+      invoke();
+    }
+  }
+
+  static class AdaptedCallable<T> extends ForkJoinTask<T>
+    implements RunnableFuture<T>
+  {
+    private final Callable<? extends T> callable;
+    private T result;
+
+    public AdaptedCallable(Callable<? extends T> callable) {
+      this.callable = callable;
+    }
+
+    public T getRawResult() {
+      return result;
+    }
+
+    protected void setRawResult(T value) {
+      result = value;
+    }
+
+    protected boolean exec() {
+      try {
+        result = callable.call();
+      } catch (RuntimeException e) {
+        throw e;
+      } catch (Exception e) {
+        throw new RuntimeException(e);
+      }
+      return true;
+    }
+
+    public void run() {
+      invoke();
+    }
+  }
+}
@@ -0,0 +1,36 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+
+package java.util.concurrent;
+
+public class ForkJoinWorkerThread extends Thread {
+  final ForkJoinPool pool;
+  final ForkJoinPool.WorkQueue workQueue;
+
+  ForkJoinWorkerThread(ForkJoinPool pool, ForkJoinPool.WorkQueue workQueue) {
+    super(pool.workerName(workQueue.index));
+    this.pool = pool;
+    this.workQueue = workQueue;
+    setDaemon(true);
+  }
+
+  public ForkJoinPool getPool() {
+    return pool;
+  }
+
+  public int getPoolIndex() {
+    return workQueue.index - 1;
+  }
+
+  public void run() {
+    pool.runWorker(this);
+  }
+}
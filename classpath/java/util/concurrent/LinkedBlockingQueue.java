@@ -11,193 +11,319 @@
 package java.util.concurrent;
 
 import java.util.AbstractQueue;
+import java.util.ArrayList;
 import java.util.Collection;
 import java.util.Iterator;
-import java.util.LinkedList;
+import java.util.NoSuchElementException;
+import java.util.concurrent.atomic.AtomicInteger;
 
-public class LinkedBlockingQueue<T> extends AbstractQueue<T> 
+/**
+ * A blocking queue with separate locks for the head and the tail, so
+ * producers and consumers don't contend with each other.
+ *
+ * <p>Producers wait on the put lock for space and consumers wait on
+ * the take lock for elements, and each state change wakes a single
+ * waiter, who wakes the next if there's still something for it to do.
+ * Operations on the middle of the queue hold both locks, taking the
+ * put lock first.
+ */
+public class LinkedBlockingQueue<T> extends AbstractQueue<T>
                                     implements BlockingQueue<T> {
-  private final Object collectionLock;
-  private final LinkedList<T> storage;
+  private final Object putLock = new Object();
+  private final Object takeLock = new Object();
+  private final AtomicInteger count = new AtomicInteger();
   private final int capacity;
-  
+
+  // guarded by the take lock; the head is a placeholder whose value
+  // is always null
+  private Node<T> head;
+
+  // guarded by the put lock
+  private Node<T> last;
+
   public LinkedBlockingQueue() {
     this(Integer.MAX_VALUE);
   }
-  
+
   public LinkedBlockingQueue(int capacity) {
-    collectionLock = new Object();
-    this.capacity = capacity;
-    storage = new LinkedList<T>();
-  }
-  
-  // should be synchronized on collectionLock before calling
-  private void handleRemove() {
-    collectionLock.notifyAll();
-  }
-  
-  // should be synchronized on collectionLock before calling
-  private void handleAdd() {
-    collectionLock.notifyAll();
-  }
-
-  // should be synchronized on collectionLock before calling
-  private void blockTillNotFull() throws InterruptedException {
-    blockTillNotFull(Long.MAX_VALUE);
-  }
-
-  // should be synchronized on collectionLock before calling
-  private void blockTillNotFull(long maxWaitInMillis) throws InterruptedException {
-    if (capacity > storage.size()) {
-      return;
-    }
-    
-    long startTime = 0;
-    if (maxWaitInMillis != Long.MAX_VALUE) {
-      startTime = System.currentTimeMillis();
-    }
-    long remainingWait = maxWaitInMillis;
-    while (remainingWait > 0) {
-      collectionLock.wait(remainingWait);
-      
-      if (capacity > storage.size()) {
-        return;
-      } else if (maxWaitInMillis != Long.MAX_VALUE) {
-        remainingWait = maxWaitInMillis - (System.currentTimeMillis() - startTime);
-      }
+    if (capacity <= 0) {
+      throw new IllegalArgumentException();
     }
-  }
 
-  // should be synchronized on collectionLock before calling
-  private void blockTillNotEmpty() throws InterruptedException {
-    blockTillNotEmpty(Long.MAX_VALUE);
+    this.capacity = capacity;
+    head = last = new Node<T>(null);
   }
 
-  // should be synchronized on collectionLock before calling
-  private void blockTillNotEmpty(long maxWaitInMillis) throws InterruptedException {
-    if (! storage.isEmpty()) {
-      return;
+  // wakes a consumer; must not be called with the put lock held
+  private void signalNotEmpty() {
+    synchronized (takeLock) {
+      takeLock.notify();
     }
-    
-    long startTime = 0;
-    if (maxWaitInMillis != Long.MAX_VALUE) {
-      startTime = System.currentTimeMillis();
+  }
+
+  // wakes a producer; must not be called with the take lock held
+  private void signalNotFull() {
+    synchronized (putLock) {
+      putLock.notify();
     }
-    long remainingWait = maxWaitInMillis;
-    while (remainingWait > 0) {
-      collectionLock.wait(remainingWait);
-      
-      if (! storage.isEmpty()) {
-        return;
-      } else if (maxWaitInMillis != Long.MAX_VALUE) {
-        remainingWait = maxWaitInMillis - (System.currentTimeMillis() - startTime);
+  }
+
+  // should be synchronized on putLock before calling
+  private void enqueue(T element) {
+    last = last.next = new Node<T>(element);
+  }
+
+  // should be synchronized on takeLock before calling
+  private T dequeue() {
+    Node<T> first = head.next;
+    head.next = head; // help the collector
+    head = first;
+    T result = first.value;
+    first.value = null;
+    return result;
+  }
+
+  // should be synchronized on lock before calling.  Waits for up to
+  // the specified time, or indefinitely if it's Long.MAX_VALUE,
+  // returning the time remaining.  If we're interrupted, pass on any
+  // notification we might have consumed before throwing.
+  private static long await(Object lock, long waitInMillis)
+    throws InterruptedException
+  {
+    try {
+      if (waitInMillis == Long.MAX_VALUE) {
+        lock.wait();
+        return waitInMillis;
+      } else {
+        long startTime = System.currentTimeMillis();
+        lock.wait(waitInMillis);
+        return waitInMillis - (System.currentTimeMillis() - startTime);
       }
+    } catch (InterruptedException e) {
+      lock.notify();
+      throw e;
     }
   }
 
   @Override
   public boolean offer(T element) {
-    synchronized (collectionLock) {
-      if (capacity > storage.size()) {
-        storage.addLast(element);
-        
-        handleAdd();
-        
-        return true;
-      } else {
-        return false;
+    if (element == null) {
+      throw new NullPointerException();
+    }
+
+    if (count.get() == capacity) {
+      return false;
+    }
+
+    int c = -1;
+    synchronized (putLock) {
+      if (count.get() < capacity) {
+        enqueue(element);
+        c = count.getAndIncrement();
+        if (c + 1 < capacity) {
+          putLock.notify();
+        }
       }
     }
+
+    if (c == 0) {
+      signalNotEmpty();
+    }
+    return c >= 0;
   }
 
   @Override
   public boolean offer(T e, long timeout, TimeUnit unit) throws InterruptedException {
-    long timeoutInMillis = unit.toMillis(timeout);
-    synchronized (collectionLock) {
+    if (e == null) {
+      throw new NullPointerException();
+    }
+
+    long remainingWait = unit.toMillis(timeout);
+    int c;
+    synchronized (putLock) {
       // block till we can add or have reached timeout
-      blockTillNotFull(timeoutInMillis);
-      
-      return offer(e);
+      while (count.get() == capacity) {
+        if (remainingWait <= 0) {
+          return false;
+        }
+        remainingWait = await(putLock, remainingWait);
+      }
+
+      enqueue(e);
+      c = count.getAndIncrement();
+      if (c + 1 < capacity) {
+        putLock.notify();
+      }
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
     }
+    return true;
   }
 
   @Override
   public void put(T e) throws InterruptedException {
-    synchronized (collectionLock) {
+    if (e == null) {
+      throw new NullPointerException();
+    }
+
+    int c;
+    synchronized (putLock) {
       // block till we have space
-      blockTillNotFull();
-      
-      storage.add(e);
-      handleAdd();
+      while (count.get() == capacity) {
+        await(putLock, Long.MAX_VALUE);
+      }
+
+      enqueue(e);
+      c = count.getAndIncrement();
+      if (c + 1 < capacity) {
+        putLock.notify();
+      }
+    }
+
+    if (c == 0) {
+      signalNotEmpty();
     }
   }
 
   @Override
   public boolean addAll(Collection<? extends T> c) {
-    synchronized (collectionLock) {
-      if (storage.size() + c.size() > capacity) {
-        throw new IllegalStateException("Not enough space");
+    if (c == this) {
+      throw new IllegalArgumentException();
+    }
+
+    // link the new nodes together first, so we can check the elements
+    // and count them without holding the lock
+    Node<T> first = null;
+    Node<T> end = null;
+    int added = 0;
+    for (T element: c) {
+      if (element == null) {
+        throw new NullPointerException();
       }
-      
-      if (c.isEmpty()) {
-        return false;
+
+      Node<T> n = new Node<T>(element);
+      if (end == null) {
+        first = n;
       } else {
-        storage.addAll(c);
-        
-        return true;
+        end.next = n;
       }
+      end = n;
+      ++ added;
+    }
+
+    if (added == 0) {
+      return false;
     }
+
+    int previous;
+    synchronized (putLock) {
+      if (count.get() + added > capacity) {
+        throw new IllegalStateException("Not enough space");
+      }
+
+      last.next = first;
+      last = end;
+
+      previous = count.getAndAdd(added);
+      if (previous + added < capacity) {
+        putLock.notify();
+      }
+    }
+
+    if (previous == 0) {
+      synchronized (takeLock) {
+        takeLock.notifyAll();
+      }
+    }
+    return true;
   }
 
   @Override
   public T peek() {
-    synchronized (collectionLock) {
-      if (storage.isEmpty()) {
-        return null;
-      } else {
-        return storage.getFirst();
-      }
+    if (count.get() == 0) {
+      return null;
     }
-  }
 
-  // should be synchronized on collectionLock before calling
-  private T removeFirst() {
-    T result = storage.removeFirst();
-    handleRemove();
-    
-    return result;
+    synchronized (takeLock) {
+      Node<T> first = head.next;
+      return first == null ? null : first.value;
+    }
   }
 
   @Override
   public T poll() {
-    synchronized (collectionLock) {
-      if (storage.isEmpty()) {
-        return null;
-      } else {
-        return removeFirst();
+    if (count.get() == 0) {
+      return null;
+    }
+
+    T result = null;
+    int c = -1;
+    synchronized (takeLock) {
+      if (count.get() > 0) {
+        result = dequeue();
+        c = count.getAndDecrement();
+        if (c > 1) {
+          takeLock.notify();
+        }
       }
     }
+
+    if (c == capacity) {
+      signalNotFull();
+    }
+    return result;
   }
 
   @Override
   public T poll(long timeout, TimeUnit unit) throws InterruptedException {
-    long timeoutInMillis = unit.toMillis(timeout);
-    synchronized (collectionLock) {
+    long remainingWait = unit.toMillis(timeout);
+    T result;
+    int c;
+    synchronized (takeLock) {
       // block till we available or timeout
-      blockTillNotEmpty(timeoutInMillis);
-      
-      return poll();
+      while (count.get() == 0) {
+        if (remainingWait <= 0) {
+          return null;
+        }
+        remainingWait = await(takeLock, remainingWait);
+      }
+
+      result = dequeue();
+      c = count.getAndDecrement();
+      if (c > 1) {
+        takeLock.notify();
+      }
     }
+
+    if (c == capacity) {
+      signalNotFull();
+    }
+    return result;
   }
 
   @Override
   public T take() throws InterruptedException {
-    synchronized (collectionLock) {
+    T result;
+    int c;
+    synchronized (takeLock) {
       // block till we available
-      blockTillNotEmpty();
-      
-      return removeFirst();
+      while (count.get() == 0) {
+        await(takeLock, Long.MAX_VALUE);
+      }
+
+      result = dequeue();
+      c = count.getAndDecrement();
+      if (c > 1) {
+        takeLock.notify();
+      }
+    }
+
+    if (c == capacity) {
+      signalNotFull();
     }
+    return result;
   }
 
   @Override
@@ -207,96 +333,244 @@ public class LinkedBlockingQueue<T> extends AbstractQueue<T>
 
   @Override
   public int drainTo(Collection<? super T> c, int maxElements) {
-    int remainingElements = maxElements;
-    synchronized (collectionLock) {
-      while (remainingElements > 0 && ! storage.isEmpty()) {
-        c.add(storage.removeFirst());
-        remainingElements--;
+    if (c == this) {
+      throw new IllegalArgumentException();
+    }
+
+    int drained = 0;
+    int previous = 0;
+    synchronized (takeLock) {
+      int n = Math.min(maxElements, count.get());
+      try {
+        while (drained < n) {
+          T element = dequeue();
+          ++ drained;
+          c.add(element);
+        }
+      } finally {
+        if (drained != 0) {
+          previous = count.getAndAdd(-drained);
+          if (previous - drained > 0) {
+            takeLock.notify();
+          }
+        }
       }
-      
-      if (remainingElements != maxElements) {
-        handleRemove();
+    }
+
+    if (drained != 0 && previous == capacity) {
+      synchronized (putLock) {
+        putLock.notifyAll();
       }
-      
-      return maxElements - remainingElements;
     }
+    return drained;
   }
 
   @Override
   public int remainingCapacity() {
-    synchronized (collectionLock) {
-      return capacity - storage.size();
-    }
+    return capacity - count.get();
   }
 
   @Override
   public int size() {
-    synchronized (collectionLock) {
-      return storage.size();
-    }
+    return count.get();
+  }
+
+  @Override
+  public boolean isEmpty() {
+    return count.get() == 0;
   }
 
   @Override
   public boolean contains(Object element) {
-    synchronized (collectionLock) {
-      return storage.contains(element);
+    if (element == null) {
+      return false;
+    }
+
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (Node<T> n = head.next; n != null; n = n.next) {
+          if (element.equals(n.value)) {
+            return true;
+          }
+        }
+        return false;
+      }
     }
   }
 
-  @Override
-  public boolean containsAll(Collection<?> c) {
-    synchronized (collectionLock) {
-      return storage.containsAll(c);
+  // should be synchronized on both locks before calling
+  private void unlink(Node<T> node, Node<T> previous) {
+    node.value = null;
+    previous.next = node.next;
+    if (last == node) {
+      last = previous;
+    }
+
+    if (count.getAndDecrement() == capacity) {
+      putLock.notify();
     }
   }
 
   @Override
   public boolean remove(Object element) {
-    synchronized (collectionLock) {
-      if (storage.remove(element)) {
-        handleRemove();
-        return true;
-      } else {
+    if (element == null) {
+      return false;
+    }
+
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (Node<T> p = head, n = p.next; n != null; p = n, n = n.next) {
+          if (element.equals(n.value)) {
+            unlink(n, p);
+            return true;
+          }
+        }
         return false;
       }
     }
   }
 
+  // removes the specified node if it's still in the queue
+  private void remove(Node<T> node) {
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (Node<T> p = head, n = p.next; n != null; p = n, n = n.next) {
+          if (n == node) {
+            unlink(n, p);
+            return;
+          }
+        }
+      }
+    }
+  }
+
   @Override
   public boolean removeAll(Collection<?> c) {
-    synchronized (collectionLock) {
-      if (storage.removeAll(c)) {
-        handleRemove();
-        return true;
-      } else {
-        return false;
+    boolean changed = false;
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (Node<T> p = head, n = p.next; n != null; n = p.next) {
+          if (c.contains(n.value)) {
+            unlink(n, p);
+            changed = true;
+          } else {
+            p = n;
+          }
+        }
       }
     }
+    return changed;
   }
 
   @Override
   public void clear() {
-    synchronized (collectionLock) {
-      storage.clear();
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        for (Node<T> n = head.next; n != null; n = n.next) {
+          n.value = null;
+        }
+        head.next = null;
+        last = head;
+
+        if (count.getAndSet(0) == capacity) {
+          putLock.notifyAll();
+        }
+      }
     }
   }
 
   @Override
   public Object[] toArray() {
-    synchronized (collectionLock) {
-      return storage.toArray();
-    }
+    return snapshot().toArray();
   }
 
   @Override
   public <S> S[] toArray(S[] array) {
-    synchronized (collectionLock) {
-      return storage.toArray(array);
+    return snapshot().toArray(array);
+  }
+
+  private ArrayList<T> snapshot() {
+    synchronized (putLock) {
+      synchronized (takeLock) {
+        ArrayList<T> list = new ArrayList<T>(count.get());
+        for (Node<T> n = head.next; n != null; n = n.next) {
+          list.add(n.value);
+        }
+        return list;
+      }
     }
   }
 
+  // The iterator is weakly consistent: it never throws
+  // ConcurrentModificationException, and it returns each element which
+  // was in the queue when it was created and hasn't since been
+  // removed, possibly along with some which were added later.
   @Override
   public Iterator<T> iterator() {
-    throw new UnsupportedOperationException("Not implemented yet");
+    return new MyIterator();
+  }
+
+  private static class Node<T> {
+    public T value;
+    public Node<T> next;
+
+    public Node(T value) {
+      this.value = value;
+    }
+  }
+
+  private class MyIterator implements Iterator<T> {
+    private Node<T> current;
+    private Node<T> nextNode;
+    private T nextValue;
+
+    public MyIterator() {
+      synchronized (putLock) {
+        synchronized (takeLock) {
+          nextNode = head.next;
+          if (nextNode != null) {
+            nextValue = nextNode.value;
+          }
+        }
+      }
+    }
+
+    public boolean hasNext() {
+      return nextNode != null;
+    }
+
+    public T next() {
+      if (nextNode == null) {
+        throw new NoSuchElementException();
+      }
+
+      T result = nextValue;
+      current = nextNode;
+      synchronized (putLock) {
+        synchronized (takeLock) {
+          // skip any nodes which were removed in the meantime.  A
+          // dequeued node points to itself, in which case we start
+          // again from the head.
+          Node<T> n = nextNode;
+          do {
+            Node<T> s = n.next;
+            n = (s == n) ? head.next : s;
+          } while (n != null && n.value == null);
+
+          nextNode = n;
+          nextValue = n == null ? null : n.value;
+        }
+      }
+      return result;
+    }
+
+    public void remove() {
+      if (current == null) {
+        throw new IllegalStateException();
+      }
+
+      LinkedBlockingQueue.this.remove(current);
+      current = null;
+    }
   }
 }
@@ -0,0 +1,765 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.concurrent;
+
+import java.util.ArrayList;
+import java.util.Collection;
+import java.util.List;
+
+/**
+ * A scheduled executor whose pending tasks are kept in a hierarchical
+ * timer wheel, so scheduling and cancelling a task take constant time
+ * however many are pending.
+ *
+ * <p>The wheel counts time in one millisecond ticks.  It has
+ * <code>LevelCount</code> levels of <code>SlotCount</code> slots, each
+ * slot of a level spanning a whole rotation of the level below.  A task
+ * goes in the lowest level at which its deadline shares all higher
+ * digits (in base <code>SlotCount</code>) with the current tick, in the
+ * slot given by its digit at that level.  When the current tick reaches
+ * a slot of a higher level, the tasks there cascade down to lower
+ * levels, reaching the lowest as they come due.
+ *
+ * <p>A timer thread advances the wheel, sleeping until the next tick
+ * at which something is due or needs to cascade, and hands due tasks
+ * to up to <code>corePoolSize</code> worker threads.
+ */
+public class ScheduledThreadPoolExecutor implements ScheduledExecutorService {
+  private static final int SlotBits = 6;
+  private static final int SlotCount = 1 << SlotBits;
+  private static final int SlotMask = SlotCount - 1;
+  private static final int LevelCount = 6;
+  // tasks due after the current block of ticks, which is as many as the
+  // wheel covers, wait in an overflow list until the next block starts
+  private static final long BlockMask = (1L << (SlotBits * LevelCount)) - 1;
+  private static final int Overflow = LevelCount * SlotCount;
+  private static final long NanosPerTick = 1000 * 1000;
+
+  private static final Runnable Stop = new Runnable() {
+      public void run() { }
+    };
+
+  private static int poolCount;
+
+  private final int corePoolSize;
+  private final ThreadFactory threadFactory;
+  private final long origin = System.nanoTime();
+  private final LinkedBlockingQueue<Runnable> ready
+    = new LinkedBlockingQueue<Runnable>();
+
+  // guards everything below
+  private final Object lock = new Object();
+  private final Task[] slots = new Task[Overflow + 1];
+  private final long[] occupied = new long[LevelCount];
+  private long currentTick;
+  // the tick the timer thread will next wake at if nothing earlier is
+  // scheduled meanwhile
+  private long wakeTick = Long.MAX_VALUE;
+  // the number of tasks in the wheel
+  private int size;
+  private Thread timer;
+  private final List<Thread> workers = new ArrayList<Thread>();
+  private int started;
+  // the number of workers and timer threads which haven't exited
+  private int live;
+  private boolean shutdown;
+  private boolean stopped;
+
+  public ScheduledThreadPoolExecutor(int corePoolSize) {
+    this(corePoolSize, null);
+  }
+
+  public ScheduledThreadPoolExecutor(int corePoolSize,
+                                     ThreadFactory threadFactory)
+  {
+    if (corePoolSize <= 0) {
+      throw new IllegalArgumentException();
+    }
+
+    this.corePoolSize = corePoolSize;
+
+    if (threadFactory == null) {
+      final String prefix;
+      synchronized (ScheduledThreadPoolExecutor.class) {
+        prefix = "pool-" + (++ poolCount) + "-thread-";
+      }
+      threadFactory = new ThreadFactory() {
+          private int count;
+
+          public synchronized Thread newThread(Runnable r) {
+            return new Thread(r, prefix + (++ count));
+          }
+        };
+    }
+    this.threadFactory = threadFactory;
+  }
+
+  public int getCorePoolSize() {
+    return corePoolSize;
+  }
+
+  public int getPoolSize() {
+    synchronized (lock) {
+      return started;
+    }
+  }
+
+  private long tick(long nanos) {
+    return (nanos - origin) / NanosPerTick;
+  }
+
+  // like tick, but rounding up, so nothing runs before its deadline
+  long deadlineTick(long nanos) {
+    return (nanos - origin + NanosPerTick - 1) / NanosPerTick;
+  }
+
+  private void link(Task t, int index) {
+    t.prev = null;
+    t.next = slots[index];
+    if (t.next != null) {
+      t.next.prev = t;
+    }
+    slots[index] = t;
+    t.index = index;
+    if (index != Overflow) {
+      occupied[index / SlotCount] |= 1L << (index & SlotMask);
+    }
+    ++ size;
+  }
+
+  private void unlink(Task t) {
+    if (t.prev != null) {
+      t.prev.next = t.next;
+    } else {
+      slots[t.index] = t.next;
+      if (t.next == null && t.index != Overflow) {
+        occupied[t.index / SlotCount] &= ~(1L << (t.index & SlotMask));
+      }
+    }
+    if (t.next != null) {
+      t.next.prev = t.prev;
+    }
+    t.prev = t.next = null;
+    t.index = -1;
+    -- size;
+  }
+
+  private void place(Task t) {
+    long when = t.when;
+    if (when <= currentTick) {
+      ready.add(t);
+    } else if (when > (currentTick | BlockMask)) {
+      link(t, Overflow);
+    } else {
+      int level = (63 - Long.numberOfLeadingZeros(when ^ currentTick))
+        / SlotBits;
+      int slot = (int) (when >>> (level * SlotBits)) & SlotMask;
+      link(t, (level * SlotCount) + slot);
+    }
+  }
+
+  // re-places the tasks of a slot relative to the current tick
+  private void cascade(int index) {
+    Task t = slots[index];
+    while (t != null) {
+      Task next = t.next;
+      unlink(t);
+      place(t);
+      t = next;
+    }
+  }
+
+  // the earliest tick at which a task is due or must cascade
+  private long nextEvent() {
+    long next = Long.MAX_VALUE;
+    for (int level = 0; level < LevelCount; ++level) {
+      int shift = level * SlotBits;
+      int digit = (int) (currentTick >>> shift) & SlotMask;
+      // every task at this level has a greater digit than the current
+      // tick there
+      long later = digit == SlotMask
+        ? 0 : occupied[level] & (-1L << (digit + 1));
+      if (later != 0) {
+        long tick = (currentTick & ~((1L << (shift + SlotBits)) - 1))
+          | ((long) Long.numberOfTrailingZeros(later) << shift);
+        if (tick < next) {
+          next = tick;
+        }
+      }
+    }
+
+    if (slots[Overflow] != null) {
+      long tick = (currentTick | BlockMask) + 1;
+      if (tick < next) {
+        next = tick;
+      }
+    }
+
+    return next;
+  }
+
+  // moves the wheel to the specified tick, which must be that of the
+  // next event
+  private void advance(long tick) {
+    currentTick = tick;
+
+    if ((tick & BlockMask) == 0) {
+      cascade(Overflow);
+    }
+
+    // cascade from the top down so tasks due now reach the bottom level
+    // before we run it
+    for (int level = LevelCount - 1; level > 0; --level) {
+      int shift = level * SlotBits;
+      if ((tick & ((1L << shift) - 1)) == 0) {
+        cascade((level * SlotCount) + ((int) (tick >>> shift) & SlotMask));
+      }
+    }
+
+    cascade((int) tick & SlotMask);
+  }
+
+  private void runTimer() {
+    try {
+      synchronized (lock) {
+        while (true) {
+          long now = tick(System.nanoTime());
+          long next;
+          while ((next = nextEvent()) <= now) {
+            advance(next);
+          }
+          currentTick = now;
+
+          if (stopped || (shutdown && size == 0)) {
+            break;
+          }
+
+          wakeTick = next;
+          try {
+            lock.wait(next == Long.MAX_VALUE ? 0 : next - now);
+          } catch (InterruptedException e) {
+            // shutdownNow wakes us this way; we check below
+          }
+        }
+
+        // workers stop once they've run whatever is ready
+        for (int i = 0; i < started; ++i) {
+          ready.add(Stop);
+        }
+      }
+    } finally {
+      exited();
+    }
+  }
+
+  private void runWorker() {
+    try {
+      while (true) {
+        Runnable r;
+        try {
+          r = ready.take();
+        } catch (InterruptedException e) {
+          synchronized (lock) {
+            if (stopped) {
+              break;
+            }
+          }
+          continue;
+        }
+
+        if (r == Stop) {
+          break;
+        }
+        r.run();
+      }
+    } finally {
+      exited();
+    }
+  }
+
+  private void exited() {
+    synchronized (lock) {
+      -- live;
+      lock.notifyAll();
+    }
+  }
+
+  private void startThreads() {
+    if (timer == null) {
+      timer = new Thread(new Runnable() {
+          public void run() {
+            runTimer();
+          }
+        }, "ScheduledThreadPoolExecutor-timer");
+      timer.setDaemon(true);
+      ++ live;
+      timer.start();
+    }
+
+    if (started < corePoolSize) {
+      Thread t = threadFactory.newThread(new Runnable() {
+          public void run() {
+            runWorker();
+          }
+        });
+      workers.add(t);
+      ++ started;
+      ++ live;
+      t.start();
+    }
+  }
+
+  private void enqueue(Task t) {
+    synchronized (lock) {
+      if (shutdown) {
+        throw new RejectedExecutionException();
+      }
+
+      startThreads();
+      place(t);
+      if (t.when < wakeTick) {
+        lock.notifyAll();
+      }
+    }
+  }
+
+  // puts a periodic task back in the wheel for its next run, unless
+  // we've been shut down meanwhile
+  boolean reschedule(Task t) {
+    synchronized (lock) {
+      if (shutdown) {
+        return false;
+      }
+
+      place(t);
+      if (t.when < wakeTick) {
+        lock.notifyAll();
+      }
+      return true;
+    }
+  }
+
+  void remove(Task t) {
+    synchronized (lock) {
+      if (t.index >= 0) {
+        unlink(t);
+        if (shutdown && size == 0) {
+          lock.notifyAll();
+        }
+      }
+    }
+  }
+
+  private <V> Task<V> schedule(Callable<V> callable, long delay,
+                               long period, TimeUnit unit)
+  {
+    if (callable == null || unit == null) {
+      throw new NullPointerException();
+    }
+
+    Task<V> t = new Task<V>
+      (this, callable, System.nanoTime() + unit.toNanos(Math.max(delay, 0)),
+       unit.toNanos(period));
+    enqueue(t);
+    return t;
+  }
+
+  public ScheduledFuture<?> schedule(Runnable command, long delay,
+                                     TimeUnit unit)
+  {
+    return schedule(Executors.callable(command, null), delay, 0, unit);
+  }
+
+  public <V> ScheduledFuture<V> schedule(Callable<V> callable, long delay,
+                                         TimeUnit unit)
+  {
+    return schedule(callable, delay, 0, unit);
+  }
+
+  public ScheduledFuture<?> scheduleAtFixedRate(Runnable command,
+                                                long initialDelay,
+                                                long period,
+                                                TimeUnit unit)
+  {
+    if (period <= 0) {
+      throw new IllegalArgumentException();
+    }
+    return schedule
+      (Executors.callable(command, null), initialDelay, period, unit);
+  }
+
+  public ScheduledFuture<?> scheduleWithFixedDelay(Runnable command,
+                                                   long initialDelay,
+                                                   long delay,
+                                                   TimeUnit unit)
+  {
+    if (delay <= 0) {
+      throw new IllegalArgumentException();
+    }
+    return schedule
+      (Executors.callable(command, null), initialDelay, -delay, unit);
+  }
+
+  public void execute(Runnable command) {
+    schedule(command, 0, TimeUnit.NANOSECONDS);
+  }
+
+  public Future<?> submit(Runnable task) {
+    return schedule(task, 0, TimeUnit.NANOSECONDS);
+  }
+
+  public <T> Future<T> submit(Runnable task, T result) {
+    return schedule(Executors.callable(task, result), 0,
+                    TimeUnit.NANOSECONDS);
+  }
+
+  public <T> Future<T> submit(Callable<T> task) {
+    return schedule(task, 0, TimeUnit.NANOSECONDS);
+  }
+
+  public <T> List<Future<T>> invokeAll(Collection<? extends Callable<T>> tasks)
+    throws InterruptedException
+  {
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    for (Callable<T> c: tasks) {
+      futures.add(submit(c));
+    }
+    for (Future<T> f: futures) {
+      try {
+        f.get();
+      } catch (ExecutionException e) {
+        // reported through the future
+      } catch (CancellationException e) {
+        // likewise
+      }
+    }
+    return futures;
+  }
+
+  public <T> List<Future<T>> invokeAll(Collection<? extends Callable<T>> tasks,
+                                       long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    long deadline = System.currentTimeMillis() + unit.toMillis(timeout);
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    for (Callable<T> c: tasks) {
+      futures.add(submit(c));
+    }
+    for (Future<T> f: futures) {
+      long remaining = deadline - System.currentTimeMillis();
+      try {
+        f.get(remaining, TimeUnit.MILLISECONDS);
+      } catch (ExecutionException e) {
+        // reported through the future
+      } catch (CancellationException e) {
+        // likewise
+      } catch (TimeoutException e) {
+        for (Future<T> g: futures) {
+          g.cancel(false);
+        }
+        break;
+      }
+    }
+    return futures;
+  }
+
+  public <T> T invokeAny(Collection<? extends Callable<T>> tasks)
+    throws InterruptedException, ExecutionException
+  {
+    try {
+      return invokeAny(tasks, Long.MAX_VALUE, TimeUnit.MILLISECONDS);
+    } catch (TimeoutException e) {
+      // not possible
+      throw new RuntimeException(e);
+    }
+  }
+
+  public <T> T invokeAny(Collection<? extends Callable<T>> tasks,
+                         long timeout, TimeUnit unit)
+    throws InterruptedException, ExecutionException, TimeoutException
+  {
+    if (tasks.isEmpty()) {
+      throw new IllegalArgumentException();
+    }
+
+    long millis = unit.toMillis(timeout);
+    long deadline = millis == Long.MAX_VALUE
+      ? Long.MAX_VALUE : System.currentTimeMillis() + millis;
+    List<Future<T>> futures = new ArrayList<Future<T>>(tasks.size());
+    for (Callable<T> c: tasks) {
+      futures.add(submit(c));
+    }
+
+    try {
+      ExecutionException failure = null;
+      for (Future<T> f: futures) {
+        try {
+          return f.get(deadline == Long.MAX_VALUE
+                       ? Long.MAX_VALUE
+                       : deadline - System.currentTimeMillis(),
+                       TimeUnit.MILLISECONDS);
+        } catch (ExecutionException e) {
+          failure = e;
+        } catch (CancellationException e) {
+          failure = new ExecutionException(e);
+        }
+      }
+      throw failure;
+    } finally {
+      for (Future<T> f: futures) {
+        f.cancel(false);
+      }
+    }
+  }
+
+  private List<Task> scheduled() {
+    List<Task> list = new ArrayList<Task>(size);
+    for (int i = 0; i < slots.length; ++i) {
+      for (Task t = slots[i]; t != null; t = t.next) {
+        list.add(t);
+      }
+    }
+    return list;
+  }
+
+  // tasks already scheduled to run once still run, but periodic ones
+  // stop
+  public void shutdown() {
+    List<Task> periodic = new ArrayList<Task>();
+    synchronized (lock) {
+      shutdown = true;
+      for (Task t: scheduled()) {
+        if (t.period != 0) {
+          periodic.add(t);
+        }
+      }
+      lock.notifyAll();
+    }
+
+    // cancel takes each task's monitor, so we mustn't hold the lock
+    for (Task t: periodic) {
+      t.cancel(false);
+    }
+  }
+
+  public List<Runnable> shutdownNow() {
+    List<Task> pending;
+    synchronized (lock) {
+      shutdown = true;
+      stopped = true;
+      pending = scheduled();
+      lock.notifyAll();
+    }
+
+    List<Runnable> list = new ArrayList<Runnable>(pending);
+    for (Runnable r = ready.poll(); r != null; r = ready.poll()) {
+      if (r != Stop) {
+        list.add(r);
+      }
+    }
+
+    for (Task t: pending) {
+      t.cancel(false);
+    }
+
+    // stop idle workers and interrupt running tasks
+    synchronized (lock) {
+      for (Thread w: workers) {
+        ready.add(Stop);
+        w.interrupt();
+      }
+    }
+
+    return list;
+  }
+
+  public boolean isShutdown() {
+    synchronized (lock) {
+      return shutdown;
+    }
+  }
+
+  public boolean isTerminated() {
+    synchronized (lock) {
+      return shutdown && live == 0;
+    }
+  }
+
+  public boolean awaitTermination(long timeout, TimeUnit unit)
+    throws InterruptedException
+  {
+    long remaining = unit.toMillis(timeout);
+    long deadline = System.currentTimeMillis() + remaining;
+    synchronized (lock) {
+      while (! (shutdown && live == 0)) {
+        if (remaining <= 0) {
+          return false;
+        }
+        lock.wait(remaining);
+        remaining = deadline - System.currentTimeMillis();
+      }
+      return true;
+    }
+  }
+
+  private static class Task<V> implements ScheduledFuture<V>, Runnable {
+    private static final int Scheduled = 0;
+    private static final int Running = 1;
+    private static final int Done = 2;
+    private static final int Canceled = 3;
+
+    private final ScheduledThreadPoolExecutor executor;
+    private final Callable<V> callable;
+    // in nanoseconds: positive for a fixed rate, negative for a fixed
+    // delay, and zero for a task which runs once
+    final long period;
+    private volatile long deadline;
+
+    // the following are guarded by the executor's lock
+    long when;
+    Task prev;
+    Task next;
+    // the slot we're in, or -1 if we're not in the wheel
+    int index = -1;
+
+    // the following are guarded by this task's monitor
+    private int state = Scheduled;
+    private V result;
+    private Throwable failure;
+    private Thread runner;
+
+    Task(ScheduledThreadPoolExecutor executor, Callable<V> callable,
+         long deadline, long period)
+    {
+      this.executor = executor;
+      this.callable = callable;
+      this.period = period;
+      setDeadline(deadline);
+    }
+
+    private void setDeadline(long deadline) {
+      this.deadline = deadline;
+      this.when = executor.deadlineTick(deadline);
+    }
+
+    public void run() {
+      synchronized (this) {
+        if (state != Scheduled) {
+          return;
+        }
+        state = Running;
+        runner = Thread.currentThread();
+      }
+
+      V v = null;
+      Throwable e = null;
+      try {
+        v = callable.call();
+      } catch (Throwable t) {
+        e = t;
+      }
+
+      synchronized (this) {
+        runner = null;
+        if (state == Canceled) {
+          // cancel(true) may have interrupted us after we finished
+          Thread.interrupted();
+          return;
+        }
+
+        if (e == null && period != 0) {
+          setDeadline(period > 0
+                      ? deadline + period
+                      : System.nanoTime() - period);
+          state = Scheduled;
+          if (executor.reschedule(this)) {
+            return;
+          }
+          state = Canceled;
+        } else {
+          result = v;
+          failure = e;
+          state = Done;
+        }
+        notifyAll();
+      }
+    }
+
+    public boolean cancel(boolean mayInterruptIfRunning) {
+      synchronized (this) {
+        if (state == Done || state == Canceled) {
+          return false;
+        }
+
+        if (state == Running && mayInterruptIfRunning && runner != null) {
+          runner.interrupt();
+        }
+        state = Canceled;
+        notifyAll();
+      }
+
+      executor.remove(this);
+      return true;
+    }
+
+    public synchronized boolean isCancelled() {
+      return state == Canceled;
+    }
+
+    public synchronized boolean isDone() {
+      return state == Done || state == Canceled;
+    }
+
+    public V get() throws InterruptedException, ExecutionException {
+      try {
+        return get(Long.MAX_VALUE, TimeUnit.MILLISECONDS);
+      } catch (TimeoutException e) {
+        // not possible
+        throw new RuntimeException(e);
+      }
+    }
+
+    public synchronized V get(long timeout, TimeUnit unit)
+      throws InterruptedException, ExecutionException, TimeoutException
+    {
+      long remaining = unit.toMillis(timeout);
+      long deadline = remaining == Long.MAX_VALUE
+        ? Long.MAX_VALUE : System.currentTimeMillis() + remaining;
+      while (state != Done && state != Canceled) {
+        if (remaining <= 0) {
+          throw new TimeoutException();
+        }
+        wait(remaining == Long.MAX_VALUE ? 0 : remaining);
+        if (deadline != Long.MAX_VALUE) {
+          remaining = deadline - System.currentTimeMillis();
+        }
+      }
+
+      if (state == Canceled) {
+        throw new CancellationException();
+      } else if (failure != null) {
+        throw new ExecutionException(failure);
+      } else {
+        return result;
+      }
+    }
+
+    public long getDelay(TimeUnit unit) {
+      return unit.convert(deadline - System.nanoTime(), TimeUnit.NANOSECONDS);
+    }
+
+    public int compareTo(Delayed o) {
+      long d = getDelay(TimeUnit.NANOSECONDS)
+        - o.getDelay(TimeUnit.NANOSECONDS);
+      return d < 0 ? -1 : (d > 0 ? 1 : 0);
+    }
+  }
+}
@@ -10,6 +10,7 @@
 
 package java.util.concurrent.locks;
 
+import avian.VirtualThread;
 import sun.misc.Unsafe;
 
 public class LockSupport {
@@ -48,6 +49,16 @@ public class LockSupport {
   }
   
   private static void doParkNanos(Object blocker, long nanos) {
+    if (VirtualThread.current() != null) {
+      // park the virtual thread rather than its carrier
+      if (nanos == 0) {
+        VirtualThread.park();
+      } else {
+        VirtualThread.parkNanos(nanos);
+      }
+      return;
+    }
+
     Thread t = Thread.currentThread();
     unsafe.putObject(t, parkBlockerOffset, blocker);
     unsafe.park(false, nanos);
@@ -55,6 +66,11 @@ public class LockSupport {
   }
   
   public static void parkUntil(Object blocker, long deadline) {
+    if (VirtualThread.current() != null) {
+      parkUntil(deadline);
+      return;
+    }
+
     Thread t = Thread.currentThread();
     unsafe.putObject(t, parkBlockerOffset, blocker);
     unsafe.park(true, deadline);
@@ -70,16 +86,29 @@ public class LockSupport {
   }
   
   public static void park() {
-    unsafe.park(false, 0L);
+    if (VirtualThread.current() != null) {
+      VirtualThread.park();
+    } else {
+      unsafe.park(false, 0L);
+    }
   }
   
   public static void parkNanos(long nanos) {
     if (nanos > 0) {
-      unsafe.park(false, nanos);
+      if (VirtualThread.current() != null) {
+        VirtualThread.parkNanos(nanos);
+      } else {
+        unsafe.park(false, nanos);
+      }
     }
   }
   
   public static void parkUntil(long deadline) {
-    unsafe.park(true, deadline);
+    if (VirtualThread.current() != null) {
+      VirtualThread.parkNanos
+        ((deadline - System.currentTimeMillis()) * 1000000L);
+    } else {
+      unsafe.park(true, deadline);
+    }
   }
 }
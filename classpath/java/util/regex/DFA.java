@@ -0,0 +1,313 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.regex;
+
+import java.util.Arrays;
+import java.util.HashMap;
+
+/**
+ * A lazily-built deterministic automaton running a {@link PikeVM} program.
+ * <p>
+ * Each state stands for the list of threads the Pike VM would run for the
+ * next character, i.e. the program counters of the instructions consuming a
+ * character, in the order of high to low priority. The threads' offsets
+ * decide which groups match, but not whether or where a match ends, so the
+ * automaton can leave them out and share states reached by different paths.
+ * Once a transition has been built, taking it costs a single array lookup
+ * instead of stepping every thread.
+ * </p>
+ * <p>
+ * States are only built when the input reaches them, and cached in the
+ * automaton, which is shared by all matchers of a pattern. If a program
+ * needs more than {@link #MAX_STATES} states, the automaton gives up and
+ * leaves the matching to the Pike VM.
+ * </p>
+ * <p>
+ * Only programs consisting of characters, character classes and jumps
+ * qualify: look-arounds and boundary matchers depend on more than the
+ * current character.
+ * </p>
+ */
+class DFA implements PikeVMOpcodes {
+  final static int FAILED = -2;
+
+  private final static int MAX_STATES = 1024;
+
+  private final int[] program;
+  private final CharacterMatcher[] classes;
+  /*
+   * When searching for the leftmost match as the Pike VM does, a thread that
+   * matches ends all threads of lower priority. Otherwise, as when the match
+   * must end at a given offset, or for the longest match of a reversed
+   * program, all threads keep running.
+   */
+  private final boolean firstMatch;
+  private final HashMap<State, State> states = new HashMap<State, State>();
+  private final State initial;
+  private boolean failed;
+
+  // scratch space for building a state, guarded by this
+  private final int[] marks;
+  private int generation;
+  private final int[] list;
+  private int listLength;
+  private boolean listMatches;
+
+  private static class State {
+    private final int[] pcs;
+    private final boolean match;
+    private final int hash;
+    private final State[] ascii = new State[128];
+    // transitions for the other characters, guarded by the automaton
+    private HashMap<Character, State> others;
+
+    public State(int[] pcs, boolean match) {
+      this.pcs = pcs;
+      this.match = match;
+      int hash = match ? 1 : 0;
+      for (int i = 0; i < pcs.length; ++i) {
+        hash = 31 * hash + pcs[i];
+      }
+      this.hash = hash;
+    }
+
+    public int hashCode() {
+      return hash;
+    }
+
+    public boolean equals(Object o) {
+      if (!(o instanceof State)) {
+        return false;
+      }
+      State other = (State) o;
+      return match == other.match && Arrays.equals(pcs, other.pcs);
+    }
+  }
+
+  private DFA(int[] program, int startPC, CharacterMatcher[] classes,
+    boolean firstMatch)
+  {
+    this.program = program;
+    this.classes = classes;
+    this.firstMatch = firstMatch;
+    marks = new int[program.length + 1];
+    list = new int[program.length];
+
+    begin();
+    schedule(startPC);
+    initial = newState();
+  }
+
+  /**
+   * Builds the automaton for a program.
+   *
+   * @param program
+   *          the Pike VM program
+   * @param startPC
+   *          the program counter to start at
+   * @param classes
+   *          the character classes the program refers to
+   * @param firstMatch
+   *          whether to stop at the first match found in the Pike VM's order,
+   *          rather than to look for further matches
+   * @return the automaton, or null if the program uses instructions which an
+   *         automaton cannot run
+   */
+  static DFA compile(int[] program, int startPC, CharacterMatcher[] classes,
+    boolean firstMatch)
+  {
+    for (int pc = 0; pc < program.length; pc += PikeVM.length(program[pc])) {
+      switch (program[pc]) {
+      case DOT:
+      case DOTALL:
+      case CHARACTER_CLASS:
+      case SAVE_OFFSET:
+      case SPLIT:
+      case SPLIT_JMP:
+      case JMP:
+        break;
+      default:
+        if (program[pc] < 0) {
+          return null;
+        }
+      }
+    }
+    return new DFA(program, startPC, classes, firstMatch);
+  }
+
+  /**
+   * Scans forward for a match.
+   *
+   * @return the end offset of the match, -1 if there is none, or
+   *         {@link #FAILED} if the automaton gave up
+   */
+  public int forward(char[] characters, int start, int end) {
+    if (failed) {
+      return FAILED;
+    }
+    State state = initial;
+    int found = state.match ? start : -1;
+    for (int i = start; i < end && state.pcs.length > 0; ++i) {
+      char c = characters[i];
+      State next = c < 128 ? state.ascii[c] : null;
+      if (next == null && (next = transition(state, c)) == null) {
+        return FAILED;
+      }
+      state = next;
+      if (state.match) {
+        found = i + 1;
+      }
+    }
+    return found;
+  }
+
+  /**
+   * Scans backward from {@code end}, as a reversed program would.
+   *
+   * @return the smallest offset, no less than {@code start}, where a match
+   *         begins, -1 if there is none, or {@link #FAILED} if the automaton
+   *         gave up
+   */
+  public int backward(char[] characters, int start, int end) {
+    if (failed) {
+      return FAILED;
+    }
+    State state = initial;
+    int found = state.match ? end : -1;
+    for (int i = end; i > start && state.pcs.length > 0; --i) {
+      char c = characters[i - 1];
+      State next = c < 128 ? state.ascii[c] : null;
+      if (next == null && (next = transition(state, c)) == null) {
+        return FAILED;
+      }
+      state = next;
+      if (state.match) {
+        found = i - 1;
+      }
+    }
+    return found;
+  }
+
+  private synchronized State transition(State from, char c) {
+    if (failed) {
+      return null;
+    }
+
+    // another thread might have built it in the meantime
+    State to = c < 128 ? from.ascii[c] :
+      from.others == null ? null : from.others.get(c);
+    if (to != null) {
+      return to;
+    }
+
+    begin();
+    for (int pc : from.pcs) {
+      int next = step(pc, c);
+      if (next >= 0 && !schedule(next)) {
+        break;
+      }
+    }
+    to = newState();
+    if (to == null) {
+      return null;
+    }
+
+    if (c < 128) {
+      from.ascii[c] = to;
+    } else {
+      if (from.others == null) {
+        from.others = new HashMap<Character, State>();
+      }
+      from.others.put(c, to);
+    }
+    return to;
+  }
+
+  // returns where the thread at pc continues after c, or -1 if it dies
+  private int step(int pc, char c) {
+    int opcode = program[pc];
+    switch (opcode) {
+    case DOT:
+      return c != '\0' && c != '\r' && c != '\n' ? pc + 1 : -1;
+    case DOTALL:
+      return pc + 1;
+    case CHARACTER_CLASS:
+      return classes[program[pc + 1]].matches(c) ? pc + 2 : -1;
+    default:
+      return c == (char) opcode ? pc + 1 : -1;
+    }
+  }
+
+  private void begin() {
+    ++ generation;
+    listLength = 0;
+    listMatches = false;
+  }
+
+  private boolean claim(int pc) {
+    if (marks[pc] == generation) {
+      return false;
+    }
+    marks[pc] = generation;
+    return true;
+  }
+
+  /**
+   * Adds the thread at {@code pc} to the state being built, following
+   * immediate instructions in the same order as the Pike VM does.
+   *
+   * @return false if a match ended all remaining threads
+   */
+  private boolean schedule(int pc) {
+    return !claim(pc) || follow(pc);
+  }
+
+  private boolean follow(int pc) {
+    if (pc == program.length) {
+      listMatches = true;
+      return !firstMatch;
+    }
+    switch (program[pc]) {
+    case SAVE_OFFSET:
+      return schedule(pc + 2);
+    case JMP:
+      return schedule(program[pc + 1]);
+    case SPLIT:
+    case SPLIT_JMP: {
+      // the Pike VM queues both targets before running either of them
+      boolean jumpFirst = program[pc] == SPLIT_JMP;
+      int first = jumpFirst ? program[pc + 1] : pc + 2;
+      int second = jumpFirst ? pc + 2 : program[pc + 1];
+      boolean followFirst = claim(first);
+      boolean followSecond = claim(second);
+      return (!followFirst || follow(first))
+        && (!followSecond || follow(second));
+    }
+    default:
+      list[listLength++] = pc;
+      return true;
+    }
+  }
+
+  private State newState() {
+    State state = new State(Arrays.copyOf(list, listLength), listMatches);
+    State existing = states.get(state);
+    if (existing != null) {
+      return existing;
+    }
+    if (states.size() >= MAX_STATES) {
+      failed = true;
+      return null;
+    }
+    states.put(state, state);
+    return state;
+  }
+}
@@ -11,6 +11,7 @@
 package java.util.regex;
 
 import java.util.ArrayList;
+import java.util.HashMap;
 import java.util.List;
 
 /**
@@ -33,6 +34,13 @@ public abstract class Pattern implements PikeVMOpcodes {
   private final int patternFlags;
   private final String pattern;
 
+  // Patterns are immutable, so the ones compiled most recently are kept
+  // around for String.split() and friends, which compile their argument
+  // on every call.
+  private static final int CACHE_SIZE = 64;
+  private static final HashMap<String, Pattern> cache =
+    new HashMap<String, Pattern>();
+
   protected Pattern(String pattern, int flags) {
     this.pattern = pattern;
     this.patternFlags = flags;
@@ -46,7 +54,22 @@ public abstract class Pattern implements PikeVMOpcodes {
     if (flags != 0) {
       throw new UnsupportedOperationException("TODO");
     }
-    return new Compiler().compile(regex);
+
+    synchronized (cache) {
+      Pattern pattern = cache.get(regex);
+      if (pattern != null) {
+        return pattern;
+      }
+    }
+
+    Pattern pattern = new Compiler().compile(regex);
+    synchronized (cache) {
+      if (cache.size() >= CACHE_SIZE) {
+        cache.clear();
+      }
+      cache.put(regex, pattern);
+    }
+    return pattern;
   }
 
   public int flags() {
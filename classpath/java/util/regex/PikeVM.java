@@ -493,7 +493,63 @@ class PikeVM implements PikeVMOpcodes {
     return new String(array);
   }
 
-  private static int length(int opcode) {
+  /**
+   * Determines the characters every match starts with.
+   * <p>
+   * The instructions up to the first non-literal one are executed by every
+   * thread in turn, so a match can only start where they occur in the text,
+   * and {@code find()} can skip ahead to the next occurrence.
+   * </p>
+   *
+   * @return the literal prefix, possibly empty
+   */
+  public String literalPrefix() {
+    int start = findPrefixLength;
+    if (start + 1 < program.length &&
+        program[start] == SAVE_OFFSET && program[start + 1] == 0) {
+      start += 2;
+    }
+    int end = start;
+    while (end < program.length && program[end] >= 0) {
+      ++ end;
+    }
+    char[] array = new char[end - start];
+    for (int i = start; i < end; ++ i) {
+      array[i - start] = (char)program[i];
+    }
+    return new String(array);
+  }
+
+  /**
+   * Builds a {@link DFA} for this program.
+   *
+   * @param find
+   *          whether the automaton should search for the first match, like
+   *          {@code find()}, rather than match at the start offset
+   * @return the automaton, or null if this program needs the Pike VM
+   */
+  public DFA toDFA(boolean find) {
+    return DFA.compile(program, find ? 0 : findPrefixLength, classes, find);
+  }
+
+  /**
+   * Builds a {@link DFA} for the reverse program, to be run backward from the
+   * end of a match to find where it starts.
+   *
+   * @return the automaton, or null if this program needs the Pike VM
+   */
+  public DFA toReverseDFA() {
+    PikeVM reverse = new PikeVM(program.clone(), findPrefixLength, groupCount,
+      classes, lookarounds);
+    reverse.reverse();
+    return DFA.compile(reverse.program, findPrefixLength, classes, false);
+  }
+
+  public int groupCount() {
+    return groupCount;
+  }
+
+  static int length(int opcode) {
     return opcode <= SINGLE_ARG_START && opcode >= SINGLE_ARG_END ? 2 : 1;
   }
 
@@ -16,13 +16,16 @@ package java.util.regex;
  * @author Johannes Schindelin
  */
 public class RegexMatcher extends Matcher {
+  private final RegexPattern pattern;
   private final PikeVM vm;
+  private String string;
   private char[] array;
   int[] groupStart, groupEnd;
 
-  RegexMatcher(PikeVM vm, CharSequence string) {
+  RegexMatcher(RegexPattern pattern, CharSequence string) {
     super(string);
-    this.vm = vm;
+    this.pattern = pattern;
+    this.vm = pattern.vm;
   }
 
   private final PikeVM.Result adapter = new PikeVM.Result() {
@@ -41,12 +44,29 @@ public class RegexMatcher extends Matcher {
 
   public Matcher reset(CharSequence input) {
     this.input = input;
-    array = input.toString().toCharArray();
+    string = input.toString();
+    array = string.toCharArray();
     return reset();
   }
 
+  private void setMatch(int start, int end) {
+    this.start = start;
+    this.end = end;
+    groupStart = new int[] { start };
+    groupEnd = new int[] { end };
+  }
+
   public boolean matches() {
-    return vm.matches(array, 0, array.length, true, true, adapter);
+    DFA dfa = pattern.matchDFA;
+    int end = dfa == null ? DFA.FAILED : dfa.forward(array, 0, array.length);
+    if (end == DFA.FAILED || (end == array.length && vm.groupCount() > 0)) {
+      return vm.matches(array, 0, array.length, true, true, adapter);
+    }
+    if (end != array.length) {
+      return false;
+    }
+    setMatch(0, end);
+    return true;
   }
 
   public boolean find() {
@@ -54,6 +74,34 @@ public class RegexMatcher extends Matcher {
   }
 
   public boolean find(int offset) {
+    if (offset > array.length) {
+      return false;
+    }
+
+    // a match can only start where its literal prefix occurs
+    if (pattern.literalPrefix.length() > 0) {
+      offset = string.indexOf(pattern.literalPrefix, offset);
+      if (offset < 0) {
+        return false;
+      }
+    }
+
+    DFA dfa = pattern.findDFA;
+    if (dfa != null) {
+      int end = dfa.forward(array, offset, array.length);
+      if (end == -1) {
+        return false;
+      }
+      int start = end == DFA.FAILED ? DFA.FAILED :
+        pattern.reverseDFA.backward(array, offset, end);
+      if (start != DFA.FAILED) {
+        if (vm.groupCount() > 0) {
+          return vm.matches(array, start, end, true, true, adapter);
+        }
+        setMatch(start, end);
+        return true;
+      }
+    }
     return vm.matches(array, offset, array.length, false, false, adapter);
   }
 
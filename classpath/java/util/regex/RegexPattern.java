@@ -40,18 +40,32 @@ package java.util.regex;
  * <li>independent, non-capturing group: (?>X)</li>
  * </ul>
  * </p>
+ * <p>
+ * Patterns without look-arounds or boundary matchers are run by lazily-built
+ * automata (see {@link DFA}) instead, which tell whether and where a match
+ * occurs; the Pike VM is only asked for the groups, and only once the match
+ * is known.
+ * </p>
  * 
  * @author Johannes Schindelin
  */
 public class RegexPattern extends Pattern {
-  private PikeVM vm;
+  final PikeVM vm;
+  // automata for matches(), for finding where a match ends in find(), and
+  // for finding where it starts; null when the program needs the Pike VM
+  final DFA matchDFA, findDFA, reverseDFA;
+  final String literalPrefix;
 
   public RegexMatcher matcher(CharSequence string) {
-    return new RegexMatcher(vm, string);
+    return new RegexMatcher(this, string);
   }
 
   RegexPattern(String regex, int flags, PikeVM vm) {
     super(regex, flags);
     this.vm = vm;
+    matchDFA = vm.toDFA(false);
+    findDFA = vm.toDFA(true);
+    reverseDFA = findDFA == null ? null : vm.toReverseDFA();
+    literalPrefix = vm.literalPrefix();
   }
 }
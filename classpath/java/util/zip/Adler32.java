@@ -0,0 +1,46 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.zip;
+
+public class Adler32 implements Checksum {
+  private static final int Base = 65521;
+
+  // the checksum so far, in the form zlib's adler32 takes and returns:
+  // the sum of the bytes plus one in the low half, and the sum of those
+  // sums in the high half
+  private int adler = 1;
+
+  public void reset() {
+    adler = 1;
+  }
+
+  public void update(int b) {
+    int low = ((adler & 0xFFFF) + (b & 0xFF)) % Base;
+    int high = ((adler >>> 16) + low) % Base;
+    adler = (high << 16) | low;
+  }
+
+  public void update(byte[] array, int offset, int length) {
+    Inflater.checkBounds(array, offset, length);
+    adler = update(adler, array, offset, length);
+  }
+
+  public void update(byte[] array) {
+    update(array, 0, array.length);
+  }
+
+  public long getValue() {
+    return adler & 0xFFFFFFFFL;
+  }
+
+  private static native int update(int adler, byte[] array, int offset,
+                                   int length);
+}
@@ -10,42 +10,39 @@
 
 package java.util.zip;
 
-public class CRC32 {
-  private static final int Polynomial = 0x04C11DB7;
-  private static final int Width = 32;
-  private static final int Top = 1 << (Width - 1);
-  private static final int InitialRemainder = 0xFFFFFFFF;
-  private static final long ResultXor = 0xFFFFFFFFL;
+public class CRC32 implements Checksum {
+  private static final int Polynomial = 0xEDB88320;
 
   private static final int[] table = new int[256];
 
   static {
     for (int dividend = 0; dividend < 256; ++ dividend) {
-      int remainder = dividend << (Width - 8);
+      int remainder = dividend;
       for (int bit = 8; bit > 0; --bit) {
-        remainder = ((remainder & Top) != 0)
-          ? (remainder << 1) ^ Polynomial
-          : (remainder << 1);
+        remainder = ((remainder & 1) != 0)
+          ? (remainder >>> 1) ^ Polynomial
+          : (remainder >>> 1);
       }
       table[dividend] = remainder;
     }
   }
 
-  private int remainder = InitialRemainder;
+  // the checksum so far, in the form zlib's crc32 takes and returns
+  private int crc;
 
   public void reset() {
-    remainder = InitialRemainder;
+    crc = 0;
   }
 
   public void update(int b) {
-    remainder = table[reflect(b, 8) ^ (remainder >>> (Width - 8))]
-      ^ (remainder << 8);
+    int remainder = ~crc;
+    remainder = table[(remainder ^ b) & 0xFF] ^ (remainder >>> 8);
+    crc = ~remainder;
   }
 
   public void update(byte[] array, int offset, int length) {
-    for (int i = 0; i < length; ++i) {
-      update(array[offset + i] & 0xFF);
-    }
+    Inflater.checkBounds(array, offset, length);
+    crc = update(crc, array, offset, length);
   }
 
   public void update(byte[] array) {
@@ -53,17 +50,9 @@ public class CRC32 {
   }
 
   public long getValue() {
-    return (reflect(remainder, Width) ^ ResultXor) & 0xFFFFFFFFL;
+    return crc & 0xFFFFFFFFL;
   }
 
-  private static int reflect(int x, int n) {
-    int reflection = 0;
-    for (int i = 0; i < n; ++i) {
-      if ((x & 1) != 0) {
-        reflection |= (1 << ((n - 1) - i));
-      }
-      x = (x >>> 1);
-    }
-    return reflection;
-  }
+  private static native int update(int crc, byte[] array, int offset,
+                                   int length);
 }
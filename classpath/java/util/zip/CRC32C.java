@@ -0,0 +1,68 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+package java.util.zip;
+
+/**
+ * The Castagnoli CRC, as used by iSCSI, SCTP, and various storage
+ * formats, which has better error detection than {@link CRC32} and is
+ * what the SSE 4.2 and ARMv8 CRC instructions compute.
+ */
+public final class CRC32C implements Checksum {
+  private static final int Polynomial = 0x82F63B78;
+
+  private static final int[] table = new int[256];
+
+  static {
+    for (int dividend = 0; dividend < 256; ++ dividend) {
+      int remainder = dividend;
+      for (int bit = 8; bit > 0; --bit) {
+        remainder = ((remainder & 1) != 0)
+          ? (remainder >>> 1) ^ Polynomial
+          : (remainder >>> 1);
+      }
+      table[dividend] = remainder;
+    }
+
+    initialize();
+  }
+
+  // the checksum so far, in the same form as CRC32's
+  private int crc;
+
+  public void reset() {
+    crc = 0;
+  }
+
+  public void update(int b) {
+    int remainder = ~crc;
+    remainder = table[(remainder ^ b) & 0xFF] ^ (remainder >>> 8);
+    crc = ~remainder;
+  }
+
+  public void update(byte[] array, int offset, int length) {
+    Inflater.checkBounds(array, offset, length);
+    crc = update(crc, array, offset, length);
+  }
+
+  public void update(byte[] array) {
+    update(array, 0, array.length);
+  }
+
+  public long getValue() {
+    return crc & 0xFFFFFFFFL;
+  }
+
+  // builds the native code's tables and checks for the CRC instructions
+  private static native void initialize();
+
+  private static native int update(int crc, byte[] array, int offset,
+                                   int length);
+}
@@ -10,6 +10,9 @@
 
 package java.util.zip;
 
+import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+
 public class Deflater {
   private static final int DEFAULT_LEVEL = 6; // default compression level (6 is default for gzip)
   private static final int Z_OK = 0;
@@ -22,6 +25,7 @@ public class Deflater {
 
   private long peer;
   private byte[] input;
+  private ByteBuffer inputBuffer;
   private int offset;
   private int length;
   private boolean needDictionary;
@@ -80,15 +84,30 @@ public class Deflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    Inflater.checkBounds(input, offset, length);
     this.input = input;
+    this.inputBuffer = null;
     this.offset = offset;
     this.length = length;
   }
 
+  public void setInput(ByteBuffer input) {
+    if (input.hasArray()) {
+      this.input = input.array();
+      this.offset = input.arrayOffset() + input.position();
+    } else {
+      this.input = null;
+      this.offset = input.position();
+    }
+    this.inputBuffer = input;
+    this.length = input.remaining();
+  }
+
   public void reset() {
     dispose();
     peer = make(nowrap, DEFAULT_LEVEL);
     input = null;
+    inputBuffer = null;
     offset = length = 0;
     finish = false;
     needDictionary = finished = false;
@@ -99,6 +118,31 @@ public class Deflater {
   }
 
   public int deflate(byte[] output, int offset, int length) {
+    Inflater.checkBounds(output, offset, length);
+    return deflate(output, null, offset, length);
+  }
+
+  public int deflate(ByteBuffer output) {
+    if (output.isReadOnly()) {
+      throw new ReadOnlyBufferException();
+    }
+
+    int count;
+    if (output.hasArray()) {
+      count = deflate(output.array(), null,
+                      output.arrayOffset() + output.position(),
+                      output.remaining());
+    } else {
+      count = deflate(null, output, output.position(), output.remaining());
+    }
+
+    output.position(output.position() + count);
+    return count;
+  }
+
+  private int deflate(byte[] output, ByteBuffer outputBuffer, int offset,
+                      int length)
+  {
     final int zlibResult = 0;
     final int inputCount = 1;
     final int outputCount = 2;
@@ -107,14 +151,16 @@ public class Deflater {
       throw new IllegalStateException();      
     }
 
-    if (input == null || output == null) {
+    if ((input == null && inputBuffer == null)
+        || (output == null && outputBuffer == null))
+    {
       throw new NullPointerException();
     }
 
     int[] results = new int[3];
-    deflate(peer, 
-            input, this.offset, this.length,
-            output, offset, length, finish, results);
+    deflate(peer, input, input == null ? inputBuffer : null,
+            this.offset, this.length, output, outputBuffer, offset, length,
+            finish, results);
 
     if (results[zlibResult] < 0) {
       throw new AssertionError();
@@ -132,6 +178,9 @@ public class Deflater {
 
     this.offset += results[inputCount];
     this.length -= results[inputCount];
+    if (inputBuffer != null) {
+      inputBuffer.position(inputBuffer.position() + results[inputCount]);
+    }
     
     return results[outputCount];
   }
@@ -142,8 +191,10 @@ public class Deflater {
 
   private static native void deflate
     (long peer,
-     byte[] input, int inputOffset, int inputLength,
-     byte[] output, int outputOffset, int outputLength,
+     byte[] inputArray, ByteBuffer inputBuffer, int inputOffset,
+     int inputLength,
+     byte[] outputArray, ByteBuffer outputBuffer, int outputOffset,
+     int outputLength,
      boolean finish,
      int[] results);
 
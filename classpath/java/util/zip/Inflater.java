@@ -10,6 +10,9 @@
 
 package java.util.zip;
 
+import java.nio.ByteBuffer;
+import java.nio.ReadOnlyBufferException;
+
 public class Inflater {
   private static final int Z_OK = 0;
   private static final int Z_STREAM_END = 1;
@@ -21,6 +24,7 @@ public class Inflater {
 
   private long peer;
   private byte[] input;
+  private ByteBuffer inputBuffer;
   private int offset;
   private int length;
   private boolean needDictionary;
@@ -42,6 +46,14 @@ public class Inflater {
     }
   }
 
+  // the natives work on the arrays in place, so they rely on us to
+  // keep them within bounds
+  static void checkBounds(byte[] array, int offset, int length) {
+    if (offset < 0 || length < 0 || offset > array.length - length) {
+      throw new ArrayIndexOutOfBoundsException();
+    }
+  }
+
   private static native long make(boolean nowrap);
 
   public boolean finished() {
@@ -65,15 +77,30 @@ public class Inflater {
   }
 
   public void setInput(byte[] input, int offset, int length) {
+    checkBounds(input, offset, length);
     this.input = input;
+    this.inputBuffer = null;
     this.offset = offset;
     this.length = length;
   }
 
+  public void setInput(ByteBuffer input) {
+    if (input.hasArray()) {
+      this.input = input.array();
+      this.offset = input.arrayOffset() + input.position();
+    } else {
+      this.input = null;
+      this.offset = input.position();
+    }
+    this.inputBuffer = input;
+    this.length = input.remaining();
+  }
+
   public void reset() {
     dispose();
     peer = make(nowrap);
     input = null;
+    inputBuffer = null;
     offset = length = 0;
     needDictionary = finished = false;
   }
@@ -84,6 +111,34 @@ public class Inflater {
 
   public int inflate(byte[] output, int offset, int length)
     throws DataFormatException
+  {
+    checkBounds(output, offset, length);
+    return inflate(output, null, offset, length);
+  }
+
+  public int inflate(ByteBuffer output)
+    throws DataFormatException
+  {
+    if (output.isReadOnly()) {
+      throw new ReadOnlyBufferException();
+    }
+
+    int count;
+    if (output.hasArray()) {
+      count = inflate(output.array(), null,
+                      output.arrayOffset() + output.position(),
+                      output.remaining());
+    } else {
+      count = inflate(null, output, output.position(), output.remaining());
+    }
+
+    output.position(output.position() + count);
+    return count;
+  }
+
+  private int inflate(byte[] output, ByteBuffer outputBuffer, int offset,
+                      int length)
+    throws DataFormatException
   {
     final int zlibResult = 0;
     final int inputCount = 1;
@@ -93,13 +148,16 @@ public class Inflater {
       throw new IllegalStateException();      
     }
 
-    if (input == null || output == null) {
+    if ((input == null && inputBuffer == null)
+        || (output == null && outputBuffer == null))
+    {
       throw new NullPointerException();
     }
 
     int[] results = new int[3];
-    inflate(peer, input, this.offset, this.length,
-            output, offset, length, results);
+    inflate(peer, input, input == null ? inputBuffer : null,
+            this.offset, this.length, output, outputBuffer, offset, length,
+            results);
 
     if (results[zlibResult] < 0) {
       throw new DataFormatException();
@@ -117,16 +175,45 @@ public class Inflater {
 
     this.offset += results[inputCount];
     this.length -= results[inputCount];
+    if (inputBuffer != null) {
+      inputBuffer.position(inputBuffer.position() + results[inputCount]);
+    }
     
     return results[outputCount];
   }
 
   private static native void inflate
     (long peer,
-     byte[] input, int inputOffset, int inputLength,
-     byte[] output, int outputOffset, int outputLength,
+     byte[] inputArray, ByteBuffer inputBuffer, int inputOffset,
+     int inputLength,
+     byte[] outputArray, ByteBuffer outputBuffer, int outputOffset,
+     int outputLength,
      int[] results);
 
+  // Inflates a complete stream into exactly outputLength bytes in a
+  // single call.  ZipFile uses this for entries whose sizes it already
+  // knows, which saves the per-chunk round trips of the streaming path.
+  static void inflate(byte[] input, int inputOffset, int inputLength,
+                      byte[] output, int outputOffset, int outputLength,
+                      boolean nowrap)
+    throws DataFormatException
+  {
+    checkBounds(input, inputOffset, inputLength);
+    checkBounds(output, outputOffset, outputLength);
+
+    if (inflateFully(input, inputOffset, inputLength,
+                     output, outputOffset, outputLength, nowrap)
+        != outputLength)
+    {
+      throw new DataFormatException();
+    }
+  }
+
+  private static native int inflateFully
+    (byte[] input, int inputOffset, int inputLength,
+     byte[] output, int outputOffset, int outputLength,
+     boolean nowrap);
+
   public void end() {
     dispose();
   }
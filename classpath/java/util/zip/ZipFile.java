@@ -10,6 +10,7 @@
 
 package java.util.zip;
 
+import java.io.ByteArrayInputStream;
 import java.io.File;
 import java.io.RandomAccessFile;
 import java.io.InputStream;
@@ -20,6 +21,10 @@ import java.util.Map;
 import java.util.HashMap;
 
 public class ZipFile {
+  // deflated entries up to this size are inflated in a single call
+  // when opened, rather than streamed a buffer at a time
+  private static final int WholeEntryLimit = 1024 * 1024;
+
   private final RandomAccessFile file;
   private final Window window;
   private final Map<String,Integer> index = new HashMap();
@@ -89,6 +94,7 @@ public class ZipFile {
     final int pointer = ((MyEntry) entry).pointer();
     int method = compressionMethod(window, pointer);
     int size = compressedSize(window, pointer);
+    final int uncompressed = uncompressedSize(window, pointer);
     InputStream in = new MyInputStream(file, fileData(window, pointer), size);
 
     final int Stored = 0;
@@ -99,8 +105,12 @@ public class ZipFile {
       return in;
 
     case Deflated:
+      if (uncompressed >= 0 && uncompressed <= WholeEntryLimit) {
+        return inflateWhole(pointer, size, uncompressed);
+      }
+
       return new InflaterInputStream(in, new Inflater(true)) {
-        int remaining = uncompressedSize(window, pointer);
+        int remaining = uncompressed;
 
         public int read() throws IOException {
           byte[] buffer = new byte[1];
@@ -132,6 +142,23 @@ public class ZipFile {
     }
   }
 
+  private InputStream inflateWhole(int pointer, int size, int uncompressed)
+    throws IOException
+  {
+    byte[] compressed = new byte[size];
+    file.seek(fileData(window, pointer));
+    file.readFully(compressed);
+
+    byte[] data = new byte[uncompressed];
+    try {
+      Inflater.inflate(compressed, 0, size, data, 0, data.length, true);
+    } catch (DataFormatException e) {
+      throw new IOException(e);
+    }
+
+    return new ByteArrayInputStream(data);
+  }
+
   private static boolean equal(byte[] a, int aOffset, byte[] b, int bOffset,
                                int size)
   {
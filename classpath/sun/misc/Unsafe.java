@@ -88,13 +88,17 @@ public final class Unsafe {
 
   public native void putLongVolatile(Object o, long offset, long x);
 
-  public long getLong(Object o, long offset) {
-    return getLongVolatile(o, offset);
-  }
+  public native short getShort(Object o, long offset);
 
-  public void putLong(Object o, long offset, long x) {
-    putLongVolatile(o, offset, x);
-  }
+  public native void putShort(Object o, long offset, short x);
+
+  public native int getInt(Object o, long offset);
+
+  public native void putInt(Object o, long offset, int x);
+
+  public native long getLong(Object o, long offset);
+
+  public native void putLong(Object o, long offset, long x);
 
   public double getDouble(Object o, long offset) {
     return getDoubleVolatile(o, offset);
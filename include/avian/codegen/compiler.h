@@ -83,6 +83,31 @@ class Compiler {
   static const unsigned TailJump = 1 << 2;
   static const unsigned LongJumpOrCall = 1 << 3;
 
+  // For a native call to a function of a thread, a class and an
+  // object which checks the object against the class: the call is
+  // skipped if the object is null or exactly of that class, and the
+  // result, if any, is then 0 or 1 respectively.
+  static const unsigned ClassCheck = 1 << 4;
+
+  // For a native call to a function of a thread, an object, an offset
+  // and a value which stores the value in the object at that offset
+  // and tells the heap about it: the store is made in line, and the
+  // call skipped if the value is null or the object is in the calling
+  // thread's local heap, since the heap keeps no record of either.  A
+  // null object still goes to the call, so the function may throw.
+  static const unsigned StoreBarrier = 1 << 5;
+
+  // For a native call to a function of a thread, a class, a non-null
+  // allocation site and either a size in words or, for an array, a
+  // length and an element size, which allocates an object of that
+  // class: unless the site is due to be sampled, pretenured or
+  // profiled, the object is too big or the calling thread's local heap
+  // too full, it is allocated from that heap in line, zeroed, given its
+  // class (and length) and counted at the site, and the call skipped.
+  // The size must be constant, and arrays are only allocated in line
+  // when their length is too.
+  static const unsigned InlineAllocation = 1 << 6;
+
   class State {
   };
 
@@ -99,6 +124,11 @@ class Compiler {
   virtual void visitLogicalIp(unsigned logicalIp) = 0;
   virtual void startLogicalIp(unsigned logicalIp) = 0;
 
+  // Tells the compiler that the logical instruction just started may
+  // be reached other than from the one before it, so that values
+  // computed earlier are no longer treated as known constants.
+  virtual void startBlock() = 0;
+
   virtual Promise* machineIp(unsigned logicalIp) = 0;
 
   virtual Promise* poolAppend(intptr_t value) = 0;
@@ -148,6 +178,10 @@ class Compiler {
                            ir::Value* index,
                            intptr_t handler) = 0;
 
+  // Reads the first word of the object, so that a null object faults
+  // at this point, as it would have had the code used the word.
+  virtual void checkNull(ir::Value* object) = 0;
+
   virtual ir::Value* truncateThenExtend(ir::ExtendMode extendMode,
                                         ir::Type extendType,
                                         ir::Type truncateType,
@@ -183,6 +217,19 @@ class Compiler {
                        unsigned stackLimitOffset) = 0;
   virtual unsigned resolve(uint8_t* dst) = 0;
   virtual unsigned poolSize() = 0;
+  virtual unsigned eventCount() = 0;
+
+  // Calls made only when a check fails, like the one checkBounds
+  // makes for an index out of bounds, are compiled after the rest of
+  // the method so the code which runs needn't jump over them.  These
+  // give the code each such call occupies and the address it would
+  // have returned to had it been made in line, which is what tables
+  // keyed by return address should treat it as.
+  virtual unsigned coldCallCount() = 0;
+  virtual void coldCall(unsigned index,
+                        Promise** start,
+                        Promise** end,
+                        Promise** hotReturn) = 0;
   virtual void write() = 0;
 
   virtual void dispose() = 0;
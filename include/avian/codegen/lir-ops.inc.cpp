@@ -25,6 +25,8 @@ LIR_OP_2(Int2Float)
 LIR_OP_2(FloatSquareRoot)
 LIR_OP_2(FloatAbsolute)
 LIR_OP_2(Absolute)
+LIR_OP_2(PopCount)
+LIR_OP_2(CountLeadingZeros)
 
 LIR_OP_3(Add)
 LIR_OP_3(Subtract)
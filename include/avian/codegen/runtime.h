@@ -39,6 +39,10 @@ uint64_t negateFloat(uint32_t a);
 uint64_t absoluteFloat(uint32_t a);
 int64_t absoluteLong(int64_t a);
 int64_t absoluteInt(int32_t a);
+int64_t popCountLong(uint64_t a);
+int64_t popCountInt(uint32_t a);
+int64_t countLeadingZerosLong(uint64_t a);
+int64_t countLeadingZerosInt(uint32_t a);
 uint64_t floatToDouble(int32_t a);
 int64_t floatToInt(int32_t a);
 int64_t floatToLong(int32_t a);
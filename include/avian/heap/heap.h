@@ -38,6 +38,54 @@ class Heap : public avian::util::Allocator {
     virtual bool visit(unsigned) = 0;
   };
 
+  // sizes are in bytes and times in milliseconds
+  class Statistics {
+   public:
+    // totals since the heap was created:
+    unsigned collections;
+    unsigned majorCollections;
+    int64_t totalPauseTime;
+    int64_t maxPauseTime;
+
+    // the most recent collection:
+    CollectionType type;
+    int64_t pauseTime;
+    unsigned copied;
+    unsigned tenured;
+    unsigned freedFixies;
+    unsigned untenuredFixies;
+    unsigned tenuredFixies;
+    unsigned gen1Before;
+    unsigned gen1After;
+    unsigned gen2Before;
+    unsigned gen2After;
+
+    // native memory from allocateDirect:
+    unsigned directFootprint;  // obtained from the system, in use or not
+    unsigned directPooled;  // free in the depot shared by all threads
+  };
+
+  // Native memory from allocateDirect is pooled in power-of-two size
+  // classes up to MaxPooledDirectSize bytes.  Each thread keeps a cache
+  // of free blocks which it exchanges in batches with a shared depot,
+  // so most allocations and frees don't take the heap's lock.
+  static const unsigned DirectClassCount = 11;
+  static const size_t MaxPooledDirectSize = static_cast<size_t>(64) << 10;
+
+  class DirectCache {
+   public:
+    DirectCache()
+    {
+      for (unsigned i = 0; i < DirectClassCount; ++i) {
+        blocks[i] = 0;
+        counts[i] = 0;
+      }
+    }
+
+    void* blocks[DirectClassCount];
+    unsigned counts[DirectClassCount];
+  };
+
   class Client {
    public:
     virtual void collect(void* context, CollectionType type) = 0;
@@ -46,13 +94,56 @@ class Heap : public avian::util::Allocator {
     virtual unsigned sizeInWords(void*) = 0;
     virtual unsigned copiedSizeInWords(void*) = 0;
     virtual void copy(void*, void*) = 0;
+    // called after an object has been copied into the old generation
+    // by a minor collection.  May be called from any collector thread.
+    virtual void tenured(void*) = 0;
     virtual void walk(void*, Walker*) = 0;
   };
 
   virtual void setClient(Client* client) = 0;
   virtual void setImmortalHeap(uintptr_t* start, unsigned sizeInWords) = 0;
+  // use the specified number of threads (including the one requesting
+  // the collection) for minor collections.  Only has an effect on
+  // builds with atomic operations available.
+  virtual void setCollectorThreads(unsigned count) = 0;
+  // trace the old generation on a background thread between
+  // collections so that major collections have less to do.  Only has an
+  // effect on builds with atomic operations available.
+  virtual void setConcurrentMarking(bool enabled) = 0;
+  // trace the old generation a slice at a time as the client reports
+  // allocation via allocated(), rather than on a background thread,
+  // letting each slice run for about the specified number of
+  // milliseconds at most.  Has no effect while concurrent marking is
+  // enabled.
+  virtual void setIncrementalMarking(unsigned pauseInMilliseconds) = 0;
+  // size the allocation budget between minor collections (see
+  // incomingBudget) so each minor collection should pause for about
+  // the specified number of milliseconds at most, based on how fast
+  // recent ones copied and how much of what they collected survived
+  virtual void setPauseTarget(unsigned milliseconds) = 0;
+  // the number of bytes the client may allocate outside the heap before
+  // the next minor collection, or zero if it should use its own default
+  virtual unsigned incomingBudget() = 0;
+  // called by the client outside of collections, one thread at a
+  // time, to report that it has allocated the specified number of
+  // bytes
+  virtual void allocated(unsigned sizeInBytes) = 0;
+  // slide live objects toward the start of the old generation during
+  // major collections where possible, rather than copying them to a
+  // new space, so a major collection needs little more memory than the
+  // live old generation itself.
+  virtual void setGen2Compaction(bool enabled) = 0;
+  // back the generations with large pages where the system provides
+  // them.  Must be called before anything is allocated.
+  virtual void setLargePages(bool enabled) = 0;
   virtual unsigned remaining() = 0;
   virtual unsigned limit() = 0;
+  // the number of bytes currently held by the heap, not counting
+  // memory which has been returned to the system
+  virtual unsigned committed() = 0;
+  // the part of committed() reserved for objects but not yet occupied
+  virtual unsigned unused() = 0;
+  virtual const Statistics& statistics() = 0;
   virtual bool limitExceeded(int pendingAllocation = 0) = 0;
   virtual void collect(CollectionType type,
                        unsigned footprint,
@@ -64,6 +155,19 @@ class Heap : public avian::util::Allocator {
   virtual void* allocateImmortalFixed(avian::util::Alloc* allocator,
                                       unsigned sizeInWords,
                                       bool objectMask) = 0;
+  // allocate an object directly in the old generation, returning null
+  // if there isn't room to spare.  The memory is not cleared, and the
+  // caller must mark() any reference stored in it, including the
+  // header.
+  virtual void* tryAllocateTenured(unsigned sizeInWords) = 0;
+  // allocate native memory which the garbage collector neither moves
+  // nor frees, returning null if the system has none to spare.  The
+  // memory is not cleared.
+  virtual void* tryAllocateDirect(DirectCache* cache, size_t size) = 0;
+  virtual void freeDirect(DirectCache* cache, void* p) = 0;
+  // return the blocks in the specified cache to the depot, e.g. when
+  // the thread which owns it exits
+  virtual void flushDirect(DirectCache* cache) = 0;
   virtual void mark(void* p, unsigned offset, unsigned count) = 0;
   virtual void pad(void* p) = 0;
   virtual void* follow(void* p) = 0;
@@ -32,13 +32,44 @@ class Memory {
   };
 
   static const size_t PageSize;
+  static const size_t LargePageSize;
 
   // Allocate a contiguous range of pages.
   static util::Slice<uint8_t> allocate(size_t sizeInBytes, Permissions perms = ReadWrite);
 
+  // Like allocate, but ask for the range to be backed by pages of
+  // LargePageSize bytes, falling back to ordinary pages where the
+  // system won't provide them.  The size is rounded up to a multiple of
+  // LargePageSize, and the returned slice covers the whole range.
+  static util::Slice<uint8_t> allocateLarge(size_t sizeInBytes,
+                                            Permissions perms = ReadWrite);
+
+  // Reserve a contiguous range of address space without committing
+  // any memory to it.  The pages may not be touched until they've been
+  // committed with commit, below.  The reservation is placed as
+  // allocate would place memory with the same permissions.
+  static util::Slice<uint8_t> reserve(size_t sizeInBytes,
+                                      Permissions perms = ReadWrite);
+
+  // Commit memory to a page-aligned range within a reservation, making
+  // it accessible with the specified permissions.  Returns false if the
+  // system can't supply the memory.
+  static bool commit(util::Slice<uint8_t> pages, Permissions perms = ReadWrite);
+
   // Free a contiguous range of pages.
   static void free(util::Slice<uint8_t> pages);
 
+  // Let the system reclaim the memory behind a contiguous range of
+  // pages while leaving them mapped.  Their contents are undefined
+  // afterward.
+  static void release(util::Slice<uint8_t> pages);
+
+  // Ask that the whole pages within a range be backed by memory on
+  // the NUMA node of the processor the calling thread is running on,
+  // moving any already touched elsewhere.  This is only a hint, and
+  // does nothing on systems with a single node or no way to say so.
+  static void placeLocally(util::Slice<uint8_t> range);
+
   // TODO: In the future:
   // static void setPermissions(util::Slice<uint8_t> pages, Permissions perms);
 };
@@ -27,6 +27,9 @@ class System : public avian::util::Aborter {
    public:
     virtual void interrupt() = 0;
     virtual bool getAndClearInterrupted() = 0;
+    virtual bool tryPark() = 0;
+    virtual void park(int64_t time) = 0;
+    virtual void unpark() = 0;
     virtual void join() = 0;
     virtual void dispose() = 0;
   };
@@ -114,7 +117,9 @@ class System : public avian::util::Aborter {
   virtual void* tryAllocate(size_t sizeInBytes) = 0;
   virtual void free(const void* p) = 0;
   virtual Status attach(Runnable*) = 0;
-  virtual Status start(Runnable*) = 0;
+  // starts a thread with a stack of the specified size, or the
+  // system's default size if zero
+  virtual Status start(Runnable*, unsigned stackSizeInBytes = 0) = 0;
   virtual Status make(Mutex**) = 0;
   virtual Status make(Monitor**) = 0;
   virtual Status make(Local**) = 0;
@@ -133,7 +138,16 @@ class System : public avian::util::Aborter {
   virtual const char* toAbsolutePath(avian::util::AllocOnly* allocator,
                                      const char* name) = 0;
   virtual int64_t now() = 0;
+  // a monotonic clock for timing intervals, unrelated to the time of day
+  virtual int64_t nanoTime() = 0;
+  // like nanoTime, but cheaper to read where the system offers a clock
+  // which is only accurate to a few milliseconds
+  virtual int64_t coarseNanoTime() = 0;
   virtual void yield() = 0;
+  virtual unsigned processorCount() = 0;
+  // the number of bytes of memory a container (e.g. a cgroup) limits
+  // the process to, or zero if there is no such limit
+  virtual uint64_t memoryLimit() = 0;
   virtual void exit(int code) = 0;
   virtual void dispose() = 0;
 };
@@ -26,7 +26,7 @@ class FixedAllocator : public Alloc {
 
   virtual void* tryAllocate(size_t size);
 
-  void* allocate(size_t size, unsigned padAlignment);
+  virtual void* allocate(size_t size, unsigned padAlignment);
 
   virtual void* allocate(size_t size);
 
@@ -15,6 +15,10 @@
 #include "avian/common.h"
 #include <avian/util/runtime-array.h>
 
+#if (defined ARCH_arm64) && (defined __ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef __APPLE__
 #include "libkern/OSAtomic.h"
 #include "libkern/OSCacheControl.h"
@@ -139,6 +143,19 @@ inline void loadMemoryBarrier()
 #endif
 }
 
+// tells the processor we're spinning on a memory location, so another
+// hardware thread may run in the meantime
+inline void spinLoopHint()
+{
+#ifdef _MSC_VER
+  __yield();
+#elif(defined AVIAN_ASSUME_ARMV6)
+  __asm__ __volatile__("" : : : "memory");
+#else
+  __asm__ __volatile__("yield" : : : "memory");
+#endif
+}
+
 #if !defined(AVIAN_AOT_ONLY)
 
 #if defined(__ANDROID__) || defined(__linux__)
@@ -161,6 +178,63 @@ inline void syncInstructionCache(const void* start, unsigned size)
 
 #endif  // AVIAN_AOT_ONLY
 
+// copies size bytes from src to dst, which must not overlap
+inline void copyMemory(void* dst, const void* src, size_t size)
+{
+  memcpy(dst, src, size);
+}
+
+// returns how many of the first length bytes at p are ASCII, checking
+// 32 at a time with NEON where we have it and then a word at a time
+inline unsigned asciiPrefixLength(const uint8_t* p, unsigned length)
+{
+  unsigned i = 0;
+#if (defined ARCH_arm64) && (defined __ARM_NEON)
+  for (; length - i >= 32; i += 32) {
+    if (vmaxvq_u8(vorrq_u8(vld1q_u8(p + i), vld1q_u8(p + i + 16))) & 0x80) {
+      break;
+    }
+  }
+#endif
+
+  const uintptr_t HighBits = static_cast<uintptr_t>(0x8080808080808080ULL);
+  for (; length - i >= sizeof(uintptr_t); i += sizeof(uintptr_t)) {
+    uintptr_t v;
+    memcpy(&v, p + i, sizeof(uintptr_t));
+    if (v & HighBits) {
+      break;
+    }
+  }
+
+  while (i < length and (p[i] & 0x80) == 0) {
+    ++i;
+  }
+  return i;
+}
+
+// returns the index of the first '\n' or '\r' among the first length
+// UTF-16 code units at p, or length if there is none, checking eight
+// at a time with NEON where we have it
+inline unsigned lineBreakIndex(const uint16_t* p, unsigned length)
+{
+  unsigned i = 0;
+#if (defined ARCH_arm64) && (defined __ARM_NEON)
+  const uint16x8_t lf = vdupq_n_u16('\n');
+  const uint16x8_t cr = vdupq_n_u16('\r');
+  for (; length - i >= 8; i += 8) {
+    uint16x8_t v = vld1q_u16(p + i);
+    if (vmaxvq_u16(vorrq_u16(vceqq_u16(v, lf), vceqq_u16(v, cr)))) {
+      break;
+    }
+  }
+#endif
+
+  while (i < length and p[i] != '\n' and p[i] != '\r') {
+    ++i;
+  }
+  return i;
+}
+
 #ifndef __APPLE__
 typedef int(__kernel_cmpxchg_t)(int oldval, int newval, int* ptr);
 #define __kernel_cmpxchg (*(__kernel_cmpxchg_t*)0xffff0fc0)
@@ -197,6 +271,39 @@ inline bool atomicCompareAndSwap(uintptr_t* p, uintptr_t old, uintptr_t new_)
 {
   return atomicCompareAndSwap32(reinterpret_cast<uint32_t*>(p), old, new_);
 }
+
+#if (defined __ARM_ARCH) && (__ARM_ARCH >= 7)
+#define AVIAN_HAS_ALIGNED_CAS64
+
+// ldrexd and strexd fault unless the address is eight-byte aligned,
+// which heap objects on 32-bit targets need not be, so callers must
+// check first
+inline bool atomicCompareAndSwap64Aligned(uint64_t* p,
+                                          uint64_t old,
+                                          uint64_t new_)
+{
+  uint64_t value;
+  unsigned failed;
+
+  memoryBarrier();
+
+  do {
+    __asm__ __volatile__(
+        "ldrexd %1, %H1, [%3]\n"
+        "mov %0, #0\n"
+        "teq %1, %4\n"
+        "teqeq %H1, %H4\n"
+        "strexdeq %0, %5, %H5, [%3]"
+        : "=&r"(failed), "=&r"(value), "+Qo"(*p)
+        : "r"(p), "r"(old), "r"(new_)
+        : "cc");
+  } while (failed);
+
+  memoryBarrier();
+
+  return value == old;
+}
+#endif
 #endif
 
 #if (defined __APPLE__) && (defined ARCH_arm64)
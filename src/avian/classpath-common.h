@@ -19,11 +19,15 @@ using namespace avian::util;
 
 namespace vm {
 
-object getTrace(Thread* t, unsigned skipCount)
+// Returns the trace of the calling thread's stack, less the top
+// skipCount frames and any Throwable constructors below them, and
+// recording at most limit frames if limit is non-zero.
+object getTrace(Thread* t, unsigned skipCount, unsigned limit = 0)
 {
   class Visitor : public Processor::StackVisitor {
    public:
-    Visitor(Thread* t, int skipCount) : t(t), trace(0), skipCount(skipCount)
+    Visitor(Thread* t, int skipCount, unsigned limit)
+        : t(t), trace(0), skipCount(skipCount), limit(limit)
     {
     }
 
@@ -36,7 +40,7 @@ object getTrace(Thread* t, unsigned skipCount)
                            method->name()->body().begin()) == 0) {
           return true;
         } else {
-          trace = makeTrace(t, walker);
+          trace = makeTrace(t, walker, limit);
           return false;
         }
       } else {
@@ -48,12 +52,13 @@ object getTrace(Thread* t, unsigned skipCount)
     Thread* t;
     object trace;
     unsigned skipCount;
-  } v(t, skipCount);
+    unsigned limit;
+  } v(t, skipCount, limit);
 
   t->m->processor->walkStack(t, &v);
 
   if (v.trace == 0)
-    v.trace = makeObjectArray(t, 0);
+    v.trace = makeEmptyTrace(t);
 
   return v.trace;
 }
@@ -90,12 +95,14 @@ void arrayCopy(Thread* t,
                       sbody + (srcOffset * elementSize),
                       length * elementSize);
             } else {
-              memcpy(dbody + (dstOffset * elementSize),
-                     sbody + (srcOffset * elementSize),
-                     length * elementSize);
+              copyMemory(dbody + (dstOffset * elementSize),
+                         sbody + (srcOffset * elementSize),
+                         length * elementSize);
             }
 
             if (objectClass(t, dst)->objectMask()) {
+              // one call covers the whole range, so the heap marks each
+              // card it spans once rather than once per element
               mark(t, dst, ArrayBody + (dstOffset * BytesPerWord), length);
             }
 
@@ -250,11 +257,12 @@ System::Library* loadLibrary(Thread* t,
   return lib;
 }
 
-GcStackTraceElement* makeStackTraceElement(Thread* t, GcTraceElement* e)
+GcStackTraceElement* makeStackTraceElement(Thread* t,
+                                           object trace,
+                                           unsigned index)
 {
-  PROTECT(t, e);
-
-  GcMethod* method = cast<GcMethod>(t, e->method());
+  GcMethod* method = traceMethod(t, trace, index);
+  int ip = traceIp(t, trace, index);
   PROTECT(t, method);
 
   GcByteArray* class_name = method->class_()->name();
@@ -275,7 +283,7 @@ GcStackTraceElement* makeStackTraceElement(Thread* t, GcTraceElement* e)
       t, method_name, 0, method_name->length() - 1);
   PROTECT(t, method_name_string);
 
-  unsigned line = t->m->processor->lineNumber(t, method, e->ip());
+  unsigned line = t->m->processor->lineNumber(t, method, ip);
 
   GcByteArray* file = method->class_()->sourceFile();
   GcString* file_string
@@ -621,7 +629,7 @@ void intercept(Thread* t,
       // through the vtable.
       clone->flags() |= ACC_PRIVATE;
 
-      GcNativeIntercept* native = makeNativeIntercept(t, function, true, clone);
+      GcNativeIntercept* native = makeNativeIntercept(t, function, true, 0, clone);
 
       PROTECT(t, native);
 
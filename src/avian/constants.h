@@ -218,7 +218,31 @@ enum OpCode {
   sipush = 0x11,
   swap = 0x5f,
   tableswitch = 0xaa,
-  wide = 0xc4
+  wide = 0xc4,
+
+  // The interpreter rewrites some instructions to these once their
+  // operands have been resolved.  They take the same operands as the
+  // originals and never appear in class files.
+  getfield_quick = 0xcb,
+  getfield_quick_int = 0xcc,
+  getfield_quick_object = 0xcd,
+  invokevirtual_quick = 0xce,
+  new_quick = 0xcf,
+  putfield_quick_int = 0xd8,
+  putfield_quick_object = 0xd9,
+  invokespecial_quick = 0xda,
+  invokestatic_quick = 0xdb,
+
+  // Superinstructions which replace the first instruction of a common
+  // sequence and execute the whole of it, leaving the rest in place.
+  aload_0_getfield_quick_int = 0xd0,
+  aload_0_getfield_quick_object = 0xd1,
+  iinc_goto = 0xd2,
+  iload_iload_if_icmp = 0xd3,
+  iload_0_iload_if_icmp = 0xd4,
+  iload_1_iload_if_icmp = 0xd5,
+  iload_2_iload_if_icmp = 0xd6,
+  iload_3_iload_if_icmp = 0xd7
 };
 
 enum TypeCode {
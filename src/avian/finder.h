@@ -107,6 +107,11 @@ inline uint32_t centralDirectoryOffset(const uint8_t* centralHeader)
   return get4(centralHeader + 16);
 }
 
+inline uint16_t centralDirectoryEntryCount(const uint8_t* centralHeader)
+{
+  return get2(centralHeader + 10);
+}
+
 inline const uint8_t* fileName(const uint8_t* centralHeader)
 {
   return centralHeader + 46;
@@ -201,10 +206,14 @@ class Finder {
   virtual void dispose() = 0;
 };
 
+// If inflateCacheSize is nonzero, up to that many bytes of deflated
+// jar entries are kept after they've been found, in case they're
+// needed again.
 AVIAN_EXPORT Finder* makeFinder(System* s,
                                 avian::util::Alloc* a,
                                 const char* path,
-                                const char* bootLibrary);
+                                const char* bootLibrary,
+                                size_t inflateCacheSize = 0);
 
 Finder* makeFinder(System* s,
                    avian::util::Alloc* a,
@@ -21,6 +21,36 @@
 #define CLASSPATH_PROPERTY "java.class.path"
 #define JAVA_HOME_PROPERTY "java.home"
 #define REENTRANT_PROPERTY "avian.reentrant"
+#define GC_THREADS_PROPERTY "avian.gc.threads"
+#define GC_CONCURRENT_MARK_PROPERTY "avian.gc.concurrentMark"
+#define GC_INCREMENTAL_PROPERTY "avian.gc.incremental"
+#define GC_PAUSE_TARGET_PROPERTY "avian.gc.pauseTarget"
+#define GC_GEN2_PROPERTY "avian.gc.gen2"
+#define GC_STRING_DEDUP_PROPERTY "avian.gc.stringDedup"
+#define GC_SOFT_REFERENCE_IDLE_PROPERTY "avian.gc.softReferenceIdlePerMegabyte"
+#define LARGE_PAGES_PROPERTY "avian.heap.largePages"
+#define GC_LOG_PROPERTY "avian.gc.log"
+#define FINALIZER_THREADS_PROPERTY "avian.finalizer.threads"
+#define JIT_THREADS_PROPERTY "avian.jit.threads"
+#define JIT_CODE_CACHE_PROPERTY "avian.jit.codeCache"
+#define JIT_PERF_MAP_PROPERTY "avian.jit.perfMap"
+#define JIT_DUMP_PROPERTY "avian.jit.dump"
+#define JIT_STATISTICS_PROPERTY "avian.jit.statistics"
+#define FINDER_CACHE_PROPERTY "avian.finder.cache"
+#define THREAD_STACK_SIZE_PROPERTY "avian.thread.stackSize"
+#define HEAP_PERCENTAGE_PROPERTY "avian.heap.percentage"
+#define KEEP_ATTACHED_DAEMONS_PROPERTY "avian.jni.keepAttachedDaemons"
+#define PROFILE_PROPERTY "avian.profile"
+#define ALLOCATION_PROFILE_INTERVAL_PROPERTY "avian.allocation.profileInterval"
+#define CONTENTION_PROFILE_PROPERTY "avian.contention.profile"
+#define EVENTS_PROPERTY "avian.events"
+#define EVENTS_CRASH_DUMP_PROPERTY "avian.events.crashDump"
+#define STARTUP_TRACE_PROPERTY "avian.startup.trace"
+#define BOOTIMAGE_IN_PLACE_PROPERTY "avian.bootimage.inPlace"
+#define THROWABLE_TRACE_DEPTH_PROPERTY "avian.throwable.maxTraceDepth"
+#define PRELOAD_PROPERTY "avian.preload"
+#define PRELOAD_INIT_PROPERTY "avian.preload.init"
+#define PRELOAD_RECORD_PROPERTY "avian.preload.record"
 #define BOOTCLASSPATH_PREPEND_OPTION "bootclasspath/p"
 #define BOOTCLASSPATH_OPTION "bootclasspath"
 #define BOOTCLASSPATH_APPEND_OPTION "bootclasspath/a"
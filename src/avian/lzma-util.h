@@ -15,6 +15,9 @@
 #include <C/Types.h>
 #include <avian/system/system.h>
 #include <avian/util/allocator.h>
+#include <avian/util/math.h>
+
+#include "lzma/blocks.h"
 
 namespace vm {
 
@@ -51,6 +54,99 @@ class LzmaAllocator {
   }
 };
 
+// works on every stride'th block from first on, in a thread of its own
+// unless it's the share of the thread which started the others
+class BlockWorker : public System::Runnable {
+ public:
+  BlockWorker(avian::lzma::Block* blocks,
+              unsigned count,
+              unsigned first,
+              unsigned stride,
+              void (*function)(avian::lzma::Block*, ISzAlloc*),
+              avian::util::Alloc* a)
+      : blocks(blocks),
+        count(count),
+        first(first),
+        stride(stride),
+        function(function),
+        allocator(a),
+        thread(0)
+  {
+  }
+
+  virtual void attach(System::Thread* t)
+  {
+    thread = t;
+  }
+
+  virtual void run()
+  {
+    for (unsigned i = first; i < count; i += stride) {
+      function(blocks + i, &(allocator.allocator));
+    }
+  }
+
+  virtual bool interrupted()
+  {
+    return false;
+  }
+
+  virtual void setInterrupted(bool)
+  {
+  }
+
+  avian::lzma::Block* blocks;
+  unsigned count;
+  unsigned first;
+  unsigned stride;
+  void (*function)(avian::lzma::Block*, ISzAlloc*);
+  LzmaAllocator allocator;
+  System::Thread* thread;
+};
+
+// Runs function on each of the count blocks, spreading them over as
+// many threads as there are processors.  The allocator must be safe to
+// use from all of them at once.
+inline void forEachBlock(System* s,
+                         avian::util::Alloc* a,
+                         avian::lzma::Block* blocks,
+                         unsigned count,
+                         void (*function)(avian::lzma::Block*, ISzAlloc*))
+{
+  unsigned threadCount = avian::util::min(
+      avian::util::min(s->processorCount(), count), avian::lzma::MaxThreads);
+
+  BlockWorker* workers = static_cast<BlockWorker*>(
+      a->allocate(threadCount * sizeof(BlockWorker)));
+
+  for (unsigned i = 0; i < threadCount; ++i) {
+    new (workers + i) BlockWorker(blocks, count, i, threadCount, function, a);
+  }
+
+  // we take the first share here, and any we couldn't start a thread
+  // for
+  for (unsigned i = 1; i < threadCount; ++i) {
+    if (not s->success(s->start(workers + i))) {
+      workers[i].thread = 0;
+    }
+  }
+
+  for (unsigned i = 0; i < threadCount; ++i) {
+    if (i == 0 or workers[i].thread == 0) {
+      workers[i].run();
+    }
+  }
+
+  for (unsigned i = 1; i < threadCount; ++i) {
+    if (workers[i].thread) {
+      workers[i].thread->join();
+      workers[i].thread->dispose();
+    }
+  }
+
+  a->free(workers, threadCount * sizeof(BlockWorker));
+}
+
 }  // namespace vm
 
 #endif  // LZMA_UTIL_H
@@ -139,22 +139,99 @@ const uintptr_t HashTakenMark = 1;
 const uintptr_t ExtendedMark = 2;
 const uintptr_t FixedMark = 3;
 
+// A thread which finds a monitor held spins up to the monitor's spin
+// limit before queueing for it.  The limit doubles each time spinning
+// succeeds and halves each time it fails, within these bounds.
+const unsigned InitialMonitorSpinLimit = 64;
+const unsigned MinimumMonitorSpinLimit = 4;
+const unsigned MaximumMonitorSpinLimit = 4096;
+
 const unsigned ThreadHeapSizeInBytes = 64 * 1024;
 const unsigned ThreadHeapSizeInWords = ThreadHeapSizeInBytes / BytesPerWord;
 
+// thread-local heaps start out at ThreadHeapSizeInBytes and are then
+// resized after each collection to allow roughly this many refills
+// before the next one, based on how much the thread allocated since the
+// last one (see postCollect):
+const unsigned ThreadHeapRefillsPerCollection = 16;
+const unsigned MinimumThreadHeapSizeInBytes = 4 * 1024;
+const unsigned MinimumThreadHeapSizeInWords = MinimumThreadHeapSizeInBytes
+                                              / BytesPerWord;
+const unsigned MaximumThreadHeapSizeInBytes = 256 * 1024;
+const unsigned MaximumThreadHeapSizeInWords = MaximumThreadHeapSizeInBytes
+                                              / BytesPerWord;
+
 const unsigned ThreadBackupHeapSizeInBytes = 2 * 1024;
 const unsigned ThreadBackupHeapSizeInWords = ThreadBackupHeapSizeInBytes
                                              / BytesPerWord;
 
 const unsigned ThreadHeapPoolSize = 64;
+const unsigned ThreadHeapPoolFootprintInWords = ThreadHeapPoolSize
+                                                * ThreadHeapSizeInWords;
 
 const unsigned FixedFootprintThresholdInBytes = ThreadHeapPoolSize
                                                 * ThreadHeapSizeInBytes;
 
+// number of default-sized thread heaps kept after their threads are
+// disposed, so threads which come and go (e.g. native threads attaching
+// for a callback) needn't allocate a fresh one each time:
+const unsigned SpareThreadHeapCount = 8;
+
+// maximum number of threads which may run finalizers and cleaners at
+// once (see the avian.finalizer.threads property):
+const unsigned MaximumFinalizeThreadCount = 16;
+
 // number of zombie threads which may accumulate before we force a GC
 // to clean them up:
 const unsigned ZombieCollectionThreshold = 16;
 
+// room left on a native stack for native frames beyond the Java
+// frames allowed by -Xss:
+const unsigned NativeStackReserveInBytes = 64 * 1024;
+
+// largest native stack we will ask the system to reserve for a thread:
+const unsigned MaximumThreadStackSizeInBytes = 1024 * 1024 * 1024;
+
+// one allocation in this many at a profiled site is watched to see
+// whether it dies young:
+const unsigned AllocationSampleInterval = 64;
+
+// number of allocations which may be watched at once:
+const unsigned AllocationSampleCount = 256;
+
+// number of watched allocations a site's pretenuring decision is
+// based on:
+const unsigned AllocationSiteWindow = 16;
+
+// buckets in the table of allocations sampled for profiling, when
+// sampling is enabled:
+const unsigned AllocationProfileBucketCount = 1024;
+
+const unsigned ContentionProfileBucketCount = 1024;
+
+// number of strings tenured by one minor collection which may be
+// considered for deduplication:
+const unsigned StringDedupCandidateCount = 4096;
+
+// milliseconds a soft reference's target may go unused per megabyte
+// of free heap before a collection may clear the reference:
+const unsigned DefaultSoftReferenceMillisecondsPerMegabyte = 1000;
+
+// slots in the table of canonical string arrays, when string
+// deduplication is enabled:
+const unsigned StringDedupTableSize = 8192;
+
+// buckets in the table of native symbols looked up so far:
+const unsigned NativeSymbolBucketCount = 1024;
+
+// spin locks guarding volatile eight-byte fields which can't be read
+// or written in a single access (see loadWide):
+const unsigned WideLockCount = 64;
+
+// how many of its contended acquisitions a thread lets pass between
+// samples of the owner's stack
+const unsigned ContentionOwnerSampleInterval = 8;
+
 enum FieldCode {
   VoidField,
   ByteField,
@@ -189,10 +266,17 @@ const unsigned LinkFlag = 1 << 8;
 const unsigned HasFinalMemberFlag = 1 << 9;
 const unsigned SingletonFlag = 1 << 10;
 const unsigned ContinuationFlag = 1 << 11;
+const unsigned StringFlag = 1 << 12;
+const unsigned SoftReferenceFlag = 1 << 13;
 
 // method vmFlags:
 const unsigned ClassInitFlag = 1 << 0;
 const unsigned ConstructorFlag = 1 << 1;
+// set once a loaded class overrides the method
+const unsigned OverriddenFlag = 1 << 2;
+// set while compiled code calls the method directly on the strength
+// of its not being overridden (see compile.cpp)
+const unsigned DevirtualizedFlag = 1 << 3;
 
 #ifndef JNI_VERSION_1_6
 #define JNI_VERSION_1_6 0x00010006
@@ -977,8 +1061,278 @@ class Reference {
   bool weak;
 };
 
+// An allocation site in compiled code which may be pretenured.  A
+// site's objects are allocated directly in the old generation once
+// nearly all of its sampled allocations are seen to survive long
+// enough to be tenured anyway, and in the young generation again if
+// later samples (which are always allocated there) start dying young.
+// While allocations are profiled, compiled code leaves every one at
+// the site to the allocator, so that each is counted.
+class AllocationSite {
+ public:
+  AllocationSite(AllocationSite* next, bool profiled)
+      : next(next),
+        allocations(0),
+        survived(0),
+        died(0),
+        pretenure(false),
+        profiled(profiled)
+  {
+  }
+
+  AllocationSite* next;
+  unsigned allocations;
+  unsigned survived;
+  unsigned died;
+  bool pretenure;
+  bool profiled;
+};
+
+class AllocationSample {
+ public:
+  object target;
+  AllocationSite* site;
+  unsigned collections;
+};
+
+// The most recent allocation a thread sampled for profiling.  Its
+// class isn't known until the allocator's caller has set it, so the
+// sample is only added to the profile at the next sample or collection,
+// whichever comes first.
+class PendingAllocationSample {
+ public:
+  object target;
+  GcMethod* method;
+  int ip;
+  unsigned weight;
+};
+
+// The number and estimated size of sampled allocations of one class at
+// one site, keyed by "<class> <site>".
+class AllocationProfileEntry {
+ public:
+  AllocationProfileEntry(AllocationProfileEntry* next,
+                         uint32_t hash,
+                         unsigned length)
+      : next(next), hash(hash), length(length), count(0), bytes(0)
+  {
+  }
+
+  char* key()
+  {
+    return reinterpret_cast<char*>(this + 1);
+  }
+
+  AllocationProfileEntry* next;
+  uint32_t hash;
+  unsigned length;
+  unsigned count;
+  uint64_t bytes;
+};
+
+// A contended monitor acquisition being timed for the contention
+// profile.  The owner's method and IP are taken from a sample of its
+// stack, when one was taken.
+class ContentionSample {
+ public:
+  ContentionSample() : lockClass(0), ownerMethod(0), ownerIp(0), start(0)
+  {
+  }
+
+  GcClass* lockClass;
+  GcMethod* ownerMethod;
+  int ownerIp;
+  int64_t start;
+};
+
+// The number of contended acquisitions of monitors belonging to
+// instances of one class at one site, and the time spent waiting for
+// them, keyed by "<class> <site> <owner site>".
+class ContentionProfileEntry {
+ public:
+  ContentionProfileEntry(ContentionProfileEntry* next,
+                         uint32_t hash,
+                         unsigned length)
+      : next(next), hash(hash), length(length), count(0), milliseconds(0)
+  {
+  }
+
+  char* key()
+  {
+    return reinterpret_cast<char*>(this + 1);
+  }
+
+  ContentionProfileEntry* next;
+  uint32_t hash;
+  unsigned length;
+  unsigned count;
+  uint64_t milliseconds;
+};
+
+// The result of looking up a native method's symbol in the loaded
+// libraries, keyed by its decorated name.  If the symbol wasn't found,
+// we remember the last library searched, since libraries are only
+// ever appended and a later search need only try the ones after it.
+class NativeSymbol {
+ public:
+  NativeSymbol(NativeSymbol* next, uint32_t hash, unsigned length)
+      : next(next), hash(hash), length(length), address(0), searched(0)
+  {
+  }
+
+  char* name()
+  {
+    return reinterpret_cast<char*>(this + 1);
+  }
+
+  NativeSymbol* next;
+  uint32_t hash;
+  unsigned length;
+  void* address;
+  System::Library* searched;
+};
+
+// The kinds of event the event recorder keeps.  Times are in
+// nanoseconds.
+enum RecordedEventType {
+  // value: Heap::CollectionType
+  GcBeginEvent = 1,
+  // value: Heap::CollectionType, data: time taken
+  GcEndEvent,
+  // value: code size, data: time taken, text: method
+  CompileEvent,
+  // value: class file size, data: time taken, text: class
+  ClassLoadEvent,
+  // text: class of the object the monitor was made for
+  MonitorInflateEvent,
+  // the thread started waiting for others to stop for it
+  SafepointBeginEvent,
+  // data: time taken
+  SafepointEndEvent,
+  ThreadStartEvent,
+  ThreadStopEvent
+};
+
+const unsigned EventBufferCapacity = 256;
+
+const unsigned RecordedEventTextLength = 40;
+
+class RecordedEvent {
+ public:
+  int64_t time;
+  uint64_t data;
+  uint32_t value;
+  uint16_t type;
+  uint16_t textLength;
+  char text[RecordedEventTextLength];
+};
+
+// A ring holding the most recent events one thread has recorded.  It
+// outlives the thread, so that the events leading up to its exit can
+// still be dumped, until another thread needs a buffer.
+class EventBuffer {
+ public:
+  EventBuffer(EventBuffer* next, unsigned number)
+      : next(next), owner(0), number(number), count(0), retired(0)
+  {
+  }
+
+  EventBuffer* next;
+  Thread* owner;
+  unsigned number;
+  // events recorded since the buffer was last handed out, of which
+  // the ring holds the most recent EventBufferCapacity
+  unsigned count;
+  // when the owner was disposed of, or zero if it's still alive
+  int64_t retired;
+  RecordedEvent events[EventBufferCapacity];
+};
+
+// Aborts on behalf of the VM, first writing the recorded events to the
+// file named by the avian.events.crashDump property, if any.
+class MachineAborter : public Aborter {
+ public:
+  MachineAborter(Machine* m) : m(m)
+  {
+  }
+
+  virtual void NO_RETURN abort();
+
+  Machine* m;
+};
+
+enum StartupPhase {
+  FinderStartupPhase,
+  ProcessorStartupPhase,
+  MachineStartupPhase,
+  ThreadStartupPhase,
+  // decompressing the boot image, which is part of ThreadStartupPhase
+  LzmaStartupPhase,
+  BootStartupPhase,
+  StartupPhaseCount
+};
+
+const unsigned StartupTraceInitializerCount = 10;
+
+class StartupTraceInitializer {
+ public:
+  int64_t time;
+  unsigned nameLength;
+  char name[RecordedEventTextLength];
+};
+
+// Where the time went between JNI_CreateJavaVM and the launcher
+// calling main, kept when the avian.startup.trace property is set.
+class StartupTrace {
+ public:
+  StartupTrace(System::Mutex* lock, FILE* out, int64_t start)
+      : lock(lock),
+        out(out),
+        start(start),
+        parseTime(0),
+        parseCount(0),
+        initTime(0),
+        initCount(0),
+        slowestCount(0),
+        reported(false)
+  {
+    memset(phases, 0, sizeof(phases));
+  }
+
+  System::Mutex* lock;
+  FILE* out;
+  int64_t start;
+  int64_t phases[StartupPhaseCount];
+  int64_t parseTime;
+  unsigned parseCount;
+  // time spent in initializers not triggered by other initializers
+  int64_t initTime;
+  unsigned initCount;
+  // ordered from slowest to fastest; times include the initializers
+  // each one triggers
+  StartupTraceInitializer slowest[StartupTraceInitializerCount];
+  unsigned slowestCount;
+  bool reported;
+};
+
+// The classes and methods used so far, in the order they were first
+// loaded, initialized, or compiled, kept when the avian.preload.record
+// property names a file.  That file can later be passed to the
+// avian.preload property to have it all done ahead of time.
+class PreloadLog {
+ public:
+  PreloadLog(System::Mutex* lock, FILE* out) : lock(lock), out(out)
+  {
+  }
+
+  System::Mutex* lock;
+  FILE* out;
+};
+
 class Classpath;
 
+class Profiler;
+
 class Gc {
  public:
   enum Type {
@@ -1008,6 +1362,7 @@ class GcJreference;
 class GcArray;
 class GcThrowable;
 class GcRoots;
+class ClassPlaceholder;
 
 class Machine {
  public:
@@ -1046,25 +1401,37 @@ class Machine {
   Classpath* classpath;
   Thread* rootThread;
   Thread* exclusive;
-  Thread* finalizeThread;
+  Thread* finalizeThreads[MaximumFinalizeThreadCount];
+  unsigned finalizeThreadCount;
   Reference* jniReferences;
+  ClassPlaceholder* classPlaceholders;
+  // incremented, with classLock held, whenever a class is added to a
+  // loader other than by finding it through the loader's finder, which
+  // invalidates the misses SystemClassLoaders have cached
+  unsigned savedClassCount;
   char** properties;
   unsigned propertyCount;
   const char** arguments;
   unsigned argumentCount;
   unsigned threadCount;
-  unsigned activeCount;
   unsigned liveCount;
   unsigned daemonCount;
   unsigned fixedFootprint;
   unsigned stackSizeInBytes;
+  // the native stack size for Java threads which don't ask for one, or
+  // zero for the system's default
+  unsigned threadStackSizeInBytes;
   System::Local* localThread;
   System::Monitor* stateLock;
   System::Monitor* heapLock;
   System::Monitor* classLock;
   System::Monitor* referenceLock;
   System::Monitor* shutdownLock;
+  System::Mutex* spareThreadHeapLock;
   System::Library* libraries;
+  System::Monitor* nativeSymbolLock;
+  NativeSymbol* nativeSymbols[NativeSymbolBucketCount];
+  uintptr_t wideLocks[WideLockCount];
   FILE* errorLog;
   BootImage* bootimage;
   GcArray* types;
@@ -1074,16 +1441,61 @@ class Machine {
   GcFinalizer* finalizeQueue;
   GcJreference* weakReferences;
   GcJreference* tenuredWeakReferences;
+  // the time (in milliseconds) of the current or most recent
+  // collection, and how long before that a soft reference's target
+  // may have last been used and still survive it (see postVisit)
+  int64_t softReferenceClock;
+  int64_t softReferenceMaxIdle;
+  unsigned softReferenceMillisecondsPerMegabyte;
   bool unsafe;
   bool collecting;
   bool triedBuiltinOnLoad;
   bool dumpedHeapOnOOM;
   bool alive;
+  bool keepAttachedDaemons;
   JavaVMVTable javaVMVTable;
   JNIEnvVTable jniEnvVTable;
   uintptr_t* heapPool[ThreadHeapPoolSize];
+  unsigned heapPoolSizeInWords[ThreadHeapPoolSize];
   unsigned heapPoolIndex;
+  unsigned heapPoolFootprint;
+  // how much the pool may hold before a minor collection is needed,
+  // which the heap may adjust after each collection (see
+  // Heap::incomingBudget)
+  unsigned heapPoolCapacityInWords;
+  uintptr_t* spareThreadHeaps[SpareThreadHeapCount];
+  unsigned spareThreadHeapCount;
   size_t bootimageSize;
+  FILE* gcLog;
+  // strings copied into gen2 by the current minor collection, and the
+  // arrays other tenured strings with the same contents are repointed
+  // at, or null if string deduplication is disabled
+  object* stringDedupCandidates;
+  uint32_t stringDedupCandidateCount;
+  object* stringDedupTable;
+  AllocationSite* allocationSites;
+  AllocationSample allocationSamples[AllocationSampleCount];
+  unsigned allocationSampleCount;
+  Profiler* profiler;
+  // bytes allocated between samples for the allocation profile, or
+  // zero if it's disabled
+  unsigned allocationProfileInterval;
+  // most frames recorded in a throwable's stack trace, or zero for no
+  // limit
+  unsigned maxThrowableTraceDepth;
+  System::Monitor* allocationProfileLock;
+  AllocationProfileEntry* allocationProfile[AllocationProfileBucketCount];
+  bool contentionProfiling;
+  System::Monitor* contentionProfileLock;
+  ContentionProfileEntry* contentionProfile[ContentionProfileBucketCount];
+  bool recordingEvents;
+  System::Mutex* eventLock;
+  EventBuffer* eventBuffers;
+  unsigned eventBufferCount;
+  StartupTrace* startupTrace;
+  PreloadLog* preloadLog;
+  System::Runnable* preloader;
+  MachineAborter aborter;
 };
 
 void printTrace(Thread* t, GcThrowable* exception);
@@ -1119,6 +1531,7 @@ extern "C" void vmRun_returnAddress();
 class GcThread;
 class GcThrowable;
 class GcString;
+class GcMonitor;
 
 class Thread {
  public:
@@ -1141,7 +1554,13 @@ class Thread {
     ActiveFlag = 1 << 5,
     SystemFlag = 1 << 6,
     JoinFlag = 1 << 7,
-    TryNativeFlag = 1 << 8
+    TryNativeFlag = 1 << 8,
+    FinalizeFlag = 1 << 9,
+    // set while the thread is blocked in monitorWait, meaning a
+    // notifier may move it straight to the monitor's acquire queue
+    WaitBlockedFlag = 1 << 10,
+    // set by a notifier which has done so
+    WaitQueuedFlag = 1 << 11
   };
 
   class Protector {
@@ -1350,6 +1769,10 @@ class Thread {
   GcThrowable* exception;
   unsigned heapIndex;
   unsigned heapOffset;
+  unsigned heapSizeInWords;
+  unsigned defaultHeapSizeInWords;
+  // allocated on first use by tryAllocateDirect
+  Heap::DirectCache* directCache;
   Protector* protector;
   ClassInitStack* classInitStack;
   LibraryLoadStack* libraryLoadStack;
@@ -1358,8 +1781,22 @@ class Thread {
   Runnable runnable;
   uintptr_t* defaultHeap;
   uintptr_t* heap;
+  // heap + heapSizeInWords, or null when heap is, so compiled code can
+  // tell cheaply whether an object is in the thread-local heap
+  uintptr_t* heapLimit;
   uintptr_t backupHeap[ThreadBackupHeapSizeInWords];
   unsigned backupHeapIndex;
+  // bytes left to allocate before the next allocation profile sample
+  int allocationProfileCountdown;
+  PendingAllocationSample pendingAllocationSample;
+  // contended acquisitions since the last owner stack sample
+  unsigned contentionCount;
+  // where this thread records events, or null if recording is off
+  EventBuffer* events;
+  // the object whose monitor this thread last looked up, and that
+  // monitor; cleared by every collection, since objects may move
+  object monitorCacheObject;
+  GcMonitor* monitorCacheMonitor;
 
  private:
   unsigned flags;
@@ -1464,6 +1901,101 @@ Classpath* makeClasspath(System* system,
 typedef uint64_t(JNICALL* FastNativeFunction)(Thread*, GcMethod*, uintptr_t*);
 typedef void(JNICALL* FastVoidNativeFunction)(Thread*, GcMethod*, uintptr_t*);
 
+// A JNI method whose parameters each fit in one general purpose
+// register or stack word, and which returns neither a float nor a
+// double, may be called through an ordinary C function pointer of the
+// right arity instead of the generic vmNativeCall trampoline, which
+// has to classify every argument on every call.  We decide this once,
+// when the method is linked, and record it in the native's shape along
+// with which parameters are references and (on 64-bit targets) which
+// are longs, so callers can also skip parsing the method spec.
+const unsigned MaxDirectNativeParameters = 6;
+const unsigned MaxDirectNativeArguments = MaxDirectNativeParameters + 2;
+const unsigned DirectNativeFlag = 1 << 24;
+
+// A critical native is a static method implemented by a
+// JavaCritical_-prefixed function, following HotSpot's convention: it
+// takes no JNIEnv or class, only primitives, with each primitive array
+// passed as its length followed by a pointer to its body.  Such a
+// function must not call back into the VM, so we call it without
+// leaving the active state or setting up local references, which also
+// means the collector can't move the arrays while it runs.  Critical
+// natives are always called directly, so the same restrictions apply,
+// and their shape marks array parameters as references.
+const unsigned CriticalNativeFlag = 1 << 25;
+
+unsigned directNativeShape(Thread* t, GcMethod* method);
+
+unsigned criticalNativeShape(Thread* t, GcMethod* method);
+
+inline bool isDirectNative(unsigned shape)
+{
+  return shape & DirectNativeFlag;
+}
+
+inline bool isCriticalNative(unsigned shape)
+{
+  return shape & CriticalNativeFlag;
+}
+
+inline bool directNativeReference(unsigned shape, unsigned index)
+{
+  return shape & (1 << index);
+}
+
+inline bool directNativeWide(unsigned shape, unsigned index)
+{
+  return shape & (1 << (index + 8));
+}
+
+// calls a direct or critical native (see above) with count words of
+// marshalled arguments
+inline uint64_t directNativeCall(Thread* t,
+                                 void* function,
+                                 uintptr_t* a,
+                                 unsigned count)
+{
+  typedef uintptr_t W;
+
+  switch (count) {
+  case 0:
+    return reinterpret_cast<uint64_t(JNICALL*)()>(function)();
+
+  case 1:
+    return reinterpret_cast<uint64_t(JNICALL*)(W)>(function)(a[0]);
+
+  case 2:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W)>(function)(a[0], a[1]);
+
+  case 3:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W, W)>(function)(
+        a[0], a[1], a[2]);
+
+  case 4:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W, W, W)>(function)(
+        a[0], a[1], a[2], a[3]);
+
+  case 5:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W, W, W, W)>(function)(
+        a[0], a[1], a[2], a[3], a[4]);
+
+  case 6:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W, W, W, W, W)>(function)(
+        a[0], a[1], a[2], a[3], a[4], a[5]);
+
+  case 7:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W, W, W, W, W, W)>(
+        function)(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+
+  case 8:
+    return reinterpret_cast<uint64_t(JNICALL*)(W, W, W, W, W, W, W, W)>(
+        function)(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+
+  default:
+    abort(t);
+  }
+}
+
 inline GcClass* objectClass(Thread*, object o)
 {
   return reinterpret_cast<GcClass*>(
@@ -1611,13 +2143,36 @@ class RawMonitorResource : public Thread::Resource {
 
 inline Aborter* getAborter(Thread* t)
 {
-  return t->m->system;
+  return &(t->m->aborter);
+}
+
+void recordEvent(Thread* t,
+                 RecordedEventType type,
+                 uint32_t value,
+                 uint64_t data,
+                 GcByteArray* name,
+                 GcByteArray* memberName = 0);
+
+inline void recordEvent(Thread* t,
+                        RecordedEventType type,
+                        uint32_t value = 0,
+                        uint64_t data = 0)
+{
+  EventBuffer* b = t->events;
+  if (b) {
+    RecordedEvent* e = b->events + (b->count++ & (EventBufferCapacity - 1));
+    e->time = t->m->system->nanoTime();
+    e->data = data;
+    e->value = value;
+    e->type = type;
+    e->textLength = 0;
+  }
 }
 
 inline bool ensure(Thread* t, unsigned sizeInBytes)
 {
   if (t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
-      > ThreadHeapSizeInWords) {
+      > t->heapSizeInWords) {
     if (sizeInBytes <= ThreadBackupHeapSizeInBytes) {
       expect(t, (t->getFlags() & Thread::UseBackupHeapFlag) == 0);
 
@@ -1640,15 +2195,32 @@ object allocate3(Thread* t,
                  unsigned sizeInBytes,
                  bool objectMask);
 
+void sampleAllocation(Thread* t, object o, unsigned sizeInBytes);
+
+inline void countAllocation(Thread* t, object o, unsigned sizeInBytes)
+{
+  t->allocationProfileCountdown -= static_cast<int>(sizeInBytes);
+  if (UNLIKELY(t->allocationProfileCountdown <= 0)) {
+    sampleAllocation(t, o, sizeInBytes);
+  }
+}
+
 inline object allocateSmall(Thread* t, unsigned sizeInBytes)
 {
-  assertT(t,
-          t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
-          <= ThreadHeapSizeInWords);
+  unsigned sizeInWords = ceilingDivide(sizeInBytes, BytesPerWord);
 
-  object o = reinterpret_cast<object>(t->heap + t->heapIndex);
-  t->heapIndex += ceilingDivide(sizeInBytes, BytesPerWord);
-  return o;
+  assertT(t, t->heapIndex + sizeInWords <= t->heapSizeInWords);
+
+  // thread-local heaps are not cleared after a collection, so each
+  // object is zeroed as it is handed out:
+  uintptr_t* p = t->heap + t->heapIndex;
+  memset(p, 0, sizeInWords * BytesPerWord);
+
+  t->heapIndex += sizeInWords;
+
+  countAllocation(t, reinterpret_cast<object>(p), sizeInWords * BytesPerWord);
+
+  return reinterpret_cast<object>(p);
 }
 
 inline object allocate(Thread* t, unsigned sizeInBytes, bool objectMask)
@@ -1656,7 +2228,7 @@ inline object allocate(Thread* t, unsigned sizeInBytes, bool objectMask)
   stress(t);
 
   if (UNLIKELY(t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
-               > ThreadHeapSizeInWords or t->m->exclusive)) {
+               > t->heapSizeInWords or t->m->exclusive)) {
     return allocate2(t, sizeInBytes, objectMask);
   } else {
     assertT(t, t->criticalLevel == 0);
@@ -1664,6 +2236,16 @@ inline object allocate(Thread* t, unsigned sizeInBytes, bool objectMask)
   }
 }
 
+AllocationSite* makeAllocationSite(Thread* t);
+
+// allocates an instance of the specified class at a profiled site,
+// setting its class but leaving the rest of it zeroed
+object allocateAtSite(Thread* t,
+                      AllocationSite* site,
+                      GcClass* class_,
+                      unsigned sizeInBytes,
+                      bool objectMask);
+
 inline void mark(Thread* t, object o, unsigned offset, unsigned count)
 {
   t->m->heap->mark(o, offset / BytesPerWord, count);
@@ -1814,7 +2396,7 @@ inline uint64_t runThread(Thread* t, uintptr_t*)
 
   checkDaemon(t);
 
-  if (t == t->m->finalizeThread) {
+  if (t->getFlags() & Thread::FinalizeFlag) {
     runFinalizeThread(t);
   } else if (t->javaThread) {
     runJavaThread(t);
@@ -1823,10 +2405,36 @@ inline uint64_t runThread(Thread* t, uintptr_t*)
   return 1;
 }
 
+// Returns the native stack size to start the specified thread with,
+// which is the size its Java thread asked for, if any, or else the
+// machine-wide default.  In compiled code, the stack overflow check
+// assumes there are stackSizeInBytes available for Java frames, so we
+// never go below that, plus some room for native frames.
+inline unsigned threadStackSize(Thread* t, Thread* p)
+{
+  uint64_t size = p->javaThread ? p->javaThread->stackSize() : 0;
+  if (size == 0) {
+    size = t->m->threadStackSizeInBytes;
+    if (size == 0) {
+      return 0;
+    }
+  }
+
+  uint64_t minimum = t->m->stackSizeInBytes + NativeStackReserveInBytes;
+  if (size < minimum) {
+    return minimum;
+  } else if (size > MaximumThreadStackSizeInBytes) {
+    return MaximumThreadStackSizeInBytes;
+  } else {
+    return size;
+  }
+}
+
 inline bool startThread(Thread* t, Thread* p)
 {
   p->setFlag(Thread::JoinFlag);
-  return t->m->system->success(t->m->system->start(&(p->runnable)));
+  return t->m->system->success(
+      t->m->system->start(&(p->runnable), threadStackSize(t, p)));
 }
 
 inline void addThread(Thread* t, Thread* p)
@@ -1997,7 +2605,11 @@ inline unsigned baseSize(Thread* t UNUSED, object o, GcClass* class_)
   return size;
 }
 
-object makeTrace(Thread* t, Processor::StackWalker* walker);
+// A stack trace is recorded as just the method and IP of each frame,
+// in two flat arrays, leaving the much larger StackTraceElement
+// objects to be made only if someone asks for them.  If limit is
+// non-zero, at most that many frames are recorded.
+object makeTrace(Thread* t, Processor::StackWalker* walker, unsigned limit = 0);
 
 object makeTrace(Thread* t, Thread* target);
 
@@ -2006,6 +2618,32 @@ inline object makeTrace(Thread* t)
   return makeTrace(t, t);
 }
 
+object makeEmptyTrace(Thread* t);
+
+// Returns the Java thread and raw trace of every live thread in
+// alternating elements, all captured within a single exclusive
+// section.  Elements past the last pair are null.
+GcArray* makeThreadTraces(Thread* t);
+
+// Returns one "\tat Class.method (line N)" line for each frame in
+// the specified trace.
+GcString* makeTraceString(Thread* t, object trace);
+
+inline unsigned traceLength(Thread* t, object trace)
+{
+  return cast<GcTrace>(t, trace)->length();
+}
+
+inline GcMethod* traceMethod(Thread* t, object trace, unsigned index)
+{
+  return cast<GcMethod>(t, cast<GcTrace>(t, trace)->methods()[index]);
+}
+
+inline int traceIp(Thread* t, object trace, unsigned index)
+{
+  return cast<GcTrace>(t, trace)->ips()->body()[index];
+}
+
 inline object makeNew(Thread* t, GcClass* class_)
 {
   assertT(t, t->state == Thread::NoState or t->state == Thread::ActiveState);
@@ -2143,15 +2781,24 @@ inline unsigned extendedSize(Thread* t, object o, unsigned baseSize)
   return baseSize + objectExtended(t, o);
 }
 
+// Marks the object so the collector will extend it with its hash when
+// it is next moved.  The mark is set with a compare-and-swap so that
+// only the thread which sets it takes the heap lock to account for the
+// extra word, and hashing an object again costs nothing.
 inline void markHashTaken(Thread* t, object o)
 {
   assertT(t, not objectExtended(t, o));
   assertT(t, not objectFixed(t, o));
 
-  ACQUIRE_RAW(t, t->m->heapLock);
+  uintptr_t* header = &fieldAtOffset<uintptr_t>(o, 0);
+  for (uintptr_t old = *header; not hashTaken(t, o); old = *header) {
+    if (atomicCompareAndSwap(header, old, old | HashTakenMark)) {
+      ACQUIRE_RAW(t, t->m->heapLock);
 
-  alias(o, 0) |= HashTakenMark;
-  t->m->heap->pad(o);
+      t->m->heap->pad(o);
+      return;
+    }
+  }
 }
 
 inline uint32_t takeHash(Thread*, object o)
@@ -2226,21 +2873,56 @@ inline uint16_t stringCharAt(Thread* t, GcString* s, int i)
   }
 }
 
+// The characters of a string, found once rather than on every access
+// as stringCharAt does.  These point into the string's data, so they
+// are only valid until the next allocation.
+class StringChars {
+ public:
+  StringChars(Thread* t, GcString* s) : length(s->length(t))
+  {
+    object data = s->data();
+    if (objectClass(t, data) == type(t, GcByteArray::Type)) {
+      bytes = cast<GcByteArray>(t, data)->body().begin() + s->offset(t);
+      chars = 0;
+    } else {
+      bytes = 0;
+      chars = cast<GcCharArray>(t, data)->body().begin() + s->offset(t);
+    }
+  }
+
+  uint16_t operator[](unsigned i) const
+  {
+    return bytes ? static_cast<uint16_t>(bytes[i]) : chars[i];
+  }
+
+  const int8_t* bytes;
+  const uint16_t* chars;
+  unsigned length;
+};
+
 inline bool stringEqual(Thread* t, object ao, object bo)
 {
   GcString* a = cast<GcString>(t, ao);
   GcString* b = cast<GcString>(t, bo);
   if (a == b) {
     return true;
-  } else if (a->length(t) == b->length(t)) {
-    for (unsigned i = 0; i < a->length(t); ++i) {
-      if (stringCharAt(t, a, i) != stringCharAt(t, b, i)) {
+  }
+
+  StringChars ac(t, a);
+  StringChars bc(t, b);
+  if (ac.length != bc.length) {
+    return false;
+  } else if (ac.bytes and bc.bytes) {
+    return memcmp(ac.bytes, bc.bytes, ac.length) == 0;
+  } else if (ac.chars and bc.chars) {
+    return memcmp(ac.chars, bc.chars, ac.length * sizeof(uint16_t)) == 0;
+  } else {
+    for (unsigned i = 0; i < ac.length; ++i) {
+      if (ac[i] != bc[i]) {
         return false;
       }
     }
     return true;
-  } else {
-    return false;
   }
 }
 
@@ -2567,6 +3249,61 @@ namespace vm {
 
 void dumpHeap(Thread* t, FILE* out);
 
+void dumpHeapHprof(Thread* t, FILE* out);
+
+void dumpClassHistogram(Thread* t, FILE* out);
+
+void setAllocationProfileInterval(Thread* t, unsigned interval);
+
+void dumpAllocationProfile(Thread* t, FILE* out);
+
+void setContentionProfiling(Thread* t, bool enabled);
+
+// Returns one "count milliseconds class site owner" line for each
+// class and site in the contention profile, most time first.
+GcString* makeContentionProfile(Thread* t);
+
+void acquireEventBuffer(Thread* t);
+
+void releaseEventBuffer(Thread* t);
+
+void disposeEventBuffers(Machine* m);
+
+// Writes the events each thread has recorded, oldest first, one
+// "time type value data text" line apiece.
+void dumpEvents(Thread* t, FILE* out);
+
+void startStartupTrace(Machine* m, int64_t start);
+
+void recordStartupPhase(Machine* m, StartupPhase phase, int64_t time);
+
+void recordClassParse(Thread* t, int64_t time);
+
+void recordClassInit(Thread* t, GcClass* c, int64_t time, bool outermost);
+
+void reportStartup(Thread* t);
+
+void disposeStartupTrace(Machine* m);
+
+void startPreloadLog(Machine* m);
+
+void recordPreloadClass(Thread* t, GcClass* c, bool initialized);
+
+void recordPreloadMethod(Thread* t, GcMethod* method);
+
+// Starts a daemon thread which loads, and optionally initializes and
+// compiles, the classes and methods listed in the file named by the
+// avian.preload property.
+void startPreload(Thread* t);
+
+void disposePreload(Machine* m);
+
+void startProfiler(Thread* t, const char* path);
+
+void stopProfiler(Thread* t);
+
+void disposeProfiler(Machine* m);
+
 inline void NO_RETURN throw_(Thread* t, GcThrowable* e)
 {
   assertT(t, t->exception == 0);
@@ -2583,7 +3320,12 @@ inline void NO_RETURN throw_(Thread* t, GcThrowable* e)
       if (path) {
         FILE* out = vm::fopen(path, "wb");
         if (out) {
-          dumpHeap(t, out);
+          size_t length = strlen(path);
+          if (length > 6 and ::strcmp(path + length - 6, ".hprof") == 0) {
+            dumpHeapHprof(t, out);
+          } else {
+            dumpHeap(t, out);
+          }
           fclose(out);
         }
       }
@@ -2692,6 +3434,44 @@ inline GcMethod* findVirtualMethod(Thread* t, GcMethod* method, GcClass* class_)
       t, cast<GcArray>(t, class_->virtualTable())->body()[method->offset()]);
 }
 
+// classes implementing at least this many interfaces get an
+// interfaceIndex, since below it a scan of the interface table is as
+// quick as hashing
+const unsigned InterfaceIndexThreshold = 4;
+
+// Returns the position of interface in the interface table of
+// class_, which must not itself be an interface, or -1 if class_
+// doesn't implement it.
+inline int interfaceTableIndex(Thread* t, GcClass* class_, GcClass* interface)
+{
+  GcArray* itable = cast<GcArray>(t, class_->interfaceTable());
+  if (itable == 0) {
+    return -1;
+  }
+
+  if (GcIntArray* index = class_->interfaceIndex()) {
+    unsigned mask = index->length() - 1;
+    for (unsigned j = objectHash(t, interface) & mask; index->body()[j];
+         j = (j + 1) & mask) {
+      unsigned i = index->body()[j] - 1;
+      if (itable->body()[i] == interface) {
+        return i;
+      }
+    }
+
+    // the identity hashes of classes in a boot image may not match
+    // the ones the index was built with, so a miss isn't conclusive
+  }
+
+  for (unsigned i = 0; i < itable->length(); i += 2) {
+    if (itable->body()[i] == interface) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
 inline GcMethod* findInterfaceMethod(Thread* t,
                                      GcMethod* method,
                                      GcClass* class_)
@@ -2703,13 +3483,11 @@ inline GcMethod* findInterfaceMethod(Thread* t,
     resolveSystemClass(t, roots(t)->bootLoader(), class_->name());
   }
 
-  GcClass* interface = method->class_();
-  GcArray* itable = cast<GcArray>(t, class_->interfaceTable());
-  for (unsigned i = 0; i < itable->length(); i += 2) {
-    if (itable->body()[i] == interface) {
-      return cast<GcMethod>(
-          t, cast<GcArray>(t, itable->body()[i + 1])->body()[method->offset()]);
-    }
+  int i = interfaceTableIndex(t, class_, method->class_());
+  if (LIKELY(i >= 0)) {
+    GcArray* itable = cast<GcArray>(t, class_->interfaceTable());
+    return cast<GcMethod>(
+        t, cast<GcArray>(t, itable->body()[i + 1])->body()[method->offset()]);
   }
   abort(t);
 }
@@ -2732,6 +3510,21 @@ inline object& objectArrayBody(Thread* t UNUSED, object array, unsigned index)
   return fieldAtOffset<object>(array, ArrayBody + (index * BytesPerWord));
 }
 
+// appends the length and body of a primitive array (or two zeros for
+// null) to the arguments of a critical native, returning the number of
+// words appended
+inline unsigned marshalCriticalArray(object array, uintptr_t* arguments)
+{
+  if (array) {
+    arguments[0] = fieldAtOffset<uintptr_t>(array, ArrayLength);
+    arguments[1] = reinterpret_cast<uintptr_t>(
+        &fieldAtOffset<uint8_t>(array, ArrayBody));
+  } else {
+    arguments[0] = arguments[1] = 0;
+  }
+  return 2;
+}
+
 unsigned parameterFootprint(Thread* t, const char* s, bool static_);
 
 void addFinalizer(Thread* t, object target, void (*finalize)(Thread*, object));
@@ -2859,35 +3652,100 @@ inline bool monitorTryAcquire(Thread* t, GcMonitor* monitor)
   }
 }
 
+// Spins waiting for the owner of a monitor to release it, on the
+// theory that most critical sections are shorter than the time it
+// takes to block and be woken up again.  We give up early if other
+// threads are already queued, since they'd get the monitor first, or if
+// another thread is waiting for us to reach a safepoint.
+inline bool monitorSpinAcquire(Thread* t, GcMonitor* monitor)
+{
+  if (monitorAtomicPollAcquire(t, monitor, false)) {
+    return false;
+  }
+
+  unsigned limit = monitor->spinLimit();
+  for (unsigned i = 0; i < limit; ++i) {
+    spinLoopHint();
+
+    if (monitor->owner() == 0) {
+      if (monitorTryAcquire(t, monitor)) {
+        if (limit < MaximumMonitorSpinLimit) {
+          monitor->spinLimit() = limit * 2;
+        }
+        return true;
+      } else if (monitorAtomicPollAcquire(t, monitor, false)) {
+        break;
+      }
+    }
+
+    if (t->m->exclusive) {
+      return false;
+    }
+  }
+
+  if (limit > MinimumMonitorSpinLimit) {
+    monitor->spinLimit() = limit / 2;
+  }
+  return false;
+}
+
+void beginContention(Thread* t,
+                     GcMonitor* monitor,
+                     object target,
+                     ContentionSample* sample);
+
+void endContention(Thread* t, ContentionSample* sample);
+
+// Waits for the monitor once t has been appended to its acquire queue.
+// The caller must hold t->lock.
+inline void monitorAcquireQueued(Thread* t, GcMonitor* monitor)
+{
+  // note that we don't try to acquire the lock until we're first in
+  // line, both because it's fair and because we don't support
+  // removing elements from arbitrary positions in the queue
+
+  while (not(t == monitorAtomicPollAcquire(t, monitor, false)
+             and atomicCompareAndSwap(
+                     reinterpret_cast<uintptr_t*>(&monitor->owner()),
+                     0,
+                     reinterpret_cast<uintptr_t>(t)))) {
+    ENTER(t, Thread::IdleState);
+
+    t->lock->wait(t->systemThread, 0);
+  }
+
+  expect(t, t == monitorAtomicPollAcquire(t, monitor, true));
+
+  ++monitor->depth();
+}
+
+// If specified, target is the object the monitor belongs to, which
+// the contention profile uses to classify the monitor.
 inline void monitorAcquire(Thread* t,
                            GcMonitor* monitor,
-                           GcMonitorNode* node = 0)
+                           GcMonitorNode* node = 0,
+                           object target = 0)
 {
-  if (not monitorTryAcquire(t, monitor)) {
+  if (not(monitorTryAcquire(t, monitor) or monitorSpinAcquire(t, monitor))) {
+    ContentionSample sample;
+    if (UNLIKELY(t->m->contentionProfiling)) {
+      beginContention(t, monitor, target, &sample);
+    }
+
     PROTECT(t, monitor);
     PROTECT(t, node);
+    PROTECT(t, sample.lockClass);
+    PROTECT(t, sample.ownerMethod);
 
     ACQUIRE(t, t->lock);
 
     monitorAtomicAppendAcquire(t, monitor, node);
 
-    // note that we don't try to acquire the lock until we're first in
-    // line, both because it's fair and because we don't support
-    // removing elements from arbitrary positions in the queue
-
-    while (not(t == monitorAtomicPollAcquire(t, monitor, false)
-               and atomicCompareAndSwap(
-                       reinterpret_cast<uintptr_t*>(&monitor->owner()),
-                       0,
-                       reinterpret_cast<uintptr_t>(t)))) {
-      ENTER(t, Thread::IdleState);
+    monitorAcquireQueued(t, monitor);
 
-      t->lock->wait(t->systemThread, 0);
+    if (UNLIKELY(sample.start)) {
+      endContention(t, &sample);
     }
-
-    expect(t, t == monitorAtomicPollAcquire(t, monitor, true));
-
-    ++monitor->depth();
   }
 
   assertT(t, monitor->owner() == t);
@@ -2982,6 +3840,7 @@ inline bool monitorWait(Thread* t, GcMonitor* monitor, int64_t time)
   expect(t, monitor->owner() == t);
 
   bool interrupted;
+  bool queued;
   unsigned depth;
 
   PROTECT(t, monitor);
@@ -3001,12 +3860,30 @@ inline bool monitorWait(Thread* t, GcMonitor* monitor, int64_t time)
 
     monitorRelease(t, monitor);
 
-    ENTER(t, Thread::IdleState);
+    t->setFlag(Thread::WaitBlockedFlag);
+
+    {
+      ENTER(t, Thread::IdleState);
+
+      interrupted = t->lock->waitAndClearInterrupted(t->systemThread, time);
+    }
+
+    t->clearFlag(Thread::WaitBlockedFlag);
 
-    interrupted = t->lock->waitAndClearInterrupted(t->systemThread, time);
+    queued = (t->getFlags() & Thread::WaitQueuedFlag) != 0;
+    if (queued) {
+      // a notifier has already put us in line for the monitor (see
+      // monitorNotify), and we were woken either because it's our turn
+      // or because we were interrupted or timed out meanwhile
+      t->clearFlag(Thread::WaitQueuedFlag);
+
+      monitorAcquireQueued(t, monitor);
+    }
   }
 
-  monitorAcquire(t, monitor, monitorNode);
+  if (not queued) {
+    monitorAcquire(t, monitor, monitorNode);
+  }
 
   monitor->depth() = depth;
 
@@ -3041,21 +3918,41 @@ inline Thread* monitorPollWait(Thread* t UNUSED, GcMonitor* monitor)
   return next;
 }
 
+// Rather than waking the waiter, only to have it block again on the
+// monitor we still hold, we move it straight to the monitor's acquire
+// queue, so it's woken once, when the monitor is released to it.  The
+// node is allocated first so that running out of memory leaves the
+// waiter where it was.
 inline bool monitorNotify(Thread* t, GcMonitor* monitor)
 {
   expect(t, monitor->owner() == t);
 
+  if (monitor->waitHead() == 0) {
+    return false;
+  }
+
+  PROTECT(t, monitor);
+
+  GcMonitorNode* node = makeMonitorNode(t, 0, 0);
+  PROTECT(t, node);
+
   Thread* next = monitorPollWait(t, monitor);
 
-  if (next) {
-    ACQUIRE(t, next->lock);
+  ACQUIRE(t, next->lock);
 
-    next->lock->notify(t->systemThread);
+  if (next->getFlags() & Thread::WaitBlockedFlag) {
+    node->value() = next;
 
-    return true;
+    monitorAtomicAppendAcquire(t, monitor, node);
+
+    next->setFlag(Thread::WaitQueuedFlag);
   } else {
-    return false;
+    // the waiter has already timed out or been interrupted, and is on
+    // its way to acquiring the monitor itself
+    next->lock->notify(t->systemThread);
   }
+
+  return true;
 }
 
 inline void monitorNotifyAll(Thread* t, GcMonitor* monitor)
@@ -3093,13 +3990,17 @@ inline void acquire(Thread* t, object o)
     hash = objectHash(t, o);
   }
 
+  // o goes on to monitorAcquire for the contention profile, so keep it
+  // current across objectMonitor, which may allocate
+  PROTECT(t, o);
+
   GcMonitor* m = objectMonitor(t, o, true);
 
   if (DebugMonitors) {
     fprintf(stderr, "thread %p acquires %p for %x\n", t, m, hash);
   }
 
-  monitorAcquire(t, m);
+  monitorAcquire(t, m, 0, o);
 }
 
 inline void release(Thread* t, object o)
@@ -3207,6 +4108,18 @@ inline void interrupt(Thread* t, Thread* target)
   }
 }
 
+inline void unpark(Thread* t UNUSED, Thread* target)
+{
+  // Thread::exit clears the peer field and zombie threads are only
+  // disposed of while we hold ExclusiveState, so as long as we stay
+  // in ActiveState the target can't disappear from under us here:
+  assertT(t, t->state == Thread::ActiveState);
+
+  if (target) {
+    target->systemThread->unpark();
+  }
+}
+
 inline bool getAndClearInterrupted(Thread* t, Thread* target)
 {
   if (acquireSystem(t, target)) {
@@ -3228,6 +4141,15 @@ object intern(Thread* t, object s);
 
 object clone(Thread* t, object o);
 
+// implements System.arraycopy; defined with the class library support
+// in classpath-common.h
+void arrayCopy(Thread* t,
+               object src,
+               int32_t srcOffset,
+               object dst,
+               int32_t dstOffset,
+               int32_t length);
+
 void walk(Thread* t, Heap::Walker* w, object o, unsigned start);
 
 int walkNext(Thread* t, object o, int previous);
@@ -3504,11 +4426,47 @@ inline GcField* resolveField(Thread* t,
   return resolveField(t, method->class_()->loader(), method, index, throw_);
 }
 
+// Volatile long and double fields on 32-bit targets are read and
+// written with loadWide and storeWide, which take no monitor.  Without
+// atomic operations they are guarded by the field's monitor instead,
+// and callers hold it around the plain access loadWide falls back to.
+#ifdef USE_ATOMIC_OPERATIONS
+const bool LockWideVolatileFields = false;
+#else
+const bool LockWideVolatileFields = BytesPerWord == 4;
+#endif
+
+int64_t loadWide(Thread* t, int64_t* p);
+
+void storeWide(Thread* t, int64_t* p, int64_t value);
+
+bool compareAndSwapWide(Thread* t, int64_t* p, int64_t old, int64_t new_);
+
+inline bool wideVolatileField(GcField* field)
+{
+  return BytesPerWord == 4 and (field->flags() & ACC_VOLATILE)
+         and (field->code() == DoubleField or field->code() == LongField);
+}
+
+inline int64_t getWideField(Thread* t, object o, GcField* field)
+{
+  int64_t* p = &fieldAtOffset<int64_t>(o, field->offset());
+  return UNLIKELY(wideVolatileField(field)) ? loadWide(t, p) : *p;
+}
+
+inline void setWideField(Thread* t, object o, GcField* field, int64_t value)
+{
+  int64_t* p = &fieldAtOffset<int64_t>(o, field->offset());
+  if (UNLIKELY(wideVolatileField(field))) {
+    storeWide(t, p, value);
+  } else {
+    *p = value;
+  }
+}
+
 inline void acquireFieldForRead(Thread* t, GcField* field)
 {
-  if (UNLIKELY(
-          (field->flags() & ACC_VOLATILE) and BytesPerWord == 4
-          and (field->code() == DoubleField or field->code() == LongField))) {
+  if (UNLIKELY(LockWideVolatileFields and wideVolatileField(field))) {
     acquire(t, field);
   }
 }
@@ -3516,8 +4474,7 @@ inline void acquireFieldForRead(Thread* t, GcField* field)
 inline void releaseFieldForRead(Thread* t, GcField* field)
 {
   if (UNLIKELY(field->flags() & ACC_VOLATILE)) {
-    if (BytesPerWord == 4
-        and (field->code() == DoubleField or field->code() == LongField)) {
+    if (LockWideVolatileFields and wideVolatileField(field)) {
       release(t, field);
     } else {
       loadMemoryBarrier();
@@ -3545,8 +4502,7 @@ class FieldReadResource {
 inline void acquireFieldForWrite(Thread* t, GcField* field)
 {
   if (UNLIKELY(field->flags() & ACC_VOLATILE)) {
-    if (BytesPerWord == 4
-        and (field->code() == DoubleField or field->code() == LongField)) {
+    if (LockWideVolatileFields and wideVolatileField(field)) {
       acquire(t, field);
     } else {
       storeStoreMemoryBarrier();
@@ -3557,8 +4513,7 @@ inline void acquireFieldForWrite(Thread* t, GcField* field)
 inline void releaseFieldForWrite(Thread* t, GcField* field)
 {
   if (UNLIKELY(field->flags() & ACC_VOLATILE)) {
-    if (BytesPerWord == 4
-        and (field->code() == DoubleField or field->code() == LongField)) {
+    if (LockWideVolatileFields and wideVolatileField(field)) {
       release(t, field);
     } else {
       storeLoadMemoryBarrier();
@@ -3611,6 +4566,18 @@ inline GcMethod* resolveMethod(Thread* t,
 
 GcVector* vectorAppend(Thread*, GcVector*, object);
 
+// Classes of the boot and app loaders, which are never unloaded and
+// may be part of a boot image, find their runtime data by index in a
+// VM-wide table, so that image classes needn't be written to.  Other
+// classes hold theirs in their runtimeData field instead, so that the
+// table doesn't keep them reachable after their loader is collected.
+inline bool classRuntimeDataInTable(Thread* t, GcClass* c)
+{
+  GcClassLoader* loader = c->loader();
+  return loader == 0 or loader == roots(t)->bootLoader()
+         or loader == roots(t)->appLoader();
+}
+
 inline GcClassRuntimeData* getClassRuntimeDataIfExists(Thread* t, GcClass* c)
 {
   if (c->runtimeDataIndex()) {
@@ -3618,33 +4585,36 @@ inline GcClassRuntimeData* getClassRuntimeDataIfExists(Thread* t, GcClass* c)
         t,
         roots(t)->classRuntimeDataTable()->body()[c->runtimeDataIndex() - 1]);
   } else {
-    return 0;
+    return cast<GcClassRuntimeData>(t, c->runtimeData());
   }
 }
 
 inline GcClassRuntimeData* getClassRuntimeData(Thread* t, GcClass* c)
 {
-  if (c->runtimeDataIndex() == 0) {
+  if (c->runtimeDataIndex() == 0 and c->runtimeData() == 0) {
     PROTECT(t, c);
 
     ACQUIRE(t, t->m->classLock);
 
-    if (c->runtimeDataIndex() == 0) {
+    if (c->runtimeDataIndex() == 0 and c->runtimeData() == 0) {
       GcClassRuntimeData* runtimeData = makeClassRuntimeData(t, 0, 0, 0, 0);
 
-      {
-        GcVector* v
-            = vectorAppend(t, roots(t)->classRuntimeDataTable(), runtimeData);
-        // sequence point, for gc (don't recombine statements)
-        roots(t)->setClassRuntimeDataTable(t, v);
-      }
+      if (classRuntimeDataInTable(t, c)) {
+        {
+          GcVector* v = vectorAppend(
+              t, roots(t)->classRuntimeDataTable(), runtimeData);
+          // sequence point, for gc (don't recombine statements)
+          roots(t)->setClassRuntimeDataTable(t, v);
+        }
 
-      c->runtimeDataIndex() = roots(t)->classRuntimeDataTable()->size();
+        c->runtimeDataIndex() = roots(t)->classRuntimeDataTable()->size();
+      } else {
+        c->setRuntimeData(t, runtimeData);
+      }
     }
   }
 
-  return cast<GcClassRuntimeData>(
-      t, roots(t)->classRuntimeDataTable()->body()[c->runtimeDataIndex() - 1]);
+  return getClassRuntimeDataIfExists(t, c);
 }
 
 inline GcMethodRuntimeData* getMethodRuntimeData(Thread* t, GcMethod* method)
@@ -3735,7 +4705,8 @@ inline void registerNative(Thread* t, GcMethod* method, void* function)
 
   expect(t, method->flags() & ACC_NATIVE);
 
-  GcNative* native = makeNative(t, function, false);
+  GcNative* native
+      = makeNative(t, function, false, directNativeShape(t, method));
   PROTECT(t, native);
 
   GcMethodRuntimeData* runtimeData = getMethodRuntimeData(t, method);
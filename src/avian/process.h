@@ -56,6 +56,8 @@ void resolveNative(Thread* t, GcMethod* method);
 
 int findLineNumber(Thread* t, GcMethod* method, unsigned ip);
 
+unsigned instructionLength(Thread* t, GcCode* code, unsigned ip);
+
 }  // namespace vm
 
 #endif  // PROCESS_H
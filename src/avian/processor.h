@@ -69,14 +69,36 @@ class Processor {
 
   class CompilationHandler {
    public:
+    // lineNumbers holds entries as encoded by vm::lineNumber, with
+    // each IP relative to code; it is empty (and sourceFile null) for
+    // thunks and methods without debug information.
     virtual void compiled(const void* code,
                           unsigned size,
                           unsigned frameSize,
-                          const char* name) = 0;
+                          const char* name,
+                          const char* sourceFile,
+                          avian::util::Slice<const uint64_t> lineNumbers) = 0;
 
     virtual void dispose() = 0;
   };
 
+  class CompileStatistics {
+   public:
+    // totals over every method compiled since the VM started:
+    unsigned methods;
+    int64_t time;  // in nanoseconds, including waiting for the class lock
+    int64_t maxTime;
+    uint64_t bytecodeSize;
+    uint64_t eventCount;  // of the compiler's intermediate representation
+    uint64_t codeSize;  // machine code, excluding constant pools
+    uint64_t frameMapSize;
+    uint64_t callSites;
+
+    // the executable area methods and thunks are allocated from:
+    uint64_t codeCacheUsed;
+    uint64_t codeCacheCapacity;
+  };
+
   virtual Thread* makeThread(Machine* m, GcThread* javaThread, Thread* parent)
       = 0;
 
@@ -159,6 +181,12 @@ class Processor {
 
   virtual object getStackTrace(Thread* t, Thread* target) = 0;
 
+  // Interrupts target and walks its stack in place, so v must not
+  // allocate, block, or retain the walker beyond the visit.
+  virtual void sampleStack(Thread* t, Thread* target, StackVisitor* v) = 0;
+
+  virtual const CompileStatistics& compileStatistics() = 0;
+
   virtual void initialize(BootImage* image, avian::util::Slice<uint8_t> code)
       = 0;
 
@@ -173,6 +201,10 @@ class Processor {
                              OffsetResolver* resolver,
                              Machine* hostVM) = 0;
 
+  // Compiles the specified method ahead of its first call, if this
+  // processor compiles methods and hasn't already compiled it.
+  virtual void precompile(Thread* t, GcMethod* method) = 0;
+
   virtual void visitRoots(Thread* t, HeapWalker* w) = 0;
 
   virtual void normalizeVirtualThunks(Thread* t) = 0;
@@ -181,6 +213,8 @@ class Processor {
 
   virtual void boot(Thread* t, BootImage* image, uint8_t* code) = 0;
 
+  virtual bool supportsContinuations() = 0;
+
   virtual void callWithCurrentContinuation(Thread* t, object receiver) = 0;
 
   virtual void dynamicWind(Thread* t, object before, object thunk, object after)
@@ -236,6 +270,20 @@ Processor* makeProcessor(System* system,
                          const char* crashDumpDirectory,
                          bool useNativeFeatures);
 
+// Writes /tmp/perf-<pid>.map, which perf uses to name samples taken in
+// generated code.  Returns null if the file can't be written.
+Processor::CompilationHandler* makePerfMapHandler(
+    System* system,
+    avian::util::Allocator* allocator);
+
+// Writes directory/jit-<pid>.dump in perf's jitdump format, including
+// code bytes and line tables, for use with "perf inject --jit".
+// Returns null where unsupported or if the file can't be written.
+Processor::CompilationHandler* makeJitDumpHandler(
+    System* system,
+    avian::util::Allocator* allocator,
+    const char* directory);
+
 }  // namespace vm
 
 #endif  // PROCESSOR_H
@@ -14,45 +14,57 @@
 #ifdef TARGET_BYTES_PER_WORD
 #if (TARGET_BYTES_PER_WORD == 8)
 
+#define TARGET_THREAD_M 8
+#define TARGET_THREAD_JAVATHREAD 72
 #define TARGET_THREAD_EXCEPTION 80
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2264
-#define TARGET_THREAD_EXCEPTIONOFFSET 2272
-#define TARGET_THREAD_EXCEPTIONHANDLER 2280
+#define TARGET_THREAD_HEAPINDEX 88
+#define TARGET_THREAD_HEAPSIZEINWORDS 96
+#define TARGET_THREAD_HEAP 176
+#define TARGET_THREAD_HEAPLIMIT 184
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2352
+#define TARGET_THREAD_EXCEPTIONOFFSET 2360
+#define TARGET_THREAD_EXCEPTIONHANDLER 2368
 
-#define TARGET_THREAD_IP 2224
-#define TARGET_THREAD_STACK 2232
-#define TARGET_THREAD_NEWSTACK 2240
-#define TARGET_THREAD_SCRATCH 2248
-#define TARGET_THREAD_CONTINUATION 2256
-#define TARGET_THREAD_TAILADDRESS 2288
-#define TARGET_THREAD_VIRTUALCALLTARGET 2296
-#define TARGET_THREAD_VIRTUALCALLINDEX 2304
-#define TARGET_THREAD_HEAPIMAGE 2312
-#define TARGET_THREAD_CODEIMAGE 2320
-#define TARGET_THREAD_THUNKTABLE 2328
-#define TARGET_THREAD_DYNAMICTABLE 2336
-#define TARGET_THREAD_STACKLIMIT 2384
+#define TARGET_THREAD_IP 2312
+#define TARGET_THREAD_STACK 2320
+#define TARGET_THREAD_NEWSTACK 2328
+#define TARGET_THREAD_SCRATCH 2336
+#define TARGET_THREAD_CONTINUATION 2344
+#define TARGET_THREAD_TAILADDRESS 2376
+#define TARGET_THREAD_VIRTUALCALLTARGET 2384
+#define TARGET_THREAD_VIRTUALCALLINDEX 2392
+#define TARGET_THREAD_HEAPIMAGE 2400
+#define TARGET_THREAD_CODEIMAGE 2408
+#define TARGET_THREAD_THUNKTABLE 2416
+#define TARGET_THREAD_DYNAMICTABLE 2424
+#define TARGET_THREAD_STACKLIMIT 2472
 
 #elif(TARGET_BYTES_PER_WORD == 4)
 
+#define TARGET_THREAD_M 4
+#define TARGET_THREAD_JAVATHREAD 40
 #define TARGET_THREAD_EXCEPTION 44
-#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2168
-#define TARGET_THREAD_EXCEPTIONOFFSET 2172
-#define TARGET_THREAD_EXCEPTIONHANDLER 2176
+#define TARGET_THREAD_HEAPINDEX 48
+#define TARGET_THREAD_HEAPSIZEINWORDS 56
+#define TARGET_THREAD_HEAP 100
+#define TARGET_THREAD_HEAPLIMIT 104
+#define TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT 2220
+#define TARGET_THREAD_EXCEPTIONOFFSET 2224
+#define TARGET_THREAD_EXCEPTIONHANDLER 2228
 
-#define TARGET_THREAD_IP 2148
-#define TARGET_THREAD_STACK 2152
-#define TARGET_THREAD_NEWSTACK 2156
-#define TARGET_THREAD_SCRATCH 2160
-#define TARGET_THREAD_CONTINUATION 2164
-#define TARGET_THREAD_TAILADDRESS 2180
-#define TARGET_THREAD_VIRTUALCALLTARGET 2184
-#define TARGET_THREAD_VIRTUALCALLINDEX 2188
-#define TARGET_THREAD_HEAPIMAGE 2192
-#define TARGET_THREAD_CODEIMAGE 2196
-#define TARGET_THREAD_THUNKTABLE 2200
-#define TARGET_THREAD_DYNAMICTABLE 2204
-#define TARGET_THREAD_STACKLIMIT 2228
+#define TARGET_THREAD_IP 2200
+#define TARGET_THREAD_STACK 2204
+#define TARGET_THREAD_NEWSTACK 2208
+#define TARGET_THREAD_SCRATCH 2212
+#define TARGET_THREAD_CONTINUATION 2216
+#define TARGET_THREAD_TAILADDRESS 2232
+#define TARGET_THREAD_VIRTUALCALLTARGET 2236
+#define TARGET_THREAD_VIRTUALCALLINDEX 2240
+#define TARGET_THREAD_HEAPIMAGE 2244
+#define TARGET_THREAD_CODEIMAGE 2248
+#define TARGET_THREAD_THUNKTABLE 2252
+#define TARGET_THREAD_DYNAMICTABLE 2256
+#define TARGET_THREAD_STACKLIMIT 2280
 
 #else
 #error
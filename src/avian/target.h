@@ -102,7 +102,7 @@ typedef int64_t target_intptr_t;
 
 const unsigned TargetClassFixedSize = 12;
 const unsigned TargetClassArrayElementSize = 14;
-const unsigned TargetClassVtable = 136;
+const unsigned TargetClassVtable = 176;
 
 const unsigned TargetFieldOffset = 12;
 
@@ -119,7 +119,7 @@ typedef int32_t target_intptr_t;
 
 const unsigned TargetClassFixedSize = 8;
 const unsigned TargetClassArrayElementSize = 10;
-const unsigned TargetClassVtable = 72;
+const unsigned TargetClassVtable = 92;
 
 const unsigned TargetFieldOffset = 8;
 
@@ -141,6 +141,17 @@ const target_uintptr_t TargetPointerMask
 const unsigned TargetArrayLength = TargetBytesPerWord;
 const unsigned TargetArrayBody = TargetBytesPerWord * 2;
 
+// offsets of AllocationSite::allocations, AllocationSite::pretenure and
+// AllocationSite::profiled, the last two adjacent
+const unsigned TargetAllocationSiteAllocations = TargetBytesPerWord;
+const unsigned TargetAllocationSitePretenure = TargetBytesPerWord + 12;
+const unsigned TargetAllocationSiteProfiled = TargetBytesPerWord + 13;
+
+const unsigned TargetAllocationSampleInterval = 64;
+
+// offset of Machine::exclusive, which follows nine pointers
+const unsigned TargetMachineExclusive = TargetBytesPerWord * 9;
+
 inline void targetMarkBit(target_uintptr_t* map, unsigned i)
 {
   map[wordOf<target_uintptr_t>(i)] |= targetVW(static_cast<target_uintptr_t>(1)
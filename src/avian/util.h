@@ -22,15 +22,11 @@ GcTriple* hashMapFindNode(Thread* t,
                           uint32_t (*hash)(Thread*, object),
                           bool (*equal)(Thread*, object, object));
 
-inline object hashMapFind(Thread* t,
-                          GcHashMap* map,
-                          object key,
-                          uint32_t (*hash)(Thread*, object),
-                          bool (*equal)(Thread*, object, object))
-{
-  GcTriple* n = hashMapFindNode(t, map, key, hash, equal);
-  return (n ? n->second() : 0);
-}
+object hashMapFind(Thread* t,
+                   GcHashMap* map,
+                   object key,
+                   uint32_t (*hash)(Thread*, object),
+                   bool (*equal)(Thread*, object, object));
 
 void hashMapResize(Thread* t,
                    GcHashMap* map,
@@ -43,38 +39,19 @@ void hashMapInsert(Thread* t,
                    object value,
                    uint32_t (*hash)(Thread*, object));
 
-inline bool hashMapInsertOrReplace(Thread* t,
-                                   GcHashMap* map,
-                                   object key,
-                                   object value,
-                                   uint32_t (*hash)(Thread*, object),
-                                   bool (*equal)(Thread*, object, object))
-{
-  GcTriple* n = hashMapFindNode(t, map, key, hash, equal);
-  if (n == 0) {
-    hashMapInsert(t, map, key, value, hash);
-    return true;
-  } else {
-    n->setSecond(t, value);
-    return false;
-  }
-}
-
-inline bool hashMapInsertMaybe(Thread* t,
-                               GcHashMap* map,
-                               object key,
-                               object value,
-                               uint32_t (*hash)(Thread*, object),
-                               bool (*equal)(Thread*, object, object))
-{
-  GcTriple* n = hashMapFindNode(t, map, key, hash, equal);
-  if (n == 0) {
-    hashMapInsert(t, map, key, value, hash);
-    return true;
-  } else {
-    return false;
-  }
-}
+bool hashMapInsertOrReplace(Thread* t,
+                            GcHashMap* map,
+                            object key,
+                            object value,
+                            uint32_t (*hash)(Thread*, object),
+                            bool (*equal)(Thread*, object, object));
+
+bool hashMapInsertMaybe(Thread* t,
+                        GcHashMap* map,
+                        object key,
+                        object value,
+                        uint32_t (*hash)(Thread*, object),
+                        bool (*equal)(Thread*, object, object));
 
 object hashMapRemove(Thread* t,
                      GcHashMap* map,
@@ -82,9 +59,8 @@ object hashMapRemove(Thread* t,
                      uint32_t (*hash)(Thread*, object),
                      bool (*equal)(Thread*, object, object));
 
-object hashMapIterator(Thread* t, GcHashMap* map);
-
-object hashMapIteratorNext(Thread* t, object it);
+// removes the entries of a weak map whose keys have been collected
+void hashMapPurge(Thread* t, GcHashMap* map);
 
 void listAppend(Thread* t, GcList* list, object value);
 
@@ -113,10 +89,58 @@ void treeUpdate(Thread* t,
                 GcTreeNode* sentinal,
                 intptr_t (*compare)(Thread* t, intptr_t key, object b));
 
+// Calls visit with the value of each node in the tree, in key order.
+// The visitor must not allocate.
+void treeVisit(Thread* t,
+               GcTreeNode* tree,
+               GcTreeNode* sentinal,
+               void (*visit)(Thread* t, object value, void* context),
+               void* context);
+
+// Visits the entries of either kind of map.  Weak maps are chained,
+// and an entry is one of their triples, with the key being the weak
+// reference; other maps keep their keys in the first half of the array
+// and the values in the second.
 class HashMapIterator : public Thread::Protector {
  public:
+  class Entry {
+   public:
+    Entry(HashMapIterator* it) : it(it)
+    {
+    }
+
+    object first()
+    {
+      if (it->weak) {
+        return it->entryNode->first();
+      } else {
+        return it->map->array()->body()[it->entrySlot];
+      }
+    }
+
+    object second()
+    {
+      if (it->weak) {
+        return it->entryNode->second();
+      } else {
+        GcArray* array = it->map->array();
+        return array->body()[(array->length() / 2) + it->entrySlot];
+      }
+    }
+
+    HashMapIterator* it;
+  };
+
   HashMapIterator(Thread* t, GcHashMap* map)
-      : Protector(t), map(map), node(0), index(0)
+      : Protector(t),
+        map(map),
+        node(0),
+        index(0),
+        slot(-1),
+        entryNode(0),
+        entrySlot(0),
+        weak(objectClass(t, map) == type(t, GcWeakHashMap::Type)),
+        entry(this)
   {
     find();
   }
@@ -125,46 +149,63 @@ class HashMapIterator : public Thread::Protector {
   {
     GcArray* array = map->array();
     if (array) {
-      for (unsigned i = index; i < array->length(); ++i) {
+      unsigned limit = weak ? array->length() : array->length() / 2;
+      for (unsigned i = index; i < limit; ++i) {
         if (array->body()[i]) {
-          node = cast<GcTriple>(t, array->body()[i]);
+          if (weak) {
+            node = cast<GcTriple>(t, array->body()[i]);
+          } else {
+            slot = i;
+          }
           index = i + 1;
           return;
         }
       }
     }
     node = 0;
+    slot = -1;
   }
 
   bool hasMore()
   {
-    return node != 0;
+    return node != 0 or slot >= 0;
   }
 
-  GcTriple* next()
+  Entry* next()
   {
-    if (node) {
-      GcTriple* n = node;
-      if (node->third()) {
-        node = cast<GcTriple>(t, node->third());
-      } else {
-        find();
+    if (weak) {
+      if (node) {
+        entryNode = node;
+        if (node->third()) {
+          node = cast<GcTriple>(t, node->third());
+        } else {
+          find();
+        }
+        return &entry;
       }
-      return n;
-    } else {
-      return 0;
+    } else if (slot >= 0) {
+      entrySlot = slot;
+      find();
+      return &entry;
     }
+    return 0;
   }
 
   virtual void visit(Heap::Visitor* v)
   {
     v->visit(&map);
     v->visit(&node);
+    v->visit(&entryNode);
   }
 
   GcHashMap* map;
   GcTriple* node;
   unsigned index;
+  int slot;
+  GcTriple* entryNode;
+  unsigned entrySlot;
+  bool weak;
+  Entry entry;
 };
 
 }  // vm
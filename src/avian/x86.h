@@ -22,6 +22,10 @@
 #undef interface
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #if (defined ARCH_x86_32) || (defined PLATFORM_WINDOWS)
 #define VA_LIST(x) (&(x))
 #else
@@ -258,11 +262,120 @@ inline void loadMemoryBarrier()
   programOrderMemoryBarrier();
 }
 
+// tells the processor we're spinning on a memory location, which
+// saves power and avoids a pipeline flush when the loop exits
+inline void spinLoopHint()
+{
+#ifdef _MSC_VER
+  YieldProcessor();
+#else
+  __asm__ __volatile__("pause" : : : "memory");
+#endif
+}
+
 inline void syncInstructionCache(const void*, unsigned)
 {
   programOrderMemoryBarrier();
 }
 
+// copies at least this big would evict most of the cache for data the
+// caller is unlikely to read back soon, so copyMemory streams them
+const size_t NonTemporalCopyThreshold = 1024 * 1024;
+
+// copies size bytes from src to dst, which must not overlap
+inline void copyMemory(void* dst, const void* src, size_t size)
+{
+#ifdef __SSE2__
+  if (size >= NonTemporalCopyThreshold) {
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+
+    size_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, d += 64, s += 64) {
+      const __m128i* from = reinterpret_cast<const __m128i*>(s);
+      __m128i a = _mm_loadu_si128(from);
+      __m128i b = _mm_loadu_si128(from + 1);
+      __m128i c = _mm_loadu_si128(from + 2);
+      __m128i e = _mm_loadu_si128(from + 3);
+
+      __m128i* to = reinterpret_cast<__m128i*>(d);
+      _mm_stream_si128(to, a);
+      _mm_stream_si128(to + 1, b);
+      _mm_stream_si128(to + 2, c);
+      _mm_stream_si128(to + 3, e);
+    }
+
+    // streaming stores are weakly ordered, so fence them before anyone
+    // else can look at the destination
+    _mm_sfence();
+
+    memcpy(d, s, size);
+    return;
+  }
+#endif  // __SSE2__
+
+  memcpy(dst, src, size);
+}
+
+// returns how many of the first length bytes at p are ASCII, checking
+// 32 at a time with SSE2 and then a word at a time
+inline unsigned asciiPrefixLength(const uint8_t* p, unsigned length)
+{
+  unsigned i = 0;
+#ifdef __SSE2__
+  for (; length - i >= 32; i += 32) {
+    const __m128i* v = reinterpret_cast<const __m128i*>(p + i);
+    if (_mm_movemask_epi8(
+            _mm_or_si128(_mm_loadu_si128(v), _mm_loadu_si128(v + 1)))) {
+      break;
+    }
+  }
+#endif  // __SSE2__
+
+  const uintptr_t HighBits = static_cast<uintptr_t>(0x8080808080808080ULL);
+  for (; length - i >= sizeof(uintptr_t); i += sizeof(uintptr_t)) {
+    uintptr_t v;
+    memcpy(&v, p + i, sizeof(uintptr_t));
+    if (v & HighBits) {
+      break;
+    }
+  }
+
+  while (i < length and (p[i] & 0x80) == 0) {
+    ++i;
+  }
+  return i;
+}
+
+// returns the index of the first '\n' or '\r' among the first length
+// UTF-16 code units at p, or length if there is none, checking eight
+// at a time with SSE2
+inline unsigned lineBreakIndex(const uint16_t* p, unsigned length)
+{
+  unsigned i = 0;
+#ifdef __SSE2__
+  const __m128i lf = _mm_set1_epi16('\n');
+  const __m128i cr = _mm_set1_epi16('\r');
+  for (; length - i >= 8; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    if (_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi16(v, lf), _mm_cmpeq_epi16(v, cr)))) {
+      break;
+    }
+  }
+#endif  // __SSE2__
+
+  while (i < length and p[i] != '\n' and p[i] != '\r') {
+    ++i;
+  }
+  return i;
+}
+
 #ifdef USE_ATOMIC_OPERATIONS
 inline bool atomicCompareAndSwap32(uint32_t* p, uint32_t old, uint32_t new_)
 {
@@ -9,6 +9,7 @@ FIELD(initialized)
 
 FIELD(heapSize)
 FIELD(codeSize)
+FIELD(heapOffset)
 
 FIELD(bootClassCount)
 FIELD(appClassCount)
@@ -51,6 +51,67 @@ GcClass* resolveSystemClassThrow(Thread* t,
       t, loader, spec, true, GcClassNotFoundException::Type);
 }
 
+// Like resolveSystemClass, but returns null rather than throwing if
+// neither loader nor its ancestors can find the class.  Names whose
+// class files don't exist are remembered per loader, so that asking
+// again, as delegation from child loaders tends to, costs one lookup.
+// A loader's misses are forgotten once any class is defined, since
+// the class may be one of them.
+GcClass* resolveSystemClassOrNull(Thread* t,
+                                  GcClassLoader* loader,
+                                  GcByteArray* spec)
+{
+  PROTECT(t, spec);
+
+  GcSystemClassLoader* sysLoader = loader->as<GcSystemClassLoader>(t);
+  PROTECT(t, sysLoader);
+
+  bool cacheable = spec->body()[0] != '[';
+  if (cacheable) {
+    ACQUIRE(t, t->m->classLock);
+
+    GcHashMap* misses = cast<GcHashMap>(t, sysLoader->misses());
+    if (misses and sysLoader->missesSavedClassCount() == t->m->savedClassCount
+        and findLoadedClass(t, loader, spec) == 0
+        and hashMapFind(t, misses, spec, byteArrayHash, byteArrayEqual)) {
+      return 0;
+    }
+  }
+
+  GcClass* c = resolveSystemClass(t, loader, spec, false);
+
+  if (c == 0 and cacheable) {
+    // a class which exists but didn't load is not a miss
+    THREAD_RUNTIME_ARRAY(t, char, file, spec->length() + 6);
+    memcpy(
+        RUNTIME_ARRAY_BODY(file), spec->body().begin(), spec->length() - 1);
+    memcpy(RUNTIME_ARRAY_BODY(file) + spec->length() - 1, ".class", 7);
+
+    size_t length;
+    if (static_cast<Finder*>(sysLoader->finder())
+            ->stat(RUNTIME_ARRAY_BODY(file), &length)
+        == System::TypeDoesNotExist) {
+      ACQUIRE(t, t->m->classLock);
+
+      if (sysLoader->misses() == 0
+          or sysLoader->missesSavedClassCount() != t->m->savedClassCount) {
+        GcHashMap* misses = makeHashMap(t, 0, 0);
+        sysLoader->setMisses(t, misses);
+        sysLoader->missesSavedClassCount() = t->m->savedClassCount;
+      }
+
+      hashMapInsertMaybe(t,
+                         cast<GcHashMap>(t, sysLoader->misses()),
+                         spec,
+                         spec,
+                         byteArrayHash,
+                         byteArrayEqual);
+    }
+  }
+
+  return c;
+}
+
 GcField* fieldForOffsetInClass(Thread* t, GcClass* c, unsigned offset)
 {
   GcClass* super = c->super();
@@ -104,6 +165,28 @@ GcField* fieldForOffset(Thread* t, object o, unsigned offset)
   }
 }
 
+void dumpToFile(Thread* t, object path, void (*dump)(Thread*, FILE*))
+{
+  GcString* outputFile = cast<GcString>(t, path);
+
+  unsigned length = outputFile->length(t);
+  THREAD_RUNTIME_ARRAY(t, char, n, length + 1);
+  stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
+  FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(n), "wb");
+  if (out) {
+    {
+      ENTER(t, Thread::ExclusiveState);
+      dump(t, out);
+    }
+    fclose(out);
+  } else {
+    throwNew(t,
+             GcRuntimeException::Type,
+             "file not found: %s",
+             RUNTIME_ARRAY_BODY(n));
+  }
+}
+
 }  // namespace
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
@@ -183,6 +266,33 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
       t->m->classpath->makeString(t, array, offset, length));
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_avian_Utf8_plainPrefixLength(Thread* t,
+                                       object,
+                                       uintptr_t* arguments)
+{
+  GcByteArray* array
+      = cast<GcByteArray>(t, reinterpret_cast<object>(arguments[0]));
+  int32_t offset = arguments[1];
+  int32_t length = arguments[2];
+
+  if (UNLIKELY(array == 0)) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  if (UNLIKELY(offset < 0 or length < 0
+               or offset > static_cast<int32_t>(array->length()) - length)) {
+    throwNew(t, GcArrayIndexOutOfBoundsException::Type);
+  }
+
+  // Utf8.encode writes zero as two zero bytes, so a zero ends the run
+  // as well as anything non-ASCII
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&array->body()[offset]);
+  unsigned n = asciiPrefixLength(p, length);
+  const void* zero = memchr(p, 0, n);
+  return zero ? static_cast<const uint8_t*>(zero) - p : n;
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_avian_SystemClassLoader_appLoader(Thread* t, object, uintptr_t*)
 {
@@ -222,6 +332,18 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return search(t, loader, name, resolveSystemClassThrow, true);
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_avian_SystemClassLoader_findVMClassOrNull(Thread* t,
+                                                    object,
+                                                    uintptr_t* arguments)
+{
+  GcClassLoader* loader
+      = cast<GcClassLoader>(t, reinterpret_cast<object>(arguments[0]));
+  GcString* name = cast<GcString>(t, reinterpret_cast<object>(arguments[1]));
+
+  return search(t, loader, name, resolveSystemClassOrNull, true);
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_avian_SystemClassLoader_resourceURLPrefix(Thread* t,
                                                     object,
@@ -315,6 +437,43 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
 
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_avian_Machine_dumpHeap(Thread* t, object, uintptr_t* arguments)
+{
+  dumpToFile(t, reinterpret_cast<object>(*arguments), dumpHeap);
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_dumpHeapHprof(Thread* t, object, uintptr_t* arguments)
+{
+  dumpToFile(t, reinterpret_cast<object>(*arguments), dumpHeapHprof);
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_dumpClassHistogram(Thread* t,
+                                            object,
+                                            uintptr_t* arguments)
+{
+  dumpToFile(t, reinterpret_cast<object>(*arguments), dumpClassHistogram);
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_dumpEvents(Thread* t, object, uintptr_t* arguments)
+{
+  dumpToFile(t, reinterpret_cast<object>(*arguments), dumpEvents);
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_setAllocationProfileInterval(Thread* t,
+                                                     object,
+                                                     uintptr_t* arguments)
+{
+  int interval = arguments[0];
+  setAllocationProfileInterval(t, interval > 0 ? interval : 0);
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_dumpAllocationProfile(Thread* t,
+                                              object,
+                                              uintptr_t* arguments)
 {
   GcString* outputFile
       = static_cast<GcString*>(reinterpret_cast<object>(*arguments));
@@ -324,10 +483,7 @@ extern "C" AVIAN_EXPORT void JNICALL
   stringChars(t, outputFile, RUNTIME_ARRAY_BODY(n));
   FILE* out = vm::fopen(RUNTIME_ARRAY_BODY(n), "wb");
   if (out) {
-    {
-      ENTER(t, Thread::ExclusiveState);
-      dumpHeap(t, out);
-    }
+    dumpAllocationProfile(t, out);
     fclose(out);
   } else {
     throwNew(t,
@@ -337,6 +493,102 @@ extern "C" AVIAN_EXPORT void JNICALL
   }
 }
 
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Traces_setContentionProfiling(Thread* t,
+                                              object,
+                                              uintptr_t* arguments)
+{
+  setContentionProfiling(t, arguments[0] != 0);
+}
+
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_avian_Traces_contentionProfile(Thread* t, object, uintptr_t*)
+{
+  return reinterpret_cast<uintptr_t>(makeContentionProfile(t));
+}
+
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_avian_Traces_captureAllThreads(Thread* t, object, uintptr_t*)
+{
+  return reinterpret_cast<uintptr_t>(makeThreadTraces(t));
+}
+
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_avian_Traces_describeTrace(Thread* t, object, uintptr_t* arguments)
+{
+  return reinterpret_cast<uintptr_t>(
+      makeTraceString(t, reinterpret_cast<object>(arguments[0])));
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_gcStatistics(Thread* t, object, uintptr_t* arguments)
+{
+  GcLongArray* array
+      = cast<GcLongArray>(t, reinterpret_cast<object>(*arguments));
+
+  if (array == 0) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  const Heap::Statistics& s = t->m->heap->statistics();
+
+  // keep in sync with the GC_* constants in avian.Machine
+  int64_t values[] = {s.collections,
+                      s.majorCollections,
+                      s.totalPauseTime,
+                      s.maxPauseTime,
+                      s.type,
+                      s.pauseTime,
+                      s.copied,
+                      s.tenured,
+                      s.freedFixies,
+                      s.untenuredFixies,
+                      s.tenuredFixies,
+                      s.gen1Before,
+                      s.gen1After,
+                      s.gen2Before,
+                      s.gen2After,
+                      s.directFootprint,
+                      s.directPooled};
+
+  unsigned count = min(array->length(), sizeof(values) / sizeof(int64_t));
+  for (unsigned i = 0; i < count; ++i) {
+    array->body()[i] = values[i];
+  }
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_avian_Machine_compileStatistics(Thread* t,
+                                          object,
+                                          uintptr_t* arguments)
+{
+  GcLongArray* array
+      = cast<GcLongArray>(t, reinterpret_cast<object>(*arguments));
+
+  if (array == 0) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  const Processor::CompileStatistics& s = t->m->processor->compileStatistics();
+
+  // keep in sync with the JIT_* constants in avian.Machine
+  int64_t values[] = {s.methods,
+                      s.time,
+                      s.maxTime,
+                      static_cast<int64_t>(s.bytecodeSize),
+                      static_cast<int64_t>(s.eventCount),
+                      static_cast<int64_t>(s.codeSize),
+                      static_cast<int64_t>(s.frameMapSize),
+                      static_cast<int64_t>(s.callSites),
+                      static_cast<int64_t>(s.codeCacheUsed),
+                      static_cast<int64_t>(s.codeCacheCapacity)};
+
+  unsigned count = min(array->length(), sizeof(values) / sizeof(int64_t));
+  for (unsigned i = 0; i < count; ++i) {
+    array->body()[i] = values[i];
+  }
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_avian_Machine_tryNative(Thread* t, object, uintptr_t* arguments)
 {
@@ -362,13 +614,13 @@ extern "C" AVIAN_EXPORT void JNICALL
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_Runtime_freeMemory(Thread* t, object, uintptr_t*)
 {
-  return t->m->heap->remaining();
+  return t->m->heap->unused();
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_Runtime_totalMemory(Thread* t, object, uintptr_t*)
 {
-  return t->m->heap->limit();
+  return t->m->heap->committed();
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
@@ -377,6 +629,12 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return t->m->heap->limit();
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_java_lang_Runtime_availableProcessors(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->processorCount();
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_avian_avianvmresource_Handler_00024ResourceInputStream_getContentLength(
         Thread* t,
@@ -498,6 +756,12 @@ extern "C" AVIAN_EXPORT void JNICALL
   reinterpret_cast<System::Region*>(peer)->dispose();
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_avian_Continuations_supported(Thread* t, object, uintptr_t*)
+{
+  return t->m->processor->supportsContinuations();
+}
+
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_avian_Continuations_callWithCurrentContinuation(Thread* t,
                                                           object,
@@ -581,6 +845,15 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return v;
 }
 
+Heap::DirectCache* directCache(Thread* t)
+{
+  if (t->directCache == 0) {
+    t->directCache = new (t->m->heap->allocate(sizeof(Heap::DirectCache)))
+        Heap::DirectCache;
+  }
+  return t->directCache;
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_sun_misc_Unsafe_allocateMemory(Thread* t,
                                          object,
@@ -588,7 +861,13 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
 {
   int64_t size;
   memcpy(&size, arguments + 1, 8);
-  void* p = malloc(size);
+  if (size < 0) {
+    throwNew(t, GcIllegalArgumentException::Type);
+  }
+
+  void* p = size == static_cast<int64_t>(static_cast<size_t>(size))
+                ? t->m->heap->tryAllocateDirect(directCache(t), size)
+                : 0;
   if (p) {
     return reinterpret_cast<int64_t>(p);
   } else {
@@ -597,12 +876,12 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
 }
 
 extern "C" AVIAN_EXPORT void JNICALL
-    Avian_sun_misc_Unsafe_freeMemory(Thread*, object, uintptr_t* arguments)
+    Avian_sun_misc_Unsafe_freeMemory(Thread* t, object, uintptr_t* arguments)
 {
   int64_t p;
   memcpy(&p, arguments + 1, 8);
   if (p) {
-    free(reinterpret_cast<void*>(p));
+    t->m->heap->freeDirect(directCache(t), reinterpret_cast<void*>(p));
   }
 }
 
@@ -776,6 +1055,82 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return *reinterpret_cast<intptr_t*>(p);
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_sun_misc_Unsafe_getShort__Ljava_lang_Object_2J(Thread*,
+                                                         object,
+                                                         uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset;
+  memcpy(&offset, arguments + 2, 8);
+
+  return fieldAtOffset<int16_t>(o, offset);
+}
+
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_sun_misc_Unsafe_getInt__Ljava_lang_Object_2J(Thread*,
+                                                       object,
+                                                       uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset;
+  memcpy(&offset, arguments + 2, 8);
+
+  return fieldAtOffset<int32_t>(o, offset);
+}
+
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_sun_misc_Unsafe_getLong__Ljava_lang_Object_2J(Thread*,
+                                                        object,
+                                                        uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset;
+  memcpy(&offset, arguments + 2, 8);
+
+  return fieldAtOffset<int64_t>(o, offset);
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_sun_misc_Unsafe_putShort__Ljava_lang_Object_2JS(Thread*,
+                                                          object,
+                                                          uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset;
+  memcpy(&offset, arguments + 2, 8);
+  int16_t value = arguments[4];
+
+  fieldAtOffset<int16_t>(o, offset) = value;
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_sun_misc_Unsafe_putInt__Ljava_lang_Object_2JI(Thread*,
+                                                        object,
+                                                        uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset;
+  memcpy(&offset, arguments + 2, 8);
+  int32_t value = arguments[4];
+
+  fieldAtOffset<int32_t>(o, offset) = value;
+}
+
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_sun_misc_Unsafe_putLong__Ljava_lang_Object_2JJ(Thread*,
+                                                         object,
+                                                         uintptr_t* arguments)
+{
+  object o = reinterpret_cast<object>(arguments[1]);
+  int64_t offset;
+  memcpy(&offset, arguments + 2, 8);
+  int64_t value;
+  memcpy(&value, arguments + 4, 8);
+
+  fieldAtOffset<int64_t>(o, offset) = value;
+}
+
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_sun_misc_Unsafe_copyMemory(Thread* t, object, uintptr_t* arguments)
 {
@@ -957,9 +1312,9 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   uint64_t update;
   memcpy(&update, arguments + 6, 8);
 
-#ifdef AVIAN_HAS_CAS64
-  return atomicCompareAndSwap64(
-      &fieldAtOffset<uint64_t>(target, offset), expect, update);
+#ifdef USE_ATOMIC_OPERATIONS
+  return compareAndSwapWide(
+      t, &fieldAtOffset<int64_t>(target, offset), expect, update);
 #else
   PROTECT(t, target);
   ACQUIRE_FIELD_FOR_WRITE(t, fieldForOffset(t, target, offset));
@@ -982,7 +1337,7 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   memcpy(&offset, arguments + 2, 8);
 
   object lock;
-  if (BytesPerWord < 8) {
+  if (LockWideVolatileFields) {
     if (objectClass(t, o)->arrayDimensions()) {
       lock = objectClass(t, o);
     } else {
@@ -994,9 +1349,9 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
     acquire(t, lock);
   }
 
-  int64_t result = fieldAtOffset<int64_t>(o, offset);
+  int64_t result = loadWide(t, &fieldAtOffset<int64_t>(o, offset));
 
-  if (BytesPerWord < 8) {
+  if (LockWideVolatileFields) {
     release(t, lock);
   } else {
     loadMemoryBarrier();
@@ -1017,7 +1372,7 @@ extern "C" AVIAN_EXPORT void JNICALL
   memcpy(&value, arguments + 4, 8);
 
   object lock;
-  if (BytesPerWord < 8) {
+  if (LockWideVolatileFields) {
     if (objectClass(t, o)->arrayDimensions()) {
       lock = objectClass(t, o);
     } else {
@@ -1031,9 +1386,9 @@ extern "C" AVIAN_EXPORT void JNICALL
     storeStoreMemoryBarrier();
   }
 
-  fieldAtOffset<int64_t>(o, offset) = value;
+  storeWide(t, &fieldAtOffset<int64_t>(o, offset), value);
 
-  if (BytesPerWord < 8) {
+  if (LockWideVolatileFields) {
     release(t, lock);
   } else {
     storeLoadMemoryBarrier();
@@ -1055,23 +1410,24 @@ extern "C" AVIAN_EXPORT void JNICALL
 {
   GcThread* thread = cast<GcThread>(t, reinterpret_cast<object>(arguments[1]));
 
-  monitorAcquire(t, cast<GcMonitor>(t, interruptLock(t, thread)));
-  thread->unparked() = true;
-  monitorNotify(t, cast<GcMonitor>(t, interruptLock(t, thread)));
-  monitorRelease(t, cast<GcMonitor>(t, interruptLock(t, thread)));
+  unpark(t, reinterpret_cast<Thread*>(thread->peer()));
 }
 
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_sun_misc_Unsafe_park(Thread* t, object, uintptr_t* arguments)
 {
+  // consume a pending permit without a state transition if we can,
+  // so the common unpark-before-park case never enters the kernel:
+  if (t->systemThread->tryPark()) {
+    return;
+  }
+
   bool absolute = arguments[1];
   int64_t time;
   memcpy(&time, arguments + 2, 8);
 
-  int64_t then = t->m->system->now();
-
   if (absolute) {
-    time -= then;
+    time -= t->m->system->now();
     if (time <= 0) {
       return;
     }
@@ -1082,27 +1438,13 @@ extern "C" AVIAN_EXPORT void JNICALL
     time = (time / (1000 * 1000)) + 1;
   }
 
-  monitorAcquire(t, cast<GcMonitor>(t, interruptLock(t, t->javaThread)));
-  bool interrupted = false;
-  while (time >= 0
-         and (not(t->javaThread->unparked() or t->javaThread->interrupted()
-                  or (interrupted = monitorWait(
-                          t,
-                          cast<GcMonitor>(t, interruptLock(t, t->javaThread)),
-                          time))))) {
-    int64_t now = t->m->system->now();
-    time -= now - then;
-    then = now;
-
-    if (time == 0) {
-      break;
-    }
-  }
-  if (interrupted) {
-    t->javaThread->interrupted() = true;
+  // threadInterrupt unparks the thread after setting this flag, so
+  // we can't miss an interrupt which arrives after we check it:
+  if (not t->javaThread->interrupted()) {
+    ENTER(t, Thread::IdleState);
+
+    t->systemThread->park(time);
   }
-  t->javaThread->unparked() = false;
-  monitorRelease(t, cast<GcMonitor>(t, interruptLock(t, t->javaThread)));
 }
 
 extern "C" AVIAN_EXPORT void JNICALL
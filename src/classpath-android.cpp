@@ -115,12 +115,11 @@ object translateStackTrace(Thread* t, object raw)
   object array = makeObjectArray(
       t,
       resolveClass(t, roots(t)->bootLoader(), "java/lang/StackTraceElement"),
-      objectArrayLength(t, raw));
+      traceLength(t, raw));
   PROTECT(t, array);
 
   for (unsigned i = 0; i < objectArrayLength(t, array); ++i) {
-    GcStackTraceElement* e = makeStackTraceElement(
-        t, cast<GcTraceElement>(t, objectArrayBody(t, raw, i)));
+    GcStackTraceElement* e = makeStackTraceElement(t, raw, i);
 
     setField(t, array, ArrayBody + (i * BytesPerWord), e);
   }
@@ -224,7 +223,7 @@ class MyClasspath : public Classpath {
   {
     PROTECT(t, vmMethod);
 
-    GcJmethod* jmethod = makeJmethod(t, vmMethod, false);
+    GcJmethod* jmethod = makeJmethod(t, vmMethod, false, 0, 0);
 
     return vmMethod->name()->body()[0] == '<'
                ? static_cast<object>(makeJconstructor(t, jmethod))
@@ -749,22 +748,33 @@ int register_org_apache_harmony_dalvik_NativeTestTarget(_JNIEnv*)
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_String_compareTo(Thread* t, object, uintptr_t* arguments)
 {
-  GcString* a = cast<GcString>(t, reinterpret_cast<object>(arguments[0]));
-  GcString* b = cast<GcString>(t, reinterpret_cast<object>(arguments[1]));
+  StringChars a(
+      t, cast<GcString>(t, reinterpret_cast<object>(arguments[0])));
+  StringChars b(
+      t, cast<GcString>(t, reinterpret_cast<object>(arguments[1])));
 
-  unsigned length = a->length(t);
-  if (length > b->length(t)) {
-    length = b->length(t);
+  unsigned length = a.length;
+  if (length > b.length) {
+    length = b.length;
   }
 
-  for (unsigned i = 0; i < length; ++i) {
-    int d = stringCharAt(t, a, i) - stringCharAt(t, b, i);
-    if (d) {
-      return d;
+  if (a.chars and b.chars) {
+    for (unsigned i = 0; i < length; ++i) {
+      int d = a.chars[i] - b.chars[i];
+      if (d) {
+        return d;
+      }
+    }
+  } else {
+    for (unsigned i = 0; i < length; ++i) {
+      int d = a[i] - b[i];
+      if (d) {
+        return d;
+      }
     }
   }
 
-  return a->length(t) - b->length(t);
+  return static_cast<int>(a.length) - static_cast<int>(b.length);
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
@@ -806,13 +816,22 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_String_fastIndexOf(Thread* t, object, uintptr_t* arguments)
 {
-  GcString* s = cast<GcString>(t, reinterpret_cast<object>(arguments[0]));
+  StringChars s(t,
+                cast<GcString>(t, reinterpret_cast<object>(arguments[0])));
   unsigned c = arguments[1];
   unsigned start = arguments[2];
 
-  for (unsigned i = start; i < s->length(t); ++i) {
-    if (stringCharAt(t, s, i) == c) {
-      return i;
+  if (s.chars) {
+    for (unsigned i = start; i < s.length; ++i) {
+      if (s.chars[i] == c) {
+        return i;
+      }
+    }
+  } else {
+    for (unsigned i = start; i < s.length; ++i) {
+      if (s[i] == c) {
+        return i;
+      }
     }
   }
 
@@ -1331,7 +1350,8 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
                                                      object,
                                                      uintptr_t*)
 {
-  return reinterpret_cast<uintptr_t>(getTrace(t, 2));
+  return reinterpret_cast<uintptr_t>(
+      getTrace(t, 2, t->m->maxThrowableTraceDepth));
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
@@ -1503,7 +1523,7 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_System_nanoTime(Thread* t, object, uintptr_t*)
 {
-  return t->m->system->now() * 1000 * 1000;
+  return t->m->system->nanoTime();
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
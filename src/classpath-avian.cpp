@@ -22,13 +22,16 @@ namespace local {
 
 class MyClasspath : public Classpath {
  public:
-  MyClasspath(Allocator* allocator) : allocator(allocator)
+  MyClasspath(Allocator* allocator)
+      : allocator(allocator),
+        directBufferAddressField(0),
+        directBufferCapacityField(0)
   {
   }
 
   virtual GcJclass* makeJclass(Thread* t, GcClass* class_)
   {
-    return vm::makeJclass(t, class_);
+    return vm::makeJclass(t, class_, 0);
   }
 
   virtual GcString* makeString(Thread* t,
@@ -56,7 +59,6 @@ class MyClasspath : public Classpath {
                           0,
                           0,
                           0,
-                          0,
                           NewState,
                           NormalPriority,
                           0,
@@ -66,6 +68,7 @@ class MyClasspath : public Classpath {
                           0,
                           0,
                           group,
+                          0,
                           0);
   }
 
@@ -73,7 +76,7 @@ class MyClasspath : public Classpath {
   {
     PROTECT(t, vmMethod);
 
-    GcJmethod* jmethod = makeJmethod(t, vmMethod, false);
+    GcJmethod* jmethod = makeJmethod(t, vmMethod, false, 0, 0, 0);
 
     return vmMethod->name()->body()[0] == '<'
                ? (object)makeJconstructor(t, jmethod)
@@ -89,7 +92,7 @@ class MyClasspath : public Classpath {
 
   virtual object makeJField(Thread* t, GcField* vmField)
   {
-    return makeJfield(t, vmField, false);
+    return makeJfield(t, vmField, false, 0);
   }
 
   virtual GcField* getVMField(Thread* t UNUSED, GcJfield* jfield)
@@ -133,9 +136,23 @@ class MyClasspath : public Classpath {
     return true;
   }
 
-  virtual void boot(Thread*)
+  virtual void boot(Thread* t)
   {
-    // ignore
+    // natives may ask for a direct buffer's address once per call, so
+    // resolve the fields involved up front rather than by name each
+    // time:
+    GcClass* c = resolveClass(
+        t, roots(t)->bootLoader(), "java/nio/DirectByteBuffer", false);
+
+    if (c) {
+      PROTECT(t, c);
+
+      GcField* address = resolveField(t, c, "address", "J");
+      directBufferAddressField = address->offset();
+
+      GcField* capacity = resolveField(t, c, "capacity", "I");
+      directBufferCapacityField = capacity->offset();
+    }
   }
 
   virtual const char* bootClasspath()
@@ -163,22 +180,47 @@ class MyClasspath : public Classpath {
     return instance;
   }
 
+  bool isDirectBuffer(Thread* t, object b)
+  {
+    for (GcClass* c = objectClass(t, b); c; c = c->super()) {
+      if (::strcmp(reinterpret_cast<const char*>(c->name()->body().begin()),
+                   "java/nio/DirectByteBuffer") == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   virtual void* getDirectBufferAddress(Thread* t, object b)
   {
-    PROTECT(t, b);
+    unsigned offset = directBufferAddressField;
+    if (LIKELY(offset)) {
+      if (not isDirectBuffer(t, b)) {
+        return 0;
+      }
+    } else {
+      PROTECT(t, b);
 
-    GcField* field = resolveField(t, objectClass(t, b), "address", "J");
+      offset = resolveField(t, objectClass(t, b), "address", "J")->offset();
+    }
 
-    return reinterpret_cast<void*>(fieldAtOffset<int64_t>(b, field->offset()));
+    return reinterpret_cast<void*>(fieldAtOffset<int64_t>(b, offset));
   }
 
   virtual int64_t getDirectBufferCapacity(Thread* t, object b)
   {
-    PROTECT(t, b);
+    unsigned offset = directBufferCapacityField;
+    if (LIKELY(offset)) {
+      if (not isDirectBuffer(t, b)) {
+        return -1;
+      }
+    } else {
+      PROTECT(t, b);
 
-    GcField* field = resolveField(t, objectClass(t, b), "capacity", "I");
+      offset = resolveField(t, objectClass(t, b), "capacity", "I")->offset();
+    }
 
-    return fieldAtOffset<int32_t>(b, field->offset());
+    return fieldAtOffset<int32_t>(b, offset);
   }
 
   virtual bool canTailCall(Thread* t UNUSED,
@@ -223,6 +265,8 @@ class MyClasspath : public Classpath {
   }
 
   Allocator* allocator;
+  unsigned directBufferAddressField;
+  unsigned directBufferCapacityField;
 };
 
 void enumerateThreads(Thread* t,
@@ -270,6 +314,28 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return reinterpret_cast<int64_t>(make(t, c));
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_java_io_BufferedReader_lineBreakIndex(Thread* t,
+                                               object,
+                                               uintptr_t* arguments)
+{
+  GcCharArray* array
+      = cast<GcCharArray>(t, reinterpret_cast<object>(arguments[0]));
+  int32_t offset = arguments[1];
+  int32_t length = arguments[2];
+
+  if (UNLIKELY(array == 0)) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  if (UNLIKELY(offset < 0 or length < 0
+               or offset > static_cast<int32_t>(array->length()) - length)) {
+    throwNew(t, GcArrayIndexOutOfBoundsException::Type);
+  }
+
+  return offset + lineBreakIndex(&array->body()[offset], length);
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_avian_LegacyObjectInputStream_makeInstance(Thread* t,
                                                      object,
@@ -449,6 +515,66 @@ extern "C" AVIAN_EXPORT void JNICALL
             arguments[4]);
 }
 
+extern "C" AVIAN_EXPORT void JNICALL
+    Avian_java_util_Arrays_fillPrimitive(Thread* t,
+                                         object,
+                                         uintptr_t* arguments)
+{
+  object array = reinterpret_cast<object>(arguments[0]);
+  int32_t offset = arguments[1];
+  int32_t length = arguments[2];
+  int64_t value;
+  memcpy(&value, arguments + 3, 8);
+
+  if (UNLIKELY(array == 0)) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  GcClass* c = objectClass(t, array);
+  unsigned elementSize = c->arrayElementSize();
+  if (UNLIKELY(elementSize == 0 or c->objectMask())) {
+    throwNew(t, GcArrayStoreException::Type);
+  }
+
+  intptr_t arrayLength = fieldAtOffset<uintptr_t>(array, BytesPerWord);
+  if (UNLIKELY(offset < 0 or length < 0 or offset > arrayLength - length)) {
+    throwNew(t, GcIndexOutOfBoundsException::Type);
+  }
+
+  // simple loops over the body, which the C++ compiler turns into
+  // memset or vector stores
+  uint8_t* body = &fieldAtOffset<uint8_t>(array, ArrayBody);
+  switch (elementSize) {
+  case 1:
+    memset(body + offset, static_cast<uint8_t>(value), length);
+    break;
+
+  case 2: {
+    uint16_t* p = reinterpret_cast<uint16_t*>(body) + offset;
+    for (int32_t i = 0; i < length; ++i) {
+      p[i] = value;
+    }
+  } break;
+
+  case 4: {
+    uint32_t* p = reinterpret_cast<uint32_t*>(body) + offset;
+    for (int32_t i = 0; i < length; ++i) {
+      p[i] = value;
+    }
+  } break;
+
+  case 8: {
+    uint64_t* p = reinterpret_cast<uint64_t*>(body) + offset;
+    for (int32_t i = 0; i < length; ++i) {
+      p[i] = value;
+    }
+  } break;
+
+  default:
+    abort(t);
+  }
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_System_identityHashCode(Thread* t,
                                             object,
@@ -463,6 +589,18 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   }
 }
 
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_java_lang_System_currentTimeMillis(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->now();
+}
+
+extern "C" AVIAN_EXPORT int64_t JNICALL
+    Avian_java_lang_System_nanoTime(Thread* t, object, uintptr_t*)
+{
+  return t->m->system->nanoTime();
+}
+
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_ClassLoader_getCaller(Thread* t, object, uintptr_t*)
 {
@@ -513,7 +651,8 @@ extern "C" AVIAN_EXPORT void JNICALL
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_java_lang_Throwable_trace(Thread* t, object, uintptr_t* arguments)
 {
-  return reinterpret_cast<int64_t>(getTrace(t, arguments[0]));
+  return reinterpret_cast<int64_t>(
+      getTrace(t, arguments[0], t->m->maxThrowableTraceDepth));
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
@@ -524,14 +663,13 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   object trace = reinterpret_cast<object>(*arguments);
   PROTECT(t, trace);
 
-  unsigned length = objectArrayLength(t, trace);
+  unsigned length = traceLength(t, trace);
   GcClass* elementType = type(t, GcStackTraceElement::Type);
   object array = makeObjectArray(t, elementType, length);
   PROTECT(t, array);
 
   for (unsigned i = 0; i < length; ++i) {
-    GcStackTraceElement* ste = makeStackTraceElement(
-        t, cast<GcTraceElement>(t, objectArrayBody(t, trace, i)));
+    GcStackTraceElement* ste = makeStackTraceElement(t, trace, i);
     reinterpret_cast<GcArray*>(array)->setBodyElement(t, i, ste);
   }
 
@@ -302,13 +302,18 @@ static uint64_t uncaughtExceptionHandler(Thread*, uintptr_t*);
 void interceptFileOperations(Thread*, bool);
 #endif
 
+class ZipFile;
+
 class MyClasspath : public Classpath {
  public:
   MyClasspath(System* s,
               Allocator* allocator,
               const char* javaHome,
               const char* embedPrefix)
-      : allocator(allocator), ranNetOnLoad(0), ranManagementOnLoad(0)
+      : allocator(allocator),
+        zipFiles(0),
+        ranNetOnLoad(0),
+        ranManagementOnLoad(0)
   {
     class StringBuilder {
      public:
@@ -906,6 +911,9 @@ class MyClasspath : public Classpath {
   unsigned zipEntrySizeField;
   unsigned zipEntryCsizeField;
   unsigned zipEntryMethodField;
+  // embedded jars opened through java.util.zip.ZipFile, each shared by
+  // every instance which has it open
+  ZipFile* zipFiles;
   bool ranNetOnLoad;
   bool ranManagementOnLoad;
   JmmInterface jmmInterface;
@@ -1466,19 +1474,36 @@ class ZipFile {
     int64_t entry;
   };
 
-  ZipFile(Thread* t, System::Region* region, unsigned entryCount)
+  ZipFile(Thread* t,
+          System::Region* region,
+          unsigned entryCount,
+          const char* name,
+          unsigned nameLength)
       : region(region),
         entryCount(entryCount),
         indexSize(nextPowerOfTwo(entryCount)),
         index(reinterpret_cast<ZipFile::Entry**>(
             t->m->heap->allocate(sizeof(ZipFile::Entry*) * indexSize))),
-        file(0)
+        file(0),
+        name(static_cast<char*>(t->m->heap->allocate(nameLength + 1))),
+        nameLength(nameLength),
+        referenceCount(1),
+        next(0)
   {
     memset(index, 0, sizeof(ZipFile::Entry*) * indexSize);
+    memcpy(this->name, name, nameLength + 1);
   }
 
   ZipFile(int64_t file)
-      : region(0), entryCount(0), indexSize(0), index(0), file(file)
+      : region(0),
+        entryCount(0),
+        indexSize(0),
+        index(0),
+        file(file),
+        name(0),
+        nameLength(0),
+        referenceCount(1),
+        next(0)
   {
   }
 
@@ -1487,9 +1512,39 @@ class ZipFile {
   unsigned indexSize;
   Entry** index;
   int64_t file;
+  // the following are only used for embedded jars, which are shared
+  // through MyClasspath::zipFiles
+  char* name;
+  unsigned nameLength;
+  unsigned referenceCount;
+  ZipFile* next;
   Entry entries[0];
 };
 
+// Returns the already open embedded jar with the specified name, if
+// any, counting the new reference to it.  Must be called with
+// referenceLock held.
+ZipFile* findOpenZipFile(MyClasspath* cp, const char* name, unsigned nameLength)
+{
+  for (ZipFile* file = cp->zipFiles; file; file = file->next) {
+    if (file->nameLength == nameLength
+        and memcmp(file->name, name, nameLength) == 0) {
+      ++file->referenceCount;
+      return file;
+    }
+  }
+  return 0;
+}
+
+void disposeZipFile(Thread* t, ZipFile* file)
+{
+  file->region->dispose();
+  t->m->heap->free(file->index, sizeof(ZipFile::Entry*) * file->indexSize);
+  t->m->heap->free(file->name, file->nameLength + 1);
+  t->m->heap->free(
+      file, sizeof(ZipFile) + (sizeof(ZipFile::Entry) * file->entryCount));
+}
+
 int64_t JNICALL openZipFile(Thread* t, GcMethod* method, uintptr_t* arguments)
 {
   GcString* path = cast<GcString>(t, reinterpret_cast<object>(arguments[0]));
@@ -1509,6 +1564,18 @@ int64_t JNICALL openZipFile(Thread* t, GcMethod* method, uintptr_t* arguments)
       throwNew(t, GcFileNotFoundException::Type);
     }
 
+    // the index is built from the jar's region and never modified, so
+    // every ZipFile opening the same jar can share the first one's
+    {
+      ACQUIRE(t, t->m->referenceLock);
+
+      ZipFile* file
+          = findOpenZipFile(cp, RUNTIME_ARRAY_BODY(p), path->length(t));
+      if (file) {
+        return reinterpret_cast<int64_t>(file);
+      }
+    }
+
     Finder* finder = getFinder(t, ef.jar, ef.jarLength);
     if (finder == 0) {
       throwNew(t, GcFileNotFoundException::Type);
@@ -1543,7 +1610,7 @@ int64_t JNICALL openZipFile(Thread* t, GcMethod* method, uintptr_t* arguments)
   make:
     ZipFile* file = new (t->m->heap->allocate(
         sizeof(ZipFile) + (sizeof(ZipFile::Entry) * entryCount)))
-        ZipFile(t, r, entryCount);
+        ZipFile(t, r, entryCount, RUNTIME_ARRAY_BODY(p), path->length(t));
 
     {
       unsigned position = 0;
@@ -1572,6 +1639,19 @@ int64_t JNICALL openZipFile(Thread* t, GcMethod* method, uintptr_t* arguments)
     }
 
   exit:
+    ACQUIRE(t, t->m->referenceLock);
+
+    // another thread may have opened the same jar while we were
+    // indexing it, in which case we use theirs instead
+    ZipFile* open = findOpenZipFile(cp, file->name, file->nameLength);
+    if (open) {
+      disposeZipFile(t, file);
+      return reinterpret_cast<int64_t>(open);
+    }
+
+    file->next = cp->zipFiles;
+    cp->zipFiles = file;
+
     return reinterpret_cast<int64_t>(file);
   } else {
     return reinterpret_cast<int64_t>(
@@ -1959,9 +2039,20 @@ void JNICALL closeZipFile(Thread* t, GcMethod* method, uintptr_t* arguments)
 
   ZipFile* file = reinterpret_cast<ZipFile*>(peer);
   if (file->region) {
-    file->region->dispose();
-    t->m->heap->free(
-        file, sizeof(ZipFile) + (sizeof(ZipFile::Entry) * file->entryCount));
+    MyClasspath* cp = static_cast<MyClasspath*>(t->m->classpath);
+
+    ACQUIRE(t, t->m->referenceLock);
+
+    if (--file->referenceCount == 0) {
+      for (ZipFile** p = &(cp->zipFiles); *p; p = &((*p)->next)) {
+        if (*p == file) {
+          *p = file->next;
+          break;
+        }
+      }
+
+      disposeZipFile(t, file);
+    }
   } else {
     t->m->processor->invoke(
         t,
@@ -2961,18 +3052,6 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
                  ->body()[jfield->slot()])->offset();
 }
 
-extern "C" AVIAN_EXPORT int64_t JNICALL
-    Avian_sun_misc_Unsafe_getShort__Ljava_lang_Object_2J(Thread*,
-                                                         object,
-                                                         uintptr_t* arguments)
-{
-  object o = reinterpret_cast<object>(arguments[1]);
-  int64_t offset;
-  memcpy(&offset, arguments + 2, 8);
-
-  return fieldAtOffset<int16_t>(o, offset);
-}
-
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_sun_misc_Unsafe_getChar__Ljava_lang_Object_2J(Thread*,
                                                         object,
@@ -2985,18 +3064,6 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return fieldAtOffset<uint16_t>(o, offset);
 }
 
-extern "C" AVIAN_EXPORT int64_t JNICALL
-    Avian_sun_misc_Unsafe_getInt__Ljava_lang_Object_2J(Thread*,
-                                                       object,
-                                                       uintptr_t* arguments)
-{
-  object o = reinterpret_cast<object>(arguments[1]);
-  int64_t offset;
-  memcpy(&offset, arguments + 2, 8);
-
-  return fieldAtOffset<int32_t>(o, offset);
-}
-
 extern "C" AVIAN_EXPORT int64_t JNICALL
     Avian_sun_misc_Unsafe_getFloat__Ljava_lang_Object_2J(Thread*,
                                                          object,
@@ -3010,9 +3077,9 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
 }
 
 extern "C" AVIAN_EXPORT int64_t JNICALL
-    Avian_sun_misc_Unsafe_getLong__Ljava_lang_Object_2J(Thread*,
-                                                        object,
-                                                        uintptr_t* arguments)
+    Avian_sun_misc_Unsafe_getDouble__Ljava_lang_Object_2J(Thread*,
+                                                          object,
+                                                          uintptr_t* arguments)
 {
   object o = reinterpret_cast<object>(arguments[1]);
   int64_t offset;
@@ -3021,15 +3088,6 @@ extern "C" AVIAN_EXPORT int64_t JNICALL
   return fieldAtOffset<int64_t>(o, offset);
 }
 
-extern "C" AVIAN_EXPORT int64_t JNICALL
-    Avian_sun_misc_Unsafe_getDouble__Ljava_lang_Object_2J(Thread* t,
-                                                          GcMethod* method,
-                                                          uintptr_t* arguments)
-{
-  return Avian_sun_misc_Unsafe_getLong__Ljava_lang_Object_2J(
-      t, method, arguments);
-}
-
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_sun_misc_Unsafe_putByte__Ljava_lang_Object_2JB(Thread*,
                                                          object,
@@ -3043,19 +3101,6 @@ extern "C" AVIAN_EXPORT void JNICALL
   fieldAtOffset<int8_t>(o, offset) = value;
 }
 
-extern "C" AVIAN_EXPORT void JNICALL
-    Avian_sun_misc_Unsafe_putShort__Ljava_lang_Object_2JS(Thread*,
-                                                          object,
-                                                          uintptr_t* arguments)
-{
-  object o = reinterpret_cast<object>(arguments[1]);
-  int64_t offset;
-  memcpy(&offset, arguments + 2, 8);
-  int16_t value = arguments[4];
-
-  fieldAtOffset<int16_t>(o, offset) = value;
-}
-
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_sun_misc_Unsafe_putChar__Ljava_lang_Object_2JC(Thread*,
                                                          object,
@@ -3069,19 +3114,6 @@ extern "C" AVIAN_EXPORT void JNICALL
   fieldAtOffset<uint16_t>(o, offset) = value;
 }
 
-extern "C" AVIAN_EXPORT void JNICALL
-    Avian_sun_misc_Unsafe_putInt__Ljava_lang_Object_2JI(Thread*,
-                                                        object,
-                                                        uintptr_t* arguments)
-{
-  object o = reinterpret_cast<object>(arguments[1]);
-  int64_t offset;
-  memcpy(&offset, arguments + 2, 8);
-  int32_t value = arguments[4];
-
-  fieldAtOffset<int32_t>(o, offset) = value;
-}
-
 extern "C" AVIAN_EXPORT void JNICALL
     Avian_sun_misc_Unsafe_putFloat__Ljava_lang_Object_2JF(Thread*,
                                                           object,
@@ -3130,20 +3162,6 @@ extern "C" AVIAN_EXPORT void JNICALL
   fieldAtOffset<uint8_t>(o, offset) = value;
 }
 
-extern "C" AVIAN_EXPORT void JNICALL
-    Avian_sun_misc_Unsafe_putLong__Ljava_lang_Object_2JJ(Thread*,
-                                                         object,
-                                                         uintptr_t* arguments)
-{
-  object o = reinterpret_cast<object>(arguments[1]);
-  int64_t offset;
-  memcpy(&offset, arguments + 2, 8);
-  int64_t value;
-  memcpy(&value, arguments + 4, 8);
-
-  fieldAtOffset<int64_t>(o, offset) = value;
-}
-
 extern "C" AVIAN_EXPORT void JNICALL
 Avian_sun_misc_Unsafe_putDouble__Ljava_lang_Object_2JD(Thread*,
                                                        object,
@@ -3310,7 +3328,7 @@ extern "C" AVIAN_EXPORT jlong JNICALL
 
 extern "C" AVIAN_EXPORT jlong JNICALL EXPORT(JVM_NanoTime)(Thread* t, jclass)
 {
-  return t->m->system->now() * 1000 * 1000;
+  return t->m->system->nanoTime();
 }
 
 uint64_t jvmArrayCopy(Thread* t, uintptr_t* arguments)
@@ -3521,12 +3539,12 @@ extern "C" AVIAN_EXPORT void JNICALL EXPORT(JVM_TraceMethodCalls)(jboolean)
 
 extern "C" AVIAN_EXPORT jlong JNICALL EXPORT(JVM_TotalMemory)()
 {
-  return 0;
+  return local::globalMachine->heap->committed();
 }
 
 extern "C" AVIAN_EXPORT jlong JNICALL EXPORT(JVM_FreeMemory)()
 {
-  return 0;
+  return local::globalMachine->heap->unused();
 }
 
 extern "C" AVIAN_EXPORT jlong JNICALL EXPORT(JVM_MaxMemory)()
@@ -3611,7 +3629,7 @@ uint64_t jvmFillInStackTrace(Thread* t, uintptr_t* arguments)
       = cast<GcThrowable>(t, *reinterpret_cast<jobject>(arguments[0]));
   PROTECT(t, throwable);
 
-  object trace = getTrace(t, 2);
+  object trace = getTrace(t, 2, t->m->maxThrowableTraceDepth);
   throwable->setTrace(t, trace);
 
   return 1;
@@ -3636,7 +3654,7 @@ extern "C" AVIAN_EXPORT jint JNICALL
 {
   ENTER(t, Thread::ActiveState);
 
-  return objectArrayLength(t, cast<GcThrowable>(t, *throwable)->trace());
+  return traceLength(t, cast<GcThrowable>(t, *throwable)->trace());
 }
 
 uint64_t jvmGetStackTraceElement(Thread* t, uintptr_t* arguments)
@@ -3647,11 +3665,7 @@ uint64_t jvmGetStackTraceElement(Thread* t, uintptr_t* arguments)
   return reinterpret_cast<uint64_t>(makeLocalReference(
       t,
       makeStackTraceElement(
-          t,
-          cast<GcTraceElement>(
-              t,
-              objectArrayBody(
-                  t, cast<GcThrowable>(t, *throwable)->trace(), index)))));
+          t, cast<GcThrowable>(t, *throwable)->trace(), index)));
 }
 
 extern "C" AVIAN_EXPORT jobject JNICALL
@@ -3883,14 +3897,13 @@ uint64_t jvmDumpThreads(Thread* t, uintptr_t* arguments)
       object trace = t->m->processor->getStackTrace(t, peer);
       PROTECT(t, trace);
 
-      unsigned traceLength = objectArrayLength(t, trace);
+      unsigned traceLength = vm::traceLength(t, trace);
       object array
           = makeObjectArray(t, type(t, GcStackTraceElement::Type), traceLength);
       PROTECT(t, array);
 
       for (unsigned traceIndex = 0; traceIndex < traceLength; ++traceIndex) {
-        object ste = makeStackTraceElement(
-            t, cast<GcTraceElement>(t, objectArrayBody(t, trace, traceIndex)));
+        object ste = makeStackTraceElement(t, trace, traceIndex);
         setField(t, array, ArrayBody + (traceIndex * BytesPerWord), ste);
       }
 
@@ -3928,15 +3941,11 @@ uint64_t jvmGetClassContext(Thread* t, uintptr_t*)
   PROTECT(t, trace);
 
   object context = makeObjectArray(
-      t, type(t, GcJclass::Type), objectArrayLength(t, trace));
+      t, type(t, GcJclass::Type), traceLength(t, trace));
   PROTECT(t, context);
 
-  for (unsigned i = 0; i < objectArrayLength(t, trace); ++i) {
-    object c = getJClass(
-        t,
-        cast<GcMethod>(
-            t, cast<GcTraceElement>(t, objectArrayBody(t, trace, i))->method())
-            ->class_());
+  for (unsigned i = 0; i < traceLength(t, trace); ++i) {
+    object c = getJClass(t, traceMethod(t, trace, i)->class_());
 
     setField(t, context, ArrayBody + (i * BytesPerWord), c);
   }
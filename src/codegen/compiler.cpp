@@ -1444,6 +1444,7 @@ void append(Context* c, Event* e)
   }
 
   if (c->lastEvent) {
+    e->sequence = c->lastEvent->sequence + 1;
     c->lastEvent->next = e;
   } else {
     c->firstEvent = e;
@@ -2085,6 +2086,11 @@ void compile(Context* c,
       }
 
       block->nextInstruction = nextInstruction;
+
+      if (e->next == 0) {
+        compileColdCalls(c);
+      }
+
       block->assemblerBlock = a->endBlock(e->next != 0);
 
       if (e->next) {
@@ -2169,9 +2175,213 @@ void restoreState(Context* c, ForkState* s)
   }
 }
 
+void startBlock(Context* c)
+{
+  memset(c->blockConstants, 0, sizeof(c->blockConstants));
+}
+
+Value* blockConstant(Context* c, int64_t value, ir::Type type)
+{
+  Value* v = compiler::value(
+      c, type, compiler::constantSite(c, resolvedPromise(c, value)));
+
+  if (type.flavor() == ir::Type::Integer
+      and type.size(c->targetInfo) <= c->targetInfo.pointerSize) {
+    c->blockConstants[c->blockConstantIndex++ % BlockConstantCount] = v;
+  }
+
+  return v;
+}
+
+// Returns true and stores the value of v in value if v is one of the
+// constants created since the start of the current basic block.
+bool findBlockConstant(Context* c, Value* v, int64_t* value)
+{
+  for (unsigned i = 0; i < BlockConstantCount; ++i) {
+    if (c->blockConstants[i] == v) {
+      *value = static_cast<ConstantSite*>(v->sites)->value->value();
+
+      if (v->type.size(c->targetInfo) == 4) {
+        *value = static_cast<int32_t>(*value);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Evaluates "second op first" as the generated code would, returning
+// false if that can't be done at compile time.
+bool fold(lir::TernaryOperation op,
+          unsigned size,
+          int64_t first,
+          int64_t second,
+          int64_t* result)
+{
+  uint64_t a = first;
+  uint64_t b = second;
+  unsigned shift = a & (size * 8 - 1);
+
+  uint64_t r;
+  switch (op) {
+  case lir::Add:
+    r = b + a;
+    break;
+
+  case lir::Subtract:
+    r = b - a;
+    break;
+
+  case lir::Multiply:
+    r = b * a;
+    break;
+
+  case lir::Divide:
+    // division by zero must still trap, and the one overflowing
+    // quotient is better not left to the host's arithmetic
+    if (first == 0) {
+      return false;
+    }
+    r = first == -1 ? 0 - b : second / first;
+    break;
+
+  case lir::Remainder:
+    if (first == 0) {
+      return false;
+    }
+    r = first == -1 ? 0 : second % first;
+    break;
+
+  case lir::ShiftLeft:
+    r = b << shift;
+    break;
+
+  case lir::ShiftRight:
+    r = second >> shift;
+    break;
+
+  case lir::UnsignedShiftRight:
+    r = (size == 4 ? b & 0xFFFFFFFF : b) >> shift;
+    break;
+
+  case lir::And:
+    r = b & a;
+    break;
+
+  case lir::Or:
+    r = b | a;
+    break;
+
+  case lir::Xor:
+    r = b ^ a;
+    break;
+
+  default:
+    return false;
+  }
+
+  *result = size == 4 ? static_cast<int32_t>(r) : static_cast<int64_t>(r);
+  return true;
+}
+
+bool fold(lir::BinaryOperation op,
+          unsigned size,
+          int64_t value,
+          int64_t* result)
+{
+  uint64_t a = size == 4 ? value & 0xFFFFFFFF : value;
+
+  uint64_t r;
+  switch (op) {
+  case lir::Negate:
+    r = 0 - a;
+    break;
+
+  case lir::Absolute:
+    r = value < 0 ? 0 - a : a;
+    break;
+
+  case lir::PopCount:
+    for (r = 0; a; a &= a - 1) {
+      ++r;
+    }
+    break;
+
+  case lir::CountLeadingZeros:
+    for (r = size * 8; a; a >>= 1) {
+      --r;
+    }
+    break;
+
+  default:
+    return false;
+  }
+
+  *result = size == 4 ? static_cast<int32_t>(r) : static_cast<int64_t>(r);
+  return true;
+}
+
+// Returns what "second op first" simplifies to when just one of the
+// operands is a known constant, or null if it doesn't.
+Value* simplify(Context* c,
+                lir::TernaryOperation op,
+                ir::Type type,
+                Value* first,
+                Value* second)
+{
+  int64_t constant;
+  if (findBlockConstant(c, first, &constant)) {
+    switch (op) {
+    case lir::Add:
+    case lir::Subtract:
+    case lir::Or:
+    case lir::Xor:
+    case lir::ShiftLeft:
+    case lir::ShiftRight:
+    case lir::UnsignedShiftRight:
+      return constant == 0 and second->type == type ? second : 0;
+
+    case lir::Multiply:
+    case lir::Divide:
+      return constant == 1 ? second : 0;
+
+    case lir::And:
+      return constant == -1 ? second : 0;
+
+    default:
+      return 0;
+    }
+  } else if (findBlockConstant(c, second, &constant)) {
+    switch (op) {
+    case lir::Add:
+    case lir::Or:
+    case lir::Xor:
+      return constant == 0 ? first : 0;
+
+    case lir::Multiply:
+      return constant == 1 ? first : 0;
+
+    case lir::And:
+      return constant == -1 ? first : 0;
+
+    default:
+      return 0;
+    }
+  } else {
+    return 0;
+  }
+}
+
 Value* maybeBuddy(Context* c, Value* v)
 {
   if (v->home >= 0) {
+    // a constant needn't share its original's sites, and keeping it
+    // a constant lets later arithmetic on it be folded
+    int64_t constant;
+    if (findBlockConstant(c, v, &constant)) {
+      return blockConstant(c, constant, v->type);
+    }
+
     Value* n = value(c, v->type);
     appendBuddy(c, v, n);
     return n;
@@ -2258,6 +2468,7 @@ class MyCompiler : public Compiler {
   virtual void restoreState(State* state)
   {
     compiler::restoreState(&c, static_cast<ForkState*>(state));
+    compiler::startBlock(&c);
   }
 
   virtual void init(unsigned logicalCodeLength,
@@ -2360,6 +2571,11 @@ class MyCompiler : public Compiler {
     c.logicalIp = logicalIp;
   }
 
+  virtual void startBlock()
+  {
+    compiler::startBlock(&c);
+  }
+
   virtual Promise* machineIp(unsigned logicalIp)
   {
     return ipPromise(&c, logicalIp);
@@ -2389,7 +2605,7 @@ class MyCompiler : public Compiler {
 
   virtual ir::Value* constant(int64_t value, ir::Type type)
   {
-    return promiseConstant(resolvedPromise(&c, value), type);
+    return blockConstant(&c, value, type);
   }
 
   virtual ir::Value* promiseConstant(Promise* value, ir::Type type)
@@ -2721,6 +2937,11 @@ class MyCompiler : public Compiler {
                       handler);
   }
 
+  virtual void checkNull(ir::Value* object)
+  {
+    appendNullCheck(&c, static_cast<Value*>(object));
+  }
+
   virtual ir::Value* truncate(ir::Type type, ir::Value* src)
   {
     assertT(&c, src->type.flavor() == type.flavor());
@@ -2825,10 +3046,32 @@ class MyCompiler : public Compiler {
             (isGeneralBinaryOp(op) and isGeneralValue(a) and isGeneralValue(b))
             or (isFloatBinaryOp(op) and isFloatValue(a) and isFloatValue(b)));
 
+    Value* first = static_cast<Value*>(a);
+    Value* second = static_cast<Value*>(b);
+
+    if (isGeneralBinaryOp(op)) {
+      int64_t firstConstant;
+      int64_t secondConstant;
+      int64_t folded;
+      if (findBlockConstant(&c, first, &firstConstant)
+          and findBlockConstant(&c, second, &secondConstant)
+          and fold(op,
+                   type.size(c.targetInfo),
+                   firstConstant,
+                   secondConstant,
+                   &folded)) {
+        return blockConstant(&c, folded, type);
+      }
+
+      Value* simplified = simplify(&c, op, type, first, second);
+      if (simplified) {
+        return simplified;
+      }
+    }
+
     Value* result = value(&c, type);
 
-    appendCombine(
-        &c, op, static_cast<Value*>(a), static_cast<Value*>(b), result);
+    appendCombine(&c, op, first, second, result);
     return result;
   }
 
@@ -2837,6 +3080,13 @@ class MyCompiler : public Compiler {
     assertT(&c,
             (isGeneralUnaryOp(op) and isGeneralValue(a))
             or (isFloatUnaryOp(op) and isFloatValue(a)));
+    int64_t constant;
+    int64_t folded;
+    if (findBlockConstant(&c, static_cast<Value*>(a), &constant)
+        and fold(op, a->type.size(c.targetInfo), constant, &folded)) {
+      return blockConstant(&c, folded, a->type);
+    }
+
     Value* result = value(&c, a->type);
     appendTranslate(&c, op, static_cast<Value*>(a), result);
     return result;
@@ -2906,6 +3156,33 @@ class MyCompiler : public Compiler {
     return c.constantCount * TargetBytesPerWord;
   }
 
+  virtual unsigned eventCount()
+  {
+    unsigned count = 0;
+    for (Event* e = c.firstEvent; e; e = e->next) {
+      ++count;
+    }
+    return count;
+  }
+
+  virtual unsigned coldCallCount()
+  {
+    return c.coldCallCount;
+  }
+
+  virtual void coldCall(unsigned index,
+                        Promise** start,
+                        Promise** end,
+                        Promise** hotReturn)
+  {
+    assertT(&c, index < c.coldCallCount);
+    ColdCall* call = c.coldCallTable[index];
+
+    *start = call->start;
+    *end = call->end;
+    *hotReturn = call->hotReturn;
+  }
+
   virtual void write()
   {
     c.assembler->write();
@@ -38,6 +38,9 @@ Context::Context(vm::System* system,
       acquiredResources(0),
       firstConstant(0),
       lastConstant(0),
+      firstColdCall(0),
+      lastColdCall(0),
+      coldCallTable(0),
       machineCode(0),
       firstEvent(0),
       lastEvent(0),
@@ -45,14 +48,18 @@ Context::Context(vm::System* system,
       firstBlock(0),
       logicalIp(-1),
       constantCount(0),
+      coldCallCount(0),
       parameterFootprint(0),
       localFootprint(0),
       machineCodeSize(0),
       alignedFrameSize(0),
       availableGeneralRegisterCount(regFile->generalRegisters.limit
                                     - regFile->generalRegisters.start),
-      targetInfo(arch->targetInfo())
+      targetInfo(arch->targetInfo()),
+      blockConstantIndex(0)
 {
+  memset(blockConstants, 0, sizeof(blockConstants));
+
   for (Register i : regFile->generalRegisters) {
     new (registerResources + i.index()) RegisterResource(arch->reserved(i));
 
@@ -36,6 +36,7 @@ class ConstantPoolNode;
 
 class ForkState;
 class Block;
+class ColdCall;
 
 template <class T>
 List<T>* reverseDestroy(List<T>* cell)
@@ -92,6 +93,9 @@ class LogicalCode {
   }
 };
 
+// number of recently created constants remembered for folding
+const unsigned BlockConstantCount = 8;
+
 class Context {
  public:
   Context(vm::System* system,
@@ -116,6 +120,10 @@ class Context {
   Resource* acquiredResources;
   ConstantPoolNode* firstConstant;
   ConstantPoolNode* lastConstant;
+  ColdCall* firstColdCall;
+  ColdCall* lastColdCall;
+  // the same calls, indexed once they've been compiled
+  ColdCall** coldCallTable;
   uint8_t* machineCode;
   Event* firstEvent;
   Event* lastEvent;
@@ -123,12 +131,18 @@ class Context {
   Block* firstBlock;
   int logicalIp;
   unsigned constantCount;
+  unsigned coldCallCount;
   unsigned parameterFootprint;
   unsigned localFootprint;
   unsigned machineCodeSize;
   unsigned alignedFrameSize;
   unsigned availableGeneralRegisterCount;
   ir::TargetInfo targetInfo;
+  // the most recent word-sized constants created in the current basic
+  // block, which, unlike values which may have been rebound at a
+  // junction, are known to hold the same value wherever they're read
+  Value* blockConstants[BlockConstantCount];
+  unsigned blockConstantIndex;
 };
 
 inline Aborter* getAborter(Context* c)
@@ -107,6 +107,7 @@ Site* pickTargetSite(Context* c,
                      unsigned registerReserveCount = 0,
                      CostCalculator* costCalculator = 0);
 Value* threadRegister(Context* c);
+ConstantSite* findConstantSite(Context* c, Value* v);
 
 Event::Event(Context* c)
     : next(0),
@@ -123,7 +124,8 @@ Event::Event(Context* c)
       visitLinks(0),
       block(0),
       logicalInstruction(c->logicalCode[c->logicalIp]),
-      readCount(0)
+      readCount(0),
+      sequence(0)
 {
 }
 
@@ -369,6 +371,15 @@ class CallEvent : public Event {
         resultValue(resultValue),
         returnAddressSurrogate(0),
         framePointerSurrogate(0),
+        checkedClass(0),
+        checkedObject(0),
+        storedObject(0),
+        storedOffset(0),
+        storedValue(0),
+        allocatedClass(0),
+        allocationSite(0),
+        allocatedSize(0),
+        allocatedLength(0),
         popIndex(0),
         stackArgumentIndex(0),
         flags(flags),
@@ -382,6 +393,32 @@ class CallEvent : public Event {
       assertT(c, (flags & Compiler::TailJump) == 0);
       assertT(c, stackArgumentFootprint == 0);
 
+      if (flags & Compiler::ClassCheck) {
+        assertT(c, arguments.count == 3);
+
+        checkedClass = static_cast<Value*>(arguments[1]);
+        checkedObject = static_cast<Value*>(arguments[2]);
+      }
+
+      if (flags & Compiler::StoreBarrier) {
+        assertT(c, arguments.count == 4);
+
+        storedObject = static_cast<Value*>(arguments[1]);
+        storedOffset = static_cast<Value*>(arguments[2]);
+        storedValue = static_cast<Value*>(arguments[3]);
+      }
+
+      if (flags & Compiler::InlineAllocation) {
+        assertT(c, arguments.count == 4 or arguments.count == 5);
+
+        allocatedClass = static_cast<Value*>(arguments[1]);
+        allocationSite = static_cast<Value*>(arguments[2]);
+        if (arguments.count == 5) {
+          allocatedLength = static_cast<Value*>(arguments[3]);
+        }
+        allocatedSize = static_cast<Value*>(arguments[arguments.count - 1]);
+      }
+
       unsigned index = 0;
       unsigned argumentIndex = 0;
 
@@ -627,6 +664,26 @@ class CallEvent : public Event {
       op = lir::Call;
     }
 
+    CodePromise* nullPromise = 0;
+    CodePromise* exactPromise = 0;
+    if (flags & Compiler::ClassCheck) {
+      nullPromise = codePromise(c, static_cast<Promise*>(0));
+      exactPromise = resultValue->type.size(c->targetInfo)
+                         ? codePromise(c, static_cast<Promise*>(0))
+                         : nullPromise;
+
+      compileClassCheck(c, nullPromise, exactPromise);
+    }
+
+    CodePromise* skipPromise = 0;
+    if (flags & Compiler::StoreBarrier) {
+      skipPromise = compileStoreBarrier(c);
+    }
+
+    if (flags & Compiler::InlineAllocation) {
+      skipPromise = compileInlineAllocation(c);
+    }
+
     apply(c, op, c->targetInfo.pointerSize, address->source, address->source);
 
     if (traceHandler) {
@@ -634,6 +691,14 @@ class CallEvent : public Event {
                                 stackArgumentIndex);
     }
 
+    if (flags & Compiler::ClassCheck) {
+      compileClassCheckResults(c, nullPromise, exactPromise);
+    }
+
+    if (skipPromise) {
+      skipPromise->offset = c->assembler->offset();
+    }
+
     if (TailCalls) {
       if (flags & Compiler::TailJump) {
         if (returnAddressSurrogate) {
@@ -660,6 +725,547 @@ class CallEvent : public Event {
     }
   }
 
+  // Branches to nullPromise if the checked object is null and to
+  // exactPromise if its class is the checked class, leaving the
+  // arguments where they are for the call which follows otherwise.
+  // The scratch register is free to use here, since the call may
+  // clobber it anyway and the arguments are in their own registers or
+  // on the stack.
+  void compileClassCheck(Context* c,
+                         CodePromise* nullPromise,
+                         CodePromise* exactPromise)
+  {
+    unsigned size = c->targetInfo.pointerSize;
+
+    assertT(c, address->source->type(c) == lir::Operand::Type::Constant);
+
+    Register scratchNumber = c->arch->scratch();
+    RegisterSite scratch(RegisterMask(scratchNumber), scratchNumber);
+
+    apply(c,
+          lir::Move,
+          size,
+          checkedObject->source,
+          checkedObject->source,
+          size,
+          &scratch,
+          &scratch);
+
+    ConstantSite zero(resolvedPromise(c, 0));
+    ConstantSite null(nullPromise);
+    apply(c,
+          lir::JumpIfEqual,
+          size,
+          &zero,
+          &zero,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          &null,
+          &null);
+
+    MemorySite header(scratchNumber, 0, NoRegister, 1);
+    header.acquired = true;
+    apply(c, lir::Move, size, &header, &header, size, &scratch, &scratch);
+
+    ConstantSite mask(resolvedPromise(c, vm::TargetPointerMask));
+    apply(c,
+          lir::And,
+          size,
+          &mask,
+          &mask,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          &scratch,
+          &scratch);
+
+    ConstantSite exact(exactPromise);
+    apply(c,
+          lir::JumpIfEqual,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          checkedClass->source,
+          checkedClass->source,
+          size,
+          &exact,
+          &exact);
+  }
+
+  // Makes the store in line, then branches to the returned promise,
+  // which belongs just after the call, unless the heap must hear of
+  // it, in which case we fall through to the call and it makes the
+  // store again.  Null objects go straight to the call.  As above,
+  // only the scratch register is written.  If the operands aren't all
+  // in registers (e.g. because arguments are passed on the stack), we
+  // leave everything to the call and return null.
+  //
+  // An object is in the thread-local heap if it lies in [heap,
+  // heapLimit).  The comparisons are signed, but a range which spans
+  // the sign boundary only ever sends us to the call, never past it.
+  CodePromise* compileStoreBarrier(Context* c)
+  {
+    unsigned size = c->targetInfo.pointerSize;
+
+    ConstantSite* offset = findConstantSite(c, storedOffset);
+    if (offset and not offset->value->resolved()) {
+      offset = 0;
+    }
+
+    if (storedObject->source->type(c) != lir::Operand::Type::RegisterPair
+        or storedValue->source->type(c) != lir::Operand::Type::RegisterPair
+        or (offset == 0 and storedOffset->source->type(c)
+                            != lir::Operand::Type::RegisterPair)) {
+      return 0;
+    }
+
+    Register object = static_cast<RegisterSite*>(storedObject->source)->number;
+
+    CodePromise* callPromise = codePromise(c, static_cast<Promise*>(0));
+    CodePromise* skipPromise = codePromise(c, static_cast<Promise*>(0));
+    ConstantSite call(callPromise);
+    ConstantSite skip(skipPromise);
+    ConstantSite zero(resolvedPromise(c, 0));
+
+    apply(c,
+          lir::JumpIfEqual,
+          size,
+          &zero,
+          &zero,
+          size,
+          storedObject->source,
+          storedObject->source,
+          size,
+          &call,
+          &call);
+
+    MemorySite field(
+        object,
+        offset ? offset->value->value() : 0,
+        offset ? NoRegister
+               : static_cast<RegisterSite*>(storedOffset->source)->number,
+        1);
+    field.acquired = true;
+    apply(c,
+          lir::Move,
+          size,
+          storedValue->source,
+          storedValue->source,
+          size,
+          &field,
+          &field);
+
+    apply(c,
+          lir::JumpIfEqual,
+          size,
+          &zero,
+          &zero,
+          size,
+          storedValue->source,
+          storedValue->source,
+          size,
+          &skip,
+          &skip);
+
+    Register scratchNumber = c->arch->scratch();
+    RegisterSite scratch(RegisterMask(scratchNumber), scratchNumber);
+
+    MemorySite heap(c->arch->thread(), TARGET_THREAD_HEAP, NoRegister, 1);
+    heap.acquired = true;
+    apply(c, lir::Move, size, &heap, &heap, size, &scratch, &scratch);
+
+    apply(c,
+          lir::JumpIfLess,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          storedObject->source,
+          storedObject->source,
+          size,
+          &call,
+          &call);
+
+    MemorySite limit(
+        c->arch->thread(), TARGET_THREAD_HEAPLIMIT, NoRegister, 1);
+    limit.acquired = true;
+    apply(c, lir::Move, size, &limit, &limit, size, &scratch, &scratch);
+
+    apply(c,
+          lir::JumpIfLess,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          storedObject->source,
+          storedObject->source,
+          size,
+          &skip,
+          &skip);
+
+    callPromise->offset = c->assembler->offset();
+
+    return skipPromise;
+  }
+
+  // Allocates the object in line and branches to the returned
+  // promise, which belongs just after the call, with the object in
+  // the return register.  If the site is due to be sampled, pretenured
+  // or profiled, or the object won't fit in the thread-local heap, we
+  // fall through to the call instead.  Besides the scratch register,
+  // the one holding the (element) size is free to use, since we know
+  // its value and put it back on the way to the call.  If the
+  // operands aren't all in registers, or the object's size isn't
+  // known or is too big to be worth zeroing here, we leave everything
+  // to the call and return null.
+  CodePromise* compileInlineAllocation(Context* c)
+  {
+    const unsigned MaxSizeInWords = 16;
+
+    unsigned size = c->targetInfo.pointerSize;
+
+    ConstantSite* sizeConstant = findConstantSite(c, allocatedSize);
+    ConstantSite* lengthConstant
+        = allocatedLength ? findConstantSite(c, allocatedLength) : 0;
+
+    if (sizeConstant == 0 or not sizeConstant->value->resolved()
+        or (allocatedLength and (lengthConstant == 0
+                                 or not lengthConstant->value->resolved()))
+        or allocatedClass->source->type(c) != lir::Operand::Type::RegisterPair
+        or allocationSite->source->type(c) != lir::Operand::Type::RegisterPair
+        or allocatedSize->source->type(c)
+           != lir::Operand::Type::RegisterPair) {
+      return 0;
+    }
+
+    int64_t sizeInWords;
+    int64_t length = 0;
+    if (allocatedLength) {
+      length = lengthConstant->value->value();
+      if (length < 0 or length > static_cast<int64_t>(MaxSizeInWords * size)) {
+        return 0;
+      }
+      sizeInWords = ceilingDivide(
+          vm::TargetArrayBody + length * sizeConstant->value->value(), size);
+    } else {
+      sizeInWords = sizeConstant->value->value();
+    }
+
+    if (sizeInWords > static_cast<int64_t>(MaxSizeInWords)) {
+      return 0;
+    }
+
+    Register classNumber
+        = static_cast<RegisterSite*>(allocatedClass->source)->number;
+    Register siteNumber
+        = static_cast<RegisterSite*>(allocationSite->source)->number;
+    Register temporaryNumber
+        = static_cast<RegisterSite*>(allocatedSize->source)->number;
+    Register scratchNumber = c->arch->scratch();
+    Register resultNumber = c->arch->returnLow();
+
+    if (resultNumber == classNumber or resultNumber == siteNumber
+        or resultNumber == temporaryNumber or scratchNumber == classNumber
+        or scratchNumber == siteNumber or scratchNumber == temporaryNumber) {
+      return 0;
+    }
+
+    RegisterSite scratch(RegisterMask(scratchNumber), scratchNumber);
+    RegisterSite temporary(RegisterMask(temporaryNumber), temporaryNumber);
+    RegisterSite result(RegisterMask(resultNumber), resultNumber);
+
+    CodePromise* slowPromise = codePromise(c, static_cast<Promise*>(0));
+    CodePromise* skipPromise = codePromise(c, static_cast<Promise*>(0));
+    ConstantSite slow(slowPromise);
+    ConstantSite skip(skipPromise);
+    ConstantSite zero(resolvedPromise(c, 0));
+
+    // the pretenure and profiled flags are adjacent bytes, so one load
+    // tests both
+    MemorySite pretenure(
+        siteNumber, vm::TargetAllocationSitePretenure, NoRegister, 1);
+    pretenure.acquired = true;
+    apply(c, lir::Move, 2, &pretenure, &pretenure, 4, &scratch, &scratch);
+
+    apply(c,
+          lir::JumpIfNotEqual,
+          4,
+          &zero,
+          &zero,
+          4,
+          &scratch,
+          &scratch,
+          size,
+          &slow,
+          &slow);
+
+    // the site counts its allocations and samples one in every
+    // interval, which is left to the call
+    MemorySite allocations(
+        siteNumber, vm::TargetAllocationSiteAllocations, NoRegister, 1);
+    allocations.acquired = true;
+    apply(c, lir::Move, 4, &allocations, &allocations, 4, &scratch, &scratch);
+
+    ConstantSite mask(
+        resolvedPromise(c, vm::TargetAllocationSampleInterval - 1));
+    apply(c,
+          lir::And,
+          4,
+          &mask,
+          &mask,
+          4,
+          &scratch,
+          &scratch,
+          4,
+          &scratch,
+          &scratch);
+
+    apply(c,
+          lir::JumpIfEqual,
+          4,
+          &mask,
+          &mask,
+          4,
+          &scratch,
+          &scratch,
+          size,
+          &slow,
+          &slow);
+
+    MemorySite index(
+        c->arch->thread(), TARGET_THREAD_HEAPINDEX, NoRegister, 1);
+    index.acquired = true;
+    apply(c, lir::Move, 4, &index, &index, 4, &scratch, &scratch);
+
+    ConstantSite words(resolvedPromise(c, sizeInWords));
+    apply(c, lir::Move, 4, &words, &words, 4, &temporary, &temporary);
+
+    apply(c,
+          lir::Add,
+          4,
+          &temporary,
+          &temporary,
+          4,
+          &scratch,
+          &scratch,
+          4,
+          &scratch,
+          &scratch);
+
+    MemorySite limit(
+        c->arch->thread(), TARGET_THREAD_HEAPSIZEINWORDS, NoRegister, 1);
+    limit.acquired = true;
+    apply(c, lir::Move, 4, &limit, &limit, 4, &temporary, &temporary);
+
+    apply(c,
+          lir::JumpIfLess,
+          4,
+          &scratch,
+          &scratch,
+          4,
+          &temporary,
+          &temporary,
+          size,
+          &slow,
+          &slow);
+
+    apply(c, lir::Move, 4, &scratch, &scratch, 4, &index, &index);
+
+    // the object starts at heap + (index - words) * word size, where
+    // index is the new one
+    ConstantSite shift(resolvedPromise(c, log(size)));
+    apply(c,
+          lir::ShiftLeft,
+          size,
+          &shift,
+          &shift,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          &scratch,
+          &scratch);
+
+    ConstantSite bytes(resolvedPromise(c, sizeInWords * size));
+    apply(c, lir::Move, size, &bytes, &bytes, size, &temporary, &temporary);
+
+    apply(c,
+          lir::Subtract,
+          size,
+          &temporary,
+          &temporary,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          &scratch,
+          &scratch);
+
+    MemorySite heap(c->arch->thread(), TARGET_THREAD_HEAP, NoRegister, 1);
+    heap.acquired = true;
+    apply(c, lir::Move, size, &heap, &heap, size, &temporary, &temporary);
+
+    apply(c,
+          lir::Add,
+          size,
+          &temporary,
+          &temporary,
+          size,
+          &scratch,
+          &scratch,
+          size,
+          &result,
+          &result);
+
+    // thread-local heaps aren't cleared after a collection, so the
+    // object must be zeroed as it's handed out
+    unsigned first = 1;
+    if (allocatedLength) {
+      ConstantSite lengthValue(resolvedPromise(c, length));
+      apply(c,
+            lir::Move,
+            size,
+            &lengthValue,
+            &lengthValue,
+            size,
+            &temporary,
+            &temporary);
+
+      MemorySite lengthField(
+          resultNumber, vm::TargetArrayLength, NoRegister, 1);
+      lengthField.acquired = true;
+      apply(c,
+            lir::Move,
+            size,
+            &temporary,
+            &temporary,
+            size,
+            &lengthField,
+            &lengthField);
+
+      first = vm::TargetArrayBody / size;
+    }
+
+    if (first < sizeInWords) {
+      apply(c, lir::Move, size, &zero, &zero, size, &temporary, &temporary);
+
+      for (unsigned i = first; i < sizeInWords; ++i) {
+        MemorySite field(resultNumber, i * size, NoRegister, 1);
+        field.acquired = true;
+        apply(c,
+              lir::Move,
+              size,
+              &temporary,
+              &temporary,
+              size,
+              &field,
+              &field);
+      }
+    }
+
+    MemorySite header(resultNumber, 0, NoRegister, 1);
+    header.acquired = true;
+    apply(c,
+          lir::Move,
+          size,
+          allocatedClass->source,
+          allocatedClass->source,
+          size,
+          &header,
+          &header);
+
+    // now that the class has been stored, its register is free too,
+    // since the call would have clobbered it anyway
+    RegisterSite one(RegisterMask(classNumber), classNumber);
+    ConstantSite oneValue(resolvedPromise(c, 1));
+    apply(c, lir::Move, 4, &oneValue, &oneValue, 4, &one, &one);
+
+    apply(c,
+          lir::Move,
+          4,
+          &allocations,
+          &allocations,
+          4,
+          &temporary,
+          &temporary);
+
+    apply(c,
+          lir::Add,
+          4,
+          &one,
+          &one,
+          4,
+          &temporary,
+          &temporary,
+          4,
+          &temporary,
+          &temporary);
+
+    apply(c,
+          lir::Move,
+          4,
+          &temporary,
+          &temporary,
+          4,
+          &allocations,
+          &allocations);
+
+    apply(c, lir::Jump, size, &skip, &skip);
+
+    slowPromise->offset = c->assembler->offset();
+
+    apply(c,
+          lir::Move,
+          4,
+          sizeConstant,
+          sizeConstant,
+          4,
+          &temporary,
+          &temporary);
+
+    return skipPromise;
+  }
+
+  // Puts the result of a skipped call where the call would have.
+  void compileClassCheckResults(Context* c,
+                                CodePromise* nullPromise,
+                                CodePromise* exactPromise)
+  {
+    Assembler* a = c->assembler;
+
+    if (nullPromise == exactPromise) {
+      nullPromise->offset = a->offset();
+      return;
+    }
+
+    unsigned size = resultValue->type.size(c->targetInfo);
+    assertT(c, size <= c->targetInfo.pointerSize);
+
+    CodePromise* nextPromise = codePromise(c, static_cast<Promise*>(0));
+    ConstantSite next(nextPromise);
+    RegisterSite result(RegisterMask(c->arch->returnLow()),
+                        c->arch->returnLow());
+
+    apply(c, lir::Jump, c->targetInfo.pointerSize, &next, &next);
+
+    nullPromise->offset = a->offset();
+
+    ConstantSite zero(resolvedPromise(c, 0));
+    apply(c, lir::Move, size, &zero, &zero, size, &result, &result);
+    apply(c, lir::Jump, c->targetInfo.pointerSize, &next, &next);
+
+    exactPromise->offset = a->offset();
+
+    ConstantSite one(resolvedPromise(c, 1));
+    apply(c, lir::Move, size, &one, &one, size, &result, &result);
+
+    nextPromise->offset = a->offset();
+  }
+
   virtual bool allExits()
   {
     return (flags & Compiler::TailJump) != 0;
@@ -670,6 +1276,15 @@ class CallEvent : public Event {
   Value* resultValue;
   Value* returnAddressSurrogate;
   Value* framePointerSurrogate;
+  Value* checkedClass;
+  Value* checkedObject;
+  Value* storedObject;
+  Value* storedOffset;
+  Value* storedValue;
+  Value* allocatedClass;
+  Value* allocationSite;
+  Value* allocatedSize;
+  Value* allocatedLength;
   unsigned popIndex;
   unsigned stackArgumentIndex;
   unsigned flags;
@@ -2007,35 +2622,37 @@ class BoundsCheckEvent : public Event {
     Assembler* a = c->assembler;
 
     ConstantSite* constant = findConstantSite(c, index);
-    CodePromise* outOfBoundsPromise = 0;
-
-    if (constant) {
-      if (constant->value->value() < 0) {
-        lir::Constant handlerConstant(resolvedPromise(c, handler));
-        a->apply(lir::Call,
-                 OperandInfo(c->targetInfo.pointerSize,
-                             lir::Operand::Type::Constant,
-                             &handlerConstant));
-      }
-    } else {
-      outOfBoundsPromise = compiler::codePromise(c, static_cast<Promise*>(0));
 
-      ConstantSite zero(resolvedPromise(c, 0));
+    if (constant and constant->value->value() < 0) {
+      // the check always fails, so there's no other path to keep the
+      // call out of the way of
+      lir::Constant handlerConstant(resolvedPromise(c, handler));
+      a->apply(lir::Call,
+               OperandInfo(c->targetInfo.pointerSize,
+                           lir::Operand::Type::Constant,
+                           &handlerConstant));
+    } else {
+      // branch to a call compiled after the rest of the method, so
+      // that an index which is in bounds runs straight through
+      CodePromise* outOfBoundsPromise
+          = compiler::codePromise(c, static_cast<Promise*>(0));
       ConstantSite oob(outOfBoundsPromise);
-      apply(c,
-            lir::JumpIfLess,
-            4,
-            &zero,
-            &zero,
-            4,
-            index->source,
-            index->source,
-            c->targetInfo.pointerSize,
-            &oob,
-            &oob);
-    }
 
-    if (constant == 0 or constant->value->value() >= 0) {
+      if (constant == 0) {
+        ConstantSite zero(resolvedPromise(c, 0));
+        apply(c,
+              lir::JumpIfLess,
+              4,
+              &zero,
+              &zero,
+              4,
+              index->source,
+              index->source,
+              c->targetInfo.pointerSize,
+              &oob,
+              &oob);
+      }
+
       assertT(c, object->source->type(c) == lir::Operand::Type::RegisterPair);
       MemorySite length(static_cast<RegisterSite*>(object->source)->number,
                         lengthOffset,
@@ -2043,14 +2660,10 @@ class BoundsCheckEvent : public Event {
                         1);
       length.acquired = true;
 
-      CodePromise* nextPromise
-          = compiler::codePromise(c, static_cast<Promise*>(0));
-
       freezeSource(c, c->targetInfo.pointerSize, index);
 
-      ConstantSite next(nextPromise);
       apply(c,
-            lir::JumpIfGreater,
+            lir::JumpIfLessOrEqual,
             4,
             index->source,
             index->source,
@@ -2058,22 +2671,15 @@ class BoundsCheckEvent : public Event {
             &length,
             &length,
             c->targetInfo.pointerSize,
-            &next,
-            &next);
+            &oob,
+            &oob);
 
       thawSource(c, c->targetInfo.pointerSize, index);
 
-      if (constant == 0) {
-        outOfBoundsPromise->offset = a->offset();
-      }
-
-      lir::Constant handlerConstant(resolvedPromise(c, handler));
-      a->apply(lir::Call,
-               OperandInfo(c->targetInfo.pointerSize,
-                           lir::Operand::Type::Constant,
-                           &handlerConstant));
-
-      nextPromise->offset = a->offset();
+      appendColdCall(c,
+                     outOfBoundsPromise,
+                     compiler::codePromise(c, a->offset()),
+                     handler);
     }
 
     popRead(c, this, object);
@@ -2097,6 +2703,106 @@ void appendBoundsCheck(Context* c,
          BoundsCheckEvent(c, object, lengthOffset, index, handler));
 }
 
+// Loads the first word of an object into the scratch register, which
+// nothing else reads, so that a null object faults.  A load into a
+// value would be no use, since a value nobody reads is never loaded.
+class NullCheckEvent : public Event {
+ public:
+  NullCheckEvent(Context* c, Value* object) : Event(c), object(object)
+  {
+    this->addRead(
+        c,
+        object,
+        SiteMask(lir::Operand::RegisterPairMask,
+                 c->regFile->generalRegisters.excluding(c->arch->scratch()),
+                 NoFrameIndex));
+  }
+
+  virtual const char* name()
+  {
+    return "NullCheckEvent";
+  }
+
+  virtual void compile(Context* c)
+  {
+    assertT(c, object->source->type(c) == lir::Operand::Type::RegisterPair);
+
+    Register scratchNumber = c->arch->scratch();
+    RegisterSite scratch(RegisterMask(scratchNumber), scratchNumber);
+
+    MemorySite header(
+        static_cast<RegisterSite*>(object->source)->number, 0, NoRegister, 1);
+    header.acquired = true;
+
+    apply(c,
+          lir::Move,
+          c->targetInfo.pointerSize,
+          &header,
+          &header,
+          c->targetInfo.pointerSize,
+          &scratch,
+          &scratch);
+
+    popRead(c, this, object);
+  }
+
+  Value* object;
+};
+
+void appendNullCheck(Context* c, Value* object)
+{
+  append(c, new (c->zone) NullCheckEvent(c, object));
+}
+
+void appendColdCall(Context* c,
+                    CodePromise* start,
+                    CodePromise* hotReturn,
+                    intptr_t handler)
+{
+  ColdCall* call = new (c->zone) ColdCall(start, hotReturn, handler);
+
+  if (c->firstColdCall) {
+    c->lastColdCall->next = call;
+  } else {
+    c->firstColdCall = call;
+  }
+  c->lastColdCall = call;
+  ++c->coldCallCount;
+}
+
+void compileColdCalls(Context* c)
+{
+  if (c->coldCallCount == 0) {
+    return;
+  }
+
+  Assembler* a = c->assembler;
+
+  c->coldCallTable = static_cast<ColdCall**>(
+      c->zone->allocate(c->coldCallCount * sizeof(ColdCall*)));
+
+  unsigned i = 0;
+  for (ColdCall* call = c->firstColdCall; call; call = call->next) {
+    c->coldCallTable[i++] = call;
+    call->start->offset = a->offset();
+
+    lir::Constant handlerConstant(resolvedPromise(c, call->handler));
+    a->apply(lir::Call,
+             OperandInfo(c->targetInfo.pointerSize,
+                         lir::Operand::Type::Constant,
+                         &handlerConstant));
+
+    call->end = compiler::codePromise(c, a->offset());
+
+    // the handler never returns, but the stack walker will look at
+    // the instruction following the call, so make sure it's one to
+    // which no meaning is attached
+    a->apply(lir::Trap);
+
+    a->endEvent();
+  }
+}
+
 class FrameSiteEvent : public Event {
  public:
   FrameSiteEvent(Context* c, Value* value, int index)
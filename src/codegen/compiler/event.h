@@ -88,6 +88,9 @@ class Event {
   Block* block;
   LogicalInstruction* logicalInstruction;
   unsigned readCount;
+  // position in the order events are appended, which is the order
+  // they're compiled in
+  unsigned sequence;
 };
 
 void finishAddRead(Context* c, Value* v, Read* r);
@@ -199,6 +202,34 @@ void appendBoundsCheck(Context* c,
                        Value* index,
                        intptr_t handler);
 
+void appendNullCheck(Context* c, Value* object);
+
+// A call made only when a check fails, which is compiled after the
+// rest of the method rather than in line with the code which runs.
+class ColdCall {
+ public:
+  ColdCall(CodePromise* start, CodePromise* hotReturn, intptr_t handler)
+      : start(start), end(0), hotReturn(hotReturn), handler(handler), next(0)
+  {
+  }
+
+  // where the failed check jumps to
+  CodePromise* start;
+  // the return address of the call
+  CodePromise* end;
+  // where the call would have returned to had it been made in line
+  CodePromise* hotReturn;
+  intptr_t handler;
+  ColdCall* next;
+};
+
+void appendColdCall(Context* c,
+                    CodePromise* start,
+                    CodePromise* hotReturn,
+                    intptr_t handler);
+
+void compileColdCalls(Context* c);
+
 void appendFrameSite(Context* c, Value* value, int index);
 
 void appendSaveLocals(Context* c);
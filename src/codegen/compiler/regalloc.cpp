@@ -15,6 +15,7 @@
 #include "codegen/compiler/site.h"
 #include "codegen/compiler/resource.h"
 #include "codegen/compiler/read.h"
+#include "codegen/compiler/event.h"
 
 namespace avian {
 namespace codegen {
@@ -56,6 +57,22 @@ unsigned resourceCost(Context* c,
   }
 }
 
+// Returns the position in the event sequence at which the value in
+// register i is next read, or the end of the sequence if the register
+// is free.  When every candidate register would have to be taken from
+// another value, the one needed furthest in the future is preferred,
+// as a linear-scan allocator spills the interval which ends last.
+unsigned nextUse(Context* c, Register i)
+{
+  Value* v = c->registerResources[i.index()].value;
+  if (v == 0) {
+    return ~0u;
+  }
+
+  Read* r = live(c, v);
+  return r and r->event ? r->event->sequence : 0;
+}
+
 bool pickRegisterTarget(Context* c,
                         Register i,
                         Value* v,
@@ -77,7 +94,9 @@ bool pickRegisterTarget(Context* c,
     if (mask.containsExactly(i)) {
       *cost = myCost;
       return true;
-    } else if (myCost < *cost) {
+    } else if (myCost < *cost
+               or (myCost == *cost and myCost < Target::Impossible
+                   and nextUse(c, i) > nextUse(c, *target))) {
       *cost = myCost;
       *target = i;
     }
@@ -224,6 +224,34 @@ int64_t absoluteInt(int32_t a)
   return a > 0 ? a : -a;
 }
 
+int64_t popCountLong(uint64_t a)
+{
+  int64_t count = 0;
+  for (; a; a &= a - 1) {
+    ++count;
+  }
+  return count;
+}
+
+int64_t popCountInt(uint32_t a)
+{
+  return popCountLong(a);
+}
+
+int64_t countLeadingZerosLong(uint64_t a)
+{
+  int64_t count = 64;
+  for (; a; a >>= 1) {
+    --count;
+  }
+  return count;
+}
+
+int64_t countLeadingZerosInt(uint32_t a)
+{
+  return countLeadingZerosLong(a) - 32;
+}
+
 uint64_t floatToDouble(int32_t a)
 {
   return vm::doubleToBits(static_cast<double>(vm::bitsToFloat(a)));
@@ -441,6 +441,8 @@ class MyArchitecture : public Architecture {
       break;
 
     case lir::Absolute:
+    case lir::PopCount:
+    case lir::CountLeadingZeros:
       *thunk = true;
       break;
 
@@ -173,6 +173,14 @@ uint32_t add(Register Rd, Register Rn, Register Rm, unsigned size)
          | (Rn.index() << 5) | Rd.index();
 }
 
+// add Rd, Rn|SP, Rm, lsl #shift (the extended register form, which,
+// unlike the shifted register form, allows SP as the base)
+uint32_t addx(Register Rd, Register Rn, Register Rm, int shift)
+{
+  return 0x8b206000 | (Rm.index() << 16) | (shift << 10) | (Rn.index() << 5)
+         | Rd.index();
+}
+
 uint32_t sub(Register Rd, Register Rn, Register Rm, unsigned size)
 {
   return (size == 8 ? 0xcb000000 : 0x4b000000) | (Rm.index() << 16)
@@ -277,6 +285,10 @@ uint32_t scvtfSdWn(Register Fd, Register Rn)
   return 0x1e220000 | (Rn.index() << 5) | Fd.index();
 }
 
+// set on a register offset load or store to shift the index left by
+// the log of the access size
+const uint32_t ScaledIndex = 0x1000;
+
 uint32_t strFs(Register Fs, Register Rn, Register Rm, unsigned size)
 {
   return (size == 8 ? 0xfc206800 : 0xbc206800) | (Rm.index() << 16)
@@ -875,70 +887,6 @@ void floatDivideR(Context* c,
   append(c, fdiv(fpr(dst), fpr(b), fpr(a), size));
 }
 
-Register normalize(Context* c,
-                   int offset,
-                   Register index,
-                   unsigned scale,
-                   bool* preserveIndex,
-                   bool* release)
-{
-  if (offset != 0 or scale != 1) {
-    lir::RegisterPair normalizedIndex(
-        *preserveIndex ? c->client->acquireTemporary(GPR_MASK) : index);
-
-    if (*preserveIndex) {
-      *release = true;
-      *preserveIndex = false;
-    } else {
-      *release = false;
-    }
-
-    Register scaled;
-
-    if (scale != 1) {
-      lir::RegisterPair unscaledIndex(index);
-
-      ResolvedPromise scalePromise(log(scale));
-      lir::Constant scaleConstant(&scalePromise);
-
-      shiftLeftC(c,
-                 vm::TargetBytesPerWord,
-                 &scaleConstant,
-                 &unscaledIndex,
-                 &normalizedIndex);
-
-      scaled = normalizedIndex.low;
-    } else {
-      scaled = index;
-    }
-
-    if (offset != 0) {
-      lir::RegisterPair untranslatedIndex(scaled);
-
-      ResolvedPromise offsetPromise(offset);
-      lir::Constant offsetConstant(&offsetPromise);
-
-      lir::RegisterPair tmp(c->client->acquireTemporary(GPR_MASK));
-      moveCR(c,
-             vm::TargetBytesPerWord,
-             &offsetConstant,
-             vm::TargetBytesPerWord,
-             &tmp);
-      addR(c,
-           vm::TargetBytesPerWord,
-           &tmp,
-           &untranslatedIndex,
-           &normalizedIndex);
-      c->client->releaseTemporary(tmp.low);
-    }
-
-    return normalizedIndex.low;
-  } else {
-    *release = false;
-    return index;
-  }
-}
-
 void store(Context* c,
            unsigned size,
            lir::RegisterPair* src,
@@ -946,24 +894,26 @@ void store(Context* c,
            int offset,
            Register index,
            unsigned scale,
-           bool preserveIndex)
+           bool preserveIndex UNUSED)
 {
-  if (index != NoRegister) {
-    bool release;
+  if (index != NoRegister
+      and (offset != 0 or (scale != 1 and scale != size))) {
+    // fold the scaled index into the base and let the store encode the
+    // offset
+    lir::RegisterPair tmp(c->client->acquireTemporary(GPR_MASK));
+    append(c, addx(tmp.low, base, index, log(scale)));
 
-    // todo: browsing the instruction set, it looks like we could do a
-    // scaled store or load in a single instruction if the offset is
-    // zero, and we could simplify things for the case of non-zero
-    // offsets also
+    store(c, size, src, tmp.low, offset, NoRegister, 1, false);
 
-    Register normalized
-        = normalize(c, offset, index, scale, &preserveIndex, &release);
+    c->client->releaseTemporary(tmp.low);
+  } else if (index != NoRegister) {
+    uint32_t shift = (scale == 1 ? 0 : ScaledIndex);
 
     if (isFpr(src)) {
       switch (size) {
       case 4:
       case 8:
-        append(c, strFs(fpr(src->low), base, normalized, size));
+        append(c, strFs(fpr(src->low), base, index, size) | shift);
         break;
 
       default:
@@ -972,26 +922,22 @@ void store(Context* c,
     } else {
       switch (size) {
       case 1:
-        append(c, strb(src->low, base, normalized));
+        append(c, strb(src->low, base, index));
         break;
 
       case 2:
-        append(c, strh(src->low, base, normalized));
+        append(c, strh(src->low, base, index) | shift);
         break;
 
       case 4:
       case 8:
-        append(c, str(src->low, base, normalized, size));
+        append(c, str(src->low, base, index, size) | shift);
         break;
 
       default:
         abort(c);
       }
     }
-
-    if (release) {
-      c->client->releaseTemporary(normalized);
-    }
   } else if (abs(offset) == (abs(offset) & 0xFFF)) {
     if (isFpr(src)) {
       switch (size) {
@@ -1078,19 +1024,28 @@ void load(Context* c,
           unsigned scale,
           unsigned dstSize,
           lir::RegisterPair* dst,
-          bool preserveIndex,
+          bool preserveIndex UNUSED,
           bool signExtend)
 {
-  if (index != NoRegister) {
-    bool release;
-    Register normalized
-        = normalize(c, offset, index, scale, &preserveIndex, &release);
+  if (index != NoRegister
+      and (offset != 0 or (scale != 1 and scale != srcSize))) {
+    // fold the scaled index into the base and let the load encode the
+    // offset
+    lir::RegisterPair tmp(c->client->acquireTemporary(GPR_MASK));
+    append(c, addx(tmp.low, base, index, log(scale)));
+
+    load(c, srcSize, tmp.low, offset, NoRegister, 1, dstSize, dst, false,
+         signExtend);
+
+    c->client->releaseTemporary(tmp.low);
+  } else if (index != NoRegister) {
+    uint32_t shift = (scale == 1 ? 0 : ScaledIndex);
 
     if (isFpr(dst)) {  // FPR load
       switch (srcSize) {
       case 4:
       case 8:
-        append(c, ldrFd(fpr(dst->low), base, normalized, srcSize));
+        append(c, ldrFd(fpr(dst->low), base, index, srcSize) | shift);
         break;
 
       default:
@@ -1100,26 +1055,26 @@ void load(Context* c,
       switch (srcSize) {
       case 1:
         if (signExtend) {
-          append(c, ldrsb(dst->low, base, normalized));
+          append(c, ldrsb(dst->low, base, index));
         } else {
-          append(c, ldrb(dst->low, base, normalized));
+          append(c, ldrb(dst->low, base, index));
         }
         break;
 
       case 2:
         if (signExtend) {
-          append(c, ldrsh(dst->low, base, normalized));
+          append(c, ldrsh(dst->low, base, index) | shift);
         } else {
-          append(c, ldrh(dst->low, base, normalized));
+          append(c, ldrh(dst->low, base, index) | shift);
         }
         break;
 
       case 4:
       case 8:
         if (signExtend and srcSize == 4 and dstSize == 8) {
-          append(c, ldrsw(dst->low, base, normalized));
+          append(c, ldrsw(dst->low, base, index) | shift);
         } else {
-          append(c, ldr(dst->low, base, normalized, srcSize));
+          append(c, ldr(dst->low, base, index, srcSize) | shift);
         }
         break;
 
@@ -1127,10 +1082,6 @@ void load(Context* c,
         abort(c);
       }
     }
-
-    if (release) {
-      c->client->releaseTemporary(normalized);
-    }
   } else if (abs(offset) == (abs(offset) & 0xFFF)) {
     if (isFpr(dst)) {
       switch (srcSize) {
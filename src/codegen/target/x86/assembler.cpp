@@ -470,6 +470,8 @@ class MyArchitecture : public Architecture {
     case lir::FloatAbsolute:
     case lir::FloatNegate:
     case lir::FloatSquareRoot:
+    case lir::PopCount:
+    case lir::CountLeadingZeros:
       return false;
 
     case lir::Negate:
@@ -531,6 +533,22 @@ class MyArchitecture : public Architecture {
       }
       break;
 
+    case lir::PopCount:
+      if (usePopcnt(&c) and aSize <= TargetBytesPerWord) {
+        aMask.typeMask = lir::Operand::RegisterPairMask;
+      } else {
+        *thunk = true;
+      }
+      break;
+
+    case lir::CountLeadingZeros:
+      if (useLzcnt(&c) and aSize <= TargetBytesPerWord) {
+        aMask.typeMask = lir::Operand::RegisterPairMask;
+      } else {
+        *thunk = true;
+      }
+      break;
+
     case lir::FloatAbsolute:
       if (useSSE(&c)) {
         aMask.typeMask = lir::Operand::RegisterPairMask;
@@ -655,6 +673,8 @@ class MyArchitecture : public Architecture {
       break;
 
     case lir::Float2Int:
+    case lir::PopCount:
+    case lir::CountLeadingZeros:
       bMask.typeMask = lir::Operand::RegisterPairMask;
       break;
 
@@ -1178,7 +1198,7 @@ class MyAssembler : public Assembler {
     uint8_t* dst = c.result;
     for (MyBlock* b = c.firstBlock; b; b = b->next) {
       unsigned index = 0;
-      unsigned padding = 0;
+      int padding = 0;
       for (AlignmentPadding* p = b->firstPadding; p; p = p->next) {
         unsigned size = p->offset - b->offset - index;
 
@@ -1188,10 +1208,19 @@ class MyAssembler : public Assembler {
 
         index += size;
 
-        while ((b->start + index + padding + p->instructionOffset)
-               % p->alignment) {
-          *(dst + b->start + index + padding) = 0x90;
-          ++padding;
+        if (p->target) {
+          if (p->shortened) {
+            // the displacement is filled in by the branch's task
+            *(dst + b->start + index + padding) = p->shortOpcode;
+            index += p->size;
+            padding -= p->size - ShortBranchSize;
+          }
+        } else {
+          while ((b->start + index + padding + p->instructionOffset)
+                 % p->alignment) {
+            *(dst + b->start + index + padding) = 0x90;
+            ++padding;
+          }
         }
       }
 
@@ -9,6 +9,7 @@
    details. */
 
 #include "block.h"
+#include "padding.h"
 
 #include <avian/codegen/assembler.h>
 
@@ -16,11 +17,6 @@ namespace avian {
 namespace codegen {
 namespace x86 {
 
-unsigned padding(AlignmentPadding* p,
-                 unsigned index,
-                 unsigned offset,
-                 AlignmentPadding* limit);
-
 MyBlock::MyBlock(unsigned offset)
     : next(0),
       firstPadding(0),
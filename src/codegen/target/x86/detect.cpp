@@ -40,9 +40,15 @@ static int __get_cpuid(unsigned int __level,
 }
 #define bit_SSE (1 << 25)
 #define bit_SSE2 (1 << 26)
+#define bit_POPCNT (1 << 23)
 
 #endif  // ndef _MSC_VER
 
+#ifndef bit_LZCNT
+// older versions of cpuid.h call this bit_ABM
+#define bit_LZCNT (1 << 5)
+#endif
+
 #endif  // ndef __arm__
 
 namespace avian {
@@ -78,6 +84,62 @@ bool useSSE(ArchitectureContext* c)
 #endif
 }
 
+#ifndef __arm__
+namespace {
+
+// returns the ecx feature bits of the specified cpuid leaf, or zero
+// if the processor does not support that leaf
+unsigned featureBits(unsigned level)
+{
+  unsigned eax;
+  unsigned ebx;
+  unsigned ecx;
+  unsigned edx;
+  return __get_cpuid(level, &eax, &ebx, &ecx, &edx) ? ecx : 0;
+}
+
+}  // namespace
+#endif
+
+// Unlike SSE2, these are not implied by amd64, so we only use them
+// when generating code for the processor we're running on (i.e. never
+// for a boot image).
+bool usePopcnt(ArchitectureContext* c UNUSED)
+{
+#ifdef __arm__
+  return false;
+#else
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      supported = (featureBits(1) & bit_POPCNT) != 0;
+    }
+    return supported;
+  } else {
+    return false;
+  }
+#endif
+}
+
+bool useLzcnt(ArchitectureContext* c UNUSED)
+{
+#ifdef __arm__
+  return false;
+#else
+  if (c->useNativeFeatures) {
+    static int supported = -1;
+    if (supported == -1) {
+      // processors without lzcnt execute it as bsr, so we must not
+      // guess
+      supported = (featureBits(0x80000001) & bit_LZCNT) != 0;
+    }
+    return supported;
+  } else {
+    return false;
+  }
+#endif
+}
+
 }  // namespace x86
 }  // namespace codegen
 }  // namespace avian
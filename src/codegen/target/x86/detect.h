@@ -21,6 +21,10 @@ class ArchitectureContext;
 
 bool useSSE(ArchitectureContext* c);
 
+bool usePopcnt(ArchitectureContext* c);
+
+bool useLzcnt(ArchitectureContext* c);
+
 }  // namespace x86
 }  // namespace codegen
 }  // namespace avian
@@ -21,6 +21,7 @@
 #include "encode.h"
 #include "registers.h"
 #include "fixup.h"
+#include "padding.h"
 
 using namespace avian::util;
 
@@ -167,7 +168,7 @@ void unconditional(Context* c, unsigned jump, lir::Constant* a)
   c->code.append4(0);
 }
 
-void conditional(Context* c, unsigned condition, lir::Constant* a)
+void fixedConditional(Context* c, unsigned condition, lir::Constant* a)
 {
   appendOffsetTask(c, a->value, offsetPromise(c), 6);
 
@@ -175,6 +176,30 @@ void conditional(Context* c, unsigned condition, lir::Constant* a)
   c->code.append4(0);
 }
 
+void conditional(Context* c, unsigned condition, lir::Constant* a)
+{
+  // the offset of the instruction is taken before the branch is
+  // recorded, so that it doesn't include the branch's own shortening
+  Promise* instruction = offsetPromise(c);
+  AlignmentPadding* branch
+      = new (c->zone) AlignmentPadding(c, a->value, 6, condition - 0x10);
+  appendBranchTask(c, a->value, instruction, branch);
+
+  opcode(c, 0x0f, condition);
+  c->code.append4(0);
+}
+
+void jump(Context* c, lir::Constant* a)
+{
+  Promise* instruction = offsetPromise(c);
+  AlignmentPadding* branch
+      = new (c->zone) AlignmentPadding(c, a->value, 5, 0xeb);
+  appendBranchTask(c, a->value, instruction, branch);
+
+  opcode(c, 0xe9);
+  c->code.append4(0);
+}
+
 void sseMoveRR(Context* c,
                unsigned aSize,
                lir::RegisterPair* a,
@@ -302,7 +327,7 @@ void branchFloat(Context* c, lir::TernaryOperation op, lir::Constant* target)
     // jp past the je so we don't jump to the target if unordered:
     c->code.append(0x7a);
     c->code.append(6);
-    conditional(c, 0x84, target);
+    fixedConditional(c, 0x84, target);
     break;
 
   case lir::JumpIfFloatNotEqual:
@@ -75,8 +75,15 @@ void opcode(Context* c, uint8_t op1, uint8_t op2);
 
 void unconditional(Context* c, unsigned jump, lir::Constant* a);
 
+// A jump or conditional branch is shortened if its target turns out
+// to be close enough, so code which skips over one by a fixed number
+// of bytes uses fixedConditional or unconditional instead.
 void conditional(Context* c, unsigned condition, lir::Constant* a);
 
+void fixedConditional(Context* c, unsigned condition, lir::Constant* a);
+
+void jump(Context* c, lir::Constant* a);
+
 void sseMoveRR(Context* c,
                unsigned aSize,
                lir::RegisterPair* a,
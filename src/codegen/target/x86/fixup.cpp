@@ -44,7 +44,10 @@ OffsetPromise::OffsetPromise(Context* c,
 
 bool OffsetPromise::resolved()
 {
-  return block->start != static_cast<unsigned>(~0);
+  // while the block is being laid out, an offset is known only once
+  // everything before it which may move it has been placed
+  return block->start != static_cast<unsigned>(~0)
+         and (limit == 0 or limit->resolved);
 }
 
 int64_t OffsetPromise::value()
@@ -129,6 +132,37 @@ void appendOffsetTask(Context* c,
   c->tasks = task;
 }
 
+BranchTask::BranchTask(Task* next,
+                       Promise* promise,
+                       Promise* instructionOffset,
+                       AlignmentPadding* branch)
+    : OffsetTask(next, promise, instructionOffset, branch->size),
+      branch(branch)
+{
+}
+
+void BranchTask::run(Context* c)
+{
+  if (branch->shortened) {
+    uint8_t* instruction = c->result + instructionOffset->value();
+    intptr_t v = reinterpret_cast<uint8_t*>(promise->value()) - instruction
+                 - ShortBranchSize;
+    expect(c->s, vm::fitsInInt8(v));
+    instruction[1] = v;
+  } else {
+    OffsetTask::run(c);
+  }
+}
+
+void appendBranchTask(Context* c,
+                      Promise* promise,
+                      Promise* instructionOffset,
+                      AlignmentPadding* branch)
+{
+  c->tasks = new (c->zone)
+      BranchTask(c->tasks, promise, instructionOffset, branch);
+}
+
 ImmediateListener::ImmediateListener(vm::System* s,
                                      void* dst,
                                      unsigned size,
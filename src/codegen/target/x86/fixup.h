@@ -95,6 +95,25 @@ void appendOffsetTask(Context* c,
                       Promise* instructionOffset,
                       unsigned instructionSize);
 
+// Fills in a branch which may have been shortened when its block was
+// laid out.
+class BranchTask : public OffsetTask {
+ public:
+  BranchTask(Task* next,
+             Promise* promise,
+             Promise* instructionOffset,
+             AlignmentPadding* branch);
+
+  virtual void run(Context* c);
+
+  AlignmentPadding* branch;
+};
+
+void appendBranchTask(Context* c,
+                      Promise* promise,
+                      Promise* instructionOffset,
+                      AlignmentPadding* branch);
+
 class ImmediateListener : public Promise::Listener {
  public:
   ImmediateListener(vm::System* s, void* dst, unsigned size, unsigned offset);
@@ -98,7 +98,7 @@ void jumpC(Context* c, unsigned size UNUSED, lir::Constant* a)
 {
   assertT(c, size == vm::TargetBytesPerWord);
 
-  unconditional(c, 0xe9, a);
+  jump(c, a);
 }
 
 void jumpM(Context* c, unsigned size UNUSED, lir::Memory* a)
@@ -119,7 +119,8 @@ void longJumpC(Context* c, unsigned size, lir::Constant* a)
     moveCR2(c, size, a, size, &r, 11);
     jumpR(c, size, &r);
   } else {
-    jumpC(c, size, a);
+    // may be patched by updateCall, so it has to stay the long form
+    unconditional(c, 0xe9, a);
   }
 }
 
@@ -159,10 +160,13 @@ void alignedLongCallC(Context* c, unsigned size, lir::Constant* a)
   }
 }
 
-void alignedJumpC(Context* c, unsigned size, lir::Constant* a)
+void alignedJumpC(Context* c, unsigned size UNUSED, lir::Constant* a)
 {
+  assertT(c, size == vm::TargetBytesPerWord);
+
+  // patched by updateCall, so it has to stay the long form
   new (c->zone) AlignmentPadding(c, 1, 4);
-  jumpC(c, size, a);
+  unconditional(c, 0xe9, a);
 }
 
 void alignedLongJumpC(Context* c, unsigned size, lir::Constant* a)
@@ -1125,7 +1129,7 @@ void branchLong(Context* c,
     c->code.append(0);
 
     compare(c, 4, al, 4, bl);
-    conditional(c, 0x84, target);  // je
+    fixedConditional(c, 0x84, target);  // je
     break;
 
   case lir::JumpIfNotEqual:
@@ -1143,7 +1147,7 @@ void branchLong(Context* c,
     c->code.append(0);
 
     compare(c, 4, al, 4, bl);
-    conditional(c, 0x82, target);  // jb
+    fixedConditional(c, 0x82, target);  // jb
     break;
 
   case lir::JumpIfGreater:
@@ -1154,7 +1158,7 @@ void branchLong(Context* c,
     c->code.append(0);
 
     compare(c, 4, al, 4, bl);
-    conditional(c, 0x87, target);  // ja
+    fixedConditional(c, 0x87, target);  // ja
     break;
 
   case lir::JumpIfLessOrEqual:
@@ -1165,7 +1169,7 @@ void branchLong(Context* c,
     c->code.append(0);
 
     compare(c, 4, al, 4, bl);
-    conditional(c, 0x86, target);  // jbe
+    fixedConditional(c, 0x86, target);  // jbe
     break;
 
   case lir::JumpIfGreaterOrEqual:
@@ -1176,7 +1180,7 @@ void branchLong(Context* c,
     c->code.append(0);
 
     compare(c, 4, al, 4, bl);
-    conditional(c, 0x83, target);  // jae
+    fixedConditional(c, 0x83, target);  // jae
     break;
 
   default:
@@ -1754,6 +1758,32 @@ void absoluteRR(Context* c,
   c->client->releaseTemporary(rdx);
 }
 
+void popCountRR(Context* c,
+                unsigned aSize,
+                lir::RegisterPair* a,
+                unsigned bSize UNUSED,
+                lir::RegisterPair* b)
+{
+  assertT(c, aSize == bSize and aSize <= vm::TargetBytesPerWord);
+  opcode(c, 0xf3);
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xb8);
+  modrm(c, 0xc0, a, b);
+}
+
+void countLeadingZerosRR(Context* c,
+                         unsigned aSize,
+                         lir::RegisterPair* a,
+                         unsigned bSize UNUSED,
+                         lir::RegisterPair* b)
+{
+  assertT(c, aSize == bSize and aSize <= vm::TargetBytesPerWord);
+  opcode(c, 0xf3);
+  maybeRex(c, aSize, b, a);
+  opcode(c, 0x0f, 0xbd);
+  modrm(c, 0xc0, a, b);
+}
+
 }  // namespace x86
 }  // namespace codegen
 }  // namespace avian
@@ -452,6 +452,18 @@ void absoluteRR(Context* c,
                 unsigned bSize UNUSED,
                 lir::RegisterPair* b UNUSED);
 
+void popCountRR(Context* c,
+                unsigned aSize,
+                lir::RegisterPair* a,
+                unsigned bSize,
+                lir::RegisterPair* b);
+
+void countLeadingZerosRR(Context* c,
+                         unsigned aSize,
+                         lir::RegisterPair* a,
+                         unsigned bSize,
+                         lir::RegisterPair* b);
+
 }  // namespace x86
 }  // namespace codegen
 }  // namespace avian
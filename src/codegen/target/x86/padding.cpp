@@ -10,6 +10,8 @@
 
 #include "avian/alloc-vector.h"
 
+#include <avian/codegen/promise.h>
+
 #include "context.h"
 #include "padding.h"
 #include "block.h"
@@ -18,51 +20,112 @@ namespace avian {
 namespace codegen {
 namespace x86 {
 
+void appendPadding(Context* c, AlignmentPadding* p)
+{
+  if (c->lastBlock->firstPadding) {
+    c->lastBlock->lastPadding->next = p;
+  } else {
+    c->lastBlock->firstPadding = p;
+  }
+  c->lastBlock->lastPadding = p;
+}
+
 AlignmentPadding::AlignmentPadding(Context* c,
                                    unsigned instructionOffset,
                                    unsigned alignment)
-    : offset(c->code.length()),
+    : c(c),
+      offset(c->code.length()),
       instructionOffset(instructionOffset),
       alignment(alignment),
+      target(0),
+      size(0),
+      shortOpcode(0),
+      shortened(false),
+      resolved(false),
       next(0),
-      padding(-1)
+      padding(0)
 {
-  if (c->lastBlock->firstPadding) {
-    c->lastBlock->lastPadding->next = this;
-  } else {
-    c->lastBlock->firstPadding = this;
+  appendPadding(c, this);
+}
+
+AlignmentPadding::AlignmentPadding(Context* c,
+                                   Promise* target,
+                                   unsigned size,
+                                   uint8_t shortOpcode)
+    : c(c),
+      offset(c->code.length()),
+      instructionOffset(0),
+      alignment(0),
+      target(target),
+      size(size),
+      shortOpcode(shortOpcode),
+      shortened(false),
+      resolved(false),
+      next(0),
+      padding(0)
+{
+  appendPadding(c, this);
+}
+
+// We only shorten a branch back to code in the same method which has
+// already been laid out, since the distance to it is then known for
+// certain.  Anything further on has yet to be placed and may be moved
+// by the branches and padding in between.
+bool shortenBranch(AlignmentPadding* p,
+                   unsigned start,
+                   unsigned index,
+                   int padding)
+{
+  uint8_t* code = p->c->result;
+  if (code == 0 or not p->target->resolved()) {
+    return false;
   }
-  c->lastBlock->lastPadding = this;
+
+  intptr_t instruction = reinterpret_cast<intptr_t>(code) + start + index
+                         + padding;
+  intptr_t target = p->target->value();
+
+  return target >= reinterpret_cast<intptr_t>(code) and target <= instruction
+         and vm::fitsInInt8(target - (instruction + ShortBranchSize));
 }
 
-unsigned padding(AlignmentPadding* p,
-                 unsigned start,
-                 unsigned offset,
-                 AlignmentPadding* limit)
+int padding(AlignmentPadding* p,
+            unsigned start,
+            unsigned offset,
+            AlignmentPadding* limit)
 {
-  unsigned padding = 0;
+  int padding = 0;
   if (limit) {
-    if (limit->padding == -1) {
+    if (not limit->resolved) {
       for (; p; p = p->next) {
-        if (p->padding == -1) {
+        if (not p->resolved) {
           unsigned index = p->offset - offset;
-          while ((start + index + padding + p->instructionOffset)
-                 % p->alignment) {
-            ++padding;
+          if (p->target) {
+            p->shortened = shortenBranch(p, start, index, padding);
+            if (p->shortened) {
+              padding -= p->size - ShortBranchSize;
+            }
+          } else {
+            while ((start + index + padding + p->instructionOffset)
+                   % p->alignment) {
+              ++padding;
+            }
           }
 
           p->padding = padding;
-
-          if (p == limit)
-            break;
+          p->resolved = true;
         } else {
           padding = p->padding;
         }
+
+        if (p == limit)
+          break;
       }
     } else {
       padding = limit->padding;
     }
   }
+
   return padding;
 }
 
@@ -11,27 +11,48 @@
 #ifndef AVIAN_CODEGEN_ASSEMBLER_X86_PADDING_H
 #define AVIAN_CODEGEN_ASSEMBLER_X86_PADDING_H
 
+#include <stdint.h>
+
 namespace avian {
 namespace codegen {
+
+class Promise;
+
 namespace x86 {
 
 class Context;
 
+// Something which moves the code after it once the block it's in is
+// laid out: either padding to align an instruction, or a branch which
+// is shortened to two bytes if its target turns out to be close by.
 class AlignmentPadding {
  public:
   AlignmentPadding(Context* c, unsigned instructionOffset, unsigned alignment);
 
+  AlignmentPadding(Context* c,
+                   Promise* target,
+                   unsigned size,
+                   uint8_t shortOpcode);
+
+  Context* c;
   unsigned offset;
   unsigned instructionOffset;
   unsigned alignment;
+  Promise* target;
+  unsigned size;
+  uint8_t shortOpcode;
+  bool shortened;
+  bool resolved;
   AlignmentPadding* next;
   int padding;
 };
 
-unsigned padding(AlignmentPadding* p,
-                 unsigned start,
-                 unsigned offset,
-                 AlignmentPadding* limit);
+const unsigned ShortBranchSize = 2;
+
+int padding(AlignmentPadding* p,
+            unsigned start,
+            unsigned offset,
+            AlignmentPadding* limit);
 
 }  // namespace x86
 }  // namespace codegen
@@ -9,6 +9,7 @@
    details. */
 
 #include "avian/machine.h"
+#include "avian/jnienv.h"
 #include "avian/util.h"
 #include "avian/alloc-vector.h"
 #include "avian/process.h"
@@ -67,7 +68,18 @@ const bool DebugInstructions = false;
 #ifndef AVIAN_AOT_ONLY
 const bool DebugFrameMaps = false;
 const bool CheckArrayBounds = true;
-const unsigned ExecutableAreaSizeInBytes = 30 * 1024 * 1024;
+
+// default amount of address space to reserve for compiled code, which
+// is committed to on demand, one segment at a time
+const unsigned DefaultCodeCacheSizeInBytes = 256 * 1024 * 1024;
+const unsigned CodeSegmentSizeInBytes = 1024 * 1024;
+
+// maximum length in bytes of a method body which may be inlined at a
+// statically-bound call site
+const unsigned InlineBytecodeLimit = 24;
+
+// maximum number of methods waiting for a background compiler thread
+const unsigned MaxCompileQueueLength = 1024;
 #endif
 
 #ifdef AVIAN_CONTINUATIONS
@@ -76,10 +88,34 @@ const bool Continuations = true;
 const bool Continuations = false;
 #endif
 
-const unsigned MaxNativeCallFootprint = TargetBytesPerWord == 8 ? 4 : 5;
+const unsigned MaxNativeCallFootprint = 5;
 
 const unsigned InitialZoneCapacityInBytes = 64 * 1024;
 
+// a thread carves its local references out of slabs of this many,
+// which it keeps, along with any references it has released, until it
+// exits:
+const unsigned ReferenceSlabSize = 64;
+
+// how many of a thread's most recent local references we search for
+// one to the same object before making a new one:
+const unsigned LocalReferenceSearchLimit = 8;
+
+// entries in each thread's cache of the methods containing recently
+// queried code addresses (see methodForIp); must be a power of two:
+const unsigned IpCacheSize = 64;
+
+// ranges a new code index has room for (see CodeIndex):
+const unsigned InitialCodeIndexCapacity = 256;
+
+// a lookupswitch with at most this many keys is compiled to a
+// sequence of comparisons, and a larger one whose keys span no more
+// than MaxLookupSwitchSpread times as many values as it has keys is
+// compiled to a jump table, like a tableswitch.  Anything else calls
+// lookUpAddress to search its keys.
+const unsigned MaxInlineLookupSwitchKeys = 8;
+const unsigned MaxLookupSwitchSpread = 3;
+
 enum ThunkIndex {
   compileMethodIndex,
   compileVirtualMethodIndex,
@@ -108,6 +144,12 @@ void* getIp(MyThread*);
 
 class MyThread : public Thread {
  public:
+  class IpCacheEntry {
+   public:
+    void* ip;
+    GcMethod* method;
+  };
+
   class CallTrace {
    public:
     CallTrace(MyThread* t, GcMethod* method)
@@ -278,9 +320,16 @@ class MyThread : public Thread {
         traceContext(0),
         stackLimit(0),
         referenceFrame(0),
-        methodLockIsClean(true)
+        spareReferences(0),
+        referenceSlabs(0),
+        spareReferenceFrames(0),
+        methodLockIsClean(true),
+        backgroundCompiler(false),
+        ipCacheVersion(0)
   {
     arch->acquire();
+
+    memset(ipCache, 0, sizeof(ipCache));
   }
 
   void* ip;
@@ -305,9 +354,67 @@ class MyThread : public Thread {
   TraceContext* traceContext;
   uintptr_t stackLimit;
   List<Reference*>* referenceFrame;
+  Reference* spareReferences;
+  void* referenceSlabs;
+  List<Reference*>* spareReferenceFrames;
   bool methodLockIsClean;
+  bool backgroundCompiler;
+  IpCacheEntry ipCache[IpCacheSize];
+  unsigned ipCacheVersion;
 };
 
+Reference* makeReference(MyThread* t, object o)
+{
+  if (t->spareReferences == 0) {
+    uint8_t* slab = static_cast<uint8_t*>(t->m->heap->allocate(
+        sizeof(void*) + (ReferenceSlabSize * sizeof(Reference))));
+
+    *reinterpret_cast<void**>(slab) = t->referenceSlabs;
+    t->referenceSlabs = slab;
+
+    Reference* slots = reinterpret_cast<Reference*>(slab + sizeof(void*));
+    for (unsigned i = 0; i < ReferenceSlabSize; ++i) {
+      slots[i].next = t->spareReferences;
+      t->spareReferences = slots + i;
+    }
+  }
+
+  Reference* r = t->spareReferences;
+  t->spareReferences = r->next;
+
+  return new (r) Reference(o, &(t->reference), false);
+}
+
+void recycle(MyThread* t, Reference* r)
+{
+  *(r->handle) = r->next;
+  if (r->next) {
+    r->next->handle = r->handle;
+  }
+
+  r->next = t->spareReferences;
+  t->spareReferences = r;
+}
+
+void disposeReferences(MyThread* t)
+{
+  t->reference = 0;
+  t->spareReferences = 0;
+
+  while (t->referenceSlabs) {
+    void* slab = t->referenceSlabs;
+    t->referenceSlabs = *static_cast<void**>(slab);
+    t->m->heap->free(slab,
+                     sizeof(void*) + (ReferenceSlabSize * sizeof(Reference)));
+  }
+
+  while (t->spareReferenceFrames) {
+    List<Reference*>* f = t->spareReferenceFrames;
+    t->spareReferenceFrames = f->next;
+    t->m->heap->free(f, sizeof(List<Reference*>));
+  }
+}
+
 void transition(MyThread* t,
                 void* ip,
                 void* stack,
@@ -400,6 +507,86 @@ intptr_t compareIpToMethodBounds(Thread* t, intptr_t ip, object om)
   }
 }
 
+// The bounds of a method's compiled code.
+class CodeRange {
+ public:
+  uintptr_t start;
+  uintptr_t end;
+  GcMethod* method;
+};
+
+// An off-heap array of the ranges of compiled code, sorted by address,
+// which methodForIp searches without locking, and so may search from a
+// signal handler.  It is only changed with the class lock held, and
+// only in ways a reader can't see half done: a range which follows all
+// the others is written into spare capacity before the count is raised
+// to include it, and any other change builds a new index and publishes
+// it with a single store.  A reader may still be using the index thus
+// replaced, so we keep it on the retired list until the next
+// collection, when no thread can be reading it.
+//
+// The method tree is kept as well, but only to be written to boot
+// images.
+class CodeIndex {
+ public:
+  CodeIndex(CodeIndex* retired, unsigned capacity)
+      : retired(retired), capacity(capacity), count(0)
+  {
+  }
+
+  static unsigned footprint(unsigned capacity)
+  {
+    return sizeof(CodeIndex) + (capacity * sizeof(CodeRange));
+  }
+
+  CodeRange* ranges()
+  {
+    return reinterpret_cast<CodeRange*>(this + 1);
+  }
+
+  CodeIndex* retired;
+  unsigned capacity;
+  unsigned count;
+};
+
+CodeIndex* codeIndex(MyThread* t);
+
+GcMethod* codeIndexQuery(MyThread* t, void* ip)
+{
+  CodeIndex* index = codeIndex(t);
+  if (index == 0) {
+    return 0;
+  }
+
+  loadMemoryBarrier();
+
+  unsigned count = index->count;
+
+  loadMemoryBarrier();
+
+  // find the last range starting at or before the address
+  uintptr_t key = reinterpret_cast<uintptr_t>(ip);
+  CodeRange* ranges = index->ranges();
+  unsigned bottom = 0;
+  unsigned top = count;
+  while (bottom < top) {
+    unsigned middle = bottom + ((top - bottom) / 2);
+    if (ranges[middle].start <= key) {
+      bottom = middle + 1;
+    } else {
+      top = middle;
+    }
+  }
+
+  if (bottom and key < ranges[bottom - 1].end) {
+    return ranges[bottom - 1].method;
+  } else {
+    return 0;
+  }
+}
+
+unsigned methodTreeVersion(MyThread* t);
+
 GcMethod* methodForIp(MyThread* t, void* ip)
 {
   if (DebugMethodTree) {
@@ -411,12 +598,36 @@ GcMethod* methodForIp(MyThread* t, void* ip)
   // compile(MyThread*, FixedAllocator*, BootContext*, object)):
   loadMemoryBarrier();
 
-  return cast<GcMethod>(t,
-                        treeQuery(t,
-                                  compileRoots(t)->methodTree(),
-                                  reinterpret_cast<intptr_t>(ip),
-                                  compileRoots(t)->methodTreeSentinal(),
-                                  compareIpToMethodBounds));
+  // Unwinding and walking the stack ask about the same few addresses
+  // again and again, so each thread caches its latest answers.  We
+  // skip the cache while a trace context is active, since the thread
+  // may then be walked from a signal handler which interrupted an
+  // update to it.  The cache is flushed whenever the tree changes,
+  // lest it hold on to the clone a method is briefly entered as.
+  MyThread::IpCacheEntry* e = 0;
+  if (t->traceContext == 0) {
+    unsigned version = methodTreeVersion(t);
+    if (UNLIKELY(t->ipCacheVersion != version)) {
+      memset(t->ipCache, 0, sizeof(t->ipCache));
+      t->ipCacheVersion = version;
+    }
+
+    e = t->ipCache
+        + ((reinterpret_cast<uintptr_t>(ip) / BytesPerWord)
+           & (IpCacheSize - 1));
+    if (e->ip == ip) {
+      return e->method;
+    }
+  }
+
+  GcMethod* method = codeIndexQuery(t, ip);
+
+  if (e) {
+    e->ip = ip;
+    e->method = method;
+  }
+
+  return method;
 }
 
 unsigned localSize(MyThread* t UNUSED, GcMethod* method)
@@ -756,6 +967,45 @@ class PoolElement : public avian::codegen::Promise {
   PoolElement* next;
 };
 
+// A virtual call compiled to call its target through a cell in the
+// constant pool instead of through the receiver's vtable, since no
+// loaded class overrode the target at the time.  Once the code is
+// written, the cell is bound to the target (see
+// bindDevirtualizedCall), and once the code is committed, the cell is
+// registered so it may be redirected later (see
+// registerDevirtualizedCall).
+class DevirtualizedCallElement {
+ public:
+  DevirtualizedCallElement(GcMethod* target,
+                           avian::codegen::Promise* cell,
+                           DevirtualizedCallElement* next)
+      : target(target), cell(cell), next(next)
+  {
+  }
+
+  GcMethod* target;
+  avian::codegen::Promise* cell;
+  DevirtualizedCallElement* next;
+};
+
+// A bound cell, which is kept pointing to the compiled target until a
+// class which overrides the target is loaded, when it is pointed to
+// the target's virtual thunk instead, so that calls through it
+// dispatch on the receiver from then on.  A frame already running the
+// target needs no such help, since no instance of the overriding
+// class could have existed when it was called.
+class DevirtualizedCall {
+ public:
+  DevirtualizedCall(GcMethod* target, void** cell, DevirtualizedCall* next)
+      : target(target), cell(cell), next(next)
+  {
+  }
+
+  GcMethod* target;
+  void** cell;
+  DevirtualizedCall* next;
+};
+
 class Subroutine {
  public:
   Subroutine(unsigned index,
@@ -966,6 +1216,11 @@ class Context {
       for (TraceElement* p = c->traceLog; p; p = p->next) {
         v->visit(&(p->target));
       }
+
+      for (DevirtualizedCallElement* p = c->devirtualizedCalls; p;
+           p = p->next) {
+        v->visit(&(p->target));
+      }
     }
 
     Context* c;
@@ -992,6 +1247,14 @@ class Context {
           assertT(t, resultSize == 8);
           return local::getThunk(t, absoluteLongThunk);
 
+        case avian::codegen::lir::PopCount:
+          assertT(t, resultSize == 8);
+          return local::getThunk(t, popCountLongThunk);
+
+        case avian::codegen::lir::CountLeadingZeros:
+          assertT(t, resultSize == 8);
+          return local::getThunk(t, countLeadingZerosLongThunk);
+
         case avian::codegen::lir::FloatNegate:
           assertT(t, resultSize == 8);
           return local::getThunk(t, negateDoubleThunk);
@@ -1031,6 +1294,14 @@ class Context {
           assertT(t, resultSize == 4);
           return local::getThunk(t, absoluteIntThunk);
 
+        case avian::codegen::lir::PopCount:
+          assertT(t, resultSize == 4);
+          return local::getThunk(t, popCountIntThunk);
+
+        case avian::codegen::lir::CountLeadingZeros:
+          assertT(t, resultSize == 4);
+          return local::getThunk(t, countLeadingZerosIntThunk);
+
         case avian::codegen::lir::FloatNegate:
           assertT(t, resultSize == 4);
           return local::getThunk(t, negateFloatThunk);
@@ -1174,12 +1445,19 @@ class Context {
         objectPool(0),
         subroutineCount(0),
         traceLog(0),
+        devirtualizedCalls(0),
         visitTable(
             Slice<uint16_t>::allocAndSet(&zone, method->code()->length(), 0)),
         rootTable(Slice<uintptr_t>::allocAndSet(
             &zone,
             method->code()->length() * frameMapSizeInWords(t, method),
             ~(uintptr_t)0)),
+        inBoundsTable(
+            Slice<bool>::allocAndSet(&zone, method->code()->length(), false)),
+        blockStartTable(
+            Slice<bool>::allocAndSet(&zone, method->code()->length(), false)),
+        threadLocalMonitorTable(
+            Slice<bool>::allocAndSet(&zone, method->code()->length(), false)),
         executableAllocator(0),
         executableStart(0),
         executableSize(0),
@@ -1207,8 +1485,12 @@ class Context {
         objectPool(0),
         subroutineCount(0),
         traceLog(0),
+        devirtualizedCalls(0),
         visitTable(0, 0),
         rootTable(0, 0),
+        inBoundsTable(0, 0),
+        blockStartTable(0, 0),
+        threadLocalMonitorTable(0, 0),
         executableAllocator(0),
         executableStart(0),
         executableSize(0),
@@ -1269,8 +1551,15 @@ class Context {
   PoolElement* objectPool;
   unsigned subroutineCount;
   TraceElement* traceLog;
+  DevirtualizedCallElement* devirtualizedCalls;
   Slice<uint16_t> visitTable;
   Slice<uintptr_t> rootTable;
+  Slice<bool> inBoundsTable;
+  // ips which may be reached other than from the instruction before
+  Slice<bool> blockStartTable;
+  // monitorenter and monitorexit ips whose object no other thread can
+  // see (see findThreadLocalMonitors)
+  Slice<bool> threadLocalMonitorTable;
   Alloc* executableAllocator;
   void* executableStart;
   unsigned executableSize;
@@ -1668,6 +1957,10 @@ class Frame {
     unsigned dupIp = duplicatedIp(bytecodeIp);
     c->startLogicalIp(dupIp);
 
+    if (context->blockStartTable[bytecodeIp]) {
+      c->startBlock();
+    }
+
     context->eventLog.append(IpEvent);
     context->eventLog.append2(bytecodeIp);
 
@@ -2121,11 +2414,11 @@ void* findExceptionHandler(Thread* t, GcMethod* method, void* ip)
       GcIntArray* index = cast<GcIntArray>(t, table->body()[0]);
 
       uint8_t* compiled = reinterpret_cast<uint8_t*>(methodCompiled(t, method));
+      unsigned key = difference(ip, compiled) - 1;
 
       for (unsigned i = 0; i < table->length() - 1; ++i) {
         unsigned start = index->body()[i * 3];
         unsigned end = index->body()[(i * 3) + 1];
-        unsigned key = difference(ip, compiled) - 1;
 
         if (key >= start and key < end) {
           GcClass* catchType = cast<GcClass>(t, table->body()[i + 1]);
@@ -2403,9 +2696,22 @@ uintptr_t methodAddress(Thread* t, GcMethod* method)
   }
 }
 
+void updateInitCaller(MyThread* t, void* ip);
+
 void tryInitClass(MyThread* t, GcClass* class_)
 {
   initClass(t, class_);
+
+  // once the class is fully initialized (and not merely being
+  // initialized by this thread), the caller needn't check again
+  if ((class_->vmFlags() & NeedInitFlag) == 0) {
+    updateInitCaller(t, getIp(t));
+  }
+}
+
+// what tryInitClass calls are patched to call instead
+void skipInitClass(MyThread*, GcClass*)
+{
 }
 
 void compile(MyThread* t,
@@ -2413,24 +2719,71 @@ void compile(MyThread* t,
              BootContext* bootContext,
              GcMethod* method);
 
+// A reference pair is made for a member reference which couldn't be
+// resolved when the calling method was compiled, and is passed to a
+// thunk each time the site runs.  Once a thunk has resolved it, the
+// member replaces the reference in the pair, so later runs of that
+// site on any thread skip resolution, and in the constant pool slot
+// the reference came from, so other sites and recompilations of the
+// method find it already resolved, as resolve() would have left it.
+void cacheResolvedMember(Thread* t,
+                         GcPair* pair,
+                         object member,
+                         object poolEntry)
+{
+  object reference = pair->second();
+  GcSingleton* pool = cast<GcMethod>(t, pair->first())->code()->pool();
+
+  storeStoreMemoryBarrier();
+
+  for (unsigned i = 0; i < singletonCount(t, pool); ++i) {
+    if (singletonIsObject(t, pool, i)
+        and singletonObject(t, pool, i) == reference) {
+      pool->setBodyElement(t, i, reinterpret_cast<uintptr_t>(poolEntry));
+      break;
+    }
+  }
+
+  pair->setSecond(t, member);
+}
+
 GcMethod* resolveMethod(Thread* t, GcPair* pair)
 {
-  GcReference* reference = cast<GcReference>(t, pair->second());
+  object o = pair->second();
+
+  loadMemoryBarrier();
+
+  if (objectClass(t, o) == type(t, GcMethod::Type)) {
+    return cast<GcMethod>(t, o);
+  }
+
+  PROTECT(t, pair);
+
+  GcReference* reference = cast<GcReference>(t, o);
   PROTECT(t, reference);
 
-  GcClass* class_ = resolveClassInObject(
+  GcClassLoader* loader = cast<GcMethod>(t, pair->first())->class_()->loader();
+  PROTECT(t, loader);
+
+  GcClass* class_
+      = resolveClassInObject(t, loader, reference, ReferenceClass);
+
+  GcMethod* method = cast<GcMethod>(t,
+                                    findInHierarchy(t,
+                                                    class_,
+                                                    reference->name(),
+                                                    reference->spec(),
+                                                    findMethodInClass,
+                                                    GcNoSuchMethodError::Type));
+  PROTECT(t, method);
+
+  cacheResolvedMember(
       t,
-      cast<GcMethod>(t, pair->first())->class_()->loader(),
-      reference,
-      ReferenceClass);
+      pair,
+      method,
+      makeMethodHandle(t, reference->kind(), loader, method, 0));
 
-  return cast<GcMethod>(t,
-                        findInHierarchy(t,
-                                        class_,
-                                        reference->name(),
-                                        reference->spec(),
-                                        findMethodInClass,
-                                        GcNoSuchMethodError::Type));
+  return method;
 }
 
 bool methodAbstract(Thread* t UNUSED, GcMethod* method)
@@ -2538,6 +2891,129 @@ int64_t findVirtualMethodFromReference(MyThread* t,
   return prepareMethodForCall(t, target);
 }
 
+// An inline cache records, for one call site, the targets found for
+// the receiver classes seen there so far.  Its first element is the
+// method named at the call site or, until that is resolved, a pair of
+// the calling method and the unresolved reference.  It is followed by
+// up to InlineCacheSize pairs of receiver class and target method,
+// filled in order and never replaced, so a site which has seen more
+// classes than that falls back to a full lookup for the rest.  An
+// entry stays valid for the life of the class, since loading further
+// classes cannot change how an existing one resolves a method.
+
+const unsigned InlineCacheSize = 4;
+
+GcArray* makeInlineCache(MyThread* t, object site)
+{
+  PROTECT(t, site);
+
+  GcArray* cache = makeArray(t, InlineCacheSize + 1);
+  cache->setBodyElement(t, 0, site);
+  return cache;
+}
+
+GcMethod* inlineCacheTarget(MyThread* t, GcArray* cache)
+{
+  object site = cache->body()[0];
+  if (objectClass(t, site) == type(t, GcPair::Type)) {
+    PROTECT(t, cache);
+
+    GcMethod* target = resolveMethod(t, cast<GcPair>(t, site));
+
+    checkMethod(t, target, false);
+
+    cache->setBodyElement(t, 0, target);
+    return target;
+  } else {
+    return cast<GcMethod>(t, site);
+  }
+}
+
+GcMethod* findInInlineCache(MyThread* t, GcArray* cache, GcClass* class_)
+{
+  for (unsigned i = 1; i < cache->length(); ++i) {
+    GcPair* entry = cast<GcPair>(t, cache->body()[i]);
+    if (entry == 0) {
+      break;
+    } else if (entry->first() == class_) {
+      return cast<GcMethod>(t, entry->second());
+    }
+  }
+  return 0;
+}
+
+void addToInlineCache(MyThread* t,
+                      GcArray* cache,
+                      GcClass* class_,
+                      GcMethod* target)
+{
+  if (cache->body()[cache->length() - 1]) {
+    return;
+  }
+
+  PROTECT(t, cache);
+
+  GcPair* entry = makePair(t, class_, target);
+
+  // entries are read without locking, so make sure the pair is
+  // complete before it is published
+  storeStoreMemoryBarrier();
+
+  for (unsigned i = 1; i < cache->length(); ++i) {
+    if (cache->body()[i] == 0) {
+      cache->setBodyElement(t, i, entry);
+      break;
+    }
+  }
+}
+
+int64_t findInterfaceMethodFromCache(MyThread* t,
+                                     GcArray* cache,
+                                     object instance)
+{
+  if (instance == 0) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  GcClass* class_ = objectClass(t, instance);
+  GcMethod* target = findInInlineCache(t, cache, class_);
+  if (target == 0) {
+    PROTECT(t, cache);
+    PROTECT(t, class_);
+
+    target = findInterfaceMethod(
+        t, inlineCacheTarget(t, cache), class_);
+
+    PROTECT(t, target);
+
+    addToInlineCache(t, cache, class_, target);
+  }
+
+  return prepareMethodForCall(t, target);
+}
+
+int64_t findVirtualMethodFromCache(MyThread* t, GcArray* cache, object instance)
+{
+  if (instance == 0) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  GcClass* class_ = objectClass(t, instance);
+  GcMethod* target = findInInlineCache(t, cache, class_);
+  if (target == 0) {
+    PROTECT(t, cache);
+    PROTECT(t, class_);
+
+    target = findVirtualMethod(t, inlineCacheTarget(t, cache), class_);
+
+    PROTECT(t, target);
+
+    addToInlineCache(t, cache, class_, target);
+  }
+
+  return prepareMethodForCall(t, target);
+}
+
 int64_t getMethodAddress(MyThread* t, GcMethod* target)
 {
   return prepareMethodForCall(t, target);
@@ -2571,9 +3047,10 @@ unsigned traceSize(Thread* t)
 
   t->m->processor->walkStack(t, &counter);
 
-  return pad(GcArray::FixedSize)
-         + (counter.count * pad(ArrayElementSizeOfArray))
-         + (counter.count * pad(GcTraceElement::FixedSize));
+  return pad(GcTrace::FixedSize)
+         + pad(counter.count * ArrayElementSizeOfTrace)
+         + pad(GcIntArray::FixedSize)
+         + pad(counter.count * ArrayElementSizeOfIntArray);
 }
 
 void NO_RETURN throwArithmetic(MyThread* t)
@@ -2647,9 +3124,64 @@ uint64_t makeBlankObjectArrayFromReference(MyThread* t,
       length);
 }
 
-uint64_t makeBlankArray(MyThread* t, unsigned type, int32_t length)
+Gc::Type primitiveArrayType(MyThread* t,
+                            unsigned type,
+                            unsigned* elementSize)
+{
+  switch (type) {
+  case T_BOOLEAN:
+    *elementSize = 1;
+    return GcBooleanArray::Type;
+  case T_CHAR:
+    *elementSize = 2;
+    return GcCharArray::Type;
+  case T_FLOAT:
+    *elementSize = 4;
+    return GcFloatArray::Type;
+  case T_DOUBLE:
+    *elementSize = 8;
+    return GcDoubleArray::Type;
+  case T_BYTE:
+    *elementSize = 1;
+    return GcByteArray::Type;
+  case T_SHORT:
+    *elementSize = 2;
+    return GcShortArray::Type;
+  case T_INT:
+    *elementSize = 4;
+    return GcIntArray::Type;
+  case T_LONG:
+    *elementSize = 8;
+    return GcLongArray::Type;
+  default:
+    abort(t);
+  }
+}
+
+object makeBlankArrayAtSite(MyThread* t,
+                            AllocationSite* site,
+                            GcClass* class_,
+                            unsigned elementSize,
+                            unsigned length)
 {
-  if (length >= 0) {
+  object array = allocateAtSite(
+      t, site, class_, ArrayBody + pad(length * elementSize), false);
+  fieldAtOffset<uintptr_t>(array, BytesPerWord) = length;
+
+  return array;
+}
+
+uint64_t makeBlankArray(MyThread* t,
+                        unsigned type,
+                        int32_t length,
+                        AllocationSite* site)
+{
+  if (length >= 0 and site) {
+    unsigned elementSize;
+    GcClass* class_ = vm::type(t, primitiveArrayType(t, type, &elementSize));
+    return reinterpret_cast<uintptr_t>(
+        makeBlankArrayAtSite(t, site, class_, elementSize, length));
+  } else if (length >= 0) {
     switch (type) {
     case T_BOOLEAN:
       return reinterpret_cast<uintptr_t>(makeBooleanArray(t, length));
@@ -2675,6 +3207,20 @@ uint64_t makeBlankArray(MyThread* t, unsigned type, int32_t length)
   }
 }
 
+uint64_t makeBlankArrayOfClass(MyThread* t,
+                               GcClass* class_,
+                               AllocationSite* site,
+                               int32_t length,
+                               unsigned elementSize)
+{
+  if (length >= 0) {
+    return reinterpret_cast<uintptr_t>(
+        makeBlankArrayAtSite(t, site, class_, elementSize, length));
+  } else {
+    throwNew(t, GcNegativeArraySizeException::Type, "%d", length);
+  }
+}
+
 uint64_t lookUpAddress(int32_t key,
                        uintptr_t* start,
                        int32_t count,
@@ -2708,6 +3254,24 @@ void setMaybeNull(MyThread* t, object o, unsigned offset, object value)
   }
 }
 
+uint64_t getWideVolatile(MyThread* t, object o, unsigned offset)
+{
+  if (LIKELY(o)) {
+    return loadWide(t, &fieldAtOffset<int64_t>(o, offset));
+  } else {
+    throwNew(t, GcNullPointerException::Type);
+  }
+}
+
+void setWideVolatile(MyThread* t, object o, unsigned offset, uint64_t value)
+{
+  if (LIKELY(o)) {
+    storeWide(t, &fieldAtOffset<int64_t>(o, offset), value);
+  } else {
+    throwNew(t, GcNullPointerException::Type);
+  }
+}
+
 void acquireMonitorForObject(MyThread* t, object o)
 {
   if (LIKELY(o)) {
@@ -2873,7 +3437,17 @@ void checkCastFromReference(MyThread* t, GcPair* pair, object o)
 
 GcField* resolveField(Thread* t, GcPair* pair)
 {
-  GcReference* reference = cast<GcReference>(t, pair->second());
+  object o = pair->second();
+
+  loadMemoryBarrier();
+
+  if (objectClass(t, o) == type(t, GcField::Type)) {
+    return cast<GcField>(t, o);
+  }
+
+  PROTECT(t, pair);
+
+  GcReference* reference = cast<GcReference>(t, o);
   PROTECT(t, reference);
 
   GcClass* class_ = resolveClassInObject(
@@ -2882,13 +3456,17 @@ GcField* resolveField(Thread* t, GcPair* pair)
       reference,
       ReferenceClass);
 
-  return cast<GcField>(t,
-                       findInHierarchy(t,
-                                       class_,
-                                       reference->name(),
-                                       reference->spec(),
-                                       findFieldInClass,
-                                       GcNoSuchFieldError::Type));
+  GcField* field = cast<GcField>(t,
+                                 findInHierarchy(t,
+                                                 class_,
+                                                 reference->name(),
+                                                 reference->spec(),
+                                                 findFieldInClass,
+                                                 GcNoSuchFieldError::Type));
+
+  cacheResolvedMember(t, pair, field, field);
+
+  return field;
 }
 
 uint64_t getFieldValue(Thread* t, object target, GcField* field)
@@ -2908,7 +3486,7 @@ uint64_t getFieldValue(Thread* t, object target, GcField* field)
 
   case DoubleField:
   case LongField:
-    return fieldAtOffset<int64_t>(target, field->offset());
+    return getWideField(t, target, field);
 
   case ObjectField:
     return fieldAtOffset<intptr_t>(target, field->offset());
@@ -2953,8 +3531,7 @@ void setStaticLongFieldValueFromReference(MyThread* t,
 
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<int64_t>(field->class_()->staticTable(), field->offset())
-      = value;
+  setWideField(t, field->class_()->staticTable(), field, value);
 }
 
 void setLongFieldValueFromReference(MyThread* t,
@@ -2969,7 +3546,7 @@ void setLongFieldValueFromReference(MyThread* t,
 
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<int64_t>(instance, field->offset()) = value;
+  setWideField(t, instance, field, value);
 }
 
 void setStaticObjectFieldValueFromReference(MyThread* t,
@@ -3058,6 +3635,26 @@ uint64_t instanceOf64(Thread* t, GcClass* class_, object o)
   return instanceOf(t, class_, o);
 }
 
+void copyArray(MyThread* t,
+               object src,
+               int32_t srcOffset,
+               object dst,
+               int32_t dstOffset,
+               int32_t length)
+{
+  arrayCopy(t, src, srcOffset, dst, dstOffset, length);
+}
+
+uint64_t stringEquals(MyThread* t, object s, object o)
+{
+  if (UNLIKELY(s == 0)) {
+    throwNew(t, GcNullPointerException::Type);
+  }
+
+  return o and objectClass(t, o) == type(t, GcString::Type)
+         and stringEqual(t, s, o);
+}
+
 uint64_t instanceOfFromReference(Thread* t, GcPair* pair, object o)
 {
   PROTECT(t, o);
@@ -3079,16 +3676,34 @@ uint64_t makeNewGeneral64(Thread* t, GcClass* class_)
   return reinterpret_cast<uintptr_t>(makeNewGeneral(t, class_));
 }
 
-uint64_t makeNew64(Thread* t, GcClass* class_)
+uint64_t makeNew64(Thread* t, GcClass* class_, AllocationSite* site)
 {
   PROTECT(t, class_);
 
   initClass(t, class_);
 
-  return reinterpret_cast<uintptr_t>(makeNew(t, class_));
+  if (site) {
+    return reinterpret_cast<uintptr_t>(
+        allocateAtSite(t,
+                       site,
+                       class_,
+                       pad(class_->fixedSize()),
+                       class_->objectMask()));
+  } else {
+    return reinterpret_cast<uintptr_t>(makeNew(t, class_));
+  }
 }
 
-uint64_t makeNewFromReference(Thread* t, GcPair* pair)
+uint64_t makeNewOfSize(Thread* t,
+                       GcClass* class_,
+                       AllocationSite* site,
+                       unsigned sizeInWords)
+{
+  return reinterpret_cast<uintptr_t>(allocateAtSite(
+      t, site, class_, sizeInWords * BytesPerWord, class_->objectMask()));
+}
+
+uint64_t makeNewFromReference(Thread* t, GcPair* pair)
 {
   GcClass* class_
       = resolveClass(t,
@@ -3143,14 +3758,130 @@ void logCompile(MyThread* t,
                 unsigned size,
                 const char* class_,
                 const char* name,
-                const char* spec);
+                const char* spec,
+                const char* sourceFile,
+                Slice<const uint64_t> lineNumbers);
 
-unsigned simpleFrameMapTableSize(MyThread* t, GcMethod* method, GcIntArray* map)
+void logCompile(MyThread* t,
+                const void* code,
+                unsigned size,
+                const char* class_,
+                const char* name,
+                const char* spec)
 {
-  int size = frameMapSizeInBits(t, method);
-  return ceilingDivide(map->length() * size, 32 + size);
+  logCompile(
+      t, code, size, class_, name, spec, 0, Slice<const uint64_t>(0, 0));
 }
 
+void logCompile(MyThread* t, const void* code, unsigned size, GcMethod* method)
+{
+  GcByteArray* sourceFile = method->class_()->sourceFile();
+  GcLineNumberTable* lineNumbers = method->code()->lineNumberTable();
+
+  logCompile(
+      t,
+      code,
+      size,
+      reinterpret_cast<const char*>(method->class_()->name()->body().begin()),
+      reinterpret_cast<const char*>(method->name()->body().begin()),
+      reinterpret_cast<const char*>(method->spec()->body().begin()),
+      sourceFile ? reinterpret_cast<const char*>(sourceFile->body().begin())
+                 : 0,
+      lineNumbers ? Slice<const uint64_t>(lineNumbers->body().begin(),
+                                          lineNumbers->length())
+                  : Slice<const uint64_t>(0, 0));
+}
+
+// A frame map table records which locals and stack slots hold object
+// references at each call site of a method.  It's an int array laid
+// out as follows:
+//
+//   the number of call sites, the number of distinct maps, and the
+//   number of bits used for each offset delta
+//
+//   the return address offset of every FrameMapIndexInterval'th call
+//   site, which we binary search to find the run of sites to decode
+//
+//   for each site, the distance from the previous one, packed into
+//   as few bits as the largest distance needs
+//
+//   for each site, the index of its map, packed likewise
+//
+//   the distinct maps, frameMapSizeInBits each, since call sites
+//   tend to see the same roots
+const unsigned FrameMapIndexInterval = 16;
+
+unsigned bitsNeeded(unsigned v)
+{
+  unsigned bits = 0;
+  for (; v; v >>= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+class FrameMapTable {
+ public:
+  static const unsigned HeaderSize = 3;
+
+  FrameMapTable(unsigned siteCount,
+                unsigned mapCount,
+                unsigned deltaBits,
+                unsigned mapSize)
+      : siteCount(siteCount),
+        mapCount(mapCount),
+        deltaBits(deltaBits),
+        indexBits(bitsNeeded(mapCount ? mapCount - 1 : 0)),
+        mapSize(mapSize)
+  {
+  }
+
+  FrameMapTable(MyThread* t, GcMethod* method, GcIntArray* table)
+      : siteCount(table->body()[0]),
+        mapCount(table->body()[1]),
+        deltaBits(table->body()[2]),
+        indexBits(bitsNeeded(mapCount ? mapCount - 1 : 0)),
+        mapSize(frameMapSizeInBits(t, method))
+  {
+  }
+
+  unsigned indexCount()
+  {
+    return ceilingDivide(siteCount, FrameMapIndexInterval);
+  }
+
+  unsigned indexStart()
+  {
+    return HeaderSize;
+  }
+
+  unsigned deltaStart()
+  {
+    return indexStart() + indexCount();
+  }
+
+  unsigned mapIndexStart()
+  {
+    return deltaStart() + ceilingDivide(siteCount * deltaBits, 32);
+  }
+
+  unsigned mapStart()
+  {
+    return mapIndexStart() + ceilingDivide(siteCount * indexBits, 32);
+  }
+
+  unsigned length()
+  {
+    return mapStart() + ceilingDivide(mapCount * mapSize, 32);
+  }
+
+  unsigned siteCount;
+  unsigned mapCount;
+  unsigned deltaBits;
+  unsigned indexBits;
+  unsigned mapSize;
+};
+
 #ifndef AVIAN_AOT_ONLY
 unsigned resultSize(MyThread* t, unsigned code)
 {
@@ -3178,6 +3909,32 @@ unsigned resultSize(MyThread* t, unsigned code)
   }
 }
 
+// code in a boot image can't refer to sites allocated at runtime, so
+// it allocates as if every site were unprofiled
+ir::Value* allocationSite(MyThread* t, Context* context)
+{
+  avian::codegen::Compiler* c = context->compiler;
+  if (context->bootContext) {
+    return c->constant(0, ir::Type::iptr());
+  } else {
+    return c->constant(reinterpret_cast<intptr_t>(makeAllocationSite(t)),
+                       ir::Type::iptr());
+  }
+}
+
+// whether compiled code may allocate in line from the thread-local
+// heap (see Compiler::InlineAllocation).  It can't stress the
+// collector, and only takes allocations with a site, which tells it
+// at run time whether allocations are being profiled.
+bool inlineAllocation(MyThread* t UNUSED, Context* context UNUSED)
+{
+#ifdef VM_STRESS
+  return false;
+#else
+  return context->bootContext == 0;
+#endif
+}
+
 ir::Value* popField(MyThread* t, Frame* frame, int code)
 {
   switch (code) {
@@ -3203,14 +3960,96 @@ ir::Value* popField(MyThread* t, Frame* frame, int code)
   }
 }
 
-void compileSafePoint(MyThread* t, Compiler* c, Frame* frame)
+// Calls tryInitClass on the way to a static field.  The call is
+// aligned so that tryInitClass can point it at skipInitClass once
+// the class is initialized, except in a boot image, which we can't
+// patch.
+void compileInitCheck(MyThread* t, Frame* frame, GcClass* class_)
+{
+  avian::codegen::Compiler* c = frame->c;
+
+  c->nativeCall(
+      c->constant(getThunk(t, tryInitClassThunk), ir::Type::iptr()),
+      frame->context->bootContext ? 0 : Compiler::Aligned,
+      frame->trace(0, 0),
+      ir::Type::void_(),
+      args(c->threadRegister(), frame->append(class_)));
+}
+
+// Compiles an unconditional backward branch to target.  Unless another
+// thread has asked for exclusive access, t->m->exclusive is null and
+// we branch straight there; otherwise we call out to go idle first.
+void compileSafePoint(MyThread* t,
+                      Compiler* c,
+                      Frame* frame,
+                      ir::Value* target)
 {
+  ir::Value* machine = c->load(
+      ir::ExtendMode::Signed,
+      c->memory(c->threadRegister(), ir::Type::iptr(), TARGET_THREAD_M),
+      ir::Type::iptr());
+
+  ir::Value* exclusive = c->load(
+      ir::ExtendMode::Signed,
+      c->memory(machine, ir::Type::iptr(), TargetMachineExclusive),
+      ir::Type::iptr());
+
+  c->condJump(lir::JumpIfEqual,
+              c->constant(0, ir::Type::iptr()),
+              exclusive,
+              target);
+
   c->nativeCall(
       c->constant(getThunk(t, idleIfNecessaryThunk), ir::Type::iptr()),
       0,
       frame->trace(0, 0),
       ir::Type::void_(),
       args(c->threadRegister()));
+
+  c->jmp(target);
+}
+
+lir::TernaryOperation invertJumpOp(MyThread* t, lir::TernaryOperation op)
+{
+  switch (op) {
+  case lir::JumpIfEqual:
+    return lir::JumpIfNotEqual;
+  case lir::JumpIfNotEqual:
+    return lir::JumpIfEqual;
+  case lir::JumpIfLess:
+    return lir::JumpIfGreaterOrEqual;
+  case lir::JumpIfGreaterOrEqual:
+    return lir::JumpIfLess;
+  case lir::JumpIfGreater:
+    return lir::JumpIfLessOrEqual;
+  case lir::JumpIfLessOrEqual:
+    return lir::JumpIfGreater;
+  default:
+    abort(t);
+  }
+}
+
+// Compiles a conditional branch from ip to newIp, polling for a safe
+// point on the way if it goes backward.  Then the branch is inverted
+// to skip to ip when not taken, leaving the taken path to
+// compileSafePoint.
+void compileConditionalBranch(MyThread* t,
+                              Frame* frame,
+                              lir::TernaryOperation op,
+                              ir::Value* a,
+                              ir::Value* b,
+                              unsigned ip,
+                              unsigned newIp)
+{
+  avian::codegen::Compiler* c = frame->c;
+  ir::Value* target = frame->machineIpValue(newIp);
+
+  if (newIp <= ip) {
+    c->condJump(invertJumpOp(t, op), a, b, frame->machineIpValue(ip));
+    compileSafePoint(t, c, frame, target);
+  } else {
+    c->condJump(op, a, b, target);
+  }
 }
 
 void compileDirectInvoke(MyThread* t,
@@ -3283,6 +4122,37 @@ void compileDirectInvoke(MyThread* t,
   }
 }
 
+bool inlineMethod(MyThread* t, Frame* frame, GcMethod* target);
+
+// Returns true if one of the VM's own types whose class file has yet
+// to be parsed inherits from c.  Instances of such a type may already
+// exist, but what it overrides isn't known until it is parsed.
+bool hasBootstrapSubclass(MyThread* t, GcClass* c)
+{
+  for (unsigned i = 0; i < t->m->types->length(); ++i) {
+    GcClass* type = vm::type(t, static_cast<Gc::Type>(i));
+    if (type and (type->vmFlags() & BootstrapFlag)) {
+      for (GcClass* s = type->super(); s; s = s->super()) {
+        if (s == c) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Returns true if a virtual call to target may be bound to target
+// itself, at least until a class which overrides it is loaded.
+bool devirtualizable(MyThread* t, GcMethod* target)
+{
+  return methodVirtual(t, target)
+         and (target->flags() & (ACC_NATIVE | ACC_ABSTRACT)) == 0
+         and (target->class_()->flags() & ACC_INTERFACE) == 0
+         and (target->vmFlags() & OverriddenFlag) == 0
+         and not hasBootstrapSubclass(t, target->class_());
+}
+
 bool compileDirectInvoke(MyThread* t,
                          Frame* frame,
                          GcMethod* target,
@@ -3293,6 +4163,8 @@ bool compileDirectInvoke(MyThread* t,
   if (emptyMethod(t, target) and (not classNeedsInit(t, target->class_()))) {
     frame->popFootprint(target->parameterFootprint());
     tailCall = false;
+  } else if (inlineMethod(t, frame, target)) {
+    tailCall = false;
   } else {
     BootContext* bc = frame->context->bootContext;
     if (bc) {
@@ -3711,12 +4583,137 @@ ir::Value* popLongAddress(Frame* frame)
                               ir::Type::iptr());
 }
 
-bool intrinsic(MyThread* t UNUSED, Frame* frame, GcMethod* target)
+// Unsafe names a location with an object and a byte offset from its
+// start, or with a null object and an absolute address.  Nothing in
+// between can trigger a collection, so the derived pointer is safe.
+ir::Value* popObjectAddress(Frame* frame)
 {
+  ir::Value* offset = popLongAddress(frame);
+  ir::Value* base = frame->pop(ir::Type::object());
+  return frame->c->binaryOp(lir::Add, ir::Type::iptr(), base, offset);
+}
+
 #define MATCH(name, constant)         \
   (name->length() == sizeof(constant) \
    and ::strcmp(reinterpret_cast<char*>(name->body().begin()), constant) == 0)
 
+void popReceiver(Frame* frame, bool instance)
+{
+  if (instance) {
+    frame->pop(ir::Type::object());
+  }
+}
+
+// Compiles the likes of Unsafe.getInt(long), which load from or store
+// to an absolute address, as a plain load or store, returning false if
+// target isn't one of them.  The accessors of avian.Arena have the same
+// names and descriptors, but are static, so there's no receiver.
+bool absoluteAccess(Frame* frame, GcMethod* target, bool instance)
+{
+  avian::codegen::Compiler* c = frame->c;
+  if (MATCH(target->name(), "getByte") and MATCH(target->spec(), "(J)B")) {
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    frame->push(ir::Type::i4(),
+                c->load(ir::ExtendMode::Signed,
+                        c->memory(address, ir::Type::i1()),
+                        ir::Type::i4()));
+    return true;
+  } else if (MATCH(target->name(), "putByte")
+             and MATCH(target->spec(), "(JB)V")) {
+    ir::Value* value = frame->pop(ir::Type::i4());
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    c->store(value, c->memory(address, ir::Type::i1()));
+    return true;
+  } else if ((MATCH(target->name(), "getShort")
+              and MATCH(target->spec(), "(J)S"))
+             or (MATCH(target->name(), "getChar")
+                 and MATCH(target->spec(), "(J)C"))) {
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    frame->push(ir::Type::i4(),
+                c->load(ir::ExtendMode::Signed,
+                        c->memory(address, ir::Type::i2()),
+                        ir::Type::i4()));
+    return true;
+  } else if ((MATCH(target->name(), "putShort")
+              and MATCH(target->spec(), "(JS)V"))
+             or (MATCH(target->name(), "putChar")
+                 and MATCH(target->spec(), "(JC)V"))) {
+    ir::Value* value = frame->pop(ir::Type::i4());
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    c->store(value, c->memory(address, ir::Type::i2()));
+    return true;
+  } else if ((MATCH(target->name(), "getInt")
+              and MATCH(target->spec(), "(J)I"))
+             or (MATCH(target->name(), "getFloat")
+                 and MATCH(target->spec(), "(J)F"))) {
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    ir::Type type = MATCH(target->name(), "getInt") ? ir::Type::i4()
+                                                    : ir::Type::f4();
+    frame->push(
+        type,
+        c->load(ir::ExtendMode::Signed, c->memory(address, type), type));
+    return true;
+  } else if ((MATCH(target->name(), "putInt")
+              and MATCH(target->spec(), "(JI)V"))
+             or (MATCH(target->name(), "putFloat")
+                 and MATCH(target->spec(), "(JF)V"))) {
+    ir::Type type = MATCH(target->name(), "putInt") ? ir::Type::i4()
+                                                    : ir::Type::f4();
+    ir::Value* value = frame->pop(type);
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    c->store(value, c->memory(address, type));
+    return true;
+  } else if ((MATCH(target->name(), "getLong")
+              and MATCH(target->spec(), "(J)J"))
+             or (MATCH(target->name(), "getDouble")
+                 and MATCH(target->spec(), "(J)D"))) {
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    ir::Type type = MATCH(target->name(), "getLong") ? ir::Type::i8()
+                                                     : ir::Type::f8();
+    frame->pushLarge(
+        type,
+        c->load(ir::ExtendMode::Signed, c->memory(address, type), type));
+    return true;
+  } else if ((MATCH(target->name(), "putLong")
+              and MATCH(target->spec(), "(JJ)V"))
+             or (MATCH(target->name(), "putDouble")
+                 and MATCH(target->spec(), "(JD)V"))) {
+    ir::Type type = MATCH(target->name(), "putLong") ? ir::Type::i8()
+                                                     : ir::Type::f8();
+    ir::Value* value = frame->popLarge(type);
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    c->store(value, c->memory(address, type));
+    return true;
+  } else if (MATCH(target->name(), "getAddress")
+             and MATCH(target->spec(), "(J)J")) {
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    frame->pushLarge(ir::Type::i8(),
+                     c->load(ir::ExtendMode::Signed,
+                             c->memory(address, ir::Type::iptr()),
+                             ir::Type::i8()));
+    return true;
+  } else if (MATCH(target->name(), "putAddress")
+             and MATCH(target->spec(), "(JJ)V")) {
+    ir::Value* value = frame->popLarge(ir::Type::i8());
+    ir::Value* address = popLongAddress(frame);
+    popReceiver(frame, instance);
+    c->store(value, c->memory(address, ir::Type::iptr()));
+    return true;
+  }
+  return false;
+}
+
+bool intrinsic(MyThread* t, Frame* frame, GcMethod* target)
+{
   GcByteArray* className = target->class_()->name();
   if (UNLIKELY(MATCH(className, "java/lang/Math"))) {
     avian::codegen::Compiler* c = frame->c;
@@ -3741,106 +4738,143 @@ bool intrinsic(MyThread* t UNUSED, Frame* frame, GcMethod* target)
         return true;
       }
     }
-  } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
+  } else if (UNLIKELY(MATCH(className, "java/lang/Integer"))) {
     avian::codegen::Compiler* c = frame->c;
-    if (MATCH(target->name(), "getByte") and MATCH(target->spec(), "(J)B")) {
-      ir::Value* address = popLongAddress(frame);
-      frame->pop(ir::Type::object());
+    if (MATCH(target->name(), "bitCount") and MATCH(target->spec(), "(I)I")) {
+      frame->push(ir::Type::i4(),
+                  c->unaryOp(lir::PopCount, frame->pop(ir::Type::i4())));
+      return true;
+    } else if (MATCH(target->name(), "numberOfLeadingZeros")
+               and MATCH(target->spec(), "(I)I")) {
+      frame->push(
+          ir::Type::i4(),
+          c->unaryOp(lir::CountLeadingZeros, frame->pop(ir::Type::i4())));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Long"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(target->name(), "bitCount") and MATCH(target->spec(), "(J)I")) {
+      frame->push(
+          ir::Type::i4(),
+          c->truncate(
+              ir::Type::i4(),
+              c->unaryOp(lir::PopCount, frame->popLarge(ir::Type::i8()))));
+      return true;
+    } else if (MATCH(target->name(), "numberOfLeadingZeros")
+               and MATCH(target->spec(), "(J)I")) {
       frame->push(ir::Type::i4(),
+                  c->truncate(ir::Type::i4(),
+                              c->unaryOp(lir::CountLeadingZeros,
+                                         frame->popLarge(ir::Type::i8()))));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/System"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(target->name(), "arraycopy")
+        and MATCH(target->spec(),
+                  "(Ljava/lang/Object;ILjava/lang/Object;II)V")) {
+      // call arrayCopy directly rather than via invokeNative
+      ir::Value* length = frame->pop(ir::Type::i4());
+      ir::Value* dstOffset = frame->pop(ir::Type::i4());
+      ir::Value* dst = frame->pop(ir::Type::object());
+      ir::Value* srcOffset = frame->pop(ir::Type::i4());
+      ir::Value* src = frame->pop(ir::Type::object());
+      c->nativeCall(
+          c->constant(getThunk(t, copyArrayThunk), ir::Type::iptr()),
+          0,
+          frame->trace(0, 0),
+          ir::Type::void_(),
+          args(c->threadRegister(), src, srcOffset, dst, dstOffset, length));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/Thread"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(target->name(), "currentThread")
+        and MATCH(target->spec(), "()Ljava/lang/Thread;")) {
+      // the current thread's Java object is a field of the thread
+      // register, so there's no need to call out to ask for it
+      frame->push(ir::Type::object(),
                   c->load(ir::ExtendMode::Signed,
-                          c->memory(address, ir::Type::i1()),
-                          ir::Type::i4()));
+                          c->memory(c->threadRegister(),
+                                    ir::Type::object(),
+                                    TARGET_THREAD_JAVATHREAD),
+                          ir::Type::object()));
       return true;
-    } else if (MATCH(target->name(), "putByte")
-               and MATCH(target->spec(), "(JB)V")) {
-      ir::Value* value = frame->pop(ir::Type::i4());
-      ir::Value* address = popLongAddress(frame);
-      frame->pop(ir::Type::object());
-      c->store(value, c->memory(address, ir::Type::i1()));
+    }
+  } else if (UNLIKELY(MATCH(className, "java/lang/String"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (MATCH(target->name(), "equals")
+        and MATCH(target->spec(), "(Ljava/lang/Object;)Z")) {
+      // String is final, so this is the method any receiver would use
+      ir::Value* o = frame->pop(ir::Type::object());
+      ir::Value* s = frame->pop(ir::Type::object());
+      frame->push(
+          ir::Type::i4(),
+          c->nativeCall(
+              c->constant(getThunk(t, stringEqualsThunk), ir::Type::iptr()),
+              0,
+              frame->trace(0, 0),
+              ir::Type::i4(),
+              args(c->threadRegister(), s, o)));
+      return true;
+    }
+  } else if (UNLIKELY(MATCH(className, "sun/misc/Unsafe"))) {
+    avian::codegen::Compiler* c = frame->c;
+    if (absoluteAccess(frame, target, true)) {
       return true;
-    } else if ((MATCH(target->name(), "getShort")
-                and MATCH(target->spec(), "(J)S"))
-               or (MATCH(target->name(), "getChar")
-                   and MATCH(target->spec(), "(J)C"))) {
-      ir::Value* address = popLongAddress(frame);
+    } else if (MATCH(target->name(), "getShort")
+               and MATCH(target->spec(), "(Ljava/lang/Object;J)S")) {
+      ir::Value* address = popObjectAddress(frame);
       frame->pop(ir::Type::object());
       frame->push(ir::Type::i4(),
                   c->load(ir::ExtendMode::Signed,
                           c->memory(address, ir::Type::i2()),
                           ir::Type::i4()));
       return true;
-    } else if ((MATCH(target->name(), "putShort")
-                and MATCH(target->spec(), "(JS)V"))
-               or (MATCH(target->name(), "putChar")
-                   and MATCH(target->spec(), "(JC)V"))) {
+    } else if (MATCH(target->name(), "putShort")
+               and MATCH(target->spec(), "(Ljava/lang/Object;JS)V")) {
       ir::Value* value = frame->pop(ir::Type::i4());
-      ir::Value* address = popLongAddress(frame);
+      ir::Value* address = popObjectAddress(frame);
       frame->pop(ir::Type::object());
       c->store(value, c->memory(address, ir::Type::i2()));
       return true;
-    } else if ((MATCH(target->name(), "getInt")
-                and MATCH(target->spec(), "(J)I"))
-               or (MATCH(target->name(), "getFloat")
-                   and MATCH(target->spec(), "(J)F"))) {
-      ir::Value* address = popLongAddress(frame);
-      frame->pop(ir::Type::object());
-      ir::Type type = MATCH(target->name(), "getInt") ? ir::Type::i4()
-                                                      : ir::Type::f4();
-      frame->push(
-          type,
-          c->load(ir::ExtendMode::Signed, c->memory(address, type), type));
-      return true;
-    } else if ((MATCH(target->name(), "putInt")
-                and MATCH(target->spec(), "(JI)V"))
-               or (MATCH(target->name(), "putFloat")
-                   and MATCH(target->spec(), "(JF)V"))) {
-      ir::Type type = MATCH(target->name(), "putInt") ? ir::Type::i4()
-                                                      : ir::Type::f4();
-      ir::Value* value = frame->pop(type);
-      ir::Value* address = popLongAddress(frame);
+    } else if (MATCH(target->name(), "getInt")
+               and MATCH(target->spec(), "(Ljava/lang/Object;J)I")) {
+      ir::Value* address = popObjectAddress(frame);
       frame->pop(ir::Type::object());
-      c->store(value, c->memory(address, type));
-      return true;
-    } else if ((MATCH(target->name(), "getLong")
-                and MATCH(target->spec(), "(J)J"))
-               or (MATCH(target->name(), "getDouble")
-                   and MATCH(target->spec(), "(J)D"))) {
-      ir::Value* address = popLongAddress(frame);
-      frame->pop(ir::Type::object());
-      ir::Type type = MATCH(target->name(), "getLong") ? ir::Type::i8()
-                                                       : ir::Type::f8();
-      frame->pushLarge(
-          type,
-          c->load(ir::ExtendMode::Signed, c->memory(address, type), type));
+      frame->push(ir::Type::i4(),
+                  c->load(ir::ExtendMode::Signed,
+                          c->memory(address, ir::Type::i4()),
+                          ir::Type::i4()));
       return true;
-    } else if ((MATCH(target->name(), "putLong")
-                and MATCH(target->spec(), "(JJ)V"))
-               or (MATCH(target->name(), "putDouble")
-                   and MATCH(target->spec(), "(JD)V"))) {
-      ir::Type type = MATCH(target->name(), "putLong") ? ir::Type::i8()
-                                                       : ir::Type::f8();
-      ir::Value* value = frame->popLarge(type);
-      ir::Value* address = popLongAddress(frame);
+    } else if (MATCH(target->name(), "putInt")
+               and MATCH(target->spec(), "(Ljava/lang/Object;JI)V")) {
+      ir::Value* value = frame->pop(ir::Type::i4());
+      ir::Value* address = popObjectAddress(frame);
       frame->pop(ir::Type::object());
-      c->store(value, c->memory(address, type));
+      c->store(value, c->memory(address, ir::Type::i4()));
       return true;
-    } else if (MATCH(target->name(), "getAddress")
-               and MATCH(target->spec(), "(J)J")) {
-      ir::Value* address = popLongAddress(frame);
+    } else if (MATCH(target->name(), "getLong")
+               and MATCH(target->spec(), "(Ljava/lang/Object;J)J")) {
+      ir::Value* address = popObjectAddress(frame);
       frame->pop(ir::Type::object());
       frame->pushLarge(ir::Type::i8(),
                        c->load(ir::ExtendMode::Signed,
-                               c->memory(address, ir::Type::iptr()),
+                               c->memory(address, ir::Type::i8()),
                                ir::Type::i8()));
       return true;
-    } else if (MATCH(target->name(), "putAddress")
-               and MATCH(target->spec(), "(JJ)V")) {
+    } else if (MATCH(target->name(), "putLong")
+               and MATCH(target->spec(), "(Ljava/lang/Object;JJ)V")) {
       ir::Value* value = frame->popLarge(ir::Type::i8());
-      ir::Value* address = popLongAddress(frame);
+      ir::Value* address = popObjectAddress(frame);
       frame->pop(ir::Type::object());
-      c->store(value, c->memory(address, ir::Type::iptr()));
+      c->store(value, c->memory(address, ir::Type::i8()));
       return true;
     }
+  } else if (UNLIKELY(MATCH(className, "avian/Arena"))) {
+    if (target->flags() & ACC_STATIC) {
+      return absoluteAccess(frame, target, false);
+    }
   }
   return false;
 }
@@ -3932,6 +4966,7 @@ class SwitchState {
         start(start),
         bottom(bottom),
         top(top),
+        keys(0),
         index(0)
   {
   }
@@ -3955,6 +4990,7 @@ class SwitchState {
   avian::codegen::Promise* start;
   int bottom;
   int top;
+  int32_t* keys;
   unsigned index;
 };
 
@@ -4008,641 +5044,758 @@ lir::TernaryOperation toCompilerBinaryOp(MyThread* t, unsigned instruction)
   }
 }
 
-uintptr_t aioobThunk(MyThread* t);
-
-uintptr_t stackOverflowThunk(MyThread* t);
-
-void checkField(Thread* t, GcField* field, bool shouldBeStatic)
+ir::Value* loadField(Context* context, ir::Value* table, GcField* field)
 {
-  if (((field->flags() & ACC_STATIC) == 0) == shouldBeStatic) {
-    throwNew(t,
-             GcIncompatibleClassChangeError::Type,
-             "expected %s.%s to be %s",
-             field->class_()->name()->body().begin(),
-             field->name()->body().begin(),
-             shouldBeStatic ? "static" : "non-static");
-  }
-}
+  avian::codegen::Compiler* c = context->compiler;
+  unsigned offset = targetFieldOffset(context, field);
 
-bool isLambda(Thread* t,
-              GcClassLoader* loader,
-              GcCharArray* bootstrapArray,
-              GcInvocation* invocation)
-{
-  GcMethod* bootstrap = cast<GcMethodHandle>(t,
-                                       resolve(t,
-                                               loader,
-                                               invocation->pool(),
-                                               bootstrapArray->body()[0],
-                                               findMethodInClass,
-                                               GcNoSuchMethodError::Type))->method();
-  PROTECT(t, bootstrap);
+  switch (field->code()) {
+  case ByteField:
+  case BooleanField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::i1(), offset),
+                   ir::Type::i4());
 
-  return vm::strcmp(reinterpret_cast<const int8_t*>(
-                        "java/lang/invoke/LambdaMetafactory"),
-                    bootstrap->class_()->name()->body().begin()) == 0
-         and ((vm::strcmp(reinterpret_cast<const int8_t*>("metafactory"),
-                          bootstrap->name()->body().begin()) == 0
-               and vm::strcmp(
-                       reinterpret_cast<const int8_t*>(
-                           "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/lang/"
-                           "String;Ljava/lang/invoke/MethodType;Ljava/lang/"
-                           "invoke/"
-                           "MethodType;Ljava/lang/invoke/MethodHandle;Ljava/"
-                           "lang/"
-                           "invoke/MethodType;)Ljava/lang/invoke/CallSite;"),
-                       bootstrap->spec()->body().begin()) == 0)
-              or (vm::strcmp(reinterpret_cast<const int8_t*>("altMetafactory"),
-                             bootstrap->name()->body().begin()) == 0
-                  and vm::strcmp(
-                          reinterpret_cast<const int8_t*>(
-                              "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/"
-                              "lang/"
-                              "String;Ljava/lang/invoke/MethodType;[Ljava/lang/"
-                              "Object;)Ljava/lang/invoke/CallSite;"),
-                          bootstrap->spec()->body().begin()) == 0));
-}
+  case CharField:
+    return c->load(ir::ExtendMode::Unsigned,
+                   c->memory(table, ir::Type::i2(), offset),
+                   ir::Type::i4());
 
-void compile(MyThread* t,
-             Frame* initialFrame,
-             unsigned initialIp,
-             int exceptionHandlerStart = -1)
-{
-  enum { Return, Unbranch, Unsubroutine, Untable0, Untable1, Unswitch };
+  case ShortField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::i2(), offset),
+                   ir::Type::i4());
 
-  Frame* frame = initialFrame;
-  avian::codegen::Compiler* c = frame->c;
-  Context* context = frame->context;
-  unsigned stackSize = context->method->code()->maxStack();
-  Stack stack(t);
-  unsigned ip = initialIp;
-  unsigned newIp;
-  stack.pushValue(Return);
+  case FloatField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::f4(), offset),
+                   ir::Type::f4());
 
-start:
-  ir::Type* stackMap
-      = static_cast<ir::Type*>(stack.push(stackSize * sizeof(ir::Type)));
-  frame = new (stack.push(sizeof(Frame))) Frame(frame, stackMap);
+  case IntField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::i4(), offset),
+                   ir::Type::i4());
 
-loop:
-  GcCode* code = context->method->code();
-  PROTECT(t, code);
+  case DoubleField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::f8(), offset),
+                   ir::Type::f8());
 
-  while (ip < code->length()) {
-    if (context->visitTable[frame->duplicatedIp(ip)]++) {
-      // we've already visited this part of the code
-      frame->visitLogicalIp(ip);
-      goto next;
-    }
+  case LongField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::i8(), offset),
+                   ir::Type::i8());
 
-    frame->startLogicalIp(ip);
+  case ObjectField:
+    return c->load(ir::ExtendMode::Signed,
+                   c->memory(table, ir::Type::object(), offset),
+                   ir::Type::object());
 
-    if (exceptionHandlerStart >= 0) {
-      c->initLocalsFromLogicalIp(exceptionHandlerStart);
+  default:
+    abort(context->thread);
+  }
+}
 
-      exceptionHandlerStart = -1;
+ir::Type storageTypeForFieldCode(MyThread* t, unsigned code)
+{
+  switch (code) {
+  case ByteField:
+  case BooleanField:
+    return ir::Type::i1();
+  case CharField:
+  case ShortField:
+    return ir::Type::i2();
+  case FloatField:
+    return ir::Type::f4();
+  case IntField:
+    return ir::Type::i4();
+  case DoubleField:
+    return ir::Type::f8();
+  case LongField:
+    return ir::Type::i8();
+  case ObjectField:
+    return ir::Type::object();
 
-      frame->pushObject();
+  default:
+    abort(t);
+  }
+}
 
-      c->nativeCall(
-          c->constant(getThunk(t, gcIfNecessaryThunk), ir::Type::iptr()),
-          0,
-          frame->trace(0, 0),
-          ir::Type::void_(),
-          args(c->threadRegister()));
+// Translates the body of the specified method into IR at the current
+// call site, consuming the arguments from the caller's operand stack
+// and pushing the result, if any.  Only straight-line code which
+// neither calls out nor allocates is accepted, and the only
+// instructions which may fault are field accesses on the receiver, the
+// first of which precedes any side effect.  Thus a null receiver
+// throws at the call site just as the invoke itself would, and no
+// frame map or trace element ever refers to inlined code.  If emit is
+// false, the body is merely checked and nothing is generated.
+bool inlineBody(MyThread* t, Frame* frame, GcMethod* target, bool emit)
+{
+  avian::codegen::Compiler* c = frame->c;
+  Context* context = frame->context;
+
+  PROTECT(t, target);
+
+  bool isStatic = (target->flags() & ACC_STATIC) != 0;
+  unsigned footprint = target->parameterFootprint();
+
+  ir::Value* locals[InlineBytecodeLimit];
+  ir::Value* stack[InlineBytecodeLimit];
+  bool receiver[InlineBytecodeLimit];
+  unsigned sp = 0;
+  bool dereferenced = false;
+
+  if (emit) {
+    unsigned codes[InlineBytecodeLimit];
+    unsigned slots[InlineBytecodeLimit];
+    unsigned count = 0;
+    unsigned slot = isStatic ? 0 : 1;
+
+    for (MethodSpecIterator it(
+             t, reinterpret_cast<const char*>(target->spec()->body().begin()));
+         it.hasNext();) {
+      codes[count] = fieldCode(t, *it.next());
+      slots[count] = slot;
+      slot += (codes[count] == LongField or codes[count] == DoubleField) ? 2
+                                                                         : 1;
+      ++count;
     }
 
-    if (DebugInstructions) {
-      unsigned startingIp = ip;
-      fprintf(stderr, " stack: [");
-      for (size_t i = frame->localSize(); i < frame->sp; i++) {
-        ir::Type ty = frame->get(i);
-        if (ty == ir::Type::i4()) {
-          fprintf(stderr, "I");
-        } else if (ty == ir::Type::i8()) {
-          fprintf(stderr, "L");
-        } else if (ty == ir::Type::f4()) {
-          fprintf(stderr, "F");
-        } else if (ty == ir::Type::f8()) {
-          fprintf(stderr, "D");
-        } else if (ty == ir::Type::object()) {
-          fprintf(stderr, "O");
-        } else {
-          fprintf(stderr, "?");
-        }
-      }
-      fprintf(stderr, "]\n");
-      fprintf(stderr, "% 5d: ", startingIp);
-      avian::jvm::debug::printInstruction(code->body().begin(), startingIp);
-      fprintf(stderr, "\n");
+    for (unsigned i = count; i > 0; --i) {
+      locals[slots[i - 1]] = popField(t, frame, codes[i - 1]);
     }
 
-    unsigned instruction = code->body()[ip++];
+    if (not isStatic) {
+      locals[0] = frame->pop(ir::Type::object());
+    }
+  }
 
-    switch (instruction) {
-    case aaload:
-    case baload:
-    case caload:
-    case daload:
-    case faload:
-    case iaload:
-    case laload:
-    case saload: {
-      ir::Value* index = frame->pop(ir::Type::i4());
-      ir::Value* array = frame->pop(ir::Type::object());
+  unsigned ip = 0;
+  while (ip < target->code()->length()) {
+    unsigned instruction = target->code()->body()[ip++];
+    ir::Value* value = 0;
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
+    switch (instruction) {
+    case iload:
+    case lload:
+    case fload:
+    case dload:
+    case aload:
+    case iload_0:
+    case iload_1:
+    case iload_2:
+    case iload_3:
+    case lload_0:
+    case lload_1:
+    case lload_2:
+    case lload_3:
+    case fload_0:
+    case fload_1:
+    case fload_2:
+    case fload_3:
+    case dload_0:
+    case dload_1:
+    case dload_2:
+    case dload_3:
+    case aload_0:
+    case aload_1:
+    case aload_2:
+    case aload_3: {
+      unsigned kind;
+      unsigned index;
+      if (instruction < iload_0) {
+        kind = instruction - iload;
+        index = target->code()->body()[ip++];
+      } else {
+        kind = (instruction - iload_0) / 4;
+        index = (instruction - iload_0) % 4;
       }
 
-      if (CheckArrayBounds) {
-        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+      bool large = (kind == lload - iload or kind == dload - iload);
+      if (index + (large ? 1 : 0) >= footprint) {
+        return false;
       }
 
-      switch (instruction) {
-      case aaload:
-        frame->push(
-            ir::Type::object(),
-            c->load(
-                ir::ExtendMode::Signed,
-                c->memory(array, ir::Type::object(), TargetArrayBody, index),
-                ir::Type::object()));
-        break;
-
-      case faload:
-        frame->push(
-            ir::Type::f4(),
-            c->load(ir::ExtendMode::Signed,
-                    c->memory(array, ir::Type::f4(), TargetArrayBody, index),
-                    ir::Type::f4()));
-        break;
+      stack[sp] = emit ? locals[index] : 0;
+      receiver[sp] = (kind == aload - iload and index == 0 and not isStatic);
+      ++sp;
+    } break;
 
-      case iaload:
-        frame->push(
-            ir::Type::i4(),
-            c->load(ir::ExtendMode::Signed,
-                    c->memory(array, ir::Type::i4(), TargetArrayBody, index),
-                    ir::Type::i4()));
-        break;
+    case aconst_null:
+      if (emit) {
+        value = c->constant(0, ir::Type::object());
+      }
+      goto push;
 
-      case baload:
-        frame->push(
-            ir::Type::i4(),
-            c->load(ir::ExtendMode::Signed,
-                    c->memory(array, ir::Type::i1(), TargetArrayBody, index),
-                    ir::Type::i4()));
-        break;
+    case iconst_m1:
+    case iconst_0:
+    case iconst_1:
+    case iconst_2:
+    case iconst_3:
+    case iconst_4:
+    case iconst_5:
+      if (emit) {
+        value = c->constant(static_cast<int>(instruction) - iconst_0,
+                            ir::Type::i4());
+      }
+      goto push;
 
-      case caload:
-        frame->push(
-            ir::Type::i4(),
-            c->load(ir::ExtendMode::Unsigned,
-                    c->memory(array, ir::Type::i2(), TargetArrayBody, index),
-                    ir::Type::i4()));
-        break;
+    case lconst_0:
+    case lconst_1:
+      if (emit) {
+        value = c->constant(instruction - lconst_0, ir::Type::i8());
+      }
+      goto push;
 
-      case daload:
-        frame->pushLarge(
-            ir::Type::f8(),
-            c->load(ir::ExtendMode::Signed,
-                    c->memory(array, ir::Type::f8(), TargetArrayBody, index),
-                    ir::Type::f8()));
-        break;
+    case fconst_0:
+    case fconst_1:
+    case fconst_2:
+      if (emit) {
+        value = c->constant(
+            floatToBits(static_cast<float>(instruction - fconst_0)),
+            ir::Type::f4());
+      }
+      goto push;
 
-      case laload:
-        frame->pushLarge(
-            ir::Type::i8(),
-            c->load(ir::ExtendMode::Signed,
-                    c->memory(array, ir::Type::i8(), TargetArrayBody, index),
-                    ir::Type::i8()));
-        break;
+    case dconst_0:
+    case dconst_1:
+      if (emit) {
+        value = c->constant(
+            doubleToBits(static_cast<double>(instruction - dconst_0)),
+            ir::Type::f8());
+      }
+      goto push;
 
-      case saload:
-        frame->push(
-            ir::Type::i4(),
-            c->load(ir::ExtendMode::Signed,
-                    c->memory(array, ir::Type::i2(), TargetArrayBody, index),
-                    ir::Type::i4()));
-        break;
+    case bipush: {
+      int8_t v = target->code()->body()[ip++];
+      if (emit) {
+        value = c->constant(v, ir::Type::i4());
       }
-    } break;
+    }
+      goto push;
 
-    case aastore:
-    case bastore:
-    case castore:
-    case dastore:
-    case fastore:
-    case iastore:
-    case lastore:
-    case sastore: {
-      ir::Value* value;
-      if (instruction == lastore) {
-        value = frame->popLarge(ir::Type::i8());
-      } else if (instruction == dastore) {
-        value = frame->popLarge(ir::Type::f8());
-      } else if (instruction == aastore) {
-        value = frame->pop(ir::Type::object());
-      } else if (instruction == fastore) {
-        value = frame->pop(ir::Type::f4());
-      } else {
-        value = frame->pop(ir::Type::i4());
+    case sipush: {
+      int16_t v = codeReadInt16(t, target->code(), ip);
+      if (emit) {
+        value = c->constant(v, ir::Type::i4());
       }
+    }
+      goto push;
 
-      ir::Value* index = frame->pop(ir::Type::i4());
-      ir::Value* array = frame->pop(ir::Type::object());
+    case iadd:
+    case iand:
+    case ior:
+    case ishl:
+    case ishr:
+    case iushr:
+    case isub:
+    case ixor:
+    case imul:
+    case ladd:
+    case land:
+    case lor:
+    case lsub:
+    case lxor:
+    case lmul: {
+      if (sp < 2) {
+        return false;
+      }
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
+      sp -= 2;
+      if (emit) {
+        value = c->binaryOp(toCompilerBinaryOp(t, instruction),
+                            stack[sp]->type,
+                            stack[sp + 1],
+                            stack[sp]);
       }
+    }
+      goto push;
 
-      if (CheckArrayBounds) {
-        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+    case ineg:
+    case lneg:
+    case i2b:
+    case i2c:
+    case i2s:
+    case i2l:
+    case l2i: {
+      if (sp < 1) {
+        return false;
       }
 
-      switch (instruction) {
-      case aastore: {
-        c->nativeCall(
-            c->constant(getThunk(t, setMaybeNullThunk), ir::Type::iptr()),
-            0,
-            frame->trace(0, 0),
-            ir::Type::void_(),
-            args(c->threadRegister(),
-                 array,
-                 c->binaryOp(lir::Add,
-                             ir::Type::i4(),
-                             c->constant(TargetArrayBody, ir::Type::i4()),
-                             c->binaryOp(lir::ShiftLeft,
-                                         ir::Type::i4(),
-                                         c->constant(log(TargetBytesPerWord),
-                                                     ir::Type::i4()),
-                                         index)),
-                 value));
-      } break;
+      --sp;
+      if (emit) {
+        switch (instruction) {
+        case ineg:
+        case lneg:
+          value = c->unaryOp(lir::Negate, stack[sp]);
+          break;
 
-      case fastore:
-        c->store(value,
-                 c->memory(array, ir::Type::f4(), TargetArrayBody, index));
-        break;
+        case i2b:
+          value = c->truncateThenExtend(ir::ExtendMode::Signed,
+                                        ir::Type::i4(),
+                                        ir::Type::i1(),
+                                        stack[sp]);
+          break;
 
-      case iastore:
-        c->store(value,
-                 c->memory(array, ir::Type::i4(), TargetArrayBody, index));
-        break;
+        case i2c:
+          value = c->truncateThenExtend(ir::ExtendMode::Unsigned,
+                                        ir::Type::i4(),
+                                        ir::Type::i2(),
+                                        stack[sp]);
+          break;
 
-      case bastore:
-        c->store(value,
-                 c->memory(array, ir::Type::i1(), TargetArrayBody, index));
-        break;
+        case i2s:
+          value = c->truncateThenExtend(ir::ExtendMode::Signed,
+                                        ir::Type::i4(),
+                                        ir::Type::i2(),
+                                        stack[sp]);
+          break;
 
-      case castore:
-      case sastore:
-        c->store(value,
-                 c->memory(array, ir::Type::i2(), TargetArrayBody, index));
-        break;
+        case i2l:
+          value = c->truncateThenExtend(ir::ExtendMode::Signed,
+                                        ir::Type::i8(),
+                                        ir::Type::i4(),
+                                        stack[sp]);
+          break;
 
-      case dastore:
-        c->store(value,
-                 c->memory(array, ir::Type::f8(), TargetArrayBody, index));
-        break;
+        case l2i:
+          value = c->truncate(ir::Type::i4(), stack[sp]);
+          break;
 
-      case lastore:
-        c->store(value,
-                 c->memory(array, ir::Type::i8(), TargetArrayBody, index));
-        break;
+        default:
+          abort(t);
+        }
       }
-    } break;
+    }
+      goto push;
 
-    case aconst_null:
-      frame->push(ir::Type::object(), c->constant(0, ir::Type::object()));
-      break;
+    case getfield:
+    case putfield: {
+      uint16_t index = codeReadInt16(t, target->code(), ip);
 
-    case aload:
-      frame->load(ir::Type::object(), code->body()[ip++]);
-      break;
+      GcField* field = resolveField(t, target, index - 1, false);
 
-    case aload_0:
-      frame->load(ir::Type::object(), 0);
-      break;
+      unsigned operands = (instruction == getfield ? 1 : 2);
+      if (field == 0 or (field->flags() & (ACC_STATIC | ACC_VOLATILE))
+          or (instruction == putfield and field->code() == ObjectField)
+          or sp < operands or not receiver[sp - operands]) {
+        return false;
+      }
 
-    case aload_1:
-      frame->load(ir::Type::object(), 1);
-      break;
+      sp -= operands;
+      if (emit) {
+        if (not dereferenced
+            and inTryBlock(t, context->method->code(), frame->ip)) {
+          c->saveLocals();
+          frame->trace(0, 0);
+        }
 
-    case aload_2:
-      frame->load(ir::Type::object(), 2);
-      break;
+        if (instruction == getfield) {
+          value = loadField(context, stack[sp], field);
+        } else {
+          c->store(stack[sp + 1],
+                   c->memory(stack[sp],
+                             storageTypeForFieldCode(t, field->code()),
+                             targetFieldOffset(context, field)));
+        }
+      }
 
-    case aload_3:
-      frame->load(ir::Type::object(), 3);
-      break;
+      dereferenced = true;
 
-    case anewarray: {
-      uint16_t index = codeReadInt16(t, code, ip);
+      if (instruction == getfield) {
+        goto push;
+      }
+    } break;
 
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+    case ireturn:
+    case lreturn:
+    case freturn:
+    case dreturn:
+    case areturn:
+    case return_: {
+      unsigned results = (instruction == return_ ? 0 : 1);
+      if (ip != target->code()->length() or sp != results
+          or not(isStatic or dereferenced)) {
+        return false;
+      }
 
-      PROTECT(t, reference);
+      if (emit and results) {
+        frame->pushReturnValue(target->returnCode(), stack[0]);
+      }
+    }
+      return true;
 
-      GcClass* class_
-          = resolveClassInPool(t, context->method, index - 1, false);
+    default:
+      return false;
 
-      ir::Value* length = frame->pop(ir::Type::i4());
+    push:
+      stack[sp] = value;
+      receiver[sp] = false;
+      ++sp;
+      break;
+    }
+  }
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = makeBlankObjectArrayThunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = makeBlankObjectArrayFromReferenceThunk;
-      }
+  return false;
+}
 
-      frame->push(
-          ir::Type::object(),
-          c->nativeCall(
-              c->constant(getThunk(t, thunk), ir::Type::iptr()),
-              0,
-              frame->trace(0, 0),
-              ir::Type::object(),
-              args(c->threadRegister(), frame->append(argument), length)));
-    } break;
+bool inlineMethod(MyThread* t, Frame* frame, GcMethod* target)
+{
+  if ((target->flags() & (ACC_NATIVE | ACC_ABSTRACT | ACC_SYNCHRONIZED))
+      or target->code()->length() > InlineBytecodeLimit
+      or target->parameterFootprint() > InlineBytecodeLimit
+      or target->code()->exceptionHandlerTable()
+      or needsReturnBarrier(t, target)
+      or classNeedsInit(t, target->class_())) {
+    return false;
+  }
 
-    case areturn: {
-      handleExit(t, frame);
-      c->return_(frame->pop(ir::Type::object()));
-    }
-      goto next;
+  return inlineBody(t, frame, target, false)
+         and inlineBody(t, frame, target, true);
+}
 
-    case arraylength: {
-      frame->push(ir::Type::i4(),
-                  c->load(ir::ExtendMode::Signed,
-                          c->memory(frame->pop(ir::Type::object()),
-                                    ir::Type::iptr(),
-                                    TargetArrayLength),
-                          ir::Type::i4()));
-    } break;
+uintptr_t aioobThunk(MyThread* t);
 
-    case astore:
-      frame->store(ir::Type::object(), code->body()[ip++]);
-      break;
+uintptr_t stackOverflowThunk(MyThread* t);
 
-    case astore_0:
-      frame->store(ir::Type::object(), 0);
-      break;
+void checkField(Thread* t, GcField* field, bool shouldBeStatic)
+{
+  if (((field->flags() & ACC_STATIC) == 0) == shouldBeStatic) {
+    throwNew(t,
+             GcIncompatibleClassChangeError::Type,
+             "expected %s.%s to be %s",
+             field->class_()->name()->body().begin(),
+             field->name()->body().begin(),
+             shouldBeStatic ? "static" : "non-static");
+  }
+}
 
-    case astore_1:
-      frame->store(ir::Type::object(), 1);
-      break;
+bool isLambda(Thread* t,
+              GcClassLoader* loader,
+              GcCharArray* bootstrapArray,
+              GcInvocation* invocation)
+{
+  GcMethod* bootstrap = cast<GcMethodHandle>(t,
+                                       resolve(t,
+                                               loader,
+                                               invocation->pool(),
+                                               bootstrapArray->body()[0],
+                                               findMethodInClass,
+                                               GcNoSuchMethodError::Type))->method();
+  PROTECT(t, bootstrap);
 
-    case astore_2:
-      frame->store(ir::Type::object(), 2);
-      break;
+  return vm::strcmp(reinterpret_cast<const int8_t*>(
+                        "java/lang/invoke/LambdaMetafactory"),
+                    bootstrap->class_()->name()->body().begin()) == 0
+         and ((vm::strcmp(reinterpret_cast<const int8_t*>("metafactory"),
+                          bootstrap->name()->body().begin()) == 0
+               and vm::strcmp(
+                       reinterpret_cast<const int8_t*>(
+                           "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/lang/"
+                           "String;Ljava/lang/invoke/MethodType;Ljava/lang/"
+                           "invoke/"
+                           "MethodType;Ljava/lang/invoke/MethodHandle;Ljava/"
+                           "lang/"
+                           "invoke/MethodType;)Ljava/lang/invoke/CallSite;"),
+                       bootstrap->spec()->body().begin()) == 0)
+              or (vm::strcmp(reinterpret_cast<const int8_t*>("altMetafactory"),
+                             bootstrap->name()->body().begin()) == 0
+                  and vm::strcmp(
+                          reinterpret_cast<const int8_t*>(
+                              "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/"
+                              "lang/"
+                              "String;Ljava/lang/invoke/MethodType;[Ljava/lang/"
+                              "Object;)Ljava/lang/invoke/CallSite;"),
+                          bootstrap->spec()->body().begin()) == 0));
+}
 
-    case astore_3:
-      frame->store(ir::Type::object(), 3);
-      break;
+void compile(MyThread* t,
+             Frame* initialFrame,
+             unsigned initialIp,
+             int exceptionHandlerStart = -1)
+{
+  enum {
+    Return,
+    Unbranch,
+    Unsubroutine,
+    Untable0,
+    Untable1,
+    Unswitch,
+    Unlookup
+  };
 
-    case athrow: {
-      ir::Value* target = frame->pop(ir::Type::object());
-      c->nativeCall(c->constant(getThunk(t, throw_Thunk), ir::Type::iptr()),
-                    Compiler::NoReturn,
-                    frame->trace(0, 0),
-                    ir::Type::void_(),
-                    args(c->threadRegister(), target));
+  Frame* frame = initialFrame;
+  avian::codegen::Compiler* c = frame->c;
+  Context* context = frame->context;
+  unsigned stackSize = context->method->code()->maxStack();
+  Stack stack(t);
+  unsigned ip = initialIp;
+  unsigned newIp;
+  stack.pushValue(Return);
 
-      c->nullaryOp(lir::Trap);
-    }
-      goto next;
+start:
+  ir::Type* stackMap
+      = static_cast<ir::Type*>(stack.push(stackSize * sizeof(ir::Type)));
+  frame = new (stack.push(sizeof(Frame))) Frame(frame, stackMap);
 
-    case bipush:
-      frame->push(
-          ir::Type::i4(),
-          c->constant(static_cast<int8_t>(code->body()[ip++]), ir::Type::i4()));
-      break;
+loop:
+  GcCode* code = context->method->code();
+  PROTECT(t, code);
 
-    case checkcast: {
-      uint16_t index = codeReadInt16(t, code, ip);
+  while (ip < code->length()) {
+    if (context->visitTable[frame->duplicatedIp(ip)]++) {
+      // we've already visited this part of the code
+      frame->visitLogicalIp(ip);
+      goto next;
+    }
 
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+    frame->startLogicalIp(ip);
 
-      PROTECT(t, reference);
+    if (exceptionHandlerStart >= 0) {
+      c->initLocalsFromLogicalIp(exceptionHandlerStart);
 
-      GcClass* class_
-          = resolveClassInPool(t, context->method, index - 1, false);
+      exceptionHandlerStart = -1;
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = checkCastThunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = checkCastFromReferenceThunk;
-      }
-
-      ir::Value* instance = c->peek(1, 0);
+      frame->pushObject();
 
       c->nativeCall(
-          c->constant(getThunk(t, thunk), ir::Type::iptr()),
+          c->constant(getThunk(t, gcIfNecessaryThunk), ir::Type::iptr()),
           0,
           frame->trace(0, 0),
           ir::Type::void_(),
-          args(c->threadRegister(), frame->append(argument), instance));
-    } break;
-
-    case d2f: {
-      frame->push(ir::Type::f4(),
-                  c->f2f(ir::Type::f4(), frame->popLarge(ir::Type::f8())));
-    } break;
-
-    case d2i: {
-      frame->push(ir::Type::i4(),
-                  c->f2i(ir::Type::i4(), frame->popLarge(ir::Type::f8())));
-    } break;
-
-    case d2l: {
-      frame->pushLarge(ir::Type::i8(),
-                       c->f2i(ir::Type::i8(), frame->popLarge(ir::Type::f8())));
-    } break;
+          args(c->threadRegister()));
+    }
 
-    case dadd:
-    case dsub:
-    case dmul:
-    case ddiv:
-    case vm::drem: {
-      ir::Value* a = frame->popLarge(ir::Type::f8());
-      ir::Value* b = frame->popLarge(ir::Type::f8());
+    if (DebugInstructions) {
+      unsigned startingIp = ip;
+      fprintf(stderr, " stack: [");
+      for (size_t i = frame->localSize(); i < frame->sp; i++) {
+        ir::Type ty = frame->get(i);
+        if (ty == ir::Type::i4()) {
+          fprintf(stderr, "I");
+        } else if (ty == ir::Type::i8()) {
+          fprintf(stderr, "L");
+        } else if (ty == ir::Type::f4()) {
+          fprintf(stderr, "F");
+        } else if (ty == ir::Type::f8()) {
+          fprintf(stderr, "D");
+        } else if (ty == ir::Type::object()) {
+          fprintf(stderr, "O");
+        } else {
+          fprintf(stderr, "?");
+        }
+      }
+      fprintf(stderr, "]\n");
+      fprintf(stderr, "% 5d: ", startingIp);
+      avian::jvm::debug::printInstruction(code->body().begin(), startingIp);
+      fprintf(stderr, "\n");
+    }
 
-      frame->pushLarge(
-          ir::Type::f8(),
-          c->binaryOp(
-              toCompilerBinaryOp(t, instruction), ir::Type::f8(), a, b));
-    } break;
+    unsigned instruction = code->body()[ip++];
 
-    case dcmpg: {
-      ir::Value* a = frame->popLarge(ir::Type::f8());
-      ir::Value* b = frame->popLarge(ir::Type::f8());
+    switch (instruction) {
+    case aaload:
+    case baload:
+    case caload:
+    case daload:
+    case faload:
+    case iaload:
+    case laload:
+    case saload: {
+      ir::Value* index = frame->pop(ir::Type::i4());
+      ir::Value* array = frame->pop(ir::Type::object());
 
-      if (floatBranch(t, frame, code, ip, false, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->push(ir::Type::i4(),
-                    c->nativeCall(c->constant(getThunk(t, compareDoublesGThunk),
-                                              ir::Type::iptr()),
-                                  0,
-                                  0,
-                                  ir::Type::i4(),
-                                  args(nullptr, a, nullptr, b)));
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
       }
-    } break;
-
-    case dcmpl: {
-      ir::Value* a = frame->popLarge(ir::Type::f8());
-      ir::Value* b = frame->popLarge(ir::Type::f8());
 
-      if (floatBranch(t, frame, code, ip, true, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->push(ir::Type::i4(),
-                    c->nativeCall(c->constant(getThunk(t, compareDoublesLThunk),
-                                              ir::Type::iptr()),
-                                  0,
-                                  0,
-                                  ir::Type::i4(),
-                                  args(nullptr, a, nullptr, b)));
+      if (CheckArrayBounds and not context->inBoundsTable[ip - 1]) {
+        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
       }
-    } break;
-
-    case dconst_0:
-      frame->pushLarge(ir::Type::f8(),
-                       c->constant(doubleToBits(0.0), ir::Type::f8()));
-      break;
-
-    case dconst_1:
-      frame->pushLarge(ir::Type::f8(),
-                       c->constant(doubleToBits(1.0), ir::Type::f8()));
-      break;
 
-    case dneg: {
-      frame->pushLarge(
-          ir::Type::f8(),
-          c->unaryOp(lir::FloatNegate, frame->popLarge(ir::Type::f8())));
-    } break;
+      switch (instruction) {
+      case aaload:
+        frame->push(
+            ir::Type::object(),
+            c->load(
+                ir::ExtendMode::Signed,
+                c->memory(array, ir::Type::object(), TargetArrayBody, index),
+                ir::Type::object()));
+        break;
 
-    case vm::dup:
-      frame->dup();
-      break;
+      case faload:
+        frame->push(
+            ir::Type::f4(),
+            c->load(ir::ExtendMode::Signed,
+                    c->memory(array, ir::Type::f4(), TargetArrayBody, index),
+                    ir::Type::f4()));
+        break;
 
-    case dup_x1:
-      frame->dupX1();
-      break;
+      case iaload:
+        frame->push(
+            ir::Type::i4(),
+            c->load(ir::ExtendMode::Signed,
+                    c->memory(array, ir::Type::i4(), TargetArrayBody, index),
+                    ir::Type::i4()));
+        break;
 
-    case dup_x2:
-      frame->dupX2();
-      break;
+      case baload:
+        frame->push(
+            ir::Type::i4(),
+            c->load(ir::ExtendMode::Signed,
+                    c->memory(array, ir::Type::i1(), TargetArrayBody, index),
+                    ir::Type::i4()));
+        break;
 
-    case vm::dup2:
-      frame->dup2();
-      break;
+      case caload:
+        frame->push(
+            ir::Type::i4(),
+            c->load(ir::ExtendMode::Unsigned,
+                    c->memory(array, ir::Type::i2(), TargetArrayBody, index),
+                    ir::Type::i4()));
+        break;
 
-    case dup2_x1:
-      frame->dup2X1();
-      break;
+      case daload:
+        frame->pushLarge(
+            ir::Type::f8(),
+            c->load(ir::ExtendMode::Signed,
+                    c->memory(array, ir::Type::f8(), TargetArrayBody, index),
+                    ir::Type::f8()));
+        break;
 
-    case dup2_x2:
-      frame->dup2X2();
-      break;
+      case laload:
+        frame->pushLarge(
+            ir::Type::i8(),
+            c->load(ir::ExtendMode::Signed,
+                    c->memory(array, ir::Type::i8(), TargetArrayBody, index),
+                    ir::Type::i8()));
+        break;
 
-    case f2d: {
-      frame->pushLarge(ir::Type::f8(),
-                       c->f2f(ir::Type::f8(), frame->pop(ir::Type::f4())));
+      case saload:
+        frame->push(
+            ir::Type::i4(),
+            c->load(ir::ExtendMode::Signed,
+                    c->memory(array, ir::Type::i2(), TargetArrayBody, index),
+                    ir::Type::i4()));
+        break;
+      }
     } break;
 
-    case f2i: {
-      frame->push(ir::Type::i4(),
-                  c->f2i(ir::Type::i4(), frame->pop(ir::Type::f4())));
-    } break;
+    case aastore:
+    case bastore:
+    case castore:
+    case dastore:
+    case fastore:
+    case iastore:
+    case lastore:
+    case sastore: {
+      ir::Value* value;
+      if (instruction == lastore) {
+        value = frame->popLarge(ir::Type::i8());
+      } else if (instruction == dastore) {
+        value = frame->popLarge(ir::Type::f8());
+      } else if (instruction == aastore) {
+        value = frame->pop(ir::Type::object());
+      } else if (instruction == fastore) {
+        value = frame->pop(ir::Type::f4());
+      } else {
+        value = frame->pop(ir::Type::i4());
+      }
 
-    case f2l: {
-      frame->pushLarge(ir::Type::i8(),
-                       c->f2i(ir::Type::i8(), frame->pop(ir::Type::f4())));
-    } break;
+      ir::Value* index = frame->pop(ir::Type::i4());
+      ir::Value* array = frame->pop(ir::Type::object());
 
-    case fadd:
-    case fsub:
-    case fmul:
-    case fdiv:
-    case frem: {
-      ir::Value* a = frame->pop(ir::Type::f4());
-      ir::Value* b = frame->pop(ir::Type::f4());
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
+      }
 
-      frame->push(
-          ir::Type::f4(),
-          c->binaryOp(
-              toCompilerBinaryOp(t, instruction), ir::Type::f4(), a, b));
-    } break;
+      if (CheckArrayBounds and not context->inBoundsTable[ip - 1]) {
+        c->checkBounds(array, TargetArrayLength, index, aioobThunk(t));
+      }
 
-    case fcmpg: {
-      ir::Value* a = frame->pop(ir::Type::f4());
-      ir::Value* b = frame->pop(ir::Type::f4());
+      switch (instruction) {
+      case aastore: {
+        // stores which the heap needn't hear of are made without
+        // calling out
+        c->nativeCall(
+            c->constant(getThunk(t, setMaybeNullThunk), ir::Type::iptr()),
+            Compiler::StoreBarrier,
+            frame->trace(0, 0),
+            ir::Type::void_(),
+            args(c->threadRegister(),
+                 array,
+                 c->binaryOp(lir::Add,
+                             ir::Type::i4(),
+                             c->constant(TargetArrayBody, ir::Type::i4()),
+                             c->binaryOp(lir::ShiftLeft,
+                                         ir::Type::i4(),
+                                         c->constant(log(TargetBytesPerWord),
+                                                     ir::Type::i4()),
+                                         index)),
+                 value));
+      } break;
 
-      if (floatBranch(t, frame, code, ip, false, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->push(ir::Type::i4(),
-                    c->nativeCall(c->constant(getThunk(t, compareFloatsGThunk),
-                                              ir::Type::iptr()),
-                                  0,
-                                  0,
-                                  ir::Type::i4(),
-                                  args(a, b)));
-      }
-    } break;
+      case fastore:
+        c->store(value,
+                 c->memory(array, ir::Type::f4(), TargetArrayBody, index));
+        break;
 
-    case fcmpl: {
-      ir::Value* a = frame->pop(ir::Type::f4());
-      ir::Value* b = frame->pop(ir::Type::f4());
+      case iastore:
+        c->store(value,
+                 c->memory(array, ir::Type::i4(), TargetArrayBody, index));
+        break;
 
-      if (floatBranch(t, frame, code, ip, true, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->push(ir::Type::i4(),
-                    c->nativeCall(c->constant(getThunk(t, compareFloatsLThunk),
-                                              ir::Type::iptr()),
-                                  0,
-                                  0,
-                                  ir::Type::i4(),
-                                  args(a, b)));
+      case bastore:
+        c->store(value,
+                 c->memory(array, ir::Type::i1(), TargetArrayBody, index));
+        break;
+
+      case castore:
+      case sastore:
+        c->store(value,
+                 c->memory(array, ir::Type::i2(), TargetArrayBody, index));
+        break;
+
+      case dastore:
+        c->store(value,
+                 c->memory(array, ir::Type::f8(), TargetArrayBody, index));
+        break;
+
+      case lastore:
+        c->store(value,
+                 c->memory(array, ir::Type::i8(), TargetArrayBody, index));
+        break;
       }
     } break;
 
-    case fconst_0:
-      frame->push(ir::Type::f4(),
-                  c->constant(floatToBits(0.0), ir::Type::f4()));
+    case aconst_null:
+      frame->push(ir::Type::object(), c->constant(0, ir::Type::object()));
       break;
 
-    case fconst_1:
-      frame->push(ir::Type::f4(),
-                  c->constant(floatToBits(1.0), ir::Type::f4()));
+    case aload:
+      frame->load(ir::Type::object(), code->body()[ip++]);
       break;
 
-    case fconst_2:
-      frame->push(ir::Type::f4(),
-                  c->constant(floatToBits(2.0), ir::Type::f4()));
+    case aload_0:
+      frame->load(ir::Type::object(), 0);
       break;
 
-    case fneg: {
-      frame->push(ir::Type::f4(),
-                  c->unaryOp(lir::FloatNegate, frame->pop(ir::Type::f4())));
-    } break;
+    case aload_1:
+      frame->load(ir::Type::object(), 1);
+      break;
 
-    case getfield:
-    case getstatic: {
+    case aload_2:
+      frame->load(ir::Type::object(), 2);
+      break;
+
+    case aload_3:
+      frame->load(ir::Type::object(), 3);
+      break;
+
+    case anewarray: {
       uint16_t index = codeReadInt16(t, code, ip);
 
       object reference
@@ -4650,436 +5803,307 @@ loop:
 
       PROTECT(t, reference);
 
-      GcField* field = resolveField(t, context->method, index - 1, false);
-
-      if (LIKELY(field)) {
-        if ((field->flags() & ACC_VOLATILE) and TargetBytesPerWord == 4
-            and (field->code() == DoubleField or field->code() == LongField)) {
-          PROTECT(t, field);
+      GcClass* class_
+          = resolveClassInPool(t, context->method, index - 1, false);
 
-          c->nativeCall(c->constant(getThunk(t, acquireMonitorForObjectThunk),
-                                    ir::Type::iptr()),
-                        0,
-                        frame->trace(0, 0),
-                        ir::Type::void_(),
-                        args(c->threadRegister(), frame->append(field)));
-        }
+      ir::Value* length = frame->pop(ir::Type::i4());
 
-        ir::Value* table;
+      object argument;
+      Thunk thunk;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = makeBlankObjectArrayThunk;
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = makeBlankObjectArrayFromReferenceThunk;
+      }
 
-        if (instruction == getstatic) {
-          checkField(t, field, true);
+      frame->push(
+          ir::Type::object(),
+          c->nativeCall(
+              c->constant(getThunk(t, thunk), ir::Type::iptr()),
+              0,
+              frame->trace(0, 0),
+              ir::Type::object(),
+              args(c->threadRegister(), frame->append(argument), length)));
+    } break;
 
-          PROTECT(t, field);
+    case areturn: {
+      handleExit(t, frame);
+      c->return_(frame->pop(ir::Type::object()));
+    }
+      goto next;
 
-          if (classNeedsInit(t, field->class_())) {
-            c->nativeCall(
-                c->constant(getThunk(t, tryInitClassThunk), ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                ir::Type::void_(),
-                args(c->threadRegister(), frame->append(field->class_())));
-          }
+    case arraylength: {
+      frame->push(ir::Type::i4(),
+                  c->load(ir::ExtendMode::Signed,
+                          c->memory(frame->pop(ir::Type::object()),
+                                    ir::Type::iptr(),
+                                    TargetArrayLength),
+                          ir::Type::i4()));
+    } break;
 
-          table = frame->append(field->class_()->staticTable());
-        } else {
-          checkField(t, field, false);
+    case astore:
+      frame->store(ir::Type::object(), code->body()[ip++]);
+      break;
 
-          table = frame->pop(ir::Type::object());
+    case astore_0:
+      frame->store(ir::Type::object(), 0);
+      break;
 
-          if (inTryBlock(t, code, ip - 3)) {
-            c->saveLocals();
-            frame->trace(0, 0);
-          }
-        }
+    case astore_1:
+      frame->store(ir::Type::object(), 1);
+      break;
 
-        switch (field->code()) {
-        case ByteField:
-        case BooleanField:
-          frame->push(ir::Type::i4(),
-                      c->load(ir::ExtendMode::Signed,
-                              c->memory(table,
-                                        ir::Type::i1(),
-                                        targetFieldOffset(context, field)),
-                              ir::Type::i4()));
-          break;
+    case astore_2:
+      frame->store(ir::Type::object(), 2);
+      break;
 
-        case CharField:
-          frame->push(ir::Type::i4(),
-                      c->load(ir::ExtendMode::Unsigned,
-                              c->memory(table,
-                                        ir::Type::i2(),
-                                        targetFieldOffset(context, field)),
-                              ir::Type::i4()));
-          break;
+    case astore_3:
+      frame->store(ir::Type::object(), 3);
+      break;
 
-        case ShortField:
-          frame->push(ir::Type::i4(),
-                      c->load(ir::ExtendMode::Signed,
-                              c->memory(table,
-                                        ir::Type::i2(),
-                                        targetFieldOffset(context, field)),
-                              ir::Type::i4()));
-          break;
+    case athrow: {
+      ir::Value* target = frame->pop(ir::Type::object());
+      c->nativeCall(c->constant(getThunk(t, throw_Thunk), ir::Type::iptr()),
+                    Compiler::NoReturn,
+                    frame->trace(0, 0),
+                    ir::Type::void_(),
+                    args(c->threadRegister(), target));
 
-        case FloatField:
-          frame->push(ir::Type::f4(),
-                      c->load(ir::ExtendMode::Signed,
-                              c->memory(table,
-                                        ir::Type::f4(),
-                                        targetFieldOffset(context, field)),
-                              ir::Type::f4()));
-          break;
+      c->nullaryOp(lir::Trap);
+    }
+      goto next;
 
-        case IntField:
-          frame->push(ir::Type::i4(),
-                      c->load(ir::ExtendMode::Signed,
-                              c->memory(table,
-                                        ir::Type::i4(),
-                                        targetFieldOffset(context, field)),
-                              ir::Type::i4()));
-          break;
+    case bipush:
+      frame->push(
+          ir::Type::i4(),
+          c->constant(static_cast<int8_t>(code->body()[ip++]), ir::Type::i4()));
+      break;
 
-        case DoubleField:
-          frame->pushLarge(ir::Type::f8(),
-                           c->load(ir::ExtendMode::Signed,
-                                   c->memory(table,
-                                             ir::Type::f8(),
-                                             targetFieldOffset(context, field)),
-                                   ir::Type::f8()));
-          break;
+    case checkcast: {
+      uint16_t index = codeReadInt16(t, code, ip);
 
-        case LongField:
-          frame->pushLarge(ir::Type::i8(),
-                           c->load(ir::ExtendMode::Signed,
-                                   c->memory(table,
-                                             ir::Type::i8(),
-                                             targetFieldOffset(context, field)),
-                                   ir::Type::i8()));
-          break;
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
 
-        case ObjectField:
-          frame->push(ir::Type::object(),
-                      c->load(ir::ExtendMode::Signed,
-                              c->memory(table,
-                                        ir::Type::object(),
-                                        targetFieldOffset(context, field)),
-                              ir::Type::object()));
-          break;
+      PROTECT(t, reference);
 
-        default:
-          abort(t);
-        }
+      GcClass* class_
+          = resolveClassInPool(t, context->method, index - 1, false);
 
-        if (field->flags() & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4 and (field->code() == DoubleField
-                                           or field->code() == LongField)) {
-            c->nativeCall(c->constant(getThunk(t, releaseMonitorForObjectThunk),
-                                      ir::Type::iptr()),
-                          0,
-                          frame->trace(0, 0),
-                          ir::Type::void_(),
-                          args(c->threadRegister(), frame->append(field)));
-          } else {
-            c->nullaryOp(lir::LoadBarrier);
-          }
-        }
+      object argument;
+      Thunk thunk;
+      unsigned flags;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = checkCastThunk;
+        // null and the exact class pass without calling out
+        flags = Compiler::ClassCheck;
       } else {
-        GcReference* ref = cast<GcReference>(t, reference);
-        PROTECT(t, ref);
-        int fieldCode = vm::fieldCode(t, ref->spec()->body()[0]);
-
-        GcPair* pair = makePair(t, context->method, reference);
-
-        ir::Type rType = operandTypeForFieldCode(t, fieldCode);
-
-        ir::Value* result;
-        if (instruction == getstatic) {
-          result = c->nativeCall(
-              c->constant(getThunk(t, getStaticFieldValueFromReferenceThunk),
-                          ir::Type::iptr()),
-              0,
-              frame->trace(0, 0),
-              rType,
-              args(c->threadRegister(), frame->append(pair)));
-        } else {
-          ir::Value* instance = frame->pop(ir::Type::object());
-
-          result = c->nativeCall(
-              c->constant(getThunk(t, getFieldValueFromReferenceThunk),
-                          ir::Type::iptr()),
-              0,
-              frame->trace(0, 0),
-              rType,
-              args(c->threadRegister(), frame->append(pair), instance));
-        }
-
-        frame->pushReturnValue(fieldCode, result);
+        argument = makePair(t, context->method, reference);
+        thunk = checkCastFromReferenceThunk;
+        flags = 0;
       }
-    } break;
-
-    case goto_: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      uint32_t newIp = (ip - 3) + offset;
-      assertT(t, newIp < code->length());
 
-      if (newIp <= ip) {
-        compileSafePoint(t, c, frame);
-      }
+      ir::Value* instance = c->peek(1, 0);
 
-      c->jmp(frame->machineIpValue(newIp));
-      ip = newIp;
+      c->nativeCall(
+          c->constant(getThunk(t, thunk), ir::Type::iptr()),
+          flags,
+          frame->trace(0, 0),
+          ir::Type::void_(),
+          args(c->threadRegister(), frame->append(argument), instance));
     } break;
 
-    case goto_w: {
-      uint32_t offset = codeReadInt32(t, code, ip);
-      uint32_t newIp = (ip - 5) + offset;
-      assertT(t, newIp < code->length());
-
-      if (newIp <= ip) {
-        compileSafePoint(t, c, frame);
-      }
-
-      c->jmp(frame->machineIpValue(newIp));
-      ip = newIp;
+    case d2f: {
+      frame->push(ir::Type::f4(),
+                  c->f2f(ir::Type::f4(), frame->popLarge(ir::Type::f8())));
     } break;
 
-    case i2b: {
+    case d2i: {
       frame->push(ir::Type::i4(),
-                  c->truncateThenExtend(ir::ExtendMode::Signed,
-                                        ir::Type::i4(),
-                                        ir::Type::i1(),
-                                        frame->pop(ir::Type::i4())));
+                  c->f2i(ir::Type::i4(), frame->popLarge(ir::Type::f8())));
     } break;
 
-    case i2c: {
-      frame->push(ir::Type::i4(),
-                  c->truncateThenExtend(ir::ExtendMode::Unsigned,
-                                        ir::Type::i4(),
-                                        ir::Type::i2(),
-                                        frame->pop(ir::Type::i4())));
+    case d2l: {
+      frame->pushLarge(ir::Type::i8(),
+                       c->f2i(ir::Type::i8(), frame->popLarge(ir::Type::f8())));
     } break;
 
-    case i2d: {
-      frame->pushLarge(ir::Type::f8(),
-                       c->i2f(ir::Type::f8(), frame->pop(ir::Type::i4())));
-    } break;
+    case dadd:
+    case dsub:
+    case dmul:
+    case ddiv:
+    case vm::drem: {
+      ir::Value* a = frame->popLarge(ir::Type::f8());
+      ir::Value* b = frame->popLarge(ir::Type::f8());
 
-    case i2f: {
-      frame->push(ir::Type::f4(),
-                  c->i2f(ir::Type::f4(), frame->pop(ir::Type::i4())));
+      frame->pushLarge(
+          ir::Type::f8(),
+          c->binaryOp(
+              toCompilerBinaryOp(t, instruction), ir::Type::f8(), a, b));
     } break;
 
-    case i2l:
-      frame->pushLarge(ir::Type::i8(),
-                       c->truncateThenExtend(ir::ExtendMode::Signed,
-                                             ir::Type::i8(),
-                                             ir::Type::i4(),
-                                             frame->pop(ir::Type::i4())));
-      break;
+    case dcmpg: {
+      ir::Value* a = frame->popLarge(ir::Type::f8());
+      ir::Value* b = frame->popLarge(ir::Type::f8());
 
-    case i2s: {
-      frame->push(ir::Type::i4(),
-                  c->truncateThenExtend(ir::ExtendMode::Signed,
-                                        ir::Type::i4(),
-                                        ir::Type::i2(),
-                                        frame->pop(ir::Type::i4())));
+      if (floatBranch(t, frame, code, ip, false, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->push(ir::Type::i4(),
+                    c->nativeCall(c->constant(getThunk(t, compareDoublesGThunk),
+                                              ir::Type::iptr()),
+                                  0,
+                                  0,
+                                  ir::Type::i4(),
+                                  args(nullptr, a, nullptr, b)));
+      }
     } break;
 
-    case iadd:
-    case iand:
-    case ior:
-    case ishl:
-    case ishr:
-    case iushr:
-    case isub:
-    case ixor:
-    case imul: {
-      ir::Value* a = frame->pop(ir::Type::i4());
-      ir::Value* b = frame->pop(ir::Type::i4());
-      frame->push(
-          ir::Type::i4(),
-          c->binaryOp(
-              toCompilerBinaryOp(t, instruction), ir::Type::i4(), a, b));
+    case dcmpl: {
+      ir::Value* a = frame->popLarge(ir::Type::f8());
+      ir::Value* b = frame->popLarge(ir::Type::f8());
+
+      if (floatBranch(t, frame, code, ip, true, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->push(ir::Type::i4(),
+                    c->nativeCall(c->constant(getThunk(t, compareDoublesLThunk),
+                                              ir::Type::iptr()),
+                                  0,
+                                  0,
+                                  ir::Type::i4(),
+                                  args(nullptr, a, nullptr, b)));
+      }
     } break;
 
-    case iconst_m1:
-      frame->push(ir::Type::i4(), c->constant(-1, ir::Type::i4()));
+    case dconst_0:
+      frame->pushLarge(ir::Type::f8(),
+                       c->constant(doubleToBits(0.0), ir::Type::f8()));
       break;
 
-    case iconst_0:
-      frame->push(ir::Type::i4(), c->constant(0, ir::Type::i4()));
+    case dconst_1:
+      frame->pushLarge(ir::Type::f8(),
+                       c->constant(doubleToBits(1.0), ir::Type::f8()));
       break;
 
-    case iconst_1:
-      frame->push(ir::Type::i4(), c->constant(1, ir::Type::i4()));
+    case dneg: {
+      frame->pushLarge(
+          ir::Type::f8(),
+          c->unaryOp(lir::FloatNegate, frame->popLarge(ir::Type::f8())));
+    } break;
+
+    case vm::dup:
+      frame->dup();
       break;
 
-    case iconst_2:
-      frame->push(ir::Type::i4(), c->constant(2, ir::Type::i4()));
+    case dup_x1:
+      frame->dupX1();
       break;
 
-    case iconst_3:
-      frame->push(ir::Type::i4(), c->constant(3, ir::Type::i4()));
+    case dup_x2:
+      frame->dupX2();
       break;
 
-    case iconst_4:
-      frame->push(ir::Type::i4(), c->constant(4, ir::Type::i4()));
+    case vm::dup2:
+      frame->dup2();
       break;
 
-    case iconst_5:
-      frame->push(ir::Type::i4(), c->constant(5, ir::Type::i4()));
+    case dup2_x1:
+      frame->dup2X1();
       break;
 
-    case idiv: {
-      ir::Value* a = frame->pop(ir::Type::i4());
-      ir::Value* b = frame->pop(ir::Type::i4());
+    case dup2_x2:
+      frame->dup2X2();
+      break;
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
-      }
+    case f2d: {
+      frame->pushLarge(ir::Type::f8(),
+                       c->f2f(ir::Type::f8(), frame->pop(ir::Type::f4())));
+    } break;
 
+    case f2i: {
       frame->push(ir::Type::i4(),
-                  c->binaryOp(lir::Divide, ir::Type::i4(), a, b));
+                  c->f2i(ir::Type::i4(), frame->pop(ir::Type::f4())));
     } break;
 
-    case if_acmpeq:
-    case if_acmpne: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assertT(t, newIp < code->length());
-
-      if (newIp <= ip) {
-        compileSafePoint(t, c, frame);
-      }
+    case f2l: {
+      frame->pushLarge(ir::Type::i8(),
+                       c->f2i(ir::Type::i8(), frame->pop(ir::Type::f4())));
+    } break;
 
-      ir::Value* a = frame->pop(ir::Type::object());
-      ir::Value* b = frame->pop(ir::Type::object());
-      ir::Value* target = frame->machineIpValue(newIp);
+    case fadd:
+    case fsub:
+    case fmul:
+    case fdiv:
+    case frem: {
+      ir::Value* a = frame->pop(ir::Type::f4());
+      ir::Value* b = frame->pop(ir::Type::f4());
 
-      c->condJump(toCompilerJumpOp(t, instruction), a, b, target);
-    }
-      goto branch;
+      frame->push(
+          ir::Type::f4(),
+          c->binaryOp(
+              toCompilerBinaryOp(t, instruction), ir::Type::f4(), a, b));
+    } break;
 
-    case if_icmpeq:
-    case if_icmpne:
-    case if_icmpgt:
-    case if_icmpge:
-    case if_icmplt:
-    case if_icmple: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assertT(t, newIp < code->length());
+    case fcmpg: {
+      ir::Value* a = frame->pop(ir::Type::f4());
+      ir::Value* b = frame->pop(ir::Type::f4());
 
-      if (newIp <= ip) {
-        compileSafePoint(t, c, frame);
+      if (floatBranch(t, frame, code, ip, false, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->push(ir::Type::i4(),
+                    c->nativeCall(c->constant(getThunk(t, compareFloatsGThunk),
+                                              ir::Type::iptr()),
+                                  0,
+                                  0,
+                                  ir::Type::i4(),
+                                  args(a, b)));
       }
+    } break;
 
-      ir::Value* a = frame->pop(ir::Type::i4());
-      ir::Value* b = frame->pop(ir::Type::i4());
-      ir::Value* target = frame->machineIpValue(newIp);
-
-      c->condJump(toCompilerJumpOp(t, instruction), a, b, target);
-    }
-      goto branch;
-
-    case ifeq:
-    case ifne:
-    case ifgt:
-    case ifge:
-    case iflt:
-    case ifle: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assertT(t, newIp < code->length());
-
-      ir::Value* target = frame->machineIpValue(newIp);
-
-      if (newIp <= ip) {
-        compileSafePoint(t, c, frame);
-      }
-
-      ir::Value* a = c->constant(0, ir::Type::i4());
-      ir::Value* b = frame->pop(ir::Type::i4());
-
-      c->condJump(toCompilerJumpOp(t, instruction), a, b, target);
-    }
-      goto branch;
-
-    case ifnull:
-    case ifnonnull: {
-      uint32_t offset = codeReadInt16(t, code, ip);
-      newIp = (ip - 3) + offset;
-      assertT(t, newIp < code->length());
+    case fcmpl: {
+      ir::Value* a = frame->pop(ir::Type::f4());
+      ir::Value* b = frame->pop(ir::Type::f4());
 
-      if (newIp <= ip) {
-        compileSafePoint(t, c, frame);
+      if (floatBranch(t, frame, code, ip, true, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->push(ir::Type::i4(),
+                    c->nativeCall(c->constant(getThunk(t, compareFloatsLThunk),
+                                              ir::Type::iptr()),
+                                  0,
+                                  0,
+                                  ir::Type::i4(),
+                                  args(a, b)));
       }
-
-      ir::Value* a = c->constant(0, ir::Type::object());
-      ir::Value* b = frame->pop(ir::Type::object());
-      ir::Value* target = frame->machineIpValue(newIp);
-
-      c->condJump(toCompilerJumpOp(t, instruction), a, b, target);
-    }
-      goto branch;
-
-    case iinc: {
-      uint8_t index = code->body()[ip++];
-      int8_t count = code->body()[ip++];
-
-      storeLocal(context,
-                 1,
-                 ir::Type::i4(),
-                 c->binaryOp(lir::Add,
-                             ir::Type::i4(),
-                             c->constant(count, ir::Type::i4()),
-                             loadLocal(context, 1, ir::Type::i4(), index)),
-                 index);
     } break;
 
-    case iload:
-      frame->load(ir::Type::i4(), code->body()[ip++]);
-      break;
-    case fload:
-      frame->load(ir::Type::f4(), code->body()[ip++]);
-      break;
-
-    case iload_0:
-      frame->load(ir::Type::i4(), 0);
-      break;
-    case fload_0:
-      frame->load(ir::Type::f4(), 0);
-      break;
-
-    case iload_1:
-      frame->load(ir::Type::i4(), 1);
-      break;
-    case fload_1:
-      frame->load(ir::Type::f4(), 1);
+    case fconst_0:
+      frame->push(ir::Type::f4(),
+                  c->constant(floatToBits(0.0), ir::Type::f4()));
       break;
 
-    case iload_2:
-      frame->load(ir::Type::i4(), 2);
-      break;
-    case fload_2:
-      frame->load(ir::Type::f4(), 2);
+    case fconst_1:
+      frame->push(ir::Type::f4(),
+                  c->constant(floatToBits(1.0), ir::Type::f4()));
       break;
 
-    case iload_3:
-      frame->load(ir::Type::i4(), 3);
-      break;
-    case fload_3:
-      frame->load(ir::Type::f4(), 3);
+    case fconst_2:
+      frame->push(ir::Type::f4(),
+                  c->constant(floatToBits(2.0), ir::Type::f4()));
       break;
 
-    case ineg: {
-      frame->push(ir::Type::i4(),
-                  c->unaryOp(lir::Negate, frame->pop(ir::Type::i4())));
+    case fneg: {
+      frame->push(ir::Type::f4(),
+                  c->unaryOp(lir::FloatNegate, frame->pop(ir::Type::f4())));
     } break;
 
-    case instanceof: {
+    case getfield:
+    case getstatic: {
       uint16_t index = codeReadInt16(t, code, ip);
 
       object reference
@@ -5087,346 +6111,358 @@ loop:
 
       PROTECT(t, reference);
 
-      GcClass* class_
-          = resolveClassInPool(t, context->method, index - 1, false);
-
-      ir::Value* instance = frame->pop(ir::Type::object());
+      GcField* field = resolveField(t, context->method, index - 1, false);
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = instanceOf64Thunk;
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = instanceOfFromReferenceThunk;
-      }
+      if (LIKELY(field)) {
+        // volatile longs and doubles on 32-bit targets are read by
+        // loadWide where possible, or else under the field's monitor
+        bool wideVolatile
+            = (field->flags() & ACC_VOLATILE) and TargetBytesPerWord == 4
+              and (field->code() == DoubleField or field->code() == LongField);
 
-      frame->push(
-          ir::Type::i4(),
-          c->nativeCall(
-              c->constant(getThunk(t, thunk), ir::Type::iptr()),
-              0,
-              frame->trace(0, 0),
-              ir::Type::i4(),
-              args(c->threadRegister(), frame->append(argument), instance)));
-    } break;
+        if (wideVolatile and LockWideVolatileFields) {
+          PROTECT(t, field);
 
-    case invokedynamic: {
-      context->leaf = false;
+          c->nativeCall(c->constant(getThunk(t, acquireMonitorForObjectThunk),
+                                    ir::Type::iptr()),
+                        0,
+                        frame->trace(0, 0),
+                        ir::Type::void_(),
+                        args(c->threadRegister(), frame->append(field)));
+        }
 
-      uint16_t poolIndex = codeReadInt16(t, code, ip);
-      ip += 2;
+        ir::Value* table;
 
-      GcInvocation* invocation = cast<GcInvocation>(
-          t,
-          singletonObject(t, context->method->code()->pool(), poolIndex - 1));
+        if (instruction == getstatic) {
+          checkField(t, field, true);
 
-      PROTECT(t, invocation);
+          PROTECT(t, field);
 
-      invocation->setClass(t, context->method->class_());
+          if (classNeedsInit(t, field->class_())) {
+            compileInitCheck(t, frame, field->class_());
+          }
 
-      BootContext* bc = context->bootContext;
-      if (bc) {
-        // When we're AOT-compiling an application, we can't handle
-        // invokedynamic in general, since it usually implies runtime
-        // code generation.  However, Java 8 lambda expressions are a
-        // special case for which we can generate code ahead of time.
-        //
-        // The only tricky part about it is that the class synthesis
-        // code resides in LambdaMetaFactory, which means we need to
-        // call out to a separate Java VM to execute it (the VM we're
-        // currently executing in won't work because it only knows how
-        // to compile code for the target machine, which might not be
-        // the same as the host; plus we don't want to pollute the
-        // runtime heap image with stuff that's only needed at compile
-        // time).
+          table = frame->append(field->class_()->staticTable());
+        } else {
+          checkField(t, field, false);
 
-        GcClass* c = context->method->class_();
-        PROTECT(t, c);
+          table = frame->pop(ir::Type::object());
 
-        // We use the second half of the bootstrap method table as a
-        // cache for already-synthesized lambdas:
-        GcMethod* target = cast<GcMethod>(
-            t, invocation->bootstrapMethodTable()
-                   ->body()[(invocation->bootstrapMethodTable()->length() / 2)
-                            + invocation->bootstrap()]);
-        PROTECT(t, target);
+          if (inTryBlock(t, code, ip - 3)) {
+            c->saveLocals();
+            frame->trace(0, 0);
+          }
+        }
 
-        if (target == nullptr) {
-          // Not cached, so now we need to synthesize it:
+        if (wideVolatile and not LockWideVolatileFields) {
+          frame->pushReturnValue(
+              field->code(),
+              c->nativeCall(
+                  c->constant(getThunk(t, getWideVolatileThunk),
+                              ir::Type::iptr()),
+                  0,
+                  frame->trace(0, 0),
+                  operandTypeForFieldCode(t, field->code()),
+                  args(c->threadRegister(),
+                       table,
+                       c->constant(targetFieldOffset(context, field),
+                                   ir::Type::i4()))));
+        } else {
+          frame->pushReturnValue(field->code(),
+                                 loadField(context, table, field));
+        }
 
-          GcCharArray* bootstrapArray = cast<GcCharArray>(
-              t, cast<GcArray>(t, invocation->bootstrapMethodTable())
-                     ->body()[invocation->bootstrap()]);
-          PROTECT(t, bootstrapArray);
+        if (field->flags() & ACC_VOLATILE) {
+          if (wideVolatile and LockWideVolatileFields) {
+            c->nativeCall(c->constant(getThunk(t, releaseMonitorForObjectThunk),
+                                      ir::Type::iptr()),
+                          0,
+                          frame->trace(0, 0),
+                          ir::Type::void_(),
+                          args(c->threadRegister(), frame->append(field)));
+          } else {
+            c->nullaryOp(lir::LoadBarrier);
+          }
+        }
+      } else {
+        GcReference* ref = cast<GcReference>(t, reference);
+        PROTECT(t, ref);
+        int fieldCode = vm::fieldCode(t, ref->spec()->body()[0]);
 
-          if (isLambda(t, c->loader(), bootstrapArray, invocation)) {
-            if (bc->hostVM == 0) {
-              throwNew(
-                  t,
-                  GcVirtualMachineError::Type,
-                  "lambda expression encountered, but host VM is not "
-                  "available; use -hostvm option to bootimage-generator to "
-                  "fix this");
-            }
+        GcPair* pair = makePair(t, context->method, reference);
 
-            JNIEnv* e;
-            if (bc->hostVM->vtable->AttachCurrentThread(bc->hostVM, &e, 0)
-                == 0) {
-              e->vtable->PushLocalFrame(e, 256);
+        ir::Type rType = operandTypeForFieldCode(t, fieldCode);
 
-              jclass lmfClass = e->vtable->FindClass(
-                  e, "java/lang/invoke/LambdaMetafactory");
-              jmethodID makeLambda
-                  = e->vtable->GetStaticMethodID(e,
-                                                 lmfClass,
-                                                 "makeLambda",
-                                                 "(Ljava/lang/String;"
-                                                 "Ljava/lang/String;"
-                                                 "Ljava/lang/String;"
-                                                 "Ljava/lang/String;"
-                                                 "Ljava/lang/String;"
-                                                 "Ljava/lang/String;"
-                                                 "I"
-                                                 ")[B");
+        ir::Value* result;
+        if (instruction == getstatic) {
+          result = c->nativeCall(
+              c->constant(getThunk(t, getStaticFieldValueFromReferenceThunk),
+                          ir::Type::iptr()),
+              0,
+              frame->trace(0, 0),
+              rType,
+              args(c->threadRegister(), frame->append(pair)));
+        } else {
+          ir::Value* instance = frame->pop(ir::Type::object());
 
-              GcMethodHandle* handle
-                  = cast<GcMethodHandle>(t,
-                                   resolve(t,
-                                           c->loader(),
-                                           invocation->pool(),
-                                           bootstrapArray->body()[2],
-                                           findMethodInClass,
-                                           GcNoSuchMethodError::Type));
+          result = c->nativeCall(
+              c->constant(getThunk(t, getFieldValueFromReferenceThunk),
+                          ir::Type::iptr()),
+              0,
+              frame->trace(0, 0),
+              rType,
+              args(c->threadRegister(), frame->append(pair), instance));
+        }
 
-              int kind = handle->kind();
+        frame->pushReturnValue(fieldCode, result);
+      }
+    } break;
 
-              GcMethod* method = handle->method();
+    case goto_: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      uint32_t newIp = (ip - 3) + offset;
+      assertT(t, newIp < code->length());
 
-              jarray lambda = e->vtable->CallStaticObjectMethod(
-                  e,
-                  lmfClass,
-                  makeLambda,
-                  e->vtable->NewStringUTF(
-                      e,
-                      reinterpret_cast<const char*>(
-                          invocation->template_()->name()->body().begin())),
-                  e->vtable->NewStringUTF(
-                      e,
-                      reinterpret_cast<const char*>(
-                          invocation->template_()->spec()->body().begin())),
-                  e->vtable->NewStringUTF(
-                      e,
-                      reinterpret_cast<const char*>(
-                          cast<GcByteArray>(
-                              t,
-                              singletonObject(t,
-                                              invocation->pool(),
-                                              bootstrapArray->body()[1]))
-                              ->body()
-                              .begin())),
-                  e->vtable->NewStringUTF(
-                      e,
-                      reinterpret_cast<const char*>(
-                          method->class_()->name()->body().begin())),
-                  e->vtable->NewStringUTF(e,
-                                          reinterpret_cast<const char*>(
-                                              method->name()->body().begin())),
-                  e->vtable->NewStringUTF(e,
-                                          reinterpret_cast<const char*>(
-                                              method->spec()->body().begin())),
-                  kind);
+      if (newIp <= ip) {
+        compileSafePoint(t, c, frame, frame->machineIpValue(newIp));
+      } else {
+        c->jmp(frame->machineIpValue(newIp));
+      }
+      ip = newIp;
+    } break;
 
-              uint8_t* bytes = reinterpret_cast<uint8_t*>(
-                  e->vtable->GetPrimitiveArrayCritical(e, lambda, 0));
+    case goto_w: {
+      uint32_t offset = codeReadInt32(t, code, ip);
+      uint32_t newIp = (ip - 5) + offset;
+      assertT(t, newIp < code->length());
 
-              GcClass* lambdaClass
-                  = defineClass(t,
-                                roots(t)->appLoader(),
-                                bytes,
-                                e->vtable->GetArrayLength(e, lambda));
+      if (newIp <= ip) {
+        compileSafePoint(t, c, frame, frame->machineIpValue(newIp));
+      } else {
+        c->jmp(frame->machineIpValue(newIp));
+      }
+      ip = newIp;
+    } break;
 
-              bc->resolver->addClass(
-                  t, lambdaClass, bytes, e->vtable->GetArrayLength(e, lambda));
+    case i2b: {
+      frame->push(ir::Type::i4(),
+                  c->truncateThenExtend(ir::ExtendMode::Signed,
+                                        ir::Type::i4(),
+                                        ir::Type::i1(),
+                                        frame->pop(ir::Type::i4())));
+    } break;
 
-              e->vtable->ReleasePrimitiveArrayCritical(e, lambda, bytes, 0);
+    case i2c: {
+      frame->push(ir::Type::i4(),
+                  c->truncateThenExtend(ir::ExtendMode::Unsigned,
+                                        ir::Type::i4(),
+                                        ir::Type::i2(),
+                                        frame->pop(ir::Type::i4())));
+    } break;
 
-              e->vtable->PopLocalFrame(e, 0);
+    case i2d: {
+      frame->pushLarge(ir::Type::f8(),
+                       c->i2f(ir::Type::f8(), frame->pop(ir::Type::i4())));
+    } break;
 
-              THREAD_RUNTIME_ARRAY(
-                  t, char, spec, invocation->template_()->spec()->length());
-              memcpy(RUNTIME_ARRAY_BODY(spec),
-                     invocation->template_()->spec()->body().begin(),
-                     invocation->template_()->spec()->length());
+    case i2f: {
+      frame->push(ir::Type::f4(),
+                  c->i2f(ir::Type::f4(), frame->pop(ir::Type::i4())));
+    } break;
 
-              target = resolveMethod(
-                  t, lambdaClass, "make", RUNTIME_ARRAY_BODY(spec));
+    case i2l:
+      frame->pushLarge(ir::Type::i8(),
+                       c->truncateThenExtend(ir::ExtendMode::Signed,
+                                             ir::Type::i8(),
+                                             ir::Type::i4(),
+                                             frame->pop(ir::Type::i4())));
+      break;
 
-              // Now cache it so we don't try to re-synthesize it
-              // later.
-              invocation->bootstrapMethodTable()->setBodyElement(
-                  t,
-                  (invocation->bootstrapMethodTable()->length() / 2)
-                      + invocation->bootstrap(),
-                  target);
-            } else {
-              throwNew(t,
-                       GcVirtualMachineError::Type,
-                       "unable to attach to host VM");
-            }
-          } else {
-            throwNew(t,
-                     GcVirtualMachineError::Type,
-                     "invokedynamic not supported for AOT-compiled code except "
-                     "in the case of lambda expressions");
-          }
-        }
+    case i2s: {
+      frame->push(ir::Type::i4(),
+                  c->truncateThenExtend(ir::ExtendMode::Signed,
+                                        ir::Type::i4(),
+                                        ir::Type::i2(),
+                                        frame->pop(ir::Type::i4())));
+    } break;
 
-        bool tailCall = isTailCall(t, code, ip, context->method, target);
-        compileDirectInvoke(t, frame, target, tailCall);
-      } else {
-        unsigned index = addDynamic(t, invocation);
+    case iadd:
+    case iand:
+    case ior:
+    case ishl:
+    case ishr:
+    case iushr:
+    case isub:
+    case ixor:
+    case imul: {
+      ir::Value* a = frame->pop(ir::Type::i4());
+      ir::Value* b = frame->pop(ir::Type::i4());
+      frame->push(
+          ir::Type::i4(),
+          c->binaryOp(
+              toCompilerBinaryOp(t, instruction), ir::Type::i4(), a, b));
+    } break;
 
-        GcMethod* template_ = invocation->template_();
-        unsigned returnCode = template_->returnCode();
-        unsigned rSize = resultSize(t, returnCode);
-        unsigned parameterFootprint = template_->parameterFootprint();
+    case iconst_m1:
+      frame->push(ir::Type::i4(), c->constant(-1, ir::Type::i4()));
+      break;
 
-        // TODO: can we allow tailCalls in general?
-        // e.g. what happens if the call site is later bound to a method that
-        // can't be tail called?
-        // NOTE: calling isTailCall right now would cause an segfault, since
-        // invocation->template_()->class_() will be null.
-        // bool tailCall
-        //     = isTailCall(t, code, ip, context->method,
-        //     invocation->template_());
-        bool tailCall = false;
+    case iconst_0:
+      frame->push(ir::Type::i4(), c->constant(0, ir::Type::i4()));
+      break;
 
-        // todo: do we need to tell the compiler to add a load barrier
-        // here for VolatileCallSite instances?
+    case iconst_1:
+      frame->push(ir::Type::i4(), c->constant(1, ir::Type::i4()));
+      break;
 
-        ir::Value* result
-            = c->stackCall(c->memory(c->memory(c->threadRegister(),
-                                               ir::Type::object(),
-                                               TARGET_THREAD_DYNAMICTABLE),
-                                     ir::Type::object(),
-                                     index * TargetBytesPerWord),
-                           tailCall ? Compiler::TailJump : 0,
-                           frame->trace(0, 0),
-                           operandTypeForFieldCode(t, returnCode),
-                           frame->peekMethodArguments(parameterFootprint));
+    case iconst_2:
+      frame->push(ir::Type::i4(), c->constant(2, ir::Type::i4()));
+      break;
 
-        frame->popFootprint(parameterFootprint);
+    case iconst_3:
+      frame->push(ir::Type::i4(), c->constant(3, ir::Type::i4()));
+      break;
 
-        if (rSize) {
-          frame->pushReturnValue(returnCode, result);
-        }
+    case iconst_4:
+      frame->push(ir::Type::i4(), c->constant(4, ir::Type::i4()));
+      break;
+
+    case iconst_5:
+      frame->push(ir::Type::i4(), c->constant(5, ir::Type::i4()));
+      break;
+
+    case idiv: {
+      ir::Value* a = frame->pop(ir::Type::i4());
+      ir::Value* b = frame->pop(ir::Type::i4());
+
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
       }
+
+      frame->push(ir::Type::i4(),
+                  c->binaryOp(lir::Divide, ir::Type::i4(), a, b));
     } break;
 
-    case invokeinterface: {
-      context->leaf = false;
+    case if_acmpeq:
+    case if_acmpne: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assertT(t, newIp < code->length());
 
-      uint16_t index = codeReadInt16(t, code, ip);
-      ip += 2;
+      ir::Value* a = frame->pop(ir::Type::object());
+      ir::Value* b = frame->pop(ir::Type::object());
 
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+      compileConditionalBranch(
+          t, frame, toCompilerJumpOp(t, instruction), a, b, ip, newIp);
+    }
+      goto branch;
 
-      PROTECT(t, reference);
+    case if_icmpeq:
+    case if_icmpne:
+    case if_icmpgt:
+    case if_icmpge:
+    case if_icmplt:
+    case if_icmple: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assertT(t, newIp < code->length());
 
-      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
+      ir::Value* a = frame->pop(ir::Type::i4());
+      ir::Value* b = frame->pop(ir::Type::i4());
 
-      object argument;
-      Thunk thunk;
-      unsigned parameterFootprint;
-      int returnCode;
-      bool tailCall;
-      if (LIKELY(target)) {
-        checkMethod(t, target, false);
+      compileConditionalBranch(
+          t, frame, toCompilerJumpOp(t, instruction), a, b, ip, newIp);
+    }
+      goto branch;
 
-        argument = target;
-        thunk = findInterfaceMethodFromInstanceThunk;
-        parameterFootprint = target->parameterFootprint();
-        returnCode = target->returnCode();
-        tailCall = isTailCall(t, code, ip, context->method, target);
-      } else {
-        GcReference* ref = cast<GcReference>(t, reference);
-        PROTECT(t, ref);
-        argument = makePair(t, context->method, reference);
-        thunk = findInterfaceMethodFromInstanceAndReferenceThunk;
-        parameterFootprint = methodReferenceParameterFootprint(t, ref, false);
-        returnCode = methodReferenceReturnCode(t, ref);
-        tailCall = isReferenceTailCall(t, code, ip, context->method, ref);
-      }
+    case ifeq:
+    case ifne:
+    case ifgt:
+    case ifge:
+    case iflt:
+    case ifle: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assertT(t, newIp < code->length());
 
-      unsigned rSize = resultSize(t, returnCode);
+      ir::Value* a = c->constant(0, ir::Type::i4());
+      ir::Value* b = frame->pop(ir::Type::i4());
 
-      ir::Value* result = c->stackCall(
-          c->nativeCall(c->constant(getThunk(t, thunk), ir::Type::iptr()),
-                        0,
-                        frame->trace(0, 0),
-                        ir::Type::iptr(),
-                        args(c->threadRegister(),
-                             frame->append(argument),
-                             c->peek(1, parameterFootprint - 1))),
-          tailCall ? Compiler::TailJump : 0,
-          frame->trace(0, 0),
-          operandTypeForFieldCode(t, returnCode),
-          frame->peekMethodArguments(parameterFootprint));
+      compileConditionalBranch(
+          t, frame, toCompilerJumpOp(t, instruction), a, b, ip, newIp);
+    }
+      goto branch;
 
-      frame->popFootprint(parameterFootprint);
+    case ifnull:
+    case ifnonnull: {
+      uint32_t offset = codeReadInt16(t, code, ip);
+      newIp = (ip - 3) + offset;
+      assertT(t, newIp < code->length());
 
-      if (rSize) {
-        frame->pushReturnValue(returnCode, result);
-      }
-    } break;
+      ir::Value* a = c->constant(0, ir::Type::object());
+      ir::Value* b = frame->pop(ir::Type::object());
 
-    case invokespecial: {
-      context->leaf = false;
+      compileConditionalBranch(
+          t, frame, toCompilerJumpOp(t, instruction), a, b, ip, newIp);
+    }
+      goto branch;
 
-      uint16_t index = codeReadInt16(t, code, ip);
+    case iinc: {
+      uint8_t index = code->body()[ip++];
+      int8_t count = code->body()[ip++];
 
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+      storeLocal(context,
+                 1,
+                 ir::Type::i4(),
+                 c->binaryOp(lir::Add,
+                             ir::Type::i4(),
+                             c->constant(count, ir::Type::i4()),
+                             loadLocal(context, 1, ir::Type::i4(), index)),
+                 index);
+    } break;
 
-      PROTECT(t, reference);
+    case iload:
+      frame->load(ir::Type::i4(), code->body()[ip++]);
+      break;
+    case fload:
+      frame->load(ir::Type::f4(), code->body()[ip++]);
+      break;
 
-      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
+    case iload_0:
+      frame->load(ir::Type::i4(), 0);
+      break;
+    case fload_0:
+      frame->load(ir::Type::f4(), 0);
+      break;
 
-      if (LIKELY(target)) {
-        GcClass* class_ = context->method->class_();
-        if (isSpecialMethod(t, target, class_)) {
-          target = findVirtualMethod(t, target, class_->super());
-        }
+    case iload_1:
+      frame->load(ir::Type::i4(), 1);
+      break;
+    case fload_1:
+      frame->load(ir::Type::f4(), 1);
+      break;
 
-        checkMethod(t, target, false);
+    case iload_2:
+      frame->load(ir::Type::i4(), 2);
+      break;
+    case fload_2:
+      frame->load(ir::Type::f4(), 2);
+      break;
 
-        bool tailCall = isTailCall(t, code, ip, context->method, target);
+    case iload_3:
+      frame->load(ir::Type::i4(), 3);
+      break;
+    case fload_3:
+      frame->load(ir::Type::f4(), 3);
+      break;
 
-        if (UNLIKELY(methodAbstract(t, target))) {
-          compileDirectAbstractInvoke(
-              t, frame, getMethodAddressThunk, target, tailCall);
-        } else {
-          compileDirectInvoke(t, frame, target, tailCall);
-        }
-      } else {
-        GcReference* ref = cast<GcReference>(t, reference);
-        PROTECT(t, ref);
-        compileDirectReferenceInvoke(
-            t,
-            frame,
-            findSpecialMethodFromReferenceThunk,
-            ref,
-            false,
-            isReferenceTailCall(t, code, ip, context->method, ref));
-      }
+    case ineg: {
+      frame->push(ir::Type::i4(),
+                  c->unaryOp(lir::Negate, frame->pop(ir::Type::i4())));
     } break;
 
-    case invokestatic: {
-      context->leaf = false;
-
+    case instanceof: {
       uint16_t index = codeReadInt16(t, code, ip);
 
       object reference
@@ -5434,1877 +6470,3573 @@ loop:
 
       PROTECT(t, reference);
 
-      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
+      GcClass* class_
+          = resolveClassInPool(t, context->method, index - 1, false);
 
-      if (LIKELY(target)) {
-        checkMethod(t, target, true);
+      ir::Value* instance = frame->pop(ir::Type::object());
 
-        if (not intrinsic(t, frame, target)) {
-          bool tailCall = isTailCall(t, code, ip, context->method, target);
-          compileDirectInvoke(t, frame, target, tailCall);
-        }
+      object argument;
+      Thunk thunk;
+      unsigned flags;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = instanceOf64Thunk;
+        flags = Compiler::ClassCheck;
       } else {
-        GcReference* ref = cast<GcReference>(t, reference);
-        PROTECT(t, ref);
-        compileDirectReferenceInvoke(
-            t,
-            frame,
-            findStaticMethodFromReferenceThunk,
-            ref,
-            true,
-            isReferenceTailCall(t, code, ip, context->method, ref));
+        argument = makePair(t, context->method, reference);
+        thunk = instanceOfFromReferenceThunk;
+        flags = 0;
       }
+
+      frame->push(
+          ir::Type::i4(),
+          c->nativeCall(
+              c->constant(getThunk(t, thunk), ir::Type::iptr()),
+              flags,
+              frame->trace(0, 0),
+              ir::Type::i4(),
+              args(c->threadRegister(), frame->append(argument), instance)));
     } break;
 
-    case invokevirtual: {
+    case invokedynamic: {
       context->leaf = false;
 
-      uint16_t index = codeReadInt16(t, code, ip);
-
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+      uint16_t poolIndex = codeReadInt16(t, code, ip);
+      ip += 2;
 
-      PROTECT(t, reference);
+      GcInvocation* invocation = cast<GcInvocation>(
+          t,
+          singletonObject(t, context->method->code()->pool(), poolIndex - 1));
 
-      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
+      PROTECT(t, invocation);
 
-      if (LIKELY(target)) {
-        checkMethod(t, target, false);
+      invocation->setClass(t, context->method->class_());
 
-        if (not intrinsic(t, frame, target)) {
-          bool tailCall = isTailCall(t, code, ip, context->method, target);
+      BootContext* bc = context->bootContext;
+      if (bc) {
+        // When we're AOT-compiling an application, we can't handle
+        // invokedynamic in general, since it usually implies runtime
+        // code generation.  However, Java 8 lambda expressions are a
+        // special case for which we can generate code ahead of time.
+        //
+        // The only tricky part about it is that the class synthesis
+        // code resides in LambdaMetaFactory, which means we need to
+        // call out to a separate Java VM to execute it (the VM we're
+        // currently executing in won't work because it only knows how
+        // to compile code for the target machine, which might not be
+        // the same as the host; plus we don't want to pollute the
+        // runtime heap image with stuff that's only needed at compile
+        // time).
 
-          if (LIKELY(methodVirtual(t, target))) {
-            unsigned parameterFootprint = target->parameterFootprint();
+        GcClass* c = context->method->class_();
+        PROTECT(t, c);
 
-            unsigned offset = TargetClassVtable
-                              + (target->offset() * TargetBytesPerWord);
+        // We use the second half of the bootstrap method table as a
+        // cache for already-synthesized lambdas:
+        GcMethod* target = cast<GcMethod>(
+            t, invocation->bootstrapMethodTable()
+                   ->body()[(invocation->bootstrapMethodTable()->length() / 2)
+                            + invocation->bootstrap()]);
+        PROTECT(t, target);
 
-            ir::Value* instance = c->peek(1, parameterFootprint - 1);
+        if (target == nullptr) {
+          // Not cached, so now we need to synthesize it:
 
-            frame->stackCall(
-                c->memory(c->binaryOp(
-                              lir::And,
-                              ir::Type::iptr(),
-                              c->constant(TargetPointerMask, ir::Type::iptr()),
-                              c->memory(instance, ir::Type::object())),
-                          ir::Type::object(),
-                          offset),
-                target,
-                tailCall ? Compiler::TailJump : 0,
-                frame->trace(0, 0));
-          } else {
-            // OpenJDK generates invokevirtual calls to private methods
-            // (e.g. readObject and writeObject for serialization), so
-            // we must handle such cases here.
+          GcCharArray* bootstrapArray = cast<GcCharArray>(
+              t, cast<GcArray>(t, invocation->bootstrapMethodTable())
+                     ->body()[invocation->bootstrap()]);
+          PROTECT(t, bootstrapArray);
 
-            compileDirectInvoke(t, frame, target, tailCall);
-          }
-        }
-      } else {
-        GcReference* ref = cast<GcReference>(t, reference);
-        PROTECT(t, reference);
-        PROTECT(t, ref);
+          if (isLambda(t, c->loader(), bootstrapArray, invocation)) {
+            if (bc->hostVM == 0) {
+              throwNew(
+                  t,
+                  GcVirtualMachineError::Type,
+                  "lambda expression encountered, but host VM is not "
+                  "available; use -hostvm option to bootimage-generator to "
+                  "fix this");
+            }
 
-        GcPair* pair = makePair(t, context->method, reference);
+            JNIEnv* e;
+            if (bc->hostVM->vtable->AttachCurrentThread(bc->hostVM, &e, 0)
+                == 0) {
+              e->vtable->PushLocalFrame(e, 256);
 
-        compileReferenceInvoke(
-            frame,
-            c->nativeCall(
-                c->constant(getThunk(t, findVirtualMethodFromReferenceThunk),
-                            ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                ir::Type::iptr(),
-                args(c->threadRegister(),
-                     frame->append(pair),
-                     c->peek(1,
-                             methodReferenceParameterFootprint(t, ref, false)
-                             - 1))),
-            ref,
-            false,
-            isReferenceTailCall(t, code, ip, context->method, ref));
-      }
-    } break;
+              jclass lmfClass = e->vtable->FindClass(
+                  e, "java/lang/invoke/LambdaMetafactory");
+              jmethodID makeLambda
+                  = e->vtable->GetStaticMethodID(e,
+                                                 lmfClass,
+                                                 "makeLambda",
+                                                 "(Ljava/lang/String;"
+                                                 "Ljava/lang/String;"
+                                                 "Ljava/lang/String;"
+                                                 "Ljava/lang/String;"
+                                                 "Ljava/lang/String;"
+                                                 "Ljava/lang/String;"
+                                                 "I"
+                                                 ")[B");
 
-    case irem: {
-      ir::Value* a = frame->pop(ir::Type::i4());
-      ir::Value* b = frame->pop(ir::Type::i4());
+              GcMethodHandle* handle
+                  = cast<GcMethodHandle>(t,
+                                   resolve(t,
+                                           c->loader(),
+                                           invocation->pool(),
+                                           bootstrapArray->body()[2],
+                                           findMethodInClass,
+                                           GcNoSuchMethodError::Type));
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
-      }
+              int kind = handle->kind();
 
-      frame->push(ir::Type::i4(),
-                  c->binaryOp(lir::Remainder, ir::Type::i4(), a, b));
-    } break;
+              GcMethod* method = handle->method();
 
-    case ireturn: {
-      handleExit(t, frame);
-      c->return_(frame->pop(ir::Type::i4()));
-    }
-      goto next;
+              jarray lambda = e->vtable->CallStaticObjectMethod(
+                  e,
+                  lmfClass,
+                  makeLambda,
+                  e->vtable->NewStringUTF(
+                      e,
+                      reinterpret_cast<const char*>(
+                          invocation->template_()->name()->body().begin())),
+                  e->vtable->NewStringUTF(
+                      e,
+                      reinterpret_cast<const char*>(
+                          invocation->template_()->spec()->body().begin())),
+                  e->vtable->NewStringUTF(
+                      e,
+                      reinterpret_cast<const char*>(
+                          cast<GcByteArray>(
+                              t,
+                              singletonObject(t,
+                                              invocation->pool(),
+                                              bootstrapArray->body()[1]))
+                              ->body()
+                              .begin())),
+                  e->vtable->NewStringUTF(
+                      e,
+                      reinterpret_cast<const char*>(
+                          method->class_()->name()->body().begin())),
+                  e->vtable->NewStringUTF(e,
+                                          reinterpret_cast<const char*>(
+                                              method->name()->body().begin())),
+                  e->vtable->NewStringUTF(e,
+                                          reinterpret_cast<const char*>(
+                                              method->spec()->body().begin())),
+                  kind);
 
-    case freturn: {
-      handleExit(t, frame);
-      c->return_(frame->pop(ir::Type::f4()));
-    }
-      goto next;
+              uint8_t* bytes = reinterpret_cast<uint8_t*>(
+                  e->vtable->GetPrimitiveArrayCritical(e, lambda, 0));
 
-    case istore:
-      frame->store(ir::Type::i4(), code->body()[ip++]);
-      break;
-    case fstore:
-      frame->store(ir::Type::f4(), code->body()[ip++]);
-      break;
+              GcClass* lambdaClass
+                  = defineClass(t,
+                                roots(t)->appLoader(),
+                                bytes,
+                                e->vtable->GetArrayLength(e, lambda));
 
-    case istore_0:
-      frame->store(ir::Type::i4(), 0);
-      break;
-    case fstore_0:
-      frame->store(ir::Type::f4(), 0);
-      break;
+              bc->resolver->addClass(
+                  t, lambdaClass, bytes, e->vtable->GetArrayLength(e, lambda));
 
-    case istore_1:
-      frame->store(ir::Type::i4(), 1);
-      break;
-    case fstore_1:
-      frame->store(ir::Type::f4(), 1);
-      break;
+              e->vtable->ReleasePrimitiveArrayCritical(e, lambda, bytes, 0);
 
-    case istore_2:
-      frame->store(ir::Type::i4(), 2);
-      break;
-    case fstore_2:
-      frame->store(ir::Type::f4(), 2);
-      break;
+              e->vtable->PopLocalFrame(e, 0);
 
-    case istore_3:
-      frame->store(ir::Type::i4(), 3);
-      break;
-    case fstore_3:
-      frame->store(ir::Type::f4(), 3);
-      break;
+              THREAD_RUNTIME_ARRAY(
+                  t, char, spec, invocation->template_()->spec()->length());
+              memcpy(RUNTIME_ARRAY_BODY(spec),
+                     invocation->template_()->spec()->body().begin(),
+                     invocation->template_()->spec()->length());
 
-    case jsr:
-    case jsr_w: {
-      uint32_t thisIp;
+              target = resolveMethod(
+                  t, lambdaClass, "make", RUNTIME_ARRAY_BODY(spec));
 
-      if (instruction == jsr) {
-        uint32_t offset = codeReadInt16(t, code, ip);
-        thisIp = ip - 3;
-        newIp = thisIp + offset;
+              // Now cache it so we don't try to re-synthesize it
+              // later.
+              invocation->bootstrapMethodTable()->setBodyElement(
+                  t,
+                  (invocation->bootstrapMethodTable()->length() / 2)
+                      + invocation->bootstrap(),
+                  target);
+            } else {
+              throwNew(t,
+                       GcVirtualMachineError::Type,
+                       "unable to attach to host VM");
+            }
+          } else {
+            throwNew(t,
+                     GcVirtualMachineError::Type,
+                     "invokedynamic not supported for AOT-compiled code except "
+                     "in the case of lambda expressions");
+          }
+        }
+
+        bool tailCall = isTailCall(t, code, ip, context->method, target);
+        compileDirectInvoke(t, frame, target, tailCall);
+      } else if (invocation->site()
+                 and (invocation->site()->target()->method()->flags()
+                      & ACC_NATIVE) == 0) {
+        // the site was linked before we got here (e.g. by another
+        // instruction sharing the constant pool entry), and call sites
+        // never change their targets, so we can call the target
+        // directly
+        compileDirectInvoke(
+            t, frame, invocation->site()->target()->method(), false);
       } else {
-        uint32_t offset = codeReadInt32(t, code, ip);
-        thisIp = ip - 5;
-        newIp = thisIp + offset;
-      }
+        unsigned index = addDynamic(t, invocation);
 
-      assertT(t, newIp < code->length());
+        GcMethod* template_ = invocation->template_();
+        unsigned returnCode = template_->returnCode();
+        unsigned rSize = resultSize(t, returnCode);
+        unsigned parameterFootprint = template_->parameterFootprint();
 
-      frame->startSubroutine(newIp, ip);
+        // TODO: can we allow tailCalls in general?
+        // e.g. what happens if the call site is later bound to a method that
+        // can't be tail called?
+        // NOTE: calling isTailCall right now would cause an segfault, since
+        // invocation->template_()->class_() will be null.
+        // bool tailCall
+        //     = isTailCall(t, code, ip, context->method,
+        //     invocation->template_());
+        bool tailCall = false;
 
-      c->jmp(frame->machineIpValue(newIp));
+        // We call the site's thunk directly, and linkDynamicMethod2
+        // patches the call to go straight to the target once the site
+        // is linked, so the call needs to be aligned to make that
+        // safe.
+        uintptr_t thunk = compileRoots(t)->dynamicThunks()->body()[index * 2];
+
+        unsigned flags = (tailCall ? Compiler::TailJump : 0)
+                         | Compiler::Aligned;
+        unsigned traceFlags = 0;
+        if (useLongJump(t, thunk)) {
+          flags |= Compiler::LongJumpOrCall;
+          traceFlags |= TraceElement::LongCall;
+        }
 
-      ip = newIp;
-    } break;
+        ir::Value* result
+            = c->stackCall(c->constant(thunk, ir::Type::iptr()),
+                           flags,
+                           frame->trace(0, traceFlags),
+                           operandTypeForFieldCode(t, returnCode),
+                           frame->peekMethodArguments(parameterFootprint));
 
-    case l2d: {
-      frame->pushLarge(ir::Type::f8(),
-                       c->i2f(ir::Type::f8(), frame->popLarge(ir::Type::i8())));
-    } break;
+        frame->popFootprint(parameterFootprint);
 
-    case l2f: {
-      frame->push(ir::Type::f4(),
-                  c->i2f(ir::Type::f4(), frame->popLarge(ir::Type::i8())));
+        if (rSize) {
+          frame->pushReturnValue(returnCode, result);
+        }
+      }
     } break;
 
-    case l2i:
-      frame->push(ir::Type::i4(),
-                  c->truncate(ir::Type::i4(), frame->popLarge(ir::Type::i8())));
-      break;
-
-    case ladd:
-    case land:
-    case lor:
-    case lsub:
-    case lxor:
-    case lmul: {
-      ir::Value* a = frame->popLarge(ir::Type::i8());
-      ir::Value* b = frame->popLarge(ir::Type::i8());
-      frame->pushLarge(
-          ir::Type::i8(),
-          c->binaryOp(
-              toCompilerBinaryOp(t, instruction), ir::Type::i8(), a, b));
-    } break;
+    case invokeinterface: {
+      context->leaf = false;
 
-    case lcmp: {
-      ir::Value* a = frame->popLarge(ir::Type::i8());
-      ir::Value* b = frame->popLarge(ir::Type::i8());
+      uint16_t index = codeReadInt16(t, code, ip);
+      ip += 2;
 
-      if (integerBranch(t, frame, code, ip, a, b, &newIp)) {
-        goto branch;
-      } else {
-        frame->push(ir::Type::i4(),
-                    c->nativeCall(c->constant(getThunk(t, compareLongsThunk),
-                                              ir::Type::iptr()),
-                                  0,
-                                  0,
-                                  ir::Type::i4(),
-                                  args(nullptr, a, nullptr, b)));
-      }
-    } break;
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
 
-    case lconst_0:
-      frame->pushLarge(ir::Type::i8(), c->constant(0, ir::Type::i8()));
-      break;
+      PROTECT(t, reference);
 
-    case lconst_1:
-      frame->pushLarge(ir::Type::i8(), c->constant(1, ir::Type::i8()));
-      break;
+      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
 
-    case ldc:
-    case ldc_w: {
-      uint16_t index;
+      object argument;
+      Thunk thunk;
+      unsigned parameterFootprint;
+      int returnCode;
+      bool tailCall;
+      if (LIKELY(target)) {
+        checkMethod(t, target, false);
 
-      if (instruction == ldc) {
-        index = code->body()[ip++];
+        argument = target;
+        thunk = findInterfaceMethodFromInstanceThunk;
+        parameterFootprint = target->parameterFootprint();
+        returnCode = target->returnCode();
+        tailCall = isTailCall(t, code, ip, context->method, target);
       } else {
-        index = codeReadInt16(t, code, ip);
+        GcReference* ref = cast<GcReference>(t, reference);
+        PROTECT(t, ref);
+        argument = makePair(t, context->method, reference);
+        thunk = findInterfaceMethodFromInstanceAndReferenceThunk;
+        parameterFootprint = methodReferenceParameterFootprint(t, ref, false);
+        returnCode = methodReferenceReturnCode(t, ref);
+        tailCall = isReferenceTailCall(t, code, ip, context->method, ref);
       }
 
-      GcSingleton* pool = code->pool();
+      // inline caches live in the heap, so they are not used for code
+      // destined for a boot image
+      if (context->bootContext == 0) {
+        argument = makeInlineCache(t, argument);
+        thunk = findInterfaceMethodFromCacheThunk;
+      }
 
-      if (singletonIsObject(t, pool, index - 1)) {
-        object v = singletonObject(t, pool, index - 1);
+      unsigned rSize = resultSize(t, returnCode);
 
-        loadMemoryBarrier();
+      ir::Value* result = c->stackCall(
+          c->nativeCall(c->constant(getThunk(t, thunk), ir::Type::iptr()),
+                        0,
+                        frame->trace(0, 0),
+                        ir::Type::iptr(),
+                        args(c->threadRegister(),
+                             frame->append(argument),
+                             c->peek(1, parameterFootprint - 1))),
+          tailCall ? Compiler::TailJump : 0,
+          frame->trace(0, 0),
+          operandTypeForFieldCode(t, returnCode),
+          frame->peekMethodArguments(parameterFootprint));
 
-        if (objectClass(t, v) == type(t, GcReference::Type)) {
-          GcReference* reference = cast<GcReference>(t, v);
-          PROTECT(t, reference);
+      frame->popFootprint(parameterFootprint);
 
-          v = resolveClassInPool(t, context->method, index - 1, false);
+      if (rSize) {
+        frame->pushReturnValue(returnCode, result);
+      }
+    } break;
 
-          if (UNLIKELY(v == 0)) {
-            frame->push(
-                ir::Type::object(),
-                c->nativeCall(
-                    c->constant(getThunk(t, getJClassFromReferenceThunk),
-                                ir::Type::iptr()),
-                    0,
-                    frame->trace(0, 0),
-                    ir::Type::object(),
-                    args(c->threadRegister(),
-                         frame->append(
-                             makePair(t, context->method, reference)))));
-          }
+    case invokespecial: {
+      context->leaf = false;
+
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
+
+      PROTECT(t, reference);
+
+      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
+
+      if (LIKELY(target)) {
+        GcClass* class_ = context->method->class_();
+        if (isSpecialMethod(t, target, class_)) {
+          target = findVirtualMethod(t, target, class_->super());
         }
 
-        if (v) {
-          if (objectClass(t, v) == type(t, GcClass::Type)) {
-            frame->push(
-                ir::Type::object(),
-                c->nativeCall(c->constant(getThunk(t, getJClass64Thunk),
-                                          ir::Type::iptr()),
-                              0,
-                              frame->trace(0, 0),
-                              ir::Type::object(),
-                              args(c->threadRegister(), frame->append(v))));
-          } else {
-            frame->push(ir::Type::object(), frame->append(v));
-          }
+        checkMethod(t, target, false);
+
+        bool tailCall = isTailCall(t, code, ip, context->method, target);
+
+        if (UNLIKELY(methodAbstract(t, target))) {
+          compileDirectAbstractInvoke(
+              t, frame, getMethodAddressThunk, target, tailCall);
+        } else {
+          compileDirectInvoke(t, frame, target, tailCall);
         }
       } else {
-        ir::Type type = singletonBit(t, pool, poolSize(t, pool), index - 1)
-                            ? ir::Type::f4()
-                            : ir::Type::i4();
-        frame->push(type,
-                    c->constant(singletonValue(t, pool, index - 1), type));
+        GcReference* ref = cast<GcReference>(t, reference);
+        PROTECT(t, ref);
+        compileDirectReferenceInvoke(
+            t,
+            frame,
+            findSpecialMethodFromReferenceThunk,
+            ref,
+            false,
+            isReferenceTailCall(t, code, ip, context->method, ref));
       }
     } break;
 
-    case ldc2_w: {
+    case invokestatic: {
+      context->leaf = false;
+
       uint16_t index = codeReadInt16(t, code, ip);
 
-      GcSingleton* pool = code->pool();
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
 
-      uint64_t v;
-      memcpy(&v, &singletonValue(t, pool, index - 1), 8);
-      ir::Type type = singletonBit(t, pool, poolSize(t, pool), index - 1)
-                          ? ir::Type::f8()
-                          : ir::Type::i8();
-      frame->pushLarge(type, c->constant(v, type));
-    } break;
+      PROTECT(t, reference);
 
-    case ldiv_: {
-      ir::Value* a = frame->popLarge(ir::Type::i8());
-      ir::Value* b = frame->popLarge(ir::Type::i8());
+      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
 
-      if (inTryBlock(t, code, ip - 1)) {
-        c->saveLocals();
-        frame->trace(0, 0);
-      }
+      if (LIKELY(target)) {
+        checkMethod(t, target, true);
 
-      frame->pushLarge(ir::Type::i8(),
-                       c->binaryOp(lir::Divide, ir::Type::i8(), a, b));
+        if (not intrinsic(t, frame, target)) {
+          bool tailCall = isTailCall(t, code, ip, context->method, target);
+          compileDirectInvoke(t, frame, target, tailCall);
+        }
+      } else {
+        GcReference* ref = cast<GcReference>(t, reference);
+        PROTECT(t, ref);
+        compileDirectReferenceInvoke(
+            t,
+            frame,
+            findStaticMethodFromReferenceThunk,
+            ref,
+            true,
+            isReferenceTailCall(t, code, ip, context->method, ref));
+      }
     } break;
 
-    case lload:
-      frame->loadLarge(ir::Type::i8(), code->body()[ip++]);
-      break;
-    case dload:
-      frame->loadLarge(ir::Type::f8(), code->body()[ip++]);
-      break;
-
-    case lload_0:
-      frame->loadLarge(ir::Type::i8(), 0);
-      break;
-    case dload_0:
-      frame->loadLarge(ir::Type::f8(), 0);
-      break;
-
-    case lload_1:
-      frame->loadLarge(ir::Type::i8(), 1);
-      break;
-    case dload_1:
-      frame->loadLarge(ir::Type::f8(), 1);
-      break;
+    case invokevirtual: {
+      context->leaf = false;
 
-    case lload_2:
-      frame->loadLarge(ir::Type::i8(), 2);
-      break;
-    case dload_2:
-      frame->loadLarge(ir::Type::f8(), 2);
-      break;
+      uint16_t index = codeReadInt16(t, code, ip);
 
-    case lload_3:
-      frame->loadLarge(ir::Type::i8(), 3);
-      break;
-    case dload_3:
-      frame->loadLarge(ir::Type::f8(), 3);
-      break;
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
 
-    case lneg:
-      frame->pushLarge(
-          ir::Type::i8(),
-          c->unaryOp(lir::Negate, frame->popLarge(ir::Type::i8())));
-      break;
+      PROTECT(t, reference);
 
-    case lookupswitch: {
-      int32_t base = ip - 1;
+      GcMethod* target = resolveMethod(t, context->method, index - 1, false);
 
-      ip = (ip + 3) & ~3;  // pad to four byte boundary
+      if (LIKELY(target)) {
+        checkMethod(t, target, false);
 
-      ir::Value* key = frame->pop(ir::Type::i4());
+        if (not intrinsic(t, frame, target)) {
+          bool tailCall = isTailCall(t, code, ip, context->method, target);
 
-      uint32_t defaultIp = base + codeReadInt32(t, code, ip);
-      assertT(t, defaultIp < code->length());
+          if (methodVirtual(t, target)
+              and ((target->flags() | target->class_()->flags()) & ACC_FINAL)
+              and inlineMethod(t, frame, target)) {
+            // a final method cannot be overridden, so we may inline it
+            // regardless of the receiver's class
+          } else if (context->bootContext == 0
+                     and devirtualizable(t, target)) {
+            // no loaded class overrides the target, so we may call it
+            // directly, through a cell which is redirected to the
+            // vtable if that changes
+            avian::codegen::Promise* cell = c->poolAppend(0);
+
+            context->devirtualizedCalls = new (&context->zone)
+                DevirtualizedCallElement(
+                    target, cell, context->devirtualizedCalls);
+
+            // the vtable load would have thrown for a null receiver
+            // before the call, and so must we
+            if (inTryBlock(t, context->method->code(), frame->ip)) {
+              c->saveLocals();
+              frame->trace(0, 0);
+            }
+            c->checkNull(c->peek(1, target->parameterFootprint() - 1));
 
-      int32_t pairCount = codeReadInt32(t, code, ip);
+            frame->stackCall(
+                c->memory(frame->absoluteAddressOperand(cell),
+                          ir::Type::iptr()),
+                target,
+                tailCall ? Compiler::TailJump : 0,
+                frame->trace(0, 0));
+          } else if (LIKELY(methodVirtual(t, target))) {
+            unsigned parameterFootprint = target->parameterFootprint();
 
-      if (pairCount) {
-        ir::Value* default_ = frame->addressOperand(
-            frame->addressPromise(frame->machineIp(defaultIp)));
+            unsigned offset = TargetClassVtable
+                              + (target->offset() * TargetBytesPerWord);
 
-        avian::codegen::Promise* start = 0;
-        uint32_t* ipTable
-            = static_cast<uint32_t*>(stack.push(sizeof(uint32_t) * pairCount));
-        for (int32_t i = 0; i < pairCount; ++i) {
-          unsigned index = ip + (i * 8);
-          int32_t key = codeReadInt32(t, code, index);
-          uint32_t newIp = base + codeReadInt32(t, code, index);
-          assertT(t, newIp < code->length());
+            ir::Value* instance = c->peek(1, parameterFootprint - 1);
 
-          ipTable[i] = newIp;
+            frame->stackCall(
+                c->memory(c->binaryOp(
+                              lir::And,
+                              ir::Type::iptr(),
+                              c->constant(TargetPointerMask, ir::Type::iptr()),
+                              c->memory(instance, ir::Type::object())),
+                          ir::Type::object(),
+                          offset),
+                target,
+                tailCall ? Compiler::TailJump : 0,
+                frame->trace(0, 0));
+          } else {
+            // OpenJDK generates invokevirtual calls to private methods
+            // (e.g. readObject and writeObject for serialization), so
+            // we must handle such cases here.
 
-          avian::codegen::Promise* p = c->poolAppend(key);
-          if (i == 0) {
-            start = p;
+            compileDirectInvoke(t, frame, target, tailCall);
           }
-          c->poolAppendPromise(frame->addressPromise(frame->machineIp(newIp)));
         }
-        assertT(t, start);
+      } else {
+        GcReference* ref = cast<GcReference>(t, reference);
+        PROTECT(t, reference);
+        PROTECT(t, ref);
 
-        ir::Value* address = c->nativeCall(
-            c->constant(getThunk(t, lookUpAddressThunk), ir::Type::iptr()),
-            0,
-            0,
-            ir::Type::iptr(),
-            args(key,
-                 frame->absoluteAddressOperand(start),
-                 c->constant(pairCount, ir::Type::i4()),
-                 default_));
-
-        c->jmp(context->bootContext
-                   ? c->binaryOp(lir::Add,
-                                 ir::Type::iptr(),
-                                 c->memory(c->threadRegister(),
-                                           ir::Type::iptr(),
-                                           TARGET_THREAD_CODEIMAGE),
-                                 address)
-                   : address);
+        object argument = makePair(t, context->method, reference);
+        Thunk thunk = findVirtualMethodFromReferenceThunk;
 
-        new (stack.push(sizeof(SwitchState)))
-            SwitchState(c->saveState(), pairCount, defaultIp, 0, 0, 0, 0);
+        if (context->bootContext == 0) {
+          argument = makeInlineCache(t, argument);
+          thunk = findVirtualMethodFromCacheThunk;
+        }
 
-        goto switchloop;
-      } else {
-        // a switch statement with no cases, apparently
-        c->jmp(frame->machineIpValue(defaultIp));
-        ip = defaultIp;
+        compileReferenceInvoke(
+            frame,
+            c->nativeCall(
+                c->constant(getThunk(t, thunk), ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                ir::Type::iptr(),
+                args(c->threadRegister(),
+                     frame->append(argument),
+                     c->peek(1,
+                             methodReferenceParameterFootprint(t, ref, false)
+                             - 1))),
+            ref,
+            false,
+            isReferenceTailCall(t, code, ip, context->method, ref));
       }
     } break;
 
-    case lrem: {
-      ir::Value* a = frame->popLarge(ir::Type::i8());
-      ir::Value* b = frame->popLarge(ir::Type::i8());
+    case irem: {
+      ir::Value* a = frame->pop(ir::Type::i4());
+      ir::Value* b = frame->pop(ir::Type::i4());
 
       if (inTryBlock(t, code, ip - 1)) {
         c->saveLocals();
         frame->trace(0, 0);
       }
 
-      frame->pushLarge(ir::Type::i8(),
-                       c->binaryOp(lir::Remainder, ir::Type::i8(), a, b));
+      frame->push(ir::Type::i4(),
+                  c->binaryOp(lir::Remainder, ir::Type::i4(), a, b));
     } break;
 
-    case lreturn: {
+    case ireturn: {
       handleExit(t, frame);
-      c->return_(frame->popLarge(ir::Type::i8()));
+      c->return_(frame->pop(ir::Type::i4()));
     }
       goto next;
 
-    case dreturn: {
+    case freturn: {
       handleExit(t, frame);
-      c->return_(frame->popLarge(ir::Type::f8()));
+      c->return_(frame->pop(ir::Type::f4()));
     }
       goto next;
 
-    case lshl:
-    case lshr:
-    case lushr: {
-      ir::Value* a = frame->pop(ir::Type::i4());
-      ir::Value* b = frame->popLarge(ir::Type::i8());
-      frame->pushLarge(
-          ir::Type::i8(),
-          c->binaryOp(
-              toCompilerBinaryOp(t, instruction), ir::Type::i8(), a, b));
-    } break;
-
-    case lstore:
-      frame->storeLarge(ir::Type::i8(), code->body()[ip++]);
+    case istore:
+      frame->store(ir::Type::i4(), code->body()[ip++]);
       break;
-    case dstore:
-      frame->storeLarge(ir::Type::f8(), code->body()[ip++]);
+    case fstore:
+      frame->store(ir::Type::f4(), code->body()[ip++]);
       break;
 
-    case lstore_0:
-      frame->storeLarge(ir::Type::i8(), 0);
+    case istore_0:
+      frame->store(ir::Type::i4(), 0);
       break;
-    case dstore_0:
-      frame->storeLarge(ir::Type::f8(), 0);
+    case fstore_0:
+      frame->store(ir::Type::f4(), 0);
       break;
 
-    case lstore_1:
-      frame->storeLarge(ir::Type::i8(), 1);
+    case istore_1:
+      frame->store(ir::Type::i4(), 1);
       break;
-    case dstore_1:
-      frame->storeLarge(ir::Type::f8(), 1);
+    case fstore_1:
+      frame->store(ir::Type::f4(), 1);
       break;
 
-    case lstore_2:
-      frame->storeLarge(ir::Type::i8(), 2);
+    case istore_2:
+      frame->store(ir::Type::i4(), 2);
       break;
-    case dstore_2:
-      frame->storeLarge(ir::Type::f8(), 2);
+    case fstore_2:
+      frame->store(ir::Type::f4(), 2);
       break;
 
-    case lstore_3:
-      frame->storeLarge(ir::Type::i8(), 3);
+    case istore_3:
+      frame->store(ir::Type::i4(), 3);
       break;
-    case dstore_3:
-      frame->storeLarge(ir::Type::f8(), 3);
+    case fstore_3:
+      frame->store(ir::Type::f4(), 3);
       break;
 
-    case monitorenter: {
-      ir::Value* target = frame->pop(ir::Type::object());
-      c->nativeCall(c->constant(getThunk(t, acquireMonitorForObjectThunk),
-                                ir::Type::iptr()),
-                    0,
-                    frame->trace(0, 0),
-                    ir::Type::void_(),
-                    args(c->threadRegister(), target));
-    } break;
-
-    case monitorexit: {
-      ir::Value* target = frame->pop(ir::Type::object());
-      c->nativeCall(c->constant(getThunk(t, releaseMonitorForObjectThunk),
-                                ir::Type::iptr()),
-                    0,
-                    frame->trace(0, 0),
-                    ir::Type::void_(),
-                    args(c->threadRegister(), target));
-    } break;
-
-    case multianewarray: {
-      uint16_t index = codeReadInt16(t, code, ip);
-      uint8_t dimensions = code->body()[ip++];
-
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
-
-      PROTECT(t, reference);
-
-      GcClass* class_
-          = resolveClassInPool(t, context->method, index - 1, false);
+    case jsr:
+    case jsr_w: {
+      uint32_t thisIp;
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        thunk = makeMultidimensionalArrayThunk;
+      if (instruction == jsr) {
+        uint32_t offset = codeReadInt16(t, code, ip);
+        thisIp = ip - 3;
+        newIp = thisIp + offset;
       } else {
-        argument = makePair(t, context->method, reference);
-        thunk = makeMultidimensionalArrayFromReferenceThunk;
+        uint32_t offset = codeReadInt32(t, code, ip);
+        thisIp = ip - 5;
+        newIp = thisIp + offset;
       }
 
-      unsigned offset
-          = localOffset(t,
-                        localSize(t, context->method) + c->topOfStack(),
-                        context->method) + t->arch->frameReturnAddressSize();
-
-      ir::Value* result
-          = c->nativeCall(c->constant(getThunk(t, thunk), ir::Type::iptr()),
-                          0,
-                          frame->trace(0, 0),
-                          ir::Type::object(),
-                          args(c->threadRegister(),
-                               frame->append(argument),
-                               c->constant(dimensions, ir::Type::i4()),
-                               c->constant(offset, ir::Type::i4())));
+      assertT(t, newIp < code->length());
 
-      frame->popFootprint(dimensions);
-      frame->push(ir::Type::object(), result);
-    } break;
+      frame->startSubroutine(newIp, ip);
 
-    case new_: {
-      uint16_t index = codeReadInt16(t, code, ip);
+      c->jmp(frame->machineIpValue(newIp));
 
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+      ip = newIp;
+    } break;
 
-      PROTECT(t, reference);
+    case l2d: {
+      frame->pushLarge(ir::Type::f8(),
+                       c->i2f(ir::Type::f8(), frame->popLarge(ir::Type::i8())));
+    } break;
 
-      GcClass* class_
-          = resolveClassInPool(t, context->method, index - 1, false);
+    case l2f: {
+      frame->push(ir::Type::f4(),
+                  c->i2f(ir::Type::f4(), frame->popLarge(ir::Type::i8())));
+    } break;
 
-      object argument;
-      Thunk thunk;
-      if (LIKELY(class_)) {
-        argument = class_;
-        if (class_->vmFlags() & (WeakReferenceFlag | HasFinalizerFlag)) {
-          thunk = makeNewGeneral64Thunk;
-        } else {
-          thunk = makeNew64Thunk;
-        }
-      } else {
-        argument = makePair(t, context->method, reference);
-        thunk = makeNewFromReferenceThunk;
-      }
+    case l2i:
+      frame->push(ir::Type::i4(),
+                  c->truncate(ir::Type::i4(), frame->popLarge(ir::Type::i8())));
+      break;
 
-      frame->push(
-          ir::Type::object(),
-          c->nativeCall(c->constant(getThunk(t, thunk), ir::Type::iptr()),
-                        0,
-                        frame->trace(0, 0),
-                        ir::Type::object(),
-                        args(c->threadRegister(), frame->append(argument))));
+    case ladd:
+    case land:
+    case lor:
+    case lsub:
+    case lxor:
+    case lmul: {
+      ir::Value* a = frame->popLarge(ir::Type::i8());
+      ir::Value* b = frame->popLarge(ir::Type::i8());
+      frame->pushLarge(
+          ir::Type::i8(),
+          c->binaryOp(
+              toCompilerBinaryOp(t, instruction), ir::Type::i8(), a, b));
     } break;
 
-    case newarray: {
-      uint8_t type = code->body()[ip++];
-
-      ir::Value* length = frame->pop(ir::Type::i4());
+    case lcmp: {
+      ir::Value* a = frame->popLarge(ir::Type::i8());
+      ir::Value* b = frame->popLarge(ir::Type::i8());
 
-      frame->push(ir::Type::object(),
-                  c->nativeCall(c->constant(getThunk(t, makeBlankArrayThunk),
-                                            ir::Type::iptr()),
-                                0,
-                                frame->trace(0, 0),
-                                ir::Type::object(),
-                                args(c->threadRegister(),
-                                     c->constant(type, ir::Type::i4()),
-                                     length)));
+      if (integerBranch(t, frame, code, ip, a, b, &newIp)) {
+        goto branch;
+      } else {
+        frame->push(ir::Type::i4(),
+                    c->nativeCall(c->constant(getThunk(t, compareLongsThunk),
+                                              ir::Type::iptr()),
+                                  0,
+                                  0,
+                                  ir::Type::i4(),
+                                  args(nullptr, a, nullptr, b)));
+      }
     } break;
 
-    case nop:
-      break;
-
-    case pop_:
-      frame->popFootprint(1);
+    case lconst_0:
+      frame->pushLarge(ir::Type::i8(), c->constant(0, ir::Type::i8()));
       break;
 
-    case pop2:
-      frame->popFootprint(2);
+    case lconst_1:
+      frame->pushLarge(ir::Type::i8(), c->constant(1, ir::Type::i8()));
       break;
 
-    case putfield:
-    case putstatic: {
-      uint16_t index = codeReadInt16(t, code, ip);
+    case ldc:
+    case ldc_w: {
+      uint16_t index;
 
-      object reference
-          = singletonObject(t, context->method->code()->pool(), index - 1);
+      if (instruction == ldc) {
+        index = code->body()[ip++];
+      } else {
+        index = codeReadInt16(t, code, ip);
+      }
 
-      PROTECT(t, reference);
+      GcSingleton* pool = code->pool();
 
-      GcField* field = resolveField(t, context->method, index - 1, false);
+      if (singletonIsObject(t, pool, index - 1)) {
+        object v = singletonObject(t, pool, index - 1);
 
-      if (LIKELY(field)) {
-        int fieldCode = field->code();
+        loadMemoryBarrier();
 
-        object staticTable = 0;
-
-        if (instruction == putstatic) {
-          checkField(t, field, true);
-
-          if (classNeedsInit(t, field->class_())) {
-            PROTECT(t, field);
-
-            c->nativeCall(
-                c->constant(getThunk(t, tryInitClassThunk), ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                ir::Type::void_(),
-                args(c->threadRegister(), frame->append(field->class_())));
-          }
+        if (objectClass(t, v) == type(t, GcReference::Type)) {
+          GcReference* reference = cast<GcReference>(t, v);
+          PROTECT(t, reference);
 
-          staticTable = field->class_()->staticTable();
-        } else {
-          checkField(t, field, false);
+          v = resolveClassInPool(t, context->method, index - 1, false);
 
-          if (inTryBlock(t, code, ip - 3)) {
-            c->saveLocals();
-            frame->trace(0, 0);
+          if (UNLIKELY(v == 0)) {
+            frame->push(
+                ir::Type::object(),
+                c->nativeCall(
+                    c->constant(getThunk(t, getJClassFromReferenceThunk),
+                                ir::Type::iptr()),
+                    0,
+                    frame->trace(0, 0),
+                    ir::Type::object(),
+                    args(c->threadRegister(),
+                         frame->append(
+                             makePair(t, context->method, reference)))));
           }
         }
 
-        if (field->flags() & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode == DoubleField or fieldCode == LongField)) {
-            PROTECT(t, field);
-
-            c->nativeCall(c->constant(getThunk(t, acquireMonitorForObjectThunk),
-                                      ir::Type::iptr()),
-                          0,
-                          frame->trace(0, 0),
-                          ir::Type::void_(),
-                          args(c->threadRegister(), frame->append(field)));
+        if (v) {
+          if (objectClass(t, v) == type(t, GcClass::Type)) {
+            frame->push(
+                ir::Type::object(),
+                c->nativeCall(c->constant(getThunk(t, getJClass64Thunk),
+                                          ir::Type::iptr()),
+                              0,
+                              frame->trace(0, 0),
+                              ir::Type::object(),
+                              args(c->threadRegister(), frame->append(v))));
           } else {
-            c->nullaryOp(lir::StoreStoreBarrier);
+            frame->push(ir::Type::object(), frame->append(v));
           }
         }
+      } else {
+        ir::Type type = singletonBit(t, pool, poolSize(t, pool), index - 1)
+                            ? ir::Type::f4()
+                            : ir::Type::i4();
+        frame->push(type,
+                    c->constant(singletonValue(t, pool, index - 1), type));
+      }
+    } break;
 
-        ir::Value* value = popField(t, frame, fieldCode);
+    case ldc2_w: {
+      uint16_t index = codeReadInt16(t, code, ip);
 
-        ir::Value* table;
+      GcSingleton* pool = code->pool();
 
-        if (instruction == putstatic) {
-          PROTECT(t, field);
+      uint64_t v;
+      memcpy(&v, &singletonValue(t, pool, index - 1), 8);
+      ir::Type type = singletonBit(t, pool, poolSize(t, pool), index - 1)
+                          ? ir::Type::f8()
+                          : ir::Type::i8();
+      frame->pushLarge(type, c->constant(v, type));
+    } break;
 
-          table = frame->append(staticTable);
-        } else {
-          table = frame->pop(ir::Type::object());
-        }
+    case ldiv_: {
+      ir::Value* a = frame->popLarge(ir::Type::i8());
+      ir::Value* b = frame->popLarge(ir::Type::i8());
 
-        switch (fieldCode) {
-        case ByteField:
-        case BooleanField:
-          c->store(
-              value,
-              c->memory(
-                  table, ir::Type::i1(), targetFieldOffset(context, field)));
-          break;
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
+      }
 
-        case CharField:
-        case ShortField:
-          c->store(
-              value,
-              c->memory(
-                  table, ir::Type::i2(), targetFieldOffset(context, field)));
-          break;
+      frame->pushLarge(ir::Type::i8(),
+                       c->binaryOp(lir::Divide, ir::Type::i8(), a, b));
+    } break;
 
-        case FloatField:
-          c->store(
-              value,
-              c->memory(
-                  table, ir::Type::f4(), targetFieldOffset(context, field)));
-          break;
+    case lload:
+      frame->loadLarge(ir::Type::i8(), code->body()[ip++]);
+      break;
+    case dload:
+      frame->loadLarge(ir::Type::f8(), code->body()[ip++]);
+      break;
 
-        case IntField:
-          c->store(
-              value,
-              c->memory(
-                  table, ir::Type::i4(), targetFieldOffset(context, field)));
-          break;
+    case lload_0:
+      frame->loadLarge(ir::Type::i8(), 0);
+      break;
+    case dload_0:
+      frame->loadLarge(ir::Type::f8(), 0);
+      break;
 
-        case DoubleField:
-          c->store(
-              value,
-              c->memory(
-                  table, ir::Type::f8(), targetFieldOffset(context, field)));
-          break;
+    case lload_1:
+      frame->loadLarge(ir::Type::i8(), 1);
+      break;
+    case dload_1:
+      frame->loadLarge(ir::Type::f8(), 1);
+      break;
 
-        case LongField:
-          c->store(
-              value,
-              c->memory(
-                  table, ir::Type::i8(), targetFieldOffset(context, field)));
-          break;
+    case lload_2:
+      frame->loadLarge(ir::Type::i8(), 2);
+      break;
+    case dload_2:
+      frame->loadLarge(ir::Type::f8(), 2);
+      break;
 
-        case ObjectField:
-          if (instruction == putfield) {
-            c->nativeCall(
-                c->constant(getThunk(t, setMaybeNullThunk), ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                ir::Type::void_(),
-                args(c->threadRegister(),
-                     table,
-                     c->constant(targetFieldOffset(context, field),
-                                 ir::Type::i4()),
-                     value));
-          } else {
-            c->nativeCall(
-                c->constant(getThunk(t, setObjectThunk), ir::Type::iptr()),
-                0,
-                0,
-                ir::Type::void_(),
-                args(c->threadRegister(),
-                     table,
-                     c->constant(targetFieldOffset(context, field),
-                                 ir::Type::i4()),
-                     value));
-          }
-          break;
+    case lload_3:
+      frame->loadLarge(ir::Type::i8(), 3);
+      break;
+    case dload_3:
+      frame->loadLarge(ir::Type::f8(), 3);
+      break;
 
-        default:
-          abort(t);
+    case lneg:
+      frame->pushLarge(
+          ir::Type::i8(),
+          c->unaryOp(lir::Negate, frame->popLarge(ir::Type::i8())));
+      break;
+
+    case lookupswitch: {
+      int32_t base = ip - 1;
+
+      ip = (ip + 3) & ~3;  // pad to four byte boundary
+
+      ir::Value* key = frame->pop(ir::Type::i4());
+
+      uint32_t defaultIp = base + codeReadInt32(t, code, ip);
+      assertT(t, defaultIp < code->length());
+
+      int32_t pairCount = codeReadInt32(t, code, ip);
+
+      if (pairCount == 0) {
+        // a switch statement with no cases, apparently
+        c->jmp(frame->machineIpValue(defaultIp));
+        ip = defaultIp;
+        break;
+      }
+
+      // the keys are sorted, so the first and last bound the rest
+      unsigned firstIndex = ip;
+      unsigned lastIndex = ip + ((pairCount - 1) * 8);
+      int32_t bottom = codeReadInt32(t, code, firstIndex);
+      int32_t top = codeReadInt32(t, code, lastIndex);
+      uint64_t spread = static_cast<int64_t>(top) - bottom + 1;
+
+      if (static_cast<unsigned>(pairCount) <= MaxInlineLookupSwitchKeys) {
+        uint32_t* ipTable
+            = static_cast<uint32_t*>(stack.push(sizeof(uint32_t) * pairCount));
+        int32_t* keys = static_cast<int32_t*>(
+            context->zone.allocate(sizeof(int32_t) * pairCount));
+        for (int32_t i = 0; i < pairCount; ++i) {
+          unsigned index = ip + (i * 8);
+          keys[i] = codeReadInt32(t, code, index);
+          uint32_t newIp = base + codeReadInt32(t, code, index);
+          assertT(t, newIp < code->length());
+
+          ipTable[i] = newIp;
         }
 
-        if (field->flags() & ACC_VOLATILE) {
-          if (TargetBytesPerWord == 4
-              and (fieldCode == DoubleField or fieldCode == LongField)) {
-            c->nativeCall(c->constant(getThunk(t, releaseMonitorForObjectThunk),
-                                      ir::Type::iptr()),
-                          0,
-                          frame->trace(0, 0),
-                          ir::Type::void_(),
-                          args(c->threadRegister(), frame->append(field)));
-          } else {
-            c->nullaryOp(lir::StoreLoadBarrier);
+        c->save(ir::Type::i4(), key);
+
+        SwitchState* s = new (stack.push(sizeof(SwitchState)))
+            SwitchState(c->saveState(), pairCount, defaultIp, key, 0, 0, 0);
+        s->keys = keys;
+
+        goto lookuploop;
+      } else if (spread <= static_cast<uint64_t>(pairCount)
+                               * MaxLookupSwitchSpread) {
+        // compile it as a tableswitch, sending the missing keys to the
+        // default
+        avian::codegen::Promise* start = 0;
+        unsigned count = spread;
+        uint32_t* ipTable
+            = static_cast<uint32_t*>(stack.push(sizeof(uint32_t) * count));
+        for (unsigned i = 0; i < count; ++i) {
+          ipTable[i] = defaultIp;
+        }
+
+        for (int32_t i = 0; i < pairCount; ++i) {
+          unsigned index = ip + (i * 8);
+          int32_t key = codeReadInt32(t, code, index);
+          uint32_t newIp = base + codeReadInt32(t, code, index);
+          assertT(t, newIp < code->length());
+
+          ipTable[key - bottom] = newIp;
+        }
+
+        for (unsigned i = 0; i < count; ++i) {
+          avian::codegen::Promise* p = c->poolAppendPromise(
+              frame->addressPromise(frame->machineIp(ipTable[i])));
+          if (i == 0) {
+            start = p;
           }
         }
-      } else {
-        GcReference* ref = cast<GcReference>(t, reference);
-        PROTECT(t, ref);
-        int fieldCode = vm::fieldCode(t, ref->spec()->body()[0]);
+        assertT(t, start);
 
-        ir::Value* value = popField(t, frame, fieldCode);
-        ir::Type rType = operandTypeForFieldCode(t, fieldCode);
+        c->condJump(lir::JumpIfLess,
+                    c->constant(bottom, ir::Type::i4()),
+                    key,
+                    frame->machineIpValue(defaultIp));
 
-        GcPair* pair = makePair(t, context->method, reference);
+        c->save(ir::Type::i4(), key);
 
-        switch (fieldCode) {
-        case ByteField:
-        case BooleanField:
-        case CharField:
-        case ShortField:
-        case FloatField:
-        case IntField: {
-          if (instruction == putstatic) {
+        new (stack.push(sizeof(SwitchState))) SwitchState(
+            c->saveState(), count, defaultIp, key, start, bottom, top);
+
+        stack.pushValue(Untable0);
+        ip = defaultIp;
+        goto start;
+      }
+
+      ir::Value* default_ = frame->addressOperand(
+          frame->addressPromise(frame->machineIp(defaultIp)));
+
+      avian::codegen::Promise* start = 0;
+      uint32_t* ipTable
+          = static_cast<uint32_t*>(stack.push(sizeof(uint32_t) * pairCount));
+      for (int32_t i = 0; i < pairCount; ++i) {
+        unsigned index = ip + (i * 8);
+        int32_t key = codeReadInt32(t, code, index);
+        uint32_t newIp = base + codeReadInt32(t, code, index);
+        assertT(t, newIp < code->length());
+
+        ipTable[i] = newIp;
+
+        avian::codegen::Promise* p = c->poolAppend(key);
+        if (i == 0) {
+          start = p;
+        }
+        c->poolAppendPromise(frame->addressPromise(frame->machineIp(newIp)));
+      }
+      assertT(t, start);
+
+      ir::Value* address = c->nativeCall(
+          c->constant(getThunk(t, lookUpAddressThunk), ir::Type::iptr()),
+          0,
+          0,
+          ir::Type::iptr(),
+          args(key,
+               frame->absoluteAddressOperand(start),
+               c->constant(pairCount, ir::Type::i4()),
+               default_));
+
+      c->jmp(context->bootContext
+                 ? c->binaryOp(lir::Add,
+                               ir::Type::iptr(),
+                               c->memory(c->threadRegister(),
+                                         ir::Type::iptr(),
+                                         TARGET_THREAD_CODEIMAGE),
+                               address)
+                 : address);
+
+      new (stack.push(sizeof(SwitchState)))
+          SwitchState(c->saveState(), pairCount, defaultIp, 0, 0, 0, 0);
+
+      goto switchloop;
+    }
+
+    case lrem: {
+      ir::Value* a = frame->popLarge(ir::Type::i8());
+      ir::Value* b = frame->popLarge(ir::Type::i8());
+
+      if (inTryBlock(t, code, ip - 1)) {
+        c->saveLocals();
+        frame->trace(0, 0);
+      }
+
+      frame->pushLarge(ir::Type::i8(),
+                       c->binaryOp(lir::Remainder, ir::Type::i8(), a, b));
+    } break;
+
+    case lreturn: {
+      handleExit(t, frame);
+      c->return_(frame->popLarge(ir::Type::i8()));
+    }
+      goto next;
+
+    case dreturn: {
+      handleExit(t, frame);
+      c->return_(frame->popLarge(ir::Type::f8()));
+    }
+      goto next;
+
+    case lshl:
+    case lshr:
+    case lushr: {
+      ir::Value* a = frame->pop(ir::Type::i4());
+      ir::Value* b = frame->popLarge(ir::Type::i8());
+      frame->pushLarge(
+          ir::Type::i8(),
+          c->binaryOp(
+              toCompilerBinaryOp(t, instruction), ir::Type::i8(), a, b));
+    } break;
+
+    case lstore:
+      frame->storeLarge(ir::Type::i8(), code->body()[ip++]);
+      break;
+    case dstore:
+      frame->storeLarge(ir::Type::f8(), code->body()[ip++]);
+      break;
+
+    case lstore_0:
+      frame->storeLarge(ir::Type::i8(), 0);
+      break;
+    case dstore_0:
+      frame->storeLarge(ir::Type::f8(), 0);
+      break;
+
+    case lstore_1:
+      frame->storeLarge(ir::Type::i8(), 1);
+      break;
+    case dstore_1:
+      frame->storeLarge(ir::Type::f8(), 1);
+      break;
+
+    case lstore_2:
+      frame->storeLarge(ir::Type::i8(), 2);
+      break;
+    case dstore_2:
+      frame->storeLarge(ir::Type::f8(), 2);
+      break;
+
+    case lstore_3:
+      frame->storeLarge(ir::Type::i8(), 3);
+      break;
+    case dstore_3:
+      frame->storeLarge(ir::Type::f8(), 3);
+      break;
+
+    case monitorenter: {
+      ir::Value* target = frame->pop(ir::Type::object());
+      if (not context->threadLocalMonitorTable[ip - 1]) {
+        c->nativeCall(c->constant(getThunk(t, acquireMonitorForObjectThunk),
+                                  ir::Type::iptr()),
+                      0,
+                      frame->trace(0, 0),
+                      ir::Type::void_(),
+                      args(c->threadRegister(), target));
+      }
+    } break;
+
+    case monitorexit: {
+      ir::Value* target = frame->pop(ir::Type::object());
+      if (not context->threadLocalMonitorTable[ip - 1]) {
+        c->nativeCall(c->constant(getThunk(t, releaseMonitorForObjectThunk),
+                                  ir::Type::iptr()),
+                      0,
+                      frame->trace(0, 0),
+                      ir::Type::void_(),
+                      args(c->threadRegister(), target));
+      }
+    } break;
+
+    case multianewarray: {
+      uint16_t index = codeReadInt16(t, code, ip);
+      uint8_t dimensions = code->body()[ip++];
+
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
+
+      PROTECT(t, reference);
+
+      GcClass* class_
+          = resolveClassInPool(t, context->method, index - 1, false);
+
+      object argument;
+      Thunk thunk;
+      if (LIKELY(class_)) {
+        argument = class_;
+        thunk = makeMultidimensionalArrayThunk;
+      } else {
+        argument = makePair(t, context->method, reference);
+        thunk = makeMultidimensionalArrayFromReferenceThunk;
+      }
+
+      unsigned offset
+          = localOffset(t,
+                        localSize(t, context->method) + c->topOfStack(),
+                        context->method) + t->arch->frameReturnAddressSize();
+
+      ir::Value* result
+          = c->nativeCall(c->constant(getThunk(t, thunk), ir::Type::iptr()),
+                          0,
+                          frame->trace(0, 0),
+                          ir::Type::object(),
+                          args(c->threadRegister(),
+                               frame->append(argument),
+                               c->constant(dimensions, ir::Type::i4()),
+                               c->constant(offset, ir::Type::i4())));
+
+      frame->popFootprint(dimensions);
+      frame->push(ir::Type::object(), result);
+    } break;
+
+    case new_: {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
+
+      PROTECT(t, reference);
+
+      GcClass* class_
+          = resolveClassInPool(t, context->method, index - 1, false);
+
+      if (LIKELY(class_)
+          and (class_->vmFlags()
+               & (WeakReferenceFlag | HasFinalizerFlag | NeedInitFlag)) == 0
+          and inlineAllocation(t, context)) {
+        frame->push(
+            ir::Type::object(),
             c->nativeCall(
-                c->constant(getThunk(t, setStaticFieldValueFromReferenceThunk),
-                            ir::Type::iptr()),
+                c->constant(getThunk(t, makeNewOfSizeThunk), ir::Type::iptr()),
+                Compiler::InlineAllocation,
+                frame->trace(0, 0),
+                ir::Type::object(),
+                args(c->threadRegister(),
+                     frame->append(class_),
+                     allocationSite(t, context),
+                     c->constant(pad(class_->fixedSize()) / BytesPerWord,
+                                 ir::Type::i4()))));
+      } else if (LIKELY(class_)
+                 and (class_->vmFlags()
+                      & (WeakReferenceFlag | HasFinalizerFlag)) == 0) {
+        frame->push(
+            ir::Type::object(),
+            c->nativeCall(
+                c->constant(getThunk(t, makeNew64Thunk), ir::Type::iptr()),
                 0,
                 frame->trace(0, 0),
-                rType,
-                args(c->threadRegister(), frame->append(pair), value));
-          } else {
-            ir::Value* instance = frame->pop(ir::Type::object());
+                ir::Type::object(),
+                args(c->threadRegister(),
+                     frame->append(class_),
+                     allocationSite(t, context))));
+      } else {
+        object argument;
+        Thunk thunk;
+        if (LIKELY(class_)) {
+          argument = class_;
+          thunk = makeNewGeneral64Thunk;
+        } else {
+          argument = makePair(t, context->method, reference);
+          thunk = makeNewFromReferenceThunk;
+        }
+
+        frame->push(
+            ir::Type::object(),
+            c->nativeCall(c->constant(getThunk(t, thunk), ir::Type::iptr()),
+                          0,
+                          frame->trace(0, 0),
+                          ir::Type::object(),
+                          args(c->threadRegister(), frame->append(argument))));
+      }
+    } break;
+
+    case newarray: {
+      uint8_t type = code->body()[ip++];
 
+      ir::Value* length = frame->pop(ir::Type::i4());
+
+      if (inlineAllocation(t, context)) {
+        unsigned elementSize;
+        GcClass* class_
+            = vm::type(t, primitiveArrayType(t, type, &elementSize));
+
+        frame->push(
+            ir::Type::object(),
             c->nativeCall(
-                c->constant(getThunk(t, setFieldValueFromReferenceThunk),
+                c->constant(getThunk(t, makeBlankArrayOfClassThunk),
                             ir::Type::iptr()),
-                0,
+                Compiler::InlineAllocation,
                 frame->trace(0, 0),
-                rType,
-                args(
-                    c->threadRegister(), frame->append(pair), instance, value));
+                ir::Type::object(),
+                args(c->threadRegister(),
+                     frame->append(class_),
+                     allocationSite(t, context),
+                     length,
+                     c->constant(elementSize, ir::Type::i4()))));
+      } else {
+        frame->push(ir::Type::object(),
+                    c->nativeCall(c->constant(getThunk(t, makeBlankArrayThunk),
+                                              ir::Type::iptr()),
+                                  0,
+                                  frame->trace(0, 0),
+                                  ir::Type::object(),
+                                  args(c->threadRegister(),
+                                       c->constant(type, ir::Type::i4()),
+                                       length,
+                                       allocationSite(t, context))));
+      }
+    } break;
+
+    case nop:
+      break;
+
+    case pop_:
+      frame->popFootprint(1);
+      break;
+
+    case pop2:
+      frame->popFootprint(2);
+      break;
+
+    case putfield:
+    case putstatic: {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      object reference
+          = singletonObject(t, context->method->code()->pool(), index - 1);
+
+      PROTECT(t, reference);
+
+      GcField* field = resolveField(t, context->method, index - 1, false);
+
+      if (LIKELY(field)) {
+        int fieldCode = field->code();
+
+        object staticTable = 0;
+
+        if (instruction == putstatic) {
+          checkField(t, field, true);
+
+          if (classNeedsInit(t, field->class_())) {
+            PROTECT(t, field);
+
+            compileInitCheck(t, frame, field->class_());
           }
-        } break;
 
-        case DoubleField:
-        case LongField: {
-          if (instruction == putstatic) {
-            c->nativeCall(
-                c->constant(
-                    getThunk(t, setStaticLongFieldValueFromReferenceThunk),
-                    ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                rType,
-                args(c->threadRegister(), frame->append(pair), nullptr, value));
-          } else {
-            ir::Value* instance = frame->pop(ir::Type::object());
+          staticTable = field->class_()->staticTable();
+        } else {
+          checkField(t, field, false);
+
+          if (inTryBlock(t, code, ip - 3)) {
+            c->saveLocals();
+            frame->trace(0, 0);
+          }
+        }
+
+        // see getfield
+        bool wideVolatile
+            = (field->flags() & ACC_VOLATILE) and TargetBytesPerWord == 4
+              and (fieldCode == DoubleField or fieldCode == LongField);
+
+        if (field->flags() & ACC_VOLATILE) {
+          if (wideVolatile and LockWideVolatileFields) {
+            PROTECT(t, field);
+
+            c->nativeCall(c->constant(getThunk(t, acquireMonitorForObjectThunk),
+                                      ir::Type::iptr()),
+                          0,
+                          frame->trace(0, 0),
+                          ir::Type::void_(),
+                          args(c->threadRegister(), frame->append(field)));
+          } else {
+            c->nullaryOp(lir::StoreStoreBarrier);
+          }
+        }
+
+        ir::Value* value = popField(t, frame, fieldCode);
+
+        ir::Value* table;
+
+        if (instruction == putstatic) {
+          PROTECT(t, field);
+
+          table = frame->append(staticTable);
+        } else {
+          table = frame->pop(ir::Type::object());
+        }
+
+        switch (fieldCode) {
+        case ByteField:
+        case BooleanField:
+          c->store(
+              value,
+              c->memory(
+                  table, ir::Type::i1(), targetFieldOffset(context, field)));
+          break;
+
+        case CharField:
+        case ShortField:
+          c->store(
+              value,
+              c->memory(
+                  table, ir::Type::i2(), targetFieldOffset(context, field)));
+          break;
+
+        case FloatField:
+          c->store(
+              value,
+              c->memory(
+                  table, ir::Type::f4(), targetFieldOffset(context, field)));
+          break;
+
+        case IntField:
+          c->store(
+              value,
+              c->memory(
+                  table, ir::Type::i4(), targetFieldOffset(context, field)));
+          break;
+
+        case DoubleField:
+        case LongField:
+          if (wideVolatile and not LockWideVolatileFields) {
+            c->nativeCall(
+                c->constant(getThunk(t, setWideVolatileThunk),
+                            ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                ir::Type::void_(),
+                args(c->threadRegister(),
+                     table,
+                     c->constant(targetFieldOffset(context, field),
+                                 ir::Type::i4()),
+                     value));
+          } else {
+            c->store(value,
+                     c->memory(table,
+                               operandTypeForFieldCode(t, fieldCode),
+                               targetFieldOffset(context, field)));
+          }
+          break;
+
+        case ObjectField:
+          if (instruction == putfield) {
+            c->nativeCall(
+                c->constant(getThunk(t, setMaybeNullThunk), ir::Type::iptr()),
+                Compiler::StoreBarrier,
+                frame->trace(0, 0),
+                ir::Type::void_(),
+                args(c->threadRegister(),
+                     table,
+                     c->constant(targetFieldOffset(context, field),
+                                 ir::Type::i4()),
+                     value));
+          } else {
+            c->nativeCall(
+                c->constant(getThunk(t, setObjectThunk), ir::Type::iptr()),
+                Compiler::StoreBarrier,
+                0,
+                ir::Type::void_(),
+                args(c->threadRegister(),
+                     table,
+                     c->constant(targetFieldOffset(context, field),
+                                 ir::Type::i4()),
+                     value));
+          }
+          break;
+
+        default:
+          abort(t);
+        }
+
+        if (field->flags() & ACC_VOLATILE) {
+          if (wideVolatile and LockWideVolatileFields) {
+            c->nativeCall(c->constant(getThunk(t, releaseMonitorForObjectThunk),
+                                      ir::Type::iptr()),
+                          0,
+                          frame->trace(0, 0),
+                          ir::Type::void_(),
+                          args(c->threadRegister(), frame->append(field)));
+          } else {
+            c->nullaryOp(lir::StoreLoadBarrier);
+          }
+        }
+      } else {
+        GcReference* ref = cast<GcReference>(t, reference);
+        PROTECT(t, ref);
+        int fieldCode = vm::fieldCode(t, ref->spec()->body()[0]);
+
+        ir::Value* value = popField(t, frame, fieldCode);
+        ir::Type rType = operandTypeForFieldCode(t, fieldCode);
+
+        GcPair* pair = makePair(t, context->method, reference);
+
+        switch (fieldCode) {
+        case ByteField:
+        case BooleanField:
+        case CharField:
+        case ShortField:
+        case FloatField:
+        case IntField: {
+          if (instruction == putstatic) {
+            c->nativeCall(
+                c->constant(getThunk(t, setStaticFieldValueFromReferenceThunk),
+                            ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                rType,
+                args(c->threadRegister(), frame->append(pair), value));
+          } else {
+            ir::Value* instance = frame->pop(ir::Type::object());
+
+            c->nativeCall(
+                c->constant(getThunk(t, setFieldValueFromReferenceThunk),
+                            ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                rType,
+                args(
+                    c->threadRegister(), frame->append(pair), instance, value));
+          }
+        } break;
+
+        case DoubleField:
+        case LongField: {
+          if (instruction == putstatic) {
+            c->nativeCall(
+                c->constant(
+                    getThunk(t, setStaticLongFieldValueFromReferenceThunk),
+                    ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                rType,
+                args(c->threadRegister(), frame->append(pair), nullptr, value));
+          } else {
+            ir::Value* instance = frame->pop(ir::Type::object());
+
+            c->nativeCall(
+                c->constant(getThunk(t, setLongFieldValueFromReferenceThunk),
+                            ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                rType,
+                args(c->threadRegister(),
+                     frame->append(pair),
+                     instance,
+                     nullptr,
+                     value));
+          }
+        } break;
+
+        case ObjectField: {
+          if (instruction == putstatic) {
+            c->nativeCall(
+                c->constant(
+                    getThunk(t, setStaticObjectFieldValueFromReferenceThunk),
+                    ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                rType,
+                args(c->threadRegister(), frame->append(pair), value));
+          } else {
+            ir::Value* instance = frame->pop(ir::Type::object());
+
+            c->nativeCall(
+                c->constant(getThunk(t, setObjectFieldValueFromReferenceThunk),
+                            ir::Type::iptr()),
+                0,
+                frame->trace(0, 0),
+                rType,
+                args(
+                    c->threadRegister(), frame->append(pair), instance, value));
+          }
+        } break;
+
+        default:
+          abort(t);
+        }
+      }
+    } break;
+
+    case ret: {
+      unsigned index = code->body()[ip];
+
+      unsigned returnAddress = frame->endSubroutine(index);
+      c->jmp(frame->machineIpValue(returnAddress));
+      ip = returnAddress;
+    } break;
+
+    case return_:
+      if (needsReturnBarrier(t, context->method)) {
+        c->nullaryOp(lir::StoreStoreBarrier);
+      }
+
+      handleExit(t, frame);
+      c->return_();
+      goto next;
+
+    case sipush:
+      frame->push(ir::Type::i4(),
+                  c->constant(static_cast<int16_t>(codeReadInt16(t, code, ip)),
+                              ir::Type::i4()));
+      break;
+
+    case swap:
+      frame->swap();
+      break;
+
+    case tableswitch: {
+      int32_t base = ip - 1;
+
+      ip = (ip + 3) & ~3;  // pad to four byte boundary
+
+      uint32_t defaultIp = base + codeReadInt32(t, code, ip);
+      assertT(t, defaultIp < code->length());
+
+      int32_t bottom = codeReadInt32(t, code, ip);
+      int32_t top = codeReadInt32(t, code, ip);
+
+      avian::codegen::Promise* start = 0;
+      unsigned count = top - bottom + 1;
+      uint32_t* ipTable
+          = static_cast<uint32_t*>(stack.push(sizeof(uint32_t) * count));
+      for (int32_t i = 0; i < top - bottom + 1; ++i) {
+        unsigned index = ip + (i * 4);
+        uint32_t newIp = base + codeReadInt32(t, code, index);
+        assertT(t, newIp < code->length());
+
+        ipTable[i] = newIp;
+
+        avian::codegen::Promise* p = c->poolAppendPromise(
+            frame->addressPromise(frame->machineIp(newIp)));
+        if (i == 0) {
+          start = p;
+        }
+      }
+      assertT(t, start);
+
+      ir::Value* key = frame->pop(ir::Type::i4());
+
+      c->condJump(lir::JumpIfLess,
+                  c->constant(bottom, ir::Type::i4()),
+                  key,
+                  frame->machineIpValue(defaultIp));
+
+      c->save(ir::Type::i4(), key);
+
+      new (stack.push(sizeof(SwitchState))) SwitchState(
+          c->saveState(), count, defaultIp, key, start, bottom, top);
+
+      stack.pushValue(Untable0);
+      ip = defaultIp;
+    }
+      goto start;
+
+    case wide: {
+      switch (code->body()[ip++]) {
+      case aload: {
+        frame->load(ir::Type::object(), codeReadInt16(t, code, ip));
+      } break;
+
+      case astore: {
+        frame->store(ir::Type::object(), codeReadInt16(t, code, ip));
+      } break;
+
+      case iinc: {
+        uint16_t index = codeReadInt16(t, code, ip);
+        int16_t count = codeReadInt16(t, code, ip);
+
+        storeLocal(context,
+                   1,
+                   ir::Type::i4(),
+                   c->binaryOp(lir::Add,
+                               ir::Type::i4(),
+                               c->constant(count, ir::Type::i4()),
+                               loadLocal(context, 1, ir::Type::i4(), index)),
+                   index);
+      } break;
+
+      case iload: {
+        frame->load(ir::Type::i4(), codeReadInt16(t, code, ip));
+      } break;
+
+      case istore: {
+        frame->store(ir::Type::i4(), codeReadInt16(t, code, ip));
+      } break;
+
+      case lload: {
+        frame->loadLarge(ir::Type::i8(), codeReadInt16(t, code, ip));
+      } break;
+
+      case lstore: {
+        frame->storeLarge(ir::Type::i8(), codeReadInt16(t, code, ip));
+      } break;
+
+      case ret: {
+        unsigned index = codeReadInt16(t, code, ip);
+
+        unsigned returnAddress = frame->endSubroutine(index);
+        c->jmp(frame->machineIpValue(returnAddress));
+        ip = returnAddress;
+      } break;
+
+      default:
+        abort(t);
+      }
+    } break;
+
+    default:
+      abort(t);
+    }
+  }
+
+next:
+  frame->dispose();
+  frame = 0;
+  stack.pop(sizeof(Frame));
+  stack.pop(stackSize * sizeof(ir::Type));
+  switch (stack.popValue()) {
+  case Return:
+    return;
+
+  case Unbranch:
+    if (DebugInstructions) {
+      fprintf(stderr, "Unbranch\n");
+    }
+    ip = stack.popValue();
+    c->restoreState(reinterpret_cast<Compiler::State*>(stack.popValue()));
+    frame = static_cast<Frame*>(stack.peek(sizeof(Frame)));
+    goto loop;
+
+  case Untable0: {
+    if (DebugInstructions) {
+      fprintf(stderr, "Untable0\n");
+    }
+    SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+
+    frame = s->frame();
+
+    c->restoreState(s->state);
+
+    c->condJump(lir::JumpIfGreater,
+                c->constant(s->top, ir::Type::i4()),
+                s->key,
+                frame->machineIpValue(s->defaultIp));
+
+    c->save(ir::Type::i4(), s->key);
+    ip = s->defaultIp;
+    stack.pushValue(Untable1);
+  }
+    goto start;
+
+  case Untable1: {
+    if (DebugInstructions) {
+      fprintf(stderr, "Untable1\n");
+    }
+    SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+
+    frame = s->frame();
+
+    c->restoreState(s->state);
+
+    ir::Value* normalizedKey
+        = (s->bottom
+               ? c->binaryOp(lir::Subtract,
+                             ir::Type::i4(),
+                             c->constant(s->bottom, ir::Type::i4()),
+                             s->key)
+               : s->key);
+
+    ir::Value* entry = c->memory(frame->absoluteAddressOperand(s->start),
+                                 ir::Type::iptr(),
+                                 0,
+                                 normalizedKey);
+
+    c->jmp(c->load(ir::ExtendMode::Signed,
+                   context->bootContext
+                       ? c->binaryOp(lir::Add,
+                                     ir::Type::iptr(),
+                                     c->memory(c->threadRegister(),
+                                               ir::Type::iptr(),
+                                               TARGET_THREAD_CODEIMAGE),
+                                     entry)
+                       : entry,
+                   ir::Type::iptr()));
+
+    s->state = c->saveState();
+  }
+    goto switchloop;
+
+  case Unswitch: {
+    if (DebugInstructions) {
+      fprintf(stderr, "Unswitch\n");
+    }
+    SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+
+    frame = s->frame();
+
+    c->restoreState(
+        static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)))->state);
+  }
+    goto switchloop;
+
+  case Unlookup: {
+    if (DebugInstructions) {
+      fprintf(stderr, "Unlookup\n");
+    }
+  }
+    goto lookuploop;
+
+  case Unsubroutine: {
+    if (DebugInstructions) {
+      fprintf(stderr, "Unsubroutine\n");
+    }
+    ip = stack.popValue();
+    unsigned start = stack.popValue();
+    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+    frame->endSubroutine(start);
+  }
+    goto loop;
+
+  default:
+    abort(t);
+  }
+
+switchloop : {
+  SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+
+  if (s->index < s->count) {
+    ip = s->ipTable()[s->index++];
+    stack.pushValue(Unswitch);
+    goto start;
+  } else {
+    ip = s->defaultIp;
+    unsigned count = s->count * 4;
+    stack.pop(sizeof(SwitchState));
+    stack.pop(count);
+    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+    goto loop;
+  }
+}
+
+lookuploop : {
+  // compare the key with each of a small lookupswitch's keys in turn,
+  // compiling the target of each comparison before moving on to the
+  // next, then fall through to the default
+  SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+
+  frame = s->frame();
+
+  c->restoreState(s->state);
+
+  if (s->index < s->count) {
+    unsigned index = s->index++;
+    ip = s->ipTable()[index];
+
+    c->condJump(lir::JumpIfEqual,
+                c->constant(s->keys[index], ir::Type::i4()),
+                s->key,
+                frame->machineIpValue(ip));
+
+    c->save(ir::Type::i4(), s->key);
+    s->state = c->saveState();
+
+    stack.pushValue(Unlookup);
+    goto start;
+  } else {
+    ip = s->defaultIp;
+    unsigned count = s->count * 4;
+    stack.pop(sizeof(SwitchState));
+    stack.pop(count);
+    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
+    goto loop;
+  }
+}
+
+branch:
+  stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
+  stack.pushValue(ip);
+  stack.pushValue(Unbranch);
+  ip = newIp;
+  goto start;
+}
+
+int resolveIpForwards(Context* context, int start, int end)
+{
+  if (start < 0) {
+    start = 0;
+  }
+
+  while (start < end and context->visitTable[start] == 0) {
+    ++start;
+  }
+
+  if (start >= end) {
+    return -1;
+  } else {
+    return start;
+  }
+}
+
+int resolveIpBackwards(Context* context, int start, int end)
+{
+  if (start >= static_cast<int>(context->method->code()->length()
+                                * (context->subroutineCount + 1))) {
+    start = context->method->code()->length();
+  } else {
+    while (start >= end and context->visitTable[start] == 0) {
+      --start;
+    }
+  }
+
+  if (start < end) {
+    return -1;
+  } else {
+    return start;
+  }
+}
+
+GcIntArray* truncateIntArray(Thread* t, GcIntArray* array, unsigned length)
+{
+  expect(t, array->length() > length);
+
+  PROTECT(t, array);
+
+  GcIntArray* newArray = makeIntArray(t, length);
+  if (length) {
+    memcpy(newArray->body().begin(), array->body().begin(), length * 4);
+  }
+
+  return newArray;
+}
+
+GcArray* truncateArray(Thread* t, GcArray* array, unsigned length)
+{
+  expect(t, array->length() > length);
+
+  PROTECT(t, array);
+
+  GcArray* newArray = makeArray(t, length);
+  if (length) {
+    for (size_t i = 0; i < length; i++) {
+      newArray->setBodyElement(t, i, array->body()[i]);
+    }
+  }
+
+  return newArray;
+}
+
+GcLineNumberTable* truncateLineNumberTable(Thread* t,
+                                           GcLineNumberTable* table,
+                                           unsigned length)
+{
+  expect(t, table->length() > length);
+
+  PROTECT(t, table);
+
+  GcLineNumberTable* newTable = makeLineNumberTable(t, length);
+  if (length) {
+    memcpy(newTable->body().begin(),
+           table->body().begin(),
+           length * sizeof(uint64_t));
+  }
+
+  return newTable;
+}
+
+GcArray* translateExceptionHandlerTable(MyThread* t,
+                                        Context* context,
+                                        intptr_t start,
+                                        intptr_t end)
+{
+  avian::codegen::Compiler* c = context->compiler;
+
+  GcExceptionHandlerTable* oldTable = cast<GcExceptionHandlerTable>(
+      t, context->method->code()->exceptionHandlerTable());
+
+  if (oldTable) {
+    PROTECT(t, oldTable);
+
+    unsigned length = oldTable->length();
+
+    GcIntArray* newIndex
+        = makeIntArray(t, length * (context->subroutineCount + 1) * 3);
+    PROTECT(t, newIndex);
+
+    GcArray* newTable
+        = makeArray(t, length * (context->subroutineCount + 1) + 1);
+    PROTECT(t, newTable);
+
+    unsigned ni = 0;
+    for (unsigned subI = 0; subI <= context->subroutineCount; ++subI) {
+      unsigned duplicatedBaseIp = subI * context->method->code()->length();
+
+      for (unsigned oi = 0; oi < length; ++oi) {
+        uint64_t oldHandler = oldTable->body()[oi];
+
+        int handlerStart = resolveIpForwards(
+            context,
+            duplicatedBaseIp + exceptionHandlerStart(oldHandler),
+            duplicatedBaseIp + exceptionHandlerEnd(oldHandler));
+
+        if (LIKELY(handlerStart >= 0)) {
+          assertT(t,
+                  handlerStart
+                  < static_cast<int>(context->method->code()->length()
+                                     * (context->subroutineCount + 1)));
+
+          int handlerEnd = resolveIpBackwards(
+              context,
+              duplicatedBaseIp + exceptionHandlerEnd(oldHandler),
+              duplicatedBaseIp + exceptionHandlerStart(oldHandler));
+
+          assertT(t, handlerEnd >= 0);
+          assertT(
+              t,
+              handlerEnd <= static_cast<int>(context->method->code()->length()
+                                             * (context->subroutineCount + 1)));
+
+          newIndex->body()[ni * 3] = c->machineIp(handlerStart)->value()
+                                     - start;
+
+          newIndex->body()[(ni * 3) + 1]
+              = (handlerEnd
+                     == static_cast<int>(context->method->code()->length())
+                     ? end
+                     : c->machineIp(handlerEnd)->value()) - start;
+
+          newIndex->body()[(ni * 3) + 2]
+              = c->machineIp(exceptionHandlerIp(oldHandler))->value() - start;
+
+          object type;
+          if (exceptionHandlerCatchType(oldHandler)) {
+            type = resolveClassInPool(
+                t, context->method, exceptionHandlerCatchType(oldHandler) - 1);
+          } else {
+            type = 0;
+          }
+
+          newTable->setBodyElement(t, ni + 1, type);
+
+          ++ni;
+        }
+      }
+    }
+
+    if (UNLIKELY(ni < length)) {
+      newIndex = truncateIntArray(t, newIndex, ni * 3);
+      newTable = truncateArray(t, newTable, ni + 1);
+    }
+
+    newTable->setBodyElement(t, 0, newIndex);
+
+    return newTable;
+  } else {
+    return 0;
+  }
+}
+
+GcLineNumberTable* translateLineNumberTable(MyThread* t,
+                                            Context* context,
+                                            intptr_t start)
+{
+  GcLineNumberTable* oldTable = context->method->code()->lineNumberTable();
+  if (oldTable) {
+    PROTECT(t, oldTable);
+
+    unsigned length = oldTable->length();
+    GcLineNumberTable* newTable = makeLineNumberTable(t, length);
+    unsigned ni = 0;
+    for (unsigned oi = 0; oi < length; ++oi) {
+      uint64_t oldLine = oldTable->body()[oi];
+
+      int ip = resolveIpForwards(
+          context,
+          lineNumberIp(oldLine),
+          oi + 1 < length ? lineNumberIp(oldTable->body()[oi + 1]) - 1
+                          : lineNumberIp(oldLine) + 1);
+
+      if (LIKELY(ip >= 0)) {
+        newTable->body()[ni++]
+            = lineNumber(context->compiler->machineIp(ip)->value() - start,
+                         lineNumberLine(oldLine));
+      }
+    }
+
+    if (UNLIKELY(ni < length)) {
+      newTable = truncateLineNumberTable(t, newTable, ni);
+    }
+
+    return newTable;
+  } else {
+    return 0;
+  }
+}
+
+// The compiler places calls which are only made when a check fails
+// after the rest of the method.  Such a call must be covered by the
+// same exception handlers as the place it stands in for.
+GcArray* addColdCallHandlers(MyThread* t,
+                             Context* context,
+                             GcArray* table,
+                             intptr_t start)
+{
+  avian::codegen::Compiler* c = context->compiler;
+
+  if (table == 0 or c->coldCallCount() == 0) {
+    return table;
+  }
+
+  PROTECT(t, table);
+
+  GcIntArray* index = cast<GcIntArray>(t, table->body()[0]);
+  PROTECT(t, index);
+
+  unsigned length = table->length() - 1;
+  unsigned extra = 0;
+  for (unsigned ci = 0; ci < c->coldCallCount(); ++ci) {
+    avian::codegen::Promise* callStart;
+    avian::codegen::Promise* callEnd;
+    avian::codegen::Promise* hotReturn;
+    c->coldCall(ci, &callStart, &callEnd, &hotReturn);
+
+    unsigned key = hotReturn->value() - start - 1;
+    for (unsigned i = 0; i < length; ++i) {
+      if (key >= static_cast<unsigned>(index->body()[i * 3])
+          and key < static_cast<unsigned>(index->body()[(i * 3) + 1])) {
+        ++extra;
+      }
+    }
+  }
+
+  if (extra == 0) {
+    return table;
+  }
+
+  GcIntArray* newIndex = makeIntArray(t, (length + extra) * 3);
+  memcpy(newIndex->body().begin(),
+         index->body().begin(),
+         length * 3 * sizeof(int32_t));
+  PROTECT(t, newIndex);
+
+  GcArray* newTable = makeArray(t, length + extra + 1);
+  for (unsigned i = 0; i < length; ++i) {
+    newTable->setBodyElement(t, i + 1, table->body()[i + 1]);
+  }
+
+  // nothing else falls within the cold calls, so appending the new
+  // entries leaves the order in which handlers are tried unchanged
+  unsigned ni = length;
+  for (unsigned ci = 0; ci < c->coldCallCount(); ++ci) {
+    avian::codegen::Promise* callStart;
+    avian::codegen::Promise* callEnd;
+    avian::codegen::Promise* hotReturn;
+    c->coldCall(ci, &callStart, &callEnd, &hotReturn);
+
+    unsigned key = hotReturn->value() - start - 1;
+    for (unsigned i = 0; i < length; ++i) {
+      if (key >= static_cast<unsigned>(index->body()[i * 3])
+          and key < static_cast<unsigned>(index->body()[(i * 3) + 1])) {
+        newIndex->body()[ni * 3] = callStart->value() - start;
+        newIndex->body()[(ni * 3) + 1] = callEnd->value() - start;
+        newIndex->body()[(ni * 3) + 2] = index->body()[(i * 3) + 2];
+        newTable->setBodyElement(t, ni + 1, table->body()[i + 1]);
+        ++ni;
+      }
+    }
+  }
+
+  newTable->setBodyElement(t, 0, newIndex);
+
+  return newTable;
+}
+
+// Likewise, a cold call reports the line of the place it stands in
+// for.
+GcLineNumberTable* addColdCallLines(MyThread* t,
+                                    Context* context,
+                                    GcLineNumberTable* table,
+                                    intptr_t start)
+{
+  avian::codegen::Compiler* c = context->compiler;
+
+  if (table == 0 or table->length() == 0 or c->coldCallCount() == 0) {
+    return table;
+  }
+
+  PROTECT(t, table);
+
+  unsigned length = table->length();
+  GcLineNumberTable* newTable
+      = makeLineNumberTable(t, length + c->coldCallCount());
+  memcpy(newTable->body().begin(),
+         table->body().begin(),
+         length * sizeof(uint64_t));
+
+  unsigned line = 0;
+  unsigned li = 0;
+  for (unsigned ci = 0; ci < c->coldCallCount(); ++ci) {
+    avian::codegen::Promise* callStart;
+    avian::codegen::Promise* callEnd;
+    avian::codegen::Promise* hotReturn;
+    c->coldCall(ci, &callStart, &callEnd, &hotReturn);
+
+    // the cold calls are in the same order as the checks they belong
+    // to, so one pass over the table finds all their lines
+    unsigned ip = hotReturn->value() - start - 1;
+    while (li < length and lineNumberIp(table->body()[li]) <= ip) {
+      line = lineNumberLine(table->body()[li++]);
+    }
+
+    newTable->body()[length + ci]
+        = lineNumber(callStart->value() - start, line);
+  }
+
+  return newTable;
+}
+
+void printSet(uintptr_t* m, unsigned limit)
+{
+  if (limit) {
+    for (unsigned i = 0; i < 32; ++i) {
+      if ((*m >> i) & 1) {
+        fprintf(stderr, "1");
+      } else {
+        fprintf(stderr, "_");
+      }
+    }
+  }
+}
+
+void calculateTryCatchRoots(Context* context,
+                            uintptr_t* roots,
+                            unsigned mapSize,
+                            unsigned start,
+                            unsigned end)
+{
+  memset(roots, 0xFF, mapSize * BytesPerWord);
+
+  if (DebugFrameMaps) {
+    fprintf(stderr, "calculate try/catch roots from %d to %d\n", start, end);
+  }
+
+  for (TraceElement* te = context->traceLog; te; te = te->next) {
+    if (te->ip >= start and te->ip < end) {
+      uintptr_t* traceRoots = 0;
+      traceRoots = te->map;
+      te->watch = true;
+
+      if (traceRoots) {
+        if (DebugFrameMaps) {
+          fprintf(stderr, "   use roots at ip %3d: ", te->ip);
+          printSet(traceRoots, mapSize);
+          fprintf(stderr, "\n");
+        }
+
+        for (unsigned wi = 0; wi < mapSize; ++wi) {
+          roots[wi] &= traceRoots[wi];
+        }
+      } else {
+        if (DebugFrameMaps) {
+          fprintf(stderr, "  skip roots at ip %3d\n", te->ip);
+        }
+      }
+    }
+  }
+
+  if (DebugFrameMaps) {
+    fprintf(stderr, "result roots          : ");
+    printSet(roots, mapSize);
+    fprintf(stderr, "\n");
+  }
+}
+
+unsigned calculateFrameMaps(MyThread* t,
+                            Context* context,
+                            uintptr_t* originalRoots,
+                            unsigned eventIndex,
+                            uintptr_t* resultRoots)
+{
+  // for each instruction with more than one predecessor, and for each
+  // stack position, determine if there exists a path to that
+  // instruction such that there is not an object pointer left at that
+  // stack position (i.e. it is uninitialized or contains primitive
+  // data).
+
+  unsigned mapSize = frameMapSizeInWords(t, context->method);
+
+  THREAD_RUNTIME_ARRAY(t, uintptr_t, roots, mapSize);
+  if (originalRoots) {
+    memcpy(RUNTIME_ARRAY_BODY(roots), originalRoots, mapSize * BytesPerWord);
+  } else {
+    memset(RUNTIME_ARRAY_BODY(roots), 0, mapSize * BytesPerWord);
+  }
+
+  int32_t ip = -1;
+
+  // invariant: for each stack position, roots contains a zero at that
+  // position if there exists some path to the current instruction
+  // such that there is definitely not an object pointer at that
+  // position.  Otherwise, roots contains a one at that position,
+  // meaning either all known paths result in an object pointer at
+  // that position, or the contents of that position are as yet
+  // unknown.
+
+  unsigned length = context->eventLog.length();
+  while (eventIndex < length) {
+    Event e = static_cast<Event>(context->eventLog.get(eventIndex++));
+    switch (e) {
+    case PushContextEvent: {
+      eventIndex = calculateFrameMaps(t,
+                                      context,
+                                      RUNTIME_ARRAY_BODY(roots),
+                                      eventIndex, /*subroutinePath,*/
+                                      resultRoots);
+    } break;
+
+    case PopContextEvent:
+      goto exit;
+
+    case IpEvent: {
+      ip = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
+
+      if (DebugFrameMaps) {
+        fprintf(stderr, "       roots at ip %3d: ", ip);
+        printSet(RUNTIME_ARRAY_BODY(roots), mapSize);
+        fprintf(stderr, "\n");
+      }
+
+      assertT(context->thread, ip * mapSize <= context->rootTable.count);
+      uintptr_t* tableRoots = context->rootTable.begin() + (ip * mapSize);
 
-            c->nativeCall(
-                c->constant(getThunk(t, setLongFieldValueFromReferenceThunk),
-                            ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                rType,
-                args(c->threadRegister(),
-                     frame->append(pair),
-                     instance,
-                     nullptr,
-                     value));
-          }
-        } break;
+      if (context->visitTable[ip] > 1) {
+        for (unsigned wi = 0; wi < mapSize; ++wi) {
+          uintptr_t newRoots = tableRoots[wi] & RUNTIME_ARRAY_BODY(roots)[wi];
 
-        case ObjectField: {
-          if (instruction == putstatic) {
-            c->nativeCall(
-                c->constant(
-                    getThunk(t, setStaticObjectFieldValueFromReferenceThunk),
-                    ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                rType,
-                args(c->threadRegister(), frame->append(pair), value));
-          } else {
-            ir::Value* instance = frame->pop(ir::Type::object());
+          if ((eventIndex == length
+               or context->eventLog.get(eventIndex) == PopContextEvent)
+              and newRoots != tableRoots[wi]) {
+            if (DebugFrameMaps) {
+              fprintf(stderr, "dirty roots!\n");
+            }
 
-            c->nativeCall(
-                c->constant(getThunk(t, setObjectFieldValueFromReferenceThunk),
-                            ir::Type::iptr()),
-                0,
-                frame->trace(0, 0),
-                rType,
-                args(
-                    c->threadRegister(), frame->append(pair), instance, value));
+            context->dirtyRoots = true;
           }
-        } break;
 
-        default:
-          abort(t);
+          tableRoots[wi] = newRoots;
+          RUNTIME_ARRAY_BODY(roots)[wi] &= tableRoots[wi];
         }
+
+        if (DebugFrameMaps) {
+          fprintf(stderr, " table roots at ip %3d: ", ip);
+          printSet(tableRoots, mapSize);
+          fprintf(stderr, "\n");
+        }
+      } else {
+        memcpy(tableRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
       }
     } break;
 
-    case ret: {
-      unsigned index = code->body()[ip];
+    case MarkEvent: {
+      unsigned i = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-      unsigned returnAddress = frame->endSubroutine(index);
-      c->jmp(frame->machineIpValue(returnAddress));
-      ip = returnAddress;
+      markBit(RUNTIME_ARRAY_BODY(roots), i);
     } break;
 
-    case return_:
-      if (needsReturnBarrier(t, context->method)) {
-        c->nullaryOp(lir::StoreStoreBarrier);
-      }
-
-      handleExit(t, frame);
-      c->return_();
-      goto next;
+    case ClearEvent: {
+      unsigned i = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-    case sipush:
-      frame->push(ir::Type::i4(),
-                  c->constant(static_cast<int16_t>(codeReadInt16(t, code, ip)),
-                              ir::Type::i4()));
-      break;
+      clearBit(RUNTIME_ARRAY_BODY(roots), i);
+    } break;
 
-    case swap:
-      frame->swap();
-      break;
+    case PushExceptionHandlerEvent: {
+      unsigned start = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
+      unsigned end = context->eventLog.get2(eventIndex);
+      eventIndex += 2;
 
-    case tableswitch: {
-      int32_t base = ip - 1;
+      calculateTryCatchRoots(
+          context, RUNTIME_ARRAY_BODY(roots), mapSize, start, end);
 
-      ip = (ip + 3) & ~3;  // pad to four byte boundary
+      eventIndex = calculateFrameMaps(
+          t, context, RUNTIME_ARRAY_BODY(roots), eventIndex, 0);
+    } break;
 
-      uint32_t defaultIp = base + codeReadInt32(t, code, ip);
-      assertT(t, defaultIp < code->length());
+    case TraceEvent: {
+      TraceElement* te;
+      context->eventLog.get(eventIndex, &te, BytesPerWord);
+      if (DebugFrameMaps) {
+        fprintf(stderr, " trace roots at ip %3d: ", ip);
+        printSet(RUNTIME_ARRAY_BODY(roots), mapSize);
+        fprintf(stderr, "\n");
+      }
 
-      int32_t bottom = codeReadInt32(t, code, ip);
-      int32_t top = codeReadInt32(t, code, ip);
+      uintptr_t* map;
+      bool watch;
+      map = te->map;
+      watch = te->watch;
 
-      avian::codegen::Promise* start = 0;
-      unsigned count = top - bottom + 1;
-      uint32_t* ipTable
-          = static_cast<uint32_t*>(stack.push(sizeof(uint32_t) * count));
-      for (int32_t i = 0; i < top - bottom + 1; ++i) {
-        unsigned index = ip + (i * 4);
-        uint32_t newIp = base + codeReadInt32(t, code, index);
-        assertT(t, newIp < code->length());
+      for (unsigned wi = 0; wi < mapSize; ++wi) {
+        uintptr_t v = RUNTIME_ARRAY_BODY(roots)[wi];
 
-        ipTable[i] = newIp;
+        if (watch and map[wi] != v) {
+          if (DebugFrameMaps) {
+            fprintf(stderr, "dirty roots due to trace watch!\n");
+          }
 
-        avian::codegen::Promise* p = c->poolAppendPromise(
-            frame->addressPromise(frame->machineIp(newIp)));
-        if (i == 0) {
-          start = p;
+          context->dirtyRoots = true;
         }
-      }
-      assertT(t, start);
-
-      ir::Value* key = frame->pop(ir::Type::i4());
 
-      c->condJump(lir::JumpIfLess,
-                  c->constant(bottom, ir::Type::i4()),
-                  key,
-                  frame->machineIpValue(defaultIp));
+        map[wi] = v;
+      }
 
-      c->save(ir::Type::i4(), key);
+      eventIndex += BytesPerWord;
+    } break;
 
-      new (stack.push(sizeof(SwitchState))) SwitchState(
-          c->saveState(), count, defaultIp, key, start, bottom, top);
+    default:
+      abort(t);
+    }
+  }
 
-      stack.pushValue(Untable0);
-      ip = defaultIp;
+exit:
+  if (resultRoots and ip != -1) {
+    if (DebugFrameMaps) {
+      fprintf(stderr, "result roots at ip %3d: ", ip);
+      printSet(RUNTIME_ARRAY_BODY(roots), mapSize);
+      fprintf(stderr, "\n");
     }
-      goto start;
 
-    case wide: {
-      switch (code->body()[ip++]) {
-      case aload: {
-        frame->load(ir::Type::object(), codeReadInt16(t, code, ip));
-      } break;
+    memcpy(resultRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
+  }
 
-      case astore: {
-        frame->store(ir::Type::object(), codeReadInt16(t, code, ip));
-      } break;
+  return eventIndex;
+}
 
-      case iinc: {
-        uint16_t index = codeReadInt16(t, code, ip);
-        int16_t count = codeReadInt16(t, code, ip);
+int compareTraceElementPointers(const void* va, const void* vb)
+{
+  TraceElement* a = *static_cast<TraceElement* const*>(va);
+  TraceElement* b = *static_cast<TraceElement* const*>(vb);
+  if (a->address->value() > b->address->value()) {
+    return 1;
+  } else if (a->address->value() < b->address->value()) {
+    return -1;
+  } else {
+    return 0;
+  }
+}
 
-        storeLocal(context,
-                   1,
-                   ir::Type::i4(),
-                   c->binaryOp(lir::Add,
-                               ir::Type::i4(),
-                               c->constant(count, ir::Type::i4()),
-                               loadLocal(context, 1, ir::Type::i4(), index)),
-                   index);
-      } break;
+uint8_t* finish(MyThread* t,
+                FixedAllocator* allocator,
+                avian::codegen::Assembler* a,
+                const char* name,
+                unsigned length)
+{
+  uint8_t* start
+      = static_cast<uint8_t*>(allocator->allocate(length, TargetBytesPerWord));
 
-      case iload: {
-        frame->load(ir::Type::i4(), codeReadInt16(t, code, ip));
-      } break;
+  a->setDestination(start);
+  a->write();
 
-      case istore: {
-        frame->store(ir::Type::i4(), codeReadInt16(t, code, ip));
-      } break;
+  logCompile(t, start, length, 0, name, 0);
 
-      case lload: {
-        frame->loadLarge(ir::Type::i8(), codeReadInt16(t, code, ip));
-      } break;
+  return start;
+}
 
-      case lstore: {
-        frame->storeLarge(ir::Type::i8(), codeReadInt16(t, code, ip));
-      } break;
+void setBit(int32_t* dst, unsigned index)
+{
+  dst[index / 32] |= static_cast<int32_t>(1) << (index % 32);
+}
 
-      case ret: {
-        unsigned index = codeReadInt16(t, code, ip);
+void clearBit(int32_t* dst, unsigned index)
+{
+  dst[index / 32] &= ~(static_cast<int32_t>(1) << (index % 32));
+}
+
+void copyFrameMap(int32_t* dst,
+                  uintptr_t* src,
+                  unsigned mapSizeInBits,
+                  unsigned offset,
+                  TraceElement* p)
+{
+  if (DebugFrameMaps) {
+    fprintf(stderr, "  orig roots at ip %3d: ", p->ip);
+    printSet(src, ceilingDivide(mapSizeInBits, BitsPerWord));
+    fprintf(stderr, "\n");
 
-        unsigned returnAddress = frame->endSubroutine(index);
-        c->jmp(frame->machineIpValue(returnAddress));
-        ip = returnAddress;
-      } break;
+    fprintf(stderr, " final roots at ip %3d: ", p->ip);
+  }
 
-      default:
-        abort(t);
+  for (unsigned j = 0; j < p->argumentIndex; ++j) {
+    if (getBit(src, j)) {
+      if (DebugFrameMaps) {
+        fprintf(stderr, "1");
       }
-    } break;
-
-    default:
-      abort(t);
+      setBit(dst, offset + j);
+    } else {
+      if (DebugFrameMaps) {
+        fprintf(stderr, "_");
+      }
+      clearBit(dst, offset + j);
     }
   }
 
-next:
-  frame->dispose();
-  frame = 0;
-  stack.pop(sizeof(Frame));
-  stack.pop(stackSize * sizeof(ir::Type));
-  switch (stack.popValue()) {
-  case Return:
-    return;
-
-  case Unbranch:
-    if (DebugInstructions) {
-      fprintf(stderr, "Unbranch\n");
-    }
-    ip = stack.popValue();
-    c->restoreState(reinterpret_cast<Compiler::State*>(stack.popValue()));
-    frame = static_cast<Frame*>(stack.peek(sizeof(Frame)));
-    goto loop;
+  if (DebugFrameMaps) {
+    fprintf(stderr, "\n");
+  }
+}
 
-  case Untable0: {
-    if (DebugInstructions) {
-      fprintf(stderr, "Untable0\n");
-    }
-    SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+class FrameMapTableHeader {
+ public:
+  FrameMapTableHeader(unsigned indexCount) : indexCount(indexCount)
+  {
+  }
 
-    frame = s->frame();
+  unsigned indexCount;
+};
 
-    c->restoreState(s->state);
+class FrameMapTableIndexElement {
+ public:
+  FrameMapTableIndexElement(int offset, unsigned base, unsigned path)
+      : offset(offset), base(base), path(path)
+  {
+  }
 
-    c->condJump(lir::JumpIfGreater,
-                c->constant(s->top, ir::Type::i4()),
-                s->key,
-                frame->machineIpValue(s->defaultIp));
+  int offset;
+  unsigned base;
+  unsigned path;
+};
 
-    c->save(ir::Type::i4(), s->key);
-    ip = s->defaultIp;
-    stack.pushValue(Untable1);
+class FrameMapTablePath {
+ public:
+  FrameMapTablePath(unsigned stackIndex, unsigned elementCount, unsigned next)
+      : stackIndex(stackIndex), elementCount(elementCount), next(next)
+  {
   }
-    goto start;
 
-  case Untable1: {
-    if (DebugInstructions) {
-      fprintf(stderr, "Untable1\n");
-    }
-    SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+  unsigned stackIndex;
+  unsigned elementCount;
+  unsigned next;
+  int32_t elements[0];
+};
 
-    frame = s->frame();
+bool hasRoot(TraceElement* p, unsigned index)
+{
+  return index < p->argumentIndex and getBit(p->map, index);
+}
 
-    c->restoreState(s->state);
+unsigned rootHash(TraceElement* p)
+{
+  unsigned hash = 0;
+  for (unsigned i = 0; i < p->argumentIndex; ++i) {
+    if (getBit(p->map, i)) {
+      hash = (hash * 31) + i;
+    }
+  }
+  return hash;
+}
 
-    ir::Value* normalizedKey
-        = (s->bottom
-               ? c->binaryOp(lir::Subtract,
-                             ir::Type::i4(),
-                             c->constant(s->bottom, ir::Type::i4()),
-                             s->key)
-               : s->key);
+bool sameRoots(TraceElement* a, TraceElement* b)
+{
+  unsigned limit = max(a->argumentIndex, b->argumentIndex);
+  for (unsigned i = 0; i < limit; ++i) {
+    if (hasRoot(a, i) != hasRoot(b, i)) {
+      return false;
+    }
+  }
+  return true;
+}
 
-    ir::Value* entry = c->memory(frame->absoluteAddressOperand(s->start),
-                                 ir::Type::iptr(),
-                                 0,
-                                 normalizedKey);
+GcIntArray* makeFrameMapTable(MyThread* t,
+                              Context* context,
+                              uint8_t* start,
+                              TraceElement** elements,
+                              unsigned elementCount)
+{
+  unsigned mapSize = frameMapSizeInBits(t, context->method);
 
-    c->jmp(c->load(ir::ExtendMode::Signed,
-                   context->bootContext
-                       ? c->binaryOp(lir::Add,
-                                     ir::Type::iptr(),
-                                     c->memory(c->threadRegister(),
-                                               ir::Type::iptr(),
-                                               TARGET_THREAD_CODEIMAGE),
-                                     entry)
-                       : entry,
-                   ir::Type::iptr()));
+  THREAD_RUNTIME_ARRAY(t, unsigned, mapIndexes, elementCount);
+  THREAD_RUNTIME_ARRAY(t, TraceElement*, maps, elementCount);
+  THREAD_RUNTIME_ARRAY(t, unsigned, hashes, elementCount);
+  unsigned mapCount = 0;
+  unsigned maxDelta = 0;
 
-    s->state = c->saveState();
-  }
-    goto switchloop;
+  for (unsigned i = 0; i < elementCount; ++i) {
+    TraceElement* p = elements[i];
 
-  case Unswitch: {
-    if (DebugInstructions) {
-      fprintf(stderr, "Unswitch\n");
+    if (i % FrameMapIndexInterval) {
+      maxDelta = max(maxDelta,
+                     static_cast<unsigned>(p->address->value()
+                                           - elements[i - 1]->address->value()));
     }
-    SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
 
-    frame = s->frame();
-
-    c->restoreState(
-        static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)))->state);
-  }
-    goto switchloop;
+    unsigned hash = rootHash(p);
+    unsigned j = 0;
+    while (j < mapCount
+           and (RUNTIME_ARRAY_BODY(hashes)[j] != hash
+                or not sameRoots(RUNTIME_ARRAY_BODY(maps)[j], p))) {
+      ++j;
+    }
 
-  case Unsubroutine: {
-    if (DebugInstructions) {
-      fprintf(stderr, "Unsubroutine\n");
+    if (j == mapCount) {
+      RUNTIME_ARRAY_BODY(maps)[mapCount] = p;
+      RUNTIME_ARRAY_BODY(hashes)[mapCount] = hash;
+      ++mapCount;
     }
-    ip = stack.popValue();
-    unsigned start = stack.popValue();
-    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
-    frame->endSubroutine(start);
-  }
-    goto loop;
 
-  default:
-    abort(t);
+    RUNTIME_ARRAY_BODY(mapIndexes)[i] = j;
   }
 
-switchloop : {
-  SwitchState* s = static_cast<SwitchState*>(stack.peek(sizeof(SwitchState)));
+  FrameMapTable layout(elementCount, mapCount, bitsNeeded(maxDelta), mapSize);
 
-  if (s->index < s->count) {
-    ip = s->ipTable()[s->index++];
-    stack.pushValue(Unswitch);
-    goto start;
-  } else {
-    ip = s->defaultIp;
-    unsigned count = s->count * 4;
-    stack.pop(sizeof(SwitchState));
-    stack.pop(count);
-    frame = reinterpret_cast<Frame*>(stack.peek(sizeof(Frame)));
-    goto loop;
-  }
-}
+  GcIntArray* table = makeIntArray(t, layout.length());
 
-branch:
-  stack.pushValue(reinterpret_cast<uintptr_t>(c->saveState()));
-  stack.pushValue(ip);
-  stack.pushValue(Unbranch);
-  ip = newIp;
-  goto start;
-}
+  table->body()[0] = elementCount;
+  table->body()[1] = mapCount;
+  table->body()[2] = layout.deltaBits;
 
-int resolveIpForwards(Context* context, int start, int end)
-{
-  if (start < 0) {
-    start = 0;
-  }
+  uint32_t* body = reinterpret_cast<uint32_t*>(table->body().begin());
 
-  while (start < end and context->visitTable[start] == 0) {
-    ++start;
-  }
+  for (unsigned i = 0; i < elementCount; ++i) {
+    TraceElement* p = elements[i];
 
-  if (start >= end) {
-    return -1;
-  } else {
-    return start;
+    if (i % FrameMapIndexInterval) {
+      setBits(body + layout.deltaStart(),
+              layout.deltaBits,
+              i * layout.deltaBits,
+              p->address->value() - elements[i - 1]->address->value());
+    } else {
+      table->body()[layout.indexStart() + (i / FrameMapIndexInterval)]
+          = static_cast<intptr_t>(p->address->value())
+            - reinterpret_cast<intptr_t>(start);
+    }
+
+    setBits(body + layout.mapIndexStart(),
+            layout.indexBits,
+            i * layout.indexBits,
+            RUNTIME_ARRAY_BODY(mapIndexes)[i]);
   }
-}
 
-int resolveIpBackwards(Context* context, int start, int end)
-{
-  if (start >= static_cast<int>(context->method->code()->length()
-                                * (context->subroutineCount + 1))) {
-    start = context->method->code()->length();
-  } else {
-    while (start >= end and context->visitTable[start] == 0) {
-      --start;
+  if (mapSize) {
+    for (unsigned i = 0; i < mapCount; ++i) {
+      copyFrameMap(&table->body()[layout.mapStart()],
+                   RUNTIME_ARRAY_BODY(maps)[i]->map,
+                   mapSize,
+                   i * mapSize,
+                   RUNTIME_ARRAY_BODY(maps)[i]);
     }
   }
 
-  if (start < end) {
-    return -1;
-  } else {
-    return start;
-  }
+  return table;
 }
 
-GcIntArray* truncateIntArray(Thread* t, GcIntArray* array, unsigned length)
-{
-  expect(t, array->length() > length);
-
-  PROTECT(t, array);
+void insertCallNode(MyThread* t, GcCallNode* node);
 
-  GcIntArray* newArray = makeIntArray(t, length);
-  if (length) {
-    memcpy(newArray->body().begin(), array->body().begin(), length * 4);
-  }
+void bindDevirtualizedCall(MyThread* t, GcMethod* target, void** cell);
 
-  return newArray;
-}
+void registerDevirtualizedCall(MyThread* t, GcMethod* target, void** cell);
 
-GcArray* truncateArray(Thread* t, GcArray* array, unsigned length)
+void finish(MyThread* t, FixedAllocator* allocator, Context* context)
 {
-  expect(t, array->length() > length);
+  avian::codegen::Compiler* c = context->compiler;
 
-  PROTECT(t, array);
+  if (false) {
+    logCompile(t, 0, 0, context->method);
+  }
 
-  GcArray* newArray = makeArray(t, length);
-  if (length) {
-    for (size_t i = 0; i < length; i++) {
-      newArray->setBodyElement(t, i, array->body()[i]);
-    }
+  // for debugging:
+  if (false
+      and ::strcmp(reinterpret_cast<const char*>(
+                       context->method->class_()->name()->body().begin()),
+                   "java/lang/System") == 0
+      and ::strcmp(reinterpret_cast<const char*>(
+                       context->method->name()->body().begin()),
+                   "<clinit>") == 0) {
+    trap();
   }
 
-  return newArray;
-}
+  // todo: this is a CPU-intensive operation, so consider doing it
+  // earlier before we've acquired the global class lock to improve
+  // parallelism (the downside being that it may end up being a waste
+  // of cycles if another thread compiles the same method in parallel,
+  // which might be mitigated by fine-grained, per-method locking):
+  c->compile(context->leaf ? 0 : stackOverflowThunk(t),
+             TARGET_THREAD_STACKLIMIT);
+
+  // we must acquire the class lock here at the latest
+
+  unsigned codeSize = c->resolve(allocator->memory.begin() + allocator->offset);
+
+  unsigned total = pad(codeSize, TargetBytesPerWord)
+                   + pad(c->poolSize(), TargetBytesPerWord);
 
-GcLineNumberTable* truncateLineNumberTable(Thread* t,
-                                           GcLineNumberTable* table,
-                                           unsigned length)
-{
-  expect(t, table->length() > length);
+  target_uintptr_t* code = static_cast<target_uintptr_t*>(
+      allocator->allocate(total, TargetBytesPerWord));
+  uint8_t* start = reinterpret_cast<uint8_t*>(code);
 
-  PROTECT(t, table);
+  context->executableAllocator = allocator;
+  context->executableStart = code;
+  context->executableSize = total;
 
-  GcLineNumberTable* newTable = makeLineNumberTable(t, length);
-  if (length) {
-    memcpy(newTable->body().begin(),
-           table->body().begin(),
-           length * sizeof(uint64_t));
-  }
+  if (context->objectPool) {
+    object pool = allocate3(
+        t,
+        allocator,
+        Machine::ImmortalAllocation,
+        GcArray::FixedSize + ((context->objectPoolCount + 1) * BytesPerWord),
+        true);
 
-  return newTable;
-}
+    context->executableSize = (allocator->memory.begin() + allocator->offset)
+                              - static_cast<uint8_t*>(context->executableStart);
 
-GcArray* translateExceptionHandlerTable(MyThread* t,
-                                        Context* context,
-                                        intptr_t start,
-                                        intptr_t end)
-{
-  avian::codegen::Compiler* c = context->compiler;
+    initArray(
+        t, reinterpret_cast<GcArray*>(pool), context->objectPoolCount + 1);
+    mark(t, pool, 0);
 
-  GcExceptionHandlerTable* oldTable = cast<GcExceptionHandlerTable>(
-      t, context->method->code()->exceptionHandlerTable());
+    setField(t, pool, ArrayBody, compileRoots(t)->objectPools());
+    compileRoots(t)->setObjectPools(t, pool);
 
-  if (oldTable) {
-    PROTECT(t, oldTable);
+    unsigned i = 1;
+    for (PoolElement* p = context->objectPool; p; p = p->next) {
+      unsigned offset = ArrayBody + ((i++) * BytesPerWord);
 
-    unsigned length = oldTable->length();
+      p->address = reinterpret_cast<uintptr_t>(pool) + offset;
 
-    GcIntArray* newIndex
-        = makeIntArray(t, length * (context->subroutineCount + 1) * 3);
-    PROTECT(t, newIndex);
+      setField(t, pool, offset, p->target);
+    }
+  }
 
-    GcArray* newTable
-        = makeArray(t, length * (context->subroutineCount + 1) + 1);
-    PROTECT(t, newTable);
+  c->write();
 
-    unsigned ni = 0;
-    for (unsigned subI = 0; subI <= context->subroutineCount; ++subI) {
-      unsigned duplicatedBaseIp = subI * context->method->code()->length();
+  for (DevirtualizedCallElement* p = context->devirtualizedCalls; p;
+       p = p->next) {
+    bindDevirtualizedCall(
+        t, p->target, reinterpret_cast<void**>(p->cell->value()));
+  }
 
-      for (unsigned oi = 0; oi < length; ++oi) {
-        uint64_t oldHandler = oldTable->body()[oi];
+  BootContext* bc = context->bootContext;
+  if (bc) {
+    for (avian::codegen::DelayedPromise* p = bc->addresses;
+         p != bc->addressSentinal;
+         p = p->next) {
+      p->basis = new (bc->zone)
+          avian::codegen::ResolvedPromise(p->basis->value());
+    }
+  }
 
-        int handlerStart = resolveIpForwards(
-            context,
-            duplicatedBaseIp + exceptionHandlerStart(oldHandler),
-            duplicatedBaseIp + exceptionHandlerEnd(oldHandler));
+  {
+    // a handler which runs to the end of the method stops short of
+    // any calls compiled out of line
+    intptr_t end = reinterpret_cast<intptr_t>(start) + codeSize;
+    if (c->coldCallCount()) {
+      avian::codegen::Promise* callStart;
+      avian::codegen::Promise* callEnd;
+      avian::codegen::Promise* hotReturn;
+      c->coldCall(0, &callStart, &callEnd, &hotReturn);
+      end = callStart->value();
+    }
 
-        if (LIKELY(handlerStart >= 0)) {
-          assertT(t,
-                  handlerStart
-                  < static_cast<int>(context->method->code()->length()
-                                     * (context->subroutineCount + 1)));
+    GcArray* newExceptionHandlerTable = addColdCallHandlers(
+        t,
+        context,
+        translateExceptionHandlerTable(
+            t, context, reinterpret_cast<intptr_t>(start), end),
+        reinterpret_cast<intptr_t>(start));
 
-          int handlerEnd = resolveIpBackwards(
-              context,
-              duplicatedBaseIp + exceptionHandlerEnd(oldHandler),
-              duplicatedBaseIp + exceptionHandlerStart(oldHandler));
+    PROTECT(t, newExceptionHandlerTable);
 
-          assertT(t, handlerEnd >= 0);
-          assertT(
-              t,
-              handlerEnd <= static_cast<int>(context->method->code()->length()
-                                             * (context->subroutineCount + 1)));
+    GcLineNumberTable* newLineNumberTable = addColdCallLines(
+        t,
+        context,
+        translateLineNumberTable(t, context, reinterpret_cast<intptr_t>(start)),
+        reinterpret_cast<intptr_t>(start));
 
-          newIndex->body()[ni * 3] = c->machineIp(handlerStart)->value()
-                                     - start;
+    GcCode* code = context->method->code();
 
-          newIndex->body()[(ni * 3) + 1]
-              = (handlerEnd
-                     == static_cast<int>(context->method->code()->length())
-                     ? end
-                     : c->machineIp(handlerEnd)->value()) - start;
+    code = makeCode(t,
+                    0,
+                    0,
+                    newExceptionHandlerTable,
+                    newLineNumberTable,
+                    reinterpret_cast<uintptr_t>(start),
+                    codeSize,
+                    code->maxStack(),
+                    code->maxLocals(),
+                    0);
 
-          newIndex->body()[(ni * 3) + 2]
-              = c->machineIp(exceptionHandlerIp(oldHandler))->value() - start;
+    context->method->setCode(t, code);
+  }
 
-          object type;
-          if (exceptionHandlerCatchType(oldHandler)) {
-            type = resolveClassInPool(
-                t, context->method, exceptionHandlerCatchType(oldHandler) - 1);
-          } else {
-            type = 0;
-          }
+  if (context->traceLogCount) {
+    THREAD_RUNTIME_ARRAY(t, TraceElement*, elements, context->traceLogCount);
+    unsigned index = 0;
+    // unsigned pathFootprint = 0;
+    // unsigned mapCount = 0;
+    for (TraceElement* p = context->traceLog; p; p = p->next) {
+      assertT(t, index < context->traceLogCount);
 
-          newTable->setBodyElement(t, ni + 1, type);
+      if (p->address) {
+        RUNTIME_ARRAY_BODY(elements)[index++] = p;
 
-          ++ni;
+        if (p->target) {
+          insertCallNode(
+              t, makeCallNode(t, p->address->value(), p->target, p->flags, 0));
         }
       }
     }
 
-    if (UNLIKELY(ni < length)) {
-      newIndex = truncateIntArray(t, newIndex, ni * 3);
-      newTable = truncateArray(t, newTable, ni + 1);
-    }
+    qsort(RUNTIME_ARRAY_BODY(elements),
+          index,
+          sizeof(TraceElement*),
+          compareTraceElementPointers);
 
-    newTable->setBodyElement(t, 0, newIndex);
+    GcIntArray* map = makeFrameMapTable(
+        t, context, start, RUNTIME_ARRAY_BODY(elements), index);
 
-    return newTable;
-  } else {
-    return 0;
+    context->method->code()->setStackMap(t, map);
   }
-}
-
-GcLineNumberTable* translateLineNumberTable(MyThread* t,
-                                            Context* context,
-                                            intptr_t start)
-{
-  GcLineNumberTable* oldTable = context->method->code()->lineNumberTable();
-  if (oldTable) {
-    PROTECT(t, oldTable);
-
-    unsigned length = oldTable->length();
-    GcLineNumberTable* newTable = makeLineNumberTable(t, length);
-    unsigned ni = 0;
-    for (unsigned oi = 0; oi < length; ++oi) {
-      uint64_t oldLine = oldTable->body()[oi];
 
-      int ip = resolveIpForwards(
-          context,
-          lineNumberIp(oldLine),
-          oi + 1 < length ? lineNumberIp(oldTable->body()[oi + 1]) - 1
-                          : lineNumberIp(oldLine) + 1);
-
-      if (LIKELY(ip >= 0)) {
-        newTable->body()[ni++]
-            = lineNumber(context->compiler->machineIp(ip)->value() - start,
-                         lineNumberLine(oldLine));
-      }
-    }
-
-    if (UNLIKELY(ni < length)) {
-      newTable = truncateLineNumberTable(t, newTable, ni);
-    }
+  logCompile(t, start, codeSize, context->method);
 
-    return newTable;
-  } else {
-    return 0;
+  // for debugging:
+  if (false
+      and ::strcmp(reinterpret_cast<const char*>(
+                       context->method->class_()->name()->body().begin()),
+                   "java/lang/System") == 0
+      and ::strcmp(reinterpret_cast<const char*>(
+                       context->method->name()->body().begin()),
+                   "<clinit>") == 0) {
+    trap();
   }
+  syncInstructionCache(start, codeSize);
 }
 
-void printSet(uintptr_t* m, unsigned limit)
+// Returns the number of ips other than the following one which the
+// instruction at ip may branch to, storing them in targets unless it
+// is null.
+unsigned branchTargets(MyThread* t, GcCode* code, unsigned ip, uint32_t* targets)
 {
-  if (limit) {
-    for (unsigned i = 0; i < 32; ++i) {
-      if ((*m >> i) & 1) {
-        fprintf(stderr, "1");
-      } else {
-        fprintf(stderr, "_");
-      }
+  unsigned base = ip;
+  switch (code->body()[ip++]) {
+  case goto_:
+  case if_acmpeq:
+  case if_acmpne:
+  case if_icmpeq:
+  case if_icmpne:
+  case if_icmplt:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case ifeq:
+  case ifne:
+  case iflt:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case ifnonnull:
+  case ifnull:
+  case jsr: {
+    int16_t offset = codeReadInt16(t, code, ip);
+    if (targets) {
+      targets[0] = base + offset;
     }
+    return 1;
   }
-}
-
-void calculateTryCatchRoots(Context* context,
-                            uintptr_t* roots,
-                            unsigned mapSize,
-                            unsigned start,
-                            unsigned end)
-{
-  memset(roots, 0xFF, mapSize * BytesPerWord);
 
-  if (DebugFrameMaps) {
-    fprintf(stderr, "calculate try/catch roots from %d to %d\n", start, end);
+  case goto_w:
+  case jsr_w: {
+    int32_t offset = codeReadInt32(t, code, ip);
+    if (targets) {
+      targets[0] = base + offset;
+    }
+    return 1;
   }
 
-  for (TraceElement* te = context->traceLog; te; te = te->next) {
-    if (te->ip >= start and te->ip < end) {
-      uintptr_t* traceRoots = 0;
-      traceRoots = te->map;
-      te->watch = true;
-
-      if (traceRoots) {
-        if (DebugFrameMaps) {
-          fprintf(stderr, "   use roots at ip %3d: ", te->ip);
-          printSet(traceRoots, mapSize);
-          fprintf(stderr, "\n");
-        }
-
-        for (unsigned wi = 0; wi < mapSize; ++wi) {
-          roots[wi] &= traceRoots[wi];
-        }
-      } else {
-        if (DebugFrameMaps) {
-          fprintf(stderr, "  skip roots at ip %3d\n", te->ip);
-        }
+  case tableswitch: {
+    ip = (ip + 3) & ~3;
+    uint32_t defaultIp = base + codeReadInt32(t, code, ip);
+    int32_t bottom = codeReadInt32(t, code, ip);
+    int32_t top = codeReadInt32(t, code, ip);
+    unsigned count = top - bottom + 1;
+    if (targets) {
+      targets[0] = defaultIp;
+      for (unsigned i = 0; i < count; ++i) {
+        targets[i + 1] = base + codeReadInt32(t, code, ip);
       }
     }
+    return count + 1;
   }
 
-  if (DebugFrameMaps) {
-    fprintf(stderr, "result roots          : ");
-    printSet(roots, mapSize);
-    fprintf(stderr, "\n");
+  case lookupswitch: {
+    ip = (ip + 3) & ~3;
+    uint32_t defaultIp = base + codeReadInt32(t, code, ip);
+    unsigned count = codeReadInt32(t, code, ip);
+    if (targets) {
+      targets[0] = defaultIp;
+      for (unsigned i = 0; i < count; ++i) {
+        ip += 4;
+        targets[i + 1] = base + codeReadInt32(t, code, ip);
+      }
+    }
+    return count + 1;
+  }
+
+  default:
+    return 0;
   }
 }
 
-unsigned calculateFrameMaps(MyThread* t,
-                            Context* context,
-                            uintptr_t* originalRoots,
-                            unsigned eventIndex,
-                            uintptr_t* resultRoots)
+// Returns true if the instruction at ip loads an int (or, if reference
+// is true, a reference) from a local variable, storing its index in
+// index.
+bool loadsLocal(GcCode* code, unsigned ip, bool reference, unsigned* index)
 {
-  // for each instruction with more than one predecessor, and for each
-  // stack position, determine if there exists a path to that
-  // instruction such that there is not an object pointer left at that
-  // stack position (i.e. it is uninitialized or contains primitive
-  // data).
-
-  unsigned mapSize = frameMapSizeInWords(t, context->method);
-
-  THREAD_RUNTIME_ARRAY(t, uintptr_t, roots, mapSize);
-  if (originalRoots) {
-    memcpy(RUNTIME_ARRAY_BODY(roots), originalRoots, mapSize * BytesPerWord);
+  unsigned instruction = code->body()[ip];
+  unsigned first = reference ? aload_0 : iload_0;
+  if (instruction == (reference ? aload : iload)) {
+    *index = code->body()[ip + 1];
+    return true;
+  } else if (instruction >= first and instruction <= first + 3) {
+    *index = instruction - first;
+    return true;
   } else {
-    memset(RUNTIME_ARRAY_BODY(roots), 0, mapSize * BytesPerWord);
+    return false;
   }
+}
 
-  int32_t ip = -1;
-
-  // invariant: for each stack position, roots contains a zero at that
-  // position if there exists some path to the current instruction
-  // such that there is definitely not an object pointer at that
-  // position.  Otherwise, roots contains a one at that position,
-  // meaning either all known paths result in an object pointer at
-  // that position, or the contents of that position are as yet
-  // unknown.
+// Returns true if the instruction at ip may write the local variable
+// at index.
+bool storesLocal(MyThread* t, GcCode* code, unsigned ip, unsigned index)
+{
+  unsigned instruction = code->body()[ip];
+  unsigned target;
+  unsigned size = 1;
 
-  unsigned length = context->eventLog.length();
-  while (eventIndex < length) {
-    Event e = static_cast<Event>(context->eventLog.get(eventIndex++));
-    switch (e) {
-    case PushContextEvent: {
-      eventIndex = calculateFrameMaps(t,
-                                      context,
-                                      RUNTIME_ARRAY_BODY(roots),
-                                      eventIndex, /*subroutinePath,*/
-                                      resultRoots);
-    } break;
+  if (instruction >= istore_0 and instruction <= astore_3) {
+    // the short forms come in groups of four: istore, lstore, fstore,
+    // dstore and astore
+    unsigned group = (instruction - istore_0) / 4;
+    target = (instruction - istore_0) % 4;
+    if (group == 1 or group == 3) {
+      size = 2;
+    }
+  } else {
+    switch (instruction) {
+    case lstore:
+    case dstore:
+      size = 2;
+      // fall through
+    case istore:
+    case fstore:
+    case astore:
+    case iinc:
+      target = code->body()[ip + 1];
+      break;
 
-    case PopContextEvent:
-      goto exit;
+    case wide: {
+      unsigned p = ip + 2;
+      target = static_cast<uint16_t>(codeReadInt16(t, code, p));
+      switch (code->body()[ip + 1]) {
+      case lstore:
+      case dstore:
+        size = 2;
+        break;
 
-    case IpEvent: {
-      ip = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+      case istore:
+      case fstore:
+      case astore:
+      case iinc:
+        break;
 
-      if (DebugFrameMaps) {
-        fprintf(stderr, "       roots at ip %3d: ", ip);
-        printSet(RUNTIME_ARRAY_BODY(roots), mapSize);
-        fprintf(stderr, "\n");
+      default:
+        return false;
       }
+    } break;
 
-      assertT(context->thread, ip * mapSize <= context->rootTable.count);
-      uintptr_t* tableRoots = context->rootTable.begin() + (ip * mapSize);
+    default:
+      return false;
+    }
+  }
 
-      if (context->visitTable[ip] > 1) {
-        for (unsigned wi = 0; wi < mapSize; ++wi) {
-          uintptr_t newRoots = tableRoots[wi] & RUNTIME_ARRAY_BODY(roots)[wi];
+  return index >= target and index < target + size;
+}
 
-          if ((eventIndex == length
-               or context->eventLog.get(eventIndex) == PopContextEvent)
-              and newRoots != tableRoots[wi]) {
-            if (DebugFrameMaps) {
-              fprintf(stderr, "dirty roots!\n");
-            }
+bool pushesNonNegativeConstant(GcCode* code, unsigned ip)
+{
+  switch (code->body()[ip]) {
+  case iconst_0:
+  case iconst_1:
+  case iconst_2:
+  case iconst_3:
+  case iconst_4:
+  case iconst_5:
+    return true;
 
-            context->dirtyRoots = true;
-          }
+  case bipush:
+    return static_cast<int8_t>(code->body()[ip + 1]) >= 0;
 
-          tableRoots[wi] = newRoots;
-          RUNTIME_ARRAY_BODY(roots)[wi] &= tableRoots[wi];
-        }
+  case sipush:
+    return (code->body()[ip + 1] & 0x80) == 0;
 
-        if (DebugFrameMaps) {
-          fprintf(stderr, " table roots at ip %3d: ", ip);
-          printSet(tableRoots, mapSize);
-          fprintf(stderr, "\n");
-        }
-      } else {
-        memcpy(tableRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
-      }
-    } break;
+  default:
+    return false;
+  }
+}
 
-    case MarkEvent: {
-      unsigned i = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+// Stores in pops and pushes the words the instruction at ip takes from
+// and leaves on the operand stack and returns true, provided it is one
+// of the straight-line, local-preserving instructions we're prepared to
+// look through when matching an array access to its operands.
+bool stackEffect(GcCode* code, unsigned ip, unsigned* pops, unsigned* pushes)
+{
+  unsigned instruction = code->body()[ip];
+  unsigned index;
+  if (loadsLocal(code, ip, false, &index) or loadsLocal(code, ip, true, &index)
+      or (instruction >= fload_0 and instruction <= fload_3)
+      or instruction == fload) {
+    *pops = 0;
+    *pushes = 1;
+    return true;
+  }
 
-      markBit(RUNTIME_ARRAY_BODY(roots), i);
-    } break;
+  if ((instruction >= lload_0 and instruction <= dload_3)
+      or instruction == lload or instruction == dload) {
+    *pops = 0;
+    *pushes = 2;
+    return true;
+  }
 
-    case ClearEvent: {
-      unsigned i = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+  switch (instruction) {
+  case aconst_null:
+  case bipush:
+  case fconst_0:
+  case fconst_1:
+  case fconst_2:
+  case iconst_m1:
+  case iconst_0:
+  case iconst_1:
+  case iconst_2:
+  case iconst_3:
+  case iconst_4:
+  case iconst_5:
+  case ldc:
+  case ldc_w:
+  case sipush:
+    *pops = 0;
+    *pushes = 1;
+    return true;
 
-      clearBit(RUNTIME_ARRAY_BODY(roots), i);
-    } break;
+  case dconst_0:
+  case dconst_1:
+  case lconst_0:
+  case lconst_1:
+  case ldc2_w:
+    *pops = 0;
+    *pushes = 2;
+    return true;
 
-    case PushExceptionHandlerEvent: {
-      unsigned start = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
-      unsigned end = context->eventLog.get2(eventIndex);
-      eventIndex += 2;
+  case nop:
+    *pops = 0;
+    *pushes = 0;
+    return true;
 
-      calculateTryCatchRoots(
-          context, RUNTIME_ARRAY_BODY(roots), mapSize, start, end);
+  case arraylength:
+  case f2i:
+  case fneg:
+  case i2b:
+  case i2c:
+  case i2f:
+  case i2s:
+  case ineg:
+    *pops = 1;
+    *pushes = 1;
+    return true;
 
-      eventIndex = calculateFrameMaps(
-          t, context, RUNTIME_ARRAY_BODY(roots), eventIndex, 0);
-    } break;
+  case dup:
+  case f2d:
+  case f2l:
+  case i2d:
+  case i2l:
+    *pops = 1;
+    *pushes = 2;
+    return true;
 
-    case TraceEvent: {
-      TraceElement* te;
-      context->eventLog.get(eventIndex, &te, BytesPerWord);
-      if (DebugFrameMaps) {
-        fprintf(stderr, " trace roots at ip %3d: ", ip);
-        printSet(RUNTIME_ARRAY_BODY(roots), mapSize);
-        fprintf(stderr, "\n");
-      }
+  case aaload:
+  case baload:
+  case caload:
+  case fadd:
+  case faload:
+  case fcmpg:
+  case fcmpl:
+  case fdiv:
+  case fmul:
+  case frem:
+  case fsub:
+  case iadd:
+  case iaload:
+  case iand:
+  case idiv:
+  case imul:
+  case ior:
+  case irem:
+  case ishl:
+  case ishr:
+  case isub:
+  case iushr:
+  case ixor:
+  case saload:
+  case d2f:
+  case d2i:
+  case l2f:
+  case l2i:
+    *pops = 2;
+    *pushes = 1;
+    return true;
 
-      uintptr_t* map;
-      bool watch;
-      map = te->map;
-      watch = te->watch;
+  case d2l:
+  case daload:
+  case dneg:
+  case l2d:
+  case laload:
+  case lneg:
+    *pops = 2;
+    *pushes = 2;
+    return true;
 
-      for (unsigned wi = 0; wi < mapSize; ++wi) {
-        uintptr_t v = RUNTIME_ARRAY_BODY(roots)[wi];
+  case lshl:
+  case lshr:
+  case lushr:
+    *pops = 3;
+    *pushes = 2;
+    return true;
 
-        if (watch and map[wi] != v) {
-          if (DebugFrameMaps) {
-            fprintf(stderr, "dirty roots due to trace watch!\n");
-          }
+  case dadd:
+  case ddiv:
+  case dmul:
+  case vm::drem:
+  case dsub:
+  case ladd:
+  case land:
+  case ldiv_:
+  case lmul:
+  case lor:
+  case lrem:
+  case lsub:
+  case lxor:
+    *pops = 4;
+    *pushes = 2;
+    return true;
 
-          context->dirtyRoots = true;
-        }
+  case dcmpg:
+  case dcmpl:
+  case lcmp:
+    *pops = 4;
+    *pushes = 1;
+    return true;
 
-        map[wi] = v;
-      }
+  default:
+    return false;
+  }
+}
 
-      eventIndex += BytesPerWord;
-    } break;
+// Returns the ip of the array access whose operands are pushed by the
+// "aload array, iload index" pair starting at ip, or -1 if there is
+// none before end or we can't be sure those are its operands.  Only
+// the instructions accepted by stackEffect may come between the pair
+// and a store, and none after the first may be a branch target.
+int matchArrayAccess(MyThread* t,
+                     GcCode* code,
+                     Slice<bool> branchTargetTable,
+                     unsigned ip,
+                     unsigned end,
+                     unsigned array,
+                     unsigned index)
+{
+  unsigned local;
+  if (not(loadsLocal(code, ip, true, &local) and local == array)) {
+    return -1;
+  }
 
-    default:
-      abort(t);
-    }
+  ip += instructionLength(t, code, ip);
+  if (ip >= end or branchTargetTable[ip]
+      or not(loadsLocal(code, ip, false, &local) and local == index)) {
+    return -1;
   }
 
-exit:
-  if (resultRoots and ip != -1) {
-    if (DebugFrameMaps) {
-      fprintf(stderr, "result roots at ip %3d: ", ip);
-      printSet(RUNTIME_ARRAY_BODY(roots), mapSize);
-      fprintf(stderr, "\n");
+  unsigned depth = 0;
+  for (ip += instructionLength(t, code, ip); ip < end;
+       ip += instructionLength(t, code, ip)) {
+    if (branchTargetTable[ip]) {
+      return -1;
     }
 
-    memcpy(resultRoots, RUNTIME_ARRAY_BODY(roots), mapSize * BytesPerWord);
-  }
+    switch (code->body()[ip]) {
+    case aaload:
+    case baload:
+    case caload:
+    case daload:
+    case faload:
+    case iaload:
+    case laload:
+    case saload:
+      if (depth == 0) {
+        return ip;
+      }
+      break;
 
-  return eventIndex;
-}
+    case aastore:
+    case bastore:
+    case castore:
+    case fastore:
+    case iastore:
+    case sastore:
+      return depth == 1 ? static_cast<int>(ip) : -1;
 
-int compareTraceElementPointers(const void* va, const void* vb)
-{
-  TraceElement* a = *static_cast<TraceElement* const*>(va);
-  TraceElement* b = *static_cast<TraceElement* const*>(vb);
-  if (a->address->value() > b->address->value()) {
-    return 1;
-  } else if (a->address->value() < b->address->value()) {
-    return -1;
-  } else {
-    return 0;
-  }
-}
+    case dastore:
+    case lastore:
+      return depth == 2 ? static_cast<int>(ip) : -1;
 
-uint8_t* finish(MyThread* t,
-                FixedAllocator* allocator,
-                avian::codegen::Assembler* a,
-                const char* name,
-                unsigned length)
-{
-  uint8_t* start
-      = static_cast<uint8_t*>(allocator->allocate(length, TargetBytesPerWord));
+    default:
+      break;
+    }
 
-  a->setDestination(start);
-  a->write();
+    // nothing may consume the array or index
+    unsigned pops;
+    unsigned pushes;
+    if (not stackEffect(code, ip, &pops, &pushes) or pops > depth) {
+      return -1;
+    }
 
-  logCompile(t, start, length, 0, name, 0);
+    depth += pushes - pops;
+  }
 
-  return start;
+  return -1;
 }
 
-void setBit(int32_t* dst, unsigned index)
+// Marks the ips in the current method which may be reached other than
+// by falling through from the instruction before them in
+// context->blockStartTable: branch and switch targets and exception
+// handlers.  Since the successors of subroutine returns aren't known
+// statically, every ip is marked in methods which use them.
+void findBlockStarts(MyThread* t, Context* context)
 {
-  dst[index / 32] |= static_cast<int32_t>(1) << (index % 32);
-}
+  GcCode* code = context->method->code();
+  unsigned length = code->length();
+
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    unsigned instruction = code->body()[ip];
+    if (instruction == jsr or instruction == jsr_w or instruction == ret
+        or (instruction == wide and code->body()[ip + 1] == ret)) {
+      for (unsigned i = 0; i < length; ++i) {
+        context->blockStartTable[i] = true;
+      }
+      return;
+    }
 
-void clearBit(int32_t* dst, unsigned index)
-{
-  dst[index / 32] &= ~(static_cast<int32_t>(1) << (index % 32));
+    unsigned count = branchTargets(t, code, ip, 0);
+    if (count) {
+      Slice<uint32_t> targets
+          = Slice<uint32_t>::alloc(&context->zone, count);
+      branchTargets(t, code, ip, targets.begin());
+      for (unsigned i = 0; i < count; ++i) {
+        context->blockStartTable[targets[i]] = true;
+      }
+    }
+  }
+
+  GcExceptionHandlerTable* eht
+      = cast<GcExceptionHandlerTable>(t, code->exceptionHandlerTable());
+  if (eht) {
+    for (unsigned i = 0; i < eht->length(); ++i) {
+      context->blockStartTable[exceptionHandlerIp(eht->body()[i])] = true;
+    }
+  }
 }
 
-void copyFrameMap(int32_t* dst,
-                  uintptr_t* src,
-                  unsigned mapSizeInBits,
-                  unsigned offset,
-                  TraceElement* p)
+// Finds the array accesses in the current method which are guarded by
+// the condition of a counted loop of the form
+//
+//   for (int i = c; i < a.length; ++i) { ... a[i] ... }
+//
+// where c is a non-negative constant and neither i nor a is written in
+// the loop except by the increment, marking them in
+// context->inBoundsTable so their bounds checks may be omitted.  Both
+// the top-tested layout javac emits and the bottom-tested one other
+// compilers use are recognized.  Since the condition holds on every
+// path into the body and i only changes just before it is retested,
+// any a[i] evaluated in the body is in bounds.
+void findInBoundsAccesses(MyThread* t, Context* context)
 {
-  if (DebugFrameMaps) {
-    fprintf(stderr, "  orig roots at ip %3d: ", p->ip);
-    printSet(src, ceilingDivide(mapSizeInBits, BitsPerWord));
-    fprintf(stderr, "\n");
+  GcCode* code = context->method->code();
+  unsigned length = code->length();
 
-    fprintf(stderr, " final roots at ip %3d: ", p->ip);
-  }
+  Slice<uint32_t> previous
+      = Slice<uint32_t>::allocAndSet(&context->zone, length, 0);
+  Slice<bool> branchTargetTable = context->blockStartTable;
 
-  for (unsigned j = 0; j < p->argumentIndex; ++j) {
-    if (getBit(src, j)) {
-      if (DebugFrameMaps) {
-        fprintf(stderr, "1");
-      }
-      setBit(dst, offset + j);
-    } else {
-      if (DebugFrameMaps) {
-        fprintf(stderr, "_");
+  unsigned edgeCount = 0;
+  for (unsigned ip = 0, last = 0; ip < length;
+       last = ip, ip += instructionLength(t, code, ip)) {
+    switch (code->body()[ip]) {
+    case jsr:
+    case jsr_w:
+    case ret:
+      // successors of subroutine returns aren't known statically
+      return;
+
+    case wide:
+      if (code->body()[ip + 1] == ret) {
+        return;
       }
-      clearBit(dst, offset + j);
+      break;
+
+    default:
+      break;
     }
-  }
 
-  if (DebugFrameMaps) {
-    fprintf(stderr, "\n");
+    previous[ip] = last;
+    edgeCount += branchTargets(t, code, ip, 0);
   }
-}
 
-class FrameMapTableHeader {
- public:
-  FrameMapTableHeader(unsigned indexCount) : indexCount(indexCount)
-  {
+  Slice<uint32_t> sources = Slice<uint32_t>::alloc(&context->zone, edgeCount);
+  Slice<uint32_t> targets = Slice<uint32_t>::alloc(&context->zone, edgeCount);
+  for (unsigned ip = 0, i = 0; ip < length;
+       ip += instructionLength(t, code, ip)) {
+    unsigned count = branchTargets(t, code, ip, targets.begin() + i);
+    for (unsigned j = 0; j < count; ++j) {
+      sources[i + j] = ip;
+    }
+    i += count;
   }
 
-  unsigned indexCount;
-};
+  GcExceptionHandlerTable* eht
+      = cast<GcExceptionHandlerTable>(t, code->exceptionHandlerTable());
 
-class FrameMapTableIndexElement {
- public:
-  FrameMapTableIndexElement(int offset, unsigned base, unsigned path)
-      : offset(offset), base(base), path(path)
-  {
-  }
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    // every loop we recognize is controlled by a test of the form
+    // "iload index, aload array, arraylength, if_icmpxx"
+    unsigned index;
+    unsigned array;
+    if (not loadsLocal(code, ip, false, &index)) {
+      continue;
+    }
+
+    unsigned test = ip + instructionLength(t, code, ip);
+    if (test >= length or not loadsLocal(code, test, true, &array)) {
+      continue;
+    }
+
+    test += instructionLength(t, code, test);
+    if (test >= length or code->body()[test] != arraylength) {
+      continue;
+    }
+
+    ++test;
+    if (test + 3 > length) {
+      continue;
+    }
+
+    unsigned condition = code->body()[test];
+    unsigned p = test + 1;
+    unsigned destination = test + codeReadInt16(t, code, p);
+    unsigned after = test + 3;
+    if (destination >= length) {
+      continue;
+    }
+
+    unsigned loopStart;
+    unsigned loopEnd;
+    unsigned bodyStart;
+    unsigned increment;
+    unsigned entry;
+    unsigned entrySource;
+    if (condition == if_icmpge and destination > after) {
+      // top-tested: the test is followed by the body, the increment,
+      // and a goto back to the test, after which the loop exits
+      unsigned back = previous[destination];
+      p = back + 1;
+      if (back < after or code->body()[back] != goto_
+          or back + codeReadInt16(t, code, p) != ip
+          or back + 3 != destination) {
+        continue;
+      }
 
-  int offset;
-  unsigned base;
-  unsigned path;
-};
+      loopStart = ip;
+      loopEnd = destination;
+      bodyStart = after;
+      increment = previous[back];
+      entry = previous[ip];
+      entrySource = length;
+    } else if (condition == if_icmplt and destination < ip) {
+      // bottom-tested: a goto jumps over the body and the increment
+      // to the test, whose condition branches back to the body
+      unsigned jump = previous[destination];
+      p = jump + 1;
+      if (jump + 3 != destination or code->body()[jump] != goto_
+          or jump + codeReadInt16(t, code, p) != ip
+          or branchTargetTable[jump]) {
+        continue;
+      }
 
-class FrameMapTablePath {
- public:
-  FrameMapTablePath(unsigned stackIndex, unsigned elementCount, unsigned next)
-      : stackIndex(stackIndex), elementCount(elementCount), next(next)
-  {
-  }
+      loopStart = destination;
+      loopEnd = after;
+      bodyStart = destination;
+      increment = previous[ip];
+      entry = previous[jump];
+      entrySource = jump;
+    } else {
+      continue;
+    }
 
-  unsigned stackIndex;
-  unsigned elementCount;
-  unsigned next;
-  int32_t elements[0];
-};
+    // the index must be initialized to a non-negative constant right
+    // before the loop is entered
+    unsigned store = code->body()[entry];
+    if (ip == 0 or entry == 0 or branchTargetTable[entry]
+        or not(store == istore or (store >= istore_0 and store <= istore_3))
+        or not storesLocal(t, code, entry, index)
+        or not pushesNonNegativeConstant(code, previous[entry])) {
+      continue;
+    }
 
-GcIntArray* makeSimpleFrameMapTable(MyThread* t,
-                                    Context* context,
-                                    uint8_t* start,
-                                    TraceElement** elements,
-                                    unsigned elementCount)
-{
-  unsigned mapSize = frameMapSizeInBits(t, context->method);
-  GcIntArray* table = makeIntArray(
-      t, elementCount + ceilingDivide(elementCount * mapSize, 32));
+    // the increment must immediately precede the retest
+    if (increment < bodyStart or code->body()[increment] != iinc
+        or code->body()[increment + 1] != index
+        or code->body()[increment + 2] != 1) {
+      continue;
+    }
 
-  assertT(t,
-          table->length()
-          == elementCount + simpleFrameMapTableSize(t, context->method, table));
+    bool valid = true;
+    for (unsigned q = loopStart; valid and q < loopEnd;
+         q += instructionLength(t, code, q)) {
+      if ((q != increment and storesLocal(t, code, q, index))
+          or storesLocal(t, code, q, array)) {
+        valid = false;
+      }
+    }
 
-  for (unsigned i = 0; i < elementCount; ++i) {
-    TraceElement* p = elements[i];
+    // the only way into the loop must be the one we checked above, and
+    // nothing may jump into the middle of the test
+    for (unsigned i = 0; valid and i < edgeCount; ++i) {
+      unsigned source = sources[i];
+      unsigned target = targets[i];
+      if (target >= loopStart and target < loopEnd) {
+        bool inside = source >= loopStart and source < loopEnd;
+        if ((not inside and source != entrySource)
+            or (target > ip and target <= test)) {
+          valid = false;
+        }
+      }
+    }
 
-    table->body()[i] = static_cast<intptr_t>(p->address->value())
-                       - reinterpret_cast<intptr_t>(start);
+    if (eht) {
+      for (unsigned i = 0; valid and i < eht->length(); ++i) {
+        unsigned handler = exceptionHandlerIp(eht->body()[i]);
+        if (handler >= loopStart and handler < loopEnd) {
+          valid = false;
+        }
+      }
+    }
 
-    assertT(
-        t,
-        elementCount + ceilingDivide((i + 1) * mapSize, 32) <= table->length());
+    if (not valid) {
+      continue;
+    }
 
-    if (mapSize) {
-      copyFrameMap(
-          &table->body()[elementCount], p->map, mapSize, i * mapSize, p);
+    for (unsigned q = bodyStart; q < increment;
+         q += instructionLength(t, code, q)) {
+      int access = matchArrayAccess(
+          t, code, branchTargetTable, q, increment, array, index);
+      if (access >= 0) {
+        context->inBoundsTable[access] = true;
+      }
     }
   }
+}
 
-  return table;
+// Returns true if the instruction at ip is an astore, storing the index
+// of the local it writes in index.
+bool storesReference(GcCode* code, unsigned ip, unsigned* index)
+{
+  unsigned instruction = code->body()[ip];
+  if (instruction == astore) {
+    *index = code->body()[ip + 1];
+    return true;
+  } else if (instruction >= astore_0 and instruction <= astore_3) {
+    *index = instruction - astore_0;
+    return true;
+  } else {
+    return false;
+  }
 }
 
-void insertCallNode(MyThread* t, GcCallNode* node);
+// Returns the ip of the instruction after the one at ip, or the length
+// of the code if there is none or it may also be reached some other
+// way.
+unsigned following(Context* context, Slice<uint32_t> next, unsigned ip)
+{
+  unsigned n = next[ip];
+  return (n < next.count and not context->blockStartTable[n]) ? n
+                                                               : next.count;
+}
 
-void finish(MyThread* t, FixedAllocator* allocator, Context* context)
+// Returns true if the specified method is a no-argument constructor
+// which does nothing with the object it is given beyond (perhaps)
+// passing it to another such constructor of its superclass.
+bool trivialConstructor(MyThread* t, GcMethod* method, unsigned depth)
 {
-  avian::codegen::Compiler* c = context->compiler;
+  if (depth > 8 or (method->vmFlags() & ConstructorFlag) == 0
+      or (method->flags() & ACC_NATIVE)
+      or vm::strcmp(reinterpret_cast<const int8_t*>("()V"),
+                    method->spec()->body().begin()) != 0) {
+    return false;
+  }
 
-  if (false) {
-    logCompile(
-        t,
-        0,
-        0,
-        reinterpret_cast<const char*>(
-            context->method->class_()->name()->body().begin()),
-        reinterpret_cast<const char*>(context->method->name()->body().begin()),
-        reinterpret_cast<const char*>(context->method->spec()->body().begin()));
+  if (emptyMethod(t, method)) {
+    return true;
   }
 
-  // for debugging:
-  if (false
-      and ::strcmp(reinterpret_cast<const char*>(
-                       context->method->class_()->name()->body().begin()),
-                   "java/lang/System") == 0
-      and ::strcmp(reinterpret_cast<const char*>(
-                       context->method->name()->body().begin()),
-                   "<clinit>") == 0) {
-    trap();
+  GcCode* code = method->code();
+  if (code->length() == 5 and code->body()[0] == aload_0
+      and code->body()[1] == invokespecial and code->body()[4] == return_) {
+    unsigned ip = 2;
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    PROTECT(t, method);
+
+    GcMethod* target = resolveMethod(t, method, index - 1, false);
+    return target and trivialConstructor(t, target, depth + 1);
   }
 
-  // todo: this is a CPU-intensive operation, so consider doing it
-  // earlier before we've acquired the global class lock to improve
-  // parallelism (the downside being that it may end up being a waste
-  // of cycles if another thread compiles the same method in parallel,
-  // which might be mitigated by fine-grained, per-method locking):
-  c->compile(context->leaf ? 0 : stackOverflowThunk(t),
-             TARGET_THREAD_STACKLIMIT);
+  return false;
+}
 
-  // we must acquire the class lock here at the latest
+// Returns true if the "new, dup, invokespecial" sequence starting at ip
+// creates an object which nothing has yet seen but the code which
+// follows it, i.e. one with a trivial constructor and no finalizer.
+bool createsUnseenObject(MyThread* t, Context* context, unsigned ip)
+{
+  GcCode* code = context->method->code();
+  PROTECT(t, code);
 
-  unsigned codeSize = c->resolve(allocator->memory.begin() + allocator->offset);
+  if (ip + 7 >= code->length() or code->body()[ip] != new_
+      or code->body()[ip + 3] != dup or code->body()[ip + 4] != invokespecial
+      or context->blockStartTable[ip + 3]
+      or context->blockStartTable[ip + 4]) {
+    return false;
+  }
 
-  unsigned total = pad(codeSize, TargetBytesPerWord)
-                   + pad(c->poolSize(), TargetBytesPerWord);
+  unsigned p = ip + 1;
+  uint16_t classIndex = codeReadInt16(t, code, p);
+  p = ip + 5;
+  uint16_t methodIndex = codeReadInt16(t, code, p);
 
-  target_uintptr_t* code = static_cast<target_uintptr_t*>(
-      allocator->allocate(total, TargetBytesPerWord));
-  uint8_t* start = reinterpret_cast<uint8_t*>(code);
+  GcClass* class_
+      = resolveClassInPool(t, context->method, classIndex - 1, false);
+  if (class_ == 0
+      or (class_->vmFlags() & (WeakReferenceFlag | HasFinalizerFlag))) {
+    return false;
+  }
 
-  context->executableAllocator = allocator;
-  context->executableStart = code;
-  context->executableSize = total;
+  PROTECT(t, class_);
 
-  if (context->objectPool) {
-    object pool = allocate3(
-        t,
-        allocator,
-        Machine::ImmortalAllocation,
-        GcArray::FixedSize + ((context->objectPoolCount + 1) * BytesPerWord),
-        true);
+  GcMethod* constructor
+      = resolveMethod(t, context->method, methodIndex - 1, false);
+  return constructor and constructor->class_() == class_
+         and trivialConstructor(t, constructor, 0);
+}
+
+// Finds the monitorenter and monitorexit instructions in the current
+// method whose object no other thread can see, marking them in
+// context->threadLocalMonitorTable so they may be omitted.  A local
+// variable holds only such objects if every value stored to it is
+// either
+//
+//   new C; dup; invokespecial C.<init>()V; [dup;] astore x
+//
+// where the constructor is trivial (and the copy, if any, goes
+// straight to monitorenter), or
+//
+//   aload y; dup; astore x; monitorenter
+//
+// where y holds only such objects (javac's idiom for a synchronized
+// block), and every load of it feeds either monitorenter, monitorexit
+// or the second pattern.  We start by assuming that of every local but
+// the parameters and rule them out one by one.
+void findThreadLocalMonitors(MyThread* t, Context* context)
+{
+  GcCode* code = context->method->code();
+  PROTECT(t, code);
 
-    context->executableSize = (allocator->memory.begin() + allocator->offset)
-                              - static_cast<uint8_t*>(context->executableStart);
+  unsigned length = code->length();
 
-    initArray(
-        t, reinterpret_cast<GcArray*>(pool), context->objectPoolCount + 1);
-    mark(t, pool, 0);
+  bool sawMonitor = false;
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    switch (code->body()[ip]) {
+    case jsr:
+    case jsr_w:
+    case ret:
+      // a subroutine could hand its return address to anything
+      return;
 
-    setField(t, pool, ArrayBody, compileRoots(t)->objectPools());
-    compileRoots(t)->setObjectPools(t, pool);
+    case wide:
+      switch (code->body()[ip + 1]) {
+      case aload:
+      case astore:
+      case ret:
+        return;
 
-    unsigned i = 1;
-    for (PoolElement* p = context->objectPool; p; p = p->next) {
-      unsigned offset = ArrayBody + ((i++) * BytesPerWord);
+      default:
+        break;
+      }
+      break;
 
-      p->address = reinterpret_cast<uintptr_t>(pool) + offset;
+    case monitorenter:
+      sawMonitor = true;
+      break;
 
-      setField(t, pool, offset, p->target);
+    default:
+      break;
     }
   }
 
-  c->write();
+  if (not sawMonitor) {
+    return;
+  }
 
-  BootContext* bc = context->bootContext;
-  if (bc) {
-    for (avian::codegen::DelayedPromise* p = bc->addresses;
-         p != bc->addressSentinal;
-         p = p->next) {
-      p->basis = new (bc->zone)
-          avian::codegen::ResolvedPromise(p->basis->value());
+  Slice<uint32_t> next
+      = Slice<uint32_t>::allocAndSet(&context->zone, length, length);
+  Slice<bool> fresh
+      = Slice<bool>::allocAndSet(&context->zone, length, false);
+  for (unsigned ip = 0; ip < length; ip += instructionLength(t, code, ip)) {
+    next[ip] = ip + instructionLength(t, code, ip);
+    if (createsUnseenObject(t, context, ip)) {
+      // the ip of the instruction after the invokespecial
+      fresh[ip + 7] = true;
     }
   }
 
-  {
-    GcArray* newExceptionHandlerTable = translateExceptionHandlerTable(
-        t,
-        context,
-        reinterpret_cast<intptr_t>(start),
-        reinterpret_cast<intptr_t>(start) + codeSize);
-
-    PROTECT(t, newExceptionHandlerTable);
-
-    GcLineNumberTable* newLineNumberTable = translateLineNumberTable(
-        t, context, reinterpret_cast<intptr_t>(start));
-
-    GcCode* code = context->method->code();
-
-    code = makeCode(t,
-                    0,
-                    0,
-                    newExceptionHandlerTable,
-                    newLineNumberTable,
-                    reinterpret_cast<uintptr_t>(start),
-                    codeSize,
-                    code->maxStack(),
-                    code->maxLocals(),
-                    0);
+  Slice<bool> blockStart = context->blockStartTable;
 
-    context->method->setCode(t, code);
+  unsigned localCount = code->maxLocals();
+  Slice<bool> local
+      = Slice<bool>::allocAndSet(&context->zone, localCount, true);
+  for (unsigned i = 0;
+       i < context->method->parameterFootprint() and i < localCount;
+       ++i) {
+    local[i] = false;
   }
 
-  if (context->traceLogCount) {
-    THREAD_RUNTIME_ARRAY(t, TraceElement*, elements, context->traceLogCount);
-    unsigned index = 0;
-    // unsigned pathFootprint = 0;
-    // unsigned mapCount = 0;
-    for (TraceElement* p = context->traceLog; p; p = p->next) {
-      assertT(t, index < context->traceLogCount);
+  bool changed = true;
+  while (changed) {
+    changed = false;
 
-      if (p->address) {
-        RUNTIME_ARRAY_BODY(elements)[index++] = p;
+    for (unsigned ip = 0; ip < length; ip = next[ip]) {
+      unsigned index;
+      if (loadsLocal(code, ip, true, &index)) {
+        if (not local[index]) {
+          continue;
+        }
+
+        unsigned n = following(context, next, ip);
+        bool valid = false;
+        if (n < length) {
+          switch (code->body()[n]) {
+          case monitorenter:
+          case monitorexit:
+            valid = true;
+            break;
+
+          case dup: {
+            unsigned store = following(context, next, n);
+            unsigned copy;
+            if (store < length and storesReference(code, store, &copy)
+                and local[copy]) {
+              unsigned enter = following(context, next, store);
+              valid = enter < length and code->body()[enter] == monitorenter;
+            }
+          } break;
 
-        if (p->target) {
-          insertCallNode(
-              t, makeCallNode(t, p->address->value(), p->target, p->flags, 0));
+          default:
+            break;
+          }
         }
-      }
-    }
 
-    qsort(RUNTIME_ARRAY_BODY(elements),
-          index,
-          sizeof(TraceElement*),
-          compareTraceElementPointers);
+        if (not valid) {
+          local[index] = false;
+          changed = true;
+        }
+      } else if (storesReference(code, ip, &index)) {
+        if (not local[index]) {
+          continue;
+        }
 
-    GcIntArray* map = makeSimpleFrameMapTable(
-        t, context, start, RUNTIME_ARRAY_BODY(elements), index);
+        unsigned enter = following(context, next, ip);
+        bool valid = false;
+        if (fresh[ip] and not blockStart[ip]) {
+          // new C; dup; invokespecial; astore x
+          valid = true;
+        } else if (ip > 0 and next[ip - 1] == ip and code->body()[ip - 1] == dup
+                   and not blockStart[ip] and enter < length
+                   and code->body()[enter] == monitorenter) {
+          unsigned source = ip - 1;
+          if (fresh[source] and not blockStart[source]) {
+            // new C; dup; invokespecial; dup; astore x; monitorenter
+            valid = true;
+          } else if (not blockStart[source]) {
+            // aload y; dup; astore x; monitorenter
+            unsigned y;
+            for (unsigned size = 1; size <= 2 and size <= source; ++size) {
+              if (next[source - size] == source
+                  and loadsLocal(code, source - size, true, &y)) {
+                valid = local[y];
+              }
+            }
+          }
+        }
 
-    context->method->code()->setStackMap(t, map);
+        if (not valid) {
+          local[index] = false;
+          changed = true;
+        }
+      }
+    }
   }
 
-  logCompile(
-      t,
-      start,
-      codeSize,
-      reinterpret_cast<const char*>(
-          context->method->class_()->name()->body().begin()),
-      reinterpret_cast<const char*>(context->method->name()->body().begin()),
-      reinterpret_cast<const char*>(context->method->spec()->body().begin()));
-
-  // for debugging:
-  if (false
-      and ::strcmp(reinterpret_cast<const char*>(
-                       context->method->class_()->name()->body().begin()),
-                   "java/lang/System") == 0
-      and ::strcmp(reinterpret_cast<const char*>(
-                       context->method->name()->body().begin()),
-                   "<clinit>") == 0) {
-    trap();
+  for (unsigned ip = 0; ip < length; ip = next[ip]) {
+    unsigned index;
+    if (loadsLocal(code, ip, true, &index) and local[index]) {
+      unsigned n = following(context, next, ip);
+      if (code->body()[n] == dup) {
+        n = following(context, next, following(context, next, n));
+      }
+      context->threadLocalMonitorTable[n] = true;
+    } else if (storesReference(code, ip, &index) and local[index] and ip > 0
+               and fresh[ip - 1]) {
+      context->threadLocalMonitorTable[following(context, next, ip)] = true;
+    }
   }
-  syncInstructionCache(start, codeSize);
 }
 
 void compile(MyThread* t, Context* context)
@@ -7319,6 +10051,14 @@ void compile(MyThread* t, Context* context)
             context->method->spec()->body().begin());
   }
 
+  findBlockStarts(t, context);
+
+  if (CheckArrayBounds) {
+    findInBoundsAccesses(t, context);
+  }
+
+  findThreadLocalMonitors(t, context);
+
   unsigned footprint = context->method->parameterFootprint();
   unsigned locals = localSize(t, context->method);
   c->init(context->method->code()->length(),
@@ -7459,6 +10199,8 @@ void updateCall(MyThread* t,
 
 void* compileMethod2(MyThread* t, void* ip);
 
+void updateDynamicCaller(MyThread* t, void* ip, GcMethod* target);
+
 uint64_t compileMethod(MyThread* t)
 {
   void* ip;
@@ -7558,6 +10300,8 @@ void* linkDynamicMethod2(MyThread* t, unsigned index)
 
   if (target->flags() & ACC_NATIVE) {
     t->trace->nativeMethod = target;
+  } else {
+    updateDynamicCaller(t, getIp(t), target);
   }
 
   return reinterpret_cast<void*>(methodAddress(t, target));
@@ -7581,7 +10325,10 @@ uint64_t invokeNativeFast(MyThread* t, GcMethod* method, void* function)
            + t->arch->frameReturnAddressSize());
 }
 
-uint64_t invokeNativeSlow(MyThread* t, GcMethod* method, void* function)
+uint64_t invokeNativeSlow(MyThread* t,
+                          GcMethod* method,
+                          void* function,
+                          unsigned shape)
 {
   PROTECT(t, method);
 
@@ -7614,39 +10361,53 @@ uint64_t invokeNativeSlow(MyThread* t, GcMethod* method, void* function)
   }
   RUNTIME_ARRAY_BODY(types)[typeOffset++] = POINTER_TYPE;
 
-  MethodSpecIterator it(
-      t, reinterpret_cast<const char*>(method->spec()->body().begin()));
-
-  while (it.hasNext()) {
-    unsigned type = RUNTIME_ARRAY_BODY(types)[typeOffset++]
-        = fieldType(t, fieldCode(t, *it.next()));
+  if (isDirectNative(shape)) {
+    for (unsigned i = 0; i < count - 2; ++i) {
+      if (directNativeReference(shape, i)) {
+        RUNTIME_ARRAY_BODY(args)[argOffset++]
+            = *sp ? reinterpret_cast<uintptr_t>(sp) : 0;
+        ++sp;
+      } else {
+        RUNTIME_ARRAY_BODY(args)[argOffset++] = *sp;
+        sp += directNativeWide(shape, i) ? 2 : 1;
+      }
+    }
+  } else {
+    MethodSpecIterator it(
+        t, reinterpret_cast<const char*>(method->spec()->body().begin()));
+
+    while (it.hasNext()) {
+      unsigned type = RUNTIME_ARRAY_BODY(types)[typeOffset++]
+          = fieldType(t, fieldCode(t, *it.next()));
+
+      switch (type) {
+      case INT8_TYPE:
+      case INT16_TYPE:
+      case INT32_TYPE:
+      case FLOAT_TYPE:
+        RUNTIME_ARRAY_BODY(args)[argOffset++] = *(sp++);
+        break;
 
-    switch (type) {
-    case INT8_TYPE:
-    case INT16_TYPE:
-    case INT32_TYPE:
-    case FLOAT_TYPE:
-      RUNTIME_ARRAY_BODY(args)[argOffset++] = *(sp++);
-      break;
+      case INT64_TYPE:
+      case DOUBLE_TYPE: {
+        memcpy(RUNTIME_ARRAY_BODY(args) + argOffset, sp, 8);
+        argOffset += (8 / BytesPerWord);
+        sp += 2;
+      } break;
 
-    case INT64_TYPE:
-    case DOUBLE_TYPE: {
-      memcpy(RUNTIME_ARRAY_BODY(args) + argOffset, sp, 8);
-      argOffset += (8 / BytesPerWord);
-      sp += 2;
-    } break;
+      case POINTER_TYPE: {
+        if (*sp) {
+          RUNTIME_ARRAY_BODY(args)[argOffset++]
+              = reinterpret_cast<uintptr_t>(sp);
+        } else {
+          RUNTIME_ARRAY_BODY(args)[argOffset++] = 0;
+        }
+        ++sp;
+      } break;
 
-    case POINTER_TYPE: {
-      if (*sp) {
-        RUNTIME_ARRAY_BODY(args)[argOffset++] = reinterpret_cast<uintptr_t>(sp);
-      } else {
-        RUNTIME_ARRAY_BODY(args)[argOffset++] = 0;
+      default:
+        abort(t);
       }
-      ++sp;
-    } break;
-
-    default:
-      abort(t);
     }
   }
 
@@ -7678,12 +10439,16 @@ uint64_t invokeNativeSlow(MyThread* t, GcMethod* method, void* function)
     t->checkpoint->noThrow = true;
     THREAD_RESOURCE(t, bool, noThrow, t->checkpoint->noThrow = noThrow);
 
-    result = vm::dynamicCall(function,
-                             RUNTIME_ARRAY_BODY(args),
-                             RUNTIME_ARRAY_BODY(types),
-                             count,
-                             footprint * BytesPerWord,
-                             returnType);
+    if (isDirectNative(shape)) {
+      result = directNativeCall(t, function, RUNTIME_ARRAY_BODY(args), count);
+    } else {
+      result = vm::dynamicCall(function,
+                               RUNTIME_ARRAY_BODY(args),
+                               RUNTIME_ARRAY_BODY(types),
+                               count,
+                               footprint * BytesPerWord,
+                               returnType);
+    }
   }
 
   if (method->flags() & ACC_SYNCHRONIZED) {
@@ -7745,19 +10510,77 @@ uint64_t invokeNativeSlow(MyThread* t, GcMethod* method, void* function)
   }
 
   while (t->reference != reference) {
-    dispose(t, t->reference);
+    recycle(t, t->reference);
   }
 
   return result;
 }
 
+uint64_t invokeNativeCritical(MyThread* t,
+                              GcMethod* method,
+                              void* function,
+                              unsigned shape)
+{
+  uintptr_t args[MaxDirectNativeArguments];
+  unsigned argOffset = 0;
+
+  uintptr_t* sp = static_cast<uintptr_t*>(t->stack) + t->arch->frameFooterSize()
+                  + t->arch->frameReturnAddressSize();
+
+  for (unsigned i = 0; i < method->parameterCount(); ++i) {
+    if (directNativeReference(shape, i)) {
+      argOffset += marshalCriticalArray(reinterpret_cast<object>(*(sp++)),
+                                        args + argOffset);
+    } else {
+      args[argOffset++] = *sp;
+      sp += directNativeWide(shape, i) ? 2 : 1;
+    }
+  }
+
+  if (DebugNatives) {
+    fprintf(stderr,
+            "invoke critical native method %s.%s\n",
+            method->class_()->name()->body().begin(),
+            method->name()->body().begin());
+  }
+
+  uint64_t result = directNativeCall(t, function, args, argOffset);
+
+  switch (method->returnCode()) {
+  case ByteField:
+  case BooleanField:
+    return static_cast<int8_t>(result);
+
+  case CharField:
+    return static_cast<uint16_t>(result);
+
+  case ShortField:
+    return static_cast<int16_t>(result);
+
+  case IntField:
+    return static_cast<int32_t>(result);
+
+  case LongField:
+    return result;
+
+  case VoidField:
+    return 0;
+
+  default:
+    abort(t);
+  }
+}
+
 uint64_t invokeNative2(MyThread* t, GcMethod* method)
 {
   GcNative* native = getMethodRuntimeData(t, method)->native();
   if (native->fast()) {
     return invokeNativeFast(t, method, native->function());
+  } else if (isCriticalNative(native->shape())) {
+    return invokeNativeCritical(
+        t, method, native->function(), native->shape());
   } else {
-    return invokeNativeSlow(t, method, native->function());
+    return invokeNativeSlow(t, method, native->function(), native->shape());
   }
 }
 
@@ -7811,53 +10634,96 @@ uint64_t invokeNative(MyThread* t)
   return result;
 }
 
-void findFrameMapInSimpleTable(MyThread* t,
-                               GcMethod* method,
-                               GcIntArray* table,
-                               int32_t offset,
-                               int32_t** map,
-                               unsigned* start)
+void findFrameMap(MyThread* t,
+                  void* stack UNUSED,
+                  GcMethod* method,
+                  int32_t offset,
+                  int32_t** map,
+                  unsigned* start)
 {
-  unsigned tableSize = simpleFrameMapTableSize(t, method, table);
-  unsigned indexSize = table->length() - tableSize;
-
-  *map = &table->body()[indexSize];
+  GcIntArray* table = method->code()->stackMap();
+  FrameMapTable layout(t, method, table);
+  uint32_t* body = reinterpret_cast<uint32_t*>(table->body().begin());
 
+  // find the last indexed site at or before the offset...
   unsigned bottom = 0;
-  unsigned top = indexSize;
+  unsigned top = layout.indexCount();
   for (unsigned span = top - bottom; span; span = top - bottom) {
     unsigned middle = bottom + (span / 2);
-    int32_t v = table->body()[middle];
-
-    if (offset == v) {
-      *start = frameMapSizeInBits(t, method) * middle;
-      return;
-    } else if (offset < v) {
+    if (offset < table->body()[layout.indexStart() + middle]) {
       top = middle;
     } else {
       bottom = middle + 1;
     }
   }
 
-  abort(t);
-}
+  expect(t, bottom);
 
-void findFrameMap(MyThread* t,
-                  void* stack UNUSED,
-                  GcMethod* method,
-                  int32_t offset,
-                  int32_t** map,
-                  unsigned* start)
-{
-  findFrameMapInSimpleTable(
-      t, method, method->code()->stackMap(), offset, map, start);
+  // ...and walk forward from there
+  unsigned site = (bottom - 1) * FrameMapIndexInterval;
+  int32_t v = table->body()[layout.indexStart() + bottom - 1];
+  unsigned limit = min(site + FrameMapIndexInterval, layout.siteCount);
+  while (v != offset) {
+    ++site;
+    expect(t, site < limit);
+
+    v += getBits(body + layout.deltaStart(),
+                 layout.deltaBits,
+                 site * layout.deltaBits);
+  }
+
+  *map = &table->body()[layout.mapStart()];
+  *start = layout.mapSize * getBits(body + layout.mapIndexStart(),
+                                    layout.indexBits,
+                                    site * layout.indexBits);
 }
 
+// Remembers the frame maps found during a walk of a thread's stack,
+// since a deep stack tends to return to the same few call sites over
+// and over.
+class FrameMapCache {
+ public:
+  static const unsigned Size = 32;
+
+  FrameMapCache()
+  {
+    memset(ips, 0, sizeof(ips));
+  }
+
+  void find(MyThread* t,
+            void* stack,
+            GcMethod* method,
+            void* ip,
+            int32_t** map,
+            unsigned* start)
+  {
+    unsigned i = (reinterpret_cast<uintptr_t>(ip) >> 2) % Size;
+    if (ips[i] != ip) {
+      findFrameMap(
+          t,
+          stack,
+          method,
+          difference(ip, reinterpret_cast<void*>(methodAddress(t, method))),
+          maps + i,
+          starts + i);
+      ips[i] = ip;
+    }
+
+    *map = maps[i];
+    *start = starts[i];
+  }
+
+  void* ips[Size];
+  int32_t* maps[Size];
+  unsigned starts[Size];
+};
+
 void visitStackAndLocals(MyThread* t,
                          Heap::Visitor* v,
                          void* frame,
                          GcMethod* method,
-                         void* ip)
+                         void* ip,
+                         FrameMapCache* cache)
 {
   unsigned count = frameMapSizeInBits(t, method);
 
@@ -7866,13 +10732,7 @@ void visitStackAndLocals(MyThread* t,
 
     int32_t* map;
     unsigned offset;
-    findFrameMap(
-        t,
-        stack,
-        method,
-        difference(ip, reinterpret_cast<void*>(methodAddress(t, method))),
-        &map,
-        &offset);
+    cache->find(t, stack, method, ip, &map, &offset);
 
     for (unsigned i = 0; i < count; ++i) {
       int j = offset + i;
@@ -7930,6 +10790,7 @@ void visitStack(MyThread* t, Heap::Visitor* v)
   GcMethod* targetMethod = (trace ? trace->targetMethod : 0);
   GcMethod* target = targetMethod;
   bool mostRecent = true;
+  FrameMapCache cache;
 
   while (stack) {
     if (targetMethod) {
@@ -7944,7 +10805,7 @@ void visitStack(MyThread* t, Heap::Visitor* v)
       void* nextIp = ip;
       nextFrame(t, &nextIp, &stack, method, target, mostRecent);
 
-      visitStackAndLocals(t, v, stack, method, ip);
+      visitStackAndLocals(t, v, stack, method, ip, &cache);
 
       ip = nextIp;
 
@@ -8683,12 +11544,72 @@ bool isVirtualThunk(MyThread* t, void* ip);
 
 bool isThunkUnsafeStack(MyThread* t, void* ip);
 
+// Fills in the context a stack walk of target should start from, given
+// the register values captured when target was interrupted by
+// System::visit.
+void initTraceContext(MyThread* t,
+                      MyThread* target,
+                      MyThread::TraceContext* c,
+                      void* ip,
+                      void* stack,
+                      void* link)
+{
+  if (methodForIp(t, ip)) {
+    // we caught the thread in Java code - use the register values
+    c->ip = ip;
+    c->stack = stack;
+    c->methodIsMostRecent = true;
+  } else if (target->transition) {
+    // we caught the thread in native code while in the middle
+    // of updating the context fields (MyThread::stack, etc.)
+    static_cast<MyThread::Context&>(*c) = *(target->transition);
+  } else if (isVmInvokeUnsafeStack(ip)) {
+    // we caught the thread in native code just after returning
+    // from java code, but before clearing MyThread::stack
+    // (which now contains a garbage value), and the most recent
+    // Java frame, if any, can be found in
+    // MyThread::continuation or MyThread::trace
+    c->ip = 0;
+    c->stack = 0;
+  } else if (target->stack and (not isThunkUnsafeStack(t, ip))
+             and (not isVirtualThunk(t, ip))) {
+    // we caught the thread in a thunk or native code, and the
+    // saved stack pointer indicates the most recent Java frame
+    // on the stack
+    c->ip = getIp(target);
+    c->stack = target->stack;
+  } else if (isThunk(t, ip) or isVirtualThunk(t, ip)) {
+    // we caught the thread in a thunk where the stack register
+    // indicates the most recent Java frame on the stack
+
+    // On e.g. x86, the return address will have already been
+    // pushed onto the stack, in which case we use getIp to
+    // retrieve it.  On e.g. ARM, it will be in the
+    // link register.  Note that we can't just check if the link
+    // argument is null here, since we use ecx/rcx as a
+    // pseudo-link register on x86 for the purpose of tail
+    // calls.
+    c->ip = t->arch->hasLinkRegister() ? link : getIp(t, link, stack);
+    c->stack = stack;
+  } else {
+    // we caught the thread in native code, and the most recent
+    // Java frame, if any, can be found in
+    // MyThread::continuation or MyThread::trace
+    c->ip = 0;
+    c->stack = 0;
+  }
+}
+
 void boot(MyThread* t, BootImage* image, uint8_t* code);
 
 class MyProcessor;
 
 MyProcessor* processor(MyThread* t);
 
+void updateDevirtualizedCalls(MyThread* t, GcMethod* target, void* address);
+
+void markOverridden(MyThread* t, GcMethod* method);
+
 #ifndef AVIAN_AOT_ONLY
 void compileThunks(MyThread* t, FixedAllocator* allocator);
 #endif
@@ -8731,6 +11652,92 @@ int checkConstant(MyThread* t, size_t expected, T C::*field, const char* name)
   return 0;
 }
 
+uint64_t runCompileThread(Thread* t, uintptr_t*);
+
+// A daemon thread which compiles methods queued by enqueueCallees so
+// that their callers find them ready rather than stalling in the
+// compiler on the first call.
+class CompileThread : public System::Runnable {
+ public:
+  CompileThread(Machine* m) : m(m), interrupted_(false)
+  {
+  }
+
+  virtual void attach(System::Thread*)
+  {
+  }
+
+  virtual void run()
+  {
+    Thread* t;
+    if (m->vtable->AttachCurrentThreadAsDaemon(m, &t, 0) == 0) {
+      vm::run(t, runCompileThread, 0);
+      m->vtable->DetachCurrentThread(m);
+    }
+  }
+
+  virtual bool interrupted()
+  {
+    return interrupted_;
+  }
+
+  virtual void setInterrupted(bool v)
+  {
+    interrupted_ = v;
+  }
+
+  Machine* m;
+  bool interrupted_;
+};
+
+// A FixedAllocator over a range of reserved address space to which
+// memory is committed a segment at a time as allocations reach it.
+// Allocations never move, so code may be resolved against the current
+// offset before the space for it is allocated.
+class CodeAllocator : public FixedAllocator {
+ public:
+  CodeAllocator(System* s)
+      : FixedAllocator(s, Slice<uint8_t>(0, 0)), committed(0)
+  {
+  }
+
+  using FixedAllocator::allocate;
+
+  virtual void* allocate(size_t size, unsigned padAlignment)
+  {
+    size_t end = offset + vm::pad(size, padAlignment);
+    if (end > committed) {
+      if (end > memory.count) {
+        fprintf(stderr,
+                "code cache of %u bytes exhausted; set the %s property "
+                "to a larger size in megabytes\n",
+                static_cast<unsigned>(memory.count),
+                JIT_CODE_CACHE_PROPERTY);
+        abort(a);
+      }
+
+      size_t target = vm::pad(end, Memory::PageSize);
+      if (target < committed + CodeSegmentSizeInBytes) {
+        target = committed + CodeSegmentSizeInBytes;
+      }
+      if (target > memory.count) {
+        target = memory.count;
+      }
+
+      expect(a,
+             Memory::commit(Slice<uint8_t>(memory.begin() + committed,
+                                           target - committed),
+                            Memory::ReadWriteExecute));
+
+      committed = target;
+    }
+
+    return FixedAllocator::allocate(size, padAlignment);
+  }
+
+  size_t committed;
+};
+
 class MyProcessor : public Processor {
  public:
   class Thunk {
@@ -8771,20 +11778,32 @@ class MyProcessor : public Processor {
         heapImage(0),
         codeImage(0),
         codeImageSize(0),
+        heapImageCopy(0),
+        heapImageCopySize(0),
         segFaultHandler(GcNullPointerException::Type,
                         &GcRoots::nullPointerException,
                         GcNullPointerException::FixedSize),
         divideByZeroHandler(GcArithmeticException::Type,
                             &GcRoots::arithmeticException,
                             GcArithmeticException::FixedSize),
-        codeAllocator(s, Slice<uint8_t>(0, 0)),
+        codeAllocator(s),
         callTableSize(0),
         dynamicIndex(0),
+        methodTreeVersion(0),
+        codeIndex(0),
         useNativeFeatures(useNativeFeatures),
         compilationHandlers(0),
         dynamicTable(0),
-        dynamicTableSize(0)
+        dynamicTableSize(0),
+        compileThreads(0),
+        compileThreadCount(0),
+        compileLog(0),
+        devirtualizedCalls(0)
   {
+    expect(s, s->success(s->make(&compileQueueLock)));
+
+    memset(&statistics, 0, sizeof(statistics));
+
     thunkTable[compileMethodIndex] = voidPointer(local::compileMethod);
     thunkTable[compileVirtualMethodIndex] = voidPointer(compileVirtualMethod);
     thunkTable[linkDynamicMethodIndex] = voidPointer(linkDynamicMethod);
@@ -8824,9 +11843,28 @@ class MyProcessor : public Processor {
 
     int mismatches
         = checkConstant(t,
-                        TARGET_THREAD_EXCEPTION,
-                        &Thread::exception,
-                        "TARGET_THREAD_EXCEPTION")
+                        TARGET_THREAD_JAVATHREAD,
+                        &Thread::javaThread,
+                        "TARGET_THREAD_JAVATHREAD")
+          + checkConstant(t, TARGET_THREAD_M, &Thread::m, "TARGET_THREAD_M")
+          + checkConstant(t,
+                          TARGET_THREAD_EXCEPTION,
+                          &Thread::exception,
+                          "TARGET_THREAD_EXCEPTION")
+          + checkConstant(t,
+                          TARGET_THREAD_HEAPINDEX,
+                          &Thread::heapIndex,
+                          "TARGET_THREAD_HEAPINDEX")
+          + checkConstant(t,
+                          TARGET_THREAD_HEAPSIZEINWORDS,
+                          &Thread::heapSizeInWords,
+                          "TARGET_THREAD_HEAPSIZEINWORDS")
+          + checkConstant(
+                t, TARGET_THREAD_HEAP, &Thread::heap, "TARGET_THREAD_HEAP")
+          + checkConstant(t,
+                          TARGET_THREAD_HEAPLIMIT,
+                          &Thread::heapLimit,
+                          "TARGET_THREAD_HEAPLIMIT")
           + checkConstant(t,
                           TARGET_THREAD_EXCEPTIONSTACKADJUSTMENT,
                           &MyThread::exceptionStackAdjustment,
@@ -8888,6 +11926,21 @@ class MyProcessor : public Processor {
     expect(t, TargetClassArrayElementSize == ClassArrayElementSize);
     expect(t, TargetClassFixedSize == ClassFixedSize);
     expect(t, TargetClassVtable == ClassVtable);
+    expect(t,
+           TargetAllocationSiteAllocations
+           == offsetof(AllocationSite, allocations));
+    expect(t,
+           TargetAllocationSitePretenure
+           == offsetof(AllocationSite, pretenure));
+    expect(t,
+           TargetAllocationSiteProfiled
+           == offsetof(AllocationSite, profiled));
+    expect(t, TargetAllocationSampleInterval == AllocationSampleInterval);
+    expect(t,
+           TargetMachineExclusive
+           == static_cast<unsigned>(
+                  reinterpret_cast<uint8_t*>(&(t->m->exclusive))
+                  - reinterpret_cast<uint8_t*>(t->m)));
 
 #endif
 
@@ -8969,6 +12022,11 @@ class MyProcessor : public Processor {
                          staticTable,
                          loader,
                          0,
+                         0,
+                         0,
+                         0,
+                         0,
+                         0,
                          vtableLength);
   }
 
@@ -8980,6 +12038,27 @@ class MyProcessor : public Processor {
           = reinterpret_cast<void*>(virtualThunk(static_cast<MyThread*>(t), i));
       c->vtable()[i] = thunk;
     }
+
+    // note which of the superclass's methods this class overrides,
+    // before any instance of it can exist.  That isn't so of the
+    // VM's own types, whose instances may predate their class files,
+    // but devirtualizable won't bind a call to a method of a class
+    // such a type inherits from until its class file is parsed, when
+    // we get here again with the parsed class.
+    GcClass* super = c->super();
+    if (super and (c->vmFlags() & BootstrapFlag) == 0 and c->virtualTable()
+        and super->virtualTable()
+        and c->virtualTable() != super->virtualTable()) {
+      unsigned length = cast<GcArray>(t, super->virtualTable())->length();
+      for (unsigned i = 0; i < length; ++i) {
+        GcMethod* method = cast<GcMethod>(
+            t, cast<GcArray>(t, c->super()->virtualTable())->body()[i]);
+        if (cast<GcArray>(t, c->virtualTable())->body()[i] != method
+            and (method->vmFlags() & OverriddenFlag) == 0) {
+          markOverridden(static_cast<MyThread*>(t), method);
+        }
+      }
+    }
   }
 
   virtual void visitObjects(Thread* vmt, Heap::Visitor* v)
@@ -8988,6 +12067,21 @@ class MyProcessor : public Processor {
 
     if (t == t->m->rootThread) {
       v->visit(&roots);
+
+      for (DevirtualizedCall* c = devirtualizedCalls; c; c = c->next) {
+        v->visit(&(c->target));
+      }
+
+      if (codeIndex) {
+        for (unsigned i = 0; i < codeIndex->count; ++i) {
+          v->visit(&(codeIndex->ranges()[i].method));
+        }
+
+        // no thread can be searching the code index while we're
+        // visiting roots, so it's safe to free the retired ones
+        disposeCodeIndexes(codeIndex->retired);
+        codeIndex->retired = 0;
+      }
     }
 
     for (MyThread::CallTrace* trace = t->trace; trace; trace = trace->next) {
@@ -8999,6 +12093,10 @@ class MyProcessor : public Processor {
 
     v->visit(&(t->continuation));
 
+    for (unsigned i = 0; i < IpCacheSize; ++i) {
+      v->visit(&(t->ipCache[i].method));
+    }
+
     for (Reference* r = t->reference; r; r = r->next) {
       v->visit(&(r->target));
     }
@@ -9024,16 +12122,19 @@ class MyProcessor : public Processor {
     if (o) {
       MyThread* t = static_cast<MyThread*>(vmt);
 
-      for (Reference* r = t->reference; r; r = r->next) {
+      unsigned count = 0;
+      for (Reference* r = t->reference;
+           r and count < LocalReferenceSearchLimit;
+           r = r->next) {
         if (r->target == o) {
           acquire(t, r);
 
           return &(r->target);
         }
+        ++count;
       }
 
-      Reference* r = new (t->m->heap->allocate(sizeof(Reference)))
-          Reference(o, &(t->reference), false);
+      Reference* r = makeReference(t, o);
 
       acquire(t, r);
 
@@ -9043,10 +12144,13 @@ class MyProcessor : public Processor {
     }
   }
 
-  virtual void disposeLocalReference(Thread* t, object* r)
+  virtual void disposeLocalReference(Thread* vmt, object* r)
   {
     if (r) {
-      release(t, reinterpret_cast<Reference*>(r));
+      Reference* reference = reinterpret_cast<Reference*>(r);
+      if ((--reference->count) == 0) {
+        recycle(static_cast<MyThread*>(vmt), reference);
+      }
     }
   }
 
@@ -9054,8 +12158,16 @@ class MyProcessor : public Processor {
   {
     MyThread* t = static_cast<MyThread*>(vmt);
 
-    t->referenceFrame = new (t->m->heap->allocate(sizeof(List<Reference*>)))
-        List<Reference*>(t->reference, t->referenceFrame);
+    List<Reference*>* f = t->spareReferenceFrames;
+    if (f) {
+      t->spareReferenceFrames = f->next;
+    } else {
+      f = static_cast<List<Reference*>*>(
+          t->m->heap->allocate(sizeof(List<Reference*>)));
+    }
+
+    t->referenceFrame
+        = new (f) List<Reference*>(t->reference, t->referenceFrame);
 
     return true;
   }
@@ -9067,10 +12179,11 @@ class MyProcessor : public Processor {
     List<Reference*>* f = t->referenceFrame;
     t->referenceFrame = f->next;
     while (t->reference != f->item) {
-      vm::dispose(t, t->reference);
+      recycle(t, t->reference);
     }
 
-    t->m->heap->free(f, sizeof(List<Reference*>));
+    f->next = t->spareReferenceFrames;
+    t->spareReferenceFrames = f;
   }
 
   virtual object invokeArray(Thread* t,
@@ -9234,9 +12347,7 @@ class MyProcessor : public Processor {
   {
     MyThread* t = static_cast<MyThread*>(vmt);
 
-    while (t->reference) {
-      vm::dispose(t, t->reference);
-    }
+    disposeReferences(t);
 
     t->arch->release();
 
@@ -9255,6 +12366,10 @@ class MyProcessor : public Processor {
       compilationHandlers->dispose(allocator);
     }
 
+    if (compileLog) {
+      fclose(compileLog);
+    }
+
     signals.unregisterHandler(SignalRegistrar::SegFault);
     signals.unregisterHandler(SignalRegistrar::DivideByZero);
     signals.setCrashDumpDirectory(0);
@@ -9263,11 +12378,39 @@ class MyProcessor : public Processor {
       allocator->free(dynamicTable, dynamicTableSize);
     }
 
+    disposeCodeIndexes(codeIndex);
+
+    for (DevirtualizedCall* c = devirtualizedCalls; c;) {
+      DevirtualizedCall* next = c->next;
+      allocator->free(c, sizeof(DevirtualizedCall));
+      c = next;
+    }
+
+    if (heapImageCopy) {
+      allocator->free(heapImageCopy, heapImageCopySize);
+    }
+
+    if (compileThreads) {
+      allocator->free(compileThreads,
+                      sizeof(CompileThread) * compileThreadCount);
+    }
+
+    compileQueueLock->dispose();
+
     this->~MyProcessor();
 
     allocator->free(this, sizeof(*this));
   }
 
+  void disposeCodeIndexes(CodeIndex* index)
+  {
+    while (index) {
+      CodeIndex* retired = index->retired;
+      allocator->free(index, CodeIndex::footprint(index->capacity));
+      index = retired;
+    }
+  }
+
   virtual object getStackTrace(Thread* vmt, Thread* vmTarget)
   {
     MyThread* t = static_cast<MyThread*>(vmt);
@@ -9284,51 +12427,7 @@ class MyProcessor : public Processor {
       virtual void visit(void* ip, void* stack, void* link)
       {
         MyThread::TraceContext c(target, link);
-
-        if (methodForIp(t, ip)) {
-          // we caught the thread in Java code - use the register values
-          c.ip = ip;
-          c.stack = stack;
-          c.methodIsMostRecent = true;
-        } else if (target->transition) {
-          // we caught the thread in native code while in the middle
-          // of updating the context fields (MyThread::stack, etc.)
-          static_cast<MyThread::Context&>(c) = *(target->transition);
-        } else if (isVmInvokeUnsafeStack(ip)) {
-          // we caught the thread in native code just after returning
-          // from java code, but before clearing MyThread::stack
-          // (which now contains a garbage value), and the most recent
-          // Java frame, if any, can be found in
-          // MyThread::continuation or MyThread::trace
-          c.ip = 0;
-          c.stack = 0;
-        } else if (target->stack and (not isThunkUnsafeStack(t, ip))
-                   and (not isVirtualThunk(t, ip))) {
-          // we caught the thread in a thunk or native code, and the
-          // saved stack pointer indicates the most recent Java frame
-          // on the stack
-          c.ip = getIp(target);
-          c.stack = target->stack;
-        } else if (isThunk(t, ip) or isVirtualThunk(t, ip)) {
-          // we caught the thread in a thunk where the stack register
-          // indicates the most recent Java frame on the stack
-
-          // On e.g. x86, the return address will have already been
-          // pushed onto the stack, in which case we use getIp to
-          // retrieve it.  On e.g. ARM, it will be in the
-          // link register.  Note that we can't just check if the link
-          // argument is null here, since we use ecx/rcx as a
-          // pseudo-link register on x86 for the purpose of tail
-          // calls.
-          c.ip = t->arch->hasLinkRegister() ? link : getIp(t, link, stack);
-          c.stack = stack;
-        } else {
-          // we caught the thread in native code, and the most recent
-          // Java frame, if any, can be found in
-          // MyThread::continuation or MyThread::trace
-          c.ip = 0;
-          c.stack = 0;
-        }
+        initTraceContext(t, target, &c, ip, stack, link);
 
         if (ensure(t, traceSize(target))) {
           t->setFlag(Thread::TracingFlag);
@@ -9351,13 +12450,50 @@ class MyProcessor : public Processor {
       collect(t, Heap::MinorCollection);
     }
 
-    return visitor.trace ? visitor.trace : makeObjectArray(t, 0);
+    return visitor.trace ? visitor.trace : makeEmptyTrace(t);
+  }
+
+  virtual void sampleStack(Thread* vmt, Thread* vmTarget, StackVisitor* v)
+  {
+    MyThread* t = static_cast<MyThread*>(vmt);
+    MyThread* target = static_cast<MyThread*>(vmTarget);
+
+    class Visitor : public System::ThreadVisitor {
+     public:
+      Visitor(MyThread* t, MyThread* target, StackVisitor* v)
+          : t(t), target(target), v(v)
+      {
+      }
+
+      virtual void visit(void* ip, void* stack, void* link)
+      {
+        MyThread::TraceContext c(target, link);
+        initTraceContext(t, target, &c, ip, stack, link);
+
+        MyStackWalker walker(target);
+        walker.walk(v);
+      }
+
+      MyThread* t;
+      MyThread* target;
+      StackVisitor* v;
+    } visitor(t, target, v);
+
+    t->m->system->visit(t->systemThread, target->systemThread, &visitor);
+  }
+
+  virtual const CompileStatistics& compileStatistics()
+  {
+    statistics.codeCacheUsed = codeAllocator.offset;
+    statistics.codeCacheCapacity = codeAllocator.memory.count;
+    return statistics;
   }
 
   virtual void initialize(BootImage* image, Slice<uint8_t> code)
   {
     bootImage = image;
     codeAllocator.memory = code;
+    codeAllocator.committed = code.count;
   }
 
   virtual void addCompilationHandler(CompilationHandler* handler)
@@ -9387,6 +12523,18 @@ class MyProcessor : public Processor {
     *addresses = bootContext.addresses;
   }
 
+  virtual void precompile(Thread* vmt UNUSED, GcMethod* method UNUSED)
+  {
+#ifndef AVIAN_AOT_ONLY
+    MyThread* t = static_cast<MyThread*>(vmt);
+
+    if ((method->flags() & (ACC_NATIVE | ACC_ABSTRACT)) == 0
+        and methodAddress(t, method) == defaultThunk(t)) {
+      compile(t, &codeAllocator, 0, method);
+    }
+#endif
+  }
+
   virtual void visitRoots(Thread* t, HeapWalker* w)
   {
     bootImage->methodTree = w->visitRoot(compileRoots(t)->methodTree());
@@ -9433,10 +12581,67 @@ class MyProcessor : public Processor {
 
   virtual void boot(Thread* t, BootImage* image, uint8_t* code)
   {
+    const char* compileThreads = findProperty(t, JIT_THREADS_PROPERTY);
+    if (compileThreads) {
+      compileThreadCount = atoi(compileThreads);
+    }
+
+    const char* perfMap = findProperty(t, JIT_PERF_MAP_PROPERTY);
+    if (perfMap and ::strcmp(perfMap, "true") == 0) {
+      CompilationHandler* h = makePerfMapHandler(s, allocator);
+      if (h) {
+        addCompilationHandler(h);
+      }
+    }
+
+    const char* jitDump = findProperty(t, JIT_DUMP_PROPERTY);
+    if (jitDump) {
+      CompilationHandler* h = makeJitDumpHandler(s, allocator, jitDump);
+      if (h) {
+        addCompilationHandler(h);
+      }
+    }
+
+    const char* statisticsPath = findProperty(t, JIT_STATISTICS_PROPERTY);
+    if (statisticsPath) {
+      compileLog = vm::fopen(statisticsPath, "wb");
+      if (compileLog) {
+        fprintf(compileLog,
+                "method,bytecode,events,nanoseconds,code,frameMap,"
+                "callSites\n");
+      } else {
+        fprintf(stderr, "unable to open %s\n", statisticsPath);
+      }
+    }
+
 #ifndef AVIAN_AOT_ONLY
     if (codeAllocator.memory.begin() == 0) {
-      codeAllocator.memory = Memory::allocate(ExecutableAreaSizeInBytes,
-                                              Memory::ReadWriteExecute);
+      const char* largePages = findProperty(t, LARGE_PAGES_PROPERTY);
+      bool useLargePages = largePages and ::strcmp(largePages, "true") == 0;
+      size_t alignment = useLargePages ? Memory::LargePageSize
+                                       : Memory::PageSize;
+
+      size_t size = DefaultCodeCacheSizeInBytes;
+      const char* codeCache = findProperty(t, JIT_CODE_CACHE_PROPERTY);
+      if (codeCache and atoi(codeCache) > 0) {
+        size = vm::pad(static_cast<unsigned>(atoi(codeCache)) * 1024 * 1024,
+                       alignment);
+      }
+
+      // every call from compiled code must be able to reach every
+      // other address in the cache with an immediate jump
+      uintptr_t reach = static_cast<MyThread*>(t)->arch->maximumImmediateJump();
+      if (size >= reach) {
+        size = (reach - 1) & ~(alignment - 1);
+      }
+
+      if (useLargePages) {
+        codeAllocator.memory = Memory::allocateLarge(
+            size, Memory::ReadWriteExecute);
+        codeAllocator.committed = codeAllocator.memory.count;
+      } else {
+        codeAllocator.memory = Memory::reserve(size, Memory::ReadWriteExecute);
+      }
 
       expect(t, codeAllocator.memory.begin());
     }
@@ -9445,7 +12650,7 @@ class MyProcessor : public Processor {
     if (image and code) {
       local::boot(static_cast<MyThread*>(t), image, code);
     } else {
-      roots = makeCompileRoots(t, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+      roots = makeCompileRoots(t, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
 
       {
         GcArray* ct = makeArray(t, 128);
@@ -9481,6 +12686,11 @@ class MyProcessor : public Processor {
                                    &divideByZeroHandler));
   }
 
+  virtual bool supportsContinuations()
+  {
+    return Continuations;
+  }
+
   virtual void callWithCurrentContinuation(Thread* t, object receiver)
   {
     if (Continuations) {
@@ -9542,20 +12752,118 @@ class MyProcessor : public Processor {
   uintptr_t* heapImage;
   uint8_t* codeImage;
   unsigned codeImageSize;
+  uintptr_t* heapImageCopy;
+  unsigned heapImageCopySize;
   SignalHandler segFaultHandler;
   SignalHandler divideByZeroHandler;
-  FixedAllocator codeAllocator;
+  CodeAllocator codeAllocator;
   ThunkCollection thunks;
   ThunkCollection bootThunks;
   unsigned callTableSize;
   unsigned dynamicIndex;
+  // incremented after each change to the method tree, invalidating
+  // any thread's cache of methodForIp results
+  unsigned methodTreeVersion;
+  CodeIndex* codeIndex;
   bool useNativeFeatures;
   void* thunkTable[dummyIndex + 1];
   CompilationHandlerList* compilationHandlers;
   void** dynamicTable;
   unsigned dynamicTableSize;
+  System::Monitor* compileQueueLock;
+  CompileThread* compileThreads;
+  unsigned compileThreadCount;
+  CompileStatistics statistics;
+  FILE* compileLog;
+  // guarded by the class lock
+  DevirtualizedCall* devirtualizedCalls;
 };
 
+unsigned methodTreeVersion(MyThread* t)
+{
+  return static_cast<MyProcessor*>(t->m->processor)->methodTreeVersion;
+}
+
+CodeIndex* codeIndex(MyThread* t)
+{
+  return static_cast<MyProcessor*>(t->m->processor)->codeIndex;
+}
+
+// Adds the range of the method's compiled code to the code index.  The
+// caller must hold the class lock.
+void codeIndexInsert(MyThread* t, GcMethod* method)
+{
+  MyProcessor* p = processor(t);
+  CodeIndex* index = p->codeIndex;
+
+  CodeRange range;
+  range.start = methodCompiled(t, method);
+  range.end = range.start + methodCompiledSize(t, method);
+  range.method = method;
+
+  if (index and index->count < index->capacity
+      and (index->count == 0
+           or index->ranges()[index->count - 1].start < range.start)) {
+    index->ranges()[index->count] = range;
+
+    storeStoreMemoryBarrier();
+
+    ++index->count;
+  } else {
+    unsigned count = index ? index->count : 0;
+    unsigned capacity = index ? index->capacity : InitialCodeIndexCapacity;
+    if (count == capacity) {
+      capacity *= 2;
+    }
+
+    CodeIndex* newIndex
+        = new (p->allocator->allocate(CodeIndex::footprint(capacity)))
+        CodeIndex(index, capacity);
+
+    unsigned i = 0;
+    for (; i < count and index->ranges()[i].start < range.start; ++i) {
+      newIndex->ranges()[i] = index->ranges()[i];
+    }
+    newIndex->ranges()[i] = range;
+    for (; i < count; ++i) {
+      newIndex->ranges()[i + 1] = index->ranges()[i];
+    }
+    newIndex->count = count + 1;
+
+    storeStoreMemoryBarrier();
+
+    p->codeIndex = newIndex;
+  }
+}
+
+// Replaces the method whose compiled code starts where the specified
+// one's does.  The caller must hold the class lock.
+void codeIndexUpdate(MyThread* t, GcMethod* method)
+{
+  CodeIndex* index = processor(t)->codeIndex;
+  uintptr_t start = methodCompiled(t, method);
+
+  unsigned bottom = 0;
+  unsigned top = index->count;
+  while (bottom < top) {
+    unsigned middle = bottom + ((top - bottom) / 2);
+    if (index->ranges()[middle].start < start) {
+      bottom = middle + 1;
+    } else {
+      top = middle;
+    }
+  }
+
+  assertT(t, bottom < index->count and index->ranges()[bottom].start == start);
+
+  index->ranges()[bottom].method = method;
+}
+
+void insertBootMethod(Thread* t, object method, void*)
+{
+  codeIndexInsert(static_cast<MyThread*>(t), cast<GcMethod>(t, method));
+}
+
 unsigned& dynamicIndex(MyThread* t)
 {
   return static_cast<MyProcessor*>(t->m->processor)->dynamicIndex;
@@ -9590,7 +12898,9 @@ void logCompile(MyThread* t,
                 unsigned size,
                 const char* class_,
                 const char* name,
-                const char* spec)
+                const char* spec,
+                const char* sourceFile,
+                Slice<const uint64_t> lineNumbers)
 {
   static bool open = false;
   if (not open) {
@@ -9626,7 +12936,12 @@ void logCompile(MyThread* t,
 
   MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
   for (CompilationHandlerList* h = p->compilationHandlers; h; h = h->next) {
-    h->handler->compiled(code, 0, 0, RUNTIME_ARRAY_BODY(completeName));
+    h->handler->compiled(code,
+                         size,
+                         0,
+                         RUNTIME_ARRAY_BODY(completeName),
+                         sourceFile,
+                         lineNumbers);
   }
 }
 
@@ -9681,6 +12996,44 @@ void* compileMethod2(MyThread* t, void* ip)
   return reinterpret_cast<void*>(address);
 }
 
+void updateInitCaller(MyThread* t, void* ip)
+{
+  uint8_t* updateIp = static_cast<uint8_t*>(ip);
+
+  MyProcessor* p = processor(t);
+
+  if (updateIp < p->codeImage
+      or updateIp >= p->codeImage + p->codeImageSize) {
+    updateCall(t,
+               avian::codegen::lir::AlignedCall,
+               updateIp,
+               reinterpret_cast<void*>(getThunk(t, skipInitClassThunk)));
+  }
+}
+
+// Called once an invokedynamic site is linked to a non-native target.
+// The caller reached the site's thunk via an aligned call, which we
+// can now point at the target itself, unless (as in compileMethod2)
+// the caller is in the boot image.
+void updateDynamicCaller(MyThread* t, void* ip, GcMethod* target)
+{
+  uint8_t* updateIp = static_cast<uint8_t*>(ip);
+
+  MyProcessor* p = processor(t);
+
+  if (updateIp < p->codeImage
+      or updateIp >= p->codeImage + p->codeImageSize) {
+    GcCallNode* node = findCallNode(t, ip);
+
+    updateCall(t,
+               (node->flags() & TraceElement::LongCall)
+                   ? avian::codegen::lir::AlignedLongCall
+                   : avian::codegen::lir::AlignedCall,
+               updateIp,
+               reinterpret_cast<void*>(methodAddress(t, target)));
+  }
+}
+
 bool isThunk(MyProcessor::ThunkCollection* thunks, void* ip)
 {
   uint8_t* thunkStart = thunks->default_.start;
@@ -9854,10 +13207,11 @@ GcHashMap* makeClassMap(Thread* t,
                         unsigned count,
                         uintptr_t* heap)
 {
-  GcArray* array = makeArray(t, nextPowerOfTwo(count));
-  GcHashMap* map = makeHashMap(t, 0, array);
+  GcHashMap* map = makeHashMap(t, 0, 0);
   PROTECT(t, map);
 
+  hashMapResize(t, map, byteArrayHash, count * 2);
+
   for (unsigned i = 0; i < count; ++i) {
     GcClass* c = cast<GcClass>(t, bootObject(heap, table[i]));
     hashMapInsert(t, map, c->name(), c, byteArrayHash);
@@ -9942,8 +13296,10 @@ void fixupHeap(MyThread* t UNUSED,
   for (unsigned word = 0; word < size; ++word) {
     uintptr_t w = map[word];
     if (w) {
-      for (unsigned bit = 0; bit < BitsPerWord; ++bit) {
-        if (w & (static_cast<uintptr_t>(1) << bit)) {
+      // stop as soon as no more bits are set, since most runs of
+      // references end well before the last bit of their word
+      for (unsigned bit = 0; w; ++bit, w >>= 1) {
+        if (w & 1) {
           unsigned index = indexOf(word, bit);
 
           uintptr_t* p = heap + index;
@@ -9970,57 +13326,6 @@ void fixupHeap(MyThread* t UNUSED,
   }
 }
 
-void resetClassRuntimeState(Thread* t,
-                            GcClass* c,
-                            uintptr_t* heap,
-                            unsigned heapSize)
-{
-  c->runtimeDataIndex() = 0;
-
-  if (c->arrayElementSize() == 0) {
-    GcSingleton* staticTable = c->staticTable()->as<GcSingleton>(t);
-    if (staticTable) {
-      for (unsigned i = 0; i < singletonCount(t, staticTable); ++i) {
-        if (singletonIsObject(t, staticTable, i)
-            and (reinterpret_cast<uintptr_t*>(
-                     singletonObject(t, staticTable, i)) < heap
-                 or reinterpret_cast<uintptr_t*>(singletonObject(
-                        t, staticTable, i)) > heap + heapSize)) {
-          singletonObject(t, staticTable, i) = 0;
-        }
-      }
-    }
-  }
-
-  if (GcArray* mtable = cast<GcArray>(t, c->methodTable())) {
-    PROTECT(t, mtable);
-    for (unsigned i = 0; i < mtable->length(); ++i) {
-      GcMethod* m = cast<GcMethod>(t, mtable->body()[i]);
-
-      m->nativeID() = 0;
-      m->runtimeDataIndex() = 0;
-
-      if (m->vmFlags() & ClassInitFlag) {
-        c->vmFlags() |= NeedInitFlag;
-        c->vmFlags() &= ~InitErrorFlag;
-      }
-    }
-  }
-
-  t->m->processor->initVtable(t, c);
-}
-
-void resetRuntimeState(Thread* t,
-                       GcHashMap* map,
-                       uintptr_t* heap,
-                       unsigned heapSize)
-{
-  for (HashMapIterator it(t, map); it.hasMore();) {
-    resetClassRuntimeState(
-        t, cast<GcClass>(t, it.next()->second()), heap, heapSize);
-  }
-}
-
 void fixupMethods(Thread* t,
                   GcHashMap* map,
                   BootImage* image UNUSED,
@@ -10041,14 +13346,12 @@ void fixupMethods(Thread* t,
           method->code()->compiled() = methodCompiled(t, method)
                                        + reinterpret_cast<uintptr_t>(code);
 
-          if (DebugCompile) {
+          if (DebugCompile
+              or processor(static_cast<MyThread*>(t))->compilationHandlers) {
             logCompile(static_cast<MyThread*>(t),
                        reinterpret_cast<uint8_t*>(methodCompiled(t, method)),
                        methodCompiledSize(t, method),
-                       reinterpret_cast<char*>(
-                           method->class_()->name()->body().begin()),
-                       reinterpret_cast<char*>(method->name()->body().begin()),
-                       reinterpret_cast<char*>(method->spec()->body().begin()));
+                       method);
           }
         }
       }
@@ -10101,10 +13404,44 @@ void boot(MyThread* t, BootImage* image, uint8_t* code)
 
   unsigned heapMapSizeInWords
       = ceilingDivide(heapMapSize(image->heapSize), BytesPerWord);
-  uintptr_t* heap = heapMap + heapMapSizeInWords;
+  uintptr_t* heap = reinterpret_cast<uintptr_t*>(
+      reinterpret_cast<uint8_t*>(image) + image->heapOffset);
 
   MyProcessor* p = static_cast<MyProcessor*>(t->m->processor);
 
+  // The VM writes to boot heap objects as it runs (static fields,
+  // class and method flags, compiled entry points), so unless the
+  // image belongs to this Machine alone (e.g. because it decoded the
+  // image itself), we fix up and run from a private copy of the heap.
+  // That leaves the image pristine for any other Machine in the
+  // process to boot from, concurrently or later.  The code image is
+  // never written after boot and is shared as-is.
+  //
+  // If the embedder promises that no other Machine will boot from the
+  // image, we use it in place instead, so startup only touches the
+  // pages holding references to fix up, plus whatever the VM goes on
+  // to use.  image->initialized marks an image claimed that way,
+  // which no other Machine may boot from.
+  if (image != t->m->bootimage) {
+    const char* inPlace = findProperty(t, BOOTIMAGE_IN_PLACE_PROPERTY);
+    if (inPlace and strcmp(inPlace, "true") == 0) {
+      // the image is word-aligned, so the field is aligned too, even
+      // though BootImage is packed
+      uint32_t* initialized = reinterpret_cast<uint32_t*>(
+          reinterpret_cast<uint8_t*>(image) + offsetof(BootImage, initialized));
+      expect(t, atomicCompareAndSwap32(initialized, 0, 1));
+    } else {
+      expect(t, image->initialized == 0);
+
+      uintptr_t* copy
+          = static_cast<uintptr_t*>(p->allocator->allocate(image->heapSize));
+      memcpy(copy, heap, image->heapSize);
+
+      heap = p->heapImageCopy = copy;
+      p->heapImageCopySize = image->heapSize;
+    }
+  }
+
   t->heapImage = p->heapImage = heap;
 
   if (false) {
@@ -10121,9 +13458,7 @@ void boot(MyThread* t, BootImage* image, uint8_t* code)
     fprintf(stderr, "code from %p to %p\n", code, code + image->codeSize);
   }
 
-  if (not image->initialized) {
-    fixupHeap(t, heapMap, heapMapSizeInWords, heap);
-  }
+  fixupHeap(t, heapMap, heapMapSizeInWords, heap);
 
   t->m->heap->setImmortalHeap(heap, image->heapSize / BytesPerWord);
 
@@ -10195,32 +13530,19 @@ void boot(MyThread* t, BootImage* image, uint8_t* code)
 
   findThunks(t, image, code);
 
-  if (image->initialized) {
-    resetRuntimeState(t,
-                      cast<GcHashMap>(t, roots(t)->bootLoader()->map()),
-                      heap,
-                      image->heapSize);
-
-    resetRuntimeState(t,
-                      cast<GcHashMap>(t, roots(t)->appLoader()->map()),
-                      heap,
-                      image->heapSize);
-
-    for (unsigned i = 0; i < t->m->types->length(); ++i) {
-      resetClassRuntimeState(
-          t, type(t, static_cast<Gc::Type>(i)), heap, image->heapSize);
-    }
-  } else {
-    fixupVirtualThunks(t, code);
+  fixupVirtualThunks(t, code);
 
-    fixupMethods(
-        t, cast<GcHashMap>(t, roots(t)->bootLoader()->map()), image, code);
+  fixupMethods(
+      t, cast<GcHashMap>(t, roots(t)->bootLoader()->map()), image, code);
 
-    fixupMethods(
-        t, cast<GcHashMap>(t, roots(t)->appLoader()->map()), image, code);
-  }
+  fixupMethods(
+      t, cast<GcHashMap>(t, roots(t)->appLoader()->map()), image, code);
 
-  image->initialized = true;
+  treeVisit(t,
+            compileRoots(t)->methodTree(),
+            compileRoots(t)->methodTreeSentinal(),
+            insertBootMethod,
+            0);
 
   GcHashMap* map = makeHashMap(t, 0, 0);
   // sequence point, for gc (don't recombine statements)
@@ -10622,6 +13944,231 @@ uintptr_t virtualThunk(MyThread* t, unsigned index)
   return oldArray->body()[index * 2];
 }
 
+// The caller holds the class lock.
+void bindDevirtualizedCall(MyThread* t, GcMethod* target, void** cell)
+{
+  PROTECT(t, target);
+
+  void* thunk = reinterpret_cast<void*>(virtualThunk(t, target->offset()));
+
+  if (target->vmFlags() & OverriddenFlag) {
+    // overridden since we compiled the call
+    *cell = thunk;
+  } else {
+    uintptr_t address = methodAddress(t, target);
+
+    // until the target is compiled, the thunk will compile it
+    *cell = address == defaultThunk(t) ? thunk
+                                       : reinterpret_cast<void*>(address);
+  }
+}
+
+// The caller holds the class lock and has committed the code
+// containing the cell, which must outlive the registration.
+void registerDevirtualizedCall(MyThread* t, GcMethod* target, void** cell)
+{
+  if ((target->vmFlags() & OverriddenFlag) == 0) {
+    MyProcessor* p = processor(t);
+    p->devirtualizedCalls
+        = new (p->allocator->allocate(sizeof(DevirtualizedCall)))
+            DevirtualizedCall(target, cell, p->devirtualizedCalls);
+
+    target->vmFlags() |= DevirtualizedFlag;
+  }
+}
+
+// The caller holds the class lock.
+void updateDevirtualizedCalls(MyThread* t, GcMethod* target, void* address)
+{
+  for (DevirtualizedCall* c = processor(t)->devirtualizedCalls; c;
+       c = c->next) {
+    if (c->target == target) {
+      *(c->cell) = address;
+    }
+  }
+}
+
+void markOverridden(MyThread* t, GcMethod* method)
+{
+  PROTECT(t, method);
+
+  ACQUIRE(t, t->m->classLock);
+
+  if (method->vmFlags() & DevirtualizedFlag) {
+    void* thunk = reinterpret_cast<void*>(virtualThunk(t, method->offset()));
+
+    MyProcessor* p = processor(t);
+    for (DevirtualizedCall** c = &(p->devirtualizedCalls); *c;) {
+      if ((*c)->target == method) {
+        DevirtualizedCall* dead = *c;
+        *(dead->cell) = thunk;
+        *c = dead->next;
+        p->allocator->free(dead, sizeof(DevirtualizedCall));
+      } else {
+        c = &((*c)->next);
+      }
+    }
+  }
+
+  method->vmFlags() = (method->vmFlags() & ~DevirtualizedFlag)
+                      | OverriddenFlag;
+}
+
+#ifndef AVIAN_AOT_ONLY
+uint64_t compileQueuedMethod(Thread* t, uintptr_t* arguments)
+{
+  GcMethod* method = cast<GcMethod>(t, reinterpret_cast<object>(arguments[0]));
+
+  compile(static_cast<MyThread*>(t),
+          codeAllocator(static_cast<MyThread*>(t)),
+          0,
+          method);
+
+  return 1;
+}
+
+uint64_t runCompileThread(Thread* vmt, uintptr_t*)
+{
+  MyThread* t = static_cast<MyThread*>(vmt);
+  MyProcessor* p = processor(t);
+
+  t->backgroundCompiler = true;
+
+  while (true) {
+    GcMethod* method;
+
+    {
+      ACQUIRE(t, p->compileQueueLock);
+
+      while (t->m->alive and (compileRoots(t)->compileQueue() == 0
+                              or compileRoots(t)->compileQueue()->front()
+                                 == 0)) {
+        ENTER(t, Thread::IdleState);
+        p->compileQueueLock->wait(t->systemThread, 0);
+      }
+
+      if (not t->m->alive) {
+        return 1;
+      }
+
+      GcList* queue = compileRoots(t)->compileQueue();
+      GcPair* front = cast<GcPair>(t, queue->front());
+      method = cast<GcMethod>(t, front->first());
+
+      queue->setFront(t, front->second());
+      if (queue->front() == 0) {
+        queue->setRear(t, 0);
+      }
+      --queue->size();
+    }
+
+    // a failure here will be reported to the caller when it compiles
+    // the method itself
+    uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(method)};
+    if (not run(t, compileQueuedMethod, arguments)) {
+      t->exception = 0;
+    }
+  }
+}
+
+void enqueueMethod(MyThread* t, GcMethod* method)
+{
+  MyProcessor* p = processor(t);
+
+  PROTECT(t, method);
+
+  ACQUIRE(t, p->compileQueueLock);
+
+  if (compileRoots(t)->compileQueue() == 0) {
+    GcList* queue = makeList(t, 0, 0, 0);
+    // sequence point, for gc (don't recombine statements)
+    compileRoots(t)->setCompileQueue(t, queue);
+
+    p->compileThreads = static_cast<CompileThread*>(
+        p->allocator->allocate(sizeof(CompileThread) * p->compileThreadCount));
+
+    for (unsigned i = 0; i < p->compileThreadCount; ++i) {
+      new (p->compileThreads + i) CompileThread(t->m);
+      t->m->system->start(p->compileThreads + i);
+    }
+  }
+
+  if (compileRoots(t)->compileQueue()->size() < MaxCompileQueueLength) {
+    listAppend(t, compileRoots(t)->compileQueue(), method);
+
+    p->compileQueueLock->notify(t->systemThread);
+  }
+}
+
+// Queues the methods which the specified, newly compiled method calls
+// directly but which have not yet been compiled themselves, so that a
+// background compiler thread may compile them before they are first
+// called.  Static methods are only queued once their class has been
+// initialized, since class initialization must happen on the thread
+// which first uses the class.  Only methods compiled on behalf of
+// mutator threads are considered, which keeps the compilers from
+// wandering arbitrarily far through the static call graph.
+void enqueueCallees(MyThread* t, Context* context)
+{
+  if (processor(t)->compileThreadCount == 0 or t->backgroundCompiler
+      or context->bootContext) {
+    return;
+  }
+
+  for (TraceElement* e = context->traceLog; e; e = e->next) {
+    GcMethod* target = e->target;
+    if (target and (target->flags() & ACC_NATIVE) == 0
+        and methodAddress(t, target) == defaultThunk(t)
+        and ((target->flags() & ACC_STATIC) == 0
+             or (target->class_()->vmFlags() & (NeedInitFlag | InitFlag))
+                == 0)) {
+      enqueueMethod(t, target);
+    }
+  }
+}
+
+// Adds a newly compiled method to the processor's totals and, if
+// avian.jit.statistics names a file, logs it there as a CSV row.  The
+// caller holds the class lock, which serializes both.
+void recordCompileStatistics(MyThread* t, Context* context, int64_t time)
+{
+  MyProcessor* p = processor(t);
+  GcMethod* method = context->method;
+  GcIntArray* map = cast<GcIntArray>(t, method->code()->stackMap());
+
+  unsigned bytecodeSize = method->code()->length();
+  unsigned eventCount = context->compiler->eventCount();
+  unsigned codeSize = methodCompiledSize(t, method);
+  unsigned frameMapSize = map ? map->length() * sizeof(int32_t) : 0;
+
+  Processor::CompileStatistics& s = p->statistics;
+  ++s.methods;
+  s.time += time;
+  if (time > s.maxTime) {
+    s.maxTime = time;
+  }
+  s.bytecodeSize += bytecodeSize;
+  s.eventCount += eventCount;
+  s.codeSize += codeSize;
+  s.frameMapSize += frameMapSize;
+  s.callSites += context->traceLogCount;
+
+  if (p->compileLog) {
+    fprintf(p->compileLog,
+            "%s.%s%s,%u,%u,%" LLD ",%u,%u,%u\n",
+            method->class_()->name()->body().begin(),
+            method->name()->body().begin(),
+            method->spec()->body().begin(),
+            bytecodeSize,
+            eventCount,
+            static_cast<int64_t>(time),
+            codeSize,
+            frameMapSize,
+            context->traceLogCount);
+  }
+}
+#endif // not AVIAN_AOT_ONLY
+
 void compile(MyThread* t,
              FixedAllocator* allocator UNUSED,
              BootContext* bootContext,
@@ -10660,6 +14207,8 @@ void compile(MyThread* t,
 
   PROTECT(t, clone);
 
+  int64_t start = t->m->system->nanoTime();
+
   Context context(t, bootContext, clone);
   compile(t, &context);
 
@@ -10681,60 +14230,101 @@ void compile(MyThread* t,
     }
   }
 
-  ACQUIRE(t, t->m->classLock);
+  {
+    ACQUIRE(t, t->m->classLock);
 
-  if (methodAddress(t, method) != defaultThunk(t)) {
-    return;
-  }
+    if (methodAddress(t, method) != defaultThunk(t)) {
+      return;
+    }
 
-  finish(t, allocator, &context);
+    finish(t, allocator, &context);
 
-  if (DebugMethodTree) {
-    fprintf(stderr,
-            "insert method at %p\n",
-            reinterpret_cast<void*>(methodCompiled(t, clone)));
-  }
-
-  // We can't update the MethodCode field on the original method
-  // before it is placed into the method tree, since another thread
-  // might call the method, from which stack unwinding would fail
-  // (since there is not yet an entry in the method tree).  However,
-  // we can't insert the original method into the tree before updating
-  // the MethodCode field on it since we rely on that field to
-  // determine its position in the tree.  Therefore, we insert the
-  // clone in its place.  Later, we'll replace the clone with the
-  // original to save memory.
-
-  GcTreeNode* newTree = treeInsert(t,
-                                   &(context.zone),
-                                   compileRoots(t)->methodTree(),
-                                   methodCompiled(t, clone),
-                                   clone,
-                                   compileRoots(t)->methodTreeSentinal(),
-                                   compareIpToMethodBounds);
-  // sequence point, for gc (don't recombine statements)
-  compileRoots(t)->setMethodTree(t, newTree);
+    recordCompileStatistics(t, &context, t->m->system->nanoTime() - start);
 
-  storeStoreMemoryBarrier();
+    if (t->m->preloadLog and not t->backgroundCompiler) {
+      recordPreloadMethod(t, method);
+    }
+
+    if (DebugMethodTree) {
+      fprintf(stderr,
+              "insert method at %p\n",
+              reinterpret_cast<void*>(methodCompiled(t, clone)));
+    }
+
+    // We can't update the MethodCode field on the original method
+    // before it is placed into the method tree, since another thread
+    // might call the method, from which stack unwinding would fail
+    // (since there is not yet an entry in the method tree).  However,
+    // we can't insert the original method into the tree before updating
+    // the MethodCode field on it since we rely on that field to
+    // determine its position in the tree.  Therefore, we insert the
+    // clone in its place.  Later, we'll replace the clone with the
+    // original to save memory.
+
+    GcTreeNode* newTree = treeInsert(t,
+                                     &(context.zone),
+                                     compileRoots(t)->methodTree(),
+                                     methodCompiled(t, clone),
+                                     clone,
+                                     compileRoots(t)->methodTreeSentinal(),
+                                     compareIpToMethodBounds);
+    // sequence point, for gc (don't recombine statements)
+    compileRoots(t)->setMethodTree(t, newTree);
 
-  method->setCode(t, clone->code());
+    codeIndexInsert(t, clone);
 
-  if (methodVirtual(t, method)) {
-    method->class_()->vtable()[method->offset()]
-        = reinterpret_cast<void*>(methodCompiled(t, clone));
-  }
+    // we hold the class lock, so there's no need to increment atomically
+    ++processor(t)->methodTreeVersion;
+
+    storeStoreMemoryBarrier();
+
+    method->setCode(t, clone->code());
+
+    if (methodVirtual(t, method)) {
+      method->class_()->vtable()[method->offset()]
+          = reinterpret_cast<void*>(methodCompiled(t, clone));
+    }
+
+    // we've compiled the method and inserted it into the tree without
+    // error, so we ensure that the executable area not be deallocated
+    // when we dispose of the context:
+    context.executableAllocator = 0;
+
+    // only now may the cells of any calls we devirtualized be
+    // redirected, since the code holding them is here to stay
+    for (DevirtualizedCallElement* p = context.devirtualizedCalls; p;
+         p = p->next) {
+      registerDevirtualizedCall(
+          t, p->target, reinterpret_cast<void**>(p->cell->value()));
+    }
 
-  // we've compiled the method and inserted it into the tree without
-  // error, so we ensure that the executable area not be deallocated
-  // when we dispose of the context:
-  context.executableAllocator = 0;
+    if (method->vmFlags() & DevirtualizedFlag) {
+      updateDevirtualizedCalls(
+          t, method, reinterpret_cast<void*>(methodCompiled(t, clone)));
+    }
+
+    treeUpdate(t,
+               compileRoots(t)->methodTree(),
+               methodCompiled(t, clone),
+               method,
+               compileRoots(t)->methodTreeSentinal(),
+               compareIpToMethodBounds);
+
+    codeIndexUpdate(t, method);
+
+    storeStoreMemoryBarrier();
+
+    ++processor(t)->methodTreeVersion;
+
+    recordEvent(t,
+                CompileEvent,
+                methodCompiledSize(t, method),
+                t->m->system->nanoTime() - start,
+                method->class_()->name(),
+                method->name());
+  }
 
-  treeUpdate(t,
-             compileRoots(t)->methodTree(),
-             methodCompiled(t, clone),
-             method,
-             compileRoots(t)->methodTreeSentinal(),
-             compareIpToMethodBounds);
+  enqueueCallees(t, &context);
 #endif // not AVIAN_AOT_ONLY
 }
 
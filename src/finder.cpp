@@ -28,6 +28,8 @@ namespace {
 const bool DebugFind = false;
 const bool DebugStat = false;
 
+class JarIndex;
+
 class Element {
  public:
   class Iterator {
@@ -36,7 +38,7 @@ class Element {
     virtual void dispose() = 0;
   };
 
-  Element() : next(0)
+  Element() : next(0), indexed(false)
   {
   }
 
@@ -49,7 +51,15 @@ class Element {
   virtual const char* sourceUrl() = 0;
   virtual void dispose() = 0;
 
+  // Returns the index of this element's entries if they can't change
+  // once opened, or null if the element must be asked directly.
+  virtual JarIndex* openIndex()
+  {
+    return 0;
+  }
+
   Element* next;
+  bool indexed;
 };
 
 class DirectoryElement : public Element {
@@ -263,6 +273,206 @@ class DataRegion : public System::Region {
   uint8_t data[0];
 };
 
+void inflateData(System* s,
+                 const uint8_t* in,
+                 size_t inLength,
+                 uint8_t* out,
+                 size_t outLength)
+{
+  z_stream zStream;
+  memset(&zStream, 0, sizeof(z_stream));
+
+  zStream.next_in = const_cast<uint8_t*>(in);
+  zStream.avail_in = inLength;
+  zStream.next_out = out;
+  zStream.avail_out = outLength;
+
+  // -15 means max window size and raw deflate (no zlib wrapper)
+  int r = inflateInit2(&zStream, -15);
+  expect(s, r == Z_OK);
+
+  r = inflate(&zStream, Z_FINISH);
+  expect(s, r == Z_STREAM_END);
+
+  inflateEnd(&zStream);
+}
+
+// Holds recently inflated jar entries, up to a total size, so that an
+// entry found repeatedly (e.g. a resource opened several times) isn't
+// decompressed again each time.  Regions handed out for an entry share
+// its data, and an entry evicted while such regions remain is freed
+// when the last of them is disposed.
+class InflateCache {
+ public:
+  class Entry {
+   public:
+    Entry(const uint8_t* header, size_t length)
+        : header(header),
+          next(0),
+          referenceCount(0),
+          cached(false),
+          length(length)
+    {
+    }
+
+    const uint8_t* header;
+    Entry* next;
+    unsigned referenceCount;
+    bool cached;
+    size_t length;
+    uint8_t data[0];
+  };
+
+  class EntryRegion : public System::Region {
+   public:
+    EntryRegion(InflateCache* cache, Entry* entry)
+        : cache(cache), entry(entry)
+    {
+    }
+
+    virtual const uint8_t* start()
+    {
+      return entry->data;
+    }
+
+    virtual size_t length()
+    {
+      return entry->length;
+    }
+
+    virtual void dispose()
+    {
+      InflateCache* cache = this->cache;
+      Entry* entry = this->entry;
+
+      cache->allocator->free(this, sizeof(*this));
+      cache->release(entry);
+    }
+
+    InflateCache* cache;
+    Entry* entry;
+  };
+
+  InflateCache(System* s, Alloc* allocator, size_t capacity)
+      : s(s), allocator(allocator), lock(0), capacity(capacity), entries(0)
+  {
+    expect(s, s->success(s->make(&lock)));
+  }
+
+  // Returns the contents of the deflated entry with the specified
+  // central directory header, whose data starts at compressed.
+  System::Region* find(const uint8_t* header, const uint8_t* compressed)
+  {
+    lock->acquire();
+    Entry* e = acquire(header);
+    lock->release();
+
+    if (e == 0) {
+      size_t length = uncompressedSize(header);
+      Entry* n = new (allocator->allocate(sizeof(Entry) + length))
+          Entry(header, length);
+
+      inflateData(s, compressed, compressedSize(header), n->data, length);
+
+      lock->acquire();
+      // another thread may have inflated the entry while we did
+      e = acquire(header);
+      if (e == 0) {
+        e = n;
+        n = 0;
+        insert(e);
+      }
+      lock->release();
+
+      if (n) {
+        free(n);
+      }
+    }
+
+    return new (allocator->allocate(sizeof(EntryRegion)))
+        EntryRegion(this, e);
+  }
+
+  void release(Entry* e)
+  {
+    lock->acquire();
+    bool dead = --e->referenceCount == 0 and not e->cached;
+    lock->release();
+
+    if (dead) {
+      free(e);
+    }
+  }
+
+  void dispose()
+  {
+    for (Entry* e = entries; e;) {
+      Entry* next = e->next;
+      e->cached = false;
+      if (e->referenceCount == 0) {
+        free(e);
+      }
+      e = next;
+    }
+    lock->dispose();
+    allocator->free(this, sizeof(*this));
+  }
+
+  // the caller must hold lock for acquire and insert
+  Entry* acquire(const uint8_t* header)
+  {
+    for (Entry** p = &entries; *p; p = &((*p)->next)) {
+      Entry* e = *p;
+      if (e->header == header) {
+        // move to the front, keeping the list in order of last use
+        *p = e->next;
+        e->next = entries;
+        entries = e;
+
+        ++e->referenceCount;
+        return e;
+      }
+    }
+    return 0;
+  }
+
+  void insert(Entry* e)
+  {
+    e->next = entries;
+    entries = e;
+    e->cached = true;
+    ++e->referenceCount;
+
+    // evict whatever no longer fits behind the more recently used
+    // entries
+    size_t total = 0;
+    for (Entry** p = &entries; *p;) {
+      Entry* old = *p;
+      if (total + old->length > capacity) {
+        *p = old->next;
+        old->cached = false;
+        if (old->referenceCount == 0) {
+          free(old);
+        }
+      } else {
+        total += old->length;
+        p = &(old->next);
+      }
+    }
+  }
+
+  void free(Entry* e)
+  {
+    allocator->free(e, sizeof(Entry) + e->length);
+  }
+
+  System* s;
+  Alloc* allocator;
+  System::Mutex* lock;
+  size_t capacity;
+  Entry* entries;
+};
+
 class JarIndex {
  public:
   enum CompressionMethod { Stored = 0, Deflated = 8 };
@@ -297,7 +507,7 @@ class JarIndex {
 
   static JarIndex* open(System* s, Alloc* allocator, System::Region* region)
   {
-    JarIndex* index = make(s, allocator, 32);
+    JarIndex* index = 0;
 
     const uint8_t* start = region->start();
     const uint8_t* end = start + region->length();
@@ -305,6 +515,13 @@ class JarIndex {
     // Find end of central directory record
     while (p > start) {
       if (signature(p) == CentralDirectorySignature) {
+        // Size the index for the number of entries the record claims, so
+        // we don't rehash repeatedly while walking a large directory.
+        // The count saturates for ZIP64 archives, in which case add
+        // grows the index as needed.
+        unsigned count = centralDirectoryEntryCount(p);
+        index = make(s, allocator, nextPowerOfTwo(count > 32 ? count : 32));
+
         p = region->start() + centralDirectoryOffset(p);
 
         while (p < end) {
@@ -322,7 +539,7 @@ class JarIndex {
       }
     }
 
-    return index;
+    return make(s, allocator, 32);
   }
 
   JarIndex* add(const Entry& entry)
@@ -355,7 +572,9 @@ class JarIndex {
     return 0;
   }
 
-  System::Region* find(const char* name, const uint8_t* start)
+  System::Region* find(const char* name,
+                       const uint8_t* start,
+                       InflateCache* cache)
   {
     List<Entry>* n = findNode(name);
     if (n) {
@@ -370,27 +589,18 @@ class JarIndex {
       } break;
 
       case Deflated: {
+        const uint8_t* data = fileData(start + localHeaderOffset(p));
+
+        if (cache and uncompressedSize(p) <= cache->capacity) {
+          return cache->find(p, data);
+        }
+
         DataRegion* region = new (
             allocator->allocate(sizeof(DataRegion) + uncompressedSize(p)))
             DataRegion(s, allocator, uncompressedSize(p));
 
-        z_stream zStream;
-        memset(&zStream, 0, sizeof(z_stream));
-
-        zStream.next_in
-            = const_cast<uint8_t*>(fileData(start + localHeaderOffset(p)));
-        zStream.avail_in = compressedSize(p);
-        zStream.next_out = region->data;
-        zStream.avail_out = region->length();
-
-        // -15 means max window size and raw deflate (no zlib wrapper)
-        int r = inflateInit2(&zStream, -15);
-        expect(s, r == Z_OK);
-
-        r = inflate(&zStream, Z_FINISH);
-        expect(s, r == Z_STREAM_END);
-
-        inflateEnd(&zStream);
+        inflateData(
+            s, data, compressedSize(p), region->data, region->length());
 
         return region;
       } break;
@@ -457,7 +667,7 @@ class JarElement : public Element {
 
     virtual const char* next(size_t* size)
     {
-      if (position < index->position) {
+      if (index and position < index->position) {
         List<JarIndex::Entry>* n = index->nodes + (position++);
         *size = fileNameLength(n->item.entry);
         return reinterpret_cast<const char*>(fileName(n->item.entry));
@@ -479,10 +689,13 @@ class JarElement : public Element {
 
   JarElement(System* s,
              Alloc* allocator,
+             InflateCache* cache,
              const char* name,
              bool canonicalizePath = true)
       : s(s),
         allocator(allocator),
+        cache(cache),
+        lock(0),
         originalName(name),
         name(name and canonicalizePath ? s->toAbsolutePath(allocator, name)
                                        : name),
@@ -492,6 +705,7 @@ class JarElement : public Element {
         region(0),
         index(0)
   {
+    expect(s, s->success(s->make(&lock)));
   }
 
   JarElement(System* s,
@@ -500,6 +714,8 @@ class JarElement : public Element {
              unsigned jarLength)
       : s(s),
         allocator(allocator),
+        cache(0),
+        lock(0),
         originalName(0),
         name(0),
         urlPrefix_(name ? append(allocator, "jar:file:", name, "!/") : 0),
@@ -508,16 +724,33 @@ class JarElement : public Element {
                PointerRegion(s, allocator, jarData, jarLength)),
         index(JarIndex::open(s, allocator, region))
   {
+    expect(s, s->success(s->make(&lock)));
   }
 
-  virtual Element::Iterator* iterator()
+  // Opens the index the first time it's needed.  Classes may be loaded
+  // by several threads at once, so this must not race.
+  void open()
   {
+    lock->acquire();
     init();
+    lock->release();
+  }
+
+  virtual Element::Iterator* iterator()
+  {
+    open();
 
     return new (allocator->allocate(sizeof(Iterator)))
         Iterator(s, allocator, index);
   }
 
+  virtual JarIndex* openIndex()
+  {
+    open();
+
+    return index;
+  }
+
   virtual void init()
   {
     if (index == 0) {
@@ -531,12 +764,13 @@ class JarElement : public Element {
 
   virtual System::Region* find(const char* name)
   {
-    init();
+    open();
 
     while (*name == '/')
       name++;
 
-    System::Region* r = (index ? index->find(name, region->start()) : 0);
+    System::Region* r
+        = (index ? index->find(name, region->start(), cache) : 0);
     if (DebugFind) {
       if (r) {
         fprintf(stderr, "found %s in %s\n", name, this->name);
@@ -551,7 +785,7 @@ class JarElement : public Element {
                                 size_t* length,
                                 bool tryDirectory)
   {
-    init();
+    open();
 
     while (*name == '/')
       name++;
@@ -595,11 +829,14 @@ class JarElement : public Element {
     if (region) {
       region->dispose();
     }
+    lock->dispose();
     allocator->free(this, size);
   }
 
   System* s;
   Alloc* allocator;
+  InflateCache* cache;
+  System::Mutex* lock;
   const char* originalName;
   const char* name;
   const char* urlPrefix_;
@@ -612,9 +849,10 @@ class BuiltinElement : public JarElement {
  public:
   BuiltinElement(System* s,
                  Alloc* allocator,
+                 InflateCache* cache,
                  const char* name,
                  const char* libraryName)
-      : JarElement(s, allocator, name, false),
+      : JarElement(s, allocator, cache, name, false),
         library(0),
         libraryName(libraryName ? copy(allocator, libraryName) : 0)
   {
@@ -689,6 +927,113 @@ class BuiltinElement : public JarElement {
   const char* libraryName;
 };
 
+// Maps each name found in the jars on a path to the first of those
+// jars which contains it.  The names point into the jars' own central
+// directories, which stay mapped for as long as the path does.
+class PathIndex {
+ public:
+  class Entry {
+   public:
+    Entry(uint32_t hash, const uint8_t* entry, Element* element)
+        : hash(hash), entry(entry), element(element)
+    {
+    }
+
+    uint32_t hash;
+    const uint8_t* entry;
+    Element* element;
+  };
+
+  PathIndex(System* s, Alloc* allocator, unsigned capacity)
+      : s(s),
+        allocator(allocator),
+        capacity(capacity),
+        position(0),
+        nodes(static_cast<List<Entry>*>(
+            allocator->allocate(sizeof(List<Entry>) * capacity)))
+  {
+    memset(table, 0, sizeof(List<Entry>*) * capacity);
+  }
+
+  static PathIndex* make(System* s, Alloc* allocator, unsigned capacity)
+  {
+    return new (allocator->allocate(sizeof(PathIndex)
+                                    + (sizeof(List<Entry>*) * capacity)))
+        PathIndex(s, allocator, capacity);
+  }
+
+  // Adds the entries of the specified element, which must come after
+  // every element already added, so that earlier elements win.
+  PathIndex* add(Element* e, JarIndex* jar)
+  {
+    PathIndex* index = this;
+    for (unsigned i = 0; i < jar->position; ++i) {
+      const JarIndex::Entry& entry = jar->nodes[i].item;
+      const uint8_t* p = entry.entry;
+      if (index->findNode(reinterpret_cast<const char*>(fileName(p)),
+                          fileNameLength(p),
+                          entry.hash) == 0) {
+        index = index->add(Entry(entry.hash, p, e));
+      }
+    }
+    e->indexed = true;
+    return index;
+  }
+
+  PathIndex* add(const Entry& entry)
+  {
+    if (position < capacity) {
+      unsigned i = entry.hash & (capacity - 1);
+      table[i] = new (nodes + (position++)) List<Entry>(entry, table[i]);
+      return this;
+    } else {
+      PathIndex* index = make(s, allocator, capacity * 2);
+      for (unsigned i = 0; i < capacity; ++i) {
+        index->add(nodes[i].item);
+      }
+      index->add(entry);
+      dispose();
+      return index;
+    }
+  }
+
+  List<Entry>* findNode(const char* name, size_t length, uint32_t hash)
+  {
+    for (List<Entry>* n = table[hash & (capacity - 1)]; n; n = n->next) {
+      const uint8_t* p = n->item.entry;
+      if (n->item.hash == hash
+          and equal(name, length, fileName(p), fileNameLength(p))) {
+        return n;
+      }
+    }
+    return 0;
+  }
+
+  Element* find(const char* name, size_t length)
+  {
+    List<Entry>* n = findNode(
+        name,
+        length,
+        hash(Slice<const uint8_t>(reinterpret_cast<const uint8_t*>(name),
+                                  length)));
+    return n ? n->item.element : 0;
+  }
+
+  void dispose()
+  {
+    allocator->free(nodes, sizeof(List<Entry>) * capacity);
+    allocator->free(this, sizeof(*this) + (sizeof(List<Entry>*) * capacity));
+  }
+
+  System* s;
+  Alloc* allocator;
+  unsigned capacity;
+  unsigned position;
+
+  List<Entry>* nodes;
+  List<Entry>* table[0];
+};
+
 void add(Element** first, Element** last, Element* e)
 {
   if (*last) {
@@ -717,6 +1062,7 @@ void add(System* s,
          Element** first,
          Element** last,
          Alloc* allocator,
+         InflateCache* cache,
          const char* name,
          unsigned nameLength,
          const char* bootLibrary);
@@ -725,6 +1071,7 @@ void addTokens(System* s,
                Element** first,
                Element** last,
                Alloc* allocator,
+               InflateCache* cache,
                const char* jarName,
                unsigned jarNameBase,
                const char* tokens,
@@ -743,6 +1090,7 @@ void addTokens(System* s,
         first,
         last,
         allocator,
+        cache,
         RUNTIME_ARRAY_BODY(n),
         jarNameBase + token.length,
         bootLibrary);
@@ -762,6 +1110,7 @@ void addJar(System* s,
             Element** first,
             Element** last,
             Alloc* allocator,
+            InflateCache* cache,
             const char* name,
             const char* bootLibrary)
 {
@@ -770,7 +1119,7 @@ void addJar(System* s,
   }
 
   JarElement* e = new (allocator->allocate(sizeof(JarElement)))
-      JarElement(s, allocator, name);
+      JarElement(s, allocator, cache, name);
 
   unsigned nameBase = baseName(name, s->fileSeparator());
 
@@ -829,6 +1178,7 @@ void addJar(System* s,
                     first,
                     last,
                     allocator,
+                    cache,
                     name,
                     nameBase,
                     RUNTIME_ARRAY_BODY(n),
@@ -839,6 +1189,7 @@ void addJar(System* s,
                     first,
                     last,
                     allocator,
+                    cache,
                     name,
                     nameBase,
                     line,
@@ -858,6 +1209,7 @@ void add(System* s,
          Element** first,
          Element** last,
          Alloc* allocator,
+         InflateCache* cache,
          const char* token,
          unsigned tokenLength,
          const char* bootLibrary)
@@ -874,7 +1226,7 @@ void add(System* s,
     add(first,
         last,
         new (allocator->allocate(sizeof(BuiltinElement)))
-        BuiltinElement(s, allocator, name, bootLibrary));
+        BuiltinElement(s, allocator, cache, name, bootLibrary));
   } else {
     char* name = static_cast<char*>(allocator->allocate(tokenLength + 1));
     memcpy(name, token, tokenLength);
@@ -883,7 +1235,7 @@ void add(System* s,
     size_t length;
     switch (s->stat(name, &length)) {
     case System::TypeFile: {
-      addJar(s, first, last, allocator, name, bootLibrary);
+      addJar(s, first, last, allocator, cache, name, bootLibrary);
     } break;
 
     case System::TypeDirectory: {
@@ -910,6 +1262,7 @@ void add(System* s,
 
 Element* parsePath(System* s,
                    Alloc* allocator,
+                   InflateCache* cache,
                    const char* path,
                    const char* bootLibrary)
 {
@@ -918,7 +1271,14 @@ Element* parsePath(System* s,
   for (Tokenizer t(path, s->pathSeparator()); t.hasMore();) {
     String token(t.next());
 
-    add(s, &first, &last, allocator, token.text, token.length, bootLibrary);
+    add(s,
+        &first,
+        &last,
+        allocator,
+        cache,
+        token.text,
+        token.length,
+        bootLibrary);
   }
 
   return first;
@@ -971,12 +1331,26 @@ class MyFinder : public Finder {
   MyFinder(System* system,
            Alloc* allocator,
            const char* path,
-           const char* bootLibrary)
+           const char* bootLibrary,
+           size_t inflateCacheSize)
       : system(system),
         allocator(allocator),
-        path_(parsePath(system, allocator, path, bootLibrary)),
-        pathString(copy(allocator, path))
+        cache(inflateCacheSize
+                  ? new (allocator->allocate(sizeof(InflateCache)))
+                    InflateCache(system, allocator, inflateCacheSize)
+                  : 0),
+        path_(parsePath(system, allocator, cache, path, bootLibrary)),
+        pathString(copy(allocator, path)),
+        lock(0),
+        index(0),
+        unindexed(0)
   {
+    // a lone element can answer for itself just as quickly
+    if (path_ and path_->next) {
+      expect(system, system->success(system->make(&lock)));
+      index = PathIndex::make(system, allocator, 256);
+      unindexed = path_;
+    }
   }
 
   MyFinder(System* system,
@@ -985,9 +1359,13 @@ class MyFinder : public Finder {
            unsigned jarLength)
       : system(system),
         allocator(allocator),
+        cache(0),
         path_(new (allocator->allocate(sizeof(JarElement)))
               JarElement(system, allocator, jarData, jarLength)),
-        pathString(0)
+        pathString(0),
+        lock(0),
+        index(0),
+        unindexed(0)
   {
   }
 
@@ -997,8 +1375,77 @@ class MyFinder : public Finder {
         MyIterator(system, allocator, path_);
   }
 
+  // Returns the first jar on the path containing the specified name,
+  // merging the entries of jars into the index only as far along the
+  // path as needed to answer.  Jars don't change once opened, but
+  // directories may, so those are never indexed.
+  Element* findIndexed(const char* name, size_t length)
+  {
+    while (*name == '/') {
+      ++name;
+      --length;
+    }
+
+    lock->acquire();
+
+    Element* e = index->find(name, length);
+    while (e == 0 and unindexed) {
+      Element* next = unindexed;
+      unindexed = next->next;
+
+      JarIndex* jar = next->openIndex();
+      if (jar) {
+        index = index->add(next, jar);
+        if (index->find(name, length)) {
+          e = next;
+        }
+      }
+    }
+
+    lock->release();
+
+    return e;
+  }
+
+  // Returns the first of the elements which could contain the
+  // specified name, starting after the specified element (or at the
+  // start of the path if it's null).  Those are elements which
+  // haven't been indexed, plus the ones the index found.
+  Element* nextCandidate(Element* e, Element* found, Element* foundDirectory)
+  {
+    for (e = e ? e->next : path_; e; e = e->next) {
+      if (not e->indexed or e == found or e == foundDirectory) {
+        return e;
+      }
+    }
+    return 0;
+  }
+
+  Element* findDirectory(const char* name)
+  {
+    size_t length = strlen(name);
+    RUNTIME_ARRAY(char, n, length + 1);
+    memcpy(RUNTIME_ARRAY_BODY(n), name, length);
+    RUNTIME_ARRAY_BODY(n)[length] = '/';
+
+    return findIndexed(RUNTIME_ARRAY_BODY(n), length + 1);
+  }
+
   virtual System::Region* find(const char* name)
   {
+    if (index) {
+      Element* found = findIndexed(name, strlen(name));
+      for (Element* e = nextCandidate(0, found, 0); e;
+           e = nextCandidate(e, found, 0)) {
+        System::Region* r = e->find(name);
+        if (r) {
+          return r;
+        }
+      }
+
+      return 0;
+    }
+
     for (Element* e = path_; e; e = e->next) {
       System::Region* r = e->find(name);
       if (r) {
@@ -1013,6 +1460,20 @@ class MyFinder : public Finder {
                                 size_t* length,
                                 bool tryDirectory)
   {
+    if (index) {
+      Element* found = findIndexed(name, strlen(name));
+      Element* foundDirectory = tryDirectory ? findDirectory(name) : 0;
+      for (Element* e = nextCandidate(0, found, foundDirectory); e;
+           e = nextCandidate(e, found, foundDirectory)) {
+        System::FileType type = e->stat(name, length, tryDirectory);
+        if (type != System::TypeDoesNotExist) {
+          return type;
+        }
+      }
+
+      return System::TypeDoesNotExist;
+    }
+
     for (Element* e = path_; e; e = e->next) {
       System::FileType type = e->stat(name, length, tryDirectory);
       if (type != System::TypeDoesNotExist) {
@@ -1046,6 +1507,21 @@ class MyFinder : public Finder {
 
   virtual const char* sourceUrl(const char* name)
   {
+    if (index) {
+      Element* found = findIndexed(name, strlen(name));
+      Element* foundDirectory = findDirectory(name);
+      for (Element* e = nextCandidate(0, found, foundDirectory); e;
+           e = nextCandidate(e, found, foundDirectory)) {
+        size_t length;
+        System::FileType type = e->stat(name, &length, true);
+        if (type != System::TypeDoesNotExist) {
+          return e->sourceUrl();
+        }
+      }
+
+      return 0;
+    }
+
     for (Element* e = path_; e; e = e->next) {
       size_t length;
       System::FileType type = e->stat(name, &length, true);
@@ -1072,13 +1548,24 @@ class MyFinder : public Finder {
     if (pathString) {
       allocator->free(pathString, strlen(pathString) + 1);
     }
+    if (cache) {
+      cache->dispose();
+    }
+    if (index) {
+      index->dispose();
+      lock->dispose();
+    }
     allocator->free(this, sizeof(*this));
   }
 
   System* system;
   Alloc* allocator;
+  InflateCache* cache;
   Element* path_;
   const char* pathString;
+  System::Mutex* lock;
+  PathIndex* index;
+  Element* unindexed;
 };
 
 }  // namespace
@@ -1088,9 +1575,11 @@ namespace vm {
 AVIAN_EXPORT Finder* makeFinder(System* s,
                                 Alloc* a,
                                 const char* path,
-                                const char* bootLibrary)
+                                const char* bootLibrary,
+                                size_t inflateCacheSize)
 {
-  return new (a->allocate(sizeof(MyFinder))) MyFinder(s, a, path, bootLibrary);
+  return new (a->allocate(sizeof(MyFinder)))
+      MyFinder(s, a, path, bootLibrary, inflateCacheSize);
 }
 
 Finder* makeFinder(System* s,
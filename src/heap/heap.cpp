@@ -10,6 +10,7 @@
 
 #include <avian/heap/heap.h>
 #include <avian/system/system.h>
+#include <avian/system/memory.h>
 #include "avian/common.h"
 #include "avian/arch.h"
 
@@ -17,6 +18,7 @@
 
 using namespace vm;
 using namespace avian::util;
+using avian::system::Memory;
 
 namespace {
 
@@ -27,6 +29,27 @@ const unsigned Top = ~static_cast<unsigned>(0);
 const unsigned InitialGen2CapacityInBytes = 4 * 1024 * 1024;
 const unsigned InitialTenuredFixieCeilingInBytes = 4 * 1024 * 1024;
 
+const unsigned MaxCollectorThreads = 64;
+const unsigned PlabSizeInWords = 4 * 1024;
+const unsigned WorkChunkCapacity = 254;
+const unsigned CopyLockCount = 256;
+const unsigned InitialGreyCapacity = 1024;
+const unsigned MarkSliceInWords = 64 * 1024;
+const unsigned MarkerIdleIntervalInMilliseconds = 10;
+const unsigned IncrementalSliceInWords = 4 * 1024;
+const unsigned LargeObjectThresholdInBytes = 64 * 1024;
+const unsigned InitialLargeObjectCapacity = BitsPerWord;
+const unsigned InitialSlotCapacity = 1024;
+const unsigned QuietCollectionsBeforeRelease = 8;
+const unsigned MinimumIncomingBudgetInWords = (512 * 1024) / BytesPerWord;
+const unsigned MaximumIncomingBudgetInWords = (16 * 1024 * 1024)
+                                              / BytesPerWord;
+
+// gen2 is divided into cards, each covered by a byte of the card table
+// and a word of the per-slot pointer map beneath it
+const unsigned BitsPerCard = 8;
+const unsigned CardSizeInWords = BitsPerWord;
+
 const bool Verbose = false;
 const bool Verbose2 = false;
 const bool Debug = false;
@@ -57,6 +80,10 @@ class MutexLock {
 };
 
 class Context;
+class Collector;
+class WorkChunk;
+class Marker;
+class LargeObject;
 
 Aborter* getAborter(Context* c);
 
@@ -64,13 +91,17 @@ void* tryAllocate(Context* c, size_t size);
 void* allocate(Context* c, size_t size);
 void* allocate(Context* c, size_t size, bool limit);
 void free(Context* c, const void* p, size_t size);
+bool largeSegment(Context* c, size_t size);
+void* allocateSegment(Context* c, size_t size);
+void freeSegment(Context* c, const void* p, size_t size);
 
 #ifdef USE_ATOMIC_OPERATIONS
 inline void markBitAtomic(uintptr_t* map, unsigned i)
 {
   uintptr_t* p = map + wordOf(i);
   uintptr_t v = static_cast<uintptr_t>(1) << bitOf(i);
-  for (uintptr_t old = *p; not atomicCompareAndSwap(p, old, old | v);
+  for (uintptr_t old = *p;
+       (old & v) == 0 and not atomicCompareAndSwap(p, old, old | v);
        old = *p) {
   }
 }
@@ -298,9 +329,23 @@ class Segment {
       vm::markBit(data, i);
     }
 
+    // a map with a byte per record (i.e. the card table) is read and
+    // written a byte at a time, so marking a card is a plain store
+    // which needs no atomic operation even when other threads are
+    // marking neighbouring cards
+    uint8_t* card(unsigned index)
+    {
+      assertT(segment->context, bitsPerRecord == BitsPerCard);
+      return reinterpret_cast<uint8_t*>(data) + (index / BitsPerCard);
+    }
+
     void clearOnlyIndex(unsigned index)
     {
-      clearBits(data, bitsPerRecord, index);
+      if (bitsPerRecord == BitsPerCard) {
+        *card(index) = 0;
+      } else {
+        clearBits(data, bitsPerRecord, index);
+      }
     }
 
     void clearOnly(unsigned segmentIndex)
@@ -322,7 +367,11 @@ class Segment {
 
     void setOnlyIndex(unsigned index, unsigned v = 1)
     {
-      setBits(data, bitsPerRecord, index, v);
+      if (bitsPerRecord == BitsPerCard) {
+        *card(index) = v;
+      } else {
+        setBits(data, bitsPerRecord, index, v);
+      }
     }
 
     void setOnly(unsigned segmentIndex, unsigned v = 1)
@@ -346,17 +395,41 @@ class Segment {
 #ifdef USE_ATOMIC_OPERATIONS
     void markAtomic(void* p)
     {
-      assertT(segment->context, bitsPerRecord == 1);
-      markBitAtomic(data, indexOf(p));
-      assertT(segment->context, getBit(data, indexOf(p)));
+      if (bitsPerRecord == BitsPerCard) {
+        *card(indexOf(p)) = 1;
+      } else {
+        assertT(segment->context, bitsPerRecord == 1);
+        markBitAtomic(data, indexOf(p));
+        assertT(segment->context, getBit(data, indexOf(p)));
+      }
       if (child)
         child->markAtomic(p);
     }
+
+    void setOnlyAtomic(void* p, unsigned v)
+    {
+      unsigned index = indexOf(p);
+      assertT(segment->context, bitOf(index) + bitsPerRecord <= BitsPerWord);
+
+      uintptr_t* word = data + wordOf(index);
+      for (uintptr_t old = *word;; old = *word) {
+        uintptr_t new_ = old;
+        setBits(&new_, bitsPerRecord, bitOf(index), v);
+        if (atomicCompareAndSwap(word, old, new_)) {
+          break;
+        }
+      }
+      assertT(segment->context, get(p) == v);
+    }
 #endif
 
     unsigned get(void* p)
     {
-      return getBits(data, bitsPerRecord, indexOf(p));
+      if (bitsPerRecord == BitsPerCard) {
+        return *card(indexOf(p));
+      } else {
+        return getBits(data, bitsPerRecord, indexOf(p));
+      }
     }
   };
 
@@ -411,8 +484,8 @@ class Segment {
       }
 
       while (data == 0) {
-        data = static_cast<uintptr_t*>(local::allocate(
-            context, (footprint(capacity_)) * BytesPerWord, false));
+        data = static_cast<uintptr_t*>(
+            allocateSegment(context, (footprint(capacity_)) * BytesPerWord));
 
         if (data == 0) {
           if (capacity_ > minimum) {
@@ -421,8 +494,9 @@ class Segment {
               break;
             }
           } else {
-            data = static_cast<uintptr_t*>(local::allocate(
+            data = static_cast<uintptr_t*>(allocateSegment(
                 context, (footprint(capacity_)) * BytesPerWord));
+            expect(context, data);
           }
         }
       }
@@ -473,7 +547,7 @@ class Segment {
   void replaceWith(Segment* s)
   {
     if (data) {
-      free(context, data, (footprint(capacity())) * BytesPerWord);
+      freeSegment(context, data, (footprint(capacity())) * BytesPerWord);
     }
     data = s->data;
     s->data = 0;
@@ -531,7 +605,7 @@ class Segment {
   void dispose()
   {
     if (data) {
-      free(context, data, (footprint(capacity())) * BytesPerWord);
+      freeSegment(context, data, (footprint(capacity())) * BytesPerWord);
     }
     data = 0;
     map = 0;
@@ -544,6 +618,7 @@ class Fixie {
   static const unsigned Marked = 1 << 1;
   static const unsigned Dirty = 1 << 2;
   static const unsigned Dead = 1 << 3;
+  static const unsigned Large = 1 << 4;
 
   Fixie(Context* c, unsigned size, bool hasMask, Fixie** handle, bool immortal)
       : age(immortal ? FixieTenureThreshold + 1 : 0),
@@ -666,6 +741,11 @@ class Fixie {
     return (flags & Dead) != 0;
   }
 
+  bool large()
+  {
+    return (flags & Large) != 0;
+  }
+
   void dead(bool v)
   {
     if (v) {
@@ -691,7 +771,41 @@ Fixie* fixie(void* body)
   return static_cast<Fixie*>(body) - 1;
 }
 
+// Fixies too big to be worth copying which contain no references other
+// than their class are allocated directly from the OS, page-aligned,
+// with this header in front.  Rather than moving among the fixie lists
+// as they age, they occupy a slot in Context::largeObjects, and the
+// bitmaps indexed by that slot (largeLive, largeTenured) let dead ones
+// be found without visiting the survivors.
+class LargeObject {
+ public:
+  LargeObject(unsigned index, unsigned footprint)
+      : index(index), footprint(footprint)
+  {
+  }
+
+  Fixie* fixie()
+  {
+    return reinterpret_cast<Fixie*>(this + 1);
+  }
+
+  static LargeObject* fromFixie(Fixie* f)
+  {
+    return reinterpret_cast<LargeObject*>(f) - 1;
+  }
+
+  static unsigned footprintFor(unsigned size)
+  {
+    return pad(sizeof(LargeObject) + Fixie::totalSize(size, false),
+               Memory::PageSize);
+  }
+
+  unsigned index;
+  unsigned footprint;
+};
+
 void free(Context* c, Fixie** fixies, bool resetImmortal = false);
+void disposeLargeObjects(Context* c);
 
 class Context {
  public:
@@ -708,20 +822,11 @@ class Context {
         nextAgeMap(&nextGen1, max(1, log(TenureThreshold)), 1, 0, false),
         nextGen1(this, &nextAgeMap, 0, 0),
         pointerMap(&gen2, 1, 1, 0, true),
-        pageMap(&gen2,
-                1,
-                LikelyPageSizeInBytes / BytesPerWord,
-                &pointerMap,
-                true),
-        heapMap(&gen2, 1, pageMap.scale * 1024, &pageMap, true),
+        heapMap(&gen2, BitsPerCard, CardSizeInWords, &pointerMap, true),
         gen2(this, &heapMap, 0, 0),
         nextPointerMap(&nextGen2, 1, 1, 0, true),
-        nextPageMap(&nextGen2,
-                    1,
-                    LikelyPageSizeInBytes / BytesPerWord,
-                    &nextPointerMap,
-                    true),
-        nextHeapMap(&nextGen2, 1, nextPageMap.scale * 1024, &nextPageMap, true),
+        nextHeapMap(
+            &nextGen2, BitsPerCard, CardSizeInWords, &nextPointerMap, true),
         nextGen2(this, &nextHeapMap, 0, 0),
         gen2Base(0),
         incomingFootprint(0),
@@ -740,11 +845,71 @@ class Context {
         dirtyTenuredFixies(0),
         markedFixies(0),
         visitedFixies(0),
-        lastCollectionTime(system->now()),
+        lastCollectionTime(system->nanoTime() / (1000 * 1000)),
         totalCollectionTime(0),
         totalTime(0),
-        limitWasExceeded(false)
+        limitWasExceeded(false),
+        largeObjects(0),
+        largeOccupied(0),
+        largeLive(0),
+        largeTenured(0),
+        largeObjectCapacity(0),
+        workLock(0),
+        collectorMonitor(0),
+        collectors(0),
+        collectorCount(1),
+        collectorEpoch(0),
+        participants(1),
+        idleCollectors(0),
+        finishedCollectors(0),
+        sharedWork(0),
+        freeWork(0),
+        parallel(false),
+        scanning(false),
+        shutdown(false),
+        markLock(0),
+        markMonitor(0),
+        marker(0),
+        markBits(0),
+        rescanBits(0),
+        markCapacity(0),
+        greyStack(0),
+        greyCount(0),
+        greyCapacity(0),
+        marking(false),
+        markShutdown(false),
+        incrementalPause(0),
+        incrementalCredit(0),
+        compaction(false),
+        largePages(false),
+        compacting(false),
+        growGen2(false),
+        liveBits(0),
+        gen2ReferenceBits(0),
+        gen1ReferenceBits(0),
+        liveRanks(0),
+        liveDestinations(0),
+        liveSizes(0),
+        liveCapacity(0),
+        slots(0),
+        slotCount(0),
+        slotCapacity(0),
+        gen2Released(0),
+        quietCollections(0),
+        copiedFootprint(0),
+        promotedFootprint(0),
+        freedFixies(0),
+        pauseTarget(0),
+        copyCost(0),
+        survival(0),
+        incomingBudget(0)
   {
+    memset(copyLocks, 0, sizeof(copyLocks));
+    memset(&statistics, 0, sizeof(statistics));
+    memset(directBlocks, 0, sizeof(directBlocks));
+    memset(directCounts, 0, sizeof(directCounts));
+    directSpans = 0;
+
     if (not system->success(system->make(&lock))) {
       system->abort();
     }
@@ -756,6 +921,11 @@ class Context {
     nextGen1.dispose();
     gen2.dispose();
     nextGen2.dispose();
+
+    if (greyStack) {
+      free(this, greyStack, greyCapacity * BytesPerWord);
+    }
+
     lock->dispose();
   }
 
@@ -764,6 +934,7 @@ class Context {
     free(this, &tenuredFixies, true);
     free(this, &dirtyTenuredFixies, true);
     free(this, &fixies, true);
+    disposeLargeObjects(this);
   }
 
   System* system;
@@ -784,12 +955,10 @@ class Context {
   Segment nextGen1;
 
   Segment::Map pointerMap;
-  Segment::Map pageMap;
   Segment::Map heapMap;
   Segment gen2;
 
   Segment::Map nextPointerMap;
-  Segment::Map nextPageMap;
   Segment::Map nextHeapMap;
   Segment nextGen2;
 
@@ -820,6 +989,85 @@ class Context {
   int64_t totalTime;
 
   bool limitWasExceeded;
+
+  // large object space (see LargeObject):
+  LargeObject** largeObjects;
+  uintptr_t* largeOccupied;
+  uintptr_t* largeLive;
+  uintptr_t* largeTenured;
+  unsigned largeObjectCapacity;
+
+  // parallel minor collection state (see Collector):
+  System::Mutex* workLock;
+  System::Monitor* collectorMonitor;
+  Collector* collectors;
+  unsigned collectorCount;
+  unsigned collectorEpoch;
+  unsigned participants;
+  unsigned idleCollectors;
+  unsigned finishedCollectors;
+  WorkChunk* sharedWork;
+  WorkChunk* freeWork;
+  uintptr_t copyLocks[CopyLockCount];
+  bool parallel;
+  bool scanning;
+  bool shutdown;
+
+  // concurrent marking state (see Marker):
+  System::Mutex* markLock;
+  System::Monitor* markMonitor;
+  Marker* marker;
+  uintptr_t* markBits;
+  uintptr_t* rescanBits;
+  unsigned markCapacity;
+  void** greyStack;
+  unsigned greyCount;
+  unsigned greyCapacity;
+  bool marking;
+  bool markShutdown;
+
+  // incremental marking state (see markIncrementally):
+  unsigned incrementalPause;
+  unsigned incrementalCredit;
+
+  // gen2 compaction state (see compactGen2):
+  bool compaction;
+  bool largePages;
+  bool compacting;
+  bool growGen2;
+  uintptr_t* liveBits;
+  uintptr_t* gen2ReferenceBits;
+  uintptr_t* gen1ReferenceBits;
+  unsigned* liveRanks;
+  unsigned* liveDestinations;
+  unsigned* liveSizes;
+  unsigned liveCapacity;
+  void*** slots;
+  unsigned slotCount;
+  unsigned slotCapacity;
+
+  // gen2 memory returned to the system (see releaseUnused):
+  unsigned gen2Released;
+  unsigned quietCollections;
+
+  // what the current collection has done, for statistics:
+  unsigned copiedFootprint;
+  unsigned promotedFootprint;
+  unsigned freedFixies;
+  Heap::Statistics statistics;
+
+  // pause-target sizing of the allocation budget between minor
+  // collections (see updateIncomingBudget):
+  int64_t pauseTarget;  // nanoseconds, or zero if disabled
+  int64_t copyCost;  // nanoseconds per 1024 words copied
+  unsigned survival;  // survivors per 1024 words collected
+  unsigned incomingBudget;  // words
+
+  // the depot of free direct memory blocks, by size class, and the
+  // spans they were carved from (see tryAllocateDirect):
+  void* directBlocks[Heap::DirectClassCount];
+  unsigned directCounts[Heap::DirectClassCount];
+  void* directSpans;
 };
 
 const char* segment(Context* c, void* p)
@@ -842,6 +1090,13 @@ inline Aborter* getAborter(Context* c)
   return c->system;
 }
 
+// the time on the system's monotonic clock, in milliseconds, for
+// timing collections
+inline int64_t milliseconds(Context* c)
+{
+  return c->system->nanoTime() / (1000 * 1000);
+}
+
 inline unsigned minimumNextGen1Capacity(Context* c)
 {
   return c->gen1.position() - c->tenureFootprint + c->incomingFootprint
@@ -854,6 +1109,13 @@ inline unsigned minimumNextGen2Capacity(Context* c)
          + c->gen2Padding;
 }
 
+// space which may be lost to partially filled per-thread copy buffers
+// when a collection runs in parallel
+inline unsigned parallelSlack(Context* c, unsigned footprint)
+{
+  return c->collectorCount * PlabSizeInWords + footprint / 15;
+}
+
 inline bool oversizedGen2(Context* c)
 {
   return c->gen2.capacity() > (InitialGen2CapacityInBytes / BytesPerWord)
@@ -866,6 +1128,13 @@ inline void initNextGen1(Context* c)
       Segment::Map(&(c->nextGen1), max(1, log(TenureThreshold)), 1, 0, false);
 
   unsigned minimum = minimumNextGen1Capacity(c);
+  if (c->compacting) {
+    // nothing is tenured while gen2 is being compacted
+    minimum += c->tenureFootprint + c->tenurePadding;
+  }
+  if (c->parallel) {
+    minimum += parallelSlack(c, minimum);
+  }
   unsigned desired = minimum;
 
   new (&(c->nextGen1)) Segment(c, &(c->nextAgeMap), desired, minimum);
@@ -881,15 +1150,12 @@ inline void initNextGen2(Context* c)
 {
   new (&(c->nextPointerMap)) Segment::Map(&(c->nextGen2), 1, 1, 0, true);
 
-  new (&(c->nextPageMap)) Segment::Map(&(c->nextGen2),
-                                       1,
-                                       LikelyPageSizeInBytes / BytesPerWord,
+  new (&(c->nextHeapMap)) Segment::Map(&(c->nextGen2),
+                                       BitsPerCard,
+                                       CardSizeInWords,
                                        &(c->nextPointerMap),
                                        true);
 
-  new (&(c->nextHeapMap)) Segment::Map(
-      &(c->nextGen2), 1, c->pageMap.scale * 1024, &(c->nextPageMap), true);
-
   unsigned minimum = minimumNextGen2Capacity(c);
   unsigned desired = minimum;
 
@@ -952,7 +1218,12 @@ void free(Context* c, Fixie** fixies, bool resetImmortal)
   for (Fixie** p = fixies; *p;) {
     Fixie* f = *p;
 
-    if (f->immortal()) {
+    if (f->large()) {
+      // the sweep of the large object space decides its fate
+      *p = f->next;
+      f->next = 0;
+      f->handle = 0;
+    } else if (f->immortal()) {
       if (resetImmortal) {
         if (DebugFixies) {
           fprintf(stderr, "reset immortal fixie %p\n", f);
@@ -971,6 +1242,7 @@ void free(Context* c, Fixie** fixies, bool resetImmortal)
       if (DebugFixies) {
         fprintf(stderr, "free fixie %p\n", f);
       }
+      ++c->freedFixies;
       free(c, f, f->totalSize());
     }
   }
@@ -985,6 +1257,181 @@ void kill(Fixie* fixies)
   }
 }
 
+inline unsigned largeObjectWords(Context* c)
+{
+  return ceilingDivide(c->largeObjectCapacity, BitsPerWord);
+}
+
+// returns the large objects which were not reached by the current
+// collection, out of those it was responsible for
+inline uintptr_t unreachedLargeObjects(Context* c, unsigned word)
+{
+  uintptr_t candidates = c->largeOccupied[word] & ~c->largeLive[word];
+  if (c->mode == Heap::MinorCollection) {
+    candidates &= ~c->largeTenured[word];
+  }
+  return candidates;
+}
+
+void growLargeObjects(Context* c)
+{
+  unsigned oldWords = largeObjectWords(c);
+  unsigned capacity
+      = max(c->largeObjectCapacity * 2, InitialLargeObjectCapacity);
+  unsigned words = ceilingDivide(capacity, BitsPerWord);
+
+  LargeObject** objects = static_cast<LargeObject**>(
+      local::allocate(c, capacity * BytesPerWord));
+  memset(objects, 0, capacity * BytesPerWord);
+
+  uintptr_t* bits = static_cast<uintptr_t*>(
+      local::allocate(c, words * 3 * BytesPerWord));
+  memset(bits, 0, words * 3 * BytesPerWord);
+
+  if (c->largeObjects) {
+    memcpy(objects, c->largeObjects, c->largeObjectCapacity * BytesPerWord);
+    memcpy(bits, c->largeOccupied, oldWords * BytesPerWord);
+    memcpy(bits + words, c->largeLive, oldWords * BytesPerWord);
+    memcpy(bits + (words * 2), c->largeTenured, oldWords * BytesPerWord);
+
+    free(c, c->largeObjects, c->largeObjectCapacity * BytesPerWord);
+    free(c, c->largeOccupied, oldWords * 3 * BytesPerWord);
+  }
+
+  c->largeObjects = objects;
+  c->largeOccupied = bits;
+  c->largeLive = bits + words;
+  c->largeTenured = bits + (words * 2);
+  c->largeObjectCapacity = capacity;
+}
+
+// the caller must ensure that neither this nor a collection runs
+// concurrently with another call
+void* allocateLarge(Context* c, unsigned sizeInWords)
+{
+  unsigned footprint = LargeObject::footprintFor(sizeInWords);
+
+  unsigned index = 0;
+  unsigned words = largeObjectWords(c);
+  while (index < words
+         and c->largeOccupied[index] == ~static_cast<uintptr_t>(0)) {
+    ++index;
+  }
+
+  if (index == words) {
+    growLargeObjects(c);
+  }
+
+  index = index * BitsPerWord;
+  while (getBit(c->largeOccupied, index)) {
+    ++index;
+  }
+
+  Slice<uint8_t> pages = Memory::allocate(footprint);
+  if (pages.begin() == 0) {
+    return 0;
+  }
+
+  {
+    ACQUIRE(c->lock);
+    c->count += footprint;
+  }
+
+  LargeObject* o = new (pages.begin()) LargeObject(index, footprint);
+  Fixie* f = new (o->fixie()) Fixie(c, sizeInWords, false, 0, false);
+  f->flags |= Fixie::Large;
+
+  markBit(c->largeOccupied, index);
+  c->largeObjects[index] = o;
+
+  if (DebugFixies) {
+    fprintf(stderr, "make large fixie %p of size %d\n", f, footprint);
+  }
+
+  return f->body();
+}
+
+void freeLarge(Context* c, unsigned index)
+{
+  LargeObject* o = c->largeObjects[index];
+
+  if (DebugFixies) {
+    fprintf(stderr, "free large fixie %p\n", o->fixie());
+  }
+
+  clearBit(c->largeOccupied, index);
+  clearBit(c->largeTenured, index);
+  c->largeObjects[index] = 0;
+  ++c->freedFixies;
+
+  {
+    ACQUIRE(c->lock);
+    expect(c->system, c->count >= o->footprint);
+    c->count -= o->footprint;
+  }
+
+  Memory::free(Slice<uint8_t>(reinterpret_cast<uint8_t*>(o), o->footprint));
+}
+
+void markLive(Context* c, Fixie* f)
+{
+  if (f->large()) {
+    markBit(c->largeLive, LargeObject::fromFixie(f)->index);
+  }
+}
+
+void killLargeObjects(Context* c)
+{
+  for (unsigned word = 0; word < largeObjectWords(c); ++word) {
+    uintptr_t bits = unreachedLargeObjects(c, word);
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        c->largeObjects[word * BitsPerWord + bit]->fixie()->dead(true);
+      }
+    }
+  }
+}
+
+void sweepLargeObjects(Context* c)
+{
+  for (unsigned word = 0; word < largeObjectWords(c); ++word) {
+    uintptr_t bits = unreachedLargeObjects(c, word);
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        freeLarge(c, word * BitsPerWord + bit);
+      }
+    }
+  }
+
+  if (c->largeLive) {
+    memset(c->largeLive, 0, largeObjectWords(c) * BytesPerWord);
+  }
+}
+
+void disposeLargeObjects(Context* c)
+{
+  if (c->largeObjects == 0) {
+    return;
+  }
+
+  for (unsigned word = 0; word < largeObjectWords(c); ++word) {
+    uintptr_t bits = c->largeOccupied[word];
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        freeLarge(c, word * BitsPerWord + bit);
+      }
+    }
+  }
+
+  free(c, c->largeObjects, c->largeObjectCapacity * BytesPerWord);
+  free(c, c->largeOccupied, largeObjectWords(c) * 3 * BytesPerWord);
+  c->largeObjects = 0;
+  c->largeOccupied = 0;
+  c->largeLive = 0;
+  c->largeTenured = 0;
+  c->largeObjectCapacity = 0;
+}
+
 void killFixies(Context* c)
 {
   assertT(c, c->markedFixies == 0);
@@ -994,6 +1441,7 @@ void killFixies(Context* c)
     kill(c->dirtyTenuredFixies);
   }
   kill(c->fixies);
+  killLargeObjects(c);
 }
 
 void sweepFixies(Context* c)
@@ -1007,6 +1455,7 @@ void sweepFixies(Context* c)
     c->tenuredFixieFootprint = 0;
   }
   free(c, &(c->fixies));
+  sweepLargeObjects(c);
 
   c->untenuredFixieFootprint = 0;
 
@@ -1032,7 +1481,9 @@ void sweepFixies(Context* c)
         c->tenuredFixieFootprint += f->totalSize();
       }
 
-      if (f->dirty()) {
+      if (f->large()) {
+        markBit(c->largeTenured, LargeObject::fromFixie(f)->index);
+      } else if (f->dirty()) {
         f->add(c, &(c->dirtyTenuredFixies));
       } else {
         f->add(c, &(c->tenuredFixies));
@@ -1040,7 +1491,9 @@ void sweepFixies(Context* c)
     } else {
       c->untenuredFixieFootprint += f->totalSize();
 
-      f->add(c, &(c->fixies));
+      if (not f->large()) {
+        f->add(c, &(c->fixies));
+      }
     }
 
     f->marked(false);
@@ -1050,6 +1503,165 @@ void sweepFixies(Context* c)
       = max(c->tenuredFixieFootprint * 2, InitialTenuredFixieCeilingInBytes);
 }
 
+// Concurrent marking: once gen2 starts filling up, a background thread
+// (see Marker) traces gen2 between collections, starting from the gen2
+// objects which minor collections find referenced from younger ones
+// and from objects as they are tenured.  Writes to marked objects are
+// recorded in rescanBits so they may be scanned again before the next
+// major collection.
+//
+// The result is only a hint: that collection copies every marked
+// object before visiting any roots, so the trace which follows only
+// has to handle what the marker missed.  Marked objects which have
+// since become garbage survive until the following major collection.
+
+inline bool marked(Context* c, void* o)
+{
+  return getBit(c->markBits, c->gen2.indexOf(o));
+}
+
+void pushGrey(Context* c, void* o)
+{
+  if (c->greyCount == c->greyCapacity) {
+    unsigned capacity = max(c->greyCapacity * 2, InitialGreyCapacity);
+    void** stack
+        = static_cast<void**>(local::allocate(c, capacity * BytesPerWord));
+
+    if (c->greyStack) {
+      memcpy(stack, c->greyStack, c->greyCount * BytesPerWord);
+      free(c, c->greyStack, c->greyCapacity * BytesPerWord);
+    }
+
+    c->greyStack = stack;
+    c->greyCapacity = capacity;
+  }
+
+  c->greyStack[c->greyCount++] = o;
+}
+
+void shade(Context* c, void* o)
+{
+  assertT(c, c->marking);
+  assertT(c, c->gen2.capacity() == c->markCapacity);
+
+  unsigned i = c->gen2.indexOf(o);
+  if (not getBit(c->markBits, i)) {
+    markBit(c->markBits, i);
+    pushGrey(c, o);
+  }
+}
+
+// scans grey objects until roughly the specified number of fields have
+// been visited, returning true if any remain
+bool markSlice(Context* c, unsigned limit)
+{
+  class Walker : public Heap::Walker {
+   public:
+    Walker(Context* c, void* o) : c(c), o(o), visits(0)
+    {
+    }
+
+    virtual bool visit(unsigned offset)
+    {
+      void* p = get(o, offset);
+      if (c->gen2.contains(p)) {
+        shade(c, p);
+      }
+
+      ++visits;
+      return true;
+    }
+
+    Context* c;
+    void* o;
+    unsigned visits;
+  };
+
+  unsigned visits = 0;
+  while (c->greyCount and visits < limit) {
+    Walker w(c, c->greyStack[--c->greyCount]);
+    c->client->walk(w.o, &w);
+    visits += w.visits + 1;
+  }
+
+  return c->greyCount != 0;
+}
+
+uintptr_t* allocateBits(Context* c, unsigned capacity)
+{
+  unsigned size = ceilingDivide(capacity, BitsPerWord) * BytesPerWord;
+  uintptr_t* bits = static_cast<uintptr_t*>(local::allocate(c, size));
+  memset(bits, 0, size);
+  return bits;
+}
+
+void startMarking(Context* c)
+{
+  if (Verbose) {
+    fprintf(stderr, "start marking gen2\n");
+  }
+
+  c->markCapacity = c->gen2.capacity();
+  c->markBits = allocateBits(c, c->markCapacity);
+  c->rescanBits = allocateBits(c, c->markCapacity);
+  c->marking = true;
+}
+
+void finishMarking(Context* c)
+{
+  unsigned size = ceilingDivide(c->markCapacity, BitsPerWord) * BytesPerWord;
+  free(c, c->markBits, size);
+  free(c, c->rescanBits, size);
+  c->markBits = 0;
+  c->rescanBits = 0;
+  c->markCapacity = 0;
+  c->greyCount = 0;
+  c->incrementalCredit = 0;
+  c->marking = false;
+}
+
+// Incremental marking does the marker's work on the client's threads
+// instead, in slices paid for by what they allocate.  Each allocated
+// word buys at least one visit, and more as gen2 fills up, so marking
+// tends to finish before a full gen2 forces a major collection.  A
+// slice stops early once it has taken incrementalPause milliseconds,
+// carrying the rest over; if the client outpaces it that way, gen2
+// fills up regardless and the major collection finishes what's left
+// (see remark).
+void markIncrementally(Context* c, unsigned sizeInBytes)
+{
+  if (not c->marking) {
+    return;
+  }
+
+  unsigned rate = 1 + (c->gen2.position() / (c->gen2.remaining() + 1));
+  c->incrementalCredit += ceilingDivide(sizeInBytes, BytesPerWord) * rate;
+
+  if (c->incrementalCredit < IncrementalSliceInWords) {
+    return;
+  }
+
+  int64_t deadline
+      = c->system->nanoTime()
+        + (static_cast<int64_t>(c->incrementalPause) * 1000 * 1000);
+
+  bool more = true;
+  while (more and c->incrementalCredit >= IncrementalSliceInWords) {
+    more = markSlice(c, IncrementalSliceInWords);
+    c->incrementalCredit -= IncrementalSliceInWords;
+
+    if (c->system->nanoTime() >= deadline) {
+      break;
+    }
+  }
+
+  if (not more) {
+    // don't bank credit while there's nothing grey; objects tenured
+    // meanwhile are shaded by the collection which tenures them
+    c->incrementalCredit = 0;
+  }
+}
+
 inline void* copyTo(Context* c, Segment* s, void* o, unsigned size)
 {
   assertT(c, s->remaining() >= size);
@@ -1066,6 +1678,7 @@ bool immortalHeapContains(Context* c, void* p)
 void* copy2(Context* c, void* o)
 {
   unsigned size = c->client->copiedSizeInWords(o);
+  c->copiedFootprint += size;
 
   if (c->gen2.contains(o)) {
     assertT(c, c->mode == Heap::MajorCollection);
@@ -1081,8 +1694,24 @@ void* copy2(Context* c, void* o)
           c->gen2Base = c->gen2.position();
         }
 
-        return copyTo(c, &(c->gen2), o, size);
+        c->promotedFootprint += size;
+        o = copyTo(c, &(c->gen2), o, size);
+        c->client->tenured(o);
+
+        if (c->marking) {
+          shade(c, o);
+        }
+
+        return o;
+      } else if (c->compacting) {
+        o = copyTo(c, &(c->nextGen1), o, size);
+
+        c->nextAgeMap.setOnly(o, age);
+        c->tenureFootprint += size;
+
+        return o;
       } else {
+        c->promotedFootprint += size;
         return copyTo(c, &(c->nextGen2), o, size);
       }
     } else {
@@ -1139,6 +1768,7 @@ void* update3(Context* c, void* o, bool* needsVisit)
       f->marked(true);
       f->dead(false);
       f->move(c, &(c->markedFixies));
+      markLive(c, f);
     }
     *needsVisit = false;
     return o;
@@ -1154,9 +1784,20 @@ void* update3(Context* c, void* o, bool* needsVisit)
   }
 }
 
+void markCompacted(Context* c, void* o);
+
 void* update2(Context* c, void* o, bool* needsVisit)
 {
   if (c->mode == Heap::MinorCollection and c->gen2.contains(o)) {
+    if (c->marking) {
+      shade(c, o);
+    }
+
+    *needsVisit = false;
+    return o;
+  } else if (c->compacting and c->gen2.contains(o)) {
+    markCompacted(c, o);
+
     *needsVisit = false;
     return o;
   }
@@ -1182,7 +1823,7 @@ void markClean(Context* c, Fixie* f)
 {
   if (f->dirty()) {
     f->dirty(false);
-    if (f->immortal()) {
+    if (f->immortal() or f->large()) {
       f->remove(c);
     } else {
       f->move(c, &(c->tenuredFixies));
@@ -1238,7 +1879,15 @@ void updateHeapMap(Context* c,
                 segment(c, p));
       }
 
+#ifdef USE_ATOMIC_OPERATIONS
+      if (c->parallel) {
+        map->markAtomic(p);
+      } else {
+        map->set(p);
+      }
+#else
       map->set(p);
+#endif
     }
   }
 }
@@ -1263,51 +1912,716 @@ void* update(Context* c,
   return result;
 }
 
-const uintptr_t BitsetExtensionBit
-    = (static_cast<uintptr_t>(1) << (BitsPerWord - 1));
+#ifdef USE_ATOMIC_OPERATIONS
 
-void bitsetInit(uintptr_t* p)
-{
-  memset(p, 0, BytesPerWord);
-}
+// Parallel minor collections: roots, dirty cards, and dirty fixies are
+// enumerated on the thread which requested the collection, and each
+// referent is copied (or marked, if fixed) without being scanned.
+// Newly copied objects are queued in chunks which are then drained by
+// that thread together with the worker threads started by
+// setCollectorThreads.  Since objects may be reached by more than one
+// thread at once, a thread first claims an object through one of a
+// small table of spin locks, chosen by hashing its address (see
+// copyLock), and only then reads its size, copies it and installs the
+// forwarding pointer; a thread which finds the object already
+// forwarded once it holds the lock simply uses the copy.  Each thread
+// copies into its own buffers (Plabs) carved from nextGen1 and gen2 so
+// that workLock is only needed to refill them.  The work lists and the
+// idle count are likewise updated under workLock, which is also where
+// a collector decides it is done.
+
+class WorkChunk {
+ public:
+  WorkChunk* next;
+  unsigned count;
+  void* body[WorkChunkCapacity];
+};
 
-void bitsetClear(uintptr_t* p, unsigned start, unsigned end)
-{
-  if (end < BitsPerWord - 1) {
-    // do nothing
-  } else if (start < BitsPerWord - 1) {
-    memset(p + 1, 0, (wordOf(end + (BitsPerWord * 2) + 1)) * BytesPerWord);
-  } else {
-    unsigned startWord = wordOf(start + (BitsPerWord * 2) + 1);
-    unsigned endWord = wordOf(end + (BitsPerWord * 2) + 1);
-    if (endWord > startWord) {
-      memset(p + startWord + 1, 0, (endWord - startWord) * BytesPerWord);
-    }
+class Plab {
+ public:
+  Plab() : segment(0), position(0), limit(0)
+  {
   }
-}
 
-void bitsetSet(uintptr_t* p, unsigned i, bool v)
-{
-  if (i >= BitsPerWord - 1) {
-    i += (BitsPerWord * 2) + 1;
-    if (v) {
-      p[0] |= BitsetExtensionBit;
-      if (p[2] <= wordOf(i) - 3)
-        p[2] = wordOf(i) - 2;
-    }
+  void reset(Segment* s)
+  {
+    segment = s;
+    position = 0;
+    limit = 0;
   }
 
-  if (v) {
-    markBit(p, i);
-  } else {
-    clearBit(p, i);
+  Segment* segment;
+  unsigned position;
+  unsigned limit;
+};
+
+class Collector : public System::Runnable {
+ public:
+  Collector(Context* c)
+      : c(c),
+        thread(0),
+        work(0),
+        tenureFootprint(0),
+        copiedFootprint(0),
+        promotedFootprint(0)
+  {
   }
-}
 
-bool bitsetHasMore(uintptr_t* p)
-{
-  switch (*p) {
-  case 0:
+  virtual void attach(System::Thread* t)
+  {
+    thread = t;
+  }
+
+  virtual void run();
+
+  virtual bool interrupted()
+  {
+    return false;
+  }
+
+  virtual void setInterrupted(bool)
+  {
+  }
+
+  Context* c;
+  System::Thread* thread;
+  WorkChunk* work;
+  Plab gen1;
+  Plab gen2;
+  unsigned tenureFootprint;
+  unsigned copiedFootprint;
+  unsigned promotedFootprint;
+};
+
+// the caller must hold workLock
+WorkChunk* allocateChunk(Context* c)
+{
+  WorkChunk* chunk = c->freeWork;
+  if (chunk) {
+    c->freeWork = chunk->next;
+  } else {
+    chunk = static_cast<WorkChunk*>(local::allocate(c, sizeof(WorkChunk)));
+  }
+
+  chunk->next = 0;
+  chunk->count = 0;
+  return chunk;
+}
+
+void push(Context* c, Collector* w, void* p)
+{
+  if (w->work == 0 or w->work->count == WorkChunkCapacity) {
+    ACQUIRE(c->workLock);
+
+    if (w->work) {
+      w->work->next = c->sharedWork;
+      c->sharedWork = w->work;
+    }
+    w->work = allocateChunk(c);
+  }
+
+  w->work->body[w->work->count++] = p;
+}
+
+void split(Context* c, Collector* w)
+{
+  ACQUIRE(c->workLock);
+
+  WorkChunk* chunk = allocateChunk(c);
+  chunk->count = w->work->count / 2;
+  w->work->count -= chunk->count;
+  memcpy(chunk->body,
+         w->work->body + w->work->count,
+         chunk->count * BytesPerWord);
+
+  chunk->next = c->sharedWork;
+  c->sharedWork = chunk;
+}
+
+bool takeShared(Context* c, Collector* w)
+{
+  bool idle = false;
+  while (true) {
+    {
+      ACQUIRE(c->workLock);
+
+      if (c->sharedWork) {
+        if (idle) {
+          --c->idleCollectors;
+        }
+
+        if (w->work) {
+          w->work->next = c->freeWork;
+          c->freeWork = w->work;
+        }
+        w->work = c->sharedWork;
+        c->sharedWork = w->work->next;
+        w->work->next = 0;
+        return true;
+      }
+
+      if (not idle) {
+        idle = true;
+        ++c->idleCollectors;
+      }
+
+      if (c->idleCollectors == c->participants) {
+        return false;
+      }
+    }
+
+    c->system->yield();
+  }
+}
+
+void* allocate(Context* c, Plab* plab, unsigned size)
+{
+  unsigned leftover = plab->limit - plab->position;
+  if (leftover < size) {
+    ACQUIRE(c->workLock);
+
+    Segment* s = plab->segment;
+    if (leftover >= PlabSizeInWords / 16 or size > PlabSizeInWords / 2) {
+      // not worth abandoning what's left of the buffer, so allocate
+      // this object by itself
+      return s->remaining() >= size ? s->allocate(size) : 0;
+    }
+
+    unsigned n = min(PlabSizeInWords, s->remaining());
+    if (n < size) {
+      return 0;
+    }
+
+    plab->position = s->position();
+    plab->limit = plab->position + n;
+    s->allocate(n);
+  }
+
+  void* p = plab->segment->data + plab->position;
+  plab->position += size;
+  return p;
+}
+
+// Copying threads claim an object before reading its size or contents,
+// since the client follows forwarding pointers when it does either and
+// would otherwise see a header which changes underneath it.  Objects
+// are hashed to a small table of spin locks rather than marked in
+// place so that the header stays intact until the copy is published.
+uintptr_t* copyLock(Context* c, void* o)
+{
+  return c->copyLocks
+         + ((reinterpret_cast<uintptr_t>(o) / BytesPerWord) % CopyLockCount);
+}
+
+void acquireCopyLock(Context* c, uintptr_t* lock)
+{
+  while (not atomicCompareAndSwap(lock, 0, 1)) {
+    c->system->yield();
+  }
+}
+
+void releaseCopyLock(Context* c UNUSED, uintptr_t* lock)
+{
+  bool success UNUSED = atomicCompareAndSwap(lock, 1, 0);
+  assertT(c, success);
+}
+
+void* copyParallel(Context* c, Collector* w, void* o)
+{
+  uintptr_t header = fieldAtOffset<uintptr_t>(o, 0);
+  if (fresh(c, reinterpret_cast<void*>(header))) {
+    return reinterpret_cast<void*>(header);
+  }
+
+  uintptr_t* lock = copyLock(c, o);
+  acquireCopyLock(c, lock);
+
+  header = fieldAtOffset<uintptr_t>(o, 0);
+  if (fresh(c, reinterpret_cast<void*>(header))) {
+    // another thread got there first
+    releaseCopyLock(c, lock);
+    return reinterpret_cast<void*>(header);
+  }
+
+  assertT(c, not c->nextGen1.contains(o));
+  assertT(c, not c->nextGen2.contains(o));
+  assertT(c, not immortalHeapContains(c, o));
+
+  unsigned size = c->client->copiedSizeInWords(o);
+
+  bool fromGen1 = c->gen1.contains(o);
+  unsigned age = fromGen1 ? c->ageMap.get(o) : 0;
+
+  Plab* plab = age == TenureThreshold ? &(w->gen2) : &(w->gen1);
+  void* dst = allocate(c, plab, size);
+  if (dst == 0) {
+    // the preferred space is exhausted, so fall back to the other one
+    plab = plab == &(w->gen2) ? &(w->gen1) : &(w->gen2);
+    dst = allocate(c, plab, size);
+    expect(c, dst);
+  }
+
+  c->client->copy(o, dst);
+
+  // the swap doubles as a barrier, so anyone who sees the forwarding
+  // pointer also sees the copy
+  bool success UNUSED = atomicCompareAndSwap(
+      &fieldAtOffset<uintptr_t>(o, 0), header, reinterpret_cast<uintptr_t>(dst));
+  assertT(c, success);
+
+  releaseCopyLock(c, lock);
+
+  w->copiedFootprint += size;
+
+  if (plab == &(w->gen1)) {
+    if (fromGen1 and age < TenureThreshold) {
+      ++age;
+    }
+
+    c->nextAgeMap.setOnlyAtomic(dst, age);
+    if (fromGen1 and age == TenureThreshold) {
+      w->tenureFootprint += size;
+    }
+  } else {
+    w->promotedFootprint += size;
+
+    c->client->tenured(dst);
+
+    if (c->marking) {
+      ACQUIRE(c->workLock);
+      shade(c, dst);
+    }
+  }
+
+  push(c, w, dst);
+
+  return dst;
+}
+
+void markParallel(Context* c, Collector* w, Fixie* f)
+{
+  if (f->marked() or f->age >= FixieTenureThreshold) {
+    return;
+  }
+
+  {
+    ACQUIRE(c->workLock);
+
+    if (f->marked()) {
+      return;
+    }
+
+    if (DebugFixies) {
+      fprintf(stderr, "mark fixie %p\n", f);
+    }
+    f->marked(true);
+    f->dead(false);
+    f->move(c, &(c->visitedFixies));
+    markLive(c, f);
+  }
+
+  push(c, w, f->body());
+}
+
+void updateParallel(Context* c,
+                    Collector* w,
+                    void** p,
+                    void* target,
+                    unsigned offset)
+{
+  assertT(c, c->mode == Heap::MinorCollection);
+
+  void* o = maskAlignedPointer(*p);
+  if (o == 0) {
+    return;
+  }
+
+  void* result;
+  if (c->gen2.contains(o)) {
+    if (c->marking and not marked(c, o)) {
+      ACQUIRE(c->workLock);
+      shade(c, o);
+    }
+    result = o;
+  } else if (c->client->isFixed(o)) {
+    markParallel(c, w, fixie(o));
+    result = o;
+  } else if (immortalHeapContains(c, o)) {
+    result = o;
+  } else {
+    result = copyParallel(c, w, o);
+  }
+
+  local::set(p, result);
+  updateHeapMap(c, p, target, offset, result);
+}
+
+void scanParallel(Context* c, Collector* w, void* o)
+{
+  class Walker : public Heap::Walker {
+   public:
+    Walker(Context* c, Collector* w, void* o) : c(c), w(w), o(o)
+    {
+    }
+
+    virtual bool visit(unsigned offset)
+    {
+      updateParallel(c, w, getp(o, offset), o, offset);
+      return true;
+    }
+
+    Context* c;
+    Collector* w;
+    void* o;
+  } walker(c, w, o);
+
+  c->client->walk(o, &walker);
+}
+
+void wakeCollectors(Context* c)
+{
+  expect(c, c->system->success(c->system->attach(c->collectors)));
+
+  System::Thread* t = c->collectors->thread;
+  c->collectorMonitor->acquire(t);
+
+  {
+    ACQUIRE(c->workLock);
+    c->participants = c->collectorCount;
+    c->finishedCollectors = 0;
+  }
+
+  ++c->collectorEpoch;
+  c->collectorMonitor->notifyAll(t);
+  c->collectorMonitor->release(t);
+}
+
+// reads a field which other collectors update under workLock without
+// taking it, as the checks made for every object scanned do; the
+// decision to stop is always made under the lock, in takeShared
+template <class T>
+T readShared(T* p)
+{
+  T v = *static_cast<volatile T*>(p);
+  loadMemoryBarrier();
+  return v;
+}
+
+void scan(Context* c, Collector* w)
+{
+  do {
+    while (w->work and w->work->count) {
+      if (w->work->count > 1 and readShared(&(c->idleCollectors))
+          and readShared(&(c->sharedWork)) == 0) {
+        split(c, w);
+      }
+
+      scanParallel(c, w, w->work->body[--w->work->count]);
+
+      if (w == c->collectors and c->participants == 1
+          and readShared(&(c->sharedWork))) {
+        // enough work has accumulated to make it worth waking the
+        // other threads
+        wakeCollectors(c);
+      }
+    }
+  } while (takeShared(c, w));
+}
+
+void Collector::run()
+{
+  unsigned epoch = 0;
+
+  c->collectorMonitor->acquire(thread);
+  while (true) {
+    while (c->collectorEpoch == epoch and not c->shutdown) {
+      c->collectorMonitor->wait(thread, 0);
+    }
+
+    if (c->shutdown) {
+      break;
+    }
+
+    epoch = c->collectorEpoch;
+    c->collectorMonitor->release(thread);
+
+    scan(c, this);
+
+    {
+      ACQUIRE(c->workLock);
+      ++c->finishedCollectors;
+    }
+
+    c->collectorMonitor->acquire(thread);
+  }
+  c->collectorMonitor->release(thread);
+}
+
+bool pending(Context* c)
+{
+  Collector* w = c->collectors;
+  return (w->work and w->work->count) or c->sharedWork;
+}
+
+void drain(Context* c)
+{
+  c->scanning = true;
+  c->participants = 1;
+  c->idleCollectors = 0;
+
+  scan(c, c->collectors);
+
+  if (c->participants > 1) {
+    while (true) {
+      {
+        ACQUIRE(c->workLock);
+        if (c->finishedCollectors == c->collectorCount - 1) {
+          break;
+        }
+      }
+      c->system->yield();
+    }
+
+    c->collectors->thread->dispose();
+    c->collectors->thread = 0;
+  }
+
+  c->scanning = false;
+}
+
+void startParallel(Context* c)
+{
+  for (unsigned i = 0; i < c->collectorCount; ++i) {
+    Collector* w = c->collectors + i;
+    w->gen1.reset(&(c->nextGen1));
+    w->gen2.reset(&(c->gen2));
+    w->tenureFootprint = 0;
+    w->copiedFootprint = 0;
+    w->promotedFootprint = 0;
+  }
+
+  // anything copied to gen2 from here on is fresh:
+  c->gen2Base = c->gen2.position();
+}
+
+void finishParallel(Context* c)
+{
+  assertT(c, not pending(c));
+
+  for (unsigned i = 0; i < c->collectorCount; ++i) {
+    c->tenureFootprint += c->collectors[i].tenureFootprint;
+    c->copiedFootprint += c->collectors[i].copiedFootprint;
+    c->promotedFootprint += c->collectors[i].promotedFootprint;
+  }
+
+  c->parallel = false;
+}
+
+void startCollectors(Context* c, unsigned count)
+{
+  count = min(count, MaxCollectorThreads);
+  if (count < 2 or c->collectors) {
+    return;
+  }
+
+  if (not(c->system->success(c->system->make(&(c->workLock)))
+          and c->system->success(c->system->make(&(c->collectorMonitor))))) {
+    c->system->abort();
+  }
+
+  c->collectors = static_cast<Collector*>(
+      local::allocate(c, count * sizeof(Collector)));
+  for (unsigned i = 0; i < count; ++i) {
+    new (c->collectors + i) Collector(c);
+  }
+  c->collectorCount = count;
+
+  for (unsigned i = 1; i < count; ++i) {
+    expect(c, c->system->success(c->system->start(c->collectors + i)));
+  }
+}
+
+void stopCollectors(Context* c)
+{
+  if (c->collectors == 0) {
+    return;
+  }
+
+  expect(c, c->system->success(c->system->attach(c->collectors)));
+
+  System::Thread* t = c->collectors->thread;
+  c->collectorMonitor->acquire(t);
+  c->shutdown = true;
+  c->collectorMonitor->notifyAll(t);
+  c->collectorMonitor->release(t);
+
+  for (unsigned i = 1; i < c->collectorCount; ++i) {
+    c->collectors[i].thread->join();
+    c->collectors[i].thread->dispose();
+  }
+  t->dispose();
+
+  assertT(c, c->sharedWork == 0);
+
+  for (unsigned i = 0; i < c->collectorCount; ++i) {
+    if (c->collectors[i].work) {
+      free(c, c->collectors[i].work, sizeof(WorkChunk));
+    }
+  }
+
+  while (c->freeWork) {
+    WorkChunk* chunk = c->freeWork;
+    c->freeWork = chunk->next;
+    free(c, chunk, sizeof(WorkChunk));
+  }
+
+  free(c, c->collectors, c->collectorCount * sizeof(Collector));
+  c->collectors = 0;
+  c->collectorCount = 1;
+
+  c->collectorMonitor->dispose();
+  c->workLock->dispose();
+}
+
+// Traces gen2 in slices whenever marking is active.  Collections hold
+// markLock for their duration, so the marker only ever sees objects at
+// rest, though their fields may change underneath it (see rescanBits).
+class Marker : public System::Runnable {
+ public:
+  Marker(Context* c) : c(c), thread(0)
+  {
+  }
+
+  virtual void attach(System::Thread* t)
+  {
+    thread = t;
+  }
+
+  virtual void run()
+  {
+    c->markMonitor->acquire(thread);
+    while (true) {
+      bool more;
+      {
+        ACQUIRE(c->markLock);
+
+        if (c->markShutdown) {
+          break;
+        }
+
+        more = c->marking and markSlice(c, MarkSliceInWords);
+      }
+
+      if (more) {
+        c->system->yield();
+      } else {
+        c->markMonitor->wait(thread, MarkerIdleIntervalInMilliseconds);
+      }
+    }
+    c->markMonitor->release(thread);
+  }
+
+  virtual bool interrupted()
+  {
+    return false;
+  }
+
+  virtual void setInterrupted(bool)
+  {
+  }
+
+  Context* c;
+  System::Thread* thread;
+};
+
+void startMarker(Context* c)
+{
+  if (c->marker) {
+    return;
+  }
+
+  if (not(c->system->success(c->system->make(&(c->markLock)))
+          and c->system->success(c->system->make(&(c->markMonitor))))) {
+    c->system->abort();
+  }
+
+  c->marker = new (local::allocate(c, sizeof(Marker))) Marker(c);
+
+  expect(c, c->system->success(c->system->start(c->marker)));
+}
+
+void stopMarker(Context* c)
+{
+  if (c->marker == 0) {
+    return;
+  }
+
+  {
+    ACQUIRE(c->markLock);
+    c->markShutdown = true;
+  }
+
+  c->marker->thread->join();
+  c->marker->thread->dispose();
+
+  free(c, c->marker, sizeof(Marker));
+  c->marker = 0;
+
+  if (c->marking) {
+    finishMarking(c);
+  }
+
+  c->markMonitor->dispose();
+  c->markLock->dispose();
+}
+
+#endif  // USE_ATOMIC_OPERATIONS
+
+const uintptr_t BitsetExtensionBit
+    = (static_cast<uintptr_t>(1) << (BitsPerWord - 1));
+
+void bitsetInit(uintptr_t* p)
+{
+  memset(p, 0, BytesPerWord);
+}
+
+void bitsetClear(uintptr_t* p, unsigned start, unsigned end)
+{
+  if (end < BitsPerWord - 1) {
+    // do nothing
+  } else if (start < BitsPerWord - 1) {
+    memset(p + 1, 0, (wordOf(end + (BitsPerWord * 2) + 1)) * BytesPerWord);
+  } else {
+    unsigned startWord = wordOf(start + (BitsPerWord * 2) + 1);
+    unsigned endWord = wordOf(end + (BitsPerWord * 2) + 1);
+    if (endWord > startWord) {
+      memset(p + startWord + 1, 0, (endWord - startWord) * BytesPerWord);
+    }
+  }
+}
+
+void bitsetSet(uintptr_t* p, unsigned i, bool v)
+{
+  if (i >= BitsPerWord - 1) {
+    i += (BitsPerWord * 2) + 1;
+    if (v) {
+      p[0] |= BitsetExtensionBit;
+      if (p[2] <= wordOf(i) - 3)
+        p[2] = wordOf(i) - 2;
+    }
+  }
+
+  if (v) {
+    markBit(p, i);
+  } else {
+    clearBit(p, i);
+  }
+}
+
+bool bitsetHasMore(uintptr_t* p)
+{
+  switch (*p) {
+  case 0:
     return false;
 
   case BitsetExtensionBit: {
@@ -1365,6 +2679,15 @@ unsigned bitsetNext(Context* c, uintptr_t* p)
 
 void collect(Context* c, void** p, void* target, unsigned offset)
 {
+#ifdef USE_ATOMIC_OPERATIONS
+  if (c->parallel) {
+    c->scanning = true;
+    updateParallel(c, c->collectors, p, target, offset);
+    c->scanning = false;
+    return;
+  }
+#endif
+
   void* original = maskAlignedPointer(*p);
   void* parent_ = 0;
 
@@ -1568,107 +2891,568 @@ visit : {
   }
 }
 
-void collect(Context* c, void** p)
+void collect(Context* c, void** p)
+{
+  collect(c, p, 0, 0);
+}
+
+void collect(Context* c, void* target, unsigned offset)
+{
+  collect(c, getp(target, offset), target, offset);
+}
+
+void visitDirtyFixies(Context* c, Fixie** p)
+{
+  while (*p) {
+    Fixie* f = *p;
+
+    bool wasDirty UNUSED = false;
+    bool clean = true;
+    uintptr_t* mask = f->mask();
+
+    unsigned word = 0;
+    unsigned bit = 0;
+    unsigned wordLimit = wordOf(f->size);
+    unsigned bitLimit = bitOf(f->size);
+
+    if (DebugFixies) {
+      fprintf(stderr, "clean fixie %p\n", f);
+    }
+
+    for (; word <= wordLimit and (word < wordLimit or bit < bitLimit); ++word) {
+      if (mask[word]) {
+        for (; bit < BitsPerWord and (word < wordLimit or bit < bitLimit);
+             ++bit) {
+          unsigned index = indexOf(word, bit);
+
+          if (getBit(mask, index)) {
+            wasDirty = true;
+
+            clearBit(mask, index);
+
+            if (DebugFixies) {
+              fprintf(stderr,
+                      "clean fixie %p at %d (%p)\n",
+                      f,
+                      index,
+                      f->body() + index);
+            }
+
+            collect(c, f->body(), index);
+
+            if (getBit(mask, index)) {
+              clean = false;
+            }
+          }
+        }
+        bit = 0;
+      }
+    }
+
+    if (DebugFixies) {
+      fprintf(stderr, "done cleaning fixie %p\n", f);
+    }
+
+    assertT(c, wasDirty);
+
+    if (clean) {
+      markClean(c, f);
+    } else {
+      p = &(f->next);
+    }
+  }
+}
+
+void visitMarkedFixies(Context* c)
+{
+  while (c->markedFixies) {
+    Fixie* f = c->markedFixies;
+    f->remove(c);
+
+    if (DebugFixies) {
+      fprintf(stderr, "visit fixie %p\n", f);
+    }
+
+    class Walker : public Heap::Walker {
+     public:
+      Walker(Context* c, void** p) : c(c), p(p)
+      {
+      }
+
+      virtual bool visit(unsigned offset)
+      {
+        local::collect(c, p, offset);
+        return true;
+      }
+
+      Context* c;
+      void** p;
+    } w(c, f->body());
+
+    c->client->walk(f->body(), &w);
+
+    f->move(c, &(c->visitedFixies));
+  }
+}
+
+// finishes marking from whatever was written to since it was scanned
+void remark(Context* c)
+{
+  unsigned words = ceilingDivide(c->gen2.position(), BitsPerWord);
+  for (unsigned word = 0; word < words; ++word) {
+    uintptr_t bits = c->rescanBits[word] & c->markBits[word];
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        pushGrey(c, c->gen2.get(word * BitsPerWord + bit));
+      }
+    }
+  }
+
+  while (markSlice(c, MarkSliceInWords)) {
+  }
+}
+
+// copies every marked object to nextGen2 and only then updates the
+// copies, so references between marked objects never need to be traced
+void evacuateMarked(Context* c)
+{
+  unsigned words = ceilingDivide(c->gen2.position(), BitsPerWord);
+  unsigned start = c->nextGen2.position();
+
+  for (unsigned word = 0; word < words; ++word) {
+    uintptr_t bits = c->markBits[word];
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        copy(c, c->gen2.get(word * BitsPerWord + bit));
+      }
+    }
+  }
+
+  if (Verbose) {
+    fprintf(stderr,
+            " - evacuated %d bytes ahead of tracing\n",
+            (c->nextGen2.position() - start) * BytesPerWord);
+  }
+
+  class Walker : public Heap::Walker {
+   public:
+    Walker(Context* c, void* p) : c(c), p(p)
+    {
+    }
+
+    virtual bool visit(unsigned offset)
+    {
+      local::collect(c, p, offset);
+      return true;
+    }
+
+    Context* c;
+    void* p;
+  };
+
+  for (unsigned word = 0; word < words; ++word) {
+    uintptr_t bits = c->markBits[word];
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        Walker w(c, follow(c, c->gen2.get(word * BitsPerWord + bit)));
+        c->client->walk(w.p, &w);
+        visitMarkedFixies(c);
+      }
+    }
+  }
+}
+
+// Gen2 compaction: when enabled, major collections may slide live gen2
+// objects toward the bottom of gen2 rather than copying them to
+// nextGen2, so no second copy of the old generation is needed.  Gen2
+// objects are marked in liveBits and scanned from greyStack as they are
+// reached, while everything younger is copied as usual.  Objects which
+// would otherwise be tenured stay in nextGen1 until the next minor
+// collection, since gen2 is not in a state to accept them.
+//
+// Once tracing is done, each live object's size and destination are
+// recorded in tables indexed by its rank among the live objects (see
+// forward), and the locations of references which may point into gen2
+// are remembered: as bits in gen2ReferenceBits and gen1ReferenceBits
+// for slots in gen2 and nextGen1, and in the slots array for everything
+// else.  The objects are then updated and slid in address order.
+//
+// Objects whose identity hash has been taken but not yet stored cannot
+// move without changing that hash, so they stay where they are.
+
+void markCompacted(Context* c, void* o)
+{
+  assertT(c, c->compacting);
+
+  unsigned i = c->gen2.indexOf(o);
+  if (not getBit(c->liveBits, i)) {
+    markBit(c->liveBits, i);
+    pushGrey(c, o);
+  }
+}
+
+void pushSlot(Context* c, void** p)
 {
-  collect(c, p, 0, 0);
+  if (c->slotCount == c->slotCapacity) {
+    unsigned capacity = max(c->slotCapacity * 2, InitialSlotCapacity);
+    void*** slots
+        = static_cast<void***>(local::allocate(c, capacity * BytesPerWord));
+
+    if (c->slots) {
+      memcpy(slots, c->slots, c->slotCount * BytesPerWord);
+      free(c, c->slots, c->slotCapacity * BytesPerWord);
+    }
+
+    c->slots = slots;
+    c->slotCapacity = capacity;
+  }
+
+  c->slots[c->slotCount++] = p;
 }
 
-void collect(Context* c, void* target, unsigned offset)
+// remembers a location which may later need to be updated to point to
+// the new location of a gen2 object
+void recordSlot(Context* c, void** p)
 {
-  collect(c, getp(target, offset), target, offset);
+  if (c->gen2.contains(p)) {
+    markBit(c->gen2ReferenceBits, c->gen2.indexOf(p));
+  } else if (c->nextGen1.contains(p)) {
+    markBit(c->gen1ReferenceBits, c->nextGen1.indexOf(p));
+  } else if (not c->gen1.contains(p)) {
+    pushSlot(c, p);
+  }
 }
 
-void visitDirtyFixies(Context* c, Fixie** p)
+void startCompaction(Context* c)
 {
-  while (*p) {
-    Fixie* f = *p;
+  if (Verbose) {
+    fprintf(stderr, "compact gen2\n");
+  }
 
-    bool wasDirty UNUSED = false;
-    bool clean = true;
-    uintptr_t* mask = f->mask();
+  c->liveBits = allocateBits(c, c->gen2.capacity());
+  c->gen2ReferenceBits = allocateBits(c, c->gen2.capacity());
+  c->gen1ReferenceBits = allocateBits(c, c->nextGen1.capacity());
+}
 
-    unsigned word = 0;
-    unsigned bit = 0;
-    unsigned wordLimit = wordOf(f->size);
-    unsigned bitLimit = bitOf(f->size);
+// scans gen2 objects as they are reached until there are none left
+void traceCompacted(Context* c)
+{
+  class Walker : public Heap::Walker {
+   public:
+    Walker(Context* c, void* p) : c(c), p(p)
+    {
+    }
 
-    if (DebugFixies) {
-      fprintf(stderr, "clean fixie %p\n", f);
+    virtual bool visit(unsigned offset)
+    {
+      local::collect(c, p, offset);
+      return true;
     }
 
-    for (; word <= wordLimit and (word < wordLimit or bit < bitLimit); ++word) {
-      if (mask[word]) {
-        for (; bit < BitsPerWord and (word < wordLimit or bit < bitLimit);
-             ++bit) {
-          unsigned index = indexOf(word, bit);
+    Context* c;
+    void* p;
+  };
 
-          if (getBit(mask, index)) {
-            wasDirty = true;
+  while (c->greyCount) {
+    Walker w(c, c->greyStack[--c->greyCount]);
+    c->client->walk(w.p, &w);
+    visitMarkedFixies(c);
+  }
+}
 
-            clearBit(mask, index);
+inline unsigned bitCount(uintptr_t v)
+{
+  unsigned n = 0;
+  for (; v; v &= v - 1) {
+    ++n;
+  }
+  return n;
+}
 
-            if (DebugFixies) {
-              fprintf(stderr,
-                      "clean fixie %p at %d (%p)\n",
-                      f,
-                      index,
-                      f->body() + index);
-            }
+inline unsigned rank(Context* c, unsigned index)
+{
+  assertT(c, getBit(c->liveBits, index));
 
-            collect(c, f->body(), index);
+  uintptr_t below = c->liveBits[wordOf(index)]
+                    & ((static_cast<uintptr_t>(1) << bitOf(index)) - 1);
 
-            if (getBit(mask, index)) {
-              clean = false;
-            }
-          }
-        }
-        bit = 0;
-      }
+  return c->liveRanks[wordOf(index)] + bitCount(below);
+}
+
+inline void* forward(Context* c, void* o)
+{
+  return c->gen2.data
+         + c->liveDestinations[rank(c, c->gen2.indexOf(o))];
+}
+
+inline void updateSlot(Context* c, void** p)
+{
+  void* o = maskAlignedPointer(*p);
+  if (c->gen2.contains(o)) {
+    local::set(p, forward(c, o));
+  }
+}
+
+// true if a gen2 slot containing the specified value needs a heapMap
+// entry so the next minor collection will find it
+inline bool remembered(Context* c, void* o)
+{
+  return o and not(c->gen2.contains(o) or immortalHeapContains(c, o)
+                   or (c->client->isFixed(o)
+                       and fixie(o)->age >= FixieTenureThreshold));
+}
+
+int compareSlots(const void* a, const void* b)
+{
+  uintptr_t x = reinterpret_cast<uintptr_t>(*static_cast<void** const*>(a));
+  uintptr_t y = reinterpret_cast<uintptr_t>(*static_cast<void** const*>(b));
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// chooses a destination for each live gen2 object and records where
+// references to them may be found, returning the resulting position
+unsigned planCompaction(Context* c)
+{
+  class Walker : public Heap::Walker {
+   public:
+    Walker(uintptr_t* bits, unsigned base) : bits(bits), base(base)
+    {
     }
 
-    if (DebugFixies) {
-      fprintf(stderr, "done cleaning fixie %p\n", f);
+    virtual bool visit(unsigned offset)
+    {
+      markBit(bits, base + offset);
+      return true;
     }
 
-    assertT(c, wasDirty);
+    uintptr_t* bits;
+    unsigned base;
+  };
 
-    if (clean) {
-      markClean(c, f);
-    } else {
-      p = &(f->next);
-    }
+  unsigned words = ceilingDivide(c->gen2.position(), BitsPerWord);
+  c->liveRanks = static_cast<unsigned*>(local::allocate(
+      c, ceilingDivide(c->gen2.capacity(), BitsPerWord) * sizeof(unsigned)));
+
+  unsigned count = 0;
+  for (unsigned word = 0; word < words; ++word) {
+    c->liveRanks[word] = count;
+    count += bitCount(c->liveBits[word]);
   }
-}
 
-void visitMarkedFixies(Context* c)
-{
-  while (c->markedFixies) {
-    Fixie* f = c->markedFixies;
-    f->remove(c);
+  c->liveCapacity = max(count, 1u);
+  c->liveDestinations = static_cast<unsigned*>(
+      local::allocate(c, c->liveCapacity * sizeof(unsigned)));
+  c->liveSizes = static_cast<unsigned*>(
+      local::allocate(c, c->liveCapacity * sizeof(unsigned)));
+
+  unsigned position = 0;
+  unsigned n = 0;
+  for (unsigned word = 0; word < words; ++word) {
+    uintptr_t bits = c->liveBits[word];
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        unsigned i = indexOf(word, bit);
+        void* o = c->gen2.get(i);
+        unsigned size = c->client->sizeInWords(o);
+
+        if (c->client->copiedSizeInWords(o) != size) {
+          position = i;
+        }
 
-    if (DebugFixies) {
-      fprintf(stderr, "visit fixie %p\n", f);
+        c->liveDestinations[n] = position;
+        c->liveSizes[n] = size;
+        position += size;
+        ++n;
+
+        Walker w(c->gen2ReferenceBits, i);
+        c->client->walk(o, &w);
+      }
     }
+  }
+
+  for (unsigned i = 0; i < c->nextGen1.position();
+       i += c->client->sizeInWords(c->nextGen1.get(i))) {
+    Walker w(c->gen1ReferenceBits, i);
+    c->client->walk(c->nextGen1.get(i), &w);
+  }
 
+  for (Fixie* f = c->visitedFixies; f; f = f->next) {
     class Walker : public Heap::Walker {
      public:
-      Walker(Context* c, void** p) : c(c), p(p)
+      Walker(Context* c, void* p) : c(c), p(p)
       {
       }
 
       virtual bool visit(unsigned offset)
       {
-        local::collect(c, p, offset);
+        pushSlot(c, getp(p, offset));
         return true;
       }
 
       Context* c;
-      void** p;
+      void* p;
     } w(c, f->body());
 
     c->client->walk(f->body(), &w);
+  }
 
-    f->move(c, &(c->visitedFixies));
+  return position;
+}
+
+void slideGen2(Context* c, unsigned position)
+{
+  for (Segment::Map* map = &(c->heapMap); map; map = map->child) {
+    memset(map->data, 0, map->size() * BytesPerWord);
+  }
+
+  unsigned words = ceilingDivide(c->gen2.position(), BitsPerWord);
+  unsigned n = 0;
+  for (unsigned word = 0; word < words; ++word) {
+    uintptr_t bits = c->liveBits[word];
+    for (unsigned bit = 0; bits; ++bit, bits >>= 1) {
+      if (bits & 1) {
+        unsigned i = indexOf(word, bit);
+        unsigned dst = c->liveDestinations[n];
+        unsigned size = c->liveSizes[n];
+        ++n;
+
+        for (unsigned j = i; j < i + size; ++j) {
+          if (getBit(c->gen2ReferenceBits, j)) {
+            updateSlot(c, static_cast<void**>(c->gen2.get(j)));
+          }
+        }
+
+        if (dst != i) {
+          memmove(c->gen2.get(dst), c->gen2.get(i), size * BytesPerWord);
+          c->copiedFootprint += size;
+        }
+
+        for (unsigned j = i; j < i + size; ++j) {
+          if (getBit(c->gen2ReferenceBits, j)) {
+            void** p = static_cast<void**>(c->gen2.get(dst + (j - i)));
+            if (remembered(c, maskAlignedPointer(*p))) {
+              c->heapMap.set(p);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  c->gen2.position_ = position;
+}
+
+void finishCompaction(Context* c)
+{
+  unsigned words = ceilingDivide(c->gen2.capacity(), BitsPerWord);
+  unsigned size = words * BytesPerWord;
+
+  free(c, c->liveRanks, words * sizeof(unsigned));
+  free(c, c->liveDestinations, c->liveCapacity * sizeof(unsigned));
+  free(c, c->liveSizes, c->liveCapacity * sizeof(unsigned));
+  free(c, c->liveBits, size);
+  free(c, c->gen2ReferenceBits, size);
+  free(c,
+       c->gen1ReferenceBits,
+       ceilingDivide(c->nextGen1.capacity(), BitsPerWord) * BytesPerWord);
+
+  if (c->slots) {
+    free(c, c->slots, c->slotCapacity * BytesPerWord);
+  }
+
+  c->liveBits = 0;
+  c->gen2ReferenceBits = 0;
+  c->gen1ReferenceBits = 0;
+  c->liveRanks = 0;
+  c->liveDestinations = 0;
+  c->liveSizes = 0;
+  c->liveCapacity = 0;
+  c->slots = 0;
+  c->slotCount = 0;
+  c->slotCapacity = 0;
+}
+
+void compactGen2(Context* c)
+{
+  unsigned before = c->gen2.position();
+  unsigned position = planCompaction(c);
+
+  for (unsigned i = 0; i < c->nextGen1.position(); ++i) {
+    if (getBit(c->gen1ReferenceBits, i)) {
+      updateSlot(c, static_cast<void**>(c->nextGen1.get(i)));
+    }
+  }
+
+  qsort(c->slots, c->slotCount, BytesPerWord, compareSlots);
+  for (unsigned i = 0; i < c->slotCount; ++i) {
+    if (i == 0 or c->slots[i] != c->slots[i - 1]) {
+      updateSlot(c, c->slots[i]);
+    }
+  }
+
+  slideGen2(c, position);
+
+  if (Verbose) {
+    fprintf(stderr,
+            " - compacted gen2 from %d to %d bytes\n",
+            before * BytesPerWord,
+            position * BytesPerWord);
+  }
+}
+
+void collect(Context* c,
+             Segment::Map* map,
+             unsigned start,
+             unsigned end,
+             bool* dirty,
+             bool expectDirty);
+
+// scans the card table linearly, a word's worth of cards at a time,
+// visiting the slots of each dirty card and leaving it dirty if any of
+// them still refer outside gen2
+void collectCards(Context* c,
+                  Segment::Map* map,
+                  unsigned start,
+                  unsigned end,
+                  bool* dirty)
+{
+  if (end > map->segment->position()) {
+    end = map->segment->position();
+  }
+
+  if (start >= end) {
+    return;
+  }
+
+  uint8_t* cards = map->card(0);
+  unsigned first = start / map->scale;
+  unsigned limit = ceilingDivide(end, map->scale);
+
+  for (unsigned i = first; i < limit;) {
+    if (i % BytesPerWord == 0 and i + BytesPerWord <= limit
+        and reinterpret_cast<uintptr_t*>(cards)[i / BytesPerWord] == 0) {
+      i += BytesPerWord;
+      continue;
+    }
+
+    if (cards[i]) {
+      cards[i] = 0;
+
+      bool childDirty = false;
+      collect(c,
+              map->child,
+              i * map->scale,
+              (i + 1) * map->scale,
+              &childDirty,
+              true);
+
+      if (childDirty) {
+        cards[i] = 1;
+        *dirty = true;
+      }
+    }
+
+    ++i;
   }
 }
 
@@ -1679,6 +3463,11 @@ void collect(Context* c,
              bool* dirty,
              bool expectDirty UNUSED)
 {
+  if (map->bitsPerRecord == BitsPerCard) {
+    collectCards(c, map, start, end, dirty);
+    return;
+  }
+
   bool wasDirty UNUSED = false;
   for (Segment::Map::Iterator it(map, start, end); it.hasMore();) {
     wasDirty = true;
@@ -1725,36 +3514,223 @@ void collect2(Context* c)
   c->tenurePadding = 0;
 
   if (c->mode == Heap::MajorCollection) {
-    c->gen2Padding = 0;
+    c->gen2Padding = 0;
+
+    if (c->marking) {
+      remark(c);
+      evacuateMarked(c);
+    } else if (c->compacting) {
+      startCompaction(c);
+    }
+  }
+
+#ifdef USE_ATOMIC_OPERATIONS
+  if (c->parallel) {
+    startParallel(c);
+  }
+#endif
+
+  if (c->mode == Heap::MinorCollection and c->gen2.position()) {
+    unsigned start = 0;
+    unsigned end = start + c->gen2.position();
+    bool dirty;
+    collect(c, &(c->heapMap), start, end, &dirty, false);
+  }
+
+  if (c->mode == Heap::MinorCollection) {
+    visitDirtyFixies(c, &(c->dirtyTenuredFixies));
+  }
+
+  class Visitor : public Heap::Visitor {
+   public:
+    Visitor(Context* c) : c(c)
+    {
+    }
+
+    virtual void visit(void* p)
+    {
+      if (c->compacting) {
+        recordSlot(c, static_cast<void**>(p));
+      }
+
+      local::collect(c, static_cast<void**>(p));
+      visitMarkedFixies(c);
+
+      if (c->compacting) {
+        traceCompacted(c);
+      }
+    }
+
+    Context* c;
+  } v(c);
+
+  c->client->visitRoots(&v);
+
+  if (c->compacting) {
+    compactGen2(c);
+    finishCompaction(c);
+  }
+
+#ifdef USE_ATOMIC_OPERATIONS
+  if (c->parallel) {
+    drain(c);
+    finishParallel(c);
+  }
+#endif
+}
+
+// returns the index of the first page boundary in gen2 at or after the
+// specified index
+unsigned pageAlignedIndex(Context* c, unsigned index)
+{
+  uintptr_t start = reinterpret_cast<uintptr_t>(c->gen2.data);
+  uintptr_t p = (start + (index * BytesPerWord) + Memory::PageSize - 1)
+                & ~static_cast<uintptr_t>(Memory::PageSize - 1);
+  return min(static_cast<unsigned>((p - start) / BytesPerWord),
+             c->gen2.capacity());
+}
+
+unsigned releasedBytes(Context* c)
+{
+  uintptr_t start
+      = reinterpret_cast<uintptr_t>(c->gen2.data + c->gen2Released);
+  uintptr_t end
+      = reinterpret_cast<uintptr_t>(c->gen2.data + c->gen2.capacity())
+        & ~static_cast<uintptr_t>(Memory::PageSize - 1);
+
+  return start < end ? end - start : 0;
+}
+
+// Once gen2 has stayed mostly empty for several collections in a row,
+// the pages above what it currently holds (plus some headroom) are
+// returned to the system.  They remain part of the segment and are
+// faulted back in as gen2 fills up again.
+void releaseUnused(Context* c)
+{
+  if (largeSegment(c, c->gen2.footprint(c->gen2.capacity()) * BytesPerWord)) {
+    // giving back part of a large page would either split it or, on
+    // some systems, fail outright
+    return;
+  }
+
+  if (c->gen2.position() > c->gen2Released) {
+    c->gen2Released = pageAlignedIndex(c, c->gen2.position());
+  }
+
+  if (c->gen2.position() <= c->gen2.capacity() / 2) {
+    ++c->quietCollections;
+  } else {
+    c->quietCollections = 0;
+  }
+
+  if (c->quietCollections >= QuietCollectionsBeforeRelease) {
+    unsigned start = pageAlignedIndex(
+        c, c->gen2.position() + (c->gen2.position() / 2));
+
+    if (start < c->gen2Released) {
+      unsigned before = releasedBytes(c);
+      c->gen2Released = start;
+
+      unsigned size = releasedBytes(c);
+      if (size) {
+        Memory::release(Slice<uint8_t>(
+            reinterpret_cast<uint8_t*>(c->gen2.data + start), size));
+      }
+
+      if (Verbose) {
+        fprintf(stderr,
+                " - released %d bytes of gen2\n",
+                static_cast<int>(size - before));
+      }
+    }
+  }
+}
+
+void recordStatistics(Context* c,
+                      int64_t then,
+                      unsigned gen1Before,
+                      unsigned gen2Before)
+{
+  Heap::Statistics* s = &(c->statistics);
+  int64_t pause = milliseconds(c) - then;
+
+  ++s->collections;
+  if (c->mode == Heap::MajorCollection) {
+    ++s->majorCollections;
   }
-
-  if (c->mode == Heap::MinorCollection and c->gen2.position()) {
-    unsigned start = 0;
-    unsigned end = start + c->gen2.position();
-    bool dirty;
-    collect(c, &(c->heapMap), start, end, &dirty, false);
+  s->totalPauseTime += pause;
+  if (pause > s->maxPauseTime) {
+    s->maxPauseTime = pause;
   }
 
-  if (c->mode == Heap::MinorCollection) {
-    visitDirtyFixies(c, &(c->dirtyTenuredFixies));
+  s->type = c->mode;
+  s->pauseTime = pause;
+  s->copied = c->copiedFootprint * BytesPerWord;
+  s->tenured = c->promotedFootprint * BytesPerWord;
+  s->freedFixies = c->freedFixies;
+  s->untenuredFixies = c->untenuredFixieFootprint;
+  s->tenuredFixies = c->tenuredFixieFootprint;
+  s->gen1Before = gen1Before * BytesPerWord;
+  s->gen1After = c->gen1.position() * BytesPerWord;
+  s->gen2Before = gen2Before * BytesPerWord;
+  s->gen2After = c->gen2.position() * BytesPerWord;
+}
+
+// pick how much may be allocated before the next minor collection so
+// that copying what survives it should take no longer than the pause
+// target.  The cost of a collection is charged entirely to the words it
+// copied, which overestimates the cost of copying since part of it is
+// fixed, so the budget errs on the small side.
+void updateIncomingBudget(Context* c, int64_t elapsed, unsigned gen1Before)
+{
+  unsigned collected = c->incomingFootprint + gen1Before;
+  if (collected == 0) {
+    return;
   }
 
-  class Visitor : public Heap::Visitor {
-   public:
-    Visitor(Context* c) : c(c)
-    {
-    }
+  int64_t cost = (elapsed * 1024) / max(c->copiedFootprint, 1u);
+  unsigned survival = max(
+      1u,
+      static_cast<unsigned>(
+          (static_cast<uint64_t>(c->copiedFootprint) * 1024) / collected));
+
+  // move halfway toward each new sample so one unusual collection
+  // doesn't swing the budget too far:
+  if (c->copyCost) {
+    c->copyCost = (c->copyCost + cost) / 2;
+    c->survival = (c->survival + survival) / 2;
+  } else {
+    c->copyCost = cost;
+    c->survival = survival;
+  }
 
-    virtual void visit(void* p)
-    {
-      local::collect(c, static_cast<void**>(p));
-      visitMarkedFixies(c);
-    }
+  // the next collection copies the survivors of what is in gen1 now
+  // plus those of whatever is allocated until then:
+  int64_t affordable = (c->pauseTarget * 1024 * 1024)
+                       / max(c->copyCost * max(c->survival, 1u),
+                             static_cast<int64_t>(1));
+  int64_t target = affordable - c->gen1.position();
+
+  if (target < static_cast<int64_t>(MinimumIncomingBudgetInWords)) {
+    target = MinimumIncomingBudgetInWords;
+  } else if (target > static_cast<int64_t>(MaximumIncomingBudgetInWords)) {
+    target = MaximumIncomingBudgetInWords;
+  }
 
-    Context* c;
-  } v(c);
+  if (c->incomingBudget) {
+    c->incomingBudget = (c->incomingBudget + target) / 2;
+  } else {
+    c->incomingBudget = target;
+  }
 
-  c->client->visitRoots(&v);
+  if (Verbose) {
+    fprintf(stderr,
+            " - incoming budget: %d bytes "
+            "(%d ns per KB copied, %d/1024 survived)\n",
+            c->incomingBudget * BytesPerWord,
+            static_cast<int>(c->copyCost / BytesPerWord),
+            c->survival);
+  }
 }
 
 bool limitExceeded(Context* c, int pendingAllocation)
@@ -1780,8 +3756,19 @@ bool limitExceeded(Context* c, int pendingAllocation)
 
 void collect(Context* c)
 {
+#ifdef USE_ATOMIC_OPERATIONS
+  if (c->marker) {
+    c->markLock->acquire();
+  }
+#endif
+
+  unsigned tenure = c->tenureFootprint + c->tenurePadding;
+  if (c->collectorCount > 1) {
+    tenure += parallelSlack(c, tenure);
+  }
+
   if (limitExceeded(c, c->pendingAllocation) or oversizedGen2(c)
-      or c->tenureFootprint + c->tenurePadding > c->gen2.remaining()
+      or tenure > c->gen2.remaining()
       or c->fixieTenureFootprint + c->tenuredFixieFootprint
          > c->tenuredFixieCeiling) {
     if (Verbose) {
@@ -1789,7 +3776,7 @@ void collect(Context* c)
         fprintf(stderr, "low memory causes ");
       } else if (oversizedGen2(c)) {
         fprintf(stderr, "oversized gen2 causes ");
-      } else if (c->tenureFootprint + c->tenurePadding > c->gen2.remaining()) {
+      } else if (tenure > c->gen2.remaining()) {
         fprintf(stderr, "undersized gen2 causes ");
       } else {
         fprintf(stderr, "fixie ceiling causes ");
@@ -1799,20 +3786,50 @@ void collect(Context* c)
     c->mode = Heap::MajorCollection;
   }
 
-  int64_t then;
+  c->parallel = c->collectorCount > 1 and c->mode == Heap::MinorCollection;
+
+  // compacting can't make gen2 bigger or smaller, so copy instead when
+  // that's needed, unless there may not be room for a copy
+  c->compacting = c->compaction and c->mode == Heap::MajorCollection
+                  and c->gen2.capacity()
+                  and (limitExceeded(c, c->pendingAllocation)
+                       or not(oversizedGen2(c) or c->growGen2));
+
+  if (c->compacting and c->marking) {
+    finishMarking(c);
+  }
+
+  if ((c->marker or c->incrementalPause)
+      and c->mode == Heap::MinorCollection and not c->marking
+      and c->gen2.position() > c->gen2.capacity() / 16) {
+    startMarking(c);
+  }
+
+  int64_t then = milliseconds(c);
+  int64_t start = c->system->nanoTime();
+  unsigned gen1Before = c->gen1.position();
+  unsigned gen2Before = c->gen2.position();
+  c->copiedFootprint = 0;
+  c->promotedFootprint = 0;
+  c->freedFixies = 0;
+
   if (Verbose) {
-    if (c->mode == Heap::MajorCollection) {
+    if (c->compacting) {
+      fprintf(stderr, "compacting major collection\n");
+    } else if (c->mode == Heap::MajorCollection) {
       fprintf(stderr, "major collection\n");
+    } else if (c->parallel) {
+      fprintf(stderr,
+              "parallel minor collection (%d threads)\n",
+              c->collectorCount);
     } else {
       fprintf(stderr, "minor collection\n");
     }
-
-    then = c->system->now();
   }
 
   initNextGen1(c);
 
-  if (c->mode == Heap::MajorCollection) {
+  if (c->mode == Heap::MajorCollection and not c->compacting) {
     initNextGen2(c);
   }
 
@@ -1820,13 +3837,37 @@ void collect(Context* c)
 
   c->gen1.replaceWith(&(c->nextGen1));
   if (c->mode == Heap::MajorCollection) {
-    c->gen2.replaceWith(&(c->nextGen2));
+    if (c->compacting) {
+      // if compacting didn't leave enough room, let the next major
+      // collection grow gen2
+      c->growGen2 = c->gen2.position() > c->gen2.capacity() / 2
+                    or c->tenureFootprint + c->tenurePadding
+                       > c->gen2.remaining();
+    } else {
+      c->gen2.replaceWith(&(c->nextGen2));
+      c->gen2Released = c->gen2.capacity();
+      c->growGen2 = false;
+
+      if (c->marking) {
+        finishMarking(c);
+      }
+    }
   }
 
   sweepFixies(c);
 
+  c->compacting = false;
+
+  releaseUnused(c);
+
+  recordStatistics(c, then, gen1Before, gen2Before);
+
+  if (c->pauseTarget and c->mode == Heap::MinorCollection) {
+    updateIncomingBudget(c, c->system->nanoTime() - start, gen1Before);
+  }
+
   if (Verbose) {
-    int64_t now = c->system->now();
+    int64_t now = milliseconds(c);
     int64_t collection = now - then;
     int64_t run = then - c->lastCollectionTime;
     c->totalCollectionTime += collection;
@@ -1861,6 +3902,12 @@ void collect(Context* c)
             " -   tenured fixies:          %8d bytes\n",
             c->tenuredFixieFootprint);
   }
+
+#ifdef USE_ATOMIC_OPERATIONS
+  if (c->marker) {
+    c->markLock->release();
+  }
+#endif
 }
 
 void* allocate(Context* c, size_t size, bool limit)
@@ -1930,6 +3977,272 @@ void free_(Context* c, const void* p, size_t size)
   free(c, p, size);
 }
 
+// Segments are allocated directly from the system in large pages when
+// those have been requested and the segment would fill at least one,
+// rounding the size up to a whole number of them.
+bool largeSegment(Context* c, size_t size)
+{
+  return c->largePages and size >= Memory::LargePageSize;
+}
+
+size_t largeSegmentSize(size_t size)
+{
+  return (size + Memory::LargePageSize - 1) & ~(Memory::LargePageSize - 1);
+}
+
+void* allocateSegment(Context* c, size_t size)
+{
+  if (not largeSegment(c, size)) {
+    return allocate(c, size, false);
+  }
+
+  Slice<uint8_t> pages = Memory::allocateLarge(size);
+  if (pages.begin() == 0) {
+    return 0;
+  }
+
+  ACQUIRE(c->lock);
+  c->count += largeSegmentSize(size);
+
+  return pages.begin();
+}
+
+void freeSegment(Context* c, const void* p, size_t size)
+{
+  if (not largeSegment(c, size)) {
+    free(c, p, size);
+    return;
+  }
+
+  size = largeSegmentSize(size);
+
+  ACQUIRE(c->lock);
+
+  expect(c->system, c->count >= size);
+
+  Memory::free(Slice<uint8_t>(
+      static_cast<uint8_t*>(const_cast<void*>(p)), size));
+  c->count -= size;
+}
+
+// Each direct memory block is preceded by a header giving its size
+// class, or, for blocks too big to pool, LargeDirectClass and the total
+// size of the allocation.  Pooled blocks are carved from spans of about
+// DirectSpanSize bytes, which go back to the system only when the heap
+// is disposed.
+const unsigned DirectHeaderSize = 16;
+const unsigned MinimumDirectShift = 6;
+const unsigned LargeDirectClass = ~0u;
+const size_t DirectSpanSize = 256 * 1024;
+const unsigned MinimumDirectSpanBlocks = 4;
+
+// the most bytes of each size class a thread cache keeps before handing
+// half of them back to the depot
+const size_t DirectCacheSize = 256 * 1024;
+
+class DirectHeader {
+ public:
+  uint32_t sizeClass;
+  uint32_t reserved;
+  uint64_t size;
+};
+
+inline DirectHeader* directHeader(void* p)
+{
+  return reinterpret_cast<DirectHeader*>(static_cast<uint8_t*>(p)
+                                         - DirectHeaderSize);
+}
+
+inline void*& nextDirectBlock(void* p)
+{
+  return *static_cast<void**>(p);
+}
+
+inline size_t directClassSize(unsigned sizeClass)
+{
+  return static_cast<size_t>(1) << (MinimumDirectShift + sizeClass);
+}
+
+inline unsigned directClass(size_t size)
+{
+  unsigned sizeClass = 0;
+  while (directClassSize(sizeClass) < size) {
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+inline unsigned directCacheLimit(unsigned sizeClass)
+{
+  return max(static_cast<size_t>(MinimumDirectSpanBlocks),
+             DirectCacheSize / directClassSize(sizeClass));
+}
+
+// Carves a new span into blocks of the specified class and adds them to
+// the depot.  The caller must hold the heap's lock.
+bool carveDirectSpan(Context* c, unsigned sizeClass)
+{
+  size_t blockSize = DirectHeaderSize + directClassSize(sizeClass);
+  size_t count = max(static_cast<size_t>(MinimumDirectSpanBlocks),
+                     DirectSpanSize / blockSize);
+
+  // the span begins with a link to the previous one, padded to keep the
+  // blocks aligned
+  size_t size = DirectHeaderSize + (count * blockSize);
+  uint8_t* span = static_cast<uint8_t*>(c->system->tryAllocate(size));
+  if (span == 0) {
+    return false;
+  }
+
+  nextDirectBlock(span) = c->directSpans;
+  c->directSpans = span;
+  c->statistics.directFootprint += size;
+
+  for (uint8_t* p = span + DirectHeaderSize; p < span + size;
+       p += blockSize) {
+    void* block = p + DirectHeaderSize;
+    directHeader(block)->sizeClass = sizeClass;
+    nextDirectBlock(block) = c->directBlocks[sizeClass];
+    c->directBlocks[sizeClass] = block;
+  }
+  c->directCounts[sizeClass] += count;
+  c->statistics.directPooled += count * directClassSize(sizeClass);
+
+  return true;
+}
+
+// moves up to count blocks of the specified class from one list to
+// another, returning how many were moved
+unsigned moveDirectBlocks(void** from,
+                          unsigned* fromCount,
+                          void** to,
+                          unsigned* toCount,
+                          unsigned count)
+{
+  unsigned moved = 0;
+  for (; moved < count and *from; ++moved) {
+    void* block = *from;
+    *from = nextDirectBlock(block);
+    nextDirectBlock(block) = *to;
+    *to = block;
+  }
+  *fromCount -= moved;
+  *toCount += moved;
+  return moved;
+}
+
+void drainDirect(Context* c,
+                 Heap::DirectCache* cache,
+                 unsigned sizeClass,
+                 unsigned count)
+{
+  ACQUIRE(c->lock);
+
+  unsigned moved = moveDirectBlocks(cache->blocks + sizeClass,
+                                    cache->counts + sizeClass,
+                                    c->directBlocks + sizeClass,
+                                    c->directCounts + sizeClass,
+                                    count);
+  c->statistics.directPooled += moved * directClassSize(sizeClass);
+}
+
+bool refillDirect(Context* c, Heap::DirectCache* cache, unsigned sizeClass)
+{
+  ACQUIRE(c->lock);
+
+  if (c->directBlocks[sizeClass] == 0
+      and not carveDirectSpan(c, sizeClass)) {
+    return false;
+  }
+
+  unsigned moved = moveDirectBlocks(c->directBlocks + sizeClass,
+                                    c->directCounts + sizeClass,
+                                    cache->blocks + sizeClass,
+                                    cache->counts + sizeClass,
+                                    directCacheLimit(sizeClass) / 2);
+  c->statistics.directPooled -= moved * directClassSize(sizeClass);
+
+  return true;
+}
+
+void* tryAllocateDirect(Context* c, Heap::DirectCache* cache, size_t size)
+{
+  if (size > Heap::MaxPooledDirectSize) {
+    size_t total = DirectHeaderSize + size;
+    if (total < size) {
+      return 0;
+    }
+
+    uint8_t* p = static_cast<uint8_t*>(c->system->tryAllocate(total));
+    if (p == 0) {
+      return 0;
+    }
+
+    void* block = p + DirectHeaderSize;
+    directHeader(block)->sizeClass = LargeDirectClass;
+    directHeader(block)->size = total;
+
+    ACQUIRE(c->lock);
+    c->statistics.directFootprint += total;
+
+    return block;
+  }
+
+  unsigned sizeClass = directClass(size);
+  if (cache->blocks[sizeClass] == 0
+      and not refillDirect(c, cache, sizeClass)) {
+    return 0;
+  }
+
+  void* block = cache->blocks[sizeClass];
+  cache->blocks[sizeClass] = nextDirectBlock(block);
+  --cache->counts[sizeClass];
+
+  return block;
+}
+
+void freeDirect(Context* c, Heap::DirectCache* cache, void* p)
+{
+  DirectHeader* header = directHeader(p);
+  if (header->sizeClass == LargeDirectClass) {
+    {
+      ACQUIRE(c->lock);
+      c->statistics.directFootprint -= header->size;
+    }
+    c->system->free(header);
+    return;
+  }
+
+  unsigned sizeClass = header->sizeClass;
+  expect(c->system, sizeClass < Heap::DirectClassCount);
+
+  if (cache->counts[sizeClass] >= directCacheLimit(sizeClass)) {
+    drainDirect(c, cache, sizeClass, cache->counts[sizeClass] / 2);
+  }
+
+  nextDirectBlock(p) = cache->blocks[sizeClass];
+  cache->blocks[sizeClass] = p;
+  ++cache->counts[sizeClass];
+}
+
+void flushDirect(Context* c, Heap::DirectCache* cache)
+{
+  for (unsigned i = 0; i < Heap::DirectClassCount; ++i) {
+    if (cache->counts[i]) {
+      drainDirect(c, cache, i, cache->counts[i]);
+    }
+  }
+}
+
+void disposeDirect(Context* c)
+{
+  while (c->directSpans) {
+    void* span = c->directSpans;
+    c->directSpans = nextDirectBlock(span);
+    c->system->free(span);
+  }
+}
+
 class MyHeap : public Heap {
  public:
   MyHeap(System* system, unsigned limit) : c(system, limit)
@@ -1948,6 +4261,56 @@ class MyHeap : public Heap {
     c.immortalHeapEnd = start + sizeInWords;
   }
 
+  virtual void setCollectorThreads(unsigned count UNUSED)
+  {
+#ifdef USE_ATOMIC_OPERATIONS
+    startCollectors(&c, count);
+#endif
+  }
+
+  virtual void setConcurrentMarking(bool enabled UNUSED)
+  {
+#ifdef USE_ATOMIC_OPERATIONS
+    if (enabled) {
+      startMarker(&c);
+    }
+#endif
+  }
+
+  virtual void setIncrementalMarking(unsigned pauseInMilliseconds)
+  {
+    c.incrementalPause = max(1u, pauseInMilliseconds);
+  }
+
+  virtual void setPauseTarget(unsigned milliseconds)
+  {
+    c.pauseTarget = static_cast<int64_t>(milliseconds) * 1000 * 1000;
+  }
+
+  virtual unsigned incomingBudget()
+  {
+    return c.incomingBudget * BytesPerWord;
+  }
+
+  virtual void allocated(unsigned sizeInBytes)
+  {
+    // a background marker, if any, already has the grey stack
+    if (c.incrementalPause and c.marker == 0) {
+      markIncrementally(&c, sizeInBytes);
+    }
+  }
+
+  virtual void setGen2Compaction(bool enabled)
+  {
+    c.compaction = enabled;
+  }
+
+  virtual void setLargePages(bool enabled)
+  {
+    assertT(&c, c.gen1.capacity() == 0 and c.gen2.capacity() == 0);
+    c.largePages = enabled;
+  }
+
   virtual unsigned remaining()
   {
     return c.limit - c.count;
@@ -1958,6 +4321,21 @@ class MyHeap : public Heap {
     return c.limit;
   }
 
+  virtual unsigned committed()
+  {
+    return c.count - releasedBytes(&c);
+  }
+
+  virtual unsigned unused()
+  {
+    return (c.gen2.remaining() * BytesPerWord) - releasedBytes(&c);
+  }
+
+  virtual const Statistics& statistics()
+  {
+    return c.statistics;
+  }
+
   virtual bool limitExceeded(int pendingAllocation = 0)
   {
     return local::limitExceeded(&c, pendingAllocation);
@@ -2015,6 +4393,16 @@ class MyHeap : public Heap {
                               unsigned sizeInWords,
                               bool objectMask)
   {
+    if (allocator == this and not objectMask
+        and sizeInWords * BytesPerWord >= LargeObjectThresholdInBytes) {
+      expect(&c, not limitExceeded());
+
+      void* p = allocateLarge(&c, sizeInWords);
+      if (p) {
+        return p;
+      }
+    }
+
     return allocateFixed(
         allocator, sizeInWords, objectMask, &(c.fixies), false);
   }
@@ -2026,6 +4414,24 @@ class MyHeap : public Heap {
     return allocateFixed(allocator, sizeInWords, objectMask, 0, true);
   }
 
+  virtual void* tryAllocateTenured(unsigned sizeInWords)
+  {
+    ACQUIRE(c.lock);
+
+    // leave room for whatever the next minor collection tenures so that
+    // pretenuring alone doesn't bring on a major collection
+    unsigned reserve = c.tenureFootprint + c.tenurePadding;
+    if (c.collectorCount > 1) {
+      reserve += parallelSlack(&c, reserve);
+    }
+
+    if (c.gen2.remaining() < sizeInWords + reserve) {
+      return 0;
+    }
+
+    return c.gen2.allocate(sizeInWords);
+  }
+
   bool needsMark(void* p)
   {
     assertT(&c, c.client->isFixed(p) or (not immortalHeapContains(&c, p)));
@@ -2046,6 +4452,21 @@ class MyHeap : public Heap {
                    and fixie(target)->age >= FixieTenureThreshold);
   }
 
+  virtual void* tryAllocateDirect(DirectCache* cache, size_t size)
+  {
+    return local::tryAllocateDirect(&c, cache, size);
+  }
+
+  virtual void freeDirect(DirectCache* cache, void* p)
+  {
+    local::freeDirect(&c, cache, p);
+  }
+
+  virtual void flushDirect(DirectCache* cache)
+  {
+    local::flushDirect(&c, cache);
+  }
+
   virtual void mark(void* p, unsigned offset, unsigned count)
   {
     if (needsMark(p)) {
@@ -2091,16 +4512,47 @@ class MyHeap : public Heap {
           map = &(c.nextHeapMap);
         }
 
+        // the card table above the per-word map covers a range of
+        // words, so when marking a range (e.g. after an array copy) we
+        // only go through it for the first dirty word in each card and
+        // mark the rest in the per-word map alone
+        Segment::Map* card = 0;
+        Segment::Map* word = map;
+        if (count > 1) {
+          while (word->child) {
+            card = word;
+            word = word->child;
+          }
+        }
+
+        unsigned lastCard = ~0u;
         for (unsigned i = 0; i < count; ++i) {
           void** target = static_cast<void**>(p) + offset + i;
           if (targetNeedsMark(maskAlignedPointer(*target))) {
+            Segment::Map* levels = word;
+            if (card) {
+              unsigned index = card->indexOf(target);
+              if (index != lastCard) {
+                lastCard = index;
+                levels = map;
+              }
+            }
+
 #ifdef USE_ATOMIC_OPERATIONS
-            map->markAtomic(target);
+            levels->markAtomic(target);
 #else
-            map->set(target);
+            levels->set(target);
 #endif
           }
         }
+
+        if (c.marking and map == &(c.heapMap)) {
+#ifdef USE_ATOMIC_OPERATIONS
+          markBitAtomic(c.rescanBits, c.gen2.indexOf(p));
+#else
+          markBit(c.rescanBits, c.gen2.indexOf(p));
+#endif
+        }
       }
     }
   }
@@ -2120,8 +4572,21 @@ class MyHeap : public Heap {
     }
   }
 
+  // finishes any copying which was deferred to worker threads so the
+  // client sees the same state it would after a serial visit
+  void drainPending()
+  {
+#ifdef USE_ATOMIC_OPERATIONS
+    if (c.parallel and not c.scanning and pending(&c)) {
+      drain(&c);
+    }
+#endif
+  }
+
   virtual void* follow(void* p)
   {
+    drainPending();
+
     if (p == 0 or c.client->isFixed(p)) {
       return p;
     } else if (wasCollected(&c, p)) {
@@ -2142,11 +4607,14 @@ class MyHeap : public Heap {
 
   virtual void postVisit()
   {
+    drainPending();
     killFixies(&c);
   }
 
   virtual Status status(void* p)
   {
+    drainPending();
+
     p = maskAlignedPointer(p);
 
     if (p == 0) {
@@ -2159,6 +4627,8 @@ class MyHeap : public Heap {
                                             : Tenured);
     } else if (c.nextGen1.contains(p)) {
       return Reachable;
+    } else if (c.compacting and c.gen2.contains(p)) {
+      return getBit(c.liveBits, c.gen2.indexOf(p)) ? Tenured : Unreachable;
     } else if (c.nextGen2.contains(p) or immortalHeapContains(&c, p)
                or (c.gen2.contains(p)
                    and (c.mode == Heap::MinorCollection
@@ -2183,6 +4653,11 @@ class MyHeap : public Heap {
 
   virtual void dispose()
   {
+#ifdef USE_ATOMIC_OPERATIONS
+    stopMarker(&c);
+    stopCollectors(&c);
+#endif
+    disposeDirect(&c);
     c.dispose();
     assertT(&c, c.count == 0);
     c.system->free(this);
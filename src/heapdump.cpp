@@ -19,25 +19,145 @@ namespace local {
 
 enum { Root, Size, ClassName, Push, Pop };
 
-void write1(FILE* out, uint8_t v)
+const unsigned BufferSize = 1024 * 1024;
+
+// see "HPROF Binary Dump Format" in the OpenJDK demo/jvmti/hprof
+// sources for the meaning of these
+enum {
+  HprofString = 0x01,
+  HprofLoadClass = 0x02,
+  HprofStackTrace = 0x05,
+  HprofHeapDumpSegment = 0x1C,
+  HprofHeapDumpEnd = 0x2C
+};
+
+enum {
+  HprofRootUnknown = 0xFF,
+  HprofClassDump = 0x20,
+  HprofInstanceDump = 0x21,
+  HprofObjectArrayDump = 0x22,
+  HprofPrimitiveArrayDump = 0x23
+};
+
+enum {
+  HprofObject = 2,
+  HprofBoolean = 4,
+  HprofChar = 5,
+  HprofFloat = 6,
+  HprofDouble = 7,
+  HprofByte = 8,
+  HprofShort = 9,
+  HprofInt = 10,
+  HprofLong = 11
+};
+
+const unsigned HprofStackTraceSerial = 1;
+
+const unsigned HprofRecordHeaderSize = 9;
+
+const unsigned ClassBucketCount = 4096;
+
+const unsigned MaxFixedSize = 65536;
+
+// Collects writes in a large buffer so a dump costs a few big
+// fwrite calls rather than one per field.
+class Output {
+ public:
+  Output(Thread* t, FILE* out)
+      : t(t),
+        out(out),
+        buffer(static_cast<uint8_t*>(t->m->heap->allocate(BufferSize))),
+        position(0)
+  {
+  }
+
+  void write(const void* data, unsigned size)
+  {
+    if (position + size > BufferSize) {
+      flush();
+    }
+
+    if (size > BufferSize) {
+      size_t n UNUSED = fwrite(data, size, 1, out);
+    } else {
+      memcpy(buffer + position, data, size);
+      position += size;
+    }
+  }
+
+  void flush()
+  {
+    if (position) {
+      size_t n UNUSED = fwrite(buffer, position, 1, out);
+      position = 0;
+    }
+  }
+
+  void dispose()
+  {
+    flush();
+    t->m->heap->free(buffer, BufferSize);
+  }
+
+  Thread* t;
+  FILE* out;
+  uint8_t* buffer;
+  unsigned position;
+};
+
+inline uint8_t* put1(uint8_t* p, uint8_t v)
+{
+  *p = v;
+  return p + 1;
+}
+
+inline uint8_t* put2(uint8_t* p, uint16_t v)
+{
+  p[0] = v >> 8;
+  p[1] = v;
+  return p + 2;
+}
+
+inline uint8_t* put4(uint8_t* p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+  return p + 4;
+}
+
+inline uint8_t* put8(uint8_t* p, uint64_t v)
+{
+  return put4(put4(p, v >> 32), v);
+}
+
+inline uint8_t* putId(uint8_t* p, uintptr_t v)
 {
-  size_t n UNUSED = fwrite(&v, 1, 1, out);
+  return BytesPerWord == 8 ? put8(p, v) : put4(p, v);
 }
 
-void write4(FILE* out, uint32_t v)
+inline uintptr_t id(object o)
 {
-  uint8_t b[] = {static_cast<uint8_t>(v >> 24),
-                 static_cast<uint8_t>((v >> 16) & 0xFF),
-                 static_cast<uint8_t>((v >> 8) & 0xFF),
-                 static_cast<uint8_t>(v & 0xFF)};
+  return reinterpret_cast<uintptr_t>(o);
+}
 
-  size_t n UNUSED = fwrite(b, 4, 1, out);
+void write1(Output* out, uint8_t v)
+{
+  out->write(&v, 1);
 }
 
-void writeString(FILE* out, int8_t* p, unsigned size)
+void write4(Output* out, uint32_t v)
+{
+  uint8_t b[4];
+  put4(b, v);
+  out->write(b, 4);
+}
+
+void writeString(Output* out, int8_t* p, unsigned size)
 {
   write4(out, size);
-  size_t n UNUSED = fwrite(p, size, 1, out);
+  out->write(p, size);
 }
 
 unsigned objectSize(Thread* t, object o)
@@ -45,6 +165,698 @@ unsigned objectSize(Thread* t, object o)
   return extendedSize(t, o, baseSize(t, o, objectClass(t, o)));
 }
 
+bool isArrayClass(GcClass* c)
+{
+  return c->arrayElementSize() and c->name() and c->name()->body()[0] == '[';
+}
+
+class FieldInfo {
+ public:
+  uintptr_t name;
+  unsigned offset;
+  uint8_t type;
+  uint8_t size;
+};
+
+// The HPROF view of a class: the instance fields it declares itself,
+// in the order their values appear in an INSTANCE_DUMP.
+class ClassInfo {
+ public:
+  ClassInfo(ClassInfo* next,
+            GcClass* class_,
+            ClassInfo* super,
+            unsigned fieldCount,
+            unsigned valueSize)
+      : next(next),
+        class_(class_),
+        super(super),
+        serial(0),
+        fieldCount(fieldCount),
+        valueSize(valueSize)
+  {
+  }
+
+  FieldInfo* fields()
+  {
+    return reinterpret_cast<FieldInfo*>(this + 1);
+  }
+
+  ClassInfo* next;
+  GcClass* class_;
+  ClassInfo* super;
+  // zero until the class has been dumped
+  unsigned serial;
+  unsigned fieldCount;
+  // the size of this class's field values plus those of its
+  // superclasses
+  unsigned valueSize;
+};
+
+uint8_t hprofType(Thread* t, unsigned code)
+{
+  switch (code) {
+  case ByteField:
+    return HprofByte;
+  case BooleanField:
+    return HprofBoolean;
+  case CharField:
+    return HprofChar;
+  case ShortField:
+    return HprofShort;
+  case FloatField:
+    return HprofFloat;
+  case IntField:
+    return HprofInt;
+  case DoubleField:
+    return HprofDouble;
+  case LongField:
+    return HprofLong;
+  case ObjectField:
+    return HprofObject;
+  default:
+    abort(t);
+  }
+}
+
+unsigned hprofArrayType(int8_t spec)
+{
+  switch (spec) {
+  case 'Z':
+    return HprofBoolean;
+  case 'B':
+    return HprofByte;
+  case 'C':
+    return HprofChar;
+  case 'S':
+    return HprofShort;
+  case 'I':
+    return HprofInt;
+  case 'F':
+    return HprofFloat;
+  case 'J':
+    return HprofLong;
+  case 'D':
+    return HprofDouble;
+  default:
+    return HprofObject;
+  }
+}
+
+unsigned syntheticName(unsigned offset)
+{
+  // real names are addressed by the byte arrays holding them, which
+  // never live this low
+  return offset + 1;
+}
+
+unsigned valueSize(uint8_t type)
+{
+  switch (type) {
+  case HprofObject:
+    return BytesPerWord;
+  case HprofBoolean:
+  case HprofByte:
+    return 1;
+  case HprofChar:
+  case HprofShort:
+    return 2;
+  case HprofFloat:
+  case HprofInt:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+// Writes a heap dump in the binary HPROF format read by jhat, Eclipse
+// MAT, VisualVM and friends.  Object IDs are addresses, which is only
+// safe because the caller holds the VM in the exclusive state for the
+// duration.
+class HprofVisitor : public HeapVisitor {
+ public:
+  HprofVisitor(Thread* t, Output* out)
+      : t(t),
+        out(out),
+        segment(static_cast<uint8_t*>(t->m->heap->allocate(BufferSize))),
+        position(0),
+        direct(false),
+        nextSerial(1),
+        root_(false)
+  {
+    memset(buckets, 0, sizeof(buckets));
+    memset(syntheticNames, 0, sizeof(syntheticNames));
+  }
+
+  // top-level records
+
+  void writeRecordHeader(uint8_t tag, unsigned length)
+  {
+    uint8_t b[HprofRecordHeaderSize];
+    put4(put4(put1(b, tag), 0), length);
+    out->write(b, HprofRecordHeaderSize);
+  }
+
+  void writeString(uintptr_t id, const void* data, unsigned size)
+  {
+    endSegment();
+
+    uint8_t b[BytesPerWord];
+    writeRecordHeader(HprofString, BytesPerWord + size);
+    putId(b, id);
+    out->write(b, BytesPerWord);
+    out->write(data, size);
+  }
+
+  void writeName(GcByteArray* name)
+  {
+    writeString(id(name), name->body().begin(), name->length() - 1);
+  }
+
+  void writeHeader()
+  {
+    const char magic[] = "JAVA PROFILE 1.0.2";
+    out->write(magic, sizeof(magic));
+
+    uint8_t b[12];
+    put8(put4(b, BytesPerWord), t->m->system->now());
+    out->write(b, 12);
+
+    // everything in the dump refers to this empty trace
+    writeRecordHeader(HprofStackTrace, 12);
+    put4(put4(put4(b, HprofStackTraceSerial), 0), 0);
+    out->write(b, 12);
+  }
+
+  void writeTrailer()
+  {
+    endSegment();
+    writeRecordHeader(HprofHeapDumpEnd, 0);
+  }
+
+  // heap dump sub-records, gathered into HEAP_DUMP_SEGMENT records
+
+  // Makes room in the current segment for a sub-record of the
+  // specified size, which must be written completely before the next
+  // call.  Records too big to buffer get a segment of their own and go
+  // straight to the output.
+  void begin(unsigned size)
+  {
+    if (position + size > BufferSize) {
+      endSegment();
+    }
+
+    direct = size > BufferSize;
+    if (direct) {
+      writeRecordHeader(HprofHeapDumpSegment, size);
+    }
+  }
+
+  void put(const void* data, unsigned size)
+  {
+    if (direct) {
+      out->write(data, size);
+    } else {
+      memcpy(segment + position, data, size);
+      position += size;
+    }
+  }
+
+  void endSegment()
+  {
+    if (position) {
+      writeRecordHeader(HprofHeapDumpSegment, position);
+      out->write(segment, position);
+      position = 0;
+    }
+  }
+
+  // classes
+
+  unsigned countFields(GcClass* c, FieldInfo* fields)
+  {
+    unsigned count = 0;
+    object table = c->fieldTable();
+    if (table) {
+      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+        GcField* field = cast<GcField>(t, objectArrayBody(t, table, i));
+        if ((field->flags() & ACC_STATIC) == 0) {
+          if (fields) {
+            FieldInfo* f = fields + count;
+            f->name = id(field->name());
+            f->offset = field->offset();
+            f->type = hprofType(t, field->code());
+            f->size = valueSize(f->type);
+          }
+          ++count;
+        }
+      }
+    } else if (not isArrayClass(c)) {
+      // VM-internal types have no field table, so describe their
+      // fixed part using the object mask to tell references from
+      // other words
+      GcIntArray* mask = c->objectMask();
+      unsigned offset = c->super() ? c->super()->fixedSize() : BytesPerWord;
+      while (offset < c->fixedSize()) {
+        uint8_t type;
+        if (offset % BytesPerWord == 0
+            and offset + BytesPerWord <= c->fixedSize()) {
+          unsigned index = offset / BytesPerWord;
+          if (mask and (mask->body()[index / 32] & (1 << (index % 32)))) {
+            type = HprofObject;
+          } else {
+            type = BytesPerWord == 8 ? HprofLong : HprofInt;
+          }
+        } else {
+          type = HprofByte;
+        }
+
+        if (fields) {
+          FieldInfo* f = fields + count;
+          f->name = syntheticName(offset);
+          f->offset = offset;
+          f->type = type;
+          f->size = valueSize(type);
+        }
+        ++count;
+
+        offset += valueSize(type);
+      }
+    }
+
+    return count;
+  }
+
+  void writeFieldNames(ClassInfo* info)
+  {
+    for (unsigned i = 0; i < info->fieldCount; ++i) {
+      FieldInfo* f = info->fields() + i;
+      if (f->name < MaxFixedSize + 1) {
+        if (not syntheticNames[f->offset]) {
+          syntheticNames[f->offset] = true;
+
+          char name[16];
+          int length = vm::snprintf(name, sizeof(name), "@%u", f->offset);
+          writeString(f->name, name, length);
+        }
+      } else {
+        writeString(f->name,
+                    reinterpret_cast<GcByteArray*>(f->name)->body().begin(),
+                    reinterpret_cast<GcByteArray*>(f->name)->length() - 1);
+      }
+    }
+  }
+
+  ClassInfo* classInfo(GcClass* c)
+  {
+    ClassInfo** bucket = buckets + ((id(c) >> 3) & (ClassBucketCount - 1));
+    for (ClassInfo* info = *bucket; info; info = info->next) {
+      if (info->class_ == c) {
+        return info;
+      }
+    }
+
+    ClassInfo* super = c->super() ? classInfo(c->super()) : 0;
+
+    unsigned count = countFields(c, 0);
+    ClassInfo* info = new (t->m->heap->allocate(sizeof(ClassInfo)
+                                                 + count * sizeof(FieldInfo)))
+        ClassInfo(*bucket, c, super, count, super ? super->valueSize : 0);
+    countFields(c, info->fields());
+
+    for (unsigned i = 0; i < count; ++i) {
+      info->valueSize += info->fields()[i].size;
+    }
+
+    writeFieldNames(info);
+
+    *bucket = info;
+    return info;
+  }
+
+  uint8_t* putValue(uint8_t* p, object o, FieldInfo* f)
+  {
+    switch (f->size) {
+    case 1:
+      return put1(p, fieldAtOffset<uint8_t>(o, f->offset));
+    case 2:
+      return put2(p, fieldAtOffset<uint16_t>(o, f->offset));
+    case 4:
+      if (f->type == HprofObject) {
+        return putId(p, id(get(o, f->offset)));
+      }
+      return put4(p, fieldAtOffset<uint32_t>(o, f->offset));
+    default:
+      if (f->type == HprofObject) {
+        return putId(p, id(get(o, f->offset)));
+      }
+      uint64_t v;
+      memcpy(&v, &fieldAtOffset<uint8_t>(o, f->offset), 8);
+      return put8(p, v);
+    }
+  }
+
+  object get(object o, unsigned offset)
+  {
+    return static_cast<object>(
+        maskAlignedPointer(fieldAtOffset<void*>(o, offset)));
+  }
+
+  ClassInfo* dumpClass(GcClass* c)
+  {
+    ClassInfo* info = classInfo(c);
+    if (info->serial) {
+      return info;
+    }
+
+    info->serial = nextSerial++;
+
+    if (info->super) {
+      dumpClass(info->super->class_);
+    }
+
+    uintptr_t name;
+    if (c->name()) {
+      writeName(c->name());
+      name = id(c->name());
+    } else {
+      char buffer[64];
+      int length = vm::snprintf(
+          buffer, sizeof(buffer), "avian/Anonymous$%" LX, id(c));
+      writeString(id(c), buffer, length);
+      name = id(c);
+    }
+
+    uint8_t b[4 + BytesPerWord + 4 + BytesPerWord];
+    writeRecordHeader(HprofLoadClass, sizeof(b));
+    putId(put4(putId(put4(b, info->serial), id(c)), HprofStackTraceSerial),
+          name);
+    out->write(b, sizeof(b));
+
+    // statics come from the static table, and the references the VM
+    // keeps in the class itself are included too so that what they
+    // point to stays reachable in the dump
+    ClassInfo* vmClass = c == type(t, GcClass::Type)
+                             ? info
+                             : classInfo(type(t, GcClass::Type));
+
+    unsigned staticCount = 0;
+    unsigned staticSize = 0;
+    object table = c->fieldTable();
+    if (table) {
+      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+        GcField* field = cast<GcField>(t, objectArrayBody(t, table, i));
+        if (field->flags() & ACC_STATIC) {
+          writeName(field->name());
+          ++staticCount;
+          staticSize += valueSize(hprofType(t, field->code()));
+        }
+      }
+    }
+
+    for (ClassInfo* i = vmClass; i; i = i->super) {
+      for (unsigned j = 0; j < i->fieldCount; ++j) {
+        if (i->fields()[j].type == HprofObject) {
+          ++staticCount;
+          staticSize += BytesPerWord;
+        }
+      }
+    }
+
+    unsigned size = 1 + BytesPerWord + 4 + (BytesPerWord * 6) + 4 + 2 + 2
+                    + (staticCount * (BytesPerWord + 1)) + staticSize + 2
+                    + (info->fieldCount * (BytesPerWord + 1));
+
+    begin(size);
+
+    uint8_t header[1 + BytesPerWord + 4 + (BytesPerWord * 6) + 4 + 2 + 2];
+    uint8_t* p = put1(header, HprofClassDump);
+    p = putId(p, id(c));
+    p = put4(p, HprofStackTraceSerial);
+    p = putId(p, id(c->super()));
+    p = putId(p, id(c->loader()));
+    for (unsigned i = 0; i < 4; ++i) {
+      // signers, protection domain, and two reserved IDs
+      p = putId(p, 0);
+    }
+    p = put4(p, isArrayClass(c) ? 0 : c->fixedSize());
+    p = put2(p, 0);
+    p = put2(p, staticCount);
+    put(header, p - header);
+
+    if (table) {
+      for (unsigned i = 0; i < objectArrayLength(t, table); ++i) {
+        GcField* field = cast<GcField>(t, objectArrayBody(t, table, i));
+        if (field->flags() & ACC_STATIC) {
+          FieldInfo f;
+          f.name = id(field->name());
+          f.offset = field->offset();
+          f.type = hprofType(t, field->code());
+          f.size = valueSize(f.type);
+
+          uint8_t v[BytesPerWord + 1 + 8];
+          uint8_t* q = put1(putId(v, f.name), f.type);
+          if (c->staticTable()) {
+            q = putValue(q, c->staticTable(), &f);
+          } else {
+            memset(q, 0, f.size);
+            q += f.size;
+          }
+          put(v, q - v);
+        }
+      }
+    }
+
+    for (ClassInfo* i = vmClass; i; i = i->super) {
+      for (unsigned j = 0; j < i->fieldCount; ++j) {
+        FieldInfo* f = i->fields() + j;
+        if (f->type == HprofObject) {
+          uint8_t v[BytesPerWord + 1 + BytesPerWord];
+          put(v, putValue(put1(putId(v, f->name), f->type), c, f) - v);
+        }
+      }
+    }
+
+    uint8_t b2[BytesPerWord + 1];
+    put(b2, put2(b2, info->fieldCount) - b2);
+    for (unsigned i = 0; i < info->fieldCount; ++i) {
+      FieldInfo* f = info->fields() + i;
+      put(b2, put1(putId(b2, f->name), f->type) - b2);
+    }
+
+    return info;
+  }
+
+  // objects
+
+  void dumpInstance(object o, ClassInfo* info)
+  {
+    begin(1 + BytesPerWord + 4 + BytesPerWord + 4 + info->valueSize);
+
+    uint8_t b[1 + BytesPerWord + 4 + BytesPerWord + 4];
+    uint8_t* p = put1(b, HprofInstanceDump);
+    p = putId(p, id(o));
+    p = put4(p, HprofStackTraceSerial);
+    p = putId(p, id(info->class_));
+    p = put4(p, info->valueSize);
+    put(b, p - b);
+
+    for (; info; info = info->super) {
+      for (unsigned i = 0; i < info->fieldCount; ++i) {
+        uint8_t v[8];
+        put(v, putValue(v, o, info->fields() + i) - v);
+      }
+    }
+  }
+
+  void dumpArray(object o, GcClass* c)
+  {
+    unsigned length = fieldAtOffset<uintptr_t>(o, c->fixedSize() - BytesPerWord);
+    unsigned type = hprofArrayType(c->name()->body()[1]);
+    uint8_t* body = &fieldAtOffset<uint8_t>(o, c->fixedSize());
+
+    if (type == HprofObject) {
+      begin(1 + BytesPerWord + 4 + 4 + BytesPerWord + length * BytesPerWord);
+
+      uint8_t b[1 + BytesPerWord + 4 + 4 + BytesPerWord];
+      uint8_t* p = put1(b, HprofObjectArrayDump);
+      p = putId(p, id(o));
+      p = put4(p, HprofStackTraceSerial);
+      p = put4(p, length);
+      p = putId(p, id(c));
+      put(b, p - b);
+
+      for (unsigned i = 0; i < length; ++i) {
+        uint8_t v[BytesPerWord];
+        put(v, putId(v, id(get(o, c->fixedSize() + i * BytesPerWord))) - v);
+      }
+    } else {
+      unsigned size = valueSize(type);
+      begin(1 + BytesPerWord + 4 + 4 + 1 + length * size);
+
+      uint8_t b[1 + BytesPerWord + 4 + 4 + 1];
+      uint8_t* p = put1(b, HprofPrimitiveArrayDump);
+      p = putId(p, id(o));
+      p = put4(p, HprofStackTraceSerial);
+      p = put4(p, length);
+      p = put1(p, type);
+      put(b, p - b);
+
+      if (size == 1) {
+        put(body, length);
+      } else {
+        // swap to big-endian a chunk at a time
+        const unsigned ChunkSize = 4096;
+        uint8_t chunk[ChunkSize];
+        unsigned perChunk = ChunkSize / size;
+        for (unsigned i = 0; i < length; i += perChunk) {
+          unsigned n = length - i < perChunk ? length - i : perChunk;
+          uint8_t* q = chunk;
+          for (unsigned j = 0; j < n; ++j) {
+            uint8_t* e = body + (i + j) * size;
+            switch (size) {
+            case 2: {
+              uint16_t v;
+              memcpy(&v, e, 2);
+              q = put2(q, v);
+            } break;
+            case 4: {
+              uint32_t v;
+              memcpy(&v, e, 4);
+              q = put4(q, v);
+            } break;
+            default: {
+              uint64_t v;
+              memcpy(&v, e, 8);
+              q = put8(q, v);
+            } break;
+            }
+          }
+          put(chunk, q - chunk);
+        }
+      }
+    }
+  }
+
+  void dumpRoot(object o)
+  {
+    begin(1 + BytesPerWord);
+
+    uint8_t b[1 + BytesPerWord];
+    put(b, putId(put1(b, HprofRootUnknown), id(o)) - b);
+  }
+
+  // HeapVisitor
+
+  virtual void root()
+  {
+    root_ = true;
+  }
+
+  virtual unsigned visitNew(object p)
+  {
+    if (p) {
+      GcClass* c = objectClass(t, p);
+      if (c == type(t, GcClass::Type)) {
+        dumpClass(static_cast<GcClass*>(p));
+      } else {
+        ClassInfo* info = dumpClass(c);
+        if (isArrayClass(c)) {
+          dumpArray(p, c);
+        } else {
+          dumpInstance(p, info);
+        }
+      }
+
+      visitOld(p, 0);
+    }
+
+    return 1;
+  }
+
+  virtual void visitOld(object p, unsigned)
+  {
+    if (root_) {
+      root_ = false;
+      if (p) {
+        dumpRoot(p);
+      }
+    }
+  }
+
+  virtual void push(object parent, unsigned, unsigned offset)
+  {
+    // a reference the dump can't express as a field or array element
+    // (e.g. one in the body of a VM-internal type) makes its target a
+    // root instead, so it isn't lost to the analyser
+    if (offset) {
+      GcClass* c = objectClass(t, parent);
+      if (c == type(t, GcClass::Type)) {
+        root_ = offset * BytesPerWord >= c->fixedSize();
+      } else if (not isArrayClass(c)) {
+        root_ = true;
+        for (ClassInfo* info = classInfo(c); info and root_;
+             info = info->super) {
+          for (unsigned i = 0; i < info->fieldCount; ++i) {
+            FieldInfo* f = info->fields() + i;
+            if (f->type == HprofObject and f->offset == offset * BytesPerWord) {
+              root_ = false;
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  virtual void pop()
+  {
+  }
+
+  void dispose()
+  {
+    for (unsigned i = 0; i < ClassBucketCount; ++i) {
+      for (ClassInfo* info = buckets[i]; info;) {
+        ClassInfo* next = info->next;
+        t->m->heap->free(info,
+                         sizeof(ClassInfo) + info->fieldCount * sizeof(FieldInfo));
+        info = next;
+      }
+    }
+
+    t->m->heap->free(segment, BufferSize);
+  }
+
+  Thread* t;
+  Output* out;
+  uint8_t* segment;
+  unsigned position;
+  bool direct;
+  unsigned nextSerial;
+  bool root_;
+  ClassInfo* buckets[ClassBucketCount];
+  bool syntheticNames[MaxFixedSize];
+};
+
+class HistogramEntry {
+ public:
+  HistogramEntry(HistogramEntry* next, GcClass* class_)
+      : next(next), class_(class_), count(0), size(0)
+  {
+  }
+
+  HistogramEntry* next;
+  GcClass* class_;
+  unsigned count;
+  uint64_t size;
+};
+
+int compareHistogramEntries(const void* a, const void* b)
+{
+  uint64_t sa = (*static_cast<HistogramEntry* const*>(a))->size;
+  uint64_t sb = (*static_cast<HistogramEntry* const*>(b))->size;
+  return sa > sb ? -1 : (sa < sb ? 1 : 0);
+}
+
 }  // namespace local
 
 }  // namespace
@@ -55,13 +867,13 @@ void dumpHeap(Thread* t, FILE* out)
 {
   class Visitor : public HeapVisitor {
    public:
-    Visitor(Thread* t, FILE* out) : t(t), out(out), nextNumber(1)
+    Visitor(Thread* t, local::Output* out) : t(t), out(out), nextNumber(1)
     {
     }
 
     virtual void root()
     {
-      write1(out, local::Root);
+      local::write1(out, local::Root);
     }
 
     virtual unsigned visitNew(object p)
@@ -103,13 +915,137 @@ void dumpHeap(Thread* t, FILE* out)
     }
 
     Thread* t;
-    FILE* out;
+    local::Output* out;
     unsigned nextNumber;
-  } visitor(t, out);
+  };
+
+  local::Output output(t, out);
+  Visitor visitor(t, &output);
 
   HeapWalker* w = makeHeapWalker(t, &visitor);
   w->visitAllRoots();
   w->dispose();
+
+  output.dispose();
+}
+
+void dumpHeapHprof(Thread* t, FILE* out)
+{
+  local::Output output(t, out);
+  local::HprofVisitor* visitor
+      = new (t->m->heap->allocate(sizeof(local::HprofVisitor)))
+          local::HprofVisitor(t, &output);
+
+  visitor->writeHeader();
+
+  HeapWalker* w = makeHeapWalker(t, visitor);
+  w->visitAllRoots();
+  w->dispose();
+
+  visitor->writeTrailer();
+  visitor->dispose();
+  t->m->heap->free(visitor, sizeof(local::HprofVisitor));
+
+  output.dispose();
+}
+
+void dumpClassHistogram(Thread* t, FILE* out)
+{
+  class Visitor : public HeapVisitor {
+   public:
+    Visitor(Thread* t) : t(t), count(0)
+    {
+      memset(buckets, 0, sizeof(buckets));
+    }
+
+    virtual void root()
+    {
+    }
+
+    virtual unsigned visitNew(object p)
+    {
+      if (p) {
+        GcClass* c = objectClass(t, p);
+        local::HistogramEntry** bucket
+            = buckets + ((local::id(c) >> 3) & (local::ClassBucketCount - 1));
+
+        local::HistogramEntry* e = *bucket;
+        while (e and e->class_ != c) {
+          e = e->next;
+        }
+
+        if (e == 0) {
+          e = new (t->m->heap->allocate(sizeof(local::HistogramEntry)))
+              local::HistogramEntry(*bucket, c);
+          *bucket = e;
+          ++count;
+        }
+
+        ++e->count;
+        e->size += local::objectSize(t, p) * BytesPerWord;
+      }
+
+      return 1;
+    }
+
+    virtual void visitOld(object, unsigned)
+    {
+    }
+
+    virtual void push(object, unsigned, unsigned)
+    {
+    }
+
+    virtual void pop()
+    {
+    }
+
+    Thread* t;
+    unsigned count;
+    local::HistogramEntry* buckets[local::ClassBucketCount];
+  };
+
+  Visitor* visitor = new (t->m->heap->allocate(sizeof(Visitor))) Visitor(t);
+
+  HeapWalker* w = makeHeapWalker(t, visitor);
+  w->visitAllRoots();
+  w->dispose();
+
+  local::HistogramEntry** entries = static_cast<local::HistogramEntry**>(
+      t->m->heap->allocate(visitor->count * sizeof(local::HistogramEntry*)));
+
+  unsigned index = 0;
+  for (unsigned i = 0; i < local::ClassBucketCount; ++i) {
+    for (local::HistogramEntry* e = visitor->buckets[i]; e; e = e->next) {
+      entries[index++] = e;
+    }
+  }
+
+  qsort(entries,
+        visitor->count,
+        sizeof(local::HistogramEntry*),
+        local::compareHistogramEntries);
+
+  for (unsigned i = 0; i < visitor->count; ++i) {
+    local::HistogramEntry* e = entries[i];
+    fprintf(out, "%" LLD " %u ", static_cast<int64_t>(e->size), e->count);
+
+    GcByteArray* name = e->class_->name();
+    if (name) {
+      for (unsigned j = 0; j < name->length() - 1; ++j) {
+        int8_t c = name->body()[j];
+        fputc(c == '/' ? '.' : c, out);
+      }
+      fputc('\n', out);
+    } else {
+      fprintf(out, "(anonymous)\n");
+    }
+
+    t->m->heap->free(e, sizeof(local::HistogramEntry));
+  }
+
+  t->m->heap->free(entries, visitor->count * sizeof(local::HistogramEntry*));
+  t->m->heap->free(visitor, sizeof(Visitor));
 }
 
 }  // namespace vm
@@ -11,6 +11,7 @@
 #include "avian/common.h"
 #include <avian/system/system.h>
 #include <avian/system/signal.h>
+#include <avian/system/memory.h>
 #include "avian/constants.h"
 #include "avian/machine.h"
 #include "avian/processor.h"
@@ -32,6 +33,14 @@ const unsigned FrameMethodOffset = 2;
 const unsigned FrameIpOffset = 3;
 const unsigned FrameFootprint = 4;
 
+// When set, the interpreter counts how often each instruction (as
+// executed, i.e. after quickening) directly follows another in the same
+// method, and prints the most frequent pairs when the VM exits.  This is
+// how the sequences fused into superinstructions were chosen.
+const bool ProfileInstructionPairs = false;
+
+const unsigned ProfiledPairCount = 32;
+
 class Thread : public vm::Thread {
  public:
   Thread(Machine* m, GcThread* javaThread, vm::Thread* parent)
@@ -52,103 +61,157 @@ class Thread : public vm::Thread {
   uintptr_t stack[0];
 };
 
-inline void pushObject(Thread* t, object o)
+// These take the stack pointer explicitly so that interpret3 can keep
+// it in a local variable; the overloads below which don't use the one
+// in the thread.
+
+inline void pushObject(Thread* t, unsigned& sp, object o)
 {
   if (DebugStack) {
-    fprintf(stderr, "push object %p at %d\n", o, t->sp);
+    fprintf(stderr, "push object %p at %d\n", o, sp);
   }
 
-  assertT(t, t->sp + 1 < stackSizeInWords(t) / 2);
-  t->stack[(t->sp * 2)] = ObjectTag;
-  t->stack[(t->sp * 2) + 1] = reinterpret_cast<uintptr_t>(o);
-  ++t->sp;
+  assertT(t, sp + 1 < stackSizeInWords(t) / 2);
+  t->stack[(sp * 2)] = ObjectTag;
+  t->stack[(sp * 2) + 1] = reinterpret_cast<uintptr_t>(o);
+  ++sp;
 }
 
-inline void pushInt(Thread* t, uint32_t v)
+inline void pushInt(Thread* t, unsigned& sp, uint32_t v)
 {
   if (DebugStack) {
-    fprintf(stderr, "push int %d at %d\n", v, t->sp);
+    fprintf(stderr, "push int %d at %d\n", v, sp);
   }
 
-  assertT(t, t->sp + 1 < stackSizeInWords(t) / 2);
-  t->stack[(t->sp * 2)] = IntTag;
-  t->stack[(t->sp * 2) + 1] = v;
-  ++t->sp;
+  assertT(t, sp + 1 < stackSizeInWords(t) / 2);
+  t->stack[(sp * 2)] = IntTag;
+  t->stack[(sp * 2) + 1] = v;
+  ++sp;
 }
 
-inline void pushFloat(Thread* t, float v)
+inline void pushFloat(Thread* t, unsigned& sp, float v)
 {
-  pushInt(t, floatToBits(v));
+  pushInt(t, sp, floatToBits(v));
 }
 
-inline void pushLong(Thread* t, uint64_t v)
+inline void pushLong(Thread* t, unsigned& sp, uint64_t v)
 {
   if (DebugStack) {
-    fprintf(stderr, "push long %" LLD " at %d\n", v, t->sp);
+    fprintf(stderr, "push long %" LLD " at %d\n", v, sp);
   }
 
-  pushInt(t, v >> 32);
-  pushInt(t, v & 0xFFFFFFFF);
+  pushInt(t, sp, v >> 32);
+  pushInt(t, sp, v & 0xFFFFFFFF);
 }
 
-inline void pushDouble(Thread* t, double v)
+inline void pushDouble(Thread* t, unsigned& sp, double v)
 {
   uint64_t w = doubleToBits(v);
-  pushLong(t, w);
+  pushLong(t, sp, w);
 }
 
-inline object popObject(Thread* t)
+inline object popObject(Thread* t, unsigned& sp)
 {
   if (DebugStack) {
     fprintf(stderr,
             "pop object %p at %d\n",
-            reinterpret_cast<object>(t->stack[((t->sp - 1) * 2) + 1]),
-            t->sp - 1);
+            reinterpret_cast<object>(t->stack[((sp - 1) * 2) + 1]),
+            sp - 1);
   }
 
-  assertT(t, t->stack[(t->sp - 1) * 2] == ObjectTag);
-  return reinterpret_cast<object>(t->stack[((--t->sp) * 2) + 1]);
+  assertT(t, t->stack[(sp - 1) * 2] == ObjectTag);
+  return reinterpret_cast<object>(t->stack[((--sp) * 2) + 1]);
 }
 
-inline uint32_t popInt(Thread* t)
+inline uint32_t popInt(Thread* t, unsigned& sp)
 {
   if (DebugStack) {
     fprintf(stderr,
             "pop int %" LD " at %d\n",
-            t->stack[((t->sp - 1) * 2) + 1],
-            t->sp - 1);
+            t->stack[((sp - 1) * 2) + 1],
+            sp - 1);
   }
 
-  assertT(t, t->stack[(t->sp - 1) * 2] == IntTag);
-  return t->stack[((--t->sp) * 2) + 1];
+  assertT(t, t->stack[(sp - 1) * 2] == IntTag);
+  return t->stack[((--sp) * 2) + 1];
 }
 
-inline float popFloat(Thread* t)
+inline float popFloat(Thread* t, unsigned& sp)
 {
-  return bitsToFloat(popInt(t));
+  return bitsToFloat(popInt(t, sp));
 }
 
-inline uint64_t popLong(Thread* t)
+inline uint64_t popLong(Thread* t, unsigned& sp)
 {
   if (DebugStack) {
     fprintf(stderr,
             "pop long %" LLD " at %d\n",
-            (static_cast<uint64_t>(t->stack[((t->sp - 2) * 2) + 1]) << 32)
-            | static_cast<uint64_t>(t->stack[((t->sp - 1) * 2) + 1]),
-            t->sp - 2);
+            (static_cast<uint64_t>(t->stack[((sp - 2) * 2) + 1]) << 32)
+            | static_cast<uint64_t>(t->stack[((sp - 1) * 2) + 1]),
+            sp - 2);
   }
 
-  uint64_t a = popInt(t);
-  uint64_t b = popInt(t);
+  uint64_t a = popInt(t, sp);
+  uint64_t b = popInt(t, sp);
   return (b << 32) | a;
 }
 
-inline double popDouble(Thread* t)
+inline double popDouble(Thread* t, unsigned& sp)
 {
-  uint64_t v = popLong(t);
+  uint64_t v = popLong(t, sp);
   return bitsToDouble(v);
 }
 
+inline void pushObject(Thread* t, object o)
+{
+  pushObject(t, t->sp, o);
+}
+
+inline void pushInt(Thread* t, uint32_t v)
+{
+  pushInt(t, t->sp, v);
+}
+
+inline void pushFloat(Thread* t, float v)
+{
+  pushFloat(t, t->sp, v);
+}
+
+inline void pushLong(Thread* t, uint64_t v)
+{
+  pushLong(t, t->sp, v);
+}
+
+inline void pushDouble(Thread* t, double v)
+{
+  pushDouble(t, t->sp, v);
+}
+
+inline object popObject(Thread* t)
+{
+  return popObject(t, t->sp);
+}
+
+inline uint32_t popInt(Thread* t)
+{
+  return popInt(t, t->sp);
+}
+
+inline float popFloat(Thread* t)
+{
+  return popFloat(t, t->sp);
+}
+
+inline uint64_t popLong(Thread* t)
+{
+  return popLong(t, t->sp);
+}
+
+inline double popDouble(Thread* t)
+{
+  return popDouble(t, t->sp);
+}
+
 inline object peekObject(Thread* t, unsigned index)
 {
   if (DebugStack) {
@@ -250,34 +313,76 @@ inline unsigned frameBase(Thread* t, int frame)
   return peekInt(t, frame + FrameBaseOffset);
 }
 
+// As with the stack, the local accessors can be given the base of the
+// current frame's locals or find it themselves.
+
+inline object localObject(Thread* t, unsigned base, unsigned index)
+{
+  return peekObject(t, base + index);
+}
+
+inline uint32_t localInt(Thread* t, unsigned base, unsigned index)
+{
+  return peekInt(t, base + index);
+}
+
+inline uint64_t localLong(Thread* t, unsigned base, unsigned index)
+{
+  return peekLong(t, base + index);
+}
+
+inline void setLocalObject(Thread* t,
+                           unsigned base,
+                           unsigned index,
+                           object value)
+{
+  pokeObject(t, base + index, value);
+}
+
+inline void setLocalInt(Thread* t,
+                        unsigned base,
+                        unsigned index,
+                        uint32_t value)
+{
+  pokeInt(t, base + index, value);
+}
+
+inline void setLocalLong(Thread* t,
+                         unsigned base,
+                         unsigned index,
+                         uint64_t value)
+{
+  pokeLong(t, base + index, value);
+}
+
 inline object localObject(Thread* t, unsigned index)
 {
-  return peekObject(t, frameBase(t, t->frame) + index);
+  return localObject(t, frameBase(t, t->frame), index);
 }
 
 inline uint32_t localInt(Thread* t, unsigned index)
 {
-  return peekInt(t, frameBase(t, t->frame) + index);
+  return localInt(t, frameBase(t, t->frame), index);
 }
 
 inline uint64_t localLong(Thread* t, unsigned index)
 {
-  return peekLong(t, frameBase(t, t->frame) + index);
+  return localLong(t, frameBase(t, t->frame), index);
 }
 
 inline void setLocalObject(Thread* t, unsigned index, object value)
 {
-  pokeObject(t, frameBase(t, t->frame) + index, value);
+  setLocalObject(t, frameBase(t, t->frame), index, value);
 }
 
 inline void setLocalInt(Thread* t, unsigned index, uint32_t value)
 {
-  pokeInt(t, frameBase(t, t->frame) + index, value);
+  setLocalInt(t, frameBase(t, t->frame), index, value);
 }
 
 inline void setLocalLong(Thread* t, unsigned index, uint64_t value)
 {
-  pokeLong(t, frameBase(t, t->frame) + index, value);
+  setLocalLong(t, frameBase(t, t->frame), index, value);
 }
 
 void pushFrame(Thread* t, GcMethod* method)
@@ -317,13 +422,16 @@ void pushFrame(Thread* t, GcMethod* method)
 
   unsigned frame = base + locals;
   pokeInt(t, frame + FrameNextOffset, t->frame);
+  pokeInt(t, frame + FrameBaseOffset, base);
+  pokeObject(t, frame + FrameMethodOffset, method);
+  pokeInt(t, frame + FrameIpOffset, 0);
+
+  // sampleStack may interrupt this thread anywhere, so the frame must
+  // be complete before it becomes the top one
+  compileTimeMemoryBarrier();
   t->frame = frame;
 
   t->sp = frame + FrameFootprint;
-
-  pokeInt(t, frame + FrameBaseOffset, base);
-  pokeObject(t, frame + FrameMethodOffset, method);
-  pokeInt(t, t->frame + FrameIpOffset, 0);
 }
 
 void popFrame(Thread* t)
@@ -523,7 +631,10 @@ void marshalArguments(Thread* t,
   }
 }
 
-unsigned invokeNativeSlow(Thread* t, GcMethod* method, void* function)
+unsigned invokeNativeSlow(Thread* t,
+                          GcMethod* method,
+                          void* function,
+                          unsigned shape)
 {
   PROTECT(t, method);
 
@@ -587,12 +698,16 @@ unsigned invokeNativeSlow(Thread* t, GcMethod* method, void* function)
     t->checkpoint->noThrow = true;
     THREAD_RESOURCE(t, bool, noThrow, t->checkpoint->noThrow = noThrow);
 
-    result = vm::dynamicCall(function,
-                             RUNTIME_ARRAY_BODY(args),
-                             RUNTIME_ARRAY_BODY(types),
-                             count,
-                             footprint * BytesPerWord,
-                             returnType);
+    if (isDirectNative(shape)) {
+      result = directNativeCall(t, function, RUNTIME_ARRAY_BODY(args), count);
+    } else {
+      result = vm::dynamicCall(function,
+                               RUNTIME_ARRAY_BODY(args),
+                               RUNTIME_ARRAY_BODY(types),
+                               count,
+                               footprint * BytesPerWord,
+                               returnType);
+    }
   }
 
   if (DebugRun) {
@@ -615,6 +730,44 @@ unsigned invokeNativeSlow(Thread* t, GcMethod* method, void* function)
   return returnCode;
 }
 
+unsigned invokeNativeCritical(Thread* t,
+                              GcMethod* method,
+                              void* function,
+                              unsigned shape)
+{
+  pushFrame(t, method);
+
+  uintptr_t args[MaxDirectNativeArguments];
+  unsigned argOffset = 0;
+  unsigned sp = frameBase(t, t->frame);
+
+  for (unsigned i = 0; i < method->parameterCount(); ++i) {
+    if (directNativeReference(shape, i)) {
+      argOffset += marshalCriticalArray(peekObject(t, sp++), args + argOffset);
+    } else if (directNativeWide(shape, i)) {
+      args[argOffset++] = peekLong(t, sp);
+      sp += 2;
+    } else {
+      args[argOffset++] = peekInt(t, sp++);
+    }
+  }
+
+  if (DebugRun) {
+    fprintf(stderr,
+            "invoke critical native method %s.%s\n",
+            method->class_()->name()->body().begin(),
+            method->name()->body().begin());
+  }
+
+  uint64_t result = directNativeCall(t, function, args, argOffset);
+
+  popFrame(t);
+
+  pushResult(t, method->returnCode(), result, false);
+
+  return method->returnCode();
+}
+
 unsigned invokeNative(Thread* t, GcMethod* method)
 {
   PROTECT(t, method);
@@ -655,15 +808,18 @@ unsigned invokeNative(Thread* t, GcMethod* method)
     pushResult(t, method->returnCode(), result, false);
 
     return method->returnCode();
+  } else if (isCriticalNative(native->shape())) {
+    return invokeNativeCritical(
+        t, method, native->function(), native->shape());
   } else {
-    return invokeNativeSlow(t, method, native->function());
+    return invokeNativeSlow(t, method, native->function(), native->shape());
   }
 }
 
-inline void store(Thread* t, unsigned index)
+inline void store(Thread* t, unsigned& sp, unsigned base, unsigned index)
 {
-  memcpy(t->stack + ((frameBase(t, t->frame) + index) * 2),
-         t->stack + ((--t->sp) * 2),
+  memcpy(t->stack + ((base + index) * 2),
+         t->stack + ((--sp) * 2),
          BytesPerWord * 2);
 }
 
@@ -724,31 +880,31 @@ uint64_t findExceptionHandler(Thread* t, int frame)
   return findExceptionHandler(t, frameMethod(t, frame), frameIp(t, frame));
 }
 
-void pushField(Thread* t, object target, GcField* field)
+void pushField(Thread* t, unsigned& sp, object target, GcField* field)
 {
   switch (field->code()) {
   case ByteField:
   case BooleanField:
-    pushInt(t, fieldAtOffset<int8_t>(target, field->offset()));
+    pushInt(t, sp, fieldAtOffset<int8_t>(target, field->offset()));
     break;
 
   case CharField:
   case ShortField:
-    pushInt(t, fieldAtOffset<int16_t>(target, field->offset()));
+    pushInt(t, sp, fieldAtOffset<int16_t>(target, field->offset()));
     break;
 
   case FloatField:
   case IntField:
-    pushInt(t, fieldAtOffset<int32_t>(target, field->offset()));
+    pushInt(t, sp, fieldAtOffset<int32_t>(target, field->offset()));
     break;
 
   case DoubleField:
   case LongField:
-    pushLong(t, fieldAtOffset<int64_t>(target, field->offset()));
+    pushLong(t, sp, getWideField(t, target, field));
     break;
 
   case ObjectField:
-    pushObject(t, fieldAtOffset<object>(target, field->offset()));
+    pushObject(t, sp, fieldAtOffset<object>(target, field->offset()));
     break;
 
   default:
@@ -756,6 +912,189 @@ void pushField(Thread* t, object target, GcField* field)
   }
 }
 
+// Rewrites the instruction at the specified offset to a quick variant.
+// Since the variant decodes the same operands, a thread which has
+// already fetched the original instruction is unaffected, and one
+// which fetches the variant finds the pool entries already resolved.
+void quicken(GcCode* code, unsigned ip, unsigned instruction)
+{
+  storeStoreMemoryBarrier();
+
+  code->body()[ip] = instruction;
+}
+
+unsigned quickGetField(GcField* field)
+{
+  switch (field->code()) {
+  case FloatField:
+  case IntField:
+    return getfield_quick_int;
+
+  case ObjectField:
+    return getfield_quick_object;
+
+  default:
+    return getfield_quick;
+  }
+}
+
+// Returns the quick variant of putfield for the specified field, or
+// putfield itself if there is none.
+unsigned quickPutField(GcField* field)
+{
+  switch (field->code()) {
+  case FloatField:
+  case IntField:
+    return putfield_quick_int;
+
+  case ObjectField:
+    return putfield_quick_object;
+
+  default:
+    return putfield;
+  }
+}
+
+bool isIntLoad(unsigned instruction)
+{
+  return instruction == iload
+         or (instruction >= iload_0 and instruction <= iload_3);
+}
+
+// Replaces the instruction at the specified offset with the
+// superinstruction for an iload/iload/if_icmp* sequence if that is what
+// starts there, where next is the offset of the second load.
+void fuseIntCompare(GcCode* code,
+                    unsigned ip,
+                    unsigned next,
+                    unsigned superinstruction)
+{
+  uint8_t* body = code->body().begin();
+  unsigned length = code->length();
+
+  if (next < length and isIntLoad(body[next])) {
+    next += (body[next] == iload ? 2 : 1);
+    if (next < length and body[next] >= if_icmpeq
+        and body[next] <= if_icmple) {
+      quicken(code, ip, superinstruction);
+    }
+  }
+}
+
+// Executes the second load and the branch of a fused iload/iload/if_icmp*
+// sequence, given the value of the first load and the offset of the
+// second, and returns the offset of the next instruction.
+unsigned loadAndCompare(Thread* t,
+                        GcCode* code,
+                        unsigned base,
+                        unsigned ip,
+                        int32_t a)
+{
+  uint8_t* body = code->body().begin();
+
+  int32_t b;
+  if (body[ip] == iload) {
+    b = localInt(t, base, body[ip + 1]);
+    ip += 2;
+  } else {
+    b = localInt(t, base, body[ip] - iload_0);
+    ++ip;
+  }
+
+  unsigned start = ip;
+  unsigned instruction = body[ip++];
+  int16_t offset = codeReadInt16(t, code, ip);
+
+  bool taken;
+  switch (instruction) {
+  case if_icmpeq:
+    taken = a == b;
+    break;
+  case if_icmpne:
+    taken = a != b;
+    break;
+  case if_icmplt:
+    taken = a < b;
+    break;
+  case if_icmpge:
+    taken = a >= b;
+    break;
+  case if_icmpgt:
+    taken = a > b;
+    break;
+  case if_icmple:
+    taken = a <= b;
+    break;
+  default:
+    abort(t);
+  }
+
+  return taken ? start + offset : ip;
+}
+
+template <class T>
+T* resolvedPoolEntry(Thread* t, GcCode* code, unsigned index)
+{
+  object o = singletonObject(t, code->pool(), index);
+
+  loadMemoryBarrier();
+
+  return cast<T>(t, o);
+}
+
+// Where the compiler lets us take the address of a label, each
+// instruction handler fetches the next instruction and jumps straight
+// to its handler, so that every handler has its own indirect branch for
+// the processor to predict.  Otherwise, or if AVIAN_SWITCH_DISPATCH is
+// defined, every handler returns to a single switch.
+#if (defined __GNUC__) and (not defined AVIAN_SWITCH_DISPATCH)
+#define AVIAN_THREADED_DISPATCH
+#endif
+
+#ifdef AVIAN_THREADED_DISPATCH
+#define INSTRUCTION(name) \
+  case vm::name:          \
+  op_##name
+#define NEXT                                       \
+  do {                                             \
+    if (DebugRun or ProfileInstructionPairs) {     \
+      goto loop;                                   \
+    }                                              \
+    instruction = code->body()[ip++];              \
+    goto* dispatchTable[instruction];              \
+  } while (0)
+#else
+#define INSTRUCTION(name) case vm::name
+#define NEXT goto loop
+#endif
+
+// interpret3 keeps ip, sp and the base of the current frame's locals in
+// local variables so the compiler can keep them in registers.  They are
+// written back to the thread before anything which might look at them,
+// i.e. calls which may allocate, block, throw or run Java code, and
+// safepoints, and read back after anything which may change them.
+// Handlers which are mostly such calls (resolution, invocation, returns
+// and so on) save the state on entry, work on the thread's copy and load
+// it again on exit.
+#define SAVE_STATE \
+  do {             \
+    t->ip = ip;    \
+    t->sp = sp;    \
+  } while (0)
+
+#define LOAD_STATE                   \
+  do {                               \
+    ip = t->ip;                      \
+    sp = t->sp;                      \
+    localBase = frameBase(t, frame); \
+  } while (0)
+
+#define LOAD_STATE_AND_NEXT \
+  do {                      \
+    LOAD_STATE;             \
+    NEXT;                   \
+  } while (0)
+
 void safePoint(Thread* t)
 {
   if (UNLIKELY(t->m->exclusive)) {
@@ -763,18 +1102,106 @@ void safePoint(Thread* t)
   }
 }
 
+void countInstructionPair(Thread* t, unsigned first, unsigned second);
+
 object interpret3(Thread* t, const int base)
 {
   unsigned instruction = nop;
-  unsigned& ip = t->ip;
-  unsigned& sp = t->sp;
+  unsigned ip = t->ip;
+  unsigned sp = t->sp;
   int& frame = t->frame;
+  unsigned localBase = frameBase(t, frame);
   GcCode*& code = t->code;
   GcMethod* method = 0;
   PROTECT(t, method);
   GcThrowable*& exception = t->exception;
   uintptr_t* stack = t->stack;
 
+#ifdef AVIAN_THREADED_DISPATCH
+  // handler for each opcode, indexed by its value
+  static void* const dispatchTable[256] = {
+      // 0x00
+      &&op_nop, &&op_aconst_null, &&op_iconst_m1, &&op_iconst_0, &&op_iconst_1,
+      &&op_iconst_2, &&op_iconst_3, &&op_iconst_4, &&op_iconst_5, &&op_lconst_0,
+      &&op_lconst_1, &&op_fconst_0, &&op_fconst_1, &&op_fconst_2, &&op_dconst_0,
+      &&op_dconst_1,
+      // 0x10
+      &&op_bipush, &&op_sipush, &&op_ldc, &&op_ldc_w, &&op_ldc2_w, &&op_iload,
+      &&op_lload, &&op_fload, &&op_dload, &&op_aload, &&op_iload_0,
+      &&op_iload_1, &&op_iload_2, &&op_iload_3, &&op_lload_0, &&op_lload_1,
+      // 0x20
+      &&op_lload_2, &&op_lload_3, &&op_fload_0, &&op_fload_1, &&op_fload_2,
+      &&op_fload_3, &&op_dload_0, &&op_dload_1, &&op_dload_2, &&op_dload_3,
+      &&op_aload_0, &&op_aload_1, &&op_aload_2, &&op_aload_3, &&op_iaload,
+      &&op_laload,
+      // 0x30
+      &&op_faload, &&op_daload, &&op_aaload, &&op_baload, &&op_caload,
+      &&op_saload, &&op_istore, &&op_lstore, &&op_fstore, &&op_dstore,
+      &&op_astore, &&op_istore_0, &&op_istore_1, &&op_istore_2, &&op_istore_3,
+      &&op_lstore_0,
+      // 0x40
+      &&op_lstore_1, &&op_lstore_2, &&op_lstore_3, &&op_fstore_0, &&op_fstore_1,
+      &&op_fstore_2, &&op_fstore_3, &&op_dstore_0, &&op_dstore_1, &&op_dstore_2,
+      &&op_dstore_3, &&op_astore_0, &&op_astore_1, &&op_astore_2, &&op_astore_3,
+      &&op_iastore,
+      // 0x50
+      &&op_lastore, &&op_fastore, &&op_dastore, &&op_aastore, &&op_bastore,
+      &&op_castore, &&op_sastore, &&op_pop_, &&op_pop2, &&op_dup, &&op_dup_x1,
+      &&op_dup_x2, &&op_dup2, &&op_dup2_x1, &&op_dup2_x2, &&op_swap,
+      // 0x60
+      &&op_iadd, &&op_ladd, &&op_fadd, &&op_dadd, &&op_isub, &&op_lsub,
+      &&op_fsub, &&op_dsub, &&op_imul, &&op_lmul, &&op_fmul, &&op_dmul,
+      &&op_idiv, &&op_ldiv_, &&op_fdiv, &&op_ddiv,
+      // 0x70
+      &&op_irem, &&op_lrem, &&op_frem, &&op_drem, &&op_ineg, &&op_lneg,
+      &&op_fneg, &&op_dneg, &&op_ishl, &&op_lshl, &&op_ishr, &&op_lshr,
+      &&op_iushr, &&op_lushr, &&op_iand, &&op_land,
+      // 0x80
+      &&op_ior, &&op_lor, &&op_ixor, &&op_lxor, &&op_iinc, &&op_i2l, &&op_i2f,
+      &&op_i2d, &&op_l2i, &&op_l2f, &&op_l2d, &&op_f2i, &&op_f2l, &&op_f2d,
+      &&op_d2i, &&op_d2l,
+      // 0x90
+      &&op_d2f, &&op_i2b, &&op_i2c, &&op_i2s, &&op_lcmp, &&op_fcmpl, &&op_fcmpg,
+      &&op_dcmpl, &&op_dcmpg, &&op_ifeq, &&op_ifne, &&op_iflt, &&op_ifge,
+      &&op_ifgt, &&op_ifle, &&op_if_icmpeq,
+      // 0xa0
+      &&op_if_icmpne, &&op_if_icmplt, &&op_if_icmpge, &&op_if_icmpgt,
+      &&op_if_icmple, &&op_if_acmpeq, &&op_if_acmpne, &&op_goto_, &&op_jsr,
+      &&op_ret, &&op_tableswitch, &&op_lookupswitch, &&op_ireturn, &&op_lreturn,
+      &&op_freturn, &&op_dreturn,
+      // 0xb0
+      &&op_areturn, &&op_return_, &&op_getstatic, &&op_putstatic, &&op_getfield,
+      &&op_putfield, &&op_invokevirtual, &&op_invokespecial, &&op_invokestatic,
+      &&op_invokeinterface, &&op_invokedynamic, &&op_new_, &&op_newarray,
+      &&op_anewarray, &&op_arraylength, &&op_athrow,
+      // 0xc0
+      &&op_checkcast, &&op_instanceof, &&op_monitorenter, &&op_monitorexit,
+      &&op_wide, &&op_multianewarray, &&op_ifnull, &&op_ifnonnull, &&op_goto_w,
+      &&op_jsr_w, &&op_invalid, &&op_getfield_quick, &&op_getfield_quick_int,
+      &&op_getfield_quick_object, &&op_invokevirtual_quick, &&op_new_quick,
+      // 0xd0
+      &&op_aload_0_getfield_quick_int, &&op_aload_0_getfield_quick_object,
+      &&op_iinc_goto, &&op_iload_iload_if_icmp, &&op_iload_0_iload_if_icmp,
+      &&op_iload_1_iload_if_icmp, &&op_iload_2_iload_if_icmp,
+      &&op_iload_3_iload_if_icmp, &&op_putfield_quick_int,
+      &&op_putfield_quick_object, &&op_invokespecial_quick,
+      &&op_invokestatic_quick, &&op_invalid, &&op_invalid, &&op_invalid,
+      &&op_invalid,
+      // 0xe0
+      &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid,
+      &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid,
+      &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid,
+      &&op_invalid,
+      // 0xf0
+      &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid,
+      &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid,
+      &&op_invalid, &&op_invalid, &&op_invalid, &&op_invalid, &&op_impdep1,
+      &&op_invalid};
+#endif
+
+  unsigned previousInstruction = nop;
+  GcCode* previousCode = 0;
+
   code = frameMethod(t, frame)->code();
 
   if (UNLIKELY(exception)) {
@@ -784,6 +1211,14 @@ object interpret3(Thread* t, const int base)
 loop:
   instruction = code->body()[ip++];
 
+  if (ProfileInstructionPairs) {
+    if (code == previousCode) {
+      countInstructionPair(t, previousInstruction, instruction);
+    }
+    previousInstruction = instruction;
+    previousCode = code;
+  }
+
   if (DebugRun) {
     fprintf(stderr,
             "ip: %d; instruction: 0x%x in %s.%s ",
@@ -806,16 +1241,17 @@ loop:
   }
 
   switch (instruction) {
-  case aaload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(aaload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       if (LIKELY(index >= 0
                  and static_cast<uintptr_t>(index)
                      < objectArrayLength(t, array))) {
-        pushObject(t, objectArrayBody(t, array, index));
+        pushObject(t, sp, objectArrayBody(t, array, index));
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -824,16 +1260,17 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case aastore: {
-    object value = popObject(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(aastore): {
+    object value = popObject(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       if (LIKELY(index >= 0
@@ -841,6 +1278,7 @@ loop:
                      < objectArrayLength(t, array))) {
         setField(t, array, ArrayBody + (index * BytesPerWord), value);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -849,47 +1287,91 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case aconst_null: {
-    pushObject(t, 0);
+  INSTRUCTION(aconst_null): {
+    pushObject(t, sp, 0);
   }
-    goto loop;
+    NEXT;
 
-  case aload: {
-    pushObject(t, localObject(t, code->body()[ip++]));
+  INSTRUCTION(aload): {
+    pushObject(t, sp, localObject(t, localBase, code->body()[ip++]));
+  }
+    NEXT;
+
+  INSTRUCTION(aload_0): {
+    pushObject(t, sp, localObject(t, localBase, 0));
+
+    switch (code->body()[ip]) {
+    case getfield_quick_int:
+      quicken(code, ip - 1, aload_0_getfield_quick_int);
+      break;
+    case getfield_quick_object:
+      quicken(code, ip - 1, aload_0_getfield_quick_object);
+      break;
+    }
+  }
+    NEXT;
+
+  // If the object is null, these leave it on the stack so that the
+  // getfield which follows throws with the right ip.
+  INSTRUCTION(aload_0_getfield_quick_int): {
+    object instance = localObject(t, localBase, 0);
+    if (LIKELY(instance)) {
+      ++ip;
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
+
+      pushInt(t, sp, fieldAtOffset<int32_t>(instance, field->offset()));
+    } else {
+      pushObject(t, sp, instance);
+    }
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(aload_0_getfield_quick_object): {
+    object instance = localObject(t, localBase, 0);
+    if (LIKELY(instance)) {
+      ++ip;
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
 
-  case aload_0: {
-    pushObject(t, localObject(t, 0));
+      pushObject(t, sp, fieldAtOffset<object>(instance, field->offset()));
+    } else {
+      pushObject(t, sp, instance);
+    }
   }
-    goto loop;
+    NEXT;
 
-  case aload_1: {
-    pushObject(t, localObject(t, 1));
+  INSTRUCTION(aload_1): {
+    pushObject(t, sp, localObject(t, localBase, 1));
   }
-    goto loop;
+    NEXT;
 
-  case aload_2: {
-    pushObject(t, localObject(t, 2));
+  INSTRUCTION(aload_2): {
+    pushObject(t, sp, localObject(t, localBase, 2));
   }
-    goto loop;
+    NEXT;
 
-  case aload_3: {
-    pushObject(t, localObject(t, 3));
+  INSTRUCTION(aload_3): {
+    pushObject(t, sp, localObject(t, localBase, 3));
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(anewarray): {
+    SAVE_STATE;
 
-  case anewarray: {
     int32_t count = popInt(t);
 
     if (LIKELY(count >= 0)) {
-      uint16_t index = codeReadInt16(t, code, ip);
+      uint16_t index = codeReadInt16(t, code, t->ip);
 
       GcClass* class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
 
@@ -900,75 +1382,80 @@ loop:
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
+
+  INSTRUCTION(areturn): {
+    SAVE_STATE;
 
-  case areturn: {
     object result = popObject(t);
     if (frame > base) {
       popFrame(t);
       pushObject(t, result);
-      goto loop;
+      LOAD_STATE_AND_NEXT;
     } else {
       return result;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case arraylength: {
-    object array = popObject(t);
+  INSTRUCTION(arraylength): {
+    object array = popObject(t, sp);
     if (LIKELY(array)) {
-      pushInt(t, fieldAtOffset<uintptr_t>(array, BytesPerWord));
+      pushInt(t, sp, fieldAtOffset<uintptr_t>(array, BytesPerWord));
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case astore: {
-    store(t, code->body()[ip++]);
+  INSTRUCTION(astore): {
+    store(t, sp, localBase, code->body()[ip++]);
   }
-    goto loop;
+    NEXT;
 
-  case astore_0: {
-    store(t, 0);
+  INSTRUCTION(astore_0): {
+    store(t, sp, localBase, 0);
   }
-    goto loop;
+    NEXT;
 
-  case astore_1: {
-    store(t, 1);
+  INSTRUCTION(astore_1): {
+    store(t, sp, localBase, 1);
   }
-    goto loop;
+    NEXT;
 
-  case astore_2: {
-    store(t, 2);
+  INSTRUCTION(astore_2): {
+    store(t, sp, localBase, 2);
   }
-    goto loop;
+    NEXT;
 
-  case astore_3: {
-    store(t, 3);
+  INSTRUCTION(astore_3): {
+    store(t, sp, localBase, 3);
   }
-    goto loop;
+    NEXT;
 
-  case athrow: {
-    exception = cast<GcThrowable>(t, popObject(t));
+  INSTRUCTION(athrow): {
+    exception = cast<GcThrowable>(t, popObject(t, sp));
+    SAVE_STATE;
     if (UNLIKELY(exception == 0)) {
       exception = makeThrowable(t, GcNullPointerException::Type);
     }
   }
     goto throw_;
 
-  case baload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(baload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       if (objectClass(t, array) == type(t, GcBooleanArray::Type)) {
         GcBooleanArray* a = cast<GcBooleanArray>(t, array);
         if (LIKELY(index >= 0
                    and static_cast<uintptr_t>(index) < a->length())) {
-          pushInt(t, a->body()[index]);
+          pushInt(t, sp, a->body()[index]);
         } else {
+          SAVE_STATE;
           exception = makeThrowable(t,
                                     GcArrayIndexOutOfBoundsException::Type,
                                     "%d not in [0,%d)",
@@ -980,8 +1467,9 @@ loop:
         GcByteArray* a = cast<GcByteArray>(t, array);
         if (LIKELY(index >= 0
                    and static_cast<uintptr_t>(index) < a->length())) {
-          pushInt(t, a->body()[index]);
+          pushInt(t, sp, a->body()[index]);
         } else {
+          SAVE_STATE;
           exception = makeThrowable(t,
                                     GcArrayIndexOutOfBoundsException::Type,
                                     "%d not in [0,%d)",
@@ -991,16 +1479,17 @@ loop:
         }
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case bastore: {
-    int8_t value = popInt(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(bastore): {
+    int8_t value = popInt(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       if (objectClass(t, array) == type(t, GcBooleanArray::Type)) {
@@ -1009,6 +1498,7 @@ loop:
                    and static_cast<uintptr_t>(index) < a->length())) {
           a->body()[index] = value;
         } else {
+          SAVE_STATE;
           exception = makeThrowable(t,
                                     GcArrayIndexOutOfBoundsException::Type,
                                     "%d not in [0,%d)",
@@ -1022,6 +1512,7 @@ loop:
                    and static_cast<uintptr_t>(index) < a->length())) {
           a->body()[index] = value;
         } else {
+          SAVE_STATE;
           exception = makeThrowable(t,
                                     GcArrayIndexOutOfBoundsException::Type,
                                     "%d not in [0,%d)",
@@ -1031,26 +1522,28 @@ loop:
         }
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case bipush: {
-    pushInt(t, static_cast<int8_t>(code->body()[ip++]));
+  INSTRUCTION(bipush): {
+    pushInt(t, sp, static_cast<int8_t>(code->body()[ip++]));
   }
-    goto loop;
+    NEXT;
 
-  case caload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(caload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcCharArray* a = cast<GcCharArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
-        pushInt(t, a->body()[index]);
+        pushInt(t, sp, a->body()[index]);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1059,22 +1552,24 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case castore: {
-    uint16_t value = popInt(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(castore): {
+    uint16_t value = popInt(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcCharArray* a = cast<GcCharArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
         a->body()[index] = value;
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1083,46 +1578,49 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case checkcast: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(checkcast): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
-    if (peekObject(t, sp - 1)) {
+    if (peekObject(t, t->sp - 1)) {
       GcClass* class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
       if (UNLIKELY(exception))
         goto throw_;
 
-      if (not instanceOf(t, class_, peekObject(t, sp - 1))) {
+      if (not instanceOf(t, class_, peekObject(t, t->sp - 1))) {
         exception = makeThrowable(
             t,
             GcClassCastException::Type,
             "%s as %s",
-            objectClass(t, peekObject(t, sp - 1))->name()->body().begin(),
+            objectClass(t, peekObject(t, t->sp - 1))->name()->body().begin(),
             class_->name()->body().begin());
         goto throw_;
       }
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case d2f: {
-    pushFloat(t, static_cast<float>(popDouble(t)));
+  INSTRUCTION(d2f): {
+    pushFloat(t, sp, static_cast<float>(popDouble(t, sp)));
   }
-    goto loop;
+    NEXT;
 
-  case d2i: {
-    double f = popDouble(t);
+  INSTRUCTION(d2i): {
+    double f = popDouble(t, sp);
     switch (fpclassify(f)) {
     case FP_NAN:
-      pushInt(t, 0);
+      pushInt(t, sp, 0);
       break;
     case FP_INFINITE:
-      pushInt(t, signbit(f) ? INT32_MIN : INT32_MAX);
+      pushInt(t, sp, signbit(f) ? INT32_MIN : INT32_MAX);
       break;
     default:
       pushInt(t,
@@ -1132,16 +1630,16 @@ loop:
       break;
     }
   }
-    goto loop;
+    NEXT;
 
-  case d2l: {
-    double f = popDouble(t);
+  INSTRUCTION(d2l): {
+    double f = popDouble(t, sp);
     switch (fpclassify(f)) {
     case FP_NAN:
-      pushLong(t, 0);
+      pushLong(t, sp, 0);
       break;
     case FP_INFINITE:
-      pushLong(t, signbit(f) ? INT64_MIN : INT64_MAX);
+      pushLong(t, sp, signbit(f) ? INT64_MIN : INT64_MAX);
       break;
     default:
       pushLong(t,
@@ -1151,25 +1649,26 @@ loop:
       break;
     }
   }
-    goto loop;
+    NEXT;
 
-  case dadd: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(dadd): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
-    pushDouble(t, a + b);
+    pushDouble(t, sp, a + b);
   }
-    goto loop;
+    NEXT;
 
-  case daload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(daload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcDoubleArray* a = cast<GcDoubleArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
-        pushLong(t, a->body()[index]);
+        pushLong(t, sp, a->body()[index]);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1178,22 +1677,24 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case dastore: {
-    double value = popDouble(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(dastore): {
+    double value = popDouble(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcDoubleArray* a = cast<GcDoubleArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
         memcpy(&a->body()[index], &value, sizeof(uint64_t));
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1202,100 +1703,101 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case dcmpg: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(dcmpg): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
     if (isNaN(a) or isNaN(b)) {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     }
     if (a < b) {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     } else if (a > b) {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     } else if (a == b) {
-      pushInt(t, 0);
+      pushInt(t, sp, 0);
     } else {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     }
   }
-    goto loop;
+    NEXT;
 
-  case dcmpl: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(dcmpl): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
     if (isNaN(a) or isNaN(b)) {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     }
     if (a < b) {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     } else if (a > b) {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     } else if (a == b) {
-      pushInt(t, 0);
+      pushInt(t, sp, 0);
     } else {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     }
   }
-    goto loop;
+    NEXT;
 
-  case dconst_0: {
-    pushDouble(t, 0);
+  INSTRUCTION(dconst_0): {
+    pushDouble(t, sp, 0);
   }
-    goto loop;
+    NEXT;
 
-  case dconst_1: {
-    pushDouble(t, 1);
+  INSTRUCTION(dconst_1): {
+    pushDouble(t, sp, 1);
   }
-    goto loop;
+    NEXT;
 
-  case ddiv: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(ddiv): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
-    pushDouble(t, a / b);
+    pushDouble(t, sp, a / b);
   }
-    goto loop;
+    NEXT;
 
-  case dmul: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(dmul): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
-    pushDouble(t, a * b);
+    pushDouble(t, sp, a * b);
   }
-    goto loop;
+    NEXT;
 
-  case dneg: {
-    double a = popDouble(t);
+  INSTRUCTION(dneg): {
+    double a = popDouble(t, sp);
 
-    pushDouble(t, -a);
+    pushDouble(t, sp, -a);
   }
-    goto loop;
+    NEXT;
 
-  case vm::drem: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(drem): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
-    pushDouble(t, fmod(a, b));
+    pushDouble(t, sp, fmod(a, b));
   }
-    goto loop;
+    NEXT;
 
-  case dsub: {
-    double b = popDouble(t);
-    double a = popDouble(t);
+  INSTRUCTION(dsub): {
+    double b = popDouble(t, sp);
+    double a = popDouble(t, sp);
 
-    pushDouble(t, a - b);
+    pushDouble(t, sp, a - b);
   }
-    goto loop;
+    NEXT;
 
-  case vm::dup: {
+  INSTRUCTION(dup): {
     if (DebugStack) {
       fprintf(stderr, "dup\n");
     }
@@ -1303,9 +1805,9 @@ loop:
     memcpy(stack + ((sp)*2), stack + ((sp - 1) * 2), BytesPerWord * 2);
     ++sp;
   }
-    goto loop;
+    NEXT;
 
-  case dup_x1: {
+  INSTRUCTION(dup_x1): {
     if (DebugStack) {
       fprintf(stderr, "dup_x1\n");
     }
@@ -1315,9 +1817,9 @@ loop:
     memcpy(stack + ((sp - 2) * 2), stack + ((sp)*2), BytesPerWord * 2);
     ++sp;
   }
-    goto loop;
+    NEXT;
 
-  case dup_x2: {
+  INSTRUCTION(dup_x2): {
     if (DebugStack) {
       fprintf(stderr, "dup_x2\n");
     }
@@ -1328,9 +1830,9 @@ loop:
     memcpy(stack + ((sp - 3) * 2), stack + ((sp)*2), BytesPerWord * 2);
     ++sp;
   }
-    goto loop;
+    NEXT;
 
-  case vm::dup2: {
+  INSTRUCTION(dup2): {
     if (DebugStack) {
       fprintf(stderr, "dup2\n");
     }
@@ -1338,9 +1840,9 @@ loop:
     memcpy(stack + ((sp)*2), stack + ((sp - 2) * 2), BytesPerWord * 4);
     sp += 2;
   }
-    goto loop;
+    NEXT;
 
-  case dup2_x1: {
+  INSTRUCTION(dup2_x1): {
     if (DebugStack) {
       fprintf(stderr, "dup2_x1\n");
     }
@@ -1351,9 +1853,9 @@ loop:
     memcpy(stack + ((sp - 3) * 2), stack + ((sp)*2), BytesPerWord * 4);
     sp += 2;
   }
-    goto loop;
+    NEXT;
 
-  case dup2_x2: {
+  INSTRUCTION(dup2_x2): {
     if (DebugStack) {
       fprintf(stderr, "dup2_x2\n");
     }
@@ -1365,21 +1867,21 @@ loop:
     memcpy(stack + ((sp - 4) * 2), stack + ((sp)*2), BytesPerWord * 4);
     sp += 2;
   }
-    goto loop;
+    NEXT;
 
-  case f2d: {
-    pushDouble(t, popFloat(t));
+  INSTRUCTION(f2d): {
+    pushDouble(t, sp, popFloat(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case f2i: {
-    float f = popFloat(t);
+  INSTRUCTION(f2i): {
+    float f = popFloat(t, sp);
     switch (fpclassify(f)) {
     case FP_NAN:
-      pushInt(t, 0);
+      pushInt(t, sp, 0);
       break;
     case FP_INFINITE:
-      pushInt(t, signbit(f) ? INT32_MIN : INT32_MAX);
+      pushInt(t, sp, signbit(f) ? INT32_MIN : INT32_MAX);
       break;
     default:
       pushInt(t,
@@ -1389,41 +1891,42 @@ loop:
       break;
     }
   }
-    goto loop;
+    NEXT;
 
-  case f2l: {
-    float f = popFloat(t);
+  INSTRUCTION(f2l): {
+    float f = popFloat(t, sp);
     switch (fpclassify(f)) {
     case FP_NAN:
-      pushLong(t, 0);
+      pushLong(t, sp, 0);
       break;
     case FP_INFINITE:
-      pushLong(t, signbit(f) ? INT64_MIN : INT64_MAX);
+      pushLong(t, sp, signbit(f) ? INT64_MIN : INT64_MAX);
       break;
     default:
-      pushLong(t, static_cast<int64_t>(f));
+      pushLong(t, sp, static_cast<int64_t>(f));
       break;
     }
   }
-    goto loop;
+    NEXT;
 
-  case fadd: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(fadd): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
-    pushFloat(t, a + b);
+    pushFloat(t, sp, a + b);
   }
-    goto loop;
+    NEXT;
 
-  case faload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(faload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcFloatArray* a = cast<GcFloatArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
-        pushInt(t, a->body()[index]);
+        pushInt(t, sp, a->body()[index]);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1432,22 +1935,24 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case fastore: {
-    float value = popFloat(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(fastore): {
+    float value = popFloat(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcFloatArray* a = cast<GcFloatArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
         memcpy(&a->body()[index], &value, sizeof(uint32_t));
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1456,107 +1961,110 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case fcmpg: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(fcmpg): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
     if (isNaN(a) or isNaN(b)) {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     }
     if (a < b) {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     } else if (a > b) {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     } else if (a == b) {
-      pushInt(t, 0);
+      pushInt(t, sp, 0);
     } else {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     }
   }
-    goto loop;
+    NEXT;
 
-  case fcmpl: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(fcmpl): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
     if (isNaN(a) or isNaN(b)) {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     }
     if (a < b) {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     } else if (a > b) {
-      pushInt(t, 1);
+      pushInt(t, sp, 1);
     } else if (a == b) {
-      pushInt(t, 0);
+      pushInt(t, sp, 0);
     } else {
-      pushInt(t, static_cast<unsigned>(-1));
+      pushInt(t, sp, static_cast<unsigned>(-1));
     }
   }
-    goto loop;
+    NEXT;
 
-  case fconst_0: {
-    pushFloat(t, 0);
+  INSTRUCTION(fconst_0): {
+    pushFloat(t, sp, 0);
   }
-    goto loop;
+    NEXT;
 
-  case fconst_1: {
-    pushFloat(t, 1);
+  INSTRUCTION(fconst_1): {
+    pushFloat(t, sp, 1);
   }
-    goto loop;
+    NEXT;
 
-  case fconst_2: {
-    pushFloat(t, 2);
+  INSTRUCTION(fconst_2): {
+    pushFloat(t, sp, 2);
   }
-    goto loop;
+    NEXT;
 
-  case fdiv: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(fdiv): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
-    pushFloat(t, a / b);
+    pushFloat(t, sp, a / b);
   }
-    goto loop;
+    NEXT;
 
-  case fmul: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(fmul): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
-    pushFloat(t, a * b);
+    pushFloat(t, sp, a * b);
   }
-    goto loop;
+    NEXT;
 
-  case fneg: {
-    float a = popFloat(t);
+  INSTRUCTION(fneg): {
+    float a = popFloat(t, sp);
 
-    pushFloat(t, -a);
+    pushFloat(t, sp, -a);
   }
-    goto loop;
+    NEXT;
 
-  case frem: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(frem): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
-    pushFloat(t, fmodf(a, b));
+    pushFloat(t, sp, fmodf(a, b));
   }
-    goto loop;
+    NEXT;
 
-  case fsub: {
-    float b = popFloat(t);
-    float a = popFloat(t);
+  INSTRUCTION(fsub): {
+    float b = popFloat(t, sp);
+    float a = popFloat(t, sp);
 
-    pushFloat(t, a - b);
+    pushFloat(t, sp, a - b);
   }
-    goto loop;
+    NEXT;
 
-  case getfield: {
-    if (LIKELY(peekObject(t, sp - 1))) {
-      uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(getfield): {
+    SAVE_STATE;
+
+    if (LIKELY(peekObject(t, t->sp - 1))) {
+      uint16_t index = codeReadInt16(t, code, t->ip);
 
       GcField* field = resolveField(t, frameMethod(t, frame), index - 1);
 
@@ -1566,16 +2074,69 @@ loop:
 
       ACQUIRE_FIELD_FOR_READ(t, field);
 
-      pushField(t, popObject(t), field);
+      pushField(t, t->sp, popObject(t), field);
+
+      if ((field->flags() & ACC_VOLATILE) == 0) {
+        quicken(code, t->ip - 3, quickGetField(field));
+      }
     } else {
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case getstatic: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(getfield_quick): {
+    if (LIKELY(peekObject(t, sp - 1))) {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
+
+      pushField(t, sp, popObject(t, sp), field);
+    } else {
+      SAVE_STATE;
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    NEXT;
+
+  INSTRUCTION(getfield_quick_int): {
+    if (LIKELY(peekObject(t, sp - 1))) {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
+
+      pushInt(t, sp, fieldAtOffset<int32_t>(popObject(t, sp), field->offset()));
+    } else {
+      SAVE_STATE;
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    NEXT;
+
+  INSTRUCTION(getfield_quick_object): {
+    if (LIKELY(peekObject(t, sp - 1))) {
+      uint16_t index = codeReadInt16(t, code, ip);
+
+      GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
+
+      object instance = popObject(t, sp);
+
+      pushObject(t, sp, fieldAtOffset<object>(instance, field->offset()));
+    } else {
+      SAVE_STATE;
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    NEXT;
+
+  INSTRUCTION(getstatic): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcField* field = resolveField(t, frameMethod(t, frame), index - 1);
 
@@ -1587,69 +2148,70 @@ loop:
 
     ACQUIRE_FIELD_FOR_READ(t, field);
 
-    pushField(t, field->class_()->staticTable(), field);
+    pushField(t, t->sp, field->class_()->staticTable(), field);
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case goto_: {
+  INSTRUCTION(goto_): {
     int16_t offset = codeReadInt16(t, code, ip);
     ip = (ip - 3) + offset;
   }
     goto back_branch;
 
-  case goto_w: {
+  INSTRUCTION(goto_w): {
     int32_t offset = codeReadInt32(t, code, ip);
     ip = (ip - 5) + offset;
   }
     goto back_branch;
 
-  case i2b: {
-    pushInt(t, static_cast<int8_t>(popInt(t)));
+  INSTRUCTION(i2b): {
+    pushInt(t, sp, static_cast<int8_t>(popInt(t, sp)));
   }
-    goto loop;
+    NEXT;
 
-  case i2c: {
-    pushInt(t, static_cast<uint16_t>(popInt(t)));
+  INSTRUCTION(i2c): {
+    pushInt(t, sp, static_cast<uint16_t>(popInt(t, sp)));
   }
-    goto loop;
+    NEXT;
 
-  case i2d: {
-    pushDouble(t, static_cast<double>(static_cast<int32_t>(popInt(t))));
+  INSTRUCTION(i2d): {
+    pushDouble(t, sp, static_cast<double>(static_cast<int32_t>(popInt(t, sp))));
   }
-    goto loop;
+    NEXT;
 
-  case i2f: {
-    pushFloat(t, static_cast<float>(static_cast<int32_t>(popInt(t))));
+  INSTRUCTION(i2f): {
+    pushFloat(t, sp, static_cast<float>(static_cast<int32_t>(popInt(t, sp))));
   }
-    goto loop;
+    NEXT;
 
-  case i2l: {
-    pushLong(t, static_cast<int32_t>(popInt(t)));
+  INSTRUCTION(i2l): {
+    pushLong(t, sp, static_cast<int32_t>(popInt(t, sp)));
   }
-    goto loop;
+    NEXT;
 
-  case i2s: {
-    pushInt(t, static_cast<int16_t>(popInt(t)));
+  INSTRUCTION(i2s): {
+    pushInt(t, sp, static_cast<int16_t>(popInt(t, sp)));
   }
-    goto loop;
+    NEXT;
 
-  case iadd: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(iadd): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a + b);
+    pushInt(t, sp, a + b);
   }
-    goto loop;
+    NEXT;
 
-  case iaload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(iaload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcIntArray* a = cast<GcIntArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
-        pushInt(t, a->body()[index]);
+        pushInt(t, sp, a->body()[index]);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1658,30 +2220,32 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case iand: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(iand): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a & b);
+    pushInt(t, sp, a & b);
   }
-    goto loop;
+    NEXT;
 
-  case iastore: {
-    int32_t value = popInt(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(iastore): {
+    int32_t value = popInt(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcIntArray* a = cast<GcIntArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
         a->body()[index] = value;
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -1690,65 +2254,67 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case iconst_m1: {
-    pushInt(t, static_cast<unsigned>(-1));
+  INSTRUCTION(iconst_m1): {
+    pushInt(t, sp, static_cast<unsigned>(-1));
   }
-    goto loop;
+    NEXT;
 
-  case iconst_0: {
-    pushInt(t, 0);
+  INSTRUCTION(iconst_0): {
+    pushInt(t, sp, 0);
   }
-    goto loop;
+    NEXT;
 
-  case iconst_1: {
-    pushInt(t, 1);
+  INSTRUCTION(iconst_1): {
+    pushInt(t, sp, 1);
   }
-    goto loop;
+    NEXT;
 
-  case iconst_2: {
-    pushInt(t, 2);
+  INSTRUCTION(iconst_2): {
+    pushInt(t, sp, 2);
   }
-    goto loop;
+    NEXT;
 
-  case iconst_3: {
-    pushInt(t, 3);
+  INSTRUCTION(iconst_3): {
+    pushInt(t, sp, 3);
   }
-    goto loop;
+    NEXT;
 
-  case iconst_4: {
-    pushInt(t, 4);
+  INSTRUCTION(iconst_4): {
+    pushInt(t, sp, 4);
   }
-    goto loop;
+    NEXT;
 
-  case iconst_5: {
-    pushInt(t, 5);
+  INSTRUCTION(iconst_5): {
+    pushInt(t, sp, 5);
   }
-    goto loop;
+    NEXT;
 
-  case idiv: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(idiv): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (UNLIKELY(b == 0)) {
+      SAVE_STATE;
       exception = makeThrowable(t, GcArithmeticException::Type);
       goto throw_;
     }
 
-    pushInt(t, a / b);
+    pushInt(t, sp, a / b);
   }
-    goto loop;
+    NEXT;
 
-  case if_acmpeq: {
+  INSTRUCTION(if_acmpeq): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    object b = popObject(t);
-    object a = popObject(t);
+    object b = popObject(t, sp);
+    object a = popObject(t, sp);
 
     if (a == b) {
       ip = (ip - 3) + offset;
@@ -1756,11 +2322,11 @@ loop:
   }
     goto back_branch;
 
-  case if_acmpne: {
+  INSTRUCTION(if_acmpne): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    object b = popObject(t);
-    object a = popObject(t);
+    object b = popObject(t, sp);
+    object a = popObject(t, sp);
 
     if (a != b) {
       ip = (ip - 3) + offset;
@@ -1768,11 +2334,11 @@ loop:
   }
     goto back_branch;
 
-  case if_icmpeq: {
+  INSTRUCTION(if_icmpeq): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (a == b) {
       ip = (ip - 3) + offset;
@@ -1780,11 +2346,11 @@ loop:
   }
     goto back_branch;
 
-  case if_icmpne: {
+  INSTRUCTION(if_icmpne): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (a != b) {
       ip = (ip - 3) + offset;
@@ -1792,11 +2358,11 @@ loop:
   }
     goto back_branch;
 
-  case if_icmpgt: {
+  INSTRUCTION(if_icmpgt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (a > b) {
       ip = (ip - 3) + offset;
@@ -1804,11 +2370,11 @@ loop:
   }
     goto back_branch;
 
-  case if_icmpge: {
+  INSTRUCTION(if_icmpge): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (a >= b) {
       ip = (ip - 3) + offset;
@@ -1816,11 +2382,11 @@ loop:
   }
     goto back_branch;
 
-  case if_icmplt: {
+  INSTRUCTION(if_icmplt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (a < b) {
       ip = (ip - 3) + offset;
@@ -1828,11 +2394,11 @@ loop:
   }
     goto back_branch;
 
-  case if_icmple: {
+  INSTRUCTION(if_icmple): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (a <= b) {
       ip = (ip - 3) + offset;
@@ -1840,133 +2406,187 @@ loop:
   }
     goto back_branch;
 
-  case ifeq: {
+  INSTRUCTION(ifeq): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (popInt(t) == 0) {
+    if (popInt(t, sp) == 0) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case ifne: {
+  INSTRUCTION(ifne): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (popInt(t)) {
+    if (popInt(t, sp)) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case ifgt: {
+  INSTRUCTION(ifgt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (static_cast<int32_t>(popInt(t)) > 0) {
+    if (static_cast<int32_t>(popInt(t, sp)) > 0) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case ifge: {
+  INSTRUCTION(ifge): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (static_cast<int32_t>(popInt(t)) >= 0) {
+    if (static_cast<int32_t>(popInt(t, sp)) >= 0) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case iflt: {
+  INSTRUCTION(iflt): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (static_cast<int32_t>(popInt(t)) < 0) {
+    if (static_cast<int32_t>(popInt(t, sp)) < 0) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case ifle: {
+  INSTRUCTION(ifle): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (static_cast<int32_t>(popInt(t)) <= 0) {
+    if (static_cast<int32_t>(popInt(t, sp)) <= 0) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case ifnonnull: {
+  INSTRUCTION(ifnonnull): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (popObject(t)) {
+    if (popObject(t, sp)) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case ifnull: {
+  INSTRUCTION(ifnull): {
     int16_t offset = codeReadInt16(t, code, ip);
 
-    if (popObject(t) == 0) {
+    if (popObject(t, sp) == 0) {
       ip = (ip - 3) + offset;
     }
   }
     goto back_branch;
 
-  case iinc: {
+  INSTRUCTION(iinc): {
     uint8_t index = code->body()[ip++];
     int8_t c = code->body()[ip++];
 
-    setLocalInt(t, index, localInt(t, index) + c);
+    setLocalInt(t, localBase, index, localInt(t, localBase, index) + c);
+
+    if (code->body()[ip] == goto_) {
+      quicken(code, ip - 3, iinc_goto);
+    }
   }
-    goto loop;
+    NEXT;
 
-  case iload:
-  case fload: {
-    pushInt(t, localInt(t, code->body()[ip++]));
+  INSTRUCTION(iinc_goto): {
+    uint8_t index = code->body()[ip++];
+    int8_t c = code->body()[ip++];
+
+    setLocalInt(t, localBase, index, localInt(t, localBase, index) + c);
+
+    ++ip;
+    int16_t offset = codeReadInt16(t, code, ip);
+    ip = (ip - 3) + offset;
   }
-    goto loop;
+    goto back_branch;
+
+  INSTRUCTION(iload):
+  INSTRUCTION(fload): {
+    pushInt(t, sp, localInt(t, localBase, code->body()[ip++]));
 
-  case iload_0:
-  case fload_0: {
-    pushInt(t, localInt(t, 0));
+    fuseIntCompare(code, ip - 2, ip, iload_iload_if_icmp);
   }
-    goto loop;
+    NEXT;
 
-  case iload_1:
-  case fload_1: {
-    pushInt(t, localInt(t, 1));
+  INSTRUCTION(iload_iload_if_icmp): {
+    uint8_t index = code->body()[ip++];
+    ip = loadAndCompare(t, code, localBase, ip, localInt(t, localBase, index));
   }
-    goto loop;
+    goto back_branch;
+
+  INSTRUCTION(iload_0):
+  INSTRUCTION(fload_0): {
+    pushInt(t, sp, localInt(t, localBase, 0));
 
-  case iload_2:
-  case fload_2: {
-    pushInt(t, localInt(t, 2));
+    fuseIntCompare(code, ip - 1, ip, iload_0_iload_if_icmp);
   }
-    goto loop;
+    NEXT;
 
-  case iload_3:
-  case fload_3: {
-    pushInt(t, localInt(t, 3));
+  INSTRUCTION(iload_0_iload_if_icmp): {
+    ip = loadAndCompare(t, code, localBase, ip, localInt(t, localBase, 0));
   }
-    goto loop;
+    goto back_branch;
 
-  case imul: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(iload_1):
+  INSTRUCTION(fload_1): {
+    pushInt(t, sp, localInt(t, localBase, 1));
 
-    pushInt(t, a * b);
+    fuseIntCompare(code, ip - 1, ip, iload_1_iload_if_icmp);
   }
-    goto loop;
+    NEXT;
 
-  case ineg: {
-    pushInt(t, -popInt(t));
+  INSTRUCTION(iload_1_iload_if_icmp): {
+    ip = loadAndCompare(t, code, localBase, ip, localInt(t, localBase, 1));
   }
-    goto loop;
+    goto back_branch;
 
-  case instanceof: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(iload_2):
+  INSTRUCTION(fload_2): {
+    pushInt(t, sp, localInt(t, localBase, 2));
 
-    if (peekObject(t, sp - 1)) {
+    fuseIntCompare(code, ip - 1, ip, iload_2_iload_if_icmp);
+  }
+    NEXT;
+
+  INSTRUCTION(iload_2_iload_if_icmp): {
+    ip = loadAndCompare(t, code, localBase, ip, localInt(t, localBase, 2));
+  }
+    goto back_branch;
+
+  INSTRUCTION(iload_3):
+  INSTRUCTION(fload_3): {
+    pushInt(t, sp, localInt(t, localBase, 3));
+
+    fuseIntCompare(code, ip - 1, ip, iload_3_iload_if_icmp);
+  }
+    NEXT;
+
+  INSTRUCTION(iload_3_iload_if_icmp): {
+    ip = loadAndCompare(t, code, localBase, ip, localInt(t, localBase, 3));
+  }
+    goto back_branch;
+
+  INSTRUCTION(imul): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
+
+    pushInt(t, sp, a * b);
+  }
+    NEXT;
+
+  INSTRUCTION(ineg): {
+    pushInt(t, sp, -popInt(t, sp));
+  }
+    NEXT;
+
+  INSTRUCTION(instanceof): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    if (peekObject(t, t->sp - 1)) {
       GcClass* class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
 
       if (instanceOf(t, class_, popObject(t))) {
@@ -1979,12 +2599,14 @@ loop:
       pushInt(t, 0);
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case invokedynamic: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(invokedynamic): {
+    SAVE_STATE;
 
-    ip += 2;
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    t->ip += 2;
 
     GcInvocation* invocation = cast<GcInvocation>(t, singletonObject(t, code->pool(), index - 1));
 
@@ -2009,32 +2631,36 @@ loop:
     method = site->target()->method();
   } goto invoke;
 
-  case invokeinterface: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(invokeinterface): {
+    SAVE_STATE;
 
-    ip += 2;
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    t->ip += 2;
 
     GcMethod* m = resolveMethod(t, frameMethod(t, frame), index - 1);
 
     unsigned parameterFootprint = m->parameterFootprint();
-    if (LIKELY(peekObject(t, sp - parameterFootprint))) {
+    if (LIKELY(peekObject(t, t->sp - parameterFootprint))) {
       method = findInterfaceMethod(
-          t, m, objectClass(t, peekObject(t, sp - parameterFootprint)));
+          t, m, objectClass(t, peekObject(t, t->sp - parameterFootprint)));
       goto invoke;
     } else {
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case invokespecial: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(invokespecial): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcMethod* m = resolveMethod(t, frameMethod(t, frame), index - 1);
 
     unsigned parameterFootprint = m->parameterFootprint();
-    if (LIKELY(peekObject(t, sp - parameterFootprint))) {
+    if (LIKELY(peekObject(t, t->sp - parameterFootprint))) {
       GcClass* class_ = frameMethod(t, frame)->class_();
       if (isSpecialMethod(t, m, class_)) {
         class_ = class_->super();
@@ -2045,6 +2671,10 @@ loop:
 
         method = findVirtualMethod(t, m, class_);
       } else {
+        // the resolved method is the one to call every time, so there's
+        // nothing left to look up
+        quicken(code, t->ip - 3, invokespecial_quick);
+
         method = m;
       }
 
@@ -2054,28 +2684,66 @@ loop:
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case invokestatic: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(invokespecial_quick): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    GcMethod* m = resolvedPoolEntry<GcMethod>(t, code, index - 1);
+
+    if (LIKELY(peekObject(t, t->sp - m->parameterFootprint()))) {
+      method = m;
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    LOAD_STATE_AND_NEXT;
+
+  INSTRUCTION(invokestatic): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcMethod* m = resolveMethod(t, frameMethod(t, frame), index - 1);
     PROTECT(t, m);
 
     initClass(t, m->class_());
 
+    // as with new, only skip initClass once initialization has finished
+    if ((m->class_()->vmFlags() & (NeedInitFlag | InitFlag)) == 0) {
+      quicken(code, t->ip - 3, invokestatic_quick);
+    }
+
     method = m;
   }
     goto invoke;
 
-  case invokevirtual: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(invokestatic_quick): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    method = resolvedPoolEntry<GcMethod>(t, code, index - 1);
+  }
+    goto invoke;
+
+  INSTRUCTION(invokevirtual): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcMethod* m = resolveMethod(t, frameMethod(t, frame), index - 1);
 
+    quicken(code, t->ip - 3, invokevirtual_quick);
+
     unsigned parameterFootprint = m->parameterFootprint();
-    if (LIKELY(peekObject(t, sp - parameterFootprint))) {
-      GcClass* class_ = objectClass(t, peekObject(t, sp - parameterFootprint));
+    if (LIKELY(peekObject(t, t->sp - parameterFootprint))) {
+      GcClass* class_
+          = objectClass(t, peekObject(t, t->sp - parameterFootprint));
       PROTECT(t, m);
       PROTECT(t, class_);
 
@@ -2086,160 +2754,185 @@ loop:
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
+
+  INSTRUCTION(invokevirtual_quick): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    GcMethod* m = resolvedPoolEntry<GcMethod>(t, code, index - 1);
+
+    unsigned parameterFootprint = m->parameterFootprint();
+    if (LIKELY(peekObject(t, t->sp - parameterFootprint))) {
+      method = findVirtualMethod(
+          t, m, objectClass(t, peekObject(t, t->sp - parameterFootprint)));
+      goto invoke;
+    } else {
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    LOAD_STATE_AND_NEXT;
 
-  case ior: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(ior): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a | b);
+    pushInt(t, sp, a | b);
   }
-    goto loop;
+    NEXT;
 
-  case irem: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(irem): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
     if (UNLIKELY(b == 0)) {
+      SAVE_STATE;
       exception = makeThrowable(t, GcArithmeticException::Type);
       goto throw_;
     }
 
-    pushInt(t, a % b);
+    pushInt(t, sp, a % b);
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(ireturn):
+  INSTRUCTION(freturn): {
+    SAVE_STATE;
 
-  case ireturn:
-  case freturn: {
     int32_t result = popInt(t);
     if (frame > base) {
       popFrame(t);
       pushInt(t, result);
-      goto loop;
+      LOAD_STATE_AND_NEXT;
     } else {
       return makeInt(t, result);
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case ishl: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(ishl): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a << (b & 0x1F));
+    pushInt(t, sp, a << (b & 0x1F));
   }
-    goto loop;
+    NEXT;
 
-  case ishr: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(ishr): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a >> (b & 0x1F));
+    pushInt(t, sp, a >> (b & 0x1F));
   }
-    goto loop;
+    NEXT;
 
-  case istore:
-  case fstore: {
-    setLocalInt(t, code->body()[ip++], popInt(t));
+  INSTRUCTION(istore):
+  INSTRUCTION(fstore): {
+    setLocalInt(t, localBase, code->body()[ip++], popInt(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case istore_0:
-  case fstore_0: {
-    setLocalInt(t, 0, popInt(t));
+  INSTRUCTION(istore_0):
+  INSTRUCTION(fstore_0): {
+    setLocalInt(t, localBase, 0, popInt(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case istore_1:
-  case fstore_1: {
-    setLocalInt(t, 1, popInt(t));
+  INSTRUCTION(istore_1):
+  INSTRUCTION(fstore_1): {
+    setLocalInt(t, localBase, 1, popInt(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case istore_2:
-  case fstore_2: {
-    setLocalInt(t, 2, popInt(t));
+  INSTRUCTION(istore_2):
+  INSTRUCTION(fstore_2): {
+    setLocalInt(t, localBase, 2, popInt(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case istore_3:
-  case fstore_3: {
-    setLocalInt(t, 3, popInt(t));
+  INSTRUCTION(istore_3):
+  INSTRUCTION(fstore_3): {
+    setLocalInt(t, localBase, 3, popInt(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case isub: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(isub): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a - b);
+    pushInt(t, sp, a - b);
   }
-    goto loop;
+    NEXT;
 
-  case iushr: {
-    int32_t b = popInt(t);
-    uint32_t a = popInt(t);
+  INSTRUCTION(iushr): {
+    int32_t b = popInt(t, sp);
+    uint32_t a = popInt(t, sp);
 
-    pushInt(t, a >> (b & 0x1F));
+    pushInt(t, sp, a >> (b & 0x1F));
   }
-    goto loop;
+    NEXT;
 
-  case ixor: {
-    int32_t b = popInt(t);
-    int32_t a = popInt(t);
+  INSTRUCTION(ixor): {
+    int32_t b = popInt(t, sp);
+    int32_t a = popInt(t, sp);
 
-    pushInt(t, a ^ b);
+    pushInt(t, sp, a ^ b);
   }
-    goto loop;
+    NEXT;
 
-  case jsr: {
+  INSTRUCTION(jsr): {
     uint16_t offset = codeReadInt16(t, code, ip);
 
-    pushInt(t, ip);
+    pushInt(t, sp, ip);
     ip = (ip - 3) + static_cast<int16_t>(offset);
   }
-    goto loop;
+    NEXT;
 
-  case jsr_w: {
+  INSTRUCTION(jsr_w): {
     uint32_t offset = codeReadInt32(t, code, ip);
 
-    pushInt(t, ip);
+    pushInt(t, sp, ip);
     ip = (ip - 5) + static_cast<int32_t>(offset);
   }
-    goto loop;
+    NEXT;
 
-  case l2d: {
-    pushDouble(t, static_cast<double>(static_cast<int64_t>(popLong(t))));
+  INSTRUCTION(l2d): {
+    pushDouble(t,
+               sp,
+               static_cast<double>(static_cast<int64_t>(popLong(t, sp))));
   }
-    goto loop;
+    NEXT;
 
-  case l2f: {
-    pushFloat(t, static_cast<float>(static_cast<int64_t>(popLong(t))));
+  INSTRUCTION(l2f): {
+    pushFloat(t, sp, static_cast<float>(static_cast<int64_t>(popLong(t, sp))));
   }
-    goto loop;
+    NEXT;
 
-  case l2i: {
-    pushInt(t, static_cast<int32_t>(popLong(t)));
+  INSTRUCTION(l2i): {
+    pushInt(t, sp, static_cast<int32_t>(popLong(t, sp)));
   }
-    goto loop;
+    NEXT;
 
-  case ladd: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(ladd): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a + b);
+    pushLong(t, sp, a + b);
   }
-    goto loop;
+    NEXT;
 
-  case laload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(laload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcLongArray* a = cast<GcLongArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
-        pushLong(t, a->body()[index]);
+        pushLong(t, sp, a->body()[index]);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -2248,30 +2941,32 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case land: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(land): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a & b);
+    pushLong(t, sp, a & b);
   }
-    goto loop;
+    NEXT;
 
-  case lastore: {
-    int64_t value = popLong(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(lastore): {
+    int64_t value = popLong(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcLongArray* a = cast<GcLongArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
         a->body()[index] = value;
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -2280,38 +2975,41 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case lcmp: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lcmp): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushInt(t, a > b ? 1 : a == b ? 0 : -1);
+    pushInt(t, sp, a > b ? 1 : a == b ? 0 : -1);
   }
-    goto loop;
+    NEXT;
 
-  case lconst_0: {
-    pushLong(t, 0);
+  INSTRUCTION(lconst_0): {
+    pushLong(t, sp, 0);
   }
-    goto loop;
+    NEXT;
 
-  case lconst_1: {
-    pushLong(t, 1);
+  INSTRUCTION(lconst_1): {
+    pushLong(t, sp, 1);
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(ldc):
+  INSTRUCTION(ldc_w): {
+    SAVE_STATE;
 
-  case ldc:
-  case ldc_w: {
     uint16_t index;
 
     if (instruction == ldc) {
-      index = code->body()[ip++];
+      index = code->body()[t->ip++];
     } else {
-      index = codeReadInt16(t, code, ip);
+      index = codeReadInt16(t, code, t->ip);
     }
 
     GcSingleton* pool = code->pool();
@@ -2333,10 +3031,12 @@ loop:
       pushInt(t, singletonValue(t, pool, index - 1));
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case ldc2_w: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(ldc2_w): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcSingleton* pool = code->pool();
 
@@ -2344,65 +3044,66 @@ loop:
     memcpy(&v, &singletonValue(t, pool, index - 1), 8);
     pushLong(t, v);
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case ldiv_: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(ldiv_): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
     if (UNLIKELY(b == 0)) {
+      SAVE_STATE;
       exception = makeThrowable(t, GcArithmeticException::Type);
       goto throw_;
     }
 
-    pushLong(t, a / b);
+    pushLong(t, sp, a / b);
   }
-    goto loop;
+    NEXT;
 
-  case lload:
-  case dload: {
-    pushLong(t, localLong(t, code->body()[ip++]));
+  INSTRUCTION(lload):
+  INSTRUCTION(dload): {
+    pushLong(t, sp, localLong(t, localBase, code->body()[ip++]));
   }
-    goto loop;
+    NEXT;
 
-  case lload_0:
-  case dload_0: {
-    pushLong(t, localLong(t, 0));
+  INSTRUCTION(lload_0):
+  INSTRUCTION(dload_0): {
+    pushLong(t, sp, localLong(t, localBase, 0));
   }
-    goto loop;
+    NEXT;
 
-  case lload_1:
-  case dload_1: {
-    pushLong(t, localLong(t, 1));
+  INSTRUCTION(lload_1):
+  INSTRUCTION(dload_1): {
+    pushLong(t, sp, localLong(t, localBase, 1));
   }
-    goto loop;
+    NEXT;
 
-  case lload_2:
-  case dload_2: {
-    pushLong(t, localLong(t, 2));
+  INSTRUCTION(lload_2):
+  INSTRUCTION(dload_2): {
+    pushLong(t, sp, localLong(t, localBase, 2));
   }
-    goto loop;
+    NEXT;
 
-  case lload_3:
-  case dload_3: {
-    pushLong(t, localLong(t, 3));
+  INSTRUCTION(lload_3):
+  INSTRUCTION(dload_3): {
+    pushLong(t, sp, localLong(t, localBase, 3));
   }
-    goto loop;
+    NEXT;
 
-  case lmul: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lmul): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a * b);
+    pushLong(t, sp, a * b);
   }
-    goto loop;
+    NEXT;
 
-  case lneg: {
-    pushLong(t, -popLong(t));
+  INSTRUCTION(lneg): {
+    pushLong(t, sp, -popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case lookupswitch: {
+  INSTRUCTION(lookupswitch): {
     int32_t base = ip - 1;
 
     ip += 3;
@@ -2411,7 +3112,7 @@ loop:
     int32_t default_ = codeReadInt32(t, code, ip);
     int32_t pairCount = codeReadInt32(t, code, ip);
 
-    int32_t key = popInt(t);
+    int32_t key = popInt(t, sp);
 
     int32_t bottom = 0;
     int32_t top = pairCount;
@@ -2427,119 +3128,124 @@ loop:
         bottom = middle + 1;
       } else {
         ip = base + codeReadInt32(t, code, index);
-        goto loop;
+        NEXT;
       }
     }
 
     ip = base + default_;
   }
-    goto loop;
+    NEXT;
 
-  case lor: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lor): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a | b);
+    pushLong(t, sp, a | b);
   }
-    goto loop;
+    NEXT;
 
-  case lrem: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lrem): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
     if (UNLIKELY(b == 0)) {
+      SAVE_STATE;
       exception = makeThrowable(t, GcArithmeticException::Type);
       goto throw_;
     }
 
-    pushLong(t, a % b);
+    pushLong(t, sp, a % b);
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(lreturn):
+  INSTRUCTION(dreturn): {
+    SAVE_STATE;
 
-  case lreturn:
-  case dreturn: {
     int64_t result = popLong(t);
     if (frame > base) {
       popFrame(t);
       pushLong(t, result);
-      goto loop;
+      LOAD_STATE_AND_NEXT;
     } else {
       return makeLong(t, result);
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case lshl: {
-    int32_t b = popInt(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lshl): {
+    int32_t b = popInt(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a << (b & 0x3F));
+    pushLong(t, sp, a << (b & 0x3F));
   }
-    goto loop;
+    NEXT;
 
-  case lshr: {
-    int32_t b = popInt(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lshr): {
+    int32_t b = popInt(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a >> (b & 0x3F));
+    pushLong(t, sp, a >> (b & 0x3F));
   }
-    goto loop;
+    NEXT;
 
-  case lstore:
-  case dstore: {
-    setLocalLong(t, code->body()[ip++], popLong(t));
+  INSTRUCTION(lstore):
+  INSTRUCTION(dstore): {
+    setLocalLong(t, localBase, code->body()[ip++], popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case lstore_0:
-  case dstore_0: {
-    setLocalLong(t, 0, popLong(t));
+  INSTRUCTION(lstore_0):
+  INSTRUCTION(dstore_0): {
+    setLocalLong(t, localBase, 0, popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case lstore_1:
-  case dstore_1: {
-    setLocalLong(t, 1, popLong(t));
+  INSTRUCTION(lstore_1):
+  INSTRUCTION(dstore_1): {
+    setLocalLong(t, localBase, 1, popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case lstore_2:
-  case dstore_2: {
-    setLocalLong(t, 2, popLong(t));
+  INSTRUCTION(lstore_2):
+  INSTRUCTION(dstore_2): {
+    setLocalLong(t, localBase, 2, popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case lstore_3:
-  case dstore_3: {
-    setLocalLong(t, 3, popLong(t));
+  INSTRUCTION(lstore_3):
+  INSTRUCTION(dstore_3): {
+    setLocalLong(t, localBase, 3, popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
-  case lsub: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lsub): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a - b);
+    pushLong(t, sp, a - b);
   }
-    goto loop;
+    NEXT;
 
-  case lushr: {
-    int64_t b = popInt(t);
-    uint64_t a = popLong(t);
+  INSTRUCTION(lushr): {
+    int64_t b = popInt(t, sp);
+    uint64_t a = popLong(t, sp);
 
-    pushLong(t, a >> (b & 0x3F));
+    pushLong(t, sp, a >> (b & 0x3F));
   }
-    goto loop;
+    NEXT;
 
-  case lxor: {
-    int64_t b = popLong(t);
-    int64_t a = popLong(t);
+  INSTRUCTION(lxor): {
+    int64_t b = popLong(t, sp);
+    int64_t a = popLong(t, sp);
 
-    pushLong(t, a ^ b);
+    pushLong(t, sp, a ^ b);
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(monitorenter): {
+    SAVE_STATE;
 
-  case monitorenter: {
     object o = popObject(t);
     if (LIKELY(o)) {
       acquire(t, o);
@@ -2548,9 +3254,11 @@ loop:
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
+
+  INSTRUCTION(monitorexit): {
+    SAVE_STATE;
 
-  case monitorexit: {
     object o = popObject(t);
     if (LIKELY(o)) {
       release(t, o);
@@ -2559,11 +3267,13 @@ loop:
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case multianewarray: {
-    uint16_t index = codeReadInt16(t, code, ip);
-    uint8_t dimensions = code->body()[ip++];
+  INSTRUCTION(multianewarray): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+    uint8_t dimensions = code->body()[t->ip++];
 
     GcClass* class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
     PROTECT(t, class_);
@@ -2588,25 +3298,44 @@ loop:
 
     pushObject(t, array);
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case new_: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(new_): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcClass* class_ = resolveClassInPool(t, frameMethod(t, frame), index - 1);
     PROTECT(t, class_);
 
     initClass(t, class_);
 
+    // a class still being initialized by this thread may yet fail to
+    // initialize, so only quicken once initialization has finished
+    if ((class_->vmFlags() & (NeedInitFlag | InitFlag)) == 0) {
+      quicken(code, t->ip - 3, new_quick);
+    }
+
     pushObject(t, make(t, class_));
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
+
+  INSTRUCTION(new_quick): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
+    pushObject(t, make(t, resolvedPoolEntry<GcClass>(t, code, index - 1)));
+  }
+    LOAD_STATE_AND_NEXT;
+
+  INSTRUCTION(newarray): {
+    SAVE_STATE;
 
-  case newarray: {
     int32_t count = popInt(t);
 
     if (LIKELY(count >= 0)) {
-      uint8_t type = code->body()[ip++];
+      uint8_t type = code->body()[t->ip++];
 
       object array;
 
@@ -2654,23 +3383,25 @@ loop:
       goto throw_;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case nop:
-    goto loop;
+  INSTRUCTION(nop):
+    NEXT;
 
-  case pop_: {
+  INSTRUCTION(pop_): {
     --sp;
   }
-    goto loop;
+    NEXT;
 
-  case pop2: {
+  INSTRUCTION(pop2): {
     sp -= 2;
   }
-    goto loop;
+    NEXT;
 
-  case putfield: {
-    uint16_t index = codeReadInt16(t, code, ip);
+  INSTRUCTION(putfield): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
 
     GcField* field = resolveField(t, frameMethod(t, frame), index - 1);
 
@@ -2716,7 +3447,7 @@ loop:
         int64_t value = popLong(t);
         object o = popObject(t);
         if (LIKELY(o)) {
-          fieldAtOffset<int64_t>(o, field->offset()) = value;
+          setWideField(t, o, field, value);
         } else {
           exception = makeThrowable(t, GcNullPointerException::Type);
         }
@@ -2740,12 +3471,53 @@ loop:
     if (UNLIKELY(exception)) {
       goto throw_;
     }
+
+    if ((field->flags() & ACC_VOLATILE) == 0
+        and quickPutField(field) != putfield) {
+      quicken(code, t->ip - 3, quickPutField(field));
+    }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case putstatic: {
+  INSTRUCTION(putfield_quick_int): {
     uint16_t index = codeReadInt16(t, code, ip);
 
+    GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
+
+    int32_t value = popInt(t, sp);
+    object o = popObject(t, sp);
+    if (LIKELY(o)) {
+      fieldAtOffset<int32_t>(o, field->offset()) = value;
+    } else {
+      SAVE_STATE;
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    NEXT;
+
+  INSTRUCTION(putfield_quick_object): {
+    uint16_t index = codeReadInt16(t, code, ip);
+
+    GcField* field = resolvedPoolEntry<GcField>(t, code, index - 1);
+
+    object value = popObject(t, sp);
+    object o = popObject(t, sp);
+    if (LIKELY(o)) {
+      setField(t, o, field->offset(), value);
+    } else {
+      SAVE_STATE;
+      exception = makeThrowable(t, GcNullPointerException::Type);
+      goto throw_;
+    }
+  }
+    NEXT;
+
+  INSTRUCTION(putstatic): {
+    SAVE_STATE;
+
+    uint16_t index = codeReadInt16(t, code, t->ip);
+
     GcField* field = resolveField(t, frameMethod(t, frame), index - 1);
 
     assertT(t, field->flags() & ACC_STATIC);
@@ -2786,7 +3558,7 @@ loop:
 
     case DoubleField:
     case LongField: {
-      fieldAtOffset<int64_t>(table, field->offset()) = popLong(t);
+      setWideField(t, table, field, popLong(t));
     } break;
 
     case ObjectField: {
@@ -2797,14 +3569,16 @@ loop:
       abort(t);
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case ret: {
-    ip = localInt(t, code->body()[ip]);
+  INSTRUCTION(ret): {
+    ip = localInt(t, localBase, code->body()[ip]);
   }
-    goto loop;
+    NEXT;
+
+  INSTRUCTION(return_): {
+    SAVE_STATE;
 
-  case return_: {
     GcMethod* method = frameMethod(t, frame);
     if ((method->flags() & ConstructorFlag)
         and (method->class_()->vmFlags() & HasFinalMemberFlag)) {
@@ -2813,22 +3587,23 @@ loop:
 
     if (frame > base) {
       popFrame(t);
-      goto loop;
+      LOAD_STATE_AND_NEXT;
     } else {
       return 0;
     }
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
-  case saload: {
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(saload): {
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcShortArray* a = cast<GcShortArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
-        pushInt(t, a->body()[index]);
+        pushInt(t, sp, a->body()[index]);
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -2837,22 +3612,24 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case sastore: {
-    int16_t value = popInt(t);
-    int32_t index = popInt(t);
-    object array = popObject(t);
+  INSTRUCTION(sastore): {
+    int16_t value = popInt(t, sp);
+    int32_t index = popInt(t, sp);
+    object array = popObject(t, sp);
 
     if (LIKELY(array)) {
       GcShortArray* a = cast<GcShortArray>(t, array);
       if (LIKELY(index >= 0 and static_cast<uintptr_t>(index) < a->length())) {
         a->body()[index] = value;
       } else {
+        SAVE_STATE;
         exception = makeThrowable(t,
                                   GcArrayIndexOutOfBoundsException::Type,
                                   "%d not in [0,%d)",
@@ -2861,26 +3638,27 @@ loop:
         goto throw_;
       }
     } else {
+      SAVE_STATE;
       exception = makeThrowable(t, GcNullPointerException::Type);
       goto throw_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case sipush: {
-    pushInt(t, static_cast<int16_t>(codeReadInt16(t, code, ip)));
+  INSTRUCTION(sipush): {
+    pushInt(t, sp, static_cast<int16_t>(codeReadInt16(t, code, ip)));
   }
-    goto loop;
+    NEXT;
 
-  case swap: {
+  INSTRUCTION(swap): {
     uintptr_t tmp[2];
     memcpy(tmp, stack + ((sp - 1) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 1) * 2), stack + ((sp - 2) * 2), BytesPerWord * 2);
     memcpy(stack + ((sp - 2) * 2), tmp, BytesPerWord * 2);
   }
-    goto loop;
+    NEXT;
 
-  case tableswitch: {
+  INSTRUCTION(tableswitch): {
     int32_t base = ip - 1;
 
     ip += 3;
@@ -2890,7 +3668,7 @@ loop:
     int32_t bottom = codeReadInt32(t, code, ip);
     int32_t top = codeReadInt32(t, code, ip);
 
-    int32_t key = popInt(t);
+    int32_t key = popInt(t, sp);
 
     if (key >= bottom and key <= top) {
       unsigned index = ip + ((key - bottom) * 4);
@@ -2899,12 +3677,14 @@ loop:
       ip = base + default_;
     }
   }
-    goto loop;
+    NEXT;
 
-  case wide:
+  INSTRUCTION(wide):
     goto wide;
 
-  case impdep1: {
+  INSTRUCTION(impdep1): {
+    SAVE_STATE;
+
     // this means we're invoking a virtual method on an instance of a
     // bootstrap class, so we need to load the real class to get the
     // real method and call it.
@@ -2912,78 +3692,84 @@ loop:
     assertT(t, frameNext(t, frame) >= base);
     popFrame(t);
 
-    assertT(t, code->body()[ip - 3] == invokevirtual);
-    ip -= 2;
+    assertT(t,
+            code->body()[t->ip - 3] == invokevirtual
+            or code->body()[t->ip - 3] == invokevirtual_quick);
+    t->ip -= 2;
 
-    uint16_t index = codeReadInt16(t, code, ip);
+    uint16_t index = codeReadInt16(t, code, t->ip);
     GcMethod* method = resolveMethod(t, frameMethod(t, frame), index - 1);
 
     unsigned parameterFootprint = method->parameterFootprint();
-    GcClass* class_ = objectClass(t, peekObject(t, sp - parameterFootprint));
+    GcClass* class_ = objectClass(t, peekObject(t, t->sp - parameterFootprint));
     assertT(t, class_->vmFlags() & BootstrapFlag);
 
     resolveClass(t, frameMethod(t, frame)->class_()->loader(), class_->name());
 
-    ip -= 3;
+    t->ip -= 3;
   }
-    goto loop;
+    LOAD_STATE_AND_NEXT;
 
   default:
+#ifdef AVIAN_THREADED_DISPATCH
+  op_invalid:
+#endif
     abort(t);
   }
 
 wide:
   switch (code->body()[ip++]) {
   case aload: {
-    pushObject(t, localObject(t, codeReadInt16(t, code, ip)));
+    pushObject(t, sp, localObject(t, localBase, codeReadInt16(t, code, ip)));
   }
-    goto loop;
+    NEXT;
 
   case astore: {
-    setLocalObject(t, codeReadInt16(t, code, ip), popObject(t));
+    setLocalObject(t, localBase, codeReadInt16(t, code, ip), popObject(t, sp));
   }
-    goto loop;
+    NEXT;
 
   case iinc: {
     uint16_t index = codeReadInt16(t, code, ip);
     int16_t count = codeReadInt16(t, code, ip);
 
-    setLocalInt(t, index, localInt(t, index) + count);
+    setLocalInt(t, localBase, index, localInt(t, localBase, index) + count);
   }
-    goto loop;
+    NEXT;
 
   case iload: {
-    pushInt(t, localInt(t, codeReadInt16(t, code, ip)));
+    pushInt(t, sp, localInt(t, localBase, codeReadInt16(t, code, ip)));
   }
-    goto loop;
+    NEXT;
 
   case istore: {
-    setLocalInt(t, codeReadInt16(t, code, ip), popInt(t));
+    setLocalInt(t, localBase, codeReadInt16(t, code, ip), popInt(t, sp));
   }
-    goto loop;
+    NEXT;
 
   case lload: {
-    pushLong(t, localLong(t, codeReadInt16(t, code, ip)));
+    pushLong(t, sp, localLong(t, localBase, codeReadInt16(t, code, ip)));
   }
-    goto loop;
+    NEXT;
 
   case lstore: {
-    setLocalLong(t, codeReadInt16(t, code, ip), popLong(t));
+    setLocalLong(t, localBase, codeReadInt16(t, code, ip), popLong(t, sp));
   }
-    goto loop;
+    NEXT;
 
   case ret: {
-    ip = localInt(t, codeReadInt16(t, code, ip));
+    ip = localInt(t, localBase, codeReadInt16(t, code, ip));
   }
-    goto loop;
+    NEXT;
 
   default:
     abort(t);
   }
 
 back_branch:
+  SAVE_STATE;
   safePoint(t);
-  goto loop;
+  NEXT;
 
 invoke : {
   if (method->flags() & ACC_NATIVE) {
@@ -2993,7 +3779,7 @@ invoke : {
     pushFrame(t, method);
   }
 }
-  goto loop;
+  LOAD_STATE_AND_NEXT;
 
 throw_:
   if (DebugRun) {
@@ -3006,9 +3792,10 @@ throw_:
     if (eh) {
       sp = frame + FrameFootprint;
       ip = exceptionHandlerIp(eh);
-      pushObject(t, exception);
+      localBase = frameBase(t, frame);
+      pushObject(t, sp, exception);
       exception = 0;
-      goto loop;
+      NEXT;
     }
   }
 
@@ -3227,17 +4014,30 @@ object invoke(Thread* t, GcMethod* method)
 class MyProcessor : public Processor {
  public:
   MyProcessor(System* s, Allocator* allocator, const char* crashDumpDirectory)
-      : s(s), allocator(allocator)
+      : s(s), allocator(allocator), instructionPairs(0)
   {
+    memset(&statistics, 0, sizeof(statistics));
+
     signals.setCrashDumpDirectory(crashDumpDirectory);
+
+    if (ProfileInstructionPairs) {
+      instructionPairs = static_cast<uint64_t*>(
+          allocator->allocate(256 * 256 * sizeof(uint64_t)));
+      memset(instructionPairs, 0, 256 * 256 * sizeof(uint64_t));
+    }
   }
 
   virtual vm::Thread* makeThread(Machine* m,
                                  GcThread* javaThread,
                                  vm::Thread* parent)
   {
-    Thread* t = new (m->heap->allocate(sizeof(Thread) + m->stackSizeInBytes))
-        Thread(m, javaThread, parent);
+    // the stack makes up most of this, so we map it straight from the
+    // system, which only commits the pages a thread actually touches
+    avian::util::Slice<uint8_t> memory
+        = Memory::allocate(sizeof(Thread) + m->stackSizeInBytes);
+    expect(m->system, memory.begin());
+
+    Thread* t = new (memory.begin()) Thread(m, javaThread, parent);
     t->init();
     return t;
   }
@@ -3311,6 +4111,11 @@ class MyProcessor : public Processor {
                          staticTable,
                          loader,
                          0,
+                         0,
+                         0,
+                         0,
+                         0,
+                         0,
                          0);
   }
 
@@ -3493,7 +4298,41 @@ class MyProcessor : public Processor {
   virtual object getStackTrace(vm::Thread* t, vm::Thread*)
   {
     // not implemented
-    return makeObjectArray(t, 0);
+    return makeEmptyTrace(t);
+  }
+
+  virtual void sampleStack(vm::Thread* t,
+                           vm::Thread* vmTarget,
+                           StackVisitor* v)
+  {
+    Thread* target = static_cast<Thread*>(vmTarget);
+
+    class Visitor : public System::ThreadVisitor {
+     public:
+      Visitor(Thread* target, StackVisitor* v) : target(target), v(v)
+      {
+      }
+
+      // the frames are all in the thread's stack array, so the
+      // registers tell us nothing we need; the top frame's ip is only
+      // as current as its last call, which is good enough for a sample
+      virtual void visit(void*, void*, void*)
+      {
+        MyStackWalker walker(target, target->frame);
+        walker.walk(v);
+      }
+
+      Thread* target;
+      StackVisitor* v;
+    } visitor(target, v);
+
+    t->m->system->visit(t->systemThread, target->systemThread, &visitor);
+  }
+
+  virtual const CompileStatistics& compileStatistics()
+  {
+    // nothing is compiled
+    return statistics;
   }
 
   virtual void initialize(BootImage*, avian::util::Slice<uint8_t>)
@@ -3518,6 +4357,11 @@ class MyProcessor : public Processor {
     abort(s);
   }
 
+  virtual void precompile(vm::Thread*, GcMethod*)
+  {
+    // ignore
+  }
+
   virtual void visitRoots(vm::Thread*, HeapWalker*)
   {
     abort(s);
@@ -3538,6 +4382,11 @@ class MyProcessor : public Processor {
     expect(s, image == 0 and code == 0);
   }
 
+  virtual bool supportsContinuations()
+  {
+    return false;
+  }
+
   virtual void callWithCurrentContinuation(vm::Thread*, object)
   {
     abort(s);
@@ -3570,21 +4419,61 @@ class MyProcessor : public Processor {
 
   virtual void dispose(vm::Thread* t)
   {
-    t->m->heap->free(t, sizeof(Thread) + t->m->stackSizeInBytes);
+    Memory::free(avian::util::Slice<uint8_t>(
+        reinterpret_cast<uint8_t*>(t), sizeof(Thread) + t->m->stackSizeInBytes));
   }
 
   virtual void dispose()
   {
+    if (ProfileInstructionPairs) {
+      printInstructionPairs();
+      allocator->free(instructionPairs, 256 * 256 * sizeof(uint64_t));
+    }
+
     signals.setCrashDumpDirectory(0);
     this->~MyProcessor();
     allocator->free(this, sizeof(*this));
   }
 
+  void printInstructionPairs()
+  {
+    fprintf(stderr, "most frequent instruction pairs:\n");
+
+    for (unsigned i = 0; i < ProfiledPairCount; ++i) {
+      unsigned max = 0;
+      for (unsigned j = 1; j < 256 * 256; ++j) {
+        if (instructionPairs[j] > instructionPairs[max]) {
+          max = j;
+        }
+      }
+
+      if (instructionPairs[max] == 0) {
+        break;
+      }
+
+      fprintf(stderr,
+              "  0x%02x 0x%02x: %" LLD "\n",
+              max >> 8,
+              max & 0xFF,
+              static_cast<int64_t>(instructionPairs[max]));
+
+      instructionPairs[max] = 0;
+    }
+  }
+
   System* s;
   Allocator* allocator;
   SignalRegistrar signals;
+  uint64_t* instructionPairs;
+  CompileStatistics statistics;
 };
 
+void countInstructionPair(Thread* t, unsigned first, unsigned second)
+{
+  ++static_cast<MyProcessor*>(t->m->processor)
+        ->instructionPairs[(first << 8) | second];
+}
+
 }  // namespace
 
 namespace vm {
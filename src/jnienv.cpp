@@ -44,6 +44,13 @@ jint JNICALL DetachCurrentThread(Machine* m)
 {
   Thread* t = static_cast<Thread*>(m->localThread->get());
   if (t) {
+    // with avian.jni.keepAttachedDaemons=true, daemon threads stay
+    // attached, so a native thread which attaches for every callback
+    // only pays for setting up its Thread the first time.
+    if (m->keepAttachedDaemons and (t->getFlags() & Thread::DaemonFlag)) {
+      return 0;
+    }
+
     // todo: detaching the root thread seems to cause stability
     // problems which I haven't yet had a chance to investigate
     // thoroughly.  Meanwhile, we just ignore requests to detach it,
@@ -498,13 +505,86 @@ jboolean JNICALL IsAssignableFrom(Thread* t, jclass b, jclass a)
   return run(t, isAssignableFrom, arguments);
 }
 
+bool equal(GcByteArray* a, const char* b)
+{
+  return strcmp(reinterpret_cast<const char*>(a->body().begin()), b) == 0;
+}
+
+// Native code tends to look up the same IDs over and over, and each
+// lookup by name allocates and searches the class hierarchy, so we
+// remember recent results in roots(t)->jNIIDCache(), a direct-mapped
+// table of (class, member) pairs.  Slots are chosen by name only,
+// since classes may move, and a hit must match the class exactly.
+unsigned idCacheSlot(Thread* t,
+                     GcClass* c,
+                     const char* name,
+                     const char* spec)
+{
+  uint32_t h = (hash(name) * 31) + hash(spec);
+  if (c->name()) {
+    h = (h * 31) + hash(c->name()->body());
+  }
+
+  return h & (roots(t)->jNIIDCache()->length() - 1);
+}
+
+object findCachedMember(Thread* t,
+                        unsigned slot,
+                        GcClass* c,
+                        Gc::Type kind,
+                        const char* name,
+                        const char* spec)
+{
+  GcPair* p = cast<GcPair>(t, roots(t)->jNIIDCache()->body()[slot]);
+  if (p and p->first() == c) {
+    object member = p->second();
+    if (objectClass(t, member) == type(t, kind)) {
+      if (kind == GcField::Type) {
+        GcField* field = cast<GcField>(t, member);
+        if (equal(field->name(), name) and equal(field->spec(), spec)) {
+          return field;
+        }
+      } else {
+        GcMethod* method = cast<GcMethod>(t, member);
+        if (equal(method->name(), name) and equal(method->spec(), spec)) {
+          return method;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+void cacheMember(Thread* t, unsigned slot, GcClass* c, object member)
+{
+  GcPair* p = makePair(t, c, member);
+  // a single store, so concurrent readers see either the old pair or
+  // the new one
+  roots(t)->jNIIDCache()->setBodyElement(t, slot, p);
+}
+
 GcMethod* findMethod(Thread* t, jclass c, const char* name, const char* spec)
 {
-  GcByteArray* n = makeByteArray(t, "%s", name);
-  PROTECT(t, n);
+  GcClass* class_ = (*c)->vmClass();
+  unsigned slot = idCacheSlot(t, class_, name, spec);
+  GcMethod* method = cast<GcMethod>(
+      t, findCachedMember(t, slot, class_, GcMethod::Type, name, spec));
+
+  if (method == 0) {
+    PROTECT(t, class_);
+
+    GcByteArray* n = makeByteArray(t, "%s", name);
+    PROTECT(t, n);
+
+    GcByteArray* s = makeByteArray(t, "%s", spec);
+    method = vm::findMethod(t, class_, n, s);
+
+    PROTECT(t, method);
+    cacheMember(t, slot, class_, method);
+  }
 
-  GcByteArray* s = makeByteArray(t, "%s", spec);
-  return vm::findMethod(t, (*c)->vmClass(), n, s);
+  return method;
 }
 
 jint methodID(Thread* t, GcMethod* method)
@@ -1345,12 +1425,30 @@ jdouble JNICALL
   return bitsToDouble(run(t, callStaticLongMethodA, arguments));
 }
 
+// the launcher calls main this way, which is where startup ends
+void reportStartupAtMain(Thread* t, GcMethod* method)
+{
+  if (::strcmp(reinterpret_cast<const char*>(method->name()->body().begin()),
+               "main") == 0
+      and ::strcmp(
+              reinterpret_cast<const char*>(method->spec()->body().begin()),
+              "([Ljava/lang/String;)V") == 0) {
+    reportStartup(t);
+  }
+}
+
 uint64_t callStaticVoidMethodV(Thread* t, uintptr_t* arguments)
 {
   jmethodID m = arguments[0];
   va_list* a = reinterpret_cast<va_list*>(arguments[1]);
 
-  t->m->processor->invokeList(t, getStaticMethod(t, m), 0, true, *a);
+  GcMethod* method = getStaticMethod(t, m);
+
+  if (t->m->startupTrace) {
+    reportStartupAtMain(t, method);
+  }
+
+  t->m->processor->invokeList(t, method, 0, true, *a);
 
   return 0;
 }
@@ -1377,7 +1475,13 @@ uint64_t callStaticVoidMethodA(Thread* t, uintptr_t* arguments)
   jmethodID m = arguments[0];
   const jvalue* a = reinterpret_cast<const jvalue*>(arguments[1]);
 
-  t->m->processor->invokeArray(t, getStaticMethod(t, m), 0, a);
+  GcMethod* method = getStaticMethod(t, m);
+
+  if (t->m->startupTrace) {
+    reportStartupAtMain(t, method);
+  }
+
+  t->m->processor->invokeArray(t, method, 0, a);
 
   return 0;
 }
@@ -1421,7 +1525,21 @@ uint64_t getFieldID(Thread* t, uintptr_t* arguments)
   const char* name = reinterpret_cast<const char*>(arguments[1]);
   const char* spec = reinterpret_cast<const char*>(arguments[2]);
 
-  return fieldID(t, resolveField(t, (*c)->vmClass(), name, spec));
+  GcClass* class_ = (*c)->vmClass();
+  unsigned slot = idCacheSlot(t, class_, name, spec);
+  GcField* field = cast<GcField>(
+      t, findCachedMember(t, slot, class_, GcField::Type, name, spec));
+
+  if (field == 0) {
+    PROTECT(t, class_);
+
+    field = resolveField(t, class_, name, spec);
+
+    PROTECT(t, field);
+    cacheMember(t, slot, class_, field);
+  }
+
+  return fieldID(t, field);
 }
 
 jfieldID JNICALL
@@ -1455,6 +1573,15 @@ GcField* getField(Thread* t, jfieldID f)
   return field;
 }
 
+// Reads of non-volatile fields need no monitor and can't throw, so
+// the accessors below do them in place rather than through run() and
+// its checkpoint.  Returns null if the field must take the slow path.
+GcField* plainField(Thread* t, jfieldID f)
+{
+  GcField* field = getField(t, f);
+  return UNLIKELY(field->flags() & ACC_VOLATILE) ? 0 : field;
+}
+
 uint64_t getObjectField(Thread* t, uintptr_t* arguments)
 {
   jobject o = reinterpret_cast<jobject>(arguments[0]);
@@ -1469,6 +1596,13 @@ uint64_t getObjectField(Thread* t, uintptr_t* arguments)
 
 jobject JNICALL GetObjectField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return makeLocalReference(t, fieldAtOffset<object>(*o, plain->offset()));
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return reinterpret_cast<jobject>(run(t, getObjectField, arguments));
@@ -1487,6 +1621,13 @@ uint64_t getBooleanField(Thread* t, uintptr_t* arguments)
 
 jboolean JNICALL GetBooleanField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jboolean>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return run(t, getBooleanField, arguments);
@@ -1505,6 +1646,13 @@ uint64_t getByteField(Thread* t, uintptr_t* arguments)
 
 jbyte JNICALL GetByteField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jbyte>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return run(t, getByteField, arguments);
@@ -1523,6 +1671,13 @@ uint64_t getCharField(Thread* t, uintptr_t* arguments)
 
 jchar JNICALL GetCharField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jchar>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return run(t, getCharField, arguments);
@@ -1541,6 +1696,13 @@ uint64_t getShortField(Thread* t, uintptr_t* arguments)
 
 jshort JNICALL GetShortField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jshort>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return run(t, getShortField, arguments);
@@ -1559,6 +1721,13 @@ uint64_t getIntField(Thread* t, uintptr_t* arguments)
 
 jint JNICALL GetIntField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jint>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return run(t, getIntField, arguments);
@@ -1572,11 +1741,18 @@ uint64_t getLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return fieldAtOffset<jlong>(*o, field->offset());
+  return getWideField(t, *o, field);
 }
 
 jlong JNICALL GetLongField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jlong>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return run(t, getLongField, arguments);
@@ -1595,6 +1771,13 @@ uint64_t getFloatField(Thread* t, uintptr_t* arguments)
 
 jfloat JNICALL GetFloatField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jfloat>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return bitsToFloat(run(t, getFloatField, arguments));
@@ -1608,11 +1791,18 @@ uint64_t getDoubleField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return doubleToBits(fieldAtOffset<jdouble>(*o, field->offset()));
+  return getWideField(t, *o, field);
 }
 
 jdouble JNICALL GetDoubleField(Thread* t, jobject o, jfieldID field)
 {
+  ENTER(t, Thread::ActiveState);
+
+  GcField* plain = plainField(t, field);
+  if (LIKELY(plain)) {
+    return fieldAtOffset<jdouble>(*o, plain->offset());
+  }
+
   uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(o), field};
 
   return bitsToDouble(run(t, getDoubleField, arguments));
@@ -1758,7 +1948,7 @@ uint64_t setLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<jlong>(*o, field->offset()) = v;
+  setWideField(t, *o, field, v);
 
   return 1;
 }
@@ -1799,13 +1989,13 @@ uint64_t setDoubleField(Thread* t, uintptr_t* arguments)
 {
   jobject o = reinterpret_cast<jobject>(arguments[0]);
   GcField* field = getField(t, arguments[1]);
-  jdouble v;
+  int64_t v;
   memcpy(&v, arguments + 2, sizeof(jdouble));
 
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<jdouble>(*o, field->offset()) = v;
+  setWideField(t, *o, field, v);
 
   return 1;
 }
@@ -1969,7 +2159,7 @@ uint64_t getStaticLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return fieldAtOffset<jlong>(c->vmClass()->staticTable(), field->offset());
+  return getWideField(t, c->vmClass()->staticTable(), field);
 }
 
 jlong JNICALL GetStaticLongField(Thread* t, jclass c, jfieldID field)
@@ -2012,8 +2202,7 @@ uint64_t getStaticDoubleField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_READ(t, field);
 
-  return doubleToBits(
-      fieldAtOffset<jdouble>(c->vmClass()->staticTable(), field->offset()));
+  return getWideField(t, c->vmClass()->staticTable(), field);
 }
 
 jdouble JNICALL GetStaticDoubleField(Thread* t, jclass c, jfieldID field)
@@ -2186,7 +2375,7 @@ uint64_t setStaticLongField(Thread* t, uintptr_t* arguments)
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<jlong>(c->vmClass()->staticTable(), field->offset()) = v;
+  setWideField(t, c->vmClass()->staticTable(), field, v);
 
   return 1;
 }
@@ -2233,13 +2422,13 @@ uint64_t setStaticDoubleField(Thread* t, uintptr_t* arguments)
   initClass(t, c->vmClass());
 
   GcField* field = getStaticField(t, arguments[1]);
-  jdouble v;
+  int64_t v;
   memcpy(&v, arguments + 2, sizeof(jdouble));
 
   PROTECT(t, field);
   ACQUIRE_FIELD_FOR_WRITE(t, field);
 
-  fieldAtOffset<jdouble>(c->vmClass()->staticTable(), field->offset()) = v;
+  setWideField(t, c->vmClass()->staticTable(), field, v);
 
   return 1;
 }
@@ -2771,7 +2960,7 @@ void JNICALL GetBooleanArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jboolean));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jboolean));
   }
 }
 
@@ -2784,7 +2973,7 @@ void JNICALL GetByteArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jbyte));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jbyte));
   }
 }
 
@@ -2797,7 +2986,7 @@ void JNICALL GetCharArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jchar));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jchar));
   }
 }
 
@@ -2810,7 +2999,7 @@ void JNICALL GetShortArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jshort));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jshort));
   }
 }
 
@@ -2823,7 +3012,7 @@ void JNICALL GetIntArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jint));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jint));
   }
 }
 
@@ -2836,7 +3025,7 @@ void JNICALL GetLongArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jlong));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jlong));
   }
 }
 
@@ -2849,7 +3038,7 @@ void JNICALL GetFloatArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jfloat));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jfloat));
   }
 }
 
@@ -2862,7 +3051,7 @@ void JNICALL GetDoubleArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(dst, &(*array)->body()[offset], length * sizeof(jdouble));
+    copyMemory(dst, &(*array)->body()[offset], length * sizeof(jdouble));
   }
 }
 
@@ -2875,7 +3064,7 @@ void JNICALL SetBooleanArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jboolean));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jboolean));
   }
 }
 
@@ -2888,7 +3077,7 @@ void JNICALL SetByteArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jbyte));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jbyte));
   }
 }
 
@@ -2901,7 +3090,7 @@ void JNICALL SetCharArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jchar));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jchar));
   }
 }
 
@@ -2914,7 +3103,7 @@ void JNICALL SetShortArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jshort));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jshort));
   }
 }
 
@@ -2927,7 +3116,7 @@ void JNICALL SetIntArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jint));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jint));
   }
 }
 
@@ -2940,7 +3129,7 @@ void JNICALL SetLongArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jlong));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jlong));
   }
 }
 
@@ -2953,7 +3142,7 @@ void JNICALL SetFloatArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jfloat));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jfloat));
   }
 }
 
@@ -2966,7 +3155,7 @@ void JNICALL SetDoubleArrayRegion(Thread* t,
   ENTER(t, Thread::ActiveState);
 
   if (length) {
-    memcpy(&(*array)->body()[offset], src, length * sizeof(jdouble));
+    copyMemory(&(*array)->body()[offset], src, length * sizeof(jdouble));
   }
 }
 
@@ -2985,13 +3174,31 @@ void* JNICALL
 
   expect(t, *array);
 
-  return reinterpret_cast<uintptr_t*>(*array) + 2;
+  void* body = reinterpret_cast<uintptr_t*>(*array) + 2;
+
+  // Fixed objects (which includes every array too large for a thread
+  // heap) never move, and the caller's reference to the array keeps it
+  // alive, so there's no need to hold off the collector while the
+  // caller works on one.  Anything else may move during a collection,
+  // so we stay active until it is released.
+  if (objectFixed(t, *array)) {
+    if ((--t->criticalLevel) == 0) {
+      enter(t, Thread::IdleState);
+    }
+  }
+
+  return body;
 }
 
-void JNICALL ReleasePrimitiveArrayCritical(Thread* t, jarray, void*, jint)
+void JNICALL
+    ReleasePrimitiveArrayCritical(Thread* t, jarray array, void*, jint)
 {
-  if ((--t->criticalLevel) == 0) {
-    enter(t, Thread::IdleState);
+  // the array's header is stable here: either it is fixed, or we are
+  // still active from when it was acquired
+  if (not objectFixed(t, *array)) {
+    if ((--t->criticalLevel) == 0) {
+      enter(t, Thread::IdleState);
+    }
   }
 }
 
@@ -3282,6 +3489,23 @@ struct JavaVMInitArgs {
   jboolean ignoreUnrecognized;
 };
 
+const unsigned DefaultHeapLimit = 128 * 1024 * 1024;
+const unsigned DefaultHeapPercentage = 25;
+
+// without -Xmx, the heap may use a percentage of the memory our
+// container (if any) allows us, or a fixed amount otherwise
+unsigned defaultHeapLimit(System* s, unsigned percentage)
+{
+  uint64_t limit = s->memoryLimit();
+  if (limit == 0) {
+    return DefaultHeapLimit;
+  }
+
+  limit = (limit / 100) * percentage;
+  const unsigned Max = ~static_cast<unsigned>(0);
+  return limit > Max ? Max : limit;
+}
+
 int parseSize(const char* s)
 {
   unsigned length = strlen(s);
@@ -3349,11 +3573,16 @@ uint64_t boot(Thread* t, uintptr_t*)
 
   t->javaThread->peer() = reinterpret_cast<jlong>(t);
 
-  GcThread* jthread = t->m->classpath->makeThread(t, t);
+  GcArray* finalizerThreads = makeArray(t, t->m->finalizeThreadCount);
   // sequence point, for gc (don't recombine statements)
-  roots(t)->setFinalizerThread(t, jthread);
+  roots(t)->setFinalizerThreads(t, finalizerThreads);
 
-  roots(t)->finalizerThread()->daemon() = true;
+  for (unsigned i = 0; i < t->m->finalizeThreadCount; ++i) {
+    GcThread* jthread = t->m->classpath->makeThread(t, t);
+    jthread->daemon() = true;
+    cast<GcArray>(t, roots(t)->finalizerThreads())
+        ->setBodyElement(t, i, jthread);
+  }
 
   t->m->classpath->boot(t);
 
@@ -3371,6 +3600,11 @@ uint64_t boot(Thread* t, uintptr_t*)
     t->m->processor->invoke(t, method, 0, host, atoi(port));
   }
 
+  const char* profile = findProperty(t, PROFILE_PROPERTY);
+  if (profile) {
+    startProfiler(t, profile);
+  }
+
   enter(t, Thread::IdleState);
 
   return 1;
@@ -3623,6 +3857,9 @@ extern "C" AVIAN_EXPORT jint JNICALL
   const char* bootClasspath = 0;
   const char* bootClasspathAppend = "";
   const char* crashDumpDirectory = 0;
+  unsigned finderCacheSize = 0;
+  unsigned threadStackSize = 0;
+  unsigned heapPercentage = local::DefaultHeapPercentage;
 
   unsigned propertyCount = 0;
 
@@ -3675,15 +3912,28 @@ extern "C" AVIAN_EXPORT jint JNICALL
                          EMBED_PREFIX_PROPERTY "=",
                          sizeof(EMBED_PREFIX_PROPERTY)) == 0) {
         embedPrefix = p + sizeof(EMBED_PREFIX_PROPERTY);
+      } else if (strncmp(p,
+                         FINDER_CACHE_PROPERTY "=",
+                         sizeof(FINDER_CACHE_PROPERTY)) == 0) {
+        finderCacheSize = local::parseSize(p + sizeof(FINDER_CACHE_PROPERTY));
+      } else if (strncmp(p,
+                         THREAD_STACK_SIZE_PROPERTY "=",
+                         sizeof(THREAD_STACK_SIZE_PROPERTY)) == 0) {
+        threadStackSize
+            = local::parseSize(p + sizeof(THREAD_STACK_SIZE_PROPERTY));
+      } else if (strncmp(p,
+                         HEAP_PERCENTAGE_PROPERTY "=",
+                         sizeof(HEAP_PERCENTAGE_PROPERTY)) == 0) {
+        int percentage = atoi(p + sizeof(HEAP_PERCENTAGE_PROPERTY));
+        if (percentage > 0 and percentage <= 100) {
+          heapPercentage = percentage;
+        }
       }
 
       ++propertyCount;
     }
   }
 
-  if (heapLimit == 0)
-    heapLimit = 128 * 1024 * 1024;
-
   if (stackLimit == 0)
     stackLimit = 128 * 1024;
 
@@ -3694,6 +3944,11 @@ extern "C" AVIAN_EXPORT jint JNICALL
   }
 
   System* s = makeSystem(reentrant);
+  int64_t start = s->nanoTime();
+
+  if (heapLimit == 0)
+    heapLimit = local::defaultHeapLimit(s, heapPercentage);
+
   Heap* h = makeHeap(s, heapLimit);
   Classpath* c = makeClasspath(s, h, javaHome, embedPrefix);
 
@@ -3725,12 +3980,18 @@ extern "C" AVIAN_EXPORT jint JNICALL
   if (bootLibraryEnd)
     *bootLibraryEnd = 0;
 
-  Finder* bf
-      = makeFinder(s, h, RUNTIME_ARRAY_BODY(bootClasspathBuffer), bootLibrary);
-  Finder* af = makeFinder(s, h, classpath, bootLibrary);
+  int64_t finderStart = s->nanoTime();
+  Finder* bf = makeFinder(s,
+                          h,
+                          RUNTIME_ARRAY_BODY(bootClasspathBuffer),
+                          bootLibrary,
+                          finderCacheSize);
+  Finder* af = makeFinder(s, h, classpath, bootLibrary, finderCacheSize);
   if (bootLibrary)
     free(bootLibrary);
+  int64_t processorStart = s->nanoTime();
   Processor* p = makeProcessor(s, h, crashDumpDirectory, true);
+  int64_t processorEnd = s->nanoTime();
 
   // reserve space for avian.version and file.encoding:
   propertyCount += 2;
@@ -3781,12 +4042,33 @@ extern "C" AVIAN_EXPORT jint JNICALL
 
   h->free(properties, sizeof(const char*) * propertyCount);
 
+  (*m)->threadStackSizeInBytes = threadStackSize;
+
+  int64_t threadStart = s->nanoTime();
+
+  startStartupTrace(*m, start);
+  startPreloadLog(*m);
+  recordStartupPhase(*m, FinderStartupPhase, processorStart - finderStart);
+  recordStartupPhase(*m, ProcessorStartupPhase, processorEnd - processorStart);
+  recordStartupPhase(*m, MachineStartupPhase, threadStart - processorEnd);
+
   *t = p->makeThread(*m, 0, 0);
 
   enter(*t, Thread::ActiveState);
   enter(*t, Thread::IdleState);
 
-  return run(*t, local::boot, 0) ? 0 : -1;
+  int64_t bootStart = s->nanoTime();
+  recordStartupPhase(*m, ThreadStartupPhase, bootStart - threadStart);
+
+  bool booted = run(*t, local::boot, 0);
+
+  recordStartupPhase(*m, BootStartupPhase, s->nanoTime() - bootStart);
+
+  if (booted) {
+    startPreload(*t);
+  }
+
+  return booted ? 0 : -1;
 }
 
 extern "C" AVIAN_EXPORT jstring JNICALL JVM_GetTemporaryDirectory(JNIEnv* e UNUSED)
@@ -12,14 +12,32 @@
 #include "C/LzmaDec.h"
 
 using namespace vm;
+using namespace avian::lzma;
 
 namespace {
 
-int32_t read4(const uint8_t* in)
+void decodeBlock(Block* b, ISzAlloc* allocator)
 {
-  return (static_cast<int32_t>(in[3]) << 24)
-         | (static_cast<int32_t>(in[2]) << 16)
-         | (static_cast<int32_t>(in[1]) << 8) | (static_cast<int32_t>(in[0]));
+  SizeT outSizeT = b->outSize;
+  SizeT inSizeT = b->inSize - HeaderSize;
+
+  ELzmaStatus status;
+  int result = LzmaDecode(b->out,
+                          &outSizeT,
+                          b->in + HeaderSize,
+                          &inSizeT,
+                          b->in,
+                          PropHeaderSize,
+                          LZMA_FINISH_END,
+                          &status,
+                          allocator);
+
+  if (result == SZ_OK and (status != LZMA_STATUS_FINISHED_WITH_MARK
+                           or outSizeT != b->outSize)) {
+    result = SZ_ERROR_DATA;
+  }
+
+  b->result = result;
 }
 
 }  // namespace
@@ -32,31 +50,34 @@ uint8_t* decodeLZMA(System* s,
                     size_t inSize,
                     size_t* outSize)
 {
-  const size_t PropHeaderSize = 5;
-  const size_t HeaderSize = 13;
-
-  int32_t outSize32 = read4(in + PropHeaderSize);
+  int32_t outSize32 = readLittle4(in + PropHeaderSize);
   expect(s, outSize32 >= 0);
-  SizeT outSizeT = outSize32;
 
   uint8_t* out = static_cast<uint8_t*>(a->allocate(outSize32));
 
-  SizeT inSizeT = inSize;
-  LzmaAllocator allocator(a);
+  if (isMultiBlock(in, inSize)) {
+    unsigned count = blockCount(in, inSize);
+    expect(s, count > 0 and blocksOffset(count) <= inSize);
 
-  ELzmaStatus status;
-  int result = LzmaDecode(out,
-                          &outSizeT,
-                          in + HeaderSize,
-                          &inSizeT,
-                          in,
-                          PropHeaderSize,
-                          LZMA_FINISH_END,
-                          &status,
-                          &(allocator.allocator));
+    size_t blocksSize = count * sizeof(Block);
+    Block* blocks = static_cast<Block*>(a->allocate(blocksSize));
+
+    expect(s, findBlocks(in, inSize, out, outSize32, blocks, count));
+
+    forEachBlock(s, a, blocks, count, decodeBlock);
+
+    for (unsigned i = 0; i < count; ++i) {
+      expect(s, blocks[i].result == SZ_OK);
+    }
+
+    a->free(blocks, blocksSize);
+  } else {
+    Block block = {in, inSize, out, static_cast<size_t>(outSize32), -1};
+    LzmaAllocator allocator(a);
+    decodeBlock(&block, &(allocator.allocator));
 
-  expect(s, result == SZ_OK);
-  expect(s, status == LZMA_STATUS_FINISHED_WITH_MARK);
+    expect(s, block.result == SZ_OK);
+  }
 
   *outSize = outSize32;
 
@@ -12,6 +12,7 @@
 #include "C/LzmaEnc.h"
 
 using namespace vm;
+using namespace avian::lzma;
 
 namespace {
 
@@ -20,58 +21,119 @@ SRes myProgress(void*, UInt64, UInt64)
   return SZ_OK;
 }
 
-}  // namespace
-
-namespace vm {
-
-uint8_t* encodeLZMA(System* s,
-                    avian::util::Alloc* a,
-                    uint8_t* in,
-                    size_t inSize,
-                    size_t* outSize)
+// Encodes the inSize bytes at in as a single stream into out, which
+// has room for outSize bytes, leaving the size of the encoding in
+// outSize.  Blocks of a larger payload get a dictionary only as big as
+// they are, lest every thread claim the one level 9 would choose.
+void encodeBlock(Block* b, ISzAlloc* allocator, bool ofMany)
 {
-  const unsigned PropHeaderSize = 5;
-  const unsigned HeaderSize = 13;
-
-  unsigned bufferSize = inSize * 2;
-
-  uint8_t* buffer = static_cast<uint8_t*>(a->allocate(bufferSize));
-
-  LzmaAllocator allocator(a);
-
   CLzmaEncProps props;
   LzmaEncProps_Init(&props);
   props.level = 9;
   props.writeEndMark = 1;
+  if (ofMany) {
+    props.dictSize = BlockSize;
+  }
 
   ICompressProgress progress = {myProgress};
 
   SizeT propsSize = PropHeaderSize;
 
-  int32_t inSize32 = inSize;
-  memcpy(buffer + PropHeaderSize, &inSize32, 4);
+  uint8_t* out = b->out;
+  memset(out + PropHeaderSize, 0, HeaderSize - PropHeaderSize);
+  writeLittle4(out + PropHeaderSize, b->inSize);
+
+  SizeT outSizeT = b->outSize - HeaderSize;
+  b->result = LzmaEncode(out + HeaderSize,
+                         &outSizeT,
+                         b->in,
+                         b->inSize,
+                         &props,
+                         out,
+                         &propsSize,
+                         1,
+                         &progress,
+                         allocator,
+                         allocator);
+
+  b->outSize = outSizeT + HeaderSize;
+}
 
-  SizeT outSizeT = bufferSize;
-  int result = LzmaEncode(buffer + HeaderSize,
-                          &outSizeT,
-                          in,
-                          inSize,
-                          &props,
-                          buffer,
-                          &propsSize,
-                          1,
-                          &progress,
-                          &(allocator.allocator),
-                          &(allocator.allocator));
+void encodeBlockOfMany(Block* b, ISzAlloc* allocator)
+{
+  encodeBlock(b, allocator, true);
+}
+
+size_t encodingCapacity(size_t inSize)
+{
+  return (inSize * 2) + HeaderSize;
+}
 
-  expect(s, result == SZ_OK);
+}  // namespace
+
+namespace vm {
 
-  *outSize = outSizeT + HeaderSize;
+uint8_t* encodeLZMA(System* s,
+                    avian::util::Alloc* a,
+                    uint8_t* in,
+                    size_t inSize,
+                    size_t* outSize)
+{
+  unsigned count = blockCount(inSize);
+  if (count == 1) {
+    size_t bufferSize = encodingCapacity(inSize);
+    uint8_t* buffer = static_cast<uint8_t*>(a->allocate(bufferSize));
+
+    Block block = {in, inSize, buffer, bufferSize, -1};
+    LzmaAllocator allocator(a);
+    encodeBlock(&block, &(allocator.allocator), false);
+
+    expect(s, block.result == SZ_OK);
+
+    *outSize = block.outSize;
+
+    uint8_t* out = static_cast<uint8_t*>(a->allocate(*outSize));
+    memcpy(out, buffer, *outSize);
+
+    a->free(buffer, bufferSize);
+
+    return out;
+  }
+
+  // each block is encoded into a buffer of its own, and then they're
+  // all copied into place after the header
+  size_t blocksSize = count * sizeof(Block);
+  Block* blocks = static_cast<Block*>(a->allocate(blocksSize));
+  for (unsigned i = 0; i < count; ++i) {
+    size_t offset = i * BlockSize;
+    size_t size = i + 1 == count ? inSize - offset : BlockSize;
+    size_t capacity = encodingCapacity(size);
+    Block block = {in + offset,
+                   size,
+                   static_cast<uint8_t*>(a->allocate(capacity)),
+                   capacity,
+                   -1};
+    blocks[i] = block;
+  }
+
+  forEachBlock(s, a, blocks, count, encodeBlockOfMany);
+
+  *outSize = blocksOffset(count);
+  for (unsigned i = 0; i < count; ++i) {
+    expect(s, blocks[i].result == SZ_OK);
+    *outSize += blocks[i].outSize;
+  }
 
   uint8_t* out = static_cast<uint8_t*>(a->allocate(*outSize));
-  memcpy(out, buffer, *outSize);
+  size_t offset = writeBlocksHeader(out, inSize, blocks, count);
+  for (unsigned i = 0; i < count; ++i) {
+    memcpy(out + offset, blocks[i].out, blocks[i].outSize);
+    offset += blocks[i].outSize;
+
+    a->free(blocks[i].out, encodingCapacity(blocks[i].inSize));
+  }
 
-  a->free(buffer, bufferSize);
+  a->free(blocks, blocksSize);
 
   return out;
 }
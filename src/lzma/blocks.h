@@ -0,0 +1,273 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef AVIAN_LZMA_BLOCKS_H
+#define AVIAN_LZMA_BLOCKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef AVIAN_LZMA_THREADS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#endif
+
+// The layout of LZMA payloads, shared by the VM, the lzma tool and the
+// lzma loader, none of which may depend on the others.
+//
+// A payload which fits in one block is a plain LZMA stream, as it
+// always has been: five bytes of properties, the uncompressed size in
+// four little-endian bytes, four unused bytes, and the compressed data,
+// which ends with an end mark.
+//
+// A larger payload is split into blocks of BlockSize bytes which are
+// compressed independently, so they may be encoded and decoded in
+// parallel.  Its thirteen byte header has MultiBlockMarker, which can't
+// be the first byte of a set of properties, in place of the properties,
+// followed by the number of blocks and then the uncompressed size,
+// which is thus where it is in a single stream.  Next comes the size of
+// each compressed block in four little-endian bytes, and then the
+// blocks themselves, each a single stream as above.
+
+namespace avian {
+namespace lzma {
+
+const unsigned PropHeaderSize = 5;
+const unsigned HeaderSize = 13;
+
+// the properties byte is (pb * 5 + lp) * 9 + lc, so at most 224
+const uint8_t MultiBlockMarker = 0xff;
+
+const size_t BlockSize = 8 * 1024 * 1024;
+
+// there's no point in more threads than this, and each one encoding
+// needs a dictionary and match finder of its own
+const unsigned MaxThreads = 16;
+
+inline int32_t readLittle4(const uint8_t* in)
+{
+  return (static_cast<int32_t>(in[3]) << 24)
+         | (static_cast<int32_t>(in[2]) << 16)
+         | (static_cast<int32_t>(in[1]) << 8) | (static_cast<int32_t>(in[0]));
+}
+
+inline void writeLittle4(uint8_t* out, uint32_t v)
+{
+  out[0] = v;
+  out[1] = v >> 8;
+  out[2] = v >> 16;
+  out[3] = v >> 24;
+}
+
+struct Block {
+  const uint8_t* in;
+  size_t inSize;
+  uint8_t* out;
+  size_t outSize;
+  // SZ_OK on success, and otherwise an LZMA error code: SZ_ERROR_DATA
+  // if the block didn't decode to the size it claimed
+  int result;
+};
+
+inline bool isMultiBlock(const uint8_t* in, size_t inSize)
+{
+  return inSize >= HeaderSize && in[0] == MultiBlockMarker;
+}
+
+// the number of blocks an input of the specified size is split into
+inline unsigned blockCount(size_t inSize)
+{
+  return inSize <= BlockSize ? 1 : (inSize + BlockSize - 1) / BlockSize;
+}
+
+inline unsigned blockCount(const uint8_t* in, size_t inSize)
+{
+  return isMultiBlock(in, inSize) ? readLittle4(in + 1) : 1;
+}
+
+// where the first compressed block of a multi-block payload begins
+inline size_t blocksOffset(unsigned count)
+{
+  return HeaderSize + (static_cast<size_t>(count) * 4);
+}
+
+// Points each of the count blocks of a multi-block payload at its
+// compressed data and at where its output goes in out, which holds
+// outSize bytes.  Returns false if the payload isn't well-formed.
+inline bool findBlocks(const uint8_t* in,
+                       size_t inSize,
+                       uint8_t* out,
+                       size_t outSize,
+                       Block* blocks,
+                       unsigned count)
+{
+  if (count == 0 || inSize < blocksOffset(count)) {
+    return false;
+  }
+
+  size_t inOffset = blocksOffset(count);
+  size_t outOffset = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    size_t size = static_cast<uint32_t>(readLittle4(in + HeaderSize + (i * 4)));
+    if (size < HeaderSize || size > inSize - inOffset) {
+      return false;
+    }
+
+    int32_t blockOutSize = readLittle4(in + inOffset + PropHeaderSize);
+    if (blockOutSize < 0
+        || static_cast<size_t>(blockOutSize) > outSize - outOffset) {
+      return false;
+    }
+
+    blocks[i].in = in + inOffset;
+    blocks[i].inSize = size;
+    blocks[i].out = out + outOffset;
+    blocks[i].outSize = blockOutSize;
+    blocks[i].result = -1;
+
+    inOffset += size;
+    outOffset += blockOutSize;
+  }
+
+  return outOffset == outSize;
+}
+
+// Writes the header and block size table of a multi-block payload for
+// the specified blocks, whose inSize is the size of their uncompressed
+// data and outSize that of their encoding, to out, and returns the
+// offset following it, where the blocks go.
+inline size_t writeBlocksHeader(uint8_t* out,
+                                size_t uncompressedSize,
+                                const Block* blocks,
+                                unsigned count)
+{
+  memset(out, 0, HeaderSize);
+  out[0] = MultiBlockMarker;
+  writeLittle4(out + 1, count);
+  writeLittle4(out + PropHeaderSize, uncompressedSize);
+  for (unsigned i = 0; i < count; ++i) {
+    writeLittle4(out + HeaderSize + (i * 4), blocks[i].outSize);
+  }
+  return blocksOffset(count);
+}
+
+#ifdef AVIAN_LZMA_THREADS
+// For the tools, which have no vm::System to start threads with: runs
+// function on each of the count blocks, spreading them over as many
+// threads as there are processors.
+
+struct BlockWork {
+  void (*function)(Block*);
+  Block* blocks;
+  unsigned count;
+  unsigned first;
+  unsigned stride;
+};
+
+inline void runBlockWork(BlockWork* w)
+{
+  for (unsigned i = w->first; i < w->count; i += w->stride) {
+    w->function(w->blocks + i);
+  }
+}
+
+#ifdef _WIN32
+inline DWORD WINAPI blockThread(void* work)
+{
+  runBlockWork(static_cast<BlockWork*>(work));
+  return 0;
+}
+
+inline unsigned processorCount()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+}
+#else
+inline void* blockThread(void* work)
+{
+  runBlockWork(static_cast<BlockWork*>(work));
+  return 0;
+}
+
+inline unsigned processorCount()
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? count : 1;
+}
+#endif
+
+inline void forEachBlock(Block* blocks,
+                         unsigned count,
+                         void (*function)(Block*))
+{
+  unsigned threadCount = processorCount();
+  if (threadCount > count) {
+    threadCount = count;
+  }
+  if (threadCount > MaxThreads) {
+    threadCount = MaxThreads;
+  }
+
+  BlockWork work[MaxThreads];
+#ifdef _WIN32
+  HANDLE threads[MaxThreads];
+#else
+  pthread_t threads[MaxThreads];
+#endif
+  bool started[MaxThreads];
+
+  // this thread takes the first share itself, and any share we fail to
+  // start a thread for
+  for (unsigned i = 0; i < threadCount; ++i) {
+    BlockWork w = {function, blocks, count, i, threadCount};
+    work[i] = w;
+    if (i == 0) {
+      started[i] = false;
+    } else {
+#ifdef _WIN32
+      threads[i] = CreateThread(0, 0, blockThread, work + i, 0, 0);
+      started[i] = threads[i] != 0;
+#else
+      started[i]
+          = pthread_create(threads + i, 0, blockThread, work + i) == 0;
+#endif
+    }
+  }
+
+  for (unsigned i = 0; i < threadCount; ++i) {
+    if (!started[i]) {
+      runBlockWork(work + i);
+    }
+  }
+
+  for (unsigned i = 1; i < threadCount; ++i) {
+    if (started[i]) {
+#ifdef _WIN32
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+#else
+      pthread_join(threads[i], 0);
+#endif
+    }
+  }
+}
+#endif  // AVIAN_LZMA_THREADS
+
+}  // namespace lzma
+}  // namespace avian
+
+#endif  // AVIAN_LZMA_BLOCKS_H
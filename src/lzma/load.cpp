@@ -8,12 +8,16 @@
 
 #include "C/LzmaDec.h"
 
+#define AVIAN_LZMA_THREADS
+#include "blocks.h"
+
 #if (defined __MINGW32__) || (defined _MSC_VER)
 #define EXPORT __declspec(dllexport)
 #include <io.h>
 #define open _open
 #define write _write
 #define close _close
+#define O_SHORT_LIVED _O_SHORT_LIVED
 #ifdef _MSC_VER
 #define S_IRWXU (_S_IREAD | _S_IWRITE)
 #define and &&
@@ -24,6 +28,14 @@
 #include <unistd.h>
 #include <errno.h>
 #define O_BINARY 0
+#define O_SHORT_LIVED 0
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1
+#endif
+#endif
 #endif
 
 #if (!defined __x86_64__) && ((defined __MINGW32__) || (defined _MSC_VER))
@@ -38,14 +50,9 @@ extern const uint8_t SYMBOL(end)[];
 
 }  // extern "C"
 
-namespace {
+using namespace avian::lzma;
 
-int32_t read4(const uint8_t* in)
-{
-  return (static_cast<int32_t>(in[3]) << 24)
-         | (static_cast<int32_t>(in[2]) << 16)
-         | (static_cast<int32_t>(in[1]) << 8) | (static_cast<int32_t>(in[0]));
-}
+namespace {
 
 void* myAllocate(void*, size_t size)
 {
@@ -57,6 +64,58 @@ void myFree(void*, void* address)
   free(address);
 }
 
+ISzAlloc allocator = {myAllocate, myFree};
+
+void decodeBlock(Block* b)
+{
+  SizeT outSize = b->outSize;
+  SizeT inSize = b->inSize - HeaderSize;
+  ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+  b->result = LzmaDecode(b->out,
+                         &outSize,
+                         b->in + HeaderSize,
+                         &inSize,
+                         b->in,
+                         PropHeaderSize,
+                         LZMA_FINISH_END,
+                         &status,
+                         &allocator);
+
+  if (b->result == SZ_OK and outSize != b->outSize) {
+    b->result = SZ_ERROR_DATA;
+  }
+}
+
+// decodes the payload into out, which holds outSize bytes, with a
+// thread per processor if it's made of several blocks
+bool decode(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize)
+{
+  if (!isMultiBlock(in, inSize)) {
+    Block block = {in, inSize, out, outSize, SZ_ERROR_DATA};
+    decodeBlock(&block);
+    return block.result == SZ_OK;
+  }
+
+  unsigned count = blockCount(in, inSize);
+  if (count == 0 or blocksOffset(count) > inSize) {
+    return false;
+  }
+
+  Block* blocks = static_cast<Block*>(malloc(count * sizeof(Block)));
+  bool success = false;
+  if (blocks and findBlocks(in, inSize, out, outSize, blocks, count)) {
+    forEachBlock(blocks, count, decodeBlock);
+
+    success = true;
+    for (unsigned i = 0; i < count; ++i) {
+      success = success and blocks[i].result == SZ_OK;
+    }
+  }
+
+  free(blocks);
+  return success;
+}
+
 #if (defined __MINGW32__) || (defined _MSC_VER)
 
 void* openLibrary(const char* name)
@@ -113,44 +172,104 @@ const char* temporaryFileName(char* buffer, unsigned)
 
 #endif
 
+// Returns a descriptor for an anonymous file in memory, storing in
+// buffer a name by which it may be opened, or -1 if the platform offers
+// no such thing.  Loading the library from such a file saves writing
+// the whole of it to disk first, and works where the temporary
+// directory is read-only or mounted noexec.
+#if (defined __linux__) && (defined SYS_memfd_create)
+int openMemoryFile(char* buffer, unsigned size)
+{
+  int file = syscall(SYS_memfd_create, "avian", MFD_CLOEXEC);
+  if (file != -1) {
+    snprintf(buffer, size, "/proc/self/fd/%d", file);
+  }
+  return file;
+}
+
+// Sizes the memory file and maps it so we can decompress straight into
+// it rather than into a buffer we then copy, returning 0 on failure.
+uint8_t* mapMemoryFile(int file, size_t size)
+{
+  if (ftruncate(file, size) == 0) {
+    void* p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (p != MAP_FAILED) {
+      return static_cast<uint8_t*>(p);
+    }
+  }
+  return 0;
+}
+
+void unmapMemoryFile(uint8_t* p, size_t size)
+{
+  munmap(p, size);
+}
+#else
+int openMemoryFile(char*, unsigned)
+{
+  return -1;
+}
+
+uint8_t* mapMemoryFile(int, size_t)
+{
+  return 0;
+}
+
+void unmapMemoryFile(uint8_t*, size_t)
+{
+}
+#endif
+
 }  // namespace
 
 int main(int ac, const char** av)
 {
-  const unsigned PropHeaderSize = 5;
-  const unsigned HeaderSize = 13;
-
   SizeT inSize = SYMBOL(end) - SYMBOL(start);
 
-  int32_t outSize32 = read4(SYMBOL(start) + PropHeaderSize);
+  int32_t outSize32 = readLittle4(SYMBOL(start) + PropHeaderSize);
   SizeT outSize = outSize32;
 
-  uint8_t* out = static_cast<uint8_t*>(malloc(outSize));
+  const unsigned BufferSize = 1024;
+  char buffer[BufferSize];
+  int file = openMemoryFile(buffer, BufferSize);
+  bool temporary = file == -1;
+
+  uint8_t* mapped = temporary ? 0 : mapMemoryFile(file, outSize);
+  uint8_t* out = mapped ? mapped : static_cast<uint8_t*>(malloc(outSize));
   if (out) {
-    ISzAlloc allocator = {myAllocate, myFree};
-    ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
-
-    if (SZ_OK == LzmaDecode(out,
-                            &outSize,
-                            SYMBOL(start) + HeaderSize,
-                            &inSize,
-                            SYMBOL(start),
-                            PropHeaderSize,
-                            LZMA_FINISH_END,
-                            &status,
-                            &allocator)) {
-      const unsigned BufferSize = 1024;
-      char buffer[BufferSize];
-      const char* name = temporaryFileName(buffer, BufferSize);
+    if (decode(SYMBOL(start), inSize, out, outSize)) {
+      const char* name = 0;
+      if (temporary) {
+        name = temporaryFileName(buffer, BufferSize);
+        if (name) {
+          // a short-lived file may never leave the cache for the disk
+          file = open(name,
+                      O_CREAT | O_EXCL | O_WRONLY | O_BINARY | O_SHORT_LIVED,
+                      S_IRWXU);
+        }
+      } else {
+        name = buffer;
+      }
+
       if (name) {
-        int file = open(name, O_CREAT | O_EXCL | O_WRONLY | O_BINARY, S_IRWXU);
         if (file != -1) {
-          SizeT result = write(file, out, outSize);
-          free(out);
+          SizeT result;
+          if (mapped) {
+            unmapMemoryFile(mapped, outSize32);
+            result = outSize;
+          } else {
+            result = write(file, out, outSize);
+            free(out);
+          }
 
-          if (close(file) == 0 and outSize == result) {
+          // a memory file vanishes when closed, so we leave it open for
+          // as long as the library is loaded, i.e. for good
+          bool closed = temporary ? close(file) == 0 : true;
+          if (closed and outSize == result) {
             void* library = openLibrary(name);
-            unlink(name);
+            if (temporary) {
+              unlink(name);
+            }
 
             if (library) {
               void* main = librarySymbol(library, "avianMain");
@@ -168,7 +287,9 @@ int main(int ac, const char** av)
                       libraryError(library));
             }
           } else {
-            unlink(name);
+            if (temporary) {
+              unlink(name);
+            }
 
             fprintf(stderr,
                     "close or write failed; tried %d, got %d; %s\n",
@@ -15,14 +15,12 @@
 #include "LzmaEnc.h"
 #include "LzmaDec.h"
 
-namespace {
+#define AVIAN_LZMA_THREADS
+#include "blocks.h"
 
-int32_t read4(const uint8_t* in)
-{
-  return (static_cast<int32_t>(in[3]) << 24)
-         | (static_cast<int32_t>(in[2]) << 16)
-         | (static_cast<int32_t>(in[1]) << 8) | (static_cast<int32_t>(in[0]));
-}
+using namespace avian::lzma;
+
+namespace {
 
 void* myAllocate(void*, size_t size)
 {
@@ -39,6 +37,188 @@ SRes myProgress(void*, UInt64, UInt64)
   return SZ_OK;
 }
 
+ISzAlloc allocator = {myAllocate, myFree};
+
+size_t encodingCapacity(size_t inSize)
+{
+  return (inSize * 2) + HeaderSize;
+}
+
+// Encodes the block's input as a single stream into its output, which
+// has room for outSize bytes, leaving the size of the encoding in
+// outSize.  Blocks of a larger payload get a dictionary only as big as
+// they are, lest every thread claim the one level 9 would choose.
+void encode(Block* b, bool ofMany)
+{
+  CLzmaEncProps props;
+  LzmaEncProps_Init(&props);
+  props.level = 9;
+  props.writeEndMark = 1;
+  if (ofMany) {
+    props.dictSize = BlockSize;
+  }
+
+  ICompressProgress progress = {myProgress};
+
+  SizeT propsSize = PropHeaderSize;
+
+  memset(b->out + PropHeaderSize, 0, HeaderSize - PropHeaderSize);
+  writeLittle4(b->out + PropHeaderSize, b->inSize);
+
+  SizeT outSize = b->outSize - HeaderSize;
+  b->result = LzmaEncode(b->out + HeaderSize,
+                         &outSize,
+                         b->in,
+                         b->inSize,
+                         &props,
+                         b->out,
+                         &propsSize,
+                         1,
+                         &progress,
+                         &allocator,
+                         &allocator);
+
+  b->outSize = outSize + HeaderSize;
+}
+
+void encodeBlockOfMany(Block* b)
+{
+  encode(b, true);
+}
+
+ELzmaStatus decode(Block* b)
+{
+  SizeT outSize = b->outSize;
+  SizeT inSize = b->inSize - HeaderSize;
+  ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+  b->result = LzmaDecode(b->out,
+                         &outSize,
+                         b->in + HeaderSize,
+                         &inSize,
+                         b->in,
+                         PropHeaderSize,
+                         LZMA_FINISH_END,
+                         &status,
+                         &allocator);
+
+  if (b->result == SZ_OK and outSize != b->outSize) {
+    b->result = SZ_ERROR_DATA;
+  }
+
+  return status;
+}
+
+void decodeBlock(Block* b)
+{
+  decode(b);
+}
+
+// encodes size bytes of data into a new buffer, whose size is left in
+// outSize, returning 0 and leaving the LZMA error code in result on
+// failure
+uint8_t* encodeAll(const uint8_t* data,
+                   size_t size,
+                   size_t* outSize,
+                   int* result)
+{
+  unsigned count = blockCount(size);
+  if (count == 1) {
+    Block block = {data, size, 0, encodingCapacity(size), SZ_ERROR_MEM};
+    block.out = static_cast<uint8_t*>(malloc(block.outSize));
+    if (block.out) {
+      encode(&block, false);
+      if (block.result != SZ_OK) {
+        free(block.out);
+        block.out = 0;
+      }
+    }
+
+    *result = block.result;
+    *outSize = block.outSize;
+    return block.out;
+  }
+
+  Block* blocks = static_cast<Block*>(malloc(count * sizeof(Block)));
+  if (blocks == 0) {
+    *result = SZ_ERROR_MEM;
+    return 0;
+  }
+
+  *result = SZ_OK;
+  for (unsigned i = 0; i < count; ++i) {
+    size_t offset = i * BlockSize;
+    size_t blockSize = i + 1 == count ? size - offset : BlockSize;
+    Block block = {data + offset, blockSize, 0, 0, SZ_ERROR_MEM};
+    if (*result == SZ_OK) {
+      block.outSize = encodingCapacity(blockSize);
+      block.out = static_cast<uint8_t*>(malloc(block.outSize));
+      if (block.out == 0) {
+        *result = SZ_ERROR_MEM;
+      }
+    }
+    blocks[i] = block;
+  }
+
+  if (*result == SZ_OK) {
+    forEachBlock(blocks, count, encodeBlockOfMany);
+  }
+
+  *outSize = blocksOffset(count);
+  for (unsigned i = 0; i < count and *result == SZ_OK; ++i) {
+    *result = blocks[i].result;
+    *outSize += blocks[i].outSize;
+  }
+
+  uint8_t* out = 0;
+  if (*result == SZ_OK) {
+    out = static_cast<uint8_t*>(malloc(*outSize));
+    if (out) {
+      size_t offset = writeBlocksHeader(out, size, blocks, count);
+      for (unsigned i = 0; i < count; ++i) {
+        memcpy(out + offset, blocks[i].out, blocks[i].outSize);
+        offset += blocks[i].outSize;
+      }
+    } else {
+      *result = SZ_ERROR_MEM;
+    }
+  }
+
+  for (unsigned i = 0; i < count; ++i) {
+    free(blocks[i].out);
+  }
+  free(blocks);
+
+  return out;
+}
+
+// decodes a multi-block payload into out, which holds outSize bytes,
+// returning SZ_OK or an LZMA error code
+int decodeAll(const uint8_t* data, size_t size, uint8_t* out, size_t outSize)
+{
+  unsigned count = blockCount(data, size);
+  if (count == 0 or blocksOffset(count) > size) {
+    return SZ_ERROR_DATA;
+  }
+
+  Block* blocks = static_cast<Block*>(malloc(count * sizeof(Block)));
+  if (blocks == 0) {
+    return SZ_ERROR_MEM;
+  }
+
+  int result = SZ_ERROR_DATA;
+  if (findBlocks(data, size, out, outSize, blocks, count)) {
+    forEachBlock(blocks, count, decodeBlock);
+
+    result = SZ_OK;
+    for (unsigned i = 0; i < count and result == SZ_OK; ++i) {
+      result = blocks[i].result;
+    }
+  }
+
+  free(blocks);
+  return result;
+}
+
 void usageAndExit(const char* program)
 {
   fprintf(stderr,
@@ -86,99 +266,71 @@ int main(int argc, const char** argv)
   bool success = false;
 
   if (data) {
-    const unsigned PropHeaderSize = 5;
-    const unsigned HeaderSize = 13;
+    uint8_t* out = 0;
+    size_t outSize = 0;
+    int result = SZ_OK;
+    ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
+    bool ready = true;
 
-    SizeT outSize;
-    bool outSizeIsValid;
     if (encode) {
-      outSize = size * 2;
-      outSizeIsValid = true;
+      out = encodeAll(data, size, &outSize, &result);
+      if (out == 0 and result == SZ_ERROR_MEM) {
+        fprintf(stderr, "unable to allocate output buffer\n");
+        ready = false;
+      }
     } else {
-      int32_t outSize32 = read4(data + PropHeaderSize);
-      if (outSize32 < 0 and argc == 5) {
+      int32_t outSize32 = readLittle4(data + PropHeaderSize);
+      if (outSize32 < 0 and argc == 5 and not isMultiBlock(data, size)) {
         outSize32 = atoi(argv[4]);
       }
 
-      outSize = outSize32;
-      outSizeIsValid = outSize32 >= 0;
-    }
-
-    if (outSizeIsValid) {
-      uint8_t* out = static_cast<uint8_t*>(malloc(outSize));
-      if (out) {
-        SizeT inSize = size;
-        ISzAlloc allocator = {myAllocate, myFree};
-        ELzmaStatus status = LZMA_STATUS_NOT_SPECIFIED;
-        int result;
-        if (encode) {
-          CLzmaEncProps props;
-          LzmaEncProps_Init(&props);
-          props.level = 9;
-          props.writeEndMark = 1;
-
-          ICompressProgress progress = {myProgress};
-
-          SizeT propsSize = PropHeaderSize;
-
-          int32_t inSize32 = inSize;
-          memcpy(out + PropHeaderSize, &inSize32, 4);
-
-          result = LzmaEncode(out + HeaderSize,
-                              &outSize,
-                              data,
-                              inSize,
-                              &props,
-                              out,
-                              &propsSize,
-                              1,
-                              &progress,
-                              &allocator,
-                              &allocator);
-
-          outSize += HeaderSize;
+      if (outSize32 >= 0) {
+        outSize = outSize32;
+        out = static_cast<uint8_t*>(malloc(outSize));
+        if (out) {
+          if (isMultiBlock(data, size)) {
+            result = decodeAll(data, size, out, outSize);
+          } else {
+            Block block = {data, size, out, outSize, SZ_ERROR_DATA};
+            status = decode(&block);
+            result = block.result;
+          }
         } else {
-          result = LzmaDecode(out,
-                              &outSize,
-                              data + HeaderSize,
-                              &inSize,
-                              data,
-                              PropHeaderSize,
-                              LZMA_FINISH_END,
-                              &status,
-                              &allocator);
+          fprintf(stderr, "unable to allocate output buffer\n");
+          ready = false;
         }
+      } else {
+        fprintf(stderr, "unable to determine uncompressed size\n");
+        ready = false;
+      }
+    }
 
-        if (result == SZ_OK) {
-          FILE* outFile = fopen(argv[3], "wb");
-
-          if (outFile) {
-            if (fwrite(out, outSize, 1, outFile) == 1) {
-              success = true;
-            } else {
-              fprintf(stderr, "unable to write to %s\n", argv[3]);
-            }
+    if (ready) {
+      if (result == SZ_OK) {
+        FILE* outFile = fopen(argv[3], "wb");
 
-            fclose(outFile);
+        if (outFile) {
+          if (fwrite(out, outSize, 1, outFile) == 1) {
+            success = true;
           } else {
-            fprintf(stderr, "unable to open %s\n", argv[3]);
+            fprintf(stderr, "unable to write to %s\n", argv[3]);
           }
+
+          fclose(outFile);
         } else {
-          fprintf(stderr,
-                  "unable to %s data: result %d status %d\n",
-                  encode ? "encode" : "decode",
-                  result,
-                  status);
+          fprintf(stderr, "unable to open %s\n", argv[3]);
         }
-
-        free(out);
       } else {
-        fprintf(stderr, "unable to allocate output buffer\n");
+        fprintf(stderr,
+                "unable to %s data: result %d status %d\n",
+                encode ? "encode" : "decode",
+                result,
+                status);
       }
-    } else {
-      fprintf(stderr, "unable to determine uncompressed size\n");
     }
 
+    free(out);
+
 #ifdef _WIN32
     UnmapViewOfFile(data);
 #else
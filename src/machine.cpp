@@ -16,6 +16,9 @@
 #include "avian/processor.h"
 #include "avian/arch.h"
 #include "avian/lzma.h"
+#include "avian/zone.h"
+
+#include <avian/system/memory.h>
 
 #include <avian/util/runtime-array.h>
 #include <avian/util/math.h>
@@ -32,16 +35,31 @@ namespace {
 
 const bool DebugClassReader = false;
 
-const unsigned NoByte = 0xFFFF;
+// field and method tables with at least this many entries get a hashed
+// index (see indexTable):
+const unsigned MemberIndexThreshold = 16;
 
-#ifdef USE_ATOMIC_OPERATIONS
-void atomicIncrement(uint32_t* p, int v)
+// the index stores 16-bit positions, with zero meaning an empty slot:
+const unsigned MaximumIndexedMembers = 0xFFFF;
+
+// slots in the cache of resolved JNI field and method IDs (must be a
+// power of two):
+const unsigned JNIIDCacheSize = 256;
+
+// Returns true if any thread in the specified list of siblings or
+// their descendants is in ActiveState.  The caller must hold
+// Machine::stateLock so the thread tree doesn't change under us.
+bool hasActiveThread(Thread* o)
 {
-  for (uint32_t old = *p; not atomicCompareAndSwap32(p, old, old + v);
-       old = *p) {
+  for (Thread* p = o; p; p = p->peer) {
+    if (p->state == Thread::ActiveState
+        or (p->child and hasActiveThread(p->child))) {
+      return true;
+    }
   }
+
+  return false;
 }
-#endif
 
 void join(Thread* t, Thread* o)
 {
@@ -360,6 +378,40 @@ bool walk(Thread*,
   return true;
 }
 
+inline bool visitFrom(Heap::Walker* w, unsigned start, unsigned offset)
+{
+  return offset < start or w->visit(offset);
+}
+
+bool visitArrayFrom(Heap::Walker* w,
+                    unsigned start,
+                    unsigned fixedSizeInWords,
+                    unsigned arrayLength)
+{
+  for (unsigned i = start > fixedSizeInWords ? start - fixedSizeInWords : 0;
+       i < arrayLength;
+       ++i) {
+    if (not w->visit(fixedSizeInWords + i)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Walks an object of one of the VM's own types using the layout the
+// type generator computed for it, which spares us copying and
+// interpreting the class's object mask.
+bool walk(Thread* t, Heap::Walker* w, object o, unsigned type, unsigned start)
+{
+  switch (type) {
+#include "type-walkers.cpp"
+
+  default:
+    abort(t);
+  }
+}
+
 object findInInterfaces(
     Thread* t,
     GcClass* class_,
@@ -479,6 +531,31 @@ bool isFinalizable(Thread* t, object o)
               & HasFinalizerFlag);
 }
 
+// Soft references keep their targets alive through a collection if
+// the target was used (via get) within the last
+// softReferenceMaxIdle milliseconds, which is proportional to the
+// free heap.  Thus soft caches shrink gradually, oldest entries first,
+// as the heap fills rather than being emptied by every collection.
+void keepSoftReferenceTargets(Thread* t, Heap::Visitor* v, GcJreference* list)
+{
+  Machine* m = t->m;
+  for (GcJreference* p = list; p;) {
+    GcJreference* r = m->heap->follow(p);
+    bool reachable = m->heap->status(p) != Heap::Unreachable;
+    p = cast<GcJreference>(t, r->vmNext());
+
+    if (reachable
+        and (m->heap->follow(objectClass(t, r))->vmFlags() & SoftReferenceFlag)
+        and m->heap->status(r->target()) == Heap::Unreachable
+        and m->softReferenceClock
+                    - static_cast<int64_t>(
+                          r->as<GcSoftReference>(t)->timestamp())
+                <= m->softReferenceMaxIdle) {
+      v->visit(&(r->target()));
+    }
+  }
+}
+
 void clearTargetIfFinalizable(Thread* t, GcJreference* r)
 {
   if (isFinalizable(t, t->m->heap->follow(r->target()))) {
@@ -486,6 +563,293 @@ void clearTargetIfFinalizable(Thread* t, GcJreference* r)
   }
 }
 
+void recordSurvival(AllocationSite* site, bool survived)
+{
+  if (survived) {
+    ++site->survived;
+  } else {
+    ++site->died;
+  }
+
+  unsigned total = site->survived + site->died;
+  if (total >= AllocationSiteWindow) {
+    // require a clear majority either way so that a site near the
+    // threshold doesn't flip back and forth
+    if (site->survived * 8 >= total * 7) {
+      site->pretenure = true;
+    } else if (site->survived * 2 < total) {
+      site->pretenure = false;
+    }
+
+    site->survived = 0;
+    site->died = 0;
+  }
+}
+
+// A sample has survived once it reaches gen2 or would have, had it
+// not been sampled, and has died if it becomes unreachable first.
+void sweepAllocationSamples(Thread* t, Heap::Visitor* v)
+{
+  Machine* m = t->m;
+  unsigned count = 0;
+  for (unsigned i = 0; i < m->allocationSampleCount; ++i) {
+    AllocationSample* s = m->allocationSamples + i;
+    Heap::Status status = m->heap->status(s->target);
+
+    if (status == Heap::Unreachable) {
+      recordSurvival(s->site, false);
+    } else {
+      v->visit(&(s->target));
+
+      if (status == Heap::Tenured or ++s->collections > TenureThreshold) {
+        recordSurvival(s->site, true);
+      } else {
+        m->allocationSamples[count++] = *s;
+      }
+    }
+  }
+  m->allocationSampleCount = count;
+}
+
+// Records the innermost frame of the stack it visits.
+class TopFrameVisitor : public Processor::StackVisitor {
+ public:
+  TopFrameVisitor() : method(0), ip(0)
+  {
+  }
+
+  virtual bool visit(Processor::StackWalker* walker)
+  {
+    method = walker->method();
+    ip = walker->ip();
+    return false;
+  }
+
+  GcMethod* method;
+  int ip;
+};
+
+// Appends format's expansion to the profile key in buffer, which
+// already holds length characters, returning the new length.
+unsigned appendToKey(char* buffer,
+                     unsigned capacity,
+                     unsigned length,
+                     const char* format,
+                     ...)
+{
+  va_list a;
+  va_start(a, format);
+  int n = vm::vsnprintf(buffer + length, capacity - length, format, a);
+  va_end(a);
+
+  if (n < 0) {
+    return length;
+  } else {
+    return min(length + n, capacity - 1);
+  }
+}
+
+// Appends "Class.method:line" for the specified frame, or "(vm)" if
+// there is none.
+unsigned appendSite(Thread* t,
+                    char* buffer,
+                    unsigned capacity,
+                    unsigned length,
+                    GcMethod* method,
+                    int ip)
+{
+  if (method) {
+    int line = t->m->processor->lineNumber(t, method, ip);
+    return appendToKey(
+        buffer,
+        capacity,
+        length,
+        line >= 0 ? "%s.%s:%d" : "%s.%s",
+        reinterpret_cast<const char*>(method->class_()->name()->body().begin()),
+        reinterpret_cast<const char*>(method->name()->body().begin()),
+        line);
+  } else {
+    return appendToKey(buffer, capacity, length, "(vm)");
+  }
+}
+
+// Replaces the slashes in class names with dots and returns the key's
+// hash.
+uint32_t finishKey(char* key, unsigned length)
+{
+  uint32_t hash = 0;
+  for (unsigned i = 0; i < length; ++i) {
+    if (key[i] == '/') {
+      key[i] = '.';
+    }
+    hash = (hash * 31) + static_cast<uint8_t>(key[i]);
+  }
+  return hash;
+}
+
+// Adds o's pending allocation sample, if any, to the profile.
+void resolveAllocationSample(Thread* t, Thread* o)
+{
+  PendingAllocationSample* s = &(o->pendingAllocationSample);
+  if (s->target == 0) {
+    return;
+  }
+
+  GcClass* class_ = objectClass(t, s->target);
+  const char* className
+      = class_ ? reinterpret_cast<const char*>(class_->name()->body().begin())
+               : "?";
+
+  char key[512];
+  unsigned length = appendToKey(key, sizeof(key), 0, "%s ", className);
+  length = appendSite(t, key, sizeof(key), length, s->method, s->ip);
+
+  uint32_t hash = finishKey(key, length);
+
+  Machine* m = t->m;
+  ACQUIRE_RAW(t, m->allocationProfileLock);
+
+  AllocationProfileEntry** bucket
+      = m->allocationProfile + (hash & (AllocationProfileBucketCount - 1));
+
+  AllocationProfileEntry* e = *bucket;
+  while (e and (e->hash != hash or e->length != length
+                or memcmp(e->key(), key, length) != 0)) {
+    e = e->next;
+  }
+
+  if (e == 0) {
+    e = new (m->heap->allocate(sizeof(AllocationProfileEntry) + length))
+        AllocationProfileEntry(*bucket, hash, length);
+    memcpy(e->key(), key, length);
+    *bucket = e;
+  }
+
+  ++e->count;
+  e->bytes += s->weight;
+
+  s->target = 0;
+}
+
+void resetAllocationProfileCountdown(Thread* t, Thread* o)
+{
+  unsigned interval = t->m->allocationProfileInterval;
+  o->allocationProfileCountdown = interval ? interval : INT32_MAX;
+}
+
+int compareAllocationProfileEntries(const void* a, const void* b)
+{
+  uint64_t ab = (*static_cast<AllocationProfileEntry* const*>(a))->bytes;
+  uint64_t bb = (*static_cast<AllocationProfileEntry* const*>(b))->bytes;
+  return ab > bb ? -1 : (ab < bb ? 1 : 0);
+}
+
+int compareContentionProfileEntries(const void* a, const void* b)
+{
+  const ContentionProfileEntry* ea
+      = *static_cast<ContentionProfileEntry* const*>(a);
+  const ContentionProfileEntry* eb
+      = *static_cast<ContentionProfileEntry* const*>(b);
+
+  if (ea->milliseconds != eb->milliseconds) {
+    return ea->milliseconds > eb->milliseconds ? -1 : 1;
+  } else {
+    return ea->count > eb->count ? -1 : (ea->count < eb->count ? 1 : 0);
+  }
+}
+
+void addStringDedupCandidate(Machine* m, object string)
+{
+  for (uint32_t i = m->stringDedupCandidateCount;
+       i < StringDedupCandidateCount;
+       i = m->stringDedupCandidateCount) {
+    if (atomicCompareAndSwap32(&(m->stringDedupCandidateCount), i, i + 1)) {
+      m->stringDedupCandidates[i] = string;
+      return;
+    }
+  }
+}
+
+// returns the contents of the specified string array as bytes, or
+// false if it is neither a byte nor a char array
+bool stringDedupKey(Thread* t, object array, Slice<const uint8_t>* key)
+{
+  GcClass* c = objectClass(t, array);
+  if (c == type(t, GcByteArray::Type)) {
+    GcByteArray* a = cast<GcByteArray>(t, array);
+    *key = Slice<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(a->body().begin()), a->length());
+    return true;
+  } else if (c == type(t, GcCharArray::Type)) {
+    GcCharArray* a = cast<GcCharArray>(t, array);
+    *key = Slice<const uint8_t>(
+        reinterpret_cast<const uint8_t*>(a->body().begin()), a->length() * 2);
+    return true;
+  } else {
+    return false;
+  }
+}
+
+// Points each string tenured by this collection at an existing
+// tenured array with the same contents, if there is one, so the
+// string's own array can die.  Only tenured arrays are made canonical,
+// so the table stays valid until the next major collection moves or
+// frees them.  The strings were shaded when they were tenured if gen2
+// is being marked, so the marker will still see their new arrays.
+void deduplicateStrings(Thread* t)
+{
+  Machine* m = t->m;
+
+  if (m->heap->collectionType() == Heap::MajorCollection) {
+    memset(m->stringDedupTable, 0, StringDedupTableSize * BytesPerWord);
+  }
+
+  for (unsigned i = 0; i < m->stringDedupCandidateCount; ++i) {
+    // status() also finishes any copying left to other collector
+    // threads, so the string's fields are up to date afterwards
+    if (m->heap->status(m->stringDedupCandidates[i]) != Heap::Tenured) {
+      continue;
+    }
+
+    GcString* s = cast<GcString>(t, m->stringDedupCandidates[i]);
+    object data = s->data();
+    Slice<const uint8_t> key(0, 0);
+    if (data == 0 or not stringDedupKey(t, data, &key)) {
+      continue;
+    }
+
+    GcClass* class_ = objectClass(t, data);
+    unsigned mask = StringDedupTableSize - 1;
+    for (unsigned j = hash(key) & mask, probes = 0;
+         probes < StringDedupTableSize;
+         j = (j + 1) & mask, ++probes) {
+      object canonical = m->stringDedupTable[j];
+      if (canonical == 0) {
+        if (m->heap->status(data) == Heap::Tenured) {
+          m->stringDedupTable[j] = data;
+        }
+        break;
+      }
+
+      Slice<const uint8_t> canonicalKey(0, 0);
+      if (canonical == data) {
+        break;
+      } else if (objectClass(t, canonical) == class_
+                 and stringDedupKey(t, canonical, &canonicalKey)
+                 and canonicalKey.count == key.count
+                 and memcmp(canonicalKey.begin(), key.begin(), key.count)
+                     == 0) {
+        // both the string and the array are tenured, so this needs no
+        // write barrier
+        *s->dataPtr() = canonical;
+        break;
+      }
+    }
+  }
+
+  m->stringDedupCandidateCount = 0;
+}
+
 void postVisit(Thread* t, Heap::Visitor* v)
 {
   Machine* m = t->m;
@@ -495,6 +859,11 @@ void postVisit(Thread* t, Heap::Visitor* v)
 
   m->heap->postVisit();
 
+  keepSoftReferenceTargets(t, v, m->weakReferences);
+  if (major) {
+    keepSoftReferenceTargets(t, v, m->tenuredWeakReferences);
+  }
+
   for (GcJreference* p = m->weakReferences; p;) {
     GcJreference* r = m->heap->follow(p);
     p = cast<GcJreference>(t, r->vmNext());
@@ -661,30 +1030,103 @@ void postVisit(Thread* t, Heap::Visitor* v)
       }
     }
   }
+
+  sweepAllocationSamples(t, v);
+
+  if (m->stringDedupTable) {
+    deduplicateStrings(t);
+  }
+}
+
+// thread heaps of the default size are kept for reuse by new threads
+// rather than freed, up to SpareThreadHeapCount of them
+uintptr_t* allocateThreadHeap(Machine* m)
+{
+  uintptr_t* heap = 0;
+
+  m->spareThreadHeapLock->acquire();
+  if (m->spareThreadHeapCount) {
+    heap = m->spareThreadHeaps[--m->spareThreadHeapCount];
+  }
+  m->spareThreadHeapLock->release();
+
+  if (heap == 0) {
+    heap = static_cast<uintptr_t*>(m->heap->allocate(ThreadHeapSizeInBytes));
+  }
+
+  return heap;
+}
+
+void releaseThreadHeap(Machine* m, uintptr_t* heap, unsigned sizeInWords)
+{
+  if (sizeInWords == ThreadHeapSizeInWords) {
+    m->spareThreadHeapLock->acquire();
+    bool kept = m->spareThreadHeapCount < SpareThreadHeapCount;
+    if (kept) {
+      m->spareThreadHeaps[m->spareThreadHeapCount++] = heap;
+    }
+    m->spareThreadHeapLock->release();
+
+    if (kept) {
+      return;
+    }
+  }
+
+  m->heap->free(heap, sizeInWords * BytesPerWord);
+}
+
+// picks a size for the next thread-local heap given the number of
+// words allocated since the last collection
+unsigned threadHeapSize(unsigned allocated, unsigned current)
+{
+  // move halfway toward the target so one unusual interval doesn't
+  // swing the size too far:
+  unsigned size = (current + (allocated / ThreadHeapRefillsPerCollection)) / 2;
+
+  size = pad(size, MinimumThreadHeapSizeInWords);
+  if (size < MinimumThreadHeapSizeInWords) {
+    return MinimumThreadHeapSizeInWords;
+  } else if (size > MaximumThreadHeapSizeInWords) {
+    return MaximumThreadHeapSizeInWords;
+  } else {
+    return size;
+  }
 }
 
 void postCollect(Thread* t)
 {
+  unsigned size = threadHeapSize(t->heapOffset + t->heapIndex,
+                                 t->defaultHeapSizeInWords);
+
 #ifdef VM_STRESS
-  t->m->heap->free(t->defaultHeap, ThreadHeapSizeInBytes);
-  t->defaultHeap
-      = static_cast<uintptr_t*>(t->m->heap->allocate(ThreadHeapSizeInBytes));
-  memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
+  bool reallocate = true;
+#else
+  bool reallocate = size != t->defaultHeapSizeInWords;
 #endif
 
-  if (t->heap == t->defaultHeap) {
-    memset(t->defaultHeap, 0, t->heapIndex * BytesPerWord);
-  } else {
-    memset(t->defaultHeap, 0, ThreadHeapSizeInBytes);
-    t->heap = t->defaultHeap;
+  if (reallocate) {
+    releaseThreadHeap(t->m, t->defaultHeap, t->defaultHeapSizeInWords);
+    t->defaultHeapSizeInWords = size;
+    if (size == ThreadHeapSizeInWords) {
+      t->defaultHeap = allocateThreadHeap(t->m);
+    } else {
+      t->defaultHeap = static_cast<uintptr_t*>(
+          t->m->heap->allocate(t->defaultHeapSizeInWords * BytesPerWord));
+    }
   }
 
+  // no need to clear the old contents here, since allocateSmall zeroes
+  // each object as it is allocated
+  t->heap = t->defaultHeap;
+
   t->heapOffset = 0;
+  t->heapSizeInWords = t->defaultHeapSizeInWords;
+  t->heapLimit = t->heap + t->heapSizeInWords;
 
   if (t->m->heap->limitExceeded()) {
     // if we're out of memory, pretend the thread-local heap is
     // already full so we don't make things worse:
-    t->heapIndex = ThreadHeapSizeInWords;
+    t->heapIndex = t->heapSizeInWords;
   } else {
     t->heapIndex = 0;
   }
@@ -696,6 +1138,9 @@ void postCollect(Thread* t)
     t->backupHeapIndex = 0;
   }
 
+  t->monitorCacheObject = 0;
+  t->monitorCacheMonitor = 0;
+
   for (Thread* c = t->child; c; c = c->peer) {
     postCollect(c);
   }
@@ -738,51 +1183,71 @@ void finalizeObject(Thread* t, object o, const char* name)
   abort(t);
 }
 
-unsigned readByte(AbstractStream& s, unsigned* value)
-{
-  if (*value == NoByte) {
-    return s.read1();
-  } else {
-    unsigned r = *value;
-    *value = NoByte;
-    return r;
+// decodes the modified UTF-8 in the first length bytes of bytes, the
+// first ascii of which are known to be ASCII.  As long as every
+// character fits in a byte, this is done in place, since the output
+// can't get ahead of the input; the first that doesn't moves us to a
+// char array.
+object decodeUtf8(Thread* t,
+                  GcByteArray* bytes,
+                  unsigned ascii,
+                  unsigned length)
+{
+  unsigned vi = ascii;
+  unsigned si = ascii;
+  while (si < length) {
+    unsigned a = static_cast<uint8_t>(bytes->body()[si]);
+    if (a & 0x80) {
+      if (a == 0xC0 and si + 1 < length
+          and static_cast<uint8_t>(bytes->body()[si + 1]) == 0x80) {
+        bytes->body()[vi++] = 0;
+        si += 2;
+      } else {
+        break;
+      }
+    } else {
+      bytes->body()[vi++] = a;
+      ++si;
+    }
   }
-}
 
-GcCharArray* parseUtf8NonAscii(Thread* t,
-                               AbstractStream& s,
-                               GcByteArray* bytesSoFar,
-                               unsigned byteCount,
-                               unsigned sourceIndex,
-                               unsigned byteA,
-                               unsigned byteB)
-{
-  PROTECT(t, bytesSoFar);
+  if (si == length) {
+    if (vi < length) {
+      PROTECT(t, bytes);
 
-  unsigned length = bytesSoFar->length() - 1;
-  GcCharArray* value = makeCharArray(t, length + 1);
+      GcByteArray* v = makeByteArray(t, vi + 1);
+      memcpy(v->body().begin(), bytes->body().begin(), vi);
+      return v;
+    }
+    return bytes;
+  }
 
-  unsigned vi = 0;
-  for (; vi < byteCount; ++vi) {
-    value->body()[vi] = bytesSoFar->body()[vi];
+  PROTECT(t, bytes);
+
+  GcCharArray* value = makeCharArray(t, length + 1);
+  for (unsigned i = 0; i < vi; ++i) {
+    value->body()[i] = static_cast<uint8_t>(bytes->body()[i]);
   }
 
-  for (unsigned si = sourceIndex; si < length; ++si) {
-    unsigned a = readByte(s, &byteA);
+  // missing trailing bytes in malformed input read as zero, as they did
+  // when this read from a stream
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(bytes->body().begin());
+  while (si < length) {
+    unsigned a = s[si++];
     if (a & 0x80) {
       if (a & 0x20) {
         // 3 bytes
+        assertT(t, si + 1 < length);
+        unsigned b = si < length ? s[si] : 0;
+        unsigned c = si + 1 < length ? s[si + 1] : 0;
         si += 2;
-        assertT(t, si < length);
-        unsigned b = readByte(s, &byteB);
-        unsigned c = s.read1();
         value->body()[vi++] = ((a & 0xf) << 12) | ((b & 0x3f) << 6)
                               | (c & 0x3f);
       } else {
         // 2 bytes
-        ++si;
         assertT(t, si < length);
-        unsigned b = readByte(s, &byteB);
+        unsigned b = si < length ? s[si] : 0;
+        ++si;
 
         if (a == 0xC0 and b == 0x80) {
           value->body()[vi++] = 0;
@@ -792,52 +1257,21 @@ GcCharArray* parseUtf8NonAscii(Thread* t,
       }
     } else {
       value->body()[vi++] = a;
-    }
-  }
-
-  if (vi < length) {
-    PROTECT(t, value);
-
-    GcCharArray* v = makeCharArray(t, vi + 1);
-    memcpy(v->body().begin(), value->body().begin(), vi * 2);
-    value = v;
-  }
-
-  return value;
-}
-
-object parseUtf8(Thread* t, AbstractStream& s, unsigned length)
-{
-  GcByteArray* value = makeByteArray(t, length + 1);
-  unsigned vi = 0;
-  for (unsigned si = 0; si < length; ++si) {
-    unsigned a = s.read1();
-    if (a & 0x80) {
-      if (a & 0x20) {
-        // 3 bytes
-        return parseUtf8NonAscii(t, s, value, vi, si, a, NoByte);
-      } else {
-        // 2 bytes
-        unsigned b = s.read1();
 
-        if (a == 0xC0 and b == 0x80) {
-          ++si;
-          assertT(t, si < length);
-          value->body()[vi++] = 0;
-        } else {
-          return parseUtf8NonAscii(t, s, value, vi, si, a, b);
-        }
+      // pick up runs of ASCII between other characters a block at a
+      // time too
+      unsigned n = asciiPrefixLength(s + si, length - si);
+      for (unsigned i = 0; i < n; ++i) {
+        value->body()[vi++] = s[si++];
       }
-    } else {
-      value->body()[vi++] = a;
     }
   }
 
   if (vi < length) {
     PROTECT(t, value);
 
-    GcByteArray* v = makeByteArray(t, vi + 1);
-    memcpy(v->body().begin(), value->body().begin(), vi);
+    GcCharArray* v = makeCharArray(t, vi + 1);
+    memcpy(v->body().begin(), value->body().begin(), vi * 2);
     value = v;
   }
 
@@ -851,11 +1285,10 @@ GcByteArray* makeByteArray(Thread* t, Stream& s, unsigned length)
   return value;
 }
 
-void removeByteArray(Thread* t, object o)
-{
-  hashMapRemove(t, roots(t)->byteArrayMap(), o, byteArrayHash, objectEqual);
-}
-
+// Every name and spec read from a class file goes through here, so
+// interned arrays are common enough that we don't register a finalizer
+// for each to remove it from the map once it's collected.  Instead,
+// hashMapInsert purges dead entries when the map would otherwise grow.
 GcByteArray* internByteArray(Thread* t, GcByteArray* array)
 {
   PROTECT(t, array);
@@ -868,7 +1301,6 @@ GcByteArray* internByteArray(Thread* t, GcByteArray* array)
     return cast<GcByteArray>(t, cast<GcJreference>(t, n->first())->target());
   } else {
     hashMapInsert(t, roots(t)->byteArrayMap(), array, 0, byteArrayHash);
-    addFinalizer(t, array, removeByteArray);
     return array;
   }
 }
@@ -1227,7 +1659,7 @@ GcClassAddendum* getClassAddendum(Thread* t, GcClass* class_, GcSingleton* pool)
   if (addendum == 0) {
     PROTECT(t, class_);
 
-    addendum = makeClassAddendum(t, pool, 0, 0, 0, 0, -1, 0, 0);
+    addendum = makeClassAddendum(t, pool, 0, 0, 0, 0, -1, 0, 0, 0, 0);
     setField(t, class_, ClassAddendum, addendum);
   }
   return addendum;
@@ -1310,23 +1742,128 @@ void parseInterfaceTable(Thread* t,
   class_->setInterfaceTable(t, interfaceTable);
 }
 
-void parseFieldTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
-{
-  PROTECT(t, class_);
-  PROTECT(t, pool);
+// The kinds of instance field layoutMemberFields places, in order of
+// preference: references first, then primitives from largest to
+// smallest.
+const unsigned MemberKindCount = 5;
 
-  unsigned memberOffset = BytesPerWord;
-  if (class_->super()) {
-    memberOffset = class_->super()->fixedSize();
+unsigned memberKind(Thread* t, GcField* field)
+{
+  switch (fieldSize(t, field->code())) {
+  case 8:
+    return field->code() == ObjectField ? 0 : 1;
+  case 4:
+    return field->code() == ObjectField ? 0 : 2;
+  case 2:
+    return 3;
+  case 1:
+    return 4;
+  default:
+    abort(t);
   }
+}
 
-  unsigned count = s.read2();
-  if (count) {
-    unsigned staticOffset = BytesPerWord * 3;
-    unsigned staticCount = 0;
-
-    GcArray* fieldTable = makeArray(t, count);
-    PROTECT(t, fieldTable);
+unsigned memberKindSize(unsigned kind)
+{
+  return kind == 0 ? BytesPerWord : 8 >> (kind - 1);
+}
+
+// Gives each field of a class's own instance fields, listed by index
+// into its field table, an offset from the specified one onwards, and
+// returns the offset just past them all.  Classes whose layout the VM
+// declares itself (see types.def) keep declaration order, since that
+// is what the type generator assumes.  Others are packed: each offset
+// goes to the first field left, by kind as above, which is aligned
+// there, so padding is only needed where no field is left small
+// enough to fill it.  That puts a class's references next to each
+// other, which keeps its object mask dense, and on 64-bit targets
+// saves most of the word an int or smaller field between two
+// references would otherwise take.
+unsigned layoutMemberFields(Thread* t,
+                            GcArray* fieldTable,
+                            const unsigned* members,
+                            unsigned count,
+                            unsigned offset,
+                            bool declarationOrder)
+{
+  if (declarationOrder) {
+    for (unsigned i = 0; i < count; ++i) {
+      GcField* field = cast<GcField>(t, fieldTable->body()[members[i]]);
+      unsigned size = fieldSize(t, field->code());
+
+      offset = pad(offset, size);
+      field->offset() = offset;
+      offset += size;
+    }
+    return offset;
+  }
+
+  // next[k] is where to look for the next unplaced field of kind k
+  unsigned next[MemberKindCount];
+  for (unsigned k = 0; k < MemberKindCount; ++k) {
+    next[k] = 0;
+  }
+
+  for (unsigned placed = 0; placed < count;) {
+    bool fitted = false;
+    for (unsigned k = 0; k < MemberKindCount and not fitted; ++k) {
+      if (offset % memberKindSize(k)) {
+        continue;
+      }
+
+      for (; next[k] < count; ++next[k]) {
+        GcField* field = cast<GcField>(t, fieldTable->body()[members[next[k]]]);
+        if (memberKind(t, field) == k) {
+          field->offset() = offset;
+          offset += memberKindSize(k);
+          ++next[k];
+          ++placed;
+          fitted = true;
+          break;
+        }
+      }
+    }
+
+    if (not fitted) {
+      // nothing left fits here, so skip to where the smallest field
+      // left does
+      unsigned size = 0;
+      for (unsigned k = 0; k < MemberKindCount; ++k) {
+        for (unsigned i = next[k]; i < count; ++i) {
+          GcField* field = cast<GcField>(t, fieldTable->body()[members[i]]);
+          if (memberKind(t, field) == k) {
+            if (size == 0 or memberKindSize(k) < size) {
+              size = memberKindSize(k);
+            }
+            break;
+          }
+        }
+      }
+
+      offset = pad(offset, size);
+    }
+  }
+
+  return offset;
+}
+
+void parseFieldTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
+{
+  PROTECT(t, class_);
+  PROTECT(t, pool);
+
+  unsigned memberOffset = BytesPerWord;
+  if (class_->super()) {
+    memberOffset = class_->super()->fixedSize();
+  }
+
+  unsigned count = s.read2();
+  if (count) {
+    unsigned staticOffset = BytesPerWord * 3;
+    unsigned staticCount = 0;
+
+    GcArray* fieldTable = makeArray(t, count);
+    PROTECT(t, fieldTable);
 
     GcIntArray* staticValueTable = makeIntArray(t, count);
     PROTECT(t, staticValueTable);
@@ -1335,6 +1872,8 @@ void parseFieldTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
     PROTECT(t, addendum);
 
     THREAD_RUNTIME_ARRAY(t, uint8_t, staticTypes, count);
+    THREAD_RUNTIME_ARRAY(t, unsigned, members, count);
+    unsigned memberCount = 0;
 
     for (unsigned i = 0; i < count; ++i) {
       unsigned flags = s.read2();
@@ -1409,11 +1948,7 @@ void parseFieldTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
           class_->vmFlags() |= HasFinalMemberFlag;
         }
 
-        memberOffset = pad(memberOffset, size);
-
-        field->offset() = memberOffset;
-
-        memberOffset += size;
+        RUNTIME_ARRAY_BODY(members)[memberCount++] = i;
       }
 
       fieldTable->setBodyElement(t, i, field);
@@ -1421,6 +1956,23 @@ void parseFieldTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
 
     class_->setFieldTable(t, fieldTable);
 
+    if (memberCount) {
+      bool declaredByVM
+          = roots(t)->bootstrapClassMap()
+            and hashMapFind(t,
+                            roots(t)->bootstrapClassMap(),
+                            class_->name(),
+                            byteArrayHash,
+                            byteArrayEqual);
+
+      memberOffset = layoutMemberFields(t,
+                                        fieldTable,
+                                        RUNTIME_ARRAY_BODY(members),
+                                        memberCount,
+                                        memberOffset,
+                                        declaredByVM);
+    }
+
     if (staticCount) {
       unsigned footprint
           = ceilingDivide(staticOffset - (BytesPerWord * 2), BytesPerWord);
@@ -2348,21 +2900,149 @@ GcCode* parseCode(Thread* t, Stream& s, GcSingleton* pool)
   return code;
 }
 
-GcList* addInterfaceMethods(Thread* t,
-                            GcClass* class_,
-                            GcHashMap* virtualMap,
-                            unsigned* virtualCount,
-                            bool makeList)
+// Maps the name and spec of each virtual method of a class being
+// parsed to the method occupying its slot in the class's virtual
+// table.  Only the slots themselves are allocated on the heap, as a
+// single array; the hash chains live in a zone freed once the class
+// is parsed, and refer to slots by number so the collector need not
+// know about them.
+class VirtualMap {
+ public:
+  class Entry {
+   public:
+    Entry(Entry* next, uint32_t hash, unsigned slot)
+        : next(next), hash(hash), slot(slot)
+    {
+    }
+
+    Entry* next;
+    uint32_t hash;
+    unsigned slot;
+  };
+
+  VirtualMap(Thread* t, unsigned capacity)
+      : t(t),
+        zone(t->m->heap, 0),
+        slots(0),
+        buckets(0),
+        bucketCount(0),
+        count(0)
+  {
+    if (capacity == 0) {
+      capacity = 1;
+    }
+    slots = makeArray(t, capacity);
+    rehash(avian::util::nextPowerOfTwo(capacity));
+  }
+
+  unsigned size()
+  {
+    return count;
+  }
+
+  GcMethod* get(unsigned slot)
+  {
+    return cast<GcMethod>(t, slots->body()[slot]);
+  }
+
+  void set(unsigned slot, GcMethod* method)
+  {
+    slots->setBodyElement(t, slot, method);
+  }
+
+  GcMethod* find(GcMethod* method)
+  {
+    uint32_t hash = methodHash(t, method);
+    for (Entry* e = buckets[hash & (bucketCount - 1)]; e; e = e->next) {
+      if (e->hash == hash and methodEqual(t, get(e->slot), method)) {
+        return get(e->slot);
+      }
+    }
+    return 0;
+  }
+
+  // puts the method in the next free slot, returning its number
+  unsigned add(GcMethod* method)
+  {
+    PROTECT(t, method);
+
+    if (count == slots->length()) {
+      GcArray* newSlots = makeArray(t, count * 2);
+      for (unsigned i = 0; i < count; ++i) {
+        newSlots->setBodyElement(t, i, slots->body()[i]);
+      }
+      slots = newSlots;
+    }
+
+    if (count == bucketCount) {
+      rehash(bucketCount * 2);
+    }
+
+    uint32_t hash = methodHash(t, method);
+    Entry** bucket = buckets + (hash & (bucketCount - 1));
+    *bucket = new (zone.allocate(sizeof(Entry))) Entry(*bucket, hash, count);
+
+    set(count, method);
+    return count++;
+  }
+
+  // returns the methods in slot order, as a virtual table
+  GcArray* table()
+  {
+    if (count == slots->length()) {
+      return slots;
+    }
+
+    GcArray* table = makeArray(t, count);
+    for (unsigned i = 0; i < count; ++i) {
+      table->setBodyElement(t, i, slots->body()[i]);
+    }
+    return table;
+  }
+
+  void dispose()
+  {
+    zone.dispose();
+  }
+
+  Thread* t;
+  Zone zone;
+  GcArray* slots;
+  Entry** buckets;
+  unsigned bucketCount;
+  unsigned count;
+
+ private:
+  void rehash(unsigned newBucketCount)
+  {
+    Entry** newBuckets = static_cast<Entry**>(
+        zone.allocate(newBucketCount * sizeof(Entry*)));
+    memset(newBuckets, 0, newBucketCount * sizeof(Entry*));
+
+    for (unsigned i = 0; i < bucketCount; ++i) {
+      for (Entry* e = buckets[i]; e;) {
+        Entry* next = e->next;
+        Entry** bucket = newBuckets + (e->hash & (newBucketCount - 1));
+        e->next = *bucket;
+        *bucket = e;
+        e = next;
+      }
+    }
+
+    buckets = newBuckets;
+    bucketCount = newBucketCount;
+  }
+};
+
+// Gives the class an abstract method for each method of the interfaces
+// it implements which the map doesn't already contain.
+void addInterfaceMethods(Thread* t, GcClass* class_, VirtualMap* map)
 {
   GcArray* itable = cast<GcArray>(t, class_->interfaceTable());
   if (itable) {
     PROTECT(t, class_);
-    PROTECT(t, virtualMap);
     PROTECT(t, itable);
 
-    GcList* list = 0;
-    PROTECT(t, list);
-
     GcMethod* method = 0;
     PROTECT(t, method);
 
@@ -2376,16 +3056,14 @@ GcList* addInterfaceMethods(Thread* t,
       if (vtable) {
         for (unsigned j = 0; j < vtable->length(); ++j) {
           method = cast<GcMethod>(t, vtable->body()[j]);
-          GcTriple* n
-              = hashMapFindNode(t, virtualMap, method, methodHash, methodEqual);
-          if (n == 0) {
+          if (map->find(method) == 0) {
             method = makeMethod(t,
                                 method->vmFlags(),
                                 method->returnCode(),
                                 method->parameterCount(),
                                 method->parameterFootprint(),
                                 method->flags(),
-                                (*virtualCount)++,
+                                map->size(),
                                 0,
                                 0,
                                 method->name(),
@@ -2394,23 +3072,12 @@ GcList* addInterfaceMethods(Thread* t,
                                 class_,
                                 method->code());
 
-            hashMapInsert(t, virtualMap, method, method, methodHash);
-
-            if (makeList) {
-              if (list == 0) {
-                list = vm::makeList(t, 0, 0, 0);
-              }
-              listAppend(t, list, method);
-            }
+            map->add(method);
           }
         }
       }
     }
-
-    return list;
   }
-
-  return 0;
 }
 
 void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
@@ -2418,34 +3085,29 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
   PROTECT(t, class_);
   PROTECT(t, pool);
 
-  GcHashMap* virtualMap = makeHashMap(t, 0, 0);
-  PROTECT(t, virtualMap);
-
-  unsigned virtualCount = 0;
   unsigned declaredVirtualCount = 0;
 
   GcArray* superVirtualTable = 0;
   PROTECT(t, superVirtualTable);
 
-  if ((class_->flags() & ACC_INTERFACE) == 0) {
-    if (class_->super()) {
-      superVirtualTable = cast<GcArray>(t, class_->super()->virtualTable());
-    }
-
-    if (superVirtualTable) {
-      virtualCount = superVirtualTable->length();
-      for (unsigned i = 0; i < virtualCount; ++i) {
-        object method = superVirtualTable->body()[i];
-        hashMapInsert(t, virtualMap, method, method, methodHash);
-      }
-    }
+  if ((class_->flags() & ACC_INTERFACE) == 0 and class_->super()) {
+    superVirtualTable = cast<GcArray>(t, class_->super()->virtualTable());
   }
 
-  GcList* newVirtuals = makeList(t, 0, 0, 0);
-  PROTECT(t, newVirtuals);
+  unsigned superVirtualCount
+      = superVirtualTable ? superVirtualTable->length() : 0;
 
   unsigned count = s.read2();
 
+  VirtualMap virtualMap(t, superVirtualCount + count);
+  PROTECT(t, virtualMap.slots);
+  VirtualMap* map = &virtualMap;
+  THREAD_RESOURCE(t, VirtualMap*, map, map->dispose());
+
+  for (unsigned i = 0; i < superVirtualCount; ++i) {
+    virtualMap.add(cast<GcMethod>(t, superVirtualTable->body()[i]));
+  }
+
   if (DebugClassReader) {
     fprintf(stderr, "  method count %d\n", count);
   }
@@ -2581,19 +3243,14 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
       if (methodVirtual(t, method)) {
         ++declaredVirtualCount;
 
-        GcTriple* p
-            = hashMapFindNode(t, virtualMap, method, methodHash, methodEqual);
+        GcMethod* p = virtualMap.find(method);
 
         if (p) {
-          method->offset() = cast<GcMethod>(t, p->first())->offset();
+          method->offset() = p->offset();
 
-          p->setSecond(t, method);
+          virtualMap.set(p->offset(), method);
         } else {
-          method->offset() = virtualCount++;
-
-          listAppend(t, newVirtuals, method);
-
-          hashMapInsert(t, virtualMap, method, method, methodHash);
+          method->offset() = virtualMap.add(method);
         }
 
         if (UNLIKELY((class_->flags() & ACC_INTERFACE) == 0
@@ -2623,14 +3280,15 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
     class_->setMethodTable(t, methodTable);
   }
 
-  GcList* abstractVirtuals
-      = addInterfaceMethods(t, class_, virtualMap, &virtualCount, true);
+  unsigned firstAbstractVirtual = virtualMap.size();
+
+  addInterfaceMethods(t, class_, &virtualMap);
 
-  PROTECT(t, abstractVirtuals);
+  unsigned abstractVirtualCount = virtualMap.size() - firstAbstractVirtual;
 
   bool populateInterfaceVtables = false;
 
-  if (declaredVirtualCount == 0 and abstractVirtuals == 0
+  if (declaredVirtualCount == 0 and abstractVirtualCount == 0
       and (class_->flags() & ACC_INTERFACE) == 0) {
     if (class_->super()) {
       // inherit virtual table from superclass
@@ -2651,41 +3309,17 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
       GcArray* vtable = makeArray(t, 0);
       class_->setVirtualTable(t, vtable);
     }
-  } else if (virtualCount) {
-    // generate class vtable
-
-    GcArray* vtable = makeArray(t, virtualCount);
-
-    unsigned i = 0;
-    if (class_->flags() & ACC_INTERFACE) {
-      PROTECT(t, vtable);
+  } else if (virtualMap.size()) {
+    // generate class vtable, in which each method's offset is its slot
+    // in the map
 
-      for (HashMapIterator it(t, virtualMap); it.hasMore();) {
-        GcMethod* method = cast<GcMethod>(t, it.next()->first());
-        assertT(t, vtable->body()[method->offset()] == 0);
-        vtable->setBodyElement(t, method->offset(), method);
-        ++i;
-      }
-    } else {
+    if ((class_->flags() & ACC_INTERFACE) == 0) {
       populateInterfaceVtables = true;
-
-      if (superVirtualTable) {
-        for (; i < superVirtualTable->length(); ++i) {
-          object method = superVirtualTable->body()[i];
-          method = hashMapFind(t, virtualMap, method, methodHash, methodEqual);
-
-          vtable->setBodyElement(t, i, method);
-        }
-      }
-
-      for (GcPair* p = cast<GcPair>(t, newVirtuals->front()); p;
-           p = cast<GcPair>(t, p->second())) {
-        vtable->setBodyElement(t, i, p->first());
-        ++i;
-      }
     }
 
-    if (abstractVirtuals) {
+    GcArray* vtable = virtualMap.table();
+
+    if (abstractVirtualCount) {
       PROTECT(t, vtable);
 
       object originalMethodTable = class_->methodTable();
@@ -2700,7 +3334,7 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
       addendum->declaredMethodCount() = oldLength;
 
       GcArray* newMethodTable
-          = makeArray(t, oldLength + abstractVirtuals->size());
+          = makeArray(t, oldLength + abstractVirtualCount);
 
       if (oldLength) {
         GcArray* mtable = cast<GcArray>(t, class_->methodTable());
@@ -2712,13 +3346,8 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
       mark(t, newMethodTable, ArrayBody, oldLength);
 
       unsigned mti = oldLength;
-      for (GcPair* p = cast<GcPair>(t, abstractVirtuals->front()); p;
-           p = cast<GcPair>(t, p->second())) {
-        newMethodTable->setBodyElement(t, mti++, p->first());
-
-        if ((class_->flags() & ACC_INTERFACE) == 0) {
-          vtable->setBodyElement(t, i++, p->first());
-        }
+      for (unsigned i = firstAbstractVirtual; i < virtualMap.size(); ++i) {
+        newMethodTable->setBodyElement(t, mti++, virtualMap.get(i));
       }
 
       assertT(t, newMethodTable->length() == mti);
@@ -2726,8 +3355,6 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
       class_->setMethodTable(t, newMethodTable);
     }
 
-    assertT(t, vtable->length() == i);
-
     class_->setVirtualTable(t, vtable);
   }
 
@@ -2744,9 +3371,8 @@ void parseMethodTable(Thread* t, Stream& s, GcClass* class_, GcSingleton* pool)
           GcArray* vtable = cast<GcArray>(t, itable->body()[i + 1]);
 
           for (unsigned j = 0; j < ivtable->length(); ++j) {
-            object method = ivtable->body()[j];
-            method
-                = hashMapFind(t, virtualMap, method, methodHash, methodEqual);
+            GcMethod* method
+                = virtualMap.find(cast<GcMethod>(t, ivtable->body()[j]));
             assertT(t, method);
 
             vtable->setBodyElement(t, j, method);
@@ -2898,6 +3524,73 @@ void updateClassTables(Thread* t, GcClass* newClass, GcClass* oldClass)
   }
 }
 
+// Records class_ and its superclasses by depth, so that
+// isAssignableFrom can find out whether a class is a superclass of
+// class_ with a single comparison.
+void initDisplay(Thread* t, GcClass* class_)
+{
+  if (class_->display()) {
+    return;
+  }
+
+  PROTECT(t, class_);
+
+  unsigned depth = 0;
+  if (class_->super()) {
+    initDisplay(t, class_->super());
+    depth = cast<GcArray>(t, class_->super()->display())->length();
+  }
+
+  GcArray* display = makeArray(t, depth + 1);
+
+  if (depth) {
+    GcArray* superDisplay = cast<GcArray>(t, class_->super()->display());
+    for (unsigned i = 0; i < depth; ++i) {
+      display->setBodyElement(t, i, superDisplay->body()[i]);
+    }
+  }
+  display->setBodyElement(t, depth, class_);
+
+  class_->setDisplay(t, display);
+}
+
+// Hashes each interface class_ implements to its position in the
+// interface table, so findInterfaceMethod and isAssignableFrom needn't
+// scan the table for classes implementing many interfaces.
+void initInterfaceIndex(Thread* t, GcClass* class_)
+{
+  GcArray* itable = cast<GcArray>(t, class_->interfaceTable());
+  if ((class_->flags() & ACC_INTERFACE) or itable == 0
+      or itable->length() / 2 < InterfaceIndexThreshold) {
+    return;
+  }
+
+  if (class_->super() and class_->super()->interfaceTable() == itable) {
+    class_->setInterfaceIndex(t, class_->super()->interfaceIndex());
+    return;
+  }
+
+  PROTECT(t, class_);
+  PROTECT(t, itable);
+
+  // keep the table at most half full so probe sequences stay short
+  unsigned capacity = 1;
+  while (capacity < itable->length()) {
+    capacity <<= 1;
+  }
+
+  GcIntArray* index = makeIntArray(t, capacity);
+  for (unsigned i = 0; i < itable->length(); i += 2) {
+    unsigned j = objectHash(t, itable->body()[i]) & (capacity - 1);
+    while (index->body()[j]) {
+      j = (j + 1) & (capacity - 1);
+    }
+    index->body()[j] = i + 1;
+  }
+
+  class_->setInterfaceIndex(t, index);
+}
+
 void updateBootstrapClass(Thread* t, GcClass* bootstrapClass, GcClass* class_)
 {
   expect(t, bootstrapClass != class_);
@@ -2921,6 +3614,7 @@ void updateBootstrapClass(Thread* t, GcClass* bootstrapClass, GcClass* class_)
   bootstrapClass->setArrayElementClass(t, class_->arrayElementClass());
   bootstrapClass->setSuper(t, class_->super());
   bootstrapClass->setInterfaceTable(t, class_->interfaceTable());
+  bootstrapClass->setInterfaceIndex(t, class_->interfaceIndex());
   bootstrapClass->setVirtualTable(t, class_->virtualTable());
   bootstrapClass->setFieldTable(t, class_->fieldTable());
   bootstrapClass->setMethodTable(t, class_->methodTable());
@@ -2980,6 +3674,8 @@ GcClass* makeArrayClass(Thread* t,
 
   PROTECT(t, c);
 
+  initDisplay(t, c);
+
   t->m->processor->initVtable(t, c);
 
   return c;
@@ -2999,6 +3695,11 @@ void saveLoadedClass(Thread* t, GcClassLoader* loader, GcClass* c)
 
   hashMapInsert(
       t, cast<GcHashMap>(t, loader->map()), c->name(), c, byteArrayHash);
+
+  // array classes are never cached as misses, so they needn't count
+  if (c->arrayDimensions() == 0) {
+    ++t->m->savedClassCount;
+  }
 }
 
 GcClass* makeArrayClass(Thread* t,
@@ -3130,9 +3831,114 @@ void removeMonitor(Thread* t, object o)
   }
 }
 
-void removeString(Thread* t, object o)
+// Replaces the table of a weak map which other threads search without
+// synchronizing (i.e. the monitor and string maps) with one twice the
+// size.  Unlike hashMapResize, this copies the nodes rather than
+// relinking them, so that threads searching the old table concurrently
+// still find what they're looking for.  Entries the collector has
+// cleared are left behind.  The caller must hold referenceLock, and
+// should retry if the table turns out to have changed anyway, which can
+// happen if a collection removes entries while we allocate.
+void growSharedMap(Thread* t,
+                   GcHashMap* map,
+                   uint32_t (*hash)(Thread*, object))
+{
+  PROTECT(t, map);
+
+  GcArray* oldArray = map->array();
+  PROTECT(t, oldArray);
+
+  unsigned count = 0;
+  if (oldArray) {
+    for (unsigned i = 0; i < oldArray->length(); ++i) {
+      for (GcTriple* p = cast<GcTriple>(t, oldArray->body()[i]); p;
+           p = cast<GcTriple>(t, p->third())) {
+        ++count;
+      }
+    }
+  }
+
+  unsigned newLength = oldArray ? oldArray->length() * 2 : 16;
+  GcArray* newArray = makeArray(t, newLength);
+  PROTECT(t, newArray);
+
+  // allocate the copies up front, since a collection in the middle of
+  // copying could change the old table under us
+  GcTriple* copies = 0;
+  PROTECT(t, copies);
+  for (unsigned i = 0; i < count; ++i) {
+    copies = makeTriple(t, 0, 0, copies);
+  }
+
+  if (map->array() != oldArray) {
+    return;
+  }
+
+  unsigned size = 0;
+  if (oldArray) {
+    for (unsigned i = 0; i < oldArray->length(); ++i) {
+      for (GcTriple* p = cast<GcTriple>(t, oldArray->body()[i]); p;
+           p = cast<GcTriple>(t, p->third())) {
+        object k = cast<GcJreference>(t, p->first())->target();
+        if (k == 0) {
+          continue;
+        }
+
+        GcTriple* copy = copies;
+        copies = cast<GcTriple>(t, copy->third());
+
+        unsigned index = hash(t, k) & (newLength - 1);
+
+        copy->setFirst(t, p->first());
+        copy->setSecond(t, p->second());
+        copy->setThird(t, newArray->body()[index]);
+        newArray->setBodyElement(t, index, copy);
+        ++size;
+      }
+    }
+  }
+
+  map->size() = size;
+
+  storeStoreMemoryBarrier();
+
+  map->setArray(t, newArray);
+}
+
+// Unlinks the nodes in the specified bucket of the string map whose
+// strings the collector has cleared.  Threads searching the bucket
+// concurrently may still be looking at an unlinked node, but its next
+// pointer is left alone, so they carry on down the bucket unharmed.
+void sweepStringBucket(Thread* t, GcHashMap* map, unsigned index)
+{
+  GcArray* array = map->array();
+  GcTriple* p = 0;
+  for (GcTriple* n = cast<GcTriple>(t, array->body()[index]); n;
+       n = cast<GcTriple>(t, n->third())) {
+    if (cast<GcJreference>(t, n->first())->target()) {
+      p = n;
+    } else {
+      if (p) {
+        p->setThird(t, n->third());
+      } else {
+        array->setBodyElement(t, index, n->third());
+      }
+      --map->size();
+    }
+  }
+}
+
+// Interned strings are held weakly, so drop the ones which didn't
+// survive the last collection.  We only bother after a major
+// collection; insertions and table growth pick up the rest as they go.
+void sweepStringMap(Thread* t)
 {
-  hashMapRemove(t, roots(t)->stringMap(), o, stringHash, objectEqual);
+  GcHashMap* map = roots(t)->stringMap();
+  if (map and map->array()) {
+    for (unsigned i = 0; i < map->array()->length(); ++i) {
+      sweepStringBucket(t, map, i);
+    }
+  }
 }
 
 void bootClass(Thread* t,
@@ -3212,6 +4018,12 @@ void bootClass(Thread* t,
                                                roots(t)->bootLoader(),
                                                vtableLength);
 
+  // type-walkers.cpp has a walker for exactly those types which have a
+  // non-trivial mask
+  if (objectMask) {
+    class_->vmType() = type + 1;
+  }
+
   setType(t, type, class_);
 }
 
@@ -3315,11 +4127,14 @@ void boot(Thread* t)
 
   type(t, GcContinuation::Type)->vmFlags() |= ContinuationFlag;
 
+  type(t, GcString::Type)->vmFlags() |= StringFlag;
+
   type(t, GcJreference::Type)->vmFlags() |= ReferenceFlag;
   type(t, GcWeakReference::Type)->vmFlags() |= ReferenceFlag
                                                | WeakReferenceFlag;
   type(t, GcSoftReference::Type)->vmFlags() |= ReferenceFlag
-                                               | WeakReferenceFlag;
+                                               | WeakReferenceFlag
+                                               | SoftReferenceFlag;
   type(t, GcPhantomReference::Type)->vmFlags() |= ReferenceFlag
                                                   | WeakReferenceFlag;
 
@@ -3391,6 +4206,10 @@ void boot(Thread* t)
   type(t, GcDoubleArray::Type)
       ->setInterfaceTable(t, roots(t)->arrayInterfaceTable());
 
+  for (unsigned i = 0; i < TypeCount; ++i) {
+    initDisplay(t, type(t, static_cast<Gc::Type>(i)));
+  }
+
   m->processor->boot(t, 0, 0);
 
   {
@@ -3484,6 +4303,18 @@ class HeapClient : public Heap::Client {
     }
   }
 
+  virtual void tenured(void* p)
+  {
+    if (m->stringDedupTable) {
+      Thread* t = m->rootThread;
+      object o = static_cast<object>(p);
+
+      if (m->heap->follow(objectClass(t, o))->vmFlags() & StringFlag) {
+        addStringDedupCandidate(m, o);
+      }
+    }
+  }
+
   virtual void walk(void* p, Heap::Walker* w)
   {
     object o = static_cast<object>(m->heap->follow(maskAlignedPointer(p)));
@@ -3499,6 +4330,63 @@ class HeapClient : public Heap::Client {
   Machine* m;
 };
 
+void logCollection(Machine* m)
+{
+  const Heap::Statistics& s = m->heap->statistics();
+
+  fprintf(m->gcLog,
+          "%s collection %d: %dms; "
+          "gen1: %d -> %d; gen2: %d -> %d; "
+          "copied: %d; tenured: %d; "
+          "fixies: %d freed, %d untenured, %d tenured\n",
+          s.type == Heap::MajorCollection ? "major" : "minor",
+          s.collections,
+          static_cast<int>(s.pauseTime),
+          s.gen1Before,
+          s.gen1After,
+          s.gen2Before,
+          s.gen2After,
+          s.copied,
+          s.tenured,
+          s.freedFixies,
+          s.untenuredFixies,
+          s.tenuredFixies);
+  fflush(m->gcLog);
+}
+
+// the free heap as of the latest collection decides how long soft
+// references' targets may go unused (see keepSoftReferenceTargets)
+void updateSoftReferenceMaxIdle(Machine* m)
+{
+  m->softReferenceMaxIdle
+      = static_cast<int64_t>(m->heap->remaining() / (1024 * 1024))
+        * m->softReferenceMillisecondsPerMegabyte;
+}
+
+// SoftReference.get records the time of the latest collection as
+// that of the target's last use, so we keep its static clock field
+// up to date.  We look the field up by name since its offset depends
+// on the class library.
+void publishSoftReferenceClock(Thread* t)
+{
+  GcClass* c = type(t, GcSoftReference::Type);
+  GcArray* fieldTable = cast<GcArray>(t, c->fieldTable());
+  if (c->staticTable() == 0 or fieldTable == 0) {
+    return;
+  }
+
+  for (unsigned i = 0; i < fieldTable->length(); ++i) {
+    GcField* field = cast<GcField>(t, fieldTable->body()[i]);
+    if ((field->flags() & ACC_STATIC) and field->code() == LongField
+        and ::strcmp(reinterpret_cast<char*>(field->name()->body().begin()),
+                     "clock") == 0) {
+      fieldAtOffset<int64_t>(c->staticTable(), field->offset())
+          = t->m->softReferenceClock;
+      return;
+    }
+  }
+}
+
 void doCollect(Thread* t, Heap::CollectionType type, int pendingAllocation)
 {
   expect(t, not t->m->collecting);
@@ -3514,21 +4402,48 @@ void doCollect(Thread* t, Heap::CollectionType type, int pendingAllocation)
 
   Machine* m = t->m;
 
+  // pending samples refer to objects and methods by address, so they
+  // must be resolved before anything moves
+  visitAll(t, m->rootThread, resolveAllocationSample);
+
+  recordEvent(t, GcBeginEvent, type);
+  int64_t start = m->system->nanoTime();
+
+  m->softReferenceClock = m->system->now();
+
   m->unsafe = true;
-  m->heap->collect(
-      type,
-      footprint(m->rootThread),
-      pendingAllocation - (t->m->heapPoolIndex * ThreadHeapSizeInWords));
+  m->heap->collect(type,
+                   footprint(m->rootThread),
+                   pendingAllocation - t->m->heapPoolFootprint);
   m->unsafe = false;
 
+  recordEvent(t, GcEndEvent, type, m->system->nanoTime() - start);
+
+  if (m->gcLog) {
+    logCollection(m);
+  }
+
   postCollect(m->rootThread);
 
+  updateSoftReferenceMaxIdle(m);
+  publishSoftReferenceClock(t);
+
+  if (m->heap->collectionType() == Heap::MajorCollection) {
+    sweepStringMap(t);
+  }
+
   killZombies(t, m->rootThread);
 
   for (unsigned i = 0; i < m->heapPoolIndex; ++i) {
-    m->heap->free(m->heapPool[i], ThreadHeapSizeInBytes);
+    m->heap->free(m->heapPool[i], m->heapPoolSizeInWords[i] * BytesPerWord);
   }
   m->heapPoolIndex = 0;
+  m->heapPoolFootprint = 0;
+
+  unsigned budget = m->heap->incomingBudget() / BytesPerWord;
+  if (budget) {
+    m->heapPoolCapacityInWords = budget;
+  }
 
   if (m->heap->limitExceeded()) {
     // if we're out of memory, disallow further allocations of fixed
@@ -3553,15 +4468,27 @@ void doCollect(Thread* t, Heap::CollectionType type, int pendingAllocation)
   }
 
   if ((roots(t)->objectsToFinalize() or roots(t)->objectsToClean())
-      and m->finalizeThread == 0 and t->state != Thread::ExitState) {
-    m->finalizeThread = m->processor->makeThread(
-        m, roots(t)->finalizerThread(), m->rootThread);
-
-    addThread(t, m->finalizeThread);
-
-    if (not startThread(t, m->finalizeThread)) {
-      removeThread(t, m->finalizeThread);
-      m->finalizeThread = 0;
+      and t->state != Thread::ExitState) {
+    // start any members of the finalizer pool which aren't yet running:
+    for (unsigned i = 0; i < m->finalizeThreadCount; ++i) {
+      if (m->finalizeThreads[i] == 0) {
+        Thread* p = m->processor->makeThread(
+            m,
+            cast<GcThread>(
+                t, cast<GcArray>(t, roots(t)->finalizerThreads())->body()[i]),
+            m->rootThread);
+
+        p->setFlag(Thread::FinalizeFlag);
+
+        addThread(t, p);
+
+        if (startThread(t, p)) {
+          m->finalizeThreads[i] = p;
+        } else {
+          removeThread(t, p);
+          break;
+        }
+      }
     }
   }
 }
@@ -3586,6 +4513,119 @@ bool isInitializing(Thread* t, GcClass* c)
   return false;
 }
 
+GcByteArray* getFieldName(Thread* t, object obj)
+{
+  return reinterpret_cast<GcByteArray*>(cast<GcField>(t, obj)->name());
+}
+
+GcByteArray* getFieldSpec(Thread* t, object obj)
+{
+  return reinterpret_cast<GcByteArray*>(cast<GcField>(t, obj)->spec());
+}
+
+GcByteArray* getMethodName(Thread* t, object obj)
+{
+  return reinterpret_cast<GcByteArray*>(cast<GcMethod>(t, obj)->name());
+}
+
+GcByteArray* getMethodSpec(Thread* t, object obj)
+{
+  return reinterpret_cast<GcByteArray*>(cast<GcMethod>(t, obj)->spec());
+}
+
+uint32_t memberHash(GcByteArray* name, GcByteArray* spec)
+{
+  return (hash(reinterpret_cast<const char*>(name->body().begin())) * 31)
+         + hash(reinterpret_cast<const char*>(spec->body().begin()));
+}
+
+// member names and specs read from class files are interned, so we
+// can usually avoid comparing them character by character:
+bool memberEqual(GcByteArray* a, GcByteArray* b)
+{
+  return a == b or vm::strcmp(a->body().begin(), b->body().begin()) == 0;
+}
+
+// Builds an open-addressed hash table mapping name/spec pairs to
+// positions in the specified field or method table.  Lookups check
+// that the index still refers to the class's current table and scan the
+// table linearly if it doesn't (e.g. because the class came from a boot
+// image built without indexes).
+GcMemberIndex* indexTable(Thread* t,
+                          GcArray* table,
+                          GcByteArray* (*getName)(Thread*, object),
+                          GcByteArray* (*getSpec)(Thread*, object))
+{
+  PROTECT(t, table);
+
+  unsigned capacity = 1;
+  while (capacity < table->length() * 2) {
+    capacity *= 2;
+  }
+
+  GcMemberIndex* index = makeMemberIndex(t, table, capacity);
+
+  unsigned mask = capacity - 1;
+  for (unsigned i = 0; i < table->length(); ++i) {
+    object o = table->body()[i];
+    unsigned j = memberHash(getName(t, o), getSpec(t, o)) & mask;
+    while (index->body()[j]) {
+      j = (j + 1) & mask;
+    }
+    index->body()[j] = i + 1;
+  }
+
+  return index;
+}
+
+void indexMembers(Thread* t, GcClass* class_, GcSingleton* pool)
+{
+  PROTECT(t, class_);
+  PROTECT(t, pool);
+
+  GcArray* fieldTable = cast<GcArray>(t, class_->fieldTable());
+  if (fieldTable and fieldTable->length() >= MemberIndexThreshold
+      and fieldTable->length() < MaximumIndexedMembers) {
+    GcMemberIndex* index
+        = indexTable(t, fieldTable, getFieldName, getFieldSpec);
+    PROTECT(t, index);
+
+    getClassAddendum(t, class_, pool)->setFieldIndex(t, index);
+  }
+
+  GcArray* methodTable = cast<GcArray>(t, class_->methodTable());
+  if (methodTable and methodTable->length() >= MemberIndexThreshold
+      and methodTable->length() < MaximumIndexedMembers) {
+    GcMemberIndex* index
+        = indexTable(t, methodTable, getMethodName, getMethodSpec);
+    PROTECT(t, index);
+
+    getClassAddendum(t, class_, pool)->setMethodIndex(t, index);
+  }
+}
+
+object findInIndex(Thread* t,
+                   GcMemberIndex* index,
+                   GcArray* table,
+                   GcByteArray* name,
+                   GcByteArray* spec,
+                   GcByteArray* (*getName)(Thread*, object),
+                   GcByteArray* (*getSpec)(Thread*, object))
+{
+  unsigned mask = index->length() - 1;
+  for (unsigned i = memberHash(name, spec) & mask;; i = (i + 1) & mask) {
+    unsigned position = index->body()[i];
+    if (position == 0) {
+      return 0;
+    }
+
+    object o = table->body()[position - 1];
+    if (memberEqual(getName(t, o), name) and memberEqual(getSpec(t, o), spec)) {
+      return o;
+    }
+  }
+}
+
 object findInTable(Thread* t,
                    GcArray* table,
                    GcByteArray* name,
@@ -3696,17 +4736,19 @@ Machine::Machine(System* system,
       classpath(classpath),
       rootThread(0),
       exclusive(0),
-      finalizeThread(0),
+      finalizeThreadCount(1),
       jniReferences(0),
+      classPlaceholders(0),
+      savedClassCount(0),
       propertyCount(propertyCount),
       arguments(arguments),
       argumentCount(argumentCount),
       threadCount(0),
-      activeCount(0),
       liveCount(0),
       daemonCount(0),
       fixedFootprint(0),
       stackSizeInBytes(stackSizeInBytes),
+      threadStackSizeInBytes(0),
       localThread(0),
       stateLock(0),
       heapLock(0),
@@ -3714,6 +4756,7 @@ Machine::Machine(System* system,
       referenceLock(0),
       shutdownLock(0),
       libraries(0),
+      nativeSymbolLock(0),
       errorLog(0),
       bootimage(0),
       types(0),
@@ -3723,15 +4766,47 @@ Machine::Machine(System* system,
       finalizeQueue(0),
       weakReferences(0),
       tenuredWeakReferences(0),
+      softReferenceClock(0),
+      softReferenceMaxIdle(0),
+      softReferenceMillisecondsPerMegabyte(
+          DefaultSoftReferenceMillisecondsPerMegabyte),
       unsafe(false),
       collecting(false),
       triedBuiltinOnLoad(false),
       dumpedHeapOnOOM(false),
       alive(true),
-      heapPoolIndex(0)
-{
+      keepAttachedDaemons(false),
+      heapPoolIndex(0),
+      heapPoolFootprint(0),
+      heapPoolCapacityInWords(ThreadHeapPoolFootprintInWords),
+      spareThreadHeapCount(0),
+      gcLog(0),
+      stringDedupCandidates(0),
+      stringDedupCandidateCount(0),
+      stringDedupTable(0),
+      allocationSites(0),
+      allocationSampleCount(0),
+      profiler(0),
+      allocationProfileInterval(0),
+      maxThrowableTraceDepth(0),
+      contentionProfiling(false),
+      recordingEvents(true),
+      eventBuffers(0),
+      eventBufferCount(0),
+      startupTrace(0),
+      preloadLog(0),
+      preloader(0),
+      aborter(this)
+{
+  memset(allocationProfile, 0, sizeof(allocationProfile));
+  memset(contentionProfile, 0, sizeof(contentionProfile));
+  memset(nativeSymbols, 0, sizeof(nativeSymbols));
+  memset(wideLocks, 0, sizeof(wideLocks));
+
   heap->setClient(heapClient);
 
+  memset(finalizeThreads, 0, sizeof(finalizeThreads));
+
   populateJNITables(&javaVMVTable, &jniEnvVTable);
 
   // Copying the properties memory (to avoid memory crashes)
@@ -3760,6 +4835,11 @@ Machine::Machine(System* system,
       or not system->success(system->make(&classLock))
       or not system->success(system->make(&referenceLock))
       or not system->success(system->make(&shutdownLock))
+      or not system->success(system->make(&spareThreadHeapLock))
+      or not system->success(system->make(&allocationProfileLock))
+      or not system->success(system->make(&contentionProfileLock))
+      or not system->success(system->make(&eventLock))
+      or not system->success(system->make(&nativeSymbolLock))
       or not system->success(system->load(&libraries, bootstrapPropertyDup))) {
     system->abort();
   }
@@ -3778,16 +4858,125 @@ Machine::Machine(System* system,
 
   if (bootstrapPropertyDup)
     free((void*)bootstrapPropertyDup);
+
+#ifndef _MSC_VER
+  // walk() allocates its scratch space from the root thread when
+  // building with MSVC, so the heap may only call it from one thread
+  // at a time there
+  const char* gcThreads = findProperty(this, GC_THREADS_PROPERTY);
+  if (gcThreads) {
+    heap->setCollectorThreads(atoi(gcThreads));
+  }
+
+  const char* concurrentMark = findProperty(this, GC_CONCURRENT_MARK_PROPERTY);
+  if (concurrentMark and ::strcmp(concurrentMark, "true") == 0) {
+    heap->setConcurrentMarking(true);
+  }
+#endif
+
+  // the value is the longest pause, in milliseconds, which marking may
+  // add to an allocation
+  const char* incremental = findProperty(this, GC_INCREMENTAL_PROPERTY);
+  if (incremental) {
+    heap->setIncrementalMarking(atoi(incremental));
+  }
+
+  // the value is the longest pause, in milliseconds (e.g. "5ms"), which
+  // a minor collection should take; the allocation budget between minor
+  // collections grows or shrinks to suit
+  const char* pauseTarget = findProperty(this, GC_PAUSE_TARGET_PROPERTY);
+  if (pauseTarget and atoi(pauseTarget) > 0) {
+    heap->setPauseTarget(atoi(pauseTarget));
+  }
+
+  const char* gen2 = findProperty(this, GC_GEN2_PROPERTY);
+  if (gen2 and ::strcmp(gen2, "compact") == 0) {
+    heap->setGen2Compaction(true);
+  }
+
+  const char* stringDedup = findProperty(this, GC_STRING_DEDUP_PROPERTY);
+  if (stringDedup and ::strcmp(stringDedup, "true") == 0) {
+    stringDedupCandidates = static_cast<object*>(
+        heap->allocate(StringDedupCandidateCount * BytesPerWord));
+    stringDedupTable = static_cast<object*>(
+        heap->allocate(StringDedupTableSize * BytesPerWord));
+    memset(stringDedupTable, 0, StringDedupTableSize * BytesPerWord);
+  }
+
+  const char* softReferenceIdle
+      = findProperty(this, GC_SOFT_REFERENCE_IDLE_PROPERTY);
+  if (softReferenceIdle) {
+    softReferenceMillisecondsPerMegabyte = atoi(softReferenceIdle);
+  }
+  updateSoftReferenceMaxIdle(this);
+
+  const char* largePages = findProperty(this, LARGE_PAGES_PROPERTY);
+  if (largePages and ::strcmp(largePages, "true") == 0) {
+    heap->setLargePages(true);
+  }
+
+  const char* gcLogPath = findProperty(this, GC_LOG_PROPERTY);
+  if (gcLogPath) {
+    gcLog = vm::fopen(gcLogPath, "wb");
+  }
+
+  const char* keepDaemons = findProperty(this, KEEP_ATTACHED_DAEMONS_PROPERTY);
+  if (keepDaemons and ::strcmp(keepDaemons, "true") == 0) {
+    keepAttachedDaemons = true;
+  }
+
+  const char* allocationProfileInterval
+      = findProperty(this, ALLOCATION_PROFILE_INTERVAL_PROPERTY);
+  if (allocationProfileInterval and atoi(allocationProfileInterval) > 0) {
+    this->allocationProfileInterval = atoi(allocationProfileInterval);
+  }
+
+  const char* throwableTraceDepth
+      = findProperty(this, THROWABLE_TRACE_DEPTH_PROPERTY);
+  if (throwableTraceDepth and atoi(throwableTraceDepth) > 0) {
+    maxThrowableTraceDepth = atoi(throwableTraceDepth);
+  }
+
+  const char* contentionProfile
+      = findProperty(this, CONTENTION_PROFILE_PROPERTY);
+  if (contentionProfile and ::strcmp(contentionProfile, "true") == 0) {
+    contentionProfiling = true;
+  }
+
+  const char* events = findProperty(this, EVENTS_PROPERTY);
+  if (events and ::strcmp(events, "false") == 0) {
+    recordingEvents = false;
+  }
+
+  const char* finalizerThreads = findProperty(this, FINALIZER_THREADS_PROPERTY);
+  if (finalizerThreads) {
+    int count = atoi(finalizerThreads);
+    finalizeThreadCount = count < 1 ? 1 : min(static_cast<unsigned>(count),
+                                              MaximumFinalizeThreadCount);
+  }
 }
 
 void Machine::dispose()
 {
+  disposeProfiler(this);
+  disposeStartupTrace(this);
+  disposePreload(this);
+
+  if (gcLog) {
+    fclose(gcLog);
+  }
+
   localThread->dispose();
   stateLock->dispose();
   heapLock->dispose();
   classLock->dispose();
   referenceLock->dispose();
   shutdownLock->dispose();
+  spareThreadHeapLock->dispose();
+  allocationProfileLock->dispose();
+  contentionProfileLock->dispose();
+  eventLock->dispose();
+  nativeSymbolLock->dispose();
 
   if (libraries) {
     libraries->disposeAll();
@@ -3800,13 +4989,22 @@ void Machine::dispose()
   }
 
   for (unsigned i = 0; i < heapPoolIndex; ++i) {
-    heap->free(heapPool[i], ThreadHeapSizeInBytes);
+    heap->free(heapPool[i], heapPoolSizeInWords[i] * BytesPerWord);
+  }
+
+  for (unsigned i = 0; i < spareThreadHeapCount; ++i) {
+    heap->free(spareThreadHeaps[i], ThreadHeapSizeInBytes);
   }
 
   if (bootimage) {
     heap->free(bootimage, bootimageSize);
   }
 
+  if (stringDedupTable) {
+    heap->free(stringDedupCandidates, StringDedupCandidateCount * BytesPerWord);
+    heap->free(stringDedupTable, StringDedupTableSize * BytesPerWord);
+  }
+
   heap->free(arguments, sizeof(const char*) * argumentCount);
 
   for (unsigned int i = 0; i < propertyCount; i++) {
@@ -3814,6 +5012,38 @@ void Machine::dispose()
   }
   heap->free(properties, sizeof(const char*) * propertyCount);
 
+  while (allocationSites) {
+    AllocationSite* site = allocationSites;
+    allocationSites = site->next;
+    heap->free(site, sizeof(AllocationSite));
+  }
+
+  for (unsigned i = 0; i < AllocationProfileBucketCount; ++i) {
+    for (AllocationProfileEntry* e = allocationProfile[i]; e;) {
+      AllocationProfileEntry* next = e->next;
+      heap->free(e, sizeof(AllocationProfileEntry) + e->length);
+      e = next;
+    }
+  }
+
+  for (unsigned i = 0; i < ContentionProfileBucketCount; ++i) {
+    for (ContentionProfileEntry* e = contentionProfile[i]; e;) {
+      ContentionProfileEntry* next = e->next;
+      heap->free(e, sizeof(ContentionProfileEntry) + e->length);
+      e = next;
+    }
+  }
+
+  for (unsigned i = 0; i < NativeSymbolBucketCount; ++i) {
+    for (NativeSymbol* e = nativeSymbols[i]; e;) {
+      NativeSymbol* next = e->next;
+      heap->free(e, sizeof(NativeSymbol) + e->length);
+      e = next;
+    }
+  }
+
+  disposeEventBuffers(this);
+
   static_cast<HeapClient*>(heapClient)->dispose();
 
   heap->free(this, sizeof(*this));
@@ -3834,23 +5064,36 @@ Thread::Thread(Machine* m, GcThread* javaThread, Thread* parent)
       exception(0),
       heapIndex(0),
       heapOffset(0),
+      heapSizeInWords(ThreadHeapSizeInWords),
+      defaultHeapSizeInWords(ThreadHeapSizeInWords),
+      directCache(0),
       protector(0),
       classInitStack(0),
       libraryLoadStack(0),
       runnable(this),
-      defaultHeap(
-          static_cast<uintptr_t*>(m->heap->allocate(ThreadHeapSizeInBytes))),
+      defaultHeap(allocateThreadHeap(m)),
       heap(defaultHeap),
+      heapLimit(heap + heapSizeInWords),
       backupHeapIndex(0),
+      allocationProfileCountdown(m->allocationProfileInterval
+                                     ? m->allocationProfileInterval
+                                     : INT32_MAX),
+      pendingAllocationSample(),
+      contentionCount(0),
+      events(0),
+      monitorCacheObject(0),
+      monitorCacheMonitor(0),
       flags(ActiveFlag)
 {
 }
 
 void Thread::init()
 {
-  memset(defaultHeap, 0, ThreadHeapSizeInBytes);
   memset(backupHeap, 0, ThreadBackupHeapSizeInBytes);
 
+  acquireEventBuffer(this);
+  recordEvent(this, ThreadStartEvent);
+
   if (parent == 0) {
     assertT(this, m->rootThread == 0);
     assertT(this, javaThread == 0);
@@ -3878,8 +5121,15 @@ void Thread::init()
         uint8_t* imageBytes = imageFunction(&size);
         if (lzma) {
 #ifdef AVIAN_USE_LZMA
+          int64_t start = m->system->nanoTime();
+
           m->bootimage = image = reinterpret_cast<BootImage*>(decodeLZMA(
               m->system, m->heap, imageBytes, size, &(m->bootimageSize)));
+
+          if (m->startupTrace) {
+            recordStartupPhase(
+                m, LzmaStartupPhase, m->system->nanoTime() - start);
+          }
 #else
           abort(this);
 #endif
@@ -3935,6 +5185,10 @@ void Thread::init()
     // sequence point, for gc (don't recombine statements)
     roots(this)->setJNIFieldTable(this, v);
 
+    GcArray* cache = makeArray(this, JNIIDCacheSize);
+    // sequence point, for gc (don't recombine statements)
+    roots(this)->setJNIIDCache(this, cache);
+
     m->localThread->set(this);
   }
 
@@ -3944,6 +5198,8 @@ void Thread::init()
 void Thread::exit()
 {
   if (state != Thread::ExitState and state != Thread::ZombieState) {
+    recordEvent(this, ThreadStopEvent);
+
     enter(this, Thread::ExclusiveState);
 
     if (m->liveCount == 1) {
@@ -3968,7 +5224,14 @@ void Thread::dispose()
 
   --m->threadCount;
 
-  m->heap->free(defaultHeap, ThreadHeapSizeInBytes);
+  if (directCache) {
+    m->heap->flushDirect(directCache);
+    m->heap->free(directCache, sizeof(Heap::DirectCache));
+  }
+
+  releaseThreadHeap(m, defaultHeap, defaultHeapSizeInWords);
+
+  releaseEventBuffer(this);
 
   m->processor->dispose(this);
 }
@@ -4009,22 +5272,30 @@ void shutDown(Thread* t)
     }
   }
 
-  // tell finalize thread to exit and wait for it to do so
+  // tell finalize threads to exit and wait for them to do so
   {
     ACQUIRE(t, t->m->stateLock);
-    Thread* finalizeThread = t->m->finalizeThread;
-    if (finalizeThread) {
-      t->m->finalizeThread = 0;
-      t->m->stateLock->notifyAll(t->systemThread);
+    t->m->finalizeThreadCount = 0;
+    t->m->stateLock->notifyAll(t->systemThread);
 
-      while (finalizeThread->state != Thread::ZombieState
-             and finalizeThread->state != Thread::JoinedState) {
-        ENTER(t, Thread::IdleState);
-        t->m->stateLock->wait(t->systemThread, 0);
+    for (unsigned i = 0; i < MaximumFinalizeThreadCount; ++i) {
+      Thread* finalizeThread = t->m->finalizeThreads[i];
+      if (finalizeThread) {
+        t->m->finalizeThreads[i] = 0;
+
+        while (finalizeThread->state != Thread::ZombieState
+               and finalizeThread->state != Thread::JoinedState) {
+          ENTER(t, Thread::IdleState);
+          t->m->stateLock->wait(t->systemThread, 0);
+        }
       }
     }
   }
 
+  // let the profiler write out what it has collected before the
+  // daemon threads are told to die
+  stopProfiler(t);
+
   // interrupt daemon threads and tell them to die
 
   // todo: be more aggressive about killing daemon threads, e.g. at
@@ -4051,11 +5322,9 @@ void enter(Thread* t, Thread::State s)
   }
 
 #ifdef USE_ATOMIC_OPERATIONS
-#define INCREMENT atomicIncrement
 #define ACQUIRE_LOCK ACQUIRE_RAW(t, t->m->stateLock)
 #define STORE_LOAD_MEMORY_BARRIER storeLoadMemoryBarrier()
 #else
-#define INCREMENT(pointer, value) *(pointer) += value;
 #define ACQUIRE_LOCK
 #define STORE_LOAD_MEMORY_BARRIER
 
@@ -4066,6 +5335,9 @@ void enter(Thread* t, Thread::State s)
   case Thread::ExclusiveState: {
     ACQUIRE_LOCK;
 
+    recordEvent(t, SafepointBeginEvent);
+    int64_t start = t->m->system->nanoTime();
+
     while (t->m->exclusive) {
       // another thread got here first.
       ENTER(t, Thread::IdleState);
@@ -4074,12 +5346,9 @@ void enter(Thread* t, Thread::State s)
 
     switch (t->state) {
     case Thread::ActiveState:
+    case Thread::IdleState:
       break;
 
-    case Thread::IdleState: {
-      INCREMENT(&(t->m->activeCount), 1);
-    } break;
-
     default:
       abort(t);
     }
@@ -4089,17 +5358,17 @@ void enter(Thread* t, Thread::State s)
 
     STORE_LOAD_MEMORY_BARRIER;
 
-    while (t->m->activeCount > 1) {
+    while (hasActiveThread(t->m->rootThread)) {
       t->m->stateLock->wait(t->systemThread, 0);
     }
+
+    recordEvent(
+        t, SafepointEndEvent, 0, t->m->system->nanoTime() - start);
   } break;
 
   case Thread::IdleState:
     if (LIKELY(t->state == Thread::ActiveState)) {
       // fast path
-      assertT(t, t->m->activeCount > 0);
-      INCREMENT(&(t->m->activeCount), -1);
-
       t->state = s;
 
       STORE_LOAD_MEMORY_BARRIER;
@@ -4132,9 +5401,6 @@ void enter(Thread* t, Thread::State s)
       abort(t);
     }
 
-    assertT(t, t->m->activeCount > 0);
-    INCREMENT(&(t->m->activeCount), -1);
-
     if (s == Thread::ZombieState) {
       assertT(t, t->m->liveCount > 0);
       --t->m->liveCount;
@@ -4152,8 +5418,6 @@ void enter(Thread* t, Thread::State s)
   case Thread::ActiveState:
     if (LIKELY(t->state == Thread::IdleState and t->m->exclusive == 0)) {
       // fast path
-      INCREMENT(&(t->m->activeCount), 1);
-
       t->state = s;
 
       STORE_LOAD_MEMORY_BARRIER;
@@ -4186,7 +5450,6 @@ void enter(Thread* t, Thread::State s)
           t->m->stateLock->wait(t->systemThread, 0);
         }
 
-        INCREMENT(&(t->m->activeCount), 1);
         if (t->state == Thread::NoState) {
           ++t->m->liveCount;
           ++t->m->threadCount;
@@ -4218,9 +5481,6 @@ void enter(Thread* t, Thread::State s)
       abort(t);
     }
 
-    assertT(t, t->m->activeCount > 0);
-    INCREMENT(&(t->m->activeCount), -1);
-
     t->state = s;
 
     while (t->m->liveCount - t->m->daemonCount > 1) {
@@ -4245,6 +5505,308 @@ object allocate2(Thread* t, unsigned sizeInBytes, bool objectMask)
       objectMask);
 }
 
+AllocationSite* makeAllocationSite(Thread* t)
+{
+  ACQUIRE_RAW(t, t->m->heapLock);
+
+  t->m->allocationSites = new (t->m->heap->allocate(sizeof(AllocationSite)))
+      AllocationSite(t->m->allocationSites,
+                     t->m->allocationProfileInterval != 0);
+
+  return t->m->allocationSites;
+}
+
+object allocateAtSite(Thread* t,
+                      AllocationSite* site,
+                      GcClass* class_,
+                      unsigned sizeInBytes,
+                      bool objectMask)
+{
+  // the counter is only a hint, so lost updates don't matter
+  bool sample = (++site->allocations % AllocationSampleInterval) == 0;
+
+  unsigned sizeInWords = ceilingDivide(sizeInBytes, BytesPerWord);
+  if (site->pretenure and not sample and not t->m->exclusive
+      and sizeInWords <= ThreadHeapSizeInWords) {
+    object o
+        = static_cast<object>(t->m->heap->tryAllocateTenured(sizeInWords));
+    if (o) {
+      memset(o, 0, sizeInBytes);
+      setObjectClass(t, o, class_);
+      mark(t, o, 0);
+      return o;
+    }
+  }
+
+  PROTECT(t, class_);
+
+  object o = allocate(t, sizeInBytes, objectMask);
+  setObjectClass(t, o, class_);
+
+  if (sample) {
+    ACQUIRE_RAW(t, t->m->heapLock);
+
+    Machine* m = t->m;
+    if (m->allocationSampleCount < AllocationSampleCount) {
+      AllocationSample* s = m->allocationSamples + m->allocationSampleCount++;
+      s->target = o;
+      s->site = site;
+      s->collections = 0;
+    }
+  }
+
+  return o;
+}
+
+void sampleAllocation(Thread* t, object o, unsigned sizeInBytes)
+{
+  unsigned interval = t->m->allocationProfileInterval;
+  if (interval == 0) {
+    t->allocationProfileCountdown = INT32_MAX;
+    return;
+  }
+
+  t->allocationProfileCountdown = interval;
+
+  if (t->getFlags() & Thread::TracingFlag) {
+    // we may be tracing another thread from a signal handler, so
+    // don't walk anything
+    return;
+  }
+
+  resolveAllocationSample(t, t);
+
+  TopFrameVisitor v;
+  t->m->processor->walkStack(t, &v);
+
+  // an object bigger than the interval stands for all of its bytes
+  // rather than just the interval's worth:
+  PendingAllocationSample* s = &(t->pendingAllocationSample);
+  s->target = o;
+  s->method = v.method;
+  s->ip = v.ip;
+  s->weight = max(interval, sizeInBytes);
+}
+
+void setAllocationProfileInterval(Thread* t, unsigned interval)
+{
+  ENTER(t, Thread::ExclusiveState);
+
+  t->m->allocationProfileInterval = interval;
+  visitAll(t, t->m->rootThread, resetAllocationProfileCountdown);
+
+  // code compiled before now may allocate in line at these sites
+  ACQUIRE_RAW(t, t->m->heapLock);
+  for (AllocationSite* s = t->m->allocationSites; s; s = s->next) {
+    s->profiled = interval != 0;
+  }
+}
+
+void dumpAllocationProfile(Thread* t, FILE* out)
+{
+  ENTER(t, Thread::ExclusiveState);
+
+  Machine* m = t->m;
+  visitAll(t, m->rootThread, resolveAllocationSample);
+
+  unsigned count = 0;
+  for (unsigned i = 0; i < AllocationProfileBucketCount; ++i) {
+    for (AllocationProfileEntry* e = m->allocationProfile[i]; e; e = e->next) {
+      ++count;
+    }
+  }
+
+  if (count == 0) {
+    return;
+  }
+
+  AllocationProfileEntry** entries = static_cast<AllocationProfileEntry**>(
+      m->heap->allocate(count * sizeof(AllocationProfileEntry*)));
+
+  unsigned index = 0;
+  for (unsigned i = 0; i < AllocationProfileBucketCount; ++i) {
+    for (AllocationProfileEntry* e = m->allocationProfile[i]; e; e = e->next) {
+      entries[index++] = e;
+    }
+  }
+
+  qsort(entries,
+        count,
+        sizeof(AllocationProfileEntry*),
+        compareAllocationProfileEntries);
+
+  for (unsigned i = 0; i < count; ++i) {
+    AllocationProfileEntry* e = entries[i];
+    fprintf(out,
+            "%" LLD " %u %.*s\n",
+            static_cast<int64_t>(e->bytes),
+            e->count,
+            e->length,
+            e->key());
+  }
+
+  m->heap->free(entries, count * sizeof(AllocationProfileEntry*));
+}
+
+void beginContention(Thread* t,
+                     GcMonitor* monitor,
+                     object target,
+                     ContentionSample* sample)
+{
+  // monitors the VM uses internally have no object of their own
+  sample->lockClass
+      = objectClass(t, target ? target : reinterpret_cast<object>(monitor));
+  sample->start = t->m->system->coarseNanoTime();
+
+  if (++t->contentionCount < ContentionOwnerSampleInterval) {
+    return;
+  }
+
+  t->contentionCount = 0;
+
+  // holding the state lock keeps the owner from exiting while we
+  // look at it
+  ACQUIRE_RAW(t, t->m->stateLock);
+
+  Thread* owner = static_cast<Thread*>(monitor->owner());
+  if (owner and owner->state == Thread::ActiveState) {
+    TopFrameVisitor v;
+    t->m->processor->sampleStack(t, owner, &v);
+
+    sample->ownerMethod = v.method;
+    sample->ownerIp = v.ip;
+  }
+}
+
+void endContention(Thread* t, ContentionSample* sample)
+{
+  // the coarse clock only ticks every few milliseconds, but since a
+  // tick is as likely to fall within any wait as any other, the
+  // totals still come out right on average
+  int64_t milliseconds
+      = (t->m->system->coarseNanoTime() - sample->start) / (1000 * 1000);
+
+  TopFrameVisitor v;
+  t->m->processor->walkStack(t, &v);
+
+  GcByteArray* className = sample->lockClass->name();
+
+  char key[1024];
+  unsigned length = appendToKey(
+      key,
+      sizeof(key),
+      0,
+      "%s ",
+      className ? reinterpret_cast<const char*>(className->body().begin())
+                : "?");
+  length = appendSite(t, key, sizeof(key), length, v.method, v.ip);
+  length = appendToKey(key, sizeof(key), length, " ");
+  if (sample->ownerMethod) {
+    length = appendSite(t,
+                        key,
+                        sizeof(key),
+                        length,
+                        sample->ownerMethod,
+                        sample->ownerIp);
+  } else {
+    length = appendToKey(key, sizeof(key), length, "-");
+  }
+
+  uint32_t hash = finishKey(key, length);
+
+  Machine* m = t->m;
+  ACQUIRE_RAW(t, m->contentionProfileLock);
+
+  ContentionProfileEntry** bucket
+      = m->contentionProfile + (hash & (ContentionProfileBucketCount - 1));
+
+  ContentionProfileEntry* e = *bucket;
+  while (e and (e->hash != hash or e->length != length
+                or memcmp(e->key(), key, length) != 0)) {
+    e = e->next;
+  }
+
+  if (e == 0) {
+    e = new (m->heap->allocate(sizeof(ContentionProfileEntry) + length))
+        ContentionProfileEntry(*bucket, hash, length);
+    memcpy(e->key(), key, length);
+    *bucket = e;
+  }
+
+  ++e->count;
+  e->milliseconds += milliseconds > 0 ? milliseconds : 0;
+}
+
+void setContentionProfiling(Thread* t, bool enabled)
+{
+  t->m->contentionProfiling = enabled;
+}
+
+GcString* makeContentionProfile(Thread* t)
+{
+  Machine* m = t->m;
+
+  // format the profile outside the heap first, since we can't
+  // allocate from it while holding the profile lock
+  char* text = 0;
+  unsigned capacity = 0;
+  unsigned length = 0;
+  {
+    ACQUIRE_RAW(t, m->contentionProfileLock);
+
+    unsigned count = 0;
+    for (unsigned i = 0; i < ContentionProfileBucketCount; ++i) {
+      for (ContentionProfileEntry* e = m->contentionProfile[i]; e;
+           e = e->next) {
+        ++count;
+        capacity += e->length + 48;
+      }
+    }
+
+    if (count) {
+      ContentionProfileEntry** entries
+          = static_cast<ContentionProfileEntry**>(
+              m->heap->allocate(count * sizeof(ContentionProfileEntry*)));
+
+      unsigned index = 0;
+      for (unsigned i = 0; i < ContentionProfileBucketCount; ++i) {
+        for (ContentionProfileEntry* e = m->contentionProfile[i]; e;
+             e = e->next) {
+          entries[index++] = e;
+        }
+      }
+
+      qsort(entries,
+            count,
+            sizeof(ContentionProfileEntry*),
+            compareContentionProfileEntries);
+
+      text = static_cast<char*>(m->heap->allocate(capacity));
+      for (unsigned i = 0; i < count; ++i) {
+        ContentionProfileEntry* e = entries[i];
+        length = appendToKey(text,
+                             capacity,
+                             length,
+                             "%u %" LLD " %.*s\n",
+                             e->count,
+                             static_cast<int64_t>(e->milliseconds),
+                             e->length,
+                             e->key());
+      }
+
+      m->heap->free(entries, count * sizeof(ContentionProfileEntry*));
+    }
+  }
+
+  GcByteArray* array = makeByteArray(t, length);
+  if (length) {
+    memcpy(array->body().begin(), text, length);
+    m->heap->free(text, capacity);
+  }
+
+  return m->classpath->makeString(t, array, 0, length);
+}
+
 object allocate3(Thread* t,
                  Alloc* allocator,
                  Machine::AllocationType type,
@@ -4265,7 +5827,7 @@ object allocate3(Thread* t,
   } else if (UNLIKELY(t->getFlags() & Thread::TracingFlag)) {
     expect(t,
            t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
-           <= ThreadHeapSizeInWords);
+           <= t->heapSizeInWords);
     return allocateSmall(t, sizeInBytes);
   }
 
@@ -4285,27 +5847,46 @@ object allocate3(Thread* t,
     switch (type) {
     case Machine::MovableAllocation:
       if (t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
-          > ThreadHeapSizeInWords) {
+          > t->heapSizeInWords) {
+        t->m->heap->allocated(t->heapIndex * BytesPerWord);
+
         t->heap = 0;
+        t->heapLimit = 0;
+
+        unsigned size = max(t->defaultHeapSizeInWords,
+                            ceilingDivide(sizeInBytes, BytesPerWord));
+
         if ((not t->m->heap->limitExceeded())
-            and t->m->heapPoolIndex < ThreadHeapPoolSize) {
+            and t->m->heapPoolIndex < ThreadHeapPoolSize
+            and t->m->heapPoolFootprint + size
+                <= t->m->heapPoolCapacityInWords) {
           t->heap = static_cast<uintptr_t*>(
-              t->m->heap->tryAllocate(ThreadHeapSizeInBytes));
+              t->m->heap->tryAllocate(size * BytesPerWord));
 
           if (t->heap) {
-            memset(t->heap, 0, ThreadHeapSizeInBytes);
-
-            t->m->heapPool[t->m->heapPoolIndex++] = t->heap;
+            // the pool is freed after every collection, so whatever
+            // thread had this memory last may have run on another node
+            avian::system::Memory::placeLocally(Slice<uint8_t>(
+                reinterpret_cast<uint8_t*>(t->heap), size * BytesPerWord));
+
+            t->m->heapPool[t->m->heapPoolIndex] = t->heap;
+            t->m->heapPoolSizeInWords[t->m->heapPoolIndex++] = size;
+            t->m->heapPoolFootprint += size;
             t->heapOffset += t->heapIndex;
             t->heapIndex = 0;
+            t->heapSizeInWords = size;
+            t->heapLimit = t->heap + size;
           }
         }
       }
       break;
 
     case Machine::FixedAllocation:
+      t->m->heap->allocated(sizeInBytes);
+
       if (t->m->fixedFootprint + sizeInBytes > FixedFootprintThresholdInBytes) {
         t->heap = 0;
+        t->heapLimit = 0;
       }
       break;
 
@@ -4327,7 +5908,7 @@ object allocate3(Thread* t,
     }
   } while (type == Machine::MovableAllocation
            and t->heapIndex + ceilingDivide(sizeInBytes, BytesPerWord)
-               > ThreadHeapSizeInWords);
+               > t->heapSizeInWords);
 
   switch (type) {
   case Machine::MovableAllocation: {
@@ -4345,6 +5926,8 @@ object allocate3(Thread* t,
     t->m->fixedFootprint += t->m->heap->fixedFootprint(
         ceilingDivide(sizeInBytes, BytesPerWord), objectMask);
 
+    countAllocation(t, o, sizeInBytes);
+
     return o;
   }
 
@@ -4356,6 +5939,8 @@ object allocate3(Thread* t,
 
     alias(o, 0) = FixedMark;
 
+    countAllocation(t, o, sizeInBytes);
+
     return o;
   }
 
@@ -4368,8 +5953,7 @@ void collect(Thread* t, Heap::CollectionType type, int pendingAllocation)
 {
   ENTER(t, Thread::ExclusiveState);
 
-  unsigned pending = pendingAllocation
-                     - (t->m->heapPoolIndex * ThreadHeapSizeInWords);
+  unsigned pending = pendingAllocation - t->m->heapPoolFootprint;
 
   if (t->m->heap->limitExceeded(pending)) {
     type = Heap::MajorCollection;
@@ -4597,6 +6181,12 @@ bool isAssignableFrom(Thread* t, GcClass* a, GcClass* b)
     return true;
 
   if (a->flags() & ACC_INTERFACE) {
+    // call sites tend to test the same few classes against the same
+    // interface over and over, so remember the last match
+    if (b->interfaceCache() == a) {
+      return true;
+    }
+
     if (b->vmFlags() & BootstrapFlag) {
       uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(b->name())};
 
@@ -4606,14 +6196,19 @@ bool isAssignableFrom(Thread* t, GcClass* a, GcClass* b)
       }
     }
 
-    GcArray* itable = cast<GcArray>(t, b->interfaceTable());
-    if (itable) {
-      unsigned stride = (b->flags() & ACC_INTERFACE) ? 1 : 2;
-      for (unsigned i = 0; i < itable->length(); i += stride) {
-        if (itable->body()[i] == a) {
-          return true;
+    if (b->flags() & ACC_INTERFACE) {
+      GcArray* itable = cast<GcArray>(t, b->interfaceTable());
+      if (itable) {
+        for (unsigned i = 0; i < itable->length(); ++i) {
+          if (itable->body()[i] == a) {
+            b->setInterfaceCache(t, a);
+            return true;
+          }
         }
       }
+    } else if (interfaceTableIndex(t, b, a) >= 0) {
+      b->setInterfaceCache(t, a);
+      return true;
     }
   } else if (a->arrayDimensions()) {
     if (b->arrayDimensions()) {
@@ -4621,6 +6216,15 @@ bool isAssignableFrom(Thread* t, GcClass* a, GcClass* b)
           t, a->arrayElementClass(), b->arrayElementClass());
     }
   } else if ((a->vmFlags() & PrimitiveFlag) == (b->vmFlags() & PrimitiveFlag)) {
+    GcArray* superDisplay = cast<GcArray>(t, a->display());
+    GcArray* display = cast<GcArray>(t, b->display());
+    if (superDisplay and display) {
+      // a is a superclass of b exactly when it sits at its own depth
+      // in b's display
+      unsigned depth = superDisplay->length() - 1;
+      return depth < display->length() and display->body()[depth] == a;
+    }
+
     for (; b; b = b->super()) {
       if (b == a) {
         return true;
@@ -4743,6 +6347,8 @@ GcClass* parseClass(Thread* t,
 {
   PROTECT(t, loader);
 
+  int64_t start = t->m->system->nanoTime();
+
   class Client : public Stream::Client {
    public:
     Client(Thread* t) : t(t)
@@ -4798,6 +6404,11 @@ GcClass* parseClass(Thread* t,
       0,  // static table
       loader,
       0,   // source
+      0,   // display
+      0,   // interface cache
+      0,   // interface index
+      0,   // runtime data
+      0,   // VM type
       0);  // vtable length
   PROTECT(t, class_);
 
@@ -4812,8 +6423,10 @@ GcClass* parseClass(Thread* t,
 
     class_->setSuper(t, sc);
 
-    class_->vmFlags() |= (sc->vmFlags() & (ReferenceFlag | WeakReferenceFlag
-                                           | HasFinalizerFlag | NeedInitFlag));
+    class_->vmFlags()
+        |= (sc->vmFlags() & (ReferenceFlag | WeakReferenceFlag
+                             | SoftReferenceFlag | HasFinalizerFlag
+                             | NeedInitFlag));
   }
 
   if (DebugClassReader) {
@@ -4828,6 +6441,8 @@ GcClass* parseClass(Thread* t,
 
   parseAttributeTable(t, s, class_, pool, invocations);
 
+  indexMembers(t, class_, pool);
+
   GcArray* vtable = cast<GcArray>(t, class_->virtualTable());
   unsigned vtableLength = (vtable ? vtable->length() : 0);
 
@@ -4853,6 +6468,10 @@ GcClass* parseClass(Thread* t,
 
   PROTECT(t, real);
 
+  initDisplay(t, real);
+
+  initInterfaceIndex(t, real);
+
   t->m->processor->initVtable(t, real);
 
   updateClassTables(t, real, class_);
@@ -4871,6 +6490,18 @@ GcClass* parseClass(Thread* t,
                   objectHash);
   }
 
+  int64_t time = t->m->system->nanoTime() - start;
+
+  recordEvent(t, ClassLoadEvent, size, time, real->name());
+
+  if (t->m->startupTrace) {
+    recordClassParse(t, time);
+  }
+
+  if (t->m->preloadLog) {
+    recordPreloadClass(t, real, false);
+  }
+
   return real;
 }
 
@@ -4885,6 +6516,79 @@ uint64_t runParseClass(Thread* t, uintptr_t* arguments)
       parseClass(t, loader, region->start(), region->length(), throwType));
 }
 
+// Marks a class which a thread is in the process of loading, so that
+// other threads asking the same loader for the same class wait for it
+// rather than parsing the class file a second time.  Placeholders are
+// linked into Machine::classPlaceholders, which is guarded by classLock,
+// but the class file itself is parsed without holding that lock.
+class ClassPlaceholder : public Thread::AutoResource {
+ public:
+  ClassPlaceholder(Thread* t, GcClassLoader* loader, GcByteArray* spec)
+      : AutoResource(t),
+        next(0),
+        loader(loader),
+        spec(spec),
+        linked(false),
+        loaderProtector(t, &(this->loader)),
+        specProtector(t, &(this->spec))
+  {
+  }
+
+  ~ClassPlaceholder()
+  {
+    if (linked) {
+      ACQUIRE(t, t->m->classLock);
+      unlink();
+    }
+  }
+
+  virtual void release()
+  {
+    this->ClassPlaceholder::~ClassPlaceholder();
+  }
+
+  // the caller must hold classLock for this and the following methods
+  static ClassPlaceholder* find(Thread* t,
+                                GcClassLoader* loader,
+                                GcByteArray* spec)
+  {
+    for (ClassPlaceholder* p = t->m->classPlaceholders; p; p = p->next) {
+      if (p->loader == loader and byteArrayEqual(t, p->spec, spec)) {
+        return p;
+      }
+    }
+    return 0;
+  }
+
+  void link()
+  {
+    next = t->m->classPlaceholders;
+    t->m->classPlaceholders = this;
+    linked = true;
+  }
+
+  void unlink()
+  {
+    for (ClassPlaceholder** p = &(t->m->classPlaceholders); *p;
+         p = &((*p)->next)) {
+      if (*p == this) {
+        *p = next;
+        break;
+      }
+    }
+    linked = false;
+
+    t->m->classLock->notifyAll(t->systemThread);
+  }
+
+  ClassPlaceholder* next;
+  GcClassLoader* loader;
+  GcByteArray* spec;
+  bool linked;
+  Thread::SingleProtector loaderProtector;
+  Thread::SingleProtector specProtector;
+};
+
 GcClass* resolveSystemClass(Thread* t,
                             GcClassLoader* loader,
                             GcByteArray* spec,
@@ -4894,105 +6598,153 @@ GcClass* resolveSystemClass(Thread* t,
   PROTECT(t, loader);
   PROTECT(t, spec);
 
-  ACQUIRE(t, t->m->classLock);
-
   GcClass* class_ = findLoadedClass(t, loader, spec);
-  if (class_ == 0) {
-    PROTECT(t, class_);
+  if (class_) {
+    return class_;
+  }
 
-    if (loader->parent()) {
-      class_ = resolveSystemClass(t, loader->parent(), spec, false);
-      if (class_) {
-        return class_;
-      }
+  PROTECT(t, class_);
+
+  if (loader->parent()) {
+    class_ = resolveSystemClass(t, loader->parent(), spec, false);
+    if (class_) {
+      return class_;
     }
+  }
 
-    if (spec->body()[0] == '[') {
-      class_ = resolveArrayClass(t, loader, spec, throw_, throwType);
-    } else {
-      GcSystemClassLoader* sysLoader = loader->as<GcSystemClassLoader>(t);
-      PROTECT(t, sysLoader);
+  if (spec->body()[0] == '[') {
+    class_ = resolveArrayClass(t, loader, spec, throw_, throwType);
 
-      THREAD_RUNTIME_ARRAY(t, char, file, spec->length() + 6);
-      memcpy(
-          RUNTIME_ARRAY_BODY(file), spec->body().begin(), spec->length() - 1);
-      memcpy(RUNTIME_ARRAY_BODY(file) + spec->length() - 1, ".class", 7);
+    if (class_) {
+      ACQUIRE(t, t->m->classLock);
 
-      System::Region* region = static_cast<Finder*>(sysLoader->finder())
-                                   ->find(RUNTIME_ARRAY_BODY(file));
+      if (findLoadedClass(t, loader, spec) == 0) {
+        hashMapInsert(
+            t, cast<GcHashMap>(t, loader->map()), spec, class_, byteArrayHash);
 
-      if (region) {
-        if (Verbose) {
-          fprintf(stderr, "parsing %s\n", spec->body().begin());
-        }
+        updatePackageMap(t, class_);
+      }
+    }
+  } else {
+    ClassPlaceholder placeholder(t, loader, spec);
 
-        {
-          THREAD_RESOURCE(t, System::Region*, region, region->dispose());
-
-          uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(loader),
-                                   reinterpret_cast<uintptr_t>(region),
-                                   static_cast<uintptr_t>(throwType)};
-
-          // parse class file
-          class_ = cast<GcClass>(
-              t, reinterpret_cast<object>(runRaw(t, runParseClass, arguments)));
-
-          if (UNLIKELY(t->exception)) {
-            if (throw_) {
-              GcThrowable* e = t->exception;
-              t->exception = 0;
-              vm::throw_(t, e);
-            } else {
-              t->exception = 0;
-              return 0;
-            }
-          }
+    {
+      ACQUIRE(t, t->m->classLock);
+
+      while (true) {
+        class_ = findLoadedClass(t, loader, spec);
+        if (class_) {
+          return class_;
         }
 
-        if (Verbose) {
-          fprintf(
-              stderr, "done parsing %s: %p\n", spec->body().begin(), class_);
+        // If this thread is already loading the class further up the
+        // stack, carry on and load it again as we would have done
+        // without placeholders, rather than waiting for ourselves.
+        ClassPlaceholder* p = ClassPlaceholder::find(t, loader, spec);
+        if (p == 0 or p->t == t) {
+          break;
         }
 
-        {
-          const char* source = static_cast<Finder*>(sysLoader->finder())
-                                   ->sourceUrl(RUNTIME_ARRAY_BODY(file));
+        ENTER(t, Thread::IdleState);
+        t->m->classLock->wait(t->systemThread, 0);
+      }
+
+      placeholder.link();
+    }
 
-          if (source) {
-            unsigned length = strlen(source);
-            GcByteArray* array = makeByteArray(t, length + 1);
-            memcpy(array->body().begin(), source, length);
-            array = internByteArray(t, array);
+    GcSystemClassLoader* sysLoader = loader->as<GcSystemClassLoader>(t);
+    PROTECT(t, sysLoader);
 
-            class_->setSource(t, array);
+    THREAD_RUNTIME_ARRAY(t, char, file, spec->length() + 6);
+    memcpy(
+        RUNTIME_ARRAY_BODY(file), spec->body().begin(), spec->length() - 1);
+    memcpy(RUNTIME_ARRAY_BODY(file) + spec->length() - 1, ".class", 7);
+
+    System::Region* region = static_cast<Finder*>(sysLoader->finder())
+                                 ->find(RUNTIME_ARRAY_BODY(file));
+
+    if (region) {
+      if (Verbose) {
+        fprintf(stderr, "parsing %s\n", spec->body().begin());
+      }
+
+      {
+        THREAD_RESOURCE(t, System::Region*, region, region->dispose());
+
+        uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(loader),
+                                 reinterpret_cast<uintptr_t>(region),
+                                 static_cast<uintptr_t>(throwType)};
+
+        // parse class file
+        class_ = cast<GcClass>(
+            t, reinterpret_cast<object>(runRaw(t, runParseClass, arguments)));
+
+        if (UNLIKELY(t->exception)) {
+          if (throw_) {
+            GcThrowable* e = t->exception;
+            t->exception = 0;
+            vm::throw_(t, e);
+          } else {
+            t->exception = 0;
+            return 0;
           }
         }
+      }
 
-        GcClass* bootstrapClass
-            = cast<GcClass>(t,
-                            hashMapFind(t,
-                                        roots(t)->bootstrapClassMap(),
-                                        spec,
-                                        byteArrayHash,
-                                        byteArrayEqual));
+      if (Verbose) {
+        fprintf(
+            stderr, "done parsing %s: %p\n", spec->body().begin(), class_);
+      }
+
+      {
+        const char* source = static_cast<Finder*>(sysLoader->finder())
+                                 ->sourceUrl(RUNTIME_ARRAY_BODY(file));
 
-        if (bootstrapClass) {
-          PROTECT(t, bootstrapClass);
+        if (source) {
+          unsigned length = strlen(source);
+          GcByteArray* array = makeByteArray(t, length + 1);
+          memcpy(array->body().begin(), source, length);
+          array = internByteArray(t, array);
 
-          updateBootstrapClass(t, bootstrapClass, class_);
-          class_ = bootstrapClass;
+          class_->setSource(t, array);
         }
       }
     }
 
-    if (class_) {
+    // publish the class, unless a nested load of the same class by
+    // this thread got there first
+    ACQUIRE(t, t->m->classLock);
+
+    GcClass* loaded = findLoadedClass(t, loader, spec);
+    if (loaded) {
+      class_ = loaded;
+    } else if (class_) {
+      GcClass* bootstrapClass
+          = cast<GcClass>(t,
+                          hashMapFind(t,
+                                      roots(t)->bootstrapClassMap(),
+                                      spec,
+                                      byteArrayHash,
+                                      byteArrayEqual));
+
+      if (bootstrapClass) {
+        PROTECT(t, bootstrapClass);
+
+        updateBootstrapClass(t, bootstrapClass, class_);
+        class_ = bootstrapClass;
+      }
+
       hashMapInsert(
           t, cast<GcHashMap>(t, loader->map()), spec, class_, byteArrayHash);
 
       updatePackageMap(t, class_);
-    } else if (throw_) {
-      throwNew(t, throwType, "%s", spec->body().begin());
     }
+
+    placeholder.unlink();
+  }
+
+  if (class_ == 0 and throw_) {
+    throwNew(t, throwType, "%s", spec->body().begin());
   }
 
   return class_;
@@ -5262,9 +7014,21 @@ void initClass(Thread* t, GcClass* c)
     GcMethod* initializer = classInitializer(t, c);
 
     if (initializer) {
+      bool outermost = t->classInitStack == 0;
+      int64_t start = t->m->startupTrace ? t->m->system->nanoTime() : 0;
+
       Thread::ClassInitStack stack(t, c);
 
       t->m->processor->invoke(t, initializer, 0);
+
+      if (t->m->startupTrace) {
+        recordClassInit(
+            t, c, t->m->system->nanoTime() - start, outermost);
+      }
+
+      if (t->m->preloadLog) {
+        recordPreloadClass(t, c, true);
+      }
     }
   }
 }
@@ -5304,6 +7068,9 @@ GcClass* resolveObjectArrayClass(Thread* t,
     spec->body()[elementSpec->length() + 2] = 0;
   }
 
+  // share the name with any constant pool naming the same array class
+  spec = internByteArray(t, spec);
+
   GcClass* arrayClass = resolveClass(t, loader, spec);
 
   getClassRuntimeData(t, elementClass)->setArrayClass(t, arrayClass);
@@ -5319,29 +7086,9 @@ object makeObjectArray(Thread* t, GcClass* elementClass, unsigned count)
   PROTECT(t, arrayClass);
 
   object array = makeArray(t, count);
-  setObjectClass(t, array, arrayClass);
-
-  return array;
-}
-
-static GcByteArray* getFieldName(Thread* t, object obj)
-{
-  return reinterpret_cast<GcByteArray*>(cast<GcField>(t, obj)->name());
-}
-
-static GcByteArray* getFieldSpec(Thread* t, object obj)
-{
-  return reinterpret_cast<GcByteArray*>(cast<GcField>(t, obj)->spec());
-}
-
-static GcByteArray* getMethodName(Thread* t, object obj)
-{
-  return reinterpret_cast<GcByteArray*>(cast<GcMethod>(t, obj)->name());
-}
+  setObjectClass(t, array, arrayClass);
 
-static GcByteArray* getMethodSpec(Thread* t, object obj)
-{
-  return reinterpret_cast<GcByteArray*>(cast<GcMethod>(t, obj)->spec());
+  return array;
 }
 
 object findFieldInClass(Thread* t,
@@ -5349,12 +7096,17 @@ object findFieldInClass(Thread* t,
                         GcByteArray* name,
                         GcByteArray* spec)
 {
-  return findInTable(t,
-                     cast<GcArray>(t, class_->fieldTable()),
-                     name,
-                     spec,
-                     getFieldName,
-                     getFieldSpec);
+  GcArray* table = cast<GcArray>(t, class_->fieldTable());
+  GcClassAddendum* addendum = class_->addendum();
+  if (addendum and addendum->fieldIndex()) {
+    GcMemberIndex* index = cast<GcMemberIndex>(t, addendum->fieldIndex());
+    if (index->table() == table) {
+      return findInIndex(
+          t, index, table, name, spec, getFieldName, getFieldSpec);
+    }
+  }
+
+  return findInTable(t, table, name, spec, getFieldName, getFieldSpec);
 }
 
 object findMethodInClass(Thread* t,
@@ -5362,12 +7114,17 @@ object findMethodInClass(Thread* t,
                          GcByteArray* name,
                          GcByteArray* spec)
 {
-  return findInTable(t,
-                     cast<GcArray>(t, class_->methodTable()),
-                     name,
-                     spec,
-                     getMethodName,
-                     getMethodSpec);
+  GcArray* table = cast<GcArray>(t, class_->methodTable());
+  GcClassAddendum* addendum = class_->addendum();
+  if (addendum and addendum->methodIndex()) {
+    GcMemberIndex* index = cast<GcMemberIndex>(t, addendum->methodIndex());
+    if (index->table() == table) {
+      return findInIndex(
+          t, index, table, name, spec, getMethodName, getMethodSpec);
+    }
+  }
+
+  return findInTable(t, table, name, spec, getMethodName, getMethodSpec);
 }
 
 object findInHierarchyOrNull(
@@ -5439,10 +7196,10 @@ void addFinalizer(Thread* t, object target, void (*finalize)(Thread*, object))
   t->m->finalizers = f;
 }
 
-GcMonitor* objectMonitor(Thread* t, object o, bool createNew)
-{
-  assertT(t, t->state == Thread::ActiveState);
+namespace {
 
+GcMonitor* findMonitor(Thread* t, object o, bool createNew)
+{
   object m = hashMapFind(t, roots(t)->monitorMap(), o, objectHash, objectEqual);
 
   if (m) {
@@ -5455,53 +7212,149 @@ GcMonitor* objectMonitor(Thread* t, object o, bool createNew)
     PROTECT(t, o);
     PROTECT(t, m);
 
-    {
-      ENTER(t, Thread::ExclusiveState);
+    object head = makeMonitorNode(t, 0, 0);
+    m = makeMonitor(t, 0, 0, 0, head, head, 0, InitialMonitorSpinLimit);
+
+    GcWeakReference* r = makeWeakReference(t, 0, 0, 0, 0);
+    PROTECT(t, r);
+
+    GcTriple* n = makeTriple(t, r, m, 0);
+    PROTECT(t, n);
 
-      m = hashMapFind(t, roots(t)->monitorMap(), o, objectHash, objectEqual);
+    // Other threads search the monitor map without synchronizing, so
+    // rather than stop them all to add to it, we only ever prepend a
+    // fully initialized node to a bucket or replace the whole table
+    // with a grown copy, either of which they will see or not.
+    // Insertions are serialized by referenceLock, which also guards the
+    // list of weak references the new key joins.
+    ACQUIRE(t, t->m->referenceLock);
+
+    while (true) {
+      GcHashMap* map = roots(t)->monitorMap();
 
-      if (m) {
+      object existing = hashMapFind(t, map, o, objectHash, objectEqual);
+      if (existing) {
         if (DebugMonitors) {
-          fprintf(
-              stderr, "found monitor %p for object %x\n", m, objectHash(t, o));
+          fprintf(stderr,
+                  "found monitor %p for object %x\n",
+                  existing,
+                  objectHash(t, o));
         }
 
-        return cast<GcMonitor>(t, m);
+        return cast<GcMonitor>(t, existing);
       }
 
-      object head = makeMonitorNode(t, 0, 0);
-      m = makeMonitor(t, 0, 0, 0, head, head, 0);
+      GcArray* array = map->array();
+      if (array and map->size() + 1 < array->length() * 2) {
+        if (DebugMonitors) {
+          fprintf(
+              stderr, "made monitor %p for object %x\n", m, objectHash(t, o));
+        }
 
-      if (DebugMonitors) {
-        fprintf(stderr, "made monitor %p for object %x\n", m, objectHash(t, o));
-      }
+        // the collector only updates the target of a registered weak
+        // reference, so we mustn't allocate between these two steps
+        r->setTarget(t, o);
+        r->setVmNext(t, t->m->weakReferences);
+        t->m->weakReferences = r->as<GcJreference>(t);
 
-      hashMapInsert(t, roots(t)->monitorMap(), o, m, objectHash);
+        unsigned index = objectHash(t, o) & (array->length() - 1);
+        n->setThird(t, array->body()[index]);
+        ++map->size();
 
-      addFinalizer(t, o, removeMonitor);
-    }
+        storeStoreMemoryBarrier();
 
-    return cast<GcMonitor>(t, m);
+        array->setBodyElement(t, index, n);
+
+        addFinalizer(t, o, removeMonitor);
+
+        recordEvent(t, MonitorInflateEvent, 0, 0, objectClass(t, o)->name());
+
+        return cast<GcMonitor>(t, m);
+      }
+
+      growSharedMap(t, roots(t)->monitorMap(), objectHash);
+    }
   } else {
     return 0;
   }
 }
 
-object intern(Thread* t, object s)
+}  // namespace
+
+GcMonitor* objectMonitor(Thread* t, object o, bool createNew)
 {
-  PROTECT(t, s);
+  assertT(t, t->state == Thread::ActiveState);
 
-  ACQUIRE(t, t->m->referenceLock);
+  // A thread nearly always releases, waits on or re-enters the monitor
+  // it last looked up, so remember that one rather than search the map
+  // for it again.  Nothing moves between collections, and each clears
+  // the cache.
+  if (t->monitorCacheObject == o and o) {
+    return t->monitorCacheMonitor;
+  }
+
+  PROTECT(t, o);
+
+  GcMonitor* m = findMonitor(t, o, createNew);
+  if (m) {
+    t->monitorCacheObject = o;
+    t->monitorCacheMonitor = m;
+  }
+  return m;
+}
 
+object intern(Thread* t, object s)
+{
+  // Like the monitor map, the string map is searched without
+  // synchronizing, so interning a string which is already there takes
+  // no lock.  See findMonitor for how insertions keep that safe.
   GcTriple* n
       = hashMapFindNode(t, roots(t)->stringMap(), s, stringHash, stringEqual);
-
   if (n) {
     return cast<GcJreference>(t, n->first())->target();
-  } else {
-    hashMapInsert(t, roots(t)->stringMap(), s, 0, stringHash);
-    addFinalizer(t, s, removeString);
-    return s;
+  }
+
+  PROTECT(t, s);
+
+  GcWeakReference* r = makeWeakReference(t, 0, 0, 0, 0);
+  PROTECT(t, r);
+
+  n = makeTriple(t, r, 0, 0);
+  PROTECT(t, n);
+
+  ACQUIRE(t, t->m->referenceLock);
+
+  while (true) {
+    GcHashMap* map = roots(t)->stringMap();
+
+    GcTriple* existing = hashMapFindNode(t, map, s, stringHash, stringEqual);
+    if (existing) {
+      return cast<GcJreference>(t, existing->first())->target();
+    }
+
+    GcArray* array = map->array();
+    if (array and map->size() + 1 < array->length() * 2) {
+      unsigned index = stringHash(t, s) & (array->length() - 1);
+
+      sweepStringBucket(t, map, index);
+
+      // the collector only updates the target of a registered weak
+      // reference, so we mustn't allocate between these two steps
+      r->setTarget(t, s);
+      r->setVmNext(t, t->m->weakReferences);
+      t->m->weakReferences = r->as<GcJreference>(t);
+
+      n->setThird(t, array->body()[index]);
+      ++map->size();
+
+      storeStoreMemoryBarrier();
+
+      array->setBodyElement(t, index, n);
+
+      return s;
+    }
+
+    growSharedMap(t, map, stringHash);
   }
 }
 
@@ -5546,7 +7399,9 @@ void walk(Thread* t, Heap::Walker* w, object o, unsigned start)
 
   bool more = true;
 
-  if (objectMask) {
+  if (class_->vmType()) {
+    more = ::walk(t, w, o, class_->vmType() - 1, start);
+  } else if (objectMask) {
     unsigned fixedSize = class_->fixedSize();
     unsigned arrayElementSize = class_->arrayElementSize();
     unsigned arrayLength = (arrayElementSize ? fieldAtOffset<uintptr_t>(
@@ -5672,13 +7527,11 @@ void printTrace(Thread* t, GcThrowable* exception)
 
     object trace = e->trace();
     if (trace) {
-      for (unsigned i = 0; i < objectArrayLength(t, trace); ++i) {
-        GcTraceElement* e
-            = cast<GcTraceElement>(t, objectArrayBody(t, trace, i));
-        GcMethod* m = cast<GcMethod>(t, e->method());
+      for (unsigned i = 0; i < traceLength(t, trace); ++i) {
+        GcMethod* m = traceMethod(t, trace, i);
         const int8_t* class_ = m->class_()->name()->body().begin();
         const int8_t* method = m->name()->body().begin();
-        int line = t->m->processor->lineNumber(t, m, e->ip());
+        int line = t->m->processor->lineNumber(t, m, traceIp(t, trace, i));
 
         logTrace(errorLog(t), "  at %s.%s ", class_, method);
 
@@ -5703,37 +7556,56 @@ void printTrace(Thread* t, GcThrowable* exception)
   ::fflush(errorLog(t));
 }
 
-object makeTrace(Thread* t, Processor::StackWalker* walker)
+namespace {
+
+GcTrace* allocateTrace(Thread* t, unsigned count)
+{
+  GcIntArray* ips = makeIntArray(t, count);
+  return makeTrace(t, ips, count);
+}
+
+}  // namespace
+
+object makeTrace(Thread* t, Processor::StackWalker* walker, unsigned limit)
 {
   class Visitor : public Processor::StackVisitor {
    public:
-    Visitor(Thread* t) : t(t), trace(0), index(0), protector(t, &trace)
+    Visitor(Thread* t, unsigned limit) : t(t), trace(0), index(0), limit(limit)
     {
     }
 
     virtual bool visit(Processor::StackWalker* walker)
     {
       if (trace == 0) {
-        trace = makeObjectArray(t, walker->count());
-        assertT(t, trace);
+        // allocate everything up front, so nothing moves while we walk
+        unsigned count = walker->count();
+        if (limit and count > limit) {
+          count = limit;
+        }
+        trace = allocateTrace(t, count);
       }
 
-      GcTraceElement* e = makeTraceElement(t, walker->method(), walker->ip());
-      assertT(t, index < objectArrayLength(t, trace));
-      reinterpret_cast<GcArray*>(trace)->setBodyElement(t, index, e);
+      assertT(t, index < trace->length());
+      trace->setMethodsElement(t, index, walker->method());
+      trace->ips()->body()[index] = walker->ip();
       ++index;
-      return true;
+      return index < trace->length();
     }
 
     Thread* t;
-    object trace;
+    GcTrace* trace;
     unsigned index;
-    Thread::SingleProtector protector;
-  } v(t);
+    unsigned limit;
+  } v(t, limit);
 
   walker->walk(&v);
 
-  return v.trace ? v.trace : makeObjectArray(t, 0);
+  return v.trace ? v.trace : makeEmptyTrace(t);
+}
+
+object makeEmptyTrace(Thread* t)
+{
+  return allocateTrace(t, 0);
 }
 
 object makeTrace(Thread* t, Thread* target)
@@ -5756,131 +7628,192 @@ object makeTrace(Thread* t, Thread* target)
 
   t->m->processor->walkStack(target, &v);
 
-  return v.trace ? v.trace : makeObjectArray(t, 0);
+  return v.trace ? v.trace : makeEmptyTrace(t);
 }
 
-void runFinalizeThread(Thread* t)
+namespace {
+
+unsigned countThreads(Thread* o)
 {
-  GcFinalizer* finalizeList = 0;
-  PROTECT(t, finalizeList);
+  unsigned count = 0;
+  for (Thread* p = o; p; p = p->peer) {
+    ++count;
+    if (p->child) {
+      count += countThreads(p->child);
+    }
+  }
+  return count;
+}
 
-  GcCleaner* cleanList = 0;
-  PROTECT(t, cleanList);
+Thread** listThreads(Thread* o, Thread** array)
+{
+  for (Thread* p = o; p; p = p->peer) {
+    *(array++) = p;
+    if (p->child) {
+      array = listThreads(p->child, array);
+    }
+  }
+  return array;
+}
 
-  while (true) {
-    {
-      ACQUIRE(t, t->m->stateLock);
+}  // namespace
 
-      while (t->m->finalizeThread and roots(t)->objectsToFinalize() == 0
-             and roots(t)->objectsToClean() == 0) {
-        ENTER(t, Thread::IdleState);
-        t->m->stateLock->wait(t->systemThread, 0);
-      }
+GcArray* makeThreadTraces(Thread* t)
+{
+  ENTER(t, Thread::ExclusiveState);
 
-      if (t->m->finalizeThread == 0) {
-        return;
-      } else {
-        finalizeList = roots(t)->objectsToFinalize();
-        roots(t)->setObjectsToFinalize(t, 0);
+  // every other thread is idle now and will stay that way until we
+  // leave the exclusive state, so none of the threads we list here
+  // can go away under us, and each of their stacks holds still while
+  // we walk it.  Holding the state lock as well keeps the tree from
+  // changing, since a thread attaching itself doesn't wait for us.
+  ACQUIRE_RAW(t, t->m->stateLock);
 
-        cleanList = roots(t)->objectsToClean();
-        roots(t)->setObjectsToClean(t, 0);
-      }
-    }
+  unsigned count = countThreads(t->m->rootThread);
+  THREAD_RUNTIME_ARRAY(t, Thread*, threads, count);
+  listThreads(t->m->rootThread, RUNTIME_ARRAY_BODY(threads));
 
-    for (; finalizeList; finalizeList = finalizeList->queueNext()) {
-      finalizeObject(t, finalizeList->queueTarget(), "finalize");
-    }
+  GcArray* array = makeArray(t, count * 2);
+  PROTECT(t, array);
 
-    for (; cleanList; cleanList = cleanList->queueNext()) {
-      finalizeObject(t, cleanList, "clean");
+  unsigned index = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    Thread* o = RUNTIME_ARRAY_BODY(threads)[i];
+    if (o->javaThread and (o == t or o->state == Thread::IdleState)) {
+      array->setBodyElement(t, index, o->javaThread);
+      object trace = makeTrace(t, o);
+      array->setBodyElement(t, index + 1, trace);
+      index += 2;
     }
   }
+
+  return array;
 }
 
-object parseUtf8(Thread* t, const char* data, unsigned length)
+GcString* makeTraceString(Thread* t, object trace)
 {
-  class Client : public Stream::Client {
-   public:
-    Client(Thread* t) : t(t)
-    {
-    }
+  unsigned length = traceLength(t, trace);
 
-    virtual void handleError()
-    {
-      if (false)
-        abort(t);
-    }
+  // format the frames outside the heap first, as makeContentionProfile
+  // does, so nothing moves while we look at them
+  unsigned capacity = 1;
+  for (unsigned i = 0; i < length; ++i) {
+    GcMethod* method = traceMethod(t, trace, i);
+    capacity += method->class_()->name()->length()
+                + method->name()->length() + 32;
+  }
 
-   private:
-    Thread* t;
-  } client(t);
+  char* text = static_cast<char*>(t->m->heap->allocate(capacity));
+  unsigned size = 0;
+  for (unsigned i = 0; i < length; ++i) {
+    GcMethod* method = traceMethod(t, trace, i);
+    int line = t->m->processor->lineNumber(t, method, traceIp(t, trace, i));
 
-  Stream s(&client, reinterpret_cast<const uint8_t*>(data), length);
+    size = appendToKey(
+        text,
+        capacity,
+        size,
+        "\tat %s.%s",
+        reinterpret_cast<const char*>(method->class_()->name()->body().begin()),
+        reinterpret_cast<const char*>(method->name()->body().begin()));
 
-  return ::parseUtf8(t, s, length);
-}
+    // keep in sync with StackTraceElement.toString
+    if (line == NativeLine) {
+      size = appendToKey(text, capacity, size, " (native)\n");
+    } else if (line >= 0) {
+      size = appendToKey(text, capacity, size, " (line %d)\n", line);
+    } else {
+      size = appendToKey(text, capacity, size, "\n");
+    }
+  }
 
-object parseUtf8(Thread* t, GcByteArray* array)
-{
-  for (unsigned i = 0; i < array->length() - 1; ++i) {
-    if (array->body()[i] & 0x80) {
-      goto slow_path;
+  // method names can't contain slashes, so this only touches the
+  // class names
+  for (unsigned i = 0; i < size; ++i) {
+    if (text[i] == '/') {
+      text[i] = '.';
     }
   }
 
-  return array;
+  GcByteArray* array = makeByteArray(t, size);
+  memcpy(array->body().begin(), text, size);
+  t->m->heap->free(text, capacity);
 
-slow_path:
-  class Client : public Stream::Client {
-   public:
-    Client(Thread* t) : t(t)
-    {
-    }
+  return t->m->classpath->makeString(t, array, 0, size);
+}
 
-    virtual void handleError()
-    {
-      if (false)
-        abort(t);
-    }
+void runFinalizeThread(Thread* t)
+{
+  GcFinalizer* finalizer = 0;
+  PROTECT(t, finalizer);
 
-   private:
-    Thread* t;
-  } client(t);
+  GcCleaner* cleaner = 0;
+  PROTECT(t, cleaner);
 
-  class MyStream : public AbstractStream {
-   public:
-    class MyProtector : public Thread::Protector {
-     public:
-      MyProtector(Thread* t, MyStream* s) : Protector(t), s(s)
-      {
-      }
+  while (true) {
+    {
+      ACQUIRE(t, t->m->stateLock);
 
-      virtual void visit(Heap::Visitor* v)
-      {
-        v->visit(&(s->array));
+      while (t->m->finalizeThreadCount and roots(t)->objectsToFinalize() == 0
+             and roots(t)->objectsToClean() == 0) {
+        ENTER(t, Thread::IdleState);
+        t->m->stateLock->wait(t->systemThread, 0);
       }
 
-      MyStream* s;
-    };
+      if (t->m->finalizeThreadCount == 0) {
+        return;
+      }
 
-    MyStream(Thread* t, Client* client, GcByteArray* array)
-        : AbstractStream(client, array->length() - 1),
-          array(array),
-          protector(t, this)
-    {
+      // take one item at a time so that a slow finalizer only holds
+      // up the thread running it, not the rest of the pool:
+      finalizer = roots(t)->objectsToFinalize();
+      if (finalizer) {
+        roots(t)->setObjectsToFinalize(t, finalizer->queueNext());
+      } else {
+        cleaner = roots(t)->objectsToClean();
+        roots(t)->setObjectsToClean(t, cleaner->queueNext());
+      }
     }
 
-    virtual void copy(uint8_t* dst, unsigned offset, unsigned size)
-    {
-      memcpy(dst, &array->body()[offset], size);
+    if (finalizer) {
+      finalizeObject(t, finalizer->queueTarget(), "finalize");
+      finalizer = 0;
+    } else {
+      finalizeObject(t, cleaner, "clean");
+      cleaner = 0;
     }
+  }
+}
+
+object parseUtf8(Thread* t, const char* data, unsigned length)
+{
+  GcByteArray* value = makeByteArray(t, length + 1);
+  memcpy(value->body().begin(), data, length);
+
+  unsigned ascii = asciiPrefixLength(
+      reinterpret_cast<const uint8_t*>(value->body().begin()), length);
+  if (ascii == length) {
+    return value;
+  } else {
+    return ::decodeUtf8(t, value, ascii, length);
+  }
+}
+
+object parseUtf8(Thread* t, GcByteArray* array)
+{
+  unsigned length = array->length() - 1;
+  unsigned ascii = asciiPrefixLength(
+      reinterpret_cast<const uint8_t*>(array->body().begin()), length);
+  if (ascii == length) {
+    return array;
+  }
 
-    GcByteArray* array;
-    MyProtector protector;
-  } s(t, &client, array);
+  // the array may be shared, e.g. by a constant pool, so decode a copy
+  PROTECT(t, array);
 
-  return ::parseUtf8(t, s, array->length() - 1);
+  GcByteArray* value = makeByteArray(t, length + 1);
+  memcpy(value->body().begin(), array->body().begin(), length);
+  return ::decodeUtf8(t, value, ascii, length);
 }
 
 GcMethod* getCaller(Thread* t, unsigned target, bool skipMethodInvoke)
@@ -6008,7 +7941,8 @@ object interruptLock(Thread* t, GcThread* thread)
 
     if (thread->interruptLock() == 0) {
       object head = makeMonitorNode(t, 0, 0);
-      GcMonitor* lock = makeMonitor(t, 0, 0, 0, head, head, 0);
+      GcMonitor* lock
+          = makeMonitor(t, 0, 0, 0, head, head, 0, InitialMonitorSpinLimit);
 
       storeStoreMemoryBarrier();
 
@@ -6036,6 +7970,7 @@ void threadInterrupt(Thread* t, GcThread* thread)
     interrupt(t, p);
   }
   thread->interrupted() = true;
+  unpark(t, p);
   monitorRelease(t, cast<GcMonitor>(t, interruptLock(t, thread)));
 }
 
@@ -6284,6 +8219,129 @@ GcCallSite* resolveDynamic(Thread* t, GcInvocation* invocation)
       t, t->m->processor->invokeArray(t, bootstrap, handle, argArray));
 }
 
+namespace {
+
+#ifdef USE_ATOMIC_OPERATIONS
+// whether the eight bytes at the specified address can be swapped in
+// one access
+bool atomicWide(int64_t* p UNUSED)
+{
+#ifdef AVIAN_HAS_CAS64
+  return true;
+#elif defined AVIAN_HAS_ALIGNED_CAS64
+  return (reinterpret_cast<uintptr_t>(p) & 7) == 0;
+#else
+  return false;
+#endif
+}
+
+bool casWide(Thread* t UNUSED,
+             int64_t* p UNUSED,
+             int64_t old UNUSED,
+             int64_t new_ UNUSED)
+{
+#ifdef AVIAN_HAS_CAS64
+  return atomicCompareAndSwap64(reinterpret_cast<uint64_t*>(p), old, new_);
+#elif defined AVIAN_HAS_ALIGNED_CAS64
+  return atomicCompareAndSwap64Aligned(
+      reinterpret_cast<uint64_t*>(p), old, new_);
+#else
+  abort(t);
+#endif
+}
+
+// Guards a field which can't be accessed atomically in place.  The
+// holder never reaches a safepoint, so the field can't move while
+// anyone holds or waits for its lock, and every thread touching it
+// agrees on which lock that is.
+class WideLock {
+ public:
+  WideLock(Thread* t, int64_t* p)
+      : t(t),
+        lock(t->m->wideLocks
+             + ((reinterpret_cast<uintptr_t>(p) / sizeof(int64_t))
+                % WideLockCount))
+  {
+    while (not atomicCompareAndSwap(lock, 0, 1)) {
+      t->m->system->yield();
+    }
+  }
+
+  ~WideLock()
+  {
+    storeStoreMemoryBarrier();
+    *lock = 0;
+  }
+
+  Thread* t;
+  uintptr_t* lock;
+};
+#endif  // USE_ATOMIC_OPERATIONS
+
+}  // namespace
+
+int64_t loadWide(Thread* t UNUSED, int64_t* p)
+{
+#ifdef USE_ATOMIC_OPERATIONS
+  if (BytesPerWord == 4) {
+    if (atomicWide(p)) {
+      // a swap which changes nothing reads all eight bytes at once
+      int64_t v = *p;
+      while (not casWide(t, p, v, v)) {
+        v = *p;
+      }
+      return v;
+    } else {
+      WideLock lock(t, p);
+      return *p;
+    }
+  }
+#endif
+
+  return *p;
+}
+
+void storeWide(Thread* t UNUSED, int64_t* p, int64_t value)
+{
+#ifdef USE_ATOMIC_OPERATIONS
+  if (BytesPerWord == 4) {
+    if (atomicWide(p)) {
+      for (int64_t v = *p; not casWide(t, p, v, value); v = *p) {
+      }
+    } else {
+      WideLock lock(t, p);
+      *p = value;
+    }
+    return;
+  }
+#endif
+
+  *p = value;
+}
+
+bool compareAndSwapWide(Thread* t UNUSED,
+                        int64_t* p,
+                        int64_t old,
+                        int64_t new_)
+{
+#ifdef USE_ATOMIC_OPERATIONS
+  if (BytesPerWord == 8) {
+    return atomicCompareAndSwap(reinterpret_cast<uintptr_t*>(p), old, new_);
+  } else if (atomicWide(p)) {
+    return casWide(t, p, old, new_);
+  }
+
+  WideLock lock(t, p);
+#endif
+
+  if (*p == old) {
+    *p = new_;
+    return true;
+  } else {
+    return false;
+  }
+}
+
 void noop()
 {
 }
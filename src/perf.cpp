@@ -0,0 +1,316 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/machine.h"
+
+#include <avian/util/runtime-array.h>
+#include <avian/util/slice.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace vm;
+using namespace avian::util;
+
+namespace {
+
+namespace local {
+
+class PerfMapHandler : public Processor::CompilationHandler {
+ public:
+  PerfMapHandler(System::Mutex* lock, Allocator* allocator, FILE* out)
+      : lock(lock), allocator(allocator), out(out)
+  {
+  }
+
+  virtual void compiled(const void* code,
+                        unsigned size,
+                        unsigned,
+                        const char* name,
+                        const char*,
+                        Slice<const uint64_t>)
+  {
+    lock->acquire();
+
+    fprintf(out, "%" LX " %x %s\n", reinterpret_cast<uintptr_t>(code), size,
+            name);
+    // perf reads the map after we exit, possibly abnormally, so don't
+    // leave anything sitting in the buffer:
+    fflush(out);
+
+    lock->release();
+  }
+
+  virtual void dispose()
+  {
+    fclose(out);
+    lock->dispose();
+    allocator->free(this, sizeof(*this));
+  }
+
+  System::Mutex* lock;
+  Allocator* allocator;
+  FILE* out;
+};
+
+#ifdef __linux__
+
+// see tools/perf/Documentation/jitdump-specification.txt in the Linux
+// source tree
+const uint32_t JitDumpMagic = 0x4A695444;
+const uint32_t JitDumpVersion = 1;
+
+enum { JitCodeLoad = 0, JitCodeDebugInfo = 2 };
+
+#if defined(__x86_64__)
+const uint32_t ElfMachine = 62;
+#elif defined(__i386__)
+const uint32_t ElfMachine = 3;
+#elif defined(__aarch64__)
+const uint32_t ElfMachine = 183;
+#elif defined(__arm__)
+const uint32_t ElfMachine = 40;
+#else
+const uint32_t ElfMachine = 0;
+#endif
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t elfMachine;
+  uint32_t pad;
+  uint32_t pid;
+  uint64_t timestamp;
+  uint64_t flags;
+};
+
+struct RecordHeader {
+  uint32_t id;
+  uint32_t size;
+  uint64_t timestamp;
+};
+
+struct CodeLoad {
+  RecordHeader header;
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t vma;
+  uint64_t codeAddress;
+  uint64_t codeSize;
+  uint64_t codeIndex;
+};
+
+struct DebugInfo {
+  RecordHeader header;
+  uint64_t codeAddress;
+  uint64_t entryCount;
+};
+
+struct DebugEntry {
+  uint64_t address;
+  uint32_t line;
+  uint32_t discriminator;
+};
+
+// perf can only correlate these with its samples if they come from
+// the same clock, i.e. "perf record -k mono"
+uint64_t timestamp()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+class JitDumpHandler : public Processor::CompilationHandler {
+ public:
+  JitDumpHandler(System::Mutex* lock,
+                 Allocator* allocator,
+                 FILE* out,
+                 void* marker,
+                 size_t markerSize)
+      : lock(lock),
+        allocator(allocator),
+        out(out),
+        marker(marker),
+        markerSize(markerSize),
+        codeIndex(0)
+  {
+  }
+
+  virtual void compiled(const void* code,
+                        unsigned size,
+                        unsigned,
+                        const char* name,
+                        const char* sourceFile,
+                        Slice<const uint64_t> lineNumbers)
+  {
+    lock->acquire();
+
+    uint64_t address = reinterpret_cast<uintptr_t>(code);
+    uint64_t now = timestamp();
+
+    // perf requires the debug information for a method to precede
+    // the record describing its code
+    if (sourceFile and lineNumbers.count) {
+      size_t sourceFileSize = strlen(sourceFile) + 1;
+
+      DebugInfo info;
+      info.header.id = JitCodeDebugInfo;
+      info.header.size = sizeof(DebugInfo)
+                         + lineNumbers.count
+                           * (sizeof(DebugEntry) + sourceFileSize);
+      info.header.timestamp = now;
+      info.codeAddress = address;
+      info.entryCount = lineNumbers.count;
+      write(&info, sizeof(DebugInfo));
+
+      for (size_t i = 0; i < lineNumbers.count; ++i) {
+        DebugEntry e;
+        e.address = address + lineNumberIp(lineNumbers[i]);
+        e.line = lineNumberLine(lineNumbers[i]);
+        e.discriminator = 0;
+        write(&e, sizeof(DebugEntry));
+        write(sourceFile, sourceFileSize);
+      }
+    }
+
+    size_t nameSize = strlen(name) + 1;
+
+    CodeLoad load;
+    load.header.id = JitCodeLoad;
+    load.header.size = sizeof(CodeLoad) + nameSize + size;
+    load.header.timestamp = now;
+    load.pid = getpid();
+    load.tid = syscall(SYS_gettid);
+    load.vma = address;
+    load.codeAddress = address;
+    load.codeSize = size;
+    load.codeIndex = codeIndex++;
+    write(&load, sizeof(CodeLoad));
+    write(name, nameSize);
+    write(code, size);
+
+    fflush(out);
+
+    lock->release();
+  }
+
+  void write(const void* data, size_t size)
+  {
+    size_t n UNUSED = fwrite(data, size, 1, out);
+  }
+
+  virtual void dispose()
+  {
+    munmap(marker, markerSize);
+    fclose(out);
+    lock->dispose();
+    allocator->free(this, sizeof(*this));
+  }
+
+  System::Mutex* lock;
+  Allocator* allocator;
+  FILE* out;
+  void* marker;
+  size_t markerSize;
+  uint64_t codeIndex;
+};
+
+#endif  // __linux__
+
+}  // namespace local
+
+}  // namespace
+
+namespace vm {
+
+Processor::CompilationHandler* makePerfMapHandler(System* s UNUSED,
+                                                  Allocator* allocator UNUSED)
+{
+#ifdef __linux__
+  char path[64];
+  vm::snprintf(
+      path, sizeof(path), "/tmp/perf-%d.map", static_cast<int>(getpid()));
+
+  FILE* out = vm::fopen(path, "wb");
+  if (out == 0) {
+    return 0;
+  }
+
+  System::Mutex* lock;
+  expect(s, s->success(s->make(&lock)));
+
+  return new (allocator->allocate(sizeof(local::PerfMapHandler)))
+      local::PerfMapHandler(lock, allocator, out);
+#else
+  return 0;
+#endif
+}
+
+Processor::CompilationHandler* makeJitDumpHandler(System* s UNUSED,
+                                                  Allocator* allocator UNUSED,
+                                                  const char* directory UNUSED)
+{
+#ifdef __linux__
+  int pid = getpid();
+
+  RUNTIME_ARRAY(char, path, strlen(directory) + 32);
+  sprintf(RUNTIME_ARRAY_BODY(path), "%s/jit-%d.dump", directory, pid);
+
+  int fd = ::open(RUNTIME_ARRAY_BODY(path), O_CREAT | O_TRUNC | O_RDWR, 0666);
+  if (fd < 0) {
+    return 0;
+  }
+
+  // perf finds the dump by looking for an executable mapping of it
+  // among the mmap events it records
+  size_t markerSize = sysconf(_SC_PAGESIZE);
+  void* marker = mmap(0, markerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0);
+  if (marker == MAP_FAILED) {
+    ::close(fd);
+    return 0;
+  }
+
+  FILE* out = fdopen(fd, "wb");
+  if (out == 0) {
+    munmap(marker, markerSize);
+    ::close(fd);
+    return 0;
+  }
+
+  local::FileHeader header;
+  header.magic = local::JitDumpMagic;
+  header.version = local::JitDumpVersion;
+  header.size = sizeof(local::FileHeader);
+  header.elfMachine = local::ElfMachine;
+  header.pad = 0;
+  header.pid = pid;
+  header.timestamp = local::timestamp();
+  header.flags = 0;
+  size_t n UNUSED = fwrite(&header, sizeof(local::FileHeader), 1, out);
+  fflush(out);
+
+  System::Mutex* lock;
+  expect(s, s->success(s->make(&lock)));
+
+  return new (allocator->allocate(sizeof(local::JitDumpHandler)))
+      local::JitDumpHandler(lock, allocator, out, marker, markerSize);
+#else
+  return 0;
+#endif
+}
+
+}  // namespace vm
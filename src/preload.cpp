@@ -0,0 +1,267 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/jnienv.h"
+#include "avian/machine.h"
+#include "avian/processor.h"
+
+using namespace vm;
+
+namespace {
+
+namespace local {
+
+// longest line we'll read from a preload list in one go; the pieces
+// of a longer line won't name anything, so they're ignored
+const unsigned MaxLineLength = 1024;
+
+class Preloader : public System::Runnable {
+ public:
+  Preloader(Machine* m, FILE* in, bool initialize)
+      : m(m), in(in), initialize(initialize), interrupted_(false)
+  {
+  }
+
+  virtual void attach(System::Thread*)
+  {
+  }
+
+  virtual void run();
+
+  virtual bool interrupted()
+  {
+    return interrupted_;
+  }
+
+  virtual void setInterrupted(bool v)
+  {
+    interrupted_ = v;
+  }
+
+  Machine* m;
+  FILE* in;
+  bool initialize;
+  bool interrupted_;
+};
+
+// whether classes loaded by this loader can be found again by name
+// from the app loader, which is where the preloader looks for them
+bool preloadable(Thread* t, GcClassLoader* loader)
+{
+  return loader == roots(t)->bootLoader() or loader == roots(t)->appLoader();
+}
+
+void write(Thread* t, const char* kind, GcByteArray* name, GcMethod* method)
+{
+  PreloadLog* log = t->m->preloadLog;
+
+  log->lock->acquire();
+
+  if (method) {
+    fprintf(log->out,
+            "%s %s %s %s\n",
+            kind,
+            name->body().begin(),
+            method->name()->body().begin(),
+            method->spec()->body().begin());
+  } else {
+    fprintf(log->out, "%s %s\n", kind, name->body().begin());
+  }
+
+  log->lock->release();
+}
+
+// Returns the next space-separated word in *line, or null if there
+// are none left.
+char* nextWord(char** line)
+{
+  char* p = *line;
+  while (*p == ' ') {
+    ++p;
+  }
+
+  char* start = p;
+  while (*p and *p != ' ' and *p != '\r' and *p != '\n') {
+    ++p;
+  }
+
+  bool last = *p != ' ';
+  *p = 0;
+  *line = last ? p : p + 1;
+
+  return p == start ? 0 : start;
+}
+
+GcClass* resolve(Thread* t, const char* name)
+{
+  return resolveSystemClass(
+      t, roots(t)->appLoader(), makeByteArray(t, "%s", name), false);
+}
+
+// Handles one line of a preload list.  Classes are only initialized
+// if avian.preload.init is set, and methods are only compiled if
+// compiling them won't initialize their class when it would have
+// stayed uninitialized otherwise.
+uint64_t preloadEntry(Thread* t, uintptr_t* arguments)
+{
+  Preloader* p = reinterpret_cast<Preloader*>(arguments[0]);
+  char* line = reinterpret_cast<char*>(arguments[1]);
+
+  char* kind = nextWord(&line);
+  char* name = kind ? nextWord(&line) : 0;
+  if (name == 0) {
+    return 1;
+  }
+
+  GcClass* c = resolve(t, name);
+  if (c == 0) {
+    return 1;
+  }
+
+  if (::strcmp(kind, "init") == 0) {
+    if (p->initialize) {
+      initClass(t, c);
+    }
+  } else if (::strcmp(kind, "method") == 0) {
+    char* methodName = nextWord(&line);
+    char* spec = methodName ? nextWord(&line) : 0;
+    if (spec) {
+      PROTECT(t, c);
+
+      GcMethod* method = findMethodOrNull(t, c, methodName, spec);
+      if (method
+          and ((method->flags() & ACC_STATIC) == 0 or p->initialize
+               or (c->vmFlags() & (NeedInitFlag | InitFlag)) == 0)) {
+        t->m->processor->precompile(t, method);
+      }
+    }
+  }
+
+  return 1;
+}
+
+uint64_t runPreloader(Thread* t, uintptr_t* arguments)
+{
+  Preloader* p = reinterpret_cast<Preloader*>(arguments[0]);
+
+  char line[MaxLineLength];
+  while (t->m->alive and fgets(line, MaxLineLength, p->in)) {
+    // an entry which can't be found or fails to load is left for the
+    // application to run into, if it ever does
+    uintptr_t entryArguments[] = {reinterpret_cast<uintptr_t>(p),
+                                  reinterpret_cast<uintptr_t>(line)};
+    if (not run(t, preloadEntry, entryArguments)) {
+      t->exception = 0;
+    }
+  }
+
+  return 1;
+}
+
+void Preloader::run()
+{
+  Thread* t;
+  if (m->vtable->AttachCurrentThreadAsDaemon(m, &t, 0) == 0) {
+    uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(this)};
+    vm::run(t, runPreloader, arguments);
+    m->vtable->DetachCurrentThread(m);
+  }
+
+  fclose(in);
+  in = 0;
+}
+
+}  // namespace local
+
+}  // namespace
+
+namespace vm {
+
+void startPreloadLog(Machine* m)
+{
+  const char* path = findProperty(m, PRELOAD_RECORD_PROPERTY);
+  if (path == 0) {
+    return;
+  }
+
+  FILE* out = vm::fopen(path, "wb");
+  if (out == 0) {
+    fprintf(stderr, "unable to open %s\n", path);
+    return;
+  }
+
+  System::Mutex* lock;
+  expect(m->system, m->system->success(m->system->make(&lock)));
+
+  m->preloadLog = new (m->heap->allocate(sizeof(PreloadLog)))
+      PreloadLog(lock, out);
+}
+
+void recordPreloadClass(Thread* t, GcClass* c, bool initialized)
+{
+  if (local::preloadable(t, c->loader())) {
+    local::write(t, initialized ? "init" : "class", c->name(), 0);
+  }
+}
+
+void recordPreloadMethod(Thread* t, GcMethod* method)
+{
+  if (local::preloadable(t, method->class_()->loader())) {
+    local::write(t, "method", method->class_()->name(), method);
+  }
+}
+
+void startPreload(Thread* t)
+{
+  const char* path = findProperty(t, PRELOAD_PROPERTY);
+  if (path == 0) {
+    return;
+  }
+
+  FILE* in = vm::fopen(path, "rb");
+  if (in == 0) {
+    fprintf(stderr, "unable to open %s\n", path);
+    return;
+  }
+
+  const char* initialize = findProperty(t, PRELOAD_INIT_PROPERTY);
+
+  local::Preloader* p = new (t->m->heap->allocate(sizeof(local::Preloader)))
+      local::Preloader(
+          t->m, in, initialize and ::strcmp(initialize, "true") == 0);
+
+  t->m->preloader = p;
+
+  if (not t->m->system->success(t->m->system->start(p))) {
+    fclose(in);
+    p->in = 0;
+  }
+}
+
+void disposePreload(Machine* m)
+{
+  PreloadLog* log = m->preloadLog;
+  if (log) {
+    fclose(log->out);
+    log->lock->dispose();
+    m->heap->free(log, sizeof(PreloadLog));
+    m->preloadLog = 0;
+  }
+
+  // the preloader runs as a daemon, so it may not be done yet, in
+  // which case we leave it be
+  local::Preloader* p = static_cast<local::Preloader*>(m->preloader);
+  if (p and p->in == 0) {
+    m->heap->free(p, sizeof(local::Preloader));
+  }
+  m->preloader = 0;
+}
+
+}  // namespace vm
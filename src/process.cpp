@@ -131,23 +131,81 @@ void makeJNIName(Thread* t UNUSED,
   *(name++) = 0;
 }
 
+NativeSymbol* findNativeSymbol(NativeSymbol* e,
+                               uint32_t hash,
+                               const char* name,
+                               unsigned length)
+{
+  while (e and (e->hash != hash or e->length != length
+                or memcmp(e->name(), name, length) != 0)) {
+    e = e->next;
+  }
+  return e;
+}
+
+// The same symbol is looked up once for each class loader which
+// loads a class declaring it, and every method is looked up under
+// several prefixes, mostly in vain, so we cache both hits and misses
+// rather than asking every library each time.
 void* resolveNativeMethod(Thread* t,
                           const char* undecorated,
                           const char* decorated)
 {
-  for (System::Library* lib = t->m->libraries; lib; lib = lib->next()) {
-    void* p = lib->resolve(undecorated);
-    if (p) {
-      return p;
-    } else {
-      p = lib->resolve(decorated);
-      if (p) {
-        return p;
+  Machine* m = t->m;
+  unsigned length = strlen(decorated) + 1;
+  uint32_t hash = avian::util::hash(decorated);
+  NativeSymbol** bucket
+      = m->nativeSymbols + (hash & (NativeSymbolBucketCount - 1));
+
+  System::Library* start = m->libraries;
+  {
+    ACQUIRE_RAW(t, m->nativeSymbolLock);
+
+    NativeSymbol* e = findNativeSymbol(*bucket, hash, decorated, length);
+    if (e) {
+      if (e->address) {
+        return e->address;
       }
+      start = e->searched->next();
     }
   }
 
-  return 0;
+  // we search without holding the lock, since the libraries may be
+  // slow to answer
+  System::Library* searched = 0;
+  void* p = 0;
+  for (System::Library* lib = start; lib; lib = lib->next()) {
+    searched = lib;
+    p = lib->resolve(undecorated);
+    if (p == 0) {
+      p = lib->resolve(decorated);
+    }
+    if (p) {
+      break;
+    }
+  }
+
+  if (searched == 0) {
+    // no libraries have been loaded since we last missed
+    return 0;
+  }
+
+  ACQUIRE_RAW(t, m->nativeSymbolLock);
+
+  NativeSymbol* e = findNativeSymbol(*bucket, hash, decorated, length);
+  if (e == 0) {
+    e = new (m->heap->allocate(sizeof(NativeSymbol) + length))
+        NativeSymbol(*bucket, hash, length);
+    memcpy(e->name(), decorated, length);
+    *bucket = e;
+  }
+
+  if (e->address == 0) {
+    e->address = p;
+    e->searched = searched;
+  }
+
+  return p;
 }
 
 void* resolveNativeMethod(Thread* t,
@@ -222,12 +280,27 @@ GcNative* resolveNativeMethod(Thread* t, GcMethod* method)
 {
   void* p = resolveNativeMethod(t, method, "Avian_", 6, 3);
   if (p) {
-    return makeNative(t, p, true);
+    return makeNative(t, p, true, 0);
+  }
+
+  unsigned shape = criticalNativeShape(t, method);
+  if (shape) {
+    unsigned footprint = method->parameterCount();
+    for (unsigned i = 0; i < method->parameterCount(); ++i) {
+      if (directNativeReference(shape, i)) {
+        ++footprint;
+      }
+    }
+
+    p = resolveNativeMethod(t, method, "JavaCritical_", 13, footprint);
+    if (p) {
+      return makeNative(t, p, false, shape);
+    }
   }
 
   p = resolveNativeMethod(t, method, "Java_", 5, -1);
   if (p) {
-    return makeNative(t, p, false);
+    return makeNative(t, p, false, directNativeShape(t, method));
   }
 
   return 0;
@@ -237,6 +310,114 @@ GcNative* resolveNativeMethod(Thread* t, GcMethod* method)
 
 namespace vm {
 
+unsigned directNativeShape(Thread* t, GcMethod* method)
+{
+  if (method->parameterCount() > MaxDirectNativeParameters) {
+    return 0;
+  }
+
+  switch (fieldType(t, method->returnCode())) {
+  case FLOAT_TYPE:
+  case DOUBLE_TYPE:
+    return 0;
+
+  default:
+    break;
+  }
+
+  unsigned shape = DirectNativeFlag;
+  unsigned index = 0;
+  MethodSpecIterator it(
+      t, reinterpret_cast<const char*>(method->spec()->body().begin()));
+
+  while (it.hasNext()) {
+    switch (fieldType(t, fieldCode(t, *it.next()))) {
+    case FLOAT_TYPE:
+    case DOUBLE_TYPE:
+      return 0;
+
+    case INT64_TYPE:
+      if (BytesPerWord < 8) {
+        return 0;
+      }
+      shape |= 1 << (index + 8);
+      break;
+
+    case POINTER_TYPE:
+      shape |= 1 << index;
+      break;
+
+    default:
+      break;
+    }
+
+    ++index;
+  }
+
+  return shape;
+}
+
+unsigned criticalNativeShape(Thread* t, GcMethod* method)
+{
+  if ((method->flags() & (ACC_STATIC | ACC_SYNCHRONIZED)) != ACC_STATIC) {
+    return 0;
+  }
+
+  switch (method->returnCode()) {
+  case FloatField:
+  case DoubleField:
+  case ObjectField:
+    return 0;
+
+  default:
+    break;
+  }
+
+  unsigned shape = CriticalNativeFlag;
+  unsigned index = 0;
+  unsigned words = 0;
+  MethodSpecIterator it(
+      t, reinterpret_cast<const char*>(method->spec()->body().begin()));
+
+  while (it.hasNext()) {
+    const char* s = it.next();
+    switch (*s) {
+    case 'F':
+    case 'D':
+    case 'L':
+      return 0;
+
+    case 'J':
+      if (BytesPerWord < 8) {
+        return 0;
+      }
+      shape |= 1 << (index + 8);
+      ++words;
+      break;
+
+    case '[':
+      if (s[1] == '[' or s[1] == 'L') {
+        return 0;
+      }
+      shape |= 1 << index;
+      words += 2;
+      break;
+
+    default:
+      ++words;
+      break;
+    }
+
+    if (words > MaxDirectNativeArguments) {
+      return 0;
+    }
+
+    ++index;
+  }
+
+  return shape;
+}
+
 void resolveNative(Thread* t, GcMethod* method)
 {
   PROTECT(t, method);
@@ -307,4 +488,89 @@ int findLineNumber(Thread* t UNUSED, GcMethod* method, unsigned ip)
   }
 }
 
+// Returns the length in bytes of the instruction at ip.
+unsigned instructionLength(Thread* t, GcCode* code, unsigned ip)
+{
+  switch (code->body()[ip]) {
+  case aload:
+  case astore:
+  case bipush:
+  case dload:
+  case dstore:
+  case fload:
+  case fstore:
+  case iload:
+  case istore:
+  case ldc:
+  case lload:
+  case lstore:
+  case newarray:
+  case ret:
+    return 2;
+
+  case anewarray:
+  case checkcast:
+  case getfield:
+  case getstatic:
+  case goto_:
+  case if_acmpeq:
+  case if_acmpne:
+  case if_icmpeq:
+  case if_icmpne:
+  case if_icmplt:
+  case if_icmpge:
+  case if_icmpgt:
+  case if_icmple:
+  case ifeq:
+  case ifne:
+  case iflt:
+  case ifge:
+  case ifgt:
+  case ifle:
+  case ifnonnull:
+  case ifnull:
+  case iinc:
+  case instanceof:
+  case invokespecial:
+  case invokestatic:
+  case invokevirtual:
+  case jsr:
+  case ldc_w:
+  case ldc2_w:
+  case new_:
+  case putfield:
+  case putstatic:
+  case sipush:
+    return 3;
+
+  case multianewarray:
+    return 4;
+
+  case goto_w:
+  case invokedynamic:
+  case invokeinterface:
+  case jsr_w:
+    return 5;
+
+  case wide:
+    return code->body()[ip + 1] == iinc ? 6 : 4;
+
+  case tableswitch: {
+    unsigned p = ((ip + 4) & ~3) + 4;
+    int32_t bottom = codeReadInt32(t, code, p);
+    int32_t top = codeReadInt32(t, code, p);
+    return p + ((top - bottom + 1) * 4) - ip;
+  }
+
+  case lookupswitch: {
+    unsigned p = ((ip + 4) & ~3) + 4;
+    int32_t pairCount = codeReadInt32(t, code, p);
+    return p + (pairCount * 8) - ip;
+  }
+
+  default:
+    return 1;
+  }
+}
+
 }  // namespace vm
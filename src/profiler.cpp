@@ -0,0 +1,333 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/machine.h"
+
+using namespace vm;
+
+namespace {
+
+namespace local {
+
+const unsigned IntervalInMilliseconds = 1;
+
+const unsigned MaxThreads = 256;
+
+const unsigned MaxDepth = 128;
+
+const unsigned MaxKeyLength = 8 * 1024;
+
+const unsigned BucketCount = 4096;
+
+class Entry {
+ public:
+  Entry(Entry* next, uint32_t hash, unsigned length)
+      : next(next), hash(hash), length(length), count(0)
+  {
+  }
+
+  char* key()
+  {
+    return reinterpret_cast<char*>(this + 1);
+  }
+
+  Entry* next;
+  uint32_t hash;
+  unsigned length;
+  unsigned count;
+};
+
+}  // namespace local
+
+}  // namespace
+
+namespace vm {
+
+// Samples the stacks of running Java threads at a fixed interval and
+// counts each distinct stack, writing the totals in "collapsed" form
+// (one "outer;...;inner count" line per stack) when the VM shuts
+// down.  Sampling is done from a daemon thread which stays in
+// ActiveState while it walks, so no collection can run and move the
+// methods it finds until it has turned them into names.
+class Profiler : public System::Runnable {
+ public:
+  Profiler(Machine* m, System::Monitor* lock, FILE* out)
+      : m(m),
+        lock(lock),
+        out(out),
+        stopping(false),
+        done(false),
+        interrupted_(false),
+        frameCount(0)
+  {
+    memset(buckets, 0, sizeof(buckets));
+  }
+
+  virtual void attach(System::Thread*)
+  {
+  }
+
+  virtual void run();
+
+  virtual bool interrupted()
+  {
+    return interrupted_;
+  }
+
+  virtual void setInterrupted(bool v)
+  {
+    interrupted_ = v;
+  }
+
+  void sample(Thread* t);
+
+  void record();
+
+  void write();
+
+  void dispose()
+  {
+    for (unsigned i = 0; i < local::BucketCount; ++i) {
+      for (local::Entry* e = buckets[i]; e;) {
+        local::Entry* next = e->next;
+        m->heap->free(e, sizeof(local::Entry) + e->length);
+        e = next;
+      }
+    }
+
+    lock->dispose();
+
+    m->heap->free(this, sizeof(*this));
+  }
+
+  Machine* m;
+  System::Monitor* lock;
+  FILE* out;
+  bool stopping;
+  bool done;
+  bool interrupted_;
+  unsigned frameCount;
+  GcMethod* frames[local::MaxDepth];
+  char key[local::MaxKeyLength];
+  local::Entry* buckets[local::BucketCount];
+};
+
+}  // namespace vm
+
+namespace {
+
+namespace local {
+
+unsigned collectThreads(Thread* t, Thread* o, Thread** threads, unsigned count)
+{
+  for (; o and count < MaxThreads; o = o->peer) {
+    // only threads running Java code are of interest; idle threads
+    // are blocked or running native code outside the VM
+    if (o != t and o->state == Thread::ActiveState and o->systemThread) {
+      threads[count++] = o;
+    }
+
+    count = collectThreads(t, o->child, threads, count);
+  }
+
+  return count;
+}
+
+unsigned append(char* key, unsigned offset, GcByteArray* name, bool dots)
+{
+  unsigned length = name->length() - 1;
+  if (offset + length > MaxKeyLength) {
+    length = MaxKeyLength - offset;
+  }
+
+  for (unsigned i = 0; i < length; ++i) {
+    char c = name->body()[i];
+    key[offset + i] = (dots and c == '/') ? '.' : c;
+  }
+
+  return offset + length;
+}
+
+uint64_t runProfiler(Thread* t, uintptr_t* arguments)
+{
+  Profiler* p = reinterpret_cast<Profiler*>(arguments[0]);
+
+  while (true) {
+    {
+      ACQUIRE(t, p->lock);
+
+      if (p->stopping) {
+        break;
+      }
+
+      ENTER(t, Thread::IdleState);
+      p->lock->wait(t->systemThread, IntervalInMilliseconds);
+    }
+
+    p->sample(t);
+  }
+
+  p->write();
+
+  ACQUIRE(t, p->lock);
+  p->done = true;
+  p->lock->notifyAll(t->systemThread);
+
+  return 1;
+}
+
+}  // namespace local
+
+}  // namespace
+
+namespace vm {
+
+void Profiler::run()
+{
+  Thread* t;
+  if (m->vtable->AttachCurrentThreadAsDaemon(m, &t, 0) == 0) {
+    uintptr_t arguments[] = {reinterpret_cast<uintptr_t>(this)};
+    vm::run(t, local::runProfiler, arguments);
+    m->vtable->DetachCurrentThread(m);
+  }
+}
+
+void Profiler::sample(Thread* t)
+{
+  class Visitor : public Processor::StackVisitor {
+   public:
+    Visitor(Profiler* p) : p(p)
+    {
+    }
+
+    // called with the target suspended, so this must not allocate or
+    // block
+    virtual bool visit(Processor::StackWalker* walker)
+    {
+      p->frames[p->frameCount++] = walker->method();
+      return p->frameCount < local::MaxDepth;
+    }
+
+    Profiler* p;
+  } v(this);
+
+  Thread* threads[local::MaxThreads];
+  unsigned count;
+  {
+    ACQUIRE_RAW(t, m->stateLock);
+
+    count = local::collectThreads(t, m->rootThread, threads, 0);
+  }
+
+  // threads are only disposed of during a collection, which can't
+  // happen while we remain in ActiveState and don't allocate
+  for (unsigned i = 0; i < count; ++i) {
+    frameCount = 0;
+    m->processor->sampleStack(t, threads[i], &v);
+
+    if (frameCount) {
+      record();
+    }
+  }
+}
+
+void Profiler::record()
+{
+  unsigned length = 0;
+  for (unsigned i = frameCount; i > 0 and length < local::MaxKeyLength;) {
+    GcMethod* method = frames[--i];
+
+    if (length) {
+      key[length++] = ';';
+    }
+    length = local::append(key, length, method->class_()->name(), true);
+    if (length < local::MaxKeyLength) {
+      key[length++] = '.';
+      length = local::append(key, length, method->name(), false);
+    }
+  }
+
+  uint32_t hash = 0;
+  for (unsigned i = 0; i < length; ++i) {
+    hash = (hash * 31) + static_cast<uint8_t>(key[i]);
+  }
+
+  local::Entry** bucket = buckets + (hash & (local::BucketCount - 1));
+
+  local::Entry* e = *bucket;
+  while (e and (e->hash != hash or e->length != length
+                or memcmp(e->key(), key, length) != 0)) {
+    e = e->next;
+  }
+
+  if (e == 0) {
+    e = new (m->heap->allocate(sizeof(local::Entry) + length))
+        local::Entry(*bucket, hash, length);
+    memcpy(e->key(), key, length);
+    *bucket = e;
+  }
+
+  ++e->count;
+}
+
+void Profiler::write()
+{
+  for (unsigned i = 0; i < local::BucketCount; ++i) {
+    for (local::Entry* e = buckets[i]; e; e = e->next) {
+      fprintf(out, "%.*s %u\n", e->length, e->key(), e->count);
+    }
+  }
+
+  fclose(out);
+  out = 0;
+}
+
+void startProfiler(Thread* t, const char* path)
+{
+  FILE* out = vm::fopen(path, "wb");
+  if (out == 0) {
+    fprintf(stderr, "unable to open profile output %s\n", path);
+    return;
+  }
+
+  System::Monitor* lock;
+  expect(t, t->m->system->success(t->m->system->make(&lock)));
+
+  Profiler* p = new (t->m->heap->allocate(sizeof(Profiler)))
+      Profiler(t->m, lock, out);
+
+  t->m->profiler = p;
+  t->m->system->start(p);
+}
+
+void stopProfiler(Thread* t)
+{
+  Profiler* p = t->m->profiler;
+  if (p) {
+    ACQUIRE(t, p->lock);
+
+    p->stopping = true;
+    p->lock->notifyAll(t->systemThread);
+
+    while (not p->done) {
+      ENTER(t, Thread::IdleState);
+      p->lock->wait(t->systemThread, 0);
+    }
+  }
+}
+
+void disposeProfiler(Machine* m)
+{
+  if (m->profiler) {
+    m->profiler->dispose();
+  }
+}
+
+}  // namespace vm
@@ -0,0 +1,231 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/jnienv.h"
+#include "avian/machine.h"
+
+using namespace vm;
+
+namespace {
+
+namespace local {
+
+const char* typeName(unsigned type)
+{
+  switch (type) {
+  case GcBeginEvent:
+    return "gc.begin";
+  case GcEndEvent:
+    return "gc.end";
+  case CompileEvent:
+    return "compile";
+  case ClassLoadEvent:
+    return "class.load";
+  case MonitorInflateEvent:
+    return "monitor.inflate";
+  case SafepointBeginEvent:
+    return "safepoint.begin";
+  case SafepointEndEvent:
+    return "safepoint.end";
+  case ThreadStartEvent:
+    return "thread.start";
+  case ThreadStopEvent:
+    return "thread.stop";
+  default:
+    return "?";
+  }
+}
+
+// Appends as much of the end of name as fits, the end of a class or
+// method name being the part which tells it apart.
+unsigned append(char* text, unsigned length, const int8_t* name, unsigned size)
+{
+  unsigned room = RecordedEventTextLength - length;
+  if (size > room) {
+    name += size - room;
+    size = room;
+  }
+
+  for (unsigned i = 0; i < size; ++i) {
+    text[length + i] = name[i] == '/' ? '.' : name[i];
+  }
+
+  return length + size;
+}
+
+void writeEvents(Machine* m, FILE* out)
+{
+  fprintf(out, "now %" LLD "\n", static_cast<int64_t>(m->system->nanoTime()));
+
+  for (EventBuffer* b = m->eventBuffers; b; b = b->next) {
+    if (b->count == 0) {
+      continue;
+    }
+
+    if (b->retired) {
+      fprintf(out,
+              "thread %u (disposed at %" LLD ")\n",
+              b->number,
+              static_cast<int64_t>(b->retired));
+    } else {
+      fprintf(out, "thread %u\n", b->number);
+    }
+
+    unsigned start = b->count > EventBufferCapacity
+                         ? b->count - EventBufferCapacity
+                         : 0;
+    for (unsigned i = start; i < b->count; ++i) {
+      RecordedEvent* e = b->events + (i & (EventBufferCapacity - 1));
+      fprintf(out,
+              "%" LLD " %s %u %" LLD " %.*s\n",
+              static_cast<int64_t>(e->time),
+              typeName(e->type),
+              e->value,
+              static_cast<int64_t>(e->data),
+              e->textLength,
+              e->text);
+    }
+  }
+}
+
+}  // namespace local
+
+}  // namespace
+
+namespace vm {
+
+void recordEvent(Thread* t,
+                 RecordedEventType type,
+                 uint32_t value,
+                 uint64_t data,
+                 GcByteArray* name,
+                 GcByteArray* memberName)
+{
+  EventBuffer* b = t->events;
+  if (b) {
+    RecordedEvent* e = b->events + (b->count & (EventBufferCapacity - 1));
+
+    unsigned length = 0;
+    if (name) {
+      length = local::append(
+          e->text, length, name->body().begin(), name->length() - 1);
+    }
+    if (memberName) {
+      if (length < RecordedEventTextLength) {
+        e->text[length++] = '.';
+      }
+      length = local::append(e->text,
+                             length,
+                             memberName->body().begin(),
+                             memberName->length() - 1);
+    }
+
+    e->time = t->m->system->nanoTime();
+    e->data = data;
+    e->value = value;
+    e->type = type;
+    e->textLength = length;
+
+    ++b->count;
+  }
+}
+
+void acquireEventBuffer(Thread* t)
+{
+  Machine* m = t->m;
+  if (not m->recordingEvents) {
+    return;
+  }
+
+  m->eventLock->acquire();
+
+  // reuse the buffer whose owner went away longest ago, if there is
+  // one, so memory use tracks the peak number of threads
+  EventBuffer* buffer = 0;
+  for (EventBuffer* b = m->eventBuffers; b; b = b->next) {
+    if (b->retired and (buffer == 0 or b->retired < buffer->retired)) {
+      buffer = b;
+    }
+  }
+
+  if (buffer) {
+    buffer->number = ++m->eventBufferCount;
+    buffer->count = 0;
+    buffer->retired = 0;
+  } else {
+    buffer = new (m->heap->allocate(sizeof(EventBuffer)))
+        EventBuffer(m->eventBuffers, ++m->eventBufferCount);
+    m->eventBuffers = buffer;
+  }
+
+  buffer->owner = t;
+
+  m->eventLock->release();
+
+  t->events = buffer;
+}
+
+void releaseEventBuffer(Thread* t)
+{
+  EventBuffer* b = t->events;
+  if (b) {
+    t->events = 0;
+
+    t->m->eventLock->acquire();
+
+    b->owner = 0;
+    b->retired = t->m->system->nanoTime();
+
+    t->m->eventLock->release();
+  }
+}
+
+void disposeEventBuffers(Machine* m)
+{
+  while (m->eventBuffers) {
+    EventBuffer* b = m->eventBuffers;
+    m->eventBuffers = b->next;
+    m->heap->free(b, sizeof(EventBuffer));
+  }
+}
+
+void dumpEvents(Thread* t, FILE* out)
+{
+  t->m->eventLock->acquire();
+
+  local::writeEvents(t->m, out);
+
+  t->m->eventLock->release();
+}
+
+void MachineAborter::abort()
+{
+  static bool aborting = false;
+
+  // don't take the event lock here, since we may be aborting while
+  // holding it
+  if (not aborting and m->eventBuffers) {
+    aborting = true;
+
+    const char* path = findProperty(m, EVENTS_CRASH_DUMP_PROPERTY);
+    if (path) {
+      FILE* out = vm::fopen(path, "wb");
+      if (out) {
+        local::writeEvents(m, out);
+        fclose(out);
+      }
+    }
+  }
+
+  m->system->abort();
+  ::abort();
+}
+
+}  // namespace vm
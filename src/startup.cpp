@@ -0,0 +1,237 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include "avian/jnienv.h"
+#include "avian/machine.h"
+#include "avian/processor.h"
+
+using namespace vm;
+
+namespace {
+
+namespace local {
+
+const char* phaseName(unsigned phase)
+{
+  switch (phase) {
+  case FinderStartupPhase:
+    return "finders";
+  case ProcessorStartupPhase:
+    return "processor";
+  case MachineStartupPhase:
+    return "machine";
+  case ThreadStartupPhase:
+    return "root thread";
+  case LzmaStartupPhase:
+    return "  boot image lzma";
+  case BootStartupPhase:
+    return "boot";
+  default:
+    abort();
+  }
+}
+
+double milliseconds(int64_t nanoseconds)
+{
+  return static_cast<double>(nanoseconds) / (1000 * 1000);
+}
+
+void write(Machine* m, StartupTrace* trace)
+{
+  FILE* out = trace->out;
+
+  fprintf(out,
+          "startup: %.3f ms to main\n",
+          milliseconds(m->system->nanoTime() - trace->start));
+
+  for (unsigned i = 0; i < StartupPhaseCount; ++i) {
+    fprintf(out,
+            "  %-20s %10.3f ms\n",
+            phaseName(i),
+            milliseconds(trace->phases[i]));
+  }
+
+  fprintf(out,
+          "  %-20s %10.3f ms in %u classes\n",
+          "class parsing",
+          milliseconds(trace->parseTime),
+          trace->parseCount);
+
+  fprintf(out,
+          "  %-20s %10.3f ms in %u classes\n",
+          "class initializers",
+          milliseconds(trace->initTime),
+          trace->initCount);
+
+  const Processor::CompileStatistics& compiled
+      = m->processor->compileStatistics();
+  fprintf(out,
+          "  %-20s %10.3f ms in %u methods\n",
+          "jit compilation",
+          milliseconds(compiled.time),
+          compiled.methods);
+
+  const Heap::Statistics& collected = m->heap->statistics();
+  fprintf(out,
+          "  %-20s %10.3f ms in %u collections\n",
+          "gc pauses",
+          static_cast<double>(collected.totalPauseTime),
+          collected.collections);
+
+  if (trace->slowestCount) {
+    fprintf(out, "slowest class initializers:\n");
+
+    for (unsigned i = 0; i < trace->slowestCount; ++i) {
+      StartupTraceInitializer* e = trace->slowest + i;
+      fprintf(out,
+              "  %10.3f ms %.*s\n",
+              milliseconds(e->time),
+              e->nameLength,
+              e->name);
+    }
+  }
+
+  fflush(out);
+}
+
+void report(Machine* m)
+{
+  StartupTrace* trace = m->startupTrace;
+
+  trace->lock->acquire();
+
+  if (not trace->reported) {
+    trace->reported = true;
+    write(m, trace);
+  }
+
+  trace->lock->release();
+}
+
+}  // namespace local
+
+}  // namespace
+
+namespace vm {
+
+void startStartupTrace(Machine* m, int64_t start)
+{
+  const char* trace = findProperty(m, STARTUP_TRACE_PROPERTY);
+  if (trace == 0 or ::strcmp(trace, "false") == 0) {
+    return;
+  }
+
+  FILE* out;
+  if (::strcmp(trace, "true") == 0) {
+    out = stderr;
+  } else {
+    out = vm::fopen(trace, "wb");
+    if (out == 0) {
+      return;
+    }
+  }
+
+  System::Mutex* lock;
+  expect(m->system, m->system->success(m->system->make(&lock)));
+
+  m->startupTrace = new (m->heap->allocate(sizeof(StartupTrace)))
+      StartupTrace(lock, out, start);
+}
+
+void recordStartupPhase(Machine* m, StartupPhase phase, int64_t time)
+{
+  StartupTrace* trace = m->startupTrace;
+  if (trace) {
+    trace->phases[phase] += time;
+  }
+}
+
+void recordClassParse(Thread* t, int64_t time)
+{
+  StartupTrace* trace = t->m->startupTrace;
+
+  trace->lock->acquire();
+
+  if (not trace->reported) {
+    trace->parseTime += time;
+    ++trace->parseCount;
+  }
+
+  trace->lock->release();
+}
+
+void recordClassInit(Thread* t, GcClass* c, int64_t time, bool outermost)
+{
+  StartupTrace* trace = t->m->startupTrace;
+
+  trace->lock->acquire();
+
+  if (not trace->reported) {
+    ++trace->initCount;
+    if (outermost) {
+      trace->initTime += time;
+    }
+
+    unsigned i = trace->slowestCount;
+    while (i and trace->slowest[i - 1].time < time) {
+      --i;
+    }
+
+    if (i < StartupTraceInitializerCount) {
+      if (trace->slowestCount < StartupTraceInitializerCount) {
+        ++trace->slowestCount;
+      }
+
+      memmove(trace->slowest + i + 1,
+              trace->slowest + i,
+              (trace->slowestCount - i - 1) * sizeof(StartupTraceInitializer));
+
+      StartupTraceInitializer* e = trace->slowest + i;
+      // keep the end of the name, as the recorder does, since that's
+      // the part which tells classes apart
+      GcByteArray* name = c->name();
+      unsigned size = name->length() - 1;
+      unsigned length = min(size, RecordedEventTextLength);
+      for (unsigned j = 0; j < length; ++j) {
+        int8_t b = name->body()[size - length + j];
+        e->name[j] = b == '/' ? '.' : b;
+      }
+      e->nameLength = length;
+      e->time = time;
+    }
+  }
+
+  trace->lock->release();
+}
+
+void reportStartup(Thread* t)
+{
+  if (t->m->startupTrace) {
+    local::report(t->m);
+  }
+}
+
+void disposeStartupTrace(Machine* m)
+{
+  StartupTrace* trace = m->startupTrace;
+  if (trace) {
+    // report what we have if the launcher never got as far as main
+    local::report(m);
+
+    if (trace->out != stderr) {
+      fclose(trace->out);
+    }
+    trace->lock->dispose();
+    m->heap->free(trace, sizeof(StartupTrace));
+    m->startupTrace = 0;
+  }
+}
+
+}  // namespace vm
@@ -16,6 +16,7 @@
 #ifdef __APPLE__
 #include "CoreFoundation/CoreFoundation.h"
 #include "sys/ucontext.h"
+#include "mach/mach_time.h"
 #undef assert
 #elif defined(__ANDROID__)
 #include <asm/sigcontext.h> /* for sigcontext */
@@ -49,6 +50,11 @@ typedef struct ucontext {
 #include "dirent.h"
 #include "sched.h"
 
+#ifdef __linux__
+#include "sys/syscall.h"
+#include "linux/futex.h"
+#endif
+
 #include <avian/arch.h>
 #include <avian/append.h>
 
@@ -129,14 +135,167 @@ const bool Verbose = false;
 
 const unsigned Notified = 1 << 0;
 
+// states of the permit word used by Thread::park and Thread::unpark:
+const uint32_t NoPermit = 0;
+const uint32_t Permit = 1;
+const uint32_t Parked = 2;
+
+// pretend anything greater than one million years (in milliseconds)
+// is infinity so as to avoid overflow:
+const int64_t MaximumWait = INT64_C(31536000000000000);
+
+// Timed waits on conditions made here run on the monotonic clock, so
+// setting the time of day doesn't cut them short or stretch them out.
+// Apple's pthreads lack pthread_condattr_setclock, so there we make do
+// with the time of day.
+void initCondition(pthread_cond_t* condition)
+{
+#ifdef __APPLE__
+  pthread_cond_init(condition, 0);
+#else
+  pthread_condattr_t attributes;
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(condition, &attributes);
+  pthread_condattr_destroy(&attributes);
+#endif
+}
+
+// fills in the time, on the clock used by initCondition, which is the
+// specified number of milliseconds from now
+void deadline(int64_t milliseconds, timespec* ts)
+{
+#ifdef __APPLE__
+  timeval tv = {0, 0};
+  gettimeofday(&tv, 0);
+  ts->tv_sec = tv.tv_sec;
+  ts->tv_nsec = tv.tv_usec * 1000;
+#else
+  clock_gettime(CLOCK_MONOTONIC, ts);
+#endif
+  int64_t nanoseconds = ts->tv_nsec + ((milliseconds % 1000) * 1000 * 1000);
+  ts->tv_sec += (milliseconds / 1000) + (nanoseconds / (1000 * 1000 * 1000));
+  ts->tv_nsec = nanoseconds % (1000 * 1000 * 1000);
+}
+
+#ifdef __linux__
+// reads the first line of a short file, such as a cgroup control
+// file, into buffer without its trailing newline
+bool readLine(const char* path, char* buffer, unsigned size)
+{
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  ssize_t r = ::read(fd, buffer, size - 1);
+  ::close(fd);
+  if (r <= 0) {
+    return false;
+  }
+
+  buffer[r] = 0;
+  for (char* p = buffer; *p; ++p) {
+    if (*p == '\n') {
+      *p = 0;
+      break;
+    }
+  }
+  return true;
+}
+
+// parses a non-negative decimal number from the start of s, returning
+// false if there is none (e.g. s is "max" or "-1")
+bool parseNumber(const char* s, uint64_t* value, const char** end = 0)
+{
+  if (*s < '0' or *s > '9') {
+    return false;
+  }
+
+  uint64_t v = 0;
+  for (; *s >= '0' and *s <= '9'; ++s) {
+    v = (v * 10) + (*s - '0');
+  }
+
+  *value = v;
+  if (end) {
+    *end = s;
+  }
+  return true;
+}
+
+// the memory limit of our cgroup under cgroup v2 or v1, or zero if
+// there is none.  Under v1, an unlimited group reports a huge number,
+// so we ignore anything at least as large as physical memory.
+uint64_t cgroupMemoryLimit()
+{
+  char buffer[64];
+  uint64_t limit;
+  if (not((readLine("/sys/fs/cgroup/memory.max", buffer, sizeof(buffer))
+           or readLine("/sys/fs/cgroup/memory/memory.limit_in_bytes",
+                       buffer,
+                       sizeof(buffer)))
+          and parseNumber(buffer, &limit))) {
+    return 0;
+  }
+
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if (pages > 0 and pageSize > 0
+      and limit >= static_cast<uint64_t>(pages) * pageSize) {
+    return 0;
+  }
+
+  return limit;
+}
+
+// the number of processors our cgroup's CPU quota amounts to, rounded
+// up, or zero if there is no quota
+unsigned cgroupProcessorCount()
+{
+  char buffer[64];
+  uint64_t quota;
+  uint64_t period;
+  const char* end;
+  if (readLine("/sys/fs/cgroup/cpu.max", buffer, sizeof(buffer))) {
+    // "<quota> <period>", where the quota may be "max"
+    if (not(parseNumber(buffer, &quota, &end) and *end == ' '
+            and parseNumber(end + 1, &period))) {
+      return 0;
+    }
+  } else {
+    char periodBuffer[64];
+    if (not(readLine(
+                "/sys/fs/cgroup/cpu/cpu.cfs_quota_us", buffer, sizeof(buffer))
+            and readLine("/sys/fs/cgroup/cpu/cpu.cfs_period_us",
+                         periodBuffer,
+                         sizeof(periodBuffer))
+            and parseNumber(buffer, &quota)
+            and parseNumber(periodBuffer, &period))) {
+      return 0;
+    }
+  }
+
+  if (quota == 0 or period == 0) {
+    return 0;
+  }
+
+  return (quota + period - 1) / period;
+}
+#endif  // __linux__
+
 class MySystem : public System {
  public:
   class Thread : public System::Thread {
    public:
-    Thread(System* s, System::Runnable* r) : s(s), r(r), next(0), flags(0)
+    Thread(System* s, System::Runnable* r)
+        : s(s), r(r), next(0), flags(0), permit(NoPermit)
     {
       pthread_mutex_init(&mutex, 0);
-      pthread_cond_init(&condition, 0);
+      initCondition(&condition);
+#ifndef __linux__
+      initCondition(&parkCondition);
+#endif
     }
 
     virtual void interrupt()
@@ -165,6 +324,98 @@ class MySystem : public System {
       return interrupted;
     }
 
+    virtual bool tryPark()
+    {
+      return atomicCompareAndSwap32(&permit, Permit, NoPermit);
+    }
+
+    virtual void park(int64_t time)
+    {
+      if (not atomicCompareAndSwap32(&permit, NoPermit, Parked)) {
+        // unpark has already granted us a permit, so consume it
+        // without waiting:
+        bool consumed UNUSED = tryPark();
+        expect(s, consumed);
+        return;
+      }
+
+#ifdef __linux__
+      // counting in nanoseconds overflows sooner, so here anything
+      // more than a hundred years counts as infinity:
+      int64_t then = (time and time < MaximumWait / 10000)
+                         ? s->nanoTime() + (time * 1000 * 1000)
+                         : 0;
+
+      while (permit == Parked) {
+        timespec ts;
+        timespec* timeout = 0;
+        if (then) {
+          int64_t remaining = then - s->nanoTime();
+          if (remaining <= 0) {
+            break;
+          }
+          ts.tv_sec = remaining / (1000 * 1000 * 1000);
+          ts.tv_nsec = remaining % (1000 * 1000 * 1000);
+          timeout = &ts;
+        }
+
+        // this returns immediately if unpark has changed the permit
+        // since we checked it above:
+        syscall(SYS_futex, &permit, FUTEX_WAIT_PRIVATE, Parked, timeout, 0, 0);
+      }
+#else
+      {
+        timespec ts;
+        bool timed = time and time < MaximumWait;
+        if (timed) {
+          deadline(time, &ts);
+        }
+
+        ACQUIRE(mutex);
+
+        while (permit == Parked) {
+          if (timed) {
+            int rv = pthread_cond_timedwait(&parkCondition, &mutex, &ts);
+            expect(s, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
+            if (rv == ETIMEDOUT) {
+              break;
+            }
+          } else {
+            int rv UNUSED = pthread_cond_wait(&parkCondition, &mutex);
+            expect(s, rv == 0 or rv == EINTR);
+          }
+        }
+      }
+#endif
+
+      // consume the permit if unpark granted one, or else withdraw
+      // from the Parked state so the next unpark won't try to wake us:
+      permit = NoPermit;
+      storeLoadMemoryBarrier();
+    }
+
+    virtual void unpark()
+    {
+      uint32_t old;
+      do {
+        old = permit;
+        if (old == Permit) {
+          return;
+        }
+      } while (not atomicCompareAndSwap32(&permit, old, Permit));
+
+      // only enter the kernel if the thread is actually waiting:
+      if (old == Parked) {
+#ifdef __linux__
+        syscall(SYS_futex, &permit, FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+#else
+        ACQUIRE(mutex);
+        int rv UNUSED = pthread_cond_signal(&parkCondition);
+        expect(s, rv == 0);
+#endif
+      }
+    }
+
     virtual void join()
     {
       int rv UNUSED = pthread_join(thread, 0);
@@ -175,16 +426,23 @@ class MySystem : public System {
     {
       pthread_mutex_destroy(&mutex);
       pthread_cond_destroy(&condition);
+#ifndef __linux__
+      pthread_cond_destroy(&parkCondition);
+#endif
       ::free(this);
     }
 
     pthread_t thread;
     pthread_mutex_t mutex;
     pthread_cond_t condition;
+#ifndef __linux__
+    pthread_cond_t parkCondition;
+#endif
     System* s;
     System::Runnable* r;
     Thread* next;
     unsigned flags;
+    uint32_t permit;
   };
 
   class Mutex : public System::Mutex {
@@ -356,12 +614,9 @@ class MySystem : public System {
           pthread_mutex_unlock(&mutex);
 
           if (not interrupted) {
-            // pretend anything greater than one million years (in
-            // milliseconds) is infinity so as to avoid overflow:
-            if (time and time < INT64_C(31536000000000000)) {
-              int64_t then = s->now() + time;
-              timespec ts = {static_cast<long>(then / 1000),
-                             static_cast<long>((then % 1000) * 1000 * 1000)};
+            if (time and time < MaximumWait) {
+              timespec ts;
+              deadline(time, &ts);
               int rv UNUSED
                   = pthread_cond_timedwait(&(t->condition), &(t->mutex), &ts);
               expect(s, rv == 0 or rv == ETIMEDOUT or rv == EINTR);
@@ -679,12 +934,30 @@ class MySystem : public System {
     return 0;
   }
 
-  virtual Status start(Runnable* r)
+  virtual Status start(Runnable* r, unsigned stackSizeInBytes)
   {
     Thread* t = new (allocate(this, sizeof(Thread))) Thread(this, r);
     r->attach(t);
-    int rv UNUSED = pthread_create(&(t->thread), 0, run, r);
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    if (stackSizeInBytes) {
+      // the C library maps the stack with a guard page below it and
+      // leaves it to the kernel to commit pages as they are touched,
+      // so a generous size costs address space, not memory
+      long pageSize = sysconf(_SC_PAGESIZE);
+      size_t size = ((stackSizeInBytes + pageSize - 1) / pageSize) * pageSize;
+      if (size < static_cast<size_t>(PTHREAD_STACK_MIN)) {
+        size = PTHREAD_STACK_MIN;
+      }
+      int rv UNUSED = pthread_attr_setstacksize(&attributes, size);
+      expect(this, rv == 0);
+    }
+
+    int rv UNUSED = pthread_create(&(t->thread), &attributes, run, r);
     expect(this, rv == 0);
+
+    pthread_attr_destroy(&attributes);
     return 0;
   }
 
@@ -925,11 +1198,67 @@ class MySystem : public System {
            + (static_cast<int64_t>(tv.tv_usec) / 1000);
   }
 
+  virtual int64_t nanoTime()
+  {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+      mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000)
+           + ts.tv_nsec;
+#endif
+  }
+
+  virtual int64_t coarseNanoTime()
+  {
+#ifdef CLOCK_MONOTONIC_COARSE
+    // this reads the time of the last tick instead of the hardware
+    // counter, which spares us the counter read and its scaling
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000)
+           + ts.tv_nsec;
+#else
+    return nanoTime();
+#endif
+  }
+
   virtual void yield()
   {
     sched_yield();
   }
 
+  virtual unsigned processorCount()
+  {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count <= 0) {
+      count = 1;
+    }
+#ifdef __linux__
+    // a container's CPU quota may allow us fewer processors than the
+    // host has
+    unsigned quota = cgroupProcessorCount();
+    if (quota and static_cast<long>(quota) < count) {
+      count = quota;
+    }
+#endif
+    return count;
+  }
+
+  virtual uint64_t memoryLimit()
+  {
+#ifdef __linux__
+    return cgroupMemoryLimit();
+#else
+    return 0;
+#endif
+  }
+
   virtual void exit(int code)
   {
     ::exit(code);
@@ -14,36 +14,96 @@
 
 #include "sys/mman.h"
 
+#ifdef __linux__
+#include "sys/syscall.h"
+#include "fcntl.h"
+#include "string.h"
+#include "unistd.h"
+#endif
+
 namespace avian {
 namespace system {
 
 const size_t Memory::PageSize = 1 << 12;
+const size_t Memory::LargePageSize = 1 << 21;
 
-util::Slice<uint8_t> Memory::allocate(size_t sizeInBytes,
-                               Permissions perms)
+namespace {
+
+unsigned protection(Memory::Permissions perms)
 {
   unsigned prot = 0;
-  if(perms & Read) {
+  if(perms & Memory::Read) {
     prot |= PROT_READ;
   }
-  if(perms & Write) {
+  if(perms & Memory::Write) {
     prot |= PROT_WRITE;
   }
-  if(perms & Execute) {
+  if(perms & Memory::Execute) {
     prot |= PROT_EXEC;
   }
+  return prot;
+}
+
+unsigned extraFlags(Memory::Permissions perms)
+{
 #ifdef MAP_32BIT
-  // map to the lower 32 bits of memory when possible so as to avoid
-  // expensive relative jumps
-  const unsigned Extra = MAP_32BIT;
+  // map code to the lower 32 bits of memory when possible so as to
+  // avoid expensive relative jumps
+  return (perms & Memory::Execute) ? MAP_32BIT : 0;
+#else
+  (void) perms;
+  return 0;
+#endif
+}
+
+#ifdef __linux__
+// from linux/mempolicy.h, which not every toolchain provides
+const int PreferredPolicy = 1;
+const unsigned MoveFlag = 1 << 1;
+
+// whether more than one NUMA node is online, found the first time
+// we're asked, after which a racing caller at worst looks again
+bool multipleNodes()
+{
+  static int multiple = -1;
+
+  if (multiple < 0) {
+    bool found = false;
+    int fd = open("/sys/devices/system/node/online", O_RDONLY);
+    if (fd >= 0) {
+      char buffer[64];
+      ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+      if (length > 0) {
+        buffer[length] = 0;
+        found = strchr(buffer, '-') or strchr(buffer, ',');
+      }
+      close(fd);
+    }
+    multiple = found;
+  }
+
+  return multiple;
+}
+#endif
+
+unsigned reserveFlags()
+{
+#ifdef MAP_NORESERVE
+  return MAP_NORESERVE;
 #else
-  const unsigned Extra = 0;
+  return 0;
 #endif
+}
+
+}  // namespace
 
+util::Slice<uint8_t> Memory::allocate(size_t sizeInBytes,
+                               Permissions perms)
+{
   void* p = mmap(0,
                  sizeInBytes,
-                 prot,
-                 MAP_PRIVATE | MAP_ANON | Extra,
+                 protection(perms),
+                 MAP_PRIVATE | MAP_ANON | extraFlags(perms),
                  -1,
                  0);
 
@@ -54,10 +114,102 @@ util::Slice<uint8_t> Memory::allocate(size_t sizeInBytes,
   }
 }
 
+util::Slice<uint8_t> Memory::allocateLarge(size_t sizeInBytes,
+                                           Permissions perms)
+{
+  sizeInBytes = (sizeInBytes + LargePageSize - 1) & ~(LargePageSize - 1);
+
+#ifdef MAP_HUGETLB
+  // explicit huge pages only exist if the administrator has reserved
+  // some, so this usually fails unless the system is set up for it
+  void* p = mmap(0,
+                 sizeInBytes,
+                 protection(perms),
+                 MAP_PRIVATE | MAP_ANON | MAP_HUGETLB | extraFlags(perms),
+                 -1,
+                 0);
+
+  if (p != MAP_FAILED) {
+    return util::Slice<uint8_t>(static_cast<uint8_t*>(p), sizeInBytes);
+  }
+#endif
+
+  util::Slice<uint8_t> pages = allocate(sizeInBytes, perms);
+
+#ifdef MADV_HUGEPAGE
+  // otherwise, let transparent huge pages back what they can
+  if (pages.begin()) {
+    madvise(const_cast<uint8_t*>(pages.begin()), pages.count, MADV_HUGEPAGE);
+  }
+#endif
+
+  return pages;
+}
+
+util::Slice<uint8_t> Memory::reserve(size_t sizeInBytes, Permissions perms)
+{
+  void* p = mmap(0,
+                 sizeInBytes,
+                 PROT_NONE,
+                 MAP_PRIVATE | MAP_ANON | reserveFlags() | extraFlags(perms),
+                 -1,
+                 0);
+
+  if (p == MAP_FAILED) {
+    return util::Slice<uint8_t>(0, 0);
+  } else {
+    return util::Slice<uint8_t>(static_cast<uint8_t*>(p), sizeInBytes);
+  }
+}
+
+bool Memory::commit(util::Slice<uint8_t> pages, Permissions perms)
+{
+  return mprotect(const_cast<uint8_t*>(pages.begin()),
+                  pages.count,
+                  protection(perms)) == 0;
+}
+
 void Memory::free(util::Slice<uint8_t> pages)
 {
   munmap(const_cast<uint8_t*>(pages.begin()), pages.count);
 }
 
+void Memory::release(util::Slice<uint8_t> pages)
+{
+  madvise(const_cast<uint8_t*>(pages.begin()), pages.count, MADV_DONTNEED);
+}
+
+void Memory::placeLocally(util::Slice<uint8_t> range)
+{
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+  uintptr_t start = (reinterpret_cast<uintptr_t>(range.begin()) + PageSize - 1)
+                    & ~(PageSize - 1);
+  uintptr_t end = (reinterpret_cast<uintptr_t>(range.begin()) + range.count)
+                  & ~(PageSize - 1);
+  if (start >= end or not multipleNodes()) {
+    return;
+  }
+
+  unsigned cpu;
+  unsigned node;
+  if (syscall(SYS_getcpu, &cpu, &node, 0) != 0
+      or node >= sizeof(unsigned long) * 8) {
+    return;
+  }
+
+  // the kernel reads one bit fewer than it is told to
+  unsigned long mask = 1UL << node;
+  syscall(SYS_mbind,
+          start,
+          end - start,
+          PreferredPolicy,
+          &mask,
+          sizeof(mask) * 8 + 1,
+          MoveFlag);
+#else
+  (void) range;
+#endif
+}
+
 }  // namespace system
 }  // namespace avian
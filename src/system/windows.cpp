@@ -89,6 +89,10 @@ BOOL WINAPI UnmapViewOfFile(_In_ LPCVOID lpBaseAddress);
 
 #endif
 
+#ifndef STACK_SIZE_PARAM_IS_A_RESERVATION
+#define STACK_SIZE_PARAM_IS_A_RESERVATION 0x00010000
+#endif
+
 #define ACQUIRE(s, x) MutexResource MAKE_NAME(mutexResource_)(s, x)
 
 using namespace vm;
@@ -128,17 +132,38 @@ const bool Verbose = false;
 const unsigned Waiting = 1 << 0;
 const unsigned Notified = 1 << 1;
 
+// states of the permit word used by Thread::park and Thread::unpark:
+const uint32_t NoPermit = 0;
+const uint32_t Permit = 1;
+const uint32_t Parked = 2;
+
+// WaitOnAddress and WakeByAddressSingle are only available on Windows
+// 8 and later, so we look them up at runtime:
+typedef BOOL(WINAPI* WaitOnAddressType)(volatile VOID*, PVOID, SIZE_T, DWORD);
+typedef VOID(WINAPI* WakeByAddressSingleType)(PVOID);
+
+// the time on the system's monotonic clock, in milliseconds, for
+// timed waits
+inline int64_t milliseconds(System* s)
+{
+  return s->nanoTime() / (1000 * 1000);
+}
+
 class MySystem : public System {
  public:
   class Thread : public System::Thread {
    public:
-    Thread(System* s, System::Runnable* r) : s(s), r(r), next(0), flags(0)
+    Thread(System* s, System::Runnable* r)
+        : s(s), r(r), next(0), flags(0), permit(NoPermit)
     {
       mutex = CreateMutex(0, false, 0);
       assertT(s, mutex);
 
       event = CreateEvent(0, true, false, 0);
       assertT(s, event);
+
+      parkEvent = CreateEvent(0, false, false, 0);
+      assertT(s, parkEvent);
     }
 
     virtual void interrupt()
@@ -164,6 +189,74 @@ class MySystem : public System {
       return interrupted;
     }
 
+    virtual bool tryPark()
+    {
+      return atomicCompareAndSwap32(&permit, Permit, NoPermit);
+    }
+
+    virtual void park(int64_t time)
+    {
+      if (not atomicCompareAndSwap32(&permit, NoPermit, Parked)) {
+        // unpark has already granted us a permit, so consume it
+        // without waiting:
+        bool consumed UNUSED = tryPark();
+        assertT(s, consumed);
+        return;
+      }
+
+      MySystem* system = static_cast<MySystem*>(s);
+      int64_t then = time ? milliseconds(s) + time : 0;
+
+      while (permit == Parked) {
+        DWORD wait = INFINITE;
+        if (then) {
+          int64_t remaining = then - milliseconds(s);
+          if (remaining <= 0) {
+            break;
+          } else if (remaining < INFINITE) {
+            wait = static_cast<DWORD>(remaining);
+          }
+        }
+
+        if (system->waitOnAddress) {
+          // this returns immediately if unpark has changed the permit
+          // since we checked it above:
+          uint32_t parked = Parked;
+          system->waitOnAddress(&permit, &parked, sizeof(permit), wait);
+        } else {
+          int r UNUSED = WaitForSingleObject(parkEvent, wait);
+          assertT(s, r == WAIT_OBJECT_0 or r == WAIT_TIMEOUT);
+        }
+      }
+
+      // consume the permit if unpark granted one, or else withdraw
+      // from the Parked state so the next unpark won't try to wake us:
+      permit = NoPermit;
+      storeLoadMemoryBarrier();
+    }
+
+    virtual void unpark()
+    {
+      uint32_t old;
+      do {
+        old = permit;
+        if (old == Permit) {
+          return;
+        }
+      } while (not atomicCompareAndSwap32(&permit, old, Permit));
+
+      // only enter the kernel if the thread is actually waiting:
+      if (old == Parked) {
+        MySystem* system = static_cast<MySystem*>(s);
+        if (system->wakeByAddressSingle) {
+          system->wakeByAddressSingle(&permit);
+        } else {
+          int r UNUSED = SetEvent(parkEvent);
+          assertT(s, r != 0);
+        }
+      }
+    }
+
     virtual void join()
     {
       int r UNUSED = WaitForSingleObject(thread, INFINITE);
@@ -172,6 +265,7 @@ class MySystem : public System {
 
     virtual void dispose()
     {
+      CloseHandle(parkEvent);
       CloseHandle(event);
       CloseHandle(mutex);
       CloseHandle(thread);
@@ -181,10 +275,12 @@ class MySystem : public System {
     HANDLE thread;
     HANDLE mutex;
     HANDLE event;
+    HANDLE parkEvent;
     System* s;
     System::Runnable* r;
     Thread* next;
     unsigned flags;
+    uint32_t permit;
   };
 
   class Mutex : public System::Mutex {
@@ -655,7 +751,8 @@ class MySystem : public System {
     System::Library* next_;
   };
 
-  MySystem(bool reentrant): reentrant(reentrant)
+  MySystem(bool reentrant)
+      : waitOnAddress(0), wakeByAddressSingle(0), reentrant(reentrant)
   {
     if (not reentrant) {
       expect(this, globalSystem == 0);
@@ -664,6 +761,20 @@ class MySystem : public System {
 
     mutex = CreateMutex(0, false, 0);
     assertT(this, mutex);
+
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    HMODULE kernel = GetModuleHandleW(L"kernelbase.dll");
+    if (kernel) {
+      waitOnAddress = reinterpret_cast<WaitOnAddressType>(
+          GetProcAddress(kernel, "WaitOnAddress"));
+      wakeByAddressSingle = reinterpret_cast<WakeByAddressSingleType>(
+          GetProcAddress(kernel, "WakeByAddressSingle"));
+      if (waitOnAddress == 0 or wakeByAddressSingle == 0) {
+        waitOnAddress = 0;
+        wakeByAddressSingle = 0;
+      }
+    }
+#endif
   }
 
   virtual void* tryAllocate(size_t sizeInBytes)
@@ -696,12 +807,21 @@ class MySystem : public System {
     return 0;
   }
 
-  virtual Status start(Runnable* r)
+  virtual Status start(Runnable* r, unsigned stackSizeInBytes)
   {
     Thread* t = new (allocate(this, sizeof(Thread))) Thread(this, r);
     r->attach(t);
     DWORD id;
-    t->thread = CreateThread(0, 0, run, r, 0, &id);
+    // reserve the requested size but let the system commit it a page
+    // at a time, behind a guard page, as the stack grows
+    t->thread = CreateThread(0,
+                             stackSizeInBytes,
+                             run,
+                             r,
+                             stackSizeInBytes
+                                 ? STACK_SIZE_PARAM_IS_A_RESERVATION
+                                 : 0,
+                             &id);
     assertT(this, t->thread);
     return 0;
   }
@@ -988,6 +1108,29 @@ class MySystem : public System {
              | time.dwLowDateTime) / 10000) - 11644473600000LL;
   }
 
+  virtual int64_t nanoTime()
+  {
+    // the frequency is fixed at boot, so we only need to ask once
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) {
+      QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    // split the conversion so the multiplication can't overflow
+    int64_t seconds = counter.QuadPart / frequency.QuadPart;
+    int64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return (seconds * 1000 * 1000 * 1000)
+           + (remainder * 1000 * 1000 * 1000 / frequency.QuadPart);
+  }
+
+  virtual int64_t coarseNanoTime()
+  {
+    // QueryPerformanceCounter is cheap enough on the systems we
+    // support that a coarser clock wouldn't buy us anything
+    return nanoTime();
+  }
+
   virtual void yield()
   {
 #if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
@@ -997,6 +1140,22 @@ class MySystem : public System {
 #endif
   }
 
+  virtual unsigned processorCount()
+  {
+    SYSTEM_INFO info;
+#if !defined(WINAPI_FAMILY) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    GetSystemInfo(&info);
+#else
+    GetNativeSystemInfo(&info);
+#endif
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+  }
+
+  virtual uint64_t memoryLimit()
+  {
+    return 0;
+  }
+
   virtual void exit(int code)
   {
     ::exit(code);
@@ -1018,6 +1177,8 @@ class MySystem : public System {
   }
 
   HANDLE mutex;
+  WaitOnAddressType waitOnAddress;
+  WakeByAddressSingleType wakeByAddressSingle;
   bool reentrant;
 };
 
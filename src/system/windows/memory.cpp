@@ -18,32 +18,75 @@ namespace avian {
 namespace system {
 
 const size_t Memory::PageSize = 1 << 12;
+const size_t Memory::LargePageSize = 1 << 21;
 
-util::Slice<uint8_t> Memory::allocate(size_t sizeInBytes,
-                               Permissions perms)
+namespace {
+
+unsigned protection(Memory::Permissions perms)
 {
   unsigned prot;
   switch(perms) {
-  case Read:
+  case Memory::Read:
     prot = PAGE_READONLY;
     break;
-  case ReadWrite:
+  case Memory::ReadWrite:
     prot = PAGE_READWRITE;
     break;
-  case ReadExecute:
+  case Memory::ReadExecute:
     prot = PAGE_EXECUTE_READ;
     break;
-  case ReadWriteExecute:
+  case Memory::ReadWriteExecute:
     prot = PAGE_EXECUTE_READWRITE;
     break;
   default:
     UNREACHABLE_;
   }
+  return prot;
+}
+
+}  // namespace
+
+util::Slice<uint8_t> Memory::allocate(size_t sizeInBytes,
+                               Permissions perms)
+{
   void* ret = VirtualAlloc(
-      0, sizeInBytes, MEM_COMMIT | MEM_RESERVE, prot);
+      0, sizeInBytes, MEM_COMMIT | MEM_RESERVE, protection(perms));
   return util::Slice<uint8_t>((uint8_t*)ret, sizeInBytes);
 }
 
+util::Slice<uint8_t> Memory::allocateLarge(size_t sizeInBytes,
+                                           Permissions perms)
+{
+  sizeInBytes = (sizeInBytes + LargePageSize - 1) & ~(LargePageSize - 1);
+
+  // this only succeeds if the process holds SeLockMemoryPrivilege and
+  // has enabled it, so fall back to ordinary pages otherwise
+  size_t minimum = GetLargePageMinimum();
+  if (minimum and LargePageSize % minimum == 0) {
+    void* ret = VirtualAlloc(0,
+                             sizeInBytes,
+                             MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES,
+                             protection(perms));
+    if (ret) {
+      return util::Slice<uint8_t>((uint8_t*)ret, sizeInBytes);
+    }
+  }
+
+  return allocate(sizeInBytes, perms);
+}
+
+util::Slice<uint8_t> Memory::reserve(size_t sizeInBytes, Permissions)
+{
+  void* ret = VirtualAlloc(0, sizeInBytes, MEM_RESERVE, PAGE_NOACCESS);
+  return util::Slice<uint8_t>((uint8_t*)ret, ret ? sizeInBytes : 0);
+}
+
+bool Memory::commit(util::Slice<uint8_t> pages, Permissions perms)
+{
+  return VirtualAlloc(
+             pages.begin(), pages.count, MEM_COMMIT, protection(perms)) != 0;
+}
+
 void Memory::free(util::Slice<uint8_t> pages)
 {
   int r = VirtualFree(pages.begin(), 0, MEM_RELEASE);
@@ -51,5 +94,16 @@ void Memory::free(util::Slice<uint8_t> pages)
   ASSERT(r);
 }
 
+void Memory::release(util::Slice<uint8_t> pages)
+{
+  void* r = VirtualAlloc(pages.begin(), pages.count, MEM_RESET, PAGE_READWRITE);
+  (void) r;
+  ASSERT(r);
+}
+
+void Memory::placeLocally(util::Slice<uint8_t>)
+{
+}
+
 }  // namespace system
 }  // namespace avian
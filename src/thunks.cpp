@@ -1,9 +1,12 @@
 THUNK(tryInitClass)
+THUNK(skipInitClass)
 THUNK(findInterfaceMethodFromInstance)
 THUNK(findInterfaceMethodFromInstanceAndReference)
 THUNK(findSpecialMethodFromReference)
 THUNK(findStaticMethodFromReference)
 THUNK(findVirtualMethodFromReference)
+THUNK(findInterfaceMethodFromCache)
+THUNK(findVirtualMethodFromCache)
 THUNK(getMethodAddress)
 THUNK(compareDoublesG)
 THUNK(compareDoublesL)
@@ -29,6 +32,10 @@ THUNK(negateFloat)
 THUNK(absoluteFloat)
 THUNK(absoluteLong)
 THUNK(absoluteInt)
+THUNK(popCountLong)
+THUNK(popCountInt)
+THUNK(countLeadingZerosLong)
+THUNK(countLeadingZerosInt)
 THUNK(divideLong)
 THUNK(divideInt)
 THUNK(moduloLong)
@@ -43,8 +50,11 @@ THUNK(longToFloat)
 THUNK(makeBlankObjectArray)
 THUNK(makeBlankObjectArrayFromReference)
 THUNK(makeBlankArray)
+THUNK(makeBlankArrayOfClass)
 THUNK(lookUpAddress)
 THUNK(setMaybeNull)
+THUNK(getWideVolatile)
+THUNK(setWideVolatile)
 THUNK(acquireMonitorForObject)
 THUNK(acquireMonitorForObjectOnEntrance)
 THUNK(releaseMonitorForObject)
@@ -64,9 +74,12 @@ THUNK(setLongFieldValueFromReference)
 THUNK(setStaticObjectFieldValueFromReference)
 THUNK(setObjectFieldValueFromReference)
 THUNK(instanceOf64)
+THUNK(copyArray)
+THUNK(stringEquals)
 THUNK(instanceOfFromReference)
 THUNK(makeNewGeneral64)
 THUNK(makeNew64)
+THUNK(makeNewOfSize)
 THUNK(makeNewFromReference)
 THUNK(setObject)
 THUNK(getJClass64)
@@ -12,6 +12,7 @@
 #include "avian/heapwalk.h"
 #include "avian/common.h"
 #include "avian/machine.h"
+#include "avian/process.h"
 #include "avian/util.h"
 #include <avian/util/stream.h>
 #include <avian/codegen/assembler.h>
@@ -49,6 +50,15 @@ const unsigned TargetFixieSize = 4;
 
 const bool DebugNativeTarget = false;
 
+// the page size to align the heap to with -page-align-heap, which must
+// be at least that of any system the image may run on
+#if (AVIAN_TARGET_FORMAT == AVIAN_FORMAT_MACHO) \
+    && (AVIAN_TARGET_ARCH == AVIAN_ARCH_ARM64)
+const unsigned TargetPageSize = 16 * 1024;
+#else
+const unsigned TargetPageSize = 4 * 1024;
+#endif
+
 enum Type {
   Type_none,
   Type_object,
@@ -643,6 +653,334 @@ void addClass(Thread* t,
   }
 }
 
+// Finds the methods that code starting from a set of entry points may
+// call.  A method is reachable if it's an entry point, if a reachable
+// method invokes it directly, if it's the static initializer of a class
+// a reachable method uses, or if it's a virtual method with the same
+// name and spec as one a reachable method invokes virtually.  The last
+// rule stands in for knowing which classes are instantiated, and errs
+// on the side of keeping methods.  Methods of classes in the image
+// which turn out to be unreachable are left uncompiled.  If something
+// calls them after all, e.g. through reflection or JNI, the JIT
+// compiles them at runtime.
+class Reachability {
+ public:
+  Reachability(Thread* t)
+      : t(t),
+        methods(0),
+        classes(0),
+        analyzed(0),
+        virtualCalls(0),
+        work(0),
+        methodsProtector(t, &methods),
+        classesProtector(t, &classes),
+        analyzedProtector(t, &analyzed),
+        virtualCallsProtector(t, &virtualCalls),
+        workProtector(t, &work)
+  {
+    methods = makeHashMap(t, 0, 0);
+    classes = makeHashMap(t, 0, 0);
+    analyzed = makeHashMap(t, 0, 0);
+    virtualCalls = makeHashMap(t, 0, 0);
+  }
+
+  bool reachable(GcMethod* method)
+  {
+    return hashMapFind(t,
+                       methods,
+                       reinterpret_cast<object>(method),
+                       objectHash,
+                       objectEqual) != 0;
+  }
+
+  void mark(GcMethod* method)
+  {
+    if (not reachable(method)) {
+      PROTECT(t, method);
+
+      hashMapInsert(t,
+                    methods,
+                    reinterpret_cast<object>(method),
+                    reinterpret_cast<object>(method),
+                    objectHash);
+
+      work = makePair(
+          t, reinterpret_cast<object>(method), reinterpret_cast<object>(work));
+    }
+  }
+
+  void markAll(GcClass* c)
+  {
+    if (GcArray* mtable = cast<GcArray>(t, c->methodTable())) {
+      PROTECT(t, mtable);
+      for (unsigned i = 0; i < mtable->length(); ++i) {
+        mark(cast<GcMethod>(t, mtable->body()[i]));
+      }
+    }
+  }
+
+  // marks the static initializers of the class and its superclasses
+  void markInitializers(GcClass* c)
+  {
+    PROTECT(t, c);
+
+    for (; c; c = c->super()) {
+      if (hashMapFind(t,
+                      classes,
+                      reinterpret_cast<object>(c),
+                      objectHash,
+                      objectEqual)) {
+        break;
+      }
+
+      hashMapInsert(t,
+                    classes,
+                    reinterpret_cast<object>(c),
+                    reinterpret_cast<object>(c),
+                    objectHash);
+
+      if (GcMethod* initializer = classInitializer(t, c)) {
+        mark(initializer);
+      }
+    }
+  }
+
+  GcByteArray* signature(GcByteArray* name, GcByteArray* spec)
+  {
+    return makeByteArray(
+        t, "%s%s", name->body().begin(), spec->body().begin());
+  }
+
+  bool calledVirtually(GcMethod* method)
+  {
+    return hashMapFind(t,
+                       virtualCalls,
+                       reinterpret_cast<object>(
+                           signature(method->name(), method->spec())),
+                       byteArrayHash,
+                       byteArrayEqual) != 0;
+  }
+
+  void scan(GcMethod* method)
+  {
+    GcCode* code = method->code();
+    if (code == 0) {
+      return;
+    }
+
+    PROTECT(t, method);
+    PROTECT(t, code);
+
+    for (unsigned ip = 0; ip < code->length();
+         ip += instructionLength(t, code, ip)) {
+      unsigned instruction = code->body()[ip];
+      switch (instruction) {
+      case invokedynamic:
+        // the call site may be bound to any method of this class,
+        // e.g. the body of a lambda expression
+        markAll(method->class_());
+        break;
+
+      case new_:
+      case getstatic:
+      case putstatic:
+      case invokestatic:
+      case invokespecial:
+      case invokevirtual:
+      case invokeinterface: {
+        unsigned p = ip + 1;
+        unsigned index = codeReadInt16(t, code, p) - 1;
+        object o = singletonObject(t, code->pool(), index);
+
+        GcClass* c;
+        GcByteArray* name;
+        GcByteArray* spec;
+        if (objectClass(t, o) == type(t, GcReference::Type)) {
+          GcReference* reference = cast<GcReference>(t, o);
+          PROTECT(t, reference);
+
+          c = resolveClass(t,
+                           roots(t)->bootLoader(),
+                           instruction == new_ ? reference->name()
+                                               : reference->class_(),
+                           false);
+          name = reference->name();
+          spec = reference->spec();
+        } else if (objectClass(t, o) == type(t, GcMethod::Type)) {
+          c = cast<GcMethod>(t, o)->class_();
+          name = cast<GcMethod>(t, o)->name();
+          spec = cast<GcMethod>(t, o)->spec();
+        } else if (objectClass(t, o) == type(t, GcField::Type)) {
+          c = cast<GcField>(t, o)->class_();
+          name = spec = 0;
+        } else {
+          c = cast<GcClass>(t, o);
+          name = spec = 0;
+        }
+
+        if (c == 0) {
+          break;
+        }
+
+        PROTECT(t, c);
+        PROTECT(t, name);
+        PROTECT(t, spec);
+
+        if (instruction == new_ or instruction == getstatic
+            or instruction == putstatic or instruction == invokestatic) {
+          markInitializers(c);
+        }
+
+        if (instruction == invokevirtual or instruction == invokeinterface) {
+          GcByteArray* key = signature(name, spec);
+          if (hashMapFind(t,
+                          virtualCalls,
+                          reinterpret_cast<object>(key),
+                          byteArrayHash,
+                          byteArrayEqual) == 0) {
+            hashMapInsert(t,
+                          virtualCalls,
+                          reinterpret_cast<object>(key),
+                          reinterpret_cast<object>(key),
+                          byteArrayHash);
+          }
+        }
+
+        if (name) {
+          GcMethod* target = cast<GcMethod>(
+              t, findInHierarchyOrNull(t, c, name, spec, findMethodInClass));
+          if (target) {
+            mark(target);
+          }
+        }
+      } break;
+
+      default:
+        break;
+      }
+    }
+  }
+
+  // Marks the entry points listed in the specified file, one per line,
+  // using the same syntax as -entry.  An entry with no method name
+  // marks every method of the class, which suits classes used through
+  // reflection; one with no spec marks every method of that name.
+  void markEntryPoints(FILE* in)
+  {
+    char line[4096];
+    while (fgets(line, sizeof(line), in)) {
+      line[strcspn(line, "\r\n")] = 0;
+      if (*line == 0 or *line == '#') {
+        continue;
+      }
+
+      char* methodName = strchr(line, '.');
+      char* methodSpec = strchr(line, '(');
+      if (methodName) {
+        *(methodName++) = 0;
+      }
+
+      GcClass* c = resolveClass(t, roots(t)->bootLoader(), line, false);
+      if (c == 0) {
+        fprintf(stderr, "warning: entry point class %s not found\n", line);
+        continue;
+      }
+
+      PROTECT(t, c);
+
+      markInitializers(c);
+
+      size_t nameLength = 0;
+      if (methodName) {
+        nameLength = methodSpec ? methodSpec - methodName : strlen(methodName);
+      }
+
+      GcArray* mtable = cast<GcArray>(t, c->methodTable());
+      if (mtable) {
+        PROTECT(t, mtable);
+        for (unsigned i = 0; i < mtable->length(); ++i) {
+          GcMethod* method = cast<GcMethod>(t, mtable->body()[i]);
+          const char* name
+              = reinterpret_cast<const char*>(method->name()->body().begin());
+          const char* spec
+              = reinterpret_cast<const char*>(method->spec()->body().begin());
+          if (methodName == 0
+              or (strlen(name) == nameLength
+                  and strncmp(name, methodName, nameLength) == 0
+                  and (methodSpec == 0 or ::strcmp(spec, methodSpec) == 0))) {
+            mark(method);
+          }
+        }
+      }
+    }
+  }
+
+  // Marks everything reachable from the methods marked so far, where
+  // the image consists of the specified classes.
+  void run(GcPair* image)
+  {
+    PROTECT(t, image);
+
+    for (GcPair* p = image; p; p = cast<GcPair>(t, p->second())) {
+      PROTECT(t, p);
+      hashMapInsert(t, analyzed, p->first(), p->first(), objectHash);
+    }
+
+    bool changed = true;
+    while (changed) {
+      while (work) {
+        GcMethod* method = cast<GcMethod>(t, work->first());
+        work = cast<GcPair>(t, work->second());
+        scan(method);
+      }
+
+      // pick up overrides of methods invoked virtually since the last
+      // pass, which may in turn invoke more
+      changed = false;
+      for (GcPair* p = image; p; p = cast<GcPair>(t, p->second())) {
+        GcArray* mtable
+            = cast<GcArray>(t, cast<GcClass>(t, p->first())->methodTable());
+        if (mtable) {
+          PROTECT(t, p);
+          PROTECT(t, mtable);
+          for (unsigned i = 0; i < mtable->length(); ++i) {
+            GcMethod* method = cast<GcMethod>(t, mtable->body()[i]);
+            if ((method->flags() & ACC_STATIC) == 0
+                and not reachable(method) and calledVirtually(method)) {
+              mark(method);
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Returns true if the method belongs to a class which was analyzed
+  // but is itself unreachable.  Classes created after the analysis,
+  // e.g. for lambda expressions, are compiled in full.
+  bool excludes(GcMethod* method)
+  {
+    return hashMapFind(t,
+                       analyzed,
+                       reinterpret_cast<object>(method->class_()),
+                       objectHash,
+                       objectEqual) and not reachable(method);
+  }
+
+  Thread* t;
+  GcHashMap* methods;
+  GcHashMap* classes;
+  GcHashMap* analyzed;
+  GcHashMap* virtualCalls;
+  GcPair* work;
+  Thread::SingleProtector methodsProtector;
+  Thread::SingleProtector classesProtector;
+  Thread::SingleProtector analyzedProtector;
+  Thread::SingleProtector virtualCallsProtector;
+  Thread::SingleProtector workProtector;
+};
+
 void compileMethods(Thread* t,
                     GcClass* c,
                     Zone* zone,
@@ -652,6 +990,7 @@ void compileMethods(Thread* t,
                     DelayedPromise** addresses,
                     OffsetResolver* resolver,
                     JavaVM* hostVM,
+                    Reachability* reachability,
                     const char* methodName,
                     const char* methodSpec)
 {
@@ -668,13 +1007,20 @@ void compileMethods(Thread* t,
                 or ::strcmp(
                        reinterpret_cast<char*>(method->spec()->body().begin()),
                        methodSpec) == 0))) {
-        if (method->code() or (method->flags() & ACC_NATIVE)) {
+        if ((method->code() or (method->flags() & ACC_NATIVE))
+            and (reachability == 0 or method->code() == 0
+                 or not reachability->excludes(method))) {
           PROTECT(t, method);
 
+          // the method may already have been compiled, e.g. by
+          // compileOrderedMethods, in which case compileMethod leaves it
+          // alone and we mustn't list it twice
+          intptr_t compiled = method->code() ? method->code()->compiled() : 0;
+
           t->m->processor->compileMethod(
               t, zone, constants, calls, addresses, method, resolver, hostVM);
 
-          if (method->code()) {
+          if (method->code() and method->code()->compiled() != compiled) {
             *methods = makePair(t,
                                 reinterpret_cast<object>(method),
                                 reinterpret_cast<object>(*methods));
@@ -709,6 +1055,83 @@ void compileMethods(Thread* t,
   }
 }
 
+// Compiles the methods listed in the specified file ahead of all
+// others, in the order listed, so they are laid out together at the
+// start of the code image.  The file uses the format the JIT writes
+// when the avian.jit.log property is set: one "<start>,<end>
+// <class>.<method><spec>" line per method, in the order the methods
+// were compiled, which is the order they were first called unless
+// background compiler threads were enabled.  Lines for thunks, and for
+// methods of classes not in the image, are ignored.
+void compileOrderedMethods(Thread* t,
+                           FILE* methodOrder,
+                           Zone* zone,
+                           GcTriple** constants,
+                           GcTriple** calls,
+                           GcPair** methods,
+                           DelayedPromise** addresses,
+                           OffsetResolver* resolver,
+                           JavaVM* hostVM,
+                           Reachability* reachability,
+                           const char* className,
+                           const char* methodName,
+                           const char* methodSpec)
+{
+  char line[4096];
+  while (fgets(line, sizeof(line), methodOrder)) {
+    char* p = strchr(line, ' ');
+    if (p == 0) {
+      continue;
+    }
+    ++p;
+
+    char* spec = strchr(p, '(');
+    if (spec == 0) {
+      continue;
+    }
+    spec[strcspn(spec, "\r\n")] = 0;
+
+    char* dot = 0;
+    for (char* q = p; q < spec; ++q) {
+      if (*q == '.') {
+        dot = q;
+      }
+    }
+
+    if (dot == 0
+        or (className and strncmp(p, className, dot - p) != 0)
+        or (methodSpec and ::strcmp(spec, methodSpec) != 0)) {
+      continue;
+    }
+
+    THREAD_RUNTIME_ARRAY(t, char, name, spec - dot);
+    memcpy(RUNTIME_ARRAY_BODY(name), dot + 1, spec - dot - 1);
+    RUNTIME_ARRAY_BODY(name)[spec - dot - 1] = 0;
+
+    if (methodName and ::strcmp(RUNTIME_ARRAY_BODY(name), methodName) != 0) {
+      continue;
+    }
+
+    GcClass* c = findLoadedClass(t,
+                                 roots(t)->bootLoader(),
+                                 makeByteArray(t, "%.*s", dot - p, p));
+    if (c) {
+      compileMethods(t,
+                     c,
+                     zone,
+                     constants,
+                     calls,
+                     methods,
+                     addresses,
+                     resolver,
+                     hostVM,
+                     reachability,
+                     RUNTIME_ARRAY_BODY(name),
+                     spec);
+    }
+  }
+}
+
 GcTriple* makeCodeImage(Thread* t,
                         Zone* zone,
                         BootImage* image,
@@ -717,6 +1140,8 @@ GcTriple* makeCodeImage(Thread* t,
                         const char* className,
                         const char* methodName,
                         const char* methodSpec,
+                        FILE* methodOrder,
+                        FILE* entryPoints,
                         GcHashMap* typeMaps)
 {
   PROTECT(t, typeMaps);
@@ -814,6 +1239,30 @@ GcTriple* makeCodeImage(Thread* t,
     }
   }
 
+  Reachability analysis(t);
+  Reachability* reachability = 0;
+  if (entryPoints) {
+    analysis.markEntryPoints(entryPoints);
+    analysis.run(classes);
+    reachability = &analysis;
+  }
+
+  if (methodOrder) {
+    compileOrderedMethods(t,
+                          methodOrder,
+                          zone,
+                          &constants,
+                          &calls,
+                          &methods,
+                          &addresses,
+                          &resolver,
+                          hostVM,
+                          reachability,
+                          className,
+                          methodName,
+                          methodSpec);
+  }
+
   // Each method compilation may result in the creation of new,
   // synthetic classes (e.g. for lambda expressions), so we must
   // iterate until we've visited them all:
@@ -833,6 +1282,7 @@ GcTriple* makeCodeImage(Thread* t,
                      &addresses,
                      &resolver,
                      hostVM,
+                     reachability,
                      methodName,
                      methodSpec);
     }
@@ -1495,11 +1945,14 @@ void writeBootImage2(Thread* t,
                      const char* className,
                      const char* methodName,
                      const char* methodSpec,
+                     FILE* methodOrder,
+                     FILE* entryPoints,
                      const char* bootimageStart,
                      const char* bootimageEnd,
                      const char* codeimageStart,
                      const char* codeimageEnd,
-                     bool useLZMA)
+                     bool useLZMA,
+                     bool pageAlignHeap)
 {
   GcThrowable* throwable
       = cast<GcThrowable>(t, make(t, type(t, GcOutOfMemoryError::Type)));
@@ -1522,7 +1975,9 @@ void writeBootImage2(Thread* t,
     virtual void compiled(const void* code,
                           unsigned size UNUSED,
                           unsigned frameSize UNUSED,
-                          const char* name)
+                          const char* name,
+                          const char* sourceFile UNUSED,
+                          Slice<const uint64_t> lineNumbers UNUSED)
     {
       uint64_t offset = reinterpret_cast<uint64_t>(code) - codeOffset;
       symbols.add(SymbolInfo(offset, heapDup(name)));
@@ -1720,6 +2175,8 @@ void writeBootImage2(Thread* t,
                               className,
                               methodName,
                               methodSpec,
+                              methodOrder,
+                              entryPoints,
                               typeMaps);
 
     PROTECT(t, constants);
@@ -1845,17 +2302,22 @@ void writeBootImage2(Thread* t,
     }
   }
 
-  image->stringCount = roots(t)->stringMap()->size();
+  // the string map may still hold entries for strings which have been
+  // collected until the next major collection sweeps them out, so
+  // leave those behind
+  unsigned stringTableSize = roots(t)->stringMap()->size();
   unsigned* stringTable = static_cast<unsigned*>(
-      t->m->heap->allocate(image->stringCount * sizeof(unsigned)));
+      t->m->heap->allocate(stringTableSize * sizeof(unsigned)));
 
   {
     unsigned i = 0;
     for (HashMapIterator it(t, roots(t)->stringMap()); it.hasMore();) {
-      stringTable[i++]
-          = targetVW(heapWalker->map()->find(reinterpret_cast<object>(
-              cast<GcJreference>(t, it.next()->first())->target())));
+      object s = cast<GcJreference>(t, it.next()->first())->target();
+      if (s) {
+        stringTable[i++] = targetVW(heapWalker->map()->find(s));
+      }
     }
+    image->stringCount = i;
   }
 
   unsigned* callTable = t->m->processor->makeCallTable(t, heapWalker);
@@ -1877,6 +2339,25 @@ void writeBootImage2(Thread* t,
   Buffer bootimageData;
 
   if (true) {
+    unsigned heapMapOffset
+        = pad(sizeof(BootImage) + (image->bootClassCount * sizeof(unsigned))
+                  + (image->appClassCount * sizeof(unsigned))
+                  + (image->stringCount * sizeof(unsigned))
+                  + (image->callCount * sizeof(unsigned) * 2),
+              TargetBytesPerWord);
+
+    // With -page-align-heap, the heap starts on a page of its own and
+    // the image is page-aligned, so the pages of the heap which hold
+    // no references needing fixups are never written when the image is
+    // used in place (see avian.bootimage.inPlace), and stay shared with
+    // the file they were loaded from.
+    unsigned alignment = pageAlignHeap ? TargetPageSize : TargetBytesPerWord;
+
+    image->heapOffset
+        = pad(heapMapOffset
+                  + pad(heapMapSize(image->heapSize), TargetBytesPerWord),
+              alignment);
+
     {
       BootImage targetImage;
 
@@ -1902,21 +2383,19 @@ void writeBootImage2(Thread* t,
     bootimageData.write(stringTable, image->stringCount * sizeof(unsigned));
     bootimageData.write(callTable, image->callCount * sizeof(unsigned) * 2);
 
-    unsigned offset = sizeof(BootImage)
-                      + (image->bootClassCount * sizeof(unsigned))
-                      + (image->appClassCount * sizeof(unsigned))
-                      + (image->stringCount * sizeof(unsigned))
-                      + (image->callCount * sizeof(unsigned) * 2);
-
-    while (offset % TargetBytesPerWord) {
+    while (bootimageData.length < heapMapOffset) {
       uint8_t c = 0;
       bootimageData.write(&c, 1);
-      ++offset;
     }
 
     bootimageData.write(heapMap,
                         pad(heapMapSize(image->heapSize), TargetBytesPerWord));
 
+    while (bootimageData.length < image->heapOffset) {
+      uint8_t c = 0;
+      bootimageData.write(&c, 1);
+    }
+
     bootimageData.write(heap, pad(image->heapSize, TargetBytesPerWord));
 
     // fwrite(code, pad(image->codeSize, TargetBytesPerWord), 1, codeOutput);
@@ -1960,7 +2439,7 @@ void writeBootImage2(Thread* t,
                           Slice<SymbolInfo>(bootimageSymbols, 2),
                           Slice<const uint8_t>(bootimage, bootimageLength),
                           Platform::Writable,
-                          TargetBytesPerWord);
+                          useLZMA ? TargetBytesPerWord : alignment);
 
     if (useLZMA) {
       t->m->heap->free(bootimage, bootimageLength);
@@ -2000,6 +2479,9 @@ uint64_t writeBootImage(Thread* t, uintptr_t* arguments)
   const char* codeimageStart = reinterpret_cast<const char*>(arguments[10]);
   const char* codeimageEnd = reinterpret_cast<const char*>(arguments[11]);
   bool useLZMA = arguments[12];
+  FILE* methodOrder = reinterpret_cast<FILE*>(arguments[13]);
+  FILE* entryPoints = reinterpret_cast<FILE*>(arguments[14]);
+  bool pageAlignHeap = arguments[15];
 
   writeBootImage2(t,
                   bootimageOutput,
@@ -2010,11 +2492,14 @@ uint64_t writeBootImage(Thread* t, uintptr_t* arguments)
                   className,
                   methodName,
                   methodSpec,
+                  methodOrder,
+                  entryPoints,
                   bootimageStart,
                   bootimageEnd,
                   codeimageStart,
                   codeimageEnd,
-                  useLZMA);
+                  useLZMA,
+                  pageAlignHeap);
 
   return 1;
 }
@@ -2048,6 +2533,14 @@ class Arguments {
 
   bool useLZMA;
 
+  bool pageAlignHeap;
+
+  const char* methodOrder;
+
+  const char* entryPoints;
+
+  const char* stamp;
+
   bool maybeSplit(const char* src, char*& destA, char*& destB)
   {
     if (src) {
@@ -2087,6 +2580,11 @@ class Arguments {
                          "codeimage-symbols",
                          "<start symbol name>:<end symbol name>");
     Arg useLZMA(parser, false, "use-lzma", 0);
+    Arg pageAlignHeap(parser, false, "page-align-heap", 0);
+    Arg methodOrder(parser, false, "method-order", "<avian.jit.log file>");
+    Arg entryPoints(
+        parser, false, "reachable-from", "<entry point list file>");
+    Arg stamp(parser, false, "stamp", "<stamp file>");
 
     if (!parser.parse(ac, av)) {
       parser.printUsage(av[0]);
@@ -2098,6 +2596,10 @@ class Arguments {
     this->codeimage = codeimage.value;
     this->hostvm = hostvm.value;
     this->useLZMA = useLZMA.value != 0;
+    this->pageAlignHeap = pageAlignHeap.value != 0;
+    this->methodOrder = methodOrder.value;
+    this->entryPoints = entryPoints.value;
+    this->stamp = stamp.value;
 
     if (entry.value) {
       if (const char* entryClassEnd = strchr(entry.value, '.')) {
@@ -2176,7 +2678,10 @@ class Arguments {
         "bootimageStart = %s\n"
         "bootimageEnd = %s\n"
         "codeimageStart = %s\n"
-        "codeimageEnd = %s\n",
+        "codeimageEnd = %s\n"
+        "methodOrder = %s\n"
+        "entryPoints = %s\n"
+        "stamp = %s\n",
         classpath,
         bootimage,
         codeimage,
@@ -2187,10 +2692,138 @@ class Arguments {
         bootimageStart,
         bootimageEnd,
         codeimageStart,
-        codeimageEnd);
+        codeimageEnd,
+        methodOrder,
+        entryPoints,
+        stamp);
+  }
+};
+
+// 64-bit FNV-1a over everything a boot image is made from, which is
+// recorded in the stamp file so that rerunning the generator on the
+// same inputs (e.g. a jar repacked with identical classes) can be
+// skipped.
+class Fingerprint {
+ public:
+  Fingerprint() : value(0xcbf29ce484222325ULL)
+  {
+  }
+
+  void add(const void* data, size_t size)
+  {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      value = (value ^ p[i]) * 0x100000001b3ULL;
+    }
+  }
+
+  void add(const char* s)
+  {
+    add(s, strlen(s) + 1);
+  }
+
+  bool addFile(System* s, const char* name)
+  {
+    size_t length;
+    if (s->stat(name, &length) != System::TypeFile) {
+      return false;
+    }
+
+    add(&length, sizeof(length));
+
+    if (length) {
+      System::Region* region;
+      if (not s->success(s->map(&region, name))) {
+        return false;
+      }
+
+      add(region->start(), region->length());
+      region->dispose();
+    }
+
+    return true;
   }
+
+  uint64_t value;
 };
 
+// Computes the fingerprint of the generator itself, its arguments,
+// every entry on the classpath, and the files the arguments name.
+// Returns false if some input couldn't be read, in which case the
+// image must be regenerated.
+bool fingerprint(System* s,
+                 Finder* f,
+                 Arguments* args,
+                 int ac,
+                 const char** av,
+                 uint64_t* value)
+{
+  Fingerprint fp;
+
+  if (not fp.addFile(s, av[0])) {
+    return false;
+  }
+
+  for (int i = 1; i < ac; ++i) {
+    fp.add(av[i]);
+  }
+
+  for (Finder::Iterator it(f); it.hasMore();) {
+    size_t nameSize;
+    const char* name = it.next(&nameSize);
+
+    fp.add(name, nameSize);
+
+    // directories appear in the iteration too, but have no contents
+    if (System::Region* region = f->find(name)) {
+      fp.add(region->start(), region->length());
+      region->dispose();
+    }
+  }
+
+  if ((args->hostvm and not fp.addFile(s, args->hostvm))
+      or (args->methodOrder and not fp.addFile(s, args->methodOrder))
+      or (args->entryPoints and not fp.addFile(s, args->entryPoints))) {
+    return false;
+  }
+
+  *value = fp.value;
+  return true;
+}
+
+bool upToDate(System* s, Arguments* args, uint64_t fingerprint)
+{
+  size_t length;
+  if (s->stat(args->bootimage, &length) != System::TypeFile
+      or s->stat(args->codeimage, &length) != System::TypeFile) {
+    return false;
+  }
+
+  FILE* in = vm::fopen(args->stamp, "rb");
+  if (in == 0) {
+    return false;
+  }
+
+  uint64_t recorded;
+  bool same = fread(&recorded, sizeof(recorded), 1, in) == 1
+              and recorded == fingerprint;
+  fclose(in);
+
+  return same;
+}
+
+void writeStamp(Arguments* args, uint64_t fingerprint)
+{
+  FILE* out = vm::fopen(args->stamp, "wb");
+  if (out == 0) {
+    fprintf(stderr, "unable to open %s\n", args->stamp);
+    return;
+  }
+
+  fwrite(&fingerprint, sizeof(fingerprint), 1, out);
+  fclose(out);
+}
+
 }  // namespace
 
 int main(int ac, const char** av)
@@ -2202,6 +2835,20 @@ int main(int ac, const char** av)
   Heap* h = makeHeap(s, HeapCapacity * 2);
   Classpath* c = makeClasspath(s, h, AVIAN_JAVA_HOME, AVIAN_EMBED_PREFIX);
   Finder* f = makeFinder(s, h, args.classpath, 0);
+
+  uint64_t stampValue;
+  bool stamped = args.stamp
+                 and fingerprint(s, f, &args, ac, av, &stampValue);
+  if (stamped and upToDate(s, &args, stampValue)) {
+    return 0;
+  }
+
+  if (args.stamp) {
+    // don't leave behind a stamp for images we're about to overwrite,
+    // in case we fail partway through
+    remove(args.stamp);
+  }
+
   Processor* p = makeProcessor(s, h, 0, false);
 
 // todo: currently, the compiler cannot compile code with jumps or
@@ -2239,6 +2886,24 @@ int main(int ac, const char** av)
     return -1;
   }
 
+  FILE* methodOrder = 0;
+  if (args.methodOrder) {
+    methodOrder = vm::fopen(args.methodOrder, "rb");
+    if (methodOrder == 0) {
+      fprintf(stderr, "unable to open %s\n", args.methodOrder);
+      return -1;
+    }
+  }
+
+  FILE* entryPoints = 0;
+  if (args.entryPoints) {
+    entryPoints = vm::fopen(args.entryPoints, "rb");
+    if (entryPoints == 0) {
+      fprintf(stderr, "unable to open %s\n", args.entryPoints);
+      return -1;
+    }
+  }
+
   JavaVM* hostVM = 0;
   System::Library* hostVMLibrary = 0;
   if (args.hostvm) {
@@ -2306,10 +2971,21 @@ int main(int ac, const char** av)
                            reinterpret_cast<uintptr_t>(args.bootimageEnd),
                            reinterpret_cast<uintptr_t>(args.codeimageStart),
                            reinterpret_cast<uintptr_t>(args.codeimageEnd),
-                           static_cast<uintptr_t>(args.useLZMA)};
+                           static_cast<uintptr_t>(args.useLZMA),
+                           reinterpret_cast<uintptr_t>(methodOrder),
+                           reinterpret_cast<uintptr_t>(entryPoints),
+                           static_cast<uintptr_t>(args.pageAlignHeap)};
 
   run(t, writeBootImage, arguments);
 
+  if (methodOrder) {
+    fclose(methodOrder);
+  }
+
+  if (entryPoints) {
+    fclose(entryPoints);
+  }
+
   if (hostVM) {
     hostVM->vtable->DestroyJavaVM(hostVM);
     hostVMLibrary->disposeAll();
@@ -2319,6 +2995,9 @@ int main(int ac, const char** av)
     printTrace(t, t->exception);
     return -1;
   } else {
+    if (stamped) {
+      writeStamp(&args, stampValue);
+    }
     return 0;
   }
 }
@@ -35,6 +35,7 @@ namespace {
 #define IMAGE_SCN_ALIGN_2BYTES 0x200000
 #define IMAGE_SCN_ALIGN_4BYTES 0x300000
 #define IMAGE_SCN_ALIGN_8BYTES 0x400000
+#define IMAGE_SCN_ALIGN_4096BYTES 0xD00000
 #define IMAGE_SCN_MEM_EXECUTE 0x20000000
 #define IMAGE_SCN_MEM_READ 0x40000000
 #define IMAGE_SCN_MEM_WRITE 0x80000000
@@ -244,6 +245,9 @@ class WindowsPlatform : public Platform {
     case 8:
       sectionMask = IMAGE_SCN_ALIGN_8BYTES;
       break;
+    case 4096:
+      sectionMask = IMAGE_SCN_ALIGN_4096BYTES;
+      break;
     default:
       fprintf(stderr, "unsupported alignment: %d\n", alignment);
       return false;
@@ -1462,6 +1462,54 @@ void writeInitializations(Output* out, Module& module)
   }
 }
 
+// Writes a case which visits the reference fields of the specified
+// type at the offsets known here, for classes whose mask
+// writeInitialization would pass to bootClass.
+void writeWalker(Output* out, Module& module, Class* cl)
+{
+  std::vector<uint32_t> mask = typeObjectMask(module, cl);
+  if (trivialMask(mask)) {
+    return;
+  }
+
+  unsigned fixedSizeInWords = ceilingDivide(cl->fixedSize, BytesPerWord);
+
+  out->write("case Gc::");
+  out->write(capitalize(cl->name));
+  out->write("Type:\n  return ");
+
+  bool wrote = false;
+  for (unsigned i = 0; i < fixedSizeInWords; ++i) {
+    if (mask[i / 32] & (static_cast<uint32_t>(1) << (i % 32))) {
+      if (wrote) {
+        out->write("\n    and ");
+      } else {
+        wrote = true;
+      }
+      out->write("visitFrom(w, start, ");
+      out->write(i);
+      out->write(")");
+    }
+  }
+
+  if (cl->arrayField and isFieldGcVisible(module, cl->arrayField)) {
+    out->write("\n    and visitArrayFrom(w, start, ");
+    out->write(fixedSizeInWords);
+    out->write(", fieldAtOffset<uintptr_t>(o, ");
+    out->write(cl->fixedSize - BytesPerWord);
+    out->write("))");
+  }
+
+  out->write(";\n");
+}
+
+void writeWalkers(Output* out, Module& module)
+{
+  for (const auto p : module.classes) {
+    writeWalker(out, module, p.second);
+  }
+}
+
 void writeJavaInitialization(Output* out,
                              Class* cl,
                              std::set<Class*>& alreadyInited)
@@ -1610,7 +1658,7 @@ int main(int ac, char** av)
                  true,
                  "t",
                  "<enums|declarations|constructors|initializations|java-"
-                 "initializations|name-initializations|maps>");
+                 "initializations|name-initializations|maps|walkers>");
 
   if (!parser.parse(ac, av)) {
     parser.printUsage(av[0]);
@@ -1623,7 +1671,8 @@ int main(int ac, char** av)
         || local::equal(outputType.value, "initializations")
         || local::equal(outputType.value, "java-initializations")
         || local::equal(outputType.value, "name-initializations")
-        || local::equal(outputType.value, "maps"))) {
+        || local::equal(outputType.value, "maps")
+        || local::equal(outputType.value, "walkers"))) {
     parser.printUsage(av[0]);
     exit(1);
   }
@@ -1701,6 +1750,8 @@ int main(int ac, char** av)
     local::writeNameInitializations(&out, module);
   } else if (local::equal(outputType.value, "maps")) {
     local::writeMaps(&out, module);
+  } else if (local::equal(outputType.value, "walkers")) {
+    local::writeWalkers(&out, module);
   }
 
   out.write("\n");
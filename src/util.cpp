@@ -303,6 +303,168 @@ GcTreeNode* treeAdd(Thread* t, TreeContext* c)
   return newRoot;
 }
 
+// Maps other than weak ones use open addressing with linear probing:
+// the keys fill the first half of the array and the corresponding
+// values the second, with a null key marking an empty slot, so a
+// lookup touches one array instead of chasing a chain of triples, and
+// insertions allocate nothing but the occasional bigger array.  Weak
+// maps stay chained, since their keys are weak references which the
+// collector clears in place, and the monitor and string maps are
+// searched without synchronizing in a way which relies on the chains.
+
+bool isWeak(Thread* t, GcHashMap* map)
+{
+  return objectClass(t, map) == type(t, GcWeakHashMap::Type);
+}
+
+unsigned openCapacity(GcArray* array)
+{
+  return array->length() / 2;
+}
+
+int openFind(Thread* t,
+             GcArray* array,
+             object key,
+             uint32_t (*hash)(Thread*, object),
+             bool (*equal)(Thread*, object, object))
+{
+  // we never let the table fill up, so there's always an empty slot to
+  // stop at
+  unsigned mask = openCapacity(array) - 1;
+  for (unsigned i = hash(t, key) & mask;; i = (i + 1) & mask) {
+    object k = array->body()[i];
+    if (k == 0) {
+      return -1;
+    } else if (equal(t, key, k)) {
+      return i;
+    }
+  }
+}
+
+void openPut(Thread* t,
+             GcArray* array,
+             object key,
+             object value,
+             uint32_t (*hash)(Thread*, object))
+{
+  unsigned capacity = openCapacity(array);
+  unsigned mask = capacity - 1;
+  unsigned i = hash(t, key) & mask;
+  while (array->body()[i]) {
+    i = (i + 1) & mask;
+  }
+
+  array->setBodyElement(t, i, key);
+  array->setBodyElement(t, capacity + i, value);
+}
+
+void openResize(Thread* t,
+                GcHashMap* map,
+                uint32_t (*hash)(Thread*, object),
+                unsigned size)
+{
+  PROTECT(t, map);
+
+  GcArray* newArray = 0;
+
+  if (size) {
+    GcArray* oldArray = map->array();
+    PROTECT(t, oldArray);
+
+    // keep the table at most half full
+    unsigned newCapacity = nextPowerOfTwo(max(size, map->size() * 2));
+    if (oldArray and openCapacity(oldArray) == newCapacity) {
+      return;
+    }
+
+    newArray = makeArray(t, newCapacity * 2);
+
+    if (oldArray != map->array()) {
+      // a resize was performed during a GC via the makeArray call
+      // above; nothing left to do
+      return;
+    }
+
+    if (oldArray) {
+      unsigned capacity = openCapacity(oldArray);
+      for (unsigned i = 0; i < capacity; ++i) {
+        object k = oldArray->body()[i];
+        if (k) {
+          openPut(t, newArray, k, oldArray->body()[capacity + i], hash);
+        }
+      }
+    }
+  }
+
+  map->setArray(t, newArray);
+}
+
+void openInsert(Thread* t,
+                GcHashMap* map,
+                object key,
+                object value,
+                uint32_t (*hash)(Thread*, object))
+{
+  GcArray* array = map->array();
+  if (array == 0 or (map->size() + 1) * 2 > openCapacity(array)) {
+    PROTECT(t, map);
+    PROTECT(t, key);
+    PROTECT(t, value);
+
+    openResize(t, map, hash, array ? openCapacity(array) * 2 : 16);
+  }
+
+  openPut(t, map->array(), key, value, hash);
+  ++map->size();
+}
+
+object openRemove(Thread* t,
+                  GcHashMap* map,
+                  object key,
+                  uint32_t (*hash)(Thread*, object),
+                  bool (*equal)(Thread*, object, object))
+{
+  GcArray* array = map->array();
+  if (array == 0) {
+    return 0;
+  }
+
+  int found = openFind(t, array, key, hash, equal);
+  if (found < 0) {
+    return 0;
+  }
+
+  unsigned capacity = openCapacity(array);
+  unsigned mask = capacity - 1;
+  unsigned i = found;
+  object o = array->body()[capacity + i];
+
+  // move back any later member of the run whose probe would otherwise
+  // stop early at the hole we're leaving
+  for (unsigned j = (i + 1) & mask; array->body()[j]; j = (j + 1) & mask) {
+    unsigned home = hash(t, array->body()[j]) & mask;
+    bool between = (i <= j) ? (i < home and home <= j)
+                            : (i < home or home <= j);
+    if (not between) {
+      array->setBodyElement(t, i, array->body()[j]);
+      array->setBodyElement(t, capacity + i, array->body()[capacity + j]);
+      i = j;
+    }
+  }
+
+  array->setBodyElement(t, i, 0);
+  array->setBodyElement(t, capacity + i, 0);
+  --map->size();
+
+  if ((not t->m->collecting) and capacity > 16
+      and map->size() * 6 <= capacity) {
+    PROTECT(t, o);
+    openResize(t, map, hash, capacity / 2);
+  }
+
+  return o;
+}
+
 }  // namespace
 
 namespace vm {
@@ -313,7 +475,8 @@ GcTriple* hashMapFindNode(Thread* t,
                           uint32_t (*hash)(Thread*, object),
                           bool (*equal)(Thread*, object, object))
 {
-  bool weak = objectClass(t, map) == type(t, GcWeakHashMap::Type);
+  bool weak = isWeak(t, map);
+  assertT(t, weak);
 
   GcArray* array = map->array();
   if (array) {
@@ -336,11 +499,77 @@ GcTriple* hashMapFindNode(Thread* t,
   return 0;
 }
 
+object hashMapFind(Thread* t,
+                   GcHashMap* map,
+                   object key,
+                   uint32_t (*hash)(Thread*, object),
+                   bool (*equal)(Thread*, object, object))
+{
+  if (isWeak(t, map)) {
+    GcTriple* n = hashMapFindNode(t, map, key, hash, equal);
+    return (n ? n->second() : 0);
+  }
+
+  GcArray* array = map->array();
+  if (array) {
+    int i = openFind(t, array, key, hash, equal);
+    if (i >= 0) {
+      return array->body()[openCapacity(array) + i];
+    }
+  }
+  return 0;
+}
+
+bool hashMapInsertOrReplace(Thread* t,
+                            GcHashMap* map,
+                            object key,
+                            object value,
+                            uint32_t (*hash)(Thread*, object),
+                            bool (*equal)(Thread*, object, object))
+{
+  if (isWeak(t, map)) {
+    GcTriple* n = hashMapFindNode(t, map, key, hash, equal);
+    if (n) {
+      n->setSecond(t, value);
+      return false;
+    }
+  } else if (GcArray* array = map->array()) {
+    int i = openFind(t, array, key, hash, equal);
+    if (i >= 0) {
+      array->setBodyElement(t, openCapacity(array) + i, value);
+      return false;
+    }
+  }
+
+  hashMapInsert(t, map, key, value, hash);
+  return true;
+}
+
+bool hashMapInsertMaybe(Thread* t,
+                        GcHashMap* map,
+                        object key,
+                        object value,
+                        uint32_t (*hash)(Thread*, object),
+                        bool (*equal)(Thread*, object, object))
+{
+  if (hashMapFind(t, map, key, hash, equal)) {
+    return false;
+  } else {
+    hashMapInsert(t, map, key, value, hash);
+    return true;
+  }
+}
+
 void hashMapResize(Thread* t,
                    GcHashMap* map,
                    uint32_t (*hash)(Thread*, object),
                    unsigned size)
 {
+  if (not isWeak(t, map)) {
+    openResize(t, map, hash, size);
+    return;
+  }
+
   PROTECT(t, map);
 
   GcArray* newArray = 0;
@@ -363,19 +592,15 @@ void hashMapResize(Thread* t,
     }
 
     if (oldArray) {
-      bool weak = objectClass(t, map) == type(t, GcWeakHashMap::Type);
       for (unsigned i = 0; i < oldArray->length(); ++i) {
         GcTriple* next;
         for (GcTriple* p = cast<GcTriple>(t, oldArray->body()[i]); p;
              p = next) {
           next = cast<GcTriple>(t, p->third());
 
-          object k = p->first();
-          if (weak) {
-            k = cast<GcJreference>(t, k)->target();
-            if (k == 0) {
-              continue;
-            }
+          object k = cast<GcJreference>(t, p->first())->target();
+          if (k == 0) {
+            continue;
           }
 
           unsigned index = hash(t, k) & (newLength - 1);
@@ -396,6 +621,11 @@ void hashMapInsert(Thread* t,
                    object value,
                    uint32_t (*hash)(Thread*, object))
 {
+  if (not isWeak(t, map)) {
+    openInsert(t, map, key, value, hash);
+    return;
+  }
+
   // note that we reinitialize the array variable whenever an
   // allocation (and thus possibly a collection) occurs, in case the
   // array changes due to a table resize.
@@ -404,12 +634,16 @@ void hashMapInsert(Thread* t,
 
   uint32_t h = hash(t, key);
 
-  bool weak = objectClass(t, map) == type(t, GcWeakHashMap::Type);
-
   GcArray* array = map->array();
 
   ++map->size();
 
+  if (array and map->size() >= array->length() * 2) {
+    // entries whose keys have been collected count towards the size
+    // until someone removes them, so drop them before deciding to grow
+    hashMapPurge(t, map);
+  }
+
   if (array == 0 or map->size() >= array->length() * 2) {
     PROTECT(t, key);
     PROTECT(t, value);
@@ -419,23 +653,16 @@ void hashMapInsert(Thread* t,
     array = map->array();
   }
 
-  object k = key;
+  PROTECT(t, key);
+  PROTECT(t, value);
 
-  if (weak) {
-    PROTECT(t, key);
-    PROTECT(t, value);
+  GcWeakReference* r = makeWeakReference(t, 0, 0, 0, 0);
 
-    GcWeakReference* r = makeWeakReference(t, 0, 0, 0, 0);
+  r->setTarget(t, key);
+  r->setVmNext(t, t->m->weakReferences);
+  t->m->weakReferences = r->as<GcJreference>(t);
 
-    r->setTarget(t, key);
-    r->setVmNext(t, t->m->weakReferences);
-    t->m->weakReferences = r->as<GcJreference>(t);
-    k = r;
-
-    array = map->array();
-  }
-
-  GcTriple* n = makeTriple(t, k, value, 0);
+  GcTriple* n = makeTriple(t, r, value, 0);
 
   array = map->array();
 
@@ -466,13 +693,31 @@ GcTriple* hashMapRemoveNode(Thread* t,
   return n;
 }
 
+void hashMapPurge(Thread* t, GcHashMap* map)
+{
+  GcArray* array = map->array();
+  for (unsigned i = 0; i < array->length(); ++i) {
+    GcTriple* p = 0;
+    for (GcTriple* n = cast<GcTriple>(t, array->body()[i]); n;) {
+      if (cast<GcJreference>(t, n->first())->target() == 0) {
+        n = cast<GcTriple>(t, hashMapRemoveNode(t, map, i, p, n)->third());
+      } else {
+        p = n;
+        n = cast<GcTriple>(t, n->third());
+      }
+    }
+  }
+}
+
 object hashMapRemove(Thread* t,
                      GcHashMap* map,
                      object key,
                      uint32_t (*hash)(Thread*, object),
                      bool (*equal)(Thread*, object, object))
 {
-  bool weak = objectClass(t, map) == type(t, GcWeakHashMap::Type);
+  if (not isWeak(t, map)) {
+    return openRemove(t, map, key, hash, equal);
+  }
 
   GcArray* array = map->array();
   object o = 0;
@@ -480,14 +725,10 @@ object hashMapRemove(Thread* t,
     unsigned index = hash(t, key) & (array->length() - 1);
     GcTriple* p = 0;
     for (GcTriple* n = cast<GcTriple>(t, array->body()[index]); n;) {
-      object k = n->first();
-      if (weak) {
-        k = cast<GcJreference>(t, k)->target();
-        if (k == 0) {
-          n = cast<GcTriple>(t,
-                             hashMapRemoveNode(t, map, index, p, n)->third());
-          continue;
-        }
+      object k = cast<GcJreference>(t, n->first())->target();
+      if (k == 0) {
+        n = cast<GcTriple>(t, hashMapRemoveNode(t, map, index, p, n)->third());
+        continue;
       }
 
       if (equal(t, key, k)) {
@@ -601,4 +842,17 @@ void treeUpdate(Thread* t,
   setTreeNodeValue(t, treeFind(t, tree, key, sentinal, compare), value);
 }
 
+void treeVisit(Thread* t,
+               GcTreeNode* tree,
+               GcTreeNode* sentinal,
+               void (*visit)(Thread* t, object value, void* context),
+               void* context)
+{
+  while (tree != sentinal) {
+    treeVisit(t, tree->left(), sentinal, visit, context);
+    visit(t, getTreeNodeValue(t, tree), context);
+    tree = tree->right();
+  }
+}
+
 }  // namespace vm
@@ -28,7 +28,7 @@ void* FixedAllocator::tryAllocate(size_t size)
 void* FixedAllocator::allocate(size_t size, unsigned padAlignment)
 {
   size_t paddedSize = vm::pad(size, padAlignment);
-  expect(a, offset + paddedSize < memory.count);
+  expect(a, offset + paddedSize <= memory.count);
 
   void* p = memory.begin() + offset;
   offset += paddedSize;
@@ -0,0 +1,55 @@
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+
+public class AllocationProfile {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static Object sink;
+
+  private static void churn() {
+    for (int i = 0; i < 100000; ++i) {
+      sink = new byte[100];
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    // compile churn, and perhaps allocate in line, before profiling is
+    // turned on, which it must notice anyway
+    churn();
+
+    avian.Machine.setAllocationProfileInterval(4096);
+    churn();
+    avian.Machine.setAllocationProfileInterval(0);
+
+    File file = File.createTempFile("allocations", ".txt");
+    avian.Machine.dumpAllocationProfile(file.getPath());
+
+    long churnBytes = 0;
+    BufferedReader reader = new BufferedReader(new FileReader(file));
+    try {
+      String line;
+      while ((line = reader.readLine()) != null) {
+        // bytes count class site
+        String[] fields = line.split(" ");
+        expect(fields.length == 4);
+        if (fields[2].equals("[B")
+            && fields[3].startsWith("AllocationProfile.churn"))
+        {
+          churnBytes += Long.parseLong(fields[0]);
+          expect(Integer.parseInt(fields[1]) > 0);
+        }
+      }
+    } finally {
+      reader.close();
+    }
+
+    expect(file.delete());
+
+    // about 10MB were allocated, so the estimate shouldn't be far off
+    expect(churnBytes > 5 * 1000 * 1000);
+    expect(churnBytes < 20 * 1000 * 1000);
+  }
+}
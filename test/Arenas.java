@@ -0,0 +1,127 @@
+import avian.Arena;
+
+public class Arenas {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // a record of an int, a long and a double, laid out by hand
+  private static final long RecordSize = 24;
+
+  private static void testRecords() {
+    Arena arena = new Arena(1024);
+    try {
+      long[] records = new long[10000];
+      for (int i = 0; i < records.length; ++i) {
+        long r = records[i] = arena.allocate(RecordSize);
+        expect((r & 7) == 0);
+        Arena.putInt(r, i);
+        Arena.putLong(r + 8, i * 1000000007L);
+        Arena.putDouble(r + 16, i / 4.0);
+      }
+
+      // growing the arena must leave earlier records where they were
+      for (int i = 0; i < records.length; ++i) {
+        long r = records[i];
+        expect(Arena.getInt(r) == i);
+        expect(Arena.getLong(r + 8) == i * 1000000007L);
+        expect(Arena.getDouble(r + 16) == i / 4.0);
+      }
+
+      expect(arena.footprint() >= records.length * RecordSize);
+    } finally {
+      arena.close();
+    }
+  }
+
+  private static void testAccessors() {
+    Arena arena = new Arena();
+    try {
+      long a = arena.allocate(8);
+      Arena.putByte(a, (byte) -2);
+      expect(Arena.getByte(a) == -2);
+      Arena.putShort(a, (short) -3);
+      expect(Arena.getShort(a) == -3);
+      Arena.putInt(a, 0x80000001);
+      expect(Arena.getInt(a) == 0x80000001);
+      Arena.putLong(a, Long.MIN_VALUE + 1);
+      expect(Arena.getLong(a) == Long.MIN_VALUE + 1);
+      Arena.putFloat(a, -1.5f);
+      expect(Arena.getFloat(a) == -1.5f);
+      Arena.putDouble(a, Math.PI);
+      expect(Arena.getDouble(a) == Math.PI);
+    } finally {
+      arena.close();
+    }
+  }
+
+  private static void testAlignment() {
+    Arena arena = new Arena(256);
+    try {
+      arena.allocate(1, 1);
+      long a = arena.allocate(3, 1);
+      expect(arena.allocate(1, 1) == a + 3);
+      expect((arena.allocate(16, 64) & 63) == 0);
+      expect((arena.allocate(1000, 4096) & 4095) == 0);
+
+      try {
+        arena.allocate(8, 3);
+        expect(false);
+      } catch (IllegalArgumentException e) { }
+
+      try {
+        arena.allocate(-1);
+        expect(false);
+      } catch (IllegalArgumentException e) { }
+    } finally {
+      arena.close();
+    }
+  }
+
+  private static void testLarge() {
+    Arena arena = new Arena(1024);
+    try {
+      long small = arena.allocate(16);
+      Arena.putLong(small, 42);
+
+      // too big for a shared segment, so it gets its own, and the
+      // current segment goes on being used
+      int size = 4 * 1024 * 1024;
+      long large = arena.allocate(size);
+      for (int i = 0; i < size; i += 4096) {
+        Arena.putInt(large + i, i);
+      }
+      for (int i = 0; i < size; i += 4096) {
+        expect(Arena.getInt(large + i) == i);
+      }
+
+      expect(arena.allocate(16) == small + 16);
+      expect(Arena.getLong(small) == 42);
+      expect(arena.footprint() >= size);
+    } finally {
+      arena.close();
+    }
+  }
+
+  private static void testClose() {
+    Arena arena = new Arena();
+    arena.allocate(100);
+    arena.close();
+    expect(arena.footprint() == 0);
+
+    try {
+      arena.allocate(8);
+      expect(false);
+    } catch (IllegalStateException e) { }
+
+    arena.close();
+  }
+
+  public static void main(String[] args) {
+    testRecords();
+    testAccessors();
+    testAlignment();
+    testLarge();
+    testClose();
+  }
+}
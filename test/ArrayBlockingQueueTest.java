@@ -0,0 +1,82 @@
+import java.util.Iterator;
+import java.util.LinkedList;
+import java.util.concurrent.ArrayBlockingQueue;
+import java.util.concurrent.TimeUnit;
+
+public class ArrayBlockingQueueTest {
+  public static void main(String[] args) throws InterruptedException {
+    QueueHelper.sizeTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.isEmptyTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.addTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.addAllTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.elementTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.elementFail(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.removeTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.removeEmptyFail(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.containsTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.containsAllTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.removeObjectTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.removeAllTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.clearTest(new ArrayBlockingQueue<Object>(4));
+    QueueHelper.toArrayTest(new ArrayBlockingQueue<Object>(4));
+    capacityTest();
+    wrapTest();
+    LinkedBlockingQueueTest.handoffTest(new ArrayBlockingQueue<Integer>(4));
+  }
+
+  private static void verify(boolean val) {
+    if (! val) {
+      throw new RuntimeException();
+    }
+  }
+
+  private static void capacityTest() throws InterruptedException {
+    ArrayBlockingQueue<Object> q = new ArrayBlockingQueue<Object>(2);
+    verify(q.remainingCapacity() == 2);
+    verify(q.offer(new Object()));
+    verify(q.offer(new Object()));
+    verify(q.remainingCapacity() == 0);
+    verify(! q.offer(new Object()));
+    verify(! q.offer(new Object(), 10, TimeUnit.MILLISECONDS));
+
+    try {
+      q.add(new Object());
+      throw new RuntimeException("Exception should have thrown");
+    } catch (IllegalStateException e) {
+      // expected
+    }
+
+    LinkedList<Object> drained = new LinkedList<Object>();
+    verify(q.drainTo(drained, 1) == 1);
+    verify(q.size() == 1);
+    verify(q.poll(10, TimeUnit.MILLISECONDS) != null);
+    verify(q.poll(10, TimeUnit.MILLISECONDS) == null);
+  }
+
+  // elements removed from the middle of a queue which has wrapped
+  // around the end of its array leave the rest in order
+  private static void wrapTest() {
+    ArrayBlockingQueue<Integer> q = new ArrayBlockingQueue<Integer>(4);
+    q.add(0);
+    q.add(1);
+    q.add(2);
+    verify(q.poll() == 0);
+    verify(q.poll() == 1);
+    q.add(3);
+    q.add(4);
+    q.add(5);
+
+    verify(q.remove((Object) 4));
+    Iterator<Integer> it = q.iterator();
+    verify(it.next() == 2);
+    it.remove();
+    verify(it.next() == 3);
+    verify(it.next() == 5);
+    verify(! it.hasNext());
+
+    verify(q.size() == 2);
+    verify(q.poll() == 3);
+    verify(q.poll() == 5);
+    verify(q.isEmpty());
+  }
+}
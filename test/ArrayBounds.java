@@ -0,0 +1,154 @@
+public class ArrayBounds {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int sum(int[] array) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += array[i];
+    }
+    return sum;
+  }
+
+  private static void fill(byte[] array, int value) {
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = (byte) (value + i);
+    }
+  }
+
+  private static long sumFrom(long[] array, int start) {
+    long sum = 0;
+    for (int i = 2; i < array.length; ++i) {
+      sum += array[i] * start;
+    }
+    return sum;
+  }
+
+  private static void copyDoubled(double[] array) {
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = array[i] * 2.0;
+    }
+  }
+
+  private static int skipOdd(int[] array) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      if ((i & 1) != 0) {
+        continue;
+      }
+      sum += array[i];
+    }
+    return sum;
+  }
+
+  private static int writesIndex(int[] array) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += array[i];
+      i = array.length;
+      sum += array[i];
+    }
+    return sum;
+  }
+
+  private static int[] other = new int[1];
+
+  private static int replacesArray(int[] array) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      int[] a = array;
+      array = other;
+      sum += array[i];
+      array = a;
+    }
+    return sum;
+  }
+
+  private static int negativeStart(int[] array) {
+    int sum = 0;
+    for (int i = -1; i < array.length; ++i) {
+      sum += array[i];
+    }
+    return sum;
+  }
+
+  private static int otherArray(int[] array, int[] b) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += b[i];
+    }
+    return sum;
+  }
+
+  private static int nested(int[][] matrix) {
+    int sum = 0;
+    for (int i = 0; i < matrix.length; ++i) {
+      int[] row = matrix[i];
+      for (int j = 0; j < row.length; ++j) {
+        sum += row[j];
+      }
+    }
+    return sum;
+  }
+
+  private static boolean throwsOutOfBounds(Runnable r) {
+    try {
+      r.run();
+      return false;
+    } catch (ArrayIndexOutOfBoundsException e) {
+      return true;
+    }
+  }
+
+  public static void main(String[] args) {
+    for (int n = 0; n < 3; ++n) {
+      int[] ints = new int[] { 1, 2, 3, 4, 5 };
+      expect(sum(ints) == 15);
+      expect(sum(new int[0]) == 0);
+      expect(skipOdd(ints) == 9);
+
+      byte[] bytes = new byte[4];
+      fill(bytes, 126);
+      expect(bytes[0] == 126);
+      expect(bytes[3] == -127);
+
+      expect(sumFrom(new long[] { 100, 100, 1, 2 }, 3) == 9);
+
+      double[] doubles = new double[] { 1.5, -2 };
+      copyDoubled(doubles);
+      expect(doubles[0] == 3.0);
+      expect(doubles[1] == -4.0);
+
+      expect(nested(new int[][] { { 1 }, { }, { 2, 3 } }) == 6);
+
+      final int[] small = new int[] { 7, 8 };
+
+      expect(throwsOutOfBounds(new Runnable() {
+          public void run() {
+            writesIndex(small);
+          }
+        }));
+
+      expect(throwsOutOfBounds(new Runnable() {
+          public void run() {
+            replacesArray(small);
+          }
+        }));
+
+      expect(throwsOutOfBounds(new Runnable() {
+          public void run() {
+            negativeStart(small);
+          }
+        }));
+
+      expect(throwsOutOfBounds(new Runnable() {
+          public void run() {
+            otherArray(small, new int[1]);
+          }
+        }));
+
+      expect(otherArray(small, small) == 15);
+    }
+  }
+}
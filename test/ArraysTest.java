@@ -1,4 +1,6 @@
 import java.util.Arrays;
+import java.util.Comparator;
+import java.util.Random;
 
 public class ArraysTest {
   private static void expect(boolean v) {
@@ -71,6 +73,161 @@ public class ArraysTest {
     expect(exception != null);
   }
 
+  public static void testFill() {
+    // both sides of the point where filling moves to native code
+    for (int length = 0; length < 100; length += 33) {
+      byte[] bytes = new byte[length + 2];
+      Arrays.fill(bytes, 1, length + 1, (byte) -3);
+      expect(bytes[0] == 0 && bytes[length + 1] == 0);
+      for (int i = 1; i <= length; ++i) {
+        expect(bytes[i] == -3);
+      }
+
+      char[] chars = new char[length + 2];
+      Arrays.fill(chars, 1, length + 1, '\uffee');
+      expect(chars[0] == 0 && chars[length + 1] == 0);
+      for (int i = 1; i <= length; ++i) {
+        expect(chars[i] == '\uffee');
+      }
+
+      int[] ints = new int[length];
+      Arrays.fill(ints, -7);
+      for (int i = 0; i < length; ++i) {
+        expect(ints[i] == -7);
+      }
+
+      long[] longs = new long[length];
+      Arrays.fill(longs, 0x123456789abcdefL);
+      for (int i = 0; i < length; ++i) {
+        expect(longs[i] == 0x123456789abcdefL);
+      }
+
+      double[] doubles = new double[length];
+      Arrays.fill(doubles, -0.5);
+      for (int i = 0; i < length; ++i) {
+        expect(doubles[i] == -0.5);
+      }
+
+      boolean[] booleans = new boolean[length];
+      Arrays.fill(booleans, true);
+      for (int i = 0; i < length; ++i) {
+        expect(booleans[i]);
+      }
+    }
+
+    Exception exception = null;
+    try {
+      Arrays.fill(new int[64], 1, 65, 0);
+    } catch (ArrayIndexOutOfBoundsException e) {
+      exception = e;
+    }
+    expect(exception != null);
+  }
+
+  // fills the array with values from one of several distributions
+  // which exercise different paths through the primitive sorts
+  private static void fill(int[] array, int kind, Random random) {
+    for (int i = 0; i < array.length; ++i) {
+      switch (kind) {
+      case 0: array[i] = random.nextInt(); break;
+      case 1: array[i] = random.nextInt(4); break;
+      case 2: array[i] = i; break;
+      case 3: array[i] = array.length - i; break;
+      default: array[i] = i % 17; break;
+      }
+    }
+  }
+
+  public static void testPrimitiveSort() {
+    Random random = new Random(42);
+    int[] lengths = { 0, 1, 2, 46, 47, 48, 1000, 100000 };
+    for (int length: lengths) {
+      for (int kind = 0; kind < 5; ++kind) {
+        int[] ints = new int[length];
+        fill(ints, kind, random);
+        long[] longs = new long[length];
+        for (int i = 0; i < length; ++i) {
+          longs[i] = ((long) ints[i] << 32) - i % 3;
+        }
+
+        Arrays.sort(ints);
+        for (int i = 1; i < length; ++i) {
+          expect(ints[i - 1] <= ints[i]);
+        }
+
+        Arrays.sort(longs);
+        for (int i = 1; i < length; ++i) {
+          expect(longs[i - 1] <= longs[i]);
+        }
+      }
+    }
+
+    int[] a = { 5, 4, 3, 2, 1 };
+    Arrays.sort(a, 1, 4);
+    expect(Arrays.equals(a, new int[] { 5, 2, 3, 4, 1 }));
+  }
+
+  public static void testParallelSort() {
+    Random random = new Random(7);
+    int[] ints = new int[200000];
+    fill(ints, 0, random);
+    int[] intsCopy = ints.clone();
+    Arrays.sort(intsCopy);
+    Arrays.parallelSort(ints);
+    expect(Arrays.equals(ints, intsCopy));
+
+    long[] longs = new long[200000];
+    for (int i = 0; i < longs.length; ++i) {
+      longs[i] = random.nextLong();
+    }
+    long[] longsCopy = longs.clone();
+    Arrays.sort(longsCopy);
+    Arrays.parallelSort(longs);
+    expect(Arrays.equals(longs, longsCopy));
+  }
+
+  private static class Keyed {
+    public final int key;
+    public final int order;
+
+    public Keyed(int key, int order) {
+      this.key = key;
+      this.order = order;
+    }
+  }
+
+  // object sorts must keep elements which compare equal in order,
+  // including when the input is made of presorted runs
+  public static void testStableSort() {
+    Comparator<Keyed> byKey = new Comparator<Keyed>() {
+      public int compare(Keyed a, Keyed b) {
+        return a.key < b.key ? -1 : (a.key > b.key ? 1 : 0);
+      }
+    };
+
+    Random random = new Random(13);
+    for (int run = 0; run < 4; ++run) {
+      Keyed[] array = new Keyed[50000];
+      for (int i = 0; i < array.length; ++i) {
+        int key = run == 0 ? random.nextInt(100)
+          : run == 1 ? (i / 1000) * (i % 2 == 0 ? 1 : -1)
+          : run == 2 ? array.length - i / 7
+          : random.nextInt();
+        array[i] = new Keyed(key, i);
+      }
+
+      Keyed[] copy = array.clone();
+      Arrays.sort(array, byKey);
+      Arrays.parallelSort(copy, byKey);
+      for (int i = 1; i < array.length; ++i) {
+        expect(array[i - 1].key < array[i].key
+               || (array[i - 1].key == array[i].key
+                   && array[i - 1].order < array[i].order));
+        expect(array[i] == copy[i]);
+      }
+    }
+  }
+
   public static void main(String[] args) {
     { int[] array = new int[0];
       Exception exception = null;
@@ -201,6 +358,10 @@ public class ArraysTest {
     }
 
     testSort();
+    testPrimitiveSort();
+    testParallelSort();
+    testStableSort();
     testBinarySearch();
+    testFill();
   }
 }
@@ -0,0 +1,182 @@
+import java.io.File;
+import java.net.InetSocketAddress;
+import java.net.SocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.AsynchronousFileChannel;
+import java.nio.channels.AsynchronousSocketChannel;
+import java.nio.channels.CompletionHandler;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.util.concurrent.ExecutionException;
+
+public class AsynchronousChannels {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Handler implements CompletionHandler<Integer, String> {
+    private boolean done;
+    private Integer result;
+    private String attachment;
+
+    public synchronized void completed(Integer result, String attachment) {
+      this.result = result;
+      this.attachment = attachment;
+      done = true;
+      notifyAll();
+    }
+
+    public synchronized void failed(Throwable exception, String attachment) {
+      exception.printStackTrace();
+      done = true;
+      notifyAll();
+    }
+
+    public synchronized int await(String attachment)
+      throws InterruptedException
+    {
+      while (! done) {
+        wait();
+      }
+      expect(result != null);
+      expect(attachment.equals(this.attachment));
+      return result;
+    }
+  }
+
+  // a handler which throws from completed, which should then see the
+  // exception in failed
+  private static class ThrowingHandler
+    implements CompletionHandler<Integer, String>
+  {
+    private static final RuntimeException Thrown = new RuntimeException();
+
+    private boolean done;
+    private Throwable exception;
+    private String attachment;
+
+    public void completed(Integer result, String attachment) {
+      throw Thrown;
+    }
+
+    public synchronized void failed(Throwable exception, String attachment) {
+      this.exception = exception;
+      this.attachment = attachment;
+      done = true;
+      notifyAll();
+    }
+
+    public synchronized void await(String attachment)
+      throws InterruptedException
+    {
+      while (! done) {
+        wait();
+      }
+      expect(exception == Thrown);
+      expect(attachment.equals(this.attachment));
+    }
+  }
+
+  private static void testFile() throws Exception {
+    File file = new File("asynchronous.bin");
+    try {
+      AsynchronousFileChannel channel
+        = AsynchronousFileChannel.open(file, "rw");
+
+      ByteBuffer src = ByteBuffer.wrap("hello, world!".getBytes());
+      expect(channel.write(src, 10).get() == 13);
+      expect(! src.hasRemaining());
+
+      ByteBuffer direct = ByteBuffer.allocateDirect(10);
+      for (int i = 0; i < 10; ++i) {
+        direct.put((byte) ('0' + i));
+      }
+      direct.flip();
+      Handler handler = new Handler();
+      channel.write(direct, 0, "direct", handler);
+      expect(handler.await("direct") == 10);
+      expect(channel.size() == 23);
+
+      ByteBuffer dst = ByteBuffer.allocate(32);
+      dst.position(1);
+      expect(channel.read(dst, 5).get() == 18);
+      expect(dst.position() == 19);
+      expect("56789hello, world!".equals(new String(dst.array(), 1, 18)));
+
+      direct.clear();
+      handler = new Handler();
+      channel.read(direct, 10, "read", handler);
+      expect(handler.await("read") == 10);
+      expect(direct.get(0) == 'h' && direct.get(9) == 'l');
+
+      ThrowingHandler throwing = new ThrowingHandler();
+      channel.read(ByteBuffer.allocate(4), 0, "throwing", throwing);
+      throwing.await("throwing");
+
+      // at the end of the file
+      expect(channel.read(ByteBuffer.allocate(4), 23).get() == -1);
+
+      channel.close();
+
+      boolean threw = false;
+      try {
+        channel.read(ByteBuffer.allocate(4), 0).get();
+      } catch (ExecutionException e) {
+        threw = true;
+      }
+      expect(threw);
+    } finally {
+      expect(file.delete());
+    }
+  }
+
+  private static void testSocket() throws Exception {
+    final SocketAddress Address = new InetSocketAddress("localhost", 22050);
+
+    ServerSocketChannel server = ServerSocketChannel.open();
+    try {
+      server.socket().bind(Address);
+
+      AsynchronousSocketChannel out = AsynchronousSocketChannel.open();
+      try {
+        out.connect(Address).get();
+        SocketChannel in = server.accept();
+        try {
+          expect(out.write(ByteBuffer.wrap("ping".getBytes())).get() == 4);
+
+          ByteBuffer b = ByteBuffer.allocate(4);
+          while (b.hasRemaining()) {
+            expect(in.read(b) > 0);
+          }
+          expect("ping".equals(new String(b.array())));
+
+          // the read is in flight before anything is written
+          ByteBuffer reply = ByteBuffer.allocate(16);
+          Handler handler = new Handler();
+          out.read(reply, "reply", handler);
+          in.write(ByteBuffer.wrap("pong".getBytes()));
+          expect(handler.await("reply") == 4);
+          expect("pong".equals(new String(reply.array(), 0, 4)));
+
+          in.close();
+          expect(out.read(ByteBuffer.allocate(4)).get() == -1);
+        } finally {
+          in.close();
+        }
+      } finally {
+        out.close();
+      }
+    } finally {
+      server.close();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    testFile();
+
+    // see Sockets.java
+    if (! "true".equals(System.getenv("TRAVIS"))) {
+      testSocket();
+    }
+  }
+}
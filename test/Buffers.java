@@ -1,4 +1,5 @@
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.BufferUnderflowException;
 import java.nio.BufferOverflowException;
 import static avian.testing.Asserts.*;
@@ -102,6 +103,91 @@ public class Buffers {
     }
   }
 
+  private static void testByteOrder(Factory factory) {
+    final int size = 32;
+    ByteBuffer b = factory.allocate(size);
+    try {
+      // values are big-endian whatever the alignment
+      for (int offset = 0; offset < 8; ++offset) {
+        b.putInt(offset, 0x01020304);
+        for (int i = 0; i < 4; ++i)
+          assertEquals(b.get(offset + i), i + 1);
+        assertEquals(b.getInt(offset), 0x01020304);
+
+        b.putShort(offset, (short) 0x0102);
+        assertEquals(b.get(offset), 1);
+        assertEquals(b.get(offset + 1), 2);
+        assertEquals(b.getShort(offset), 0x0102);
+
+        b.putLong(offset, 0x0102030405060708L);
+        for (int i = 0; i < 8; ++i)
+          assertEquals(b.get(offset + i), i + 1);
+        assertTrue(b.getLong(offset) == 0x0102030405060708L);
+      }
+
+      // ...or little-endian if asked, which new views don't inherit
+      b.order(ByteOrder.LITTLE_ENDIAN);
+      assertTrue(b.order() == ByteOrder.LITTLE_ENDIAN);
+      assertTrue(b.duplicate().order() == ByteOrder.BIG_ENDIAN);
+      for (int offset = 0; offset < 8; ++offset) {
+        b.putInt(offset, 0x04030201);
+        for (int i = 0; i < 4; ++i)
+          assertEquals(b.get(offset + i), i + 1);
+        assertEquals(b.getInt(offset), 0x04030201);
+
+        b.putShort(offset, (short) 0x0201);
+        assertEquals(b.get(offset), 1);
+        assertEquals(b.get(offset + 1), 2);
+        assertEquals(b.getShort(offset), 0x0201);
+
+        b.putLong(offset, 0x0807060504030201L);
+        for (int i = 0; i < 8; ++i)
+          assertEquals(b.get(offset + i), i + 1);
+        assertTrue(b.getLong(offset) == 0x0807060504030201L);
+      }
+      b.order(ByteOrder.BIG_ENDIAN);
+
+      b.clear();
+      b.put((byte) 9).putInt(-2).putLong(-3L).putShort((short) -4);
+      assertEquals(15, b.position());
+      b.flip();
+      assertEquals(b.get(), 9);
+      assertEquals(b.getInt(), -2);
+      assertTrue(b.getLong() == -3L);
+      assertEquals(b.getShort(), -4);
+      assertEquals(15, b.position());
+
+      b.position(0);
+      b.get(new byte[5]);
+      assertEquals(5, b.position());
+
+      b.clear();
+      b.position(size - 3);
+      try {
+        b.getInt();
+        assertTrue(false);
+      } catch (BufferUnderflowException e) {
+        // cool
+      }
+
+      try {
+        b.putLong(size - 7, 1L);
+        assertTrue(false);
+      } catch (IndexOutOfBoundsException e) {
+        // cool
+      }
+
+      try {
+        b.getInt(-1);
+        assertTrue(false);
+      } catch (IndexOutOfBoundsException e) {
+        // cool
+      }
+    } finally {
+      factory.dispose(b);
+    }
+  }
+
   private static native ByteBuffer allocateNative(int capacity);
 
   private static native void freeNative(ByteBuffer b);
@@ -158,6 +244,34 @@ public class Buffers {
     testPrimativeGetAndSet(native_, native_);
     testArrays(native_, native_);
 
+    testByteOrder(array);
+    testByteOrder(direct);
+    testByteOrder(native_);
+
+    { byte[] array = new byte[] { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+      ByteBuffer b = ByteBuffer.wrap(array, 1, 8);
+      assertEquals(b.getInt(0), 0x01020304);
+      assertTrue(b.getLong(0) == 0x0102030405060708L);
+      b.putShort(6, (short) -1);
+      assertEquals(array[7], -1);
+      assertEquals(array[8], -1);
+      assertEquals(array[9], 9);
+
+      try {
+        b.getInt(5);
+        assertTrue(false);
+      } catch (IndexOutOfBoundsException e) {
+        // cool
+      }
+
+      try {
+        ByteBuffer.wrap(array, 3, 8);
+        assertTrue(false);
+      } catch (IndexOutOfBoundsException e) {
+        // cool
+      }
+    }
+
     try {
       ByteBuffer.allocate(1).getInt();
       assertTrue(false);
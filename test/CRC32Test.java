@@ -0,0 +1,92 @@
+import java.util.zip.Adler32;
+import java.util.zip.CRC32;
+import java.util.zip.CRC32C;
+import java.util.zip.Checksum;
+
+public class CRC32Test {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) {
+    byte[] check = "123456789".getBytes();
+
+    CRC32 crc = new CRC32();
+    expect(crc.getValue() == 0);
+
+    crc.update(check);
+    expect(crc.getValue() == 0xCBF43926L);
+
+    crc.reset();
+    for (int i = 0; i < check.length; ++i) {
+      crc.update(check[i]);
+    }
+    expect(crc.getValue() == 0xCBF43926L);
+
+    crc.reset();
+    crc.update(check, 0, 4);
+    crc.update(check[4]);
+    crc.update(check, 5, 4);
+    expect(crc.getValue() == 0xCBF43926L);
+
+    boolean threw = false;
+    try {
+      crc.update(check, 5, 5);
+    } catch (ArrayIndexOutOfBoundsException e) {
+      threw = true;
+    }
+    expect(threw);
+    expect(crc.getValue() == 0xCBF43926L);
+
+    expectChecksum(new CRC32C(), check, 0xE3069283L, 0);
+    expectChecksum(new Adler32(), check, 0x091E01DEL, 1);
+    expectChecksum(new CRC32(), check, 0xCBF43926L, 0);
+
+    // the native code handles unaligned heads and tails on its own, so
+    // compare it against byte-at-a-time updates at various offsets
+    byte[] data = new byte[1000];
+    for (int i = 0; i < data.length; ++i) {
+      data[i] = (byte) (i * 31 + (i >> 3));
+    }
+    expectConsistent(new CRC32C(), new CRC32C(), data);
+    expectConsistent(new Adler32(), new Adler32(), data);
+    expectConsistent(new CRC32(), new CRC32(), data);
+  }
+
+  private static void expectChecksum(Checksum c, byte[] check, long value,
+                                     long initial)
+  {
+    expect(c.getValue() == initial);
+
+    c.update(check, 0, check.length);
+    expect(c.getValue() == value);
+
+    c.reset();
+    for (int i = 0; i < check.length; ++i) {
+      c.update(check[i]);
+    }
+    expect(c.getValue() == value);
+
+    c.reset();
+    c.update(check, 0, 3);
+    c.update(check[3]);
+    c.update(check, 4, 5);
+    expect(c.getValue() == value);
+  }
+
+  private static void expectConsistent(Checksum bulk, Checksum single,
+                                       byte[] data)
+  {
+    for (int offset = 0; offset < 9; ++offset) {
+      for (int length = 0; length < data.length - offset; length += 37) {
+        bulk.reset();
+        single.reset();
+        bulk.update(data, offset, length);
+        for (int i = offset; i < offset + length; ++i) {
+          single.update(data[i]);
+        }
+        expect(bulk.getValue() == single.getValue());
+      }
+    }
+  }
+}
@@ -0,0 +1,49 @@
+import avian.Machine;
+
+public class CompileStatistics {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int sum(int[] array) {
+    int sum = 0;
+    for (int i = 0; i < array.length; ++i) {
+      sum += array[i];
+    }
+    return sum;
+  }
+
+  public static void main(String[] args) {
+    long[] before = new long[Machine.JIT_STATISTICS_COUNT];
+    Machine.compileStatistics(before);
+
+    expect(sum(new int[] { 1, 2, 3 }) == 6);
+
+    long[] after = new long[Machine.JIT_STATISTICS_COUNT];
+    Machine.compileStatistics(after);
+
+    if (after[Machine.JIT_CODE_CACHE_CAPACITY] == 0) {
+      // interpreted, so nothing is compiled
+      expect(after[Machine.JIT_METHODS] == 0);
+      return;
+    }
+
+    for (int i = 0; i < Machine.JIT_STATISTICS_COUNT; ++i) {
+      expect(after[i] >= before[i]);
+    }
+
+    if (after[Machine.JIT_METHODS] > before[Machine.JIT_METHODS]) {
+      expect(after[Machine.JIT_BYTECODE] > before[Machine.JIT_BYTECODE]);
+      expect(after[Machine.JIT_EVENTS] > before[Machine.JIT_EVENTS]);
+      expect(after[Machine.JIT_CODE] > before[Machine.JIT_CODE]);
+      expect(after[Machine.JIT_TOTAL_TIME] > before[Machine.JIT_TOTAL_TIME]);
+    }
+
+    expect(after[Machine.JIT_MAX_TIME] <= after[Machine.JIT_TOTAL_TIME]);
+    expect(after[Machine.JIT_CODE_CACHE_USED]
+           <= after[Machine.JIT_CODE_CACHE_CAPACITY]);
+
+    // filling in a short array is fine
+    Machine.compileStatistics(new long[1]);
+  }
+}
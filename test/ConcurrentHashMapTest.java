@@ -14,6 +14,8 @@ public class ConcurrentHashMapTest {
   }
 
   public static void main(String[] args) throws Throwable {
+    testGrowth();
+
     final ConcurrentMap<Integer, Object> map = new ConcurrentHashMap();
     final int[] counter = new int[1];
     final int[] step = new int[1];
@@ -105,6 +107,67 @@ public class ConcurrentHashMapTest {
     }
   }
 
+  // threads adding keys at once resize the table together, and no
+  // key may be lost or counted twice while bins are being moved
+  private static void testGrowth() throws Throwable {
+    final int count = 2000;
+    final ConcurrentMap<Integer, Integer> map = new ConcurrentHashMap();
+    final Throwable[] exception = new Throwable[1];
+
+    Thread[] threads = new Thread[ThreadCount];
+    for (int i = 0; i < ThreadCount; ++i) {
+      final int base = i * count;
+      threads[i] = new Thread() {
+          public void run() {
+            try {
+              for (int j = base; j < base + count; ++j) {
+                expect(map.put(j, j) == null);
+                expect(map.get(j) == j);
+                if (j % 3 == 0) {
+                  expect(map.remove(j) == j);
+                  expect(map.putIfAbsent(j, j) == null);
+                }
+              }
+            } catch (Throwable e) {
+              synchronized (exception) {
+                exception[0] = e;
+              }
+            }
+          }
+        };
+      threads[i].start();
+    }
+
+    for (int i = 0; i < ThreadCount; ++i) {
+      threads[i].join();
+    }
+
+    if (exception[0] != null) {
+      throw exception[0];
+    }
+
+    expect(map.size() == ThreadCount * count);
+    for (int i = 0; i < ThreadCount * count; ++i) {
+      expect(map.get(i) == i);
+    }
+
+    boolean[] seen = new boolean[ThreadCount * count];
+    int entries = 0;
+    for (Map.Entry<Integer, Integer> e: map.entrySet()) {
+      expect(! seen[e.getKey()]);
+      expect(e.getKey().equals(e.getValue()));
+      seen[e.getKey()] = true;
+      ++ entries;
+    }
+    expect(entries == ThreadCount * count);
+
+    map.clear();
+    expect(map.isEmpty());
+    expect(map.get(0) == null);
+
+    expect(new ConcurrentHashMap(100).putIfAbsent(1, 1) == null);
+  }
+
   private static void populateCommon(ConcurrentMap<Integer, Object> map) {
     Object value = new Object();
     for (int i = CommonBase, j = CommonBase + Range; i < j; ++i) {
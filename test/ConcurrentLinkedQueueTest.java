@@ -0,0 +1,111 @@
+import java.util.Iterator;
+import java.util.concurrent.ConcurrentLinkedQueue;
+
+public class ConcurrentLinkedQueueTest {
+  public static void main(String[] args) throws InterruptedException {
+    QueueHelper.sizeTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.isEmptyTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.addTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.addAllTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.elementTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.elementFail(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.removeTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.removeEmptyFail(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.containsTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.containsAllTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.removeObjectTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.removeAllTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.clearTest(new ConcurrentLinkedQueue<Object>());
+    QueueHelper.toArrayTest(new ConcurrentLinkedQueue<Object>());
+    removeTest();
+    concurrentTest();
+  }
+
+  private static void verify(boolean val) {
+    if (! val) {
+      throw new RuntimeException();
+    }
+  }
+
+  // elements removed from the middle are skipped by consumers
+  private static void removeTest() {
+    ConcurrentLinkedQueue<Integer> q = new ConcurrentLinkedQueue<Integer>();
+    for (int i = 0; i < 5; ++i) {
+      q.add(i);
+    }
+
+    verify(q.remove((Object) 1));
+    verify(! q.remove((Object) 1));
+    Iterator<Integer> it = q.iterator();
+    verify(it.next() == 0);
+    verify(it.next() == 2);
+    it.remove();
+
+    verify(q.size() == 3);
+    verify(q.poll() == 0);
+    verify(q.peek() == 3);
+    verify(q.poll() == 3);
+    verify(q.poll() == 4);
+    verify(q.poll() == null);
+  }
+
+  private static void concurrentTest() throws InterruptedException {
+    final ConcurrentLinkedQueue<Integer> q
+      = new ConcurrentLinkedQueue<Integer>();
+    final int threadCount = 4;
+    final int perThread = 1000;
+    final boolean[] seen = new boolean[threadCount * perThread];
+    final int[] taken = new int[1];
+    final Throwable[] exception = new Throwable[1];
+    Thread[] threads = new Thread[threadCount * 2];
+
+    for (int i = 0; i < threadCount; ++i) {
+      final int base = i * perThread;
+      threads[i] = new Thread() {
+          public void run() {
+            for (int j = base; j < base + perThread; ++j) {
+              q.add(j);
+            }
+          }
+        };
+      threads[threadCount + i] = new Thread() {
+          public void run() {
+            try {
+              while (true) {
+                synchronized (seen) {
+                  if (taken[0] == seen.length || exception[0] != null) {
+                    return;
+                  }
+                }
+
+                Integer v = q.poll();
+                if (v != null) {
+                  synchronized (seen) {
+                    verify(! seen[v]);
+                    seen[v] = true;
+                    ++ taken[0];
+                  }
+                } else {
+                  Thread.yield();
+                }
+              }
+            } catch (Throwable e) {
+              synchronized (seen) {
+                exception[0] = e;
+              }
+            }
+          }
+        };
+    }
+
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].start();
+    }
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+    }
+
+    verify(exception[0] == null);
+    verify(q.isEmpty());
+  }
+}
@@ -0,0 +1,52 @@
+public class ContentionProfile {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Lock { }
+
+  private static final Lock lock = new Lock();
+
+  private static void waitForLock() {
+    synchronized (lock) {
+      expect(true);
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    avian.Traces.setContentionProfiling(true);
+
+    Thread waiter = new Thread() {
+        public void run() {
+          waitForLock();
+        }
+      };
+
+    synchronized (lock) {
+      waiter.start();
+      // give the waiter time to give up spinning and block
+      Thread.sleep(200);
+    }
+
+    waiter.join();
+
+    avian.Traces.setContentionProfiling(false);
+
+    boolean found = false;
+    for (String line: avian.Traces.contentionProfile().split("\n")) {
+      // count milliseconds class site owner
+      String[] fields = line.split(" ");
+      expect(fields.length == 5);
+
+      if (fields[2].equals("ContentionProfile$Lock")
+          && fields[3].startsWith("ContentionProfile.waitForLock"))
+      {
+        expect(Integer.parseInt(fields[0]) > 0);
+        expect(Long.parseLong(fields[1]) > 50);
+        found = true;
+      }
+    }
+
+    expect(found);
+  }
+}
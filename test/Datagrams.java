@@ -24,6 +24,66 @@ public class Datagrams {
   public static void main(String[] args) throws Exception {
     test(true);
     test(false);
+    testBatch(true);
+    testBatch(false);
+  }
+
+  private static void testBatch(boolean send) throws Exception {
+    final SocketAddress InAddress = new InetSocketAddress("localhost", 22048);
+    final SocketAddress OutAddress = new InetSocketAddress("localhost", 22049);
+    final String[] Messages = { "one", "two two", "three three three" };
+
+    DatagramChannel out = DatagramChannel.open();
+    try {
+      out.socket().bind(OutAddress);
+      if (! send) out.connect(InAddress);
+
+      DatagramChannel in = DatagramChannel.open();
+      try {
+        in.socket().bind(InAddress);
+
+        ByteBuffer[] outBuffers = new ByteBuffer[Messages.length];
+        SocketAddress[] targets = new SocketAddress[Messages.length];
+        for (int i = 0; i < Messages.length; ++i) {
+          outBuffers[i] = ByteBuffer.wrap(Messages[i].getBytes());
+          targets[i] = InAddress;
+        }
+
+        expect(out.send(outBuffers, send ? targets : null, 0, Messages.length)
+               == Messages.length);
+        for (int i = 0; i < Messages.length; ++i) {
+          expect(! outBuffers[i].hasRemaining());
+        }
+
+        // the last buffer is too small, so its datagram is truncated
+        ByteBuffer[] inBuffers = new ByteBuffer[Messages.length];
+        for (int i = 0; i < Messages.length; ++i) {
+          inBuffers[i] = ByteBuffer.allocate(i == 2 ? 5 : 32);
+        }
+        SocketAddress[] sources = new SocketAddress[Messages.length];
+
+        int received = 0;
+        while (received < Messages.length) {
+          int n = in.receive
+            (inBuffers, sources, received, Messages.length - received);
+          expect(n > 0);
+          received += n;
+        }
+
+        for (int i = 0; i < Messages.length; ++i) {
+          expect(sources[i].equals(OutAddress));
+
+          byte[] message = Messages[i].getBytes();
+          int length = Math.min(message.length, inBuffers[i].capacity());
+          expect(inBuffers[i].position() == length);
+          expect(equal(inBuffers[i].array(), 0, message, 0, length));
+        }
+      } finally {
+        in.close();
+      }
+    } finally {
+      out.close();
+    }
   }
 
   private static void test(boolean send) throws Exception {
@@ -0,0 +1,65 @@
+public class Devirtualization {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int counted;
+
+  private static class Base {
+    public int value() { return 1; }
+
+    // never overridden, and never touches this
+    public void count() { ++ counted; }
+  }
+
+  private static class Inheritor extends Base { }
+
+  // not loaded until we first make one, which is after call has been
+  // compiled to call Base.value directly
+  private static class Overrider extends Base {
+    public int value() { return 2; }
+  }
+
+  private static class Grandchild extends Overrider {
+    public int value() { return 3; }
+  }
+
+  private static int call(Base b) {
+    return b.value();
+  }
+
+  private static void count(Base b) {
+    b.count();
+  }
+
+  // kept out of main so that compiling main doesn't load Overrider
+  private static Base overrider() {
+    return new Overrider();
+  }
+
+  private static Base grandchild() {
+    return new Grandchild();
+  }
+
+  public static void main(String[] args) {
+    for (int i = 0; i < 100; ++i) {
+      expect(call(new Base()) == 1);
+      expect(call(new Inheritor()) == 1);
+    }
+
+    expect(call(overrider()) == 2);
+    expect(call(new Base()) == 1);
+    expect(call(new Inheritor()) == 1);
+    expect(call(grandchild()) == 3);
+    expect(call(overrider()) == 2);
+
+    // the call must throw before the callee runs
+    count(new Base());
+    expect(counted == 1);
+    try {
+      count(null);
+      expect(false);
+    } catch (NullPointerException e) { }
+    expect(counted == 1);
+  }
+}
@@ -0,0 +1,73 @@
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+
+public class Events {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Loaded { }
+
+  public static void main(String[] args) throws Exception {
+    new Loaded();
+    System.gc();
+
+    Thread thread = new Thread() {
+        public void run() { }
+      };
+    thread.start();
+    thread.join();
+
+    File file = File.createTempFile("events", ".txt");
+    avian.Machine.dumpEvents(file.getPath());
+
+    boolean sawGcBegin = false;
+    boolean sawGcEnd = false;
+    boolean sawClassLoad = false;
+    int threadStarts = 0;
+    BufferedReader reader = new BufferedReader(new FileReader(file));
+    try {
+      String line = reader.readLine();
+      expect(line.startsWith("now "));
+
+      long previous = 0;
+      while ((line = reader.readLine()) != null) {
+        if (line.startsWith("thread ")) {
+          previous = 0;
+          continue;
+        }
+
+        // time type value data text
+        String[] fields = line.split(" ");
+        expect(fields.length >= 4);
+
+        long time = Long.parseLong(fields[0]);
+        expect(time >= previous);
+        previous = time;
+
+        if (fields[1].equals("gc.begin")) {
+          sawGcBegin = true;
+        } else if (fields[1].equals("gc.end")) {
+          expect(Long.parseLong(fields[3]) >= 0);
+          sawGcEnd = true;
+        } else if (fields[1].equals("class.load")) {
+          if (fields.length == 5 && fields[4].equals("Events$Loaded")) {
+            sawClassLoad = true;
+          }
+        } else if (fields[1].equals("thread.start")) {
+          ++ threadStarts;
+        }
+      }
+    } finally {
+      reader.close();
+    }
+
+    expect(file.delete());
+
+    expect(sawGcBegin);
+    expect(sawGcEnd);
+    expect(sawClassLoad);
+    expect(threadStarts >= 1);
+  }
+}
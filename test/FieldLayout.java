@@ -0,0 +1,102 @@
+import java.lang.reflect.Field;
+import sun.misc.Unsafe;
+
+public class FieldLayout {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Base {
+    byte b1;
+    Object o1;
+    int i1;
+  }
+
+  private static class Mixed extends Base {
+    short s1;
+    long l1;
+    boolean z1;
+    Object o2;
+    char c1;
+    int i2;
+    double d1;
+    byte b2;
+    float f1;
+    Object o3;
+  }
+
+  private static class Small extends Mixed {
+    byte b3;
+    short s2;
+  }
+
+  private static void fill(Small s) {
+    s.b1 = (byte) 0x81;
+    s.o1 = "o1";
+    s.i1 = 0x11223344;
+    s.s1 = (short) 0x5566;
+    s.l1 = 0x0102030405060708L;
+    s.z1 = true;
+    s.o2 = "o2";
+    s.c1 = '\u7788';
+    s.i2 = 0x99aabbcc;
+    s.d1 = 3.25;
+    s.b2 = (byte) 0x42;
+    s.f1 = 1.5f;
+    s.o3 = "o3";
+    s.b3 = (byte) 0x7f;
+    s.s2 = (short) 0x0bad;
+  }
+
+  private static void check(Small s) {
+    expect(s.b1 == (byte) 0x81);
+    expect(s.o1 == "o1");
+    expect(s.i1 == 0x11223344);
+    expect(s.s1 == (short) 0x5566);
+    expect(s.l1 == 0x0102030405060708L);
+    expect(s.z1);
+    expect(s.o2 == "o2");
+    expect(s.c1 == '\u7788');
+    expect(s.i2 == 0x99aabbcc);
+    expect(s.d1 == 3.25);
+    expect(s.b2 == (byte) 0x42);
+    expect(s.f1 == 1.5f);
+    expect(s.o3 == "o3");
+    expect(s.b3 == (byte) 0x7f);
+    expect(s.s2 == (short) 0x0bad);
+  }
+
+  public static void main(String[] args) throws Exception {
+    Small s = new Small();
+    fill(s);
+    check(s);
+
+    // references must survive being moved by the collector wherever
+    // they were placed among the primitive fields
+    Small[] many = new Small[1000];
+    for (int i = 0; i < many.length; ++i) {
+      many[i] = new Small();
+      fill(many[i]);
+    }
+    System.gc();
+    for (Small m : many) {
+      check(m);
+    }
+
+    // reflection sees the same fields the compiled code does
+    Field f = Mixed.class.getDeclaredField("l1");
+    f.setAccessible(true);
+    expect(f.getLong(s) == 0x0102030405060708L);
+    f = Small.class.getDeclaredField("s2");
+    f.setAccessible(true);
+    f.setShort(s, (short) 0x1234);
+    expect(s.s2 == (short) 0x1234);
+    expect(s.b3 == (byte) 0x7f);
+
+    // a class's own references are placed next to each other
+    Unsafe u = avian.Machine.getUnsafe();
+    long o2 = u.objectFieldOffset(Mixed.class.getDeclaredField("o2"));
+    long o3 = u.objectFieldOffset(Mixed.class.getDeclaredField("o3"));
+    expect(Math.abs(o3 - o2) == u.arrayIndexScale(Object[].class));
+  }
+}
@@ -0,0 +1,73 @@
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+
+public class FileTransfers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static byte[] read(File file) throws IOException {
+    RandomAccessFile f = new RandomAccessFile(file, "r");
+    byte[] bytes = new byte[(int) f.length()];
+    f.readFully(bytes);
+    f.close();
+    return bytes;
+  }
+
+  public static void main(String[] args) throws IOException {
+    File a = new File("transfer-a.bin");
+    File b = new File("transfer-b.bin");
+    try {
+      RandomAccessFile fa = new RandomAccessFile(a, "rw");
+      byte[] bytes = new byte[100 * 1024];
+      for (int i = 0; i < bytes.length; ++i) {
+        bytes[i] = (byte) (i * 7);
+      }
+
+      FileChannel ca = fa.getChannel();
+      expect(ca.write(ByteBuffer.wrap(bytes)) == bytes.length);
+
+      RandomAccessFile fb = new RandomAccessFile(b, "rw");
+      FileChannel cb = fb.getChannel();
+
+      // transferTo writes at, and advances, the target's position, but
+      // leaves the source's alone
+      cb.position(10);
+      expect(ca.transferTo(1000, 80 * 1024, cb) == 80 * 1024);
+      expect(cb.position() == 10 + 80 * 1024);
+
+      byte[] copy = read(b);
+      expect(copy.length == 10 + 80 * 1024);
+      for (int i = 0; i < 80 * 1024; ++i) {
+        expect(copy[10 + i] == bytes[1000 + i]);
+      }
+
+      // a count beyond the end of the source is clipped
+      expect(ca.transferTo(bytes.length - 5, 100, cb) == 5);
+      expect(ca.transferTo(bytes.length, 100, cb) == 0);
+
+      // transferFrom reads from, and advances, the source's position
+      ca.position(50);
+      expect(cb.transferFrom(ca, 0, 100) == 100);
+      expect(ca.position() == 150);
+      copy = read(b);
+      for (int i = 0; i < 100; ++i) {
+        expect(copy[i] == bytes[50 + i]);
+      }
+
+      ByteBuffer buffer = ByteBuffer.allocate(4);
+      expect(cb.read(buffer, 0) == 4);
+      expect(buffer.position() == 4);
+      expect(buffer.get(0) == bytes[50]);
+
+      fa.close();
+      fb.close();
+    } finally {
+      expect(a.delete());
+      expect(b.delete());
+    }
+  }
+}
@@ -0,0 +1,184 @@
+import java.util.Arrays;
+import java.util.Comparator;
+import java.util.Random;
+import java.util.concurrent.Callable;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ForkJoinPool;
+import java.util.concurrent.ForkJoinTask;
+import java.util.concurrent.Future;
+import java.util.concurrent.RecursiveAction;
+import java.util.concurrent.RecursiveTask;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class ForkJoin {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Fibonacci extends RecursiveTask<Integer> {
+    private final int n;
+
+    public Fibonacci(int n) {
+      this.n = n;
+    }
+
+    protected Integer compute() {
+      if (n < 2) {
+        return n;
+      }
+
+      Fibonacci a = new Fibonacci(n - 1);
+      a.fork();
+      return new Fibonacci(n - 2).compute() + a.join();
+    }
+  }
+
+  private static class Count extends RecursiveAction {
+    private final AtomicInteger counter;
+    private final int begin;
+    private final int end;
+
+    public Count(AtomicInteger counter, int begin, int end) {
+      this.counter = counter;
+      this.begin = begin;
+      this.end = end;
+    }
+
+    protected void compute() {
+      if (end - begin <= 16) {
+        counter.addAndGet(end - begin);
+      } else {
+        int middle = (begin + end) >>> 1;
+        invokeAll(new Count(counter, begin, middle),
+                  new Count(counter, middle, end));
+      }
+    }
+  }
+
+  private static class Fail extends RecursiveTask<Integer> {
+    private final int depth;
+
+    public Fail(int depth) {
+      this.depth = depth;
+    }
+
+    protected Integer compute() {
+      if (depth == 0) {
+        throw new IllegalStateException("expected");
+      }
+
+      Fail a = new Fail(depth - 1);
+      a.fork();
+      return new Fibonacci(depth).compute() + a.join();
+    }
+  }
+
+  private static int fibonacci(int n) {
+    return n < 2 ? n : fibonacci(n - 1) + fibonacci(n - 2);
+  }
+
+  private static void computeTest(ForkJoinPool pool) {
+    expect(pool.invoke(new Fibonacci(20)) == fibonacci(20));
+
+    AtomicInteger counter = new AtomicInteger();
+    pool.invoke(new Count(counter, 0, 10000));
+    expect(counter.get() == 10000);
+
+    // forking from outside a pool uses the common pool
+    Fibonacci f = new Fibonacci(15);
+    f.fork();
+    expect(f.join() == fibonacci(15));
+  }
+
+  private static void exceptionTest(ForkJoinPool pool) throws Exception {
+    try {
+      pool.invoke(new Fail(8));
+      expect(false);
+    } catch (IllegalStateException e) {
+      // expected
+    }
+
+    ForkJoinTask<Integer> t = pool.submit(new Fail(4));
+    try {
+      t.get();
+      expect(false);
+    } catch (ExecutionException e) {
+      expect(e.getCause() instanceof IllegalStateException);
+    }
+    expect(t.isCompletedAbnormally());
+  }
+
+  private static void submitTest(ForkJoinPool pool) throws Exception {
+    Future<String> f = pool.submit(new Callable<String>() {
+        public String call() {
+          return "hello";
+        }
+      });
+    expect("hello".equals(f.get()));
+
+    final AtomicInteger counter = new AtomicInteger();
+    Future<?>[] futures = new Future<?>[100];
+    for (int i = 0; i < futures.length; ++i) {
+      futures[i] = pool.submit(new Runnable() {
+          public void run() {
+            counter.incrementAndGet();
+          }
+        });
+    }
+    for (int i = 0; i < futures.length; ++i) {
+      futures[i].get(10, TimeUnit.SECONDS);
+    }
+    expect(counter.get() == futures.length);
+  }
+
+  private static void shutdownTest() throws Exception {
+    ForkJoinPool pool = new ForkJoinPool(2);
+    expect(pool.invoke(new Fibonacci(10)) == fibonacci(10));
+    pool.shutdown();
+    expect(pool.isShutdown());
+    expect(pool.awaitTermination(10, TimeUnit.SECONDS));
+    expect(pool.isTerminated());
+
+    // the common pool ignores shutdown
+    ForkJoinPool.commonPool().shutdown();
+    expect(! ForkJoinPool.commonPool().isShutdown());
+  }
+
+  private static void sortTest() {
+    Random random = new Random(42);
+    Integer[] array = new Integer[100000];
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = random.nextInt();
+    }
+
+    Integer[] copy = array.clone();
+    Arrays.sort(copy);
+    Arrays.parallelSort(array);
+    expect(Arrays.equals(array, copy));
+
+    Arrays.parallelSort(array, new Comparator<Integer>() {
+        public int compare(Integer a, Integer b) {
+          return b.compareTo(a);
+        }
+      });
+    for (int i = 1; i < array.length; ++i) {
+      expect(array[i - 1] >= array[i]);
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    expect(Runtime.getRuntime().availableProcessors() >= 1);
+
+    ForkJoinPool pool = new ForkJoinPool(4);
+    computeTest(ForkJoinPool.commonPool());
+    computeTest(pool);
+    exceptionTest(ForkJoinPool.commonPool());
+    exceptionTest(pool);
+    submitTest(pool);
+    pool.shutdown();
+
+    shutdownTest();
+    sortTest();
+  }
+}
@@ -25,6 +25,7 @@ public class FormatStrings {
     test.testIntegers();
     test.testWidths();
     test.testPrecisions();
+    test.testPlainConversions();
   }
 
   private void _testFormat(String expected, String format, Object... args) {
@@ -293,4 +294,28 @@ public class FormatStrings {
     _testFormat("Hello", "%1.5s", "Hello World");
   }
 
+  // conversions without flags, width or precision take a shorter path,
+  // and compiled patterns are reused, so check the edges and repeats
+  public void testPlainConversions() {
+    _testFormat("-9223372036854775808", "%d", new Long(Long.MIN_VALUE));
+    _testFormat("9223372036854775807", "%d", new Long(Long.MAX_VALUE));
+    _testFormat("-2147483648", "%d", new Integer(Integer.MIN_VALUE));
+    _testFormat("1000000000", "%d", new Integer(1000000000));
+    _testFormat("9", "%d", new Integer(9));
+    _testFormat("0", "%x", new Integer(0));
+    _testFormat("ffffffff", "%x", new Integer(-1));
+    _testFormat("80000000", "%x", new Integer(Integer.MIN_VALUE));
+    _testFormat("7fffffffffffffff", "%x", new Long(Long.MAX_VALUE));
+    _testFormat("10", "%x", new Long(16));
+    _testFormat("[1.5]", "[%s]", new Double(1.5));
+    for (int i = 0; i < 3; ++i) {
+      _testFormat("a=" + i + " b=" + Integer.toHexString(i * 255) + " c=x",
+                  "a=%d b=%x c=%s", new Integer(i), new Integer(i * 255), "x");
+    }
+
+    java.util.Formatter formatter = new java.util.Formatter();
+    formatter.format("%d,", new Integer(1)).format("%s", "two");
+    ensureEquals("1,two", formatter.toString());
+  }
+
 }
@@ -0,0 +1,163 @@
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.IdentityHashMap;
+import java.util.Iterator;
+import java.util.Map;
+
+public class HashMapTest {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // all instances collide, and ordering doesn't help either
+  private static class Colliding {
+    private final int value;
+
+    public Colliding(int value) {
+      this.value = value;
+    }
+
+    public int hashCode() {
+      return 42;
+    }
+
+    public boolean equals(Object o) {
+      return o != null && o.getClass() == getClass()
+        && ((Colliding) o).value == value;
+    }
+  }
+
+  // all instances collide, but they can be ordered
+  private static class ComparableColliding extends Colliding
+    implements Comparable<ComparableColliding>
+  {
+    private final int value;
+
+    public ComparableColliding(int value) {
+      super(value);
+      this.value = value;
+    }
+
+    public int compareTo(ComparableColliding o) {
+      return value < o.value ? -1 : value > o.value ? 1 : 0;
+    }
+  }
+
+  private static void collisionTest(boolean comparable) {
+    final int count = 2000;
+    Map<Object, Integer> map = new HashMap<Object, Integer>();
+    for (int i = 0; i < count; ++i) {
+      Object key = comparable ? new ComparableColliding(i) : new Colliding(i);
+      expect(map.put(key, i) == null);
+    }
+    expect(map.size() == count);
+
+    for (int i = 0; i < count; ++i) {
+      Object key = comparable ? new ComparableColliding(i) : new Colliding(i);
+      expect(map.get(key) == i);
+    }
+    expect(! map.containsKey(new Colliding(-1)));
+    expect(! map.containsKey(new ComparableColliding(-1)));
+
+    for (int i = 0; i < count; i += 2) {
+      Object key = comparable ? new ComparableColliding(i) : new Colliding(i);
+      expect(map.remove(key) == i);
+    }
+    expect(map.size() == count / 2);
+
+    int seen = 0;
+    for (Iterator<Map.Entry<Object, Integer>> it = map.entrySet().iterator();
+         it.hasNext();)
+    {
+      int value = it.next().getValue();
+      expect(value % 2 == 1);
+      ++ seen;
+      if (value % 4 == 1) {
+        it.remove();
+      }
+    }
+    expect(seen == count / 2);
+
+    for (int i = 0; i < count; ++i) {
+      Object key = comparable ? new ComparableColliding(i) : new Colliding(i);
+      expect(map.containsKey(key) == (i % 4 == 3));
+    }
+
+    map.clear();
+    expect(map.isEmpty());
+    expect(map.get(comparable ? new ComparableColliding(3) : new Colliding(3))
+           == null);
+  }
+
+  private static void mixedTest() {
+    // keys of different classes may share a bucket, and so a tree
+    Map<Object, Object> map = new HashMap<Object, Object>();
+    String[] strings = { "Aa", "BB", "AaAa", "BBBB", "AaBB", "BBAa" };
+    for (int i = 0; i < 100; ++i) {
+      map.put(new Colliding(i), "c" + i);
+      map.put(new ComparableColliding(i), "d" + i);
+    }
+    for (String s : strings) {
+      map.put(s, s);
+    }
+    map.put(null, "null");
+    for (int i = 0; i < 100; ++i) {
+      expect(("c" + i).equals(map.get(new Colliding(i))));
+      expect(("d" + i).equals(map.get(new ComparableColliding(i))));
+    }
+    for (String s : strings) {
+      expect(s.equals(map.get(s)));
+    }
+    expect("null".equals(map.get(null)));
+    expect(map.size() == 207);
+  }
+
+  private static void resizeTest() {
+    Map<Integer, Integer> map = new HashMap<Integer, Integer>();
+    for (int i = 0; i < 100000; ++i) {
+      map.put(i * 65536, i);
+    }
+    for (int i = 0; i < 100000; ++i) {
+      expect(map.get(i * 65536) == i);
+    }
+    for (int i = 0; i < 100000; ++i) {
+      if (i % 10 != 0) {
+        expect(map.remove(i * 65536) == i);
+      }
+    }
+    expect(map.size() == 10000);
+    for (int i = 0; i < 100000; ++i) {
+      expect(map.containsKey(i * 65536) == (i % 10 == 0));
+    }
+  }
+
+  private static void identityTest() {
+    Map<Object, Integer> map = new IdentityHashMap<Object, Integer>();
+    ComparableColliding[] keys = new ComparableColliding[50];
+    for (int i = 0; i < keys.length; ++i) {
+      // equal, but not identical
+      keys[i] = new ComparableColliding(7);
+      map.put(keys[i], i);
+    }
+    expect(map.size() == keys.length);
+    for (int i = 0; i < keys.length; ++i) {
+      expect(map.get(keys[i]) == i);
+    }
+    expect(map.get(new ComparableColliding(7)) == null);
+  }
+
+  public static void main(String[] args) {
+    collisionTest(true);
+    collisionTest(false);
+    mixedTest();
+    resizeTest();
+    identityTest();
+
+    HashSet<Colliding> set = new HashSet<Colliding>();
+    for (int i = 0; i < 100; ++i) {
+      expect(set.add(new Colliding(i)));
+      expect(! set.add(new Colliding(i)));
+    }
+    expect(set.size() == 100);
+  }
+}
@@ -0,0 +1,123 @@
+import java.io.BufferedReader;
+import java.io.DataInputStream;
+import java.io.EOFException;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileReader;
+
+public class HeapDumps {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Node {
+    Node next;
+    int value;
+  }
+
+  private static final int Count = 1000;
+
+  private static Node nodes;
+
+  private static void histogram() throws Exception {
+    File file = File.createTempFile("histogram", ".txt");
+    avian.Machine.dumpClassHistogram(file.getPath());
+
+    boolean found = false;
+    long previous = Long.MAX_VALUE;
+    BufferedReader reader = new BufferedReader(new FileReader(file));
+    try {
+      String line;
+      while ((line = reader.readLine()) != null) {
+        // bytes count class
+        String[] fields = line.split(" ");
+        expect(fields.length == 3);
+
+        long bytes = Long.parseLong(fields[0]);
+        expect(bytes <= previous);
+        previous = bytes;
+
+        if (fields[2].equals("HeapDumps$Node")) {
+          expect(Integer.parseInt(fields[1]) >= Count);
+          found = true;
+        }
+      }
+    } finally {
+      reader.close();
+    }
+
+    expect(file.delete());
+    expect(found);
+  }
+
+  private static void hprof() throws Exception {
+    File file = File.createTempFile("heap", ".hprof");
+    avian.Machine.dumpHeapHprof(file.getPath());
+
+    DataInputStream in = new DataInputStream(new FileInputStream(file));
+    try {
+      byte[] magic = "JAVA PROFILE 1.0.2".getBytes();
+      for (int i = 0; i < magic.length; ++i) {
+        expect(in.readByte() == magic[i]);
+      }
+      expect(in.readByte() == 0);
+
+      int idSize = in.readInt();
+      expect(idSize == 4 || idSize == 8);
+      in.readLong();
+
+      boolean sawSegment = false;
+      boolean sawNodeName = false;
+      while (true) {
+        int tag = in.readUnsignedByte();
+        in.readInt();
+        int length = in.readInt();
+
+        if (tag == 0x2C) {
+          expect(length == 0);
+          break;
+        } else if (tag == 0x01) {
+          in.readFully(new byte[idSize]);
+          byte[] name = new byte[length - idSize];
+          in.readFully(name);
+          if (new String(name).equals("HeapDumps$Node")) {
+            sawNodeName = true;
+          }
+        } else {
+          if (tag == 0x1C) {
+            expect(length > 0);
+            sawSegment = true;
+          }
+          in.readFully(new byte[length]);
+        }
+      }
+
+      expect(sawSegment);
+      expect(sawNodeName);
+
+      boolean threw = false;
+      try {
+        in.readByte();
+      } catch (EOFException e) {
+        threw = true;
+      }
+      expect(threw);
+    } finally {
+      in.close();
+    }
+
+    expect(file.delete());
+  }
+
+  public static void main(String[] args) throws Exception {
+    for (int i = 0; i < Count; ++i) {
+      Node n = new Node();
+      n.next = nodes;
+      n.value = i;
+      nodes = n;
+    }
+
+    histogram();
+    hprof();
+  }
+}
@@ -0,0 +1,120 @@
+import java.nio.ByteBuffer;
+import java.util.zip.Deflater;
+import java.util.zip.Inflater;
+
+public class InflaterBuffers {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static byte[] data(int length) {
+    byte[] data = new byte[length];
+    for (int i = 0; i < length; ++i) {
+      data[i] = (byte) ("abcdefgh".charAt(i % 8) ^ (i / 777));
+    }
+    return data;
+  }
+
+  private static ByteBuffer deflate(ByteBuffer input, ByteBuffer output) {
+    Deflater deflater = new Deflater(6, true);
+    deflater.setInput(input);
+    deflater.finish();
+    while (! deflater.finished()) {
+      deflater.deflate(output);
+    }
+    deflater.dispose();
+
+    expect(! input.hasRemaining());
+    output.flip();
+    return output;
+  }
+
+  private static void inflate(ByteBuffer input, ByteBuffer output)
+    throws Exception
+  {
+    Inflater inflater = new Inflater(true);
+    inflater.setInput(input);
+    while (! inflater.finished()) {
+      // small steps, so each call resumes where the last one left off
+      ByteBuffer step = output.duplicate();
+      step.limit(Math.min(output.limit(), output.position() + 1000));
+      int count = inflater.inflate(step);
+      expect(step.position() == output.position() + count);
+      output.position(step.position());
+    }
+    inflater.dispose();
+
+    expect(! input.hasRemaining());
+  }
+
+  private static void expectData(ByteBuffer buffer, byte[] data) {
+    expect(buffer.remaining() == data.length);
+    for (int i = 0; i < data.length; ++i) {
+      expect(buffer.get(buffer.position() + i) == data[i]);
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    byte[] data = data(10000);
+
+    { // heap to direct and back
+      ByteBuffer compressed = deflate
+        (ByteBuffer.wrap(data), ByteBuffer.allocateDirect(20000));
+
+      ByteBuffer output = ByteBuffer.allocate(data.length);
+      inflate(compressed, output);
+      output.flip();
+      expectData(output, data);
+    }
+
+    { // direct to heap and back, at non-zero offsets
+      ByteBuffer input = ByteBuffer.allocateDirect(data.length + 10);
+      input.position(10);
+      input.put(data);
+      input.position(10);
+
+      ByteBuffer compressed = deflate
+        (input, ByteBuffer.wrap(new byte[20010], 10, 20000));
+
+      ByteBuffer output = ByteBuffer.allocateDirect(data.length + 5);
+      output.position(5);
+      inflate(compressed, output);
+      output.position(5);
+      expectData(output, data);
+    }
+
+    { // arrays and buffers mix on the same stream
+      ByteBuffer compressed = deflate
+        (ByteBuffer.wrap(data), ByteBuffer.allocate(20000));
+
+      Inflater inflater = new Inflater(true);
+      inflater.setInput(compressed.array(), 0, compressed.limit());
+      byte[] head = new byte[100];
+      expect(inflater.inflate(head) == head.length);
+
+      ByteBuffer tail = ByteBuffer.allocateDirect(data.length - head.length);
+      while (! inflater.finished()) {
+        inflater.inflate(tail);
+      }
+      inflater.dispose();
+
+      tail.flip();
+      ByteBuffer output = ByteBuffer.allocate(data.length);
+      output.put(head);
+      output.put(tail);
+      output.flip();
+      expectData(output, data);
+    }
+
+    { Inflater inflater = new Inflater(true);
+      boolean threw = false;
+      try {
+        inflater.setInput(new byte[10], 5, 10);
+      } catch (ArrayIndexOutOfBoundsException e) {
+        threw = true;
+      }
+      expect(threw);
+      inflater.dispose();
+    }
+  }
+}
@@ -16,9 +16,39 @@ public class Initializers {
     }
   }
 
+  private static class Counter {
+    public static int count;
+
+    static {
+      // reads and writes count while Counter is still being
+      // initialized, which must not disable the check for later
+      bump();
+      count += 10;
+    }
+
+    public static void bump() {
+      ++ count;
+    }
+  }
+
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // the same static accesses run before and after Counter is
+  // initialized
+  private static int readCounter() {
+    return Counter.count;
+  }
+
   public static void main(String[] args) {
     Object x = new Object();
     System.out.println(Static1.foo);
     x.toString();
+
+    for (int i = 0; i < 100; ++i) {
+      expect(readCounter() == 11 + i);
+      Counter.count = readCounter() + 1;
+    }
   }
 }
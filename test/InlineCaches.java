@@ -0,0 +1,108 @@
+public class InlineCaches {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private interface Shape {
+    int sides();
+  }
+
+  private static class Triangle implements Shape {
+    public int sides() { return 3; }
+  }
+
+  private static class Square implements Shape {
+    public int sides() { return 4; }
+  }
+
+  private static class Pentagon implements Shape {
+    public int sides() { return 5; }
+  }
+
+  private static class Hexagon implements Shape {
+    public int sides() { return 6; }
+  }
+
+  private static class Heptagon implements Shape {
+    public int sides() { return 7; }
+  }
+
+  private static class Octagon extends Square {
+    public int sides() { return 8; }
+  }
+
+  private interface A { int a(); }
+  private interface B { int b(); }
+  private interface C { int c(); }
+  private interface D { int d(); }
+  private interface E extends A, B { int e(); }
+
+  private static class Many implements C, D, E, Shape {
+    public int a() { return 1; }
+    public int b() { return 2; }
+    public int c() { return 3; }
+    public int d() { return 4; }
+    public int e() { return 5; }
+    public int sides() { return 6; }
+  }
+
+  private static class MoreThanMany extends Many { }
+
+  private static int sum(Many m) {
+    return ((A) m).a() + ((B) m).b() + ((C) m).c() + ((D) m).d()
+      + ((E) m).e() + ((Shape) m).sides();
+  }
+
+  private static int sides(Shape s) {
+    return s.sides();
+  }
+
+  private static int sides(Object o) {
+    return o.hashCode();
+  }
+
+  private static int sum(Shape[] shapes) {
+    int sum = 0;
+    for (int i = 0; i < shapes.length; ++i) {
+      sum += sides(shapes[i]);
+    }
+    return sum;
+  }
+
+  public static void main(String[] args) {
+    // monomorphic
+    Shape[] triangles = { new Triangle(), new Triangle(), new Triangle() };
+    for (int i = 0; i < 100; ++i) {
+      expect(sum(triangles) == 9);
+    }
+
+    // polymorphic, then past the size of the cache, including a
+    // subclass overriding its superclass's implementation
+    Shape[] shapes = { new Triangle(), new Square(), new Pentagon(),
+                       new Hexagon(), new Heptagon(), new Octagon() };
+    for (int i = 0; i < 100; ++i) {
+      expect(sum(shapes) == 33);
+      expect(sum(triangles) == 9);
+    }
+
+    // classes implementing enough interfaces to get a hashed
+    // interface index, one of which inherits its superclass's
+    for (int i = 0; i < 100; ++i) {
+      expect(sum(new Many()) == 21);
+      expect(sum(new MoreThanMany()) == 21);
+    }
+
+    Object o = new MoreThanMany();
+    expect(o instanceof A && o instanceof E && o instanceof Shape);
+    expect(! (o instanceof Runnable));
+
+    try {
+      sides((Shape) null);
+      expect(false);
+    } catch (NullPointerException e) { }
+
+    for (int i = 0; i < shapes.length; ++i) {
+      expect(sides((Object) shapes[i]) == shapes[i].hashCode());
+    }
+  }
+}
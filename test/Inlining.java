@@ -0,0 +1,156 @@
+public class Inlining {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private int x;
+  private long y;
+  private byte b;
+  private char c;
+  private double d;
+  private Object o;
+
+  private int x() {
+    return x;
+  }
+
+  private void setX(int x) {
+    this.x = x;
+  }
+
+  private long y() {
+    return y;
+  }
+
+  private void setY(long y) {
+    this.y = y;
+  }
+
+  private byte b() {
+    return b;
+  }
+
+  private void setB(int v) {
+    this.b = (byte) v;
+  }
+
+  private char c() {
+    return c;
+  }
+
+  private void setC(int v) {
+    this.c = (char) v;
+  }
+
+  private double d() {
+    return d;
+  }
+
+  private void setD(double d) {
+    this.d = d;
+  }
+
+  private Object o() {
+    return o;
+  }
+
+  private int sum(int a, int b) {
+    return x + a + b;
+  }
+
+  private long scaled(int a) {
+    return y * a;
+  }
+
+  private static int mix(int a, int b) {
+    return (a ^ b) << 3 | -a;
+  }
+
+  private static long widen(int a, long b) {
+    return (a - b) & 0xFFFF;
+  }
+
+  private static int seven() {
+    return 7;
+  }
+
+  private static int bigConstant() {
+    return 12345;
+  }
+
+  private static final class Point {
+    private final int px;
+    private final int py;
+
+    public Point(int px, int py) {
+      this.px = px;
+      this.py = py;
+    }
+
+    public int px() {
+      return px;
+    }
+
+    public int py() {
+      return py;
+    }
+
+    public int area() {
+      return px * py;
+    }
+  }
+
+  private static int getX(Inlining i) {
+    return i.x();
+  }
+
+  public static void main(String[] args) {
+    Inlining i = new Inlining();
+
+    expect(i.x() == 0);
+    i.setX(42);
+    expect(i.x() == 42);
+
+    i.setY(-5000000000L);
+    expect(i.y() == -5000000000L);
+
+    i.setB(0x1FF);
+    expect(i.b() == -1);
+
+    i.setC(-1);
+    expect(i.c() == 0xFFFF);
+
+    i.setD(2.5);
+    expect(i.d() == 2.5);
+
+    expect(i.o() == null);
+
+    expect(i.sum(1, 2) == 45);
+    expect(i.scaled(2) == -10000000000L);
+
+    expect(mix(5, 3) == ((5 ^ 3) << 3 | -5));
+    expect(widen(3, 70000L) == ((3 - 70000L) & 0xFFFF));
+    expect(seven() == 7);
+    expect(bigConstant() == 12345);
+
+    Point p = new Point(3, 4);
+    expect(p.px() == 3);
+    expect(p.py() == 4);
+    expect(p.area() == 12);
+
+    // a null receiver must throw at the call site
+    try {
+      getX(null);
+      expect(false);
+    } catch (NullPointerException e) {
+      expect(e.getStackTrace()[0].getMethodName().equals("getX"));
+    }
+
+    try {
+      ((Point) null).area();
+      expect(false);
+    } catch (NullPointerException e) {
+      expect(e.getStackTrace()[0].getMethodName().equals("main"));
+    }
+  }
+}
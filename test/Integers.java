@@ -366,5 +366,18 @@ public class Integers {
     expect(291 == Integer.decode("#123").intValue());
 
     testNumberOfLeadingZeros();
+
+    { Integer a = 127;
+      Integer b = 127;
+      expect(a == b);
+      expect(Integer.valueOf(-128) == Integer.valueOf(-128));
+      expect(Integer.valueOf(1000).intValue() == 1000);
+      expect(Long.valueOf(-1) == Long.valueOf(-1));
+      expect(Long.valueOf(128).longValue() == 128);
+      expect(Short.valueOf((short) 5) == Short.valueOf((short) 5));
+      expect(Byte.valueOf((byte) -1) == Byte.valueOf((byte) -1));
+      expect(Character.valueOf('a') == Character.valueOf('a'));
+      expect(Character.valueOf('\u00e9').charValue() == '\u00e9');
+    }
   }
 }
@@ -0,0 +1,70 @@
+public class Interning {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static final int NameCount = 500;
+
+  private static String name(int i) {
+    return new StringBuilder().append("element").append(i).toString();
+  }
+
+  public static void main(String[] args) throws Exception {
+    final String[] names = new String[NameCount];
+    for (int i = 0; i < NameCount; ++i) {
+      names[i] = name(i).intern();
+    }
+
+    expect(names[0] == "element0".intern());
+    expect(names[0] != name(0));
+
+    // strings interned from other threads, some of which find what's
+    // already there and some of which have to add to the table, must
+    // all agree
+    final String[][] results = new String[4][NameCount * 2];
+    Thread[] threads = new Thread[results.length];
+    for (int i = 0; i < threads.length; ++i) {
+      final String[] result = results[i];
+      threads[i] = new Thread() {
+          public void run() {
+            for (int j = 0; j < result.length; ++j) {
+              result[j] = name(j).intern();
+            }
+          }
+        };
+      threads[i].start();
+    }
+
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+    }
+
+    for (int i = 0; i < results.length; ++i) {
+      for (int j = 0; j < NameCount; ++j) {
+        expect(results[i][j] == names[j]);
+      }
+      for (int j = NameCount; j < NameCount * 2; ++j) {
+        expect(results[i][j] == results[0][j]);
+        expect(results[i][j].equals(name(j)));
+      }
+    }
+
+    // strings nobody refers to any more may be dropped from the table,
+    // but the ones we still hold must stay put
+    results[0] = null;
+    results[1] = null;
+    results[2] = null;
+    results[3] = null;
+    for (int i = 0; i < 3; ++i) {
+      System.gc();
+    }
+
+    for (int i = 0; i < NameCount; ++i) {
+      expect(name(i).intern() == names[i]);
+    }
+
+    String s = name(NameCount).intern();
+    expect(s.equals(name(NameCount)));
+    expect(s == name(NameCount).intern());
+  }
+}
@@ -0,0 +1,121 @@
+public class Intrinsics {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static boolean equal(String a, Object b) {
+    return a.equals(b);
+  }
+
+  public static void main(String[] args) {
+    { String a = "hello";
+      String b = new StringBuilder("hel").append("lo").toString();
+      expect(equal(a, a));
+      expect(equal(a, b));
+      expect(! equal(a, "hellO"));
+      expect(! equal(a, "hell"));
+      expect(! equal(a, null));
+      expect(! equal(a, new Object()));
+      expect(! equal("", "x"));
+      expect(equal(a.substring(1, 3), "el"));
+
+      boolean threw = false;
+      try {
+        equal(null, a);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+    }
+
+    { int[] a = new int[] { 1, 2, 3, 4 };
+      int[] b = new int[4];
+      System.arraycopy(a, 1, b, 0, 3);
+      expect(b[0] == 2 && b[1] == 3 && b[2] == 4 && b[3] == 0);
+
+      System.arraycopy(a, 0, a, 1, 3);
+      expect(a[0] == 1 && a[1] == 1 && a[2] == 2 && a[3] == 3);
+
+      Object[] o = new Object[2];
+      System.arraycopy(new String[] { "x", "y" }, 0, o, 0, 2);
+      expect(o[0] == "x" && o[1] == "y");
+
+      boolean threw = false;
+      try {
+        System.arraycopy(a, 2, b, 0, 3);
+      } catch (IndexOutOfBoundsException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      threw = false;
+      try {
+        System.arraycopy(null, 0, b, 0, 1);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      threw = false;
+      try {
+        System.arraycopy(a, 0, new long[4], 0, 1);
+      } catch (ArrayStoreException e) {
+        threw = true;
+      }
+      expect(threw);
+    }
+
+    { // big enough to take the streaming path, at unaligned offsets
+      byte[] a = new byte[3 * 1024 * 1024];
+      for (int i = 0; i < a.length; ++i) {
+        a[i] = (byte) (i * 7);
+      }
+      byte[] b = new byte[a.length];
+      System.arraycopy(a, 3, b, 5, a.length - 8);
+      expect(b[4] == 0 && b[b.length - 3] == 0);
+      for (int i = 5; i < b.length - 3; ++i) {
+        expect(b[i] == (byte) ((i - 2) * 7));
+      }
+    }
+
+    { int[] ints = new int[] { 0, 1, -1, 0x80000000, 0x7fffffff, 0x00f0f000 };
+      int[] intBits = new int[] { 0, 1, 32, 1, 31, 8 };
+      int[] intZeros = new int[] { 32, 31, 0, 0, 1, 8 };
+      for (int i = 0; i < ints.length; ++i) {
+        expect(Integer.bitCount(ints[i]) == intBits[i]);
+        expect(Integer.numberOfLeadingZeros(ints[i]) == intZeros[i]);
+      }
+
+      long[] longs = new long[] { 0, 1, -1, 0x8000000000000000L,
+                                  0x00000000ffffffffL, 0x0000f00000000000L };
+      int[] longBits = new int[] { 0, 1, 64, 1, 32, 4 };
+      int[] longZeros = new int[] { 64, 63, 0, 0, 32, 16 };
+      for (int i = 0; i < longs.length; ++i) {
+        expect(Long.bitCount(longs[i]) == longBits[i]);
+        expect(Long.numberOfLeadingZeros(longs[i]) == longZeros[i]);
+      }
+
+      // constant operands are folded by the compiler
+      expect(Integer.bitCount(0xff) == 8);
+      expect(Long.numberOfLeadingZeros(1L) == 63);
+    }
+
+    { // an array old enough to be tenured must still keep the young
+      // objects copied into it alive
+      Object[] old = new Object[5000];
+      for (int i = 0; i < 4; ++i) {
+        System.gc();
+      }
+      Object[] young = new Object[old.length];
+      for (int i = 0; i < young.length; ++i) {
+        young[i] = new Integer(i);
+      }
+      System.arraycopy(young, 0, old, 0, young.length);
+      young = null;
+      System.gc();
+      for (int i = 0; i < old.length; ++i) {
+        expect(((Integer) old[i]).intValue() == i);
+      }
+    }
+  }
+}
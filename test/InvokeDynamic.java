@@ -79,6 +79,31 @@ public class InvokeDynamic {
     for (int i = 0; i < 4; ++i) {
       new InvokeDynamic(i).test();
     }
+
+    linkedSites();
+  }
+
+  private static Operation nonCapturing() {
+    return (a, b) -> a * b;
+  }
+
+  private static Operation capturing(int c) {
+    return (a, b) -> a * b + c;
+  }
+
+  // each site is linked on its first execution, so later ones
+  // exercise the linked path
+  private static void linkedSites() {
+    Operation first = nonCapturing();
+    for (int i = 0; i < 100; ++i) {
+      Operation op = nonCapturing();
+      expect(op == first);
+      expect(op.operate(i, 3) == i * 3);
+
+      Operation op2 = capturing(i);
+      expect(op2 != capturing(i));
+      expect(op2.operate(i, 3) == i * 3 + i);
+    }
   }
 
   private interface Foo extends java.io.Serializable {
@@ -76,6 +76,29 @@ public class JNI {
 
   private static native Object testLocalRef(Object o);
 
+  private static native long sumCritical(int[] a, long b, byte[] c);
+
+  private static native boolean collectWhileCritical(byte[] array);
+
+  private static native int makeLocalRefs(Object[] array, int frames);
+
+  private static native long sumFields(Object a, Object b, int rounds);
+
+  private static class Point {
+    public int x = 1;
+    public long y = 2;
+    public volatile double z = 3.5;
+    public String name = "ab";
+
+    public int m() { return 4; }
+  }
+
+  private static class Shadow extends Point {
+    public int x = 10;
+
+    public int m() { return 40; }
+  }
+
   public static int method242() { return 242; }
   
   public static final int field950 = 950;
@@ -137,5 +160,41 @@ public class JNI {
     { Object o = new Object();
       expect(testLocalRef(o) == o);
     }
+
+    { Object[] array = new Object[300];
+      for (int i = 0; i < array.length; ++i) {
+        array[i] = new Object();
+      }
+      expect(makeLocalRefs(array, 10) == array.length * 10);
+    }
+
+    // repeated lookups are served from the ID cache, which must still
+    // tell a field from the one it shadows
+    expect(sumFields(new Point(), new Shadow(), 100) == (12 + 57) * 100);
+
+    expect(sumCritical(new int[] { 1, 2, 3 }, 40000000000L,
+                       new byte[] { 10, 20 }) == 40000000036L);
+    expect(sumCritical(new int[] { 5 }, -7, null) == -2);
+
+    { // an array too big for a thread heap is fixed, so holding it
+      // critical mustn't keep other threads from collecting garbage
+      final byte[] array = new byte[1024 * 1024];
+      Thread collector = new Thread() {
+          public void run() {
+            try {
+              while (array[1] == 0) {
+                Thread.sleep(1);
+              }
+            } catch (InterruptedException e) {
+              throw new RuntimeException(e);
+            }
+            System.gc();
+            array[0] = 1;
+          }
+        };
+      collector.start();
+      expect(collectWhileCritical(array));
+      collector.join();
+    }
   }
 }
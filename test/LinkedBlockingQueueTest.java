@@ -1,4 +1,6 @@
+import java.util.Iterator;
 import java.util.LinkedList;
+import java.util.concurrent.BlockingQueue;
 import java.util.concurrent.LinkedBlockingQueue;
 import java.util.concurrent.TimeUnit;
 
@@ -27,6 +29,8 @@ public class LinkedBlockingQueueTest {
     QueueHelper.removeTest(new LinkedBlockingQueue<Object>());
     drainToTest();
     drainToLimitTest();
+    iteratorTest();
+    handoffTest(new LinkedBlockingQueue<Integer>(4));
     QueueHelper.containsTest(new LinkedBlockingQueue<Object>());
     QueueHelper.containsAllTest(new LinkedBlockingQueue<Object>());
     QueueHelper.removeObjectTest(new LinkedBlockingQueue<Object>());
@@ -205,4 +209,81 @@ public class LinkedBlockingQueueTest {
     verify(drainToResult.size() == limit);
     verify(lbq.size() == objQty - limit);
   }
+
+  private static void iteratorTest() {
+    LinkedBlockingQueue<Object> lbq = new LinkedBlockingQueue<Object>();
+    Object a = new Object();
+    Object b = new Object();
+    Object c = new Object();
+    lbq.add(a);
+    lbq.add(b);
+    lbq.add(c);
+
+    Iterator<Object> it = lbq.iterator();
+    verify(it.next() == a);
+    // elements taken after the iterator has passed them don't matter
+    verify(lbq.poll() == a);
+    verify(it.next() == b);
+    it.remove();
+    verify(it.next() == c);
+    verify(! it.hasNext());
+
+    verify(lbq.size() == 1);
+    verify(lbq.peek() == c);
+  }
+
+  // producers and consumers which block on a small queue get every
+  // element through exactly once
+  static void handoffTest(final BlockingQueue<Integer> q)
+    throws InterruptedException
+  {
+    final int threadCount = 4;
+    final int perThread = 1000;
+    final boolean[] seen = new boolean[threadCount * perThread];
+    final Throwable[] exception = new Throwable[1];
+    Thread[] threads = new Thread[threadCount * 2];
+
+    for (int i = 0; i < threadCount; ++i) {
+      final int base = i * perThread;
+      threads[i] = new Thread() {
+          public void run() {
+            try {
+              for (int j = base; j < base + perThread; ++j) {
+                q.put(j);
+              }
+            } catch (Throwable e) {
+              exception[0] = e;
+            }
+          }
+        };
+      threads[threadCount + i] = new Thread() {
+          public void run() {
+            try {
+              for (int j = 0; j < perThread; ++j) {
+                int v = q.take();
+                synchronized (seen) {
+                  verify(! seen[v]);
+                  seen[v] = true;
+                }
+              }
+            } catch (Throwable e) {
+              exception[0] = e;
+            }
+          }
+        };
+    }
+
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].start();
+    }
+    for (int i = 0; i < threads.length; ++i) {
+      threads[i].join();
+    }
+
+    verify(exception[0] == null);
+    verify(q.isEmpty());
+    for (int i = 0; i < seen.length; ++i) {
+      verify(seen[i]);
+    }
+  }
 }
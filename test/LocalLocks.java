@@ -0,0 +1,111 @@
+public class LocalLocks {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int counter;
+
+  private static int lockLocal(int n) {
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+      Object lock = new Object();
+      synchronized (lock) {
+        sum += i;
+      }
+      synchronized (lock) {
+        sum += i;
+      }
+    }
+    return sum;
+  }
+
+  private static int lockNew(int n) {
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+      synchronized (new Object()) {
+        sum += i;
+      }
+    }
+    return sum;
+  }
+
+  private static int lockAndThrow(int n) {
+    int caught = 0;
+    for (int i = 0; i < n; ++i) {
+      Object lock = new Object();
+      try {
+        synchronized (lock) {
+          if ((i & 1) == 0) {
+            throw new IllegalStateException();
+          }
+        }
+      } catch (IllegalStateException e) {
+        ++caught;
+      }
+    }
+    return caught;
+  }
+
+  private static void lockNested() {
+    Object outer = new Object();
+    Object inner = new Object();
+    synchronized (outer) {
+      synchronized (inner) {
+        synchronized (outer) {
+          ++ counter;
+        }
+      }
+    }
+  }
+
+  // the lock reaches wait and notify, so it must really be held
+  private static void lockAndNotify() throws InterruptedException {
+    Object lock = new Object();
+    synchronized (lock) {
+      lock.notifyAll();
+      lock.wait(1);
+    }
+
+    expect(! Thread.holdsLock(lock));
+  }
+
+  // the lock is shared with another thread, so it must really be held
+  private static void lockShared() throws InterruptedException {
+    final Object lock = new Object();
+    final int[] count = new int[1];
+
+    Thread thread = new Thread() {
+        public void run() {
+          for (int i = 0; i < 100000; ++i) {
+            synchronized (lock) {
+              ++ count[0];
+            }
+          }
+        }
+      };
+
+    thread.start();
+
+    for (int i = 0; i < 100000; ++i) {
+      synchronized (lock) {
+        ++ count[0];
+      }
+    }
+
+    thread.join();
+
+    expect(count[0] == 200000);
+  }
+
+  public static void main(String[] args) throws Exception {
+    expect(lockLocal(100) == 9900);
+    expect(lockNew(100) == 4950);
+    expect(lockAndThrow(100) == 50);
+
+    lockNested();
+    expect(counter == 1);
+
+    lockAndNotify();
+    lockShared();
+  }
+}
@@ -0,0 +1,83 @@
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.MappedByteBuffer;
+import java.nio.ReadOnlyBufferException;
+import java.nio.channels.FileChannel;
+import java.nio.channels.NonWritableChannelException;
+
+public class MappedFiles {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) throws IOException {
+    File file = new File("mapped.bin");
+    try {
+      RandomAccessFile f = new RandomAccessFile(file, "rw");
+      FileChannel c = f.getChannel();
+
+      // mapping past the end of the file grows it to fit
+      MappedByteBuffer b = c.map(FileChannel.MapMode.READ_WRITE, 0, 8192);
+      expect(b.capacity() == 8192);
+      expect(f.length() == 8192);
+
+      for (int i = 0; i < 8192; ++i) {
+        b.put(i, (byte) i);
+      }
+      b.putInt(5000, 0x01020304);
+      b.force();
+
+      // a view keeps working once the original buffer is unreachable
+      ByteBuffer slice = ((ByteBuffer) b.position(4096)).slice();
+      b = null;
+      System.gc();
+      expect(slice.get(0) == (byte) 4096);
+      expect(slice.getInt(5000 - 4096) == 0x01020304);
+      f.close();
+
+      FileInputStream in = new FileInputStream(file);
+      byte[] bytes = new byte[8192];
+      int offset = 0;
+      int count;
+      while ((count = in.read(bytes, offset, bytes.length - offset)) > 0) {
+        offset += count;
+      }
+      in.close();
+      expect(offset == 8192);
+      expect(bytes[100] == 100);
+      expect(bytes[5003] == 4);
+
+      f = new RandomAccessFile(file, "r");
+      c = f.getChannel();
+
+      // an unaligned position
+      b = c.map(FileChannel.MapMode.READ_ONLY, 5000, 4);
+      expect(b.isReadOnly());
+      expect(b.getInt(0) == 0x01020304);
+
+      boolean threw = false;
+      try {
+        b.put(0, (byte) 0);
+      } catch (ReadOnlyBufferException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      threw = false;
+      try {
+        c.map(FileChannel.MapMode.READ_WRITE, 0, 1);
+      } catch (NonWritableChannelException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      expect(c.map(FileChannel.MapMode.READ_ONLY, 0, 0).capacity() == 0);
+      f.close();
+    } finally {
+      expect(file.delete());
+    }
+  }
+}
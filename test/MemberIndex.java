@@ -0,0 +1,68 @@
+public class MemberIndex {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  // enough fields and methods that the VM indexes them by name and spec
+  private static class Base {
+    public int f0, f1, f2, f3, f4, f5, f6, f7, f8, f9;
+    public long g0, g1, g2, g3, g4, g5, g6, g7, g8, g9;
+
+    public int m(int x) { return x + 1; }
+    public int m(long x) { return (int) x + 2; }
+    public int m(String x) { return x.length() + 3; }
+    public int m(int x, int y) { return x + y; }
+
+    public int a0() { return 0; }
+    public int a1() { return 1; }
+    public int a2() { return 2; }
+    public int a3() { return 3; }
+    public int a4() { return 4; }
+    public int a5() { return 5; }
+    public int a6() { return 6; }
+    public int a7() { return 7; }
+    public int a8() { return 8; }
+    public int a9() { return 9; }
+    public int b0() { return 10; }
+    public int b1() { return 11; }
+    public int b2() { return 12; }
+    public int b3() { return 13; }
+    public int b4() { return 14; }
+    public int b5() { return 15; }
+  }
+
+  private static class Derived extends Base {
+    public int h;
+
+    public int m(String x) { return x.length() + 4; }
+  }
+
+  public static void main(String[] args) throws Exception {
+    Derived d = new Derived();
+    d.f7 = 7;
+    d.g9 = 9;
+    d.h = 1;
+    expect(d.f7 + d.g9 + d.h == 17);
+
+    Base b = d;
+    expect(b.m(1) == 2);
+    expect(b.m(1L) == 3);
+    expect(b.m("x") == 5);
+    expect(b.m(2, 3) == 5);
+    expect(b.a0() + b.a9() + b.b5() == 24);
+
+    expect(Base.class.getField("g9").getLong(d) == 9);
+    expect(Derived.class.getField("f7").getInt(d) == 7);
+    expect(((Integer) Base.class.getMethod("m", String.class).invoke(d, "xy"))
+           == 6);
+    expect(((Integer) Base.class.getMethod("b3").invoke(d)) == 13);
+
+    boolean threw = false;
+    try {
+      Base.class.getMethod("m", Object.class);
+    } catch (NoSuchMethodException e) {
+      threw = true;
+    }
+    expect(threw);
+  }
+}
@@ -0,0 +1,77 @@
+public class MonitorCache {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static int counter;
+
+  private static synchronized void increment() {
+    ++ counter;
+  }
+
+  // the lock may move while held, so the monitor found on release must
+  // still be the one acquired
+  private static void holdAcrossCollection(Object lock) {
+    synchronized (lock) {
+      System.gc();
+      expect(Thread.holdsLock(lock));
+    }
+    expect(! Thread.holdsLock(lock));
+  }
+
+  private static void alternate(Object a, Object b) {
+    for (int i = 0; i < 1000; ++i) {
+      synchronized (a) {
+        synchronized (b) {
+          expect(Thread.holdsLock(a));
+          expect(Thread.holdsLock(b));
+        }
+        expect(Thread.holdsLock(a));
+        expect(! Thread.holdsLock(b));
+      }
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    final Object a = new Object();
+    Object b = new Object();
+
+    holdAcrossCollection(a);
+    alternate(a, b);
+    holdAcrossCollection(b);
+
+    // monitors for dead objects are discarded by the collector; make
+    // sure a new object at a reused address gets a fresh one
+    for (int i = 0; i < 100; ++i) {
+      Object o = new Object();
+      synchronized (o) {
+        expect(Thread.holdsLock(o));
+      }
+      if (i % 10 == 0) {
+        System.gc();
+      }
+    }
+
+    Thread thread = new Thread() {
+        public void run() {
+          for (int i = 0; i < 10000; ++i) {
+            increment();
+          }
+          synchronized (a) {
+            a.notifyAll();
+          }
+        }
+      };
+
+    synchronized (a) {
+      thread.start();
+      for (int i = 0; i < 10000; ++i) {
+        increment();
+      }
+      a.wait();
+    }
+    thread.join();
+
+    expect(counter == 20000);
+  }
+}
@@ -0,0 +1,87 @@
+public class Notify {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static final Object lock = new Object();
+  private static int waiting;
+  private static int woken;
+  private static int generation;
+
+  private static Thread waiter(final long timeout) {
+    Thread thread = new Thread() {
+        public void run() {
+          try {
+            synchronized (lock) {
+              int g = generation;
+              ++ waiting;
+              lock.notifyAll();
+              while (g == generation) {
+                lock.wait(timeout);
+              }
+              // we must own the monitor again by the time wait returns
+              expect(Thread.holdsLock(lock));
+              ++ woken;
+            }
+          } catch (InterruptedException e) {
+            throw new RuntimeException(e);
+          }
+        }
+      };
+    thread.start();
+    return thread;
+  }
+
+  private static void awaitWaiters(int count) throws Exception {
+    synchronized (lock) {
+      while (waiting < count) {
+        lock.wait();
+      }
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    final int count = 8;
+
+    // every waiter must get the monitor back after notifyAll, one at
+    // a time, including those using timed waits
+    Thread[] threads = new Thread[count];
+    for (int i = 0; i < count; ++i) {
+      threads[i] = waiter(i % 2 == 0 ? 0 : 5);
+    }
+    awaitWaiters(count);
+
+    synchronized (lock) {
+      ++ generation;
+      lock.notifyAll();
+      // nobody can run until we let go of the monitor
+      expect(woken == 0);
+    }
+
+    for (int i = 0; i < count; ++i) {
+      threads[i].join();
+    }
+    expect(woken == count);
+
+    // notify wakes waiters one by one
+    waiting = 0;
+    woken = 0;
+    for (int i = 0; i < count; ++i) {
+      threads[i] = waiter(0);
+    }
+    awaitWaiters(count);
+
+    synchronized (lock) {
+      ++ generation;
+    }
+    for (int i = 0; i < count; ++i) {
+      synchronized (lock) {
+        lock.notify();
+      }
+    }
+    for (int i = 0; i < count; ++i) {
+      threads[i].join();
+    }
+    expect(woken == count);
+  }
+}
@@ -0,0 +1,81 @@
+public class ParallelClassLoading {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class A { }
+  private static class B extends A { }
+  private static class C extends B { }
+  private static class D extends A { }
+  private static class E extends D { }
+
+  private static final String[] names = {
+    "ParallelClassLoading$C", "ParallelClassLoading$E",
+    "ParallelClassLoading$B", "ParallelClassLoading$D",
+    "ParallelClassLoading$A"
+  };
+
+  private static final Object lock = new Object();
+  private static boolean go;
+
+  public static void main(String[] args) throws Exception {
+    int threadCount = 8;
+    final Class[][] results = new Class[threadCount][];
+    Thread[] threads = new Thread[threadCount];
+
+    for (int i = 0; i < threadCount; ++i) {
+      final int index = i;
+      threads[i] = new Thread() {
+          public void run() {
+            synchronized (lock) {
+              while (! go) {
+                try {
+                  lock.wait();
+                } catch (InterruptedException e) {
+                  throw new RuntimeException(e);
+                }
+              }
+            }
+
+            Class[] classes = new Class[names.length];
+            for (int j = 0; j < names.length; ++j) {
+              // start each thread at a different name so they race on
+              // both the same class and on classes sharing a superclass
+              int k = (j + index) % names.length;
+              try {
+                classes[k] = Class.forName(names[k]);
+              } catch (ClassNotFoundException e) {
+                throw new RuntimeException(e);
+              }
+            }
+            results[index] = classes;
+          }
+        };
+      threads[i].start();
+    }
+
+    synchronized (lock) {
+      go = true;
+      lock.notifyAll();
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+      threads[i].join();
+    }
+
+    // every thread must see the same class object for a given name
+    for (int i = 0; i < threadCount; ++i) {
+      expect(results[i] != null);
+      for (int j = 0; j < names.length; ++j) {
+        expect(results[i][j] == results[0][j]);
+        expect(results[i][j].getName().equals(names[j]));
+      }
+    }
+
+    expect(results[0][0].getSuperclass() == results[0][2]);
+    expect(results[0][1].getSuperclass() == results[0][3]);
+    expect(results[0][2].getSuperclass() == results[0][4]);
+    expect(results[0][3].getSuperclass() == results[0][4]);
+    expect(new C() instanceof A);
+  }
+}
@@ -0,0 +1,56 @@
+import java.util.concurrent.locks.LockSupport;
+
+public class Park {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static volatile boolean done;
+
+  public static void main(String[] args) throws Exception {
+    // a permit granted before we park is consumed immediately, and
+    // permits don't accumulate:
+    LockSupport.unpark(Thread.currentThread());
+    LockSupport.unpark(Thread.currentThread());
+    LockSupport.park();
+
+    long start = System.currentTimeMillis();
+    LockSupport.parkNanos(50L * 1000 * 1000);
+    expect(System.currentTimeMillis() - start >= 40);
+
+    start = System.currentTimeMillis();
+    LockSupport.parkUntil(start + 50);
+    expect(System.currentTimeMillis() - start >= 40);
+
+    Thread t = new Thread() {
+        public void run() {
+          while (! done) {
+            LockSupport.park();
+          }
+        }
+      };
+    t.start();
+
+    Thread.sleep(50);
+    done = true;
+    LockSupport.unpark(t);
+    t.join();
+
+    // an interrupt wakes a parked thread, and park returns immediately
+    // as long as the thread remains interrupted:
+    t = new Thread() {
+        public void run() {
+          while (! Thread.currentThread().isInterrupted()) {
+            LockSupport.park();
+          }
+          LockSupport.park();
+          expect(Thread.interrupted());
+        }
+      };
+    t.start();
+
+    Thread.sleep(50);
+    t.interrupt();
+    t.join();
+  }
+}
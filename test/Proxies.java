@@ -31,6 +31,26 @@ public class Proxies {
     expect(foo.baz(42) == 43);
     expect(foo.bim(42L) == 41L);
     expect(foo.boom("hello").equals("ello"));
+
+    // proxies for the same loader and interfaces share a class
+    InvocationHandler echo = new InvocationHandler() {
+        public Object invoke(Object proxy, Method method, Object[] arguments)
+        {
+          return method.getName();
+        }
+      };
+
+    for (int i = 0; i < 10; ++i) {
+      Foo other = (Foo) Proxy.newProxyInstance
+        (Proxies.class.getClassLoader(), new Class[] { Foo.class }, echo);
+      expect(other.getClass() == foo.getClass());
+      expect(other.bar().equals("bar"));
+      expect(other.boom("hello").equals("boom"));
+    }
+
+    expect(Proxy.getProxyClass
+           (Proxies.class.getClassLoader(), Foo.class, Bar.class)
+           != foo.getClass());
   }
 
   private interface Foo {
@@ -39,4 +59,8 @@ public class Proxies {
     public long bim(long v);
     public String boom(String s);
   }
+
+  private interface Bar {
+    public void bar(int v);
+  }
 }
@@ -0,0 +1,104 @@
+public class Quickening {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private int i;
+  private float f;
+  private long l;
+  private byte b;
+  private Object o;
+  private volatile int v;
+
+  private static int initCount;
+
+  private static class Initialized {
+    static {
+      ++ initCount;
+    }
+
+    static int count() {
+      return initCount;
+    }
+  }
+
+  private static class Base {
+    public int get() {
+      return 1;
+    }
+  }
+
+  private static class Derived extends Base {
+    public int get() {
+      return 2;
+    }
+  }
+
+  private static class Grandchild extends Derived {
+    public int get() {
+      return super.get() + 10;
+    }
+  }
+
+  private static int read(Quickening q) {
+    return q.i + (int) q.f + (int) q.l + q.b + (q.o == null ? 0 : 1) + q.v;
+  }
+
+  private static void write(Quickening q, int n) {
+    q.i = n;
+    q.o = q;
+  }
+
+  private static int call(Base b) {
+    return b.get();
+  }
+
+  private static Object make() {
+    return new Initialized();
+  }
+
+  public static void main(String[] args) {
+    Quickening q = new Quickening();
+    for (int n = 0; n < 3; ++n) {
+      q.i = n;
+      q.f = n;
+      q.l = n;
+      q.b = (byte) n;
+      q.o = n == 0 ? null : q;
+      q.v = n;
+      expect(read(q) == (n * 5) + (n == 0 ? 0 : 1));
+
+      boolean threw = false;
+      try {
+        write(null, n);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      threw = false;
+      try {
+        read(null);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      expect(call(new Base()) == 1);
+      expect(call(new Derived()) == 2);
+      expect(call(new Grandchild()) == 12);
+
+      threw = false;
+      try {
+        call(null);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+
+      expect(make() instanceof Initialized);
+      expect(initCount == 1);
+      expect(Initialized.count() == 1);
+    }
+  }
+}
@@ -2,6 +2,7 @@ import java.lang.ref.ReferenceQueue;
 import java.lang.ref.Reference;
 import java.lang.ref.WeakReference;
 import java.lang.ref.PhantomReference;
+import java.lang.ref.SoftReference;
 import java.util.WeakHashMap;
 
 public class References {
@@ -12,6 +13,7 @@ public class References {
     Object d = new Object();
     Object e = new Object();
     Object f = new Object();
+    Object g = new Object();
 
     ReferenceQueue q = new ReferenceQueue();
 
@@ -20,17 +22,19 @@ public class References {
     Reference cr = new WeakReference(c, q);
     Reference dr = new PhantomReference(d, q);
     Reference er = new MyReference(e, q, "foo");
+    Reference gr = new SoftReference(g, q);
     
     WeakHashMap<Key,Object> map = new WeakHashMap();
     map.put(new Key("foo"), f);
 
-    a = b = c = d = e = cr = null;
+    a = b = c = d = e = g = cr = null;
     
     System.out.println("a: " + ar.get());
     System.out.println("b: " + br.get());
     System.out.println("d: " + dr.get());
     System.out.println("e: " + er.get());
     System.out.println("f: " + map.get(new Key("foo")));
+    System.out.println("g: " + gr.get());
 
     System.gc();
 
@@ -39,6 +43,13 @@ public class References {
     System.out.println("d: " + dr.get());
     System.out.println("e: " + er.get());
     System.out.println("f: " + map.get(new Key("foo")));
+    System.out.println("g: " + gr.get());
+
+    // g was used just now and the heap is nearly empty, so its soft
+    // reference should survive the collection
+    if (gr.get() == null) {
+      throw new RuntimeException();
+    }
 
     for (Reference r = q.poll(); r != null; r = q.poll()) {
       System.out.println("polled: " + r.get());      
@@ -119,6 +119,68 @@ public class Reflection {
     expect(NamedLocal.class.isLocalClass());
   }
 
+  public static long sum(int a, long b, double c, String d) {
+    return a + b + (long) c + d.length();
+  }
+
+  public int twice(int v) {
+    return v * 2;
+  }
+
+  private String hidden(char[] v) {
+    return new String(v);
+  }
+
+  public static void fail(String message) {
+    throw new IllegalStateException(message);
+  }
+
+  private static class Thrice extends Reflection {
+    public int twice(int v) {
+      return v * 3;
+    }
+  }
+
+  // enough calls through each method to get them past the threshold
+  // at which Method.invoke switches to a generated accessor, so we see
+  // the same results on both sides of it
+  private static void inflatedMethods() throws Exception {
+    Method sum = Reflection.class.getMethod
+      ("sum", int.class, long.class, double.class, String.class);
+    Method twice = Reflection.class.getMethod("twice", int.class);
+    Method hidden = Reflection.class.getDeclaredMethod
+      ("hidden", char[].class);
+    Method fail = Reflection.class.getMethod("fail", String.class);
+    Method compare = Comparable.class.getMethod("compareTo", Object.class);
+
+    for (int i = 0; i < 100; ++i) {
+      expect(((Long) sum.invoke(null, i, 2L, 3.5, "four")) == i + 9);
+
+      expect(((Integer) twice.invoke(new Reflection(), i)) == i * 2);
+      expect(((Integer) twice.invoke(new Thrice(), i)) == i * 3);
+
+      expect(hidden.invoke(new Reflection(), new char[] { 'h', 'i' })
+             .equals("hi"));
+
+      expect(((Integer) compare.invoke("b", "b")) == 0);
+
+      try {
+        fail.invoke(null, "oops");
+        expect(false);
+      } catch (InvocationTargetException e) {
+        expect(e.getCause() instanceof IllegalStateException);
+        expect(e.getCause().getMessage().equals("oops"));
+      }
+
+      try {
+        twice.invoke(new Object(), i);
+        expect(false);
+      } catch (IllegalArgumentException e) {
+        // cool
+      }
+    }
+  }
+
   private static class MyClassLoader extends ClassLoader {
     public Package definePackage1(String name) {
       return definePackage(name, null, null, null, null, null, null, null);
@@ -132,6 +194,7 @@ public class Reflection {
     annotations();
     genericType();
     classType();
+    inflatedMethods();
 
     Class system = Class.forName("java.lang.System");
     Field out = system.getDeclaredField("out");
@@ -269,6 +332,27 @@ public class Reflection {
 
     expect(B.class.getDeclaredMethods().length == 0);
 
+    // the arrays are cached, but each call must still hand out its own
+    // copies, sharing interned names
+    { Method[] first = C.class.getDeclaredMethods();
+      Method[] second = C.class.getDeclaredMethods();
+      expect(first != second);
+      expect(first.length == 1 && second.length == 1);
+      expect(first[0] != second[0]);
+      expect(first[0].equals(second[0]));
+      expect(first[0].getName() == second[0].getName());
+      expect(first[0].getName() == "foo");
+      first[0].setAccessible(true);
+      expect(! C.class.getDeclaredMethods()[0].isAccessible());
+
+      Field[] fields = Baz.class.getDeclaredFields();
+      expect(fields != Baz.class.getDeclaredFields());
+      expect(fields[0] != Baz.class.getDeclaredFields()[0]);
+      expect(fields[0].getName()
+             == Baz.class.getDeclaredFields()[0].getName());
+      expect(Baz.class.getFields().length == Baz.class.getFields().length);
+    }
+
     new Runnable() {
       public void run() {
         expect(getClass().getDeclaringClass() == null);
@@ -98,5 +98,31 @@ public class Regex {
     expectGroups("a??(a{3}?)", "aaaa", "aaa");
     expectNoMatch("a(a{3}?)", "aaaaa");
     expectMatch("a(a{3,}?)", "aaaaa");
+
+    expectFind("a.*b|c", "acb", "acb");
+    expectFind("a*", "baa", "", "aa", "");
+    expectFind("ab+c", "xxabbcabcab", "abbc", "abc");
+    expectFind("zz[0-9]", "abc zz z9");
+    expectFind("[0-9]+", "ab 12 c345\u00e9 6", "12", "345", "6");
+    expectFind("\u00e9+", "a\u00e9\u00e9b\u00e9", "\u00e9\u00e9", "\u00e9");
+
+    Matcher matcher = getMatcher("(\\w+)=(\\d+)", "x a=1, bc=23;");
+    expect(matcher.find());
+    expect("a".equals(matcher.group(1)) && "1".equals(matcher.group(2)));
+    expect(matcher.find());
+    expect("bc".equals(matcher.group(1)) && "23".equals(matcher.group(2)));
+    expect(matcher.start() == 7 && matcher.end() == 12);
+    expect(!matcher.find());
+
+    // these need more automaton states than we are willing to build
+    StringBuilder sb = new StringBuilder();
+    for (int i = 0, x = 1; i < 4000; ++i) {
+      x = x * 1103515245 + 12345;
+      sb.append((x & 0x10000) == 0 ? 'a' : 'b');
+    }
+    String ab = sb.toString();
+    char last = ab.charAt(ab.length() - 11);
+    expect(getMatcher("[ab]*a[ab]{10}", ab).matches() == (last == 'a'));
+    expect(getMatcher("[ab]*b[ab]{10}", ab).matches() == (last == 'b'));
   }
 }
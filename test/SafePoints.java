@@ -0,0 +1,69 @@
+public class SafePoints {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static volatile boolean done;
+  private static volatile boolean started;
+
+  // loops which call nothing, so a collection requested by another
+  // thread can only proceed once their back edges have polled
+  private static long spinWhile() {
+    long count = 0;
+    while (! done) {
+      ++ count;
+    }
+    return count;
+  }
+
+  private static int spinFor(int n) {
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+      sum += i;
+    }
+    return sum;
+  }
+
+  private static int spinGoto(int n) {
+    int sum = 0;
+    int i = 0;
+    do {
+      sum ^= i;
+      i += 1;
+    } while (i != n);
+    return sum;
+  }
+
+  public static void main(String[] args) throws Exception {
+    final long[] result = new long[1];
+    Thread spinner = new Thread() {
+        public void run() {
+          started = true;
+          result[0] = spinWhile();
+        }
+      };
+    spinner.start();
+
+    while (! started) {
+      Thread.yield();
+    }
+
+    for (int i = 0; i < 10; ++i) {
+      System.gc();
+    }
+
+    done = true;
+    spinner.join();
+
+    expect(result[0] >= 0);
+
+    expect(spinFor(100000) == (int) (99999L * 100000L / 2));
+    expect(spinFor(0) == 0);
+
+    int expected = 0;
+    for (int i = 0; i < 1000; ++i) {
+      expected ^= i;
+    }
+    expect(spinGoto(1000) == expected);
+  }
+}
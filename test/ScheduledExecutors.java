@@ -0,0 +1,101 @@
+import java.util.concurrent.Callable;
+import java.util.concurrent.CancellationException;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ScheduledFuture;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class ScheduledExecutors {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  public static void main(String[] args) throws Exception {
+    ScheduledExecutorService executor = Executors.newScheduledThreadPool(2);
+
+    // tasks run no earlier than their delays and in deadline order
+    final long start = System.nanoTime();
+    final int[] order = new int[3];
+    final AtomicInteger position = new AtomicInteger();
+    ScheduledFuture<?>[] futures = new ScheduledFuture<?>[3];
+    for (int i = 2; i >= 0; --i) {
+      final int index = i;
+      futures[i] = executor.schedule(new Runnable() {
+          public void run() {
+            expect(System.nanoTime() - start
+                   >= TimeUnit.MILLISECONDS.toNanos(index * 20));
+            order[position.getAndIncrement()] = index;
+          }
+        }, i * 20, TimeUnit.MILLISECONDS);
+    }
+    for (int i = 0; i < 3; ++i) {
+      futures[i].get();
+    }
+    expect(order[0] == 0 && order[1] == 1 && order[2] == 2);
+
+    ScheduledFuture<Integer> answer = executor.schedule
+      (new Callable<Integer>() {
+        public Integer call() {
+          return 42;
+        }
+      }, 1, TimeUnit.MILLISECONDS);
+    expect(answer.get() == 42);
+
+    // a cancelled task never runs, even when many others are pending
+    final AtomicInteger ran = new AtomicInteger();
+    Runnable count = new Runnable() {
+        public void run() {
+          ran.incrementAndGet();
+        }
+      };
+    ScheduledFuture<?>[] many = new ScheduledFuture<?>[1000];
+    for (int i = 0; i < many.length; ++i) {
+      many[i] = executor.schedule(count, 10 + (i * 37) % 500,
+                                  TimeUnit.MILLISECONDS);
+    }
+    for (int i = 0; i < many.length; ++i) {
+      if (i % 10 != 0) {
+        expect(many[i].cancel(false));
+        expect(many[i].isCancelled());
+      }
+    }
+    ScheduledFuture<?> cancelled = executor.schedule
+      (count, 10, TimeUnit.MILLISECONDS);
+    expect(cancelled.cancel(false));
+    try {
+      cancelled.get();
+      expect(false);
+    } catch (CancellationException e) { }
+
+    // far off tasks cascade through the higher levels of the wheel
+    ScheduledFuture<?> far = executor.schedule
+      (count, 1, TimeUnit.DAYS);
+    expect(far.getDelay(TimeUnit.HOURS) >= 23);
+
+    final AtomicInteger periodic = new AtomicInteger();
+    ScheduledFuture<?> rate = executor.scheduleAtFixedRate(new Runnable() {
+        public void run() {
+          periodic.incrementAndGet();
+        }
+      }, 0, 5, TimeUnit.MILLISECONDS);
+    while (periodic.get() < 5) {
+      Thread.sleep(5);
+    }
+    expect(rate.cancel(false));
+    expect(rate.isDone());
+
+    for (int i = 0; i < many.length; i += 10) {
+      many[i].get();
+    }
+    expect(ran.get() == many.length / 10);
+
+    executor.shutdown();
+    // the day long task still runs after shutdown, so we cancel it to
+    // let the executor terminate
+    expect(! executor.awaitTermination(10, TimeUnit.MILLISECONDS));
+    far.cancel(false);
+    expect(executor.awaitTermination(10, TimeUnit.SECONDS));
+    expect(executor.isTerminated());
+  }
+}
@@ -117,6 +117,20 @@ public class Serialize implements Serializable {
     }
   }
 
+  private static class Mixed implements Serializable {
+    private boolean z = true;
+    private byte b = -2;
+    private char c = '\u1234';
+    private short s = -300;
+    private String name = "mixed";
+    private int i = 0xcafebabe;
+    private float f = 1.5f;
+    private long j = 0x123456789abcdefl;
+    private double d = -2.25;
+    private transient int skipped = 42;
+    private Mixed next;
+  }
+
   public static void main(String[] args) throws Exception {
     ByteArrayOutputStream out = new ByteArrayOutputStream();
     ObjectOutputStream out2 = new ObjectOutputStream(out);
@@ -246,5 +260,40 @@ public class Serialize implements Serializable {
     expectEqual(list.size(), listCopy.size());
     for (int i = 0; i < list.size(); i++)
         expectEqual(list.get(i), listCopy.get(i));
+
+    // the same class written repeatedly, with primitive fields on either
+    // side of object ones
+    out.reset();
+    out2 = new ObjectOutputStream(out);
+    Mixed mixed = new Mixed();
+    mixed.next = new Mixed();
+    mixed.next.i = 7;
+    mixed.next.name = null;
+    out2.writeObject(mixed);
+    out2.writeObject(new Mixed());
+    out2.close();
+    in = new ByteArrayInputStream(out.toByteArray());
+    in2 = new ObjectInputStream(in);
+    for (int k = 0; k < 2; ++k) {
+      Mixed copy = (Mixed) in2.readObject();
+      expect(copy.z);
+      expect(copy.b == -2);
+      expect(copy.c == '\u1234');
+      expect(copy.s == -300);
+      expectEqual("mixed", copy.name);
+      expect(copy.i == 0xcafebabe);
+      expect(copy.f == 1.5f);
+      expect(copy.j == 0x123456789abcdefl);
+      expect(copy.d == -2.25);
+      expect(copy.skipped == 0);
+      if (k == 0) {
+        expect(copy.next.i == 7);
+        expect(copy.next.name == null);
+        expect(copy.next.next == null);
+      } else {
+        expect(copy.next == null);
+      }
+    }
+    in2.close();
   }
 }
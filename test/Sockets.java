@@ -1,5 +1,8 @@
 import java.net.SocketAddress;
 import java.net.InetSocketAddress;
+import java.net.StandardSocketOptions;
+import java.nio.ByteBuffer;
+import java.nio.channels.ServerSocketChannel;
 import java.nio.channels.SocketChannel;
 import java.io.IOException;
 
@@ -27,11 +30,113 @@ public class Sockets {
     }
   }
 
+  public static void testScatterGather() throws Exception {
+    final SocketAddress Address = new InetSocketAddress("localhost", 22047);
+
+    ServerSocketChannel server = ServerSocketChannel.open();
+    try {
+      server.socket().bind(Address);
+
+      SocketChannel out = SocketChannel.open();
+      try {
+        out.connect(Address);
+        SocketChannel in = server.accept();
+        try {
+          ByteBuffer body = ByteBuffer.wrap("xxbodyxx".getBytes());
+          body.position(2);
+          body.limit(6);
+          ByteBuffer[] frame = new ByteBuffer[] {
+            ByteBuffer.wrap("head".getBytes()),
+            body,
+            ByteBuffer.wrap("tail".getBytes()) };
+          expect(out.write(frame) == 12);
+          for (ByteBuffer b : frame) expect(! b.hasRemaining());
+
+          ByteBuffer a = ByteBuffer.allocate(5);
+          ByteBuffer b = ByteBuffer.allocate(20);
+          long n = 0;
+          while (n < 12) {
+            n += in.read(new ByteBuffer[] { a, b });
+          }
+          expect(n == 12);
+          expect(a.position() == 5 && b.position() == 7);
+          expect("headb".equals(new String(a.array(), 0, 5)));
+          expect("odytail".equals(new String(b.array(), 0, 7)));
+        } finally {
+          in.close();
+        }
+      } finally {
+        out.close();
+      }
+    } finally {
+      server.close();
+    }
+  }
+
+  // two acceptors may share an address with SO_REUSEPORT, and either
+  // may be handed a connection, which must still start out blocking
+  public static void testReusePort() throws Exception {
+    final SocketAddress Address = new InetSocketAddress("localhost", 22048);
+
+    ServerSocketChannel[] servers = new ServerSocketChannel[2];
+    try {
+      for (int i = 0; i < servers.length; ++i) {
+        servers[i] = ServerSocketChannel.open();
+        try {
+          servers[i].setOption(StandardSocketOptions.SO_REUSEPORT, true);
+        } catch (UnsupportedOperationException e) {
+          // not every system has it
+          return;
+        }
+        servers[i].configureBlocking(false);
+        servers[i].socket().bind(Address);
+      }
+
+      SocketChannel out = SocketChannel.open();
+      try {
+        out.connect(Address);
+
+        SocketChannel in = null;
+        while (in == null) {
+          for (int i = 0; i < servers.length && in == null; ++i) {
+            in = servers[i].accept();
+          }
+          if (in == null) {
+            Thread.sleep(1);
+          }
+        }
+
+        try {
+          expect(in.isBlocking());
+          expect(out.write(ByteBuffer.wrap("hi".getBytes())) == 2);
+
+          ByteBuffer b = ByteBuffer.allocate(2);
+          while (b.hasRemaining()) {
+            expect(in.read(b) > 0);
+          }
+          expect("hi".equals(new String(b.array())));
+        } finally {
+          in.close();
+        }
+      } finally {
+        out.close();
+      }
+    } finally {
+      for (ServerSocketChannel server : servers) {
+        if (server != null) {
+          server.close();
+        }
+      }
+    }
+  }
+
   public static void main(String[] args) throws Exception {
     // This test sometimes fails without explanation on Travis-CI, so
     // we skip it there:
     if (! "true".equals(System.getenv("TRAVIS"))) {
       testFailedBind();
+      testScatterGather();
+      testReusePort();
     }
   }
 }
@@ -6,6 +6,9 @@ public class StringBuilderTest {
     verifyAppendStrLength();
     verifyAppendCharLength();
     verifySubstring();
+    verifyAppendNumbers();
+    verifySinglePart();
+    verifySetLength();
   }
   
   private static void verify(String srcStr, int iterations, String result) {
@@ -62,4 +65,47 @@ public class StringBuilderTest {
     String endSubString = sb.substring(fooStr.length());
     verify(fooStr, endSubString);
   }
+
+  private static void verifyAppendNumbers() {
+    verify("0", new StringBuilder().append(0).toString());
+    verify("-7", new StringBuilder().append(-7).toString());
+    verify("x=2147483647;", "x=" + Integer.MAX_VALUE + ";");
+    verify("-2147483648", new StringBuilder().append(Integer.MIN_VALUE)
+           .toString());
+    verify("-9223372036854775808", new StringBuilder().append(Long.MIN_VALUE)
+           .toString());
+    verify("9223372036854775807", "" + Long.MAX_VALUE);
+
+    // enough digits to spill over several buffers
+    StringBuilder sb = new StringBuilder();
+    StringBuilder expected = new StringBuilder();
+    for (int i = 0; i < 100; ++i) {
+      sb.append(1234567890123L * i).append(',');
+      expected.append(Long.toString(1234567890123L * i)).append(',');
+    }
+    verify(expected.toString(), sb.toString());
+  }
+
+  private static void verifySinglePart() {
+    String s = new String("single");
+    if (new StringBuilder().append(s).toString() != s) {
+      throw new IllegalStateException("single part was copied");
+    }
+    verify("", new StringBuilder().toString());
+    verify("ab", new StringBuilder().append('a').append('b').toString());
+  }
+
+  private static void verifySetLength() {
+    StringBuilder sb = new StringBuilder();
+    sb.append('a').append(42);
+    sb.setLength(0);
+    sb.append('b');
+    verify("b", sb.toString());
+
+    // growing pads with nulls, even after a single string
+    sb = new StringBuilder();
+    sb.append("ab");
+    sb.setLength(4);
+    verify("ab\0\0", sb.toString());
+  }
 }
@@ -227,5 +227,60 @@ public class Strings {
         (new java.io.ByteArrayInputStream(s.getBytes())).read(buffer);
       expect(s.equals(new String(buffer.array())));
     }
+
+    // decoding copies runs of ASCII a block at a time, so check strings
+    // with other characters before, after, and among long runs of it
+    { StringBuilder sb = new StringBuilder();
+      for (int i = 0; i < 100; ++i) {
+        sb.append((char) ('a' + (i % 26)));
+      }
+      String ascii = sb.toString();
+      String[] strings = { ascii, ascii + "\u00e9", "\u2665" + ascii,
+                           ascii + "\u2665" + ascii + "\u00e9" + ascii };
+      for (String s: strings) {
+        byte[] bytes = s.getBytes("UTF-8");
+        expect(s.equals(new String(bytes, "UTF-8")));
+        expect(s.equals(new String(bytes, 0, bytes.length)));
+      }
+
+      byte[] bytes = ("xy" + ascii + "\u00e9z").getBytes("UTF-8");
+      expect((ascii + "\u00e9").equals(new String(bytes, 2, bytes.length - 3)));
+
+      // the reader decodes whatever each read brings in, carrying over
+      // the start of a character cut short, so read a few at a time
+      String mixed = strings[3];
+      java.io.Reader r = new java.io.InputStreamReader
+        (new java.io.ByteArrayInputStream(mixed.getBytes("UTF-8")), "UTF-8");
+      StringBuilder decoded = new StringBuilder();
+      char[] chunk = new char[7];
+      int c;
+      while ((c = r.read(chunk, 0, chunk.length)) != -1) {
+        decoded.append(chunk, 0, c);
+      }
+      expect(mixed.equals(decoded.toString()));
+
+      java.io.BufferedReader lines = new java.io.BufferedReader
+        (new java.io.InputStreamReader
+         (new java.io.ByteArrayInputStream
+          ((ascii + "\r\n\u00e9\n\n" + mixed + "\r" + ascii)
+           .getBytes("UTF-8"))), 64);
+      expect(ascii.equals(lines.readLine()));
+      expect("\u00e9".equals(lines.readLine()));
+      expect("".equals(lines.readLine()));
+      expect(mixed.equals(lines.readLine()));
+      expect(ascii.equals(lines.readLine()));
+      expect(lines.readLine() == null);
+    }
+
+    { byte[] latin1 = { 'a', (byte) 0xe9, 'b', (byte) 0xff };
+      expect("a\u00e9b\u00ff".equals(new String(latin1, "ISO-8859-1")));
+      expect("ab".equals(new String(new byte[] { 'a', 'b' }, "ISO-8859-1")));
+
+      char[] chars = new char[4];
+      expect(new java.io.InputStreamReader
+             (new java.io.ByteArrayInputStream(latin1), "ISO-8859-1")
+             .read(chars, 0, 4) == 4);
+      expect("a\u00e9b\u00ff".equals(new String(chars)));
+    }
   }
 }
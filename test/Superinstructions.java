@@ -0,0 +1,67 @@
+public class Superinstructions {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private int count;
+  private Object next;
+
+  private int loop(int n) {
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+      sum += count;
+    }
+    return sum;
+  }
+
+  private static int compare(int a, int b) {
+    int result = 0;
+    if (a == b) result |= 1;
+    if (a != b) result |= 2;
+    if (a < b) result |= 4;
+    if (a >= b) result |= 8;
+    if (a > b) result |= 16;
+    if (a <= b) result |= 32;
+    return result;
+  }
+
+  private static int compareLocals(int a, int b, int c, int d, int e) {
+    int result = 0;
+    for (int i = 0; i < 2; ++i) {
+      if (d < e) result += 1;
+      if (e <= a) result += 2;
+      if (c > b) result += 4;
+    }
+    return result;
+  }
+
+  private static Object next(Superinstructions s) {
+    return s.next;
+  }
+
+  public static void main(String[] args) {
+    for (int n = 0; n < 3; ++n) {
+      Superinstructions s = new Superinstructions();
+      s.count = 3;
+      s.next = s;
+      expect(s.loop(4) == 12);
+      expect(next(s) == s);
+
+      expect(compare(1, 1) == (1 | 8 | 32));
+      expect(compare(1, 2) == (2 | 4 | 32));
+      expect(compare(2, 1) == (2 | 8 | 16));
+      expect(compare(Integer.MIN_VALUE, Integer.MAX_VALUE) == (2 | 4 | 32));
+
+      expect(compareLocals(5, 1, 2, 3, 4) == 14);
+      expect(compareLocals(0, 2, 1, 4, 3) == 0);
+
+      boolean threw = false;
+      try {
+        next(null);
+      } catch (NullPointerException e) {
+        threw = true;
+      }
+      expect(threw);
+    }
+  }
+}
@@ -43,6 +43,46 @@ public class Switch {
     }
   }
 
+  private static int sparseLookup(int k) {
+    switch (k) {
+    case -1000000:
+      return 1;
+    case -300:
+      return 2;
+    case -2:
+      return 3;
+    case 17:
+      return 4;
+    case 1000:
+      return 5;
+    case 1001:
+      return 6;
+    case 5000:
+      return 7;
+    case 77777:
+      return 8;
+    case 123456:
+      return 9;
+    case Integer.MAX_VALUE:
+      return 10;
+    default:
+      return 0;
+    }
+  }
+
+  private static int smallLookup(int k) {
+    switch (k) {
+    case Integer.MIN_VALUE:
+      return 1;
+    case -70000:
+      return 2;
+    case 70000:
+      return 3;
+    default:
+      return 0;
+    }
+  }
+
   private static void expect(boolean v) {
     if (! v) throw new RuntimeException();
   }
@@ -62,5 +102,27 @@ public class Switch {
     expect(lookup(47) == -47);
     expect(lookup(245) == 245);
     expect(lookup(246) == 91);
+    expect(lookup(-1) == 91);
+    expect(lookup(100) == 91);
+
+    expect(sparseLookup(-1000000) == 1);
+    expect(sparseLookup(-300) == 2);
+    expect(sparseLookup(-2) == 3);
+    expect(sparseLookup(17) == 4);
+    expect(sparseLookup(1000) == 5);
+    expect(sparseLookup(1001) == 6);
+    expect(sparseLookup(5000) == 7);
+    expect(sparseLookup(77777) == 8);
+    expect(sparseLookup(123456) == 9);
+    expect(sparseLookup(Integer.MAX_VALUE) == 10);
+    expect(sparseLookup(0) == 0);
+    expect(sparseLookup(1002) == 0);
+    expect(sparseLookup(Integer.MIN_VALUE) == 0);
+
+    expect(smallLookup(Integer.MIN_VALUE) == 1);
+    expect(smallLookup(-70000) == 2);
+    expect(smallLookup(70000) == 3);
+    expect(smallLookup(0) == 0);
+    expect(smallLookup(Integer.MAX_VALUE) == 0);
   }
 }
@@ -0,0 +1,61 @@
+public class ThreadLocals {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static final ThreadLocal<String> name = new ThreadLocal<String>() {
+      protected String initialValue() {
+        return "initial";
+      }
+    };
+
+  private static final InheritableThreadLocal<Integer> inherited
+    = new InheritableThreadLocal<Integer>() {
+      protected Integer childValue(Integer parentValue) {
+        return parentValue + 1;
+      }
+    };
+
+  private static final ThreadLocal<Object> uninherited
+    = new ThreadLocal<Object>();
+
+  public static void main(String[] args) throws Exception {
+    expect(name.get().equals("initial"));
+    name.set("main");
+    expect(name.get().equals("main"));
+    name.set(null);
+    expect(name.get() == null);
+    name.remove();
+    expect(name.get().equals("initial"));
+
+    // enough locals to make the per-thread table grow
+    ThreadLocal[] many = new ThreadLocal[100];
+    for (int i = 0; i < many.length; ++i) {
+      many[i] = new ThreadLocal();
+      many[i].set(i);
+    }
+    for (int i = 0; i < many.length; ++i) {
+      expect(((Integer) many[i].get()) == i);
+    }
+
+    inherited.set(41);
+    uninherited.set("parent");
+
+    final boolean[] ok = new boolean[1];
+    Thread thread = new Thread() {
+        public void run() {
+          ok[0] = inherited.get() == 42
+            && uninherited.get() == null
+            && name.get().equals("initial");
+          name.set("child");
+        }
+      };
+    thread.start();
+    thread.join();
+
+    expect(ok[0]);
+    expect(inherited.get() == 41);
+    expect(uninherited.get().equals("parent"));
+    expect(name.get().equals("initial"));
+  }
+}
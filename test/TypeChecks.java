@@ -0,0 +1,98 @@
+public class TypeChecks {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static class Base { }
+
+  private static class Derived extends Base implements Runnable {
+    public void run() { }
+  }
+
+  private static class MoreDerived extends Derived { }
+
+  private static class Unrelated implements Runnable {
+    public void run() { }
+  }
+
+  private static boolean isBase(Object o) {
+    return o instanceof Base;
+  }
+
+  private static boolean isDerived(Object o) {
+    return o instanceof Derived;
+  }
+
+  private static boolean isRunnable(Object o) {
+    return o instanceof Runnable;
+  }
+
+  private static Base toBase(Object o) {
+    return (Base) o;
+  }
+
+  private static Derived toDerived(Object o) {
+    return (Derived) o;
+  }
+
+  private static boolean castFails(Object o) {
+    try {
+      toDerived(o);
+      return false;
+    } catch (ClassCastException e) {
+      return true;
+    }
+  }
+
+  public static void main(String[] args) {
+    Object base = new Base();
+    Object derived = new Derived();
+
+    for (int i = 0; i < 2; ++i) {
+      // null and the exact class are checked without calling out, so
+      // make sure the results agree with the general case
+      expect(! isBase(null));
+      expect(isBase(base));
+      expect(isBase(derived));
+      expect(! isDerived(base));
+      expect(isDerived(derived));
+      expect(! isRunnable(base));
+      expect(isRunnable(derived));
+      expect(! isBase(new Object()));
+      expect(! isBase(new Base[0]));
+
+      expect(toBase(null) == null);
+      expect(toBase(base) == base);
+      expect(toBase(derived) == derived);
+      expect(toDerived(null) == null);
+      expect(toDerived(derived) == derived);
+
+      // superclass tests which can't be decided by the exact class check
+      Object moreDerived = new MoreDerived();
+      expect(isBase(moreDerived));
+      expect(isDerived(moreDerived));
+      expect(isRunnable(moreDerived));
+      expect(toDerived(moreDerived) == moreDerived);
+      expect(! (base instanceof MoreDerived));
+      expect(! (derived instanceof MoreDerived));
+      expect(! isBase(new Unrelated()));
+
+      // alternate between classes so the interface check can't just
+      // rely on the last match
+      expect(isRunnable(new Unrelated()));
+      expect(isRunnable(derived));
+      expect(! isRunnable("foo"));
+      expect(isRunnable(new Unrelated()));
+
+      Object[] bases = new Base[1];
+      bases[0] = moreDerived;
+      expect(bases instanceof Object[]);
+      expect(! (bases instanceof Derived[]));
+
+      expect(castFails(base));
+      expect(castFails(new Object()));
+      expect(castFails("foo"));
+      expect(! castFails(null));
+    }
+  }
+}
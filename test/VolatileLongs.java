@@ -0,0 +1,57 @@
+import java.util.concurrent.atomic.AtomicLong;
+
+public class VolatileLongs {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static final long A = 0x0123456789ABCDEFL;
+  private static final long B = ~A;
+
+  private static volatile double staticDouble = 1.5;
+
+  private volatile long member = A;
+
+  private static boolean whole(long v) {
+    return v == A || v == B;
+  }
+
+  private static boolean whole(double v) {
+    return v == 1.5 || v == -2.25;
+  }
+
+  public static void main(String[] args) throws Exception {
+    final VolatileLongs o = new VolatileLongs();
+    final AtomicLong counter = new AtomicLong();
+    final boolean[] torn = new boolean[1];
+    final int count = 100000;
+
+    // each field only ever holds one of two values, so a reader which
+    // sees anything else caught a write halfway through
+    Thread writer = new Thread() {
+        public void run() {
+          for (int i = 0; i < count; ++i) {
+            o.member = (i & 1) == 0 ? B : A;
+            staticDouble = (i & 1) == 0 ? -2.25 : 1.5;
+            counter.incrementAndGet();
+          }
+        }
+      };
+
+    writer.start();
+
+    for (int i = 0; i < count; ++i) {
+      if (! (whole(o.member) && whole(staticDouble))) {
+        torn[0] = true;
+      }
+      counter.incrementAndGet();
+    }
+
+    writer.join();
+
+    expect(! torn[0]);
+    expect(whole(o.member));
+    expect(whole(staticDouble));
+    expect(counter.get() == count * 2);
+  }
+}
@@ -0,0 +1,9 @@
+#include <jni.h>
+
+// natives used by the benchmarks in test/benchmark
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_benchmark_Jni_identity(JNIEnv*, jclass, jint v)
+{
+  return v;
+}
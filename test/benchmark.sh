@@ -0,0 +1,42 @@
+#!/bin/sh
+
+vm=${1}; shift
+flags=${1}; shift
+results=${1}; shift
+benchmarks=${@}
+
+log=$(dirname ${results})/benchmark-log.txt
+log_tmp=$(dirname ${results})/benchmark-log_tmp.txt
+results_tmp=${results}.tmp
+
+echo -n "" >${log}
+echo -n "" >${results_tmp}
+
+printf "%20s------- Benchmarks -------\n" ""
+for benchmark in ${benchmarks}; do
+  printf "%32s: " "${benchmark}"
+
+  ${vm} ${flags} ${benchmark} >${log_tmp} 2>&1
+
+  if [ "${?}" = "0" ]; then
+    echo "success"
+    cat ${log_tmp} >> ${results_tmp}
+  else
+    echo "fail"
+    cat ${log_tmp} >> ${log}
+    trouble=1
+  fi
+done
+
+echo
+
+rm ${log_tmp}
+
+# one "name<TAB>value<TAB>unit" line per result
+mv ${results_tmp} ${results}
+cat ${results}
+
+if [ -n "${trouble}" ]; then
+  printf "see ${log} for output from failed benchmarks\n"
+  exit -1
+fi
@@ -0,0 +1,42 @@
+package benchmark;
+
+// Measures the cost of allocating short-lived objects and arrays,
+// including that of the minor collections they provoke.
+public class Allocation {
+  private static class Small {
+    public int a;
+    public int b;
+  }
+
+  public static void main(String[] args) throws Exception {
+    Harness.time("allocation.object", new Harness.Body() {
+        public void run(int iterations) {
+          Object o = null;
+          for (int i = 0; i < iterations; ++i) {
+            o = new Small();
+          }
+          Harness.sink = o;
+        }
+      });
+
+    Harness.time("allocation.array.16", new Harness.Body() {
+        public void run(int iterations) {
+          Object o = null;
+          for (int i = 0; i < iterations; ++i) {
+            o = new byte[16];
+          }
+          Harness.sink = o;
+        }
+      });
+
+    Harness.throughput("allocation.array.1024", 1024, new Harness.Body() {
+        public void run(int iterations) {
+          Object o = null;
+          for (int i = 0; i < iterations; ++i) {
+            o = new byte[1024];
+          }
+          Harness.sink = o;
+        }
+      });
+  }
+}
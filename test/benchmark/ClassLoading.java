@@ -0,0 +1,56 @@
+package benchmark;
+
+import java.io.ByteArrayOutputStream;
+import java.io.InputStream;
+
+// Measures how quickly classes can be parsed and defined, by defining
+// the same class over and over in a fresh class loader each time.
+public class ClassLoading {
+  public static class Loaded {
+    public int field;
+
+    public int method(int v) {
+      return field + v;
+    }
+  }
+
+  private static class Loader extends ClassLoader {
+    public Loader(ClassLoader parent) {
+      super(parent);
+    }
+
+    public Class define(String name, byte[] bytes) {
+      return defineClass(name, bytes, 0, bytes.length);
+    }
+  }
+
+  private static byte[] read(String name) throws Exception {
+    InputStream in = ClassLoading.class.getClassLoader()
+      .getResourceAsStream(name.replace('.', '/') + ".class");
+    try {
+      ByteArrayOutputStream out = new ByteArrayOutputStream();
+      byte[] buffer = new byte[4096];
+      int c;
+      while ((c = in.read(buffer)) > 0) {
+        out.write(buffer, 0, c);
+      }
+      return out.toByteArray();
+    } finally {
+      in.close();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    final String name = Loaded.class.getName();
+    final byte[] bytes = read(name);
+    final ClassLoader parent = ClassLoading.class.getClassLoader();
+
+    Harness.time("class.define", new Harness.Body() {
+        public void run(int iterations) {
+          for (int i = 0; i < iterations; ++i) {
+            Harness.sink = new Loader(parent).define(name, bytes);
+          }
+        }
+      });
+  }
+}
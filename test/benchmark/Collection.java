@@ -0,0 +1,63 @@
+package benchmark;
+
+import avian.Machine;
+
+// Measures garbage collection pauses as reported by the collector
+// itself: minor collections while allocating garbage with a moderate
+// set of objects kept live, and major collections requested
+// explicitly with the same live set.
+public class Collection {
+  private static final int LiveCount = 64 * 1024;
+
+  public static void main(String[] args) {
+    Object[] live = new Object[LiveCount];
+    for (int i = 0; i < LiveCount; ++i) {
+      live[i] = new int[i & 15];
+    }
+
+    long[] s = new long[Machine.GC_STATISTICS_COUNT];
+    Machine.gcStatistics(s);
+    long collections = s[Machine.GC_COLLECTIONS];
+
+    int minorCount = 0;
+    long minorTotal = 0;
+    long minorMax = 0;
+    for (int i = 0; minorCount < 100; ++i) {
+      Harness.sink = new byte[64];
+      // replace part of the live set now and then so that collections
+      // have something to copy
+      if ((i & 1023) == 0) {
+        live[(i >>> 10) % LiveCount] = new int[4];
+      }
+
+      if ((i & 255) == 0) {
+        Machine.gcStatistics(s);
+        if (s[Machine.GC_COLLECTIONS] != collections) {
+          collections = s[Machine.GC_COLLECTIONS];
+          if (s[Machine.GC_TYPE] == 0) {
+            ++minorCount;
+            minorTotal += s[Machine.GC_PAUSE_TIME];
+            minorMax = Math.max(minorMax, s[Machine.GC_PAUSE_TIME]);
+          }
+        }
+      }
+    }
+
+    int majorCount = 10;
+    long majorTotal = 0;
+    long majorMax = 0;
+    for (int i = 0; i < majorCount; ++i) {
+      System.gc();
+      Machine.gcStatistics(s);
+      majorTotal += s[Machine.GC_PAUSE_TIME];
+      majorMax = Math.max(majorMax, s[Machine.GC_PAUSE_TIME]);
+    }
+
+    Harness.sink = live;
+
+    Harness.report("gc.minor.pause", (double) minorTotal / minorCount, "ms");
+    Harness.report("gc.minor.pause.max", minorMax, "ms");
+    Harness.report("gc.major.pause", (double) majorTotal / majorCount, "ms");
+    Harness.report("gc.major.pause.max", majorMax, "ms");
+  }
+}
@@ -0,0 +1,65 @@
+package benchmark;
+
+// Measures the cost of static, virtual and interface calls.  The
+// virtual and interface call sites each see two receiver classes, so
+// they can't be bound statically.
+public class Dispatch {
+  private interface Shape {
+    public int sides();
+  }
+
+  private static abstract class Base {
+    public abstract int sides();
+  }
+
+  private static class Triangle extends Base implements Shape {
+    public int sides() {
+      return 3;
+    }
+  }
+
+  private static class Square extends Base implements Shape {
+    public int sides() {
+      return 4;
+    }
+  }
+
+  private static int sides(int i) {
+    return i & 7;
+  }
+
+  public static void main(String[] args) throws Exception {
+    final Base[] bases = new Base[] { new Triangle(), new Square() };
+    final Shape[] shapes = new Shape[] { new Triangle(), new Square() };
+
+    Harness.time("call.static", new Harness.Body() {
+        public void run(int iterations) {
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            sum += sides(i);
+          }
+          Harness.intSink = sum;
+        }
+      });
+
+    Harness.time("call.virtual", new Harness.Body() {
+        public void run(int iterations) {
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            sum += bases[i & 1].sides();
+          }
+          Harness.intSink = sum;
+        }
+      });
+
+    Harness.time("call.interface", new Harness.Body() {
+        public void run(int iterations) {
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            sum += shapes[i & 1].sides();
+          }
+          Harness.intSink = sum;
+        }
+      });
+  }
+}
@@ -0,0 +1,62 @@
+package benchmark;
+
+// Times the bodies of the benchmarks in this package and reports each
+// result as a "name<TAB>value<TAB>unit" line on standard output, so
+// that the results of one build can be compared with another's by
+// script.  System.currentTimeMillis is the only clock every class
+// library provides, so bodies are run repeatedly, doubling the
+// iteration count, until a run takes long enough for the clock's
+// resolution not to matter; those runs double as a warm-up for the
+// JIT compiler.  The best of several timed runs is reported.
+public class Harness {
+  public interface Body {
+    public void run(int iterations) throws Exception;
+  }
+
+  private static final long MinimumMilliseconds = 250;
+
+  private static final int Repetitions = 5;
+
+  public static void report(String name, double value, String unit) {
+    System.out.println(name + "\t" + value + "\t" + unit);
+  }
+
+  private static long elapsed(Body body, int iterations) throws Exception {
+    long start = System.currentTimeMillis();
+    body.run(iterations);
+    return System.currentTimeMillis() - start;
+  }
+
+  public static double time(Body body) throws Exception {
+    int iterations = 1;
+    while (elapsed(body, iterations) < MinimumMilliseconds) {
+      iterations *= 2;
+    }
+
+    double best = Double.MAX_VALUE;
+    for (int i = 0; i < Repetitions; ++i) {
+      best = Math.min(best, (elapsed(body, iterations) * 1000000.0)
+                      / iterations);
+    }
+    return best;
+  }
+
+  // reports the per-iteration cost of body in nanoseconds
+  public static void time(String name, Body body) throws Exception {
+    report(name, time(body), "ns/op");
+  }
+
+  // reports how many bytes body processes per second, given that each
+  // iteration processes the specified number
+  public static void throughput(String name, final int bytesPerIteration,
+                                Body body)
+    throws Exception
+  {
+    report(name, (bytesPerIteration * 1000.0) / time(body), "MB/s");
+  }
+
+  // keeps the results of benchmark bodies live, so the work they do
+  // can't be optimized away
+  public static volatile Object sink;
+  public static volatile int intSink;
+}
@@ -0,0 +1,23 @@
+package benchmark;
+
+// Measures the cost of calling a trivial native method through JNI.
+// The native is defined in test/benchmark.cpp.
+public class Jni {
+  static {
+    System.loadLibrary("test");
+  }
+
+  private static native int identity(int v);
+
+  public static void main(String[] args) throws Exception {
+    Harness.time("jni.call", new Harness.Body() {
+        public void run(int iterations) {
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            sum += identity(i);
+          }
+          Harness.intSink = sum;
+        }
+      });
+  }
+}
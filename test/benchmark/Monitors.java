@@ -0,0 +1,47 @@
+package benchmark;
+
+// Measures the cost of entering and exiting a monitor which no other
+// thread wants, and one which two threads are competing for.  The
+// contended figure is per acquisition, counting both threads'.
+public class Monitors {
+  private static int counter;
+
+  public static void main(String[] args) throws Exception {
+    final Object lock = new Object();
+
+    Harness.time("monitor.uncontended", new Harness.Body() {
+        public void run(int iterations) {
+          for (int i = 0; i < iterations; ++i) {
+            synchronized (lock) {
+              ++counter;
+            }
+          }
+        }
+      });
+
+    Harness.time("monitor.contended", new Harness.Body() {
+        public void run(int iterations) throws Exception {
+          final int half = (iterations + 1) / 2;
+          Thread[] threads = new Thread[2];
+          for (int i = 0; i < threads.length; ++i) {
+            threads[i] = new Thread() {
+                public void run() {
+                  for (int j = 0; j < half; ++j) {
+                    synchronized (lock) {
+                      ++counter;
+                    }
+                  }
+                }
+              };
+            threads[i].start();
+          }
+
+          for (int i = 0; i < threads.length; ++i) {
+            threads[i].join();
+          }
+        }
+      });
+
+    Harness.intSink = counter;
+  }
+}
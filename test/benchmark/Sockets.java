@@ -0,0 +1,74 @@
+package benchmark;
+
+import java.net.InetSocketAddress;
+import java.net.SocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+
+// Measures round trips and bulk transfers over a loopback TCP
+// connection.  Both ends are driven from one thread, relying on the
+// kernel's buffering.
+public class Sockets {
+  private static final int Port = 22060; // hopefully this port is unused
+
+  private static void transfer(SocketChannel from, SocketChannel to,
+                               ByteBuffer buffer)
+    throws Exception
+  {
+    buffer.clear();
+    while (buffer.hasRemaining()) {
+      from.write(buffer);
+    }
+
+    buffer.clear();
+    while (buffer.hasRemaining()) {
+      if (to.read(buffer) < 0) throw new RuntimeException();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    SocketAddress address = new InetSocketAddress("localhost", Port);
+
+    ServerSocketChannel server = ServerSocketChannel.open();
+    try {
+      server.socket().bind(address);
+
+      final SocketChannel client = SocketChannel.open();
+      try {
+        client.connect(address);
+        final SocketChannel peer = server.accept();
+        try {
+          final ByteBuffer small = ByteBuffer.allocate(64);
+
+          Harness.time("socket.roundTrip", new Harness.Body() {
+              public void run(int iterations) throws Exception {
+                for (int i = 0; i < iterations; ++i) {
+                  transfer(client, peer, small);
+                  transfer(peer, client, small);
+                }
+              }
+            });
+
+          // small enough to fit in the loopback socket buffers
+          final ByteBuffer large = ByteBuffer.allocate(32 * 1024);
+
+          Harness.throughput("socket.transfer", large.capacity(),
+                             new Harness.Body() {
+              public void run(int iterations) throws Exception {
+                for (int i = 0; i < iterations; ++i) {
+                  transfer(client, peer, large);
+                }
+              }
+            });
+        } finally {
+          peer.close();
+        }
+      } finally {
+        client.close();
+      }
+    } finally {
+      server.close();
+    }
+  }
+}
@@ -0,0 +1,75 @@
+package benchmark;
+
+import java.util.HashMap;
+
+// Measures common String and HashMap operations.
+public class Strings {
+  private static final int KeyCount = 1024;
+
+  public static void main(String[] args) throws Exception {
+    final String[] keys = new String[KeyCount];
+    for (int i = 0; i < KeyCount; ++i) {
+      keys[i] = "key-" + i;
+    }
+
+    Harness.time("string.concat", new Harness.Body() {
+        public void run(int iterations) {
+          for (int i = 0; i < iterations; ++i) {
+            Harness.sink = new StringBuilder().append("value ").append(i)
+              .append(" of ").append(iterations).toString();
+          }
+        }
+      });
+
+    Harness.time("string.hashCode", new Harness.Body() {
+        public void run(int iterations) {
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            // a fresh string each time, since hash codes are cached
+            sum += new String(keys[i & (KeyCount - 1)]).hashCode();
+          }
+          Harness.intSink = sum;
+        }
+      });
+
+    Harness.time("string.indexOf", new Harness.Body() {
+        public void run(int iterations) {
+          String s = "the quick brown fox jumps over the lazy dog";
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            sum += s.indexOf("lazy");
+          }
+          Harness.intSink = sum;
+        }
+      });
+
+    Harness.time("hashmap.put", new Harness.Body() {
+        public void run(int iterations) {
+          HashMap<String, Integer> map = new HashMap<String, Integer>();
+          Integer value = Integer.valueOf(42);
+          for (int i = 0; i < iterations; ++i) {
+            if ((i & (KeyCount - 1)) == 0) {
+              map = new HashMap<String, Integer>();
+            }
+            map.put(keys[i & (KeyCount - 1)], value);
+          }
+          Harness.sink = map;
+        }
+      });
+
+    final HashMap<String, Integer> map = new HashMap<String, Integer>();
+    for (int i = 0; i < KeyCount; ++i) {
+      map.put(keys[i], Integer.valueOf(i));
+    }
+
+    Harness.time("hashmap.get", new Harness.Body() {
+        public void run(int iterations) {
+          int sum = 0;
+          for (int i = 0; i < iterations; ++i) {
+            sum += map.get(keys[i & (KeyCount - 1)]).intValue();
+          }
+          Harness.intSink = sum;
+        }
+      });
+  }
+}
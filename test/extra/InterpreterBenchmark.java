@@ -0,0 +1,95 @@
+package extra;
+
+// Run this on process=interpret builds made with dispatch=threaded and
+// dispatch=switch to compare the two ways of dispatching instructions.
+public class InterpreterBenchmark {
+  private int field;
+
+  private static int arithmetic(int n) {
+    int a = 1;
+    int b = 2;
+    for (int i = 0; i < n; ++i) {
+      a = (a * 31) ^ (b >>> 3);
+      b += a - i;
+      if ((a & 1) == 0) {
+        b = -b;
+      }
+    }
+    return a + b;
+  }
+
+  private static long arrays(int n) {
+    int[] array = new int[256];
+    long sum = 0;
+    for (int i = 0; i < n; ++i) {
+      int j = i & 255;
+      array[j] += i;
+      sum += array[255 - j];
+    }
+    return sum;
+  }
+
+  private int fields(int n) {
+    for (int i = 0; i < n; ++i) {
+      field += i;
+      if (field > 1000000) {
+        field -= 1000000;
+      }
+    }
+    return field;
+  }
+
+  private static int calls(int n) {
+    InterpreterBenchmark b = new InterpreterBenchmark();
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+      sum += b.get(i);
+    }
+    return sum;
+  }
+
+  private int get(int i) {
+    return i & 7;
+  }
+
+  private static void time(String name, Runnable r) {
+    long start = System.currentTimeMillis();
+    r.run();
+    System.out.println(name + ": " + (System.currentTimeMillis() - start)
+                       + " ms");
+  }
+
+  public static void main(String[] args) {
+    final int n = args.length > 0 ? Integer.parseInt(args[0]) : 10000000;
+    final int[] result = new int[1];
+
+    long start = System.currentTimeMillis();
+
+    time("arithmetic", new Runnable() {
+        public void run() {
+          result[0] += arithmetic(n);
+        }
+      });
+
+    time("arrays", new Runnable() {
+        public void run() {
+          result[0] += (int) arrays(n);
+        }
+      });
+
+    time("fields", new Runnable() {
+        public void run() {
+          result[0] += new InterpreterBenchmark().fields(n);
+        }
+      });
+
+    time("calls", new Runnable() {
+        public void run() {
+          result[0] += calls(n);
+        }
+      });
+
+    System.out.println("total: " + (System.currentTimeMillis() - start)
+                       + " ms (" + result[0] + ")");
+  }
+}
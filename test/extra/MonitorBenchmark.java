@@ -0,0 +1,52 @@
+package extra;
+
+// Measures how the cost of entering monitors scales with the number of
+// threads doing so at once, both for objects locked for the first time
+// (which creates their monitors) and for a monitor private to each
+// thread which already exists.
+public class MonitorBenchmark {
+  private static long run(int threadCount, final int iterations,
+                          final boolean fresh)
+    throws InterruptedException
+  {
+    Thread[] threads = new Thread[threadCount];
+    for (int i = 0; i < threadCount; ++i) {
+      threads[i] = new Thread() {
+          public void run() {
+            Object mine = new Object();
+            int count = 0;
+            for (int j = 0; j < iterations; ++j) {
+              Object o = fresh ? new Object() : mine;
+              synchronized (o) {
+                ++count;
+              }
+            }
+            if (count != iterations) throw new RuntimeException();
+          }
+        };
+    }
+
+    long start = System.currentTimeMillis();
+
+    for (int i = 0; i < threadCount; ++i) {
+      threads[i].start();
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+      threads[i].join();
+    }
+
+    return System.currentTimeMillis() - start;
+  }
+
+  public static void main(String[] args) throws InterruptedException {
+    int maxThreads = args.length > 0 ? Integer.parseInt(args[0]) : 64;
+    int iterations = args.length > 1 ? Integer.parseInt(args[1]) : 100000;
+
+    for (int n = 1; n <= maxThreads; n *= 2) {
+      System.out.println(n + " threads: fresh objects "
+                         + run(n, iterations, true) + " ms, existing monitor "
+                         + run(n, iterations, false) + " ms");
+    }
+  }
+}
@@ -0,0 +1,205 @@
+package extra;
+
+import avian.VirtualThread;
+
+import java.net.InetSocketAddress;
+import java.net.SocketAddress;
+import java.nio.ByteBuffer;
+import java.nio.channels.ServerSocketChannel;
+import java.nio.channels.SocketChannel;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.locks.LockSupport;
+
+public class VirtualThreads {
+  private static void expect(boolean v) {
+    if (! v) throw new RuntimeException();
+  }
+
+  private static void joinAll(List<VirtualThread> threads) throws Exception {
+    for (VirtualThread t : threads) {
+      t.join();
+    }
+  }
+
+  // passes a token around a ring of threads, each of which parks
+  // until its predecessor hands it over
+  private static void testRing() throws Exception {
+    final int Count = 100;
+    final int Rounds = 10;
+    final VirtualThread[] ring = new VirtualThread[Count];
+    final int[] token = new int[1];
+    final AtomicInteger passes = new AtomicInteger();
+
+    for (int i = 0; i < Count; ++i) {
+      final int index = i;
+      ring[i] = new VirtualThread(new Runnable() {
+          public void run() {
+            for (int round = 0; round < Rounds; ++round) {
+              while (true) {
+                synchronized (token) {
+                  if (token[0] == index) break;
+                }
+                LockSupport.park();
+              }
+
+              passes.incrementAndGet();
+
+              synchronized (token) {
+                token[0] = (index + 1) % Count;
+              }
+              ring[(index + 1) % Count].unpark();
+            }
+          }
+        });
+    }
+
+    for (VirtualThread t : ring) {
+      t.start();
+    }
+    for (VirtualThread t : ring) {
+      t.join();
+    }
+
+    expect(passes.get() == Count * Rounds);
+  }
+
+  private static void testSleep() throws Exception {
+    final List<Integer> order = new ArrayList<Integer>();
+    List<VirtualThread> threads = new ArrayList<VirtualThread>();
+    for (final int delay : new int[] { 300, 100, 200 }) {
+      VirtualThread t = new VirtualThread(new Runnable() {
+          public void run() {
+            try {
+              VirtualThread.sleep(delay);
+            } catch (InterruptedException e) {
+              throw new RuntimeException(e);
+            }
+            synchronized (order) {
+              order.add(delay);
+            }
+          }
+        });
+      threads.add(t);
+      t.start();
+    }
+
+    joinAll(threads);
+
+    expect(order.size() == 3);
+    expect(order.get(0) == 100);
+    expect(order.get(1) == 200);
+    expect(order.get(2) == 300);
+  }
+
+  private static void testJoin() throws Exception {
+    final AtomicInteger count = new AtomicInteger();
+    final VirtualThread child = new VirtualThread(new Runnable() {
+        public void run() {
+          try {
+            VirtualThread.sleep(50);
+          } catch (InterruptedException e) {
+            throw new RuntimeException(e);
+          }
+          count.incrementAndGet();
+        }
+      });
+
+    VirtualThread parent = new VirtualThread(new Runnable() {
+        public void run() {
+          child.start();
+          try {
+            child.join();
+          } catch (InterruptedException e) {
+            throw new RuntimeException(e);
+          }
+          expect(count.get() == 1);
+          count.incrementAndGet();
+        }
+      });
+
+    parent.start();
+    parent.join();
+
+    expect(count.get() == 2);
+    expect(! child.isAlive());
+    expect(! parent.isAlive());
+  }
+
+  // Starts more clients than there are carriers, all of which block
+  // reading from their sockets before the server writes anything.  If
+  // those reads blocked their carriers, the server would never run.
+  private static void testSockets() throws Exception {
+    final SocketAddress Address = new InetSocketAddress("localhost", 22049);
+    final int Count = (Runtime.getRuntime().availableProcessors() * 2) + 1;
+
+    final ServerSocketChannel server = ServerSocketChannel.open();
+    try {
+      server.socket().bind(Address);
+
+      final AtomicInteger received = new AtomicInteger();
+      List<VirtualThread> threads = new ArrayList<VirtualThread>();
+
+      threads.add(new VirtualThread(new Runnable() {
+          public void run() {
+            try {
+              List<SocketChannel> clients = new ArrayList<SocketChannel>();
+              for (int i = 0; i < Count; ++i) {
+                clients.add(server.accept());
+              }
+
+              for (SocketChannel c : clients) {
+                ByteBuffer b = ByteBuffer.wrap("hello".getBytes());
+                while (b.hasRemaining()) {
+                  c.write(b);
+                }
+                c.close();
+              }
+            } catch (Exception e) {
+              throw new RuntimeException(e);
+            }
+          }
+        }));
+
+      for (int i = 0; i < Count; ++i) {
+        threads.add(new VirtualThread(new Runnable() {
+            public void run() {
+              try {
+                SocketChannel c = SocketChannel.open();
+                try {
+                  c.connect(Address);
+
+                  ByteBuffer b = ByteBuffer.allocate(16);
+                  while (c.read(b) > 0) { }
+                  expect("hello".equals
+                         (new String(b.array(), 0, b.position())));
+                  received.incrementAndGet();
+                } finally {
+                  c.close();
+                }
+              } catch (Exception e) {
+                throw new RuntimeException(e);
+              }
+            }
+          }));
+      }
+
+      for (VirtualThread t : threads) {
+        t.start();
+      }
+      joinAll(threads);
+
+      expect(received.get() == Count);
+    } finally {
+      server.close();
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    testRing();
+    testSleep();
+    testJoin();
+    testSockets();
+  }
+}
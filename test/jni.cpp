@@ -211,6 +211,101 @@ extern "C" JNIEXPORT jobject JNICALL
   return e->NewLocalRef(o);
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+    JavaCritical_JNI_sumCritical(jint aLength,
+                                 jint* a,
+                                 jlong b,
+                                 jint cLength,
+                                 jbyte* c)
+{
+  jlong sum = b;
+  for (jint i = 0; i < aLength; ++i) {
+    sum += a[i];
+  }
+
+  // a null array arrives as a zero length and a null pointer
+  for (jint i = 0; i < cLength; ++i) {
+    sum += c[i];
+  }
+
+  return sum;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+    Java_JNI_makeLocalRefs(JNIEnv* e, jclass, jobjectArray array, jint frames)
+{
+  jint count = 0;
+  jsize length = e->GetArrayLength(array);
+  for (jint i = 0; i < frames; ++i) {
+    if (e->PushLocalFrame(length) != 0) {
+      return -1;
+    }
+
+    for (jsize j = 0; j < length; ++j) {
+      jobject o = e->GetObjectArrayElement(array, j);
+      jobject copy = e->NewLocalRef(o);
+      if (e->IsSameObject(o, copy)) {
+        ++count;
+      }
+      if (j % 2) {
+        e->DeleteLocalRef(copy);
+      }
+    }
+
+    e->PopLocalFrame(0);
+  }
+
+  return count;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+    Java_JNI_sumFields(JNIEnv* e, jclass, jobject a, jobject b, jint rounds)
+{
+  jobject objects[] = {a, b};
+  jlong sum = 0;
+  for (jint i = 0; i < rounds; ++i) {
+    for (unsigned j = 0; j < 2; ++j) {
+      jobject o = objects[j];
+      jclass c = e->GetObjectClass(o);
+
+      sum += e->GetIntField(o, e->GetFieldID(c, "x", "I"));
+      sum += e->GetLongField(o, e->GetFieldID(c, "y", "J"));
+      sum += static_cast<jlong>(
+          e->GetDoubleField(o, e->GetFieldID(c, "z", "D")));
+
+      jstring name = static_cast<jstring>(e->GetObjectField(
+          o, e->GetFieldID(c, "name", "Ljava/lang/String;")));
+      sum += e->GetStringUTFLength(name);
+
+      sum += e->CallIntMethod(o, e->GetMethodID(c, "m", "()I"));
+
+      e->DeleteLocalRef(name);
+      e->DeleteLocalRef(c);
+    }
+  }
+
+  return sum;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+    Java_JNI_collectWhileCritical(JNIEnv* e, jclass, jbyteArray array)
+{
+  volatile jbyte* body
+      = static_cast<jbyte*>(e->GetPrimitiveArrayCritical(array, 0));
+
+  // tell the collector thread we've got the array, then wait (for a
+  // few seconds at most) for it to report a completed collection
+  body[1] = 1;
+  bool collected = false;
+  for (uint64_t i = 0; i < 10000000000ULL and not collected; ++i) {
+    collected = body[0] != 0;
+  }
+
+  e->ReleasePrimitiveArrayCritical(array, const_cast<jbyte*>(body), 0);
+
+  return collected;
+}
+
 extern "C" JNIEXPORT jobject JNICALL
     Java_Buffers_allocateNative(JNIEnv* e, jclass, jint capacity)
 {
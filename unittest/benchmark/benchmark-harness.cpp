@@ -0,0 +1,108 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <avian/system/system.h>
+
+#include "benchmark-harness.h"
+
+using namespace vm;
+
+// since we aren't linking against libstdc++, we must implement this
+// ourselves:
+extern "C" void __cxa_pure_virtual(void)
+{
+  abort();
+}
+
+namespace {
+
+// each measurement runs for at least this long, doubling the
+// iteration count until it does; those runs double as a warm-up
+const int64_t MinimumNanoseconds = 250 * 1000 * 1000;
+
+const unsigned Repetitions = 5;
+
+int64_t elapsed(System* s, Benchmark* b, unsigned iterations)
+{
+  int64_t start = s->nanoTime();
+  b->run(iterations);
+  return s->nanoTime() - start;
+}
+
+}  // namespace
+
+Benchmark* Benchmark::first = 0;
+Benchmark** Benchmark::last = &first;
+
+Benchmark::Benchmark(const char* name) : next(0), name(name), s(0)
+{
+  *last = this;
+  last = &next;
+}
+
+void Benchmark::runAll(const char* filter, bool smoke)
+{
+  System* s = makeSystem();
+
+  for (Benchmark* b = Benchmark::first; b; b = b->next) {
+    if (filter and strncmp(b->name, filter, strlen(filter)) != 0) {
+      continue;
+    }
+
+    b->s = s;
+    b->setUp();
+
+    if (smoke) {
+      b->run(1);
+    } else {
+      unsigned iterations = 1;
+      while (elapsed(s, b, iterations) < MinimumNanoseconds) {
+        iterations *= 2;
+      }
+
+      int64_t best = elapsed(s, b, iterations);
+      for (unsigned i = 1; i < Repetitions; ++i) {
+        int64_t time = elapsed(s, b, iterations);
+        if (time < best) {
+          best = time;
+        }
+      }
+
+      printf("native.%s\t%.1f\tns/op\n",
+             b->name,
+             static_cast<double>(best) / iterations);
+      fflush(stdout);
+    }
+
+    b->tearDown();
+  }
+
+  s->dispose();
+}
+
+int main(int argc, char** argv)
+{
+  bool smoke = false;
+  const char* filter = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-smoke") == 0) {
+      smoke = true;
+    } else {
+      filter = argv[i];
+    }
+  }
+
+  Benchmark::runAll(filter, smoke);
+
+  return 0;
+}
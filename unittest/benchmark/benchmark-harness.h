@@ -0,0 +1,65 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#ifndef BENCHMARK_HARNESS_H
+#define BENCHMARK_HARNESS_H
+
+#include "avian/common.h"
+#include <avian/system/system.h>
+#include <stdio.h>
+
+// A benchmark times its run method, which must repeat the work being
+// measured the specified number of times.  Anything which shouldn't
+// count toward the result belongs in setUp, which is called once
+// before timing starts, and tearDown, called once after.  Benchmarks
+// which need them subclass Benchmark directly; the BENCHMARK macro is
+// for those which don't.  Only one System may exist at a time, so
+// benchmarks use the harness's.
+class Benchmark {
+ private:
+  Benchmark* next;
+  static Benchmark* first;
+  static Benchmark** last;
+
+  friend int main(int argc, char** argv);
+
+ public:
+  const char* const name;
+  vm::System* s;
+  Benchmark(const char* name);
+
+  virtual void setUp()
+  {
+  }
+
+  virtual void run(unsigned iterations) = 0;
+
+  virtual void tearDown()
+  {
+  }
+
+  // Prints one "name<TAB>nanoseconds<TAB>ns/op" line for each
+  // benchmark whose name starts with filter (or every one if filter is
+  // null).  If smoke is true, each is run just once, without output,
+  // as a check that it still works.
+  static void runAll(const char* filter, bool smoke);
+};
+
+#define BENCHMARK(name)                                \
+  class name##BenchmarkClass : public Benchmark {      \
+   public:                                             \
+    name##BenchmarkClass() : Benchmark(#name)          \
+    {                                                  \
+    }                                                  \
+    virtual void run(unsigned iterations);             \
+  } name##BenchmarkInstance;                           \
+  void name##BenchmarkClass::run(unsigned iterations)
+
+#endif  // BENCHMARK_HARNESS_H
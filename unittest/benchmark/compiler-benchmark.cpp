@@ -0,0 +1,359 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include <string.h>
+
+#include "avian/common.h"
+#include <avian/heap/heap.h>
+#include <avian/system/system.h>
+#include "avian/target.h"
+#include "avian/zone.h"
+
+#include <avian/codegen/assembler.h>
+#include <avian/codegen/architecture.h>
+#include <avian/codegen/compiler.h>
+#include <avian/codegen/promise.h>
+#include <avian/codegen/targets.h>
+#include <avian/codegen/lir.h>
+
+#include "benchmark-harness.h"
+
+using namespace avian::codegen;
+using namespace vm;
+
+namespace {
+
+// The compiler benchmark replays a stream of instructions in the
+// manner of compile.cpp translating bytecode: one logical IP per
+// instruction, operands passed on the compiler's stack, and the target
+// of each branch compiled before its fall-through path.  Every local
+// is an int parameter, so any of them may be read at any point.  The
+// stream is made of statements which leave the stack empty, which are
+// the only places branches go to.
+
+enum OpCode { Load, Constant, Arithmetic, Store, Branch, Return };
+
+class Op {
+ public:
+  OpCode code;
+  int operand;
+  lir::TernaryOperation operation;
+};
+
+const unsigned LocalCount = 8;
+const unsigned MaxStack = 2;
+const unsigned StatementCount = 256;
+const unsigned MaxOpCount = (StatementCount * 4) + 2;
+const unsigned CodeCapacity = 256 * 1024;
+
+const lir::TernaryOperation Operations[]
+    = {lir::Add, lir::Subtract, lir::And, lir::Or, lir::Xor, lir::Multiply};
+
+class Stream {
+ public:
+  Stream() : count(0), seed(42)
+  {
+  }
+
+  unsigned random()
+  {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xFFFFFF;
+  }
+
+  void append(OpCode code,
+              int operand,
+              lir::TernaryOperation operation = lir::Add)
+  {
+    ops[count].code = code;
+    ops[count].operand = operand;
+    ops[count].operation = operation;
+    ++count;
+  }
+
+  // Generates StatementCount statements, one in eight a conditional
+  // branch forward over a few of the statements which follow, the
+  // rest of the "a = b op c" form, ending with a return.
+  void generate()
+  {
+    unsigned starts[StatementCount + 1];
+    unsigned branches[StatementCount];
+    unsigned branchCount = 0;
+
+    for (unsigned i = 0; i < StatementCount; ++i) {
+      starts[i] = count;
+
+      if (i % 8 == 7) {
+        append(Load, random() % LocalCount);
+        append(Constant, random() % 100);
+        branches[branchCount++] = count;
+        append(Branch, i + 1 + (random() % 4));
+      } else {
+        append(Load, random() % LocalCount);
+        append(Load, random() % LocalCount);
+        append(Arithmetic,
+               0,
+               Operations[random()
+                          % (sizeof(Operations) / sizeof(Operations[0]))]);
+        append(Store, random() % LocalCount);
+      }
+    }
+
+    starts[StatementCount] = count;
+    append(Load, 0);
+    append(Return, 0);
+
+    // translate statement numbers to logical IPs
+    for (unsigned i = 0; i < branchCount; ++i) {
+      Op* op = ops + branches[i];
+      unsigned target = op->operand;
+      op->operand = starts[target < StatementCount ? target : StatementCount];
+    }
+  }
+
+  Op ops[MaxOpCount];
+  unsigned count;
+  unsigned seed;
+};
+
+class Client : public Compiler::Client {
+ public:
+  // the stream only uses operations every architecture implements
+  // inline for ints
+  virtual intptr_t getThunk(lir::UnaryOperation, unsigned)
+  {
+    abort();
+  }
+
+  virtual intptr_t getThunk(lir::BinaryOperation, unsigned, unsigned)
+  {
+    abort();
+  }
+
+  virtual intptr_t getThunk(lir::TernaryOperation,
+                            unsigned,
+                            unsigned,
+                            bool*)
+  {
+    abort();
+  }
+};
+
+class Pending {
+ public:
+  Compiler::State* state;
+  unsigned ip;
+};
+
+void replay(Compiler* c, Stream* stream, bool* visited, Pending* pending)
+{
+  memset(visited, 0, stream->count * sizeof(bool));
+  unsigned pendingCount = 0;
+  unsigned ip = 0;
+
+  while (true) {
+    if (visited[ip]) {
+      c->visitLogicalIp(ip);
+    } else {
+      visited[ip] = true;
+      c->startLogicalIp(ip);
+
+      Op* op = stream->ops + ip;
+      switch (op->code) {
+      case Load:
+        c->push(ir::Type::i4(), c->loadLocal(ir::Type::i4(), op->operand));
+        ++ip;
+        continue;
+
+      case Constant:
+        c->push(ir::Type::i4(), c->constant(op->operand, ir::Type::i4()));
+        ++ip;
+        continue;
+
+      case Arithmetic: {
+        ir::Value* b = c->pop(ir::Type::i4());
+        ir::Value* a = c->pop(ir::Type::i4());
+        c->push(ir::Type::i4(),
+                c->binaryOp(op->operation, ir::Type::i4(), a, b));
+        ++ip;
+      }
+        continue;
+
+      case Store:
+        c->storeLocal(c->pop(ir::Type::i4()), op->operand);
+        ++ip;
+        continue;
+
+      case Branch: {
+        ir::Value* b = c->pop(ir::Type::i4());
+        ir::Value* a = c->pop(ir::Type::i4());
+        c->condJump(
+            lir::JumpIfLess,
+            a,
+            b,
+            c->promiseConstant(c->machineIp(op->operand), ir::Type::iptr()));
+
+        pending[pendingCount].state = c->saveState();
+        pending[pendingCount].ip = ip + 1;
+        ++pendingCount;
+
+        ip = op->operand;
+      }
+        continue;
+
+      case Return:
+        c->return_(c->pop(ir::Type::i4()));
+        break;
+      }
+    }
+
+    if (pendingCount == 0) {
+      break;
+    }
+
+    --pendingCount;
+    c->restoreState(pending[pendingCount].state);
+    ip = pending[pendingCount].ip;
+  }
+}
+
+class CodegenBenchmark : public Benchmark {
+ public:
+  CodegenBenchmark(const char* name)
+      : Benchmark(name), heap(0), arch(0), code(0)
+  {
+  }
+
+  virtual void setUp()
+  {
+    heap = makeHeap(s, 64 * 1024 * 1024);
+    arch = makeArchitectureNative(s, true);
+    arch->acquire();
+
+    code = static_cast<uint8_t*>(heap->allocate(CodeCapacity));
+  }
+
+  virtual void tearDown()
+  {
+    heap->free(code, CodeCapacity);
+    arch->release();
+    heap->dispose();
+  }
+
+  Heap* heap;
+  Architecture* arch;
+  uint8_t* code;
+};
+
+// translating one method of StatementCount statements to machine code,
+// from the first IR instruction to the last byte written
+class CodegenCompile : public CodegenBenchmark {
+ public:
+  CodegenCompile() : CodegenBenchmark("codegen.compile")
+  {
+  }
+
+  virtual void setUp()
+  {
+    CodegenBenchmark::setUp();
+    stream.generate();
+  }
+
+  virtual void run(unsigned iterations)
+  {
+    for (unsigned i = 0; i < iterations; ++i) {
+      Zone zone(heap, 64 * 1024);
+      Assembler* a = arch->makeAssembler(heap, &zone);
+      Compiler* c = makeCompiler(s, a, &zone, &client);
+
+      c->init(stream.count,
+              LocalCount,
+              LocalCount,
+              arch->alignFrameSize(MaxStack + arch->frameFootprint(0)));
+
+      for (unsigned j = 0; j < LocalCount; ++j) {
+        c->initLocal(j, ir::Type::i4());
+      }
+
+      replay(c, &stream, visited, pending);
+
+      c->compile(0, 0);
+      unsigned size = c->resolve(code);
+      expect(s, pad(size, TargetBytesPerWord) + c->poolSize() <= CodeCapacity);
+      c->write();
+
+      c->dispose();
+      a->dispose();
+    }
+  }
+
+  Stream stream;
+  Client client;
+  bool visited[MaxOpCount];
+  Pending pending[StatementCount];
+} codegenCompile;
+
+// assembling a block of register, constant and memory moves and
+// arithmetic straight from LIR, as the thunks are, bypassing the
+// compiler's register allocation
+class CodegenAssemble : public CodegenBenchmark {
+ public:
+  static const unsigned InstructionCount = 1024;
+
+  CodegenAssemble() : CodegenBenchmark("codegen.assemble")
+  {
+  }
+
+  virtual void run(unsigned iterations)
+  {
+    const RegisterFile* registers = arch->registerFile();
+    Register r[2];
+    unsigned n = 0;
+    for (Register i : registers->generalRegisters) {
+      if (n < 2 and not arch->reserved(i)) {
+        r[n++] = i;
+      }
+    }
+    expect(s, n == 2);
+
+    lir::RegisterPair a(r[0]);
+    lir::RegisterPair b(r[1]);
+    lir::Memory memory(r[1], TargetBytesPerWord);
+    ResolvedPromise value(0x1234);
+    lir::Constant constant(&value);
+
+    const unsigned Size = TargetBytesPerWord;
+    OperandInfo ra(Size, lir::Operand::Type::RegisterPair, &a);
+    OperandInfo rb(Size, lir::Operand::Type::RegisterPair, &b);
+    OperandInfo m(Size, lir::Operand::Type::Memory, &memory);
+    OperandInfo k(Size, lir::Operand::Type::Constant, &constant);
+
+    for (unsigned i = 0; i < iterations; ++i) {
+      Zone zone(heap, 64 * 1024);
+      Assembler* as = arch->makeAssembler(heap, &zone);
+
+      for (unsigned j = 0; j < InstructionCount; j += 4) {
+        as->apply(lir::Move, k, ra);
+        as->apply(lir::Move, m, rb);
+        as->apply(lir::Add, ra, rb, rb);
+        as->apply(lir::Move, rb, m);
+      }
+
+      unsigned size = as->endBlock(false)->resolve(0, 0);
+      expect(s, size <= CodeCapacity);
+      as->setDestination(code);
+      as->write();
+
+      as->dispose();
+    }
+  }
+} codegenAssemble;
+
+}  // namespace
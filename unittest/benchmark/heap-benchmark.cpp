@@ -0,0 +1,231 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include <string.h>
+
+#include "avian/common.h"
+
+#include <avian/heap/heap.h>
+#include <avian/system/system.h>
+
+#include "benchmark-harness.h"
+
+using namespace vm;
+
+namespace {
+
+// Objects are laid out as [header, field...], the header holding the
+// size in words shifted left by one.  Each object is a node of a
+// binary tree, with two fields for its children and two more which
+// are left null.
+
+const unsigned FieldCount = 4;
+const unsigned ObjectSizeInWords = 1 + FieldCount;
+const unsigned YoungObjectCount = 16 * 1024;
+const unsigned OldObjectCount = 64 * 1024;
+const unsigned ArenaSizeInWords = 2 * YoungObjectCount * ObjectSizeInWords;
+
+class Tree : public Heap::Client {
+ public:
+  Tree(Heap* heap) : heap(heap), arena(0), arenaPosition(0), young(0), old(0)
+  {
+  }
+
+  static uintptr_t& header(void* o)
+  {
+    return static_cast<uintptr_t*>(o)[0];
+  }
+
+  static void*& field(void* o, unsigned i)
+  {
+    return static_cast<void**>(o)[1 + i];
+  }
+
+  virtual void collect(void*, Heap::CollectionType)
+  {
+    abort();
+  }
+
+  virtual void visitRoots(Heap::Visitor* v)
+  {
+    v->visit(&young);
+    v->visit(&old);
+
+    heap->postVisit();
+  }
+
+  virtual bool isFixed(void*)
+  {
+    return false;
+  }
+
+  virtual unsigned sizeInWords(void* p)
+  {
+    return header(heap->follow(p)) >> 1;
+  }
+
+  virtual unsigned copiedSizeInWords(void* p)
+  {
+    return sizeInWords(p);
+  }
+
+  virtual void copy(void* src, void* dst)
+  {
+    memcpy(dst, heap->follow(src), sizeInWords(src) * BytesPerWord);
+  }
+
+  virtual void tenured(void*)
+  {
+  }
+
+  virtual void walk(void*, Heap::Walker* w)
+  {
+    for (unsigned i = 1; i < ObjectSizeInWords; ++i) {
+      if (not w->visit(i)) {
+        break;
+      }
+    }
+  }
+
+  void startArena()
+  {
+    arena = static_cast<uintptr_t*>(
+        heap->allocate(ArenaSizeInWords * BytesPerWord));
+    arenaPosition = 0;
+  }
+
+  void endArena()
+  {
+    heap->free(arena, ArenaSizeInWords * BytesPerWord);
+    arena = 0;
+  }
+
+  void* make()
+  {
+    void* o = arena + arenaPosition;
+    arenaPosition += ObjectSizeInWords;
+
+    header(o) = ObjectSizeInWords << 1;
+    for (unsigned i = 0; i < FieldCount; ++i) {
+      field(o, i) = 0;
+    }
+
+    return o;
+  }
+
+  // Builds a complete binary tree of the specified number of objects in
+  // the arena, interleaved with as many unreachable ones.
+  void* build(unsigned count, void** nodes)
+  {
+    for (unsigned i = 0; i < count; ++i) {
+      nodes[i] = make();
+      make();
+
+      if (i) {
+        field(nodes[(i - 1) / 2], (i - 1) % 2) = nodes[i];
+      }
+    }
+
+    return nodes[0];
+  }
+
+  Heap* heap;
+  uintptr_t* arena;
+  unsigned arenaPosition;
+  void* young;
+  void* old;
+};
+
+class HeapBenchmark : public Benchmark {
+ public:
+  HeapBenchmark(const char* name)
+      : Benchmark(name), heap(0), tree(0), nodes(0)
+  {
+  }
+
+  virtual void setUp()
+  {
+    heap = makeHeap(s, 256 * 1024 * 1024);
+
+    tree = new (heap->allocate(sizeof(Tree))) Tree(heap);
+    heap->setClient(tree);
+
+    nodes = static_cast<void**>(
+        heap->allocate(OldObjectCount * sizeof(void*)));
+  }
+
+  virtual void tearDown()
+  {
+    heap->free(nodes, OldObjectCount * sizeof(void*));
+    heap->free(tree, sizeof(Tree));
+    heap->disposeFixies();
+    heap->dispose();
+  }
+
+  Heap* heap;
+  Tree* tree;
+  void** nodes;
+};
+
+// a minor collection finding a freshly built tree of YoungObjectCount
+// objects live, and as many dead
+class HeapMinorCollection : public HeapBenchmark {
+ public:
+  HeapMinorCollection() : HeapBenchmark("heap.minorCollection")
+  {
+  }
+
+  virtual void run(unsigned iterations)
+  {
+    for (unsigned i = 0; i < iterations; ++i) {
+      tree->startArena();
+      tree->young = tree->build(YoungObjectCount, nodes);
+
+      heap->collect(Heap::MinorCollection, tree->arenaPosition, 0);
+
+      tree->endArena();
+    }
+  }
+} heapMinorCollection;
+
+// a major collection with a tree of OldObjectCount objects live
+class HeapMajorCollection : public HeapBenchmark {
+ public:
+  HeapMajorCollection() : HeapBenchmark("heap.majorCollection")
+  {
+  }
+
+  virtual void setUp()
+  {
+    HeapBenchmark::setUp();
+
+    for (unsigned i = 0; i < OldObjectCount; i += YoungObjectCount) {
+      tree->startArena();
+      void* subtree = tree->build(YoungObjectCount, nodes);
+      if (tree->old) {
+        Tree::field(subtree, 2) = tree->old;
+      }
+      tree->old = subtree;
+
+      heap->collect(Heap::MajorCollection, tree->arenaPosition, 0);
+
+      tree->endArena();
+    }
+  }
+
+  virtual void run(unsigned iterations)
+  {
+    for (unsigned i = 0; i < iterations; ++i) {
+      heap->collect(Heap::MajorCollection, 0, 0);
+    }
+  }
+} heapMajorCollection;
+
+}  // namespace
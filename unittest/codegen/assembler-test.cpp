@@ -82,3 +82,30 @@ TEST(ArchitecturePlan)
     assertNotEqual(static_cast<uint64_t>(0), (uint64_t)mask.lowRegisterMask);
   }
 }
+
+TEST(ArchitecturePlanBitCounts)
+{
+  BasicEnv env;
+
+  lir::BinaryOperation ops[] = {lir::PopCount, lir::CountLeadingZeros};
+  for (unsigned i = 0; i < 2; ++i) {
+    for (unsigned size = 4; size <= 8; size += 4) {
+      bool thunk;
+      OperandMask aMask;
+      env.arch->planSource(ops[i], size, aMask, size, &thunk);
+
+      if (size > vm::TargetBytesPerWord) {
+        assertTrue(thunk);
+      } else if (not thunk) {
+        // the instructions only take a register operand
+        assertEqual(static_cast<unsigned>(lir::Operand::RegisterPairMask),
+                    static_cast<unsigned>(aMask.typeMask));
+
+        OperandMask bMask;
+        env.arch->planDestination(ops[i], size, aMask, size, bMask);
+        assertEqual(static_cast<unsigned>(lir::Operand::RegisterPairMask),
+                    static_cast<unsigned>(bMask.typeMask));
+      }
+    }
+  }
+}
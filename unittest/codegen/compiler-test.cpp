@@ -0,0 +1,277 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "avian/common.h"
+#include <avian/heap/heap.h>
+#include <avian/system/system.h>
+#include "avian/target.h"
+#include "avian/environment.h"
+#include "avian/zone.h"
+
+#include <avian/codegen/assembler.h>
+#include <avian/codegen/architecture.h>
+#include <avian/codegen/compiler.h>
+#include <avian/codegen/targets.h>
+#include <avian/codegen/lir.h>
+
+#include "test-harness.h"
+
+using namespace avian::codegen;
+using namespace vm;
+
+namespace {
+
+class Client : public Compiler::Client {
+ public:
+  virtual intptr_t getThunk(lir::UnaryOperation, unsigned)
+  {
+    abort();
+  }
+
+  virtual intptr_t getThunk(lir::BinaryOperation, unsigned, unsigned)
+  {
+    abort();
+  }
+
+  virtual intptr_t getThunk(lir::TernaryOperation, unsigned, unsigned, bool*)
+  {
+    abort();
+  }
+};
+
+class CompilerEnv {
+ public:
+  CompilerEnv(ir::Type localType = ir::Type::i4(),
+              unsigned logicalCodeLength = 2)
+      : s(makeSystem()),
+        heap(makeHeap(s, 1024 * 1024)),
+        arch(makeArchitectureNative(s, true)),
+        zone(heap, 8192)
+  {
+    arch->acquire();
+    a = arch->makeAssembler(heap, &zone);
+    c = makeCompiler(s, a, &zone, &client);
+
+    c->init(logicalCodeLength, 1, 1, arch->alignFrameSize(2 + arch->frameFootprint(0)));
+    c->initLocal(0, localType);
+    c->startLogicalIp(0);
+  }
+
+  ~CompilerEnv()
+  {
+    c->dispose();
+    a->dispose();
+    zone.dispose();
+    arch->release();
+    heap->dispose();
+    s->dispose();
+  }
+
+  ir::Value* constant(int64_t value)
+  {
+    return c->constant(value, ir::Type::i4());
+  }
+
+  // "second op first", as compile.cpp passes the operands of
+  // arithmetic instructions
+  ir::Value* op(lir::TernaryOperation op,
+                ir::Value* second,
+                ir::Value* first)
+  {
+    return c->binaryOp(op, ir::Type::i4(), first, second);
+  }
+
+  System* s;
+  Heap* heap;
+  Architecture* arch;
+  Zone zone;
+  Client client;
+  Assembler* a;
+  Compiler* c;
+};
+
+// Compiles "if (((6 * 7) - 2) / -1 == expected) goto 1; 1: return",
+// returning the size of the machine code.  A branch on two constants
+// is either taken unconditionally or not at all, so the code is larger
+// if the folded value is the expected one.
+unsigned branchSize(int64_t expected)
+{
+  CompilerEnv env;
+  Compiler* c = env.c;
+
+  ir::Value* v = env.op(
+      lir::Divide,
+      env.op(lir::Subtract,
+             env.op(lir::Multiply, env.constant(6), env.constant(7)),
+             env.constant(2)),
+      env.constant(-1));
+
+  c->condJump(lir::JumpIfEqual,
+              v,
+              env.constant(expected),
+              c->promiseConstant(c->machineIp(1), ir::Type::iptr()));
+
+  c->startLogicalIp(1);
+  c->return_();
+
+  c->compile(0, 0);
+
+  uint8_t code[1024];
+  unsigned size = c->resolve(code);
+  c->write();
+  return size;
+}
+
+}  // namespace
+
+TEST(CompilerFoldsConstants)
+{
+  CompilerEnv env;
+  Compiler* c = env.c;
+  unsigned events = c->eventCount();
+
+  env.op(lir::Add, env.constant(2), env.constant(3));
+  env.op(lir::ShiftLeft, env.constant(1), env.constant(35));
+  env.op(lir::Divide, env.constant(-0x7FFFFFFF - 1), env.constant(-1));
+  env.op(lir::Remainder, env.constant(7), env.constant(-3));
+  c->unaryOp(lir::Negate, env.constant(5));
+  c->unaryOp(lir::PopCount, env.constant(-1));
+  c->unaryOp(lir::CountLeadingZeros, env.constant(0));
+  assertEqual(events, c->eventCount());
+
+  // division by zero still has to trap at run time
+  env.op(lir::Divide, env.constant(1), env.constant(0));
+  assertTrue(c->eventCount() > events);
+}
+
+TEST(CompilerSimplifiesIdentities)
+{
+  CompilerEnv env;
+  Compiler* c = env.c;
+  ir::Value* x = c->loadLocal(ir::Type::i4(), 0);
+  unsigned events = c->eventCount();
+
+  assertTrue(env.op(lir::Add, x, env.constant(0)) == x);
+  assertTrue(env.op(lir::Add, env.constant(0), x) == x);
+  assertTrue(env.op(lir::Subtract, x, env.constant(0)) == x);
+  assertTrue(env.op(lir::Multiply, env.constant(1), x) == x);
+  assertTrue(env.op(lir::And, x, env.constant(-1)) == x);
+  assertTrue(env.op(lir::ShiftRight, x, env.constant(0)) == x);
+  assertEqual(events, c->eventCount());
+
+  assertTrue(env.op(lir::Subtract, env.constant(0), x) != x);
+  assertTrue(c->eventCount() > events);
+}
+
+TEST(CompilerForgetsConstantsAtBlocks)
+{
+  CompilerEnv env;
+  Compiler* c = env.c;
+  ir::Value* two = env.constant(2);
+  ir::Value* three = env.constant(3);
+
+  // the values might have been rebound on another path into the
+  // block, so they're no longer known
+  c->startBlock();
+
+  unsigned events = c->eventCount();
+  env.op(lir::Add, two, three);
+  assertTrue(c->eventCount() > events);
+}
+
+TEST(CompilerFoldedValues)
+{
+  unsigned taken = branchSize(-40);
+  assertTrue(taken > branchSize(40));
+  assertTrue(taken > branchSize(-41));
+}
+
+TEST(CompilerMovesFailedBoundsChecksOutOfLine)
+{
+  CompilerEnv env(ir::Type::object());
+  Compiler* c = env.c;
+  uint8_t code[1024];
+
+  // the handler is never called, but it has to be within reach of a
+  // direct call
+  c->checkBounds(c->loadLocal(ir::Type::object(), 0),
+                 TargetBytesPerWord,
+                 env.constant(3),
+                 reinterpret_cast<intptr_t>(code));
+  c->return_();
+
+  c->compile(0, 0);
+
+  unsigned size = c->resolve(code);
+  c->write();
+
+  assertEqual(1u, c->coldCallCount());
+
+  Promise* start;
+  Promise* end;
+  Promise* hotReturn;
+  c->coldCall(0, &start, &end, &hotReturn);
+
+  // the in-bounds path runs on to the return, and the call comes after
+  assertTrue(start->value() >= hotReturn->value());
+  assertTrue(end->value() > start->value());
+  assertTrue(end->value() <= reinterpret_cast<intptr_t>(code) + size);
+}
+
+#if (AVIAN_TARGET_ARCH == AVIAN_ARCH_X86) \
+    || (AVIAN_TARGET_ARCH == AVIAN_ARCH_X86_64)
+TEST(CompilerShortensBackwardBranches)
+{
+  CompilerEnv env(ir::Type::i4(), 3);
+  Compiler* c = env.c;
+
+  // 0: if (x == 0) goto 2; 1: goto 0; 2: return
+  c->condJump(lir::JumpIfEqual,
+              c->loadLocal(ir::Type::i4(), 0),
+              env.constant(0),
+              c->promiseConstant(c->machineIp(2), ir::Type::iptr()));
+
+  // as compile.cpp does, compile the branch target first
+  Compiler::State* state = c->saveState();
+
+  c->startLogicalIp(2);
+  c->return_();
+
+  c->restoreState(state);
+
+  c->startLogicalIp(1);
+  c->jmp(c->promiseConstant(c->machineIp(0), ir::Type::iptr()));
+  c->visitLogicalIp(0);
+
+  c->compile(0, 0);
+
+  uint8_t code[1024];
+  c->resolve(code);
+  c->write();
+
+  uint8_t* loop = reinterpret_cast<uint8_t*>(c->machineIp(0)->value());
+  uint8_t* jump = reinterpret_cast<uint8_t*>(c->machineIp(1)->value());
+  uint8_t* exit = reinterpret_cast<uint8_t*>(c->machineIp(2)->value());
+
+  // the jump back is short, and the branch forward, whose target
+  // wasn't placed yet, is long
+  assertEqual(static_cast<uint8_t>(0xeb), jump[0]);
+  assertTrue(jump + 2 + static_cast<int8_t>(jump[1]) == loop);
+
+  int32_t forward;
+  memcpy(&forward, jump - 4, 4);
+  assertEqual(static_cast<uint8_t>(0x0f), jump[-6]);
+  assertEqual(static_cast<uint8_t>(0x84), jump[-5]);
+  assertTrue(jump + forward == exit);
+}
+#endif
@@ -0,0 +1,622 @@
+/* Copyright (c) 2008-2015, Avian Contributors
+
+   Permission to use, copy, modify, and/or distribute this software
+   for any purpose with or without fee is hereby granted, provided
+   that the above copyright notice and this permission notice appear
+   in all copies.
+
+   There is NO WARRANTY for this software.  See license.txt for
+   details. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "avian/common.h"
+
+#include <avian/heap/heap.h>
+#include <avian/system/system.h>
+
+#include "test-harness.h"
+
+using namespace vm;
+
+namespace {
+
+// Objects are laid out as [header, id, field...] where the header holds
+// the size in words shifted left by two, plus FixedFlag for objects
+// allocated with allocateFixed.  Blobs are fixed objects whose
+// contents are not references.
+
+const uintptr_t FixedFlag = 1;
+const uintptr_t BlobFlag = 2;
+
+const unsigned ObjectCount = 64 * 1024;
+const unsigned BatchSize = 4096;
+const unsigned FieldCount = 4;
+const unsigned RootCount = 16;
+const unsigned ArenaSizeInWords = 64 * 1024;
+const unsigned BlobCount = 8;
+const unsigned BlobSizeInWords = 128 * 1024;
+
+class Graph : public Heap::Client {
+ public:
+  Graph(Heap* heap, void** live)
+      : heap(heap),
+        live(live),
+        arena(0),
+        arenaPosition(0),
+        count(0),
+        seed(42),
+        pretenure(false),
+        pretenured(0),
+        sawTenured(false)
+  {
+    memset(roots, 0, sizeof(roots));
+    memset(blobs, 0, sizeof(blobs));
+  }
+
+  static uintptr_t& header(void* o)
+  {
+    return static_cast<uintptr_t*>(o)[0];
+  }
+
+  static uintptr_t& id(void* o)
+  {
+    return static_cast<uintptr_t*>(o)[1];
+  }
+
+  static void*& field(void* o, unsigned i)
+  {
+    return static_cast<void**>(o)[2 + i];
+  }
+
+  static unsigned fieldCount(unsigned id)
+  {
+    return 1 + (id % FieldCount);
+  }
+
+  unsigned random()
+  {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xFFFFFF;
+  }
+
+  virtual void collect(void*, Heap::CollectionType)
+  {
+    abort();
+  }
+
+  virtual void visitRoots(Heap::Visitor* v)
+  {
+    for (unsigned i = 0; i < RootCount; ++i) {
+      v->visit(roots + i);
+    }
+
+    for (unsigned i = 0; i < BlobCount; ++i) {
+      v->visit(blobs + i);
+    }
+
+    heap->postVisit();
+  }
+
+  virtual bool isFixed(void* p)
+  {
+    return (header(p) & FixedFlag) != 0;
+  }
+
+  virtual unsigned sizeInWords(void* p)
+  {
+    return header(heap->follow(p)) >> 2;
+  }
+
+  virtual unsigned copiedSizeInWords(void* p)
+  {
+    return sizeInWords(p);
+  }
+
+  virtual void copy(void* src, void* dst)
+  {
+    memcpy(dst, heap->follow(src), sizeInWords(src) * BytesPerWord);
+  }
+
+  virtual void tenured(void*)
+  {
+    sawTenured = true;
+  }
+
+  virtual void walk(void* p, Heap::Walker* w)
+  {
+    void* o = heap->follow(p);
+    if (header(o) & BlobFlag) {
+      return;
+    }
+
+    for (unsigned i = 2; i < (header(o) >> 2); ++i) {
+      if (not w->visit(i)) {
+        break;
+      }
+    }
+  }
+
+  void* make(bool fixed)
+  {
+    ++count;
+    unsigned size = 2 + fieldCount(count);
+
+    void* o = 0;
+    if (fixed) {
+      o = heap->allocateFixed(heap, size, true);
+    } else if (pretenure and random() % 4 == 0) {
+      o = heap->tryAllocateTenured(size);
+      if (o) {
+        ++pretenured;
+      }
+    }
+
+    if (o == 0) {
+      o = arena + arenaPosition;
+      arenaPosition += size;
+    }
+
+    heap->allocated(size * BytesPerWord);
+
+    header(o) = (size << 2) | (fixed ? FixedFlag : 0);
+    id(o) = count;
+    for (unsigned i = 0; i < fieldCount(count); ++i) {
+      field(o, i) = 0;
+      model[count][i] = 0;
+    }
+
+    return o;
+  }
+
+  void* makeBlob(unsigned pattern)
+  {
+    uintptr_t* o = static_cast<uintptr_t*>(
+        heap->allocateFixed(heap, BlobSizeInWords, false));
+
+    header(o) = (BlobSizeInWords << 2) | FixedFlag | BlobFlag;
+    for (unsigned i = 1; i < BlobSizeInWords; ++i) {
+      o[i] = pattern;
+    }
+
+    return o;
+  }
+
+  bool intact(void* o, unsigned pattern)
+  {
+    for (unsigned i = 1; i < BlobSizeInWords; ++i) {
+      if (static_cast<uintptr_t*>(o)[i] != pattern) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void set(void* o, unsigned i, void* value)
+  {
+    field(o, i) = value;
+    model[id(o)][i] = value ? id(value) : 0;
+    heap->mark(o, 2 + i, 1);
+  }
+
+  unsigned reachable(void** list, unsigned capacity)
+  {
+    memset(where, 0, sizeof(where));
+
+    unsigned n = 0;
+    for (unsigned i = 0; i < RootCount; ++i) {
+      if (roots[i] and where[id(roots[i])] == 0) {
+        where[id(roots[i])] = roots[i];
+        list[n++] = roots[i];
+      }
+    }
+
+    for (unsigned i = 0; i < n; ++i) {
+      void* o = list[i];
+      for (unsigned j = 0; j < fieldCount(id(o)); ++j) {
+        void* child = field(o, j);
+        if (child and where[id(child)] == 0 and n < capacity) {
+          where[id(child)] = child;
+          list[n++] = child;
+        }
+      }
+    }
+
+    return n;
+  }
+
+  // Adds a batch of new objects, some reachable only from older ones.
+  void mutate()
+  {
+    arena = static_cast<uintptr_t*>(
+        heap->allocate(ArenaSizeInWords * BytesPerWord));
+    arenaPosition = 0;
+
+    if (count + BatchSize >= ObjectCount) {
+      return;
+    }
+
+    unsigned liveCount = reachable(live, ObjectCount);
+    void** fresh = live + liveCount;
+    for (unsigned i = 0; i < BatchSize; ++i) {
+      fresh[i] = make(random() % 16 == 0);
+
+      for (unsigned j = 0; j < fieldCount(id(fresh[i])); ++j) {
+        unsigned r = random() % 3;
+        if (r == 0 and i) {
+          set(fresh[i], j, fresh[random() % i]);
+        } else if (r == 1 and liveCount) {
+          set(fresh[i], j, live[random() % liveCount]);
+        }
+      }
+    }
+
+    for (unsigned i = 0; i < BatchSize / 8 and liveCount; ++i) {
+      void* o = live[random() % liveCount];
+      set(o, random() % fieldCount(id(o)), fresh[random() % BatchSize]);
+    }
+
+    roots[random() % RootCount] = fresh[random() % BatchSize];
+    roots[random() % RootCount] = fresh[random() % BatchSize];
+  }
+
+  bool verify(void** list, unsigned n)
+  {
+    for (unsigned i = 0; i < n; ++i) {
+      void* o = list[i];
+      if (o >= arena and o < arena + arenaPosition) {
+        return false;
+      }
+
+      for (unsigned j = 0; j < fieldCount(id(o)); ++j) {
+        void* child = field(o, j);
+        unsigned expected = model[id(o)][j];
+        if ((child ? id(child) : 0) != expected
+            or (child and where[expected] != child)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  Heap* heap;
+  void** live;
+  uintptr_t* arena;
+  unsigned arenaPosition;
+  unsigned count;
+  unsigned seed;
+  bool pretenure;
+  unsigned pretenured;
+  bool sawTenured;
+  void* roots[RootCount];
+  void* blobs[BlobCount];
+  unsigned model[ObjectCount][FieldCount];
+  void* where[ObjectCount];
+};
+
+bool collectGraph(unsigned threads,
+                  bool concurrentMarking,
+                  bool compaction,
+                  bool largePages,
+                  bool pretenure = false,
+                  unsigned incrementalPause = 0)
+{
+  System* s = makeSystem();
+  Heap* h = makeHeap(s, 64 * 1024 * 1024);
+  h->setCollectorThreads(threads);
+  h->setConcurrentMarking(concurrentMarking);
+  if (incrementalPause) {
+    h->setIncrementalMarking(incrementalPause);
+  }
+  h->setGen2Compaction(compaction);
+  h->setLargePages(largePages);
+
+  void** list = static_cast<void**>(h->allocate(ObjectCount * BytesPerWord));
+
+  Graph* g = static_cast<Graph*>(h->allocate(sizeof(Graph)));
+  new (g) Graph(h, list);
+  g->pretenure = pretenure;
+  h->setClient(g);
+
+  bool success = true;
+  for (unsigned i = 0; i < 32 and success; ++i) {
+    g->mutate();
+
+    h->collect(i % 8 == 7 ? Heap::MajorCollection : Heap::MinorCollection,
+               g->arenaPosition,
+               0);
+
+    success = g->verify(list, g->reachable(list, ObjectCount));
+
+    h->free(g->arena, ArenaSizeInWords * BytesPerWord);
+  }
+
+  // objects allocated directly in gen2 should have been mixed in
+  success = success and pretenure == (g->pretenured != 0);
+
+  h->free(list, ObjectCount * BytesPerWord);
+  h->free(g, sizeof(Graph));
+  h->disposeFixies();
+  h->dispose();
+  s->dispose();
+
+  return success;
+}
+
+unsigned used(Heap* h)
+{
+  return h->limit() - h->remaining();
+}
+
+bool collectBlobs()
+{
+  System* s = makeSystem();
+  Heap* h = makeHeap(s, 64 * 1024 * 1024);
+
+  Graph* g = static_cast<Graph*>(h->allocate(sizeof(Graph)));
+  new (g) Graph(h, 0);
+  h->setClient(g);
+
+  // start with gen2 already at its initial size so that later major
+  // collections don't change the footprint of anything but the blobs
+  h->collect(Heap::MajorCollection, 0, 0);
+
+  g->blobs[0] = g->makeBlob(0);
+  unsigned before = used(h);
+  g->blobs[1] = g->makeBlob(1);
+  unsigned blobFootprint = used(h) - before;
+  before -= blobFootprint;
+
+  for (unsigned i = 2; i < BlobCount; ++i) {
+    g->blobs[i] = g->makeBlob(i);
+  }
+
+  bool success = blobFootprint >= BlobSizeInWords * BytesPerWord
+                 and used(h) - before == BlobCount * blobFootprint
+                 and g->intact(g->blobs[0], 0);
+
+  // unreachable blobs are released by the next minor collection
+  for (unsigned i = 2; i < BlobCount; ++i) {
+    g->blobs[i] = 0;
+  }
+  h->collect(Heap::MinorCollection, 0, 0);
+  success = success and used(h) - before == 2 * blobFootprint;
+
+  // once tenured, only a major collection will release them
+  for (unsigned i = 0; i < FixieTenureThreshold; ++i) {
+    h->collect(Heap::MinorCollection, 0, 0);
+  }
+  g->blobs[0] = 0;
+  h->collect(Heap::MinorCollection, 0, 0);
+  success = success and used(h) - before == 2 * blobFootprint;
+
+  h->collect(Heap::MajorCollection, 0, 0);
+  success = success and used(h) - before == blobFootprint
+            and g->intact(g->blobs[1], 1);
+
+  g->blobs[1] = 0;
+  h->collect(Heap::MajorCollection, 0, 0);
+  success = success and used(h) == before;
+
+  h->free(g, sizeof(Graph));
+  h->disposeFixies();
+  h->dispose();
+  s->dispose();
+
+  return success;
+}
+
+bool releaseUnused()
+{
+  System* s = makeSystem();
+  Heap* h = makeHeap(s, 64 * 1024 * 1024);
+
+  Graph* g = static_cast<Graph*>(h->allocate(sizeof(Graph)));
+  new (g) Graph(h, 0);
+  h->setClient(g);
+
+  h->collect(Heap::MajorCollection, 0, 0);
+  unsigned before = h->committed();
+  bool success = h->unused() <= before;
+
+  // an empty gen2 is given back to the system once things stay quiet
+  for (unsigned i = 0; i < 16; ++i) {
+    h->collect(Heap::MinorCollection, 0, 0);
+  }
+
+  success = success and h->committed() + (1024 * 1024) < before
+            and h->unused() <= h->committed();
+
+  h->free(g, sizeof(Graph));
+  h->disposeFixies();
+  h->dispose();
+  s->dispose();
+
+  return success;
+}
+
+bool collectStatistics(unsigned threads)
+{
+  System* s = makeSystem();
+  Heap* h = makeHeap(s, 64 * 1024 * 1024);
+  h->setCollectorThreads(threads);
+
+  void** list = static_cast<void**>(h->allocate(ObjectCount * BytesPerWord));
+
+  Graph* g = static_cast<Graph*>(h->allocate(sizeof(Graph)));
+  new (g) Graph(h, list);
+  h->setClient(g);
+
+  const Heap::Statistics& stats = h->statistics();
+  bool success = stats.collections == 0;
+  bool tenured = false;
+  unsigned majorCollections = 0;
+
+  for (unsigned i = 0; i < 8 and success; ++i) {
+    g->mutate();
+
+    // the heap may promote any of these to a major collection
+    h->collect(i == 7 ? Heap::MajorCollection : Heap::MinorCollection,
+               g->arenaPosition,
+               0);
+
+    Heap::CollectionType type = h->collectionType();
+    if (type == Heap::MajorCollection) {
+      ++majorCollections;
+    }
+    tenured = tenured or stats.tenured;
+
+    success = stats.collections == i + 1 and stats.type == type
+              and stats.majorCollections == majorCollections
+              and stats.pauseTime >= 0
+              and stats.pauseTime <= stats.maxPauseTime
+              and stats.maxPauseTime <= stats.totalPauseTime
+              and (type == Heap::MajorCollection
+                   or stats.gen2After >= stats.gen2Before)
+              and stats.copied > 0
+              and stats.tenured <= stats.copied
+              and stats.tenured <= stats.gen2After;
+
+    h->free(g->arena, ArenaSizeInWords * BytesPerWord);
+  }
+
+  // the client hears about objects promoted by minor collections
+  success = success and g->sawTenured;
+
+  h->free(list, ObjectCount * BytesPerWord);
+  h->free(g, sizeof(Graph));
+  h->disposeFixies();
+  h->dispose();
+  s->dispose();
+
+  return success and tenured;
+}
+
+}  // namespace
+
+bool directMemory()
+{
+  System* s = makeSystem();
+  Heap* h = makeHeap(s, 64 * 1024 * 1024);
+  const Heap::Statistics& stats = h->statistics();
+
+  const unsigned Count = 1024;
+  const size_t Sizes[] = {1, 64, 100, 16 * 1024, Heap::MaxPooledDirectSize};
+  const unsigned SizeCount = sizeof(Sizes) / sizeof(size_t);
+
+  Heap::DirectCache a;
+  Heap::DirectCache b;
+  void** blocks = static_cast<void**>(h->allocate(Count * sizeof(void*)));
+  bool success = true;
+
+  for (unsigned round = 0; round < 4 and success; ++round) {
+    for (unsigned i = 0; i < Count and success; ++i) {
+      size_t size = Sizes[i % SizeCount];
+      blocks[i] = h->tryAllocateDirect(&a, size);
+      success = blocks[i] != 0;
+      if (success) {
+        memset(blocks[i], i, size);
+      }
+    }
+
+    unsigned footprint = stats.directFootprint;
+
+    // free half of them from another thread's cache, which exchanges
+    // them with the first through the depot
+    for (unsigned i = 0; i < Count and success; ++i) {
+      size_t size = Sizes[i % SizeCount];
+      uint8_t* p = static_cast<uint8_t*>(blocks[i]);
+      success = p[0] == static_cast<uint8_t>(i)
+                and p[size - 1] == static_cast<uint8_t>(i);
+      h->freeDirect(i % 2 ? &a : &b, blocks[i]);
+    }
+    h->flushDirect(&b);
+
+    // later rounds recycle what earlier ones freed
+    success = success and stats.directFootprint == footprint
+              and stats.directPooled > 0
+              and stats.directPooled <= stats.directFootprint;
+  }
+
+  // large blocks aren't pooled, and go back to the system when freed
+  unsigned footprint = stats.directFootprint;
+  void* large = h->tryAllocateDirect(&a, Heap::MaxPooledDirectSize + 1);
+  success = success and large
+            and stats.directFootprint > footprint + Heap::MaxPooledDirectSize;
+  if (large) {
+    h->freeDirect(&a, large);
+  }
+  success = success and stats.directFootprint == footprint;
+
+  h->flushDirect(&a);
+  h->free(blocks, Count * sizeof(void*));
+  h->dispose();
+  s->dispose();
+
+  return success;
+}
+
+TEST(HeapSerialCollection)
+{
+  assertTrue(collectGraph(1, false, false, false));
+}
+
+TEST(HeapParallelCollection)
+{
+  assertTrue(collectGraph(4, false, false, false));
+}
+
+TEST(HeapConcurrentMarking)
+{
+  assertTrue(collectGraph(1, true, false, false));
+  assertTrue(collectGraph(4, true, false, false));
+}
+
+TEST(HeapIncrementalMarking)
+{
+  assertTrue(collectGraph(1, false, false, false, false, 2));
+  assertTrue(collectGraph(4, false, true, false, true, 2));
+}
+
+TEST(HeapCompaction)
+{
+  assertTrue(collectGraph(1, false, true, false));
+  assertTrue(collectGraph(4, true, true, false));
+}
+
+TEST(HeapLargePages)
+{
+  assertTrue(collectGraph(1, false, false, true));
+  assertTrue(collectGraph(4, true, true, true));
+}
+
+TEST(HeapPretenuring)
+{
+  assertTrue(collectGraph(1, false, false, false, true));
+  assertTrue(collectGraph(4, true, false, false, true));
+  assertTrue(collectGraph(4, true, true, false, true));
+}
+
+TEST(HeapLargeObjects)
+{
+  assertTrue(collectBlobs());
+}
+
+TEST(HeapStatistics)
+{
+  assertTrue(collectStatistics(1));
+  assertTrue(collectStatistics(4));
+}
+
+TEST(HeapReleaseUnused)
+{
+  assertTrue(releaseUnused());
+}
+
+TEST(HeapDirectMemory)
+{
+  assertTrue(directMemory());
+}
@@ -134,3 +134,9 @@
  -keepclassmembers class avian.Classes {
    public java.security.ProtectionDomain getProtectionDomain(avian.VMClass);
  }
+
+# called via JNI by RandomAccessFile.map:
+
+-keepclassmembers class java.nio.MappedByteBuffer {
+   private <init>(long, int, boolean, long, long);
+ }